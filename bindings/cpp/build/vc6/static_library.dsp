@@ -269,6 +269,19 @@ SOURCE=..\..\source\portaudiocpp\StreamParameters.cxx
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\source\portaudiocpp\StreamReactor.cxx
+
+!IF  "$(CFG)" == "static_library - Win32 Release"
+
+!ELSEIF  "$(CFG)" == "static_library - Win32 Debug"
+
+# SUBTRACT CPP /YX
+
+!ENDIF 
+
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\source\portaudiocpp\System.cxx
 
 !IF  "$(CFG)" == "static_library - Win32 Release"
@@ -352,6 +365,10 @@ SOURCE=..\..\include\portaudiocpp\Exception.hxx
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\include\portaudiocpp\FrameBuffers.hxx
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\include\portaudiocpp\HostApi.hxx
 # End Source File
 # Begin Source File
@@ -368,6 +385,10 @@ SOURCE=..\..\include\portaudiocpp\PortAudioCpp.hxx
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\include\portaudiocpp\RingBuffer.hxx
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\include\portaudiocpp\SampleDataFormat.hxx
 # End Source File
 # Begin Source File
@@ -380,6 +401,10 @@ SOURCE=..\..\include\portaudiocpp\StreamParameters.hxx
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\include\portaudiocpp\StreamReactor.hxx
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\include\portaudiocpp\System.hxx
 # End Source File
 # Begin Source File
@@ -390,6 +415,10 @@ SOURCE=..\..\include\portaudiocpp\SystemDeviceIterator.hxx
 
 SOURCE=..\..\include\portaudiocpp\SystemHostApiIterator.hxx
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\include\portaudiocpp\TypedCallbackStream.hxx
+# End Source File
 # End Group
 # End Target
 # End Project
@@ -3,7 +3,11 @@
 
 // ---------------------------------------------------------------------------------------
 
+#include <cstddef>
+
 #include "portaudiocpp/Stream.hxx"
+#include "portaudiocpp/FrameBuffers.hxx"
+#include "portaudiocpp/RingBuffer.hxx"
 
 // ---------------------------------------------------------------------------------------
 
@@ -26,9 +30,163 @@ namespace portaudio
 
 		void read(void *buffer, unsigned long numFrames);
 		void write(const void *buffer, unsigned long numFrames);
+		void read(void *buffer, unsigned long numFrames, PaError &error) PORTAUDIOCPP_NOEXCEPT;
+		void write(const void *buffer, unsigned long numFrames, PaError &error) PORTAUDIOCPP_NOEXCEPT;
+
+		unsigned long readSome(void *buffer, unsigned long numFrames, bool *overflowed = NULL);
+		unsigned long writeSome(const void *buffer, unsigned long numFrames, bool *underflowed = NULL);
+		unsigned long readSome(void *buffer, unsigned long numFrames, bool *overflowed, PaError &error) PORTAUDIOCPP_NOEXCEPT;
+		unsigned long writeSome(const void *buffer, unsigned long numFrames, bool *underflowed, PaError &error) PORTAUDIOCPP_NOEXCEPT;
+
+		//////
+		/// Reads or writes all frames of a view. The view must match the sample format and
+		/// layout (interleaved or not) the stream was opened with.
+		//////
+		template<typename SampleT, int Channels>
+		void read(const InterleavedFrames<SampleT, Channels> &frames)
+		{
+			read(frames.buffer(), frames.numFrames());
+		}
+
+		template<typename SampleT, int Channels>
+		void read(const NonInterleavedFrames<SampleT, Channels> &frames)
+		{
+			read(frames.buffer(), frames.numFrames());
+		}
+
+		template<typename SampleT, int Channels>
+		void write(const InterleavedFrames<SampleT, Channels> &frames)
+		{
+			write(frames.buffer(), frames.numFrames());
+		}
+
+		template<typename SampleT, int Channels>
+		void write(const NonInterleavedFrames<SampleT, Channels> &frames)
+		{
+			write(frames.buffer(), frames.numFrames());
+		}
+
+		template<typename SampleT, int Channels>
+		void read(const InterleavedFrames<SampleT, Channels> &frames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+		{
+			read(frames.buffer(), frames.numFrames(), error);
+		}
+
+		template<typename SampleT, int Channels>
+		void read(const NonInterleavedFrames<SampleT, Channels> &frames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+		{
+			read(frames.buffer(), frames.numFrames(), error);
+		}
+
+		template<typename SampleT, int Channels>
+		void write(const InterleavedFrames<SampleT, Channels> &frames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+		{
+			write(frames.buffer(), frames.numFrames(), error);
+		}
+
+		template<typename SampleT, int Channels>
+		void write(const NonInterleavedFrames<SampleT, Channels> &frames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+		{
+			write(frames.buffer(), frames.numFrames(), error);
+		}
+
+#ifdef PORTAUDIOCPP_HAS_RINGBUFFER
+		//////
+		/// Reads up to maxFrames frames straight into the free space of a ring buffer and
+		/// publishes them to its reader, or writes up to maxFrames frames straight from the
+		/// readable elements of a ring buffer and releases them to its writer. Returns the
+		/// number of frames transferred, which is only less than maxFrames if the ring buffer
+		/// had no more room or frames. Blocks as read() and write() do.
+		///
+		/// FrameT is one frame of an interleaved stream, such as float for a mono or
+		/// std::array<float, 2> for a stereo paFloat32 stream, the stream must be opened
+		/// with a matching sample format and channel count.
+		//////
+		template<typename FrameT, std::size_t Capacity>
+		unsigned long readInto(RingBuffer<FrameT, Capacity> &ring, unsigned long maxFrames)
+		{
+			RingBufferRegions<FrameT> regions = ring.getWriteRegions(maxFrames);
+			// Publish each region once read, so a throwing second read() doesn't lose the first
+			if (!regions.first.empty())
+			{
+				read(regions.first.data(), regions.first.size());
+				ring.advanceWriteIndex(regions.first.size());
+			}
+			if (!regions.second.empty())
+			{
+				read(regions.second.data(), regions.second.size());
+				ring.advanceWriteIndex(regions.second.size());
+			}
+			return static_cast<unsigned long>(regions.size());
+		}
+
+		template<typename FrameT, std::size_t Capacity>
+		unsigned long writeFrom(RingBuffer<FrameT, Capacity> &ring, unsigned long maxFrames)
+		{
+			RingBufferRegions<const FrameT> regions = static_cast<const RingBuffer<FrameT, Capacity> &>(ring).getReadRegions(maxFrames);
+			// Release each region once written, so a throwing second write() doesn't resend the first
+			if (!regions.first.empty())
+			{
+				write(regions.first.data(), regions.first.size());
+				ring.advanceReadIndex(regions.first.size());
+			}
+			if (!regions.second.empty())
+			{
+				write(regions.second.data(), regions.second.size());
+				ring.advanceReadIndex(regions.second.size());
+			}
+			return static_cast<unsigned long>(regions.size());
+		}
+
+		//////
+		/// Non-throwing readInto() and writeFrom(), only the frames transferred before an
+		/// error are published to or released from the ring buffer.
+		//////
+		template<typename FrameT, std::size_t Capacity>
+		unsigned long readInto(RingBuffer<FrameT, Capacity> &ring, unsigned long maxFrames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+		{
+			RingBufferRegions<FrameT> regions = ring.getWriteRegions(maxFrames);
+			std::size_t frames = 0;
+			error = paNoError;
+			if (!regions.first.empty())
+				read(regions.first.data(), regions.first.size(), error);
+			if (error == paNoError)
+			{
+				frames = regions.first.size();
+				if (!regions.second.empty())
+					read(regions.second.data(), regions.second.size(), error);
+				if (error == paNoError)
+					frames = regions.size();
+			}
+			ring.advanceWriteIndex(frames);
+			return static_cast<unsigned long>(frames);
+		}
+
+		template<typename FrameT, std::size_t Capacity>
+		unsigned long writeFrom(RingBuffer<FrameT, Capacity> &ring, unsigned long maxFrames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+		{
+			RingBufferRegions<const FrameT> regions = static_cast<const RingBuffer<FrameT, Capacity> &>(ring).getReadRegions(maxFrames);
+			std::size_t frames = 0;
+			error = paNoError;
+			if (!regions.first.empty())
+				write(regions.first.data(), regions.first.size(), error);
+			if (error == paNoError)
+			{
+				frames = regions.first.size();
+				if (!regions.second.empty())
+					write(regions.second.data(), regions.second.size(), error);
+				if (error == paNoError)
+					frames = regions.size();
+			}
+			ring.advanceReadIndex(frames);
+			return static_cast<unsigned long>(frames);
+		}
+#endif
 
 		signed long availableReadSize() const;
 		signed long availableWriteSize() const;
+		signed long availableReadSize(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
+		signed long availableWriteSize(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
 
 	private:
 		BlockingStream(const BlockingStream &); // non-copyable
@@ -0,0 +1,287 @@
+#ifndef INCLUDED_PORTAUDIO_FRAMEBUFFERS_HXX
+#define INCLUDED_PORTAUDIO_FRAMEBUFFERS_HXX
+
+// ---------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// ---------------------------------------------------------------------------------------
+
+namespace portaudio
+{
+
+
+	//////
+	/// @brief Channel count template argument of the frame buffer views meaning that the number
+	/// of channels is only known at run time and is passed to the constructor.
+	//////
+	const int DYNAMIC_CHANNELS = -1;
+
+	namespace impl
+	{
+		//////
+		/// @brief The channel count of a view, a compile time constant unless Channels is
+		/// DYNAMIC_CHANNELS.
+		//////
+		template<int Channels>
+		class ChannelCount
+		{
+		public:
+			explicit ChannelCount(int) {}
+			int numChannels() const { return Channels; }
+		};
+
+		template<>
+		class ChannelCount<DYNAMIC_CHANNELS>
+		{
+		public:
+			explicit ChannelCount(int numChannels) : numChannels_(numChannels) {}
+			int numChannels() const { return numChannels_; }
+		private:
+			int numChannels_;
+		};
+
+		//////
+		/// @brief void with the constness of T, the type PortAudio passes buffers of T as.
+		//////
+		template<typename T> struct VoidOf { typedef void type; };
+		template<typename T> struct VoidOf<const T> { typedef const void type; };
+	}
+
+	// -----------------------------------------------------------------------------------
+
+	//////
+	/// @brief A view of a buffer of interleaved frames, as PortAudio passes them unless
+	/// paNonInterleaved is set. The view doesn't own the samples, it is as cheap to pass by value
+	/// as a pointer.
+	///
+	/// SampleT may be const for input buffers. If Channels is a compile time constant instead of
+	/// DYNAMIC_CHANNELS, the compiler can unroll and vectorize loops over the channels of a frame.
+	///
+	/// Example usage in a callback:
+	/// @verbatim InterleavedFrames<float, 2> out(outputBuffer, numFrames); out(i, 1) = out(i, 0); @endverbatim
+	//////
+	template<typename SampleT, int Channels = DYNAMIC_CHANNELS>
+	class InterleavedFrames : private impl::ChannelCount<Channels>
+	{
+	public:
+		typedef SampleT SampleType;
+		static const int CHANNELS = Channels;
+
+		InterleavedFrames(typename impl::VoidOf<SampleT>::type *buffer, unsigned long numFrames, int numChannels = Channels)
+			: impl::ChannelCount<Channels>(numChannels), data_(static_cast<SampleT *>(buffer)), numFrames_(numFrames)
+		{
+		}
+
+		InterleavedFrames(SampleT *data, unsigned long numFrames, int numChannels = Channels)
+			: impl::ChannelCount<Channels>(numChannels), data_(data), numFrames_(numFrames)
+		{
+		}
+
+		//////
+		/// Views a mutable buffer as a const one.
+		//////
+		template<typename OtherSampleT>
+		InterleavedFrames(const InterleavedFrames<OtherSampleT, Channels> &other)
+			: impl::ChannelCount<Channels>(other.numChannels()), data_(other.data()), numFrames_(other.numFrames())
+		{
+		}
+
+		using impl::ChannelCount<Channels>::numChannels;
+
+		unsigned long numFrames() const
+		{
+			return numFrames_;
+		}
+
+		unsigned long numSamples() const
+		{
+			return numFrames_ * numChannels();
+		}
+
+		SampleT *data() const
+		{
+			return data_;
+		}
+
+		//////
+		/// Returns the buffer in the form BlockingStream::read() and write() take it.
+		//////
+		typename impl::VoidOf<SampleT>::type *buffer() const
+		{
+			return data_;
+		}
+
+		//////
+		/// Returns the first sample of a frame.
+		//////
+		SampleT *operator[](unsigned long frame) const
+		{
+			return data_ + frame * numChannels();
+		}
+
+		SampleT &operator()(unsigned long frame, int channel) const
+		{
+			return data_[frame * numChannels() + channel];
+		}
+
+		//////
+		/// Returns the view of numFrames frames starting at frame first.
+		//////
+		InterleavedFrames frames(unsigned long first, unsigned long numFrames) const
+		{
+			return InterleavedFrames(data_ + first * numChannels(), numFrames, numChannels());
+		}
+
+	private:
+		SampleT *data_;
+		unsigned long numFrames_;
+	};
+
+	// -----------------------------------------------------------------------------------
+
+	//////
+	/// @brief A view of a non-interleaved buffer, an array of one pointer per channel to the
+	/// samples of that channel, as PortAudio passes it if paNonInterleaved is set. The view
+	/// doesn't own the array or the samples.
+	///
+	/// Example usage in a callback:
+	/// @verbatim NonInterleavedFrames<const float> in(inputBuffer, numFrames, numChannels); @endverbatim
+	//////
+	template<typename SampleT, int Channels = DYNAMIC_CHANNELS>
+	class NonInterleavedFrames : private impl::ChannelCount<Channels>
+	{
+	public:
+		typedef SampleT SampleType;
+		static const int CHANNELS = Channels;
+
+		NonInterleavedFrames(typename impl::VoidOf<SampleT>::type *buffer, unsigned long numFrames, int numChannels = Channels)
+			: impl::ChannelCount<Channels>(numChannels), channels_(static_cast<SampleT *const *>(buffer)), numFrames_(numFrames)
+		{
+		}
+
+		NonInterleavedFrames(SampleT *const *channels, unsigned long numFrames, int numChannels = Channels)
+			: impl::ChannelCount<Channels>(numChannels), channels_(channels), numFrames_(numFrames)
+		{
+		}
+
+		using impl::ChannelCount<Channels>::numChannels;
+
+		unsigned long numFrames() const
+		{
+			return numFrames_;
+		}
+
+		SampleT *const *channels() const
+		{
+			return channels_;
+		}
+
+		//////
+		/// Returns the buffer in the form BlockingStream::read() and write() take it.
+		//////
+		typename impl::VoidOf<SampleT>::type *buffer() const
+		{
+			return const_cast<SampleT **>(channels_);
+		}
+
+		//////
+		/// Returns the samples of a channel.
+		//////
+		SampleT *operator[](int channel) const
+		{
+			return channels_[channel];
+		}
+
+		SampleT &operator()(unsigned long frame, int channel) const
+		{
+			return channels_[channel][frame];
+		}
+
+	private:
+		SampleT *const *channels_;
+		unsigned long numFrames_;
+	};
+
+	// -----------------------------------------------------------------------------------
+
+	//////
+	/// @brief Owns a fixed number of equally sized buffers of frames which are allocated once,
+	/// so that a client can hand buffers between its threads and a BlockingStream and process
+	/// them in place without allocating on the way.
+	///
+	/// Each buffer can be viewed as interleaved or non-interleaved frames; the pool's layout
+	/// doesn't change, only the way the samples of a buffer are addressed. A pool is
+	/// non-copyable, ownership of the buffers may be exchanged with swap(). Views of a buffer
+	/// remain valid until the pool owning it is destroyed, swap() doesn't move the samples.
+	///
+	/// If Channels is DYNAMIC_CHANNELS, the number of channels must be passed to the
+	/// constructor.
+	//////
+	template<typename SampleT, int Channels = DYNAMIC_CHANNELS>
+	class FrameBufferPool : private impl::ChannelCount<Channels>
+	{
+	public:
+		typedef InterleavedFrames<SampleT, Channels> InterleavedBuffer;
+		typedef NonInterleavedFrames<SampleT, Channels> NonInterleavedBuffer;
+
+		FrameBufferPool(std::size_t numBuffers, unsigned long framesPerBuffer, int numChannels = Channels)
+			: impl::ChannelCount<Channels>(numChannels), framesPerBuffer_(framesPerBuffer),
+			samples_(numBuffers * framesPerBuffer * this->numChannels()), channels_(numBuffers * this->numChannels())
+		{
+			if (!samples_.empty())
+			{
+				for (std::size_t i = 0; i < channels_.size(); ++i)
+					channels_[i] = &samples_[0] + i * framesPerBuffer;
+			}
+		}
+
+		using impl::ChannelCount<Channels>::numChannels;
+
+		std::size_t numBuffers() const
+		{
+			return (numChannels() == 0) ? 0 : channels_.size() / numChannels();
+		}
+
+		unsigned long framesPerBuffer() const
+		{
+			return framesPerBuffer_;
+		}
+
+		InterleavedBuffer interleaved(std::size_t index)
+		{
+			return InterleavedBuffer(&samples_[0] + index * framesPerBuffer_ * numChannels(), framesPerBuffer_, numChannels());
+		}
+
+		NonInterleavedBuffer nonInterleaved(std::size_t index)
+		{
+			return NonInterleavedBuffer(&channels_[0] + index * numChannels(), framesPerBuffer_, numChannels());
+		}
+
+		void swap(FrameBufferPool &other)
+		{
+			impl::ChannelCount<Channels> tmp = *this;
+			static_cast<impl::ChannelCount<Channels> &>(*this) = other;
+			static_cast<impl::ChannelCount<Channels> &>(other) = tmp;
+			std::swap(framesPerBuffer_, other.framesPerBuffer_);
+			samples_.swap(other.samples_);
+			channels_.swap(other.channels_);
+		}
+
+	private:
+		FrameBufferPool(const FrameBufferPool &); // non-copyable
+		FrameBufferPool &operator=(const FrameBufferPool &); // non-copyable
+
+		unsigned long framesPerBuffer_;
+		std::vector<SampleT> samples_;
+		std::vector<SampleT *> channels_;
+	};
+
+
+} // namespace portaudio
+
+// ---------------------------------------------------------------------------------------
+
+#endif // INCLUDED_PORTAUDIO_FRAMEBUFFERS_HXX
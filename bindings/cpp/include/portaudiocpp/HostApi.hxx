@@ -55,7 +55,7 @@ namespace portaudio
 
 	private:
 		const PaHostApiInfo *info_;
-		Device **devices_;
+		PaDeviceIndex firstDevice_; // the Devices of a HostApi are consecutive in the System's Device table
 
 	private:
 		friend class System;
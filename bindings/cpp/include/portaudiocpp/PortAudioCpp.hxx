@@ -93,16 +93,20 @@
 #include "portaudiocpp/CppFunCallbackStream.hxx"
 #include "portaudiocpp/Device.hxx"
 #include "portaudiocpp/Exception.hxx"
+#include "portaudiocpp/FrameBuffers.hxx"
 #include "portaudiocpp/HostApi.hxx"
 #include "portaudiocpp/InterfaceCallbackStream.hxx"
 #include "portaudiocpp/MemFunCallbackStream.hxx"
+#include "portaudiocpp/RingBuffer.hxx"
 #include "portaudiocpp/SampleDataFormat.hxx"
 #include "portaudiocpp/DirectionSpecificStreamParameters.hxx"
 #include "portaudiocpp/Stream.hxx"
 #include "portaudiocpp/StreamParameters.hxx"
+#include "portaudiocpp/StreamReactor.hxx"
 #include "portaudiocpp/System.hxx"
 #include "portaudiocpp/SystemDeviceIterator.hxx"
 #include "portaudiocpp/SystemHostApiIterator.hxx"
+#include "portaudiocpp/TypedCallbackStream.hxx"
 
 // ---------------------------------------------------------------------------------------
 
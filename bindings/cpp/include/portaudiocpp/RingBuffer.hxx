@@ -0,0 +1,280 @@
+#ifndef INCLUDED_PORTAUDIO_RINGBUFFER_HXX
+#define INCLUDED_PORTAUDIO_RINGBUFFER_HXX
+
+// ---------------------------------------------------------------------------------------
+
+#include <cstddef>
+
+// The ring buffer needs std::atomic and move semantics:
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#include <atomic>
+#include <utility>
+#define PORTAUDIOCPP_HAS_RINGBUFFER 1
+#endif
+
+// ---------------------------------------------------------------------------------------
+
+#ifdef PORTAUDIOCPP_HAS_RINGBUFFER
+
+namespace portaudio
+{
+
+
+	//////
+	/// @brief A contiguous range of elements of a RingBuffer, the typed counterpart of the
+	/// (void *, size) pairs of PaUtil_GetRingBufferReadRegions() and
+	/// PaUtil_GetRingBufferWriteRegions(). Doesn't own the elements.
+	//////
+	template<typename T>
+	class RingBufferSpan
+	{
+	public:
+		constexpr RingBufferSpan() : data_(nullptr), size_(0) {}
+		constexpr RingBufferSpan(T *data, std::size_t size) : data_(data), size_(size) {}
+
+		T *data() const { return data_; }
+		std::size_t size() const { return size_; }
+		bool empty() const { return size_ == 0; }
+
+		T *begin() const { return data_; }
+		T *end() const { return data_ + size_; }
+
+		T &operator[](std::size_t index) const { return data_[index]; }
+
+	private:
+		T *data_;
+		std::size_t size_;
+	};
+
+	//////
+	/// @brief The up to two spans a number of elements of a RingBuffer occupy, second is only
+	/// non-empty if they wrap around the end of the buffer.
+	//////
+	template<typename T>
+	struct RingBufferRegions
+	{
+		RingBufferSpan<T> first;
+		RingBufferSpan<T> second;
+
+		std::size_t size() const { return first.size() + second.size(); }
+	};
+
+	// -----------------------------------------------------------------------------------
+
+	//////
+	/// @brief Lock-free single-reader single-writer ring buffer of Capacity elements of type T,
+	/// with the element type and capacity known at compile time.
+	///
+	/// It uses the scheme of PaUtilRingBuffer (pa_ringbuffer.c): the read and write indices
+	/// run over twice the capacity, so that a full buffer can be told from an empty one, and
+	/// are published with release stores and read with acquire loads where PaUtilRingBuffer
+	/// uses memory barriers. As Capacity is a power of two constant, wrapping an index is a
+	/// constant mask and all counts are in elements, there is no element size arithmetic.
+	///
+	/// One thread may write (push(), write(), getWriteRegions(), advanceWriteIndex()) while one
+	/// other thread reads (pop(), read(), getReadRegions(), advanceReadIndex()), for example a
+	/// callback and the thread feeding or draining it. T is typically a sample type, or a frame
+	/// type such as std::array<float, 2> so that a span of elements is a buffer of interleaved
+	/// frames, see BlockingStream::readInto() and BlockingStream::writeFrom().
+	///
+	/// The elements are stored in the object and stay constructed, T must be default
+	/// constructible; read() and pop() move elements out and leave moved-from elements behind.
+	/// Large buffers should not be placed on the stack. The buffer is non-copyable.
+	//////
+	template<typename T, std::size_t Capacity>
+	class RingBuffer
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "RingBuffer Capacity must be a power of two");
+		static_assert(Capacity <= (~std::size_t(0) >> 1), "RingBuffer Capacity too large");
+
+	public:
+		typedef T ValueType;
+		typedef RingBufferSpan<T> Span;
+		typedef RingBufferSpan<const T> ConstSpan;
+		typedef RingBufferRegions<T> Regions;
+		typedef RingBufferRegions<const T> ConstRegions;
+
+		RingBuffer() : writeIndex_(0), readIndex_(0)
+		{
+		}
+
+		RingBuffer(const RingBuffer &) = delete;
+		RingBuffer &operator=(const RingBuffer &) = delete;
+
+		static constexpr std::size_t capacity()
+		{
+			return Capacity;
+		}
+
+		//////
+		/// Number of elements which can be read.
+		//////
+		std::size_t readAvailable() const
+		{
+			return (writeIndex_.load(std::memory_order_acquire) - readIndex_.load(std::memory_order_relaxed)) & BIG_MASK;
+		}
+
+		//////
+		/// Number of elements which can be written.
+		//////
+		std::size_t writeAvailable() const
+		{
+			return Capacity - ((writeIndex_.load(std::memory_order_relaxed) - readIndex_.load(std::memory_order_acquire)) & BIG_MASK);
+		}
+
+		// Writer side:
+
+		//////
+		/// Returns the spans where up to count elements can be written, the writer fills them
+		/// in place and then publishes them with advanceWriteIndex().
+		//////
+		Regions getWriteRegions(std::size_t count)
+		{
+			const std::size_t available = writeAvailable();
+			const std::size_t index = writeIndex_.load(std::memory_order_relaxed) & SMALL_MASK;
+			if (count > available)
+				count = available;
+			return splitRegions<T>(data_, index, count);
+		}
+
+		void advanceWriteIndex(std::size_t count)
+		{
+			// The elements written before are visible to the reader once it sees the new index
+			writeIndex_.store((writeIndex_.load(std::memory_order_relaxed) + count) & BIG_MASK, std::memory_order_release);
+		}
+
+		bool push(const T &item)
+		{
+			return emplaceOne(item);
+		}
+
+		bool push(T &&item)
+		{
+			return emplaceOne(std::move(item));
+		}
+
+		//////
+		/// Writes up to count elements taken from first and returns how many were written.
+		/// The elements are copied, or moved if first is a std::move_iterator.
+		//////
+		template<typename InputIterator>
+		std::size_t write(InputIterator first, std::size_t count)
+		{
+			Regions regions = getWriteRegions(count);
+			for (T &element : regions.first)
+				element = *first++;
+			for (T &element : regions.second)
+				element = *first++;
+			advanceWriteIndex(regions.size());
+			return regions.size();
+		}
+
+		// Reader side:
+
+		//////
+		/// Returns the spans of up to count readable elements, which the reader processes in
+		/// place and then releases with advanceReadIndex().
+		//////
+		ConstRegions getReadRegions(std::size_t count) const
+		{
+			const std::size_t available = readAvailable();
+			const std::size_t index = readIndex_.load(std::memory_order_relaxed) & SMALL_MASK;
+			if (count > available)
+				count = available;
+			return splitRegions<const T>(data_, index, count);
+		}
+
+		Regions getReadRegions(std::size_t count)
+		{
+			const std::size_t available = readAvailable();
+			const std::size_t index = readIndex_.load(std::memory_order_relaxed) & SMALL_MASK;
+			if (count > available)
+				count = available;
+			return splitRegions<T>(data_, index, count);
+		}
+
+		void advanceReadIndex(std::size_t count)
+		{
+			// The elements read before are done with once the writer sees the new index
+			readIndex_.store((readIndex_.load(std::memory_order_relaxed) + count) & BIG_MASK, std::memory_order_release);
+		}
+
+		bool pop(T &item)
+		{
+			Regions regions = getReadRegions(1);
+			if (regions.first.empty())
+				return false;
+			item = std::move(regions.first[0]);
+			advanceReadIndex(1);
+			return true;
+		}
+
+		//////
+		/// Moves up to count elements to out and returns how many were read.
+		//////
+		template<typename OutputIterator>
+		std::size_t read(OutputIterator out, std::size_t count)
+		{
+			Regions regions = getReadRegions(count);
+			for (T &element : regions.first)
+				*out++ = std::move(element);
+			for (T &element : regions.second)
+				*out++ = std::move(element);
+			advanceReadIndex(regions.size());
+			return regions.size();
+		}
+
+		//////
+		/// Discards all elements. Not thread safe, neither the reader nor the writer may use
+		/// the buffer meanwhile, same as PaUtil_FlushRingBuffer().
+		//////
+		void clear()
+		{
+			writeIndex_.store(0, std::memory_order_relaxed);
+			readIndex_.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		static constexpr std::size_t SMALL_MASK = Capacity - 1;
+		static constexpr std::size_t BIG_MASK = Capacity * 2 - 1;
+
+		template<typename U, typename DataT>
+		static RingBufferRegions<U> splitRegions(DataT *data, std::size_t index, std::size_t count)
+		{
+			RingBufferRegions<U> regions;
+			if (index + count > Capacity)
+			{
+				regions.first = RingBufferSpan<U>(data + index, Capacity - index);
+				regions.second = RingBufferSpan<U>(data, count - (Capacity - index));
+			}
+			else
+			{
+				regions.first = RingBufferSpan<U>(data + index, count);
+			}
+			return regions;
+		}
+
+		template<typename U>
+		bool emplaceOne(U &&item)
+		{
+			Regions regions = getWriteRegions(1);
+			if (regions.first.empty())
+				return false;
+			regions.first[0] = std::forward<U>(item);
+			advanceWriteIndex(1);
+			return true;
+		}
+
+		T data_[Capacity];
+		std::atomic<std::size_t> writeIndex_;
+		std::atomic<std::size_t> readIndex_;
+	};
+
+
+} // namespace portaudio
+
+#endif // PORTAUDIOCPP_HAS_RINGBUFFER
+
+// ---------------------------------------------------------------------------------------
+
+#endif // INCLUDED_PORTAUDIO_RINGBUFFER_HXX
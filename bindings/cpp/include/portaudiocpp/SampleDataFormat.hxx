@@ -20,8 +20,10 @@ namespace portaudio
 	{
 		INVALID_FORMAT	= 0,
 		FLOAT32			= paFloat32,
+		FLOAT64			= paFloat64,
 		INT32			= paInt32,
 		INT24			= paInt24,
+		INT24_IN_32		= paInt24In32,
 		INT16			= paInt16,
 		INT8			= paInt8,
 		UINT8			= paUInt8
@@ -5,6 +5,15 @@
 
 // ---------------------------------------------------------------------------------------
 
+// Functions which report errors through a PaError instead of throwing:
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define PORTAUDIOCPP_NOEXCEPT noexcept
+#else
+#define PORTAUDIOCPP_NOEXCEPT throw()
+#endif
+
+// ---------------------------------------------------------------------------------------
+
 // Forward declaration(s):
 namespace portaudio
 {
@@ -30,6 +39,11 @@ namespace portaudio
 	///
 	/// The Stream object can be used to manipulate the Stream's state. Also, time-constant 
 	/// and time-varying information about the Stream can be retreived.
+	///
+	/// The queries, and the reads and writes of BlockingStream, have overloads taking a 
+	/// PaError reference which never throw. They set the error to paNoError on success 
+	/// and to PortAudio's error code otherwise, so they can be used on audio threads 
+	/// where unwinding an exception (e.g. for a common output underflow) is too costly.
 	//////
 	class Stream
 	{
@@ -38,7 +52,7 @@ namespace portaudio
 		virtual ~Stream();
 
 		virtual void close();
-		bool isOpen() const;
+		bool isOpen() const PORTAUDIOCPP_NOEXCEPT;
 
 		// Additional set up:
 		void setStreamFinishedCallback(PaStreamFinishedCallback *callback);
@@ -50,19 +64,24 @@ namespace portaudio
 
 		bool isStopped() const;
 		bool isActive() const;
+		bool isStopped(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
+		bool isActive(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
 
 		// Stream info (time-constant, but might become time-variant soon):
 		PaTime inputLatency() const;
 		PaTime outputLatency() const;
 		double sampleRate() const;
+		PaTime inputLatency(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
+		PaTime outputLatency(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
+		double sampleRate(PaError &error) const PORTAUDIOCPP_NOEXCEPT;
 
 		// Stream info (time-varying):
-		PaTime time() const;
+		PaTime time() const PORTAUDIOCPP_NOEXCEPT;
 
 		// Accessors for PortAudio PaStream, useful for interfacing 
 		// with PortAudio add-ons (such as PortMixer) for instance:
-		const PaStream *paStream() const;
-		PaStream *paStream();
+		const PaStream *paStream() const PORTAUDIOCPP_NOEXCEPT;
+		PaStream *paStream() PORTAUDIOCPP_NOEXCEPT;
 
 	protected:
 		Stream(); // abstract class
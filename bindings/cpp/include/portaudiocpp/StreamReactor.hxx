@@ -0,0 +1,188 @@
+#ifndef INCLUDED_PORTAUDIO_STREAMREACTOR_HXX
+#define INCLUDED_PORTAUDIO_STREAMREACTOR_HXX
+
+// ---------------------------------------------------------------------------------------
+
+#include <cstddef>
+
+#include "portaudio.h"
+
+#include "portaudiocpp/BlockingStream.hxx"
+#include "portaudiocpp/FrameBuffers.hxx"
+#include "portaudiocpp/Exception.hxx"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#include <coroutine>
+#define PORTAUDIOCPP_HAS_COROUTINES 1
+#endif
+
+// ---------------------------------------------------------------------------------------
+
+// Declaration(s):
+namespace portaudio
+{
+
+
+	//////
+	/// @brief Drives reads and writes of many BlockingStreams from one thread without
+	/// blocking it, for clients built around an event loop.
+	///
+	/// A pending transfer is an Operation, which is submitted to the reactor and completed
+	/// by later calls to poll(). poll() moves as many frames as each stream can take or give
+	/// without waiting (see BlockingStream::readSome()) and calls Operation::completed() for
+	/// the transfers which are done. Operations are linked into the reactor, submitting one
+	/// doesn't allocate.
+	///
+	/// The event loop calls poll() when a stream may have made progress: periodically, at
+	/// least every suggestedPollInterval() seconds, or when one of the stream's host API
+	/// specific handles becomes ready, such as the descriptors of
+	/// PaAlsa_GetStreamPollDescriptors() or the events of PaWinMME_GetStreamInputEvent()
+	/// and PaWinMME_GetStreamOutputEvent(). A reactor must only be used by one thread.
+	///
+	/// With C++20 coroutines, read() and write() return awaitables:
+	/// @verbatim co_await reactor.read(stream, InterleavedFrames<float, 2>(buffer, 256)); @endverbatim
+	//////
+	class StreamReactor
+	{
+	public:
+		//////
+		/// @brief A read or write of a number of interleaved frames, pending in a
+		/// StreamReactor until completed() is called.
+		//////
+		class Operation
+		{
+		public:
+			virtual ~Operation() {}
+
+			unsigned long framesDone() const;
+			unsigned long framesRemaining() const;
+
+			//////
+			/// Returns paNoError or the error which ended the transfer, such as
+			/// paStreamIsStopped.
+			//////
+			PaError error() const;
+
+			//////
+			/// Returns true if input overflowed or output underflowed while the transfer
+			/// was pending, which doesn't end it.
+			//////
+			bool xrunOccurred() const;
+
+		protected:
+			Operation(BlockingStream &stream, bool isRead, void *buffer, unsigned long numFrames,
+				unsigned long bytesPerFrame);
+
+			//////
+			/// Called once the transfer is complete or failed, may submit new Operations.
+			//////
+			virtual void completed() = 0;
+
+			bool progress(); // moves what can be moved without waiting, returns true when done or failed
+
+		private:
+			friend class StreamReactor;
+
+			Operation *next_;
+			BlockingStream *stream_;
+			bool isRead_;
+			unsigned char *buffer_;
+			unsigned long numFrames_;
+			unsigned long framesDone_;
+			unsigned long bytesPerFrame_;
+			PaError error_;
+			bool xrunOccurred_;
+
+			Operation(const Operation &); // non-copyable
+			Operation &operator=(const Operation &); // non-copyable
+		};
+
+		// -------------------------------------------------------------------------------
+
+		StreamReactor();
+		~StreamReactor();
+
+		void submit(Operation &operation);
+		void cancel(Operation &operation);
+
+		std::size_t poll();
+
+		bool idle() const;
+		double suggestedPollInterval() const;
+
+#ifdef PORTAUDIOCPP_HAS_COROUTINES
+		template<typename SampleT, int Channels>
+		class Awaitable;
+
+		template<typename SampleT, int Channels>
+		Awaitable<SampleT, Channels> read(BlockingStream &stream, const InterleavedFrames<SampleT, Channels> &frames)
+		{
+			return Awaitable<SampleT, Channels>(*this, stream, true, frames.buffer(), frames);
+		}
+
+		template<typename SampleT, int Channels>
+		Awaitable<SampleT, Channels> write(BlockingStream &stream, const InterleavedFrames<SampleT, Channels> &frames)
+		{
+			return Awaitable<SampleT, Channels>(*this, stream, false, const_cast<void *>(static_cast<const void *>(frames.buffer())), frames);
+		}
+#endif
+
+	private:
+		Operation *pending_;
+
+		StreamReactor(const StreamReactor &); // non-copyable
+		StreamReactor &operator=(const StreamReactor &); // non-copyable
+	};
+
+	// -----------------------------------------------------------------------------------
+
+#ifdef PORTAUDIOCPP_HAS_COROUTINES
+	//////
+	/// @brief Awaitable read or write of a StreamReactor. Lives in the awaiting coroutine's
+	/// frame, resuming it throws a PaException if the transfer failed.
+	//////
+	template<typename SampleT, int Channels>
+	class StreamReactor::Awaitable : private StreamReactor::Operation
+	{
+	public:
+		Awaitable(StreamReactor &reactor, BlockingStream &stream, bool isRead, void *buffer, const InterleavedFrames<SampleT, Channels> &frames)
+			: Operation(stream, isRead, buffer, frames.numFrames(), sizeof(SampleT) * frames.numChannels()), reactor_(reactor)
+		{
+		}
+
+		Awaitable(Awaitable &&other) = delete;
+
+		bool await_ready()
+		{
+			return progress();
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			handle_ = handle;
+			reactor_.submit(*this);
+		}
+
+		void await_resume() const
+		{
+			if (error() != paNoError)
+				throw PaException(error());
+		}
+
+	private:
+		void completed()
+		{
+			handle_.resume();
+		}
+
+		StreamReactor &reactor_;
+		std::coroutine_handle<> handle_;
+	};
+#endif
+
+
+} // namespace portaudio
+
+// ---------------------------------------------------------------------------------------
+
+#endif // INCLUDED_PORTAUDIO_STREAMREACTOR_HXX
@@ -34,6 +34,17 @@ namespace portaudio
 	/// Terminating the System will also abort and close the open streams. 
 	/// The Stream objects will need to be deallocated by the client though 
 	/// (it's usually a good idea to have them cleaned up automatically).
+	///
+	/// The HostApis and Devices are kept in two arrays which are allocated 
+	/// when the System is initialized. refreshDevices() enumerates the 
+	/// devices again and updates the Devices in place, the Device array is 
+	/// only reallocated if there are more devices than it can hold. When 
+	/// PortAudio reports that devices changed, the next call to 
+	/// devicesBegin() or hostApisBegin() refreshes the devices first.
+	///
+	/// As with device indices in PortAudio, a Device refers to whatever 
+	/// device has its index after a refresh, and iterators and references 
+	/// obtained before a refresh must not be used after it.
 	//////
 	class System
 	{
@@ -80,6 +91,9 @@ namespace portaudio
 
 		static Device &nullDevice();
 
+		void refreshDevices();
+		bool devicesChanged() const;
+
 		// -------------------------------------------------------------------------------
 
 		// misc:
@@ -90,11 +104,21 @@ namespace portaudio
 		System();
 		~System();
 
+		static void createHostApis();
+		static void destroyHostApis();
+		static void createDevices();
+		static void destroyDevices();
+		static void refreshDevicesIfChanged();
+
 		static System *instance_;
 		static int initCount_;
 
-		static HostApi **hostApis_;
-		static Device **devices_;
+		static HostApi *hostApis_;
+		static int hostApiCount_;
+
+		static Device *devices_;
+		static int deviceCount_;
+		static int deviceCapacity_;
 
 		static Device *nullDevice_;
 	};
@@ -29,7 +29,8 @@ namespace portaudio
 	///
 	/// Devices will be iterated by iterating all Devices in each 
 	/// HostApi in the System. Compliant with the STL bidirectional 
-	/// iterator concept.
+	/// iterator concept. The Devices of the System are kept in a single 
+	/// array, so an iterator is a plain pointer into it.
 	//////
 	class System::DeviceIterator
 	{
@@ -54,7 +55,7 @@ namespace portaudio
 	private:
 		friend class System;
 		friend class HostApi;
-		Device **ptr_;
+		Device *ptr_;
 	};
 
 
@@ -50,7 +50,7 @@ namespace portaudio
 
 	private:
 		friend class System;
-		HostApi **ptr_;
+		HostApi *ptr_;
 	};
 
 
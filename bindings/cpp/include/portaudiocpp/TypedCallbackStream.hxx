@@ -0,0 +1,160 @@
+#ifndef INCLUDED_PORTAUDIO_TYPEDCALLBACKSTREAM_HXX
+#define INCLUDED_PORTAUDIO_TYPEDCALLBACKSTREAM_HXX
+
+// ---------------------------------------------------------------------------------------
+
+#include "portaudio.h"
+
+#include "portaudiocpp/CallbackStream.hxx"
+#include "portaudiocpp/StreamParameters.hxx"
+#include "portaudiocpp/SampleDataFormat.hxx"
+#include "portaudiocpp/Exception.hxx"
+#include "portaudiocpp/FrameBuffers.hxx"
+
+// ---------------------------------------------------------------------------------------
+
+namespace portaudio
+{
+
+
+	//////
+	/// @brief Maps a sample type to its SampleDataFormat. Specialized for float (FLOAT32), double
+	/// (FLOAT64), int (INT32), short (INT16), signed char (INT8) and unsigned char (UINT8).
+	//////
+	template<typename SampleT>
+	struct SampleFormatOf;
+
+	template<> struct SampleFormatOf<float> { static const SampleDataFormat value = FLOAT32; };
+	template<> struct SampleFormatOf<double> { static const SampleDataFormat value = FLOAT64; };
+	template<> struct SampleFormatOf<int> { static const SampleDataFormat value = INT32; };
+	template<> struct SampleFormatOf<short> { static const SampleDataFormat value = INT16; };
+	template<> struct SampleFormatOf<signed char> { static const SampleDataFormat value = INT8; };
+	template<> struct SampleFormatOf<unsigned char> { static const SampleDataFormat value = UINT8; };
+
+	// -----------------------------------------------------------------------------------
+
+	namespace impl
+	{
+		//////
+		/// @brief The frame buffer view type of a TypedCallbackStream.
+		//////
+		template<typename SampleT, int Channels, bool Interleaved>
+		struct FramesOf { typedef InterleavedFrames<SampleT, Channels> type; };
+
+		template<typename SampleT, int Channels>
+		struct FramesOf<SampleT, Channels, false> { typedef NonInterleavedFrames<SampleT, Channels> type; };
+	}
+
+	// -----------------------------------------------------------------------------------
+
+	//////
+	/// @brief Callback stream calling a function object of type Fn, with the sample type and
+	/// channel counts fixed at compile time.
+	///
+	/// Unlike the other callback streams the callback isn't called through a function pointer
+	/// or virtual function, so it can be inlined into the stream callback, and the compiler
+	/// knows the sample type and channel counts of the buffers it processes. Fn is called as:
+	/// @verbatim int fn(InputFrames in, OutputFrames out, const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags); @endverbatim
+	/// where in and out are InterleavedFrames<const SampleT, InputChannels> and
+	/// InterleavedFrames<SampleT, OutputChannels>, or NonInterleavedFrames if Interleaved is
+	/// false. A direction with 0 channels is not opened, its view has a NULL data pointer.
+	///
+	/// The StreamParameters passed to open() must use SampleT samples, interleaved as given by
+	/// Interleaved, and exactly InputChannels and OutputChannels channels, otherwise a
+	/// PaException with paSampleFormatNotSupported or paInvalidChannelCount is thrown.
+	///
+	/// Example usage:
+	/// @verbatim TypedCallbackStream<MySynth, float, 0, 2> stream(parameters, synth); @endverbatim
+	//////
+	template<typename Fn, typename SampleT, int InputChannels, int OutputChannels = InputChannels, bool Interleaved = true>
+	class TypedCallbackStream : public CallbackStream
+	{
+	public:
+		typedef typename impl::FramesOf<const SampleT, InputChannels, Interleaved>::type InputFrames;
+		typedef typename impl::FramesOf<SampleT, OutputChannels, Interleaved>::type OutputFrames;
+
+		// -------------------------------------------------------------------------------
+
+		TypedCallbackStream() : fn_()
+		{
+		}
+
+		TypedCallbackStream(const StreamParameters &parameters, const Fn &fn = Fn()) : fn_(fn)
+		{
+			open(parameters);
+		}
+
+		~TypedCallbackStream()
+		{
+			close();
+		}
+
+		void open(const StreamParameters &parameters)
+		{
+			checkParameters(parameters.inputParameters().paStreamParameters(), InputChannels);
+			checkParameters(parameters.outputParameters().paStreamParameters(), OutputChannels);
+
+			PaError err = Pa_OpenStream(&stream_, parameters.inputParameters().paStreamParameters(), parameters.outputParameters().paStreamParameters(),
+				parameters.sampleRate(), parameters.framesPerBuffer(), parameters.flags(), &callback,
+				static_cast<void *>(this));
+
+			if (err != paNoError)
+				throw PaException(err);
+		}
+
+		void open(const StreamParameters &parameters, const Fn &fn)
+		{
+			fn_ = fn;
+			open(parameters);
+		}
+
+		//////
+		/// Returns the function object. It is called from the callback thread while the stream
+		/// is active.
+		//////
+		Fn &function()
+		{
+			return fn_;
+		}
+
+	private:
+		TypedCallbackStream(const TypedCallbackStream &); // non-copyable
+		TypedCallbackStream &operator=(const TypedCallbackStream &); // non-copyable
+
+		Fn fn_;
+
+		static void checkParameters(const PaStreamParameters *parameters, int numChannels)
+		{
+			if (parameters == NULL)
+			{
+				if (numChannels != 0)
+					throw PaException(paInvalidChannelCount);
+				return;
+			}
+
+			if (parameters->channelCount != numChannels)
+				throw PaException(paInvalidChannelCount);
+
+			// sampleFormat must be exactly SampleT, interleaved as requested and not host api-specific
+			PaSampleFormat format = static_cast<PaSampleFormat>(SampleFormatOf<SampleT>::value);
+			if (!Interleaved)
+				format |= paNonInterleaved;
+
+			if (parameters->sampleFormat != format)
+				throw PaException(paSampleFormatNotSupported);
+		}
+
+		static int callback(const void *inputBuffer, void *outputBuffer, unsigned long numFrames,
+			const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData)
+		{
+			TypedCallbackStream *stream = static_cast<TypedCallbackStream *>(userData);
+			return stream->fn_(InputFrames(inputBuffer, numFrames), OutputFrames(outputBuffer, numFrames), timeInfo, statusFlags);
+		}
+	};
+
+
+} // namespace portaudio
+
+// ---------------------------------------------------------------------------------------
+
+#endif // INCLUDED_PORTAUDIO_TYPEDCALLBACKSTREAM_HXX
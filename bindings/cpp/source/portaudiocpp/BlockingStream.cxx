@@ -48,7 +48,8 @@ namespace portaudio
 
 	void BlockingStream::read(void *buffer, unsigned long numFrames)
 	{
-		PaError err = Pa_ReadStream(stream_, buffer, numFrames);
+		PaError err;
+		read(buffer, numFrames, err);
 
 		if (err != paNoError)
 		{
@@ -58,7 +59,8 @@ namespace portaudio
 
 	void BlockingStream::write(const void *buffer, unsigned long numFrames)
 	{
-		PaError err = Pa_WriteStream(stream_, buffer, numFrames);
+		PaError err;
+		write(buffer, numFrames, err);
 
 		if (err != paNoError)
 		{
@@ -66,15 +68,142 @@ namespace portaudio
 		}
 	}
 
+	//////
+	/// Reads numFrames frames, waiting for them if needed. Instead of throwing, sets error 
+	/// to the result of Pa_ReadStream(), e.g. paInputOverflowed if input was discarded 
+	/// (the frames are read nevertheless).
+	//////
+	void BlockingStream::read(void *buffer, unsigned long numFrames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+	{
+		error = Pa_ReadStream(stream_, buffer, numFrames);
+	}
+
+	//////
+	/// Writes numFrames frames, waiting for room if needed. Instead of throwing, sets error 
+	/// to the result of Pa_WriteStream(), e.g. paOutputUnderflowed if the device ran out 
+	/// of data before (the frames are written nevertheless).
+	//////
+	void BlockingStream::write(const void *buffer, unsigned long numFrames, PaError &error) PORTAUDIOCPP_NOEXCEPT
+	{
+		error = Pa_WriteStream(stream_, buffer, numFrames);
+	}
+
+	//////
+	/// Reads as many of numFrames frames as can be read without waiting and returns 
+	/// how many that were, possibly 0. Unlike read(), an input overflow doesn't throw 
+	/// but sets *overflowed (if not NULL), so that the frames read aren't lost track 
+	/// of. Used to drive a stream from an event loop, see StreamReactor.
+	//////
+	unsigned long BlockingStream::readSome(void *buffer, unsigned long numFrames, bool *overflowed)
+	{
+		PaError err;
+		numFrames = readSome(buffer, numFrames, overflowed, err);
+
+		// (an input overflow already reported in *overflowed isn't an error)
+		if (err != paNoError && !(err == paInputOverflowed && overflowed != NULL))
+			throw PaException(err);
+
+		return numFrames;
+	}
+
+	//////
+	/// Writes as many of numFrames frames as can be written without waiting and 
+	/// returns how many that were, possibly 0. An output underflow sets *underflowed 
+	/// (if not NULL) instead of throwing.
+	//////
+	unsigned long BlockingStream::writeSome(const void *buffer, unsigned long numFrames, bool *underflowed)
+	{
+		PaError err;
+		numFrames = writeSome(buffer, numFrames, underflowed, err);
+
+		// (an output underflow already reported in *underflowed isn't an error)
+		if (err != paNoError && !(err == paOutputUnderflowed && underflowed != NULL))
+			throw PaException(err);
+
+		return numFrames;
+	}
+
+	//////
+	/// Like readSome(), but sets error instead of throwing. An input overflow is reported 
+	/// both in *overflowed (if not NULL) and in error. Returns 0 if the stream couldn't 
+	/// be queried.
+	//////
+	unsigned long BlockingStream::readSome(void *buffer, unsigned long numFrames, bool *overflowed, PaError &error) PORTAUDIOCPP_NOEXCEPT
+	{
+		signed long available = availableReadSize(error);
+
+		if (overflowed != NULL)
+			*overflowed = false;
+
+		if (error != paNoError)
+			return 0;
+
+		if (static_cast<unsigned long>(available) < numFrames)
+			numFrames = static_cast<unsigned long>(available);
+
+		if (numFrames > 0)
+		{
+			error = Pa_ReadStream(stream_, buffer, numFrames);
+
+			if (error == paInputOverflowed)
+			{
+				if (overflowed != NULL)
+					*overflowed = true;
+			}
+			else if (error != paNoError)
+			{
+				return 0;
+			}
+		}
+
+		return numFrames;
+	}
+
+	//////
+	/// Like writeSome(), but sets error instead of throwing. An output underflow is 
+	/// reported both in *underflowed (if not NULL) and in error.
+	//////
+	unsigned long BlockingStream::writeSome(const void *buffer, unsigned long numFrames, bool *underflowed, PaError &error) PORTAUDIOCPP_NOEXCEPT
+	{
+		signed long available = availableWriteSize(error);
+
+		if (underflowed != NULL)
+			*underflowed = false;
+
+		if (error != paNoError)
+			return 0;
+
+		if (static_cast<unsigned long>(available) < numFrames)
+			numFrames = static_cast<unsigned long>(available);
+
+		if (numFrames > 0)
+		{
+			error = Pa_WriteStream(stream_, buffer, numFrames);
+
+			if (error == paOutputUnderflowed)
+			{
+				if (underflowed != NULL)
+					*underflowed = true;
+			}
+			else if (error != paNoError)
+			{
+				return 0;
+			}
+		}
+
+		return numFrames;
+	}
+
 	// --------------------------------------------------------------------------------------
 
 	signed long BlockingStream::availableReadSize() const
 	{
-		signed long avail = Pa_GetStreamReadAvailable(stream_);
+		PaError err;
+		signed long avail = availableReadSize(err);
 
-		if (avail < 0)
+		if (err != paNoError)
 		{
-			throw PaException(avail);
+			throw PaException(err);
 		}
 
 		return avail;
@@ -82,16 +211,41 @@ namespace portaudio
 
 	signed long BlockingStream::availableWriteSize() const
 	{
-		signed long avail = Pa_GetStreamWriteAvailable(stream_);
+		PaError err;
+		signed long avail = availableWriteSize(err);
 
-		if (avail < 0)
+		if (err != paNoError)
 		{
-			throw PaException(avail);
+			throw PaException(err);
 		}
 
 		return avail;
 	}
 
+	//////
+	/// Returns the number of frames which can be read without waiting, or 0 and sets 
+	/// error if the stream couldn't be queried.
+	//////
+	signed long BlockingStream::availableReadSize(PaError &error) const PORTAUDIOCPP_NOEXCEPT
+	{
+		signed long avail = Pa_GetStreamReadAvailable(stream_);
+
+		error = (avail < 0) ? static_cast<PaError>(avail) : paNoError;
+		return (avail < 0) ? 0 : avail;
+	}
+
+	//////
+	/// Returns the number of frames which can be written without waiting, or 0 and sets 
+	/// error if the stream couldn't be queried.
+	//////
+	signed long BlockingStream::availableWriteSize(PaError &error) const PORTAUDIOCPP_NOEXCEPT
+	{
+		signed long avail = Pa_GetStreamWriteAvailable(stream_);
+
+		error = (avail < 0) ? static_cast<PaError>(avail) : paNoError;
+		return (avail < 0) ? 0 : avail;
+	}
+
 	// --------------------------------------------------------------------------------------
 
 } // portaudio
@@ -1,5 +1,7 @@
 #include "portaudiocpp/HostApi.hxx"
 
+#include <cstddef>
+
 #include "portaudiocpp/System.hxx"
 #include "portaudiocpp/Device.hxx"
 #include "portaudiocpp/SystemDeviceIterator.hxx"
@@ -10,43 +12,24 @@ namespace portaudio
 
 	// -----------------------------------------------------------------------------------
 
-	HostApi::HostApi(PaHostApiIndex index) : devices_(NULL)
+	HostApi::HostApi(PaHostApiIndex index) : firstDevice_(0)
 	{
-		try
-		{
-			info_ = Pa_GetHostApiInfo(index);
-
-			// Create and populate devices array:
-			int numDevices = deviceCount();
+		info_ = Pa_GetHostApiInfo(index);
 
-			devices_ = new Device*[numDevices];
+		if (info_ == NULL)
+			throw PaException(paInvalidHostApi);
 
-			for (int i = 0; i < numDevices; ++i)
-			{
-				PaDeviceIndex deviceIndex = Pa_HostApiDeviceIndexToDeviceIndex(index, i);
-
-				if (deviceIndex < 0)
-				{
-					throw PaException(deviceIndex);
-				}
-
-				devices_[i] = &System::instance().deviceByIndex(deviceIndex);
-			}
-		}
-		catch (const std::exception &e)
+		if (deviceCount() > 0)
 		{
-			// Delete any (partially) constructed objects (deconstructor isn't called):
-			delete[] devices_; // devices_ is either NULL or valid
+			firstDevice_ = Pa_HostApiDeviceIndexToDeviceIndex(index, 0);
 
-			// Re-throw exception:
-			throw e;
+			if (firstDevice_ < 0)
+				throw PaException(firstDevice_);
 		}
 	}
 
 	HostApi::~HostApi()
 	{
-		// Destroy devices array:
-		delete[] devices_;
 	}
 
 	// -----------------------------------------------------------------------------------
@@ -81,14 +64,21 @@ namespace portaudio
 	HostApi::DeviceIterator HostApi::devicesBegin()
 	{
 		DeviceIterator tmp;
-		tmp.ptr_ = &devices_[0]; // begin (first element)
+		tmp.ptr_ = NULL;
+
+		if (deviceCount() > 0)
+			tmp.ptr_ = &System::instance().deviceByIndex(firstDevice_); // begin (first element)
+
 		return tmp;
 	}
 
 	HostApi::DeviceIterator HostApi::devicesEnd()
 	{
-		DeviceIterator tmp;
-		tmp.ptr_ = &devices_[deviceCount()]; // end (one past last element)
+		DeviceIterator tmp = devicesBegin();
+
+		if (deviceCount() > 0)
+			tmp.ptr_ += deviceCount(); // end (one past last element)
+
 		return tmp;
 	}
 
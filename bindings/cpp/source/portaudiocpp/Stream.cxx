@@ -41,7 +41,7 @@ namespace portaudio
 	//////
 	/// Returns true if the Stream is open.
 	//////
-	bool Stream::isOpen() const
+	bool Stream::isOpen() const PORTAUDIOCPP_NOEXCEPT
 	{
 		return (stream_ != NULL);
 	}
@@ -84,21 +84,45 @@ namespace portaudio
 
 	bool Stream::isStopped() const
 	{
-		PaError ret = Pa_IsStreamStopped(stream_);
+		PaError err;
+		bool stopped = isStopped(err);
 
-		if (ret < 0)
-			throw PaException(ret);
+		if (err != paNoError)
+			throw PaException(err);
 
-		return (ret == 1);
+		return stopped;
 	}
 
 	bool Stream::isActive() const
 	{
-		PaError ret = Pa_IsStreamActive(stream_);
+		PaError err;
+		bool active = isActive(err);
+
+		if (err != paNoError)
+			throw PaException(err);
 
-		if (ret < 0)
-			throw PaException(ret);
+		return active;
+	}
+
+	//////
+	/// Like isStopped(), but sets error instead of throwing. Returns false on error.
+	//////
+	bool Stream::isStopped(PaError &error) const PORTAUDIOCPP_NOEXCEPT
+	{
+		PaError ret = Pa_IsStreamStopped(stream_);
 
+		error = (ret < 0) ? ret : paNoError;
+		return (ret == 1);
+	}
+
+	//////
+	/// Like isActive(), but sets error instead of throwing. Returns false on error.
+	//////
+	bool Stream::isActive(PaError &error) const PORTAUDIOCPP_NOEXCEPT
+	{
+		PaError ret = Pa_IsStreamActive(stream_);
+
+		error = (ret < 0) ? ret : paNoError;
 		return (ret == 1);
 	}
 
@@ -112,14 +136,13 @@ namespace portaudio
 	//////
 	PaTime Stream::inputLatency() const
 	{
-		const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
-		if (info == NULL)
-		{
-			throw PaException(paInternalError);
-			return PaTime(0.0);
-		}
+		PaError err;
+		PaTime latency = inputLatency(err);
+
+		if (err != paNoError)
+			throw PaException(err);
 
-		return info->inputLatency;
+		return latency;
 	}
 
 	//////
@@ -130,14 +153,13 @@ namespace portaudio
 	//////
 	PaTime Stream::outputLatency() const
 	{
-		const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
-		if (info == NULL)
-		{
-			throw PaException(paInternalError);
-			return PaTime(0.0);
-		}
+		PaError err;
+		PaTime latency = outputLatency(err);
 
-		return info->outputLatency;
+		if (err != paNoError)
+			throw PaException(err);
+
+		return latency;
 	}
 
 	//////
@@ -148,20 +170,56 @@ namespace portaudio
 	/// sound card hardware).
 	//////
 	double Stream::sampleRate() const
+	{
+		PaError err;
+		double rate = sampleRate(err);
+
+		if (err != paNoError)
+			throw PaException(err);
+
+		return rate;
+	}
+
+	//////
+	/// Like inputLatency(), but sets error instead of throwing. Returns 0 on error.
+	//////
+	PaTime Stream::inputLatency(PaError &error) const PORTAUDIOCPP_NOEXCEPT
+	{
+		const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
+
+		error = (info == NULL) ? paInternalError : paNoError;
+		return (info == NULL) ? PaTime(0.0) : info->inputLatency;
+	}
+
+	//////
+	/// Like outputLatency(), but sets error instead of throwing. Returns 0 on error.
+	//////
+	PaTime Stream::outputLatency(PaError &error) const PORTAUDIOCPP_NOEXCEPT
 	{
 		const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
-		if (info == NULL)
-		{
-			throw PaException(paInternalError);
-			return 0.0;
-		}
 
-		return info->sampleRate;
+		error = (info == NULL) ? paInternalError : paNoError;
+		return (info == NULL) ? PaTime(0.0) : info->outputLatency;
+	}
+
+	//////
+	/// Like sampleRate(), but sets error instead of throwing. Returns 0 on error.
+	//////
+	double Stream::sampleRate(PaError &error) const PORTAUDIOCPP_NOEXCEPT
+	{
+		const PaStreamInfo *info = Pa_GetStreamInfo(stream_);
+
+		error = (info == NULL) ? paInternalError : paNoError;
+		return (info == NULL) ? 0.0 : info->sampleRate;
 	}
 
 	// -----------------------------------------------------------------------------------
 
-	PaTime Stream::time() const
+	//////
+	/// Returns the stream's current time in seconds, in the time base of the callback 
+	/// timestamps, or 0 on error. Never throws.
+	//////
+	PaTime Stream::time() const PORTAUDIOCPP_NOEXCEPT
 	{
 		return Pa_GetStreamTime(stream_);
 	}
@@ -174,7 +232,7 @@ namespace portaudio
 	/// pointer should not be needed as PortAudioCpp aims to provide all of PortAudio's 
 	/// functionality.
 	//////
-	const PaStream *Stream::paStream() const
+	const PaStream *Stream::paStream() const PORTAUDIOCPP_NOEXCEPT
 	{
 		return stream_;
 	}
@@ -185,7 +243,7 @@ namespace portaudio
 	/// pointer should not be needed as PortAudioCpp aims to provide all of PortAudio's 
 	/// functionality.
 	//////
-	PaStream *Stream::paStream()
+	PaStream *Stream::paStream() PORTAUDIOCPP_NOEXCEPT
 	{
 		return stream_;
 	}
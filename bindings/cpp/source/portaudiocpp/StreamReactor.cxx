@@ -0,0 +1,182 @@
+#include "portaudiocpp/StreamReactor.hxx"
+
+#include <cstddef>
+#include <cassert>
+
+namespace portaudio
+{
+
+	// -----------------------------------------------------------------------------------
+
+	StreamReactor::Operation::Operation(BlockingStream &stream, bool isRead, void *buffer, unsigned long numFrames, 
+		unsigned long bytesPerFrame) : next_(NULL), stream_(&stream), isRead_(isRead), 
+		buffer_(static_cast<unsigned char *>(buffer)), numFrames_(numFrames), framesDone_(0), 
+		bytesPerFrame_(bytesPerFrame), error_(paNoError), xrunOccurred_(false)
+	{
+	}
+
+	unsigned long StreamReactor::Operation::framesDone() const
+	{
+		return framesDone_;
+	}
+
+	unsigned long StreamReactor::Operation::framesRemaining() const
+	{
+		return numFrames_ - framesDone_;
+	}
+
+	PaError StreamReactor::Operation::error() const
+	{
+		return error_;
+	}
+
+	bool StreamReactor::Operation::xrunOccurred() const
+	{
+		return xrunOccurred_;
+	}
+
+	bool StreamReactor::Operation::progress()
+	{
+		if (error_ != paNoError)
+			return true;
+
+		try
+		{
+			unsigned char *buffer = buffer_ + framesDone_ * bytesPerFrame_;
+			bool xrun = false;
+
+			if (isRead_)
+				framesDone_ += stream_->readSome(buffer, framesRemaining(), &xrun);
+			else
+				framesDone_ += stream_->writeSome(buffer, framesRemaining(), &xrun);
+
+			if (xrun)
+				xrunOccurred_ = true;
+
+			// A stopped stream won't make the rest available:
+			if (framesDone_ < numFrames_ && stream_->isStopped())
+				error_ = paStreamIsStopped;
+		}
+		catch (const PaException &e)
+		{
+			error_ = e.paError();
+		}
+
+		return (framesDone_ == numFrames_ || error_ != paNoError);
+	}
+
+	// -----------------------------------------------------------------------------------
+
+	StreamReactor::StreamReactor() : pending_(NULL)
+	{
+	}
+
+	StreamReactor::~StreamReactor()
+	{
+		// Operations still pending are simply forgotten, they are owned by the client.
+	}
+
+	//////
+	/// Adds an Operation to the pending ones. It is only advanced by poll(), so 
+	/// completed() is never called from within submit(). The Operation must stay 
+	/// alive until it completed or was cancelled.
+	//////
+	void StreamReactor::submit(Operation &operation)
+	{
+		assert(operation.next_ == NULL);
+
+		operation.next_ = pending_;
+		pending_ = &operation;
+	}
+
+	//////
+	/// Removes a pending Operation without completing it.
+	//////
+	void StreamReactor::cancel(Operation &operation)
+	{
+		for (Operation **link = &pending_; *link != NULL; link = &(*link)->next_)
+		{
+			if (*link == &operation)
+			{
+				*link = operation.next_;
+				operation.next_ = NULL;
+				return;
+			}
+		}
+	}
+
+	//////
+	/// Advances all pending Operations without waiting and completes those which 
+	/// are done. Returns the number of Operations completed.
+	//////
+	std::size_t StreamReactor::poll()
+	{
+		// Unlink the finished Operations first, completing them may submit new ones:
+		Operation *finished = NULL;
+		Operation **link = &pending_;
+
+		while (*link != NULL)
+		{
+			Operation *operation = *link;
+
+			if (operation->progress())
+			{
+				*link = operation->next_;
+				operation->next_ = finished;
+				finished = operation;
+			}
+			else
+			{
+				link = &operation->next_;
+			}
+		}
+
+		std::size_t count = 0;
+
+		while (finished != NULL)
+		{
+			Operation *operation = finished;
+			finished = operation->next_;
+			operation->next_ = NULL;
+
+			operation->completed(); // may destroy operation
+			++count;
+		}
+
+		return count;
+	}
+
+	bool StreamReactor::idle() const
+	{
+		return (pending_ == NULL);
+	}
+
+	//////
+	/// Returns how long the event loop may wait before calling poll() again 
+	/// without a pending transfer falling behind: the shortest time any of the 
+	/// streams needs to play or record the frames its Operation still waits for, 
+	/// limited by the stream's latency. Returns 0 if nothing is pending.
+	//////
+	double StreamReactor::suggestedPollInterval() const
+	{
+		double interval = 0.0;
+
+		for (const Operation *operation = pending_; operation != NULL; operation = operation->next_)
+		{
+			const BlockingStream &stream = *operation->stream_;
+			double latency = operation->isRead_ ? stream.inputLatency() : stream.outputLatency();
+			double remaining = operation->framesRemaining() / stream.sampleRate();
+
+			// Waking every half latency keeps writers from underflowing:
+			double wait = (latency > 0.0 && latency / 2 < remaining) ? latency / 2 : remaining;
+
+			if (operation == pending_ || wait < interval)
+				interval = wait;
+		}
+
+		return interval;
+	}
+
+	// -----------------------------------------------------------------------------------
+
+} // namespace portaudio
@@ -2,6 +2,7 @@
 
 #include <cstddef>
 #include <cassert>
+#include <new>
 
 #include "portaudiocpp/HostApi.hxx"
 #include "portaudiocpp/Device.hxx"
@@ -17,12 +18,35 @@ namespace portaudio
 	// Static members:
 	System *System::instance_ = NULL;
 	int System::initCount_ = 0;
-	HostApi **System::hostApis_ = NULL;
-	Device **System::devices_ = NULL;
+	HostApi *System::hostApis_ = NULL;
+	int System::hostApiCount_ = 0;
+	Device *System::devices_ = NULL;
+	int System::deviceCount_ = 0;
+	int System::deviceCapacity_ = 0;
 	Device *System::nullDevice_ = NULL;
 
 	// -----------------------------------------------------------------------------------
 
+	namespace
+	{
+		// Set by the device change callback, which may run on any thread and must not 
+		// call PortAudio, cleared when the Devices are refreshed.
+		volatile int devicesChanged_ = 0;
+
+		extern "C"
+		{
+			static void deviceChangeCallback(PaHostApiIndex hostApi, void *userData)
+			{
+				(void) hostApi;
+				(void) userData;
+
+				devicesChanged_ = 1;
+			}
+		} // extern "C"
+	}
+
+	// -----------------------------------------------------------------------------------
+
 	int System::version()
 	{
 		return Pa_GetVersion();
@@ -51,25 +75,14 @@ namespace portaudio
 					throw PaException(err);
 			}
 
-			// Create and populate device array:
-			{
-				int numDevices = instance().deviceCount();
+			// Create and populate the device and host api arrays:
+			createDevices();
+			createHostApis();
 
-				devices_ = new Device*[numDevices];
-
-				for (int i = 0; i < numDevices; ++i)
-					devices_[i] = new Device(i);
-			}
-
-			// Create and populate host api array:
-			{
-				int numHostApis = instance().hostApiCount();
-
-				hostApis_ = new HostApi*[numHostApis];
-
-				for (int i = 0; i < numHostApis; ++i)
-					hostApis_[i] = new HostApi(i);
-			}
+			// Refresh lazily once devices change; not all host apis can tell, so failing 
+			// to register is not an error:
+			devicesChanged_ = 0;
+			Pa_SetDeviceChangeCallback(&deviceChangeCallback, NULL);
 			
 			// Create null device:
 			nullDevice_ = new Device(paNoDevice);
@@ -85,33 +98,17 @@ namespace portaudio
 			// Destroy null device:
 			delete nullDevice_;
 
-			// Destroy host api array:
-			{
-				if (hostApis_ != NULL)
-				{
-					int numHostApis = instance().hostApiCount();
-
-					for (int i = 0; i < numHostApis; ++i)
-						delete hostApis_[i];
-
-					delete[] hostApis_;
-					hostApis_ = NULL;
-				}
-			}
-
-			// Destroy device array:
-			{
-				if (devices_ != NULL)
-				{
-					int numDevices = instance().deviceCount();
+			Pa_SetDeviceChangeCallback(NULL, NULL);
 
-					for (int i = 0; i < numDevices; ++i)
-						delete devices_[i];
+			// Destroy host api and device arrays:
+			destroyHostApis();
+			::operator delete(hostApis_);
+			hostApis_ = NULL;
 
-					delete[] devices_;
-					devices_ = NULL;
-				}
-			}
+			destroyDevices();
+			::operator delete(devices_);
+			devices_ = NULL;
+			deviceCapacity_ = 0;
 
 			// Terminate the PortAudio system:
 			assert(instance_ != NULL);
@@ -146,17 +143,17 @@ namespace portaudio
 
 	System::HostApiIterator System::hostApisBegin()
 	{
+		refreshDevicesIfChanged();
+
 		System::HostApiIterator tmp;
-		tmp.ptr_ = &hostApis_[0]; // begin (first element)
+		tmp.ptr_ = hostApis_; // begin (first element)
 		return tmp;
 	}
 
 	System::HostApiIterator System::hostApisEnd()
 	{
-		int count = hostApiCount();
-
 		System::HostApiIterator tmp;
-		tmp.ptr_ = &hostApis_[count]; // end (one past last element)
+		tmp.ptr_ = hostApis_ + hostApiCount_; // end (one past last element)
 		return tmp;
 	}
 
@@ -167,7 +164,7 @@ namespace portaudio
 		if (defaultHostApi < 0)
 			throw PaException(defaultHostApi);
 
-		return *hostApis_[defaultHostApi];
+		return hostApis_[defaultHostApi];
 	}
 
 	HostApi &System::hostApiByTypeId(PaHostApiTypeId type)
@@ -177,7 +174,7 @@ namespace portaudio
 		if (index < 0)
 			throw PaException(index);
 
-		return *hostApis_[index];
+		return hostApis_[index];
 	}
 
 	HostApi &System::hostApiByIndex(PaHostApiIndex index)
@@ -185,35 +182,30 @@ namespace portaudio
 		if (index < 0 || index >= hostApiCount())
 			throw PaException(paInternalError);
 
-		return *hostApis_[index];
+		return hostApis_[index];
 	}
 
 	int System::hostApiCount()
 	{
-		PaHostApiIndex count = Pa_GetHostApiCount();
-
-		if (count < 0)
-			throw PaException(count);
-
-		return count;
+		return hostApiCount_;
 	}
 
 	// -----------------------------------------------------------------------------------
 
 	System::DeviceIterator System::devicesBegin()
 	{
+		refreshDevicesIfChanged();
+
 		DeviceIterator tmp;
-		tmp.ptr_ = &devices_[0];
+		tmp.ptr_ = devices_;
 
 		return tmp;
 	}
 
 	System::DeviceIterator System::devicesEnd()
 	{
-		int count = deviceCount();
-
 		DeviceIterator tmp;
-		tmp.ptr_ = &devices_[count];
+		tmp.ptr_ = devices_ + deviceCount_;
 
 		return tmp;
 	}
@@ -253,22 +245,108 @@ namespace portaudio
 		if (index == -1)
 			return System::instance().nullDevice();
 
-		return *devices_[index];
+		return devices_[index];
 	}
 
 	int System::deviceCount()
+	{
+		return deviceCount_;
+	}
+
+	Device &System::nullDevice()
+	{
+		return *nullDevice_;
+	}
+
+	//////
+	/// Enumerates the devices again (see Pa_RefreshDeviceList()) and updates the 
+	/// Devices and HostApis in place. Will throw a PaException if PortAudio failed 
+	/// to enumerate the devices, the Devices are left unchanged then.
+	//////
+	void System::refreshDevices()
+	{
+		devicesChanged_ = 0;
+
+		PaError err = Pa_RefreshDeviceList();
+
+		if (err != paNoError)
+			throw PaException(err);
+
+		destroyHostApis();
+		createDevices();
+		createHostApis();
+	}
+
+	//////
+	/// Returns true if PortAudio reported that devices were connected or removed 
+	/// since the Devices were last refreshed.
+	//////
+	bool System::devicesChanged() const
+	{
+		return (devicesChanged_ != 0);
+	}
+
+	void System::refreshDevicesIfChanged()
+	{
+		if (devicesChanged_ != 0)
+			instance().refreshDevices();
+	}
+
+	// -----------------------------------------------------------------------------------
+
+	void System::createHostApis()
+	{
+		PaHostApiIndex count = Pa_GetHostApiCount();
+
+		if (count < 0)
+			throw PaException(count);
+
+		if (hostApis_ == NULL)
+			hostApis_ = static_cast<HostApi *>(::operator new(sizeof(HostApi) * count));
+
+		// The number of host apis never changes, refreshing only reconstructs them in place:
+		for (hostApiCount_ = 0; hostApiCount_ < count; ++hostApiCount_)
+			new (&hostApis_[hostApiCount_]) HostApi(hostApiCount_);
+	}
+
+	void System::destroyHostApis()
+	{
+		for (int i = 0; i < hostApiCount_; ++i)
+			hostApis_[i].~HostApi();
+
+		hostApiCount_ = 0;
+	}
+
+	void System::createDevices()
 	{
 		PaDeviceIndex count = Pa_GetDeviceCount();
 
 		if (count < 0)
 			throw PaException(count);
 
-		return count;
+		destroyDevices();
+
+		// Keep the array unless it's too small:
+		if (count > deviceCapacity_)
+		{
+			int capacity = (2 * deviceCapacity_ > count) ? 2 * deviceCapacity_ : count;
+			Device *devices = static_cast<Device *>(::operator new(sizeof(Device) * capacity));
+
+			::operator delete(devices_);
+			devices_ = devices;
+			deviceCapacity_ = capacity;
+		}
+
+		for (deviceCount_ = 0; deviceCount_ < count; ++deviceCount_)
+			new (&devices_[deviceCount_]) Device(deviceCount_);
 	}
 
-	Device &System::nullDevice()
+	void System::destroyDevices()
 	{
-		return *nullDevice_;
+		for (int i = 0; i < deviceCount_; ++i)
+			devices_[i].~Device();
+
+		deviceCount_ = 0;
 	}
 
 	// -----------------------------------------------------------------------------------
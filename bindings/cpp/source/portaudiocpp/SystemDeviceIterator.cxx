@@ -1,12 +1,14 @@
 #include "portaudiocpp/SystemDeviceIterator.hxx"
 
+#include "portaudiocpp/Device.hxx"
+
 namespace portaudio
 {
 	// -----------------------------------------------------------------------------------
 
 	Device &System::DeviceIterator::operator*() const
 	{
-		return **ptr_;
+		return *ptr_;
 	}
 
 	Device *System::DeviceIterator::operator->() const
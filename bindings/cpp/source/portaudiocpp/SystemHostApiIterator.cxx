@@ -1,12 +1,14 @@
 #include "portaudiocpp/SystemHostApiIterator.hxx"
 
+#include "portaudiocpp/HostApi.hxx"
+
 namespace portaudio
 {
 	// -----------------------------------------------------------------------------------
 
 	HostApi &System::HostApiIterator::operator*() const
 	{
-		return **ptr_;
+		return *ptr_;
 	}
 
 	HostApi *System::HostApiIterator::operator->() const
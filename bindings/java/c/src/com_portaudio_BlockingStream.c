@@ -74,6 +74,54 @@ JNIEXPORT jint JNICALL Java_com_portaudio_BlockingStream_getWriteAvailable
 }
 
 
+/* Write frames from native memory, return TRUE on an output underflow. */
+static jboolean WriteFrames( JNIEnv *env, PaStream *stream, const void *carr, jint numFrames )
+{
+	jint err;
+	if( stream == NULL )
+	{
+		jpa_ThrowError( env, "stream closed" );
+		return FALSE;
+	}
+	err = Pa_WriteStream( stream, carr, numFrames );
+	if( err == paOutputUnderflowed )
+	{
+		return TRUE;
+	}
+	else
+	{
+		jpa_CheckError( env, err );
+		return FALSE;
+	}
+}
+
+/* Read frames into native memory, return TRUE on an input overflow. */
+static jboolean ReadFrames( JNIEnv *env, PaStream *stream, void *carr, jint numFrames )
+{
+	jint err;
+	if( stream == NULL )
+	{
+		jpa_ThrowError( env, "stream closed" );
+		return FALSE;
+	}
+	err = Pa_ReadStream( stream, carr, numFrames );
+	if( err == paInputOverflowed )
+	{
+		return TRUE;
+	}
+	else
+	{
+		jpa_CheckError( env, err );
+		return FALSE;
+	}
+}
+
+/* The JVM usually copies array elements. Arrays written from aren't
+ * modified, so they are released with JNI_ABORT to skip the copy back.
+ * GetPrimitiveArrayCritical() can't be used as the calls block. Direct
+ * buffers avoid the copies, see writeDirect and readDirect.
+ */
+
 /*
  * Class:     com_portaudio_BlockingStream
  * Method:    writeFloats
@@ -83,32 +131,22 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeFloats
   (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
 {
 	jfloat *carr;
-	jint err;
+	jboolean underflowed;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( buffer == NULL )
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "null stream buffer");
+		jpa_ThrowError( env, "null stream buffer" );
 		return FALSE;
 	}
 	carr = (*env)->GetFloatArrayElements(env, buffer, NULL);
 	if (carr == NULL)
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "invalid stream buffer");
-		return FALSE;
-	}
-	err = Pa_WriteStream( stream, carr, numFrames );
-	(*env)->ReleaseFloatArrayElements(env, buffer, carr, 0);
-	if( err == paOutputUnderflowed )
-	{
-		return TRUE;
-	}
-	else
-	{
-		jpa_CheckError( env, err );
+		jpa_ThrowError( env, "invalid stream buffer" );
 		return FALSE;
 	}
+	underflowed = WriteFrames( env, stream, carr, numFrames );
+	(*env)->ReleaseFloatArrayElements(env, buffer, carr, JNI_ABORT);
+	return underflowed;
 }
 
 /*
@@ -120,32 +158,22 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readFloats
   (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
 {
 	jfloat *carr;
-	jint err;
+	jboolean overflowed;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( buffer == NULL )
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "null stream buffer");
+		jpa_ThrowError( env, "null stream buffer" );
 		return FALSE;
 	}
 	carr = (*env)->GetFloatArrayElements(env, buffer, NULL);
 	if (carr == NULL)
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "invalid stream buffer");
+		jpa_ThrowError( env, "invalid stream buffer" );
 		return FALSE;
 	}
-	err = Pa_ReadStream( stream, carr, numFrames );
+	overflowed = ReadFrames( env, stream, carr, numFrames );
 	(*env)->ReleaseFloatArrayElements(env, buffer, carr, 0);
-	if( err == paInputOverflowed )
-	{
-		return TRUE;
-	}
-	else
-	{
-		jpa_CheckError( env, err );
-		return FALSE;
-	}
+	return overflowed;
 }
 
 /*
@@ -154,35 +182,25 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readFloats
  * Signature: ([SI)Z
  */
 JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeShorts
-  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+  (JNIEnv *env, jobject blockingStream, jshortArray buffer, jint numFrames)
 {
 	jshort *carr;
-	jint err;
+	jboolean underflowed;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( buffer == NULL )
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "null stream buffer");
+		jpa_ThrowError( env, "null stream buffer" );
 		return FALSE;
 	}
 	carr = (*env)->GetShortArrayElements(env, buffer, NULL);
 	if (carr == NULL)
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "invalid stream buffer");
-		return FALSE;
-	}
-	err = Pa_WriteStream( stream, carr, numFrames );
-	(*env)->ReleaseShortArrayElements(env, buffer, carr, 0);
-	if( err == paOutputUnderflowed )
-	{
-		return TRUE;
-	}
-	else
-	{
-		jpa_CheckError( env, err );
+		jpa_ThrowError( env, "invalid stream buffer" );
 		return FALSE;
 	}
+	underflowed = WriteFrames( env, stream, carr, numFrames );
+	(*env)->ReleaseShortArrayElements(env, buffer, carr, JNI_ABORT);
+	return underflowed;
 }
 
 /*
@@ -191,35 +209,71 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeShorts
  * Signature: ([SI)Z
  */
 JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readShorts
-  (JNIEnv *env, jobject blockingStream, jfloatArray buffer, jint numFrames)
+  (JNIEnv *env, jobject blockingStream, jshortArray buffer, jint numFrames)
 {
 	jshort *carr;
-	jint err;
+	jboolean overflowed;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( buffer == NULL )
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "null stream buffer");
+		jpa_ThrowError( env, "null stream buffer" );
 		return FALSE;
 	}
 	carr = (*env)->GetShortArrayElements(env, buffer, NULL);
 	if (carr == NULL)
 	{
-		(*env)->ThrowNew( env, (*env)->FindClass(env,"java/lang/RuntimeException"),
-                  "invalid stream buffer");
+		jpa_ThrowError( env, "invalid stream buffer" );
 		return FALSE;
 	}
-	err = Pa_ReadStream( stream, carr, numFrames );
+	overflowed = ReadFrames( env, stream, carr, numFrames );
 	(*env)->ReleaseShortArrayElements(env, buffer, carr, 0);
-	if( err == paInputOverflowed )
+	return overflowed;
+}
+
+/* The Java code checks that the buffer is direct, of the stream's format
+ * and large enough, offsetBytes is its position in bytes.
+ */
+static void *GetDirectBufferAddress( JNIEnv *env, jobject buffer, jint offsetBytes )
+{
+	char *address;
+	if( buffer == NULL )
 	{
-		return TRUE;
+		jpa_ThrowError( env, "null stream buffer" );
+		return NULL;
 	}
-	else
+	address = (char *) (*env)->GetDirectBufferAddress( env, buffer );
+	if( address == NULL )
 	{
-		jpa_CheckError( env, err );
-		return FALSE;
+		jpa_ThrowError( env, "stream buffer is not direct" );
+		return NULL;
 	}
+	return address + offsetBytes;
+}
+
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    writeDirect
+ * Signature: (Ljava/nio/Buffer;II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeDirect
+  (JNIEnv *env, jobject blockingStream, jobject buffer, jint offsetBytes, jint numFrames)
+{
+	void *address = GetDirectBufferAddress( env, buffer, offsetBytes );
+	if( address == NULL ) return FALSE;
+	return WriteFrames( env, jpa_GetStreamPointer( env, blockingStream ), address, numFrames );
+}
+
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    readDirect
+ * Signature: (Ljava/nio/Buffer;II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readDirect
+  (JNIEnv *env, jobject blockingStream, jobject buffer, jint offsetBytes, jint numFrames)
+{
+	void *address = GetDirectBufferAddress( env, buffer, offsetBytes );
+	if( address == NULL ) return FALSE;
+	return ReadFrames( env, jpa_GetStreamPointer( env, blockingStream ), address, numFrames );
 }
 
 /*
@@ -268,14 +322,12 @@ JNIEXPORT void JNICALL Java_com_portaudio_BlockingStream_abort
 JNIEXPORT void JNICALL Java_com_portaudio_BlockingStream_close
   (JNIEnv *env, jobject blockingStream )
 {
-	jclass cls;
 	PaStream *stream =jpa_GetStreamPointer( env, blockingStream );
 	if( stream != NULL )
 	{
 		int err = Pa_CloseStream( stream );
 		jpa_CheckError( env, err );
-		cls = (*env)->GetObjectClass(env, blockingStream);
-		jpa_SetLongField( env, cls, blockingStream, "nativeStream", (jlong) 0 );
+		jpa_ClearStreamPointer( env, blockingStream );
 	}
 }
 
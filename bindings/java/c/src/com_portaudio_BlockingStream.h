@@ -60,6 +60,22 @@ JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readShorts
 JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeShorts
   (JNIEnv *, jobject, jshortArray, jint);
 
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    readDirect
+ * Signature: (Ljava/nio/Buffer;II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_readDirect
+  (JNIEnv *, jobject, jobject, jint, jint);
+
+/*
+ * Class:     com_portaudio_BlockingStream
+ * Method:    writeDirect
+ * Signature: (Ljava/nio/Buffer;II)Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_BlockingStream_writeDirect
+  (JNIEnv *, jobject, jobject, jint, jint);
+
 /*
  * Class:     com_portaudio_BlockingStream
  * Method:    start
@@ -0,0 +1,368 @@
+/*
+ * Portable Audio I/O Library
+ * Java Binding for PortAudio
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 2008 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "com_portaudio_CallbackStream.h"
+#include "portaudio.h"
+#include "jpa_tools.h"
+
+#ifndef FALSE
+#define FALSE  (0)
+#endif
+#ifndef TRUE
+#define TRUE  (!FALSE)
+#endif
+
+/* The native state of a CallbackStream. The Java buffers are allocated when
+ * the stream is opened, and kept alive by the global reference to the
+ * CallbackStream, so the callback only copies the frames and calls process().
+ */
+typedef struct JpaCallbackStream
+{
+	PaStream *stream;
+	JavaVM *vm;
+	jobject callbackStream;
+	jmethodID processMethod;
+	void *inputBuffer;
+	void *outputBuffer;
+	unsigned long inputFrameSize;
+	unsigned long outputFrameSize;
+	unsigned long framesPerBuffer;
+	/* The JNIEnv of the audio thread if it was attached by the callback,
+	 * to detach it when the stream finishes. */
+	JNIEnv *attachedEnv;
+} JpaCallbackStream;
+
+static int JpaStreamCallback( const void *input, void *output,
+		unsigned long frameCount, const PaStreamCallbackTimeInfo* timeInfo,
+		PaStreamCallbackFlags statusFlags, void *userData )
+{
+	JpaCallbackStream *self = (JpaCallbackStream *) userData;
+	JNIEnv *env;
+	jint result;
+	(void) timeInfo; /* unused parameter */
+
+	/* Attach the audio thread once, as a daemon so it doesn't keep the VM from exiting. */
+	if( (*self->vm)->GetEnv( self->vm, (void **) &env, JNI_VERSION_1_4 ) != JNI_OK )
+	{
+		if( (*self->vm)->AttachCurrentThreadAsDaemon( self->vm, (void **) &env, NULL ) != JNI_OK )
+		{
+			return paAbort;
+		}
+		self->attachedEnv = env;
+	}
+
+	/* The buffer processor always passes framesPerBuffer frames, as it isn't paFramesPerBufferUnspecified */
+	if( frameCount > self->framesPerBuffer ) return paAbort;
+
+	if( self->inputBuffer != NULL )
+	{
+		memcpy( self->inputBuffer, input, frameCount * self->inputFrameSize );
+	}
+
+	result = (*env)->CallIntMethod( env, self->callbackStream, self->processMethod,
+			(jint) frameCount, (jint) statusFlags );
+	if( (*env)->ExceptionCheck( env ) )
+	{
+		(*env)->ExceptionDescribe( env );
+		(*env)->ExceptionClear( env );
+		return paAbort;
+	}
+
+	if( self->outputBuffer != NULL )
+	{
+		memcpy( output, self->outputBuffer, frameCount * self->outputFrameSize );
+	}
+
+	return ( result == paContinue || result == paComplete ) ? result : paAbort;
+}
+
+/* Detach the audio thread if this is called on it, as by most host APIs. */
+static void JpaStreamFinished( void *userData )
+{
+	JpaCallbackStream *self = (JpaCallbackStream *) userData;
+	JNIEnv *env;
+
+	if( self->attachedEnv != NULL
+			&& (*self->vm)->GetEnv( self->vm, (void **) &env, JNI_VERSION_1_4 ) == JNI_OK
+			&& env == self->attachedEnv )
+	{
+		(*self->vm)->DetachCurrentThread( self->vm );
+		self->attachedEnv = NULL;
+	}
+}
+
+static void *GetBufferAddress( JNIEnv *env, jclass cls, jobject callbackStream, const char *fieldName )
+{
+	jobject buffer;
+	jfieldID fid = (*env)->GetFieldID( env, cls, fieldName, "Ljava/nio/ByteBuffer;" );
+	if( fid == NULL ) return NULL;
+	buffer = (*env)->GetObjectField( env, callbackStream, fid );
+	if( buffer == NULL ) return NULL;
+	return (*env)->GetDirectBufferAddress( env, buffer );
+}
+
+static unsigned long GetFrameSize( const PaStreamParameters *params )
+{
+	if( params == NULL ) return 0;
+	return Pa_GetSampleSize( params->sampleFormat ) * params->channelCount;
+}
+
+static JpaCallbackStream *GetCallbackStreamPointer( JNIEnv *env, jobject callbackStream )
+{
+	jclass cls = (*env)->GetObjectClass( env, callbackStream );
+	return (JpaCallbackStream *) jpa_GetLongField( env, cls, callbackStream, "nativeStream" );
+}
+
+// Open the PaStream of a CallbackStream, called by PortAudio.openCallbackStream().
+void jpa_OpenCallbackStream( JNIEnv *env, jobject callbackStream,
+		PaStreamParameters *inParams, PaStreamParameters *outParams,
+		jint sampleRate, jint framesPerBuffer, jint flags )
+{
+	int err;
+	jclass cls;
+	JpaCallbackStream *self;
+
+	if( ( inParams && ( inParams->sampleFormat & paNonInterleaved ) )
+			|| ( outParams && ( outParams->sampleFormat & paNonInterleaved ) ) )
+	{
+		jpa_ThrowError( env, "Callback streams don't support non-interleaved samples." );
+		return;
+	}
+
+	self = (JpaCallbackStream *) calloc( 1, sizeof (JpaCallbackStream) );
+	if( self == NULL )
+	{
+		jpa_ThrowError( env, "Cannot allocate callback stream." );
+		return;
+	}
+
+	cls = (*env)->GetObjectClass( env, callbackStream );
+	if( (*env)->GetJavaVM( env, &self->vm ) != 0
+			|| ( self->processMethod = (*env)->GetMethodID( env, cls, "process", "(II)I" ) ) == NULL )
+	{
+		jpa_ThrowError( env, "Cannot find CallbackStream.process()." );
+		goto error;
+	}
+
+	self->inputFrameSize = GetFrameSize( inParams );
+	self->outputFrameSize = GetFrameSize( outParams );
+	self->framesPerBuffer = framesPerBuffer;
+	if( inParams != NULL
+			&& ( self->inputBuffer = GetBufferAddress( env, cls, callbackStream, "inputBuffer" ) ) == NULL )
+	{
+		jpa_ThrowError( env, "Cannot get the input buffer." );
+		goto error;
+	}
+	if( outParams != NULL
+			&& ( self->outputBuffer = GetBufferAddress( env, cls, callbackStream, "outputBuffer" ) ) == NULL )
+	{
+		jpa_ThrowError( env, "Cannot get the output buffer." );
+		goto error;
+	}
+
+	self->callbackStream = (*env)->NewGlobalRef( env, callbackStream );
+	if( self->callbackStream == NULL )
+	{
+		jpa_ThrowError( env, "Cannot reference the callback stream." );
+		goto error;
+	}
+
+	err = Pa_OpenStream( &self->stream, inParams, outParams, sampleRate, framesPerBuffer, flags,
+			JpaStreamCallback, self );
+	if( err != paNoError )
+	{
+		jpa_CheckError( env, err );
+		goto error;
+	}
+
+	err = Pa_SetStreamFinishedCallback( self->stream, JpaStreamFinished );
+	if( err != paNoError )
+	{
+		jpa_CheckError( env, err );
+		goto error;
+	}
+
+	jpa_SetLongField( env, cls, callbackStream, "nativeStream", (jlong) self );
+	return;
+
+error:
+	if( self->stream != NULL ) Pa_CloseStream( self->stream );
+	if( self->callbackStream != NULL ) (*env)->DeleteGlobalRef( env, self->callbackStream );
+	free( self );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    start
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_start
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return;
+	jpa_CheckError( env, Pa_StartStream( self->stream ) );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    stop
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_stop
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return;
+	jpa_CheckError( env, Pa_StopStream( self->stream ) );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    abort
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_abort
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return;
+	jpa_CheckError( env, Pa_AbortStream( self->stream ) );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    close
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_close
+  (JNIEnv *env, jobject callbackStream )
+{
+	jclass cls;
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self != NULL )
+	{
+		int err = Pa_CloseStream( self->stream );
+		(*env)->DeleteGlobalRef( env, self->callbackStream );
+		free( self );
+		cls = (*env)->GetObjectClass(env, callbackStream);
+		jpa_SetLongField( env, cls, callbackStream, "nativeStream", (jlong) 0 );
+		jpa_CheckError( env, err );
+	}
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    isStopped
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_CallbackStream_isStopped
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return TRUE;
+	return (jpa_CheckError( env, Pa_IsStreamStopped( self->stream ) ) > 0);
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    isActive
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_CallbackStream_isActive
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return FALSE;
+	return (jpa_CheckError( env, Pa_IsStreamActive( self->stream ) ) > 0);
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getTime
+ * Signature: ()D
+ */
+JNIEXPORT jdouble JNICALL Java_com_portaudio_CallbackStream_getTime
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return 0.0;
+	return Pa_GetStreamTime( self->stream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getCpuLoad
+ * Signature: ()D
+ */
+JNIEXPORT jdouble JNICALL Java_com_portaudio_CallbackStream_getCpuLoad
+  (JNIEnv *env, jobject callbackStream )
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	if( self == NULL ) return 0.0;
+	return Pa_GetStreamCpuLoad( self->stream );
+}
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getInfo
+ * Signature: (Lcom/portaudio/StreamInfo;)V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_getInfo
+  (JNIEnv *env, jobject callbackStream, jobject streamInfo)
+{
+	JpaCallbackStream *self = GetCallbackStreamPointer( env, callbackStream );
+	const PaStreamInfo *info = self ? Pa_GetStreamInfo( self->stream ) : NULL;
+	if( streamInfo == NULL || info == NULL )
+	{
+		jpa_ThrowError( env, "Invalid stream." );
+	}
+	else
+	{
+		/* Get a reference to obj's class */
+		jclass cls = (*env)->GetObjectClass(env, streamInfo);
+ 
+		jpa_SetIntField( env, cls, streamInfo, "structVersion", info->structVersion );
+		jpa_SetDoubleField( env, cls, streamInfo, "inputLatency", info->inputLatency );
+		jpa_SetDoubleField( env, cls, streamInfo, "outputLatency", info->outputLatency );
+		jpa_SetDoubleField( env, cls, streamInfo, "sampleRate", info->sampleRate );
+	}
+}
@@ -0,0 +1,90 @@
+/* DO NOT EDIT THIS FILE - it is machine generated */
+#if defined(__APPLE__)
+#include <JavaVM/jni.h>
+#else
+#include <jni.h>
+#endif
+
+/* Header for class com_portaudio_CallbackStream */
+
+#ifndef _Included_com_portaudio_CallbackStream
+#define _Included_com_portaudio_CallbackStream
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    start
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_start
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    stop
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_stop
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    abort
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_abort
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    close
+ * Signature: ()V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_close
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    isStopped
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_CallbackStream_isStopped
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    isActive
+ * Signature: ()Z
+ */
+JNIEXPORT jboolean JNICALL Java_com_portaudio_CallbackStream_isActive
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getTime
+ * Signature: ()D
+ */
+JNIEXPORT jdouble JNICALL Java_com_portaudio_CallbackStream_getTime
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getCpuLoad
+ * Signature: ()D
+ */
+JNIEXPORT jdouble JNICALL Java_com_portaudio_CallbackStream_getCpuLoad
+  (JNIEnv *, jobject);
+
+/*
+ * Class:     com_portaudio_CallbackStream
+ * Method:    getInfo
+ * Signature: (Lcom/portaudio/StreamInfo;)V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_CallbackStream_getInfo
+  (JNIEnv *, jobject, jobject);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -106,29 +106,55 @@ JNIEXPORT jint JNICALL Java_com_portaudio_PortAudio_getDeviceCount
 JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_getDeviceInfo
   (JNIEnv *env, jclass clazz, jint index, jobject deviceInfo)
 {
-	const PaDeviceInfo *info;
-	     /* Get a reference to obj's class */
-	jclass cls = (*env)->GetObjectClass(env, deviceInfo);
- 
-	info = Pa_GetDeviceInfo( index );
+	const PaDeviceInfo *info = Pa_GetDeviceInfo( index );
 	if( info == NULL )
 	{
 		jpa_ThrowError( env, "Pa_GetDeviceInfo returned NULL." );
 	}
 	else
 	{
-		jpa_SetStringField( env, cls, deviceInfo, "name", info->name );
-		jpa_SetIntField( env, cls, deviceInfo, "maxInputChannels", info->maxInputChannels );
-		jpa_SetIntField( env, cls, deviceInfo, "maxOutputChannels", info->maxOutputChannels );
-		jpa_SetIntField( env, cls, deviceInfo, "hostApi", info->hostApi );
-		jpa_SetDoubleField( env, cls, deviceInfo, "defaultSampleRate", info->defaultSampleRate );
-		jpa_SetDoubleField( env, cls, deviceInfo, "defaultLowInputLatency", info->defaultLowInputLatency );
-		jpa_SetDoubleField( env, cls, deviceInfo, "defaultLowInputLatency", info->defaultHighInputLatency );
-		jpa_SetDoubleField( env, cls, deviceInfo, "defaultLowOutputLatency", info->defaultLowOutputLatency );
-		jpa_SetDoubleField( env, cls, deviceInfo, "defaultHighOutputLatency", info->defaultHighOutputLatency );
+		jpa_FillDeviceInfo( env, deviceInfo, info );
 	}
 }
 
+/*
+ * Class:     com_portaudio_PortAudio
+ * Method:    getDeviceInfos
+ * Signature: ()[Lcom/portaudio/DeviceInfo;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_portaudio_PortAudio_getDeviceInfos
+  (JNIEnv *env, jclass clazz)
+{
+	jobjectArray deviceInfos;
+	jint i;
+	jint count = Pa_GetDeviceCount();
+	if( count < 0 )
+	{
+		jpa_CheckError( env, count );
+		return NULL;
+	}
+
+	deviceInfos = (*env)->NewObjectArray( env, count, jpa_GetDeviceInfoClass(), NULL );
+	if( deviceInfos == NULL ) return NULL;
+
+	for( i = 0; i < count; i++ )
+	{
+		jobject deviceInfo;
+		const PaDeviceInfo *info = Pa_GetDeviceInfo( i );
+		if( info == NULL )
+		{
+			jpa_ThrowError( env, "Pa_GetDeviceInfo returned NULL." );
+			return NULL;
+		}
+		deviceInfo = jpa_NewDeviceInfo( env, info );
+		if( deviceInfo == NULL ) return NULL;
+		(*env)->SetObjectArrayElement( env, deviceInfos, i, deviceInfo );
+		/* Don't run out of local references on machines with many devices. */
+		(*env)->DeleteLocalRef( env, deviceInfo );
+	}
+	return deviceInfos;
+}
+
 /*
  * Class:     com_portaudio_PortAudio
  * Method:    geHostApiCount
@@ -173,26 +199,54 @@ JNIEXPORT jint JNICALL Java_com_portaudio_PortAudio_hostApiDeviceIndexToDeviceIn
 JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_getHostApiInfo
   (JNIEnv *env, jclass clazz, jint index, jobject hostApiInfo)
 {
-	const PaHostApiInfo *info;
-	     /* Get a reference to obj's class */
-	jclass cls = (*env)->GetObjectClass(env, hostApiInfo);
- 
-	info = Pa_GetHostApiInfo( index );
+	const PaHostApiInfo *info = Pa_GetHostApiInfo( index );
 	if( info == NULL )
 	{
 		jpa_ThrowError( env, "Pa_GetHostApiInfo returned NULL." );
 	}
 	else
 	{
-		jpa_SetIntField( env, cls, hostApiInfo, "version", info->structVersion );
-		jpa_SetIntField( env, cls, hostApiInfo, "type", info->type );
-		jpa_SetStringField( env, cls, hostApiInfo, "name", info->name );
-		jpa_SetIntField( env, cls, hostApiInfo, "deviceCount", info->deviceCount );
-		jpa_SetIntField( env, cls, hostApiInfo, "defaultInputDevice", info->defaultInputDevice );
-		jpa_SetIntField( env, cls, hostApiInfo, "defaultOutputDevice", info->defaultOutputDevice );
+		jpa_FillHostApiInfo( env, hostApiInfo, info );
 	}
 }
 
+/*
+ * Class:     com_portaudio_PortAudio
+ * Method:    getHostApiInfos
+ * Signature: ()[Lcom/portaudio/HostApiInfo;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_portaudio_PortAudio_getHostApiInfos
+  (JNIEnv *env, jclass clazz)
+{
+	jobjectArray hostApiInfos;
+	jint i;
+	jint count = Pa_GetHostApiCount();
+	if( count < 0 )
+	{
+		jpa_CheckError( env, count );
+		return NULL;
+	}
+
+	hostApiInfos = (*env)->NewObjectArray( env, count, jpa_GetHostApiInfoClass(), NULL );
+	if( hostApiInfos == NULL ) return NULL;
+
+	for( i = 0; i < count; i++ )
+	{
+		jobject hostApiInfo;
+		const PaHostApiInfo *info = Pa_GetHostApiInfo( i );
+		if( info == NULL )
+		{
+			jpa_ThrowError( env, "Pa_GetHostApiInfo returned NULL." );
+			return NULL;
+		}
+		hostApiInfo = jpa_NewHostApiInfo( env, info );
+		if( hostApiInfo == NULL ) return NULL;
+		(*env)->SetObjectArrayElement( env, hostApiInfos, i, hostApiInfo );
+		(*env)->DeleteLocalRef( env, hostApiInfo );
+	}
+	return hostApiInfos;
+}
+
 /*
  * Class:     com_portaudio_PortAudio
  * Method:    getDefaultInputDevice
@@ -270,10 +324,28 @@ JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_openStream
 		if( paInParams != NULL )
 		{
 			jpa_SetIntField( env, cls, blockingStream, "inputFormat", paInParams->sampleFormat );
+			jpa_SetIntField( env, cls, blockingStream, "inputChannelCount", paInParams->channelCount );
 		}
 		if( paOutParams != NULL )
 		{
 			jpa_SetIntField( env, cls, blockingStream, "outputFormat", paOutParams->sampleFormat );
+			jpa_SetIntField( env, cls, blockingStream, "outputChannelCount", paOutParams->channelCount );
 		}
 	}
 }
+
+/*
+ * Class:     com_portaudio_PortAudio
+ * Method:    openCallbackStream
+ * Signature: (Lcom/portaudio/CallbackStream;Lcom/portaudio/StreamParameters;Lcom/portaudio/StreamParameters;III)V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_openCallbackStream
+  (JNIEnv *env, jclass clazz, jobject callbackStream,  jobject inParams, jobject outParams, jint sampleRate, jint framesPerBuffer, jint flags )
+{
+	PaStreamParameters myInParams, *paInParams;
+	PaStreamParameters myOutParams, *paOutParams;
+	
+	paInParams = jpa_FillStreamParameters(  env, inParams, &myInParams );
+	paOutParams = jpa_FillStreamParameters(  env, outParams, &myOutParams );
+	jpa_OpenCallbackStream( env, callbackStream, paInParams, paOutParams, sampleRate, framesPerBuffer, flags );
+}
@@ -105,6 +105,14 @@ JNIEXPORT jint JNICALL Java_com_portaudio_PortAudio_getDeviceCount
 JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_getDeviceInfo
   (JNIEnv *, jclass, jint, jobject);
 
+/*
+ * Class:     com_portaudio_PortAudio
+ * Method:    getDeviceInfos
+ * Signature: ()[Lcom/portaudio/DeviceInfo;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_portaudio_PortAudio_getDeviceInfos
+  (JNIEnv *, jclass);
+
 /*
  * Class:     com_portaudio_PortAudio
  * Method:    getHostApiCount
@@ -121,6 +129,14 @@ JNIEXPORT jint JNICALL Java_com_portaudio_PortAudio_getHostApiCount
 JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_getHostApiInfo
   (JNIEnv *, jclass, jint, jobject);
 
+/*
+ * Class:     com_portaudio_PortAudio
+ * Method:    getHostApiInfos
+ * Signature: ()[Lcom/portaudio/HostApiInfo;
+ */
+JNIEXPORT jobjectArray JNICALL Java_com_portaudio_PortAudio_getHostApiInfos
+  (JNIEnv *, jclass);
+
 /*
  * Class:     com_portaudio_PortAudio
  * Method:    hostApiTypeIdToHostApiIndex
@@ -177,6 +193,14 @@ JNIEXPORT jint JNICALL Java_com_portaudio_PortAudio_isFormatSupported
 JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_openStream
   (JNIEnv *, jclass, jobject, jobject, jobject, jint, jint, jint);
 
+/*
+ * Class:     com_portaudio_PortAudio
+ * Method:    openCallbackStream
+ * Signature: (Lcom/portaudio/CallbackStream;Lcom/portaudio/StreamParameters;Lcom/portaudio/StreamParameters;III)V
+ */
+JNIEXPORT void JNICALL Java_com_portaudio_PortAudio_openCallbackStream
+  (JNIEnv *, jclass, jobject, jobject, jobject, jint, jint, jint);
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,134 @@
 #include "portaudio.h"
 #include "jpa_tools.h"
 
+/* Looked up once in JNI_OnLoad() so that the stream methods don't look them up on every call. */
+static jclass runtimeExceptionClass_ = NULL;
+static jfieldID nativeStreamFieldID_ = NULL;
+
+/* Looked up once so that enumerating many devices doesn't look up each field of each device. */
+static struct
+{
+	jclass cls;
+	jmethodID constructor;
+	jfieldID version;
+	jfieldID name;
+	jfieldID hostApi;
+	jfieldID maxInputChannels;
+	jfieldID maxOutputChannels;
+	jfieldID defaultLowInputLatency;
+	jfieldID defaultHighInputLatency;
+	jfieldID defaultLowOutputLatency;
+	jfieldID defaultHighOutputLatency;
+	jfieldID defaultSampleRate;
+} deviceInfoIDs_;
+
+static struct
+{
+	jclass cls;
+	jmethodID constructor;
+	jfieldID version;
+	jfieldID type;
+	jfieldID name;
+	jfieldID deviceCount;
+	jfieldID defaultInputDevice;
+	jfieldID defaultOutputDevice;
+} hostApiInfoIDs_;
+
+/* Make a global reference to a class and look up its no argument constructor. */
+static jclass FindClassAndConstructor( JNIEnv *env, const char *name, jmethodID *constructor )
+{
+	jclass globalCls;
+	jclass cls = (*env)->FindClass( env, name );
+	if( cls == NULL ) return NULL;
+	*constructor = (*env)->GetMethodID( env, cls, "<init>", "()V" );
+	globalCls = (*constructor == NULL) ? NULL : (jclass) (*env)->NewGlobalRef( env, cls );
+	(*env)->DeleteLocalRef( env, cls );
+	return globalCls;
+}
+
+static jint LookUpInfoIDs( JNIEnv *env )
+{
+	jclass cls;
+
+	cls = FindClassAndConstructor( env, "com/portaudio/DeviceInfo", &deviceInfoIDs_.constructor );
+	if( cls == NULL ) return JNI_ERR;
+	deviceInfoIDs_.cls = cls;
+	if( (deviceInfoIDs_.version = (*env)->GetFieldID( env, cls, "version", "I" )) == NULL
+			|| (deviceInfoIDs_.name = (*env)->GetFieldID( env, cls, "name", "Ljava/lang/String;" )) == NULL
+			|| (deviceInfoIDs_.hostApi = (*env)->GetFieldID( env, cls, "hostApi", "I" )) == NULL
+			|| (deviceInfoIDs_.maxInputChannels = (*env)->GetFieldID( env, cls, "maxInputChannels", "I" )) == NULL
+			|| (deviceInfoIDs_.maxOutputChannels = (*env)->GetFieldID( env, cls, "maxOutputChannels", "I" )) == NULL
+			|| (deviceInfoIDs_.defaultLowInputLatency = (*env)->GetFieldID( env, cls, "defaultLowInputLatency", "D" )) == NULL
+			|| (deviceInfoIDs_.defaultHighInputLatency = (*env)->GetFieldID( env, cls, "defaultHighInputLatency", "D" )) == NULL
+			|| (deviceInfoIDs_.defaultLowOutputLatency = (*env)->GetFieldID( env, cls, "defaultLowOutputLatency", "D" )) == NULL
+			|| (deviceInfoIDs_.defaultHighOutputLatency = (*env)->GetFieldID( env, cls, "defaultHighOutputLatency", "D" )) == NULL
+			|| (deviceInfoIDs_.defaultSampleRate = (*env)->GetFieldID( env, cls, "defaultSampleRate", "D" )) == NULL )
+	{
+		return JNI_ERR;
+	}
+
+	cls = FindClassAndConstructor( env, "com/portaudio/HostApiInfo", &hostApiInfoIDs_.constructor );
+	if( cls == NULL ) return JNI_ERR;
+	hostApiInfoIDs_.cls = cls;
+	if( (hostApiInfoIDs_.version = (*env)->GetFieldID( env, cls, "version", "I" )) == NULL
+			|| (hostApiInfoIDs_.type = (*env)->GetFieldID( env, cls, "type", "I" )) == NULL
+			|| (hostApiInfoIDs_.name = (*env)->GetFieldID( env, cls, "name", "Ljava/lang/String;" )) == NULL
+			|| (hostApiInfoIDs_.deviceCount = (*env)->GetFieldID( env, cls, "deviceCount", "I" )) == NULL
+			|| (hostApiInfoIDs_.defaultInputDevice = (*env)->GetFieldID( env, cls, "defaultInputDevice", "I" )) == NULL
+			|| (hostApiInfoIDs_.defaultOutputDevice = (*env)->GetFieldID( env, cls, "defaultOutputDevice", "I" )) == NULL )
+	{
+		return JNI_ERR;
+	}
+
+	return JNI_OK;
+}
+
+JNIEXPORT jint JNICALL JNI_OnLoad( JavaVM *vm, void *reserved )
+{
+	JNIEnv *env;
+	jclass cls;
+	(void) reserved; /* unused parameter */
+
+	if( (*vm)->GetEnv( vm, (void **) &env, JNI_VERSION_1_4 ) != JNI_OK )
+	{
+		return JNI_ERR;
+	}
+
+	cls = (*env)->FindClass( env, "java/lang/RuntimeException" );
+	if( cls == NULL ) return JNI_ERR;
+	runtimeExceptionClass_ = (jclass) (*env)->NewGlobalRef( env, cls );
+	(*env)->DeleteLocalRef( env, cls );
+	if( runtimeExceptionClass_ == NULL ) return JNI_ERR;
+
+	cls = (*env)->FindClass( env, "com/portaudio/BlockingStream" );
+	if( cls == NULL ) return JNI_ERR;
+	/* A field ID stays valid for as long as its class is loaded, which is as long as this library is. */
+	nativeStreamFieldID_ = (*env)->GetFieldID( env, cls, "nativeStream", "J" );
+	(*env)->DeleteLocalRef( env, cls );
+	if( nativeStreamFieldID_ == NULL ) return JNI_ERR;
+
+	if( LookUpInfoIDs( env ) != JNI_OK ) return JNI_ERR;
+
+	return JNI_VERSION_1_4;
+}
+
+JNIEXPORT void JNICALL JNI_OnUnload( JavaVM *vm, void *reserved )
+{
+	JNIEnv *env;
+	(void) reserved; /* unused parameter */
+
+	if( (*vm)->GetEnv( vm, (void **) &env, JNI_VERSION_1_4 ) == JNI_OK )
+	{
+		if( runtimeExceptionClass_ != NULL ) (*env)->DeleteGlobalRef( env, runtimeExceptionClass_ );
+		if( deviceInfoIDs_.cls != NULL ) (*env)->DeleteGlobalRef( env, deviceInfoIDs_.cls );
+		if( hostApiInfoIDs_.cls != NULL ) (*env)->DeleteGlobalRef( env, hostApiInfoIDs_.cls );
+	}
+	runtimeExceptionClass_ = NULL;
+	deviceInfoIDs_.cls = NULL;
+	hostApiInfoIDs_.cls = NULL;
+	nativeStreamFieldID_ = NULL;
+}
+
 jint jpa_GetIntField( JNIEnv *env, jclass cls, jobject obj, const char *fieldName )
 {
      /* Look for the instance field maxInputChannels in cls */
@@ -151,6 +279,78 @@ void jpa_SetStringField( JNIEnv *env, jclass cls, jobject obj, const char *field
 	 }
 }
 
+/* Set a String field, returning 0 if the String could not be created. */
+static int SetStringField( JNIEnv *env, jobject obj, jfieldID fid, const char *value )
+{
+	jstring jstr = (*env)->NewStringUTF( env, value );
+	if( jstr == NULL ) return 0; /* OutOfMemoryError is pending */
+	(*env)->SetObjectField( env, obj, fid, jstr );
+	(*env)->DeleteLocalRef( env, jstr );
+	return 1;
+}
+
+// Copy a PaDeviceInfo into a DeviceInfo, returns 0 with an exception pending on failure.
+int jpa_FillDeviceInfo( JNIEnv *env, jobject deviceInfo, const PaDeviceInfo *info )
+{
+	if( !SetStringField( env, deviceInfo, deviceInfoIDs_.name, info->name ) ) return 0;
+	(*env)->SetIntField( env, deviceInfo, deviceInfoIDs_.version, info->structVersion );
+	(*env)->SetIntField( env, deviceInfo, deviceInfoIDs_.hostApi, info->hostApi );
+	(*env)->SetIntField( env, deviceInfo, deviceInfoIDs_.maxInputChannels, info->maxInputChannels );
+	(*env)->SetIntField( env, deviceInfo, deviceInfoIDs_.maxOutputChannels, info->maxOutputChannels );
+	(*env)->SetDoubleField( env, deviceInfo, deviceInfoIDs_.defaultLowInputLatency, info->defaultLowInputLatency );
+	(*env)->SetDoubleField( env, deviceInfo, deviceInfoIDs_.defaultHighInputLatency, info->defaultHighInputLatency );
+	(*env)->SetDoubleField( env, deviceInfo, deviceInfoIDs_.defaultLowOutputLatency, info->defaultLowOutputLatency );
+	(*env)->SetDoubleField( env, deviceInfo, deviceInfoIDs_.defaultHighOutputLatency, info->defaultHighOutputLatency );
+	(*env)->SetDoubleField( env, deviceInfo, deviceInfoIDs_.defaultSampleRate, info->defaultSampleRate );
+	return 1;
+}
+
+// Create a DeviceInfo holding a PaDeviceInfo, returns NULL with an exception pending on failure.
+jobject jpa_NewDeviceInfo( JNIEnv *env, const PaDeviceInfo *info )
+{
+	jobject deviceInfo = (*env)->NewObject( env, deviceInfoIDs_.cls, deviceInfoIDs_.constructor );
+	if( deviceInfo != NULL && !jpa_FillDeviceInfo( env, deviceInfo, info ) )
+	{
+		(*env)->DeleteLocalRef( env, deviceInfo );
+		deviceInfo = NULL;
+	}
+	return deviceInfo;
+}
+
+// Copy a PaHostApiInfo into a HostApiInfo, returns 0 with an exception pending on failure.
+int jpa_FillHostApiInfo( JNIEnv *env, jobject hostApiInfo, const PaHostApiInfo *info )
+{
+	if( !SetStringField( env, hostApiInfo, hostApiInfoIDs_.name, info->name ) ) return 0;
+	(*env)->SetIntField( env, hostApiInfo, hostApiInfoIDs_.version, info->structVersion );
+	(*env)->SetIntField( env, hostApiInfo, hostApiInfoIDs_.type, info->type );
+	(*env)->SetIntField( env, hostApiInfo, hostApiInfoIDs_.deviceCount, info->deviceCount );
+	(*env)->SetIntField( env, hostApiInfo, hostApiInfoIDs_.defaultInputDevice, info->defaultInputDevice );
+	(*env)->SetIntField( env, hostApiInfo, hostApiInfoIDs_.defaultOutputDevice, info->defaultOutputDevice );
+	return 1;
+}
+
+// Create a HostApiInfo holding a PaHostApiInfo, returns NULL with an exception pending on failure.
+jobject jpa_NewHostApiInfo( JNIEnv *env, const PaHostApiInfo *info )
+{
+	jobject hostApiInfo = (*env)->NewObject( env, hostApiInfoIDs_.cls, hostApiInfoIDs_.constructor );
+	if( hostApiInfo != NULL && !jpa_FillHostApiInfo( env, hostApiInfo, info ) )
+	{
+		(*env)->DeleteLocalRef( env, hostApiInfo );
+		hostApiInfo = NULL;
+	}
+	return hostApiInfo;
+}
+
+jclass jpa_GetDeviceInfoClass( void )
+{
+	return deviceInfoIDs_.cls;
+}
+
+jclass jpa_GetHostApiInfoClass( void )
+{
+	return hostApiInfoIDs_.cls;
+}
+
 PaStreamParameters *jpa_FillStreamParameters( JNIEnv *env, jobject jstreamParam, PaStreamParameters *myParams )
 {
 	jclass cls;
@@ -171,8 +371,7 @@ PaStreamParameters *jpa_FillStreamParameters( JNIEnv *env, jobject jstreamParam,
 // Create an exception that will be thrown when we return from the JNI call.
 jint jpa_ThrowError( JNIEnv *env, const char *message )
 {
-	return (*env)->ThrowNew(env, (*env)->FindClass( env, "java/lang/RuntimeException"),
-                  message );
+	return (*env)->ThrowNew(env, runtimeExceptionClass_, message );
 }
 
 // Throw an exception on error.
@@ -203,6 +402,11 @@ jint jpa_CheckError( JNIEnv *env, PaError err )
 // Get the stream pointer from a BlockingStream long field.
 PaStream *jpa_GetStreamPointer( JNIEnv *env, jobject blockingStream )
 {
-	jclass cls = (*env)->GetObjectClass(env, blockingStream);
-	return (PaStream *) jpa_GetLongField( env, cls, blockingStream, "nativeStream" );
+	return (PaStream *) (*env)->GetLongField( env, blockingStream, nativeStreamFieldID_ );
+}
+
+// Clear the stream pointer of a BlockingStream after closing it.
+void jpa_ClearStreamPointer( JNIEnv *env, jobject blockingStream )
+{
+	(*env)->SetLongField( env, blockingStream, nativeStreamFieldID_, (jlong) 0 );
 }
@@ -58,5 +58,17 @@ jint jpa_CheckError( JNIEnv *env, PaError err );
 jint jpa_ThrowError( JNIEnv *env, const char *message );
 
 PaStream *jpa_GetStreamPointer( JNIEnv *env, jobject blockingStream );
+void jpa_ClearStreamPointer( JNIEnv *env, jobject blockingStream );
+
+int jpa_FillDeviceInfo( JNIEnv *env, jobject deviceInfo, const PaDeviceInfo *info );
+jobject jpa_NewDeviceInfo( JNIEnv *env, const PaDeviceInfo *info );
+int jpa_FillHostApiInfo( JNIEnv *env, jobject hostApiInfo, const PaHostApiInfo *info );
+jobject jpa_NewHostApiInfo( JNIEnv *env, const PaHostApiInfo *info );
+jclass jpa_GetDeviceInfoClass( void );
+jclass jpa_GetHostApiInfoClass( void );
+
+void jpa_OpenCallbackStream( JNIEnv *env, jobject callbackStream,
+		PaStreamParameters *inParams, PaStreamParameters *outParams,
+		jint sampleRate, jint framesPerBuffer, jint flags );
 
 #endif /* JPA_TOOLS_H */
@@ -38,6 +38,10 @@
 
 package com.portaudio;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+
 import junit.framework.TestCase;
 
 /**
@@ -100,6 +104,39 @@ public class TestBasic extends TestCase
 		PortAudio.terminate();
 	}
 
+	public void testGetDeviceInfos()
+	{
+		PortAudio.initialize();
+		DeviceInfo[] infos = PortAudio.getDeviceInfos();
+		assertEquals( "one info per device", PortAudio.getDeviceCount(),
+				infos.length );
+		for( int i = 0; i < infos.length; i++ )
+		{
+			DeviceInfo info = PortAudio.getDeviceInfo( i );
+			assertEquals( "name", info.name, infos[i].name );
+			assertEquals( "hostApi", info.hostApi, infos[i].hostApi );
+			assertEquals( "maxInputChannels", info.maxInputChannels,
+					infos[i].maxInputChannels );
+			assertEquals( "maxOutputChannels", info.maxOutputChannels,
+					infos[i].maxOutputChannels );
+			assertEquals( "defaultHighInputLatency",
+					info.defaultHighInputLatency,
+					infos[i].defaultHighInputLatency, 0.0 );
+		}
+
+		HostApiInfo[] hostApiInfos = PortAudio.getHostApiInfos();
+		assertEquals( "one info per host api", PortAudio.getHostApiCount(),
+				hostApiInfos.length );
+		for( int i = 0; i < hostApiInfos.length; i++ )
+		{
+			HostApiInfo info = PortAudio.getHostApiInfo( i );
+			assertEquals( "name", info.name, hostApiInfos[i].name );
+			assertEquals( "deviceCount", info.deviceCount,
+					hostApiInfos[i].deviceCount );
+		}
+		PortAudio.terminate();
+	}
+
 	public void testHostApis()
 	{
 		PortAudio.initialize();
@@ -420,6 +457,125 @@ public class TestBasic extends TestCase
 		PortAudio.terminate();
 	}
 
+	public void testBlockingWriteFloatDirect()
+	{
+		PortAudio.initialize();
+
+		StreamParameters streamParameters = new StreamParameters();
+		streamParameters.channelCount = 2;
+		streamParameters.device = PortAudio.getDefaultOutputDevice();
+		streamParameters.suggestedLatency = PortAudio
+				.getDeviceInfo( streamParameters.device ).defaultLowOutputLatency;
+
+		int framesPerBuffer = 256;
+		int flags = 0;
+		BlockingStream stream = PortAudio.openStream( null, streamParameters,
+				44100, framesPerBuffer, flags );
+		assertTrue( "got default stream", stream != null );
+
+		FloatBuffer buffer = ByteBuffer
+				.allocateDirect( framesPerBuffer * 2 * 4 )
+				.order( ByteOrder.nativeOrder() ).asFloatBuffer();
+		SineOscillator osc1 = new SineOscillator( 200.0, 44100 );
+		SineOscillator osc2 = new SineOscillator( 300.0, 44100 );
+
+		int numFrames = 80000;
+		stream.start();
+		long startTime = System.currentTimeMillis();
+		int framesLeft = numFrames;
+		while( framesLeft > 0 )
+		{
+			int framesToWrite = (framesLeft > framesPerBuffer) ? framesPerBuffer
+					: framesLeft;
+			buffer.clear();
+			for( int j = 0; j < framesToWrite; j++ )
+			{
+				buffer.put( (float) osc1.next() );
+				buffer.put( (float) osc2.next() );
+			}
+			buffer.flip();
+			stream.write( buffer, framesToWrite );
+			assertEquals( "buffer position advanced", framesToWrite * 2,
+					buffer.position() );
+			framesLeft -= framesToWrite;
+		}
+		stream.stop();
+		long stopTime = System.currentTimeMillis();
+
+		Throwable caught = null;
+		try
+		{
+			stream.write( FloatBuffer.allocate( framesPerBuffer * 2 ),
+					framesPerBuffer );
+		} catch( Throwable e )
+		{
+			caught = e;
+		}
+		assertTrue( "caught no exception for a heap buffer", (caught != null) );
+		stream.close();
+
+		double elapsed = (stopTime - startTime) / 1000.0;
+		double expected = numFrames / 44100.0;
+		assertEquals( "elapsed time to play", expected, elapsed, 0.20 );
+		PortAudio.terminate();
+	}
+
+	public void testCallbackStream() throws InterruptedException
+	{
+		PortAudio.initialize();
+
+		StreamParameters streamParameters = new StreamParameters();
+		streamParameters.channelCount = 2;
+		streamParameters.device = PortAudio.getDefaultOutputDevice();
+		streamParameters.suggestedLatency = PortAudio
+				.getDeviceInfo( streamParameters.device ).defaultLowOutputLatency;
+
+		final int sampleRate = 44100;
+		final int numFrames = 44100;
+		final int[] framesPlayed = new int[1];
+		StreamCallback callback = new StreamCallback()
+		{
+			SineOscillator osc1 = new SineOscillator( 200.0, sampleRate );
+			SineOscillator osc2 = new SineOscillator( 300.0, sampleRate );
+
+			public int onProcess( ByteBuffer input, ByteBuffer output,
+					int frames, int statusFlags )
+			{
+				for( int j = 0; j < frames; j++ )
+				{
+					output.putFloat( (float) osc1.next() );
+					output.putFloat( (float) osc2.next() );
+				}
+				framesPlayed[0] += frames;
+				return (framesPlayed[0] < numFrames) ? RESULT_CONTINUE
+						: RESULT_COMPLETE;
+			}
+		};
+
+		int framesPerBuffer = 256;
+		int flags = 0;
+		CallbackStream stream = PortAudio.openCallbackStream( null,
+				streamParameters, sampleRate, framesPerBuffer, flags,
+				callback );
+		assertTrue( "got default stream", stream != null );
+
+		long startTime = System.currentTimeMillis();
+		stream.start();
+		while( stream.isActive() )
+		{
+			Thread.sleep( 10 );
+		}
+		long stopTime = System.currentTimeMillis();
+		stream.stop();
+		stream.close();
+
+		assertTrue( "frames played", framesPlayed[0] >= numFrames );
+		double elapsed = (stopTime - startTime) / 1000.0;
+		double expected = numFrames / (double) sampleRate;
+		assertEquals( "elapsed time to play", expected, elapsed, 0.20 );
+		PortAudio.terminate();
+	}
+
 	public void testRecordPlayFloat() throws InterruptedException
 	{
 		checkRecordPlay( PortAudio.FORMAT_FLOAT_32 );
@@ -43,6 +43,12 @@
 */
 package com.portaudio;
 
+import java.nio.Buffer;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+import java.nio.ShortBuffer;
+
 /**
  * Represents a stream for blocking read/write I/O.
  * 
@@ -63,6 +69,8 @@ public class BlockingStream
 	private long nativeStream;
 	private int inputFormat = -1;
 	private int outputFormat = -1;
+	private int inputChannelCount = 0;
+	private int outputChannelCount = 0;
 
 	protected BlockingStream()
 	{
@@ -159,6 +167,188 @@ public class BlockingStream
 		return writeShorts( buffer, numFrames );
 	}
 
+	private native boolean readDirect( Buffer buffer, int offsetBytes,
+			int numFrames );
+
+	private native boolean writeDirect( Buffer buffer, int offsetBytes,
+			int numFrames );
+
+	private static int getSampleSize( int format )
+	{
+		switch( format )
+		{
+		case PortAudio.FORMAT_FLOAT_32:
+			return 4;
+		case PortAudio.FORMAT_INT_16:
+			return 2;
+		default:
+			throw new RuntimeException( "Unsupported sample format." );
+		}
+	}
+
+	// Check a direct buffer of numFrames frames from its position on and
+	// return the number of samples.
+	private static int checkDirectBuffer( Buffer buffer, int numFrames,
+			int channelCount, boolean nativeOrder )
+	{
+		if( !buffer.isDirect() )
+		{
+			throw new RuntimeException( "Buffer is not direct." );
+		}
+		if( !nativeOrder )
+		{
+			throw new RuntimeException( "Buffer is not in native byte order." );
+		}
+		if( numFrames < 0 || buffer.remaining() / channelCount < numFrames )
+		{
+			throw new RuntimeException( "Buffer too small for numFrames." );
+		}
+		return numFrames * channelCount;
+	}
+
+	/**
+	 * Read 32-bit floating point data from the stream into a direct buffer,
+	 * from its position on, which is advanced by the samples read. The
+	 * samples are read in place, without the copies of read( float[], int ).
+	 * 
+	 * @param buffer
+	 *            a direct buffer in native byte order
+	 * @param numFrames
+	 *            number of frames to read
+	 * @return true if an input overflow occurred
+	 */
+	public boolean read( FloatBuffer buffer, int numFrames )
+	{
+		if( inputFormat != PortAudio.FORMAT_FLOAT_32 )
+		{
+			throw new RuntimeException(
+					"Tried to read float samples from a non float stream." );
+		}
+		int samples = checkDirectBuffer( buffer, numFrames,
+				inputChannelCount, buffer.order() == ByteOrder.nativeOrder() );
+		int position = buffer.position();
+		boolean overflowed = readDirect( buffer, position * 4, numFrames );
+		buffer.position( position + samples );
+		return overflowed;
+	}
+
+	/**
+	 * Write 32-bit floating point data to the stream from a direct buffer,
+	 * from its position on, which is advanced by the samples written.
+	 * 
+	 * @param buffer
+	 *            a direct buffer in native byte order
+	 * @param numFrames
+	 *            number of frames to write
+	 * @return true if an output underflow occurred
+	 */
+	public boolean write( FloatBuffer buffer, int numFrames )
+	{
+		if( outputFormat != PortAudio.FORMAT_FLOAT_32 )
+		{
+			throw new RuntimeException(
+					"Tried to write float samples to a non float stream." );
+		}
+		int samples = checkDirectBuffer( buffer, numFrames,
+				outputChannelCount, buffer.order() == ByteOrder.nativeOrder() );
+		int position = buffer.position();
+		boolean underflowed = writeDirect( buffer, position * 4, numFrames );
+		buffer.position( position + samples );
+		return underflowed;
+	}
+
+	/**
+	 * Read 16-bit integer data from the stream into a direct buffer, as
+	 * read( FloatBuffer, int ).
+	 * 
+	 * @param buffer
+	 *            a direct buffer in native byte order
+	 * @param numFrames
+	 *            number of frames to read
+	 * @return true if an input overflow occurred
+	 */
+	public boolean read( ShortBuffer buffer, int numFrames )
+	{
+		if( inputFormat != PortAudio.FORMAT_INT_16 )
+		{
+			throw new RuntimeException(
+					"Tried to read short samples from a non short stream." );
+		}
+		int samples = checkDirectBuffer( buffer, numFrames,
+				inputChannelCount, buffer.order() == ByteOrder.nativeOrder() );
+		int position = buffer.position();
+		boolean overflowed = readDirect( buffer, position * 2, numFrames );
+		buffer.position( position + samples );
+		return overflowed;
+	}
+
+	/**
+	 * Write 16-bit integer data to the stream from a direct buffer, as
+	 * write( FloatBuffer, int ).
+	 * 
+	 * @param buffer
+	 *            a direct buffer in native byte order
+	 * @param numFrames
+	 *            number of frames to write
+	 * @return true if an output underflow occurred
+	 */
+	public boolean write( ShortBuffer buffer, int numFrames )
+	{
+		if( outputFormat != PortAudio.FORMAT_INT_16 )
+		{
+			throw new RuntimeException(
+					"Tried to write short samples from a non short stream." );
+		}
+		int samples = checkDirectBuffer( buffer, numFrames,
+				outputChannelCount, buffer.order() == ByteOrder.nativeOrder() );
+		int position = buffer.position();
+		boolean underflowed = writeDirect( buffer, position * 2, numFrames );
+		buffer.position( position + samples );
+		return underflowed;
+	}
+
+	/**
+	 * Read samples in the stream's format from the stream into a direct byte
+	 * buffer, as read( FloatBuffer, int ). The position is advanced by the
+	 * bytes read.
+	 * 
+	 * @param buffer
+	 *            a direct buffer, the samples are in native byte order
+	 * @param numFrames
+	 *            number of frames to read
+	 * @return true if an input overflow occurred
+	 */
+	public boolean read( ByteBuffer buffer, int numFrames )
+	{
+		int frameSize = getSampleSize( inputFormat ) * inputChannelCount;
+		int bytes = checkDirectBuffer( buffer, numFrames, frameSize, true );
+		int position = buffer.position();
+		boolean overflowed = readDirect( buffer, position, numFrames );
+		buffer.position( position + bytes );
+		return overflowed;
+	}
+
+	/**
+	 * Write samples in the stream's format to the stream from a direct byte
+	 * buffer, as write( FloatBuffer, int ). The position is advanced by the
+	 * bytes written.
+	 * 
+	 * @param buffer
+	 *            a direct buffer, the samples are in native byte order
+	 * @param numFrames
+	 *            number of frames to write
+	 * @return true if an output underflow occurred
+	 */
+	public boolean write( ByteBuffer buffer, int numFrames )
+	{
+		int frameSize = getSampleSize( outputFormat ) * outputChannelCount;
+		int bytes = checkDirectBuffer( buffer, numFrames, frameSize, true );
+		int position = buffer.position();
+		boolean underflowed = writeDirect( buffer, position, numFrames );
+		buffer.position( position + bytes );
+		return underflowed;
+	}
+
 	/**
 	 * Atart audio I/O.
 	 */
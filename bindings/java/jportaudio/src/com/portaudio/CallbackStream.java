@@ -0,0 +1,198 @@
+/*
+ * Portable Audio I/O Library
+ * Java Binding for PortAudio
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 2008 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup bindings_java
+
+ @brief A stream calling a Java listener from its audio thread.
+*/
+package com.portaudio;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Represents a stream which calls a StreamCallback for each buffer of audio.
+ * 
+ * The native audio thread is attached to the Java VM once, as a daemon
+ * thread, and the audio is exchanged through direct buffers allocated when
+ * the stream is opened, so no objects are allocated while it runs. This
+ * avoids the extra thread and latency of a BlockingStream, but the
+ * callback runs on the audio thread and must not block.
+ * 
+ * To create one of these, call PortAudio.openCallbackStream().
+ * 
+ * @see PortAudio
+ * @see StreamCallback
+ * 
+ */
+public class CallbackStream
+{
+	// nativeStream is only accessed by the native code. It contains a pointer
+	// to the native state of the stream, including the PaStream.
+	private long nativeStream;
+	private final StreamCallback callback;
+	private final ByteBuffer inputBuffer;
+	private final ByteBuffer outputBuffer;
+	private final int inputFrameSize;
+	private final int outputFrameSize;
+
+	protected CallbackStream( StreamCallback callback,
+			StreamParameters inputParameters,
+			StreamParameters outputParameters, int framesPerBuffer )
+	{
+		this.callback = callback;
+		inputFrameSize = getFrameSize( inputParameters );
+		outputFrameSize = getFrameSize( outputParameters );
+		inputBuffer = allocateBuffer( inputFrameSize, framesPerBuffer );
+		outputBuffer = allocateBuffer( outputFrameSize, framesPerBuffer );
+	}
+
+	private static int getFrameSize( StreamParameters parameters )
+	{
+		if( parameters == null )
+		{
+			return 0;
+		}
+		int sampleSize;
+		switch( parameters.sampleFormat )
+		{
+		case PortAudio.FORMAT_FLOAT_32:
+		case PortAudio.FORMAT_INT_32:
+			sampleSize = 4;
+			break;
+		case PortAudio.FORMAT_INT_24:
+			sampleSize = 3;
+			break;
+		case PortAudio.FORMAT_INT_16:
+			sampleSize = 2;
+			break;
+		case PortAudio.FORMAT_INT_8:
+		case PortAudio.FORMAT_UINT_8:
+			sampleSize = 1;
+			break;
+		default:
+			throw new RuntimeException( "Unsupported sample format." );
+		}
+		return sampleSize * parameters.channelCount;
+	}
+
+	private static ByteBuffer allocateBuffer( int frameSize, int framesPerBuffer )
+	{
+		if( frameSize == 0 )
+		{
+			return null;
+		}
+		return ByteBuffer.allocateDirect( frameSize * framesPerBuffer ).order(
+				ByteOrder.nativeOrder() );
+	}
+
+	// Called by the native code on the audio thread, the buffers hold the
+	// frames of this call.
+	private int process( int numFrames, int statusFlags )
+	{
+		if( inputBuffer != null )
+		{
+			inputBuffer.clear();
+			inputBuffer.limit( numFrames * inputFrameSize );
+		}
+		if( outputBuffer != null )
+		{
+			outputBuffer.clear();
+			outputBuffer.limit( numFrames * outputFrameSize );
+		}
+		return callback.onProcess( inputBuffer, outputBuffer, numFrames,
+				statusFlags );
+	}
+
+	/**
+	 * Start audio I/O, the callback is called from now on.
+	 */
+	public native void start();
+
+	/**
+	 * Wait for the stream to play the output of the last callback, then stop.
+	 */
+	public native void stop();
+
+	/**
+	 * Stop immediately and lose any output not played yet.
+	 */
+	public native void abort();
+
+	/**
+	 * Close the stream and zero out the pointer. Do not reference the stream
+	 * after this. An open stream holds on to its callback.
+	 */
+	public native void close();
+
+	public native boolean isStopped();
+
+	/**
+	 * @return false after the callback returned RESULT_COMPLETE or
+	 *         RESULT_ABORT, or threw an exception
+	 */
+	public native boolean isActive();
+
+	/**
+	 * Get audio time related to this stream. Note that it may not start at 0.0.
+	 */
+	public native double getTime();
+
+	/**
+	 * @return the fraction of the available time spent in the callback,
+	 *         0.0 to 1.0 or more
+	 */
+	public native double getCpuLoad();
+
+	private native void getInfo( StreamInfo streamInfo );
+
+	public StreamInfo getInfo()
+	{
+		StreamInfo streamInfo = new StreamInfo();
+		getInfo( streamInfo );
+		return streamInfo;
+	}
+
+	public String toString()
+	{
+		return "CallbackStream: streamPtr = " + Long.toHexString( nativeStream )
+				+ ", inFrameSize = " + inputFrameSize + ", outFrameSize = "
+				+ outputFrameSize;
+	}
+}
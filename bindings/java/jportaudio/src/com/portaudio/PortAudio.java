@@ -52,12 +52,14 @@ package com.portaudio;
  * http://portaudio.com/docs/
  * http://portaudio.com/docs/v19-doxydocs/portaudio_8h.html
  * 
- * This Java binding does not support audio callbacks because an audio callback
- * should never block. Calling into a Java virtual machine might block for
- * garbage collection or synchronization. So only the blocking read/write mode
- * is supported.
+ * An audio callback should never block, and calling into a Java virtual
+ * machine might block for garbage collection or synchronization. The blocking
+ * read/write mode of a BlockingStream is the safe choice. A CallbackStream
+ * calls Java from the audio thread for the lowest latency, with a callback
+ * that doesn't allocate.
  * 
  * @see BlockingStream
+ * @see CallbackStream
  * @see DeviceInfo
  * @see HostApiInfo
  * @see StreamInfo
@@ -173,6 +175,16 @@ public class PortAudio
 		return deviceInfo;
 	}
 
+	/**
+	 * Get the information about all devices in a single native call, which
+	 * is much faster than calling getDeviceInfo() for each device on systems
+	 * with many devices.
+	 * 
+	 * @return An array of getDeviceCount() DeviceInfo structures, indexed by
+	 *         device index.
+	 */
+	public native static DeviceInfo[] getDeviceInfos();
+
 	/**
 	 * @return the number of available host APIs.
 	 */
@@ -192,6 +204,14 @@ public class PortAudio
 		return hostApiInfo;
 	}
 
+	/**
+	 * Get the information about all host APIs in a single native call.
+	 * 
+	 * @return An array of getHostApiCount() HostApiInfo structures, indexed
+	 *         by host API index.
+	 */
+	public native static HostApiInfo[] getHostApiInfos();
+
 	/**
 	 * @param hostApiType
 	 *            A unique host API identifier, for example
@@ -258,4 +278,49 @@ public class PortAudio
 		return blockingStream;
 	}
 
+	private native static void openCallbackStream(
+			CallbackStream callbackStream,
+			StreamParameters inputStreamParameters,
+			StreamParameters outputStreamParameters, int sampleRate,
+			int framesPerBuffer, int flags );
+
+	/**
+	 * Open a stream which calls callback.onProcess() from its audio thread
+	 * for every framesPerBuffer frames.
+	 * 
+	 * @param inputStreamParameters
+	 *            input description, may be null
+	 * @param outputStreamParameters
+	 *            output description, may be null
+	 * @param sampleRate
+	 *            typically 44100 or 48000, or maybe 22050, 16000, 8000, 96000
+	 * @param framesPerBuffer
+	 *            the frames passed to each call, must be above 0 as the
+	 *            buffers are allocated when the stream is opened
+	 * @param flags
+	 * @param callback
+	 *            processes the audio
+	 * @return
+	 */
+	public static CallbackStream openCallbackStream(
+			StreamParameters inputStreamParameters,
+			StreamParameters outputStreamParameters, int sampleRate,
+			int framesPerBuffer, int flags, StreamCallback callback )
+	{
+		if( callback == null )
+		{
+			throw new RuntimeException( "null stream callback" );
+		}
+		if( framesPerBuffer <= 0 )
+		{
+			throw new RuntimeException(
+					"framesPerBuffer must be above 0 for a callback stream." );
+		}
+		CallbackStream callbackStream = new CallbackStream( callback,
+				inputStreamParameters, outputStreamParameters, framesPerBuffer );
+		openCallbackStream( callbackStream, inputStreamParameters,
+				outputStreamParameters, sampleRate, framesPerBuffer, flags );
+		return callbackStream;
+	}
+
 }
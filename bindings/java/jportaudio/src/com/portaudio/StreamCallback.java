@@ -0,0 +1,93 @@
+/*
+ * Portable Audio I/O Library
+ * Java Binding for PortAudio
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 2008 Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup bindings_java
+
+ @brief Interface of the listener of a callback stream.
+*/
+package com.portaudio;
+
+import java.nio.ByteBuffer;
+
+/**
+ * Processes the audio of a CallbackStream.
+ * 
+ * onProcess() is called on the audio thread of the stream, so it must not
+ * block, and should not allocate, to keep the garbage collector from
+ * pausing the audio.
+ * 
+ * @see CallbackStream
+ * @see PortAudio#openCallbackStream
+ * 
+ */
+public interface StreamCallback
+{
+	/** Return to keep the stream running. */
+	public final static int RESULT_CONTINUE = 0;
+	/** Return to stop the stream once the output written has been played. */
+	public final static int RESULT_COMPLETE = 1;
+	/** Return to stop the stream as soon as possible. */
+	public final static int RESULT_ABORT = 2;
+
+	/** Bits of statusFlags. */
+	public final static int INPUT_UNDERFLOW = (1 << 0);
+	public final static int INPUT_OVERFLOW = (1 << 1);
+	public final static int OUTPUT_UNDERFLOW = (1 << 2);
+	public final static int OUTPUT_OVERFLOW = (1 << 3);
+	public final static int PRIMING_OUTPUT = (1 << 4);
+
+	/**
+	 * Process one buffer of audio. The buffers are allocated once when the
+	 * stream is opened and passed to every call, with their position set to
+	 * 0 and their limit to the end of the numFrames frames. The samples are
+	 * interleaved, in the stream's sample format and native byte order.
+	 * 
+	 * @param input
+	 *            the input samples, null for an output only stream
+	 * @param output
+	 *            receives the output samples, null for an input only stream
+	 * @param numFrames
+	 *            the number of frames, the framesPerBuffer of the stream
+	 * @param statusFlags
+	 *            a combination of the bits above
+	 * @return RESULT_CONTINUE, RESULT_COMPLETE or RESULT_ABORT
+	 */
+	public int onProcess( ByteBuffer input, ByteBuffer output, int numFrames,
+			int statusFlags );
+}
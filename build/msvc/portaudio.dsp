@@ -101,10 +101,18 @@ SOURCE=..\..\src\common\pa_allocation.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_channelmatrix.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_converters.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_cpufeatures.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_cpuload.c
 # End Source File
 # Begin Source File
@@ -121,10 +129,26 @@ SOURCE=..\..\src\common\pa_front.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_headroom.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_levelmeter.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_process.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\src\common\pa_recorder.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_resampler.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\src\common\pa_ringbuffer.c
 # End Source File
 # Begin Source File
@@ -135,6 +159,26 @@ SOURCE=..\..\src\hostapi\skeleton\pa_hostapi_skeleton.c
 
 SOURCE=..\..\src\common\pa_stream.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_streamclock.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_streamstats.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_streamtap.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_timefilter.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\src\common\pa_x86_simd_converters.c
+# End Source File
 # End Group
 # Begin Group "hostapi"
 
@@ -0,0 +1,21 @@
+# - Try to find PipeWire
+# Once done this will define
+#  PIPEWIRE_FOUND - System has libpipewire
+#  PIPEWIRE_INCLUDE_DIRS - The libpipewire and spa include directories
+#  PIPEWIRE_LIBRARIES - The libraries needed to use libpipewire
+
+if (PIPEWIRE_LIBRARIES AND PIPEWIRE_INCLUDE_DIRS)
+
+	# in cache already
+	set(PIPEWIRE_FOUND TRUE)
+
+else (PIPEWIRE_LIBRARIES AND PIPEWIRE_INCLUDE_DIRS)
+
+	# PipeWire installs its headers in versioned directories, pkg-config is needed to find them.
+	# pw_stream_get_time_n() and pw_buffer.requested need 0.3.50.
+	find_package(PkgConfig QUIET)
+	if (PKG_CONFIG_FOUND)
+		pkg_search_module(PIPEWIRE QUIET libpipewire-0.3>=0.3.50)
+	endif (PKG_CONFIG_FOUND)
+
+endif (PIPEWIRE_LIBRARIES AND PIPEWIRE_INCLUDE_DIRS)
@@ -187,6 +187,11 @@ int main(void)
      */
     memset(table, 0, sizeof(table));
 
+    /* pick the converters Pa_Initialize would use */
+    PaUtil_InitializeConverterTable();
+    printf("Using %s converters\n",
+        PaUtil_GetConverterTableName(PaUtil_GetActiveConverterTable()));
+
     ADD_TAB_ENTRY(0,  Float32_To_Int32, float32, int32, 0, 0);
     ADD_TAB_ENTRY(1,  Float32_To_Int32_Dither, float32, int32, 1, 0);
     ADD_TAB_ENTRY(2,  Float32_To_Int32_Clip, float32, int32, 0, 1);
@@ -210,17 +215,17 @@ int main(void)
     ADD_TAB_ENTRY(16, Float32_To_UInt8, float32, uint8, 0, 0);
     ADD_TAB_ENTRY(17, Float32_To_UInt8_Dither, float32, uint8, 1, 0);
     ADD_TAB_ENTRY(18, Float32_To_UInt8_Clip, float32, uint8, 0, 1);
-    ADD_TAB_ENTRY(19, Float32_To_UInt8_DitherClip, float32, uint8, 1, 1);
+    ADD_TAB_ENTRY(19, Float32_To_UInt8_DitherClip, float32, uint8, 1, 1);*/
 
     ADD_TAB_ENTRY(20, Int32_To_Float32, int32, float32, 0, 0);
     ADD_TAB_ENTRY(21, Int32_To_Int24, int32, int24, 0, 0);
-    ADD_TAB_ENTRY(22, Int32_To_Int24_Dither, int32, int24, 1, 0);
-    ADD_TAB_ENTRY(23, Int32_To_Int16, int32, int16, 1, 0);
+    /*ADD_TAB_ENTRY(22, Int32_To_Int24_Dither, int32, int24, 1, 0);*/ /* IMPLEMENT ME */
+    ADD_TAB_ENTRY(23, Int32_To_Int16, int32, int16, 0, 0);
     ADD_TAB_ENTRY(24, Int32_To_Int16_Dither, int32, int16, 1, 0);
     ADD_TAB_ENTRY(25, Int32_To_Int8, int32, int8, 0, 0);
     ADD_TAB_ENTRY(26, Int32_To_Int8_Dither, int32, int8, 1, 0);
     ADD_TAB_ENTRY(27, Int32_To_UInt8, int32, uint8, 0, 0);
-    ADD_TAB_ENTRY(28, Int32_To_UInt8_Dither, int32, uint8, 1, 0);
+    /*ADD_TAB_ENTRY(28, Int32_To_UInt8_Dither, int32, uint8, 1, 0);*/ /* IMPLEMENT ME */
 
     ADD_TAB_ENTRY(29, Int24_To_Float32, int24, float32, 0, 0);
     ADD_TAB_ENTRY(30, Int24_To_Int32, int24, int32, 0, 0);
@@ -229,15 +234,15 @@ int main(void)
     ADD_TAB_ENTRY(33, Int24_To_Int8, int24, int8, 0, 0);
     ADD_TAB_ENTRY(34, Int24_To_Int8_Dither, int24, int8, 1, 0);
     ADD_TAB_ENTRY(35, Int24_To_UInt8, int24, uint8, 0, 0);
-    ADD_TAB_ENTRY(36, Int24_To_UInt8_Dither, int24, uint8, 1, 0);
+    /*ADD_TAB_ENTRY(36, Int24_To_UInt8_Dither, int24, uint8, 1, 0);*/ /* IMPLEMENT ME */
 
     ADD_TAB_ENTRY(37, Int16_To_Float32, int16, float32, 0, 0);
     ADD_TAB_ENTRY(38, Int16_To_Int32, int16, int32, 0, 0);
     ADD_TAB_ENTRY(39, Int16_To_Int24, int16, int24, 0, 0);
     ADD_TAB_ENTRY(40, Int16_To_Int8, int16, int8, 0, 0);
-    ADD_TAB_ENTRY(41, Int16_To_Int8_Dither, int16, int8, 1, 0);
+    /*ADD_TAB_ENTRY(41, Int16_To_Int8_Dither, int16, int8, 1, 0);*/ /* IMPLEMENT ME */
     ADD_TAB_ENTRY(42, Int16_To_UInt8, int16, uint8, 0, 0);
-    ADD_TAB_ENTRY(43, Int16_To_UInt8_Dither, int16, int8, 1, 0);
+    /*ADD_TAB_ENTRY(43, Int16_To_UInt8_Dither, int16, int8, 1, 0);*/ /* IMPLEMENT ME */
 
     ADD_TAB_ENTRY(44, Int8_To_Float32, int8, float32, 0, 0);
     ADD_TAB_ENTRY(45, Int8_To_Int32, int8, int32, 0, 0);
@@ -251,7 +256,7 @@ int main(void)
     ADD_TAB_ENTRY(52, UInt8_To_Int16, uint8, int16, 0, 0);
     ADD_TAB_ENTRY(53, UInt8_To_Int8, uint8, int8, 0, 0);
 
-    ADD_TAB_ENTRY(54, Copy_8_To_8, int8, int8, 0, 0);
+    /*ADD_TAB_ENTRY(54, Copy_8_To_8, int8, int8, 0, 0);
     ADD_TAB_ENTRY(55, Copy_16_To_16, int16, int16, 0, 0);
     ADD_TAB_ENTRY(56, Copy_24_To_24, int24, int24, 0, 0);
     ADD_TAB_ENTRY(57, Copy_32_To_32, int32, int32, 0, 0); */
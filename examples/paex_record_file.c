@@ -1,6 +1,6 @@
 /** @file paex_record_file.c
 	@ingroup examples_src
-	@brief Record input into a file, then playback recorded data from file (Windows only at the moment) 
+	@brief Record input into a WAV file with a PaUtilRecorder, then playback recorded data from file
 	@author Robert Bielik
 */
 /*
@@ -43,22 +43,19 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "portaudio.h"
 #include "pa_ringbuffer.h"
+#include "pa_recorder.h"
 #include "pa_util.h"
 
-#ifdef _WIN32
-#include <windows.h>
-#include <process.h>
-#endif
-
 static ring_buffer_size_t rbs_min(ring_buffer_size_t a, ring_buffer_size_t b)
 {
     return (a < b) ? a : b;
 }
 
 /* #define SAMPLE_RATE  (17932) // Test failure to open with this value. */
-#define FILE_NAME       "audio_data.raw"
+#define FILE_NAME       "audio_data.wav"
 #define SAMPLE_RATE  (44100)
 #define FRAMES_PER_BUFFER (512)
 #define NUM_SECONDS     (10)
@@ -66,6 +63,8 @@ static ring_buffer_size_t rbs_min(ring_buffer_size_t a, ring_buffer_size_t b)
 #define NUM_WRITES_PER_BUFFER   (4)
 /* #define DITHER_FLAG     (paDitherOff) */
 #define DITHER_FLAG     (0) /**/
+/* Seconds of audio the recorder buffers while the disk is busy. */
+#define RECORDER_SECONDS (2.0)
 
 
 /* Select sample format. */
@@ -93,62 +92,19 @@ typedef unsigned char SAMPLE;
 
 typedef struct
 {
-    unsigned            frameIndex;
-    int                 threadSyncFlag;
+    volatile unsigned   frameIndex;
+    volatile int        threadPrimed;
+    volatile int        threadSyncFlag;
     SAMPLE             *ringBufferData;
     PaUtilRingBuffer    ringBuffer;
+    PaUtilRecorder     *recorder;
     FILE               *file;
-    void               *threadHandle;
 }
 paTestData;
 
-/* This routine is run in a separate thread to write data from the ring buffer into a file (during Recording) */
-static int threadFunctionWriteToRawFile(void* ptr)
-{
-    paTestData* pData = (paTestData*)ptr;
-
-    /* Mark thread started */
-    pData->threadSyncFlag = 0;
-
-    while (1)
-    {
-        ring_buffer_size_t elementsInBuffer = PaUtil_GetRingBufferReadAvailable(&pData->ringBuffer);
-        if ( (elementsInBuffer >= pData->ringBuffer.bufferSize / NUM_WRITES_PER_BUFFER) ||
-             pData->threadSyncFlag )
-        {
-            void* ptr[2] = {0};
-            ring_buffer_size_t sizes[2] = {0};
-
-            /* By using PaUtil_GetRingBufferReadRegions, we can read directly from the ring buffer */
-            ring_buffer_size_t elementsRead = PaUtil_GetRingBufferReadRegions(&pData->ringBuffer, elementsInBuffer, ptr + 0, sizes + 0, ptr + 1, sizes + 1);
-            if (elementsRead > 0)
-            {
-                int i;
-                for (i = 0; i < 2 && ptr[i] != NULL; ++i)
-                {
-                    fwrite(ptr[i], pData->ringBuffer.elementSizeBytes, sizes[i], pData->file);
-                }
-                PaUtil_AdvanceRingBufferReadIndex(&pData->ringBuffer, elementsRead);
-            }
-
-            if (pData->threadSyncFlag)
-            {
-                break;
-            }
-        }
-
-        /* Sleep a little while... */
-        Pa_Sleep(20);
-    }
-
-    pData->threadSyncFlag = 0;
-
-    return 0;
-}
-
 /* This routine is run in a separate thread to read data from file into the ring buffer (during Playback). When the file
    has reached EOF, a flag is set so that the play PA callback can return paComplete */
-static int threadFunctionReadFromRawFile(void* ptr)
+static void threadFunctionReadFromFile(void* ptr)
 {
     paTestData* pData = (paTestData*)ptr;
 
@@ -173,14 +129,18 @@ static int threadFunctionReadFromRawFile(void* ptr)
                     itemsReadFromFile += (ring_buffer_size_t)fread(ptr[i], pData->ringBuffer.elementSizeBytes, sizes[i], pData->file);
                 }
                 PaUtil_AdvanceRingBufferWriteIndex(&pData->ringBuffer, itemsReadFromFile);
-
-                /* Mark thread started here, that way we "prime" the ring buffer before playback */
-                pData->threadSyncFlag = 0;
             }
             else
             {
                 /* No more data to read */
                 pData->threadSyncFlag = 1;
+            }
+
+            /* Mark thread started here, that way we "prime" the ring buffer before playback */
+            pData->threadPrimed = 1;
+
+            if (pData->threadSyncFlag)
+            {
                 break;
             }
         }
@@ -188,57 +148,38 @@ static int threadFunctionReadFromRawFile(void* ptr)
         /* Sleep a little while... */
         Pa_Sleep(20);
     }
-
-    return 0;
 }
 
-typedef int (*ThreadFunctionType)(void*);
-
-/* Start up a new thread in the given function, at the moment only Windows, but should be very easy to extend
-   to posix type OSs (Linux/Mac) */
-static PaError startThread( paTestData* pData, ThreadFunctionType fn )
+/* Position file at the samples of the WAV file's data chunk. The recorder's
+   files may be RF64, whose data size field is a placeholder, so the samples
+   are simply read up to the end of the file. */
+static int seekToWavData(FILE *file)
 {
-#ifdef _WIN32
-    typedef unsigned (__stdcall* WinThreadFunctionType)(void*);
-    pData->threadHandle = (void*)_beginthreadex(NULL, 0, (WinThreadFunctionType)fn, pData, CREATE_SUSPENDED, NULL);
-    if (pData->threadHandle == NULL) return paUnanticipatedHostError;
-
-    /* Set file thread to a little higher prio than normal */
-    SetThreadPriority(pData->threadHandle, THREAD_PRIORITY_ABOVE_NORMAL);
-
-    /* Start it up */
-    pData->threadSyncFlag = 1;
-    ResumeThread(pData->threadHandle);
-
-#endif
+    unsigned char header[12];
 
-    /* Wait for thread to startup */
-    while (pData->threadSyncFlag) {
-        Pa_Sleep(10);
+    if (fread(header, 1, 12, file) != 12 ||
+        (memcmp(header, "RIFF", 4) != 0 && memcmp(header, "RF64", 4) != 0) ||
+        memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        return 0;
     }
 
-    return paNoError;
-}
+    while (fread(header, 1, 8, file) == 8)
+    {
+        long size = (long)header[4] | ((long)header[5] << 8) | ((long)header[6] << 16) | ((long)header[7] << 24);
 
-static int stopThread( paTestData* pData )
-{
-    pData->threadSyncFlag = 1;
-    /* Wait for thread to stop */
-    while (pData->threadSyncFlag) {
-        Pa_Sleep(10);
+        if (memcmp(header, "data", 4) == 0)
+            return 1;
+        if (fseek(file, size + (size & 1), SEEK_CUR) != 0)
+            return 0;
     }
-#ifdef _WIN32
-    CloseHandle(pData->threadHandle);
-    pData->threadHandle = 0;
-#endif
-
-    return paNoError;
+    return 0;
 }
 
-
 /* This routine will be called by the PortAudio engine when audio is needed.
 ** It may be called at interrupt level on some machines so don't do anything
 ** that could mess up the system like calling malloc() or free().
+** The recorder only copies the frames, its own thread writes them to disk.
 */
 static int recordCallback( const void *inputBuffer, void *outputBuffer,
                            unsigned long framesPerBuffer,
@@ -247,16 +188,12 @@ static int recordCallback( const void *inputBuffer, void *outputBuffer,
                            void *userData )
 {
     paTestData *data = (paTestData*)userData;
-    ring_buffer_size_t elementsWriteable = PaUtil_GetRingBufferWriteAvailable(&data->ringBuffer);
-    ring_buffer_size_t elementsToWrite = rbs_min(elementsWriteable, (ring_buffer_size_t)(framesPerBuffer * NUM_CHANNELS));
-    const SAMPLE *rptr = (const SAMPLE*)inputBuffer;
 
     (void) outputBuffer; /* Prevent unused variable warnings. */
     (void) timeInfo;
     (void) statusFlags;
-    (void) userData;
 
-    data->frameIndex += PaUtil_WriteRingBuffer(&data->ringBuffer, rptr, elementsToWrite);
+    data->frameIndex += PaUtil_WriteRecorder(data->recorder, inputBuffer, framesPerBuffer);
 
     return paContinue;
 }
@@ -283,7 +220,7 @@ static int playCallback( const void *inputBuffer, void *outputBuffer,
 
     data->frameIndex += PaUtil_ReadRingBuffer(&data->ringBuffer, wptr, elementsToRead);
 
-    return data->threadSyncFlag ? paComplete : paContinue;
+    return (data->threadSyncFlag && elementsToPlay == 0) ? paComplete : paContinue;
 }
 
 static unsigned NextPowerOf2(unsigned val)
@@ -336,7 +273,7 @@ int main(void)
         fprintf(stderr,"Error: No default input device.\n");
         goto done;
     }
-    inputParameters.channelCount = 2;                    /* stereo input */
+    inputParameters.channelCount = NUM_CHANNELS;
     inputParameters.sampleFormat = PA_SAMPLE_TYPE;
     inputParameters.suggestedLatency = Pa_GetDeviceInfo( inputParameters.device )->defaultLowInputLatency;
     inputParameters.hostApiSpecificStreamInfo = NULL;
@@ -353,12 +290,9 @@ int main(void)
               &data );
     if( err != paNoError ) goto done;
 
-    /* Open the raw audio 'cache' file... */
-    data.file = fopen(FILE_NAME, "wb");
-    if (data.file == 0) goto done;
-
-    /* Start the file writing thread */
-    err = startThread(&data, threadFunctionWriteToRawFile);
+    /* Create the WAV file and start the recorder's writer thread */
+    err = PaUtil_OpenRecorder(&data.recorder, FILE_NAME, NUM_CHANNELS, PA_SAMPLE_TYPE, SAMPLE_RATE,
+                              RECORDER_SECONDS, paUtilRecorderDirectIO);
     if( err != paNoError ) goto done;
 
     err = Pa_StartStream( stream );
@@ -378,14 +312,12 @@ int main(void)
     err = Pa_CloseStream( stream );
     if( err != paNoError ) goto done;
 
-    /* Stop the thread */
-    err = stopThread(&data);
+    /* Write what is still buffered and complete the file */
+    printf("dropped frames = %lu\n", PaUtil_GetRecorderDroppedFrames(data.recorder)); fflush(stdout);
+    err = PaUtil_CloseRecorder(data.recorder);
+    data.recorder = NULL;
     if( err != paNoError ) goto done;
 
-    /* Close file */
-    fclose(data.file);
-    data.file = 0;
-
     /* Playback recorded data.  -------------------------------------------- */
     data.frameIndex = 0;
 
@@ -394,7 +326,7 @@ int main(void)
         fprintf(stderr,"Error: No default output device.\n");
         goto done;
     }
-    outputParameters.channelCount = 2;                     /* stereo output */
+    outputParameters.channelCount = NUM_CHANNELS;
     outputParameters.sampleFormat =  PA_SAMPLE_TYPE;
     outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultLowOutputLatency;
     outputParameters.hostApiSpecificStreamInfo = NULL;
@@ -415,11 +347,14 @@ int main(void)
     {
         /* Open file again for reading */
         data.file = fopen(FILE_NAME, "rb");
-        if (data.file != 0)
+        if (data.file != 0 && seekToWavData(data.file))
         {
-            /* Start the file reading thread */
-            err = startThread(&data, threadFunctionReadFromRawFile);
+            /* Start the file reading thread and wait until it has primed the ring buffer */
+            err = PaUtil_StartDetachedThread(threadFunctionReadFromFile, &data);
             if( err != paNoError ) goto done;
+            while (!data.threadPrimed) {
+                Pa_Sleep(10);
+            }
 
             err = Pa_StartStream( stream );
             if( err != paNoError ) goto done;
@@ -437,13 +372,16 @@ int main(void)
         err = Pa_CloseStream( stream );
         if( err != paNoError ) goto done;
 
-        fclose(data.file);
+        if (data.file != 0)
+            fclose(data.file);
         
         printf("Done.\n"); fflush(stdout);
     }
 
 done:
     Pa_Terminate();
+    if( data.recorder )
+        PaUtil_CloseRecorder( data.recorder );
     if( data.ringBufferData )       /* Sure it is NULL or valid. */
         PaUtil_FreeMemory( data.ringBufferData );
     if( err != paNoError )
@@ -455,4 +393,3 @@ done:
     }
     return err;
 }
-
@@ -0,0 +1,89 @@
+#ifndef PA_AAUDIO_H
+#define PA_AAUDIO_H
+
+/*
+ * $Id:
+ * PortAudio Portable Real-Time Audio Library
+ * Android AAudio-specific extensions
+ *
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ *  @ingroup public_header
+ *  @brief Android AAudio-specific PortAudio API extension header file.
+ */
+
+#include <stdint.h>
+
+#include "portaudio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Open the stream in AAudio's shared mode.
+ *
+ * By default a stream asks for exclusive use of the device, which gets it the MMAP path with the least latency where
+ * the device has one, and shuts out other apps while it's open. AAudio falls back to shared mode where it's not
+ * available, PaAAudio_IsExclusive() tells which one a stream got.
+ * @see PaAAudio_IsExclusive
+ */
+#define paAAudioSharedMode ((PaStreamFlags)0x00010000)
+
+/** A struct providing AAudio-specific information, passed as the hostApiSpecificStreamInfo of PaStreamParameters.
+ */
+typedef struct PaAAudioStreamInfo
+{
+    unsigned long size;             /**< sizeof(PaAAudioStreamInfo) */
+    PaHostApiTypeId hostApiType;    /**< paInDevelopment */
+    unsigned long version;          /**< 1 */
+
+    /** The id of the device to open the stream on, as the Java API's AudioDeviceInfo.getId() returns it, or 0 to let
+     * Android route the stream. AAudio doesn't enumerate devices itself, so PortAudio only lists a default device. */
+    int32_t deviceId;
+}
+PaAAudioStreamInfo;
+
+/** Tell whether the AAudio streams of a stream were opened in exclusive mode.
+ *
+ * @return 1 if every direction of the stream is exclusive, 0 if not, or a negative PaError if the stream isn't an
+ * AAudio stream.
+ */
+PaError PaAAudio_IsExclusive( PaStream *stream );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
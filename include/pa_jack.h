@@ -50,6 +50,46 @@
 extern "C" {
 #endif
 
+/** Host API specific callback status flag: the JACK server is freewheeling.
+ *
+ * In freewheel mode, for instance while a session is bounced offline, JACK runs its process cycles back to back
+ * instead of at the pace of the sound card, and the stream callback is called as fast as the streams are processed.
+ * The times of PaStreamCallbackTimeInfo and Pa_GetStreamTime() then advance with the frames processed rather than
+ * with the wall clock, and the CPU load of the stream is the share of real time processing takes.
+ */
+#define paJackFreewheeling ((PaStreamCallbackFlags)0x00010000)
+
+/** Platform specific flag of PaJackStreamInfo: run the stream on a JACK client of its own.
+ *
+ * By default all streams share the JACK client PortAudio opens in Pa_Initialize, whose process callback runs
+ * them one after the other. A stream with a dedicated client is processed by that client's callback instead,
+ * which JACK2 can run in parallel with those of other clients on another core, so that heavy streams of the
+ * same process don't hold up each other. The client is opened by Pa_OpenStream() and closed by
+ * Pa_CloseStream().
+ */
+#define paJackDedicatedClient ((unsigned long)0x01)
+
+/** The host API specific stream info of JACK streams, initialize it with PaJack_InitializeStreamInfo(). If
+ * both directions of a stream give one, their flags are combined and the clientName of the output is used.
+ */
+typedef struct PaJackStreamInfo
+{
+    unsigned long size;             /**< sizeof(PaJackStreamInfo) */
+    PaHostApiTypeId hostApiType;    /**< paJACK */
+    unsigned long version;          /**< 1 */
+
+    unsigned long flags;            /**< 0 or paJackDedicatedClient */
+
+    /** The name requested for a dedicated client, NULL for the name of PortAudio's client, to which JACK
+     * appends a suffix. Must remain valid until Pa_OpenStream() returns.
+     */
+    const char *clientName;
+}
+PaJackStreamInfo;
+
+/** Initialize host API specific structure, call this before setting relevant attributes. */
+void PaJack_InitializeStreamInfo( PaJackStreamInfo *info );
+
 /** Set the JACK client name.
  *
  * During Pa_Initialize, When PA JACK connects as a client of the JACK server, it requests a certain
@@ -70,6 +110,28 @@ PaError PaJack_SetClientName( const char* name );
  */
 PaError PaJack_GetClientName(const char** clientName);
 
+/** Set the low watermark of a blocking stream.
+ *
+ * A thread waiting in Pa_ReadStream() or Pa_WriteStream() is woken up once this many frames can be read or
+ * written, or all that remain of the call if there are fewer, instead of at every JACK cycle that brings any. A
+ * larger watermark means fewer wakeups for clients moving large blocks, such as transcoders, but less audio queued
+ * for output when a writer resumes. It is limited to the size of the stream's buffer. 0, the default, wakes up the
+ * thread at every JACK cycle.
+ *
+ * Waiting threads sleep on a semaphore the JACK callback posts only once their watermark has been reached.
+ *
+ * @return paCanNotReadFromACallbackStream if the stream is not a blocking stream.
+ */
+PaError PaJack_SetLowWatermark( PaStream *stream, unsigned long frames );
+
+/** Read up to frames frames from a blocking stream without waiting.
+ *
+ * Like Pa_ReadStream() but only copies what is available.
+ *
+ * @return The number of frames read, which may be 0, or a negative error code.
+ */
+signed long PaJack_ReadStreamAvailable( PaStream *stream, void *buffer, unsigned long frames );
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,6 +50,20 @@
 extern "C" {
 #endif
 
+/** One of the ALSA devices an aggregate stream is made of, see PaAlsaStreamInfo::aggregateDevices. */
+typedef struct PaAlsaAggregateDevice
+{
+    const char *deviceString; /**< The ALSA name of the device, e.g. "hw:2" */
+    int channelCount; /**< The number of channels the device takes part with */
+}
+PaAlsaAggregateDevice;
+
+/** Host API specific stream info, initialize it with PaAlsa_InitializeStreamInfo().
+ *
+ * Version 1 only had deviceString, which named the ALSA device and required the device of the
+ * PaStreamParameters to be paUseHostApiSpecificDeviceSpecification. Since version 2 deviceString
+ * may be NULL, the device index of the PaStreamParameters is then used.
+ */
 typedef struct PaAlsaStreamInfo
 {
     unsigned long size;
@@ -57,22 +71,147 @@ typedef struct PaAlsaStreamInfo
     unsigned long version;
 
     const char *deviceString;
+
+    /** NULL or the routing between the stream's channels and the channelMatrix->deviceChannelCount
+     * channels the device is opened with. Only supported for callback streams which don't convert
+     * the sample rate. Must remain valid until Pa_OpenStream() returns.
+     */
+    const PaChannelMatrix *channelMatrix;
+
+    /** NULL or the indices of the CPUs the callback thread may run on, e.g. cores isolated from the
+     * scheduler for audio. Only used by callback streams. If both directions of a stream give CPUs, those
+     * of the output are used. On systems with several memory nodes the buffers of the callback are moved to
+     * the nodes of these CPUs. Must remain valid until Pa_OpenStream() returns.
+     */
+    const int *callbackCpus;
+    int callbackCpuCount;
+
+    /** The number of threads, the callback thread included, converting the samples of a callback stream with
+     * many channels, each taking a range of the channels; extra threads are started with the stream and
+     * scheduled and pinned like the callback thread. 0 or 1 converts on the callback thread only. If both
+     * directions of a stream give a number, the larger one is used. Since version 4.
+     */
+    int conversionThreadCount;
+
+    /** NULL or the ALSA device the stream switches to when its own device goes away, e.g. a USB interface that is
+     * unplugged. The fallback is opened with the access, sample format, channels, sample rate and period size of the
+     * device it replaces and the stream is restarted on it without interrupting the callback, the gap being reported
+     * as an underflow or overflow; Pa_GetStreamInfo() keeps reporting the latencies of the original device. If the
+     * fallback can't be configured identically the stream fails as without one. A stream fails over once per
+     * direction. Must remain valid until Pa_OpenStream() returns. Since version 5.
+     */
+    const char *fallbackDeviceString;
+
+    /** NULL or the ALSA devices opened together as the device of this direction, e.g. several 8-channel USB
+     * interfaces making up one 32-channel device. The stream's channels are those of the devices in order, the first
+     * channelCount of aggregateDevices[0] followed by those of aggregateDevices[1] and so on, and they must add up to
+     * the channels the stream is opened with (channelMatrix->deviceChannelCount if there is a channel matrix). The
+     * devices are configured identically and started together, linked by the driver where it can, and the stream
+     * waits for and transfers them as one device, so they should run from a common clock. Requires the device of the
+     * PaStreamParameters to be paUseHostApiSpecificDeviceSpecification and deviceString to be NULL. The array must
+     * remain valid until Pa_OpenStream() returns. Since version 6.
+     */
+    const PaAlsaAggregateDevice *aggregateDevices;
+    int aggregateDeviceCount;
+
+    /** NULL or, for each of the channelCount channels of an input stream, the device channel it is, e.g. { 12, 13 }
+     * to record a pair of a 64-channel interface. The device is opened with the channels up to the highest one
+     * selected and only the selected channels are converted, the others are skipped. Not supported for output or
+     * together with a channel matrix. The array must remain valid until Pa_OpenStream() returns. Since version 7.
+     */
+    const int *channelSelectors;
 }
 PaAlsaStreamInfo;
 
+/** Platform specific stream flag: run the stream callback directly on the ALSA buffers.
+ *
+ * When the device takes the user sample format and channel layout unchanged and no block adaption is needed
+ * (framesPerBuffer is paFramesPerBufferUnspecified or equals the host buffer size), the callback is handed
+ * the mmap (or read/write) buffers of the device instead of the buffers of the buffer processor, saving a copy
+ * in each direction. Clipping and dithering do not apply in this case. Streams that don't qualify, and
+ * blocking streams, ignore the flag.
+ */
+#define paAlsaZeroCopy ((PaStreamFlags)0x00010000)
+
+/** Platform specific stream flag: service the stream from a callback thread shared with other streams.
+ *
+ * Started callback streams with this flag and the same period (frames per ALSA period and device sample rate)
+ * are serviced by one thread, which waits for all their devices in a single poll() and runs their callbacks in
+ * turn, instead of each stream waking up a thread of its own every period. The thread is created by the first
+ * stream to start, with that stream's real-time scheduling and callback CPUs, and ends when the last one stops.
+ * The callbacks of the group must together finish well within a period. Blocking streams and streams with
+ * paCompensateClockDrift ignore the flag.
+ */
+#define paAlsaSharedCallbackThread ((PaStreamFlags)0x00020000)
+
+/** Platform specific stream flag: wake the callback thread on a timer instead of on period interrupts.
+ *
+ * The devices are opened with period wakeups disabled where the driver allows it, and a hardware buffer as large as
+ * they take, up to 2 seconds. The callback thread sleeps on a high-resolution timer until, according to the
+ * status of the devices, a period has been captured or fits into the output without exceeding the suggested
+ * latency, so the buffer is only kept filled to the latency asked for. Large buffers cope with long stalls of the
+ * thread, the latency is that of a small one, and the thread doesn't wake up more often than once per period.
+ * Ignored by blocking streams, streams sharing a callback thread and streams with paCompensateClockDrift.
+ */
+#define paAlsaTimerScheduling ((PaStreamFlags)0x00040000)
+
+/** Platform specific stream flag: open the hw: device behind a plughw: device where the hw: device will do.
+ *
+ * A plughw: device (PA_ALSA_PLUGHW, or a deviceString of PaAlsaStreamInfo) converts the sample format in a buffer of
+ * the plug plugin, which is then copied to the hardware. With this flag the stream is opened on the hw: device
+ * instead if that takes the channels and sample rate of the stream with mmap access, PortAudio's converters
+ * converting the samples directly in the device's buffer. Otherwise the plughw: device is used.
+ */
+#define paAlsaPreferHw ((PaStreamFlags)0x00080000)
+
+/** Platform specific stream flag: tune the output latency of a callback stream while it runs.
+ *
+ * The stream is timer scheduled as with paAlsaTimerScheduling, on the smallest periods the devices take, and keeps
+ * its output filled with two periods to start with. Every underrun raises the fill level by a period, without
+ * reconfiguring the device, up to the suggested latency of the output, so that the stream converges on the lowest
+ * latency it runs on without underruns on the card. PaStreamInfo::outputLatency follows the fill level. Ignored
+ * where paAlsaTimerScheduling is, and by streams without output.
+ */
+#define paAlsaAutoLatency ((PaStreamFlags)0x00100000)
+
+/** Platform specific stream flag: wake the callback thread of an output stream as seldom as possible, to save power.
+ *
+ * The stream is timer scheduled as with paAlsaTimerScheduling, its output being kept filled with the suggested
+ * latency. Instead of topping the buffer up every period, the callback thread sleeps until the output has drained to
+ * about 100 ms and then refills it with as many callbacks as it takes, so that with a suggested latency of some
+ * seconds the thread, and with it the CPU, wakes up every few seconds. Ignored where paAlsaTimerScheduling is, and
+ * by streams with input.
+ */
+#define paAlsaLowPowerOutput ((PaStreamFlags)0x00200000)
+
 /** Initialize host API specific structure, call this before setting relevant attributes. */
 void PaAlsa_InitializeStreamInfo( PaAlsaStreamInfo *info );
 
 /** Instruct whether to enable real-time priority when starting the audio thread.
  *
  * If this is turned on by the stream is started, the audio callback thread will be created
- * with the FIFO scheduling policy, which is suitable for realtime operation.
+ * with a scheduling policy suitable for realtime operation: SCHED_DEADLINE, reserving half of
+ * each ALSA period, if the kernel admits it, else the FIFO scheduling policy. Processes without
+ * the privilege for either ask rtkit if PortAudio was built with PA_USE_RTKIT.
  **/
 void PaAlsa_EnableRealtimeScheduling( PaStream *s, int enable );
 
-#if 0
+/** Instruct whether to protect the system from a runaway callback thread when starting the audio thread.
+ *
+ * If this is turned on before the stream is started, a callback thread scheduled with SCHED_FIFO or SCHED_RR is
+ * demoted to the default scheduling policy once it runs for 100 ms without blocking, e.g. when the callback is stuck
+ * in a loop. The kernel does the watching, through the RLIMIT_RTTIME soft limit of the process and the SIGXCPU it
+ * sends, so there are no threads or wakeups per stream. The thread stays demoted until the stream is restarted.
+ * Threads under SCHED_DEADLINE don't need this, the kernel throttles them to their runtime already.
+ **/
 void PaAlsa_EnableWatchdog( PaStream *s, int enable );
-#endif
+
+/** Get the CPU the stream's callback thread last ran on.
+ *
+ * @param cpu Receives the index of the CPU, or -1 if the callback thread isn't running or the system doesn't
+ * tell.
+ */
+PaError PaAlsa_GetStreamCallbackCpu( PaStream *s, int *cpu );
 
 /** Get the ALSA-lib card index of this stream's input device. */
 PaError PaAlsa_GetStreamInputCard( PaStream *s, int *card );
@@ -80,6 +219,23 @@ PaError PaAlsa_GetStreamInputCard( PaStream *s, int *card );
 /** Get the ALSA-lib card index of this stream's output device. */
 PaError PaAlsa_GetStreamOutputCard( PaStream *s, int *card );
 
+struct pollfd;
+
+/** Get the file descriptors to poll for when frames can be read from or written to a blocking stream, so
+ * that an event loop can serve many streams with Pa_ReadStreamTimeout() and Pa_WriteStreamTimeout() and a
+ * timeout of 0 instead of a thread each.
+ *
+ * Treat any event on them as a hint only: ALSA plugins may signal the descriptors early, a read or write
+ * then transfers fewer frames or none. The descriptors change when the stream fails over to its fallback
+ * device, get them again after handling their events.
+ *
+ * @param output Nonzero for the descriptors of the output device, 0 for those of the input device.
+ * @param pfds NULL to query the number of descriptors, else an array of *count entries which receives
+ * them, with the events to poll for set.
+ * @param count The size of pfds, receives the number of descriptors.
+ */
+PaError PaAlsa_GetStreamPollDescriptors( PaStream *s, int output, struct pollfd *pfds, int *count );
+
 /** Set the number of periods (buffer fragments) to configure devices with.
  *
  * By default the number of periods is 4, this is the lowest number of periods that works well on
@@ -93,6 +249,18 @@ PaError PaAlsa_SetNumPeriods( int numPeriods );
  */
 PaError PaAlsa_SetRetriesBusy( int retries );
 
+/** Keep the capabilities of the devices in a file, so that initializing PortAudio again doesn't have to open and
+ * probe every device.
+ *
+ * The file is rewritten whenever devices had to be probed, and a stale one is discarded when ALSA, its configuration
+ * files or the cards present change, or a device listed in it fails to open. Takes effect on the next Pa_Initialize(),
+ * the cache is off by default. The environment variable PA_ALSA_DEVICE_CACHE overrides this setting: 0 turns the
+ * cache off, 1 uses the default location, any other value is the path of the file.
+ * @param pathName The file, an empty string for $XDG_CACHE_HOME/portaudio/alsa-devices (~/.cache if XDG_CACHE_HOME
+ *                 isn't set), or NULL to turn the cache off. Must remain valid until Pa_Initialize() returns.
+ */
+void PaAlsa_SetDeviceCachePath( const char *pathName );
+
 /** Set the path and name of ALSA library file if PortAudio is configured to load it dynamically (see
  *  PA_ALSA_DYNAMIC). This setting will overwrite the default name set by PA_ALSA_PATHNAME define.
  * @param pathName Full path with filename. Only filename can be used, but dlopen() will lookup default
@@ -68,6 +68,7 @@ typedef struct
     unsigned long flags;          /** flags to modify behaviour */
     SInt32 const * channelMap;    /** Channel map for HAL channel mapping , if not needed, use NULL;*/ 
     unsigned long channelMapSize; /** Channel map size for HAL channel mapping , if not needed, use 0;*/ 
+    Float32 ioCycleUsage;         /** IO cycle usage for paMacCoreSetIOCycleUsage. Since version 2 */
 } PaMacCoreStreamInfo;
 
 /**
@@ -77,7 +78,8 @@ typedef struct
 
 /** Use this function to initialize a paMacCoreStreamInfo struct
  * using the requested flags. Note that channel mapping is turned
- * off after a call to this function.
+ * off after a call to this function, and ioCycleUsage is set to 1,
+ * the HAL's default.
  * @param data The datastructure to initialize
  * @param flags The flags to initialize the datastructure with.
 */
@@ -108,6 +110,41 @@ AudioDeviceID PaMacCore_GetStreamInputDevice( PaStream* s );
  */
 AudioDeviceID PaMacCore_GetStreamOutputDevice( PaStream* s );
 
+/**
+ * Retrieve the audio workgroup (os_workgroup_t) of the IO thread of an open
+ * stream's device. Worker threads that do part of the real-time processing
+ * for the stream callback should join it so that the scheduler treats them
+ * as part of the same deadline, e.g. keeps them off efficiency cores.
+ * The callback thread itself is already a member.
+ *
+ * @param s The stream to query.
+ * @param workgroup Receives the os_workgroup_t, retained on behalf of the
+ *        caller who must release it with os_release(). Receives NULL if
+ *        workgroups are not available (before macOS 11).
+ *
+ * @see kAudioDevicePropertyIOThreadOSWorkgroup in the CoreAudio SDK.
+ */
+PaError PaMacCore_GetStreamWorkgroup( PaStream* s, void **workgroup );
+
+/**
+ * Join the calling thread to the audio workgroup of an open stream's device.
+ * This is a convenience wrapper around PaMacCore_GetStreamWorkgroup() and
+ * os_workgroup_join().
+ *
+ * @param s The stream whose workgroup to join.
+ * @param membership Receives a handle that must be passed to
+ *        PaMacCore_LeaveStreamWorkgroup() from the same thread. Receives NULL
+ *        if there is no workgroup to join, which is not an error.
+ */
+PaError PaMacCore_JoinStreamWorkgroup( PaStream* s, void **membership );
+
+/**
+ * Leave a workgroup joined with PaMacCore_JoinStreamWorkgroup(). Must be
+ * called on the thread that joined, before the stream is closed. NULL is
+ * accepted and ignored.
+ */
+void PaMacCore_LeaveStreamWorkgroup( void *membership );
+
 /**
  * Returns a statically allocated string with the device's name
  * for the given channel. NULL will be returned on failure.
@@ -158,6 +195,48 @@ PaError PaMacCore_GetBufferSizeRange( PaDeviceIndex device,
  * are supported by the device. */
 #define paMacCoreFailIfConversionRequired (0x02)
 
+/** For full duplex streams on two different devices running at the same
+ * nominal sample rate, have CoreAudio build a private aggregate device
+ * from the pair so input and output are delivered in a single IO callback.
+ * This avoids the intermediate ring buffer and sample rate converter that
+ * are otherwise used to bridge the two device clocks. The aggregate is
+ * only used when the first input and output channels can be made to
+ * belong to the requested devices, i.e. when one of the two devices has
+ * no channels in the other direction; otherwise the flag is ignored. The
+ * flag may be set on either the input or the output stream info. */
+#define paMacCoreUseAggregateDevice (0x04)
+
+/** Drive the stream from an IOProc registered directly on the HAL device
+ * with AudioDeviceCreateIOProcID() instead of going through an AUHAL
+ * AudioUnit. This removes the AudioUnit render overhead and its extra
+ * buffering, which matters most at very small buffer sizes. It is only
+ * used when the device delivers packed, interleaved native Float32 and
+ * runs at the requested sample rate (set it with
+ * paMacCoreChangeDeviceParameters if needed), and for full duplex only on
+ * a single device or together with paMacCoreUseAggregateDevice. Channel
+ * maps are not supported in this mode. Otherwise the flag is ignored and
+ * the AUHAL is used. The flag may be set on either
+ * the input or the output stream info. */
+#define paMacCoreUseHALIOProc (0x08)
+
+/** Take hog mode on the stream's devices while it is open, so that no
+ * other process can use them and the HAL doesn't mix their output. The
+ * stream fails to open with paDeviceUnavailable if another process
+ * already hogs one of them. Hog mode is handed back when the stream is
+ * closed, unless this process held it before. Meant for dedicated
+ * playback and recording machines. */
+#define paMacCoreHogDevice (0x10)
+
+/** Set the kAudioDevicePropertyIOCycleUsage of the stream's devices to the
+ * ioCycleUsage of the stream info while it is open, restoring the previous
+ * value when it is closed. This is the part of each IO cycle, from 0 to 1,
+ * which the HAL leaves to this process' IO: a lower value has the HAL
+ * start the callback closer to the device's deadline, which lowers the
+ * latency but leaves the callback less time to finish in. Requires a
+ * stream info of version 2 or later, as set up by
+ * PaMacCore_SetupStreamInfo(). */
+#define paMacCoreSetIOCycleUsage (0x20)
+
 /** These flags set the SR conversion quality, if required. The wierd ordering
  * allows Maximum Quality to be the default.*/
 #define paMacCoreConversionQualityMin    (0x0100)
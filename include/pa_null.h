@@ -0,0 +1,96 @@
+#ifndef PA_NULL_H
+#define PA_NULL_H
+
+/*
+ * $Id:
+ * PortAudio Portable Real-Time Audio Library
+ * Null host API specific extensions
+ *
+ * Copyright (c) 1999-2000 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ *  @ingroup public_header
+ *  @brief Null host API specific PortAudio API extension header file.
+ */
+
+#include "portaudio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Flag of PaNullStreamInfo: render the stream offline.
+ *
+ * An offline stream isn't driven by the clock, its callback is called back to back as fast as it returns, so that
+ * a file is rendered in as little time as the processing takes. Input is read from the buffer or file of the input's
+ * PaNullStreamInfo, output is written to that of the output's; a direction without either reads silence or has its
+ * output discarded. The data is interleaved in the stream's sample format with its channel count, and files are raw
+ * samples in native byte order. Both are read and written from their beginning each time the stream is started.
+ *
+ * The stream finishes as if its callback had returned paComplete once its input has been read to the end or its
+ * output buffer is full. The PaStreamCallbackTimeInfo times and Pa_GetStreamTime() follow a timeline starting at 0
+ * with the stream, advancing by the frames rendered rather than with the system clock, and without the fake device
+ * latency of PA_NULL_LATENCY_MSEC. Offline streams don't use the loopback device. If either direction of a stream
+ * asks for offline rendering, the stream is rendered offline.
+ */
+#define paNullOffline ((unsigned long)0x01)
+
+/** The host API specific stream info of the null host API, initialize it with PaNull_InitializeStreamInfo(). */
+typedef struct PaNullStreamInfo
+{
+    unsigned long size;             /**< sizeof(PaNullStreamInfo) */
+    PaHostApiTypeId hostApiType;    /**< paInDevelopment */
+    unsigned long version;          /**< 1 */
+
+    unsigned long flags;            /**< 0 or paNullOffline */
+
+    /** NULL or the frames an offline stream reads (input) or writes (output), bufferFrames of them. Must remain
+     * valid until the stream is closed. */
+    void *buffer;
+    unsigned long bufferFrames;
+
+    /** NULL or the file an offline stream reads (input) or writes (output) in place of a buffer, opened by
+     * Pa_OpenStream() and closed by Pa_CloseStream(). An output file is truncated. */
+    const char *fileName;
+}
+PaNullStreamInfo;
+
+/** Initialize host API specific structure, call this before setting relevant attributes. */
+void PaNull_InitializeStreamInfo( PaNullStreamInfo *info );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
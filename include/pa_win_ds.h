@@ -59,7 +59,7 @@ extern "C"
 typedef struct PaWinDirectSoundStreamInfo{
     unsigned long size;             /**< sizeof(PaWinDirectSoundStreamInfo) */
     PaHostApiTypeId hostApiType;    /**< paDirectSound */
-    unsigned long version;          /**< 2 */
+    unsigned long version;          /**< 3 */
 
     unsigned long flags;            /**< enable other features of this struct */
 
@@ -84,6 +84,17 @@ typedef struct PaWinDirectSoundStreamInfo{
     */
     PaWinWaveFormatChannelMask channelMask;
 
+    /**
+        The logical processors the stream's processing thread may run on.
+        On systems with more than 64 of them the processors are numbered
+        group by group, those of processor group 0 first. NULL or a
+        callbackCpuCount of 0 lets the thread run on any processor. If both
+        directions of a stream give processors, those of the output are used.
+        Must remain valid until Pa_OpenStream() returns. Since version 3.
+    */
+    const int *callbackCpus;
+    int callbackCpuCount;
+
 }PaWinDirectSoundStreamInfo;
 
 
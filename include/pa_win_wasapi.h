@@ -41,6 +41,11 @@
 /** @file
  @ingroup public_header
  @brief WASAPI-specific PortAudio API extension header file.
+
+ Pa_Initialize() reads the cheap properties of the endpoints only. The device
+ periods are queried when a device is first opened, until then the default
+ latencies of its PaDeviceInfo are WASAPI's usual periods of 3 ms (low) and
+ 10 ms (high).
 */
 
 #include "portaudio.h"
@@ -71,7 +76,16 @@ typedef enum PaWasapiFlags
 
     /* forces custom thread priority setting, must be used if PaWasapiStreamInfo::threadPriority 
        is set to a custom value */
-    paWinWasapiThreadPriority           = (1 << 4)
+    paWinWasapiThreadPriority           = (1 << 4),
+
+    /* uses the minimal period of the shared-mode audio engine (IAudioClient3, Windows 10 and up)
+       for Event driven Shared mode streams, ignored in Exclusive mode or if not supported by the OS.
+       Use PaWasapi_GetSharedModeEnginePeriod to query the available period range. */
+    paWinWasapiLowLatencyShared         = (1 << 5),
+
+    /* opens an input stream on the device channels of PaWasapiStreamInfo::channelSelectors,
+       requires PaWasapiStreamInfo version 3 */
+    paWinWasapiUseChannelSelectors      = (1 << 6)
 }
 PaWasapiFlags;
 #define paWinWasapiExclusive             (paWinWasapiExclusive)
@@ -79,6 +93,8 @@ PaWasapiFlags;
 #define paWinWasapiUseChannelMask        (paWinWasapiUseChannelMask)
 #define paWinWasapiPolling               (paWinWasapiPolling)
 #define paWinWasapiThreadPriority        (paWinWasapiThreadPriority)
+#define paWinWasapiLowLatencyShared      (paWinWasapiLowLatencyShared)
+#define paWinWasapiUseChannelSelectors   (paWinWasapiUseChannelSelectors)
 
 
 /* Host processor. Allows to skip internal PA processing completely. 
@@ -236,7 +252,7 @@ PaWasapiStreamCategory;
 typedef enum PaWasapiStreamOption
 {
     eStreamOptionNone        = 0, //!< default
-    eStreamOptionRaw         = 1, //!< bypass WASAPI Audio Engine DSP effects, supported since Windows 8.1
+    eStreamOptionRaw         = 1, //!< bypass WASAPI Audio Engine DSP effects, supported since Windows 8.1 by devices for which PaWasapi_IsRawStreamSupported() is true
     eStreamOptionMatchFormat = 2  //!< force WASAPI Audio Engine into a stream format, supported since Windows 10
 }
 PaWasapiStreamOption;
@@ -247,7 +263,7 @@ typedef struct PaWasapiStreamInfo
 {
     unsigned long size;             /**< sizeof(PaWasapiStreamInfo) */
     PaHostApiTypeId hostApiType;    /**< paWASAPI */
-    unsigned long version;          /**< 1 */
+    unsigned long version;          /**< 3 */
 
     unsigned long flags;            /**< collection of PaWasapiFlags */
 
@@ -287,6 +303,25 @@ typedef struct PaWasapiStreamInfo
      @version Available as of 19.6.0
     */
     PaWasapiStreamOption streamOption;
+
+    /** The logical processors the stream's processing thread may run on. On systems with more
+       than 64 of them the processors are numbered group by group, those of processor group 0
+       first. NULL or a callbackCpuCount of 0 lets the thread run on any processor. If both
+       directions of a stream give processors, those of the output are used. Must remain valid
+       until Pa_OpenStream() returns.
+     @version Since PaWasapiStreamInfo version 2.
+    */
+    const int *callbackCpus;
+    int callbackCpuCount;
+
+    /** For each of the channelCount channels of an input stream, the device channel it is,
+       e.g. { 12, 13 } to record a pair of a 64-channel interface. The device is opened with
+       the channels up to the highest one selected and only the selected channels are
+       converted. Will be used only if paWinWasapiUseChannelSelectors flag is specified, not
+       supported for output. Must remain valid until Pa_OpenStream() returns.
+     @version Since PaWasapiStreamInfo version 3.
+    */
+    const int *channelSelectors;
 } 
 PaWasapiStreamInfo;
 
@@ -315,6 +350,24 @@ int PaWasapi_GetDeviceDefaultFormat( void *pFormat, unsigned int nFormatSize, Pa
 int/*PaWasapiDeviceRole*/ PaWasapi_GetDeviceRole( PaDeviceIndex nDevice );
 
 
+/** Returns whether the device is a loopback device capturing what is played on an output device.
+
+ Every output endpoint gets an input device named after it with " [Loopback]" appended (not on
+ WinRT). Loopback devices work in Shared mode only, opening them with paWinWasapiExclusive fails
+ with paInvalidFlag. Callback streams of loopback devices are event driven by a silent render
+ stream on the same endpoint, unless paWinWasapiPolling is set or the stream is full-duplex;
+ the render stream also keeps packets coming while nothing else plays on the endpoint. The
+ inputBufferAdcTime of loopback callbacks is the capture time of the packet's first frame on the
+ clock of Pa_GetStreamTime().
+
+ @param nDevice device index.
+
+ @return 1 if the device is a loopback device, 0 if not or, a PaErrorCode (which are always
+         negative) if PortAudio is not initialized or an error is encountered.
+*/
+int PaWasapi_IsLoopback( PaDeviceIndex nDevice );
+
+
 /** Boost thread priority of calling thread (MMCSS). Use it for Blocking Interface only for thread
     which makes calls to Pa_WriteStream/Pa_ReadStream.
 
@@ -353,6 +406,36 @@ PaError PaWasapi_ThreadPriorityRevert( void *hTask );
 PaError PaWasapi_GetFramesPerHostBuffer( PaStream *pStream, unsigned int *nInput, unsigned int *nOutput );
 
 
+/** Get the periods of the shared-mode audio engine for the default (mix) format of a device.
+    A Shared mode stream opened with the paWinWasapiLowLatencyShared flag uses a period in
+    the [nMin, nMax] range which is a multiple of nFundamental above nMin. Requires Windows 10.
+
+ @param  nDevice      Device index.
+ @param  nDefault     Pointer to variable to receive default period in frames. Can be NULL.
+ @param  nFundamental Pointer to variable to receive period granularity in frames. Can be NULL.
+ @param  nMin         Pointer to variable to receive minimal period in frames. Can be NULL.
+ @param  nMax         Pointer to variable to receive maximal period in frames. Can be NULL.
+ @return Error code indicating success or failure, paIncompatibleHostApiSpecificStreamInfo
+         if the OS does not provide the periods, paUnanticipatedHostError if the device
+         could not be queried.
+*/
+PaError PaWasapi_GetSharedModeEnginePeriod( PaDeviceIndex nDevice, unsigned int *nDefault,
+    unsigned int *nFundamental, unsigned int *nMin, unsigned int *nMax );
+
+
+/** Find out whether a device can be opened in raw mode (eStreamOptionRaw), in which Shared
+    mode streams bypass the audio processing objects (effects) of the audio engine with their
+    latency and CPU cost. Streams of devices without raw mode requesting it are opened with the
+    effects. Requires Windows 8.1.
+
+ @param  nDevice    Device index.
+ @param  bSupported Pointer to variable to receive non-zero if raw mode is supported.
+ @return Error code indicating success or failure, paIncompatibleHostApiSpecificStreamInfo
+         for UWP applications which cannot query devices.
+*/
+PaError PaWasapi_IsRawStreamSupported( PaDeviceIndex nDevice, int *bSupported );
+
+
 /** Get number of jacks associated with a WASAPI device.  Use this method to determine if
     there are any jacks associated with the provided WASAPI device.  Not all audio devices
     will support this capability.  This is valid for both input and output devices.
@@ -410,6 +493,13 @@ PaError PaWasapi_GetJackDescription(PaDeviceIndex nDevice, int jindex, PaWasapiJ
         Polling can be setup by speciying 'paWinWasapiPolling' flag. Our WASAPI implementation detects
         WOW64 bug and sets 'paWinWasapiPolling' automatically.
 
+        3) Manual (paManualProcessing):
+        Pa_ProcessStream() waits for the event or polls as the processing thread would, but on the
+        application's thread, which must be allowed to use the stream's COM objects (the thread
+        which opened the stream, or any MTA thread if it was opened in the MTA). Only input-only
+        and output-only streams can be processed manually. The application's thread priority
+        is left as it is.
+
     Thread priority:
 
         Normally thread priority is set automatically and does not require modification. Although
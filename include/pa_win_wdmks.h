@@ -69,12 +69,19 @@ extern "C"
         */
         paWinWDMKSUseGivenChannelMask = (1 << 1),
 
+        /** Makes WDMKS schedule processing of a WaveRT device from its hardware position register,
+         with a (high-resolution where available) timer set to the time the position reaches the
+         next half of the buffer, instead of using the notification events of the driver. Use it
+         on drivers whose notification events are coarse. Ignored for WaveCyclic devices.
+        */
+        paWinWDMKSPositionScheduling  = (1 << 2),
+
     } PaWinWDMKSFlags;
 
     typedef struct PaWinWDMKSInfo{
         unsigned long size;             /**< sizeof(PaWinWDMKSInfo) */
         PaHostApiTypeId hostApiType;    /**< paWDMKS */
-        unsigned long version;          /**< 1 */
+        unsigned long version;          /**< 2 */
 
         /** Flags indicate which fields are valid.
          @see PaWinWDMKSFlags
@@ -82,7 +89,10 @@ extern "C"
         */
         unsigned long flags;
 
-        /** The number of packets to use for WaveCyclic devices, range is [2, 8]. Set to zero for default value of 2. */
+        /** The number of packets to use for WaveCyclic devices, range is [2, 16]. Set to zero for default value of 2.
+         More packets queued at the driver trade latency (noOfPackets * framesPerHostBuffer) for robustness
+         on drivers that glitch with two packets.
+        */
         unsigned noOfPackets;
 
         /** If paWinWDMKSUseGivenChannelMask bit is set in flags, use this as channelMask instead of default.
@@ -90,6 +100,15 @@ extern "C"
          @version Available as of 19.5.0.
         */
         unsigned channelMask;
+
+        /** The logical processors the stream's processing thread may run on. On systems with more
+         than 64 of them the processors are numbered group by group, those of processor group 0 first.
+         NULL or a callbackCpuCount of 0 lets the thread run on any processor. If both directions of a
+         stream give processors, those of the output are used. Must remain valid until Pa_OpenStream()
+         returns. Since version 2.
+        */
+        const int *callbackCpus;
+        int callbackCpuCount;
     } PaWinWDMKSInfo;
 
     typedef enum PaWDMKSType
@@ -130,6 +149,30 @@ extern "C"
         PaWDMKSDirectionSpecificStreamInfo output;
     } PaWDMKSSpecificStreamInfo;
 
+    /** Completion timing of the WaveCyclic packets of one direction of a stream, since it was started.
+     Intervals are in seconds between succeeding packet completions.
+     @see PaWinWDMKS_GetPacketTiming
+    */
+    typedef struct PaWinWDMKSPacketTiming {
+        unsigned long completedPackets;     /**< Number of packets completed by the driver */
+        unsigned long lateCompletions;      /**< Completions later than 1.5 times expectedInterval */
+        unsigned noOfPackets;               /**< Number of packets queued at the driver */
+        double expectedInterval;            /**< Duration of one packet */
+        double lastInterval;
+        double minInterval;
+        double maxInterval;
+        double meanInterval;
+    } PaWinWDMKSPacketTiming;
+
+    /** Retrieve the packet completion timing of a running or stopped WDMKS stream.
+     @param stream A stream opened on a WDMKS device.
+     @param input Nonzero for the capture direction, zero for the render direction.
+     @param timing Receives the timing. All fields are zero for a direction the stream does not
+     have, or if the device is WaveRT, which does not use packets.
+     @return paNoError, paIncompatibleStreamHostApi if the stream is not a WDMKS stream.
+    */
+    PaError PaWinWDMKS_GetPacketTiming( PaStream *stream, int input, PaWinWDMKSPacketTiming *timing );
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
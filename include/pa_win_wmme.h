@@ -72,6 +72,14 @@ extern "C"
 #define paWinMmeWaveFormatDolbyAc3Spdif                 (0x10)
 #define paWinMmeWaveFormatWmaSpdif                      (0x20)
 
+/* Adaptive output buffer count for callback streams. The buffer count selected from the
+    latency parameters becomes a maximum: the stream starts with the minimum number of
+    buffers queued and adds one each time an output underflow is detected, until the
+    maximum is reached. The outputLatency reported by Pa_GetStreamInfo() follows the
+    number of buffers in use.
+*/
+#define paWinMmeAdaptiveOutputBufferCount               (0x40)
+
 
 typedef struct PaWinMmeDeviceAndChannelCount{
     PaDeviceIndex device;
@@ -82,7 +90,7 @@ typedef struct PaWinMmeDeviceAndChannelCount{
 typedef struct PaWinMmeStreamInfo{
     unsigned long size;             /**< sizeof(PaWinMmeStreamInfo) */
     PaHostApiTypeId hostApiType;    /**< paMME */
-    unsigned long version;          /**< 1 */
+    unsigned long version;          /**< 2 */
 
     unsigned long flags;
 
@@ -125,6 +133,17 @@ typedef struct PaWinMmeStreamInfo{
     */
     PaWinWaveFormatChannelMask channelMask;
 
+    /*
+        The logical processors the stream's processing thread may run on.
+        On systems with more than 64 of them the processors are numbered
+        group by group, those of processor group 0 first. NULL or a
+        callbackCpuCount of 0 lets the thread run on any processor. If both
+        directions of a stream give processors, those of the output are used.
+        Must remain valid until Pa_OpenStream() returns. Since version 2.
+    */
+    const int *callbackCpus;
+    int callbackCpuCount;
+
 }PaWinMmeStreamInfo;
 
 
@@ -178,6 +197,40 @@ int PaWinMME_GetStreamOutputHandleCount( PaStream* stream );
 HWAVEOUT PaWinMME_GetStreamOutputHandle( PaStream* stream, int handleIndex );
 
 
+/** Retrieve the event a PortAudio WinMME stream's input devices signal when
+ they return a buffer, so that an event loop can wait for input on many
+ streams, for example with RegisterWaitForSingleObject(), and read it with
+ Pa_ReadStreamTimeout() and a timeout of 0.
+
+ The event is an auto-reset event which Pa_ReadStream() waits on too, treat
+ it as a hint only: the read may find no frames, or frames may be available
+ without the event being signalled after a read which left some, so read
+ until Pa_ReadStreamTimeout() returns paTimedOut.
+
+ @param stream The stream to query.
+
+ @return The event, or NULL if the stream is output only or an error
+ occurred.
+
+ @see PaWinMME_GetStreamOutputEvent
+*/
+HANDLE PaWinMME_GetStreamInputEvent( PaStream* stream );
+
+
+/** Retrieve the event a PortAudio WinMME stream's output devices signal when
+ they return a buffer, as PaWinMME_GetStreamInputEvent(), for writing with
+ Pa_WriteStreamTimeout().
+
+ @param stream The stream to query.
+
+ @return The event, or NULL if the stream is input only or an error
+ occurred.
+
+ @see PaWinMME_GetStreamInputEvent
+*/
+HANDLE PaWinMME_GetStreamOutputEvent( PaStream* stream );
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
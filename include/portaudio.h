@@ -291,6 +291,34 @@ typedef enum PaHostApiTypeId
 } PaHostApiTypeId;
 
 
+/** Library initialization function like Pa_Initialize(), which only brings up
+ the host APIs of the given types. A process using only some host APIs thus
+ avoids the cost of initializing the others, for example of probing ALSA and
+ OSS devices when it only uses JACK.
+
+ Host APIs keep their usual order and default host API selection among those
+ initialized; types that weren't compiled in are ignored. If PortAudio is
+ already initialized, this only counts the call like Pa_Initialize() and the
+ host APIs stay those of the first initialization.
+
+ Pa_Initialize() itself selects host APIs if the PA_HOSTAPIS environment
+ variable is set, to a list of names separated by commas or spaces: ALSA, OSS,
+ JACK, ASIHPI, CoreAudio, MME, DirectSound, ASIO, WASAPI or WDMKS (case
+ doesn't matter). Unknown names are ignored.
+
+ @param hostApiTypes The types of the host APIs to initialize, NULL to
+ initialize like Pa_Initialize().
+
+ @param hostApiTypeCount The number of elements of hostApiTypes.
+
+ @return paNoError if successful, otherwise an error code indicating the cause
+ of failure.
+
+ @see Pa_Initialize, PaHostApiTypeId
+*/
+PaError Pa_InitializeWithHostApis( const PaHostApiTypeId *hostApiTypes, int hostApiTypeCount );
+
+
 /** A structure containing information about a particular host API. */
 
 typedef struct PaHostApiInfo
@@ -467,18 +495,25 @@ typedef double PaTime;
  The standard formats paFloat32, paInt16, paInt32, paInt24, paInt8
  and aUInt8 are usually implemented by all implementations.
 
- The floating point representation (paFloat32) uses +1.0 and -1.0 as the
- maximum and minimum respectively.
+ The floating point representations (paFloat32 and paFloat64) use +1.0 and
+ -1.0 as the maximum and minimum respectively. paFloat64 samples are doubles,
+ for clients processing in double precision.
 
  paUInt8 is an unsigned 8 bit format where 128 is considered "ground"
 
+ paInt24In32 holds 24 bit samples in the low 3 bytes of a native endian 32
+ bit integer, the layout ALSA calls S24. PortAudio sign extends the upper
+ byte of the samples it produces and ignores it in the samples it consumes.
+ Host APIs which transfer 24 bit samples in 32 bit containers use it
+ without a detour through packed paInt24.
+
  The paNonInterleaved flag indicates that audio data is passed as an array 
  of pointers to separate buffers, one buffer for each channel. Usually,
  when this flag is not used, audio data is passed as a single buffer with
  all channels interleaved.
 
  @see Pa_OpenStream, Pa_OpenDefaultStream, PaDeviceInfo
- @see paFloat32, paInt16, paInt32, paInt24, paInt8
+ @see paFloat32, paFloat64, paInt16, paInt32, paInt24, paInt24In32, paInt8
  @see paUInt8, paCustomFormat, paNonInterleaved
 */
 typedef unsigned long PaSampleFormat;
@@ -490,6 +525,8 @@ typedef unsigned long PaSampleFormat;
 #define paInt16          ((PaSampleFormat) 0x00000008) /**< @see PaSampleFormat */
 #define paInt8           ((PaSampleFormat) 0x00000010) /**< @see PaSampleFormat */
 #define paUInt8          ((PaSampleFormat) 0x00000020) /**< @see PaSampleFormat */
+#define paInt24In32      ((PaSampleFormat) 0x00000040) /**< 24 bit samples in 32 bit integers. @see PaSampleFormat */
+#define paFloat64        ((PaSampleFormat) 0x00000080) /**< @see PaSampleFormat */
 #define paCustomFormat   ((PaSampleFormat) 0x00010000) /**< @see PaSampleFormat */
 
 #define paNonInterleaved ((PaSampleFormat) 0x80000000) /**< @see PaSampleFormat */
@@ -533,6 +570,153 @@ typedef struct PaDeviceInfo
 const PaDeviceInfo* Pa_GetDeviceInfo( PaDeviceIndex device );
 
 
+/** A structure describing the sample formats, channel counts and sample rates
+ supported by a PortAudio device, as returned by Pa_GetDeviceCapabilities().
+ Fields of a direction the device doesn't support are 0.
+*/
+typedef struct PaDeviceCapabilities
+{
+    int structVersion;  /* this is struct version 1 */
+
+    /** The sample formats the device supports natively, PortAudio converts
+     from and to the other formats. */
+    PaSampleFormat inputSampleFormats;
+    PaSampleFormat outputSampleFormats;
+
+    int minInputChannels;
+    int maxInputChannels;
+    int minOutputChannels;
+    int maxOutputChannels;
+
+    /** Supported sample rates from a list of standard rates, in ascending
+     order. The device may support other rates too. */
+    const double *inputSampleRates;
+    int inputSampleRateCount;
+    const double *outputSampleRates;
+    int outputSampleRateCount;
+} PaDeviceCapabilities;
+
+
+/** Retrieve a pointer to a PaDeviceCapabilities structure describing what
+ the specified device supports. The capabilities are determined once, when
+ they are first retrieved or the device is first passed to
+ Pa_IsFormatSupported(), which then answers from them without opening the
+ device where the host API allows it.
+
+ @return A pointer to an immutable PaDeviceCapabilities structure, or NULL if
+ the device parameter is out of range, the host API doesn't provide device
+ capabilities or they can't be determined now, for example because the device
+ is in use.
+
+ @param device A valid device index in the range 0 to (Pa_GetDeviceCount()-1)
+
+ @note PortAudio manages the memory referenced by the returned pointer,
+ the client must not manipulate or free the memory. The pointer is only
+ guaranteed to be valid until the device list is refreshed or Pa_Terminate()
+ is called.
+
+ @see PaDeviceCapabilities, Pa_IsFormatSupported
+*/
+const PaDeviceCapabilities* Pa_GetDeviceCapabilities( PaDeviceIndex device );
+
+
+/** Enumerate the devices again, picking up devices that were connected or
+ removed since Pa_Initialize(), without terminating PortAudio.
+
+ Host APIs which support it rebuild their device lists, the others keep
+ theirs. Open streams, including running ones, are left alone. The new lists
+ replace the old ones only once every host API was enumerated successfully,
+ otherwise the device list stays unchanged.
+
+ @return paNoError on success, or an error code if PortAudio is not
+ initialized or a host API failed to enumerate its devices.
+
+ @note Device indices and PaDeviceInfo pointers obtained before the call are
+ invalid after it succeeds, also the default devices may change. Must not be
+ called while other threads use PortAudio functions which take or return
+ device indices or device information, such as Pa_OpenStream().
+
+ @see Pa_GetDeviceCount, Pa_GetDeviceInfo
+*/
+PaError Pa_RefreshDeviceList( void );
+
+
+/** Functions of type PaDeviceChangeCallback are implemented by PortAudio
+ clients to be told that devices of a host API were connected or removed,
+ or that its default devices changed. They are registered with
+ Pa_SetDeviceChangeCallback().
+
+ @param hostApi The index of the host API whose devices changed.
+
+ @param userData The userData parameter supplied to
+ Pa_SetDeviceChangeCallback().
+
+ @note The callback runs on a thread of the host API, which may be a thread
+ of the operating system, and must return quickly. It must not call
+ PortAudio functions; a client typically wakes up one of its threads which
+ then calls Pa_RefreshDeviceList(). Several changes in a short time, such as
+ the devices of one sound card appearing, may be reported once or several
+ times.
+
+ @see Pa_SetDeviceChangeCallback, Pa_RefreshDeviceList
+*/
+typedef void PaDeviceChangeCallback( PaHostApiIndex hostApi, void *userData );
+
+
+/** Register a function to be called when devices are connected or removed,
+ or default devices change, replacing the one registered before.
+
+ Notifications come from the host APIs which can detect such changes:
+ ALSA (for sound cards appearing and disappearing), WASAPI and Core Audio.
+ PortAudio's device list doesn't change by itself, call
+ Pa_RefreshDeviceList() to update it.
+
+ @param callback The function to call, or NULL to stop notifications. Once
+ the function returns, the previously registered callback is not called any
+ more. Pa_Terminate() unregisters the callback.
+
+ @param userData A client supplied pointer which is passed to the callback.
+
+ @return paNoError on success, or an error code if PortAudio is not
+ initialized or a host API failed to start notifications, in which case
+ no callback is registered.
+
+ @see PaDeviceChangeCallback
+*/
+PaError Pa_SetDeviceChangeCallback( PaDeviceChangeCallback *callback, void *userData );
+
+
+/** Keep the host APIs and their device lists when PortAudio is terminated,
+ so that terminating and initializing PortAudio again doesn't enumerate every
+ device and determine its capabilities anew.
+
+ With retention on, Pa_Terminate() closes the open streams but leaves the
+ host APIs initialized. The next Pa_Initialize() reuses them if the same host
+ APIs are selected, enumerating again only those whose device change
+ notifications reported changes in between, as Pa_RefreshDeviceList() would.
+ Host APIs which can't notify changes keep their devices, those which can
+ but failed to start notifications are enumerated again. If a changed host
+ API can't enumerate its devices again, or other host APIs are selected,
+ Pa_Initialize() initializes all of them as usual.
+
+ May be called at any time, also before Pa_Initialize(). Retention is off by
+ default.
+
+ @param retain Non-zero to keep the host APIs on Pa_Terminate(), 0 to
+ terminate them as usual. If PortAudio is terminated, 0 also releases the
+ host APIs kept by the last Pa_Terminate().
+
+ @return paNoError.
+
+ @note Device indices and PaDeviceInfo pointers obtained before
+ Pa_Terminate() remain invalid after Pa_Initialize(), even if the devices
+ were retained.
+
+ @see Pa_Terminate, Pa_RefreshDeviceList
+*/
+PaError Pa_RetainDevicesOnTerminate( int retain );
+
+
 /** Parameters for one direction (input or output) of a stream.
 */
 typedef struct PaStreamParameters
@@ -581,6 +765,50 @@ typedef struct PaStreamParameters
 } PaStreamParameters;
 
 
+/** One gain of a sparse PaChannelMatrix: the contribution of streamChannel
+ to deviceChannel for output, or of deviceChannel to streamChannel for input.
+ @see PaChannelMatrix
+*/
+typedef struct PaChannelMatrixEntry
+{
+    int deviceChannel;
+    int streamChannel;
+    float gain;
+} PaChannelMatrixEntry;
+
+
+/** Routes and mixes the channels of a stream to and from a device with a
+ different number of channels, for example to downmix a 5.1 capture device
+ to the stereo buffers of the callback or to send a stereo stream to two
+ channels of a 16 channel interface.
+
+ The gains are given either densely, in gains, or sparsely, in entries. Both
+ may be used, entries are then added to the dense gains, as are entries which
+ name the same pair of channels. Pairs which are not given have a gain of 0.
+
+ Host APIs that support it accept a matrix through their host API specific
+ stream info (see PaAlsaStreamInfo). The stream callback then sees the
+ channelCount of PaStreamParameters while the device is opened with
+ deviceChannelCount channels.
+*/
+typedef struct PaChannelMatrix
+{
+    /** The number of channels the device is opened with. */
+    int deviceChannelCount;
+
+    /** NULL or deviceChannelCount * channelCount gains, the gain between
+     deviceChannel and streamChannel being
+     gains[ deviceChannel * channelCount + streamChannel ].
+    */
+    const float *gains;
+
+    /** NULL or entryCount gains of individual pairs of channels. */
+    const PaChannelMatrixEntry *entries;
+    unsigned long entryCount;
+
+} PaChannelMatrix;
+
+
 /** Return code for Pa_IsFormatSupported indicating success. */
 #define paFormatIsSupported (0)
 
@@ -648,7 +876,10 @@ typedef void PaStream;
 
  @see Pa_OpenStream, Pa_OpenDefaultStream
  @see paNoFlag, paClipOff, paDitherOff, paNeverDropInput,
-  paPrimeOutputBuffersUsingStreamCallback, paPlatformSpecificFlags
+  paPrimeOutputBuffersUsingStreamCallback, paDitherNoiseShaped,
+  paConvertSampleRate, paCompensateClockDrift, paSkipSilentOutput, paSoftClip,
+  paFlushDenormals, paBatchCallbacks, paMeterLevels, paManualProcessing,
+  paPreferCheapestConversion, paPlatformSpecificFlags
 */
 typedef unsigned long PaStreamFlags;
 
@@ -684,6 +915,147 @@ typedef unsigned long PaStreamFlags;
 */
 #define   paPrimeOutputBuffersUsingStreamCallback ((PaStreamFlags) 0x00000008)
 
+/** Use triangular dither with 2nd order noise shaping instead of plain
+ triangular dither, which moves the dither noise out of the most audible
+ frequency range. Currently only used for paFloat32 output to a paInt16 host
+ format, other conversions use the default dither. Noise shaped output is
+ always clipped. Ignored when combined with paDitherOff.
+
+ @see PaStreamFlags
+*/
+#define   paDitherNoiseShaped ((PaStreamFlags) 0x00000010)
+
+/** Allow the host API to run the device at a different sample rate if it
+ does not support the one passed to Pa_OpenStream(), and convert between the
+ two in PortAudio. The stream callback is called at the requested rate and
+ the delay of the converter is included in the latencies returned by
+ Pa_GetStreamInfo(). Only callback streams of host APIs which support it
+ (currently ALSA and JACK) are converted, in other cases the flag has no
+ effect and an unsupported sample rate still fails with paInvalidSampleRate.
+
+ @see PaStreamFlags, paConvertSampleRateFast, paConvertSampleRateBest
+*/
+#define   paConvertSampleRate ((PaStreamFlags) 0x00000020)
+
+/** Use a shorter sample rate conversion filter, with less latency and CPU
+ load but a wider transition band and less stop band attenuation. Only valid
+ in combination with paConvertSampleRate.
+ @see PaStreamFlags, paConvertSampleRate
+*/
+#define   paConvertSampleRateFast ((PaStreamFlags) 0x00000040)
+
+/** Use a longer sample rate conversion filter, for more than 100 dB of stop
+ band attenuation. Only valid in combination with paConvertSampleRate.
+ @see PaStreamFlags, paConvertSampleRate
+*/
+#define   paConvertSampleRateBest ((PaStreamFlags) 0x00000080)
+
+/** For full duplex streams whose input and output devices do not share a
+ clock, for example a USB microphone and an HDMI output. The host API
+ services the two devices independently. PortAudio resamples the input to
+ follow the output device's clock, using the devices' time stamps, so the
+ latency does not grow or shrink as the clocks drift apart. This adds the
+ resampler's delay and up to two host buffers to the input latency. Only
+ valid for full duplex callback streams. Host APIs which do not support it
+ (currently only ALSA does) ignore it.
+
+ @see PaStreamFlags
+*/
+#define   paCompensateClockDrift ((PaStreamFlags) 0x00000100)
+
+/** Write silence to the device for output buffers which the stream callback
+ (or Pa_WriteStream()) left entirely silent, instead of converting them to the
+ host sample format. Useful for streams which are kept open but mostly
+ silent: each buffer is scanned, which is cheaper than converting it, and a
+ silent one is then zeroed in the host format. Only samples which are exactly
+ zero (128 for paUInt8) count as silent, and silent buffers stay silent when
+ dithering, instead of becoming dither noise.
+
+ @see PaStreamFlags
+*/
+#define   paSkipSilentOutput ((PaStreamFlags) 0x00000200)
+
+/** Clip paFloat32 output samples with a smooth curve instead of limiting
+ them at full scale. The samples are shaped by x - 4/27 x^3, after limiting
+ them to +/-1.5: the gain is 1 for small signals and falls off towards peaks,
+ which reach full scale with a slope of 0 at 1.5. This also applies to a
+ paFloat32 host format, keeping the output within +/-1. Ignored together
+ with paClipOff, for other sample formats and for input, and not combined
+ with paDitherNoiseShaped, which keeps its own clipping.
+
+ @see PaStreamFlags
+*/
+#define   paSoftClip ((PaStreamFlags) 0x00000400)
+
+/** Flush denormal floating point numbers to zero on the thread which calls
+ the stream callback, before each callback. Denormals are the tiny values a
+ decaying reverb or IIR filter tail ends up with, and arithmetic on them can
+ be many times slower. Sets FTZ and DAZ in MXCSR on x86, which applies to SSE
+ but not to x87 arithmetic, and FZ on ARM. The mode stays set on the thread.
+ Ignored by blocking streams, whose I/O functions run on the application's
+ threads.
+
+ @see PaStreamFlags
+*/
+#define   paFlushDenormals ((PaStreamFlags) 0x00000800)
+
+/** Treat framesPerBuffer as the least number of frames per stream callback
+ instead of a suggestion for the host buffer size. Host APIs which support
+ the flag choose their buffers from the suggested latency as if
+ framesPerBuffer were paFramesPerBufferUnspecified, and call the callback
+ once per whole number of host buffers, with the smallest multiple of the
+ host buffer size which is at least framesPerBuffer. This amortizes the per
+ callback overhead over host buffers of a few dozen frames. The input waits
+ for the rest of the batch, which is included in PaStreamInfo::inputLatency.
+ The flag is supported by ALSA, ASIO, JACK, PipeWire, AAudio and the null,
+ shared memory and AES67 host APIs. Other host APIs ignore the flag and call
+ the callback with framesPerBuffer frames. Only valid for callback streams,
+ ignored with paFramesPerBufferUnspecified.
+
+ @see PaStreamFlags
+*/
+#define   paBatchCallbacks ((PaStreamFlags) 0x00001000)
+
+/** Measure the peak and RMS level of each channel of the stream, for
+ Pa_GetStreamLevels(). The samples are metered in the user's sample format as
+ they are converted to or from the host's, while they are in the cache, or
+ as they are passed to the stream callback when no conversion is needed.
+ Host APIs which don't process their buffers with PortAudio's common buffer
+ processor don't meter.
+
+ @see PaStreamFlags, Pa_GetStreamLevels
+*/
+#define   paMeterLevels ((PaStreamFlags) 0x00002000)
+
+/** Don't create a thread for the stream callback, the application calls
+ Pa_ProcessStream() from a thread of its own instead, typically a real-time
+ thread it already runs, which saves a thread and a context switch per host
+ buffer. Each call waits for the device and processes one host buffer,
+ calling the stream callback on the caller's thread. Only valid for callback
+ streams, and only supported by the ALSA, OSS, WASAPI and null host APIs,
+ Pa_OpenStream() fails with paInvalidFlag on the others and for the
+ combinations a host API documents as unsupported. Host API specific flags
+ asking for threads of their own, such as a shared callback thread or timer
+ scheduling, are ignored.
+
+ @see PaStreamFlags, Pa_ProcessStream
+*/
+#define   paManualProcessing ((PaStreamFlags) 0x00004000)
+
+/** Let the host API choose the sample format it runs the device with by the
+ cost of converting to it rather than by its quality alone: of the formats
+ which hold the stream's samples without losing resolution, such as paInt32,
+ paInt24 and paInt24In32 for paFloat32, the one whose conversion is cheapest,
+ preferring those the driver takes without converting them itself (for
+ example the formats of the hw: device behind an ALSA plughw: device). The
+ costs are the converter timings measured when PA_CONVERTER_TUNING is set,
+ otherwise estimates. If no format holds the samples losslessly the usual
+ choice is made. Currently only used by ALSA, ignored by the other host APIs.
+
+ @see PaStreamFlags
+*/
+#define   paPreferCheapestConversion ((PaStreamFlags) 0x00008000)
+
 /** A mask specifying the platform specific bits.
  @see PaStreamFlags
 */
@@ -886,6 +1258,13 @@ typedef int PaStreamCallback(
  If a call to Pa_OpenStream() fails, a non-zero error code is returned (see
  PaError for possible error codes) and the value of stream is invalid.
 
+ @note Pa_OpenStream(), Pa_CloseStream(), Pa_IsFormatSupported() and
+ Pa_GetDeviceCapabilities() may be called from several threads at once.
+ Calls concerning devices of the same host API are serialized, calls for
+ different host APIs run in parallel. Pa_Initialize(), Pa_Terminate() and
+ Pa_RefreshDeviceList() must not be called while another thread is in one
+ of them.
+
  @see PaStreamParameters, PaStreamCallback, Pa_ReadStream, Pa_WriteStream,
  Pa_GetStreamReadAvailable, Pa_GetStreamWriteAvailable
 */
@@ -939,6 +1318,64 @@ PaError Pa_OpenDefaultStream( PaStream** stream,
                               void *userData );
 
 
+/** Open a stream as Pa_OpenStream() does, drawing the memory which PortAudio
+ allocates for it from a caller-supplied arena instead of the heap: the host
+ API's stream structure, host buffers, the temporary buffers of the buffer
+ processor and ring buffers.
+
+ Only the allocations made by the calling thread while the stream is opened
+ come from the arena. Memory which host API libraries or drivers allocate
+ themselves is not included, neither are allocations made when the stream is
+ started on host APIs which create their threads or buffers then.
+
+ The arena must stay valid until Pa_CloseStream() returns, after which it may
+ be reused. Pa_GetOpenStreamArenaSize() tells the size needed.
+
+ @param arena The memory the stream is placed in.
+
+ @param arenaSize The size of arena in bytes.
+
+ The other parameters are those of Pa_OpenStream().
+
+ @return As for Pa_OpenStream(), paInsufficientMemory if arena is too small,
+ or paBadBufferPtr if arena is NULL.
+
+ @see Pa_GetOpenStreamArenaSize
+*/
+PaError Pa_OpenStreamInArena( PaStream** stream,
+                       const PaStreamParameters *inputParameters,
+                       const PaStreamParameters *outputParameters,
+                       double sampleRate,
+                       unsigned long framesPerBuffer,
+                       PaStreamFlags streamFlags,
+                       PaStreamCallback *streamCallback,
+                       void *userData,
+                       void *arena,
+                       unsigned long arenaSize );
+
+
+/** Retrieve the size of the arena which Pa_OpenStreamInArena() needs for a
+ stream with the given parameters. The stream is opened and closed to find
+ out, allocating from the heap, so this is called ahead of the part of an
+ application which mustn't allocate. The size holds for the same devices
+ and parameters for as long as the device list isn't refreshed.
+
+ @param arenaSize Receives the size in bytes.
+
+ The other parameters are those of Pa_OpenStream().
+
+ @return paNoError, or the error Pa_OpenStream() returned for the parameters.
+*/
+PaError Pa_GetOpenStreamArenaSize( const PaStreamParameters *inputParameters,
+                       const PaStreamParameters *outputParameters,
+                       double sampleRate,
+                       unsigned long framesPerBuffer,
+                       PaStreamFlags streamFlags,
+                       PaStreamCallback *streamCallback,
+                       void *userData,
+                       unsigned long *arenaSize );
+
+
 /** Closes an audio stream. If the audio stream is active it
  discards any pending buffers as if Pa_AbortStream() had been called.
 */
@@ -988,6 +1425,52 @@ PaError Pa_SetStreamFinishedCallback( PaStream *stream, PaStreamFinishedCallback
 PaError Pa_StartStream( PaStream *stream );
 
 
+/** Commences audio processing so that the stream callback's first frame is
+ played at startTime, or for input only streams was captured at it, for
+ starting the playback of several streams, devices or machines together.
+
+ The stream starts right away: until the start time its output is silence
+ and its input is discarded. The callback is first called for the buffer
+ containing the start time, with its first frame at the start time, which
+ its timeInfo->outputBufferDacTime, or inputBufferAdcTime, reports. A start
+ time which has passed starts calling the callback right away.
+
+ The accuracy is that of the host API's buffer timestamps, a frame with most
+ host APIs using PortAudio's buffer processor. Host APIs which can't schedule
+ the start wait in Pa_StartStreamAtTime() until the start time less the
+ stream's output latency and start the stream then.
+
+ @param startTime The time of the callback's first frame, in the time base of
+ Pa_GetStreamTime().
+
+ @return paNoError, or an error as Pa_StartStream() returns.
+
+ @see Pa_StartStream, Pa_GetStreamTime
+*/
+PaError Pa_StartStreamAtTime( PaStream *stream, PaTime startTime );
+
+
+/** Commences audio processing of several streams together, so that the first
+ frames of their callbacks are played, or for input only streams captured,
+ at the same time, with aligned timeInfo->outputBufferDacTime.
+
+ The streams may be of different devices and host APIs. They are started
+ with Pa_StartStreamAtTime() at a common time, a little more than the
+ largest of their latencies from now, in the time base of each stream. The
+ function returns once all streams are started.
+
+ @param streams The streams, all stopped.
+
+ @param count The number of streams.
+
+ @return paNoError, or the error of the first stream which couldn't be
+ started, after aborting the streams started before it.
+
+ @see Pa_StartStreamAtTime
+*/
+PaError Pa_StartStreams( PaStream **streams, int count );
+
+
 /** Terminates audio processing. It waits until all pending
  audio buffers have been played before it returns.
 */
@@ -1000,6 +1483,102 @@ PaError Pa_StopStream( PaStream *stream );
 PaError Pa_AbortStream( PaStream *stream );
 
 
+/** Functions of type PaStreamStopCallback are passed to Pa_StopStreamAsync()
+ and called once the stream has stopped.
+
+ @param stream The stream passed to Pa_StopStreamAsync().
+
+ @param result The result Pa_StopStream() or Pa_AbortStream() would have
+ returned.
+
+ @param userData The userData passed to Pa_StopStreamAsync().
+
+ The callback is called on a thread created by PortAudio, not the stream
+ callback thread. It may call Pa_CloseStream() on the stream.
+
+ @see Pa_StopStreamAsync
+*/
+typedef void PaStreamStopCallback( PaStream *stream, PaError result, void *userData );
+
+
+/** Terminates audio processing like Pa_StopStream(), or like Pa_AbortStream()
+ if abort is nonzero, without waiting for the stream to stop. Returns once
+ stopping has begun; callback is called when the stream has stopped.
+
+ While the stream is stopping Pa_IsStreamStopped() returns 0, Pa_StopStream()
+ and Pa_AbortStream() wait for the stop to complete and Pa_CloseStream()
+ waits for the callback to be called.
+
+ @param callback Called with the result of stopping the stream, may be NULL.
+
+ @return paNoError if stopping has begun, paStreamIsStopped if the stream is
+ stopped or already being stopped, in which case callback isn't called, or
+ another PaErrorCode if the stop couldn't be started.
+
+ @see PaStreamStopCallback, Pa_StopStream, Pa_AbortStream
+*/
+PaError Pa_StopStreamAsync( PaStream *stream, int abort,
+                            PaStreamStopCallback *callback, void *userData );
+
+
+/** Pause audio processing of an active stream, keeping the device
+ configured so that Pa_ResumeStream() restarts it quickly, for example for
+ push-to-talk.
+
+ Host APIs which support pausing do so natively: the ALSA host API pauses
+ the PCMs of a blocking stream with snd_pcm_pause(), and callback streams of
+ several host APIs keep running while the stream callback isn't called,
+ outputting silence and discarding input, so that resuming takes effect
+ within one buffer. Other host APIs abort the stream and start it again on
+ resume.
+
+ A paused stream is neither active nor stopped: Pa_IsStreamActive() and
+ Pa_IsStreamStopped() return 0. It may be resumed, stopped, aborted or closed.
+
+ @return paNoError if the stream is paused, also if it already was, or
+ paStreamIsStopped if the stream is stopped.
+
+ @see Pa_ResumeStream
+*/
+PaError Pa_PauseStream( PaStream *stream );
+
+
+/** Resume a stream paused with Pa_PauseStream().
+
+ @return paNoError, or paStreamIsStopped or paStreamIsNotStopped if the stream
+ isn't paused.
+
+ @see Pa_PauseStream
+*/
+PaError Pa_ResumeStream( PaStream *stream );
+
+
+/** Process one host buffer of a started stream opened with paManualProcessing
+ on the calling thread: wait up to timeoutSeconds for the device to be ready,
+ then run the stream callback for its frames as the stream's own thread
+ would. Meant to be called in a loop for as long as the stream is active.
+
+ Once the stream callback returned paComplete or paAbort, the stream becomes
+ inactive as it would with a thread of its own, after the buffered output has
+ been played where the host API flushes it, and the call which stopped it
+ calls the stream finished callback. Pa_StopStream() and
+ Pa_AbortStream() must not be called while Pa_ProcessStream() runs on
+ another thread, they stop the device without flushing the buffered output.
+
+ @param timeoutSeconds The longest wait for the device, 0 to process only if
+ it is ready already.
+
+ @return paNoError once a host buffer has been processed, or an underrun or
+ overrun has been recovered from; paTimedOut if the device wasn't ready in
+ time; paStreamIsStopped if the stream isn't active; paInvalidFlag if it
+ wasn't opened with paManualProcessing; or another PaErrorCode if the device
+ failed.
+
+ @see paManualProcessing
+*/
+PaError Pa_ProcessStream( PaStream *stream, double timeoutSeconds );
+
+
 /** Determine whether the stream is stopped.
  A stream is considered to be stopped prior to a successful call to
  Pa_StartStream and after a successful call to Pa_StopStream or Pa_AbortStream.
@@ -1026,6 +1605,10 @@ PaError Pa_IsStreamStopped( PaStream *stream );
  audio), zero (0) when not playing or, a PaErrorCode (which are always negative)
  if PortAudio is not initialized or an error is encountered.
 
+ Pa_IsStreamActive() reads the stream's state without taking locks or waiting
+ for the stream, so it may be polled from control threads while another
+ thread starts or stops the stream.
+
  @see Pa_StopStream, Pa_AbortStream, Pa_IsStreamStopped
 */
 PaError Pa_IsStreamActive( PaStream *stream );
@@ -1095,14 +1678,43 @@ const PaStreamInfo* Pa_GetStreamInfo( PaStream *stream );
 
  This time may be used for synchronizing other events to the audio stream, for 
  example synchronizing audio to MIDI.
+
+ While a callback stream is running the time is interpolated from the
+ timestamps of the latest host buffer, without querying the host, so the
+ function is cheap enough to be called at video frame rate from any thread.
                                         
  @return The stream's current time in seconds, or 0 if an error occurred.
 
- @see PaTime, PaStreamCallback, PaStreamCallbackTimeInfo
+ @see PaTime, PaStreamCallback, PaStreamCallbackTimeInfo, Pa_GetStreamFramePosition
 */
 PaTime Pa_GetStreamTime( PaStream *stream );
 
 
+/** Retrieve the position of a callback stream: the number of frames which
+ have been played since it was started, or for an input only stream
+ captured, at the time of the call.
+
+ The position is interpolated from the timestamps of the latest host
+ buffer at the rate estimated for the device (see
+ PaStreamStatistics::estimatedSampleRate), without locks or system calls,
+ and may be retrieved from any thread, including the stream callback. It
+ counts frames at the stream's sample rate, has a fractional part, and
+ doesn't pass the frames which have been passed to or received from the
+ host, so it stops advancing when the stream stops.
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @param framePosition Receives the position. It is 0 until the stream's
+ output reaches the DAC, for blocking read/write streams and for host APIs
+ which don't publish the position.
+
+ @return paNoError on success, or an error code if the stream is invalid.
+
+ @see Pa_GetStreamTime
+*/
+PaError Pa_GetStreamFramePosition( PaStream* stream, double* framePosition );
+
+
 /** Retrieve CPU usage information for the specified stream.
  The "CPU Load" is a fraction of total CPU time consumed by a callback stream's
  audio processing routines including, but not limited to the client supplied
@@ -1122,6 +1734,348 @@ PaTime Pa_GetStreamTime( PaStream *stream );
 double Pa_GetStreamCpuLoad( PaStream* stream );
 
 
+/** Timing and xrun statistics of a callback stream since it was last
+ started, retrieved with Pa_GetStreamStatistics().
+
+ The durations measure the processing of each host buffer: the stream
+ callback, or the callbacks when the buffer is split or joined to deliver
+ framesPerBuffer, together with PortAudio's sample conversion. Unlike the
+ average of Pa_GetStreamCpuLoad() they show how close the slowest callbacks
+ come to the deadline. The jitter is the difference between the interval
+ from one host buffer to the next and the duration of the earlier buffer, it
+ shows how punctually the host delivers them.
+
+ Percentiles are taken from histograms with four buckets per octave and are
+ accurate to within about 20%, the maxima are exact.
+*/
+typedef struct PaStreamStatistics
+{
+    /** this is struct version 4 */
+    int structVersion;
+
+    /** The number of host buffers processed. */
+    unsigned long bufferCount;
+
+    PaTime callbackDurationMedian;
+    PaTime callbackDuration99thPercentile;
+    PaTime callbackDurationMax;
+
+    PaTime callbackJitter99thPercentile;
+    PaTime callbackJitterMax;
+
+    /** The number of host buffers reported with each of the
+     PaStreamCallbackFlags, and the stream time (see Pa_GetStreamTime()) of
+     the last one. The times are 0 while the count is 0.
+    */
+    unsigned long inputUnderflowCount;
+    unsigned long inputOverflowCount;
+    unsigned long outputUnderflowCount;
+    unsigned long outputOverflowCount;
+    PaTime lastInputUnderflowTime;
+    PaTime lastInputOverflowTime;
+    PaTime lastOutputUnderflowTime;
+    PaTime lastOutputOverflowTime;
+
+    /** The sample rate of the device measured against Pa_GetStreamTime(),
+     with the delay-locked loop which smooths the inputBufferAdcTime and
+     outputBufferDacTime passed to the stream callback. It differs from the
+     nominal rate by the drift between the device's clock and the system's,
+     typically well below 0.1%. The nominal rate of the host side of the
+     stream until the loop has seen two host buffers. Added in struct
+     version 2.
+    */
+    double estimatedSampleRate;
+
+    /** Averages like that of Pa_GetStreamCpuLoad() of the processing of the
+     host buffers, and of the parts of it spent converting the input to the
+     user's sample format, in the stream callback and converting the output
+     to the host's format. The remainder of bufferProcessingCpuLoad is
+     PortAudio's own work, such as block adaption, resampling and channel
+     mixing. threadCpuLoad is the CPU time the callback thread actually
+     consumed meanwhile: well below bufferProcessingCpuLoad, the thread was
+     preempted or blocked, in the callback or elsewhere. 0 for host APIs
+     which pass their buffers to the callback without conversion, and where
+     the system doesn't measure the CPU time of threads. Added in struct
+     version 3.
+    */
+    double bufferProcessingCpuLoad;
+    double inputConversionCpuLoad;
+    double callbackCpuLoad;
+    double outputConversionCpuLoad;
+    double threadCpuLoad;
+
+    /** The output headroom of the last host buffer and the least since the
+     stream was started: the time from when the buffer's processing ended to
+     when its first frame reaches the DAC, from the host API's
+     outputBufferDacTime, which most host APIs derive from the frames still
+     queued for the device. As it approaches 0 the stream is about to
+     underflow. 0 for input only streams and while no host buffer has been
+     processed. Added in struct version 4.
+
+     @see Pa_SetStreamHeadroomCallback
+    */
+    PaTime outputHeadroom;
+    PaTime outputHeadroomMin;
+
+} PaStreamStatistics;
+
+
+/** Retrieve timing and xrun statistics for the specified stream.
+
+ The statistics are collected by the callback without locking, this
+ function may be called from any thread, including the stream callback.
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @param statistics Receives the statistics. All fields except structVersion
+ are 0 for blocking read/write streams and for host APIs which don't collect
+ statistics.
+
+ @return paNoError on success, or an error code if the stream is invalid.
+
+ @see PaStreamStatistics, Pa_GetStreamCpuLoad
+*/
+PaError Pa_GetStreamStatistics( PaStream* stream, PaStreamStatistics* statistics );
+
+
+/** Functions of type PaStreamHeadroomCallback are called when the output
+ headroom of a stream falls below the threshold passed to
+ Pa_SetStreamHeadroomCallback(), so the application can shed load before the
+ stream underflows.
+
+ @param stream The stream whose headroom fell.
+
+ @param headroom The headroom of the host buffer, as
+ PaStreamStatistics::outputHeadroom.
+
+ @param userData The userData passed to Pa_SetStreamHeadroomCallback().
+
+ The callback is called on a thread of normal priority created by PortAudio,
+ not the stream callback thread. It must not close the stream.
+*/
+typedef void PaStreamHeadroomCallback( PaStream *stream, PaTime headroom, void *userData );
+
+
+/** Register a function to be called when the output headroom of a stream
+ falls below threshold. It is called once each time the headroom falls,
+ again only after it has been at or above the threshold, and not while the
+ previous call is still running.
+
+ The function may only be called while the stream is stopped. The headroom
+ is measured by host APIs which collect statistics, see
+ Pa_GetStreamStatistics().
+
+ @param threshold The headroom in seconds, for example the duration of a
+ host buffer.
+
+ @param callback The function, NULL to remove the one registered.
+
+ @return paNoError on success, paStreamIsNotStopped if the stream is
+ running, paIncompatibleStreamHostApi if the host API doesn't collect
+ statistics for the stream or another error code.
+
+ @see PaStreamHeadroomCallback, PaStreamStatistics::outputHeadroom
+*/
+PaError Pa_SetStreamHeadroomCallback( PaStream *stream, PaTime threshold,
+                                      PaStreamHeadroomCallback *callback, void *userData );
+
+
+/** The buffers of a stream a tap copies, see Pa_AddStreamTap(). */
+typedef enum PaStreamTapSource
+{
+    paStreamTapInput = 0,   /**< the input passed to the stream callback */
+    paStreamTapOutput = 1   /**< the output the stream callback returned */
+} PaStreamTapSource;
+
+
+/** A reader of the buffers of a stream, created with Pa_AddStreamTap().
+ The structure is opaque.
+*/
+typedef struct PaStreamTap PaStreamTap;
+
+
+/** Let a thread other than the stream callback's read copies of the input
+ or output buffers of a stream, for example to meter or record them,
+ without the callback copying them itself.
+
+ After each call of the stream callback PortAudio appends its buffer to a
+ ring shared by all taps of the source, in the sample format of the stream
+ callback. Taps read from there with Pa_ReadStreamTap(). The callback
+ thread never waits for them: frames which a tap hasn't read by the time
+ the ring is full are overwritten, and counted by
+ Pa_GetStreamTapDroppedFrames().
+
+ The function may only be called while the stream is stopped. Taps are only
+ fed by callback streams of host APIs which process their buffers with
+ PortAudio's common buffer processor.
+
+ @param source paStreamTapInput or paStreamTapOutput.
+
+ @param bufferDuration The seconds of frames the ring holds, how long a tap
+ may go without reading before frames are dropped. Only the first tap of a
+ source sets it, later taps share the ring.
+
+ @param tap Receives the tap, to be read from any one thread at a time and
+ removed with Pa_RemoveStreamTap().
+
+ @return paNoError on success, paStreamIsNotStopped if the stream is
+ running, paIncompatibleStreamHostApi if the stream can't be tapped,
+ paInvalidChannelCount if it has no buffers of source or another error code.
+
+ @see Pa_ReadStreamTap, Pa_RemoveStreamTap
+*/
+PaError Pa_AddStreamTap( PaStream *stream, PaStreamTapSource source,
+                         PaTime bufferDuration, PaStreamTap **tap );
+
+
+/** Read the frames appended to a tap's ring since the last read, without
+ waiting for more. The frames are interleaved, also for streams opened with
+ paNonInterleaved, and have the sample format and channels of the stream
+ callback's buffers of the tap's source.
+
+ Taps may be read while the stream runs and while it is stopped, but not
+ after it has been closed.
+
+ @param frames The most frames to read into buffer.
+
+ @return The number of frames read, 0 if none are available, or a
+ PaErrorCode (which are always negative).
+*/
+signed long Pa_ReadStreamTap( PaStreamTap *tap, void *buffer, unsigned long frames );
+
+
+/** Retrieve the number of frames Pa_ReadStreamTap() would read at most,
+ or a PaErrorCode (which are always negative).
+*/
+signed long Pa_GetStreamTapReadAvailable( PaStreamTap *tap );
+
+
+/** Retrieve the number of frames the callback thread overwrote before the
+ tap read them.
+*/
+unsigned long Pa_GetStreamTapDroppedFrames( PaStreamTap *tap );
+
+
+/** Free a tap created with Pa_AddStreamTap(). Taps must be removed, also
+ those of streams which have been closed. It must not be called while the
+ tap is being read.
+*/
+PaError Pa_RemoveStreamTap( PaStreamTap *tap );
+
+
+/** The level of a channel of a stream opened with paMeterLevels, as
+ retrieved with Pa_GetStreamLevels().
+*/
+typedef struct PaStreamChannelLevel
+{
+    /** The largest absolute value of a sample of the last metering period,
+     1 for full scale. */
+    float peak;
+
+    /** The root mean square of the samples of the last metering period, 1
+     for a full scale square wave and 0.707 for a full scale sine. */
+    float rms;
+
+    /** The samples at full scale, or beyond it for paFloat32, since the
+     stream was started. */
+    unsigned long clippedSamples;
+} PaStreamChannelLevel;
+
+
+/** Retrieve the levels of the channels of a stream opened with
+ paMeterLevels. They are measured over periods of 20 ms or of a host
+ buffer, whichever is longer, and the levels of the last complete period are
+ retrieved. The function doesn't block the stream callback and may be called
+ from any thread.
+
+ @param source paStreamTapInput for the input passed to the stream callback,
+ paStreamTapOutput for the output it returned.
+
+ @param levels Receives the levels of the first channelCount channels.
+
+ @return paNoError on success, paIncompatibleStreamHostApi if the stream
+ isn't metered, paInvalidChannelCount if it has fewer than channelCount
+ channels of source, or another error code.
+
+ @see PaStreamChannelLevel, paMeterLevels
+*/
+PaError Pa_GetStreamLevels( PaStream *stream, PaStreamTapSource source,
+                            PaStreamChannelLevel *levels, int channelCount );
+
+
+/** Mark an output channel of a stream silent, or active again. The output
+ of a silent channel is zeroed instead of converted from the buffer the
+ stream callback fills, which may leave the channel as it is, and host APIs
+ whose output buffers keep what was written to them, such as ASIO, zero each
+ of their buffers once and then skip the channel until it is active again.
+ This saves converting the unused channels of a stream opened with many of
+ them. May be called from any thread, the stream callback included; the
+ change applies from the next host buffer. Channels are active when the
+ stream is opened and keep their marks when it is stopped and restarted.
+ Host APIs which pass their buffers to the callback directly, without
+ converting them, leave the channels as the callback wrote them.
+
+ @param channel The channel, from 0 to the channelCount of the stream's
+ output parameters minus one.
+
+ @param silent Non-zero to mark the channel silent, 0 to mark it active.
+
+ @return paNoError on success, paIncompatibleStreamHostApi if the stream
+ has no output processed by PortAudio's buffer processor,
+ paInvalidChannelCount if channel isn't a channel of the stream, or another
+ error code.
+*/
+PaError Pa_SetStreamOutputChannelSilent( PaStream *stream, int channel, int silent );
+
+
+/** Set the gain of an output channel of a stream, or of all of them. The
+ output the stream callback returns is multiplied by the gain of its channel
+ and by the gain of the stream as it is converted to the host's sample format,
+ and a new gain is reached by a linear ramp over rampTime so that changing it
+ doesn't click. Gains are 1 when the stream is opened and are kept when it is
+ stopped and restarted, a ramp in progress then ends at its gain. May be
+ called from any thread, the stream callback included, but not from two
+ threads at once for the same stream; the change applies from the next host
+ buffer, and a ramp lasts at least the rest of that buffer.
+
+ Only output of the paFloat32 sample format which PortAudio's buffer
+ processor converts can have a gain. Host APIs which pass their buffers to
+ the callback directly stop doing so once a gain was set.
+
+ @param channel The channel, from 0 to the channelCount of the stream's
+ output parameters minus one, or -1 for the gain of the stream.
+
+ @param gain The factor to multiply the samples by, 1 to leave them as they
+ are and 0 to mute them. Samples beyond full scale are clipped as if the
+ callback had returned them, unless the stream was opened with paClipOff.
+
+ @param rampTime The time in seconds to reach gain in, 0 to jump to it.
+
+ @return paNoError on success, paIncompatibleStreamHostApi if the stream's
+ output isn't paFloat32 output converted by PortAudio's buffer processor,
+ paInvalidChannelCount if channel is neither -1 nor a channel of the stream,
+ or another error code.
+*/
+PaError Pa_SetStreamOutputGain( PaStream *stream, int channel, float gain, PaTime rampTime );
+
+
+/** Retrieve the number of bytes of memory PortAudio allocated for a stream:
+ the stream itself, the host buffers it keeps, the temporary buffers of the
+ sample conversion and block adaption, ring buffers, and the buffers of
+ sample rate conversion and channel matrices. Memory which belongs to the
+ host API's driver or library, and memory shared by all streams, is not
+ included.
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @return The number of bytes, which may grow while the stream runs if the
+ host API allocates buffers on demand, 0 for host APIs which don't account
+ for the memory of their streams, or a PaErrorCode (which are always
+ negative) if PortAudio is not initialized or an error is encountered.
+*/
+signed long Pa_GetStreamMemoryUsage( PaStream* stream );
+
+
 /** Read samples from an input stream. The function doesn't return until
  the entire buffer has been filled - this may involve waiting for the operating
  system to supply the data.
@@ -1175,6 +2129,131 @@ PaError Pa_WriteStream( PaStream* stream,
                         unsigned long frames );
 
 
+/** Read samples from an input stream into several buffers, as consecutive
+ calls to Pa_ReadStream() would, but with the argument checks done once. Host
+ APIs which support it fill the buffers in as few passes over the host's
+ buffers as possible, so an application reading small blocks doesn't pay the
+ cost of a Pa_ReadStream() call for each of them.
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @param buffers An array of bufferCount buffers, each as the buffer parameter
+ of Pa_ReadStream(). For streams opened with paNonInterleaved each entry is
+ an array of buffer pointers, one for each channel.
+
+ @param frames An array of bufferCount frame counts, the number of frames to
+ read into each buffer. Buffers with a frame count of 0 are skipped, and may
+ be NULL.
+
+ @param bufferCount The number of buffers.
+
+ @return On success PaNoError will be returned, or paInputOverflowed if input
+ data was discarded before any of the buffers were filled. Any other error
+ ends the call, possibly after some of the buffers were filled.
+
+ @see Pa_ReadStream
+*/
+PaError Pa_ReadStreamV( PaStream* stream,
+                        void * const *buffers,
+                        const unsigned long *frames,
+                        unsigned long bufferCount );
+
+
+/** Write samples to an output stream from several buffers, as consecutive
+ calls to Pa_WriteStream() would, but with the argument checks done once. Host
+ APIs which support it copy the buffers in as few passes over the host's
+ buffers as possible, so an application writing small blocks doesn't pay the
+ cost of a Pa_WriteStream() call for each of them.
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @param buffers An array of bufferCount buffers, each as the buffer parameter
+ of Pa_WriteStream(). For streams opened with paNonInterleaved each entry is
+ an array of buffer pointers, one for each channel.
+
+ @param frames An array of bufferCount frame counts, the number of frames to
+ write from each buffer. Buffers with a frame count of 0 are skipped, and may
+ be NULL.
+
+ @param bufferCount The number of buffers.
+
+ @return On success PaNoError will be returned, or paOutputUnderflowed if
+ additional output data was inserted before any of the buffers were written.
+ Any other error ends the call, possibly after some of the buffers were
+ written.
+
+ @see Pa_WriteStream
+*/
+PaError Pa_WriteStreamV( PaStream* stream,
+                         const void * const *buffers,
+                         const unsigned long *frames,
+                         unsigned long bufferCount );
+
+
+/** Read samples from an input stream as Pa_ReadStream() does, but wait at
+ most timeoutSeconds for them. With a timeout of 0 the call doesn't wait, so
+ an event loop can serve many streams without a thread each, see the host
+ API specific functions returning a descriptor or handle to wait on, such as
+ PaAlsa_GetStreamPollDescriptors() and PaWinMME_GetStreamInputEvent().
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @param buffer As for Pa_ReadStream().
+
+ @param frames The number of frames to be read into buffer.
+
+ @param framesRead NULL, or receives the number of frames read, which is
+ less than frames if the call timed out. Host APIs which don't support
+ partial reads wait for all frames to be available and read all or none, so
+ frames must not exceed what the stream buffers for them.
+
+ @param timeoutSeconds The longest time to wait, 0 not to wait at all. A
+ negative timeout waits as long as Pa_ReadStream() would.
+
+ @return paNoError or paInputOverflowed as Pa_ReadStream(), or paTimedOut if
+ fewer than frames frames were read, which takes precedence over
+ paInputOverflowed.
+
+ @see Pa_ReadStream, Pa_GetStreamReadAvailable
+*/
+PaError Pa_ReadStreamTimeout( PaStream* stream,
+                              void *buffer,
+                              unsigned long frames,
+                              unsigned long *framesRead,
+                              double timeoutSeconds );
+
+
+/** Write samples to an output stream as Pa_WriteStream() does, but wait at
+ most timeoutSeconds for room for them. With a timeout of 0 the call doesn't
+ wait, see Pa_ReadStreamTimeout().
+
+ @param stream A pointer to an open stream previously created with Pa_OpenStream.
+
+ @param buffer As for Pa_WriteStream().
+
+ @param frames The number of frames to be written from buffer.
+
+ @param framesWritten NULL, or receives the number of frames written, which
+ is less than frames if the call timed out. Host APIs which don't support
+ partial writes wait for room for all frames and write all or none, so
+ frames must not exceed what the stream buffers for them.
+
+ @param timeoutSeconds The longest time to wait, 0 not to wait at all. A
+ negative timeout waits as long as Pa_WriteStream() would.
+
+ @return paNoError or paOutputUnderflowed as Pa_WriteStream(), or paTimedOut
+ if fewer than frames frames were written, which takes precedence over
+ paOutputUnderflowed.
+
+ @see Pa_WriteStream, Pa_GetStreamWriteAvailable
+*/
+PaError Pa_WriteStreamTimeout( PaStream* stream,
+                               const void *buffer,
+                               unsigned long frames,
+                               unsigned long *framesWritten,
+                               double timeoutSeconds );
+
+
 /** Retrieve the number of frames that can be read from the stream without
  waiting.
 
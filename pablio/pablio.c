@@ -46,13 +46,26 @@
 #include "portaudio.h"
 #include "pa_ringbuffer.h"
 #include "pablio.h"
+#include "pa_memorybarrier.h"
 #include <string.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <errno.h>
+#include <semaphore.h>
+#include <time.h>
+#endif
+
 /************************************************************************/
 /******** Constants *****************************************************/
 /************************************************************************/
 
 #define FRAMES_PER_BUFFER    (256)
+/* Waits are woken by the callback; the timeout only bounds a missed wakeup. */
+#define WAIT_TIMEOUT_MSEC    (100)
 
 /************************************************************************/
 /******** Prototypes ****************************************************/
@@ -61,8 +74,15 @@
 static int blockingIOCallback( void *inputBuffer, void *outputBuffer,
                                unsigned long framesPerBuffer,
                                PaTimestamp outTime, void *userData );
-static PaError PABLIO_InitFIFO( RingBuffer *rbuf, long numFrames, long bytesPerFrame );
-static PaError PABLIO_TermFIFO( RingBuffer *rbuf );
+static PaError PABLIO_InitFIFO( PaUtilRingBuffer64 *rbuf, long numFrames, long bytesPerFrame );
+static PaError PABLIO_TermFIFO( PaUtilRingBuffer64 *rbuf );
+static PaError PABLIO_InitSemaphore( void **semaphorePtr );
+static void PABLIO_TermSemaphore( void *semaphore );
+static void PABLIO_PostSemaphore( void *semaphore );
+static void PABLIO_WaitSemaphore( void *semaphore, long msec );
+static void PABLIO_WaitForFIFO( PaUtilRingBuffer64 *rbuf, long numFrames, int forWrite,
+                                volatile int *waiting, void *semaphore );
+static void PABLIO_WakeWaiter( volatile int *waiting, void *semaphore );
 
 /************************************************************************/
 /******** Functions *****************************************************/
@@ -76,40 +96,159 @@ static int blockingIOCallback( void *inputBuffer, void *outputBuffer,
                                PaTimestamp outTime, void *userData )
 {
     PABLIO_Stream *data = (PABLIO_Stream*)userData;
-    long numBytes = data->bytesPerFrame * framesPerBuffer;
     (void) outTime;
 
     /* This may get called with NULL inputBuffer during initial setup. */
     if( inputBuffer != NULL )
     {
-        PaUtil_WriteRingBuffer( &data->inFIFO, inputBuffer, numBytes );
+        PaUtil_WriteRingBuffer64( &data->inFIFO, inputBuffer, framesPerBuffer );
+        PABLIO_WakeWaiter( &data->inWaiting, data->inSemaphore );
     }
     if( outputBuffer != NULL )
     {
-        int i;
-        int numRead = PaUtil_ReadRingBuffer( &data->outFIFO, outputBuffer, numBytes );
+        long numRead = (long) PaUtil_ReadRingBuffer64( &data->outFIFO, outputBuffer, framesPerBuffer );
         /* Zero out remainder of buffer if we run out of data. */
-        for( i=numRead; i<numBytes; i++ )
+        if( numRead < (long) framesPerBuffer )
         {
-            ((char *)outputBuffer)[i] = 0;
+            memset( (char *)outputBuffer + numRead * data->bytesPerFrame, 0,
+                    (framesPerBuffer - numRead) * data->bytesPerFrame );
         }
+        PABLIO_WakeWaiter( &data->outWaiting, data->outSemaphore );
     }
 
     return 0;
 }
 
-/* Allocate buffer. */
-static PaError PABLIO_InitFIFO( RingBuffer *rbuf, long numFrames, long bytesPerFrame )
+/* Called from the callback after it moved data through a FIFO.
+ * Only posts if someone is waiting, so the semaphore doesn't count up
+ * while nobody blocks.
+ */
+static void PABLIO_WakeWaiter( volatile int *waiting, void *semaphore )
+{
+    /* Make the FIFO update visible before looking at the flag. */
+    PaUtil_FullMemoryBarrier();
+    if( *waiting )
+    {
+        *waiting = 0;
+        PABLIO_PostSemaphore( semaphore );
+    }
+}
+
+/* Wait until numFrames can be written to (forWrite) or read from a FIFO.
+ * The waiting flag is raised before the FIFO is checked again, so a
+ * callback running in between either sees the flag or has already made
+ * room that the check finds.
+ */
+static void PABLIO_WaitForFIFO( PaUtilRingBuffer64 *rbuf, long numFrames, int forWrite,
+                                volatile int *waiting, void *semaphore )
+{
+    while( 1 )
+    {
+        long available = forWrite ? (long) PaUtil_GetRingBuffer64WriteAvailable( rbuf )
+                                  : (long) PaUtil_GetRingBuffer64ReadAvailable( rbuf );
+        if( available >= numFrames ) break;
+
+        *waiting = 1;
+        PaUtil_FullMemoryBarrier();
+        available = forWrite ? (long) PaUtil_GetRingBuffer64WriteAvailable( rbuf )
+                             : (long) PaUtil_GetRingBuffer64ReadAvailable( rbuf );
+        if( available >= numFrames )
+        {
+            *waiting = 0;
+            break;
+        }
+        PABLIO_WaitSemaphore( semaphore, WAIT_TIMEOUT_MSEC );
+    }
+}
+
+/* Create a semaphore with a count of zero. */
+static PaError PABLIO_InitSemaphore( void **semaphorePtr )
+{
+#if defined(_WIN32)
+    HANDLE semaphore = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL );
+    if( semaphore == NULL ) return paInsufficientMemory;
+    *semaphorePtr = (void *) semaphore;
+#elif defined(__APPLE__)
+    dispatch_semaphore_t semaphore = dispatch_semaphore_create( 0 );
+    if( semaphore == NULL ) return paInsufficientMemory;
+    *semaphorePtr = (void *) semaphore;
+#else
+    sem_t *semaphore = (sem_t *) malloc( sizeof(sem_t) );
+    if( semaphore == NULL ) return paInsufficientMemory;
+    if( sem_init( semaphore, 0, 0 ) != 0 )
+    {
+        free( semaphore );
+        return paInsufficientMemory;
+    }
+    *semaphorePtr = (void *) semaphore;
+#endif
+    return paNoError;
+}
+
+static void PABLIO_TermSemaphore( void *semaphore )
+{
+    if( semaphore == NULL ) return;
+#if defined(_WIN32)
+    CloseHandle( (HANDLE) semaphore );
+#elif defined(__APPLE__)
+    dispatch_release( (dispatch_semaphore_t) semaphore );
+#else
+    sem_destroy( (sem_t *) semaphore );
+    free( semaphore );
+#endif
+}
+
+/* Lock free, safe to call from the callback. */
+static void PABLIO_PostSemaphore( void *semaphore )
+{
+#if defined(_WIN32)
+    ReleaseSemaphore( (HANDLE) semaphore, 1, NULL );
+#elif defined(__APPLE__)
+    dispatch_semaphore_signal( (dispatch_semaphore_t) semaphore );
+#else
+    sem_post( (sem_t *) semaphore );
+#endif
+}
+
+static void PABLIO_WaitSemaphore( void *semaphore, long msec )
+{
+#if defined(_WIN32)
+    WaitForSingleObject( (HANDLE) semaphore, (DWORD) msec );
+#elif defined(__APPLE__)
+    dispatch_semaphore_wait( (dispatch_semaphore_t) semaphore,
+                             dispatch_time( DISPATCH_TIME_NOW, (int64_t) msec * 1000000 ) );
+#else
+    struct timespec deadline;
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += msec / 1000;
+    deadline.tv_nsec += (msec % 1000) * 1000000;
+    if( deadline.tv_nsec >= 1000000000 )
+    {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while( sem_timedwait( (sem_t *) semaphore, &deadline ) != 0 && errno == EINTR )
+        ;
+#endif
+}
+
+/* Allocate buffer. The FIFO counts frames and may hold any number of them. */
+static PaError PABLIO_InitFIFO( PaUtilRingBuffer64 *rbuf, long numFrames, long bytesPerFrame )
 {
     long numBytes = numFrames * bytesPerFrame;
     char *buffer = (char *) malloc( numBytes );
     if( buffer == NULL ) return paInsufficientMemory;
     memset( buffer, 0, numBytes );
-    return (PaError) PaUtil_InitializeRingBuffer( rbuf, numBytes, buffer );
+    if( PaUtil_InitializeRingBuffer64( rbuf, bytesPerFrame, numFrames, buffer ) < 0 )
+    {
+        free( buffer );
+        return paInsufficientMemory;
+    }
+    return paNoError;
 }
 
 /* Free buffer. */
-static PaError PABLIO_TermFIFO( RingBuffer *rbuf )
+static PaError PABLIO_TermFIFO( PaUtilRingBuffer64 *rbuf )
 {
     if( rbuf->buffer ) free( rbuf->buffer );
     rbuf->buffer = NULL;
@@ -122,15 +261,21 @@ static PaError PABLIO_TermFIFO( RingBuffer *rbuf )
  */
 long WriteAudioStream( PABLIO_Stream *aStream, void *data, long numFrames )
 {
-    long bytesWritten;
+    long framesWritten;
     char *p = (char *) data;
-    long numBytes = aStream->bytesPerFrame * numFrames;
-    while( numBytes > 0)
+    long framesLeft = numFrames;
+    while( framesLeft > 0)
     {
-        bytesWritten = PaUtil_WriteRingBuffer( &aStream->outFIFO, p, numBytes );
-        numBytes -= bytesWritten;
-        p += bytesWritten;
-        if( numBytes > 0) Pa_Sleep(10);
+        framesWritten = (long) PaUtil_WriteRingBuffer64( &aStream->outFIFO, p, framesLeft );
+        framesLeft -= framesWritten;
+        p += framesWritten * aStream->bytesPerFrame;
+        if( framesLeft > 0)
+        {
+            /* Sleep until the callback has made room for the rest, or as much as fits. */
+            long framesWanted = (framesLeft < aStream->framesPerFIFO) ? framesLeft : aStream->framesPerFIFO;
+            PABLIO_WaitForFIFO( &aStream->outFIFO, framesWanted, 1,
+                                &aStream->outWaiting, aStream->outSemaphore );
+        }
     }
     return numFrames;
 }
@@ -141,27 +286,89 @@ long WriteAudioStream( PABLIO_Stream *aStream, void *data, long numFrames )
  */
 long ReadAudioStream( PABLIO_Stream *aStream, void *data, long numFrames )
 {
-    long bytesRead;
+    long framesRead;
     char *p = (char *) data;
-    long numBytes = aStream->bytesPerFrame * numFrames;
-    while( numBytes > 0)
+    long framesLeft = numFrames;
+    while( framesLeft > 0)
     {
-        bytesRead = PaUtil_ReadRingBuffer( &aStream->inFIFO, p, numBytes );
-        numBytes -= bytesRead;
-        p += bytesRead;
-        if( numBytes > 0) Pa_Sleep(10);
+        framesRead = (long) PaUtil_ReadRingBuffer64( &aStream->inFIFO, p, framesLeft );
+        framesLeft -= framesRead;
+        p += framesRead * aStream->bytesPerFrame;
+        if( framesLeft > 0)
+        {
+            /* Sleep until the callback has recorded the rest, or as much as fits. */
+            long framesWanted = (framesLeft < aStream->framesPerFIFO) ? framesLeft : aStream->framesPerFIFO;
+            PABLIO_WaitForFIFO( &aStream->inFIFO, framesWanted, 0,
+                                &aStream->inWaiting, aStream->inSemaphore );
+        }
     }
     return numFrames;
 }
 
+/************************************************************
+ * Get direct access to the output ring buffer.
+ * The FIFO holds whole frames, so a frame never straddles the two regions.
+ */
+long GetAudioStreamWriteRegions( PABLIO_Stream *aStream, long numFrames,
+                                 void **dataPtr1, long *numFrames1,
+                                 void **dataPtr2, long *numFrames2 )
+{
+    ring_buffer_index_t size1, size2, framesAvailable;
+    if( numFrames > aStream->framesPerFIFO ) numFrames = aStream->framesPerFIFO;
+
+    PABLIO_WaitForFIFO( &aStream->outFIFO, numFrames, 1,
+                        &aStream->outWaiting, aStream->outSemaphore );
+    framesAvailable = PaUtil_GetRingBuffer64WriteRegions( &aStream->outFIFO, numFrames,
+                      dataPtr1, &size1, dataPtr2, &size2 );
+    *numFrames1 = (long) size1;
+    *numFrames2 = (long) size2;
+    return (long) framesAvailable;
+}
+
+/************************************************************
+ * Queue frames written to the regions for playback.
+ */
+long AdvanceAudioStreamWrite( PABLIO_Stream *aStream, long numFrames )
+{
+    PaUtil_AdvanceRingBuffer64WriteIndex( &aStream->outFIFO, numFrames );
+    return numFrames;
+}
+
+/************************************************************
+ * Get direct access to the input ring buffer.
+ */
+long GetAudioStreamReadRegions( PABLIO_Stream *aStream, long numFrames,
+                                void **dataPtr1, long *numFrames1,
+                                void **dataPtr2, long *numFrames2 )
+{
+    ring_buffer_index_t size1, size2, framesAvailable;
+    if( numFrames > aStream->framesPerFIFO ) numFrames = aStream->framesPerFIFO;
+
+    PABLIO_WaitForFIFO( &aStream->inFIFO, numFrames, 0,
+                        &aStream->inWaiting, aStream->inSemaphore );
+    framesAvailable = PaUtil_GetRingBuffer64ReadRegions( &aStream->inFIFO, numFrames,
+                      dataPtr1, &size1, dataPtr2, &size2 );
+    *numFrames1 = (long) size1;
+    *numFrames2 = (long) size2;
+    return (long) framesAvailable;
+}
+
+/************************************************************
+ * Release frames consumed from the regions.
+ */
+long AdvanceAudioStreamRead( PABLIO_Stream *aStream, long numFrames )
+{
+    PaUtil_AdvanceRingBuffer64ReadIndex( &aStream->inFIFO, numFrames );
+    return numFrames;
+}
+
 /************************************************************
  * Return the number of frames that could be written to the stream without
  * having to wait.
  */
 long GetAudioStreamWriteable( PABLIO_Stream *aStream )
 {
-    int bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-    return bytesEmpty / aStream->bytesPerFrame;
+    return (long) PaUtil_GetRingBuffer64WriteAvailable( &aStream->outFIFO );
 }
 
 /************************************************************
@@ -170,21 +377,16 @@ long GetAudioStreamWriteable( PABLIO_Stream *aStream )
  */
 long GetAudioStreamReadable( PABLIO_Stream *aStream )
 {
-    int bytesFull = PaUtil_GetRingBufferReadAvailable( &aStream->inFIFO );
-    return bytesFull / aStream->bytesPerFrame;
+    return (long) PaUtil_GetRingBuffer64ReadAvailable( &aStream->inFIFO );
 }
 
-/************************************************************/
-static unsigned long RoundUpToNextPowerOf2( unsigned long n )
+/************************************************************
+ * Return the number of frames the FIFOs can hold, which is the
+ * latency pablio adds on top of the PortAudio buffers.
+ */
+long GetAudioStreamLatencyFrames( PABLIO_Stream *aStream )
 {
-    long numBits = 0;
-    if( ((n-1) & n) == 0) return n; /* Already Power of two. */
-    while( n > 0 )
-    {
-        n= n>>1;
-        numBits++;
-    }
-    return (1<<numBits);
+    return aStream->framesPerFIFO;
 }
 
 /************************************************************
@@ -226,11 +428,12 @@ PaError OpenAudioStream( PABLIO_Stream **rwblPtr, double sampleRate,
     if( err != paNoError ) goto error;
 
     /* Warning: numFrames must be larger than amount of data processed per interrupt
-     *    inside PA to prevent glitches. Just to be safe, adjust size upwards.
+     *    inside PA to prevent glitches. The FIFOs take any size, so this is
+     *    not rounded up to a power of 2, which could nearly double the latency.
      */
     minNumBuffers = 2 * Pa_GetMinNumBuffers( FRAMES_PER_BUFFER, sampleRate );
     numFrames = minNumBuffers * FRAMES_PER_BUFFER;
-    numFrames = RoundUpToNextPowerOf2( numFrames );
+    aStream->framesPerFIFO = numFrames;
 
     /* Initialize Ring Buffers */
     doRead = ((flags & PABLIO_READ) != 0);
@@ -239,15 +442,19 @@ PaError OpenAudioStream( PABLIO_Stream **rwblPtr, double sampleRate,
     {
         err = PABLIO_InitFIFO( &aStream->inFIFO, numFrames, aStream->bytesPerFrame );
         if( err != paNoError ) goto error;
+        err = PABLIO_InitSemaphore( &aStream->inSemaphore );
+        if( err != paNoError ) goto error;
     }
     if(doWrite)
     {
-        long numBytes;
+        long numFramesEmpty;
         err = PABLIO_InitFIFO( &aStream->outFIFO, numFrames, aStream->bytesPerFrame );
         if( err != paNoError ) goto error;
+        err = PABLIO_InitSemaphore( &aStream->outSemaphore );
+        if( err != paNoError ) goto error;
         /* Make Write FIFO appear full initially. */
-        numBytes = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-        PaUtil_AdvanceRingBufferWriteIndex( &aStream->outFIFO, numBytes );
+        numFramesEmpty = (long) PaUtil_GetRingBuffer64WriteAvailable( &aStream->outFIFO );
+        PaUtil_AdvanceRingBuffer64WriteIndex( &aStream->outFIFO, numFramesEmpty );
     }
 
     /* Open a PortAudio stream that we will use to communicate with the underlying
@@ -286,18 +493,12 @@ error:
 PaError CloseAudioStream( PABLIO_Stream *aStream )
 {
     PaError err;
-    int bytesEmpty;
-    int byteSize = aStream->outFIFO.bufferSize;
 
     /* If we are writing data, make sure we play everything written. */
-    if( byteSize > 0 )
+    if( aStream->outFIFO.buffer != NULL && aStream->stream != NULL )
     {
-        bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-        while( bytesEmpty < byteSize )
-        {
-            Pa_Sleep( 10 );
-            bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &aStream->outFIFO );
-        }
+        PABLIO_WaitForFIFO( &aStream->outFIFO, aStream->framesPerFIFO, 1,
+                            &aStream->outWaiting, aStream->outSemaphore );
     }
 
     err = Pa_StopStream( aStream->stream );
@@ -309,6 +510,8 @@ PaError CloseAudioStream( PABLIO_Stream *aStream )
 error:
     PABLIO_TermFIFO( &aStream->inFIFO );
     PABLIO_TermFIFO( &aStream->outFIFO );
+    PABLIO_TermSemaphore( aStream->inSemaphore );
+    PABLIO_TermSemaphore( aStream->outSemaphore );
     free( aStream );
     return err;
 }
@@ -58,11 +58,18 @@ extern "C"
 
 typedef struct
 {
-    RingBuffer   inFIFO;
-    RingBuffer   outFIFO;
+    PaUtilRingBuffer64 inFIFO;
+    PaUtilRingBuffer64 outFIFO;
     PortAudioStream *stream;
     int          bytesPerFrame;
     int          samplesPerFrame;
+    long         framesPerFIFO;  /* Size of each FIFO, not rounded to a power of 2. */
+    /* Semaphores posted by the callback when a reader or writer is waiting.
+     * They are opaque handles private to pablio.c. */
+    void        *inSemaphore;
+    void        *outSemaphore;
+    volatile int inWaiting;
+    volatile int outWaiting;
 }
 PABLIO_Stream;
 
@@ -85,6 +92,43 @@ long WriteAudioStream( PABLIO_Stream *aStream, void *data, long numFrames );
  */
 long ReadAudioStream( PABLIO_Stream *aStream, void *data, long numFrames );
 
+/************************************************************
+ * Get direct access to the output ring buffer, to avoid copying
+ * through WriteAudioStream().
+ * Will not return until numFrames can be written. The space is
+ * returned as up to two regions, the second one is used when the
+ * space wraps around the end of the ring buffer.
+ * Call AdvanceAudioStreamWrite() once the data is in place.
+ * Returns the number of frames in both regions.
+ */
+long GetAudioStreamWriteRegions( PABLIO_Stream *aStream, long numFrames,
+                                 void **dataPtr1, long *numFrames1,
+                                 void **dataPtr2, long *numFrames2 );
+
+/************************************************************
+ * Queue numFrames written to the regions returned by
+ * GetAudioStreamWriteRegions() for playback.
+ */
+long AdvanceAudioStreamWrite( PABLIO_Stream *aStream, long numFrames );
+
+/************************************************************
+ * Get direct access to the input ring buffer, to avoid copying
+ * through ReadAudioStream().
+ * Will not return until numFrames can be read. The data is
+ * returned as up to two regions, like GetAudioStreamWriteRegions().
+ * Call AdvanceAudioStreamRead() once the data has been consumed.
+ * Returns the number of frames in both regions.
+ */
+long GetAudioStreamReadRegions( PABLIO_Stream *aStream, long numFrames,
+                                void **dataPtr1, long *numFrames1,
+                                void **dataPtr2, long *numFrames2 );
+
+/************************************************************
+ * Release numFrames read from the regions returned by
+ * GetAudioStreamReadRegions().
+ */
+long AdvanceAudioStreamRead( PABLIO_Stream *aStream, long numFrames );
+
 /************************************************************
  * Return the number of frames that could be written to the stream without
  * having to wait.
@@ -97,6 +141,11 @@ long GetAudioStreamWriteable( PABLIO_Stream *aStream );
  */
 long GetAudioStreamReadable( PABLIO_Stream *aStream );
 
+/************************************************************
+ * Return the number of frames of latency added by the FIFOs.
+ */
+long GetAudioStreamLatencyFrames( PABLIO_Stream *aStream );
+
 /************************************************************
  * Opens a PortAudio stream with default characteristics.
  * Allocates PABLIO_Stream structure.
@@ -43,6 +43,7 @@
 #include <math.h>
 #include "qa_tools.h"
 #include "audio_analyzer.h"
+#include "paqa_fft.h"
 #include "write_wav.h"
 
 #define PAQA_POP_THRESHOLD  (0.04)
@@ -348,6 +349,7 @@ void PaQa_FilterRecording( PaQaRecording *input, PaQaRecording *output, BiquadFi
 /** Scan until we get a correlation of a single that goes over the tolerance level,
  * peaks then drops to half the peak.
  * Look for inverse correlation as well.
+ * The correlations are computed with FFTs, a block at a time, so the scan can stop early.
  */
 double PaQa_FindFirstMatch( PaQaRecording *recording, float *buffer, int numFrames, double threshold  )
 {
@@ -359,23 +361,37 @@ double PaQa_FindFirstMatch( PaQaRecording *recording, float *buffer, int numFram
 	double inverseMaxSum = 0.0;
 	int inversePeakIndex = -1;
 	double location = -1.0;
+	PaQaCorrelator correlator;
+	double *sums = NULL;
+	int blockSize;
+	int numSums = 0;
+	int result;
 
     QA_ASSERT_TRUE( "numFrames out of bounds", (numFrames < recording->numFrames) );
+	result = PaQa_InitializeCorrelator( &correlator, buffer, numFrames );
+	QA_ASSERT_EQUALS( "PaQa_InitializeCorrelator failed", 0, result );
+	blockSize = PaQa_GetCorrelatorBlockSize( &correlator );
+	sums = (double *) malloc( sizeof(double) * blockSize );
+	if( sums == NULL )
+	{
+		PaQa_TerminateCorrelator( &correlator );
+		QA_ASSERT_TRUE( "Allocate correlation buffer.", 0 );
+	}
 
-	for( ic=0; ic<maxCorrelations; ic++ )
+	for( ic=0, is=0; ic<maxCorrelations; ic++, is++ )
 	{
 		int pastPeak;
 		int inversePastPeak;
+		double sum;
 		
-		double sum = 0.0;
-		// Correlate buffer against the recording.
-		float *recorded = &recording->buffer[ ic ];
-		for( is=0; is<numFrames; is++ )
+		// Correlate the next block of offsets of buffer against the recording.
+		if( is == numSums )
 		{
-			float s1 = buffer[is];
-			float s2 = *recorded++;
-			sum += s1 * s2;
+			numSums = (maxCorrelations - ic < blockSize) ? (maxCorrelations - ic) : blockSize;
+			PaQa_Correlate( &correlator, &recording->buffer[ ic ], numSums, sums );
+			is = 0;
 		}
+		sum = sums[is];
 		if( (sum > maxSum) )
 		{
 			maxSum = sum;
@@ -403,6 +419,8 @@ double PaQa_FindFirstMatch( PaQaRecording *recording, float *buffer, int numFram
 		}
 		
 	}
+	free( sums );
+	PaQa_TerminateCorrelator( &correlator );
 	//printf("PaQa_FindFirstMatch: location = %4d\n", (int)location );
 	return location;
 error:
@@ -687,6 +705,7 @@ int PaQa_AnalyseRecording( PaQaRecording *recording, PaQaTestTone *testTone, PaQ
     int result = 0;
 
 	memset( analysisResult, 0, sizeof(PaQaAnalysisResult) );
+	analysisResult->harmonicDistortion = -1.0;
 	result = PaQa_MeasureLatency( recording, testTone, analysisResult );
     QA_ASSERT_EQUALS( "latency measurement", 0, result );
 	
@@ -699,6 +718,16 @@ int PaQa_AnalyseRecording( PaQaRecording *recording, PaQaTestTone *testTone, PaQ
 
 		result = PaQa_DetectPhaseError( recording, testTone, analysisResult );
 		QA_ASSERT_EQUALS( "detect phase error", 0, result );
+
+		// Skip the first cycle, where the signal fades in.
+		{
+			int startFrame = (int) analysisResult->latency + (int) (testTone->sampleRate / testTone->frequency + 0.5);
+			if( startFrame < recording->numFrames )
+			{
+				analysisResult->harmonicDistortion = PaQa_MeasureHarmonicDistortion( &recording->buffer[startFrame],
+						recording->numFrames - startFrame, testTone->frequency, testTone->sampleRate );
+			}
+		}
 	}
 	return 0;
 error:
@@ -84,6 +84,8 @@ typedef struct PaQaAnalysisResult_s
 	double    droppedFramesPosition;
 	double    numAddedFrames;
 	double    addedFramesPosition;
+	/** Total harmonic distortion ratio, negative if it could not be measured. */
+	double    harmonicDistortion;
 } PaQaAnalysisResult;
 
 
@@ -38,10 +38,19 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <limits.h>
 #include <memory.h>
 #include <math.h>
 #include <string.h>
 
+#if !defined(WIN32) && !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+// Analyse the recordings of the glitch tests on worker threads with -j.
+#define PAQA_ANALYSIS_THREADS
+#endif
+
 #include "portaudio.h"
 
 #include "qa_tools.h"
@@ -61,6 +70,7 @@ int g_testsFailed = 0;
 #define DEFAULT_FRAMES_PER_BUFFER            (0)
 #define PAQA_WAIT_STREAM_MSEC                (100)
 #define PAQA_TEST_DURATION                   (1.2)
+#define MAX_ANALYSIS_THREADS                 (32)
 
 // Use two separate streams instead of one full duplex stream.
 #define PAQA_FLAG_TWO_STREAMS       (1<<0)
@@ -135,6 +145,8 @@ typedef struct UserOptions_s
 	int           outputLatency;
 	int           saveBadWaves;
 	int           verbose;
+	int           latencySweep;  // sweep buffer sizes and suggested latencies instead of the glitch tests
+	int           analysisThreads; // threads analysing the glitch test recordings, 0 for one per processor, 1 for none
 	int           waveFileCount;
 	const char   *waveFilePath;
 	PaDeviceIndex inputDevice;
@@ -792,96 +804,295 @@ static void PaQa_PrintFullErrorReport( PaQaAnalysisResult *analysisResultPtr, in
 	printf("     added frames at: %10.3f\n", analysisResultPtr->addedFramesPosition );
 	printf("  num dropped frames: %10.3f\n", analysisResultPtr->numDroppedFrames );
 	printf("   dropped frames at: %10.3f\n", analysisResultPtr->droppedFramesPosition );
+	printf(" harmonic distortion: %10.5f\n", analysisResultPtr->harmonicDistortion );
 }
 
 /*******************************************************************/
-/** 
- * Test loopback connection using the given parameters.
- * @return number of channels with glitches, or negative error.
+/**
+ * A glitch test whose recordings are analysed on the analysis threads, or a piece
+ * of text queued after such tests. The queue is reported in order by the main thread,
+ * so the results come out as if the tests had been analysed one after the other.
  */
-static int PaQa_SingleLoopBackTest( UserOptions *userOptions, TestParameters *testParams )
+typedef struct PendingTest_s
+{
+	LoopbackContext     loopbackContext;
+	TestParameters      testParams;      // loopbackContext.test points here
+	PaQaTestTone        testTones[MAX_NUM_RECORDINGS];
+	PaQaAnalysisResult  analysisResults[MAX_NUM_RECORDINGS];
+	int                 hasTest;         // 0 for text
+	int                 channelsStarted; // guarded by g_AnalysisLock
+	int                 channelsLeft;    // guarded by g_AnalysisLock
+	int                *totalBadChannels;
+	int                 buffered;        // row is printed when the test is reported, not while it runs
+	char                row[1024];
+	struct PendingTest_s *next;
+} PendingTest;
+
+typedef struct AnalysisPool_s
 {
+	int                 numThreads;      // 0 to analyse each test as soon as it has run
+	int                 numQueued;       // tests and text in the queue
+	PendingTest        *head;            // only changed by the main thread
+	PendingTest        *tail;
+#ifdef PAQA_ANALYSIS_THREADS
+	pthread_t           threads[MAX_ANALYSIS_THREADS];
+	pthread_cond_t      channelQueued;
+	pthread_cond_t      channelAnalysed;
+	int                 quit;
+#endif
+} AnalysisPool;
+
+static AnalysisPool g_AnalysisPool;
+
+#ifdef PAQA_ANALYSIS_THREADS
+static pthread_mutex_t g_AnalysisLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t g_CountLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*******************************************************************/
+void PaQa_CountTest( int *counter )
+{
+#ifdef PAQA_ANALYSIS_THREADS
+	pthread_mutex_lock( &g_CountLock );
+	*counter += 1;
+	pthread_mutex_unlock( &g_CountLock );
+#else
+	*counter += 1;
+#endif
+}
+
+#ifdef PAQA_ANALYSIS_THREADS
+/*******************************************************************/
+/** Find a channel no thread analyses yet, with g_AnalysisLock held. */
+static PendingTest *PaQa_TakeQueuedChannel( int *channel )
+{
+	PendingTest *test;
+	for( test = g_AnalysisPool.head; test != NULL; test = test->next )
+	{
+		if( test->hasTest && test->channelsStarted < test->testParams.samplesPerFrame )
+		{
+			*channel = test->channelsStarted++;
+			return test;
+		}
+	}
+	return NULL;
+}
+
+/*******************************************************************/
+static void *PaQa_AnalysisThread( void *arg )
+{
+	(void) arg;
+	pthread_mutex_lock( &g_AnalysisLock );
+	while( !g_AnalysisPool.quit )
+	{
+		int channel;
+		PendingTest *test = PaQa_TakeQueuedChannel( &channel );
+		if( test == NULL )
+		{
+			pthread_cond_wait( &g_AnalysisPool.channelQueued, &g_AnalysisLock );
+			continue;
+		}
+		pthread_mutex_unlock( &g_AnalysisLock );
+
+		PaQa_AnalyseRecording( &test->loopbackContext.recordings[channel], &test->testTones[channel],
+							  &test->analysisResults[channel] );
+
+		pthread_mutex_lock( &g_AnalysisLock );
+		test->channelsLeft -= 1;
+		pthread_cond_signal( &g_AnalysisPool.channelAnalysed );
+	}
+	pthread_mutex_unlock( &g_AnalysisLock );
+	return NULL;
+}
+#endif /* PAQA_ANALYSIS_THREADS */
+
+/*******************************************************************/
+/** Start numThreads analysis threads, all online processors if numThreads is 0. */
+static void PaQa_StartAnalysisThreads( int numThreads )
+{
+#ifdef PAQA_ANALYSIS_THREADS
 	int i;
-	LoopbackContext loopbackContext;
-	PaError err = paNoError;
-	PaQaTestTone testTone;
-	PaQaAnalysisResult analysisResult;
-	int numBadChannels = 0;
-	
-	printf("| %5d | %6d | ", ((int)(testParams->sampleRate+0.5)), testParams->framesPerBuffer );
-	fflush(stdout);
-	
-	testTone.samplesPerFrame = testParams->samplesPerFrame;
-	testTone.sampleRate = testParams->sampleRate;
-	testTone.amplitude = testParams->amplitude;
-	testTone.startDelay = 0;
-	
-	err = PaQa_SetupLoopbackContext( &loopbackContext, testParams );
-	if( err ) return err;
-	
-	err = PaQa_RunLoopback( &loopbackContext );
-	QA_ASSERT_TRUE("loopback did not run", (loopbackContext.callbackCount > 1) );
+	if( numThreads <= 0 )
+	{
+		numThreads = (int) sysconf( _SC_NPROCESSORS_ONLN );
+	}
+	if( numThreads > MAX_ANALYSIS_THREADS )
+	{
+		numThreads = MAX_ANALYSIS_THREADS;
+	}
+	memset( &g_AnalysisPool, 0, sizeof(g_AnalysisPool) );
+	pthread_cond_init( &g_AnalysisPool.channelQueued, NULL );
+	pthread_cond_init( &g_AnalysisPool.channelAnalysed, NULL );
+	for( i=0; i<numThreads; i++ )
+	{
+		if( pthread_create( &g_AnalysisPool.threads[i], NULL, PaQa_AnalysisThread, NULL ) != 0 )
+		{
+			break;
+		}
+		g_AnalysisPool.numThreads += 1;
+	}
+	if( g_AnalysisPool.numThreads == 0 )
+	{
+		pthread_cond_destroy( &g_AnalysisPool.channelQueued );
+		pthread_cond_destroy( &g_AnalysisPool.channelAnalysed );
+	}
+	printf( "Analysing recordings on %d threads.\n", g_AnalysisPool.numThreads );
+#else
+	(void) numThreads;
+	printf( "Analysis threads are not supported on this platform, ignoring -j.\n" );
+#endif
+}
 
-	printf( "%7.2f %7.2f %7.2f | ",
-		   loopbackContext.streamInfoInputLatency * 1000.0,
-		   loopbackContext.streamInfoOutputLatency * 1000.0,
-		   (loopbackContext.streamInfoInputLatency + loopbackContext.streamInfoOutputLatency) * 1000.0
-		   );
+/*******************************************************************/
+static void PaQa_StopAnalysisThreads( void )
+{
+#ifdef PAQA_ANALYSIS_THREADS
+	int i;
+	if( g_AnalysisPool.numThreads == 0 )
+	{
+		return;
+	}
+	pthread_mutex_lock( &g_AnalysisLock );
+	g_AnalysisPool.quit = 1;
+	pthread_cond_broadcast( &g_AnalysisPool.channelQueued );
+	pthread_mutex_unlock( &g_AnalysisLock );
+	for( i=0; i<g_AnalysisPool.numThreads; i++ )
+	{
+		pthread_join( g_AnalysisPool.threads[i], NULL );
+	}
+	pthread_cond_destroy( &g_AnalysisPool.channelQueued );
+	pthread_cond_destroy( &g_AnalysisPool.channelAnalysed );
+	g_AnalysisPool.numThreads = 0;
+#endif
+}
 
-	printf( "%4d/%4d/%4d, %4d/%4d/%4d | ",
-		   loopbackContext.inputOverflowCount,
-		   loopbackContext.inputUnderflowCount,
-		   loopbackContext.inputBufferCount,
-		   loopbackContext.outputOverflowCount,
-		   loopbackContext.outputUnderflowCount,
-		   loopbackContext.outputBufferCount
-		   );
+/*******************************************************************/
+static void PaQa_EnqueueTest( PendingTest *test )
+{
+#ifdef PAQA_ANALYSIS_THREADS
+	pthread_mutex_lock( &g_AnalysisLock );
+#endif
+	test->next = NULL;
+	if( g_AnalysisPool.tail != NULL )
+	{
+		g_AnalysisPool.tail->next = test;
+	}
+	else
+	{
+		g_AnalysisPool.head = test;
+	}
+	g_AnalysisPool.tail = test;
+	g_AnalysisPool.numQueued += 1;
+#ifdef PAQA_ANALYSIS_THREADS
+	if( test->hasTest )
+	{
+		pthread_cond_broadcast( &g_AnalysisPool.channelQueued );
+	}
+	pthread_mutex_unlock( &g_AnalysisLock );
+#endif
+}
+
+/*******************************************************************/
+/** Print text after the tests still being analysed, or right away if there are none. */
+static void PaQa_QueueText( const char *format, ... )
+{
+	va_list args;
+	PendingTest *text = NULL;
+
+	if( g_AnalysisPool.head != NULL )
+	{
+		text = (PendingTest *) calloc( 1, sizeof(PendingTest) );
+	}
+	va_start( args, format );
+	if( text != NULL )
+	{
+		vsnprintf( text->row, sizeof(text->row), format, args );
+		PaQa_EnqueueTest( text );
+	}
+	else
+	{
+		vprintf( format, args );
+	}
+	va_end( args );
+}
+
+/*******************************************************************/
+/** Add to the row of a test, which is printed right away unless the test is analysed later. */
+static void PaQa_AppendRow( PendingTest *test, const char *format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	if( test->buffered )
+	{
+		size_t length = strlen( test->row );
+		vsnprintf( &test->row[length], sizeof(test->row) - length, format, args );
+	}
+	else
+	{
+		vprintf( format, args );
+		fflush( stdout );
+	}
+	va_end( args );
+}
+
+/*******************************************************************/
+/**
+ * Print the results of a test whose channels were all analysed and free it.
+ * @return number of channels with glitches
+ */
+static int PaQa_ReportLoopBackTest( UserOptions *userOptions, PendingTest *test )
+{
+	int i;
+	TestParameters *testParams = &test->testParams;
+	LoopbackContext *loopbackContext = &test->loopbackContext;
+	int numBadChannels = 0;
+
+	if( test->buffered )
+	{
+		fputs( test->row, stdout );
+	}
 	
-	// Analyse recording to detect glitches.
 	for( i=0; i<testParams->samplesPerFrame; i++ )
 	{
-		double freq = PaQa_GetNthFrequency( testParams->baseFrequency, i );
-		testTone.frequency = freq;
-		
-		PaQa_AnalyseRecording(  &loopbackContext.recordings[i], &testTone, &analysisResult );
+		PaQaAnalysisResult *analysisResult = &test->analysisResults[i];
 		
 		if( i==0 )
 		{
             double latencyMSec;
 
 			printf( "%4d-%4d | ",
-				   loopbackContext.minFramesPerBuffer,
-				   loopbackContext.maxFramesPerBuffer
+				   loopbackContext->minFramesPerBuffer,
+				   loopbackContext->maxFramesPerBuffer
 				   );
 			
-			latencyMSec = 1000.0 * analysisResult.latency / testParams->sampleRate;
+			latencyMSec = 1000.0 * analysisResult->latency / testParams->sampleRate;
 			printf("%7.2f | ", latencyMSec );
 						
 		}
 		
-		if( analysisResult.valid )
+		if( analysisResult->valid )
 		{
-			int badChannel = ( (analysisResult.popPosition > 0)
-					   || (analysisResult.addedFramesPosition > 0)
-					   || (analysisResult.droppedFramesPosition > 0) );
+			int badChannel = ( (analysisResult->popPosition > 0)
+					   || (analysisResult->addedFramesPosition > 0)
+					   || (analysisResult->droppedFramesPosition > 0) );
 			
 			if( badChannel )
 			{	
 				if( userOptions->verbose )
 				{
-					PaQa_PrintFullErrorReport( &analysisResult, i );
+					PaQa_PrintFullErrorReport( analysisResult, i );
 				}
 				else
 				{
-					PaQa_PrintShortErrorReport( &analysisResult, i );
+					PaQa_PrintShortErrorReport( analysisResult, i );
 				}
-				PaQa_SaveTestResultToWaveFile( userOptions, &loopbackContext.recordings[i] );
+				PaQa_SaveTestResultToWaveFile( userOptions, &loopbackContext->recordings[i] );
 			}
 			numBadChannels += badChannel;
 		}
 		else
 		{
-			printf( "[%d] No or low signal, ampRatio = %f", i, analysisResult.amplitudeRatio );
+			printf( "[%d] No or low signal, ampRatio = %f", i, analysisResult->amplitudeRatio );
 			numBadChannels += 1;
 		}
 
@@ -894,17 +1105,169 @@ static int PaQa_SingleLoopBackTest( UserOptions *userOptions, TestParameters *te
     // Print the # errors so far to make it easier to see where the error occured.
 	printf( " - #errs = %d\n", g_testsFailed );
 
-	PaQa_TeardownLoopbackContext( &loopbackContext );
+	PaQa_TeardownLoopbackContext( loopbackContext );
 	if( numBadChannels > 0 )
 	{
-		g_testsFailed += 1;
+		PaQa_CountTest( &g_testsFailed );
+	}
+	*test->totalBadChannels += numBadChannels;
+	free( test );
+	return numBadChannels;
+}
+
+/*******************************************************************/
+/**
+ * Report the tests at the head of the queue whose channels were all analysed,
+ * waiting for them while more than maxQueued tests are queued.
+ */
+static void PaQa_ReportFinishedTests( UserOptions *userOptions, int maxQueued )
+{
+	for( ;; )
+	{
+		PendingTest *test;
+#ifdef PAQA_ANALYSIS_THREADS
+		pthread_mutex_lock( &g_AnalysisLock );
+		while( (test = g_AnalysisPool.head) != NULL && test->hasTest && test->channelsLeft > 0
+			  && g_AnalysisPool.numQueued > maxQueued )
+		{
+			pthread_cond_wait( &g_AnalysisPool.channelAnalysed, &g_AnalysisLock );
+		}
+#else
+		(void) maxQueued;
+		test = g_AnalysisPool.head;
+#endif
+		if( test == NULL || (test->hasTest && test->channelsLeft > 0) )
+		{
+#ifdef PAQA_ANALYSIS_THREADS
+			pthread_mutex_unlock( &g_AnalysisLock );
+#endif
+			return;
+		}
+		g_AnalysisPool.head = test->next;
+		if( g_AnalysisPool.head == NULL )
+		{
+			g_AnalysisPool.tail = NULL;
+		}
+		g_AnalysisPool.numQueued -= 1;
+#ifdef PAQA_ANALYSIS_THREADS
+		pthread_mutex_unlock( &g_AnalysisLock );
+#endif
+
+		if( test->hasTest )
+		{
+			PaQa_ReportLoopBackTest( userOptions, test );
+		}
+		else
+		{
+			fputs( test->row, stdout );
+			free( test );
+		}
+		fflush( stdout );
+	}
+}
+
+/*******************************************************************/
+/** 
+ * Test loopback connection using the given parameters.
+ * With analysis threads the recordings are analysed while the next test runs,
+ * and the test is reported by PaQa_ReportFinishedTests().
+ * Adds the number of channels with glitches, or a negative error, to totalBadChannels.
+ * @return 0 or negative error.
+ */
+static int PaQa_SingleLoopBackTest( UserOptions *userOptions, TestParameters *testParams, int *totalBadChannels )
+{
+	int i;
+	PendingTest *test;
+	LoopbackContext *loopbackContext;
+	PaError err = paNoError;
+	
+	if( g_AnalysisPool.numThreads > 0 )
+	{
+		// Bound the memory held by the recordings waiting to be analysed.
+		PaQa_ReportFinishedTests( userOptions, 2 * g_AnalysisPool.numThreads - 1 );
+	}
+	
+	test = (PendingTest *) calloc( 1, sizeof(PendingTest) );
+	if( test == NULL )
+	{
+		printf( "out of memory\n" );
+		PaQa_CountTest( &g_testsFailed );
+		*totalBadChannels += paInsufficientMemory;
+		return paInsufficientMemory;
+	}
+	test->hasTest = 1;
+	test->testParams = *testParams;
+	test->totalBadChannels = totalBadChannels;
+	test->buffered = ( g_AnalysisPool.numThreads > 0 );
+	loopbackContext = &test->loopbackContext;
+	
+	PaQa_AppendRow( test, "| %5d | %6d | ", ((int)(testParams->sampleRate+0.5)), testParams->framesPerBuffer );
+	
+	for( i=0; i<testParams->samplesPerFrame; i++ )
+	{
+		test->testTones[i].samplesPerFrame = testParams->samplesPerFrame;
+		test->testTones[i].sampleRate = testParams->sampleRate;
+		test->testTones[i].amplitude = testParams->amplitude;
+		test->testTones[i].startDelay = 0;
+		test->testTones[i].frequency = PaQa_GetNthFrequency( testParams->baseFrequency, i );
 	}
-	return numBadChannels;	
+	
+	err = PaQa_SetupLoopbackContext( loopbackContext, &test->testParams );
+	if( err )
+	{
+		free( test );
+		*totalBadChannels += err;
+		return err;
+	}
+	
+	err = PaQa_RunLoopback( loopbackContext );
+	QA_ASSERT_TRUE("loopback did not run", (loopbackContext->callbackCount > 1) );
+
+	PaQa_AppendRow( test, "%7.2f %7.2f %7.2f | ",
+		   loopbackContext->streamInfoInputLatency * 1000.0,
+		   loopbackContext->streamInfoOutputLatency * 1000.0,
+		   (loopbackContext->streamInfoInputLatency + loopbackContext->streamInfoOutputLatency) * 1000.0
+		   );
+
+	PaQa_AppendRow( test, "%4d/%4d/%4d, %4d/%4d/%4d | ",
+		   loopbackContext->inputOverflowCount,
+		   loopbackContext->inputUnderflowCount,
+		   loopbackContext->inputBufferCount,
+		   loopbackContext->outputOverflowCount,
+		   loopbackContext->outputUnderflowCount,
+		   loopbackContext->outputBufferCount
+		   );
+	
+	// Analyse recording to detect glitches.
+	if( test->buffered )
+	{
+		test->channelsLeft = testParams->samplesPerFrame;
+		PaQa_EnqueueTest( test );
+		PaQa_ReportFinishedTests( userOptions, INT_MAX );
+		return paNoError;
+	}
+	for( i=0; i<testParams->samplesPerFrame; i++ )
+	{
+		PaQa_AnalyseRecording( &loopbackContext->recordings[i], &test->testTones[i], &test->analysisResults[i] );
+	}
+	PaQa_ReportLoopBackTest( userOptions, test );
+	return paNoError;
 	
 error:
-	PaQa_TeardownLoopbackContext( &loopbackContext );
-	printf( "\n" );
-	g_testsFailed += 1;
+	PaQa_TeardownLoopbackContext( loopbackContext );
+	PaQa_AppendRow( test, "\n" );
+	if( test->buffered )
+	{
+		// Print the row after the tests before it.
+		test->hasTest = 0;
+		PaQa_EnqueueTest( test );
+	}
+	else
+	{
+		free( test );
+	}
+	PaQa_CountTest( &g_testsFailed );
+	*totalBadChannels += err;
 	return err;	
 }
 
@@ -1006,11 +1369,11 @@ static int PaQa_AnalyzeLoopbackConnection( UserOptions *userOptions, PaDeviceInd
 		int numRuns = 0;
 
 		testParams.flags = flagSettings[iFlags];
-		printf( "\n************ Mode = %s ************\n",
+		PaQa_QueueText( "\n************ Mode = %s ************\n",
 			   (( testParams.flags & 1 ) ? s_FlagOnNames[0] : s_FlagOffNames[0]) );
 
-		printf("|-   requested  -|-  stream info latency  -|- measured ------------------------------\n");
-		printf("|-sRate-|-fr/buf-|- in    - out   - total -|- over/under/calls for in, out -|- frm/buf -|-latency-|- channel results -\n");
+		PaQa_QueueText("|-   requested  -|-  stream info latency  -|- measured ------------------------------\n");
+		PaQa_QueueText("|-sRate-|-fr/buf-|- in    - out   - total -|- over/under/calls for in, out -|- frm/buf -|-latency-|- channel results -\n");
 
 		// Loop though various sample rates.
 		if( userOptions->sampleRate < 0 )
@@ -1018,18 +1381,15 @@ static int PaQa_AnalyzeLoopbackConnection( UserOptions *userOptions, PaDeviceInd
 			savedValue = testParams.sampleRate;
 			for( iRate=0; iRate<numRates; iRate++ )
 			{
-                int numBadChannels;
-
 				// SAMPLE RATE
 				testParams.sampleRate = sampleRates[iRate];
 				testParams.maxFrames = (int) (PAQA_TEST_DURATION * testParams.sampleRate);
 				
-				numBadChannels = PaQa_SingleLoopBackTest( userOptions, &testParams );
-				totalBadChannels += numBadChannels;
+				PaQa_SingleLoopBackTest( userOptions, &testParams, &totalBadChannels );
 			}
 			testParams.sampleRate = savedValue;
 			testParams.maxFrames = (int) (PAQA_TEST_DURATION * testParams.sampleRate);
-			printf( "\n" );
+			PaQa_QueueText( "\n" );
 			numRuns += 1;
 		}
 		
@@ -1039,27 +1399,23 @@ static int PaQa_AnalyzeLoopbackConnection( UserOptions *userOptions, PaDeviceInd
 			savedValue = testParams.framesPerBuffer;
 			for( iSize=0; iSize<numBufferSizes; iSize++ )
 			{	
-                int numBadChannels;
-
 				// BUFFER SIZE
 				testParams.framesPerBuffer = framesPerBuffers[iSize];
 				
-				numBadChannels = PaQa_SingleLoopBackTest( userOptions, &testParams );
-				totalBadChannels += numBadChannels;			
+				PaQa_SingleLoopBackTest( userOptions, &testParams, &totalBadChannels );
 			}
 			testParams.framesPerBuffer = savedValue;
-			printf( "\n" );		
+			PaQa_QueueText( "\n" );
 			numRuns += 1;
 		}
 		// Run one with single parameters in case we did not do a series.
 		if( numRuns == 0 )
 		{
-			int numBadChannels = PaQa_SingleLoopBackTest( userOptions, &testParams );
-			totalBadChannels += numBadChannels;						
+			PaQa_SingleLoopBackTest( userOptions, &testParams, &totalBadChannels );
 		}
 	}
 			
-	printf("\nTest Sample Formats using Half Duplex IO -----\n" );
+	PaQa_QueueText("\nTest Sample Formats using Half Duplex IO -----\n" );
     
 	PaQa_SetDefaultTestParameters( &testParams, inputDevice, outputDevice );
 	testParams.flags = PAQA_FLAG_TWO_STREAMS;	
@@ -1072,21 +1428,212 @@ static int PaQa_AnalyzeLoopbackConnection( UserOptions *userOptions, PaDeviceInd
         
         for( iFormat=0; iFormat<numSampleFormats; iFormat++ )
         {	
-            int numBadChannels;
             PaSampleFormat format = sampleFormats[ iFormat ];
             testParams.inputParameters.sampleFormat = format;
             testParams.outputParameters.sampleFormat = format;
-            printf("Sample format = %d = %s, PaStreamFlags = 0x%02X\n", (int) format, sampleFormatNames[iFormat], (unsigned int) testParams.streamFlags );
-            numBadChannels = PaQa_SingleLoopBackTest( userOptions, &testParams );
-            totalBadChannels += numBadChannels;			
+            PaQa_QueueText("Sample format = %d = %s, PaStreamFlags = 0x%02X\n", (int) format, sampleFormatNames[iFormat], (unsigned int) testParams.streamFlags );
+            PaQa_SingleLoopBackTest( userOptions, &testParams, &totalBadChannels );
         }
     }
-	printf( "\n" );
-	printf( "****************************************\n");
+	PaQa_QueueText( "\n" );
+	PaQa_QueueText( "****************************************\n");
 	
+	// The next connection's tests are not reported before this one's.
+	PaQa_ReportFinishedTests( userOptions, 0 );
 	return totalBadChannels;
 }
 
+/*******************************************************************/
+/** 
+ * Measure the round trip latency of one setting of a latency sweep and print it as a row of the sweep table.
+ * @return 1 if the setting played without glitches or xruns, 0 if not or it could not be opened, or negative error.
+ */
+static int PaQa_MeasureRoundTripLatency( TestParameters *testParams, double *measuredLatencyPtr )
+{
+	int i;
+	LoopbackContext loopbackContext;
+	PaError err = paNoError;
+	PaQaTestTone testTone;
+	PaQaAnalysisResult analysisResult;
+	int stable = 1;
+	double measuredLatency = -1.0;
+	double reportedLatency;
+	int xrunCount;
+	
+	printf("| %6d | %7.2f %7.2f | ", testParams->framesPerBuffer,
+		   testParams->inputParameters.suggestedLatency * 1000.0,
+		   testParams->outputParameters.suggestedLatency * 1000.0 );
+	fflush(stdout);
+	
+	if( Pa_IsFormatSupported( &testParams->inputParameters, NULL, testParams->sampleRate ) != paFormatIsSupported ||
+		Pa_IsFormatSupported( NULL, &testParams->outputParameters, testParams->sampleRate ) != paFormatIsSupported )
+	{
+		printf( "not supported\n" );
+		return 0;
+	}
+	
+	testTone.samplesPerFrame = testParams->samplesPerFrame;
+	testTone.sampleRate = testParams->sampleRate;
+	testTone.amplitude = testParams->amplitude;
+	testTone.startDelay = 0;
+	
+	err = PaQa_SetupLoopbackContext( &loopbackContext, testParams );
+	if( err ) return err;
+	
+	err = PaQa_RunLoopback( &loopbackContext );
+	if( err != paNoError || loopbackContext.callbackCount <= 1 )
+	{
+		printf( "failed to run: %s\n", Pa_GetErrorText( err ) );
+		PaQa_TeardownLoopbackContext( &loopbackContext );
+		return 0;
+	}
+	
+	reportedLatency = loopbackContext.streamInfoInputLatency + loopbackContext.streamInfoOutputLatency;
+	printf( "%7.2f %7.2f %7.2f | ",
+		   loopbackContext.streamInfoInputLatency * 1000.0,
+		   loopbackContext.streamInfoOutputLatency * 1000.0,
+		   reportedLatency * 1000.0 );
+	
+	xrunCount = loopbackContext.inputOverflowCount + loopbackContext.inputUnderflowCount
+		+ loopbackContext.outputOverflowCount + loopbackContext.outputUnderflowCount;
+	if( xrunCount > 0 )
+	{
+		stable = 0;
+	}
+	
+	for( i=0; i<testParams->samplesPerFrame; i++ )
+	{
+		testTone.frequency = PaQa_GetNthFrequency( testParams->baseFrequency, i );
+		
+		PaQa_AnalyseRecording( &loopbackContext.recordings[i], &testTone, &analysisResult );
+		if( !analysisResult.valid
+		   || (analysisResult.popPosition > 0)
+		   || (analysisResult.addedFramesPosition > 0)
+		   || (analysisResult.droppedFramesPosition > 0) )
+		{
+			stable = 0;
+		}
+		else if( i == 0 )
+		{
+			measuredLatency = analysisResult.latency / testParams->sampleRate;
+		}
+	}
+	
+	if( measuredLatency >= 0.0 )
+	{
+		printf( "%7.2f %7.2f | ", measuredLatency * 1000.0, (measuredLatency - reportedLatency) * 1000.0 );
+	}
+	else
+	{
+		printf( "%7s %7s | ", "-", "-" );
+		stable = 0;
+	}
+	printf( "%5d | %s\n", xrunCount, stable ? "stable" : "GLITCHES" );
+	
+	PaQa_TeardownLoopbackContext( &loopbackContext );
+	*measuredLatencyPtr = measuredLatency;
+	return stable;
+}
+
+/*******************************************************************/
+/** 
+ * Sweep buffer sizes and suggested latencies on this loopback connection and tabulate the measured
+ * round trip latency against the latency reported in PaStreamInfo, to find the lowest stable setting.
+ * @return number of stable settings found
+ */
+static int PaQa_SweepLoopbackLatency( UserOptions *userOptions, PaDeviceIndex inputDevice, PaDeviceIndex outputDevice )
+{
+	int iSize;
+	int iLatency;
+	TestParameters testParams;
+	const PaDeviceInfo *inputDeviceInfo = Pa_GetDeviceInfo( inputDevice );	
+	const PaDeviceInfo *outputDeviceInfo = Pa_GetDeviceInfo( outputDevice );		
+	int numStable = 0;
+	int bestFramesPerBuffer = 0;
+	double bestSuggestedLatency = 0.0;
+	double bestMeasuredLatency = -1.0;
+	
+	// framesPerBuffer==0 means PA decides on the buffer size.
+	int framesPerBuffers[] = { 0, 32, 64, 128, 256, 512, 1024 };
+	int numBufferSizes = (sizeof(framesPerBuffers)/sizeof(int));
+	
+	// Suggested latency in msec, 0 asks for the lowest the host API can do.
+	int suggestedLatencies[] = { 0, 2, 5, 10, 20, 50, 100 };
+	int numLatencies = (sizeof(suggestedLatencies)/sizeof(int));
+	
+	printf( "=============== Latency Sweep %d to %d =====================\n", outputDevice, inputDevice  );
+	printf( "   Devices: %s => %s\n", outputDeviceInfo->name, inputDeviceInfo->name);
+	printf( "   Host APIs: %s => %s\n", Pa_GetHostApiInfo( outputDeviceInfo->hostApi )->name,
+		   Pa_GetHostApiInfo( inputDeviceInfo->hostApi )->name );
+	
+	PaQa_SetDefaultTestParameters( &testParams, inputDevice, outputDevice );
+	if( userOptions->sampleRate >= 0 )
+	{
+		testParams.sampleRate = userOptions->sampleRate;
+		testParams.maxFrames = (int) (PAQA_TEST_DURATION * testParams.sampleRate);
+	}
+	// Full duplex on one device, like the loopback detection.
+	if( inputDevice == outputDevice )
+	{
+		testParams.flags &= ~PAQA_FLAG_TWO_STREAMS;
+	}
+	printf( "   Sample rate = %d, mode = %s\n", (int)(testParams.sampleRate+0.5),
+		   (( testParams.flags & PAQA_FLAG_TWO_STREAMS ) ? s_FlagOnNames[0] : s_FlagOffNames[0]) );
+	
+	printf("|- requested ----------------|- stream info latency  -|- measured ------|-xruns-|- result -\n");
+	printf("|-fr/buf-|- in    - out     -|- in    - out   - total -|- total - diff  -|-      -|-\n");
+	
+	for( iSize=0; iSize<numBufferSizes; iSize++ )
+	{
+		if( userOptions->framesPerBuffer >= 0 && iSize > 0 )
+		{
+			break;
+		}
+		testParams.framesPerBuffer = (userOptions->framesPerBuffer >= 0) ? userOptions->framesPerBuffer : framesPerBuffers[iSize];
+		
+		for( iLatency=0; iLatency<numLatencies; iLatency++ )
+		{
+			double measuredLatency = -1.0;
+			int stable;
+			
+			if( (userOptions->inputLatency >= 0 || userOptions->outputLatency >= 0) && iLatency > 0 )
+			{
+				break;
+			}
+			testParams.inputParameters.suggestedLatency = 0.001 *
+				((userOptions->inputLatency >= 0) ? userOptions->inputLatency : suggestedLatencies[iLatency]);
+			testParams.outputParameters.suggestedLatency = 0.001 *
+				((userOptions->outputLatency >= 0) ? userOptions->outputLatency : suggestedLatencies[iLatency]);
+			
+			stable = PaQa_MeasureRoundTripLatency( &testParams, &measuredLatency );
+			if( stable > 0 )
+			{
+				numStable += 1;
+				if( bestMeasuredLatency < 0.0 || measuredLatency < bestMeasuredLatency )
+				{
+					bestMeasuredLatency = measuredLatency;
+					bestFramesPerBuffer = testParams.framesPerBuffer;
+					bestSuggestedLatency = testParams.outputParameters.suggestedLatency;
+				}
+			}
+		}
+	}
+	
+	if( numStable > 0 )
+	{
+		printf( "   Lowest stable setting: framesPerBuffer = %d, suggested latency = %5.2f msec, measured round trip = %5.2f msec\n",
+			   bestFramesPerBuffer, bestSuggestedLatency * 1000.0, bestMeasuredLatency * 1000.0 );
+	}
+	else
+	{
+		printf( "   No stable setting found!\n" );
+		PaQa_CountTest( &g_testsFailed );
+	}
+	printf( "****************************************\n");
+	
+	return numStable;
+}
+
 /*******************************************************************/
 int PaQa_CheckForClippedLoopback( LoopbackContext *loopbackContextPtr )
 {
@@ -1294,7 +1841,14 @@ static int CheckLoopbackAndScan( UserOptions *userOptions,
 	int loopbackConnected = PaQa_CheckForLoopBack( userOptions, iIn, iOut );
 	if( loopbackConnected > 0 )
 	{
-		PaQa_AnalyzeLoopbackConnection( userOptions, iIn, iOut );
+		if( userOptions->latencySweep )
+		{
+			PaQa_SweepLoopbackLatency( userOptions, iIn, iOut );
+		}
+		else
+		{
+			PaQa_AnalyzeLoopbackConnection( userOptions, iIn, iOut );
+		}
 		return 1;
 	}
 	return 0;
@@ -1437,7 +1991,7 @@ error:
 /*******************************************************************/
 void usage( const char *name )
 {
-	printf("%s [-i# -o# -l# -r# -s# -m -w -dDir]\n", name);
+	printf("%s [-i# -o# -l# -r# -s# -t -j# -m -w -dDir]\n", name);
 	printf("  -i# - Input device ID. Will scan for loopback cable if not specified.\n");
 	printf("  -o# - Output device ID. Will scan for loopback if not specified.\n");
 	printf("  -l# - Latency for both input and output in milliseconds.\n");
@@ -1445,6 +1999,8 @@ void usage( const char *name )
 	printf("  --outputLatency # Output latency in milliseconds.\n");
 	printf("  -r# - Sample Rate in Hz.  Will use multiple common rates if not specified.\n");
 	printf("  -s# - Size of callback buffer in frames, framesPerBuffer. Will use common values if not specified.\n");
+	printf("  -t  - Sweep buffer sizes and suggested latencies, comparing measured and reported round trip latency.\n");
+	printf("  -j# - Analyse the recordings on # threads while the next test runs. One thread per processor if # is omitted.\n");
 	printf("  -w  - Save bad recordings in a WAV file.\n");
 	printf("  -dDir - Path for Directory for WAV files. Default is current directory.\n");
 	printf("  -m  - Just test the DSP Math code and not the audio devices.\n");
@@ -1479,6 +2035,7 @@ int main( int argc, char **argv )
 	userOptions.inputLatency = -1;
 	userOptions.outputLatency = -1;
 	userOptions.waveFilePath = ".";
+	userOptions.analysisThreads = 1;
 	
 	// Process arguments. Skip name of executable.
 	i = 1;
@@ -1510,6 +2067,14 @@ int main( int argc, char **argv )
 					justMath = 1;
 					break;
 					
+				case 't':
+					userOptions.latencySweep = 1;
+					break;
+					
+				case 'j':
+					userOptions.analysisThreads = atoi(&arg[2]);
+					break;
+					
 				case 'w':
 					userOptions.saveBadWaves = 1;
 					break;
@@ -1582,7 +2147,12 @@ int main( int argc, char **argv )
             printf( "no devices found.\n" );
         
 		printf( "=============== Detect Loopback ==========================\n" );
+		if( userOptions.analysisThreads != 1 )
+		{
+			PaQa_StartAnalysisThreads( userOptions.analysisThreads );
+		}
 		ScanForLoopback(&userOptions);
+		PaQa_StopAnalysisThreads();
  
 		Pa_Terminate();
 	}
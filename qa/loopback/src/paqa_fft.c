@@ -0,0 +1,328 @@
+
+/*
+ * PortAudio Portable Real-Time Audio Library
+ * Latest Version at: http://www.portaudio.com
+ *
+ * Copyright (c) 1999-2010 Phil Burk and Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "paqa_fft.h"
+
+#define FFT_PI  (3.141592653589793238462643)
+
+/* bins on either side of a harmonic counted as its energy, the Hann main lobe is 2 bins wide */
+#define HARMONIC_HALF_WIDTH  (3)
+
+/*==========================================================================================*/
+int PaQa_NextPowerOfTwo( int n )
+{
+	int size = 1;
+	while( size < n )
+	{
+		size <<= 1;
+	}
+	return size;
+}
+
+/*==========================================================================================*/
+int PaQa_InitializeFFT( PaQaFFT *fft, int size )
+{
+	int i, bits = 0;
+
+	memset( fft, 0, sizeof(PaQaFFT) );
+	if( size < 2 || (size & (size - 1)) != 0 )
+	{
+		return 1;
+	}
+	while( (1 << bits) < size )
+	{
+		bits += 1;
+	}
+
+	fft->size = size;
+	fft->cosTable = (double *) malloc( sizeof(double) * (size / 2) );
+	fft->sinTable = (double *) malloc( sizeof(double) * (size / 2) );
+	fft->bitReversed = (int *) malloc( sizeof(int) * size );
+	if( fft->cosTable == NULL || fft->sinTable == NULL || fft->bitReversed == NULL )
+	{
+		PaQa_TerminateFFT( fft );
+		return 1;
+	}
+
+	for( i=0; i<size/2; i++ )
+	{
+		double angle = 2.0 * FFT_PI * i / size;
+		fft->cosTable[i] = cos( angle );
+		fft->sinTable[i] = sin( angle );
+	}
+	for( i=0; i<size; i++ )
+	{
+		int b, reversed = 0;
+		for( b=0; b<bits; b++ )
+		{
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		fft->bitReversed[i] = reversed;
+	}
+	return 0;
+}
+
+/*==========================================================================================*/
+void PaQa_TerminateFFT( PaQaFFT *fft )
+{
+	free( fft->cosTable );
+	free( fft->sinTable );
+	free( fft->bitReversed );
+	memset( fft, 0, sizeof(PaQaFFT) );
+}
+
+/*==========================================================================================*/
+void PaQa_TransformFFT( PaQaFFT *fft, double *real, double *imag, int inverse )
+{
+	int i, half, size = fft->size;
+	double sign = inverse ? 1.0 : -1.0;
+
+	for( i=0; i<size; i++ )
+	{
+		int j = fft->bitReversed[i];
+		if( j > i )
+		{
+			double t = real[i]; real[i] = real[j]; real[j] = t;
+			t = imag[i]; imag[i] = imag[j]; imag[j] = t;
+		}
+	}
+
+	// Decimation in time, each pass combines pairs of transforms of half the size.
+	for( half=1; half<size; half <<= 1 )
+	{
+		int tableStride = size / (2 * half);
+		int block;
+		for( block=0; block<size; block += 2 * half )
+		{
+			double *re1 = &real[block];
+			double *im1 = &imag[block];
+			double *re2 = &real[block + half];
+			double *im2 = &imag[block + half];
+			int k;
+			for( k=0; k<half; k++ )
+			{
+				double wr = fft->cosTable[k * tableStride];
+				double wi = sign * fft->sinTable[k * tableStride];
+				double tr = re2[k] * wr - im2[k] * wi;
+				double ti = re2[k] * wi + im2[k] * wr;
+				re2[k] = re1[k] - tr;
+				im2[k] = im1[k] - ti;
+				re1[k] += tr;
+				im1[k] += ti;
+			}
+		}
+	}
+
+	if( inverse )
+	{
+		double scale = 1.0 / size;
+		for( i=0; i<size; i++ )
+		{
+			real[i] *= scale;
+			imag[i] *= scale;
+		}
+	}
+}
+
+/*==========================================================================================*/
+int PaQa_InitializeCorrelator( PaQaCorrelator *correlator, const float *pattern, int patternSize )
+{
+	int i, size;
+
+	memset( correlator, 0, sizeof(PaQaCorrelator) );
+	// Several correlations per block keep the transforms per correlation low.
+	size = PaQa_NextPowerOfTwo( 4 * patternSize );
+	if( size < 256 )
+	{
+		size = 256;
+	}
+	if( PaQa_InitializeFFT( &correlator->fft, size ) != 0 )
+	{
+		return 1;
+	}
+	correlator->patternSize = patternSize;
+	correlator->patternReal = (double *) calloc( size, sizeof(double) );
+	correlator->patternImag = (double *) calloc( size, sizeof(double) );
+	correlator->real = (double *) malloc( sizeof(double) * size );
+	correlator->imag = (double *) malloc( sizeof(double) * size );
+	if( correlator->patternReal == NULL || correlator->patternImag == NULL
+	   || correlator->real == NULL || correlator->imag == NULL )
+	{
+		PaQa_TerminateCorrelator( correlator );
+		return 1;
+	}
+
+	for( i=0; i<patternSize; i++ )
+	{
+		correlator->patternReal[i] = pattern[i];
+	}
+	PaQa_TransformFFT( &correlator->fft, correlator->patternReal, correlator->patternImag, 0 );
+	return 0;
+}
+
+/*==========================================================================================*/
+void PaQa_TerminateCorrelator( PaQaCorrelator *correlator )
+{
+	PaQa_TerminateFFT( &correlator->fft );
+	free( correlator->patternReal );
+	free( correlator->patternImag );
+	free( correlator->real );
+	free( correlator->imag );
+	memset( correlator, 0, sizeof(PaQaCorrelator) );
+}
+
+/*==========================================================================================*/
+int PaQa_GetCorrelatorBlockSize( PaQaCorrelator *correlator )
+{
+	return correlator->fft.size - correlator->patternSize + 1;
+}
+
+/*==========================================================================================*/
+void PaQa_Correlate( PaQaCorrelator *correlator, const float *signal, int numCorrelations, double *correlation )
+{
+	int i, size = correlator->fft.size;
+	int numSamples = numCorrelations + correlator->patternSize - 1;
+	double *real = correlator->real;
+	double *imag = correlator->imag;
+
+	for( i=0; i<numSamples; i++ )
+	{
+		real[i] = signal[i];
+	}
+	for( ; i<size; i++ )
+	{
+		real[i] = 0.0;
+	}
+	memset( imag, 0, sizeof(double) * size );
+
+	PaQa_TransformFFT( &correlator->fft, real, imag, 0 );
+
+	// Multiply by the conjugate of the pattern's spectrum to correlate instead of convolve.
+	for( i=0; i<size; i++ )
+	{
+		double pr = correlator->patternReal[i];
+		double pi = correlator->patternImag[i];
+		double re = real[i] * pr + imag[i] * pi;
+		double im = imag[i] * pr - real[i] * pi;
+		real[i] = re;
+		imag[i] = im;
+	}
+
+	PaQa_TransformFFT( &correlator->fft, real, imag, 1 );
+
+	// The first numCorrelations lags don't wrap around the block.
+	for( i=0; i<numCorrelations; i++ )
+	{
+		correlation[i] = real[i];
+	}
+}
+
+/*==========================================================================================*/
+double PaQa_MeasureHarmonicDistortion( const float *buffer, int numFrames, double frequency, double frameRate )
+{
+	PaQaFFT fft;
+	double *real, *imag;
+	double fundamental = 0.0, harmonics = 0.0;
+	int i, size = 1, harmonic;
+
+	while( 2 * size <= numFrames )
+	{
+		size <<= 1;
+	}
+	// Need a few bins between the harmonics.
+	if( size < 256 || frequency * size / frameRate < 4 * HARMONIC_HALF_WIDTH )
+	{
+		return -1.0;
+	}
+	if( PaQa_InitializeFFT( &fft, size ) != 0 )
+	{
+		return -1.0;
+	}
+	real = (double *) malloc( sizeof(double) * size );
+	imag = (double *) calloc( size, sizeof(double) );
+	if( real == NULL || imag == NULL )
+	{
+		free( real );
+		free( imag );
+		PaQa_TerminateFFT( &fft );
+		return -1.0;
+	}
+
+	for( i=0; i<size; i++ )
+	{
+		double window = 0.5 - 0.5 * cos( 2.0 * FFT_PI * i / size );
+		real[i] = buffer[i] * window;
+	}
+	PaQa_TransformFFT( &fft, real, imag, 0 );
+
+	for( harmonic=1; harmonic * frequency < frameRate / 2.0; harmonic++ )
+	{
+		int center = (int) (harmonic * frequency * size / frameRate + 0.5);
+		int bin;
+		double power = 0.0;
+		for( bin=center-HARMONIC_HALF_WIDTH; bin<=center+HARMONIC_HALF_WIDTH; bin++ )
+		{
+			if( bin > 0 && bin < size/2 )
+			{
+				power += real[bin] * real[bin] + imag[bin] * imag[bin];
+			}
+		}
+		if( harmonic == 1 )
+		{
+			fundamental = power;
+		}
+		else
+		{
+			harmonics += power;
+		}
+	}
+
+	free( real );
+	free( imag );
+	PaQa_TerminateFFT( &fft );
+
+	if( fundamental <= 0.0 )
+	{
+		return -1.0;
+	}
+	return sqrt( harmonics / fundamental );
+}
@@ -0,0 +1,110 @@
+
+/*
+ * PortAudio Portable Real-Time Audio Library
+ * Latest Version at: http://www.portaudio.com
+ *
+ * Copyright (c) 1999-2010 Phil Burk and Ross Bencina
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+#ifndef _PAQA_FFT_H
+#define _PAQA_FFT_H
+
+/**
+ * Radix-2 FFT and FFT based cross correlation for analysing loopback recordings.
+ *
+ * Complex data is kept in separate arrays of real and imaginary parts, so the butterflies
+ * of a pass run over contiguous memory which the compiler can vectorize.
+ */
+
+typedef struct PaQaFFT_s
+{
+	int       size;          // a power of 2
+	double   *cosTable;      // cos( 2*pi*i/size ) for i < size/2
+	double   *sinTable;
+	int      *bitReversed;   // index i bit reversed
+} PaQaFFT;
+
+/**
+ * Prepare the tables for transforms of size points, which must be a power of 2.
+ * @return 0 if OK or 1 if out of memory or size is not a power of 2.
+ */
+int PaQa_InitializeFFT( PaQaFFT *fft, int size );
+
+void PaQa_TerminateFFT( PaQaFFT *fft );
+
+/**
+ * Transform size points in place. The inverse transform is scaled by 1/size, so that it
+ * restores the input of the forward transform.
+ */
+void PaQa_TransformFFT( PaQaFFT *fft, double *real, double *imag, int inverse );
+
+/** @return the smallest power of 2 not less than n. */
+int PaQa_NextPowerOfTwo( int n );
+
+/**
+ * Cross correlates signals against a fixed pattern, block by block, using overlap-save.
+ */
+typedef struct PaQaCorrelator_s
+{
+	PaQaFFT   fft;
+	int       patternSize;
+	double   *patternReal;   // spectrum of the pattern
+	double   *patternImag;
+	double   *real;          // work buffers
+	double   *imag;
+} PaQaCorrelator;
+
+int PaQa_InitializeCorrelator( PaQaCorrelator *correlator, const float *pattern, int patternSize );
+
+void PaQa_TerminateCorrelator( PaQaCorrelator *correlator );
+
+/** @return the largest number of correlations one call of PaQa_Correlate() computes. */
+int PaQa_GetCorrelatorBlockSize( PaQaCorrelator *correlator );
+
+/**
+ * Compute correlation[i] = sum of pattern[j] * signal[i+j] over the pattern, for i < numCorrelations.
+ * Reads numCorrelations + patternSize - 1 samples of signal. numCorrelations must not exceed
+ * PaQa_GetCorrelatorBlockSize().
+ */
+void PaQa_Correlate( PaQaCorrelator *correlator, const float *signal, int numCorrelations, double *correlation );
+
+/**
+ * Measure the total harmonic distortion of a sine wave of the given frequency in numFrames
+ * samples of buffer, the RMS amplitude of its harmonics below Nyquist divided by the RMS
+ * amplitude of the fundamental. The largest power of 2 of samples not exceeding numFrames is
+ * analysed, with a Hann window.
+ * @return the distortion ratio, or negative if numFrames is too small or out of memory.
+ */
+double PaQa_MeasureHarmonicDistortion( const float *buffer, int numFrames, double frequency, double frameRate );
+
+#endif /* _PAQA_FFT_H */
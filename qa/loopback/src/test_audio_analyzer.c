@@ -44,6 +44,7 @@
 #include "test_audio_analyzer.h"
 #include "write_wav.h"
 #include "biquad_filter.h"
+#include "paqa_fft.h"
 
 #define FRAMES_PER_BLOCK  (64)
 #define PRINT_REPORTS  0
@@ -683,6 +684,100 @@ error:
 	
 }
 
+/*==========================================================================================*/
+/**
+ * Compare the FFT based correlation with a direct sum over the pattern, across several blocks.
+ */
+static int TestCorrelator( void )
+{
+	int i, j;
+	int patternSize = 200;
+	int numCorrelations = 3000;
+	float pattern[200];
+	float signal[3200];
+	double correlation[3000];
+	PaQaCorrelator correlator = { { 0 } };
+	int blockSize;
+	int result;
+	unsigned int seed = 22222;
+
+	for( i=0; i<patternSize + numCorrelations; i++ )
+	{
+		seed = seed * 196314165 + 907633515;
+		signal[i] = ((int)(seed >> 16) - 32768) / 32768.0f;
+		if( i < patternSize )
+		{
+			pattern[i] = (float) sin( i * 0.1 );
+		}
+	}
+
+	result = PaQa_InitializeCorrelator( &correlator, pattern, patternSize );
+	QA_ASSERT_EQUALS( "PaQa_InitializeCorrelator failed", 0, result );
+	blockSize = PaQa_GetCorrelatorBlockSize( &correlator );
+	QA_ASSERT_TRUE( "block size too small", (blockSize > 0) && (blockSize < numCorrelations) );
+	
+	for( i=0; i<numCorrelations; i += blockSize )
+	{
+		int numSums = (numCorrelations - i < blockSize) ? (numCorrelations - i) : blockSize;
+		PaQa_Correlate( &correlator, &signal[i], numSums, &correlation[i] );
+	}
+	
+	for( i=0; i<numCorrelations; i++ )
+	{
+		double sum = 0.0;
+		for( j=0; j<patternSize; j++ )
+		{
+			sum += pattern[j] * signal[i+j];
+		}
+		QA_ASSERT_CLOSE( "FFT correlation differs from direct sum", sum, correlation[i], 0.0001 );
+	}
+	
+	PaQa_TerminateCorrelator( &correlator );
+	return 0;
+	
+error:
+	PaQa_TerminateCorrelator( &correlator );
+	return 1;
+}
+
+/*==========================================================================================*/
+/**
+ * Measure the distortion of a pure tone and of one with a known amount of harmonics mixed in.
+ */
+static int TestHarmonicDistortion( void )
+{
+	int result = 0;
+	PaQaRecording     recording = { 0 };
+	PaQaSineGenerator generator;
+	double sampleRate = 44100.0;
+	int maxFrames = ((int)sampleRate) * 1;
+	double freq = 234.5;
+	double amp = 0.5;
+	double distortion;
+	
+	result = PaQa_InitializeRecording( &recording, maxFrames, (int) sampleRate );
+	QA_ASSERT_EQUALS( "PaQa_InitializeRecording failed", 0, result );
+	
+	PaQa_FillWithSine( &recording, sampleRate, freq, amp );
+	distortion = PaQa_MeasureHarmonicDistortion( recording.buffer, recording.numFrames, freq, sampleRate );
+	QA_ASSERT_CLOSE( "pure tone should not be distorted", 0.0, distortion, 0.001 );
+	
+	// 2nd and 3rd harmonics at 6% and 8% of the fundamental give 10% distortion.
+	PaQa_SetupSineGenerator( &generator, 2.0 * freq, 0.06 * amp, sampleRate );
+	PaQa_MixSine( &generator, recording.buffer, recording.numFrames, 1 );
+	PaQa_SetupSineGenerator( &generator, 3.0 * freq, 0.08 * amp, sampleRate );
+	PaQa_MixSine( &generator, recording.buffer, recording.numFrames, 1 );
+	distortion = PaQa_MeasureHarmonicDistortion( recording.buffer, recording.numFrames, freq, sampleRate );
+	QA_ASSERT_CLOSE( "harmonic distortion", 0.1, distortion, 0.002 );
+	
+	PaQa_TerminateRecording( &recording );
+	return 0;
+	
+error:
+	PaQa_TerminateRecording( &recording );
+	return 1;
+}
+
 /*==========================================================================================*/
 /**
  */ 
@@ -707,6 +802,12 @@ int PaQa_TestAnalyzer( void )
 	// Test to see if notch filter can knock out the test tone.
 	if ((result = TestNotchFilter()) != 0) return result;
 	
+	// Compare FFT correlation against the direct computation.
+	if ((result = TestCorrelator()) != 0) return result;
+	
+	// Measure harmonic distortion with the FFT.
+	if ((result = TestHarmonicDistortion()) != 0) return result;
+	
 	// Detect pops that get back in phase.
 	if ((result = TestDetectPops()) != 0) return result;
 	
@@ -0,0 +1,1707 @@
+/** @file paqa_benchmark.c
+    @ingroup qa_src
+    @brief Micro benchmarks for the sample converters and the buffer processor.
+
+    Times every entry of paConverters over a range of strides and buffer
+    sizes, with and without acceleration, then times complete buffer
+    processor cycles (PaUtil_BeginBufferProcessing() ..
+    PaUtil_EndBufferProcessing()) for typical stream configurations.
+
+    If PortAudio was built with the null host API (PA_USE_NULL), streams on
+    its clock driven devices are timed end-to-end too: the jitter of the
+    intervals between callbacks of an output stream, and the cost per frame
+    of a free running full duplex loopback stream for several host formats.
+
+    The ring buffer benchmarks pass data from a writer to a reader thread
+    through PaUtilRingBuffer, the padded PaUtilSpscRingBuffer and a
+    PaUtilRingBuffer in mirrored memory, with both threads on the same
+    processor and on two processors (unpinned where threads can't be bound
+    to processors). They report the throughput for several element sizes and
+    capacities, and the latency of handing single elements back and forth.
+
+    No audio device is opened, so the numbers are reproducible enough to
+    compare builds against each other and catch performance regressions.
+    With -j the results are printed as one JSON object, with the arrays
+    "converters", "processors", "streams", "ringBuffers" and
+    "ringBufferHandoffs", for scripts to compare.
+
+    The scaling benchmark (-m) opens up to hundreds of output streams at
+    once on the default output device of a host API, the null host API
+    unless -H selects another such as JACK. For each number of streams it
+    reports the open and close latencies, the CPU time, threads and memory
+    taken per running stream and the share of the expected callbacks which
+    were made, in the JSON array "scaling". Threads and memory are read from
+    /proc and only reported on Linux.
+
+    Usage: paqa_benchmark [-q] [-j] [-c] [-p] [-s] [-r] [-m] [-H hostapi] [name]
+    - -q: quick run, fewer strides, buffer sizes, callbacks and streams
+    - -j: print JSON instead of tables
+    - -c: run the converter benchmarks
+    - -p: run the buffer processor benchmarks
+    - -s: run the null host API stream benchmarks
+    - -r: run the ring buffer benchmarks
+    - -m: run the scaling benchmark
+    - -H hostapi: the host API of the scaling benchmark, whose name contains hostapi
+    - name: only run converters whose name contains name
+
+    Without -c, -p, -s, -r or -m all benchmarks but the scaling benchmark are run.
+*/
+/*
+ * $Id$
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* sched_setaffinity() */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+#include "portaudio.h"
+#include "pa_converters.h"
+#include "pa_dither.h"
+#include "pa_memorybarrier.h"
+#include "pa_process.h"
+#include "pa_ringbuffer.h"
+#include "pa_util.h"
+
+extern volatile int withAcceleration;
+
+#define MAX_FRAMES          (4096)
+#define MAX_STRIDE          (32)
+#define MAX_CHANNELS        (32)
+#define TRIALS              (5)     /* the fastest of TRIALS runs is reported */
+#define SAMPLES_PER_TRIAL   (1<<18) /* minimum samples converted per trial */
+#define FRAMES_PER_TRIAL    (1<<16) /* minimum frames processed per trial */
+
+static const unsigned int bufferSizes_[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+static const unsigned int quickBufferSizes_[] = { 256, 4096 };
+static const int strides_[] = { 1, 2, 8, 32 };
+static const int quickStrides_[] = { 1, 8 };
+
+#define ARRAY_SIZE_( a ) (sizeof(a)/sizeof(a[0]))
+
+static int json_ = 0;               /* print JSON instead of tables */
+static int jsonSectionCount_ = 0;
+static int jsonRecordCount_ = 0;
+
+
+typedef struct
+{
+    const char *name;
+    PaUtilConverter **converter;    /* entry of paConverters */
+    PaSampleFormat sourceFormat;
+    PaSampleFormat destinationFormat;
+}
+ConverterInfo;
+
+#define CONVERTER_( name, sourceFormat, destinationFormat ) \
+    { #name, &paConverters.name, sourceFormat, destinationFormat }
+
+static const ConverterInfo converters_[] = {
+    CONVERTER_( Float32_To_Int32, paFloat32, paInt32 ),
+    CONVERTER_( Float32_To_Int32_Dither, paFloat32, paInt32 ),
+    CONVERTER_( Float32_To_Int32_Clip, paFloat32, paInt32 ),
+    CONVERTER_( Float32_To_Int32_DitherClip, paFloat32, paInt32 ),
+    CONVERTER_( Float32_To_Int24, paFloat32, paInt24 ),
+    CONVERTER_( Float32_To_Int24_Dither, paFloat32, paInt24 ),
+    CONVERTER_( Float32_To_Int24_Clip, paFloat32, paInt24 ),
+    CONVERTER_( Float32_To_Int24_DitherClip, paFloat32, paInt24 ),
+    CONVERTER_( Float32_To_Int16, paFloat32, paInt16 ),
+    CONVERTER_( Float32_To_Int16_Dither, paFloat32, paInt16 ),
+    CONVERTER_( Float32_To_Int16_Clip, paFloat32, paInt16 ),
+    CONVERTER_( Float32_To_Int16_DitherClip, paFloat32, paInt16 ),
+    CONVERTER_( Float32_To_Int8, paFloat32, paInt8 ),
+    CONVERTER_( Float32_To_Int8_Dither, paFloat32, paInt8 ),
+    CONVERTER_( Float32_To_Int8_Clip, paFloat32, paInt8 ),
+    CONVERTER_( Float32_To_Int8_DitherClip, paFloat32, paInt8 ),
+    CONVERTER_( Float32_To_UInt8, paFloat32, paUInt8 ),
+    CONVERTER_( Float32_To_UInt8_Dither, paFloat32, paUInt8 ),
+    CONVERTER_( Float32_To_UInt8_Clip, paFloat32, paUInt8 ),
+    CONVERTER_( Float32_To_UInt8_DitherClip, paFloat32, paUInt8 ),
+
+    CONVERTER_( Int32_To_Float32, paInt32, paFloat32 ),
+    CONVERTER_( Int32_To_Int24, paInt32, paInt24 ),
+    CONVERTER_( Int32_To_Int24_Dither, paInt32, paInt24 ),
+    CONVERTER_( Int32_To_Int16, paInt32, paInt16 ),
+    CONVERTER_( Int32_To_Int16_Dither, paInt32, paInt16 ),
+    CONVERTER_( Int32_To_Int8, paInt32, paInt8 ),
+    CONVERTER_( Int32_To_Int8_Dither, paInt32, paInt8 ),
+    CONVERTER_( Int32_To_UInt8, paInt32, paUInt8 ),
+    CONVERTER_( Int32_To_UInt8_Dither, paInt32, paUInt8 ),
+
+    CONVERTER_( Int24_To_Float32, paInt24, paFloat32 ),
+    CONVERTER_( Int24_To_Int32, paInt24, paInt32 ),
+    CONVERTER_( Int24_To_Int16, paInt24, paInt16 ),
+    CONVERTER_( Int24_To_Int16_Dither, paInt24, paInt16 ),
+    CONVERTER_( Int24_To_Int8, paInt24, paInt8 ),
+    CONVERTER_( Int24_To_Int8_Dither, paInt24, paInt8 ),
+    CONVERTER_( Int24_To_UInt8, paInt24, paUInt8 ),
+    CONVERTER_( Int24_To_UInt8_Dither, paInt24, paUInt8 ),
+
+    CONVERTER_( Int16_To_Float32, paInt16, paFloat32 ),
+    CONVERTER_( Int16_To_Int32, paInt16, paInt32 ),
+    CONVERTER_( Int16_To_Int24, paInt16, paInt24 ),
+    CONVERTER_( Int16_To_Int8, paInt16, paInt8 ),
+    CONVERTER_( Int16_To_Int8_Dither, paInt16, paInt8 ),
+    CONVERTER_( Int16_To_UInt8, paInt16, paUInt8 ),
+    CONVERTER_( Int16_To_UInt8_Dither, paInt16, paUInt8 ),
+
+    CONVERTER_( Int8_To_Float32, paInt8, paFloat32 ),
+    CONVERTER_( Int8_To_Int32, paInt8, paInt32 ),
+    CONVERTER_( Int8_To_Int24, paInt8, paInt24 ),
+    CONVERTER_( Int8_To_Int16, paInt8, paInt16 ),
+    CONVERTER_( Int8_To_UInt8, paInt8, paUInt8 ),
+
+    CONVERTER_( UInt8_To_Float32, paUInt8, paFloat32 ),
+    CONVERTER_( UInt8_To_Int32, paUInt8, paInt32 ),
+    CONVERTER_( UInt8_To_Int24, paUInt8, paInt24 ),
+    CONVERTER_( UInt8_To_Int16, paUInt8, paInt16 ),
+    CONVERTER_( UInt8_To_Int8, paUInt8, paInt8 ),
+
+    CONVERTER_( Copy_8_To_8, paInt8, paInt8 ),
+    CONVERTER_( Copy_16_To_16, paInt16, paInt16 ),
+    CONVERTER_( Copy_24_To_24, paInt24, paInt24 ),
+    CONVERTER_( Copy_32_To_32, paInt32, paInt32 )
+};
+
+/*******************************************************************/
+
+/* Starts a table titled title, or a JSON array named name */
+static void BeginSection( const char *name, const char *title )
+{
+    if( json_ )
+    {
+        printf( "%s\n  \"%s\": [", jsonSectionCount_++ ? "," : "", name );
+        jsonRecordCount_ = 0;
+    }
+    else if( title )
+    {
+        printf( "\n%s\n", title );
+    }
+}
+
+
+static void EndSection( void )
+{
+    if( json_ )
+        printf( "\n  ]" );
+}
+
+
+/* Starts one JSON object of the current array, the caller prints its members */
+static void BeginRecord( void )
+{
+    printf( "%s\n    { ", jsonRecordCount_++ ? "," : "" );
+}
+
+
+static const char *FormatName( PaSampleFormat format )
+{
+    switch( format & ~paNonInterleaved )
+    {
+    case paFloat32: return "Float32";
+    case paInt32: return "Int32";
+    case paInt24: return "Int24";
+    case paInt16: return "Int16";
+    case paInt8: return "Int8";
+    case paUInt8: return "UInt8";
+    default: return "custom";
+    }
+}
+
+/*******************************************************************/
+
+static unsigned int SampleSize( PaSampleFormat format )
+{
+    switch( format & ~paNonInterleaved )
+    {
+    case paFloat32: case paInt32: return 4;
+    case paInt24: return 3;
+    case paInt16: return 2;
+    default: return 1;
+    }
+}
+
+/* fill with full scale signal so clipping and dither code does real work */
+static void FillSourceBuffer( void *buffer, PaSampleFormat format, unsigned long sampleCount )
+{
+    unsigned long i;
+
+    if( (format & ~paNonInterleaved) == paFloat32 )
+    {
+        float *p = (float*)buffer;
+        for( i=0; i<sampleCount; ++i )
+            p[i] = (float)sin( (double)i * 0.01 ) * 1.05f;
+    }
+    else
+    {
+        unsigned char *p = (unsigned char*)buffer;
+        unsigned long bytes = sampleCount * SampleSize( format );
+        unsigned long seed = 22222;
+        for( i=0; i<bytes; ++i )
+        {
+            seed = seed * 196314165 + 907633515;
+            p[i] = (unsigned char)(seed >> 24);
+        }
+    }
+}
+
+/*******************************************************************/
+
+static double TimeConverter( PaUtilConverter *converter, void *destination, void *source,
+        int stride, unsigned int frames, PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned long repetitions = SAMPLES_PER_TRIAL / frames;
+    double best = -1.;
+    int trial;
+
+    if( repetitions == 0 )
+        repetitions = 1;
+
+    for( trial=0; trial<TRIALS; ++trial )
+    {
+        unsigned long i;
+        double start = PaUtil_GetTime(), elapsed;
+
+        for( i=0; i<repetitions; ++i )
+            converter( destination, stride, source, stride, frames, ditherGenerator );
+
+        elapsed = PaUtil_GetTime() - start;
+        if( best < 0. || elapsed < best )
+            best = elapsed;
+    }
+
+    /* seconds per sample */
+    return best / ((double)repetitions * frames);
+}
+
+
+static void BenchmarkConverters( const char *nameFilter, int quick )
+{
+    const unsigned int *sizes = quick ? quickBufferSizes_ : bufferSizes_;
+    unsigned int sizeCount = quick ? ARRAY_SIZE_( quickBufferSizes_ ) : ARRAY_SIZE_( bufferSizes_ );
+    const int *strides = quick ? quickStrides_ : strides_;
+    unsigned int strideCount = quick ? ARRAY_SIZE_( quickStrides_ ) : ARRAY_SIZE_( strides_ );
+    unsigned long bufferBytes = (unsigned long)MAX_FRAMES * MAX_STRIDE * 4;
+    void *source = malloc( bufferBytes );
+    void *destination = malloc( bufferBytes );
+    PaUtilTriangularDitherGenerator ditherGenerator;
+    unsigned int i, j, k;
+
+    if( !source || !destination )
+    {
+        printf( "out of memory\n" );
+        goto done;
+    }
+    memset( destination, 0, bufferBytes );
+
+    PaUtil_InitializeTriangularDitherState( &ditherGenerator );
+
+    if( json_ )
+    {
+        printf( "%s\n  \"converterTable\": \"%s\"", jsonSectionCount_++ ? "," : "",
+                PaUtil_GetConverterTableName( PaUtil_GetActiveConverterTable() ) );
+    }
+    else
+    {
+        printf( "\nConverters (%s), source and destination use the same stride\n",
+                PaUtil_GetConverterTableName( PaUtil_GetActiveConverterTable() ) );
+    }
+    BeginSection( "converters", NULL );
+    if( !json_ )
+        printf( "%-30s %6s %6s %12s %12s %10s %8s\n",
+                "converter", "stride", "frames", "scalar ns/s", "accel ns/s", "accel GB/s", "speedup" );
+
+    for( i=0; i<ARRAY_SIZE_( converters_ ); ++i )
+    {
+        const ConverterInfo *info = &converters_[i];
+        unsigned int bytesPerFrame = SampleSize( info->sourceFormat ) + SampleSize( info->destinationFormat );
+
+        if( !*info->converter || (nameFilter && !strstr( info->name, nameFilter )) )
+            continue;
+
+        FillSourceBuffer( source, info->sourceFormat, (unsigned long)MAX_FRAMES * MAX_STRIDE );
+
+        for( j=0; j<strideCount; ++j )
+        {
+            for( k=0; k<sizeCount; ++k )
+            {
+                double scalar, accel;
+
+                withAcceleration = 0;
+                scalar = TimeConverter( *info->converter, destination, source,
+                        strides[j], sizes[k], &ditherGenerator );
+                withAcceleration = 1;
+                accel = TimeConverter( *info->converter, destination, source,
+                        strides[j], sizes[k], &ditherGenerator );
+
+                if( json_ )
+                {
+                    BeginRecord();
+                    printf( "\"name\": \"%s\", \"source\": \"%s\", \"destination\": \"%s\", "
+                            "\"stride\": %d, \"frames\": %u, \"scalarNsPerSample\": %.4f, "
+                            "\"accelNsPerSample\": %.4f }",
+                            info->name, FormatName( info->sourceFormat ), FormatName( info->destinationFormat ),
+                            strides[j], sizes[k], scalar * 1e9, accel * 1e9 );
+                }
+                else
+                {
+                    printf( "%-30s %6d %6u %12.3f %12.3f %10.2f %7.2fx\n",
+                            info->name, strides[j], sizes[k], scalar * 1e9, accel * 1e9,
+                            bytesPerFrame / accel * 1e-9, scalar / accel );
+                }
+            }
+        }
+    }
+    EndSection();
+
+done:
+    free( source );
+    free( destination );
+}
+
+/*******************************************************************/
+
+typedef struct
+{
+    int channelCount;
+    PaSampleFormat userFormat;
+    PaSampleFormat hostFormat;
+    unsigned long framesPerUserBuffer;  /* paFramesPerBufferUnspecified -> NonAdaptingProcess */
+    unsigned long framesPerHostBuffer;
+}
+ProcessorConfig;
+
+
+/* copies the input to the output, like a wire */
+static int WireCallback( const void *input, void *output, unsigned long frameCount,
+        const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags,
+        void *userData )
+{
+    const ProcessorConfig *config = (const ProcessorConfig*)userData;
+    unsigned long bytes = frameCount * SampleSize( config->userFormat );
+    int i;
+    (void) timeInfo; /* unused parameter */
+    (void) statusFlags; /* unused parameter */
+
+    if( config->userFormat & paNonInterleaved )
+    {
+        for( i=0; i<config->channelCount; ++i )
+            memcpy( ((void**)output)[i], ((const void**)input)[i], bytes );
+    }
+    else
+    {
+        memcpy( output, input, bytes * config->channelCount );
+    }
+    return paContinue;
+}
+
+
+static void BenchmarkProcessor( const ProcessorConfig *config, void *hostInput, void *hostOutput )
+{
+    PaUtilBufferProcessor bp;
+    PaStreamCallbackTimeInfo timeInfo = { 0, 0, 0 };
+    unsigned long cycles = FRAMES_PER_TRIAL / config->framesPerHostBuffer;
+    unsigned long bytesPerFrame = (unsigned long)config->channelCount * 2 *
+            (SampleSize( config->userFormat ) + SampleSize( config->hostFormat ));
+    double best = -1., perFrame;
+    int trial, callbackResult;
+    PaError result;
+
+    result = PaUtil_InitializeBufferProcessor( &bp,
+            config->channelCount, config->userFormat, config->hostFormat,
+            config->channelCount, config->userFormat, config->hostFormat,
+            48000., paNoFlag, config->framesPerUserBuffer, config->framesPerHostBuffer,
+            paUtilFixedHostBufferSize, WireCallback, (void*)config );
+    if( result != paNoError )
+    {
+        printf( "PaUtil_InitializeBufferProcessor failed: %d\n", result );
+        return;
+    }
+
+    FillSourceBuffer( hostInput, config->hostFormat,
+            config->framesPerHostBuffer * config->channelCount );
+
+    for( trial=0; trial<TRIALS; ++trial )
+    {
+        unsigned long i;
+        double start = PaUtil_GetTime(), elapsed;
+
+        for( i=0; i<cycles; ++i )
+        {
+            PaUtil_BeginBufferProcessing( &bp, &timeInfo, 0 );
+            PaUtil_SetInputFrameCount( &bp, config->framesPerHostBuffer );
+            PaUtil_SetInterleavedInputChannels( &bp, 0, hostInput, 0 );
+            PaUtil_SetOutputFrameCount( &bp, config->framesPerHostBuffer );
+            PaUtil_SetInterleavedOutputChannels( &bp, 0, hostOutput, 0 );
+            callbackResult = paContinue;
+            PaUtil_EndBufferProcessing( &bp, &callbackResult );
+        }
+
+        elapsed = PaUtil_GetTime() - start;
+        if( best < 0. || elapsed < best )
+            best = elapsed;
+    }
+
+    PaUtil_TerminateBufferProcessor( &bp );
+
+    perFrame = best / ((double)cycles * config->framesPerHostBuffer);
+    if( json_ )
+    {
+        BeginRecord();
+        printf( "\"process\": \"%s\", \"channels\": %d, \"user\": \"%s\", \"nonInterleaved\": %s, "
+                "\"host\": \"%s\", \"userFrames\": %lu, \"hostFrames\": %lu, \"nsPerFrame\": %.4f }",
+                (config->framesPerUserBuffer == paFramesPerBufferUnspecified
+                        || config->framesPerHostBuffer % config->framesPerUserBuffer == 0)
+                        ? "non-adapting" : "adapting",
+                config->channelCount, FormatName( config->userFormat ),
+                (config->userFormat & paNonInterleaved) ? "true" : "false",
+                FormatName( config->hostFormat ),
+                config->framesPerUserBuffer, config->framesPerHostBuffer, perFrame * 1e9 );
+        return;
+    }
+    printf( "%-12s %3d %-6s %-8s %6lu %6lu %10.2f %10.2f\n",
+            (config->framesPerUserBuffer == paFramesPerBufferUnspecified
+                    || config->framesPerHostBuffer % config->framesPerUserBuffer == 0)
+                    ? "non-adapting" : "adapting",
+            config->channelCount,
+            (config->userFormat & paNonInterleaved) ? "F32 ni" : "F32",
+            FormatName( config->hostFormat ),
+            config->framesPerUserBuffer, config->framesPerHostBuffer,
+            perFrame * 1e9, bytesPerFrame / perFrame * 1e-9 );
+}
+
+
+static void BenchmarkProcessors( int quick )
+{
+    static const int channelCounts[] = { 2, 8, MAX_CHANNELS };
+    static const PaSampleFormat userFormats[] = { paFloat32, paFloat32 | paNonInterleaved };
+    static const PaSampleFormat hostFormats[] = { paInt16, paInt32, paFloat32 };
+    /* { user, host } frames: NonAdaptingProcess, AdaptingProcess */
+    static const unsigned long bufferSizes[][2] = { { paFramesPerBufferUnspecified, 512 }, { 480, 512 } };
+    unsigned long bufferBytes = (unsigned long)MAX_CHANNELS * 512 * 4;
+    void *hostInput = malloc( bufferBytes );
+    void *hostOutput = malloc( bufferBytes );
+    unsigned int c, u, h, b;
+
+    if( !hostInput || !hostOutput )
+    {
+        printf( "out of memory\n" );
+        goto done;
+    }
+
+    BeginSection( "processors", "Full duplex buffer processor, interleaved host buffers, wire callback" );
+    if( !json_ )
+        printf( "%-12s %3s %-6s %-8s %6s %6s %10s %10s\n",
+                "process", "ch", "user", "host", "user", "host", "ns/frame", "GB/s" );
+
+    for( c=0; c<ARRAY_SIZE_( channelCounts ); ++c )
+    {
+        if( quick && channelCounts[c] != MAX_CHANNELS )
+            continue;
+
+        for( u=0; u<ARRAY_SIZE_( userFormats ); ++u )
+        {
+            for( h=0; h<ARRAY_SIZE_( hostFormats ); ++h )
+            {
+                for( b=0; b<ARRAY_SIZE_( bufferSizes ); ++b )
+                {
+                    ProcessorConfig config;
+                    config.channelCount = channelCounts[c];
+                    config.userFormat = userFormats[u];
+                    config.hostFormat = hostFormats[h];
+                    config.framesPerUserBuffer = bufferSizes[b][0];
+                    config.framesPerHostBuffer = bufferSizes[b][1];
+                    BenchmarkProcessor( &config, hostInput, hostOutput );
+                }
+            }
+        }
+    }
+    EndSection();
+
+done:
+    free( hostInput );
+    free( hostOutput );
+}
+
+/*******************************************************************/
+
+#define STREAM_SAMPLE_RATE      (48000.)
+#define STREAM_FRAMES           (256)
+#define JITTER_CALLBACKS        (1000)  /* about 5 seconds */
+#define QUICK_JITTER_CALLBACKS  (200)
+#define THROUGHPUT_FRAMES       (1<<21)
+#define QUICK_THROUGHPUT_FRAMES (1<<19)
+
+typedef struct
+{
+    int channelCount;
+    unsigned long callbackCount;
+    unsigned long maxCallbacks;
+    unsigned long frameCount;
+    unsigned long maxFrames;
+    PaTime *callbackTimes;              /* NULL if not recorded */
+    PaTime firstTime;
+    PaTime lastTime;
+}
+StreamBenchmark;
+
+
+/* copies the input to the output, times the callbacks and completes the stream when enough were made */
+static int StreamCallback( const void *input, void *output, unsigned long frameCount,
+        const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags,
+        void *userData )
+{
+    StreamBenchmark *benchmark = (StreamBenchmark*)userData;
+    PaTime now = PaUtil_GetTime();
+    (void) timeInfo; /* unused parameter */
+    (void) statusFlags; /* unused parameter */
+
+    if( output )
+    {
+        if( input )
+            memcpy( output, input, frameCount * benchmark->channelCount * sizeof(float) );
+        else
+            memset( output, 0, frameCount * benchmark->channelCount * sizeof(float) );
+    }
+
+    if( benchmark->callbackCount == 0 )
+        benchmark->firstTime = now;
+    benchmark->lastTime = now;
+    if( benchmark->callbackTimes )
+        benchmark->callbackTimes[benchmark->callbackCount] = now;
+    benchmark->frameCount += frameCount;
+
+    return (++benchmark->callbackCount >= benchmark->maxCallbacks || benchmark->frameCount >= benchmark->maxFrames)
+            ? paComplete : paContinue;
+}
+
+
+/* Initializes PortAudio with the null host API configured by freeRun and hostFormat (an environment variable
+   setting), returns the index of its device named deviceName or paNoDevice */
+static PaDeviceIndex InitializeNullHostApi( char *freeRun, char *hostFormat, const char *deviceName )
+{
+    PaHostApiIndex hostApi;
+    int i;
+
+    putenv( freeRun );
+    putenv( hostFormat );
+    if( Pa_Initialize() != paNoError )
+        return paNoDevice;
+
+    for( hostApi=0; hostApi<Pa_GetHostApiCount(); ++hostApi )
+    {
+        const PaHostApiInfo *info = Pa_GetHostApiInfo( hostApi );
+        if( strcmp( info->name, "Null" ) != 0 )
+            continue;
+
+        for( i=0; i<info->deviceCount; ++i )
+        {
+            PaDeviceIndex device = Pa_HostApiDeviceIndexToDeviceIndex( hostApi, i );
+            if( strcmp( Pa_GetDeviceInfo( device )->name, deviceName ) == 0 )
+                return device;
+        }
+    }
+
+    Pa_Terminate();
+    return paNoDevice;
+}
+
+
+/* Runs a stream until its callback completes it */
+static PaError RunStream( PaDeviceIndex inputDevice, PaDeviceIndex outputDevice, StreamBenchmark *benchmark )
+{
+    PaStreamParameters inputParameters, outputParameters;
+    PaStream *stream;
+    PaError result;
+
+    inputParameters.device = inputDevice;
+    inputParameters.channelCount = benchmark->channelCount;
+    inputParameters.sampleFormat = paFloat32;
+    inputParameters.suggestedLatency = 0.;
+    inputParameters.hostApiSpecificStreamInfo = NULL;
+    outputParameters = inputParameters;
+    outputParameters.device = outputDevice;
+
+    result = Pa_OpenStream( &stream, inputDevice == paNoDevice ? NULL : &inputParameters,
+            &outputParameters, STREAM_SAMPLE_RATE, STREAM_FRAMES, paClipOff | paDitherOff,
+            StreamCallback, benchmark );
+    if( result != paNoError )
+        return result;
+
+    result = Pa_StartStream( stream );
+    if( result == paNoError )
+    {
+        while( (result = Pa_IsStreamActive( stream )) == 1 )
+            Pa_Sleep( 10 );
+        if( result == 0 )
+            result = Pa_StopStream( stream );
+    }
+
+    Pa_CloseStream( stream );
+    return result;
+}
+
+
+/* Times the intervals between the callbacks of a clock driven output stream */
+static void BenchmarkJitter( int quick )
+{
+    static char freeRun[] = "PA_NULL_FREERUN=0";
+    static char hostFormat[] = "PA_NULL_HOST_FORMAT=int16";
+    StreamBenchmark benchmark;
+    PaDeviceIndex device = InitializeNullHostApi( freeRun, hostFormat, "Null Device" );
+    double period = STREAM_FRAMES / STREAM_SAMPLE_RATE, sum = 0., sumOfSquares = 0., maxDeviation = 0.;
+    double mean, deviation;
+    unsigned long i, intervals;
+    PaError result;
+
+    if( device == paNoDevice )
+        return;
+
+    memset( &benchmark, 0, sizeof(benchmark) );
+    benchmark.channelCount = 2;
+    benchmark.maxCallbacks = quick ? QUICK_JITTER_CALLBACKS : JITTER_CALLBACKS;
+    benchmark.maxFrames = (unsigned long)-1;
+    benchmark.callbackTimes = (PaTime*)malloc( sizeof(PaTime) * benchmark.maxCallbacks );
+    if( !benchmark.callbackTimes )
+    {
+        printf( "out of memory\n" );
+        goto done;
+    }
+
+    result = RunStream( paNoDevice, device, &benchmark );
+    if( result != paNoError || benchmark.callbackCount < 2 )
+    {
+        printf( "jitter stream failed: %s\n", Pa_GetErrorText( result ) );
+        goto done;
+    }
+
+    intervals = benchmark.callbackCount - 1;
+    for( i=0; i<intervals; ++i )
+    {
+        double interval = benchmark.callbackTimes[i + 1] - benchmark.callbackTimes[i];
+        sum += interval;
+        sumOfSquares += interval * interval;
+        deviation = fabs( interval - period );
+        if( deviation > maxDeviation )
+            maxDeviation = deviation;
+    }
+    mean = sum / intervals;
+    deviation = sumOfSquares / intervals - mean * mean;
+    deviation = (deviation > 0.) ? sqrt( deviation ) : 0.;
+
+    if( json_ )
+    {
+        BeginRecord();
+        printf( "\"benchmark\": \"jitter\", \"frames\": %d, \"callbacks\": %lu, \"periodUs\": %.3f, "
+                "\"meanIntervalUs\": %.3f, \"stdDevUs\": %.3f, \"maxDeviationUs\": %.3f }",
+                STREAM_FRAMES, benchmark.callbackCount, period * 1e6, mean * 1e6, deviation * 1e6,
+                maxDeviation * 1e6 );
+    }
+    else
+    {
+        printf( "%6d %8lu %10.3f %10.3f %10.3f %10.3f\n", STREAM_FRAMES, benchmark.callbackCount,
+                period * 1e6, mean * 1e6, deviation * 1e6, maxDeviation * 1e6 );
+    }
+
+done:
+    free( benchmark.callbackTimes );
+    Pa_Terminate();
+}
+
+
+/* Times a free running full duplex stream on the loopback device, front end to host buffers and back */
+static void BenchmarkThroughput( int quick, char *hostFormat, PaSampleFormat format )
+{
+    static char freeRun[] = "PA_NULL_FREERUN=1";
+    StreamBenchmark benchmark;
+    PaDeviceIndex device = InitializeNullHostApi( freeRun, hostFormat, "Loopback Device" );
+    double perFrame;
+    PaError result;
+
+    if( device == paNoDevice )
+        return;
+
+    memset( &benchmark, 0, sizeof(benchmark) );
+    benchmark.channelCount = 2;
+    benchmark.maxCallbacks = (unsigned long)-1;
+    benchmark.maxFrames = quick ? QUICK_THROUGHPUT_FRAMES : THROUGHPUT_FRAMES;
+
+    result = RunStream( device, device, &benchmark );
+    if( result != paNoError || benchmark.callbackCount < 2 )
+    {
+        printf( "throughput stream failed: %s\n", Pa_GetErrorText( result ) );
+        goto done;
+    }
+
+    /* the first callback's frames are processed before firstTime */
+    perFrame = (benchmark.lastTime - benchmark.firstTime) / (benchmark.frameCount - STREAM_FRAMES);
+
+    if( json_ )
+    {
+        BeginRecord();
+        printf( "\"benchmark\": \"throughput\", \"host\": \"%s\", \"frames\": %d, \"callbacks\": %lu, "
+                "\"nsPerFrame\": %.4f }",
+                FormatName( format ), STREAM_FRAMES, benchmark.callbackCount, perFrame * 1e9 );
+    }
+    else
+    {
+        printf( "%-8s %6d %8lu %10.2f\n", FormatName( format ), STREAM_FRAMES,
+                benchmark.callbackCount, perFrame * 1e9 );
+    }
+
+done:
+    Pa_Terminate();
+}
+
+
+static void BenchmarkStreams( int quick )
+{
+    static char int16Format[] = "PA_NULL_HOST_FORMAT=int16";
+    static char int32Format[] = "PA_NULL_HOST_FORMAT=int32";
+    static char float32Format[] = "PA_NULL_HOST_FORMAT=float32";
+    static char freeRun[] = "PA_NULL_FREERUN=0";
+    PaDeviceIndex device = InitializeNullHostApi( freeRun, int16Format, "Null Device" );
+
+    if( device == paNoDevice )
+    {
+        if( !json_ )
+            printf( "\nStreams skipped, the null host API isn't available\n" );
+        return;
+    }
+    Pa_Terminate();
+
+    BeginSection( "streams", "Null host API, callback intervals of a 2 channel Float32 output stream" );
+    if( !json_ )
+        printf( "%6s %8s %10s %10s %10s %10s\n",
+                "frames", "calls", "period us", "mean us", "stddev us", "max dev us" );
+    BenchmarkJitter( quick );
+
+    if( !json_ )
+    {
+        printf( "\nNull host API, free running 2 channel Float32 full duplex loopback stream\n" );
+        printf( "%-8s %6s %8s %10s\n", "host", "frames", "calls", "ns/frame" );
+    }
+    BenchmarkThroughput( quick, int16Format, paInt16 );
+    BenchmarkThroughput( quick, int32Format, paInt32 );
+    BenchmarkThroughput( quick, float32Format, paFloat32 );
+
+    EndSection();
+}
+
+/*******************************************************************/
+
+#define SCALING_RUN_MSEC        (1000)
+#define QUICK_SCALING_RUN_MSEC  (300)
+
+static const int scalingStreamCounts_[] = { 1, 8, 32, 128, 256, 512 };
+static const int quickScalingStreamCounts_[] = { 1, 16, 128 };
+
+
+/* Returns the value of a field of /proc/self/status such as "Threads" or "VmRSS" (in kB), -1 if unknown */
+static long ReadProcessStatus( const char *field )
+{
+    long value = -1;
+#ifdef __linux__
+    char line[256];
+    size_t length = strlen( field );
+    FILE *file = fopen( "/proc/self/status", "r" );
+
+    if( !file )
+        return -1;
+    while( fgets( line, sizeof(line), file ) )
+    {
+        if( strncmp( line, field, length ) == 0 && line[length] == ':' )
+        {
+            value = strtol( line + length + 1, NULL, 10 );
+            break;
+        }
+    }
+    fclose( file );
+#else
+    (void) field; /* unused parameter */
+#endif
+    return value;
+}
+
+
+/* Initializes PortAudio and returns the default output device of the host API whose name contains hostApiName,
+   paNoDevice if there is none. The null host API is run clock driven with Float32 host buffers. */
+static PaDeviceIndex InitializeScalingHostApi( const char *hostApiName )
+{
+    static char freeRun[] = "PA_NULL_FREERUN=0";
+    static char hostFormat[] = "PA_NULL_HOST_FORMAT=float32";
+    PaHostApiIndex hostApi;
+
+    if( strcmp( hostApiName, "Null" ) == 0 )
+        return InitializeNullHostApi( freeRun, hostFormat, "Null Device" );
+
+    if( Pa_Initialize() != paNoError )
+        return paNoDevice;
+
+    for( hostApi=0; hostApi<Pa_GetHostApiCount(); ++hostApi )
+    {
+        const PaHostApiInfo *info = Pa_GetHostApiInfo( hostApi );
+        if( strstr( info->name, hostApiName ) && info->defaultOutputDevice != paNoDevice )
+            return info->defaultOutputDevice;
+    }
+
+    Pa_Terminate();
+    return paNoDevice;
+}
+
+
+/* Opens streamCount output streams at once, runs them for runMsec and closes them again */
+static void BenchmarkScalingStep( const char *hostApiName, int streamCount, long runMsec )
+{
+    PaStream **streams = (PaStream**)calloc( streamCount, sizeof(PaStream*) );
+    StreamBenchmark *benchmarks = (StreamBenchmark*)calloc( streamCount, sizeof(StreamBenchmark) );
+    PaDeviceIndex device = paNoDevice;
+    PaStreamParameters parameters;
+    PaTime start, elapsed, openSum = 0., openMax = 0., closeSum = 0., closeMax = 0.;
+    PaTime startTime, runTime, stopTime;
+    long rss0, rss1, threads0, threads1;
+    clock_t cpu0, cpu1;
+    double cpuPerStream, callbackShare, expectedCallbacks;
+    unsigned long callbacks = 0;
+    int opened = 0, started = 0, i;
+    PaError result = paNoError;
+
+    if( !streams || !benchmarks )
+    {
+        printf( "out of memory\n" );
+        goto done;
+    }
+
+    device = InitializeScalingHostApi( hostApiName );
+    if( device == paNoDevice )
+    {
+        if( !json_ )
+            printf( "no output device on a host API named %s\n", hostApiName );
+        goto done;
+    }
+
+    parameters.device = device;
+    parameters.channelCount = 2;
+    parameters.sampleFormat = paFloat32;
+    parameters.suggestedLatency = Pa_GetDeviceInfo( device )->defaultLowOutputLatency;
+    parameters.hostApiSpecificStreamInfo = NULL;
+
+    rss0 = ReadProcessStatus( "VmRSS" );
+    threads0 = ReadProcessStatus( "Threads" );
+
+    for( opened=0; opened<streamCount; ++opened )
+    {
+        benchmarks[opened].channelCount = 2;
+        benchmarks[opened].maxCallbacks = (unsigned long)-1;
+        benchmarks[opened].maxFrames = (unsigned long)-1;
+
+        start = PaUtil_GetTime();
+        result = Pa_OpenStream( &streams[opened], NULL, &parameters, STREAM_SAMPLE_RATE, STREAM_FRAMES,
+                paClipOff | paDitherOff, StreamCallback, &benchmarks[opened] );
+        elapsed = PaUtil_GetTime() - start;
+        if( result != paNoError )
+            break;
+
+        openSum += elapsed;
+        if( elapsed > openMax )
+            openMax = elapsed;
+    }
+
+    start = PaUtil_GetTime();
+    for( started=0; started<opened; ++started )
+    {
+        if( Pa_StartStream( streams[started] ) != paNoError )
+            break;
+    }
+    startTime = PaUtil_GetTime() - start;
+
+    cpu0 = clock();
+    start = PaUtil_GetTime();
+    Pa_Sleep( runMsec );
+    runTime = PaUtil_GetTime() - start;
+    cpu1 = clock();
+
+    /* streams of hosts which start their threads or buffers on demand have them now */
+    rss1 = ReadProcessStatus( "VmRSS" );
+    threads1 = ReadProcessStatus( "Threads" );
+
+    for( i=0; i<started; ++i )
+        callbacks += benchmarks[i].callbackCount;
+
+    start = PaUtil_GetTime();
+    for( i=0; i<started; ++i )
+        Pa_StopStream( streams[i] );
+    stopTime = PaUtil_GetTime() - start;
+
+    /* in the order they were opened, the worst case for the open stream list */
+    for( i=0; i<opened; ++i )
+    {
+        start = PaUtil_GetTime();
+        Pa_CloseStream( streams[i] );
+        elapsed = PaUtil_GetTime() - start;
+        closeSum += elapsed;
+        if( elapsed > closeMax )
+            closeMax = elapsed;
+    }
+
+    cpuPerStream = started ? (double)(cpu1 - cpu0) / CLOCKS_PER_SEC / runTime / started : 0.;
+    expectedCallbacks = started * runTime * STREAM_SAMPLE_RATE / STREAM_FRAMES;
+    callbackShare = expectedCallbacks > 0. ? callbacks / expectedCallbacks : 0.;
+
+    if( json_ )
+    {
+        BeginRecord();
+        printf( "\"hostApi\": \"%s\", \"streams\": %d, \"opened\": %d, \"started\": %d, "
+                "\"openMeanUs\": %.1f, \"openMaxUs\": %.1f, \"startAllUs\": %.1f, \"stopAllUs\": %.1f, "
+                "\"closeMeanUs\": %.1f, \"closeMaxUs\": %.1f, \"cpuPercentPerStream\": %.3f, "
+                "\"callbackShare\": %.3f",
+                Pa_GetHostApiInfo( Pa_GetDeviceInfo( device )->hostApi )->name, streamCount, opened, started,
+                opened ? openSum / opened * 1e6 : 0., openMax * 1e6, startTime * 1e6, stopTime * 1e6,
+                opened ? closeSum / opened * 1e6 : 0., closeMax * 1e6, cpuPerStream * 100., callbackShare );
+        if( threads0 >= 0 && threads1 >= 0 && started )
+            printf( ", \"threadsPerStream\": %.2f", (double)(threads1 - threads0) / started );
+        if( rss0 >= 0 && rss1 >= 0 && started )
+            printf( ", \"kBPerStream\": %.1f", (double)(rss1 - rss0) / started );
+        printf( " }" );
+    }
+    else
+    {
+        printf( "%7d %6d %9.1f %9.1f %10.1f %10.1f %9.3f %8.3f",
+                streamCount, started, opened ? openSum / opened * 1e6 : 0., openMax * 1e6,
+                opened ? closeSum / opened * 1e6 : 0., closeMax * 1e6, cpuPerStream * 100., callbackShare );
+        if( threads0 >= 0 && threads1 >= 0 && started )
+            printf( " %8.2f", (double)(threads1 - threads0) / started );
+        else
+            printf( " %8s", "-" );
+        if( rss0 >= 0 && rss1 >= 0 && started )
+            printf( " %9.1f\n", (double)(rss1 - rss0) / started );
+        else
+            printf( " %9s\n", "-" );
+        if( opened < streamCount )
+            printf( "        opening stream %d failed: %s\n", opened + 1, Pa_GetErrorText( result ) );
+    }
+
+done:
+    if( device != paNoDevice )
+        Pa_Terminate();
+    free( benchmarks );
+    free( streams );
+}
+
+
+static void BenchmarkScaling( int quick, const char *hostApiName )
+{
+    const int *counts = quick ? quickScalingStreamCounts_ : scalingStreamCounts_;
+    int countCount = quick ? ARRAY_SIZE_( quickScalingStreamCounts_ ) : ARRAY_SIZE_( scalingStreamCounts_ );
+    int i;
+
+    BeginSection( "scaling", NULL );
+    if( !json_ )
+    {
+        printf( "\n%s host API, concurrent 2 channel Float32 output streams of %d frames\n", hostApiName, STREAM_FRAMES );
+        printf( "%7s %6s %9s %9s %10s %10s %9s %8s %8s %9s\n", "streams", "ran", "open us", "open max",
+                "close us", "close max", "cpu %", "calls", "threads", "kB" );
+    }
+
+    for( i=0; i<countCount; ++i )
+        BenchmarkScalingStep( hostApiName, counts[i], quick ? QUICK_SCALING_RUN_MSEC : SCALING_RUN_MSEC );
+
+    EndSection();
+}
+
+/*******************************************************************/
+
+/* Single producer single consumer transfers through the ring buffer
+   variants, between two threads on the same or on different processors */
+
+#define RING_BYTES_PER_TRIAL        (1<<24)
+#define QUICK_RING_BYTES_PER_TRIAL  (1<<21)
+#define RING_TRIALS                 (3)
+#define RING_HANDOFFS               (100000)
+#define QUICK_RING_HANDOFFS         (10000)
+#define RING_WARMUP_HANDOFFS        (1000)
+#define RING_SPINS_BEFORE_YIELD     (1000)
+#define RING_HANDOFF_CAPACITY       (512)     /* a page of elements, so the mirrored buffer runs too */
+#define RING_HANDOFF_ELEMENT_SIZE   (8)
+
+static const long ringElementSizes_[] = { 4, 8, 64 };
+static const long quickRingElementSizes_[] = { 8 };
+static const long ringCapacities_[] = { 256, 4096, 65536 };
+static const long quickRingCapacities_[] = { 4096 };
+
+
+typedef struct
+{
+    PaUtilRingBuffer ringBuffer;
+    PaUtilSpscRingBuffer spscRingBuffer;
+    void *data;
+    long mirroredSize;      /* > 0 if data was allocated with PaUtil_AllocateMirroredMemory() */
+}
+RingBenchmarkBuffer;
+
+
+typedef struct
+{
+    const char *name;
+    int (*initialize)( RingBenchmarkBuffer *buffer, long elementSize, long capacity );
+    ring_buffer_size_t (*write)( RingBenchmarkBuffer *buffer, const void *data, ring_buffer_size_t count );
+    ring_buffer_size_t (*read)( RingBenchmarkBuffer *buffer, void *data, ring_buffer_size_t count );
+}
+RingBufferVariant;
+
+
+static int InitializePlainRing( RingBenchmarkBuffer *buffer, long elementSize, long capacity )
+{
+    buffer->data = PaUtil_AllocateMemory( elementSize * capacity );
+    return buffer->data
+            && PaUtil_InitializeRingBuffer( &buffer->ringBuffer, elementSize, capacity, buffer->data ) == 0;
+}
+
+
+static ring_buffer_size_t WritePlainRing( RingBenchmarkBuffer *buffer, const void *data, ring_buffer_size_t count )
+{
+    return PaUtil_WriteRingBuffer( &buffer->ringBuffer, data, count );
+}
+
+
+static ring_buffer_size_t ReadPlainRing( RingBenchmarkBuffer *buffer, void *data, ring_buffer_size_t count )
+{
+    return PaUtil_ReadRingBuffer( &buffer->ringBuffer, data, count );
+}
+
+
+static int InitializeSpscRing( RingBenchmarkBuffer *buffer, long elementSize, long capacity )
+{
+    buffer->data = PaUtil_AllocateMemory( elementSize * capacity );
+    return buffer->data
+            && PaUtil_InitializeSpscRingBuffer( &buffer->spscRingBuffer, elementSize, capacity, buffer->data ) == 0;
+}
+
+
+static ring_buffer_size_t WriteSpscRing( RingBenchmarkBuffer *buffer, const void *data, ring_buffer_size_t count )
+{
+    return PaUtil_WriteSpscRingBuffer( &buffer->spscRingBuffer, data, count );
+}
+
+
+static ring_buffer_size_t ReadSpscRing( RingBenchmarkBuffer *buffer, void *data, ring_buffer_size_t count )
+{
+    return PaUtil_ReadSpscRingBuffer( &buffer->spscRingBuffer, data, count );
+}
+
+
+/* only for capacities whose size is a multiple of the mapping granularity */
+static int InitializeMirroredRing( RingBenchmarkBuffer *buffer, long elementSize, long capacity )
+{
+    long size = elementSize * capacity;
+
+    buffer->data = PaUtil_AllocateMirroredMemory( &size );
+    if( !buffer->data )
+        return 0;
+    buffer->mirroredSize = size;
+    return size == elementSize * capacity
+            && PaUtil_InitializeRingBuffer( &buffer->ringBuffer, elementSize, capacity, buffer->data ) == 0;
+}
+
+
+static ring_buffer_size_t WriteMirroredRing( RingBenchmarkBuffer *buffer, const void *data, ring_buffer_size_t count )
+{
+    void *region;
+
+    count = PaUtil_GetRingBufferContiguousWriteRegion( &buffer->ringBuffer, count, &region );
+    if( count > 0 )
+    {
+        memcpy( region, data, count * buffer->ringBuffer.elementSizeBytes );
+        PaUtil_AdvanceRingBufferWriteIndex( &buffer->ringBuffer, count );
+    }
+    return count;
+}
+
+
+static ring_buffer_size_t ReadMirroredRing( RingBenchmarkBuffer *buffer, void *data, ring_buffer_size_t count )
+{
+    void *region;
+
+    count = PaUtil_GetRingBufferContiguousReadRegion( &buffer->ringBuffer, count, &region );
+    if( count > 0 )
+    {
+        memcpy( data, region, count * buffer->ringBuffer.elementSizeBytes );
+        PaUtil_AdvanceRingBufferReadIndex( &buffer->ringBuffer, count );
+    }
+    return count;
+}
+
+
+static const RingBufferVariant ringBufferVariants_[] = {
+    { "PaUtilRingBuffer", InitializePlainRing, WritePlainRing, ReadPlainRing },
+    { "PaUtilSpscRingBuffer", InitializeSpscRing, WriteSpscRing, ReadSpscRing },
+    { "mirrored", InitializeMirroredRing, WriteMirroredRing, ReadMirroredRing }
+};
+
+
+/* allocated separately so the buffers don't share cache lines with the threads' state */
+static RingBenchmarkBuffer *NewRingBenchmarkBuffer( const RingBufferVariant *variant, long elementSize, long capacity )
+{
+    RingBenchmarkBuffer *buffer = (RingBenchmarkBuffer*)calloc( 1, sizeof(RingBenchmarkBuffer) );
+
+    if( buffer && !variant->initialize( buffer, elementSize, capacity ) )
+    {
+        if( buffer->mirroredSize > 0 )
+            PaUtil_FreeMirroredMemory( buffer->data, buffer->mirroredSize );
+        else
+            PaUtil_FreeMemory( buffer->data );
+        free( buffer );
+        buffer = NULL;
+    }
+    return buffer;
+}
+
+
+static void DeleteRingBenchmarkBuffer( RingBenchmarkBuffer *buffer )
+{
+    if( !buffer )
+        return;
+    if( buffer->mirroredSize > 0 )
+        PaUtil_FreeMirroredMemory( buffer->data, buffer->mirroredSize );
+    else
+        PaUtil_FreeMemory( buffer->data );
+    free( buffer );
+}
+
+
+typedef struct
+{
+    const RingBufferVariant *variant;
+    RingBenchmarkBuffer *buffer;            /* written by the first thread, read by the second one */
+    RingBenchmarkBuffer *returnBuffer;      /* handoffs: written by the second thread */
+    long elementSize;
+    ring_buffer_size_t chunk;               /* elements per write or read */
+    long elementCount;                      /* to transfer, or handoffs to make */
+    int cpu[2];                             /* processors of the threads, -1 for any */
+    void *data[2];                          /* chunk elements for each thread */
+    volatile int ready[2];
+    double start, end;
+    double *roundTrips;                     /* handoffs: seconds per round trip */
+}
+RingBenchmark;
+
+
+typedef struct
+{
+    RingBenchmark *benchmark;
+    int side;
+}
+RingBenchmarkThreadArgument;
+
+
+#ifdef _WIN32
+typedef HANDLE RingBenchmarkThread;
+#else
+typedef pthread_t RingBenchmarkThread;
+#endif
+
+
+static void YieldBenchmarkThread( void )
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+
+static int GetProcessorCount( void )
+{
+#ifdef _WIN32
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo( &systemInfo );
+    return (int)systemInfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    return (int)sysconf( _SC_NPROCESSORS_ONLN );
+#else
+    return 1;
+#endif
+}
+
+
+/* returns 0 where threads can't be bound to processors (e.g. macOS) */
+static int PinBenchmarkThread( int cpu )
+{
+#ifdef _WIN32
+    return cpu < 64 && SetThreadAffinityMask( GetCurrentThread(), (DWORD_PTR)1 << cpu ) != 0;
+#elif defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO( &cpus );
+    CPU_SET( cpu, &cpus );
+    return sched_setaffinity( 0, sizeof(cpus), &cpus ) == 0;
+#else
+    (void)cpu;
+    return 0;
+#endif
+}
+
+
+static int CanPinBenchmarkThreads( void )
+{
+#if defined(_WIN32) || defined(__linux__)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+/* spin for a while, then let the other thread run in case it shares our processor */
+static void WaitForRingBuffer( unsigned long *spins )
+{
+    if( ++*spins >= RING_SPINS_BEFORE_YIELD )
+    {
+        *spins = 0;
+        YieldBenchmarkThread();
+    }
+}
+
+
+static void WriteRing( RingBenchmark *benchmark, RingBenchmarkBuffer *buffer, const char *data,
+        ring_buffer_size_t count, unsigned long *spins )
+{
+    while( count > 0 )
+    {
+        ring_buffer_size_t written = benchmark->variant->write( buffer, data, count );
+        if( written == 0 )
+            WaitForRingBuffer( spins );
+        data += written * benchmark->elementSize;
+        count -= written;
+    }
+}
+
+
+static void ReadRing( RingBenchmark *benchmark, RingBenchmarkBuffer *buffer, char *data,
+        ring_buffer_size_t count, unsigned long *spins )
+{
+    while( count > 0 )
+    {
+        ring_buffer_size_t read = benchmark->variant->read( buffer, data, count );
+        if( read == 0 )
+            WaitForRingBuffer( spins );
+        data += read * benchmark->elementSize;
+        count -= read;
+    }
+}
+
+
+static void RunRingBenchmarkSide( RingBenchmark *benchmark, int side )
+{
+    unsigned long spins = 0;
+    long i;
+
+    if( benchmark->cpu[side] >= 0 )
+        PinBenchmarkThread( benchmark->cpu[side] );
+
+    /* start together once both threads run where they should */
+    benchmark->ready[side] = 1;
+    PaUtil_FullMemoryBarrier();
+    while( !benchmark->ready[!side] )
+        WaitForRingBuffer( &spins );
+
+    if( !benchmark->returnBuffer )
+    {
+        /* throughput: the first thread writes, the second one reads */
+        if( side == 0 )
+        {
+            benchmark->start = PaUtil_GetTime();
+            for( i=0; i<benchmark->elementCount; i+=benchmark->chunk )
+                WriteRing( benchmark, benchmark->buffer, (const char*)benchmark->data[0], benchmark->chunk, &spins );
+        }
+        else
+        {
+            for( i=0; i<benchmark->elementCount; i+=benchmark->chunk )
+                ReadRing( benchmark, benchmark->buffer, (char*)benchmark->data[1], benchmark->chunk, &spins );
+            benchmark->end = PaUtil_GetTime();
+        }
+    }
+    else
+    {
+        /* handoff latency: the first thread sends an element, the second one sends it back */
+        for( i=-RING_WARMUP_HANDOFFS; i<benchmark->elementCount; ++i )
+        {
+            if( side == 0 )
+            {
+                double start = PaUtil_GetTime();
+                WriteRing( benchmark, benchmark->buffer, (const char*)benchmark->data[0], 1, &spins );
+                ReadRing( benchmark, benchmark->returnBuffer, (char*)benchmark->data[0], 1, &spins );
+                if( i >= 0 )
+                    benchmark->roundTrips[i] = PaUtil_GetTime() - start;
+            }
+            else
+            {
+                ReadRing( benchmark, benchmark->buffer, (char*)benchmark->data[1], 1, &spins );
+                WriteRing( benchmark, benchmark->returnBuffer, (const char*)benchmark->data[1], 1, &spins );
+            }
+        }
+    }
+}
+
+
+#ifdef _WIN32
+static unsigned __stdcall RingBenchmarkThreadFunction( void *userData )
+#else
+static void *RingBenchmarkThreadFunction( void *userData )
+#endif
+{
+    RingBenchmarkThreadArgument *argument = (RingBenchmarkThreadArgument*)userData;
+    RunRingBenchmarkSide( argument->benchmark, argument->side );
+    return 0;
+}
+
+
+/* runs the two sides of benchmark on two threads */
+static void RunRingBenchmark( RingBenchmark *benchmark )
+{
+    RingBenchmarkThreadArgument arguments[2];
+    RingBenchmarkThread threads[2];
+    int i;
+
+    benchmark->ready[0] = benchmark->ready[1] = 0;
+    for( i=0; i<2; ++i )
+    {
+        arguments[i].benchmark = benchmark;
+        arguments[i].side = i;
+#ifdef _WIN32
+        threads[i] = (HANDLE)_beginthreadex( NULL, 0, RingBenchmarkThreadFunction, &arguments[i], 0, NULL );
+        if( !threads[i] )
+#else
+        if( pthread_create( &threads[i], NULL, RingBenchmarkThreadFunction, &arguments[i] ) != 0 )
+#endif
+        {
+            /* the first thread would wait for its partner forever */
+            printf( "could not start a benchmark thread\n" );
+            exit( 1 );
+        }
+    }
+
+    for( i=0; i<2; ++i )
+    {
+#ifdef _WIN32
+        WaitForSingleObject( threads[i], INFINITE );
+        CloseHandle( threads[i] );
+#else
+        pthread_join( threads[i], NULL );
+#endif
+    }
+}
+
+
+typedef struct
+{
+    const char *name;
+    int cpu[2];
+}
+RingPlacement;
+
+
+/* same processor, two processors, or where the scheduler likes if threads can't be pinned */
+static int GetRingPlacements( RingPlacement *placements )
+{
+    int count = 0;
+
+    if( CanPinBenchmarkThreads() )
+    {
+        placements[count].name = "same-core";
+        placements[count].cpu[0] = placements[count].cpu[1] = 0;
+        ++count;
+        if( GetProcessorCount() > 1 )
+        {
+            placements[count].name = "cross-core";
+            placements[count].cpu[0] = 0;
+            placements[count].cpu[1] = 1;
+            ++count;
+        }
+    }
+    else
+    {
+        placements[count].name = "unpinned";
+        placements[count].cpu[0] = placements[count].cpu[1] = -1;
+        ++count;
+    }
+    return count;
+}
+
+
+static int CompareDoubles( const void *a, const void *b )
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+
+static void BenchmarkRingBufferThroughput( int quick, const RingPlacement *placements, int placementCount )
+{
+    const long *elementSizes = quick ? quickRingElementSizes_ : ringElementSizes_;
+    int elementSizeCount = quick ? ARRAY_SIZE_( quickRingElementSizes_ ) : ARRAY_SIZE_( ringElementSizes_ );
+    const long *capacities = quick ? quickRingCapacities_ : ringCapacities_;
+    int capacityCount = quick ? ARRAY_SIZE_( quickRingCapacities_ ) : ARRAY_SIZE_( ringCapacities_ );
+    long bytesPerTrial = quick ? QUICK_RING_BYTES_PER_TRIAL : RING_BYTES_PER_TRIAL;
+    int i, j, k, p, trial;
+
+    BeginSection( "ringBuffers", "Ring buffer throughput, one writer and one reader thread, chunk = capacity / 4" );
+    if( !json_ )
+        printf( "%-22s %-10s %7s %8s %6s %10s\n", "variant", "placement", "element", "capacity", "chunk", "MB/s" );
+
+    for( p=0; p<placementCount; ++p )
+    {
+        for( i=0; i<elementSizeCount; ++i )
+        {
+            for( j=0; j<capacityCount; ++j )
+            {
+                for( k=0; k<(int)ARRAY_SIZE_( ringBufferVariants_ ); ++k )
+                {
+                    RingBenchmark benchmark;
+                    double best = -1.;
+                    long elementSize = elementSizes[i];
+
+                    memset( &benchmark, 0, sizeof(benchmark) );
+                    benchmark.variant = &ringBufferVariants_[k];
+                    benchmark.elementSize = elementSize;
+                    benchmark.chunk = capacities[j] / 4;
+                    benchmark.elementCount = (bytesPerTrial / elementSize / benchmark.chunk) * benchmark.chunk;
+                    benchmark.cpu[0] = placements[p].cpu[0];
+                    benchmark.cpu[1] = placements[p].cpu[1];
+                    benchmark.data[0] = calloc( benchmark.chunk, elementSize );
+                    benchmark.data[1] = calloc( benchmark.chunk, elementSize );
+
+                    for( trial=0; trial<RING_TRIALS && benchmark.data[0] && benchmark.data[1]; ++trial )
+                    {
+                        benchmark.buffer = NewRingBenchmarkBuffer( benchmark.variant, elementSize, capacities[j] );
+                        if( !benchmark.buffer )
+                            break;
+                        RunRingBenchmark( &benchmark );
+                        if( best < 0. || benchmark.end - benchmark.start < best )
+                            best = benchmark.end - benchmark.start;
+                        DeleteRingBenchmarkBuffer( benchmark.buffer );
+                    }
+                    free( benchmark.data[0] );
+                    free( benchmark.data[1] );
+
+                    /* e.g. a mirrored buffer smaller than a page */
+                    if( best <= 0. )
+                        continue;
+
+                    if( json_ )
+                    {
+                        BeginRecord();
+                        printf( "\"variant\": \"%s\", \"placement\": \"%s\", \"elementSize\": %ld, \"capacity\": %ld, "
+                                "\"chunk\": %ld, \"mBytesPerSecond\": %.1f }",
+                                benchmark.variant->name, placements[p].name, elementSize, capacities[j],
+                                (long)benchmark.chunk, benchmark.elementCount * elementSize / best * 1e-6 );
+                    }
+                    else
+                    {
+                        printf( "%-22s %-10s %7ld %8ld %6ld %10.1f\n",
+                                benchmark.variant->name, placements[p].name, elementSize, capacities[j],
+                                (long)benchmark.chunk, benchmark.elementCount * elementSize / best * 1e-6 );
+                    }
+                }
+            }
+        }
+    }
+    EndSection();
+}
+
+
+static void BenchmarkRingBufferHandoffs( int quick, const RingPlacement *placements, int placementCount )
+{
+    long handoffs = quick ? QUICK_RING_HANDOFFS : RING_HANDOFFS;
+    double *roundTrips = (double*)malloc( handoffs * sizeof(double) );
+    int k, p;
+
+    if( !roundTrips )
+    {
+        printf( "out of memory\n" );
+        return;
+    }
+
+    BeginSection( "ringBufferHandoffs", NULL );
+    if( !json_ )
+    {
+        printf( "\nRing buffer handoff latency, single %d byte elements sent back and forth, half the round trip\n",
+                RING_HANDOFF_ELEMENT_SIZE );
+        printf( "%-22s %-10s %10s %10s %10s\n", "variant", "placement", "median ns", "mean ns", "99% ns" );
+    }
+
+    for( p=0; p<placementCount; ++p )
+    {
+        for( k=0; k<(int)ARRAY_SIZE_( ringBufferVariants_ ); ++k )
+        {
+            RingBenchmark benchmark;
+            double sum = 0.;
+            long i;
+            int ran = 0;
+
+            memset( &benchmark, 0, sizeof(benchmark) );
+            benchmark.variant = &ringBufferVariants_[k];
+            benchmark.elementSize = RING_HANDOFF_ELEMENT_SIZE;
+            benchmark.chunk = 1;
+            benchmark.elementCount = handoffs;
+            benchmark.cpu[0] = placements[p].cpu[0];
+            benchmark.cpu[1] = placements[p].cpu[1];
+            benchmark.data[0] = calloc( 1, RING_HANDOFF_ELEMENT_SIZE );
+            benchmark.data[1] = calloc( 1, RING_HANDOFF_ELEMENT_SIZE );
+            benchmark.roundTrips = roundTrips;
+            benchmark.buffer = NewRingBenchmarkBuffer( benchmark.variant, RING_HANDOFF_ELEMENT_SIZE, RING_HANDOFF_CAPACITY );
+            benchmark.returnBuffer = NewRingBenchmarkBuffer( benchmark.variant, RING_HANDOFF_ELEMENT_SIZE, RING_HANDOFF_CAPACITY );
+
+            if( benchmark.buffer && benchmark.returnBuffer && benchmark.data[0] && benchmark.data[1] )
+            {
+                RunRingBenchmark( &benchmark );
+                ran = 1;
+            }
+
+            DeleteRingBenchmarkBuffer( benchmark.buffer );
+            DeleteRingBenchmarkBuffer( benchmark.returnBuffer );
+            free( benchmark.data[0] );
+            free( benchmark.data[1] );
+            if( !ran )
+                continue;
+
+            for( i=0; i<handoffs; ++i )
+                sum += roundTrips[i];
+            qsort( roundTrips, handoffs, sizeof(double), CompareDoubles );
+
+            if( json_ )
+            {
+                BeginRecord();
+                printf( "\"variant\": \"%s\", \"placement\": \"%s\", \"medianNs\": %.1f, \"meanNs\": %.1f, "
+                        "\"p99Ns\": %.1f }", benchmark.variant->name, placements[p].name,
+                        roundTrips[handoffs / 2] * 0.5e9, sum / handoffs * 0.5e9, roundTrips[handoffs * 99 / 100] * 0.5e9 );
+            }
+            else
+            {
+                printf( "%-22s %-10s %10.1f %10.1f %10.1f\n", benchmark.variant->name, placements[p].name,
+                        roundTrips[handoffs / 2] * 0.5e9, sum / handoffs * 0.5e9, roundTrips[handoffs * 99 / 100] * 0.5e9 );
+            }
+        }
+    }
+    EndSection();
+    free( roundTrips );
+}
+
+
+static void BenchmarkRingBuffers( int quick )
+{
+    RingPlacement placements[2];
+    int placementCount = GetRingPlacements( placements );
+
+    BenchmarkRingBufferThroughput( quick, placements, placementCount );
+    BenchmarkRingBufferHandoffs( quick, placements, placementCount );
+}
+
+/*******************************************************************/
+int main( int argc, char **argv );
+int main( int argc, char **argv )
+{
+    int quick = 0, converters = 0, processors = 0, streams = 0, scaling = 0, ringBuffers = 0;
+    const char *nameFilter = 0;
+    const char *hostApiName = "Null";
+    int i;
+
+    for( i=1; i<argc; ++i )
+    {
+        if( strcmp( argv[i], "-q" ) == 0 )
+            quick = 1;
+        else if( strcmp( argv[i], "-j" ) == 0 )
+            json_ = 1;
+        else if( strcmp( argv[i], "-c" ) == 0 )
+            converters = 1;
+        else if( strcmp( argv[i], "-p" ) == 0 )
+            processors = 1;
+        else if( strcmp( argv[i], "-s" ) == 0 )
+            streams = 1;
+        else if( strcmp( argv[i], "-m" ) == 0 )
+            scaling = 1;
+        else if( strcmp( argv[i], "-r" ) == 0 )
+            ringBuffers = 1;
+        else if( strcmp( argv[i], "-H" ) == 0 && i + 1 < argc )
+            hostApiName = argv[++i];
+        else if( argv[i][0] == '-' )
+        {
+            printf( "usage: %s [-q] [-j] [-c] [-p] [-s] [-r] [-m] [-H hostapi] [name]\n", argv[0] );
+            return 1;
+        }
+        else
+            nameFilter = argv[i];
+    }
+
+    if( !converters && !processors && !streams && !ringBuffers && !scaling )
+        converters = processors = streams = ringBuffers = 1;
+
+    /* the parts of Pa_Initialize the benchmarks need, without opening any host API */
+    PaUtil_InitializeClock();
+    PaUtil_InitializeConverterTable();
+
+    if( json_ )
+        printf( "{\n  \"version\": \"%s\"", Pa_GetVersionInfo()->versionText );
+    else
+        printf( "PortAudio benchmark - %s\n", Pa_GetVersionInfo()->versionText );
+    jsonSectionCount_ = 1;
+
+    if( converters )
+        BenchmarkConverters( nameFilter, quick );
+    if( processors )
+        BenchmarkProcessors( quick );
+    if( streams )
+        BenchmarkStreams( quick );
+    if( ringBuffers )
+        BenchmarkRingBuffers( quick );
+    if( scaling )
+        BenchmarkScaling( quick, hostApiName );
+
+    if( json_ )
+        printf( "\n}\n" );
+
+    return 0;
+}
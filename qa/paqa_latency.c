@@ -74,6 +74,11 @@ paTestData;
 int g_testsPassed = 0;
 int g_testsFailed = 0;
 
+void PaQa_CountTest( int *counter )
+{
+    *counter += 1;
+}
+
 /* This routine will be called by the PortAudio engine when audio is needed.
 ** It may called at interrupt level on some machines so don't do anything
 ** that could mess up the system like calling malloc() or free().
@@ -44,6 +44,9 @@
 */
 
 
+#include <stddef.h> /* size_t */
+#include <string.h> /* memset */
+
 #include "pa_allocation.h"
 #include "pa_util.h"
 
@@ -60,12 +63,39 @@
 
 #define PA_INITIAL_LINK_COUNT_    16
 
+/* the arena is touched and aligned in steps of the smallest common page size */
+#define PA_ARENA_PAGE_SIZE_       4096
+
+/* where the buffer of a link comes from */
+#define PA_HEAP_BLOCK_            0   /* PaUtil_AllocateMemory() */
+#define PA_ALIGNED_BLOCK_         1   /* PaUtil_AllocateAlignedMemory() */
+#define PA_ARENA_BLOCK_           2   /* carved from the group's arena */
+
+/* the bytes PaUtil_AllocateAlignedMemory() takes from the heap */
+#define PA_ALIGNED_BLOCK_SIZE_( size, alignment ) \
+    ( (size) + ((alignment) < (long)sizeof(void*) ? (long)sizeof(void*) : (alignment)) + (long)sizeof(void*) )
+
 struct PaUtilAllocationGroupLink
 {
     struct PaUtilAllocationGroupLink *next;
     void *buffer;
+    int blockType;
+    long size;      /* bytes taken from the heap, 0 for arena blocks */
 };
 
+
+static void FreeLinkBuffer( PaUtilAllocationGroup* group, struct PaUtilAllocationGroupLink *link )
+{
+    group->heapBytes -= link->size;
+    link->size = 0;
+
+    if( link->blockType == PA_ALIGNED_BLOCK_ )
+        PaUtil_FreeAlignedMemory( link->buffer );
+    else if( link->blockType == PA_HEAP_BLOCK_ )
+        PaUtil_FreeMemory( link->buffer );
+    /* arena blocks go away with the arena */
+}
+
 /*
     Allocate a block of links. The first link will have it's buffer member
     pointing to the block, and it's next member set to <nextBlock>. The remaining
@@ -86,12 +116,16 @@ static struct PaUtilAllocationGroupLink *AllocateLinks( long count,
         /* the block link */
         result[0].buffer = result;
         result[0].next = nextBlock;
+        result[0].blockType = PA_HEAP_BLOCK_;
+        result[0].size = 0;
 
         /* the spare links */
         for( i=1; i<count; ++i )
         {
             result[i].buffer = 0;
             result[i].next = &result[i+1];
+            result[i].blockType = PA_HEAP_BLOCK_;
+            result[i].size = 0;
         }
         result[count-1].next = nextSpare;
     }
@@ -116,6 +150,12 @@ PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void )
             result->linkBlocks = &links[0];
             result->spareLinks = &links[1];
             result->allocations = 0;
+            result->arena = 0;
+            result->arenaSize = 0;
+            result->arenaAlignment = 0;
+            result->arenaUsed = 0;
+            result->arenaIsLocked = 0;
+            result->heapBytes = 0;
         }
         else
         {
@@ -127,11 +167,63 @@ PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void )
 }
 
 
+PaUtilAllocationGroup* PaUtil_CreateArenaAllocationGroup( long arenaSize )
+{
+    PaUtilAllocationGroup* result = PaUtil_CreateAllocationGroup();
+
+    if( result && arenaSize > 0 )
+    {
+        long hugePageSize = PaUtil_GetHugePageSize();
+        long pageSize = ( hugePageSize > PA_ARENA_PAGE_SIZE_ && arenaSize >= hugePageSize )
+                ? hugePageSize : PA_ARENA_PAGE_SIZE_;
+
+        /* whole pages, so unlocking the arena can't unlock anybody else's memory */
+        arenaSize = (arenaSize + pageSize - 1) & ~(pageSize - 1);
+
+        result->arena = (unsigned char*)PaUtil_AllocateAlignedMemory( arenaSize, pageSize );
+        if( !result->arena )
+        {
+            PaUtil_DestroyAllocationGroup( result );
+            return 0;
+        }
+        result->arenaSize = arenaSize;
+        result->arenaAlignment = pageSize;
+
+        /* before the pages are faulted in, so they are huge from the start */
+        if( pageSize != PA_ARENA_PAGE_SIZE_ )
+            PaUtil_AdviseHugePages( result->arena, arenaSize );
+
+        /* fault all pages in now rather than in the callback */
+        memset( result->arena, 0, arenaSize );
+
+        result->arenaIsLocked = PaUtil_LockMemory( result->arena, arenaSize );
+    }
+
+    return result;
+}
+
+
+int PaUtil_PlaceAllocationGroup( PaUtilAllocationGroup* group, const int *cpus, int cpuCount )
+{
+    if( !group->arena )
+        return 0;
+
+    return PaUtil_PlaceMemory( group->arena, group->arenaSize, cpus, cpuCount );
+}
+
+
 void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group )
 {
     struct PaUtilAllocationGroupLink *current = group->linkBlocks;
     struct PaUtilAllocationGroupLink *next;
 
+    if( group->arena )
+    {
+        if( group->arenaIsLocked )
+            PaUtil_UnlockMemory( group->arena, group->arenaSize );
+        PaUtil_FreeAlignedMemory( group->arena );
+    }
+
     while( current )
     {
         next = current->next;
@@ -143,10 +235,35 @@ void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group )
 }
 
 
-void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
+/*
+    Carve size bytes from the arena of group, or return NULL if they don't
+    fit. Blocks don't share cache lines so the arena doesn't introduce false
+    sharing between buffers used by different threads.
+*/
+static void* ArenaAllocate( PaUtilAllocationGroup* group, long size, long alignment )
+{
+    long offset;
+
+    if( alignment > PA_ARENA_PAGE_SIZE_ )
+        return 0; /* more than the arena itself is aligned to */
+    if( alignment < PA_CACHE_LINE_SIZE )
+        alignment = PA_CACHE_LINE_SIZE;
+
+    offset = (group->arenaUsed + alignment - 1) & ~(alignment - 1);
+    if( offset + size > group->arenaSize )
+        return 0;
+
+    group->arenaUsed = offset + size;
+    return group->arena + offset;
+}
+
+
+static void* GroupAllocate( PaUtilAllocationGroup* group, long size, long alignment )
 {
     struct PaUtilAllocationGroupLink *links, *link;
     void *result = 0;
+    int blockType = PA_HEAP_BLOCK_;
+    long heapSize = 0;
     
     /* allocate more links if necessary */
     if( !group->spareLinks )
@@ -163,13 +280,34 @@ void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
 
     if( group->spareLinks )
     {
-        result = PaUtil_AllocateMemory( size );
+        if( group->arena )
+            result = ArenaAllocate( group, size, alignment );
+
+        if( result )
+        {
+            blockType = PA_ARENA_BLOCK_;
+        }
+        else if( alignment > 0 )
+        {
+            result = PaUtil_AllocateAlignedMemory( size, alignment );
+            blockType = PA_ALIGNED_BLOCK_;
+            heapSize = PA_ALIGNED_BLOCK_SIZE_( size, alignment );
+        }
+        else
+        {
+            result = PaUtil_AllocateMemory( size );
+            heapSize = size;
+        }
+
         if( result )
         {
             link = group->spareLinks;
             group->spareLinks = link->next;
 
             link->buffer = result;
+            link->blockType = blockType;
+            link->size = heapSize;
+            group->heapBytes += heapSize;
             link->next = group->allocations;
 
             group->allocations = link;
@@ -180,6 +318,18 @@ void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
 }
 
 
+void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size )
+{
+    return GroupAllocate( group, size, 0 );
+}
+
+
+void* PaUtil_GroupAllocateAlignedMemory( PaUtilAllocationGroup* group, long size, long alignment )
+{
+    return GroupAllocate( group, size, alignment );
+}
+
+
 void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer )
 {
     struct PaUtilAllocationGroupLink *current = group->allocations;
@@ -202,11 +352,14 @@ void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer )
                 group->allocations = current->next;
             }
 
+            FreeLinkBuffer( group, current );
+
             current->buffer = 0;
+            current->blockType = PA_HEAP_BLOCK_;
             current->next = group->spareLinks;
             group->spareLinks = current;
 
-            break;
+            return;
         }
         
         previous = current;
@@ -225,8 +378,9 @@ void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group )
     /* free all buffers in the allocations list */
     while( current )
     {
-        PaUtil_FreeMemory( current->buffer );
+        FreeLinkBuffer( group, current );
         current->buffer = 0;
+        current->blockType = PA_HEAP_BLOCK_;
 
         previous = current;
         current = current->next;
@@ -239,5 +393,44 @@ void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group )
         group->spareLinks = group->allocations;
         group->allocations = 0;
     }
+
+    /* the arena stays allocated and locked for reuse */
+    group->arenaUsed = 0;
+}
+
+
+long PaUtil_GetAllocationGroupMemoryUsage( const PaUtilAllocationGroup* group )
+{
+    return (long)sizeof(PaUtilAllocationGroup)
+            + group->linkCount * (long)sizeof(struct PaUtilAllocationGroupLink)
+            + (group->arena ? PA_ALIGNED_BLOCK_SIZE_( group->arenaSize, group->arenaAlignment ) : 0)
+            + group->heapBytes;
+}
+
+
+void* PaUtil_AllocateAlignedMemory( long size, long alignment )
+{
+    void *block;
+    unsigned char *result = 0;
+
+    if( alignment < (long)sizeof(void*) )
+        alignment = (long)sizeof(void*);
+
+    /* room to move the start forward and to store the block below it */
+    block = PaUtil_AllocateMemory( size + alignment + (long)sizeof(void*) );
+    if( block )
+    {
+        result = (unsigned char*)block + sizeof(void*);
+        result += (alignment - ((size_t)result & (size_t)(alignment - 1))) & (size_t)(alignment - 1);
+        ((void**)result)[-1] = block;
+    }
+
+    return result;
 }
 
+
+void PaUtil_FreeAlignedMemory( void *buffer )
+{
+    if( buffer )
+        PaUtil_FreeMemory( ((void**)buffer)[-1] );
+}
@@ -62,12 +62,26 @@ extern "C"
 #endif /* __cplusplus */
 
 
+/** Alignment used for buffers which are processed by the (SIMD) sample
+ converters. A multiple of the cache line size of current CPUs and of the
+ widest vector loads.
+ @see PaUtil_AllocateAlignedMemory
+*/
+#define PA_CACHE_LINE_SIZE (64)
+
+
 typedef struct
 {
     long linkCount;
     struct PaUtilAllocationGroupLink *linkBlocks;
     struct PaUtilAllocationGroupLink *spareLinks;
     struct PaUtilAllocationGroupLink *allocations;
+    unsigned char *arena;
+    long arenaSize;
+    long arenaAlignment;
+    long arenaUsed;
+    int arenaIsLocked;
+    long heapBytes;     /**< held by the blocks which aren't carved from the arena */
 }PaUtilAllocationGroup;
 
 
@@ -76,7 +90,36 @@ typedef struct
 */
 PaUtilAllocationGroup* PaUtil_CreateAllocationGroup( void );
 
+/** Create an allocation group for memory used by the real-time (callback)
+ thread of a stream. At least arenaSize bytes are allocated up front,
+ written to so that all pages are present, and locked into physical memory
+ with PaUtil_LockMemory(). Allocations through the group are taken from
+ this arena, each aligned to at least PA_CACHE_LINE_SIZE, as long as they
+ fit. Later ones are served from the heap like in any other group.
+
+ Locking usually needs privileges or a large enough RLIMIT_MEMLOCK. Failing
+ to lock is not an error, the arena is still pre-faulted.
+
+ Arenas of at least PaUtil_GetHugePageSize() bytes are aligned to and
+ rounded up to whole huge pages and advised to be backed by them, which
+ saves the callback TLB misses with large buffers.
+
+ Memory freed with PaUtil_GroupFreeMemory() is not returned to the arena,
+ PaUtil_FreeAllAllocations() makes the whole arena available again.
+*/
+PaUtilAllocationGroup* PaUtil_CreateArenaAllocationGroup( long arenaSize );
+
+/** Move the arena of a group to the memory nodes of the processors cpus,
+ those the thread using it is pinned to, with PaUtil_PlaceMemory(). Blocks
+ which didn't fit into the arena stay where the heap put them.
+ @return 1 if the arena was moved, 0 if the group has none or it couldn't be
+ placed, which is not an error.
+*/
+int PaUtil_PlaceAllocationGroup( PaUtilAllocationGroup* group, const int *cpus, int cpuCount );
+
 /** Destroy an allocation group, but not the memory allocated through the group.
+ The arena of a group created with PaUtil_CreateArenaAllocationGroup() is
+ unlocked and freed, so blocks allocated from it must not be used anymore.
 */
 void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group );
 
@@ -84,6 +127,12 @@ void PaUtil_DestroyAllocationGroup( PaUtilAllocationGroup* group );
 */
 void* PaUtil_GroupAllocateMemory( PaUtilAllocationGroup* group, long size );
 
+/** Allocate a block of memory though an allocation group. The block starts
+ at a multiple of alignment, which must be a power of two.
+ Free it like any other block of the group.
+*/
+void* PaUtil_GroupAllocateAlignedMemory( PaUtilAllocationGroup* group, long size, long alignment );
+
 /** Free a block of memory that was previously allocated though an allocation
  group. Calling this function is a relatively time consuming operation.
  Under normal circumstances clients should call PaUtil_FreeAllAllocations to
@@ -97,6 +146,24 @@ void PaUtil_GroupFreeMemory( PaUtilAllocationGroup* group, void *buffer );
 */
 void PaUtil_FreeAllAllocations( PaUtilAllocationGroup* group );
 
+/** Return the number of bytes of memory a group holds: the group and its
+ links, the whole arena, and the blocks allocated from the heap, including
+ the padding of aligned blocks.
+*/
+long PaUtil_GetAllocationGroupMemoryUsage( const PaUtilAllocationGroup* group );
+
+
+/** Allocate a block of memory outside of a group which starts at a multiple
+ of alignment, which must be a power of two. The memory is obtained from
+ PaUtil_AllocateMemory and must be freed with PaUtil_FreeAlignedMemory.
+*/
+void* PaUtil_AllocateAlignedMemory( long size, long alignment );
+
+/** Free a block of memory allocated with PaUtil_AllocateAlignedMemory.
+ Passing NULL is allowed.
+*/
+void PaUtil_FreeAlignedMemory( void *buffer );
+
 
 #ifdef __cplusplus
 }
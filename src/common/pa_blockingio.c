@@ -0,0 +1,481 @@
+/*
+ * Portable Audio I/O Library blocking i/o emulation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Blocking i/o emulation for callback only host APIs.
+*/
+
+
+#include <string.h> /* memset(), memcpy() */
+
+#include "pa_blockingio.h"
+#include "pa_memorybarrier.h"
+
+
+/* A waiting thread checks again this often, which bounds how long a stop
+   takes to be noticed if the callback doesn't run anymore. */
+#define PA_BLOCKING_IO_WAIT_SECONDS_ (0.1)
+
+
+static unsigned long RoundUpToPowerOf2( unsigned long n )
+{
+    unsigned long result = 1;
+    while( result < n )
+        result <<= 1;
+    return result;
+}
+
+static PaError InitializeRingBuffer( PaUtilSpscRingBuffer *ringBuffer, void **data,
+        int bytesPerFrame, ring_buffer_size_t frames )
+{
+    if( !(*data = PaUtil_AllocateMemory( (long)bytesPerFrame * frames )) )
+        return paInsufficientMemory;
+    if( PaUtil_InitializeSpscRingBuffer( ringBuffer, bytesPerFrame, frames, *data ) < 0 )
+        return paInternalError;
+    return paNoError;
+}
+
+/* Copy frames between an interleaved ring buffer region and a user buffer at
+   frame offset userFrame, either interleaved or an array of channel buffers. */
+static void CopyToRing( void *ring, const void *user, unsigned long userFrame, int isInterleaved,
+        int channelCount, int bytesPerSample, unsigned long frames )
+{
+    int bytesPerFrame = channelCount * bytesPerSample;
+    int channel;
+    unsigned long i;
+
+    if( isInterleaved )
+    {
+        memcpy( ring, (const unsigned char*)user + userFrame * bytesPerFrame, frames * bytesPerFrame );
+        return;
+    }
+
+    for( channel = 0; channel < channelCount; ++channel )
+    {
+        const unsigned char *src = (const unsigned char*)((const void* const*)user)[channel]
+                + userFrame * bytesPerSample;
+        unsigned char *dest = (unsigned char*)ring + channel * bytesPerSample;
+        for( i = 0; i < frames; ++i, src += bytesPerSample, dest += bytesPerFrame )
+            memcpy( dest, src, bytesPerSample );
+    }
+}
+
+static void CopyFromRing( void *user, unsigned long userFrame, int isInterleaved, const void *ring,
+        int channelCount, int bytesPerSample, unsigned long frames )
+{
+    int bytesPerFrame = channelCount * bytesPerSample;
+    int channel;
+    unsigned long i;
+
+    if( isInterleaved )
+    {
+        memcpy( (unsigned char*)user + userFrame * bytesPerFrame, ring, frames * bytesPerFrame );
+        return;
+    }
+
+    for( channel = 0; channel < channelCount; ++channel )
+    {
+        unsigned char *dest = (unsigned char*)((void**)user)[channel] + userFrame * bytesPerSample;
+        const unsigned char *src = (const unsigned char*)ring + channel * bytesPerSample;
+        for( i = 0; i < frames; ++i, src += bytesPerFrame, dest += bytesPerSample )
+            memcpy( dest, src, bytesPerSample );
+    }
+}
+
+static void Silence( void *user, unsigned long userFrame, int isInterleaved, int channelCount,
+        int bytesPerSample, unsigned char silence, unsigned long frames )
+{
+    int channel;
+
+    if( isInterleaved )
+    {
+        memset( (unsigned char*)user + userFrame * channelCount * bytesPerSample, silence,
+                frames * channelCount * bytesPerSample );
+        return;
+    }
+
+    for( channel = 0; channel < channelCount; ++channel )
+        memset( (unsigned char*)((void**)user)[channel] + userFrame * bytesPerSample, silence,
+                frames * bytesPerSample );
+}
+
+/* Called by the callback after it moved frames, with the frames the waiting
+   side could now move. Only the callback clears waitFrames when posting, so
+   a waiter is posted at most once per wait; a post arriving after the waiter
+   timed out only makes its next wait check again. */
+static void WakeIfWaiting( PaUtilSemaphore *semaphore, volatile long *waitFrames, long framesAvailable )
+{
+    long wanted;
+
+    /* Either the waiter sees the frames just published, or we see it waiting */
+    PaUtil_FullMemoryBarrier();
+    wanted = *waitFrames;
+    if( wanted > 0 && framesAvailable >= wanted )
+    {
+        *waitFrames = 0;
+        PaUtil_PostSemaphore( semaphore );
+    }
+}
+
+/* Sleep until the callback reports the wanted frames, checking
+   available() first after publishing them. */
+static void Wait( PaUtilBlockingIO *self, PaUtilSemaphore *semaphore, volatile long *waitFrames,
+        PaUtilSpscRingBuffer *ringBuffer, ring_buffer_size_t (*available)( PaUtilSpscRingBuffer* ),
+        unsigned long framesLeft )
+{
+    long wanted = self->wakeupFrames > 0 && self->wakeupFrames < framesLeft ? (long)self->wakeupFrames
+            : (long)framesLeft;
+    if( wanted > self->ringBufferFrames )
+        wanted = self->ringBufferFrames;
+
+    *waitFrames = wanted;
+    PaUtil_FullMemoryBarrier();
+    if( available( ringBuffer ) < wanted && !self->isStopped )
+        PaUtil_WaitSemaphore( semaphore, PA_BLOCKING_IO_WAIT_SECONDS_ );
+    *waitFrames = 0;
+}
+
+
+PaError PaUtil_InitializeBlockingIO( PaUtilBlockingIO *self,
+        int inputChannelCount, PaSampleFormat inputSampleFormat,
+        int outputChannelCount, PaSampleFormat outputSampleFormat,
+        unsigned long ringBufferFrames )
+{
+    PaError result = paNoError;
+
+    memset( self, 0, sizeof (PaUtilBlockingIO) );
+    self->ringBufferFrames = (ring_buffer_size_t)RoundUpToPowerOf2( ringBufferFrames > 2 ? ringBufferFrames : 2 );
+
+    if( inputChannelCount > 0 )
+    {
+        self->inputChannelCount = inputChannelCount;
+        self->inputBytesPerSample = Pa_GetSampleSize( inputSampleFormat );
+        self->inputIsInterleaved = !(inputSampleFormat & paNonInterleaved);
+        if( (result = InitializeRingBuffer( &self->inputRingBuffer, &self->inputRingBufferData,
+                        inputChannelCount * self->inputBytesPerSample, self->ringBufferFrames )) != paNoError )
+            return result;
+        if( (result = PaUtil_CreateSemaphore( &self->inputSemaphore )) != paNoError )
+            return result;
+    }
+
+    if( outputChannelCount > 0 )
+    {
+        self->outputChannelCount = outputChannelCount;
+        self->outputBytesPerSample = Pa_GetSampleSize( outputSampleFormat );
+        self->outputIsInterleaved = !(outputSampleFormat & paNonInterleaved);
+        self->outputSilence = (outputSampleFormat & ~paNonInterleaved) == paUInt8 ? 0x80 : 0;
+        if( (result = InitializeRingBuffer( &self->outputRingBuffer, &self->outputRingBufferData,
+                        outputChannelCount * self->outputBytesPerSample, self->ringBufferFrames )) != paNoError )
+            return result;
+        if( (result = PaUtil_CreateSemaphore( &self->outputSemaphore )) != paNoError )
+            return result;
+    }
+
+    PaUtil_ResetBlockingIO( self );
+    return result;
+}
+
+
+void PaUtil_TerminateBlockingIO( PaUtilBlockingIO *self )
+{
+    if( self->inputRingBufferData )
+        PaUtil_FreeMemory( self->inputRingBufferData );
+    self->inputRingBufferData = NULL;
+    if( self->inputSemaphore )
+        PaUtil_DestroySemaphore( self->inputSemaphore );
+    self->inputSemaphore = NULL;
+
+    if( self->outputRingBufferData )
+        PaUtil_FreeMemory( self->outputRingBufferData );
+    self->outputRingBufferData = NULL;
+    if( self->outputSemaphore )
+        PaUtil_DestroySemaphore( self->outputSemaphore );
+    self->outputSemaphore = NULL;
+}
+
+
+void PaUtil_ResetBlockingIO( PaUtilBlockingIO *self )
+{
+    if( self->inputRingBufferData )
+        PaUtil_FlushSpscRingBuffer( &self->inputRingBuffer );
+
+    if( self->outputRingBufferData )
+    {
+        PaUtil_FlushSpscRingBuffer( &self->outputRingBuffer );
+        memset( self->outputRingBufferData, self->outputSilence,
+                (size_t)self->ringBufferFrames * self->outputChannelCount * self->outputBytesPerSample );
+        PaUtil_AdvanceSpscRingBufferWriteIndex( &self->outputRingBuffer, self->ringBufferFrames );
+    }
+
+    self->inputWaitFrames = self->outputWaitFrames = 0;
+    self->inputOverflowsReported = self->inputOverflows = 0;
+    self->outputUnderflowsReported = self->outputUnderflows = 0;
+    self->isStopped = 0;
+    PaUtil_FullMemoryBarrier();
+}
+
+
+void PaUtil_StopBlockingIO( PaUtilBlockingIO *self )
+{
+    self->isStopped = 1;
+    PaUtil_FullMemoryBarrier();
+    if( self->inputSemaphore )
+        PaUtil_PostSemaphore( self->inputSemaphore );
+    if( self->outputSemaphore )
+        PaUtil_PostSemaphore( self->outputSemaphore );
+}
+
+
+void PaUtil_SetBlockingIOWakeupFrames( PaUtilBlockingIO *self, unsigned long frames )
+{
+    self->wakeupFrames = frames;
+}
+
+
+unsigned long PaUtil_GetBlockingIORingBufferFrames( const PaUtilBlockingIO *self )
+{
+    return self->ringBufferFrames;
+}
+
+
+long PaUtil_GetBlockingIOMemoryUsage( const PaUtilBlockingIO *self )
+{
+    long result = 0;
+    if( self->inputRingBufferData )
+        result += (long)self->inputChannelCount * self->inputBytesPerSample * self->ringBufferFrames;
+    if( self->outputRingBufferData )
+        result += (long)self->outputChannelCount * self->outputBytesPerSample * self->ringBufferFrames;
+    return result;
+}
+
+
+int PaUtil_BlockingIOCallback( const void *input, void *output,
+        unsigned long frameCount, const PaStreamCallbackTimeInfo *timeInfo,
+        PaStreamCallbackFlags statusFlags, void *userData )
+{
+    PaUtilBlockingIO *self = (PaUtilBlockingIO*)userData;
+    void *data1, *data2;
+    ring_buffer_size_t size1, size2, frames;
+    (void)timeInfo; /* unused parameter */
+
+    /* The flags are only reported through the return values of the next read
+       and write, which the counts below already stand for. */
+    if( statusFlags & paInputOverflow )
+        self->inputOverflows++;
+    if( statusFlags & paOutputUnderflow )
+        self->outputUnderflows++;
+
+    /* This may get called with NULL input during initial setup. */
+    if( input && self->inputRingBufferData )
+    {
+        frames = PaUtil_GetSpscRingBufferWriteRegions( &self->inputRingBuffer, (ring_buffer_size_t)frameCount,
+                &data1, &size1, &data2, &size2 );
+        if( (unsigned long)frames < frameCount )
+            self->inputOverflows++;
+        CopyToRing( data1, input, 0, self->inputIsInterleaved, self->inputChannelCount,
+                self->inputBytesPerSample, size1 );
+        if( size2 > 0 )
+            CopyToRing( data2, input, size1, self->inputIsInterleaved, self->inputChannelCount,
+                    self->inputBytesPerSample, size2 );
+        PaUtil_AdvanceSpscRingBufferWriteIndex( &self->inputRingBuffer, frames );
+
+        WakeIfWaiting( self->inputSemaphore, &self->inputWaitFrames,
+                self->ringBufferFrames - PaUtil_GetSpscRingBufferWriteAvailable( &self->inputRingBuffer ) );
+    }
+
+    if( output && self->outputRingBufferData )
+    {
+        frames = PaUtil_GetSpscRingBufferReadRegions( &self->outputRingBuffer, (ring_buffer_size_t)frameCount,
+                &data1, &size1, &data2, &size2 );
+        CopyFromRing( output, 0, self->outputIsInterleaved, data1, self->outputChannelCount,
+                self->outputBytesPerSample, size1 );
+        if( size2 > 0 )
+            CopyFromRing( output, size1, self->outputIsInterleaved, data2, self->outputChannelCount,
+                    self->outputBytesPerSample, size2 );
+        if( (unsigned long)frames < frameCount )
+        {
+            Silence( output, frames, self->outputIsInterleaved, self->outputChannelCount,
+                    self->outputBytesPerSample, self->outputSilence, frameCount - frames );
+            self->outputUnderflows++;
+        }
+        PaUtil_AdvanceSpscRingBufferReadIndex( &self->outputRingBuffer, frames );
+
+        WakeIfWaiting( self->outputSemaphore, &self->outputWaitFrames,
+                self->ringBufferFrames - PaUtil_GetSpscRingBufferReadAvailable( &self->outputRingBuffer ) );
+    }
+
+    return paContinue;
+}
+
+
+unsigned long PaUtil_ReadBlockingIOAvailable( PaUtilBlockingIO *self, void *buffer, unsigned long frames )
+{
+    void *data1, *data2;
+    ring_buffer_size_t size1, size2, read;
+
+    read = PaUtil_GetSpscRingBufferReadRegions( &self->inputRingBuffer,
+            (ring_buffer_size_t)( frames < (unsigned long)self->ringBufferFrames ? frames : (unsigned long)self->ringBufferFrames ),
+            &data1, &size1, &data2, &size2 );
+    CopyFromRing( buffer, 0, self->inputIsInterleaved, data1, self->inputChannelCount,
+            self->inputBytesPerSample, size1 );
+    if( size2 > 0 )
+        CopyFromRing( buffer, size1, self->inputIsInterleaved, data2, self->inputChannelCount,
+                self->inputBytesPerSample, size2 );
+    PaUtil_AdvanceSpscRingBufferReadIndex( &self->inputRingBuffer, read );
+
+    return read;
+}
+
+
+PaError PaUtil_ReadBlockingIO( PaUtilBlockingIO *self, void *buffer, unsigned long frames )
+{
+    unsigned long done = 0;
+    void *data1, *data2;
+    ring_buffer_size_t size1, size2, read;
+    unsigned long overflows;
+
+    while( done < frames )
+    {
+        if( self->isStopped )
+            return paStreamIsStopped;
+
+        read = PaUtil_GetSpscRingBufferReadRegions( &self->inputRingBuffer,
+                (ring_buffer_size_t)( frames - done < (unsigned long)self->ringBufferFrames ?
+                    frames - done : (unsigned long)self->ringBufferFrames ),
+                &data1, &size1, &data2, &size2 );
+        if( read == 0 )
+        {
+            Wait( self, self->inputSemaphore, &self->inputWaitFrames, &self->inputRingBuffer,
+                    PaUtil_GetSpscRingBufferReadAvailable, frames - done );
+            continue;
+        }
+
+        CopyFromRing( buffer, done, self->inputIsInterleaved, data1, self->inputChannelCount,
+                self->inputBytesPerSample, size1 );
+        if( size2 > 0 )
+            CopyFromRing( buffer, done + size1, self->inputIsInterleaved, data2, self->inputChannelCount,
+                    self->inputBytesPerSample, size2 );
+        PaUtil_AdvanceSpscRingBufferReadIndex( &self->inputRingBuffer, read );
+        done += read;
+    }
+
+    /* Report each overflow once */
+    overflows = self->inputOverflows;
+    if( overflows != self->inputOverflowsReported )
+    {
+        self->inputOverflowsReported = overflows;
+        return paInputOverflowed;
+    }
+    return paNoError;
+}
+
+
+PaError PaUtil_WriteBlockingIO( PaUtilBlockingIO *self, const void *buffer, unsigned long frames )
+{
+    unsigned long done = 0;
+    void *data1, *data2;
+    ring_buffer_size_t size1, size2, written;
+    unsigned long underflows;
+
+    while( done < frames )
+    {
+        if( self->isStopped )
+            return paStreamIsStopped;
+
+        written = PaUtil_GetSpscRingBufferWriteRegions( &self->outputRingBuffer,
+                (ring_buffer_size_t)( frames - done < (unsigned long)self->ringBufferFrames ?
+                    frames - done : (unsigned long)self->ringBufferFrames ),
+                &data1, &size1, &data2, &size2 );
+        if( written == 0 )
+        {
+            Wait( self, self->outputSemaphore, &self->outputWaitFrames, &self->outputRingBuffer,
+                    PaUtil_GetSpscRingBufferWriteAvailable, frames - done );
+            continue;
+        }
+
+        CopyToRing( data1, buffer, done, self->outputIsInterleaved, self->outputChannelCount,
+                self->outputBytesPerSample, size1 );
+        if( size2 > 0 )
+            CopyToRing( data2, buffer, done + size1, self->outputIsInterleaved, self->outputChannelCount,
+                    self->outputBytesPerSample, size2 );
+        PaUtil_AdvanceSpscRingBufferWriteIndex( &self->outputRingBuffer, written );
+        done += written;
+    }
+
+    /* Report each underflow once */
+    underflows = self->outputUnderflows;
+    if( underflows != self->outputUnderflowsReported )
+    {
+        self->outputUnderflowsReported = underflows;
+        return paOutputUnderflowed;
+    }
+    return paNoError;
+}
+
+
+signed long PaUtil_GetBlockingIOReadAvailable( PaUtilBlockingIO *self )
+{
+    return self->inputRingBufferData ? PaUtil_GetSpscRingBufferReadAvailable( &self->inputRingBuffer ) : 0;
+}
+
+
+signed long PaUtil_GetBlockingIOWriteAvailable( PaUtilBlockingIO *self )
+{
+    return self->outputRingBufferData ? PaUtil_GetSpscRingBufferWriteAvailable( &self->outputRingBuffer ) : 0;
+}
+
+
+PaError PaUtil_DrainBlockingIO( PaUtilBlockingIO *self, double timeoutSeconds )
+{
+    PaTime deadline = PaUtil_GetTime() + timeoutSeconds;
+
+    if( !self->outputRingBufferData )
+        return paNoError;
+
+    while( PaUtil_GetSpscRingBufferWriteAvailable( &self->outputRingBuffer ) < self->ringBufferFrames )
+    {
+        if( PaUtil_GetTime() >= deadline )
+            return paTimedOut;
+
+        /* Wake up once the whole ring buffer is free */
+        self->outputWaitFrames = self->ringBufferFrames;
+        PaUtil_FullMemoryBarrier();
+        if( PaUtil_GetSpscRingBufferWriteAvailable( &self->outputRingBuffer ) < self->ringBufferFrames )
+            PaUtil_WaitSemaphore( self->outputSemaphore, PA_BLOCKING_IO_WAIT_SECONDS_ );
+        self->outputWaitFrames = 0;
+    }
+    return paNoError;
+}
@@ -0,0 +1,225 @@
+#ifndef PA_BLOCKINGIO_H
+#define PA_BLOCKINGIO_H
+/*
+ * Portable Audio I/O Library blocking i/o emulation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Implements Pa_ReadStream() and Pa_WriteStream() on top of a stream
+ callback, for host APIs which only have a callback interface.
+
+ The host API opens its stream with PaUtil_BlockingIOCallback() as the
+ stream callback and a PaUtilBlockingIO as its user data. The callback moves
+ the frames between the buffers it is passed and a pair of single-reader
+ single-writer ring buffers holding interleaved frames in the user's sample
+ format, which the host API's ReadStream(), WriteStream() and
+ GetStreamRead/WriteAvailable() then drain and fill with the functions below.
+
+ A thread that has to wait publishes how many frames it waits for and sleeps
+ on a PaUtilSemaphore. The callback only posts the semaphore once that many
+ frames can be moved, so it never takes a lock and a reader or writer moving
+ large blocks isn't woken at every host buffer.
+*/
+
+
+#include "portaudio.h"
+#include "pa_ringbuffer.h"
+#include "pa_util.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The state of the blocking i/o of a stream. All fields are private, use the
+ functions below.
+*/
+typedef struct PaUtilBlockingIO
+{
+    PaUtilSpscRingBuffer inputRingBuffer;   /**< written by the callback */
+    PaUtilSpscRingBuffer outputRingBuffer;  /**< read by the callback */
+    void *inputRingBufferData;
+    void *outputRingBufferData;
+    ring_buffer_size_t ringBufferFrames;    /**< of each ring buffer, a power of 2 */
+
+    int inputChannelCount;
+    int inputBytesPerSample;
+    int inputIsInterleaved;
+    int outputChannelCount;
+    int outputBytesPerSample;
+    int outputIsInterleaved;
+    unsigned char outputSilence;            /**< byte value of a silent output sample */
+
+    unsigned long wakeupFrames;             /**< 0 to wake waiting threads for any frames */
+    PaUtilSemaphore *inputSemaphore;
+    PaUtilSemaphore *outputSemaphore;
+    volatile long inputWaitFrames;          /**< frames a waiting reader needs, 0 if there is none */
+    volatile long outputWaitFrames;         /**< space a waiting writer needs, 0 if there is none */
+
+    /* Counted by the callback only and compared with the counts reported, so
+       neither side needs an atomic read-modify-write. */
+    volatile unsigned long inputOverflows;
+    volatile unsigned long outputUnderflows;
+    unsigned long inputOverflowsReported;
+    unsigned long outputUnderflowsReported;
+
+    volatile int isStopped;
+}
+PaUtilBlockingIO;
+
+
+/** Initialize the blocking i/o of a stream and reset it, see
+ PaUtil_ResetBlockingIO().
+
+ @param inputChannelCount The number of input channels, 0 for an output only
+ stream.
+
+ @param inputSampleFormat The input sample format the user passed to
+ Pa_OpenStream(), which is also the format of the frames passed to the
+ callback. paNonInterleaved is supported.
+
+ @param ringBufferFrames The minimum size of each ring buffer in frames. It is
+ rounded up to a power of 2, PaUtil_GetBlockingIORingBufferFrames() returns
+ the actual size, which adds to the latency of the stream.
+
+ @return paNoError, or paInsufficientMemory. On error the blocking i/o must
+ still be passed to PaUtil_TerminateBlockingIO().
+*/
+PaError PaUtil_InitializeBlockingIO( PaUtilBlockingIO *blockingIO,
+        int inputChannelCount, PaSampleFormat inputSampleFormat,
+        int outputChannelCount, PaSampleFormat outputSampleFormat,
+        unsigned long ringBufferFrames );
+
+
+/** Free the resources of the blocking i/o of a stream. May be called on a
+ PaUtilBlockingIO set to 0 or left by a failed PaUtil_InitializeBlockingIO().
+*/
+void PaUtil_TerminateBlockingIO( PaUtilBlockingIO *blockingIO );
+
+
+/** Empty the input ring buffer and fill the output ring buffer with silence,
+ so that a writer blocks until the stream has played a ring buffer's worth,
+ and forget the xruns. Must be called while the callback doesn't run and no
+ thread reads or writes, usually when the stream is started.
+*/
+void PaUtil_ResetBlockingIO( PaUtilBlockingIO *blockingIO );
+
+
+/** Make threads waiting in PaUtil_ReadBlockingIO() or PaUtil_WriteBlockingIO()
+ return paStreamIsStopped, and later calls too until the next reset. Called
+ when the stream is stopped or aborted.
+*/
+void PaUtil_StopBlockingIO( PaUtilBlockingIO *blockingIO );
+
+
+/** Wake a waiting reader or writer only once this many frames can be moved,
+ or all that remain of its call if there are fewer. 0 wakes it as soon as
+ any are, the default.
+*/
+void PaUtil_SetBlockingIOWakeupFrames( PaUtilBlockingIO *blockingIO, unsigned long frames );
+
+
+/** The size of each ring buffer in frames. */
+unsigned long PaUtil_GetBlockingIORingBufferFrames( const PaUtilBlockingIO *blockingIO );
+
+
+/** The bytes allocated for the ring buffers, see Pa_GetStreamMemoryUsage(). */
+long PaUtil_GetBlockingIOMemoryUsage( const PaUtilBlockingIO *blockingIO );
+
+
+/** The stream callback of a blocking stream, userData is the PaUtilBlockingIO.
+ Input frames which don't fit in the ring buffer are dropped and reported as
+ an overflow by the next read, output frames the writer hasn't provided are
+ played as silence and reported as an underflow by the next write.
+
+ @return paContinue.
+*/
+int PaUtil_BlockingIOCallback( const void *input, void *output,
+        unsigned long frameCount, const PaStreamCallbackTimeInfo *timeInfo,
+        PaStreamCallbackFlags statusFlags, void *userData );
+
+
+/** Read frames frames, waiting for them as needed. Implements
+ Pa_ReadStream().
+
+ @return paNoError, paInputOverflowed if input was lost since the last read,
+ or paStreamIsStopped if the stream was stopped before all frames were read.
+*/
+PaError PaUtil_ReadBlockingIO( PaUtilBlockingIO *blockingIO, void *buffer, unsigned long frames );
+
+
+/** Write frames frames, waiting for room as needed. Implements
+ Pa_WriteStream().
+
+ @return paNoError, paOutputUnderflowed if silence was played since the last
+ write, or paStreamIsStopped if the stream was stopped before all frames were
+ written.
+*/
+PaError PaUtil_WriteBlockingIO( PaUtilBlockingIO *blockingIO, const void *buffer, unsigned long frames );
+
+
+/** Read up to frames frames without waiting.
+
+ @return The number of frames read.
+*/
+unsigned long PaUtil_ReadBlockingIOAvailable( PaUtilBlockingIO *blockingIO, void *buffer, unsigned long frames );
+
+
+/** The number of frames which can be read without waiting. Implements
+ Pa_GetStreamReadAvailable().
+*/
+signed long PaUtil_GetBlockingIOReadAvailable( PaUtilBlockingIO *blockingIO );
+
+
+/** The number of frames which can be written without waiting. Implements
+ Pa_GetStreamWriteAvailable().
+*/
+signed long PaUtil_GetBlockingIOWriteAvailable( PaUtilBlockingIO *blockingIO );
+
+
+/** Wait until the callback has played all frames written, for at most
+ timeoutSeconds. Called by the writer before stopping a stream.
+
+ @return paNoError, or paTimedOut.
+*/
+PaError PaUtil_DrainBlockingIO( PaUtilBlockingIO *blockingIO, double timeoutSeconds );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_BLOCKINGIO_H */
@@ -0,0 +1,429 @@
+/*
+ * Portable Audio I/O Library channel routing and mixing matrix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Channel routing and mixing matrix implementation.
+
+ The terms of each destination channel are kept in groups of four, the
+ last group padded with gains of 0. The first group of a destination writes
+ it, the following groups add to it, so a destination with up to four
+ sources is produced in a single pass over the buffers.
+*/
+
+
+#include <string.h> /* memset, memcpy */
+
+#include "pa_channelmatrix.h"
+#include "pa_util.h"
+#include "pa_cpufeatures.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PA_CHANNELMATRIX_SSE2_
+#include <emmintrin.h>
+
+#if defined(__clang__) || \
+    ( defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) )
+#define PA_CHANNELMATRIX_AVX2_
+#define PA_CHANNELMATRIX_AVX2_TARGET_ __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define PA_CHANNELMATRIX_AVX2_
+#define PA_CHANNELMATRIX_AVX2_TARGET_
+#endif
+
+#ifdef PA_CHANNELMATRIX_AVX2_
+#include <immintrin.h>
+#endif
+#endif /* PA_CHANNELMATRIX_SSE2_ */
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+
+#define PA_CHANNELMATRIX_GROUP_     (4)
+
+
+static void Mix4_C( float *destination, const float *const *sources,
+        const float *gains, unsigned long frameCount, int accumulate )
+{
+    const float *s0 = sources[0], *s1 = sources[1], *s2 = sources[2], *s3 = sources[3];
+    float g0 = gains[0], g1 = gains[1], g2 = gains[2], g3 = gains[3];
+    unsigned long i;
+
+    if( accumulate )
+    {
+        for( i = 0; i < frameCount; ++i )
+            destination[i] += (g0 * s0[i] + g1 * s1[i]) + (g2 * s2[i] + g3 * s3[i]);
+    }
+    else
+    {
+        for( i = 0; i < frameCount; ++i )
+            destination[i] = (g0 * s0[i] + g1 * s1[i]) + (g2 * s2[i] + g3 * s3[i]);
+    }
+}
+
+
+#ifdef PA_CHANNELMATRIX_SSE2_
+
+static void Mix4_SSE2( float *destination, const float *const *sources,
+        const float *gains, unsigned long frameCount, int accumulate )
+{
+    const float *s0 = sources[0], *s1 = sources[1], *s2 = sources[2], *s3 = sources[3];
+    __m128 g0 = _mm_set1_ps( gains[0] ), g1 = _mm_set1_ps( gains[1] );
+    __m128 g2 = _mm_set1_ps( gains[2] ), g3 = _mm_set1_ps( gains[3] );
+    unsigned long i, vectorFrames = frameCount & ~3UL;
+
+    for( i = 0; i < vectorFrames; i += 4 )
+    {
+        __m128 v = _mm_add_ps(
+                _mm_add_ps( _mm_mul_ps( g0, _mm_loadu_ps( s0 + i ) ), _mm_mul_ps( g1, _mm_loadu_ps( s1 + i ) ) ),
+                _mm_add_ps( _mm_mul_ps( g2, _mm_loadu_ps( s2 + i ) ), _mm_mul_ps( g3, _mm_loadu_ps( s3 + i ) ) ) );
+
+        if( accumulate )
+            v = _mm_add_ps( v, _mm_loadu_ps( destination + i ) );
+
+        _mm_storeu_ps( destination + i, v );
+    }
+
+    if( i < frameCount )
+    {
+        const float *tail[PA_CHANNELMATRIX_GROUP_];
+
+        tail[0] = s0 + i;
+        tail[1] = s1 + i;
+        tail[2] = s2 + i;
+        tail[3] = s3 + i;
+        Mix4_C( destination + i, tail, gains, frameCount - i, accumulate );
+    }
+}
+
+#ifdef PA_CHANNELMATRIX_AVX2_
+
+PA_CHANNELMATRIX_AVX2_TARGET_ static void Mix4_AVX2( float *destination, const float *const *sources,
+        const float *gains, unsigned long frameCount, int accumulate )
+{
+    const float *s0 = sources[0], *s1 = sources[1], *s2 = sources[2], *s3 = sources[3];
+    __m256 g0 = _mm256_set1_ps( gains[0] ), g1 = _mm256_set1_ps( gains[1] );
+    __m256 g2 = _mm256_set1_ps( gains[2] ), g3 = _mm256_set1_ps( gains[3] );
+    unsigned long i, vectorFrames = frameCount & ~7UL;
+
+    for( i = 0; i < vectorFrames; i += 8 )
+    {
+        __m256 v = _mm256_add_ps(
+                _mm256_add_ps( _mm256_mul_ps( g0, _mm256_loadu_ps( s0 + i ) ), _mm256_mul_ps( g1, _mm256_loadu_ps( s1 + i ) ) ),
+                _mm256_add_ps( _mm256_mul_ps( g2, _mm256_loadu_ps( s2 + i ) ), _mm256_mul_ps( g3, _mm256_loadu_ps( s3 + i ) ) ) );
+
+        if( accumulate )
+            v = _mm256_add_ps( v, _mm256_loadu_ps( destination + i ) );
+
+        _mm256_storeu_ps( destination + i, v );
+    }
+
+    _mm256_zeroupper();
+
+    if( i < frameCount )
+    {
+        const float *tail[PA_CHANNELMATRIX_GROUP_];
+
+        tail[0] = s0 + i;
+        tail[1] = s1 + i;
+        tail[2] = s2 + i;
+        tail[3] = s3 + i;
+        Mix4_SSE2( destination + i, tail, gains, frameCount - i, accumulate );
+    }
+}
+
+#endif /* PA_CHANNELMATRIX_AVX2_ */
+#endif /* PA_CHANNELMATRIX_SSE2_ */
+
+
+#ifdef __ARM_NEON__
+
+static void Mix4_NEON( float *destination, const float *const *sources,
+        const float *gains, unsigned long frameCount, int accumulate )
+{
+    const float *s0 = sources[0], *s1 = sources[1], *s2 = sources[2], *s3 = sources[3];
+    float32x4_t g0 = vdupq_n_f32( gains[0] ), g1 = vdupq_n_f32( gains[1] );
+    float32x4_t g2 = vdupq_n_f32( gains[2] ), g3 = vdupq_n_f32( gains[3] );
+    unsigned long i, vectorFrames = frameCount & ~3UL;
+
+    for( i = 0; i < vectorFrames; i += 4 )
+    {
+        float32x4_t v = accumulate ? vld1q_f32( destination + i ) : vdupq_n_f32( 0.f );
+
+        v = vmlaq_f32( v, g0, vld1q_f32( s0 + i ) );
+        v = vmlaq_f32( v, g1, vld1q_f32( s1 + i ) );
+        v = vmlaq_f32( v, g2, vld1q_f32( s2 + i ) );
+        v = vmlaq_f32( v, g3, vld1q_f32( s3 + i ) );
+        vst1q_f32( destination + i, v );
+    }
+
+    if( i < frameCount )
+    {
+        const float *tail[PA_CHANNELMATRIX_GROUP_];
+
+        tail[0] = s0 + i;
+        tail[1] = s1 + i;
+        tail[2] = s2 + i;
+        tail[3] = s3 + i;
+        Mix4_C( destination + i, tail, gains, frameCount - i, accumulate );
+    }
+}
+
+#endif /* __ARM_NEON__ */
+
+
+static PaUtilChannelMixKernel* SelectMixKernel( void )
+{
+#ifdef PA_CHANNELMATRIX_SSE2_
+#ifdef PA_CHANNELMATRIX_AVX2_
+    if( PaUtil_GetCpuFeatures() & paCpuAVX2 )
+        return Mix4_AVX2;
+#endif
+    return Mix4_SSE2;
+#elif defined(__ARM_NEON__)
+    return Mix4_NEON;
+#else
+    return Mix4_C;
+#endif
+}
+
+
+PaError PaUtil_InitializeChannelMatrix( PaUtilChannelMatrix *m,
+        const PaChannelMatrix *channelMatrix, int streamChannelCount, int toDevice )
+{
+    PaError result = paNoError;
+    int deviceChannelCount = channelMatrix ? channelMatrix->deviceChannelCount : streamChannelCount;
+    float *dense = 0;
+    unsigned int termCount;
+    int d, s;
+    unsigned long i;
+
+    memset( m, 0, sizeof(PaUtilChannelMatrix) );
+
+    if( streamChannelCount <= 0 || deviceChannelCount <= 0 )
+        return paInvalidChannelCount;
+
+    m->sourceChannelCount = toDevice ? streamChannelCount : deviceChannelCount;
+    m->destinationChannelCount = toDevice ? deviceChannelCount : streamChannelCount;
+
+    /* gather the gains as [destination][source] */
+    dense = (float*)PaUtil_AllocateMemory( (long)(sizeof(float)
+            * m->destinationChannelCount * m->sourceChannelCount) );
+    if( !dense )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+    memset( dense, 0, sizeof(float) * m->destinationChannelCount * m->sourceChannelCount );
+
+#define PA_CHANNELMATRIX_GAIN_( deviceChannel, streamChannel ) \
+    dense[ toDevice ? (deviceChannel) * streamChannelCount + (streamChannel) \
+                    : (streamChannel) * deviceChannelCount + (deviceChannel) ]
+
+    if( !channelMatrix )
+    {
+        for( s = 0; s < streamChannelCount; ++s )
+            PA_CHANNELMATRIX_GAIN_( s, s ) = 1.f;
+    }
+    else
+    {
+        if( channelMatrix->gains )
+        {
+            for( d = 0; d < deviceChannelCount; ++d )
+                for( s = 0; s < streamChannelCount; ++s )
+                    PA_CHANNELMATRIX_GAIN_( d, s ) += channelMatrix->gains[ d * streamChannelCount + s ];
+        }
+
+        if( channelMatrix->entries )
+        {
+            for( i = 0; i < channelMatrix->entryCount; ++i )
+            {
+                const PaChannelMatrixEntry *entry = &channelMatrix->entries[i];
+
+                if( entry->deviceChannel < 0 || entry->deviceChannel >= deviceChannelCount
+                        || entry->streamChannel < 0 || entry->streamChannel >= streamChannelCount )
+                {
+                    result = paInvalidChannelCount;
+                    goto error;
+                }
+
+                PA_CHANNELMATRIX_GAIN_( entry->deviceChannel, entry->streamChannel ) += entry->gain;
+            }
+        }
+    }
+
+#undef PA_CHANNELMATRIX_GAIN_
+
+    m->firstTerm = (unsigned int*)PaUtil_AllocateMemory(
+            (long)(sizeof(unsigned int) * (m->destinationChannelCount + 1)) );
+    m->nonzeroTermCount = (unsigned int*)PaUtil_AllocateMemory(
+            (long)(sizeof(unsigned int) * m->destinationChannelCount) );
+    if( !m->firstTerm || !m->nonzeroTermCount )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    termCount = 0;
+    for( d = 0; d < m->destinationChannelCount; ++d )
+    {
+        unsigned int nonzero = 0;
+
+        for( s = 0; s < m->sourceChannelCount; ++s )
+        {
+            if( dense[ d * m->sourceChannelCount + s ] != 0.f )
+                ++nonzero;
+        }
+
+        m->firstTerm[d] = termCount;
+        m->nonzeroTermCount[d] = nonzero;
+        termCount += (nonzero + PA_CHANNELMATRIX_GROUP_ - 1) & ~(PA_CHANNELMATRIX_GROUP_ - 1);
+    }
+    m->firstTerm[d] = termCount;
+
+    m->termSources = (unsigned int*)PaUtil_AllocateMemory(
+            (long)(sizeof(unsigned int) * (termCount ? termCount : 1)) );
+    m->termGains = (float*)PaUtil_AllocateMemory( (long)(sizeof(float) * (termCount ? termCount : 1)) );
+    if( !m->termSources || !m->termGains )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    for( d = 0; d < m->destinationChannelCount; ++d )
+    {
+        unsigned int t = m->firstTerm[d];
+
+        for( s = 0; s < m->sourceChannelCount; ++s )
+        {
+            float gain = dense[ d * m->sourceChannelCount + s ];
+
+            if( gain != 0.f )
+            {
+                m->termSources[t] = (unsigned int)s;
+                m->termGains[t] = gain;
+                ++t;
+            }
+        }
+
+        for( ; t < m->firstTerm[d + 1]; ++t )
+        {
+            m->termSources[t] = 0;
+            m->termGains[t] = 0.f;
+        }
+    }
+
+    m->mix = SelectMixKernel();
+
+    PaUtil_FreeMemory( dense );
+
+    return result;
+
+error:
+    if( dense )
+        PaUtil_FreeMemory( dense );
+
+    PaUtil_TerminateChannelMatrix( m );
+
+    return result;
+}
+
+
+void PaUtil_TerminateChannelMatrix( PaUtilChannelMatrix *m )
+{
+    if( m->firstTerm )
+        PaUtil_FreeMemory( m->firstTerm );
+
+    if( m->nonzeroTermCount )
+        PaUtil_FreeMemory( m->nonzeroTermCount );
+
+    if( m->termSources )
+        PaUtil_FreeMemory( m->termSources );
+
+    if( m->termGains )
+        PaUtil_FreeMemory( m->termGains );
+
+    memset( m, 0, sizeof(PaUtilChannelMatrix) );
+}
+
+
+long PaUtil_GetChannelMatrixMemoryUsage( const PaUtilChannelMatrix *m )
+{
+    unsigned int termCount;
+
+    if( !m->termSources )
+        return 0;
+
+    termCount = m->firstTerm[ m->destinationChannelCount ];
+    if( termCount == 0 )
+        termCount = 1;
+
+    return (long)(sizeof(unsigned int) * (2 * m->destinationChannelCount + 1)
+            + (sizeof(unsigned int) + sizeof(float)) * termCount);
+}
+
+
+void PaUtil_ApplyChannelMatrix( PaUtilChannelMatrix *m,
+        float *const *destinations, const float *const *sources, unsigned long frameCount )
+{
+    const float *groupSources[PA_CHANNELMATRIX_GROUP_];
+    int d;
+
+    for( d = 0; d < m->destinationChannelCount; ++d )
+    {
+        unsigned int first = m->firstTerm[d], t, k;
+
+        if( m->nonzeroTermCount[d] == 0 )
+        {
+            memset( destinations[d], 0, frameCount * sizeof(float) );
+        }
+        else if( m->nonzeroTermCount[d] == 1 && m->termGains[first] == 1.f )
+        {
+            memcpy( destinations[d], sources[ m->termSources[first] ], frameCount * sizeof(float) );
+        }
+        else
+        {
+            for( t = first; t < m->firstTerm[d + 1]; t += PA_CHANNELMATRIX_GROUP_ )
+            {
+                for( k = 0; k < PA_CHANNELMATRIX_GROUP_; ++k )
+                    groupSources[k] = sources[ m->termSources[t + k] ];
+
+                m->mix( destinations[d], groupSources, &m->termGains[t], frameCount, t != first );
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef PA_CHANNELMATRIX_H
+#define PA_CHANNELMATRIX_H
+/*
+ * Portable Audio I/O Library channel routing and mixing matrix
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Applies a PaChannelMatrix to non-interleaved paFloat32 buffers.
+
+ A matrix is compiled into a list of terms per destination channel, with
+ the zero gains left out, so a routing matrix costs a copy per channel and a
+ sparse one only as much as its nonzero gains. The terms are applied four
+ sources at a time with SSE2, AVX2 or NEON where available.
+
+ The buffer processor uses it to present the stream callback with a
+ different channel count than the device's, see
+ PaUtil_InitializeChannelMatrixBufferProcessor().
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** Mix up to four sources into destination, adding to what destination
+ holds if accumulate is nonzero.
+*/
+typedef void PaUtilChannelMixKernel( float *destination, const float *const *sources,
+        const float *gains, unsigned long frameCount, int accumulate );
+
+
+/** A compiled channel matrix. All fields are private, use the functions
+ below.
+*/
+typedef struct PaUtilChannelMatrix
+{
+    int sourceChannelCount;
+    int destinationChannelCount;
+
+    unsigned int *firstTerm;        /**< destinationChannelCount + 1 offsets into the terms */
+    unsigned int *termSources;      /**< padded with source 0 to a multiple of four per destination */
+    float *termGains;               /**< padded with 0 */
+    unsigned int *nonzeroTermCount; /**< the terms of each destination without the padding */
+    PaUtilChannelMixKernel *mix;
+} PaUtilChannelMatrix;
+
+
+/** Compile a channel matrix.
+
+ @param matrix The matrix to initialize.
+
+ @param channelMatrix The gains. NULL routes each stream channel to the
+ device channel with the same index.
+
+ @param streamChannelCount The channel count of the stream's buffers.
+
+ @param toDevice Nonzero if the stream channels are the sources (output),
+ zero if the device channels are (input).
+
+ @return paNoError, paInvalidChannelCount if the device channel count or a
+ channel index is out of range, or paInsufficientMemory. The matrix must not
+ be used or terminated if initialization failed.
+*/
+PaError PaUtil_InitializeChannelMatrix( PaUtilChannelMatrix *matrix,
+        const PaChannelMatrix *channelMatrix, int streamChannelCount, int toDevice );
+
+
+/** Free the memory of a matrix initialized with PaUtil_InitializeChannelMatrix().
+*/
+void PaUtil_TerminateChannelMatrix( PaUtilChannelMatrix *matrix );
+
+
+/** Return the number of bytes allocated by PaUtil_InitializeChannelMatrix()
+ for the terms of a matrix.
+*/
+long PaUtil_GetChannelMatrixMemoryUsage( const PaUtilChannelMatrix *matrix );
+
+
+/** Mix non-interleaved paFloat32 buffers.
+
+ @param matrix The matrix.
+
+ @param destinations destinationChannelCount buffers of frameCount frames.
+
+ @param sources sourceChannelCount buffers of frameCount frames, they must
+ not overlap the destinations.
+
+ @param frameCount The number of frames to mix.
+*/
+void PaUtil_ApplyChannelMatrix( PaUtilChannelMatrix *matrix,
+        float *const *destinations, const float *const *sources, unsigned long frameCount );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_CHANNELMATRIX_H */
@@ -0,0 +1,192 @@
+/*
+ * Generator for stride specialized PortAudio sample converters.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Macros used by converter implementations to generate versions of a
+ converter for fixed source and destination strides.
+
+ A converter written as a force inlined kernel is expanded once per stride
+ pair by PA_OUTPUT_STRIDE_CONVERTERS_ or PA_INPUT_STRIDE_CONVERTERS_. With
+ the strides known at compile time the per vector stride branches and the
+ gather / scatter index arithmetic are folded away.
+
+ Each specialized version checks the strides it was called with on entry and
+ hands the buffer to the generic version if they turn out to be different,
+ so selecting a wrong one is slow, never wrong.
+
+ PaUtil_SelectConverterForStrides() picks the versions generated here.
+*/
+
+#ifndef PA_CONVERTER_VARIANTS_H
+#define PA_CONVERTER_VARIANTS_H
+
+#include "pa_converters.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PA_CONVERTER_KERNEL_ __inline __attribute__((always_inline))
+#define PA_CONVERTER_NOINLINE_ __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define PA_CONVERTER_KERNEL_ __forceinline
+#define PA_CONVERTER_NOINLINE_ __declspec(noinline)
+#else
+#define PA_CONVERTER_KERNEL_ __inline
+#define PA_CONVERTER_NOINLINE_
+#endif
+
+/* The generators take a tag instead of the function attributes themselves,
+   PA_CONVERTER_ATTRIBUTES_ ## tag must expand to the attributes (e.g. a
+   target ISA) of the kernel. */
+#define PA_CONVERTER_ATTRIBUTES_PORTABLE
+
+
+/** Maps a generic converter and a pair of strides to the version of the
+    converter generated for exactly these strides.
+*/
+typedef struct PaUtilStrideConverter{
+    PaUtilConverter *converter;
+    signed int sourceStride;
+    signed int destinationStride;
+    PaUtilConverter *specialized;
+} PaUtilStrideConverter;
+
+/** The number of entries of each table generated by
+    PA_OUTPUT_STRIDE_CONVERTERS_ and PA_INPUT_STRIDE_CONVERTERS_.
+*/
+#define PA_STRIDE_CONVERTER_COUNT_  (9)
+
+
+/** Search tables of PA_STRIDE_CONVERTER_COUNT_ entries each for a version
+    of converter specialized for sourceStride and destinationStride.
+    @return the specialized converter or NULL if there is none.
+*/
+PaUtilConverter* PaUtil_FindStrideConverter( const PaUtilStrideConverter *const *tables,
+        int tableCount, PaUtilConverter *converter,
+        signed int sourceStride, signed int destinationStride );
+
+
+/* kernel ## _Generic is the version installed into paConverters. It must not
+   be inlined into the specialized versions, they only need the kernel
+   expanded for their own strides. */
+#define PA_GENERIC_CONVERTER_( tag, kernel ) \
+    PA_CONVERTER_ATTRIBUTES_ ## tag PA_CONVERTER_NOINLINE_ static void kernel ## _Generic( \
+        void *destinationBuffer, signed int destinationStride, \
+        void *sourceBuffer, signed int sourceStride, \
+        unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator ) \
+    { \
+        kernel( destinationBuffer, destinationStride, \
+                sourceBuffer, sourceStride, count, ditherGenerator ); \
+    }
+
+#define PA_STRIDE_CONVERTER_( tag, kernel, ss, ds ) \
+    PA_CONVERTER_ATTRIBUTES_ ## tag static void kernel ## _ ## ss ## _ ## ds( \
+        void *destinationBuffer, signed int destinationStride, \
+        void *sourceBuffer, signed int sourceStride, \
+        unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator ) \
+    { \
+        if( sourceStride == (ss) && destinationStride == (ds) ) \
+            kernel( destinationBuffer, (ds), sourceBuffer, (ss), count, ditherGenerator ); \
+        else \
+            kernel ## _Generic( destinationBuffer, destinationStride, \
+                    sourceBuffer, sourceStride, count, ditherGenerator ); \
+    }
+
+#define PA_STRIDE_CONVERTER_ENTRY_( kernel, ss, ds ) \
+    { kernel ## _Generic, (ss), (ds), kernel ## _ ## ss ## _ ## ds }
+
+
+/** Generate kernel ## _Generic, the specialized versions and the table
+    kernel ## _Strides for a converter from user to host format: the user
+    buffer (source) has a stride of 1 or the channel count, the host buffer
+    (destination) is interleaved.
+*/
+#define PA_OUTPUT_STRIDE_CONVERTERS_( tag, kernel ) \
+    PA_GENERIC_CONVERTER_( tag, kernel ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 1, 1 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 1, 2 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 2, 2 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 1, 4 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 4, 4 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 1, 6 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 6, 6 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 1, 8 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 8, 8 ) \
+    static const PaUtilStrideConverter kernel ## _Strides[PA_STRIDE_CONVERTER_COUNT_] = { \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 1, 1 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 1, 2 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 2, 2 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 1, 4 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 4, 4 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 1, 6 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 6, 6 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 1, 8 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 8, 8 ) };
+
+/** Same as PA_OUTPUT_STRIDE_CONVERTERS_ for a converter from host to user
+    format: the host buffer (source) is interleaved.
+*/
+#define PA_INPUT_STRIDE_CONVERTERS_( tag, kernel ) \
+    PA_GENERIC_CONVERTER_( tag, kernel ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 1, 1 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 2, 1 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 2, 2 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 4, 1 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 4, 4 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 6, 1 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 6, 6 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 8, 1 ) \
+    PA_STRIDE_CONVERTER_( tag, kernel, 8, 8 ) \
+    static const PaUtilStrideConverter kernel ## _Strides[PA_STRIDE_CONVERTER_COUNT_] = { \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 1, 1 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 2, 1 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 2, 2 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 4, 1 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 4, 4 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 6, 1 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 6, 6 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 8, 1 ), \
+        PA_STRIDE_CONVERTER_ENTRY_( kernel, 8, 8 ) };
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_CONVERTER_VARIANTS_H */
@@ -61,10 +61,19 @@
 */
 
 
+#include <stdio.h> /* fopen(), snprintf() */
+#include <stdlib.h> /* getenv(), strtod() */
+#include <string.h> /* memset() */
+
 #include "pa_converters.h"
+#include "pa_converter_variants.h"
+#include "pa_cpufeatures.h"
+#include "pa_debugprint.h"
 #include "pa_dither.h"
 #include "pa_endianness.h"
 #include "pa_types.h"
+#include "pa_util.h"
+#include "pa_x86_simd_converters.h"
 
 /* allow to switch acceleration on/off */
 volatile int withAcceleration = 1;
@@ -238,70 +247,253 @@ static inline PaInt16 *NeonWriteDestVectorInt16(
     return dest;
 }
 
-#endif /* __ARM_NEON__ */
-
+static inline float *NeonWriteDestVectorFloat32(
+    float32x4_t neonResultVector, float *dest, signed int destinationStride)
+{
+    switch(destinationStride)
+    {
+        case 1:
+            vst1q_f32(dest, neonResultVector);
+            dest += destinationStride * ARM_NEON_BEST_VECTOR_SIZE;
+            break;
+        default:
+        {
+            int lane;
+            for(lane=0; lane<ARM_NEON_BEST_VECTOR_SIZE; lane++)
+            {
+                vst1q_lane_f32(dest, neonResultVector, lane);
+                dest += destinationStride;
+            }
+            break;
+        }
+    }
+    return dest;
+}
 
-PaSampleFormat PaUtil_SelectClosestAvailableFormat(
-        PaSampleFormat availableFormats, PaSampleFormat format )
+/* Only the lower ARM_NEON_BEST_VECTOR_SIZE lanes are written */
+static inline unsigned char *NeonWriteDestVector8(
+    uint8x8_t neonResultVector, unsigned char *dest, signed int destinationStride)
 {
-    PaSampleFormat result;
+    int lane;
+    for(lane=0; lane<ARM_NEON_BEST_VECTOR_SIZE; lane++)
+    {
+        vst1_lane_u8(dest, neonResultVector, lane);
+        dest += destinationStride;
+    }
+    return dest;
+}
 
-    format &= ~paNonInterleaved;
-    availableFormats &= ~paNonInterleaved;
-    
-    if( (format & availableFormats) == 0 )
+static inline int32x4_t NeonGetSourceVectorInt32(
+    PaInt32 **src, signed int sourceStride)
+{
+    int lane;
+    int32x4_t neonSourceVector = vdupq_n_s32(0);
+    switch(sourceStride)
     {
-        /* NOTE: this code depends on the sample format constants being in
-            descending order of quality - ie best quality is 0
-            FIXME: should write an assert which checks that all of the
-            known constants conform to that requirement.
-        */
+        case 1:
+            neonSourceVector = vld1q_s32(*src);
+            *src += sourceStride * ARM_NEON_BEST_VECTOR_SIZE;
+            break;
+        case 2:
+        {
+            int32x4x2_t neonTmp = vld2q_s32(*src);
+            neonSourceVector = neonTmp.val[0];
+            *src += sourceStride * ARM_NEON_BEST_VECTOR_SIZE;
+            break;
+        }
+        /* VLDN N>2 decrease performance */
+        default:
+            for(lane=0; lane<ARM_NEON_BEST_VECTOR_SIZE; lane++)
+            {
+                neonSourceVector = vld1q_lane_s32(*src, neonSourceVector, lane);
+                *src += sourceStride;
+            }
+            break;
+    }
+    return neonSourceVector;
+}
 
-        if( format != 0x01 )
+/* Returns the 24 bit samples left aligned in 32 bit lanes - same as the
+ * scalar converters do with their temp variable.
+ */
+static inline int32x4_t NeonGetSourceVectorInt24(
+    unsigned char **src, signed int sourceStride)
+{
+    int32x4_t neonSourceVector;
+    switch(sourceStride)
+    {
+        /* Did not find big endian ARM NEON machine for test - so disable this path */
+        #if defined(PA_LITTLE_ENDIAN)
+        case 1:
+        {
+            /* Reverse of NeonWriteDestVectorInt24: load 64+32 bits and expand
+             * them by table lookup. Indexes out of range (255) become 0.
+             *
+             * |24Bit0|24Bit1|24Bit2|24Bit3|
+             *                  |
+             *                  v
+             * |0|24Bit0|0|24Bit1|0|24Bit2|0|24Bit3|
+             */
+            static const uint8_t expandPositions[] =
+            {
+                255, 0, 1, 2, 255, 3,  4,  5,
+                255, 6, 7, 8, 255, 9, 10, 11
+            };
+            uint8x8x2_t neonTable;
+            neonTable.val[0] = vld1_u8(*src);
+            neonTable.val[1] = vreinterpret_u8_u32(
+                vld1_lane_u32((const uint32_t*)(*src + 8), vdup_n_u32(0), 0));
+            uint8x8_t neonValuesLow = vtbl2_u8(neonTable, vld1_u8(expandPositions));
+            uint8x8_t neonValuesHigh = vtbl2_u8(neonTable, vld1_u8(expandPositions + 8));
+            neonSourceVector = vreinterpretq_s32_u8(vcombine_u8(neonValuesLow, neonValuesHigh));
+            *src += 8+4;
+            break;
+        }
+        #endif /* defined(PA_LITTLE_ENDIAN)*/
+        default:
         {
-            /* scan for better formats */
-            result = format;
-            do
+            /* Collect data 'traditional' and move it into neon */
+            PaInt32 sourceVector32[ARM_NEON_BEST_VECTOR_SIZE];
+            unsigned char *s = *src;
+            int lane;
+            for(lane=0; lane<ARM_NEON_BEST_VECTOR_SIZE; lane++)
             {
-                result >>= 1;
+                #if defined(PA_LITTLE_ENDIAN)
+                    sourceVector32[lane] = (((PaInt32)s[0]) << 8) |
+                        (((PaInt32)s[1]) << 16) | (((PaInt32)s[2]) << 24);
+                #elif defined(PA_BIG_ENDIAN)
+                    sourceVector32[lane] = (((PaInt32)s[0]) << 24) |
+                        (((PaInt32)s[1]) << 16) | (((PaInt32)s[2]) << 8);
+                #endif
+                s += 3*sourceStride;
             }
-            while( (result & availableFormats) == 0 && result != 0 );
+            neonSourceVector = vld1q_s32(sourceVector32);
+            *src = s;
+            break;
         }
-        else
+    }
+    return neonSourceVector;
+}
+
+static inline int16x4_t NeonGetSourceVectorInt16(
+    PaInt16 **src, signed int sourceStride)
+{
+    int lane;
+    int16x4_t neonSourceVector = vdup_n_s16(0);
+    switch(sourceStride)
+    {
+        case 1:
+            neonSourceVector = vld1_s16(*src);
+            *src += sourceStride * ARM_NEON_BEST_VECTOR_SIZE;
+            break;
+        case 2:
         {
-            result = 0;
+            int16x4x2_t neonTmp = vld2_s16(*src);
+            neonSourceVector = neonTmp.val[0];
+            *src += sourceStride * ARM_NEON_BEST_VECTOR_SIZE;
+            break;
         }
-        
-        if( result == 0 ){
-            /* scan for worse formats */
-            result = format;
-            do
+        /* VLDN N>2 decrease performance */
+        default:
+            for(lane=0; lane<ARM_NEON_BEST_VECTOR_SIZE; lane++)
             {
-                result <<= 1;
+                neonSourceVector = vld1_lane_s16(*src, neonSourceVector, lane);
+                *src += sourceStride;
             }
-            while( (result & availableFormats) == 0 && result != paCustomFormat );
+            break;
+    }
+    return neonSourceVector;
+}
 
-            if( (result & availableFormats) == 0 )
-                result = paSampleFormatNotSupported;
-        }
-        
-    }else{
-        result = format;
+/* Only the lower ARM_NEON_BEST_VECTOR_SIZE lanes are loaded - the upper
+ * lanes are 0. Signed and unsigned 8 bit sources share this loader.
+ */
+static inline uint8x8_t NeonGetSourceVector8(
+    unsigned char **src, signed int sourceStride)
+{
+    int lane;
+    uint8x8_t neonSourceVector = vdup_n_u8(0);
+    for(lane=0; lane<ARM_NEON_BEST_VECTOR_SIZE; lane++)
+    {
+        neonSourceVector = vld1_lane_u8(*src, neonSourceVector, lane);
+        *src += sourceStride;
+    }
+    return neonSourceVector;
+}
+
+/* Widen lower lanes of 8 bit vector to 32 bit lanes */
+static inline int32x4_t NeonWidenInt8ToInt32(int8x8_t neonVector)
+{
+    return vmovl_s16(vget_low_s16(vmovl_s8(neonVector)));
+}
+
+/* Narrow 32 bit lanes to lower lanes of 8 bit vector (truncating) */
+static inline int8x8_t NeonNarrowInt32ToInt8(int32x4_t neonVector)
+{
+    int16x4_t neonVector16 = vmovn_s32(neonVector);
+    return vmovn_s16(vcombine_s16(neonVector16, neonVector16));
+}
+
+#endif /* __ARM_NEON__ */
+
+
+/* The sample formats in descending order of quality. paInt24In32 carries
+   the same samples as paInt24 and is tried right after it. */
+static const PaSampleFormat formatsByQuality_[] = {
+    paFloat64, paFloat32, paInt32, paInt24, paInt24In32, paInt16, paInt8, paUInt8, paCustomFormat
+};
+
+#define PA_FORMAT_BY_QUALITY_COUNT_ \
+    ((int)(sizeof(formatsByQuality_) / sizeof(formatsByQuality_[0])))
+
+PaSampleFormat PaUtil_SelectClosestAvailableFormat(
+        PaSampleFormat availableFormats, PaSampleFormat format )
+{
+    int requested, i;
+
+    format &= ~paNonInterleaved;
+    availableFormats &= ~paNonInterleaved;
+    
+    if( (format & availableFormats) != 0 )
+        return format;
+
+    for( requested=0; requested < PA_FORMAT_BY_QUALITY_COUNT_; ++requested )
+    {
+        if( formatsByQuality_[requested] == format )
+            break;
+    }
+
+    /* scan for better formats */
+    for( i=requested-1; i >= 0; --i )
+    {
+        if( formatsByQuality_[i] & availableFormats )
+            return formatsByQuality_[i];
+    }
+
+    /* scan for worse formats */
+    for( i=requested+1; i < PA_FORMAT_BY_QUALITY_COUNT_; ++i )
+    {
+        if( formatsByQuality_[i] & availableFormats )
+            return formatsByQuality_[i];
     }
 
-    return result;
+    return paSampleFormatNotSupported;
 }
 
 /* -------------------------------------------------------------------------- */
 
-#define PA_SELECT_FORMAT_( format, float32, int32, int24, int16, int8, uint8 ) \
+#define PA_SELECT_FORMAT_( format, float64, float32, int32, int24, int24in32, int16, int8, uint8 ) \
     switch( format & ~paNonInterleaved ){                                      \
+    case paFloat64:                                                            \
+        float64                                                                \
     case paFloat32:                                                            \
         float32                                                                \
     case paInt32:                                                              \
         int32                                                                  \
     case paInt24:                                                              \
         int24                                                                  \
+    case paInt24In32:                                                          \
+        int24in32                                                              \
     case paInt16:                                                              \
         int16                                                                  \
     case paInt8:                                                               \
@@ -330,6 +522,22 @@ PaSampleFormat PaUtil_SelectClosestAvailableFormat(
 
 /* -------------------------------------------------------------------------- */
 
+/* paSoftClip only applies to Float32 sources, paClipOff overrides it */
+#define PA_SOFT_CLIP_( flags ) ( ((flags) & (paClipOff | paSoftClip)) == paSoftClip )
+
+#define PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, destination )            \
+    if( PA_SOFT_CLIP_( flags ) ){                                              \
+        if( flags & paDitherOff ){ /* no dither */                             \
+            return paConverters. Float32_To_ ## destination ## _SoftClip;      \
+        }else{ /* dither */                                                    \
+            return paConverters. Float32_To_ ## destination ## _DitherSoftClip; \
+        }                                                                      \
+    }else{                                                                     \
+        PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float32, destination )        \
+    }
+
+/* -------------------------------------------------------------------------- */
+
 #define PA_SELECT_CONVERTER_DITHER_( flags, source, destination )              \
     if( flags & paDitherOff ){ /* no dither */                                 \
         return paConverters. source ## _To_ ## destination;                    \
@@ -353,56 +561,91 @@ PaUtilConverter* PaUtil_SelectConverter( PaSampleFormat sourceFormat,
         PaSampleFormat destinationFormat, PaStreamFlags flags )
 {
     PA_SELECT_FORMAT_( sourceFormat,
+                       /* paFloat64: */
+                       PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_UNITY_CONVERSION_( 64 ),
+                                          /* paFloat32: */        PA_USE_CONVERTER_( Float64, Float32 ),
+                                          /* paInt32: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float64, Int32 ),
+                                          /* paInt24: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float64, Int24 ),
+                                          /* paInt24In32: */      PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float64, Int24In32 ),
+                                          /* paInt16: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float64, Int16 ),
+                                          /* paInt8: */           PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float64, Int8 ),
+                                          /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float64, UInt8 )
+                                        ),
                        /* paFloat32: */
                        PA_SELECT_FORMAT_( destinationFormat,
-                                          /* paFloat32: */        PA_UNITY_CONVERSION_( 32 ),
-                                          /* paInt32: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float32, Int32 ),
-                                          /* paInt24: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float32, Int24 ),
-                                          /* paInt16: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float32, Int16 ),
-                                          /* paInt8: */           PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float32, Int8 ),
-                                          /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_CLIP_( flags, Float32, UInt8 )
+                                          /* paFloat64: */        PA_USE_CONVERTER_( Float32, Float64 ),
+                                          /* paFloat32: */        if( PA_SOFT_CLIP_( flags ) ) PA_USE_CONVERTER_( Float32, Float32_SoftClip )
+                                                                  PA_UNITY_CONVERSION_( 32 ),
+                                          /* paInt32: */          PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, Int32 ),
+                                          /* paInt24: */          PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, Int24 ),
+                                          /* paInt24In32: */      PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, Int24In32 ),
+                                          /* paInt16: */          PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, Int16 ),
+                                          /* paInt8: */           PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, Int8 ),
+                                          /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_SOFT_CLIP_( flags, UInt8 )
                                         ),
                        /* paInt32: */
                        PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_USE_CONVERTER_( Int32, Float64 ),
                                           /* paFloat32: */        PA_USE_CONVERTER_( Int32, Float32 ),
                                           /* paInt32: */          PA_UNITY_CONVERSION_( 32 ),
                                           /* paInt24: */          PA_SELECT_CONVERTER_DITHER_( flags, Int32, Int24 ),
+                                          /* paInt24In32: */      PA_SELECT_CONVERTER_DITHER_( flags, Int32, Int24In32 ),
                                           /* paInt16: */          PA_SELECT_CONVERTER_DITHER_( flags, Int32, Int16 ),
                                           /* paInt8: */           PA_SELECT_CONVERTER_DITHER_( flags, Int32, Int8 ),
                                           /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_( flags, Int32, UInt8 )
                                         ),
                        /* paInt24: */
                        PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_USE_CONVERTER_( Int24, Float64 ),
                                           /* paFloat32: */        PA_USE_CONVERTER_( Int24, Float32 ),
                                           /* paInt32: */          PA_USE_CONVERTER_( Int24, Int32 ),
                                           /* paInt24: */          PA_UNITY_CONVERSION_( 24 ),
+                                          /* paInt24In32: */      PA_USE_CONVERTER_( Int24, Int24In32 ),
                                           /* paInt16: */          PA_SELECT_CONVERTER_DITHER_( flags, Int24, Int16 ),
                                           /* paInt8: */           PA_SELECT_CONVERTER_DITHER_( flags, Int24, Int8 ),
                                           /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_( flags, Int24, UInt8 )
                                         ),
+                       /* paInt24In32: */
+                       PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_USE_CONVERTER_( Int24In32, Float64 ),
+                                          /* paFloat32: */        PA_USE_CONVERTER_( Int24In32, Float32 ),
+                                          /* paInt32: */          PA_USE_CONVERTER_( Int24In32, Int32 ),
+                                          /* paInt24: */          PA_USE_CONVERTER_( Int24In32, Int24 ),
+                                          /* paInt24In32: */      PA_UNITY_CONVERSION_( 32 ),
+                                          /* paInt16: */          PA_SELECT_CONVERTER_DITHER_( flags, Int24In32, Int16 ),
+                                          /* paInt8: */           PA_SELECT_CONVERTER_DITHER_( flags, Int24In32, Int8 ),
+                                          /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_( flags, Int24In32, UInt8 )
+                                        ),
                        /* paInt16: */
                        PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_USE_CONVERTER_( Int16, Float64 ),
                                           /* paFloat32: */        PA_USE_CONVERTER_( Int16, Float32 ),
                                           /* paInt32: */          PA_USE_CONVERTER_( Int16, Int32 ),
                                           /* paInt24: */          PA_USE_CONVERTER_( Int16, Int24 ),
+                                          /* paInt24In32: */      PA_USE_CONVERTER_( Int16, Int24In32 ),
                                           /* paInt16: */          PA_UNITY_CONVERSION_( 16 ),
                                           /* paInt8: */           PA_SELECT_CONVERTER_DITHER_( flags, Int16, Int8 ),
                                           /* paUInt8: */          PA_SELECT_CONVERTER_DITHER_( flags, Int16, UInt8 )
                                         ),
                        /* paInt8: */
                        PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_USE_CONVERTER_( Int8, Float64 ),
                                           /* paFloat32: */        PA_USE_CONVERTER_( Int8, Float32 ),
                                           /* paInt32: */          PA_USE_CONVERTER_( Int8, Int32 ),
                                           /* paInt24: */          PA_USE_CONVERTER_( Int8, Int24 ),
+                                          /* paInt24In32: */      PA_USE_CONVERTER_( Int8, Int24In32 ),
                                           /* paInt16: */          PA_USE_CONVERTER_( Int8, Int16 ),
                                           /* paInt8: */           PA_UNITY_CONVERSION_( 8 ),
                                           /* paUInt8: */          PA_USE_CONVERTER_( Int8, UInt8 )
                                         ),
                        /* paUInt8: */
                        PA_SELECT_FORMAT_( destinationFormat,
+                                          /* paFloat64: */        PA_USE_CONVERTER_( UInt8, Float64 ),
                                           /* paFloat32: */        PA_USE_CONVERTER_( UInt8, Float32 ),
                                           /* paInt32: */          PA_USE_CONVERTER_( UInt8, Int32 ),
                                           /* paInt24: */          PA_USE_CONVERTER_( UInt8, Int24 ),
+                                          /* paInt24In32: */      PA_USE_CONVERTER_( UInt8, Int24In32 ),
                                           /* paInt16: */          PA_USE_CONVERTER_( UInt8, Int16 ),
                                           /* paInt8: */           PA_USE_CONVERTER_( UInt8, Int8 ),
                                           /* paUInt8: */          PA_UNITY_CONVERSION_( 8 )
@@ -481,10 +724,87 @@ PaUtilConverterTable paConverters = {
     0, /* PaUtilConverter *UInt8_To_Int16; */
     0, /* PaUtilConverter *UInt8_To_Int8; */
 
+    0, /* PaUtilConverter *Float32_To_Int24In32; */
+    0, /* PaUtilConverter *Float32_To_Int24In32_Dither; */
+    0, /* PaUtilConverter *Float32_To_Int24In32_Clip; */
+    0, /* PaUtilConverter *Float32_To_Int24In32_DitherClip; */
+
+    0, /* PaUtilConverter *Int32_To_Int24In32; */
+    0, /* PaUtilConverter *Int32_To_Int24In32_Dither; */
+    0, /* PaUtilConverter *Int24_To_Int24In32; */
+    0, /* PaUtilConverter *Int16_To_Int24In32; */
+    0, /* PaUtilConverter *Int8_To_Int24In32; */
+    0, /* PaUtilConverter *UInt8_To_Int24In32; */
+
+    0, /* PaUtilConverter *Int24In32_To_Float32; */
+    0, /* PaUtilConverter *Int24In32_To_Int32; */
+    0, /* PaUtilConverter *Int24In32_To_Int24; */
+    0, /* PaUtilConverter *Int24In32_To_Int16; */
+    0, /* PaUtilConverter *Int24In32_To_Int16_Dither; */
+    0, /* PaUtilConverter *Int24In32_To_Int8; */
+    0, /* PaUtilConverter *Int24In32_To_Int8_Dither; */
+    0, /* PaUtilConverter *Int24In32_To_UInt8; */
+    0, /* PaUtilConverter *Int24In32_To_UInt8_Dither; */
+
+    0, /* PaUtilConverter *Float64_To_Float32; */
+
+    0, /* PaUtilConverter *Float64_To_Int32; */
+    0, /* PaUtilConverter *Float64_To_Int32_Dither; */
+    0, /* PaUtilConverter *Float64_To_Int32_Clip; */
+    0, /* PaUtilConverter *Float64_To_Int32_DitherClip; */
+
+    0, /* PaUtilConverter *Float64_To_Int24; */
+    0, /* PaUtilConverter *Float64_To_Int24_Dither; */
+    0, /* PaUtilConverter *Float64_To_Int24_Clip; */
+    0, /* PaUtilConverter *Float64_To_Int24_DitherClip; */
+
+    0, /* PaUtilConverter *Float64_To_Int24In32; */
+    0, /* PaUtilConverter *Float64_To_Int24In32_Dither; */
+    0, /* PaUtilConverter *Float64_To_Int24In32_Clip; */
+    0, /* PaUtilConverter *Float64_To_Int24In32_DitherClip; */
+
+    0, /* PaUtilConverter *Float64_To_Int16; */
+    0, /* PaUtilConverter *Float64_To_Int16_Dither; */
+    0, /* PaUtilConverter *Float64_To_Int16_Clip; */
+    0, /* PaUtilConverter *Float64_To_Int16_DitherClip; */
+
+    0, /* PaUtilConverter *Float64_To_Int8; */
+    0, /* PaUtilConverter *Float64_To_Int8_Dither; */
+    0, /* PaUtilConverter *Float64_To_Int8_Clip; */
+    0, /* PaUtilConverter *Float64_To_Int8_DitherClip; */
+
+    0, /* PaUtilConverter *Float64_To_UInt8; */
+    0, /* PaUtilConverter *Float64_To_UInt8_Dither; */
+    0, /* PaUtilConverter *Float64_To_UInt8_Clip; */
+    0, /* PaUtilConverter *Float64_To_UInt8_DitherClip; */
+
+    0, /* PaUtilConverter *Float32_To_Float64; */
+    0, /* PaUtilConverter *Int32_To_Float64; */
+    0, /* PaUtilConverter *Int24_To_Float64; */
+    0, /* PaUtilConverter *Int24In32_To_Float64; */
+    0, /* PaUtilConverter *Int16_To_Float64; */
+    0, /* PaUtilConverter *Int8_To_Float64; */
+    0, /* PaUtilConverter *UInt8_To_Float64; */
+
+    0, /* PaUtilConverter *Float32_To_Float32_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int32_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int32_DitherSoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int24_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int24_DitherSoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int24In32_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int24In32_DitherSoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int16_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int16_DitherSoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int8_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_Int8_DitherSoftClip; */
+    0, /* PaUtilConverter *Float32_To_UInt8_SoftClip; */
+    0, /* PaUtilConverter *Float32_To_UInt8_DitherSoftClip; */
+
     0, /* PaUtilConverter *Copy_8_To_8; */
     0, /* PaUtilConverter *Copy_16_To_16; */
     0, /* PaUtilConverter *Copy_24_To_24; */
-    0  /* PaUtilConverter *Copy_32_To_32; */
+    0, /* PaUtilConverter *Copy_32_To_32; */
+    0  /* PaUtilConverter *Copy_64_To_64; */
 };
 
 /* -------------------------------------------------------------------------- */
@@ -493,8 +813,11 @@ PaUtilConverterTable paConverters = {
 
 /* -------------------------------------------------------------------------- */
 
+/* Two independent selects rather than nested ones, each of which compilers
+   can turn into a min / max or conditional move instead of a branch. NaN
+   passes through unchanged, as it does for the SIMD versions. */
 #define PA_CLIP_( val, min, max )\
-    { val = ((val) < (min)) ? (min) : (((val) > (max)) ? (max) : (val)); }
+    { val = ((val) < (min)) ? (min) : (val); val = ((val) > (max)) ? (max) : (val); }
 
 
 static const float const_1_div_128_ = 1.0f / 128.0f;  /* 8 bit multiplier */
@@ -505,7 +828,7 @@ static const double const_1_div_2147483648_ = 1.0 / 2147483648.0; /* 32 bit mult
 
 /* -------------------------------------------------------------------------- */
 
-static void Float32_To_Int32(
+static PA_CONVERTER_KERNEL_ void Float32_To_Int32(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -551,6 +874,8 @@ static void Float32_To_Int32(
     }
 }
 
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Int32 )
+
 /* -------------------------------------------------------------------------- */
 
 static void Float32_To_Int32_Dither(
@@ -567,7 +892,7 @@ static void Float32_To_Int32_Dither(
         /* ARM NEON does not support doubles so don't dither at 32Bit - there
          * is no hardware avavailable creating less noise than 32Bit dither...
          */
-        Float32_To_Int32(
+        Float32_To_Int32_Generic(
             destinationBuffer,
             destinationStride,
             sourceBuffer,
@@ -578,28 +903,36 @@ static void Float32_To_Int32_Dither(
     }
 #endif
 
-    while( count-- )
+    while( count > 0 )
     {
-        /* REVIEW */
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* REVIEW */
 #if defined (PA_USE_C99_LRINTF) && !defined (__ARM_NEON__)
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = ((float)*src * (2147483646.0f)) + dither;
-        *dest = lrintf(dithered - 0.5f);
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = ((float)*src * (2147483646.0f)) + dither;
+            *dest = lrintf(dithered - 0.5f);
 #else
-        double dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        double dithered = ((double)*src * (2147483646.0)) + dither;
-        *dest = (PaInt32) dithered;
+            double dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = ((double)*src * (2147483646.0)) + dither;
+            *dest = (PaInt32) dithered;
 #endif
-        src += sourceStride;
-        dest += destinationStride;
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void Float32_To_Int32_Clip(
+static PA_CONVERTER_KERNEL_ void Float32_To_Int32_Clip(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -650,6 +983,8 @@ static void Float32_To_Int32_Clip(
     }
 }
 
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Int32_Clip )
+
 /* -------------------------------------------------------------------------- */
 
 static void Float32_To_Int32_DitherClip(
@@ -666,7 +1001,7 @@ static void Float32_To_Int32_DitherClip(
         /* ARM NEON does not support doubles so don't dither at 32Bit - there
          * is no hardware avavailable creating less noise than 32Bit dither...
          */
-        Float32_To_Int32(
+        Float32_To_Int32_Generic(
             destinationBuffer,
             destinationStride,
             sourceBuffer,
@@ -677,25 +1012,33 @@ static void Float32_To_Int32_DitherClip(
     }
 #endif
 
-    while( count-- )
+    while( count > 0 )
     {
-        /* REVIEW */
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* REVIEW */
 #if defined (PA_USE_C99_LRINTF) && !defined (__ARM_NEON__)
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = ((float)*src * (2147483646.0f)) + dither;
-        PA_CLIP_( dithered, -2147483648.f, 2147483647.f  );
-        *dest = lrintf(dithered-0.5f);
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = ((float)*src * (2147483646.0f)) + dither;
+            PA_CLIP_( dithered, -2147483648.f, 2147483647.f  );
+            *dest = lrintf(dithered-0.5f);
 #else
-        double dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        double dithered = ((double)*src * (2147483646.0)) + dither;
-        PA_CLIP_( dithered, -2147483648., 2147483647.  );
-        *dest = (PaInt32) dithered;
+            double dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = ((double)*src * (2147483646.0)) + dither;
+            PA_CLIP_( dithered, -2147483648., 2147483647.  );
+            *dest = (PaInt32) dithered;
 #endif
 
-        src += sourceStride;
-        dest += destinationStride;
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
@@ -790,28 +1133,36 @@ static void Float32_To_Int24_Dither(
     }
 #endif
 
-    while( count-- )
+    while( count > 0 )
     {
-        /* convert to 32 bit and drop the low 8 bits */
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
 
-        double dither  = PaUtil_GenerateFloatTriangularDither24( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        double dithered = ((double)*src * (2147483646.0)) + dither;
-        
-        temp = (PaInt32) dithered;
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* convert to 32 bit and drop the low 8 bits */
+
+            double dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = ((double)*src * (2147483646.0)) + dither;
+
+            temp = (PaInt32) dithered;
 
 #if defined(PA_LITTLE_ENDIAN)
-        dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
-        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
-        dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
 #elif defined(PA_BIG_ENDIAN)
-        dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
-        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
-        dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
 #endif
 
-        src += sourceStride;
-        dest += destinationStride * 3;
+            src += sourceStride;
+            dest += destinationStride * 3;
+        }
+        count -= n;
     }
 }
 
@@ -914,35 +1265,43 @@ static void Float32_To_Int24_DitherClip(
     }
 #endif
 
-    while( count-- )
+    while( count > 0 )
     {
-        /* convert to 32 bit and drop the low 8 bits */
-        
-        double dither  = PaUtil_GenerateFloatTriangularDither24( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        double dithered = ((double)*src * (2147483646.0)) + dither;
-        PA_CLIP_( dithered, -2147483648., 2147483647.  );
-        
-        temp = (PaInt32) dithered;
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* convert to 32 bit and drop the low 8 bits */
+
+            double dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = ((double)*src * (2147483646.0)) + dither;
+            PA_CLIP_( dithered, -2147483648., 2147483647.  );
+
+            temp = (PaInt32) dithered;
 
 #if defined(PA_LITTLE_ENDIAN)
-        dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
-        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
-        dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
 #elif defined(PA_BIG_ENDIAN)
-        dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
-        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
-        dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
 #endif
 
-        src += sourceStride;
-        dest += destinationStride * 3;
+            src += sourceStride;
+            dest += destinationStride * 3;
+        }
+        count -= n;
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void Float32_To_Int16(
+static PA_CONVERTER_KERNEL_ void Float32_To_Int16(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -987,6 +1346,8 @@ static void Float32_To_Int16(
     }
 }
 
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Int16 )
+
 /* -------------------------------------------------------------------------- */
 
 static void Float32_To_Int16_Dither(
@@ -1021,27 +1382,35 @@ static void Float32_To_Int16_Dither(
     }
 #endif
 
-    while( count-- )
+    while( count > 0 )
     {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
 
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = (*src * (32766.0f)) + dither;
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = (*src * (32766.0f)) + dither;
 
 #ifdef PA_USE_C99_LRINTF
-        *dest = lrintf(dithered-0.5f);
+            *dest = lrintf(dithered-0.5f);
 #else
-        *dest = (PaInt16) dithered;
+            *dest = (PaInt16) dithered;
 #endif
 
-        src += sourceStride;
-        dest += destinationStride;
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void Float32_To_Int16_Clip(
+static PA_CONVERTER_KERNEL_ void Float32_To_Int16_Clip(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -1086,6 +1455,8 @@ static void Float32_To_Int16_Clip(
     }
 }
 
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Int16_Clip )
+
 /* -------------------------------------------------------------------------- */
 
 static void Float32_To_Int16_DitherClip(
@@ -1121,22 +1492,30 @@ static void Float32_To_Int16_DitherClip(
     }
 #endif
 
-    while( count-- )
+    while( count > 0 )
     {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
 
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = (*src * (32766.0f)) + dither;
-        PaInt32 samp = (PaInt32) dithered;
-        PA_CLIP_( samp, -0x8000, 0x7FFF );
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = (*src * (32766.0f)) + dither;
+            PaInt32 samp = (PaInt32) dithered;
+            PA_CLIP_( samp, -0x8000, 0x7FFF );
 #ifdef PA_USE_C99_LRINTF
-        *dest = lrintf(samp-0.5f);
+            *dest = lrintf(samp-0.5f);
 #else
-        *dest = (PaInt16) samp;
+            *dest = (PaInt16) samp;
 #endif
 
-        src += sourceStride;
-        dest += destinationStride;
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
@@ -1171,16 +1550,24 @@ static void Float32_To_Int8_Dither(
     float *src = (float*)sourceBuffer;
     signed char *dest =  (signed char*)destinationBuffer;
     
-    while( count-- )
+    while( count > 0 )
     {
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = (*src * (126.0f)) + dither;
-        PaInt32 samp = (PaInt32) dithered;
-        *dest = (signed char) samp;
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
 
-        src += sourceStride;
-        dest += destinationStride;
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = (*src * (126.0f)) + dither;
+            PaInt32 samp = (PaInt32) dithered;
+            *dest = (signed char) samp;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
@@ -1217,17 +1604,25 @@ static void Float32_To_Int8_DitherClip(
     signed char *dest =  (signed char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
-    while( count-- )
+    while( count > 0 )
     {
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = (*src * (126.0f)) + dither;
-        PaInt32 samp = (PaInt32) dithered;
-        PA_CLIP_( samp, -0x80, 0x7F );
-        *dest = (signed char) samp;
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
 
-        src += sourceStride;
-        dest += destinationStride;
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = (*src * (126.0f)) + dither;
+            PaInt32 samp = (PaInt32) dithered;
+            PA_CLIP_( samp, -0x80, 0x7F );
+            *dest = (signed char) samp;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
@@ -1262,16 +1657,24 @@ static void Float32_To_UInt8_Dither(
     float *src = (float*)sourceBuffer;
     unsigned char *dest =  (unsigned char*)destinationBuffer;
     
-    while( count-- )
+    while( count > 0 )
     {
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = (*src * (126.0f)) + dither;
-        PaInt32 samp = (PaInt32) dithered;
-        *dest = (unsigned char) (128 + samp);
-        
-        src += sourceStride;
-        dest += destinationStride;
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = (*src * (126.0f)) + dither;
+            PaInt32 samp = (PaInt32) dithered;
+            *dest = (unsigned char) (128 + samp);
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
@@ -1308,23 +1711,31 @@ static void Float32_To_UInt8_DitherClip(
     unsigned char *dest =  (unsigned char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
-    while( count-- )
+    while( count > 0 )
     {
-        float dither  = PaUtil_GenerateFloatTriangularDither( ditherGenerator );
-        /* use smaller scaler to prevent overflow when we add the dither */
-        float dithered = (*src * (126.0f)) + dither;
-        PaInt32 samp = 128 + (PaInt32) dithered;
-        PA_CLIP_( samp, 0x0000, 0x00FF );
-        *dest = (unsigned char) samp;
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
 
-        src += sourceStride;
-        dest += destinationStride;
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            float dither  = dithers[i];
+            /* use smaller scaler to prevent overflow when we add the dither */
+            float dithered = (*src * (126.0f)) + dither;
+            PaInt32 samp = 128 + (PaInt32) dithered;
+            PA_CLIP_( samp, 0x0000, 0x00FF );
+            *dest = (unsigned char) samp;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
     }
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void Int32_To_Float32(
+static PA_CONVERTER_KERNEL_ void Int32_To_Float32(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -1333,6 +1744,22 @@ static void Int32_To_Float32(
     float *dest =  (float*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        float32x4_t neonMult = vdupq_n_f32((float)const_1_div_2147483648_);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32(&src, sourceStride);
+            /* convert + scale - 1/2^31 is exact so this matches the scalar double path */
+            dest = NeonWriteDestVectorFloat32(
+                vmulq_f32(vcvtq_f32_s32(neonSourceVector), neonMult), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         *dest = (float) ((double)*src * const_1_div_2147483648_);
@@ -1342,6 +1769,8 @@ static void Int32_To_Float32(
     }
 }
 
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Int32_To_Float32 )
+
 /* -------------------------------------------------------------------------- */
 
 static void Int32_To_Int24(
@@ -1353,6 +1782,19 @@ static void Int32_To_Int24(
     unsigned char *dest = (unsigned char*)destinationBuffer;
     (void) ditherGenerator; /* unused parameter */
     
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32((PaInt32**)&src, sourceStride);
+            dest = NeonWriteDestVectorInt24(neonSourceVector, dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
 	while( count-- )
     {
 		/* REVIEW */
@@ -1397,6 +1839,19 @@ static void Int32_To_Int16(
     PaInt16 *dest =  (PaInt16*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32(&src, sourceStride);
+            dest = NeonWriteDestVectorInt16(vshrn_n_s32(neonSourceVector, 16), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         *dest = (PaInt16) ((*src) >> 16);
@@ -1417,6 +1872,23 @@ static void Int32_To_Int16_Dither(
     PaInt16 *dest =  (PaInt16*)destinationBuffer;
     PaInt32 dither;
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector, neonDither, neonResultVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32(&src, sourceStride);
+            neonDither = PaUtil_Generate16BitTriangularDitherVector(ditherGenerator);
+            /* ((src>>1) + dither) >> 15 */
+            neonResultVector = vshrq_n_s32(
+                vaddq_s32(vshrq_n_s32(neonSourceVector, 1), neonDither), 15);
+            dest = NeonWriteDestVectorInt16(vmovn_s32(neonResultVector), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         /* REVIEW */
@@ -1439,6 +1911,21 @@ static void Int32_To_Int8(
     signed char *dest =  (signed char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32(&src, sourceStride);
+            dest = (signed char*)NeonWriteDestVector8(
+                vreinterpret_u8_s8(NeonNarrowInt32ToInt8(vshrq_n_s32(neonSourceVector, 24))),
+                (unsigned char*)dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         *dest = (signed char) ((*src) >> 24);
@@ -1459,6 +1946,25 @@ static void Int32_To_Int8_Dither(
     signed char *dest =  (signed char*)destinationBuffer;
     PaInt32 dither;
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector, neonDither, neonResultVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32(&src, sourceStride);
+            neonDither = PaUtil_Generate16BitTriangularDitherVector(ditherGenerator);
+            /* ((src>>1) + dither) >> 23 */
+            neonResultVector = vshrq_n_s32(
+                vaddq_s32(vshrq_n_s32(neonSourceVector, 1), neonDither), 23);
+            dest = (signed char*)NeonWriteDestVector8(
+                vreinterpret_u8_s8(NeonNarrowInt32ToInt8(neonResultVector)),
+                (unsigned char*)dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         /* REVIEW */
@@ -1481,6 +1987,23 @@ static void Int32_To_UInt8(
     unsigned char *dest =  (unsigned char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt32(&src, sourceStride);
+            /* +128 <-> flip sign bit */
+            dest = NeonWriteDestVector8(
+                veor_u8(vreinterpret_u8_s8(NeonNarrowInt32ToInt8(vshrq_n_s32(neonSourceVector, 24))), neonOffset),
+                dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 		(*dest) = (unsigned char)(((*src) >> 24) + 128); 
@@ -1512,7 +2035,7 @@ static void Int32_To_UInt8_Dither(
 
 /* -------------------------------------------------------------------------- */
 
-static void Int24_To_Float32(
+static PA_CONVERTER_KERNEL_ void Int24_To_Float32(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -1523,6 +2046,21 @@ static void Int24_To_Float32(
 
     (void) ditherGenerator; /* unused parameter */
     
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        float32x4_t neonMult = vdupq_n_f32((float)const_1_div_2147483648_);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            dest = NeonWriteDestVectorFloat32(
+                vmulq_f32(vcvtq_f32_s32(neonSourceVector), neonMult), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 
@@ -1543,6 +2081,8 @@ static void Int24_To_Float32(
     }
 }
 
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Int24_To_Float32 )
+
 /* -------------------------------------------------------------------------- */
 
 static void Int24_To_Int32(
@@ -1556,6 +2096,19 @@ static void Int24_To_Int32(
 
     (void) ditherGenerator; /* unused parameter */
     
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            dest = NeonWriteDestVectorInt32(neonSourceVector, dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 
@@ -1590,6 +2143,19 @@ static void Int24_To_Int16(
 
     (void) ditherGenerator; /* unused parameter */
         
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            dest = NeonWriteDestVectorInt16(vshrn_n_s32(neonSourceVector, 16), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 		
@@ -1622,6 +2188,23 @@ static void Int24_To_Int16_Dither(
 
     PaInt32 temp, dither;
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector, neonDither, neonResultVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            neonDither = PaUtil_Generate16BitTriangularDitherVector(ditherGenerator);
+            /* ((src>>1) + dither) >> 15 */
+            neonResultVector = vshrq_n_s32(
+                vaddq_s32(vshrq_n_s32(neonSourceVector, 1), neonDither), 15);
+            dest = NeonWriteDestVectorInt16(vmovn_s32(neonResultVector), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 
@@ -1656,6 +2239,21 @@ static void Int24_To_Int8(
     
     (void) ditherGenerator; /* unused parameter */
         
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            dest = (signed char*)NeonWriteDestVector8(
+                vreinterpret_u8_s8(NeonNarrowInt32ToInt8(vshrq_n_s32(neonSourceVector, 24))),
+                (unsigned char*)dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {	
 	
@@ -1686,6 +2284,25 @@ static void Int24_To_Int8_Dither(
     
     PaInt32 temp, dither;
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector, neonDither, neonResultVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            neonDither = PaUtil_Generate16BitTriangularDitherVector(ditherGenerator);
+            /* ((src>>1) + dither) >> 23 */
+            neonResultVector = vshrq_n_s32(
+                vaddq_s32(vshrq_n_s32(neonSourceVector, 1), neonDither), 23);
+            dest = (signed char*)NeonWriteDestVector8(
+                vreinterpret_u8_s8(NeonNarrowInt32ToInt8(neonResultVector)),
+                (unsigned char*)dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 
@@ -1720,6 +2337,23 @@ static void Int24_To_UInt8(
     
     (void) ditherGenerator; /* unused parameter */
         
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int32x4_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt24(&src, sourceStride);
+            /* +128 <-> flip sign bit */
+            dest = NeonWriteDestVector8(
+                veor_u8(vreinterpret_u8_s8(NeonNarrowInt32ToInt8(vshrq_n_s32(neonSourceVector, 24))), neonOffset),
+                dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 		
@@ -1756,7 +2390,7 @@ static void Int24_To_UInt8_Dither(
 
 /* -------------------------------------------------------------------------- */
 
-static void Int16_To_Float32(
+static PA_CONVERTER_KERNEL_ void Int16_To_Float32(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
@@ -1765,6 +2399,21 @@ static void Int16_To_Float32(
     float *dest =  (float*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int16x4_t neonSourceVector;
+        float32x4_t neonMult = vdupq_n_f32(const_1_div_32768_);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt16(&src, sourceStride);
+            dest = NeonWriteDestVectorFloat32(
+                vmulq_f32(vcvtq_f32_s32(vmovl_s16(neonSourceVector)), neonMult), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         float samp = *src * const_1_div_32768_; /* FIXME: i'm concerned about this being asymetrical with float->int16 -rb */
@@ -1775,6 +2424,8 @@ static void Int16_To_Float32(
     }
 }
 
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Int16_To_Float32 )
+
 /* -------------------------------------------------------------------------- */
 
 static void Int16_To_Int32(
@@ -1786,6 +2437,19 @@ static void Int16_To_Int32(
     PaInt32 *dest =  (PaInt32*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int16x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt16(&src, sourceStride);
+            dest = NeonWriteDestVectorInt32(vshll_n_s16(neonSourceVector, 16), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         /* REVIEW: we should consider something like
@@ -1812,6 +2476,19 @@ static void Int16_To_Int24(
 
     (void) ditherGenerator; /* unused parameter */
     
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int16x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt16((PaInt16**)&src, sourceStride);
+            dest = NeonWriteDestVectorInt24(vshll_n_s16(neonSourceVector, 16), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         temp = *src;
@@ -1842,6 +2519,21 @@ static void Int16_To_Int8(
     signed char *dest =  (signed char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int16x4_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt16(&src, sourceStride);
+            dest = (signed char*)NeonWriteDestVector8(
+                vreinterpret_u8_s8(vshrn_n_s16(vcombine_s16(neonSourceVector, neonSourceVector), 8)),
+                (unsigned char*)dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         (*dest) = (signed char)((*src) >> 8);
@@ -1882,6 +2574,23 @@ static void Int16_To_UInt8(
     unsigned char *dest =  (unsigned char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int16x4_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = NeonGetSourceVectorInt16(&src, sourceStride);
+            /* +128 <-> flip sign bit */
+            dest = NeonWriteDestVector8(
+                veor_u8(vreinterpret_u8_s8(vshrn_n_s16(vcombine_s16(neonSourceVector, neonSourceVector), 8)), neonOffset),
+                dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 		(*dest) = (unsigned char)(((*src) >> 8) + 128); 
@@ -1922,6 +2631,22 @@ static void Int8_To_Float32(
     float *dest =  (float*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        float32x4_t neonMult = vdupq_n_f32(const_1_div_128_);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = vreinterpret_s8_u8(
+                NeonGetSourceVector8((unsigned char**)&src, sourceStride));
+            dest = NeonWriteDestVectorFloat32(
+                vmulq_f32(vcvtq_f32_s32(NeonWidenInt8ToInt32(neonSourceVector)), neonMult), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         float samp = *src * const_1_div_128_;
@@ -1943,6 +2668,21 @@ static void Int8_To_Int32(
     PaInt32 *dest =  (PaInt32*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = vreinterpret_s8_u8(
+                NeonGetSourceVector8((unsigned char**)&src, sourceStride));
+            dest = NeonWriteDestVectorInt32(
+                vshlq_n_s32(NeonWidenInt8ToInt32(neonSourceVector), 24), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 		(*dest) = (*src) << 24;
@@ -1963,6 +2703,21 @@ static void Int8_To_Int24(
     unsigned char *dest =  (unsigned char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = vreinterpret_s8_u8(
+                NeonGetSourceVector8((unsigned char**)&src, sourceStride));
+            dest = NeonWriteDestVectorInt24(
+                vshlq_n_s32(NeonWidenInt8ToInt32(neonSourceVector), 24), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 
@@ -1992,6 +2747,21 @@ static void Int8_To_Int16(
     PaInt16 *dest =  (PaInt16*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            neonSourceVector = vreinterpret_s8_u8(
+                NeonGetSourceVector8((unsigned char**)&src, sourceStride));
+            dest = NeonWriteDestVectorInt16(
+                vshl_n_s16(vget_low_s16(vmovl_s8(neonSourceVector)), 8), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         (*dest) = (PaInt16)((*src) << 8);
@@ -2012,6 +2782,21 @@ static void Int8_To_UInt8(
     unsigned char *dest =  (unsigned char*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            /* +128 <-> flip sign bit */
+            dest = NeonWriteDestVector8(
+                veor_u8(NeonGetSourceVector8((unsigned char**)&src, sourceStride), neonOffset),
+                dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         (*dest) = (unsigned char)(*src + 128);
@@ -2032,6 +2817,24 @@ static void UInt8_To_Float32(
     float *dest =  (float*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        float32x4_t neonMult = vdupq_n_f32(const_1_div_128_);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            /* -128 <-> flip sign bit */
+            neonSourceVector = vreinterpret_s8_u8(
+                veor_u8(NeonGetSourceVector8(&src, sourceStride), neonOffset));
+            dest = NeonWriteDestVectorFloat32(
+                vmulq_f32(vcvtq_f32_s32(NeonWidenInt8ToInt32(neonSourceVector)), neonMult), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
         float samp = (*src - 128) * const_1_div_128_;
@@ -2053,6 +2856,23 @@ static void UInt8_To_Int32(
     PaInt32 *dest = (PaInt32*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            /* -128 <-> flip sign bit */
+            neonSourceVector = vreinterpret_s8_u8(
+                veor_u8(NeonGetSourceVector8(&src, sourceStride), neonOffset));
+            dest = NeonWriteDestVectorInt32(
+                vshlq_n_s32(NeonWidenInt8ToInt32(neonSourceVector), 24), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
     while( count-- )
     {
 		(*dest) = (*src - 128) << 24;
@@ -2073,58 +2893,1411 @@ static void UInt8_To_Int24(
     unsigned char *dest = (unsigned char*)destinationBuffer;
     (void) ditherGenerator; /* unused parameters */
     
-	while( count-- )
-    {
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            /* -128 <-> flip sign bit */
+            neonSourceVector = vreinterpret_s8_u8(
+                veor_u8(NeonGetSourceVector8(&src, sourceStride), neonOffset));
+            dest = NeonWriteDestVectorInt24(
+                vshlq_n_s32(NeonWidenInt8ToInt32(neonSourceVector), 24), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
+	while( count-- )
+    {
+
+#if defined(PA_LITTLE_ENDIAN)
+        dest[0] = 0;
+        dest[1] = 0;
+        dest[2] = (unsigned char)(*src - 128);
+#elif defined(PA_BIG_ENDIAN)
+        dest[0] = (unsigned char)(*src - 128);
+        dest[1] = 0;
+        dest[2] = 0;
+#endif
+		
+        src += sourceStride;
+        dest += destinationStride * 3;    
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void UInt8_To_Int16(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    PaInt16 *dest =  (PaInt16*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        int8x8_t neonSourceVector;
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            /* -128 <-> flip sign bit */
+            neonSourceVector = vreinterpret_s8_u8(
+                veor_u8(NeonGetSourceVector8(&src, sourceStride), neonOffset));
+            dest = NeonWriteDestVectorInt16(
+                vshl_n_s16(vget_low_s16(vmovl_s8(neonSourceVector)), 8), dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
+    while( count-- )
+    {
+        (*dest) = (PaInt16)((*src - 128) << 8);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void UInt8_To_Int8(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    signed char  *dest = (signed char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+#ifdef __ARM_NEON__
+    if(withAcceleration)
+    {
+        uint8x8_t neonOffset = vdup_n_u8(0x80);
+        while(count >= ARM_NEON_BEST_VECTOR_SIZE)
+        {
+            /* -128 <-> flip sign bit */
+            dest = (signed char*)NeonWriteDestVector8(
+                veor_u8(NeonGetSourceVector8(&src, sourceStride), neonOffset),
+                (unsigned char*)dest, destinationStride);
+            count -= ARM_NEON_BEST_VECTOR_SIZE;
+        }
+    }
+#endif
+
+    while( count-- )
+    {
+        (*dest) = (signed char)(*src - 128);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* paInt24In32 samples are native PaInt32 holding a 24 bit value in their low
+   3 bytes. The upper byte is written sign extended and ignored when read, so
+   the converters work on the value shifted into the Int32 range. */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        /* convert to 32 bit and drop the low 8 bits */
+        double scaled = (double)(*src) * 2147483647.0;
+        *dest = ((PaInt32) scaled) >> 8;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Int24In32 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int24In32_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = ((double)*src * (2147483646.0)) + dithers[i];
+            *dest = ((PaInt32) dithered) >> 8;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int24In32_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 0x7FFFFFFF;
+        PA_CLIP_( scaled, -2147483648., 2147483647.  );
+        *dest = ((PaInt32) scaled) >> 8;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Int24In32_Clip )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int24In32_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = ((double)*src * (2147483646.0)) + dithers[i];
+            PA_CLIP_( dithered, -2147483648., 2147483647.  );
+            *dest = ((PaInt32) dithered) >> 8;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int32_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = *src >> 8;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int32_To_Int24In32_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    PaInt32 dither;
+
+    while( count-- )
+    {
+        /* the 16 bit dither scaled down to the 24 bit LSB, as Int32_To_Int16_Dither adds it */
+        dither = PaUtil_Generate16BitTriangularDither( ditherGenerator );
+        *dest = (((*src) >> 1) + (dither >> 8)) >> 7;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    PaInt32 temp;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+#if defined(PA_LITTLE_ENDIAN)
+        temp = (((PaInt32)src[0]) << 8);
+        temp = temp | (((PaInt32)src[1]) << 16);
+        temp = temp | (((PaInt32)src[2]) << 24);
+#elif defined(PA_BIG_ENDIAN)
+        temp = (((PaInt32)src[0]) << 24);
+        temp = temp | (((PaInt32)src[1]) << 16);
+        temp = temp | (((PaInt32)src[2]) << 8);
+#endif
+        *dest = temp >> 8;
+
+        src += sourceStride * 3;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int16_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (PaInt32)(*src) * 256;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int8_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    signed char *src = (signed char*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (PaInt32)(*src) * 65536;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void UInt8_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = ((PaInt32)(*src) - 128) * 65536;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int24In32_To_Float32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (float) ((double)(PaInt32)(*src << 8) * const_1_div_2147483648_);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Int24In32_To_Float32 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Int32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (PaInt32)(*src << 8);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Int24(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+#if defined(PA_LITTLE_ENDIAN)
+        dest[0] = (unsigned char)(*src);
+        dest[1] = (unsigned char)(*src >> 8);
+        dest[2] = (unsigned char)(*src >> 16);
+#elif defined(PA_BIG_ENDIAN)
+        dest[0] = (unsigned char)(*src >> 16);
+        dest[1] = (unsigned char)(*src >> 8);
+        dest[2] = (unsigned char)(*src);
+#endif
+        src += sourceStride;
+        dest += destinationStride * 3;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Int16(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (PaInt16)((PaInt32)(*src << 8) >> 16);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Int16_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+    PaInt32 dither;
+
+    while( count-- )
+    {
+        dither = PaUtil_Generate16BitTriangularDither( ditherGenerator );
+        *dest = (PaInt16) ((((PaInt32)(*src << 8) >> 1) + dither) >> 15);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Int8(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    signed char *dest = (signed char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (signed char)((PaInt32)(*src << 8) >> 24);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Int8_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    signed char *dest = (signed char*)destinationBuffer;
+    PaInt32 dither;
+
+    while( count-- )
+    {
+        dither = PaUtil_Generate16BitTriangularDither( ditherGenerator );
+        *dest = (signed char) ((((PaInt32)(*src << 8) >> 1) + dither) >> 23);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_UInt8(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (unsigned char)(((PaInt32)(*src << 8) >> 24) + 128);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_UInt8_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    PaInt32 dither;
+
+    while( count-- )
+    {
+        dither = PaUtil_Generate16BitTriangularDither( ditherGenerator );
+        *dest = (unsigned char) (((((PaInt32)(*src << 8) >> 1) + dither) >> 23) + 128);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* paFloat64 conversions mirror the Float32 ones, but scale and clip in
+   double precision throughout. */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Float32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (float) *src;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float64_To_Float32 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 2147483647.0;
+        *dest = (PaInt32) scaled;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float64_To_Int32 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int32_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = (*src * 2147483646.0) + dithers[i];
+            *dest = (PaInt32) dithered;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int32_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 2147483647.0;
+        PA_CLIP_( scaled, -2147483648., 2147483647. );
+        *dest = (PaInt32) scaled;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float64_To_Int32_Clip )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int32_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = (*src * 2147483646.0) + dithers[i];
+            PA_CLIP_( dithered, -2147483648., 2147483647. );
+            *dest = (PaInt32) dithered;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    PaInt32 temp;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 2147483647.0;
+        temp = (PaInt32) scaled;
+
+#if defined(PA_LITTLE_ENDIAN)
+        dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
+        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+        dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
+#elif defined(PA_BIG_ENDIAN)
+        dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
+        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+        dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
+#endif
+
+        src += sourceStride;
+        dest += destinationStride * 3;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    PaInt32 temp;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = (*src * 2147483646.0) + dithers[i];
+            temp = (PaInt32) dithered;
+
+#if defined(PA_LITTLE_ENDIAN)
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
+#elif defined(PA_BIG_ENDIAN)
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
+#endif
+
+            src += sourceStride;
+            dest += destinationStride * 3;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    PaInt32 temp;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 2147483647.0;
+        PA_CLIP_( scaled, -2147483648., 2147483647. );
+        temp = (PaInt32) scaled;
+
+#if defined(PA_LITTLE_ENDIAN)
+        dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
+        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+        dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
+#elif defined(PA_BIG_ENDIAN)
+        dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
+        dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+        dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
+#endif
+
+        src += sourceStride;
+        dest += destinationStride * 3;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    PaInt32 temp;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = (*src * 2147483646.0) + dithers[i];
+            PA_CLIP_( dithered, -2147483648., 2147483647. );
+            temp = (PaInt32) dithered;
+
+#if defined(PA_LITTLE_ENDIAN)
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 8);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 24);
+#elif defined(PA_BIG_ENDIAN)
+            dest[0] = (unsigned char)(((PaUint32)temp) >> 24);
+            dest[1] = (unsigned char)(((PaUint32)temp) >> 16);
+            dest[2] = (unsigned char)(((PaUint32)temp) >> 8);
+#endif
+
+            src += sourceStride;
+            dest += destinationStride * 3;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24In32(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 2147483647.0;
+        *dest = ((PaInt32) scaled) >> 8;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24In32_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = (*src * 2147483646.0) + dithers[i];
+            *dest = ((PaInt32) dithered) >> 8;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24In32_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 2147483647.0;
+        PA_CLIP_( scaled, -2147483648., 2147483647. );
+        *dest = ((PaInt32) scaled) >> 8;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int24In32_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = (*src * 2147483646.0) + dithers[i];
+            PA_CLIP_( dithered, -2147483648., 2147483647. );
+            *dest = ((PaInt32) dithered) >> 8;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int16(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 32767.0;
+        *dest = (PaInt16) scaled;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float64_To_Int16 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int16_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = (*src * 32766.0) + dithers[i];
+            *dest = (PaInt16) dithered;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int16_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 32767.0;
+        PA_CLIP_( scaled, -32768., 32767. );
+        *dest = (PaInt16) scaled;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( PORTABLE, Float64_To_Int16_Clip )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int16_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = (*src * 32766.0) + dithers[i];
+            PA_CLIP_( dithered, -32768., 32767. );
+            *dest = (PaInt16) dithered;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int8(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    signed char *dest = (signed char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 127.0;
+        *dest = (signed char) scaled;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int8_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    signed char *dest = (signed char*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = (*src * 126.0) + dithers[i];
+            *dest = (signed char) dithered;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int8_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    signed char *dest = (signed char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 127.0;
+        PA_CLIP_( scaled, -128., 127. );
+        *dest = (signed char) scaled;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_Int8_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    signed char *dest = (signed char*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = (*src * 126.0) + dithers[i];
+            PA_CLIP_( dithered, -128., 127. );
+            *dest = (signed char) dithered;
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_UInt8(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 127.0;
+        *dest = (unsigned char) (128 + (PaInt32) scaled);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_UInt8_Dither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to prevent overflow when we add the dither */
+            double dithered = (*src * 126.0) + dithers[i];
+            *dest = (unsigned char) (128 + (PaInt32) dithered);
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_UInt8_Clip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        double scaled = *src * 127.0;
+        PA_CLIP_( scaled, -128., 127. );
+        *dest = (unsigned char) (128 + (PaInt32) scaled);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Float64_To_UInt8_DitherClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            double dithered = (*src * 126.0) + dithers[i];
+            PA_CLIP_( dithered, -128., 127. );
+            *dest = (unsigned char) (128 + (PaInt32) dithered);
+
+            src += sourceStride;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Float64(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = *src;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Float32_To_Float64 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int32_To_Float64(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (double)*src * const_1_div_2147483648_;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Int32_To_Float64 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24_To_Float64(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+    PaInt32 temp;
+    (void)ditherGenerator; /* unused parameter */
 
+    while( count-- )
+    {
 #if defined(PA_LITTLE_ENDIAN)
-        dest[0] = 0;
-        dest[1] = 0;
-        dest[2] = (unsigned char)(*src - 128);
+        temp = (((PaInt32)src[0]) << 8);
+        temp = temp | (((PaInt32)src[1]) << 16);
+        temp = temp | (((PaInt32)src[2]) << 24);
 #elif defined(PA_BIG_ENDIAN)
-        dest[0] = (unsigned char)(*src - 128);
-        dest[1] = 0;
-        dest[2] = 0;
+        temp = (((PaInt32)src[0]) << 24);
+        temp = temp | (((PaInt32)src[1]) << 16);
+        temp = temp | (((PaInt32)src[2]) << 8);
 #endif
-		
+
+        *dest = (double)temp * const_1_div_2147483648_;
+
+        src += sourceStride * 3;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Int24In32_To_Float64(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUint32 *src = (PaUint32*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = (double)(PaInt32)(*src << 8) * const_1_div_2147483648_;
+
         src += sourceStride;
-        dest += destinationStride * 3;    
-	}
+        dest += destinationStride;
+    }
 }
 
 /* -------------------------------------------------------------------------- */
 
-static void UInt8_To_Int16(
+static PA_CONVERTER_KERNEL_ void Int16_To_Float64(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
 {
-    unsigned char *src = (unsigned char*)sourceBuffer;
-    PaInt16 *dest =  (PaInt16*)destinationBuffer;
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
     while( count-- )
     {
-        (*dest) = (PaInt16)((*src - 128) << 8);
+        *dest = *src * (1.0 / 32768.0);
 
         src += sourceStride;
         dest += destinationStride;
     }
 }
 
+PA_INPUT_STRIDE_CONVERTERS_( PORTABLE, Int16_To_Float64 )
+
 /* -------------------------------------------------------------------------- */
 
-static void UInt8_To_Int8(
+static void Int8_To_Float64(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    signed char *src = (signed char*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        *dest = *src * (1.0 / 128.0);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void UInt8_To_Float64(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
 {
     unsigned char *src = (unsigned char*)sourceBuffer;
-    signed char  *dest = (signed char*)destinationBuffer;
+    double *dest = (double*)destinationBuffer;
     (void)ditherGenerator; /* unused parameter */
 
     while( count-- )
     {
-        (*dest) = (signed char)(*src - 128);
+        *dest = (*src - 128) * (1.0 / 128.0);
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* paSoftClip: Float32_To_Float32_SoftClip shapes the samples, which the
+   other soft clipping converters then pass on to the hard clipping ones in
+   blocks. The hard clip only catches rounding beyond full scale. */
+
+static const float const_soft_clip_knee_ = 1.5f;
+static const float const_soft_clip_cubic_ = 4.0f / 27.0f;
+
+static void Float32_To_Float32_SoftClip(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+    (void)ditherGenerator; /* unused parameter */
+
+    while( count-- )
+    {
+        /* x - 4/27 x^3 has unity gain at 0 and reaches 1 with a slope of 0 at 1.5 */
+        float x = *src;
+        PA_CLIP_( x, -const_soft_clip_knee_, const_soft_clip_knee_ );
+        *dest = x - const_soft_clip_cubic_ * x * x * x;
 
         src += sourceStride;
         dest += destinationStride;
@@ -2133,6 +4306,44 @@ static void UInt8_To_Int8(
 
 /* -------------------------------------------------------------------------- */
 
+#define PA_SOFT_CLIP_CONVERTER_( name, clipConverter, bytesPerSample )         \
+static void name(                                                              \
+    void *destinationBuffer, signed int destinationStride,                     \
+    void *sourceBuffer, signed int sourceStride,                               \
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator ) \
+{                                                                              \
+    float *src = (float*)sourceBuffer;                                         \
+    unsigned char *dest = (unsigned char*)destinationBuffer;                   \
+                                                                               \
+    while( count > 0 )                                                         \
+    {                                                                          \
+        float shaped[PA_DITHER_BLOCK_SIZE];                                    \
+        unsigned int n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE; \
+                                                                               \
+        paConverters.Float32_To_Float32_SoftClip( shaped, 1, src, sourceStride, n, 0 ); \
+        paConverters. clipConverter( dest, destinationStride, shaped, 1, n, ditherGenerator ); \
+                                                                               \
+        src += sourceStride * (signed int)n;                                   \
+        dest += destinationStride * (signed int)n * bytesPerSample;            \
+        count -= n;                                                            \
+    }                                                                          \
+}
+
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int32_SoftClip, Float32_To_Int32_Clip, 4 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int32_DitherSoftClip, Float32_To_Int32_DitherClip, 4 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int24_SoftClip, Float32_To_Int24_Clip, 3 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int24_DitherSoftClip, Float32_To_Int24_DitherClip, 3 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int24In32_SoftClip, Float32_To_Int24In32_Clip, 4 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int24In32_DitherSoftClip, Float32_To_Int24In32_DitherClip, 4 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int16_SoftClip, Float32_To_Int16_Clip, 2 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int16_DitherSoftClip, Float32_To_Int16_DitherClip, 2 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int8_SoftClip, Float32_To_Int8_Clip, 1 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_Int8_DitherSoftClip, Float32_To_Int8_DitherClip, 1 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_UInt8_SoftClip, Float32_To_UInt8_Clip, 1 )
+PA_SOFT_CLIP_CONVERTER_( Float32_To_UInt8_DitherSoftClip, Float32_To_UInt8_DitherClip, 1 )
+
+/* -------------------------------------------------------------------------- */
+
 static void Copy_8_To_8(
     void *destinationBuffer, signed int destinationStride,
     void *sourceBuffer, signed int sourceStride,
@@ -2203,11 +4414,32 @@ static void Copy_32_To_32(
     void *sourceBuffer, signed int sourceStride,
     unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
 {
-    PaUint32 *dest = (PaUint32 *)destinationBuffer;
-    PaUint32 *src = (PaUint32 *)sourceBuffer;
+    PaUint32 *dest = (PaUint32 *)destinationBuffer;
+    PaUint32 *src = (PaUint32 *)sourceBuffer;
+
+    (void) ditherGenerator; /* unused parameter */
+    
+    while( count-- )
+    {
+        *dest = *src;
+
+        src += sourceStride;
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void Copy_64_To_64(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *dest = (double *)destinationBuffer;
+    double *src = (double *)sourceBuffer;
 
     (void) ditherGenerator; /* unused parameter */
-    
+
     while( count-- )
     {
         *dest = *src;
@@ -2220,9 +4452,9 @@ static void Copy_32_To_32(
 /* -------------------------------------------------------------------------- */
 
 PaUtilConverterTable paConverters = {
-    Float32_To_Int32,              /* PaUtilConverter *Float32_To_Int32; */
+    Float32_To_Int32_Generic,      /* PaUtilConverter *Float32_To_Int32; */
     Float32_To_Int32_Dither,       /* PaUtilConverter *Float32_To_Int32_Dither; */
-    Float32_To_Int32_Clip,         /* PaUtilConverter *Float32_To_Int32_Clip; */
+    Float32_To_Int32_Clip_Generic, /* PaUtilConverter *Float32_To_Int32_Clip; */
     Float32_To_Int32_DitherClip,   /* PaUtilConverter *Float32_To_Int32_DitherClip; */
 
     Float32_To_Int24,              /* PaUtilConverter *Float32_To_Int24; */
@@ -2230,9 +4462,9 @@ PaUtilConverterTable paConverters = {
     Float32_To_Int24_Clip,         /* PaUtilConverter *Float32_To_Int24_Clip; */
     Float32_To_Int24_DitherClip,   /* PaUtilConverter *Float32_To_Int24_DitherClip; */
     
-    Float32_To_Int16,              /* PaUtilConverter *Float32_To_Int16; */
+    Float32_To_Int16_Generic,      /* PaUtilConverter *Float32_To_Int16; */
     Float32_To_Int16_Dither,       /* PaUtilConverter *Float32_To_Int16_Dither; */
-    Float32_To_Int16_Clip,         /* PaUtilConverter *Float32_To_Int16_Clip; */
+    Float32_To_Int16_Clip_Generic, /* PaUtilConverter *Float32_To_Int16_Clip; */
     Float32_To_Int16_DitherClip,   /* PaUtilConverter *Float32_To_Int16_DitherClip; */
 
     Float32_To_Int8,               /* PaUtilConverter *Float32_To_Int8; */
@@ -2245,7 +4477,7 @@ PaUtilConverterTable paConverters = {
     Float32_To_UInt8_Clip,         /* PaUtilConverter *Float32_To_UInt8_Clip; */
     Float32_To_UInt8_DitherClip,   /* PaUtilConverter *Float32_To_UInt8_DitherClip; */
 
-    Int32_To_Float32,              /* PaUtilConverter *Int32_To_Float32; */
+    Int32_To_Float32_Generic,      /* PaUtilConverter *Int32_To_Float32; */
     Int32_To_Int24,                /* PaUtilConverter *Int32_To_Int24; */
     Int32_To_Int24_Dither,         /* PaUtilConverter *Int32_To_Int24_Dither; */
     Int32_To_Int16,                /* PaUtilConverter *Int32_To_Int16; */
@@ -2255,7 +4487,7 @@ PaUtilConverterTable paConverters = {
     Int32_To_UInt8,                /* PaUtilConverter *Int32_To_UInt8; */
     Int32_To_UInt8_Dither,         /* PaUtilConverter *Int32_To_UInt8_Dither; */
 
-    Int24_To_Float32,              /* PaUtilConverter *Int24_To_Float32; */
+    Int24_To_Float32_Generic,      /* PaUtilConverter *Int24_To_Float32; */
     Int24_To_Int32,                /* PaUtilConverter *Int24_To_Int32; */
     Int24_To_Int16,                /* PaUtilConverter *Int24_To_Int16; */
     Int24_To_Int16_Dither,         /* PaUtilConverter *Int24_To_Int16_Dither; */
@@ -2264,7 +4496,7 @@ PaUtilConverterTable paConverters = {
     Int24_To_UInt8,                /* PaUtilConverter *Int24_To_UInt8; */
     Int24_To_UInt8_Dither,         /* PaUtilConverter *Int24_To_UInt8_Dither; */
 
-    Int16_To_Float32,              /* PaUtilConverter *Int16_To_Float32; */
+    Int16_To_Float32_Generic,      /* PaUtilConverter *Int16_To_Float32; */
     Int16_To_Int32,                /* PaUtilConverter *Int16_To_Int32; */
     Int16_To_Int24,                /* PaUtilConverter *Int16_To_Int24; */
     Int16_To_Int8,                 /* PaUtilConverter *Int16_To_Int8; */
@@ -2284,10 +4516,110 @@ PaUtilConverterTable paConverters = {
     UInt8_To_Int16,                /* PaUtilConverter *UInt8_To_Int16; */
     UInt8_To_Int8,                 /* PaUtilConverter *UInt8_To_Int8; */
 
+    Float32_To_Int24In32_Generic,  /* PaUtilConverter *Float32_To_Int24In32; */
+    Float32_To_Int24In32_Dither,   /* PaUtilConverter *Float32_To_Int24In32_Dither; */
+    Float32_To_Int24In32_Clip_Generic,/* PaUtilConverter *Float32_To_Int24In32_Clip; */
+    Float32_To_Int24In32_DitherClip,/* PaUtilConverter *Float32_To_Int24In32_DitherClip; */
+
+    Int32_To_Int24In32,            /* PaUtilConverter *Int32_To_Int24In32; */
+    Int32_To_Int24In32_Dither,     /* PaUtilConverter *Int32_To_Int24In32_Dither; */
+    Int24_To_Int24In32,            /* PaUtilConverter *Int24_To_Int24In32; */
+    Int16_To_Int24In32,            /* PaUtilConverter *Int16_To_Int24In32; */
+    Int8_To_Int24In32,             /* PaUtilConverter *Int8_To_Int24In32; */
+    UInt8_To_Int24In32,            /* PaUtilConverter *UInt8_To_Int24In32; */
+
+    Int24In32_To_Float32_Generic,  /* PaUtilConverter *Int24In32_To_Float32; */
+    Int24In32_To_Int32,            /* PaUtilConverter *Int24In32_To_Int32; */
+    Int24In32_To_Int24,            /* PaUtilConverter *Int24In32_To_Int24; */
+    Int24In32_To_Int16,            /* PaUtilConverter *Int24In32_To_Int16; */
+    Int24In32_To_Int16_Dither,     /* PaUtilConverter *Int24In32_To_Int16_Dither; */
+    Int24In32_To_Int8,             /* PaUtilConverter *Int24In32_To_Int8; */
+    Int24In32_To_Int8_Dither,      /* PaUtilConverter *Int24In32_To_Int8_Dither; */
+    Int24In32_To_UInt8,            /* PaUtilConverter *Int24In32_To_UInt8; */
+    Int24In32_To_UInt8_Dither,     /* PaUtilConverter *Int24In32_To_UInt8_Dither; */
+
+    Float64_To_Float32_Generic,    /* PaUtilConverter *Float64_To_Float32; */
+
+    Float64_To_Int32_Generic,      /* PaUtilConverter *Float64_To_Int32; */
+    Float64_To_Int32_Dither,       /* PaUtilConverter *Float64_To_Int32_Dither; */
+    Float64_To_Int32_Clip_Generic, /* PaUtilConverter *Float64_To_Int32_Clip; */
+    Float64_To_Int32_DitherClip,   /* PaUtilConverter *Float64_To_Int32_DitherClip; */
+
+    Float64_To_Int24,              /* PaUtilConverter *Float64_To_Int24; */
+    Float64_To_Int24_Dither,       /* PaUtilConverter *Float64_To_Int24_Dither; */
+    Float64_To_Int24_Clip,         /* PaUtilConverter *Float64_To_Int24_Clip; */
+    Float64_To_Int24_DitherClip,   /* PaUtilConverter *Float64_To_Int24_DitherClip; */
+
+    Float64_To_Int24In32,          /* PaUtilConverter *Float64_To_Int24In32; */
+    Float64_To_Int24In32_Dither,   /* PaUtilConverter *Float64_To_Int24In32_Dither; */
+    Float64_To_Int24In32_Clip,     /* PaUtilConverter *Float64_To_Int24In32_Clip; */
+    Float64_To_Int24In32_DitherClip,/* PaUtilConverter *Float64_To_Int24In32_DitherClip; */
+
+    Float64_To_Int16_Generic,      /* PaUtilConverter *Float64_To_Int16; */
+    Float64_To_Int16_Dither,       /* PaUtilConverter *Float64_To_Int16_Dither; */
+    Float64_To_Int16_Clip_Generic, /* PaUtilConverter *Float64_To_Int16_Clip; */
+    Float64_To_Int16_DitherClip,   /* PaUtilConverter *Float64_To_Int16_DitherClip; */
+
+    Float64_To_Int8,               /* PaUtilConverter *Float64_To_Int8; */
+    Float64_To_Int8_Dither,        /* PaUtilConverter *Float64_To_Int8_Dither; */
+    Float64_To_Int8_Clip,          /* PaUtilConverter *Float64_To_Int8_Clip; */
+    Float64_To_Int8_DitherClip,    /* PaUtilConverter *Float64_To_Int8_DitherClip; */
+
+    Float64_To_UInt8,              /* PaUtilConverter *Float64_To_UInt8; */
+    Float64_To_UInt8_Dither,       /* PaUtilConverter *Float64_To_UInt8_Dither; */
+    Float64_To_UInt8_Clip,         /* PaUtilConverter *Float64_To_UInt8_Clip; */
+    Float64_To_UInt8_DitherClip,   /* PaUtilConverter *Float64_To_UInt8_DitherClip; */
+
+    Float32_To_Float64_Generic,    /* PaUtilConverter *Float32_To_Float64; */
+    Int32_To_Float64_Generic,      /* PaUtilConverter *Int32_To_Float64; */
+    Int24_To_Float64,              /* PaUtilConverter *Int24_To_Float64; */
+    Int24In32_To_Float64,          /* PaUtilConverter *Int24In32_To_Float64; */
+    Int16_To_Float64_Generic,      /* PaUtilConverter *Int16_To_Float64; */
+    Int8_To_Float64,               /* PaUtilConverter *Int8_To_Float64; */
+    UInt8_To_Float64,              /* PaUtilConverter *UInt8_To_Float64; */
+
+    Float32_To_Float32_SoftClip,   /* PaUtilConverter *Float32_To_Float32_SoftClip; */
+    Float32_To_Int32_SoftClip,     /* PaUtilConverter *Float32_To_Int32_SoftClip; */
+    Float32_To_Int32_DitherSoftClip,/* PaUtilConverter *Float32_To_Int32_DitherSoftClip; */
+    Float32_To_Int24_SoftClip,     /* PaUtilConverter *Float32_To_Int24_SoftClip; */
+    Float32_To_Int24_DitherSoftClip,/* PaUtilConverter *Float32_To_Int24_DitherSoftClip; */
+    Float32_To_Int24In32_SoftClip, /* PaUtilConverter *Float32_To_Int24In32_SoftClip; */
+    Float32_To_Int24In32_DitherSoftClip,/* PaUtilConverter *Float32_To_Int24In32_DitherSoftClip; */
+    Float32_To_Int16_SoftClip,     /* PaUtilConverter *Float32_To_Int16_SoftClip; */
+    Float32_To_Int16_DitherSoftClip,/* PaUtilConverter *Float32_To_Int16_DitherSoftClip; */
+    Float32_To_Int8_SoftClip,      /* PaUtilConverter *Float32_To_Int8_SoftClip; */
+    Float32_To_Int8_DitherSoftClip,/* PaUtilConverter *Float32_To_Int8_DitherSoftClip; */
+    Float32_To_UInt8_SoftClip,     /* PaUtilConverter *Float32_To_UInt8_SoftClip; */
+    Float32_To_UInt8_DitherSoftClip,/* PaUtilConverter *Float32_To_UInt8_DitherSoftClip; */
+
     Copy_8_To_8,                   /* PaUtilConverter *Copy_8_To_8; */
     Copy_16_To_16,                 /* PaUtilConverter *Copy_16_To_16; */
     Copy_24_To_24,                 /* PaUtilConverter *Copy_24_To_24; */
-    Copy_32_To_32                  /* PaUtilConverter *Copy_32_To_32; */
+    Copy_32_To_32,                 /* PaUtilConverter *Copy_32_To_32; */
+    Copy_64_To_64                  /* PaUtilConverter *Copy_64_To_64; */
+};
+
+/* -------------------------------------------------------------------------- */
+
+static const PaUtilStrideConverter *const portableStrideConverters_[] = {
+    Float32_To_Int32_Strides,
+    Float32_To_Int32_Clip_Strides,
+    Float32_To_Int16_Strides,
+    Float32_To_Int16_Clip_Strides,
+    Int32_To_Float32_Strides,
+    Int24_To_Float32_Strides,
+    Int16_To_Float32_Strides,
+    Float32_To_Int24In32_Strides,
+    Float32_To_Int24In32_Clip_Strides,
+    Int24In32_To_Float32_Strides,
+    Float64_To_Float32_Strides,
+    Float64_To_Int32_Strides,
+    Float64_To_Int32_Clip_Strides,
+    Float64_To_Int16_Strides,
+    Float64_To_Int16_Clip_Strides,
+    Float32_To_Float64_Strides,
+    Int32_To_Float64_Strides,
+    Int16_To_Float64_Strides
 };
 
 /* -------------------------------------------------------------------------- */
@@ -2296,6 +4628,598 @@ PaUtilConverterTable paConverters = {
 
 /* -------------------------------------------------------------------------- */
 
+PaUtilConverter* PaUtil_FindStrideConverter( const PaUtilStrideConverter *const *tables,
+        int tableCount, PaUtilConverter *converter,
+        signed int sourceStride, signed int destinationStride )
+{
+    int i, j;
+
+    for( i=0; i < tableCount; ++i )
+    {
+        /* all entries of a table belong to the same converter */
+        if( tables[i][0].converter != converter )
+            continue;
+
+        for( j=0; j < PA_STRIDE_CONVERTER_COUNT_; ++j )
+        {
+            if( tables[i][j].sourceStride == sourceStride
+                    && tables[i][j].destinationStride == destinationStride )
+                return tables[i][j].specialized;
+        }
+        return 0;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PaUtilConverter* SpecializeConverter( PaUtilConverter *converter,
+        signed int sourceStride, signed int destinationStride )
+{
+    PaUtilConverter *specialized =
+            PaUtil_SelectX86StrideConverter( converter, sourceStride, destinationStride );
+
+#ifndef PA_NO_STANDARD_CONVERTERS
+    if( !specialized )
+        specialized = PaUtil_FindStrideConverter( portableStrideConverters_,
+                sizeof(portableStrideConverters_) / sizeof(portableStrideConverters_[0]),
+                converter, sourceStride, destinationStride );
+#endif /* PA_NO_STANDARD_CONVERTERS */
+
+    return specialized ? specialized : converter;
+}
+
+
+PaUtilConverter* PaUtil_SelectConverterForStrides( PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat, PaStreamFlags flags,
+        signed int sourceStride, signed int destinationStride )
+{
+    PaUtilConverter *converter =
+            PaUtil_SelectConverter( sourceFormat, destinationFormat, flags );
+
+    if( !converter )
+        return 0;
+
+    return SpecializeConverter( converter, sourceStride, destinationStride );
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef PA_NO_STANDARD_CONVERTERS
+
+#define PA_TUNING_VERSION_      (2)
+#define PA_TUNING_SAMPLES_      (1024)  /* per call, at strides of 1 and 2 */
+#define PA_TUNING_CALLS_        (16)    /* per run */
+#define PA_TUNING_RUNS_         (5)     /* the fastest run counts */
+#define PA_TUNING_TABLES_       (paUtilX86AVX2Converters + 1)
+
+#define PA_CONVERTER_COUNT_     (sizeof(PaUtilConverterTable) / sizeof(PaUtilConverter*))
+
+/* PaUtilConverterTable only holds converters, so it is treated as an array */
+#define PA_CONVERTER_ENTRIES_( table )  ((PaUtilConverter**) &(table))
+
+/* The nanoseconds per sample of each converter of paConverters, as measured
+   by AutotuneConverterTable(), 0 where it wasn't measured. Used by
+   PaUtil_SelectCheapestAvailableFormat(). */
+static double converterCosts_[PA_CONVERTER_COUNT_];
+
+
+/* Find the file of PA_CONVERTER_TUNING, *path is set to NULL if the result
+   can't be kept. Returns 0 if the converters shouldn't be tuned. */
+static int GetConverterTuningPath( char *buffer, size_t size, const char **path )
+{
+    const char *value = getenv( "PA_CONVERTER_TUNING" );
+    const char *base;
+
+    *path = NULL;
+    if( !value || !*value || !strcmp( value, "0" ) )
+        return 0;
+    if( strcmp( value, "1" ) )
+    {
+        *path = value;
+        return 1;
+    }
+
+#ifdef _WIN32
+    if( (base = getenv( "LOCALAPPDATA" )) && *base )
+        snprintf( buffer, size, "%s\\portaudio\\converters", base );
+    else
+        return 1;
+#else
+    if( (base = getenv( "XDG_CACHE_HOME" )) && *base )
+        snprintf( buffer, size, "%s/portaudio/converters", base );
+    else if( (base = getenv( "HOME" )) && *base )
+        snprintf( buffer, size, "%s/.cache/portaudio/converters", base );
+    else
+        return 1;
+#endif
+    *path = buffer;
+    return 1;
+}
+
+
+/* Read the choices and costs of a tuning file starting with key, 0 if
+   there is none */
+static int ReadConverterTuning( const char *path, const char *key,
+        unsigned char *choices, double *costs, const int *available )
+{
+    char buffer[4096], *end;
+    const char *cost;
+    FILE *file;
+    size_t keyLength = strlen( key ), length, i;
+
+    if( !(file = fopen( path, "r" )) )
+        return 0;
+    length = fread( buffer, 1, sizeof(buffer) - 1, file );
+    fclose( file );
+    buffer[length] = '\0';
+
+    if( length < keyLength + PA_CONVERTER_COUNT_ + 1 || strncmp( buffer, key, keyLength ) )
+        return 0;
+    for( i=0; i < PA_CONVERTER_COUNT_; ++i )
+    {
+        int choice = buffer[keyLength + i] - '0';
+        if( choice < 0 || choice >= PA_TUNING_TABLES_ || !available[choice] )
+            return 0;
+        choices[i] = (unsigned char)choice;
+    }
+    if( buffer[keyLength + i] != '\n' )
+        return 0;
+
+    /* followed by a line of the costs, in nanoseconds per sample */
+    cost = buffer + keyLength + i + 1;
+    for( i=0; i < PA_CONVERTER_COUNT_; ++i )
+    {
+        costs[i] = strtod( cost, &end );
+        if( end == cost || costs[i] < 0. )
+            return 0;
+        cost = end;
+    }
+    return *cost == '\n';
+}
+
+
+static void WriteConverterTuning( const char *path, const char *key, const unsigned char *choices,
+        const double *costs )
+{
+    FILE *file;
+    size_t i;
+
+    if( !(file = fopen( path, "w" )) )
+    {
+        PA_DEBUG(( "PaUtil_InitializeConverterTable: can't write %s\n", path ));
+        return;
+    }
+    fputs( key, file );
+    for( i=0; i < PA_CONVERTER_COUNT_; ++i )
+        fputc( '0' + choices[i], file );
+    fputc( '\n', file );
+    for( i=0; i < PA_CONVERTER_COUNT_; ++i )
+        fprintf( file, "%s%.4g", i ? " " : "", costs[i] );
+    fputc( '\n', file );
+    fclose( file );
+}
+
+
+/* The seconds the fastest run of converter takes, at strides of 1 and 2 */
+static double TimeConverter( PaUtilConverter *converter, void *destination, void *source,
+        PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double total = 0.;
+    signed int stride;
+    int run, call;
+
+    for( stride = 1; stride <= 2; ++stride )
+    {
+        PaUtilConverter *specialized = SpecializeConverter( converter, stride, stride );
+        double best = 0.;
+
+        /* the first run also warms the caches and is not counted */
+        for( run = 0; run <= PA_TUNING_RUNS_; ++run )
+        {
+            PaTime start = PaUtil_GetTime(), elapsed;
+            for( call = 0; call < PA_TUNING_CALLS_; ++call )
+                specialized( destination, stride, source, stride, PA_TUNING_SAMPLES_, ditherGenerator );
+            elapsed = PaUtil_GetTime() - start;
+            if( run == 1 || (run > 1 && elapsed < best) )
+                best = elapsed;
+        }
+        total += best;
+    }
+    return total;
+}
+
+
+/* Take each converter from the fastest of the sets supported by the CPU.
+   Must be called with the C versions in paConverters. Returns 0 if there
+   was nothing to choose from or the converters were not to be tuned, with
+   paConverters unchanged. */
+static int AutotuneConverterTable( PaUtilCpuFeatures features )
+{
+    PaUtilConverterTable tables[PA_TUNING_TABLES_];
+    int available[PA_TUNING_TABLES_] = { 0 };
+    unsigned char choices[PA_CONVERTER_COUNT_];
+    double costs[PA_CONVERTER_COUNT_];
+    char pathBuffer[1024], key[256];
+    const char *path;
+    int tableCount = 1, i;
+    size_t entry;
+
+    if( !GetConverterTuningPath( pathBuffer, sizeof(pathBuffer), &path ) )
+        return 0;
+
+    tables[paUtilPortableConverters] = paConverters;
+    available[paUtilPortableConverters] = 1;
+    if( (features & paCpuSSE2) && PaUtil_InitializeX86SSE2Converters() )
+    {
+        tables[paUtilX86SSE2Converters] = paConverters;
+        available[paUtilX86SSE2Converters] = 1;
+        ++tableCount;
+    }
+    if( (features & paCpuAVX2) && PaUtil_InitializeX86AVX2Converters() )
+    {
+        tables[paUtilX86AVX2Converters] = paConverters;
+        available[paUtilX86AVX2Converters] = 1;
+        ++tableCount;
+    }
+    paConverters = tables[paUtilPortableConverters];
+    if( tableCount == 1 )
+        return 0;
+
+    snprintf( key, sizeof(key), "PortAudio converter tuning %d\nversion %x features %lx tables %d%d%d%d converters %d\n",
+            PA_TUNING_VERSION_, Pa_GetVersion(), (unsigned long)features,
+            available[0], available[1], available[2], available[3], (int)PA_CONVERTER_COUNT_ );
+
+    if( path && ReadConverterTuning( path, key, choices, costs, available ) )
+    {
+        PA_DEBUG(( "PaUtil_InitializeConverterTable: converters read from %s\n", path ));
+    }
+    else
+    {
+        /* any source sample pattern will do, as long as it reads as
+           floating point values within [-1, 1] */
+        void *source = PaUtil_AllocateMemory( PA_TUNING_SAMPLES_ * 2 * 8 );
+        void *destination = PaUtil_AllocateMemory( PA_TUNING_SAMPLES_ * 2 * 8 );
+        PaUtilTriangularDitherGenerator ditherGenerator;
+
+        if( !source || !destination )
+        {
+            PaUtil_FreeMemory( source );
+            PaUtil_FreeMemory( destination );
+            return 0;
+        }
+        for( i=0; i < PA_TUNING_SAMPLES_ * 2 * 2; ++i )
+            ((float*)source)[i] = (float)((i * 37) % 200 - 100) / 128.f;
+        PaUtil_InitializeTriangularDitherState( &ditherGenerator );
+
+        for( entry = 0; entry < PA_CONVERTER_COUNT_; ++entry )
+        {
+            double bestTime = 0.;
+
+            choices[entry] = paUtilPortableConverters;
+            costs[entry] = 0.;
+            for( i=0; i < PA_TUNING_TABLES_; ++i )
+            {
+                PaUtilConverter *candidate = PA_CONVERTER_ENTRIES_( tables[i] )[entry];
+                int j, seen = 0;
+                double t;
+
+                if( !available[i] || !candidate )
+                    continue;
+                for( j=0; j < i; ++j )
+                    seen |= available[j] && PA_CONVERTER_ENTRIES_( tables[j] )[entry] == candidate;
+                if( seen )
+                    continue;
+
+                t = TimeConverter( candidate, destination, source, &ditherGenerator );
+                if( i == paUtilPortableConverters || t < bestTime )
+                {
+                    bestTime = t;
+                    choices[entry] = (unsigned char)i;
+                }
+            }
+            /* TimeConverter() times a run at each of the two strides */
+            costs[entry] = bestTime * 1e9 / (2. * PA_TUNING_CALLS_ * PA_TUNING_SAMPLES_);
+        }
+
+        PaUtil_FreeMemory( source );
+        PaUtil_FreeMemory( destination );
+        if( path )
+            WriteConverterTuning( path, key, choices, costs );
+        PA_DEBUG(( "PaUtil_InitializeConverterTable: converters tuned%s\n",
+                path ? ", kept for later runs" : "" ));
+    }
+
+    for( entry = 0; entry < PA_CONVERTER_COUNT_; ++entry )
+    {
+        PA_CONVERTER_ENTRIES_( paConverters )[entry] = PA_CONVERTER_ENTRIES_( tables[choices[entry]] )[entry];
+        converterCosts_[entry] = costs[entry];
+    }
+
+    return 1;
+}
+
+#endif /* PA_NO_STANDARD_CONVERTERS */
+
+/* -------------------------------------------------------------------------- */
+
+static int converterTableInitialized_ = 0;
+static PaUtilConverterTableId activeConverterTable_ = paUtilPortableConverters;
+
+void PaUtil_InitializeConverterTable( void )
+{
+    if( converterTableInitialized_ )
+        return;
+    converterTableInitialized_ = 1;
+
+#ifndef PA_NO_STANDARD_CONVERTERS
+    {
+        /* the accelerated converters fall back to the standard ones for
+           the remaining samples, so there is nothing to build on without */
+        PaUtilCpuFeatures features = PaUtil_GetCpuFeatures();
+
+#ifdef __ARM_NEON__
+        /* NEON sections are compiled into the C versions */
+        if( features & paCpuNEON )
+            activeConverterTable_ = paUtilArmNeonConverters;
+#endif
+
+        if( AutotuneConverterTable( features ) )
+            activeConverterTable_ = paUtilAutotunedConverters;
+        else if( (features & paCpuAVX2) && PaUtil_InitializeX86AVX2Converters() )
+            activeConverterTable_ = paUtilX86AVX2Converters;
+        else if( (features & paCpuSSE2) && PaUtil_InitializeX86SSE2Converters() )
+            activeConverterTable_ = paUtilX86SSE2Converters;
+    }
+#endif /* PA_NO_STANDARD_CONVERTERS */
+}
+
+/* -------------------------------------------------------------------------- */
+
+PaUtilConverterTableId PaUtil_GetActiveConverterTable( void )
+{
+    return activeConverterTable_;
+}
+
+/* -------------------------------------------------------------------------- */
+
+const char *PaUtil_GetConverterTableName( PaUtilConverterTableId tableId )
+{
+    switch( tableId ){
+    case paUtilPortableConverters:
+        return "portable";
+    case paUtilArmNeonConverters:
+        return "ARM NEON";
+    case paUtilX86SSE2Converters:
+        return "x86 SSE2";
+    case paUtilX86AVX2Converters:
+        return "x86 AVX2";
+    case paUtilAutotunedConverters:
+        return "autotuned";
+    default: return "unknown";
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* The bits of resolution of a sample format, of the mantissa for floating
+   point formats, 0 for custom formats */
+static int GetFormatResolution( PaSampleFormat format )
+{
+    switch( format ){
+    case paFloat64: return 53;
+    case paInt32: return 32;
+    case paFloat32: /* fall through */
+    case paInt24: /* fall through */
+    case paInt24In32: return 24;
+    case paInt16: return 16;
+    case paInt8: /* fall through */
+    case paUInt8: return 8;
+    default: return 0;
+    }
+}
+
+
+static int GetFormatBytes( PaSampleFormat format )
+{
+    switch( format ){
+    case paFloat64: return 8;
+    case paInt24: return 3;
+    case paInt16: return 2;
+    case paInt8: /* fall through */
+    case paUInt8: return 1;
+    default: return 4;
+    }
+}
+
+
+/* The nanoseconds per sample the tuning measured for the converter, 0 if
+   the converters weren't tuned */
+static double GetMeasuredConversionCost( PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat, PaStreamFlags flags )
+{
+#ifndef PA_NO_STANDARD_CONVERTERS
+    PaUtilConverter *converter = PaUtil_SelectConverter( sourceFormat, destinationFormat, flags );
+    size_t entry;
+
+    for( entry = 0; converter && entry < PA_CONVERTER_COUNT_; ++entry )
+    {
+        if( PA_CONVERTER_ENTRIES_( paConverters )[entry] == converter )
+            return converterCosts_[entry];
+    }
+#else
+    (void) sourceFormat;
+    (void) destinationFormat;
+    (void) flags;
+#endif /* PA_NO_STANDARD_CONVERTERS */
+    return 0.;
+}
+
+
+/* An estimate of the cost of an untuned converter, from the bytes it moves
+   per sample and the work it does on them */
+static double GetEstimatedConversionCost( PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat, PaStreamFlags flags )
+{
+    const PaSampleFormat floatFormats = paFloat32 | paFloat64;
+    double cost = GetFormatBytes( sourceFormat ) + GetFormatBytes( destinationFormat );
+
+    if( sourceFormat == destinationFormat )
+        return cost;
+    if( !(sourceFormat & floatFormats) != !(destinationFormat & floatFormats) )
+        cost += 4.; /* scaling, rounding and clipping */
+    if( sourceFormat == paInt24 || destinationFormat == paInt24 )
+        cost += 2.; /* samples assembled byte by byte */
+    if( !(destinationFormat & floatFormats) && !(flags & paDitherOff)
+            && GetFormatResolution( destinationFormat ) < GetFormatResolution( sourceFormat ) )
+        cost += 4.; /* dither */
+    return cost;
+}
+
+
+PaSampleFormat PaUtil_SelectCheapestAvailableFormat(
+        PaSampleFormat availableFormats, PaSampleFormat nativeFormats,
+        PaSampleFormat format, int isOutput, PaStreamFlags flags )
+{
+    PaSampleFormat candidates[PA_FORMAT_BY_QUALITY_COUNT_], selected = paSampleFormatNotSupported;
+    double measuredCosts[PA_FORMAT_BY_QUALITY_COUNT_], estimatedCosts[PA_FORMAT_BY_QUALITY_COUNT_];
+    double lowestCost = 0.;
+    int candidateCount = 0, resolution, allMeasured = 1, i;
+
+    format &= ~paNonInterleaved;
+    availableFormats &= ~paNonInterleaved;
+    nativeFormats &= availableFormats;
+
+    /* the driver's own conversions are only used if it has no lossless
+       native format */
+    resolution = GetFormatResolution( format );
+    for( i=0; i < PA_FORMAT_BY_QUALITY_COUNT_; ++i )
+    {
+        if( (formatsByQuality_[i] & nativeFormats) && GetFormatResolution( formatsByQuality_[i] ) >= resolution )
+            break;
+    }
+    if( i == PA_FORMAT_BY_QUALITY_COUNT_ )
+        nativeFormats = availableFormats;
+
+    for( i=0; i < PA_FORMAT_BY_QUALITY_COUNT_; ++i )
+    {
+        PaSampleFormat candidate = formatsByQuality_[i];
+        PaSampleFormat source = isOutput ? format : candidate;
+        PaSampleFormat destination = isOutput ? candidate : format;
+
+        if( !resolution || !(candidate & nativeFormats) || GetFormatResolution( candidate ) < resolution )
+            continue;
+        candidates[candidateCount] = candidate;
+        measuredCosts[candidateCount] = GetMeasuredConversionCost( source, destination, flags );
+        estimatedCosts[candidateCount] = GetEstimatedConversionCost( source, destination, flags );
+        allMeasured = allMeasured && measuredCosts[candidateCount] > 0.;
+        ++candidateCount;
+    }
+
+    if( candidateCount == 0 )
+        return PaUtil_SelectClosestAvailableFormat( availableFormats, format );
+
+    /* measurements and estimates aren't comparable with each other, ties
+       go to the higher quality format */
+    for( i=0; i < candidateCount; ++i )
+    {
+        double cost = allMeasured ? measuredCosts[i] : estimatedCosts[i];
+        if( i == 0 || cost < lowestCost )
+        {
+            selected = candidates[i];
+            lowestCost = cost;
+        }
+    }
+    PA_DEBUG(( "PaUtil_SelectCheapestAvailableFormat: %lx for %lx, %s cost %g\n",
+            (unsigned long)selected, (unsigned long)format, allMeasured ? "measured" : "estimated", lowestCost ));
+    return selected;
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef PA_NO_STANDARD_CONVERTERS
+
+/*
+    2nd order noise shaped triangular dither, after the musicdsp.org
+    algorithm quoted in pa_dither.c: the quantization error of the previous
+    two samples is fed back with s*(2*e1 - e2), s = 0.5.
+
+    The dither and the scaled source are prepared a block at a time in loops
+    without dependencies between samples, leaving only the error feedback
+    itself serial.
+*/
+#define PA_NOISE_SHAPING_ (0.5f)
+
+static void Float32_To_Int16_NoiseShapedDither(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+    /* see PaUtil_SelectNoiseShapedDitherConverter() */
+    PaUtilNoiseShapedDitherGenerator *state = (PaUtilNoiseShapedDitherGenerator*)ditherGenerator;
+    float error1 = state->error1;
+    float error2 = state->error2;
+
+    while( count > 0 )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        float scaled[PA_DITHER_BLOCK_SIZE];
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        PaUtil_GenerateFloatTriangularDitherBlock( &state->triangular, dithers, n );
+        for( i=0; i<n; i++ )
+        {
+            /* use smaller scaler to leave room for the dither */
+            scaled[i] = *src * (32766.0f);
+            src += sourceStride;
+        }
+
+        for( i=0; i<n; i++ )
+        {
+            float shaped = scaled[i] + PA_NOISE_SHAPING_ * (error1 + error1 - error2);
+            /* round to nearest - the offset keeps the value positive so
+               truncation is floor() */
+            PaInt32 samp = (PaInt32)(shaped + dithers[i] + 32768.5f) - 32768;
+
+            /* error of the unclipped value so clipping can't run away */
+            error2 = error1;
+            error1 = shaped - (float)samp;
+
+            PA_CLIP_( samp, -0x8000, 0x7FFF );
+            *dest = (PaInt16) samp;
+            dest += destinationStride;
+        }
+        count -= n;
+    }
+
+    state->error1 = error1;
+    state->error2 = error2;
+}
+
+#endif /* PA_NO_STANDARD_CONVERTERS */
+
+/* -------------------------------------------------------------------------- */
+
+PaUtilConverter* PaUtil_SelectNoiseShapedDitherConverter( PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat )
+{
+#ifndef PA_NO_STANDARD_CONVERTERS
+    if( (sourceFormat & ~paNonInterleaved) == paFloat32
+            && (destinationFormat & ~paNonInterleaved) == paInt16 )
+        return Float32_To_Int16_NoiseShapedDither;
+#else
+    (void)sourceFormat; /* unused parameter */
+    (void)destinationFormat; /* unused parameter */
+#endif /* PA_NO_STANDARD_CONVERTERS */
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
 PaUtilZeroer* PaUtil_SelectZeroer( PaSampleFormat destinationFormat )
 {
     switch( destinationFormat & ~paNonInterleaved ){
@@ -2305,6 +5229,10 @@ PaUtilZeroer* PaUtil_SelectZeroer( PaSampleFormat destinationFormat )
         return paZeroers.Zero32;
     case paInt24:
         return paZeroers.Zero24;
+    case paInt24In32:
+        return paZeroers.Zero32;
+    case paFloat64:
+        return paZeroers.Zero64;
     case paInt16:
         return paZeroers.Zero16;
     case paInt8:
@@ -2327,6 +5255,7 @@ PaUtilZeroerTable paZeroers = {
     0,  /* PaUtilZeroer *Zero16; */
     0,  /* PaUtilZeroer *Zero24; */
     0,  /* PaUtilZeroer *Zero32; */
+    0,  /* PaUtilZeroer *Zero64; */
 };
 
 /* -------------------------------------------------------------------------- */
@@ -2335,11 +5264,26 @@ PaUtilZeroerTable paZeroers = {
 
 /* -------------------------------------------------------------------------- */
 
+/*
+    The zeroers fill contiguous samples (destinationStride 1) with memset(),
+    whose vectorized stores beat a loop over the samples by far on large
+    buffers. Strided ones are written a sample at a time: storing whole
+    vectors would mean reading back and rewriting the samples of the other
+    channels in between, which is slow on uncached device buffers and
+    races with whoever writes those channels.
+*/
+
 static void ZeroU8( void *destinationBuffer, signed int destinationStride,
         unsigned int count )
 {
     unsigned char *dest = (unsigned char*)destinationBuffer;
 
+    if( destinationStride == 1 )
+    {
+        memset( destinationBuffer, 128, count );
+        return;
+    }
+
     while( count-- )
     {
         *dest = 128;
@@ -2355,6 +5299,12 @@ static void Zero8( void *destinationBuffer, signed int destinationStride,
 {
     unsigned char *dest = (unsigned char*)destinationBuffer;
 
+    if( destinationStride == 1 )
+    {
+        memset( destinationBuffer, 0, count );
+        return;
+    }
+
     while( count-- )
     {
         *dest = 0;
@@ -2370,6 +5320,12 @@ static void Zero16( void *destinationBuffer, signed int destinationStride,
 {
     PaUint16 *dest = (PaUint16 *)destinationBuffer;
 
+    if( destinationStride == 1 )
+    {
+        memset( destinationBuffer, 0, (size_t)count * sizeof(PaUint16) );
+        return;
+    }
+
     while( count-- )
     {
         *dest = 0;
@@ -2385,6 +5341,12 @@ static void Zero24( void *destinationBuffer, signed int destinationStride,
 {
     unsigned char *dest = (unsigned char*)destinationBuffer;
 
+    if( destinationStride == 1 )
+    {
+        memset( destinationBuffer, 0, (size_t)count * 3 );
+        return;
+    }
+
     while( count-- )
     {
         dest[0] = 0;
@@ -2402,6 +5364,12 @@ static void Zero32( void *destinationBuffer, signed int destinationStride,
 {
     PaUint32 *dest = (PaUint32 *)destinationBuffer;
 
+    if( destinationStride == 1 )
+    {
+        memset( destinationBuffer, 0, (size_t)count * sizeof(PaUint32) );
+        return;
+    }
+
     while( count-- )
     {
         *dest = 0;
@@ -2412,12 +5380,34 @@ static void Zero32( void *destinationBuffer, signed int destinationStride,
 
 /* -------------------------------------------------------------------------- */
 
+static void Zero64( void *destinationBuffer, signed int destinationStride,
+        unsigned int count )
+{
+    double *dest = (double *)destinationBuffer;
+
+    if( destinationStride == 1 )
+    {
+        memset( destinationBuffer, 0, (size_t)count * sizeof(double) );
+        return;
+    }
+
+    while( count-- )
+    {
+        *dest = 0.;
+
+        dest += destinationStride;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
 PaUtilZeroerTable paZeroers = {
     ZeroU8,  /* PaUtilZeroer *ZeroU8; */
     Zero8,  /* PaUtilZeroer *Zero8; */
     Zero16,  /* PaUtilZeroer *Zero16; */
     Zero24,  /* PaUtilZeroer *Zero24; */
     Zero32,  /* PaUtilZeroer *Zero32; */
+    Zero64,  /* PaUtilZeroer *Zero64; */
 };
 
 /* -------------------------------------------------------------------------- */
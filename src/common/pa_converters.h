@@ -70,6 +70,30 @@ PaSampleFormat PaUtil_SelectClosestAvailableFormat(
         PaSampleFormat availableFormats, PaSampleFormat format );
 
 
+/** Choose the available sample format which is cheapest to convert the
+ requested format to (or from, for input) without losing resolution, used
+ for streams opened with paPreferCheapestConversion. Formats the driver
+ takes natively are preferred over ones it converts itself, then the one
+ whose conversion costs least. The costs are the converter timings measured
+ when the converters were tuned (see PaUtil_InitializeConverterTable()),
+ estimated from the sample sizes and the kind of conversion if they weren't.
+ If no available format holds the requested one losslessly the result is
+ that of PaUtil_SelectClosestAvailableFormat().
+ @param availableFormats A variable containing the logical OR of all available
+ formats.
+ @param nativeFormats The logical OR of the available formats the driver
+ takes without converting them, 0 if they are not known.
+ @param format The desired format.
+ @param isOutput Non-zero if samples are converted from format to the
+ selected format, zero if from the selected format to format.
+ @param flags The stream flags, which select the converters.
+ @return The selected format, or paSampleFormatNotSupported.
+*/
+PaSampleFormat PaUtil_SelectCheapestAvailableFormat(
+        PaSampleFormat availableFormats, PaSampleFormat nativeFormats,
+        PaSampleFormat format, int isOutput, PaStreamFlags flags );
+
+
 /* high level conversions functions for use by implementations */
 
 
@@ -94,7 +118,9 @@ typedef void PaUtilConverter(
 
 
 /** Find a sample converter function for the given source and destinations
-    formats and flags (clip and dither.)
+    formats and flags (clip, soft clip and dither.) paSoftClip selects the
+    soft clipping versions of the conversions from Float32, including one to
+    Float32, unless paClipOff is also given.
     @return
     A pointer to a PaUtilConverter which will perform the requested
     conversion, or NULL if the given format conversion is not supported.
@@ -108,6 +134,38 @@ PaUtilConverter* PaUtil_SelectConverter( PaSampleFormat sourceFormat,
         PaSampleFormat destinationFormat, PaStreamFlags flags );
 
 
+/** Find a sample converter like PaUtil_SelectConverter() does and, if
+    one was generated, return a version of it specialized for exactly the
+    given strides. Versions exist for most of the plain and clipping
+    conversions between Float32 and Int32/Int24/Int16, with an interleaved
+    host side of 2, 4, 6 or 8 channels (or a stride of 1 on both sides.)
+
+    The specialized converter still accepts any strides, it falls back to
+    the generic version when called with others than it was generated for.
+    @return
+    The same as PaUtil_SelectConverter() if there is no specialized
+    version.
+*/
+PaUtilConverter* PaUtil_SelectConverterForStrides( PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat, PaStreamFlags flags,
+        signed int sourceStride, signed int destinationStride );
+
+
+/** Find a noise shaped dither converter for the given source and destination
+    formats. Only Float32 to Int16 is currently supported.
+
+    The returned converter must be passed a pointer to the triangular member
+    of a PaUtilNoiseShapedDitherGenerator, one per channel, as its
+    ditherGenerator parameter. Its output is always clipped.
+    @return
+    A pointer to a PaUtilConverter, or NULL if there is no noise shaped
+    version of the conversion.
+    @see PaUtilNoiseShapedDitherGenerator, paDitherNoiseShaped
+*/
+PaUtilConverter* PaUtil_SelectNoiseShapedDitherConverter( PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat );
+
+
 /** The generic buffer zeroer prototype. Buffer zeroers copy count zeros to
     destinationBuffer. The actual type of the data pointed to varys for
     different zeroer functions.
@@ -200,10 +258,87 @@ typedef struct{
     PaUtilConverter *UInt8_To_Int16;
     PaUtilConverter *UInt8_To_Int8;
 
+    PaUtilConverter *Float32_To_Int24In32;
+    PaUtilConverter *Float32_To_Int24In32_Dither;
+    PaUtilConverter *Float32_To_Int24In32_Clip;
+    PaUtilConverter *Float32_To_Int24In32_DitherClip;
+
+    PaUtilConverter *Int32_To_Int24In32;
+    PaUtilConverter *Int32_To_Int24In32_Dither;
+    PaUtilConverter *Int24_To_Int24In32;
+    PaUtilConverter *Int16_To_Int24In32;
+    PaUtilConverter *Int8_To_Int24In32;
+    PaUtilConverter *UInt8_To_Int24In32;
+
+    PaUtilConverter *Int24In32_To_Float32;
+    PaUtilConverter *Int24In32_To_Int32;
+    PaUtilConverter *Int24In32_To_Int24;
+    PaUtilConverter *Int24In32_To_Int16;
+    PaUtilConverter *Int24In32_To_Int16_Dither;
+    PaUtilConverter *Int24In32_To_Int8;
+    PaUtilConverter *Int24In32_To_Int8_Dither;
+    PaUtilConverter *Int24In32_To_UInt8;
+    PaUtilConverter *Int24In32_To_UInt8_Dither;
+
+    PaUtilConverter *Float64_To_Float32;
+
+    PaUtilConverter *Float64_To_Int32;
+    PaUtilConverter *Float64_To_Int32_Dither;
+    PaUtilConverter *Float64_To_Int32_Clip;
+    PaUtilConverter *Float64_To_Int32_DitherClip;
+
+    PaUtilConverter *Float64_To_Int24;
+    PaUtilConverter *Float64_To_Int24_Dither;
+    PaUtilConverter *Float64_To_Int24_Clip;
+    PaUtilConverter *Float64_To_Int24_DitherClip;
+
+    PaUtilConverter *Float64_To_Int24In32;
+    PaUtilConverter *Float64_To_Int24In32_Dither;
+    PaUtilConverter *Float64_To_Int24In32_Clip;
+    PaUtilConverter *Float64_To_Int24In32_DitherClip;
+
+    PaUtilConverter *Float64_To_Int16;
+    PaUtilConverter *Float64_To_Int16_Dither;
+    PaUtilConverter *Float64_To_Int16_Clip;
+    PaUtilConverter *Float64_To_Int16_DitherClip;
+
+    PaUtilConverter *Float64_To_Int8;
+    PaUtilConverter *Float64_To_Int8_Dither;
+    PaUtilConverter *Float64_To_Int8_Clip;
+    PaUtilConverter *Float64_To_Int8_DitherClip;
+
+    PaUtilConverter *Float64_To_UInt8;
+    PaUtilConverter *Float64_To_UInt8_Dither;
+    PaUtilConverter *Float64_To_UInt8_Clip;
+    PaUtilConverter *Float64_To_UInt8_DitherClip;
+
+    PaUtilConverter *Float32_To_Float64;
+    PaUtilConverter *Int32_To_Float64;
+    PaUtilConverter *Int24_To_Float64;
+    PaUtilConverter *Int24In32_To_Float64;
+    PaUtilConverter *Int16_To_Float64;
+    PaUtilConverter *Int8_To_Float64;
+    PaUtilConverter *UInt8_To_Float64;
+
+    PaUtilConverter *Float32_To_Float32_SoftClip;
+    PaUtilConverter *Float32_To_Int32_SoftClip;
+    PaUtilConverter *Float32_To_Int32_DitherSoftClip;
+    PaUtilConverter *Float32_To_Int24_SoftClip;
+    PaUtilConverter *Float32_To_Int24_DitherSoftClip;
+    PaUtilConverter *Float32_To_Int24In32_SoftClip;
+    PaUtilConverter *Float32_To_Int24In32_DitherSoftClip;
+    PaUtilConverter *Float32_To_Int16_SoftClip;
+    PaUtilConverter *Float32_To_Int16_DitherSoftClip;
+    PaUtilConverter *Float32_To_Int8_SoftClip;
+    PaUtilConverter *Float32_To_Int8_DitherSoftClip;
+    PaUtilConverter *Float32_To_UInt8_SoftClip;
+    PaUtilConverter *Float32_To_UInt8_DitherSoftClip;
+
     PaUtilConverter *Copy_8_To_8;       /* copy without any conversion */
     PaUtilConverter *Copy_16_To_16;     /* copy without any conversion */
     PaUtilConverter *Copy_24_To_24;     /* copy without any conversion */
     PaUtilConverter *Copy_32_To_32;     /* copy without any conversion */
+    PaUtilConverter *Copy_64_To_64;     /* copy without any conversion */
 } PaUtilConverterTable;
 
 
@@ -227,6 +362,57 @@ typedef struct{
 extern PaUtilConverterTable paConverters;
 
 
+/** Identifies the set of converter functions installed in paConverters.
+    @see PaUtil_InitializeConverterTable, PaUtil_GetActiveConverterTable
+*/
+typedef enum PaUtilConverterTableId{
+    paUtilPortableConverters = 0,   /* C versions only */
+    paUtilArmNeonConverters,        /* C versions with NEON sections enabled */
+    paUtilX86SSE2Converters,
+    paUtilX86AVX2Converters,
+    paUtilAutotunedConverters       /* the fastest of the above for each converter */
+} PaUtilConverterTableId;
+
+
+/** Install the fastest converter functions supported by the CPU we are
+    running on into paConverters. Called by Pa_Initialize(). The CPU is only
+    examined on the first call, later calls keep the table selected before.
+
+    Accelerated converters honour withAcceleration like the NEON sections of
+    the C versions do.
+
+    If the PA_CONVERTER_TUNING environment variable is set, each converter
+    is instead taken from the set which runs it fastest on this machine, as
+    measured with a short benchmark of the versions for strides of 1 and 2.
+    PA_CONVERTER_TUNING is the path of a file keeping the result for later
+    runs, 1 for the default of $XDG_CACHE_HOME/portaudio/converters or
+    ~/.cache/portaudio/converters (%LOCALAPPDATA%\portaudio\converters on
+    Windows) or 0 to not tune. The file is measured again when PortAudio,
+    the CPU features or the available sets change. Tuning is skipped where
+    the CPU has no accelerated sets besides the C versions.
+
+    @note
+    Code substituting its own conversion functions should do so after
+    Pa_Initialize() has been called.
+
+    @see PaUtil_GetActiveConverterTable, PaUtil_GetCpuFeatures
+*/
+void PaUtil_InitializeConverterTable( void );
+
+
+/** Retrieve the set of converter functions selected by
+    PaUtil_InitializeConverterTable(). paUtilPortableConverters is
+    returned if it has not been called yet.
+*/
+PaUtilConverterTableId PaUtil_GetActiveConverterTable( void );
+
+
+/** Retrieve a human readable name of a converter table id, e.g. for
+    debug output. Returns "unknown" for invalid ids.
+*/
+const char *PaUtil_GetConverterTableName( PaUtilConverterTableId tableId );
+
+
 /** The type used to store all buffer zeroing functions.
     @see paZeroers;
 */
@@ -236,6 +422,7 @@ typedef struct{
     PaUtilZeroer *Zero16;
     PaUtilZeroer *Zero24;
     PaUtilZeroer *Zero32;
+    PaUtilZeroer *Zero64;
 } PaUtilZeroerTable;
 
 
@@ -0,0 +1,301 @@
+/*
+ * Portable Audio I/O Library CPU feature detection
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Runtime detection of the vector instruction sets offered by the CPU.
+
+ x86: cpuid, and xgetbv to make sure the OS saves the wide registers.
+ ARM: NEON is assumed if the library was built for it (the compiler may use
+ it anywhere then) or on AArch64, where it is mandatory. On Linux the
+ kernel's hwcaps are checked in addition, which also reports SVE.
+*/
+
+
+#include "pa_cpufeatures.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define PA_CPU_X86_
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <xmmintrin.h> /* _mm_getcsr() */
+#elif defined(__GNUC__)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__arm__) || defined(__aarch64__)
+#define PA_CPU_ARM_
+#if defined(__linux__)
+#include <sys/auxv.h>
+#define PA_CPU_HAVE_HWCAP_
+#endif
+#endif
+
+
+static int cpuFeaturesDetected_ = 0;
+static PaUtilCpuFeatures cpuFeatures_ = 0;
+
+
+#ifdef PA_CPU_X86_
+
+/* bits in cpuid leaf 1 */
+#define PA_CPUID1_EDX_FXSR_     (1UL << 24)
+#define PA_CPUID1_EDX_SSE2_     (1UL << 26)
+#define PA_CPUID1_ECX_SSE41_    (1UL << 19)
+#define PA_CPUID1_ECX_OSXSAVE_  (1UL << 27)
+#define PA_CPUID1_ECX_AVX_      (1UL << 28)
+/* bits in cpuid leaf 7 / subleaf 0 */
+#define PA_CPUID7_EBX_AVX2_     (1UL << 5)
+#define PA_CPUID7_EBX_AVX512F_  (1UL << 16)
+/* bits in cpuid leaf 0x80000007 */
+#define PA_CPUID80000007_EDX_INVARIANT_TSC_ (1UL << 8)
+/* MXCSR bits */
+#define PA_MXCSR_DAZ_           0x0040UL
+#define PA_MXCSR_FTZ_           0x8000UL
+/* register state enabled by the OS in XCR0 */
+#define PA_XCR0_YMM_            0x06UL /* xmm + ymm */
+#define PA_XCR0_ZMM_            0xe6UL /* xmm + ymm + opmask + zmm */
+
+/* regs: eax, ebx, ecx, edx - returns 0 if the leaf is not supported */
+static int Cpuid( unsigned int leaf, unsigned int subleaf, unsigned long regs[4] )
+{
+    /* the basic and the extended leaves have separate maxima */
+    unsigned int range = leaf & 0x80000000U;
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid( info, (int)range );
+    if( (unsigned int)info[0] < leaf )
+        return 0;
+    __cpuidex( info, (int)leaf, (int)subleaf );
+    regs[0] = (unsigned long)info[0];
+    regs[1] = (unsigned long)info[1];
+    regs[2] = (unsigned long)info[2];
+    regs[3] = (unsigned long)info[3];
+    return 1;
+#elif defined(__GNUC__)
+    unsigned int eax, ebx, ecx, edx;
+    if( __get_cpuid_max( range, 0 ) < leaf )
+        return 0;
+    __cpuid_count( leaf, subleaf, eax, ebx, ecx, edx );
+    regs[0] = eax;
+    regs[1] = ebx;
+    regs[2] = ecx;
+    regs[3] = edx;
+    return 1;
+#else
+    (void)range; /* unused variable */
+    (void)leaf; /* unused parameter */
+    (void)subleaf; /* unused parameter */
+    (void)regs; /* unused parameter */
+    return 0;
+#endif
+}
+
+/* only valid if cpuid reports OSXSAVE */
+static unsigned long GetXcr0( void )
+{
+#if defined(_MSC_VER)
+    return (unsigned long)_xgetbv( 0 );
+#elif defined(__GNUC__)
+    unsigned int eax, edx;
+    /* xgetbv - encoded, older assemblers do not know the mnemonic */
+    __asm__ __volatile__( ".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0) );
+    return eax;
+#else
+    return 0;
+#endif
+}
+
+/* Setting an MXCSR bit which the CPU does not support faults, the early SSE
+   CPUs lack DAZ. The mask of the supported ones is stored by fxsave, 0 there
+   means the default mask, which does not include DAZ. Only valid if cpuid
+   reports FXSR. */
+static int HasMxcsrDaz( void )
+{
+#if defined(_MSC_VER) || defined(__GNUC__)
+#if defined(_MSC_VER)
+    __declspec(align(16)) unsigned char area[512];
+    _fxsave( area );
+#else
+    unsigned char area[512] __attribute__((aligned(16)));
+    __asm__ __volatile__( "fxsave %0" : "=m"(area) );
+#endif
+    return ( (unsigned long)area[28] | ((unsigned long)area[29] << 8) ) & PA_MXCSR_DAZ_ ? 1 : 0;
+#else
+    return 0;
+#endif
+}
+
+static PaUtilCpuFeatures DetectX86Features( void )
+{
+    PaUtilCpuFeatures result = 0;
+    unsigned long leaf1[4], leaf7[4], leaf80000007[4];
+    unsigned long xcr0 = 0;
+
+    if( !Cpuid( 1, 0, leaf1 ) )
+        return 0;
+
+    if( leaf1[3] & PA_CPUID1_EDX_SSE2_ )
+        result |= paCpuSSE2;
+    if( leaf1[2] & PA_CPUID1_ECX_SSE41_ )
+        result |= paCpuSSE41;
+    if( (leaf1[3] & PA_CPUID1_EDX_FXSR_) && (leaf1[3] & PA_CPUID1_EDX_SSE2_) && HasMxcsrDaz() )
+        result |= paCpuDAZ;
+
+    /* without OS support AVX instructions fault */
+    if( (leaf1[2] & PA_CPUID1_ECX_OSXSAVE_) && (leaf1[2] & PA_CPUID1_ECX_AVX_) )
+        xcr0 = GetXcr0();
+
+    if( (xcr0 & PA_XCR0_YMM_) == PA_XCR0_YMM_ && Cpuid( 7, 0, leaf7 ) )
+    {
+        if( leaf7[1] & PA_CPUID7_EBX_AVX2_ )
+            result |= paCpuAVX2;
+        if( (xcr0 & PA_XCR0_ZMM_) == PA_XCR0_ZMM_ && (leaf7[1] & PA_CPUID7_EBX_AVX512F_) )
+            result |= paCpuAVX512F;
+    }
+
+    if( Cpuid( 0x80000007U, 0, leaf80000007 ) && (leaf80000007[3] & PA_CPUID80000007_EDX_INVARIANT_TSC_) )
+        result |= paCpuInvariantTSC;
+
+    return result;
+}
+
+#endif /* PA_CPU_X86_ */
+
+
+#ifdef PA_CPU_ARM_
+
+#ifdef __aarch64__
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1UL << 1)
+#endif
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1UL << 22)
+#endif
+#else
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1UL << 12)
+#endif
+#endif
+
+static PaUtilCpuFeatures DetectArmFeatures( void )
+{
+    PaUtilCpuFeatures result = 0;
+
+#if defined(__aarch64__) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+    /* mandatory on AArch64 / compiled in */
+    result |= paCpuNEON;
+#endif
+
+#ifdef PA_CPU_HAVE_HWCAP_
+    {
+        unsigned long hwcap = getauxval( AT_HWCAP );
+#ifdef __aarch64__
+        if( hwcap & HWCAP_ASIMD )
+            result |= paCpuNEON;
+        if( hwcap & HWCAP_SVE )
+            result |= paCpuSVE;
+#else
+        if( hwcap & HWCAP_NEON )
+            result |= paCpuNEON;
+#endif
+    }
+#endif /* PA_CPU_HAVE_HWCAP_ */
+
+    return result;
+}
+
+#endif /* PA_CPU_ARM_ */
+
+
+PaUtilCpuFeatures PaUtil_GetCpuFeatures( void )
+{
+    /* races are harmless here: every thread detects the same value */
+    if( !cpuFeaturesDetected_ )
+    {
+#if defined(PA_CPU_X86_)
+        cpuFeatures_ = DetectX86Features();
+#elif defined(PA_CPU_ARM_)
+        cpuFeatures_ = DetectArmFeatures();
+#endif
+        cpuFeaturesDetected_ = 1;
+    }
+    return cpuFeatures_;
+}
+
+
+int PaUtil_FlushDenormalsToZero( void )
+{
+#if defined(PA_CPU_X86_) && ( defined(_MSC_VER) || defined(__GNUC__) )
+    PaUtilCpuFeatures features = PaUtil_GetCpuFeatures();
+    unsigned int csr, flush;
+
+    if( !(features & paCpuSSE2) )
+        return 0;
+
+    flush = PA_MXCSR_FTZ_ | ( (features & paCpuDAZ) ? PA_MXCSR_DAZ_ : 0 );
+#if defined(_MSC_VER)
+    csr = _mm_getcsr();
+    if( (csr & flush) != flush )
+        _mm_setcsr( csr | flush );
+#else
+    __asm__ __volatile__( "stmxcsr %0" : "=m"(csr) );
+    if( (csr & flush) != flush )
+    {
+        csr |= flush;
+        __asm__ __volatile__( "ldmxcsr %0" : : "m"(csr) );
+    }
+#endif
+    return 1;
+
+#elif defined(__aarch64__) && defined(__GNUC__)
+    unsigned long long fpcr;
+    __asm__ __volatile__( "mrs %0, fpcr" : "=r"(fpcr) );
+    if( !(fpcr & (1ULL << 24)) ) /* FZ */
+        __asm__ __volatile__( "msr fpcr, %0" : : "r"(fpcr | (1ULL << 24)) );
+    return 1;
+
+#elif defined(__arm__) && defined(__GNUC__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+    unsigned int fpscr;
+    __asm__ __volatile__( "vmrs %0, fpscr" : "=r"(fpscr) );
+    if( !(fpscr & (1U << 24)) ) /* FZ */
+        __asm__ __volatile__( "vmsr fpscr, %0" : : "r"(fpscr | (1U << 24)) );
+    return 1;
+
+#else
+    return 0;
+#endif
+}
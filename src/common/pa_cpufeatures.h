@@ -0,0 +1,90 @@
+#ifndef PA_CPUFEATURES_H
+#define PA_CPUFEATURES_H
+/*
+ * Portable Audio I/O Library CPU feature detection
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however, 
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also 
+ * requested that these non-binding requests be included along with the 
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Runtime detection of the vector instruction sets offered by the CPU.
+ Used to select accelerated implementations (e.g. sample converters) at
+ Pa_Initialize() time instead of at compile time.
+*/
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** A set of bits, one for each detected CPU feature.
+ @see paCpuSSE2, paCpuNEON, PaUtil_GetCpuFeatures
+*/
+typedef unsigned long PaUtilCpuFeatures;
+
+#define paCpuSSE2       ((PaUtilCpuFeatures) 0x00000001) /**< x86 SSE2 */
+#define paCpuSSE41      ((PaUtilCpuFeatures) 0x00000002) /**< x86 SSE4.1 */
+#define paCpuAVX2       ((PaUtilCpuFeatures) 0x00000004) /**< x86 AVX2, OS saves the ymm registers */
+#define paCpuAVX512F    ((PaUtilCpuFeatures) 0x00000008) /**< x86 AVX-512 foundation, OS saves the zmm registers */
+#define paCpuInvariantTSC ((PaUtilCpuFeatures) 0x00000010) /**< x86 time stamp counter runs at a constant rate in all power states */
+#define paCpuDAZ        ((PaUtilCpuFeatures) 0x00000020) /**< x86 MXCSR supports denormals-are-zero */
+#define paCpuNEON       ((PaUtilCpuFeatures) 0x00000100) /**< ARM NEON / AArch64 Advanced SIMD */
+#define paCpuSVE        ((PaUtilCpuFeatures) 0x00000200) /**< AArch64 scalable vector extension */
+
+
+/** Detect the features of the CPU we are running on. The CPU is only
+ queried on the first call, later calls return the cached result.
+ @return The logical OR of all detected features, 0 if none were detected
+ or detection is not supported on this platform.
+*/
+PaUtilCpuFeatures PaUtil_GetCpuFeatures( void );
+
+
+/** Make the floating point unit flush denormal results of the calling thread
+ to zero, and treat denormal operands as zero where the CPU supports it: FTZ
+ and DAZ in MXCSR on x86, which applies to SSE but not to x87 arithmetic, and
+ FZ in FPCR (AArch64) or FPSCR (32 bit ARM with VFP). The mode is only written
+ if it differs, so that calling this for every buffer is cheap.
+ @return 1 if flushing is enabled for the calling thread, 0 if it is not
+ supported on this platform.
+ @see paFlushDenormals
+*/
+int PaUtil_FlushDenormalsToZero( void );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_CPUFEATURES_H */
@@ -53,6 +53,7 @@
 #include "pa_cpuload.h"
 
 #include <assert.h>
+#include <string.h> /* memset() */
 
 #include "pa_util.h"   /* for PaUtil_GetTime() */
 
@@ -61,24 +62,58 @@ void PaUtil_InitializeCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double s
 {
     assert( sampleRate > 0 );
 
+    memset( measurer, 0, sizeof(PaUtilCpuLoadMeasurer) );
     measurer->samplingPeriod = 1. / sampleRate;
     measurer->averageLoad = 0.;
 }
 
+void PaUtil_InitializeStageCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double sampleRate )
+{
+    PaUtil_InitializeCpuLoadMeasurer( measurer, sampleRate );
+    measurer->measuresStages = 1;
+}
+
 void PaUtil_ResetCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer )
 {
+    int i;
+
     measurer->averageLoad = 0.;
+    measurer->averageThreadLoad = 0.;
+    for( i = 0; i < paUtilCpuLoadStageCount; ++i )
+        measurer->averageStageLoad[i] = 0.;
 }
 
 void PaUtil_BeginCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer )
 {
+    int i;
+
+    if( measurer->measuresStages )
+    {
+        measurer->measurementStartThreadTime = PaUtil_GetThreadCpuTime();
+        for( i = 0; i < paUtilCpuLoadStageCount; ++i )
+            measurer->stageDuration[i] = 0.;
+        measurer->stage = paUtilOtherCpuLoadStage;
+        measurer->measuring = 1;
+    }
+
     measurer->measurementStartTime = PaUtil_GetTime();
+    measurer->stageStartTime = measurer->measurementStartTime;
 }
 
 
+/* Low pass filter the calculated CPU load to reduce jitter using a simple IIR low pass filter. */
+/** FIXME @todo these coefficients shouldn't be hardwired see: http://www.portaudio.com/trac/ticket/113 */
+#define LOWPASS_COEFFICIENT_0   (0.9)
+#define LOWPASS_COEFFICIENT_1   (0.99999 - LOWPASS_COEFFICIENT_0)
+
+#define LOWPASS( average, measured ) \
+    ( (LOWPASS_COEFFICIENT_0 * (average)) + (LOWPASS_COEFFICIENT_1 * (measured)) )
+
+
 void PaUtil_EndCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer, unsigned long framesProcessed )
 {
-    double measurementEndTime, secondsFor100Percent, measuredLoad;
+    double measurementEndTime, secondsFor100Percent, measuredLoad, threadTime;
+    int i;
 
     if( framesProcessed > 0 ){
         measurementEndTime = PaUtil_GetTime();
@@ -88,14 +123,50 @@ void PaUtil_EndCpuLoadMeasurement( PaUtilCpuLoadMeasurer* measurer, unsigned lon
 
         measuredLoad = (measurementEndTime - measurer->measurementStartTime) / secondsFor100Percent;
 
-        /* Low pass filter the calculated CPU load to reduce jitter using a simple IIR low pass filter. */
-        /** FIXME @todo these coefficients shouldn't be hardwired see: http://www.portaudio.com/trac/ticket/113 */
-#define LOWPASS_COEFFICIENT_0   (0.9)
-#define LOWPASS_COEFFICIENT_1   (0.99999 - LOWPASS_COEFFICIENT_0)
-
-        measurer->averageLoad = (LOWPASS_COEFFICIENT_0 * measurer->averageLoad) +
-                               (LOWPASS_COEFFICIENT_1 * measuredLoad);
+        measurer->averageLoad = LOWPASS( measurer->averageLoad, measuredLoad );
+
+        if( measurer->measuresStages )
+        {
+            measurer->stageDuration[ measurer->stage ] += measurementEndTime - measurer->stageStartTime;
+            for( i = 0; i < paUtilCpuLoadStageCount; ++i )
+            {
+                measurer->averageStageLoad[i] = LOWPASS( measurer->averageStageLoad[i],
+                        measurer->stageDuration[i] / secondsFor100Percent );
+            }
+
+            if( measurer->measurementStartThreadTime >= 0. )
+            {
+                threadTime = PaUtil_GetThreadCpuTime() - measurer->measurementStartThreadTime;
+                measurer->averageThreadLoad = LOWPASS( measurer->averageThreadLoad,
+                        threadTime / secondsFor100Percent );
+            }
+        }
     }
+
+    measurer->measuring = 0;
+}
+
+
+PaUtilCpuLoadStage PaUtil_BeginCpuLoadStage( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStage stage )
+{
+    PaUtilCpuLoadStage previousStage = measurer->stage;
+    double now;
+
+    if( !measurer->measuring || stage == previousStage )
+        return previousStage;
+
+    now = PaUtil_GetTime();
+    measurer->stageDuration[ previousStage ] += now - measurer->stageStartTime;
+    measurer->stageStartTime = now;
+    measurer->stage = stage;
+
+    return previousStage;
+}
+
+
+void PaUtil_EndCpuLoadStage( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStage previousStage )
+{
+    PaUtil_BeginCpuLoadStage( measurer, previousStage );
 }
 
 
@@ -103,3 +174,15 @@ double PaUtil_GetCpuLoad( PaUtilCpuLoadMeasurer* measurer )
 {
     return measurer->averageLoad;
 }
+
+
+double PaUtil_GetCpuLoadOfStage( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStage stage )
+{
+    return measurer->averageStageLoad[ stage ];
+}
+
+
+double PaUtil_GetThreadCpuLoad( PaUtilCpuLoadMeasurer* measurer )
+{
+    return measurer->averageThreadLoad;
+}
@@ -53,10 +53,33 @@ extern "C"
 #endif /* __cplusplus */
 
 
+/** The stages a measurement can be divided into, see
+ PaUtil_BeginCpuLoadStage().
+*/
+typedef enum PaUtilCpuLoadStage
+{
+    paUtilOtherCpuLoadStage = 0,        /**< the time outside the stages below */
+    paUtilInputConversionCpuLoadStage,
+    paUtilCallbackCpuLoadStage,
+    paUtilOutputConversionCpuLoadStage,
+    paUtilCpuLoadStageCount
+} PaUtilCpuLoadStage;
+
+
 typedef struct {
     double samplingPeriod;
     double measurementStartTime;
     double averageLoad;
+
+    /* only used by measurers initialized with PaUtil_InitializeStageCpuLoadMeasurer() */
+    int measuresStages;
+    int measuring;                      /**< between Begin and EndCpuLoadMeasurement */
+    double measurementStartThreadTime;  /**< negative where thread times aren't available */
+    double averageThreadLoad;
+    PaUtilCpuLoadStage stage;
+    double stageStartTime;
+    double stageDuration[ paUtilCpuLoadStageCount ];
+    double averageStageLoad[ paUtilCpuLoadStageCount ];
 } PaUtilCpuLoadMeasurer; /**< @todo need better name than measurer */
 
 void PaUtil_InitializeCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double sampleRate );
@@ -66,6 +89,37 @@ void PaUtil_ResetCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer );
 double PaUtil_GetCpuLoad( PaUtilCpuLoadMeasurer* measurer );
 
 
+/** Initialize a measurer which, in addition to the wall clock load, divides
+ each measurement into the stages of PaUtilCpuLoadStage and measures the CPU
+ time of the measuring thread with PaUtil_GetThreadCpuTime(). A thread load
+ well below the wall clock load means the thread was preempted or blocked
+ while being measured.
+*/
+void PaUtil_InitializeStageCpuLoadMeasurer( PaUtilCpuLoadMeasurer* measurer, double sampleRate );
+
+/** Charge the time from now on to stage, until the next call, and return the
+ stage charged so far. Stages nest by passing the returned stage to
+ PaUtil_EndCpuLoadStage(). Does nothing outside a measurement and for
+ measurers without stages.
+*/
+PaUtilCpuLoadStage PaUtil_BeginCpuLoadStage( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStage stage );
+
+/** Charge the time from now on to previousStage again, as returned by the
+ matching PaUtil_BeginCpuLoadStage().
+*/
+void PaUtil_EndCpuLoadStage( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStage previousStage );
+
+/** Return the average load of a stage, the stage loads add up to
+ PaUtil_GetCpuLoad().
+*/
+double PaUtil_GetCpuLoadOfStage( PaUtilCpuLoadMeasurer* measurer, PaUtilCpuLoadStage stage );
+
+/** Return the average CPU time of the measuring thread relative to the
+ duration of the frames processed, 0 where thread times aren't available.
+*/
+double PaUtil_GetThreadCpuLoad( PaUtilCpuLoadMeasurer* measurer );
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */     
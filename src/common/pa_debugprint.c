@@ -48,12 +48,25 @@
 	"byte code/abi portable". So the technique used here is to allocate a local
 	a static array, write in it, then callback the user with a pointer to its
 	start.
+
+    In the deferred mode, started by Pa_Initialize() when PA_DEBUG_DEFERRED is
+    set in the environment, PaUtil_DebugPrint formats each message into a fixed
+    size record which it queues in a PaUtilMultiRingBuffer, without locks or
+    allocation. A detached thread writes the records out in order, so messages
+    printed by audio callbacks don't wait on stdio locks or a slow terminal.
+    Messages longer than a record are truncated, those which don't fit into a
+    full queue are dropped and reported as a count.
 */
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h> /* getenv() */
+#include <string.h> /* strcmp() */
 
 #include "pa_debugprint.h"
+#include "pa_util.h"
+#include "pa_ringbuffer.h"
+#include "pa_memorybarrier.h"
 
 // for OutputDebugStringA
 #if defined(_MSC_VER) && defined(PA_ENABLE_MSVC_DEBUG_OUTPUT)
@@ -85,8 +98,149 @@ void PaUtil_SetDebugPrintFunction(PaUtilLogCallback cb)
 
 #define PA_LOG_BUF_SIZE 2048
 
+// Deferred mode, a multiple of sizeof(unsigned long) so a record and its
+// sequence number fill a slot of the queue
+#define PA_LOG_RECORD_SIZE      (256)
+#define PA_LOG_RECORD_COUNT     (1024)
+#define PA_LOG_POLL_SECONDS     (.1)
+
+static PaUtilMultiRingBuffer deferredQueue;
+static unsigned long deferredStorage[ (PA_LOG_RECORD_SIZE / sizeof(unsigned long) + 1) * PA_LOG_RECORD_COUNT ];
+static PaUtilSemaphore *deferredReady = NULL;
+static PaUtilSemaphore *deferredDone = NULL;
+static volatile int deferredActive = 0;
+static volatile int deferredStopRequested = 0;
+static volatile unsigned long deferredDropped = 0;
+
+// Write a formatted message to the user callback or stderr
+static void OutputDebugText( const char *text )
+{
+#if defined(_MSC_VER) && defined(PA_ENABLE_MSVC_DEBUG_OUTPUT)
+	OutputDebugStringA(text);
+#endif
+
+    if (userCB != NULL)
+    {
+        userCB(text);
+    }
+    else
+    {
+        fputs(text, stderr);
+        fflush(stderr);
+    }
+}
+
+// Write out the queued records
+static void DrainDebugRecords( void )
+{
+    char record[PA_LOG_RECORD_SIZE];
+    char dropped[64];
+    unsigned long droppedCount;
+
+    while (PaUtil_ReadMultiRingBufferElement(&deferredQueue, record))
+        OutputDebugText(record);
+
+    droppedCount = deferredDropped;
+    if (droppedCount > 0)
+    {
+        deferredDropped -= droppedCount; // drops counted meanwhile are reported next time
+        sprintf(dropped, "PaUtil_DebugPrint: %lu messages dropped\n", droppedCount);
+        OutputDebugText(dropped);
+    }
+}
+
+static void DeferredDebugPrintThread( void *userData )
+{
+    int stopping;
+
+    (void)userData; /* unused parameter */
+
+    do
+    {
+        PaUtil_WaitSemaphore(deferredReady, PA_LOG_POLL_SECONDS);
+
+        // records queued before the stop request are drained below
+        stopping = deferredStopRequested;
+        PaUtil_ReadMemoryBarrier();
+
+        DrainDebugRecords();
+    }
+    while (!stopping);
+
+    PaUtil_PostSemaphore(deferredDone);
+}
+
+void PaUtil_InitializeDebugPrint( void )
+{
+    const char *deferred = getenv("PA_DEBUG_DEFERRED");
+
+    if (!deferred || !*deferred || strcmp(deferred, "0") == 0 || deferredActive)
+        return;
+
+    if (PaUtil_GetMultiRingBufferStorageSize(PA_LOG_RECORD_SIZE, PA_LOG_RECORD_COUNT) > (ring_buffer_size_t)sizeof(deferredStorage)
+            || PaUtil_InitializeMultiRingBuffer(&deferredQueue, PA_LOG_RECORD_SIZE, PA_LOG_RECORD_COUNT, deferredStorage) < 0)
+        return;
+
+    if (PaUtil_CreateSemaphore(&deferredReady) != paNoError)
+        goto error;
+    if (PaUtil_CreateSemaphore(&deferredDone) != paNoError)
+        goto error;
+
+    deferredStopRequested = 0;
+    deferredDropped = 0;
+    if (PaUtil_StartDetachedThread(DeferredDebugPrintThread, NULL) != paNoError)
+        goto error;
+
+    PaUtil_WriteMemoryBarrier();
+    deferredActive = 1;
+    return;
+
+error:
+    if (deferredReady)
+        PaUtil_DestroySemaphore(deferredReady);
+    if (deferredDone)
+        PaUtil_DestroySemaphore(deferredDone);
+    deferredReady = deferredDone = NULL;
+}
+
+void PaUtil_TerminateDebugPrint( void )
+{
+    if (!deferredActive)
+        return;
+
+    // later messages are printed directly, the queue's storage stays valid
+    // for callbacks which are still queueing one
+    deferredActive = 0;
+    PaUtil_WriteMemoryBarrier();
+    deferredStopRequested = 1;
+    PaUtil_PostSemaphore(deferredReady);
+
+    while (PaUtil_WaitSemaphore(deferredDone, 1.) != paNoError)
+        ;
+
+    PaUtil_DestroySemaphore(deferredReady);
+    PaUtil_DestroySemaphore(deferredDone);
+    deferredReady = deferredDone = NULL;
+}
+
 void PaUtil_DebugPrint( const char *format, ... )
 {
+    if (deferredActive)
+    {
+        char record[PA_LOG_RECORD_SIZE];
+        va_list ap;
+        va_start(ap, format);
+        VSNPRINTF(record, sizeof(record), format, ap);
+        record[sizeof(record)-1] = 0;
+        va_end(ap);
+
+        if (PaUtil_WriteMultiRingBufferElement(&deferredQueue, record))
+            PaUtil_PostSemaphore(deferredReady);
+        else
+            ++deferredDropped;
+        return;
+    }
+
 	// Optional logging into Output console of Visual Studio
 #if defined(_MSC_VER) && defined(PA_ENABLE_MSVC_DEBUG_OUTPUT)
 	{
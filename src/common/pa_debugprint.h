@@ -142,6 +142,19 @@ typedef void (*PaUtilLogCallback ) (const char *log);
 void PaUtil_SetDebugPrintFunction(PaUtilLogCallback  cb);
 
 
+/** Start the deferred mode if PA_DEBUG_DEFERRED is set in the environment:
+ PaUtil_DebugPrint() then queues the formatted message without blocking, and
+ a thread of its own passes it to the log function, so that messages may be
+ printed from audio callbacks. Called by Pa_Initialize().
+*/
+void PaUtil_InitializeDebugPrint( void );
+
+/** Write out the queued messages and return to printing them directly.
+ Called by Pa_Terminate().
+*/
+void PaUtil_TerminateDebugPrint( void );
+
+
 
 #ifdef __cplusplus
 }
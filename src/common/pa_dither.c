@@ -45,6 +45,11 @@
 #include "pa_types.h"
 #include "pa_dither.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PA_DITHER_SSE2_
+#include <emmintrin.h>
+#endif
+
 extern volatile int withAcceleration;
 
 PaInt16 accelBuff[DITHER_BUFF_SIZE];
@@ -70,6 +75,19 @@ void PaUtil_InitializeTriangularDitherState( PaUtilTriangularDitherGenerator *st
 }
 
 
+void PaUtil_InitializeNoiseShapedDitherState( PaUtilNoiseShapedDitherGenerator *state,
+        unsigned int channel )
+{
+    PaUtil_InitializeTriangularDitherState( &state->triangular );
+    /* any seed is on the full period of the LCG, so offsetting just starts
+       each channel at a different (far away) point of the same sequence */
+    state->triangular.randSeed1 += channel * 0x9E3779B9U;
+    state->triangular.randSeed2 += channel * 0x7F4A7C15U;
+    state->error1 = 0.0f;
+    state->error2 = 0.0f;
+}
+
+
 PaInt32 PaUtil_Generate16BitTriangularDither( PaUtilTriangularDitherGenerator *state )
 {
     if(withAcceleration)
@@ -144,6 +162,245 @@ float PaUtil_GenerateFloatTriangularDither24( PaUtilTriangularDitherGenerator *s
 }
 
 
+/*
+Block generation: the LCGs are run in PA_DITHER_LANES_ interleaved lanes,
+lane k producing every PA_DITHER_LANES_-th value starting at k. Each lane
+jumps ahead with a' = a^N, c' = c*(a^(N-1) + ... + a + 1). The lanes are
+independent so they map to vector registers, and the values are exactly
+the ones the single step functions above would produce.
+*/
+
+#define PA_DITHER_LANES_        (8)
+#define PA_DITHER_LCG_A_        (196314165)
+#define PA_DITHER_LCG_C_        (907633515)
+/* a^8 and c*(a^7 + ... + a + 1) mod 2^32 */
+#define PA_DITHER_LCG_JUMP_A_   (0x4d66b561UL)
+#define PA_DITHER_LCG_JUMP_C_   (0x16c0a8e8UL)
+
+
+static PaInt32 GenerateTriangularDither( PaUtilTriangularDitherGenerator *state )
+{
+    PaInt32 current, highPass;
+
+    state->randSeed1 = (state->randSeed1 * PA_DITHER_LCG_A_) + PA_DITHER_LCG_C_;
+    state->randSeed2 = (state->randSeed2 * PA_DITHER_LCG_A_) + PA_DITHER_LCG_C_;
+    current = (((PaInt32)state->randSeed1)>>DITHER_SHIFT_) +
+              (((PaInt32)state->randSeed2)>>DITHER_SHIFT_);
+    highPass = current - (PaInt32)state->previous;
+    state->previous = (PaUint32)current;
+    return highPass;
+}
+
+#if defined(PA_DITHER_SSE2_) || defined(__ARM_NEON__)
+
+/* seeds for the next PA_DITHER_LANES_ values */
+static void GetLaneSeeds( PaUint32 seed, PaUint32 *seeds )
+{
+    int i;
+    for( i=0; i<PA_DITHER_LANES_; i++ )
+    {
+        seed = (seed * PA_DITHER_LCG_A_) + PA_DITHER_LCG_C_;
+        seeds[i] = seed;
+    }
+}
+
+#endif
+
+#if defined(PA_DITHER_SSE2_)
+
+/* SSE2 has no pmulld */
+static __inline __m128i Sse2MultiplyLow32( __m128i a, __m128i b )
+{
+    __m128i even = _mm_mul_epu32( a, b );
+    __m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+    return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+            _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+/* generates whole multiples of PA_DITHER_LANES_ - returns the number generated */
+static unsigned int GenerateTriangularDitherLanes( PaUtilTriangularDitherGenerator *state,
+        PaInt32 *dither, unsigned int count )
+{
+    PaUint32 seeds[PA_DITHER_LANES_];
+    __m128i seeds1Low, seeds1High, seeds2Low, seeds2High, lastSeeds1, lastSeeds2;
+    __m128i currentLow, currentHigh;
+    __m128i jumpMult = _mm_set1_epi32( (int)PA_DITHER_LCG_JUMP_A_ );
+    __m128i jumpAdd = _mm_set1_epi32( (int)PA_DITHER_LCG_JUMP_C_ );
+    /* lane 3 is the one used */
+    __m128i previous = _mm_set1_epi32( (int)state->previous );
+    unsigned int blocks = count / PA_DITHER_LANES_;
+    unsigned int i;
+
+    GetLaneSeeds( state->randSeed1, seeds );
+    seeds1Low = _mm_loadu_si128( (const __m128i*)seeds );
+    seeds1High = _mm_loadu_si128( (const __m128i*)(seeds + 4) );
+    GetLaneSeeds( state->randSeed2, seeds );
+    seeds2Low = _mm_loadu_si128( (const __m128i*)seeds );
+    seeds2High = _mm_loadu_si128( (const __m128i*)(seeds + 4) );
+    lastSeeds1 = seeds1High;
+    lastSeeds2 = seeds2High;
+
+    for( i=0; i<blocks; i++ )
+    {
+        currentLow = _mm_add_epi32( _mm_srai_epi32( seeds1Low, DITHER_SHIFT_ ),
+                _mm_srai_epi32( seeds2Low, DITHER_SHIFT_ ) );
+        currentHigh = _mm_add_epi32( _mm_srai_epi32( seeds1High, DITHER_SHIFT_ ),
+                _mm_srai_epi32( seeds2High, DITHER_SHIFT_ ) );
+
+        /* high pass filter: subtract the value one lane before */
+        _mm_storeu_si128( (__m128i*)dither, _mm_sub_epi32( currentLow,
+                _mm_or_si128( _mm_slli_si128( currentLow, 4 ), _mm_srli_si128( previous, 12 ) ) ) );
+        _mm_storeu_si128( (__m128i*)(dither + 4), _mm_sub_epi32( currentHigh,
+                _mm_or_si128( _mm_slli_si128( currentHigh, 4 ), _mm_srli_si128( currentLow, 12 ) ) ) );
+        previous = currentHigh;
+
+        lastSeeds1 = seeds1High;
+        lastSeeds2 = seeds2High;
+        seeds1Low = _mm_add_epi32( Sse2MultiplyLow32( seeds1Low, jumpMult ), jumpAdd );
+        seeds1High = _mm_add_epi32( Sse2MultiplyLow32( seeds1High, jumpMult ), jumpAdd );
+        seeds2Low = _mm_add_epi32( Sse2MultiplyLow32( seeds2Low, jumpMult ), jumpAdd );
+        seeds2High = _mm_add_epi32( Sse2MultiplyLow32( seeds2High, jumpMult ), jumpAdd );
+        dither += PA_DITHER_LANES_;
+    }
+
+    /* state of the last value generated */
+    state->randSeed1 = (PaUint32)_mm_cvtsi128_si32( _mm_srli_si128( lastSeeds1, 12 ) );
+    state->randSeed2 = (PaUint32)_mm_cvtsi128_si32( _mm_srli_si128( lastSeeds2, 12 ) );
+    state->previous = (PaUint32)_mm_cvtsi128_si32( _mm_srli_si128( previous, 12 ) );
+    return blocks * PA_DITHER_LANES_;
+}
+
+#elif defined(__ARM_NEON__)
+
+/* generates whole multiples of PA_DITHER_LANES_ - returns the number generated */
+static unsigned int GenerateTriangularDitherLanes( PaUtilTriangularDitherGenerator *state,
+        PaInt32 *dither, unsigned int count )
+{
+    PaUint32 seeds[PA_DITHER_LANES_];
+    uint32x4_t seeds1Low, seeds1High, seeds2Low, seeds2High, lastSeeds1, lastSeeds2;
+    int32x4_t currentLow, currentHigh;
+    uint32x4_t jumpMult = vdupq_n_u32( PA_DITHER_LCG_JUMP_A_ );
+    uint32x4_t jumpAdd = vdupq_n_u32( PA_DITHER_LCG_JUMP_C_ );
+    /* lane 3 is the one used */
+    int32x4_t previous = vdupq_n_s32( (PaInt32)state->previous );
+    unsigned int blocks = count / PA_DITHER_LANES_;
+    unsigned int i;
+
+    GetLaneSeeds( state->randSeed1, seeds );
+    seeds1Low = vld1q_u32( seeds );
+    seeds1High = vld1q_u32( seeds + 4 );
+    GetLaneSeeds( state->randSeed2, seeds );
+    seeds2Low = vld1q_u32( seeds );
+    seeds2High = vld1q_u32( seeds + 4 );
+    lastSeeds1 = seeds1High;
+    lastSeeds2 = seeds2High;
+
+    for( i=0; i<blocks; i++ )
+    {
+        currentLow = vaddq_s32( vshrq_n_s32( vreinterpretq_s32_u32( seeds1Low ), DITHER_SHIFT_ ),
+                vshrq_n_s32( vreinterpretq_s32_u32( seeds2Low ), DITHER_SHIFT_ ) );
+        currentHigh = vaddq_s32( vshrq_n_s32( vreinterpretq_s32_u32( seeds1High ), DITHER_SHIFT_ ),
+                vshrq_n_s32( vreinterpretq_s32_u32( seeds2High ), DITHER_SHIFT_ ) );
+
+        /* high pass filter: subtract the value one lane before */
+        vst1q_s32( dither, vsubq_s32( currentLow, vextq_s32( previous, currentLow, 3 ) ) );
+        vst1q_s32( dither + 4, vsubq_s32( currentHigh, vextq_s32( currentLow, currentHigh, 3 ) ) );
+        previous = currentHigh;
+
+        lastSeeds1 = seeds1High;
+        lastSeeds2 = seeds2High;
+        /* vmla(a,b,c) <-> a+b*c */
+        seeds1Low = vmlaq_u32( jumpAdd, seeds1Low, jumpMult );
+        seeds1High = vmlaq_u32( jumpAdd, seeds1High, jumpMult );
+        seeds2Low = vmlaq_u32( jumpAdd, seeds2Low, jumpMult );
+        seeds2High = vmlaq_u32( jumpAdd, seeds2High, jumpMult );
+        dither += PA_DITHER_LANES_;
+    }
+
+    /* state of the last value generated */
+    state->randSeed1 = vgetq_lane_u32( lastSeeds1, 3 );
+    state->randSeed2 = vgetq_lane_u32( lastSeeds2, 3 );
+    state->previous = (PaUint32)vgetq_lane_s32( previous, 3 );
+    return blocks * PA_DITHER_LANES_;
+}
+
+#endif
+
+
+static void GenerateTriangularDitherBlock( PaUtilTriangularDitherGenerator *state,
+        PaInt32 *dither, unsigned int count )
+{
+#if defined(PA_DITHER_SSE2_) || defined(__ARM_NEON__)
+    if( count >= PA_DITHER_LANES_ )
+    {
+        unsigned int generated = GenerateTriangularDitherLanes( state, dither, count );
+        dither += generated;
+        count -= generated;
+    }
+#endif
+
+    while( count-- )
+        *dither++ = GenerateTriangularDither( state );
+}
+
+
+void PaUtil_Generate16BitTriangularDitherBlock( PaUtilTriangularDitherGenerator *state,
+        PaInt32 *dither, unsigned int count )
+{
+    if(withAcceleration)
+    {
+        /* same values PaUtil_Generate16BitTriangularDither would return */
+        while( count-- )
+        {
+            *dither++ = (PaInt32)accelBuff[state->posInAccelBuff];
+            state->posInAccelBuff++;
+            if(state->posInAccelBuff >= DITHER_BUFF_SIZE)
+                state->posInAccelBuff = 0;
+        }
+        return;
+    }
+    GenerateTriangularDitherBlock( state, dither, count );
+}
+
+
+void PaUtil_GenerateFloatTriangularDitherBlock( PaUtilTriangularDitherGenerator *state,
+        float *dither, unsigned int count )
+{
+    PaInt32 highPass[PA_DITHER_BLOCK_SIZE];
+
+    while( count > 0 )
+    {
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        GenerateTriangularDitherBlock( state, highPass, n );
+        for( i=0; i<n; i++ )
+            dither[i] = ((float)highPass[i]) * const_float_dither_scale_;
+
+        dither += n;
+        count -= n;
+    }
+}
+
+
+void PaUtil_GenerateFloatTriangularDither24Block( PaUtilTriangularDitherGenerator *state,
+        float *dither, unsigned int count )
+{
+    PaInt32 highPass[PA_DITHER_BLOCK_SIZE];
+
+    while( count > 0 )
+    {
+        unsigned int i, n = count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE;
+
+        GenerateTriangularDitherBlock( state, highPass, n );
+        for( i=0; i<n; i++ )
+            dither[i] = ((float)highPass[i]) * (const_float_dither_scale_ * 256.0);
+
+        dither += n;
+        count -= n;
+    }
+}
+
+
 /*
 The following alternate dither algorithms (from musicdsp.org) could be
 considered
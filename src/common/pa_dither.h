@@ -111,6 +111,58 @@ float PaUtil_GenerateFloatTriangularDither( PaUtilTriangularDitherGenerator *dit
 float PaUtil_GenerateFloatTriangularDither24( PaUtilTriangularDitherGenerator *ditherState );
 
 
+/** @brief State needed to generate noise shaped dither for one channel.
+
+ The triangular generator must remain the first member - noise shaping
+ converters are passed a pointer to it in place of a plain generator.
+*/
+typedef struct PaUtilNoiseShapedDitherGenerator{
+    PaUtilTriangularDitherGenerator triangular;
+    float error1;   /**< error feedback buffers, in LSB */
+    float error2;
+} PaUtilNoiseShapedDitherGenerator;
+
+
+/** @brief Initialize noise shaped dither state
+
+ @param channel Index of the channel the state is used for. Each channel gets
+ differently seeded dither so the noise is not correlated between channels.
+*/
+void PaUtil_InitializeNoiseShapedDitherState( PaUtilNoiseShapedDitherGenerator *ditherState,
+        unsigned int channel );
+
+
+/** Number of dither values converters should request per block call, also
+ the amount of stack the float block functions use internally.
+*/
+#define PA_DITHER_BLOCK_SIZE 64
+
+/**
+ @brief Block versions of the dither generators above.
+
+ Fill dither with count values - the same values count calls of the single
+ value function would return, in the same order, and leave ditherState in
+ the same state. The generator runs in several independent lanes so these
+ are considerably faster than calling the single value versions in a loop.
+<pre>
+    float dither[PA_DITHER_BLOCK_SIZE];
+    PaUtil_GenerateFloatTriangularDitherBlock( ditherState, dither, n );
+    for( i=0; i<n; i++ )
+        out[i] = (signed short)(in[i]*(32766.0f) + dither[i]);
+</pre>
+*/
+void PaUtil_Generate16BitTriangularDitherBlock( PaUtilTriangularDitherGenerator *ditherState,
+        PaInt32 *dither, unsigned int count );
+
+/** @see PaUtil_Generate16BitTriangularDitherBlock */
+void PaUtil_GenerateFloatTriangularDitherBlock( PaUtilTriangularDitherGenerator *ditherState,
+        float *dither, unsigned int count );
+
+/** @see PaUtil_Generate16BitTriangularDitherBlock */
+void PaUtil_GenerateFloatTriangularDither24Block( PaUtilTriangularDitherGenerator *ditherState,
+        float *dither, unsigned int count );
+
+
 /* Note that the linear congruential algorithm requires 32 bit integers
  * because it uses arithmetic overflow. So use PaUint32 instead of
  * unsigned long so it will work on 64 bit systems.
@@ -136,6 +188,21 @@ static inline float32x4_t PaUtil_GenerateFloatTriangularDitherVector(
         state->posInAccelBuff += ARM_NEON_BEST_VECTOR_SIZE;
     return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(neonDither16)), ditherScale);
 }
+
+/* Vector version of PaUtil_Generate16BitTriangularDither */
+static inline int32x4_t PaUtil_Generate16BitTriangularDitherVector(
+    PaUtilTriangularDitherGenerator *state)
+{
+    int16x4_t neonDither16;
+    /* scalar tails can leave us unaligned - do not read beyond buffer */
+    if(state->posInAccelBuff > DITHER_BUFF_SIZE - ARM_NEON_BEST_VECTOR_SIZE)
+        state->posInAccelBuff = 0;
+    neonDither16 = vld1_s16(accelBuff + state->posInAccelBuff);
+    state->posInAccelBuff += ARM_NEON_BEST_VECTOR_SIZE;
+    if(state->posInAccelBuff >= DITHER_BUFF_SIZE)
+        state->posInAccelBuff = 0;
+    return vmovl_s16(neonDither16);
+}
 #endif
 
 
@@ -67,15 +67,25 @@
 #include <string.h>
 #include <stdlib.h> /* needed for strtol() */
 #include <assert.h> /* needed by PA_VALIDATE_ENDIANNESS */
+#include <ctype.h> /* needed for tolower() */
 
 #include "portaudio.h"
 #include "pa_util.h"
+#include "pa_converters.h"
 #include "pa_endianness.h"
 #include "pa_types.h"
 #include "pa_hostapi.h"
 #include "pa_stream.h"
+#include "pa_streamclock.h"
+#include "pa_streamstats.h"
+#include "pa_streamtap.h"
+#include "pa_memorybarrier.h"
 #include "pa_trace.h" /* still usefull?*/
 #include "pa_debugprint.h"
+#include "pa_headroom.h"
+#include "pa_levelmeter.h"
+#include "pa_process.h"
+#include "pa_probes.h"
 
 #ifndef PA_GIT_REVISION
 #include "pa_gitrevision.h"
@@ -159,7 +169,81 @@ static int defaultHostApiIndex_ = 0;
 static int initializationCount_ = 0;
 static int deviceCount_ = 0;
 
-PaUtilStreamRepresentation *firstOpenStream_ = NULL;
+/* The index in hostApis_ of the host API of each device, indexed by
+   PaDeviceIndex, so that FindHostApi() takes constant time. Replaced as a
+   whole whenever the devices are renumbered. */
+static int *deviceHostApis_ = 0;
+
+/* Open streams are kept in a table of slots. Each stream remembers its slot
+   and the slot's generation, which is incremented whenever a stream leaves
+   the slot, so adding, removing and validating a stream take constant time.
+   The slots are allocated in pages which stay in place until Pa_Terminate(),
+   PaUtil_ValidateStreamPointer() reads them without taking openStreamLock_,
+   which serializes streams being opened and closed on several threads. */
+
+#define PA_OPEN_STREAM_SLOTS_PER_PAGE_  (64)
+#define PA_MAX_OPEN_STREAM_PAGES_       (256)
+
+typedef struct PaOpenStreamSlot
+{
+    PaUtilStreamRepresentation * volatile stream; /* NULL if free */
+    unsigned long generation;
+    int nextFreeSlot;                   /* -1 at the end of the free list */
+} PaOpenStreamSlot;
+
+static PaOpenStreamSlot * volatile openStreamPages_[ PA_MAX_OPEN_STREAM_PAGES_ ];
+static int openStreamPageCount_ = 0;
+static int firstFreeOpenStreamSlot_ = -1;
+static PaUtilSemaphore *openStreamLock_ = NULL;
+
+/* Pa_OpenStreamInArena() points currentStreamArena_ of the opening thread at
+   the caller's arena while the stream is opened, PaUtil_AllocateMemory() then
+   takes its blocks from there. The arenas of open streams are registered in
+   streamArenas_ so that PaUtil_FreeMemory() leaves their blocks alone on any
+   thread. The registry is written under openStreamLock_ and read without
+   it. Pa_GetOpenStreamArenaSize() uses a measuring arena, which only adds up
+   the sizes of the blocks allocated from the heap. */
+
+#if defined(__GNUC__)
+#   define PA_THREAD_LOCAL_                             __thread
+#elif defined(_MSC_VER)
+#   define PA_THREAD_LOCAL_                             __declspec(thread)
+#endif
+
+#define PA_STREAM_ARENA_ALIGNMENT_      (16)
+#define PA_MAX_STREAM_ARENAS_           (64)
+
+typedef struct PaStreamArena
+{
+    char *next;
+    char *end;
+    int measuring;
+    unsigned long measured;
+} PaStreamArena;
+
+typedef struct PaStreamArenaRange
+{
+    char * volatile begin;              /* NULL if free */
+    char * volatile end;
+} PaStreamArenaRange;
+
+#ifdef PA_THREAD_LOCAL_
+static PA_THREAD_LOCAL_ PaStreamArena *currentStreamArena_ = NULL;
+#endif
+static PaStreamArenaRange streamArenas_[ PA_MAX_STREAM_ARENAS_ ];
+
+static PaDeviceChangeCallback *deviceChangeCallback_ = NULL;
+static void *deviceChangeUserData_ = NULL;
+
+/* With Pa_RetainDevicesOnTerminate( 1 ) the host APIs stay initialized when
+   Pa_Terminate() terminates PortAudio, hostApisRetained_ is set until the
+   next Pa_Initialize() reuses them. Their device change notifications stay
+   enabled meanwhile, so that only host APIs whose devices changed are
+   enumerated again. hostApiSelection_ flags the initializers which were
+   selected, retained host APIs are only reused for the same selection. */
+static int retainDevices_ = 0;
+static int hostApisRetained_ = 0;
+static unsigned char *hostApiSelection_ = 0;
 
 
 #define PA_IS_INITIALISED_ (initializationCount_ != 0)
@@ -183,12 +267,23 @@ static void TerminateHostApis( void )
     while( hostApisCount_ > 0 )
     {
         --hostApisCount_;
+        if( hostApis_[hostApisCount_]->privatePaFrontInfo.lock )
+            PaUtil_DestroySemaphore( hostApis_[hostApisCount_]->privatePaFrontInfo.lock );
         hostApis_[hostApisCount_]->Terminate( hostApis_[hostApisCount_] );
     }
     hostApisCount_ = 0;
     defaultHostApiIndex_ = 0;
     deviceCount_ = 0;
 
+    if( deviceHostApis_ != 0 )
+        PaUtil_FreeMemory( deviceHostApis_ );
+    deviceHostApis_ = 0;
+
+    if( hostApiSelection_ != 0 )
+        PaUtil_FreeMemory( hostApiSelection_ );
+    hostApiSelection_ = 0;
+    hostApisRetained_ = 0;
+
     if( hostApis_ != 0 )
         PaUtil_FreeMemory( hostApis_ );
     hostApis_ = 0;
@@ -197,66 +292,332 @@ static void TerminateHostApis( void )
 }
 
 
-static PaError InitializeHostApis( void )
+int PaUtil_GetInitializationThreadCount( void )
+{
+    const char *threads = getenv( "PA_INITIALIZATION_THREADS" );
+    int result = threads ? atoi( threads ) : 1;
+
+    return result > 1 ? result : 1;
+}
+
+
+/* Number the devices of the host API at hostApiIndex of hostApis_ from
+   *baseDeviceIndex on, converting its default devices from host API
+   specific indices, and make it the default host API if it is the first
+   with a default device */
+static void NumberHostApiDevices( PaUtilHostApiRepresentation *hostApi,
+        int hostApiIndex, int *baseDeviceIndex )
+{
+    int i;
+
+    assert( hostApi->info.defaultInputDevice < hostApi->info.deviceCount );
+    assert( hostApi->info.defaultOutputDevice < hostApi->info.deviceCount );
+
+    /* host APIs initialized in parallel were passed their position among
+       the initializers, which is too large if earlier ones were not found */
+    for( i=0; i < hostApi->info.deviceCount; ++i )
+        hostApi->deviceInfos[i]->hostApi = hostApiIndex;
+
+    /* the first successfully initialized host API with a default input *or*
+       output device is used as the default host API.
+    */
+    if( (defaultHostApiIndex_ == -1) &&
+            ( hostApi->info.defaultInputDevice != paNoDevice
+                || hostApi->info.defaultOutputDevice != paNoDevice ) )
+    {
+        defaultHostApiIndex_ = hostApiIndex;
+    }
+
+    hostApi->privatePaFrontInfo.baseDeviceIndex = *baseDeviceIndex;
+
+    if( hostApi->info.defaultInputDevice != paNoDevice )
+        hostApi->info.defaultInputDevice += *baseDeviceIndex;
+
+    if( hostApi->info.defaultOutputDevice != paNoDevice )
+        hostApi->info.defaultOutputDevice += *baseDeviceIndex;
+
+    *baseDeviceIndex += hostApi->info.deviceCount;
+    deviceCount_ += hostApi->info.deviceCount;
+}
+
+
+/* Allocate a table for deviceHostApis_ of deviceCount devices */
+static int *AllocateDeviceHostApis( int deviceCount )
+{
+    /* one entry more, so that a table of no devices is allocated as well */
+    return (int*)PaUtil_AllocateMemory( sizeof(int) * (deviceCount + 1) );
+}
+
+
+/* Fill a table of AllocateDeviceHostApis( deviceCount_ ) from the
+   numbered devices of hostApis_, and make it deviceHostApis_ */
+static void SetDeviceHostApis( int *table )
+{
+    int i, j, device = 0;
+
+    for( i=0; i < hostApisCount_; ++i )
+    {
+        for( j=0; j < hostApis_[i]->info.deviceCount; ++j )
+            table[ device++ ] = i;
+    }
+    assert( device == deviceCount_ );
+
+    if( deviceHostApis_ != 0 )
+        PaUtil_FreeMemory( deviceHostApis_ );
+    deviceHostApis_ = table;
+}
+
+
+/* Append an initialized host API to hostApis_ and number its devices */
+static void AddHostApi( PaUtilHostApiRepresentation *hostApi, int *baseDeviceIndex )
+{
+    NumberHostApiDevices( hostApi, hostApisCount_, baseDeviceIndex );
+    hostApi->privatePaFrontInfo.lock = NULL; /* created by CreateHostApiLocks() */
+    hostApi->privatePaFrontInfo.notifying = 0;
+    hostApi->privatePaFrontInfo.deviceChangeCount = 0;
+    hostApi->privatePaFrontInfo.enumeratedDeviceChangeCount = 0;
+
+    hostApis_[hostApisCount_++] = hostApi;
+}
+
+
+/* The names PA_HOSTAPIS selects host APIs by */
+static const struct
+{
+    const char *name;
+    PaHostApiTypeId type;
+}
+hostApiTypeNames_[] =
+{
+    { "DirectSound", paDirectSound },
+    { "MME", paMME },
+    { "ASIO", paASIO },
+    { "SoundManager", paSoundManager },
+    { "CoreAudio", paCoreAudio },
+    { "OSS", paOSS },
+    { "ALSA", paALSA },
+    { "AL", paAL },
+    { "BeOS", paBeOS },
+    { "WDMKS", paWDMKS },
+    { "JACK", paJACK },
+    { "WASAPI", paWASAPI },
+    { "ASIHPI", paAudioScienceHPI },
+    { "InDevelopment", paInDevelopment }
+};
+
+#define PA_HOST_API_TYPE_NAME_COUNT_ ((int)(sizeof(hostApiTypeNames_) / sizeof(hostApiTypeNames_[0])))
+
+
+/* Compare the length characters of name to the NUL terminated typeName,
+   ignoring case */
+static int MatchHostApiTypeName( const char *name, size_t length, const char *typeName )
+{
+    size_t i;
+
+    for( i=0; i < length; ++i )
+    {
+        if( !typeName[i] || tolower( (unsigned char)name[i] ) != tolower( (unsigned char)typeName[i] ) )
+            return 0;
+    }
+    return typeName[length] == '\0';
+}
+
+
+/* Parse the comma or space separated host API names of PA_HOSTAPIS into
+   types, which has room for PA_HOST_API_TYPE_NAME_COUNT_ of them. Returns the
+   number of types, or -1 if PA_HOSTAPIS isn't set or empty. */
+static int GetHostApiTypesFromEnvironment( PaHostApiTypeId *types )
+{
+    const char *names = getenv( "PA_HOSTAPIS" );
+    int count = 0, i, j;
+    size_t length;
+
+    if( !names || !*names )
+        return -1;
+
+    while( *names )
+    {
+        length = strcspn( names, ", " );
+        for( i=0; i < PA_HOST_API_TYPE_NAME_COUNT_; ++i )
+        {
+            if( length > 0 && MatchHostApiTypeName( names, length, hostApiTypeNames_[i].name ) )
+                break;
+        }
+
+        if( i < PA_HOST_API_TYPE_NAME_COUNT_ )
+        {
+            for( j=0; j < count && types[j] != hostApiTypeNames_[i].type; ++j )
+                ;
+            if( j == count )
+                types[count++] = hostApiTypeNames_[i].type;
+        }
+        else if( length > 0 )
+        {
+            PA_DEBUG(( "PA_HOSTAPIS: ignoring unknown host API %.*s.\n", (int)length, names ));
+        }
+
+        names += length;
+        names += strspn( names, ", " );
+    }
+
+    return count;
+}
+
+
+/* The host APIs to initialize, all if hostApiTypes is NULL */
+typedef struct
+{
+    const PaHostApiTypeId *hostApiTypes;
+    int hostApiTypeCount;
+}
+PaHostApiSelection;
+
+
+static int IsHostApiSelected( const PaHostApiSelection *selection, int initializer )
+{
+    int i;
+
+    if( !selection->hostApiTypes )
+        return 1;
+
+    for( i=0; i < selection->hostApiTypeCount; ++i )
+    {
+        if( selection->hostApiTypes[i] == paHostApiInitializerTypes[initializer] )
+            return 1;
+    }
+    return 0;
+}
+
+
+typedef struct
+{
+    int initializerCount;
+    const PaHostApiSelection *selection;
+    PaError *results;
+}
+PaHostApiInitializationJob;
+
+
+/* Initialize every workerCount'th host API, starting with the worker's
+   index, into the slot of hostApis_ of the same index */
+static void InitializeHostApisJob( void *userData, int worker, int workerCount )
+{
+    PaHostApiInitializationJob *job = (PaHostApiInitializationJob*)userData;
+    int i;
+
+    for( i=worker; i < job->initializerCount; i += workerCount )
+    {
+        hostApis_[i] = NULL;
+        job->results[i] = paNoError;
+
+        if( !IsHostApiSelected( job->selection, i ) )
+            continue;
+
+        PA_DEBUG(( "before paHostApiInitializers[%d] on worker %d.\n", i, worker ));
+
+        job->results[i] = paHostApiInitializers[i]( &hostApis_[i], i );
+
+        PA_DEBUG(( "after paHostApiInitializers[%d] on worker %d.\n", i, worker ));
+    }
+}
+
+
+/* Initialize the host APIs on a worker pool, each with the index it would
+   have if all were found */
+static PaError InitializeHostApisOnWorkerPool( PaUtilWorkerPool *pool, int initializerCount,
+        const PaHostApiSelection *selection, int *baseDeviceIndex )
+{
+    PaError result = paNoError;
+    PaHostApiInitializationJob job;
+    int i;
+
+    job.initializerCount = initializerCount;
+    job.selection = selection;
+    job.results = (PaError*)PaUtil_AllocateMemory( sizeof(PaError) * initializerCount );
+    if( !job.results )
+        return paInsufficientMemory;
+
+    PaUtil_RunWorkerPool( pool, InitializeHostApisJob, &job );
+
+    /* report the first failure, as sequential initialization would have */
+    for( i=0; i < initializerCount; ++i )
+    {
+        if( job.results[i] != paNoError && result == paNoError )
+            result = job.results[i];
+    }
+
+    for( i=0; i < initializerCount; ++i )
+    {
+        if( !hostApis_[i] || job.results[i] != paNoError )
+            continue;
+
+        if( result != paNoError )
+            hostApis_[i]->Terminate( hostApis_[i] );
+        else
+            AddHostApi( hostApis_[i], baseDeviceIndex );
+    }
+
+    PaUtil_FreeMemory( job.results );
+    return result;
+}
+
+
+static PaError InitializeHostApis( const PaHostApiSelection *selection )
 {
     PaError result = paNoError;
-    int i, initializerCount, baseDeviceIndex;
+    int i, initializerCount, baseDeviceIndex, threadCount;
+    int *table;
+    PaUtilWorkerPool *pool = NULL;
 
     initializerCount = CountHostApiInitializers();
 
     hostApis_ = (PaUtilHostApiRepresentation**)PaUtil_AllocateMemory(
             sizeof(PaUtilHostApiRepresentation*) * initializerCount );
-    if( !hostApis_ )
+    hostApiSelection_ = (unsigned char*)PaUtil_AllocateMemory( initializerCount + 1 );
+    if( !hostApis_ || !hostApiSelection_ )
     {
         result = paInsufficientMemory;
         goto error;
     }
 
+    for( i=0; i < initializerCount; ++i )
+        hostApiSelection_[i] = (unsigned char)IsHostApiSelected( selection, i );
+
     hostApisCount_ = 0;
     defaultHostApiIndex_ = -1; /* indicates that we haven't determined the default host API yet */
     deviceCount_ = 0;
     baseDeviceIndex = 0;
 
-    for( i=0; i< initializerCount; ++i )
+    /* without a worker pool on this platform host APIs are initialized in turn */
+    threadCount = PaUtil_GetInitializationThreadCount();
+    if( threadCount > initializerCount )
+        threadCount = initializerCount;
+    if( threadCount > 1 && PaUtil_CreateWorkerPool( &pool, threadCount, 0, NULL, 0 ) == paNoError )
     {
-        hostApis_[hostApisCount_] = NULL;
-
-        PA_DEBUG(( "before paHostApiInitializers[%d].\n",i));
-
-        result = paHostApiInitializers[i]( &hostApis_[hostApisCount_], hostApisCount_ );
+        result = InitializeHostApisOnWorkerPool( pool, initializerCount, selection, &baseDeviceIndex );
+        PaUtil_DestroyWorkerPool( pool );
         if( result != paNoError )
             goto error;
-
-        PA_DEBUG(( "after paHostApiInitializers[%d].\n",i));
-
-        if( hostApis_[hostApisCount_] )
+    }
+    else
+    {
+        for( i=0; i< initializerCount; ++i )
         {
-            PaUtilHostApiRepresentation* hostApi = hostApis_[hostApisCount_];
-            assert( hostApi->info.defaultInputDevice < hostApi->info.deviceCount );
-            assert( hostApi->info.defaultOutputDevice < hostApi->info.deviceCount );
-
-            /* the first successfully initialized host API with a default input *or*
-               output device is used as the default host API.
-            */
-            if( (defaultHostApiIndex_ == -1) &&
-                    ( hostApi->info.defaultInputDevice != paNoDevice
-                        || hostApi->info.defaultOutputDevice != paNoDevice ) )
-            {
-                defaultHostApiIndex_ = hostApisCount_;
-            }
+            PaUtilHostApiRepresentation *hostApi = NULL;
 
-            hostApi->privatePaFrontInfo.baseDeviceIndex = baseDeviceIndex;
+            if( !IsHostApiSelected( selection, i ) )
+                continue;
 
-            if( hostApi->info.defaultInputDevice != paNoDevice )
-                hostApi->info.defaultInputDevice += baseDeviceIndex;
+            PA_DEBUG(( "before paHostApiInitializers[%d].\n",i));
 
-            if( hostApi->info.defaultOutputDevice != paNoDevice )
-                hostApi->info.defaultOutputDevice += baseDeviceIndex;
+            result = paHostApiInitializers[i]( &hostApi, hostApisCount_ );
+            if( result != paNoError )
+                goto error;
 
-            baseDeviceIndex += hostApi->info.deviceCount;
-            deviceCount_ += hostApi->info.deviceCount;
+            PA_DEBUG(( "after paHostApiInitializers[%d].\n",i));
 
-            ++hostApisCount_;
+            if( hostApi )
+                AddHostApi( hostApi, &baseDeviceIndex );
         }
     }
 
@@ -264,6 +625,14 @@ static PaError InitializeHostApis( void )
     if( defaultHostApiIndex_ == -1 )
         defaultHostApiIndex_ = 0;
 
+    table = AllocateDeviceHostApis( deviceCount_ );
+    if( !table )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+    SetDeviceHostApis( table );
+
     return result;
 
 error:
@@ -281,1226 +650,2728 @@ error:
 */
 static int FindHostApi( PaDeviceIndex device, int *hostSpecificDeviceIndex )
 {
-    int i=0;
+    int i;
 
     if( !PA_IS_INITIALISED_ )
         return -1;
 
-    if( device < 0 )
+    if( device < 0 || device >= deviceCount_ )
         return -1;
 
-    while( i < hostApisCount_
-            && device >= hostApis_[i]->info.deviceCount )
-    {
-
-        device -= hostApis_[i]->info.deviceCount;
-        ++i;
-    }
-
-    if( i >= hostApisCount_ )
-        return -1;
+    i = deviceHostApis_[ device ];
 
     if( hostSpecificDeviceIndex )
-        *hostSpecificDeviceIndex = device;
+        *hostSpecificDeviceIndex = device - hostApis_[i]->privatePaFrontInfo.baseDeviceIndex;
 
     return i;
 }
 
 
-static void AddOpenStream( PaStream* stream )
+/* The front end's locks are binary semaphores, posted while unlocked, as
+   pa_util.h has semaphores on every platform */
+static PaError CreateLock( PaUtilSemaphore **lock )
 {
-    ((PaUtilStreamRepresentation*)stream)->nextOpenStream = firstOpenStream_;
-    firstOpenStream_ = (PaUtilStreamRepresentation*)stream;
+    PaError result = PaUtil_CreateSemaphore( lock );
+    if( result == paNoError )
+        PaUtil_PostSemaphore( *lock );
+    return result;
 }
 
 
-static void RemoveOpenStream( PaStream* stream )
+static void Lock( PaUtilSemaphore *lock )
 {
-    PaUtilStreamRepresentation *previous = NULL;
-    PaUtilStreamRepresentation *current = firstOpenStream_;
+    while( PaUtil_WaitSemaphore( lock, 1. ) != paNoError )
+        ;
+}
 
-    while( current != NULL )
-    {
-        if( ((PaStream*)current) == stream )
-        {
-            if( previous == NULL )
-            {
-                firstOpenStream_ = current->nextOpenStream;
-            }
-            else
-            {
-                previous->nextOpenStream = current->nextOpenStream;
-            }
-            return;
-        }
-        else
-        {
-            previous = current;
-            current = current->nextOpenStream;
-        }
-    }
+
+static void Unlock( PaUtilSemaphore *lock )
+{
+    PaUtil_PostSemaphore( lock );
 }
 
 
-static void CloseOpenStreams( void )
+static PaError CreateHostApiLocks( void )
 {
-    /* we call Pa_CloseStream() here to ensure that the same destruction
-        logic is used for automatically closed streams */
+    PaError result = paNoError;
+    int i;
 
-    while( firstOpenStream_ != NULL )
-        Pa_CloseStream( firstOpenStream_ );
+    for( i=0; i < hostApisCount_ && result == paNoError; ++i )
+        result = CreateLock( &hostApis_[i]->privatePaFrontInfo.lock );
+
+    return result;
 }
 
 
-PaError Pa_Initialize( void )
+static PaError InitializeOpenStreams( void )
 {
-    PaError result;
+    return CreateLock( &openStreamLock_ );
+}
 
-    PA_LOGAPI_ENTER( "Pa_Initialize" );
 
-    if( PA_IS_INITIALISED_ )
+static void TerminateOpenStreams( void )
+{
+    int i;
+
+    for( i=0; i < openStreamPageCount_; ++i )
     {
-        ++initializationCount_;
-        result = paNoError;
+        PaUtil_FreeMemory( openStreamPages_[i] );
+        openStreamPages_[i] = NULL;
     }
-    else
-    {
-        PA_VALIDATE_TYPE_SIZES;
-        PA_VALIDATE_ENDIANNESS;
-
-        PaUtil_InitializeClock();
-        PaUtil_ResetTraceMessages();
+    openStreamPageCount_ = 0;
+    firstFreeOpenStreamSlot_ = -1;
 
-        result = InitializeHostApis();
-        if( result == paNoError )
-            ++initializationCount_;
-    }
+    PaUtil_DestroySemaphore( openStreamLock_ );
+    openStreamLock_ = NULL;
+}
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_Initialize", result );
 
-    return result;
+static PaOpenStreamSlot *GetOpenStreamSlot( int slot )
+{
+    return &openStreamPages_[ slot / PA_OPEN_STREAM_SLOTS_PER_PAGE_ ][ slot % PA_OPEN_STREAM_SLOTS_PER_PAGE_ ];
 }
 
 
-PaError Pa_Terminate( void )
+static PaError AddOpenStream( PaStream* stream )
 {
-    PaError result;
+    PaUtilStreamRepresentation *streamRepresentation = (PaUtilStreamRepresentation*)stream;
+    PaOpenStreamSlot *slot;
+    PaError result = paNoError;
+#ifdef PA_THREAD_LOCAL_
+    /* the pages outlive the stream, keep them out of its arena */
+    PaStreamArena *arena = currentStreamArena_;
+    currentStreamArena_ = NULL;
+#endif
 
-    PA_LOGAPI_ENTER( "Pa_Terminate" );
+    Lock( openStreamLock_ );
 
-    if( PA_IS_INITIALISED_ )
+    if( firstFreeOpenStreamSlot_ == -1 )
     {
-        // leave initializationCount_>0 so that Pa_CloseStream() can execute
-        if( initializationCount_ == 1 )
+        PaOpenStreamSlot *page;
+        int i;
+
+        if( openStreamPageCount_ == PA_MAX_OPEN_STREAM_PAGES_ )
         {
-            CloseOpenStreams();
+            result = paInsufficientMemory;
+            goto done;
+        }
 
-            TerminateHostApis();
+        page = (PaOpenStreamSlot*)PaUtil_AllocateMemory( sizeof(PaOpenStreamSlot) * PA_OPEN_STREAM_SLOTS_PER_PAGE_ );
+        if( !page )
+        {
+            result = paInsufficientMemory;
+            goto done;
+        }
 
-            PaUtil_DumpTraceMessages();
+        for( i=0; i < PA_OPEN_STREAM_SLOTS_PER_PAGE_; ++i )
+        {
+            page[i].stream = NULL;
+            page[i].generation = 0;
+            page[i].nextFreeSlot = ( i + 1 < PA_OPEN_STREAM_SLOTS_PER_PAGE_ )
+                    ? openStreamPageCount_ * PA_OPEN_STREAM_SLOTS_PER_PAGE_ + i + 1 : -1;
         }
-        --initializationCount_;
-        result = paNoError;
-    }
-    else
-    {
-        result=  paNotInitialized;
+
+        /* publish the initialized page to PaUtil_ValidateStreamPointer() */
+        PaUtil_WriteMemoryBarrier();
+        openStreamPages_[ openStreamPageCount_ ] = page;
+        firstFreeOpenStreamSlot_ = openStreamPageCount_ * PA_OPEN_STREAM_SLOTS_PER_PAGE_;
+        ++openStreamPageCount_;
     }
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_Terminate", result );
+    streamRepresentation->openStreamSlot = firstFreeOpenStreamSlot_;
+    slot = GetOpenStreamSlot( firstFreeOpenStreamSlot_ );
+    firstFreeOpenStreamSlot_ = slot->nextFreeSlot;
+    streamRepresentation->openStreamGeneration = slot->generation;
+
+    PaUtil_WriteMemoryBarrier();
+    slot->stream = streamRepresentation;
 
+done:
+    Unlock( openStreamLock_ );
+#ifdef PA_THREAD_LOCAL_
+    currentStreamArena_ = arena;
+#endif
     return result;
 }
 
 
-const PaHostErrorInfo* Pa_GetLastHostErrorInfo( void )
+static void RemoveOpenStream( PaStream* stream )
 {
-    return &lastHostErrorInfo_;
+    PaUtilStreamRepresentation *streamRepresentation = (PaUtilStreamRepresentation*)stream;
+    PaOpenStreamSlot *slot;
+
+    Lock( openStreamLock_ );
+
+    slot = GetOpenStreamSlot( streamRepresentation->openStreamSlot );
+    if( slot->stream == streamRepresentation )
+    {
+        slot->stream = NULL;
+        ++slot->generation;
+        slot->nextFreeSlot = firstFreeOpenStreamSlot_;
+        firstFreeOpenStreamSlot_ = streamRepresentation->openStreamSlot;
+        streamRepresentation->openStreamSlot = -1;
+    }
+
+    Unlock( openStreamLock_ );
 }
 
 
-const char *Pa_GetErrorText( PaError errorCode )
+/* Whether stream occupies the slot it remembers, without locking */
+static int IsOpenStream( PaUtilStreamRepresentation *stream )
 {
-    const char *result;
+    int slot = stream->openStreamSlot;
+    PaOpenStreamSlot *page;
 
-    switch( errorCode )
+    if( slot < 0 || slot >= PA_MAX_OPEN_STREAM_PAGES_ * PA_OPEN_STREAM_SLOTS_PER_PAGE_ )
+        return 0;
+
+    page = openStreamPages_[ slot / PA_OPEN_STREAM_SLOTS_PER_PAGE_ ];
+    if( !page )
+        return 0;
+    PaUtil_ReadMemoryBarrier();
+
+    page += slot % PA_OPEN_STREAM_SLOTS_PER_PAGE_;
+    return page->stream == stream && page->generation == stream->openStreamGeneration;
+}
+
+
+static void CloseOpenStreams( void )
+{
+    int i, j;
+
+    /* we call Pa_CloseStream() here to ensure that the same destruction
+        logic is used for automatically closed streams */
+
+    for( i=0; i < openStreamPageCount_; ++i )
     {
-    case paNoError:                  result = "Success"; break;
-    case paNotInitialized:           result = "PortAudio not initialized"; break;
-    /** @todo could catenate the last host error text to result in the case of paUnanticipatedHostError. see: http://www.portaudio.com/trac/ticket/114 */
-    case paUnanticipatedHostError:   result = "Unanticipated host error"; break;
-    case paInvalidChannelCount:      result = "Invalid number of channels"; break;
-    case paInvalidSampleRate:        result = "Invalid sample rate"; break;
-    case paInvalidDevice:            result = "Invalid device"; break;
-    case paInvalidFlag:              result = "Invalid flag"; break;
-    case paSampleFormatNotSupported: result = "Sample format not supported"; break;
-    case paBadIODeviceCombination:   result = "Illegal combination of I/O devices"; break;
-    case paInsufficientMemory:       result = "Insufficient memory"; break;
-    case paBufferTooBig:             result = "Buffer too big"; break;
-    case paBufferTooSmall:           result = "Buffer too small"; break;
-    case paNullCallback:             result = "No callback routine specified"; break;
-    case paBadStreamPtr:             result = "Invalid stream pointer"; break;
-    case paTimedOut:                 result = "Wait timed out"; break;
-    case paInternalError:            result = "Internal PortAudio error"; break;
-    case paDeviceUnavailable:        result = "Device unavailable"; break;
-    case paIncompatibleHostApiSpecificStreamInfo:   result = "Incompatible host API specific stream info"; break;
-    case paStreamIsStopped:          result = "Stream is stopped"; break;
-    case paStreamIsNotStopped:       result = "Stream is not stopped"; break;
-    case paInputOverflowed:          result = "Input overflowed"; break;
-    case paOutputUnderflowed:        result = "Output underflowed"; break;
-    case paHostApiNotFound:          result = "Host API not found"; break;
-    case paInvalidHostApi:           result = "Invalid host API"; break;
-    case paCanNotReadFromACallbackStream:       result = "Can't read from a callback stream"; break;
-    case paCanNotWriteToACallbackStream:        result = "Can't write to a callback stream"; break;
-    case paCanNotReadFromAnOutputOnlyStream:    result = "Can't read from an output only stream"; break;
-    case paCanNotWriteToAnInputOnlyStream:      result = "Can't write to an input only stream"; break;
-    case paIncompatibleStreamHostApi: result = "Incompatible stream host API"; break;
-    case paBadBufferPtr:             result = "Bad buffer pointer"; break;
-    default:
-		if( errorCode > 0 )
-			result = "Invalid error code (value greater than zero)";
-        else
-			result = "Invalid error code";
-        break;
+        for( j=0; j < PA_OPEN_STREAM_SLOTS_PER_PAGE_; ++j )
+        {
+            PaUtilStreamRepresentation *stream = openStreamPages_[i][j].stream;
+            if( stream )
+                Pa_CloseStream( stream );
+        }
     }
-    return result;
 }
 
 
-PaHostApiIndex Pa_HostApiTypeIdToHostApiIndex( PaHostApiTypeId type )
+static int RegisterStreamArena( char *begin, char *end )
 {
-    PaHostApiIndex result;
-    int i;
+    int i, result = -1;
 
-    PA_LOGAPI_ENTER_PARAMS( "Pa_HostApiTypeIdToHostApiIndex" );
-    PA_LOGAPI(("\tPaHostApiTypeId type: %d\n", type ));
+    Lock( openStreamLock_ );
 
-    if( !PA_IS_INITIALISED_ )
-    {
-        result = paNotInitialized;
-    }
-    else
+    for( i=0; i < PA_MAX_STREAM_ARENAS_; ++i )
     {
-        result = paHostApiNotFound;
-
-        for( i=0; i < hostApisCount_; ++i )
+        if( streamArenas_[i].begin == NULL )
         {
-            if( hostApis_[i]->info.type == type )
-            {
-                result = i;
-                break;
-            }
+            /* publish end before begin to PaUtil_IsStreamArenaMemory() */
+            streamArenas_[i].end = end;
+            PaUtil_WriteMemoryBarrier();
+            streamArenas_[i].begin = begin;
+            result = i;
+            break;
         }
     }
 
-    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_HostApiTypeIdToHostApiIndex", "PaHostApiIndex: %d", result );
-
+    Unlock( openStreamLock_ );
     return result;
 }
 
 
-PaError PaUtil_GetHostApiRepresentation( struct PaUtilHostApiRepresentation **hostApi,
-        PaHostApiTypeId type )
+static void UnregisterStreamArena( int slot )
 {
-    PaError result;
-    int i;
+    Lock( openStreamLock_ );
+    streamArenas_[ slot ].begin = NULL;
+    Unlock( openStreamLock_ );
+}
 
-    if( !PA_IS_INITIALISED_ )
+
+void *PaUtil_AllocateStreamArenaMemory( long size, int *handled )
+{
+#ifdef PA_THREAD_LOCAL_
+    PaStreamArena *arena = currentStreamArena_;
+    unsigned long alignedSize;
+    void *result;
+
+    *handled = 0;
+    if( !arena || size < 0 )
+        return NULL;
+
+    alignedSize = ((unsigned long)size + PA_STREAM_ARENA_ALIGNMENT_ - 1)
+            & ~(unsigned long)(PA_STREAM_ARENA_ALIGNMENT_ - 1);
+
+    if( arena->measuring )
     {
-        result = paNotInitialized;
+        arena->measured += alignedSize;
+        return NULL;
     }
-    else
-    {
-        result = paHostApiNotFound;
 
-        for( i=0; i < hostApisCount_; ++i )
-        {
-            if( hostApis_[i]->info.type == type )
-            {
-                *hostApi = hostApis_[i];
-                result = paNoError;
-                break;
-            }
-        }
-    }
+    *handled = 1;
+    if( alignedSize > (unsigned long)(arena->end - arena->next) )
+        return NULL;
 
+    result = arena->next;
+    arena->next += alignedSize;
+
+    /* blocks are zeroed as those of GlobalAlloc( GPTR ) are */
+    memset( result, 0, size );
     return result;
+#else
+    (void) size;
+    *handled = 0;
+    return NULL;
+#endif
 }
 
 
-PaError PaUtil_DeviceIndexToHostApiDeviceIndex(
-        PaDeviceIndex *hostApiDevice, PaDeviceIndex device, struct PaUtilHostApiRepresentation *hostApi )
+int PaUtil_IsStreamArenaMemory( const void *block )
 {
-    PaError result;
-    PaDeviceIndex x;
-
-    x = device - hostApi->privatePaFrontInfo.baseDeviceIndex;
+    const char *b = (const char*)block;
+    int i;
 
-    if( x < 0 || x >= hostApi->info.deviceCount )
-    {
-        result = paInvalidDevice;
-    }
-    else
+    for( i=0; i < PA_MAX_STREAM_ARENAS_; ++i )
     {
-        *hostApiDevice = x;
-        result = paNoError;
+        char *begin = streamArenas_[i].begin;
+        char *end;
+
+        if( begin == NULL || b < begin )
+            continue;
+
+        PaUtil_ReadMemoryBarrier();
+        end = streamArenas_[i].end;
+        PaUtil_ReadMemoryBarrier();
+
+        /* a range registered again in between keeps a consistent end if it
+           begins at the same address */
+        if( streamArenas_[i].begin == begin && b < end )
+            return 1;
     }
 
-    return result;
+    return 0;
 }
 
 
-PaHostApiIndex Pa_GetHostApiCount( void )
+/* Start or stop the device change notification of every host API which
+   has one, returning the first error */
+static PaError EnableDeviceChangeNotification( int enable )
 {
-    int result;
-
-    PA_LOGAPI_ENTER( "Pa_GetHostApiCount" );
+    PaError result = paNoError, error;
+    int i;
 
-    if( !PA_IS_INITIALISED_ )
-    {
-        result = paNotInitialized;
-    }
-    else
+    for( i=0; i < hostApisCount_; ++i )
     {
-        result = hostApisCount_;
-    }
+        PaUtilHostApiRepresentation *hostApi = hostApis_[i];
 
-    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_GetHostApiCount", "PaHostApiIndex: %d", result );
+        if( !hostApi->EnableDeviceChangeNotification
+                || hostApi->privatePaFrontInfo.notifying == (enable != 0) )
+            continue;
+
+        error = hostApi->EnableDeviceChangeNotification( hostApi, enable );
+        if( error != paNoError && result == paNoError )
+            result = error;
+
+        hostApi->privatePaFrontInfo.notifying = (enable && error == paNoError);
+        if( hostApi->privatePaFrontInfo.notifying )
+            ++hostApi->privatePaFrontInfo.deviceChangeCount;
+    }
 
     return result;
 }
 
 
-PaHostApiIndex Pa_GetDefaultHostApi( void )
+/* Whether the devices of a host API may have changed since they were
+   enumerated. The devices of host APIs which can't notify changes are
+   assumed to be unchanged. */
+static int HostApiDevicesChanged( PaUtilHostApiRepresentation *hostApi )
 {
-    int result;
+    if( !hostApi->EnableDeviceChangeNotification )
+        return 0;
 
-    PA_LOGAPI_ENTER( "Pa_GetDefaultHostApi" );
+    return !hostApi->privatePaFrontInfo.notifying
+            || hostApi->privatePaFrontInfo.deviceChangeCount
+                != hostApi->privatePaFrontInfo.enumeratedDeviceChangeCount;
+}
 
-    if( !PA_IS_INITIALISED_ )
-    {
-        result = paNotInitialized;
-    }
-    else
-    {
-        result = defaultHostApiIndex_;
 
-        /* internal consistency check: make sure that the default host api
-         index is within range */
+static PaError RefreshHostApis( int changedOnly );
 
-        if( result < 0 || result >= hostApisCount_ )
-        {
-            result = paInternalError;
-        }
+
+/* Reuse the host APIs retained by Pa_Terminate() for selection,
+   enumerating the devices of those whose devices changed again. Returns an
+   error if they can't be reused, they are still retained then. */
+static PaError ReuseRetainedHostApis( const PaHostApiSelection *selection )
+{
+    int i, initializerCount = CountHostApiInitializers();
+
+    for( i=0; i < initializerCount; ++i )
+    {
+        if( hostApiSelection_[i] != (unsigned char)IsHostApiSelected( selection, i ) )
+            return paInvalidHostApi;
     }
 
-    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_GetDefaultHostApi", "PaHostApiIndex: %d", result );
+    /* a host API whose devices changed, but can't enumerate them again,
+       has to be initialized again like all others */
+    for( i=0; i < hostApisCount_; ++i )
+    {
+        if( HostApiDevicesChanged( hostApis_[i] ) && !hostApis_[i]->ScanDeviceInfos )
+            return paDeviceUnavailable;
+    }
 
-    return result;
+    return RefreshHostApis( 1 );
 }
 
 
-const PaHostApiInfo* Pa_GetHostApiInfo( PaHostApiIndex hostApi )
+static PaError InitializeOrReuseHostApis( const PaHostApiSelection *selection )
 {
-    PaHostApiInfo *info;
-
-    PA_LOGAPI_ENTER_PARAMS( "Pa_GetHostApiInfo" );
-    PA_LOGAPI(("\tPaHostApiIndex hostApi: %d\n", hostApi ));
+    PaError result;
+    int i;
 
-    if( !PA_IS_INITIALISED_ )
+    if( hostApisRetained_ )
     {
-        info = NULL;
-
-        PA_LOGAPI(("Pa_GetHostApiInfo returned:\n" ));
-        PA_LOGAPI(("\tPaHostApiInfo*: NULL [ PortAudio not initialized ]\n" ));
+        if( ReuseRetainedHostApis( selection ) == paNoError )
+        {
+            hostApisRetained_ = 0;
+            PA_DEBUG(( "Pa_Initialize: reusing the retained host APIs.\n" ));
+            return paNoError;
+        }
 
+        EnableDeviceChangeNotification( 0 );
+        TerminateHostApis();
     }
-    else if( hostApi < 0 || hostApi >= hostApisCount_ )
-    {
-        info = NULL;
-
-        PA_LOGAPI(("Pa_GetHostApiInfo returned:\n" ));
-        PA_LOGAPI(("\tPaHostApiInfo*: NULL [ hostApi out of range ]\n" ));
 
-    }
-    else
+    result = InitializeHostApis( selection );
+    if( result == paNoError )
     {
-        info = &hostApis_[hostApi]->info;
-
-        PA_LOGAPI(("Pa_GetHostApiInfo returned:\n" ));
-        PA_LOGAPI(("\tPaHostApiInfo*: 0x%p\n", info ));
-        PA_LOGAPI(("\t{\n" ));
-        PA_LOGAPI(("\t\tint structVersion: %d\n", info->structVersion ));
-        PA_LOGAPI(("\t\tPaHostApiTypeId type: %d\n", info->type ));
-        PA_LOGAPI(("\t\tconst char *name: %s\n", info->name ));
-        PA_LOGAPI(("\t}\n" ));
+        result = CreateHostApiLocks();
+        if( result != paNoError )
+            TerminateHostApis();
+    }
 
+    if( result == paNoError && retainDevices_ )
+    {
+        /* a host API failing to notify is enumerated again when reused */
+        EnableDeviceChangeNotification( 1 );
+        for( i=0; i < hostApisCount_; ++i )
+        {
+            hostApis_[i]->privatePaFrontInfo.enumeratedDeviceChangeCount =
+                    hostApis_[i]->privatePaFrontInfo.deviceChangeCount;
+        }
     }
 
-     return info;
+    return result;
 }
 
 
-PaDeviceIndex Pa_HostApiDeviceIndexToDeviceIndex( PaHostApiIndex hostApi, int hostApiDeviceIndex )
+static PaError Initialize( const PaHostApiSelection *selection )
 {
-    PaDeviceIndex result;
-
-    PA_LOGAPI_ENTER_PARAMS( "Pa_HostApiDeviceIndexToPaDeviceIndex" );
-    PA_LOGAPI(("\tPaHostApiIndex hostApi: %d\n", hostApi ));
-    PA_LOGAPI(("\tint hostApiDeviceIndex: %d\n", hostApiDeviceIndex ));
+    PaError result;
 
-    if( !PA_IS_INITIALISED_ )
+    if( PA_IS_INITIALISED_ )
     {
-        result = paNotInitialized;
+        ++initializationCount_;
+        result = paNoError;
     }
     else
     {
-        if( hostApi < 0 || hostApi >= hostApisCount_ )
+        PA_VALIDATE_TYPE_SIZES;
+        PA_VALIDATE_ENDIANNESS;
+
+        PaUtil_InitializeClock();
+        PaUtil_InitializeDebugPrint();
+        PaUtil_InitializeTraceEvents();
+        PaUtil_InitializeProbes();
+        PaUtil_ResetTraceMessages();
+
+        PaUtil_InitializeConverterTable();
+        PA_DEBUG(( "Pa_Initialize: using %s sample converters.\n",
+                PaUtil_GetConverterTableName( PaUtil_GetActiveConverterTable() ) ));
+
+        result = InitializeOpenStreams();
+        if( result == paNoError )
         {
-            result = paInvalidHostApi;
+            result = InitializeOrReuseHostApis( selection );
+
+            if( result == paNoError )
+                ++initializationCount_;
+            else
+                TerminateOpenStreams();
         }
-        else
+
+        if( result != paNoError )
         {
-            if( hostApiDeviceIndex < 0 ||
-                    hostApiDeviceIndex >= hostApis_[hostApi]->info.deviceCount )
-            {
-                result = paInvalidDevice;
-            }
-            else
-            {
-                result = hostApis_[hostApi]->privatePaFrontInfo.baseDeviceIndex + hostApiDeviceIndex;
-            }
+            PaUtil_TerminateProbes();
+            PaUtil_TerminateDebugPrint();
         }
     }
 
-    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_HostApiDeviceIndexToPaDeviceIndex", "PaDeviceIndex: %d", result );
-
     return result;
 }
 
 
-PaDeviceIndex Pa_GetDeviceCount( void )
+PaError Pa_Initialize( void )
 {
-    PaDeviceIndex result;
+    PaError result;
+    PaHostApiTypeId hostApiTypes[ PA_HOST_API_TYPE_NAME_COUNT_ ];
+    PaHostApiSelection selection;
 
-    PA_LOGAPI_ENTER( "Pa_GetDeviceCount" );
+    PA_LOGAPI_ENTER( "Pa_Initialize" );
 
-    if( !PA_IS_INITIALISED_ )
-    {
-        result = paNotInitialized;
-    }
-    else
-    {
-        result = deviceCount_;
-    }
+    selection.hostApiTypeCount = GetHostApiTypesFromEnvironment( hostApiTypes );
+    selection.hostApiTypes = selection.hostApiTypeCount >= 0 ? hostApiTypes : NULL;
+    result = Initialize( &selection );
 
-    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_GetDeviceCount", "PaDeviceIndex: %d", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_Initialize", result );
 
     return result;
 }
 
 
-PaDeviceIndex Pa_GetDefaultInputDevice( void )
+PaError Pa_InitializeWithHostApis( const PaHostApiTypeId *hostApiTypes, int hostApiTypeCount )
 {
-    PaHostApiIndex hostApi;
-    PaDeviceIndex result;
+    PaError result;
+    PaHostApiSelection selection;
 
-    PA_LOGAPI_ENTER( "Pa_GetDefaultInputDevice" );
+    if( !hostApiTypes )
+        return Pa_Initialize();
 
-    hostApi = Pa_GetDefaultHostApi();
-    if( hostApi < 0 )
+    PA_LOGAPI_ENTER_PARAMS( "Pa_InitializeWithHostApis" );
+    PA_LOGAPI(("\tint hostApiTypeCount: %d\n", hostApiTypeCount ));
+
+    if( hostApiTypeCount < 0 )
     {
-        result = paNoDevice;
+        result = paInvalidHostApi;
     }
     else
     {
-        result = hostApis_[hostApi]->info.defaultInputDevice;
+        selection.hostApiTypes = hostApiTypes;
+        selection.hostApiTypeCount = hostApiTypeCount;
+        result = Initialize( &selection );
     }
 
-    PA_LOGAPI_EXIT_T( "Pa_GetDefaultInputDevice", "PaDeviceIndex: %d", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_InitializeWithHostApis", result );
 
     return result;
 }
 
 
-PaDeviceIndex Pa_GetDefaultOutputDevice( void )
+PaError Pa_Terminate( void )
 {
-    PaHostApiIndex hostApi;
-    PaDeviceIndex result;
+    PaError result;
 
-    PA_LOGAPI_ENTER( "Pa_GetDefaultOutputDevice" );
+    PA_LOGAPI_ENTER( "Pa_Terminate" );
 
-    hostApi = Pa_GetDefaultHostApi();
-    if( hostApi < 0 )
+    if( PA_IS_INITIALISED_ )
     {
-        result = paNoDevice;
+        // leave initializationCount_>0 so that Pa_CloseStream() can execute
+        if( initializationCount_ == 1 )
+        {
+            if( deviceChangeCallback_ )
+            {
+                EnableDeviceChangeNotification( 0 );
+                deviceChangeCallback_ = NULL;
+                deviceChangeUserData_ = NULL;
+            }
+
+            CloseOpenStreams();
+
+            if( retainDevices_ )
+            {
+                /* keep counting changes without the client's callback */
+                EnableDeviceChangeNotification( 1 );
+                hostApisRetained_ = 1;
+            }
+            else
+            {
+                EnableDeviceChangeNotification( 0 );
+                TerminateHostApis();
+            }
+
+            TerminateOpenStreams();
+
+            PaUtil_DumpTraceMessages();
+            PaUtil_TerminateTraceEvents();
+            PaUtil_TerminateProbes();
+            PaUtil_TerminateDebugPrint();
+        }
+        --initializationCount_;
+        result = paNoError;
     }
     else
     {
-        result = hostApis_[hostApi]->info.defaultOutputDevice;
+        result=  paNotInitialized;
     }
 
-    PA_LOGAPI_EXIT_T( "Pa_GetDefaultOutputDevice", "PaDeviceIndex: %d", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_Terminate", result );
 
     return result;
 }
 
 
-const PaDeviceInfo* Pa_GetDeviceInfo( PaDeviceIndex device )
+/* Whether RefreshHostApis() enumerates the devices of hostApi again */
+static int IsHostApiRescanned( PaUtilHostApiRepresentation *hostApi, int changedOnly )
 {
-    int hostSpecificDeviceIndex;
-    int hostApiIndex = FindHostApi( device, &hostSpecificDeviceIndex );
-    PaDeviceInfo *result;
+    return hostApi->ScanDeviceInfos && (!changedOnly || HostApiDevicesChanged( hostApi ));
+}
 
 
-    PA_LOGAPI_ENTER_PARAMS( "Pa_GetDeviceInfo" );
-    PA_LOGAPI(("\tPaDeviceIndex device: %d\n", device ));
+/* Enumerate the devices of the host APIs again, if changedOnly is set only
+   those of host APIs whose devices changed, see HostApiDevicesChanged() */
+static PaError RefreshHostApis( int changedOnly )
+{
+    PaError result = paNoError;
+    void **scanResults = NULL;
+    int *deviceCounts = NULL;
+    unsigned long *changeCounts = NULL;
+    unsigned char *rescanned = NULL;
+    int *table = NULL;
+    int i, scannedCount = 0, baseDeviceIndex = 0, locked = 0, deviceCount = 0;
+
+    if( hostApisCount_ == 0 )
+        goto done;
+
+    /* in index order, no other call holds more than one of them */
+    for( i=0; i < hostApisCount_; ++i )
+        Lock( hostApis_[i]->privatePaFrontInfo.lock );
+    locked = 1;
+
+    scanResults = (void**)PaUtil_AllocateMemory( sizeof(void*) * hostApisCount_ );
+    deviceCounts = (int*)PaUtil_AllocateMemory( sizeof(int) * hostApisCount_ );
+    changeCounts = (unsigned long*)PaUtil_AllocateMemory( sizeof(unsigned long) * hostApisCount_ );
+    rescanned = (unsigned char*)PaUtil_AllocateMemory( hostApisCount_ );
+    if( !scanResults || !deviceCounts || !changeCounts || !rescanned )
+    {
+        result = paInsufficientMemory;
+        goto done;
+    }
 
-    if( hostApiIndex < 0 )
+    /* scan every host API before changing any, so that a failure leaves
+       the device list as it was */
+    for( scannedCount=0; scannedCount < hostApisCount_; ++scannedCount )
     {
-        result = NULL;
+        PaUtilHostApiRepresentation *hostApi = hostApis_[scannedCount];
 
-        PA_LOGAPI(("Pa_GetDeviceInfo returned:\n" ));
-        PA_LOGAPI(("\tPaDeviceInfo* NULL [ invalid device index ]\n" ));
+        scanResults[scannedCount] = NULL;
+        deviceCounts[scannedCount] = 0;
+
+        /* decided once, as notifications may come in meanwhile; changes
+           notified from here on are enumerated again next time */
+        changeCounts[scannedCount] = hostApi->privatePaFrontInfo.deviceChangeCount;
+        rescanned[scannedCount] = (unsigned char)IsHostApiRescanned( hostApi, changedOnly );
+        if( !rescanned[scannedCount] )
+            continue;
+
+        PA_DEBUG(( "before ScanDeviceInfos of host API %d.\n", scannedCount ));
+
+        result = hostApi->ScanDeviceInfos( hostApi, scannedCount,
+                &scanResults[scannedCount], &deviceCounts[scannedCount] );
+        if( result != paNoError )
+            goto dispose;
 
+        PA_DEBUG(( "after ScanDeviceInfos of host API %d.\n", scannedCount ));
     }
-    else
+
+    for( i=0; i < hostApisCount_; ++i )
+        deviceCount += rescanned[i] ? deviceCounts[i] : hostApis_[i]->info.deviceCount;
+    table = AllocateDeviceHostApis( deviceCount );
+    if( !table )
     {
-        result = hostApis_[hostApiIndex]->deviceInfos[ hostSpecificDeviceIndex ];
+        result = paInsufficientMemory;
+        goto dispose;
+    }
 
-        PA_LOGAPI(("Pa_GetDeviceInfo returned:\n" ));
-        PA_LOGAPI(("\tPaDeviceInfo*: 0x%p:\n", result ));
-        PA_LOGAPI(("\t{\n" ));
+    /* host APIs which were not scanned keep their devices, whose default
+       devices are renumbered with the others below */
+    for( i=0; i < hostApisCount_; ++i )
+    {
+        PaUtilHostApiRepresentation *hostApi = hostApis_[i];
 
-        PA_LOGAPI(("\t\tint structVersion: %d\n", result->structVersion ));
-        PA_LOGAPI(("\t\tconst char *name: %s\n", result->name ));
-        PA_LOGAPI(("\t\tPaHostApiIndex hostApi: %d\n", result->hostApi ));
-        PA_LOGAPI(("\t\tint maxInputChannels: %d\n", result->maxInputChannels ));
-        PA_LOGAPI(("\t\tint maxOutputChannels: %d\n", result->maxOutputChannels ));
-        PA_LOGAPI(("\t}\n" ));
+        if( rescanned[i] )
+        {
+            hostApi->CommitDeviceInfos( hostApi, i, scanResults[i], deviceCounts[i] );
+            hostApi->privatePaFrontInfo.enumeratedDeviceChangeCount = changeCounts[i];
+        }
+        else
+        {
+            if( hostApi->info.defaultInputDevice != paNoDevice )
+                hostApi->info.defaultInputDevice -= hostApi->privatePaFrontInfo.baseDeviceIndex;
 
+            if( hostApi->info.defaultOutputDevice != paNoDevice )
+                hostApi->info.defaultOutputDevice -= hostApi->privatePaFrontInfo.baseDeviceIndex;
+        }
     }
 
-    return result;
-}
+    defaultHostApiIndex_ = -1;
+    deviceCount_ = 0;
+    for( i=0; i < hostApisCount_; ++i )
+        NumberHostApiDevices( hostApis_[i], i, &baseDeviceIndex );
+    SetDeviceHostApis( table );
 
+    if( defaultHostApiIndex_ == -1 )
+        defaultHostApiIndex_ = 0;
 
-/*
-    SampleFormatIsValid() returns 1 if sampleFormat is a sample format
-    defined in portaudio.h, or 0 otherwise.
-*/
-static int SampleFormatIsValid( PaSampleFormat format )
-{
-    switch( format & ~paNonInterleaved )
+    goto done;
+
+dispose:
+    for( i=0; i < scannedCount; ++i )
     {
-    case paFloat32: return 1;
-    case paInt16: return 1;
-    case paInt32: return 1;
-    case paInt24: return 1;
-    case paInt8: return 1;
-    case paUInt8: return 1;
-    case paCustomFormat: return 1;
-    default: return 0;
+        if( rescanned[i] )
+            hostApis_[i]->DisposeDeviceInfos( hostApis_[i], scanResults[i], deviceCounts[i] );
+    }
+
+done:
+    if( locked )
+    {
+        for( i=0; i < hostApisCount_; ++i )
+            Unlock( hostApis_[i]->privatePaFrontInfo.lock );
     }
+    if( scanResults )
+        PaUtil_FreeMemory( scanResults );
+    if( deviceCounts )
+        PaUtil_FreeMemory( deviceCounts );
+    if( changeCounts )
+        PaUtil_FreeMemory( changeCounts );
+    if( rescanned )
+        PaUtil_FreeMemory( rescanned );
+
+    return result;
 }
 
-/*
-    NOTE: make sure this validation list is kept syncronised with the one in
-            pa_hostapi.h
 
-    ValidateOpenStreamParameters() checks that parameters to Pa_OpenStream()
-    conform to the expected values as described below. This function is
-    also designed to be used with the proposed Pa_IsFormatSupported() function.
+PaError Pa_RefreshDeviceList( void )
+{
+    PaError result;
 
-    There are basically two types of validation that could be performed:
-    Generic conformance validation, and device capability mismatch
-    validation. This function performs only generic conformance validation.
-    Validation that would require knowledge of device capabilities is
-    not performed because of potentially complex relationships between
-    combinations of parameters - for example, even if the sampleRate
-    seems ok, it might not be for a duplex stream - we have no way of
-    checking this in an API-neutral way, so we don't try.
+    PA_LOGAPI_ENTER( "Pa_RefreshDeviceList" );
 
-    On success the function returns PaNoError and fills in hostApi,
-    hostApiInputDeviceID, and hostApiOutputDeviceID fields. On failure
-    the function returns an error code indicating the first encountered
-    parameter error.
+    if( !PA_IS_INITIALISED_ )
+        result = paNotInitialized;
+    else
+        result = RefreshHostApis( 0 );
 
+    PA_LOGAPI_EXIT_PAERROR( "Pa_RefreshDeviceList", result );
 
-    If ValidateOpenStreamParameters() returns paNoError, the following
-    assertions are guaranteed to be true.
+    return result;
+}
 
-    - at least one of inputParameters & outputParmeters is valid (not NULL)
 
-    - if inputParameters & outputParameters are both valid, that
-        inputParameters->device & outputParameters->device  both use the same host api
+PaError Pa_RetainDevicesOnTerminate( int retain )
+{
+    PA_LOGAPI_ENTER_PARAMS( "Pa_RetainDevicesOnTerminate" );
+    PA_LOGAPI(("\tint retain: %d\n", retain ));
 
-    PaDeviceIndex inputParameters->device
-        - is within range (0 to Pa_GetDeviceCount-1) Or:
-        - is paUseHostApiSpecificDeviceSpecification and
-            inputParameters->hostApiSpecificStreamInfo is non-NULL and refers
-            to a valid host api
+    retainDevices_ = (retain != 0);
 
-    int inputParameters->channelCount
-        - if inputParameters->device is not paUseHostApiSpecificDeviceSpecification, channelCount is > 0
-        - upper bound is NOT validated against device capabilities
+    if( !retainDevices_ && hostApisRetained_ )
+    {
+        /* release the host APIs Pa_Terminate() retained */
+        EnableDeviceChangeNotification( 0 );
+        TerminateHostApis();
+    }
+    else if( retainDevices_ && PA_IS_INITIALISED_ )
+    {
+        /* devices enumerated before aren't known to be unchanged */
+        EnableDeviceChangeNotification( 1 );
+    }
 
-    PaSampleFormat inputParameters->sampleFormat
-        - is one of the sample formats defined in portaudio.h
+    PA_LOGAPI_EXIT_PAERROR( "Pa_RetainDevicesOnTerminate", paNoError );
 
-    void *inputParameters->hostApiSpecificStreamInfo
-        - if supplied its hostApi field matches the input device's host Api
+    return paNoError;
+}
 
-    PaDeviceIndex outputParmeters->device
-        - is within range (0 to Pa_GetDeviceCount-1)
 
-    int outputParmeters->channelCount
-        - if inputDevice is valid, channelCount is > 0
-        - upper bound is NOT validated against device capabilities
 
-    PaSampleFormat outputParmeters->sampleFormat
-        - is one of the sample formats defined in portaudio.h
 
-    void *outputParmeters->hostApiSpecificStreamInfo
-        - if supplied its hostApi field matches the output device's host Api
+void PaUtil_NotifyDeviceChange( struct PaUtilHostApiRepresentation *hostApi )
+{
+    int i;
 
-    double sampleRate
-        - is not an 'absurd' rate (less than 1000. or greater than 384000.)
-        - sampleRate is NOT validated against device capabilities
+    for( i=0; i < hostApisCount_; ++i )
+    {
+        if( hostApis_[i] == hostApi )
+        {
+            PA_DEBUG(( "device change of host API %d.\n", i ));
 
-    PaStreamFlags streamFlags
-        - unused platform neutral flags are zero
-        - paNeverDropInput is only used for full-duplex callback streams with
-            variable buffer size (paFramesPerBufferUnspecified)
-*/
-static PaError ValidateOpenStreamParameters(
-    const PaStreamParameters *inputParameters,
-    const PaStreamParameters *outputParameters,
-    double sampleRate,
-    unsigned long framesPerBuffer,
-    PaStreamFlags streamFlags,
-    PaStreamCallback *streamCallback,
-    PaUtilHostApiRepresentation **hostApi,
-    PaDeviceIndex *hostApiInputDevice,
-    PaDeviceIndex *hostApiOutputDevice )
+            ++hostApi->privatePaFrontInfo.deviceChangeCount;
+
+            if( deviceChangeCallback_ )
+                deviceChangeCallback_( i, deviceChangeUserData_ );
+            return;
+        }
+    }
+}
+
+
+PaError Pa_SetDeviceChangeCallback( PaDeviceChangeCallback *callback, void *userData )
 {
-    int inputHostApiIndex  = -1, /* Surpress uninitialised var warnings: compiler does */
-        outputHostApiIndex = -1; /* not see that if inputParameters and outputParame-  */
-                                 /* ters are both nonzero, these indices are set.      */
+    PaError result = paNoError;
 
-    if( (inputParameters == NULL) && (outputParameters == NULL) )
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetDeviceChangeCallback" );
+    PA_LOGAPI(("\tPaDeviceChangeCallback* callback: 0x%p\n", callback ));
+    PA_LOGAPI(("\tvoid* userData: 0x%p\n", userData ));
+
+    if( !PA_IS_INITIALISED_ )
     {
-        return paInvalidDevice; /** @todo should be a new error code "invalid device parameters" or something */
+        result = paNotInitialized;
     }
     else
     {
-        if( inputParameters == NULL )
-        {
-            *hostApiInputDevice = paNoDevice;
-        }
-        else if( inputParameters->device == paUseHostApiSpecificDeviceSpecification )
-        {
-            if( inputParameters->hostApiSpecificStreamInfo )
-            {
-                inputHostApiIndex = Pa_HostApiTypeIdToHostApiIndex(
-                        ((PaUtilHostApiSpecificStreamInfoHeader*)inputParameters->hostApiSpecificStreamInfo)->hostApiType );
+        /* the callback and its data only change while no host API notifies */
+        if( deviceChangeCallback_ || retainDevices_ )
+            EnableDeviceChangeNotification( 0 );
 
-                if( inputHostApiIndex != -1 )
-                {
-                    *hostApiInputDevice = paUseHostApiSpecificDeviceSpecification;
-                    *hostApi = hostApis_[inputHostApiIndex];
-                }
-                else
-                {
-                    return paInvalidDevice;
-                }
-            }
-            else
+        deviceChangeCallback_ = callback;
+        deviceChangeUserData_ = userData;
+
+        if( callback )
+        {
+            result = EnableDeviceChangeNotification( 1 );
+            if( result != paNoError )
             {
-                return paInvalidDevice;
+                EnableDeviceChangeNotification( 0 );
+                deviceChangeCallback_ = NULL;
+                deviceChangeUserData_ = NULL;
             }
         }
-        else
-        {
-            if( inputParameters->device < 0 || inputParameters->device >= deviceCount_ )
-                return paInvalidDevice;
 
-            inputHostApiIndex = FindHostApi( inputParameters->device, hostApiInputDevice );
-            if( inputHostApiIndex < 0 )
-                return paInternalError;
+        /* changes of retained devices are counted without a callback too */
+        if( retainDevices_ )
+            EnableDeviceChangeNotification( 1 );
+    }
 
-            *hostApi = hostApis_[inputHostApiIndex];
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetDeviceChangeCallback", result );
 
-            if( inputParameters->channelCount <= 0 )
-                return paInvalidChannelCount;
+    return result;
+}
 
-            if( !SampleFormatIsValid( inputParameters->sampleFormat ) )
-                return paSampleFormatNotSupported;
 
-            if( inputParameters->hostApiSpecificStreamInfo != NULL )
-            {
-                if( ((PaUtilHostApiSpecificStreamInfoHeader*)inputParameters->hostApiSpecificStreamInfo)->hostApiType
-                        != (*hostApi)->info.type )
-                    return paIncompatibleHostApiSpecificStreamInfo;
-            }
-        }
+const PaHostErrorInfo* Pa_GetLastHostErrorInfo( void )
+{
+    return &lastHostErrorInfo_;
+}
 
-        if( outputParameters == NULL )
-        {
-            *hostApiOutputDevice = paNoDevice;
-        }
-        else if( outputParameters->device == paUseHostApiSpecificDeviceSpecification  )
-        {
-            if( outputParameters->hostApiSpecificStreamInfo )
-            {
-                outputHostApiIndex = Pa_HostApiTypeIdToHostApiIndex(
-                        ((PaUtilHostApiSpecificStreamInfoHeader*)outputParameters->hostApiSpecificStreamInfo)->hostApiType );
 
-                if( outputHostApiIndex != -1 )
-                {
-                    *hostApiOutputDevice = paUseHostApiSpecificDeviceSpecification;
-                    *hostApi = hostApis_[outputHostApiIndex];
-                }
-                else
-                {
-                    return paInvalidDevice;
-                }
+const char *Pa_GetErrorText( PaError errorCode )
+{
+    const char *result;
+
+    switch( errorCode )
+    {
+    case paNoError:                  result = "Success"; break;
+    case paNotInitialized:           result = "PortAudio not initialized"; break;
+    /** @todo could catenate the last host error text to result in the case of paUnanticipatedHostError. see: http://www.portaudio.com/trac/ticket/114 */
+    case paUnanticipatedHostError:   result = "Unanticipated host error"; break;
+    case paInvalidChannelCount:      result = "Invalid number of channels"; break;
+    case paInvalidSampleRate:        result = "Invalid sample rate"; break;
+    case paInvalidDevice:            result = "Invalid device"; break;
+    case paInvalidFlag:              result = "Invalid flag"; break;
+    case paSampleFormatNotSupported: result = "Sample format not supported"; break;
+    case paBadIODeviceCombination:   result = "Illegal combination of I/O devices"; break;
+    case paInsufficientMemory:       result = "Insufficient memory"; break;
+    case paBufferTooBig:             result = "Buffer too big"; break;
+    case paBufferTooSmall:           result = "Buffer too small"; break;
+    case paNullCallback:             result = "No callback routine specified"; break;
+    case paBadStreamPtr:             result = "Invalid stream pointer"; break;
+    case paTimedOut:                 result = "Wait timed out"; break;
+    case paInternalError:            result = "Internal PortAudio error"; break;
+    case paDeviceUnavailable:        result = "Device unavailable"; break;
+    case paIncompatibleHostApiSpecificStreamInfo:   result = "Incompatible host API specific stream info"; break;
+    case paStreamIsStopped:          result = "Stream is stopped"; break;
+    case paStreamIsNotStopped:       result = "Stream is not stopped"; break;
+    case paInputOverflowed:          result = "Input overflowed"; break;
+    case paOutputUnderflowed:        result = "Output underflowed"; break;
+    case paHostApiNotFound:          result = "Host API not found"; break;
+    case paInvalidHostApi:           result = "Invalid host API"; break;
+    case paCanNotReadFromACallbackStream:       result = "Can't read from a callback stream"; break;
+    case paCanNotWriteToACallbackStream:        result = "Can't write to a callback stream"; break;
+    case paCanNotReadFromAnOutputOnlyStream:    result = "Can't read from an output only stream"; break;
+    case paCanNotWriteToAnInputOnlyStream:      result = "Can't write to an input only stream"; break;
+    case paIncompatibleStreamHostApi: result = "Incompatible stream host API"; break;
+    case paBadBufferPtr:             result = "Bad buffer pointer"; break;
+    default:
+		if( errorCode > 0 )
+			result = "Invalid error code (value greater than zero)";
+        else
+			result = "Invalid error code";
+        break;
+    }
+    return result;
+}
+
+
+PaHostApiIndex Pa_HostApiTypeIdToHostApiIndex( PaHostApiTypeId type )
+{
+    PaHostApiIndex result;
+    int i;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_HostApiTypeIdToHostApiIndex" );
+    PA_LOGAPI(("\tPaHostApiTypeId type: %d\n", type ));
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+    }
+    else
+    {
+        result = paHostApiNotFound;
+
+        for( i=0; i < hostApisCount_; ++i )
+        {
+            if( hostApis_[i]->info.type == type )
+            {
+                result = i;
+                break;
             }
-            else
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_HostApiTypeIdToHostApiIndex", "PaHostApiIndex: %d", result );
+
+    return result;
+}
+
+
+PaError PaUtil_GetHostApiRepresentation( struct PaUtilHostApiRepresentation **hostApi,
+        PaHostApiTypeId type )
+{
+    PaError result;
+    int i;
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+    }
+    else
+    {
+        result = paHostApiNotFound;
+
+        for( i=0; i < hostApisCount_; ++i )
+        {
+            if( hostApis_[i]->info.type == type )
             {
-                return paInvalidDevice;
+                *hostApi = hostApis_[i];
+                result = paNoError;
+                break;
             }
         }
+    }
+
+    return result;
+}
+
+
+PaError PaUtil_DeviceIndexToHostApiDeviceIndex(
+        PaDeviceIndex *hostApiDevice, PaDeviceIndex device, struct PaUtilHostApiRepresentation *hostApi )
+{
+    PaError result;
+    PaDeviceIndex x;
+
+    x = device - hostApi->privatePaFrontInfo.baseDeviceIndex;
+
+    if( x < 0 || x >= hostApi->info.deviceCount )
+    {
+        result = paInvalidDevice;
+    }
+    else
+    {
+        *hostApiDevice = x;
+        result = paNoError;
+    }
+
+    return result;
+}
+
+
+PaHostApiIndex Pa_GetHostApiCount( void )
+{
+    int result;
+
+    PA_LOGAPI_ENTER( "Pa_GetHostApiCount" );
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+    }
+    else
+    {
+        result = hostApisCount_;
+    }
+
+    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_GetHostApiCount", "PaHostApiIndex: %d", result );
+
+    return result;
+}
+
+
+PaHostApiIndex Pa_GetDefaultHostApi( void )
+{
+    int result;
+
+    PA_LOGAPI_ENTER( "Pa_GetDefaultHostApi" );
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+    }
+    else
+    {
+        result = defaultHostApiIndex_;
+
+        /* internal consistency check: make sure that the default host api
+         index is within range */
+
+        if( result < 0 || result >= hostApisCount_ )
+        {
+            result = paInternalError;
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_GetDefaultHostApi", "PaHostApiIndex: %d", result );
+
+    return result;
+}
+
+
+const PaHostApiInfo* Pa_GetHostApiInfo( PaHostApiIndex hostApi )
+{
+    PaHostApiInfo *info;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetHostApiInfo" );
+    PA_LOGAPI(("\tPaHostApiIndex hostApi: %d\n", hostApi ));
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        info = NULL;
+
+        PA_LOGAPI(("Pa_GetHostApiInfo returned:\n" ));
+        PA_LOGAPI(("\tPaHostApiInfo*: NULL [ PortAudio not initialized ]\n" ));
+
+    }
+    else if( hostApi < 0 || hostApi >= hostApisCount_ )
+    {
+        info = NULL;
+
+        PA_LOGAPI(("Pa_GetHostApiInfo returned:\n" ));
+        PA_LOGAPI(("\tPaHostApiInfo*: NULL [ hostApi out of range ]\n" ));
+
+    }
+    else
+    {
+        info = &hostApis_[hostApi]->info;
+
+        PA_LOGAPI(("Pa_GetHostApiInfo returned:\n" ));
+        PA_LOGAPI(("\tPaHostApiInfo*: 0x%p\n", info ));
+        PA_LOGAPI(("\t{\n" ));
+        PA_LOGAPI(("\t\tint structVersion: %d\n", info->structVersion ));
+        PA_LOGAPI(("\t\tPaHostApiTypeId type: %d\n", info->type ));
+        PA_LOGAPI(("\t\tconst char *name: %s\n", info->name ));
+        PA_LOGAPI(("\t}\n" ));
+
+    }
+
+     return info;
+}
+
+
+PaDeviceIndex Pa_HostApiDeviceIndexToDeviceIndex( PaHostApiIndex hostApi, int hostApiDeviceIndex )
+{
+    PaDeviceIndex result;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_HostApiDeviceIndexToPaDeviceIndex" );
+    PA_LOGAPI(("\tPaHostApiIndex hostApi: %d\n", hostApi ));
+    PA_LOGAPI(("\tint hostApiDeviceIndex: %d\n", hostApiDeviceIndex ));
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+    }
+    else
+    {
+        if( hostApi < 0 || hostApi >= hostApisCount_ )
+        {
+            result = paInvalidHostApi;
+        }
         else
         {
-            if( outputParameters->device < 0 || outputParameters->device >= deviceCount_ )
-                return paInvalidDevice;
+            if( hostApiDeviceIndex < 0 ||
+                    hostApiDeviceIndex >= hostApis_[hostApi]->info.deviceCount )
+            {
+                result = paInvalidDevice;
+            }
+            else
+            {
+                result = hostApis_[hostApi]->privatePaFrontInfo.baseDeviceIndex + hostApiDeviceIndex;
+            }
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_HostApiDeviceIndexToPaDeviceIndex", "PaDeviceIndex: %d", result );
+
+    return result;
+}
+
+
+PaDeviceIndex Pa_GetDeviceCount( void )
+{
+    PaDeviceIndex result;
+
+    PA_LOGAPI_ENTER( "Pa_GetDeviceCount" );
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+    }
+    else
+    {
+        result = deviceCount_;
+    }
+
+    PA_LOGAPI_EXIT_PAERROR_OR_T_RESULT( "Pa_GetDeviceCount", "PaDeviceIndex: %d", result );
+
+    return result;
+}
+
+
+PaDeviceIndex Pa_GetDefaultInputDevice( void )
+{
+    PaHostApiIndex hostApi;
+    PaDeviceIndex result;
+
+    PA_LOGAPI_ENTER( "Pa_GetDefaultInputDevice" );
+
+    hostApi = Pa_GetDefaultHostApi();
+    if( hostApi < 0 )
+    {
+        result = paNoDevice;
+    }
+    else
+    {
+        result = hostApis_[hostApi]->info.defaultInputDevice;
+    }
+
+    PA_LOGAPI_EXIT_T( "Pa_GetDefaultInputDevice", "PaDeviceIndex: %d", result );
+
+    return result;
+}
+
+
+PaDeviceIndex Pa_GetDefaultOutputDevice( void )
+{
+    PaHostApiIndex hostApi;
+    PaDeviceIndex result;
+
+    PA_LOGAPI_ENTER( "Pa_GetDefaultOutputDevice" );
+
+    hostApi = Pa_GetDefaultHostApi();
+    if( hostApi < 0 )
+    {
+        result = paNoDevice;
+    }
+    else
+    {
+        result = hostApis_[hostApi]->info.defaultOutputDevice;
+    }
+
+    PA_LOGAPI_EXIT_T( "Pa_GetDefaultOutputDevice", "PaDeviceIndex: %d", result );
+
+    return result;
+}
+
+
+const PaDeviceInfo* Pa_GetDeviceInfo( PaDeviceIndex device )
+{
+    int hostSpecificDeviceIndex;
+    int hostApiIndex = FindHostApi( device, &hostSpecificDeviceIndex );
+    PaDeviceInfo *result;
+
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetDeviceInfo" );
+    PA_LOGAPI(("\tPaDeviceIndex device: %d\n", device ));
+
+    if( hostApiIndex < 0 )
+    {
+        result = NULL;
+
+        PA_LOGAPI(("Pa_GetDeviceInfo returned:\n" ));
+        PA_LOGAPI(("\tPaDeviceInfo* NULL [ invalid device index ]\n" ));
+
+    }
+    else
+    {
+        result = hostApis_[hostApiIndex]->deviceInfos[ hostSpecificDeviceIndex ];
+
+        PA_LOGAPI(("Pa_GetDeviceInfo returned:\n" ));
+        PA_LOGAPI(("\tPaDeviceInfo*: 0x%p:\n", result ));
+        PA_LOGAPI(("\t{\n" ));
+
+        PA_LOGAPI(("\t\tint structVersion: %d\n", result->structVersion ));
+        PA_LOGAPI(("\t\tconst char *name: %s\n", result->name ));
+        PA_LOGAPI(("\t\tPaHostApiIndex hostApi: %d\n", result->hostApi ));
+        PA_LOGAPI(("\t\tint maxInputChannels: %d\n", result->maxInputChannels ));
+        PA_LOGAPI(("\t\tint maxOutputChannels: %d\n", result->maxOutputChannels ));
+        PA_LOGAPI(("\t}\n" ));
+
+    }
+
+    return result;
+}
+
+
+const PaDeviceCapabilities* Pa_GetDeviceCapabilities( PaDeviceIndex device )
+{
+    int hostSpecificDeviceIndex;
+    int hostApiIndex = FindHostApi( device, &hostSpecificDeviceIndex );
+    PaUtilHostApiRepresentation *hostApi;
+    const PaDeviceCapabilities *result = NULL;
+    PaError err;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetDeviceCapabilities" );
+    PA_LOGAPI(("\tPaDeviceIndex device: %d\n", device ));
+
+    if( hostApiIndex >= 0 )
+    {
+        hostApi = hostApis_[hostApiIndex];
+        if( hostApi->GetDeviceCapabilities )
+        {
+            Lock( hostApi->privatePaFrontInfo.lock );
+            err = hostApi->GetDeviceCapabilities( hostApi, hostSpecificDeviceIndex, &result );
+            Unlock( hostApi->privatePaFrontInfo.lock );
+            if( err != paNoError )
+                result = NULL;
+        }
+    }
+
+    PA_LOGAPI(("Pa_GetDeviceCapabilities returned:\n" ));
+    PA_LOGAPI(("\tPaDeviceCapabilities*: 0x%p\n", result ));
+
+    return result;
+}
+
+
+/*
+    SampleFormatIsValid() returns 1 if sampleFormat is a sample format
+    defined in portaudio.h, or 0 otherwise.
+*/
+static int SampleFormatIsValid( PaSampleFormat format )
+{
+    switch( format & ~paNonInterleaved )
+    {
+    case paFloat32: return 1;
+    case paFloat64: return 1;
+    case paInt16: return 1;
+    case paInt32: return 1;
+    case paInt24: return 1;
+    case paInt24In32: return 1;
+    case paInt8: return 1;
+    case paUInt8: return 1;
+    case paCustomFormat: return 1;
+    default: return 0;
+    }
+}
+
+/*
+    NOTE: make sure this validation list is kept syncronised with the one in
+            pa_hostapi.h
+
+    ValidateOpenStreamParameters() checks that parameters to Pa_OpenStream()
+    conform to the expected values as described below. This function is
+    also designed to be used with the proposed Pa_IsFormatSupported() function.
+
+    There are basically two types of validation that could be performed:
+    Generic conformance validation, and device capability mismatch
+    validation. This function performs only generic conformance validation.
+    Validation that would require knowledge of device capabilities is
+    not performed because of potentially complex relationships between
+    combinations of parameters - for example, even if the sampleRate
+    seems ok, it might not be for a duplex stream - we have no way of
+    checking this in an API-neutral way, so we don't try.
+
+    On success the function returns PaNoError and fills in hostApi,
+    hostApiInputDeviceID, and hostApiOutputDeviceID fields. On failure
+    the function returns an error code indicating the first encountered
+    parameter error.
+
+
+    If ValidateOpenStreamParameters() returns paNoError, the following
+    assertions are guaranteed to be true.
+
+    - at least one of inputParameters & outputParmeters is valid (not NULL)
+
+    - if inputParameters & outputParameters are both valid, that
+        inputParameters->device & outputParameters->device  both use the same host api
+
+    PaDeviceIndex inputParameters->device
+        - is within range (0 to Pa_GetDeviceCount-1) Or:
+        - is paUseHostApiSpecificDeviceSpecification and
+            inputParameters->hostApiSpecificStreamInfo is non-NULL and refers
+            to a valid host api
+
+    int inputParameters->channelCount
+        - if inputParameters->device is not paUseHostApiSpecificDeviceSpecification, channelCount is > 0
+        - upper bound is NOT validated against device capabilities
+
+    PaSampleFormat inputParameters->sampleFormat
+        - is one of the sample formats defined in portaudio.h
+
+    void *inputParameters->hostApiSpecificStreamInfo
+        - if supplied its hostApi field matches the input device's host Api
+
+    PaDeviceIndex outputParmeters->device
+        - is within range (0 to Pa_GetDeviceCount-1)
+
+    int outputParmeters->channelCount
+        - if inputDevice is valid, channelCount is > 0
+        - upper bound is NOT validated against device capabilities
+
+    PaSampleFormat outputParmeters->sampleFormat
+        - is one of the sample formats defined in portaudio.h
+
+    void *outputParmeters->hostApiSpecificStreamInfo
+        - if supplied its hostApi field matches the output device's host Api
+
+    double sampleRate
+        - is not an 'absurd' rate (less than 1000. or greater than 384000.)
+        - sampleRate is NOT validated against device capabilities
+
+    PaStreamFlags streamFlags
+        - unused platform neutral flags are zero
+        - paNeverDropInput is only used for full-duplex callback streams with
+            variable buffer size (paFramesPerBufferUnspecified)
+*/
+static PaError ValidateOpenStreamParameters(
+    const PaStreamParameters *inputParameters,
+    const PaStreamParameters *outputParameters,
+    double sampleRate,
+    unsigned long framesPerBuffer,
+    PaStreamFlags streamFlags,
+    PaStreamCallback *streamCallback,
+    PaUtilHostApiRepresentation **hostApi,
+    PaDeviceIndex *hostApiInputDevice,
+    PaDeviceIndex *hostApiOutputDevice )
+{
+    int inputHostApiIndex  = -1, /* Surpress uninitialised var warnings: compiler does */
+        outputHostApiIndex = -1; /* not see that if inputParameters and outputParame-  */
+                                 /* ters are both nonzero, these indices are set.      */
+
+    if( (inputParameters == NULL) && (outputParameters == NULL) )
+    {
+        return paInvalidDevice; /** @todo should be a new error code "invalid device parameters" or something */
+    }
+    else
+    {
+        if( inputParameters == NULL )
+        {
+            *hostApiInputDevice = paNoDevice;
+        }
+        else if( inputParameters->device == paUseHostApiSpecificDeviceSpecification )
+        {
+            if( inputParameters->hostApiSpecificStreamInfo )
+            {
+                inputHostApiIndex = Pa_HostApiTypeIdToHostApiIndex(
+                        ((PaUtilHostApiSpecificStreamInfoHeader*)inputParameters->hostApiSpecificStreamInfo)->hostApiType );
+
+                if( inputHostApiIndex != -1 )
+                {
+                    *hostApiInputDevice = paUseHostApiSpecificDeviceSpecification;
+                    *hostApi = hostApis_[inputHostApiIndex];
+                }
+                else
+                {
+                    return paInvalidDevice;
+                }
+            }
+            else
+            {
+                return paInvalidDevice;
+            }
+        }
+        else
+        {
+            if( inputParameters->device < 0 || inputParameters->device >= deviceCount_ )
+                return paInvalidDevice;
+
+            inputHostApiIndex = FindHostApi( inputParameters->device, hostApiInputDevice );
+            if( inputHostApiIndex < 0 )
+                return paInternalError;
+
+            *hostApi = hostApis_[inputHostApiIndex];
+
+            if( inputParameters->channelCount <= 0 )
+                return paInvalidChannelCount;
+
+            if( !SampleFormatIsValid( inputParameters->sampleFormat ) )
+                return paSampleFormatNotSupported;
+
+            if( inputParameters->hostApiSpecificStreamInfo != NULL )
+            {
+                if( ((PaUtilHostApiSpecificStreamInfoHeader*)inputParameters->hostApiSpecificStreamInfo)->hostApiType
+                        != (*hostApi)->info.type )
+                    return paIncompatibleHostApiSpecificStreamInfo;
+            }
+        }
+
+        if( outputParameters == NULL )
+        {
+            *hostApiOutputDevice = paNoDevice;
+        }
+        else if( outputParameters->device == paUseHostApiSpecificDeviceSpecification  )
+        {
+            if( outputParameters->hostApiSpecificStreamInfo )
+            {
+                outputHostApiIndex = Pa_HostApiTypeIdToHostApiIndex(
+                        ((PaUtilHostApiSpecificStreamInfoHeader*)outputParameters->hostApiSpecificStreamInfo)->hostApiType );
+
+                if( outputHostApiIndex != -1 )
+                {
+                    *hostApiOutputDevice = paUseHostApiSpecificDeviceSpecification;
+                    *hostApi = hostApis_[outputHostApiIndex];
+                }
+                else
+                {
+                    return paInvalidDevice;
+                }
+            }
+            else
+            {
+                return paInvalidDevice;
+            }
+        }
+        else
+        {
+            if( outputParameters->device < 0 || outputParameters->device >= deviceCount_ )
+                return paInvalidDevice;
+
+            outputHostApiIndex = FindHostApi( outputParameters->device, hostApiOutputDevice );
+            if( outputHostApiIndex < 0 )
+                return paInternalError;
+
+            *hostApi = hostApis_[outputHostApiIndex];
+
+            if( outputParameters->channelCount <= 0 )
+                return paInvalidChannelCount;
+
+            if( !SampleFormatIsValid( outputParameters->sampleFormat ) )
+                return paSampleFormatNotSupported;
+
+            if( outputParameters->hostApiSpecificStreamInfo != NULL )
+            {
+                if( ((PaUtilHostApiSpecificStreamInfoHeader*)outputParameters->hostApiSpecificStreamInfo)->hostApiType
+                        != (*hostApi)->info.type )
+                    return paIncompatibleHostApiSpecificStreamInfo;
+            }
+        }
+
+        if( (inputParameters != NULL) && (outputParameters != NULL) )
+        {
+            /* ensure that both devices use the same API */
+            if( inputHostApiIndex != outputHostApiIndex )
+                return paBadIODeviceCombination;
+        }
+    }
+
+
+    /* Check for absurd sample rates. */
+    if( (sampleRate < 1000.0) || (sampleRate > 384000.0) )
+        return paInvalidSampleRate;
+
+    if( ((streamFlags & ~paPlatformSpecificFlags) & ~(paClipOff | paDitherOff | paNeverDropInput | paPrimeOutputBuffersUsingStreamCallback | paDitherNoiseShaped
+            | paConvertSampleRate | paConvertSampleRateFast | paConvertSampleRateBest
+            | paCompensateClockDrift | paSkipSilentOutput | paSoftClip
+            | paFlushDenormals | paBatchCallbacks | paMeterLevels | paManualProcessing
+            | paPreferCheapestConversion ) ) != 0 )
+        return paInvalidFlag;
+
+    /* batching and manual processing only apply to callbacks */
+    if( (streamFlags & (paBatchCallbacks | paManualProcessing)) && !streamCallback )
+        return paInvalidFlag;
+
+    if( streamFlags & (paConvertSampleRateFast | paConvertSampleRateBest) )
+    {
+        /* a quality is only meaningful for a conversion, and only one of them */
+        if( !(streamFlags & paConvertSampleRate)
+                || ((streamFlags & paConvertSampleRateFast) && (streamFlags & paConvertSampleRateBest)) )
+            return paInvalidFlag;
+    }
+
+    if( streamFlags & paNeverDropInput )
+    {
+        /* must be a callback stream */
+        if( !streamCallback )
+             return paInvalidFlag;
+
+        /* must be a full duplex stream */
+        if( (inputParameters == NULL) || (outputParameters == NULL) )
+            return paInvalidFlag;
+
+        /* must use paFramesPerBufferUnspecified */
+        if( framesPerBuffer != paFramesPerBufferUnspecified )
+            return paInvalidFlag;
+    }
+
+    if( streamFlags & paCompensateClockDrift )
+    {
+        /* must be a full duplex callback stream */
+        if( !streamCallback || (inputParameters == NULL) || (outputParameters == NULL) )
+             return paInvalidFlag;
+    }
+
+    return paNoError;
+}
+
+
+PaError Pa_IsFormatSupported( const PaStreamParameters *inputParameters,
+                              const PaStreamParameters *outputParameters,
+                              double sampleRate )
+{
+    PaError result;
+    PaUtilHostApiRepresentation *hostApi = 0;
+    PaDeviceIndex hostApiInputDevice = paNoDevice, hostApiOutputDevice = paNoDevice;
+    PaStreamParameters hostApiInputParameters, hostApiOutputParameters;
+    PaStreamParameters *hostApiInputParametersPtr, *hostApiOutputParametersPtr;
+
+
+#ifdef PA_LOG_API_CALLS
+    PA_LOGAPI_ENTER_PARAMS( "Pa_IsFormatSupported" );
+
+    if( inputParameters == NULL ){
+        PA_LOGAPI(("\tPaStreamParameters *inputParameters: NULL\n" ));
+    }else{
+        PA_LOGAPI(("\tPaStreamParameters *inputParameters: 0x%p\n", inputParameters ));
+        PA_LOGAPI(("\tPaDeviceIndex inputParameters->device: %d\n", inputParameters->device ));
+        PA_LOGAPI(("\tint inputParameters->channelCount: %d\n", inputParameters->channelCount ));
+        PA_LOGAPI(("\tPaSampleFormat inputParameters->sampleFormat: %d\n", inputParameters->sampleFormat ));
+        PA_LOGAPI(("\tPaTime inputParameters->suggestedLatency: %f\n", inputParameters->suggestedLatency ));
+        PA_LOGAPI(("\tvoid *inputParameters->hostApiSpecificStreamInfo: 0x%p\n", inputParameters->hostApiSpecificStreamInfo ));
+    }
+
+    if( outputParameters == NULL ){
+        PA_LOGAPI(("\tPaStreamParameters *outputParameters: NULL\n" ));
+    }else{
+        PA_LOGAPI(("\tPaStreamParameters *outputParameters: 0x%p\n", outputParameters ));
+        PA_LOGAPI(("\tPaDeviceIndex outputParameters->device: %d\n", outputParameters->device ));
+        PA_LOGAPI(("\tint outputParameters->channelCount: %d\n", outputParameters->channelCount ));
+        PA_LOGAPI(("\tPaSampleFormat outputParameters->sampleFormat: %d\n", outputParameters->sampleFormat ));
+        PA_LOGAPI(("\tPaTime outputParameters->suggestedLatency: %f\n", outputParameters->suggestedLatency ));
+        PA_LOGAPI(("\tvoid *outputParameters->hostApiSpecificStreamInfo: 0x%p\n", outputParameters->hostApiSpecificStreamInfo ));
+    }
+
+    PA_LOGAPI(("\tdouble sampleRate: %g\n", sampleRate ));
+#endif
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+
+        PA_LOGAPI_EXIT_PAERROR( "Pa_IsFormatSupported", result );
+        return result;
+    }
+
+    result = ValidateOpenStreamParameters( inputParameters,
+                                           outputParameters,
+                                           sampleRate, 0, paNoFlag, 0,
+                                           &hostApi,
+                                           &hostApiInputDevice,
+                                           &hostApiOutputDevice );
+    if( result != paNoError )
+    {
+        PA_LOGAPI_EXIT_PAERROR( "Pa_IsFormatSupported", result );
+        return result;
+    }
+
+
+    if( inputParameters )
+    {
+        hostApiInputParameters.device = hostApiInputDevice;
+        hostApiInputParameters.channelCount = inputParameters->channelCount;
+        hostApiInputParameters.sampleFormat = inputParameters->sampleFormat;
+        hostApiInputParameters.suggestedLatency = inputParameters->suggestedLatency;
+        hostApiInputParameters.hostApiSpecificStreamInfo = inputParameters->hostApiSpecificStreamInfo;
+        hostApiInputParametersPtr = &hostApiInputParameters;
+    }
+    else
+    {
+        hostApiInputParametersPtr = NULL;
+    }
+
+    if( outputParameters )
+    {
+        hostApiOutputParameters.device = hostApiOutputDevice;
+        hostApiOutputParameters.channelCount = outputParameters->channelCount;
+        hostApiOutputParameters.sampleFormat = outputParameters->sampleFormat;
+        hostApiOutputParameters.suggestedLatency = outputParameters->suggestedLatency;
+        hostApiOutputParameters.hostApiSpecificStreamInfo = outputParameters->hostApiSpecificStreamInfo;
+        hostApiOutputParametersPtr = &hostApiOutputParameters;
+    }
+    else
+    {
+        hostApiOutputParametersPtr = NULL;
+    }
+
+    Lock( hostApi->privatePaFrontInfo.lock );
+    result = hostApi->IsFormatSupported( hostApi,
+                                  hostApiInputParametersPtr, hostApiOutputParametersPtr,
+                                  sampleRate );
+    Unlock( hostApi->privatePaFrontInfo.lock );
+
+#ifdef PA_LOG_API_CALLS
+    PA_LOGAPI(("Pa_OpenStream returned:\n" ));
+    if( result == paFormatIsSupported )
+        PA_LOGAPI(("\tPaError: 0 [ paFormatIsSupported ]\n" ));
+    else
+        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+#endif
+
+    return result;
+}
+
+
+PaError Pa_OpenStream( PaStream** stream,
+                       const PaStreamParameters *inputParameters,
+                       const PaStreamParameters *outputParameters,
+                       double sampleRate,
+                       unsigned long framesPerBuffer,
+                       PaStreamFlags streamFlags,
+                       PaStreamCallback *streamCallback,
+                       void *userData )
+{
+    PaError result;
+    PaUtilHostApiRepresentation *hostApi = 0;
+    PaDeviceIndex hostApiInputDevice = paNoDevice, hostApiOutputDevice = paNoDevice;
+    PaStreamParameters hostApiInputParameters, hostApiOutputParameters;
+    PaStreamParameters *hostApiInputParametersPtr, *hostApiOutputParametersPtr;
+
+
+#ifdef PA_LOG_API_CALLS
+    PA_LOGAPI_ENTER_PARAMS( "Pa_OpenStream" );
+    PA_LOGAPI(("\tPaStream** stream: 0x%p\n", stream ));
+
+    if( inputParameters == NULL ){
+        PA_LOGAPI(("\tPaStreamParameters *inputParameters: NULL\n" ));
+    }else{
+        PA_LOGAPI(("\tPaStreamParameters *inputParameters: 0x%p\n", inputParameters ));
+        PA_LOGAPI(("\tPaDeviceIndex inputParameters->device: %d\n", inputParameters->device ));
+        PA_LOGAPI(("\tint inputParameters->channelCount: %d\n", inputParameters->channelCount ));
+        PA_LOGAPI(("\tPaSampleFormat inputParameters->sampleFormat: %d\n", inputParameters->sampleFormat ));
+        PA_LOGAPI(("\tPaTime inputParameters->suggestedLatency: %f\n", inputParameters->suggestedLatency ));
+        PA_LOGAPI(("\tvoid *inputParameters->hostApiSpecificStreamInfo: 0x%p\n", inputParameters->hostApiSpecificStreamInfo ));
+    }
+
+    if( outputParameters == NULL ){
+        PA_LOGAPI(("\tPaStreamParameters *outputParameters: NULL\n" ));
+    }else{
+        PA_LOGAPI(("\tPaStreamParameters *outputParameters: 0x%p\n", outputParameters ));
+        PA_LOGAPI(("\tPaDeviceIndex outputParameters->device: %d\n", outputParameters->device ));
+        PA_LOGAPI(("\tint outputParameters->channelCount: %d\n", outputParameters->channelCount ));
+        PA_LOGAPI(("\tPaSampleFormat outputParameters->sampleFormat: %d\n", outputParameters->sampleFormat ));
+        PA_LOGAPI(("\tPaTime outputParameters->suggestedLatency: %f\n", outputParameters->suggestedLatency ));
+        PA_LOGAPI(("\tvoid *outputParameters->hostApiSpecificStreamInfo: 0x%p\n", outputParameters->hostApiSpecificStreamInfo ));
+    }
+
+    PA_LOGAPI(("\tdouble sampleRate: %g\n", sampleRate ));
+    PA_LOGAPI(("\tunsigned long framesPerBuffer: %d\n", framesPerBuffer ));
+    PA_LOGAPI(("\tPaStreamFlags streamFlags: 0x%x\n", streamFlags ));
+    PA_LOGAPI(("\tPaStreamCallback *streamCallback: 0x%p\n", streamCallback ));
+    PA_LOGAPI(("\tvoid *userData: 0x%p\n", userData ));
+#endif
+
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+
+        PA_LOGAPI(("Pa_OpenStream returned:\n" ));
+        PA_LOGAPI(("\t*(PaStream** stream): undefined\n" ));
+        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+        return result;
+    }
+
+    /* Check for parameter errors.
+        NOTE: make sure this validation list is kept syncronised with the one
+        in pa_hostapi.h
+    */
+
+    if( stream == NULL )
+    {
+        result = paBadStreamPtr;
+
+        PA_LOGAPI(("Pa_OpenStream returned:\n" ));
+        PA_LOGAPI(("\t*(PaStream** stream): undefined\n" ));
+        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+        return result;
+    }
+
+    result = ValidateOpenStreamParameters( inputParameters,
+                                           outputParameters,
+                                           sampleRate, framesPerBuffer,
+                                           streamFlags, streamCallback,
+                                           &hostApi,
+                                           &hostApiInputDevice,
+                                           &hostApiOutputDevice );
+    if( result != paNoError )
+    {
+        PA_LOGAPI(("Pa_OpenStream returned:\n" ));
+        PA_LOGAPI(("\t*(PaStream** stream): undefined\n" ));
+        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+        return result;
+    }
+
+
+    if( inputParameters )
+    {
+        hostApiInputParameters.device = hostApiInputDevice;
+        hostApiInputParameters.channelCount = inputParameters->channelCount;
+        hostApiInputParameters.sampleFormat = inputParameters->sampleFormat;
+        hostApiInputParameters.suggestedLatency = inputParameters->suggestedLatency;
+        hostApiInputParameters.hostApiSpecificStreamInfo = inputParameters->hostApiSpecificStreamInfo;
+        hostApiInputParametersPtr = &hostApiInputParameters;
+    }
+    else
+    {
+        hostApiInputParametersPtr = NULL;
+    }
+
+    if( outputParameters )
+    {
+        hostApiOutputParameters.device = hostApiOutputDevice;
+        hostApiOutputParameters.channelCount = outputParameters->channelCount;
+        hostApiOutputParameters.sampleFormat = outputParameters->sampleFormat;
+        hostApiOutputParameters.suggestedLatency = outputParameters->suggestedLatency;
+        hostApiOutputParameters.hostApiSpecificStreamInfo = outputParameters->hostApiSpecificStreamInfo;
+        hostApiOutputParametersPtr = &hostApiOutputParameters;
+    }
+    else
+    {
+        hostApiOutputParametersPtr = NULL;
+    }
+
+    Lock( hostApi->privatePaFrontInfo.lock );
+    result = hostApi->OpenStream( hostApi, stream,
+                                  hostApiInputParametersPtr, hostApiOutputParametersPtr,
+                                  sampleRate, framesPerBuffer, streamFlags, streamCallback, userData );
+    Unlock( hostApi->privatePaFrontInfo.lock );
+
+    if( result == paNoError )
+    {
+        PA_STREAM_REP( *stream )->hostApi = hostApi;
+        PA_STREAM_REP( *stream )->processesManually = (streamFlags & paManualProcessing) != 0;
+
+        /* host APIs which can't process on the application's thread ignore the flag */
+        if( PA_STREAM_REP( *stream )->processesManually && !PA_STREAM_INTERFACE( *stream )->Process )
+            result = paInvalidFlag;
+        else
+            result = AddOpenStream( *stream );
+        if( result != paNoError )
+        {
+            Lock( hostApi->privatePaFrontInfo.lock );
+            PA_STREAM_INTERFACE( *stream )->Close( *stream );
+            Unlock( hostApi->privatePaFrontInfo.lock );
+            *stream = NULL;
+        }
+    }
+
+
+    PA_LOGAPI(("Pa_OpenStream returned:\n" ));
+    PA_LOGAPI(("\t*(PaStream** stream): 0x%p\n", *stream ));
+    PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+
+    return result;
+}
+
+
+PaError Pa_OpenDefaultStream( PaStream** stream,
+                              int inputChannelCount,
+                              int outputChannelCount,
+                              PaSampleFormat sampleFormat,
+                              double sampleRate,
+                              unsigned long framesPerBuffer,
+                              PaStreamCallback *streamCallback,
+                              void *userData )
+{
+    PaError result;
+    PaStreamParameters hostApiInputParameters, hostApiOutputParameters;
+    PaStreamParameters *hostApiInputParametersPtr, *hostApiOutputParametersPtr;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_OpenDefaultStream" );
+    PA_LOGAPI(("\tPaStream** stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tint inputChannelCount: %d\n", inputChannelCount ));
+    PA_LOGAPI(("\tint outputChannelCount: %d\n", outputChannelCount ));
+    PA_LOGAPI(("\tPaSampleFormat sampleFormat: %d\n", sampleFormat ));
+    PA_LOGAPI(("\tdouble sampleRate: %g\n", sampleRate ));
+    PA_LOGAPI(("\tunsigned long framesPerBuffer: %d\n", framesPerBuffer ));
+    PA_LOGAPI(("\tPaStreamCallback *streamCallback: 0x%p\n", streamCallback ));
+    PA_LOGAPI(("\tvoid *userData: 0x%p\n", userData ));
+
+
+    if( inputChannelCount > 0 )
+    {
+        hostApiInputParameters.device = Pa_GetDefaultInputDevice();
+		if( hostApiInputParameters.device == paNoDevice )
+			return paDeviceUnavailable;
+
+        hostApiInputParameters.channelCount = inputChannelCount;
+        hostApiInputParameters.sampleFormat = sampleFormat;
+        /* defaultHighInputLatency is used below instead of
+           defaultLowInputLatency because it is more important for the default
+           stream to work reliably than it is for it to work with the lowest
+           latency.
+         */
+        hostApiInputParameters.suggestedLatency =
+             Pa_GetDeviceInfo( hostApiInputParameters.device )->defaultHighInputLatency;
+        hostApiInputParameters.hostApiSpecificStreamInfo = NULL;
+        hostApiInputParametersPtr = &hostApiInputParameters;
+    }
+    else
+    {
+        hostApiInputParametersPtr = NULL;
+    }
+
+    if( outputChannelCount > 0 )
+    {
+        hostApiOutputParameters.device = Pa_GetDefaultOutputDevice();
+		if( hostApiOutputParameters.device == paNoDevice )
+			return paDeviceUnavailable;
+
+        hostApiOutputParameters.channelCount = outputChannelCount;
+        hostApiOutputParameters.sampleFormat = sampleFormat;
+        /* defaultHighOutputLatency is used below instead of
+           defaultLowOutputLatency because it is more important for the default
+           stream to work reliably than it is for it to work with the lowest
+           latency.
+         */
+        hostApiOutputParameters.suggestedLatency =
+             Pa_GetDeviceInfo( hostApiOutputParameters.device )->defaultHighOutputLatency;
+        hostApiOutputParameters.hostApiSpecificStreamInfo = NULL;
+        hostApiOutputParametersPtr = &hostApiOutputParameters;
+    }
+    else
+    {
+        hostApiOutputParametersPtr = NULL;
+    }
+
+
+    result = Pa_OpenStream(
+                 stream, hostApiInputParametersPtr, hostApiOutputParametersPtr,
+                 sampleRate, framesPerBuffer, paNoFlag, streamCallback, userData );
+
+    PA_LOGAPI(("Pa_OpenDefaultStream returned:\n" ));
+    PA_LOGAPI(("\t*(PaStream** stream): 0x%p", *stream ));
+    PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+
+    return result;
+}
+
+
+PaError PaUtil_ValidateStreamPointer( PaStream* stream )
+{
+    if( !PA_IS_INITIALISED_ ) return paNotInitialized;
+
+    if( stream == NULL ) return paBadStreamPtr;
+
+    if( ((PaUtilStreamRepresentation*)stream)->magic != PA_STREAM_MAGIC )
+        return paBadStreamPtr;
+
+    return IsOpenStream( (PaUtilStreamRepresentation*)stream ) ? paNoError : paBadStreamPtr;
+}
+
+
+/* Wait until a stop begun by Pa_StopStreamAsync() has completed. */
+static void WaitForAsyncStop( PaStream *stream )
+{
+    while( PA_STREAM_REP(stream)->isStoppingAsync )
+        Pa_Sleep( 1 );
+    PaUtil_ReadMemoryBarrier();
+}
+
+
+PaError Pa_OpenStreamInArena( PaStream** stream,
+                       const PaStreamParameters *inputParameters,
+                       const PaStreamParameters *outputParameters,
+                       double sampleRate,
+                       unsigned long framesPerBuffer,
+                       PaStreamFlags streamFlags,
+                       PaStreamCallback *streamCallback,
+                       void *userData,
+                       void *arena,
+                       unsigned long arenaSize )
+{
+    PaError result;
+#ifdef PA_THREAD_LOCAL_
+    PaStreamArena streamArena;
+    char *begin, *end;
+    int slot;
+#endif
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_OpenStreamInArena" );
+    PA_LOGAPI(("\tvoid *arena: 0x%p\n", arena ));
+    PA_LOGAPI(("\tunsigned long arenaSize: %lu\n", arenaSize ));
+
+#ifdef PA_THREAD_LOCAL_
+    if( !PA_IS_INITIALISED_ )
+    {
+        result = paNotInitialized;
+        goto done;
+    }
+
+    if( arena == NULL )
+    {
+        result = paBadBufferPtr;
+        goto done;
+    }
+
+    begin = (char*)arena;
+    end = begin + arenaSize;
+    streamArena.next = (char*)(((size_t)begin + PA_STREAM_ARENA_ALIGNMENT_ - 1)
+            & ~(size_t)(PA_STREAM_ARENA_ALIGNMENT_ - 1));
+    streamArena.end = end;
+    streamArena.measuring = 0;
+    streamArena.measured = 0;
+    if( streamArena.next > end )
+    {
+        result = paInsufficientMemory;
+        goto done;
+    }
+
+    slot = RegisterStreamArena( begin, end );
+    if( slot == -1 )
+    {
+        result = paInsufficientMemory;
+        goto done;
+    }
+
+    currentStreamArena_ = &streamArena;
+    result = Pa_OpenStream( stream, inputParameters, outputParameters, sampleRate,
+            framesPerBuffer, streamFlags, streamCallback, userData );
+    currentStreamArena_ = NULL;
+
+    if( result == paNoError )
+        PA_STREAM_REP( *stream )->arenaSlot = slot;
+    else
+        UnregisterStreamArena( slot );
+
+    PA_DEBUG(( "%s: %lu of %lu bytes used\n", __FUNCTION__,
+            (unsigned long)(streamArena.next - begin), arenaSize ));
+
+done:
+#else
+    (void) stream; (void) inputParameters; (void) outputParameters;
+    (void) sampleRate; (void) framesPerBuffer; (void) streamFlags;
+    (void) streamCallback; (void) userData; (void) arena; (void) arenaSize;
+
+    /* the compiler has no thread local storage to track the opening thread */
+    result = paInternalError;
+#endif
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_OpenStreamInArena", result );
+
+    return result;
+}
+
+
+PaError Pa_GetOpenStreamArenaSize( const PaStreamParameters *inputParameters,
+                       const PaStreamParameters *outputParameters,
+                       double sampleRate,
+                       unsigned long framesPerBuffer,
+                       PaStreamFlags streamFlags,
+                       PaStreamCallback *streamCallback,
+                       void *userData,
+                       unsigned long *arenaSize )
+{
+    PaError result;
+#ifdef PA_THREAD_LOCAL_
+    PaStreamArena streamArena;
+    PaStream *stream;
+#endif
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetOpenStreamArenaSize" );
+
+#ifdef PA_THREAD_LOCAL_
+    if( arenaSize == NULL )
+    {
+        result = paBadBufferPtr;
+        goto done;
+    }
+
+    streamArena.next = NULL;
+    streamArena.end = NULL;
+    streamArena.measuring = 1;
+    streamArena.measured = 0;
+
+    currentStreamArena_ = &streamArena;
+    result = Pa_OpenStream( &stream, inputParameters, outputParameters, sampleRate,
+            framesPerBuffer, streamFlags, streamCallback, userData );
+    currentStreamArena_ = NULL;
+
+    if( result == paNoError )
+    {
+        result = Pa_CloseStream( stream );
+
+        /* room to align the caller's arena */
+        *arenaSize = streamArena.measured + PA_STREAM_ARENA_ALIGNMENT_ - 1;
+    }
+
+done:
+#else
+    (void) inputParameters; (void) outputParameters; (void) sampleRate;
+    (void) framesPerBuffer; (void) streamFlags; (void) streamCallback;
+    (void) userData; (void) arenaSize;
+
+    result = paInternalError;
+#endif
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetOpenStreamArenaSize", result );
+
+    return result;
+}
+
+
+PaError Pa_CloseStream( PaStream* stream )
+{
+    PaUtilStreamInterface *interface;
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_CloseStream" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+
+    if( result == paNoError )
+    {
+        /* always remove the open stream from the table, even if this function
+            eventually returns an error. Otherwise CloseOpenStreams() would
+            try to close it again */
+        RemoveOpenStream( stream ); /* be sure to call this _before_ closing the stream */
+
+        interface = PA_STREAM_INTERFACE(stream);
+
+        WaitForAsyncStop( stream );
+
+        /* abort the stream if it isn't stopped */
+        result = PA_STREAM_IS_STOPPED( stream );
+        if( result == 1 )
+            result = paNoError;
+        else if( result == 0 )
+            result = interface->Abort( stream );
+
+        if( result == paNoError )                 /** @todo REVIEW: shouldn't we close anyway? see: http://www.portaudio.com/trac/ticket/115 */
+        {
+            PaUtilHostApiRepresentation *hostApi = PA_STREAM_REP( stream )->hostApi;
+
+            if( PA_STREAM_REP( stream )->headroomNotifier )
+            {
+                PaUtil_SetStreamHeadroomNotifier( PA_STREAM_REP( stream )->statistics, NULL );
+                PaUtil_DestroyHeadroomNotifier( PA_STREAM_REP( stream )->headroomNotifier );
+                PA_STREAM_REP( stream )->headroomNotifier = NULL;
+            }
+
+            int arenaSlot = PA_STREAM_REP( stream )->arenaSlot;
+
+            Lock( hostApi->privatePaFrontInfo.lock );
+            result = interface->Close( stream );
+            Unlock( hostApi->privatePaFrontInfo.lock );
+
+            /* the stream is gone, its arena may be reused by the caller */
+            if( arenaSlot != -1 )
+                UnregisterStreamArena( arenaSlot );
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_CloseStream", result );
+
+    return result;
+}
+
+
+PaError Pa_SetStreamFinishedCallback( PaStream *stream, PaStreamFinishedCallback* streamFinishedCallback )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamFinishedCallback" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamFinishedCallback* streamFinishedCallback: 0x%p\n", streamFinishedCallback ));
+
+    if( result == paNoError )
+    {
+        result = PA_STREAM_IS_STOPPED( stream );
+        if( result == 0 )
+        {
+            result = paStreamIsNotStopped ;
+        }
+        if( result == 1 )
+        {
+            PA_STREAM_REP( stream )->streamFinishedCallback = streamFinishedCallback;
+            result = paNoError;
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamFinishedCallback", result );
+
+    return result;
+
+}
+
+
+/* A paused stream is neither stopped nor active, whatever the host API
+   reports; without Pause and Resume it has been aborted. */
+static PaError IsStreamStopped( PaStream *stream )
+{
+    if( PA_STREAM_REP(stream)->isPaused )
+        return 0;
+    return PA_STREAM_IS_STOPPED( stream );
+}
 
-            outputHostApiIndex = FindHostApi( outputParameters->device, hostApiOutputDevice );
-            if( outputHostApiIndex < 0 )
-                return paInternalError;
 
-            *hostApi = hostApis_[outputHostApiIndex];
+PaError Pa_SetStreamHeadroomCallback( PaStream *stream, PaTime threshold,
+                                      PaStreamHeadroomCallback *callback, void *userData )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaUtilStreamRepresentation *streamRepresentation;
+    PaUtilHeadroomNotifier *notifier = NULL;
 
-            if( outputParameters->channelCount <= 0 )
-                return paInvalidChannelCount;
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamHeadroomCallback" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaTime threshold: %g\n", threshold ));
+    PA_LOGAPI(("\tPaStreamHeadroomCallback* callback: 0x%p\n", callback ));
+    PA_LOGAPI(("\tvoid* userData: 0x%p\n", userData ));
 
-            if( !SampleFormatIsValid( outputParameters->sampleFormat ) )
-                return paSampleFormatNotSupported;
+    if( result == paNoError )
+    {
+        streamRepresentation = PA_STREAM_REP( stream );
 
-            if( outputParameters->hostApiSpecificStreamInfo != NULL )
-            {
-                if( ((PaUtilHostApiSpecificStreamInfoHeader*)outputParameters->hostApiSpecificStreamInfo)->hostApiType
-                        != (*hostApi)->info.type )
-                    return paIncompatibleHostApiSpecificStreamInfo;
-            }
-        }
+        if( !streamRepresentation->statistics )
+            result = paIncompatibleStreamHostApi;
+        else if( streamRepresentation->isStoppingAsync )
+            result = paStreamIsNotStopped;
+        else
+            result = IsStreamStopped( stream );
 
-        if( (inputParameters != NULL) && (outputParameters != NULL) )
+        if( result == 0 )
         {
-            /* ensure that both devices use the same API */
-            if( inputHostApiIndex != outputHostApiIndex )
-                return paBadIODeviceCombination;
+            result = paStreamIsNotStopped;
+        }
+        else if( result == 1 )
+        {
+            result = paNoError;
+            if( callback )
+                result = PaUtil_CreateHeadroomNotifier( &notifier, stream, threshold, callback, userData );
+
+            if( result == paNoError )
+            {
+                /* the callback thread isn't running, the notifiers may be swapped */
+                PaUtil_SetStreamHeadroomNotifier( streamRepresentation->statistics, notifier );
+                if( streamRepresentation->headroomNotifier )
+                    PaUtil_DestroyHeadroomNotifier( streamRepresentation->headroomNotifier );
+                streamRepresentation->headroomNotifier = notifier;
+            }
         }
     }
 
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamHeadroomCallback", result );
 
-    /* Check for absurd sample rates. */
-    if( (sampleRate < 1000.0) || (sampleRate > 384000.0) )
-        return paInvalidSampleRate;
+    return result;
+}
 
-    if( ((streamFlags & ~paPlatformSpecificFlags) & ~(paClipOff | paDitherOff | paNeverDropInput | paPrimeOutputBuffersUsingStreamCallback ) ) != 0 )
-        return paInvalidFlag;
 
-    if( streamFlags & paNeverDropInput )
+PaError Pa_AddStreamTap( PaStream *stream, PaStreamTapSource source,
+                         PaTime bufferDuration, PaStreamTap **tap )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaUtilStreamRepresentation *streamRepresentation;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_AddStreamTap" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamTapSource source: %d\n", source ));
+    PA_LOGAPI(("\tPaTime bufferDuration: %g\n", bufferDuration ));
+    PA_LOGAPI(("\tPaStreamTap** tap: 0x%p\n", tap ));
+
+    if( result == paNoError )
     {
-        /* must be a callback stream */
-        if( !streamCallback )
-             return paInvalidFlag;
+        streamRepresentation = PA_STREAM_REP( stream );
 
-        /* must be a full duplex stream */
-        if( (inputParameters == NULL) || (outputParameters == NULL) )
-            return paInvalidFlag;
+        if( !tap )
+            result = paBadStreamPtr;
+        else if( !streamRepresentation->taps || !streamRepresentation->streamCallback )
+            result = paIncompatibleStreamHostApi;
+        else if( streamRepresentation->isStoppingAsync )
+            result = paStreamIsNotStopped;
+        else
+            result = IsStreamStopped( stream );
 
-        /* must use paFramesPerBufferUnspecified */
-        if( framesPerBuffer != paFramesPerBufferUnspecified )
-            return paInvalidFlag;
+        if( result == 0 )
+            result = paStreamIsNotStopped;
+        else if( result == 1 )
+            /* the callback thread isn't running, a ring may be added */
+            result = PaUtil_AddStreamTap( streamRepresentation->taps, source, bufferDuration, tap );
     }
 
-    return paNoError;
+    PA_LOGAPI_EXIT_PAERROR( "Pa_AddStreamTap", result );
+
+    return result;
 }
 
 
-PaError Pa_IsFormatSupported( const PaStreamParameters *inputParameters,
-                              const PaStreamParameters *outputParameters,
-                              double sampleRate )
+signed long Pa_ReadStreamTap( PaStreamTap *tap, void *buffer, unsigned long frames )
 {
-    PaError result;
-    PaUtilHostApiRepresentation *hostApi = 0;
-    PaDeviceIndex hostApiInputDevice = paNoDevice, hostApiOutputDevice = paNoDevice;
-    PaStreamParameters hostApiInputParameters, hostApiOutputParameters;
-    PaStreamParameters *hostApiInputParametersPtr, *hostApiOutputParametersPtr;
+    signed long result;
 
+    PA_LOGAPI_ENTER_PARAMS( "Pa_ReadStreamTap" );
+    PA_LOGAPI(("\tPaStreamTap* tap: 0x%p\n", tap ));
+    PA_LOGAPI(("\tvoid* buffer: 0x%p\n", buffer ));
+    PA_LOGAPI(("\tunsigned long frames: %lu\n", frames ));
 
-#ifdef PA_LOG_API_CALLS
-    PA_LOGAPI_ENTER_PARAMS( "Pa_IsFormatSupported" );
+    if( !tap )
+        result = paBadStreamPtr;
+    else if( !buffer && frames != 0 )
+        result = paBadBufferPtr;
+    else
+        result = PaUtil_ReadStreamTap( tap, buffer, frames );
 
-    if( inputParameters == NULL ){
-        PA_LOGAPI(("\tPaStreamParameters *inputParameters: NULL\n" ));
-    }else{
-        PA_LOGAPI(("\tPaStreamParameters *inputParameters: 0x%p\n", inputParameters ));
-        PA_LOGAPI(("\tPaDeviceIndex inputParameters->device: %d\n", inputParameters->device ));
-        PA_LOGAPI(("\tint inputParameters->channelCount: %d\n", inputParameters->channelCount ));
-        PA_LOGAPI(("\tPaSampleFormat inputParameters->sampleFormat: %d\n", inputParameters->sampleFormat ));
-        PA_LOGAPI(("\tPaTime inputParameters->suggestedLatency: %f\n", inputParameters->suggestedLatency ));
-        PA_LOGAPI(("\tvoid *inputParameters->hostApiSpecificStreamInfo: 0x%p\n", inputParameters->hostApiSpecificStreamInfo ));
-    }
+    PA_LOGAPI(("Pa_ReadStreamTap returned:\n" ));
+    PA_LOGAPI(("\tsigned long: %ld\n", result ));
 
-    if( outputParameters == NULL ){
-        PA_LOGAPI(("\tPaStreamParameters *outputParameters: NULL\n" ));
-    }else{
-        PA_LOGAPI(("\tPaStreamParameters *outputParameters: 0x%p\n", outputParameters ));
-        PA_LOGAPI(("\tPaDeviceIndex outputParameters->device: %d\n", outputParameters->device ));
-        PA_LOGAPI(("\tint outputParameters->channelCount: %d\n", outputParameters->channelCount ));
-        PA_LOGAPI(("\tPaSampleFormat outputParameters->sampleFormat: %d\n", outputParameters->sampleFormat ));
-        PA_LOGAPI(("\tPaTime outputParameters->suggestedLatency: %f\n", outputParameters->suggestedLatency ));
-        PA_LOGAPI(("\tvoid *outputParameters->hostApiSpecificStreamInfo: 0x%p\n", outputParameters->hostApiSpecificStreamInfo ));
-    }
+    return result;
+}
 
-    PA_LOGAPI(("\tdouble sampleRate: %g\n", sampleRate ));
-#endif
 
-    if( !PA_IS_INITIALISED_ )
-    {
-        result = paNotInitialized;
+signed long Pa_GetStreamTapReadAvailable( PaStreamTap *tap )
+{
+    signed long result;
 
-        PA_LOGAPI_EXIT_PAERROR( "Pa_IsFormatSupported", result );
-        return result;
-    }
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamTapReadAvailable" );
+    PA_LOGAPI(("\tPaStreamTap* tap: 0x%p\n", tap ));
 
-    result = ValidateOpenStreamParameters( inputParameters,
-                                           outputParameters,
-                                           sampleRate, 0, paNoFlag, 0,
-                                           &hostApi,
-                                           &hostApiInputDevice,
-                                           &hostApiOutputDevice );
-    if( result != paNoError )
-    {
-        PA_LOGAPI_EXIT_PAERROR( "Pa_IsFormatSupported", result );
-        return result;
-    }
+    result = tap ? PaUtil_GetStreamTapReadAvailable( tap ) : paBadStreamPtr;
 
+    PA_LOGAPI(("Pa_GetStreamTapReadAvailable returned:\n" ));
+    PA_LOGAPI(("\tsigned long: %ld\n", result ));
 
-    if( inputParameters )
-    {
-        hostApiInputParameters.device = hostApiInputDevice;
-        hostApiInputParameters.channelCount = inputParameters->channelCount;
-        hostApiInputParameters.sampleFormat = inputParameters->sampleFormat;
-        hostApiInputParameters.suggestedLatency = inputParameters->suggestedLatency;
-        hostApiInputParameters.hostApiSpecificStreamInfo = inputParameters->hostApiSpecificStreamInfo;
-        hostApiInputParametersPtr = &hostApiInputParameters;
-    }
+    return result;
+}
+
+
+unsigned long Pa_GetStreamTapDroppedFrames( PaStreamTap *tap )
+{
+    return tap ? PaUtil_GetStreamTapDroppedFrames( tap ) : 0;
+}
+
+
+PaError Pa_RemoveStreamTap( PaStreamTap *tap )
+{
+    PaError result = paNoError;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_RemoveStreamTap" );
+    PA_LOGAPI(("\tPaStreamTap* tap: 0x%p\n", tap ));
+
+    if( !tap )
+        result = paBadStreamPtr;
     else
+        PaUtil_RemoveStreamTap( tap );
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_RemoveStreamTap", result );
+
+    return result;
+}
+
+
+PaError Pa_GetStreamLevels( PaStream *stream, PaStreamTapSource source,
+                            PaStreamChannelLevel *levels, int channelCount )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamLevels" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamTapSource source: %d\n", source ));
+    PA_LOGAPI(("\tPaStreamChannelLevel* levels: 0x%p\n", levels ));
+    PA_LOGAPI(("\tint channelCount: %d\n", channelCount ));
+
+    if( result == paNoError )
     {
-        hostApiInputParametersPtr = NULL;
+        if( !PA_STREAM_REP(stream)->levelMeter )
+            result = paIncompatibleStreamHostApi;
+        else if( !levels )
+            result = paBadBufferPtr;
+        else
+            result = PaUtil_GetLevels( PA_STREAM_REP(stream)->levelMeter, source, levels, channelCount );
     }
 
-    if( outputParameters )
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetStreamLevels", result );
+
+    return result;
+}
+
+
+PaError Pa_SetStreamOutputChannelSilent( PaStream *stream, int channel, int silent )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamOutputChannelSilent" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tint channel: %d\n", channel ));
+    PA_LOGAPI(("\tint silent: %d\n", silent ));
+
+    if( result == paNoError )
     {
-        hostApiOutputParameters.device = hostApiOutputDevice;
-        hostApiOutputParameters.channelCount = outputParameters->channelCount;
-        hostApiOutputParameters.sampleFormat = outputParameters->sampleFormat;
-        hostApiOutputParameters.suggestedLatency = outputParameters->suggestedLatency;
-        hostApiOutputParameters.hostApiSpecificStreamInfo = outputParameters->hostApiSpecificStreamInfo;
-        hostApiOutputParametersPtr = &hostApiOutputParameters;
+        if( !PA_STREAM_REP(stream)->silentOutputChannels )
+            result = paIncompatibleStreamHostApi;
+        else
+            result = PaUtil_SetSilentChannel( PA_STREAM_REP(stream)->silentOutputChannels, channel, silent );
     }
-    else
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamOutputChannelSilent", result );
+
+    return result;
+}
+
+
+PaError Pa_SetStreamOutputGain( PaStream *stream, int channel, float gain, PaTime rampTime )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamOutputGain" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tint channel: %d\n", channel ));
+    PA_LOGAPI(("\tfloat gain: %f\n", gain ));
+    PA_LOGAPI(("\tPaTime rampTime: %f\n", rampTime ));
+
+    if( result == paNoError )
     {
-        hostApiOutputParametersPtr = NULL;
+        if( !PA_STREAM_REP(stream)->outputGain )
+            result = paIncompatibleStreamHostApi;
+        else
+            result = PaUtil_SetOutputGain( PA_STREAM_REP(stream)->outputGain, channel, gain, rampTime );
     }
 
-    result = hostApi->IsFormatSupported( hostApi,
-                                  hostApiInputParametersPtr, hostApiOutputParametersPtr,
-                                  sampleRate );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamOutputGain", result );
 
-#ifdef PA_LOG_API_CALLS
-    PA_LOGAPI(("Pa_OpenStream returned:\n" ));
-    if( result == paFormatIsSupported )
-        PA_LOGAPI(("\tPaError: 0 [ paFormatIsSupported ]\n" ));
-    else
-        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
-#endif
+    return result;
+}
+
+
+PaError Pa_StartStream( PaStream *stream )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StartStream" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+
+    if( result == paNoError )
+    {
+        result = IsStreamStopped( stream );
+        if( result == 0 )
+        {
+            result = paStreamIsNotStopped ;
+        }
+        else if( result == 1 )
+        {
+            result = PA_STREAM_INTERFACE(stream)->Start( stream );
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StartStream", result );
 
     return result;
 }
 
 
-PaError Pa_OpenStream( PaStream** stream,
-                       const PaStreamParameters *inputParameters,
-                       const PaStreamParameters *outputParameters,
-                       double sampleRate,
-                       unsigned long framesPerBuffer,
-                       PaStreamFlags streamFlags,
-                       PaStreamCallback *streamCallback,
-                       void *userData )
+PaError Pa_StartStreamAtTime( PaStream *stream, PaTime startTime )
 {
-    PaError result;
-    PaUtilHostApiRepresentation *hostApi = 0;
-    PaDeviceIndex hostApiInputDevice = paNoDevice, hostApiOutputDevice = paNoDevice;
-    PaStreamParameters hostApiInputParameters, hostApiOutputParameters;
-    PaStreamParameters *hostApiInputParametersPtr, *hostApiOutputParametersPtr;
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaTime delay;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StartStreamAtTime" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaTime startTime: %f\n", startTime ));
+
+    if( result == paNoError )
+    {
+        result = IsStreamStopped( stream );
+        if( result == 0 )
+        {
+            result = paStreamIsNotStopped ;
+        }
+        else if( result == 1 )
+        {
+            if( PA_STREAM_INTERFACE(stream)->StartAtTime )
+            {
+                result = PA_STREAM_INTERFACE(stream)->StartAtTime( stream, startTime );
+            }
+            else
+            {
+                /* start the stream as close to the time as the host API allows */
+                delay = startTime - PA_STREAM_REP(stream)->streamInfo.outputLatency
+                        - PA_STREAM_GET_TIME( stream );
+                if( delay > 0. )
+                    Pa_Sleep( (long)(delay * 1000.) );
+                result = PA_STREAM_INTERFACE(stream)->Start( stream );
+            }
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StartStreamAtTime", result );
 
+    return result;
+}
 
-#ifdef PA_LOG_API_CALLS
-    PA_LOGAPI_ENTER_PARAMS( "Pa_OpenStream" );
-    PA_LOGAPI(("\tPaStream** stream: 0x%p\n", stream ));
 
-    if( inputParameters == NULL ){
-        PA_LOGAPI(("\tPaStreamParameters *inputParameters: NULL\n" ));
-    }else{
-        PA_LOGAPI(("\tPaStreamParameters *inputParameters: 0x%p\n", inputParameters ));
-        PA_LOGAPI(("\tPaDeviceIndex inputParameters->device: %d\n", inputParameters->device ));
-        PA_LOGAPI(("\tint inputParameters->channelCount: %d\n", inputParameters->channelCount ));
-        PA_LOGAPI(("\tPaSampleFormat inputParameters->sampleFormat: %d\n", inputParameters->sampleFormat ));
-        PA_LOGAPI(("\tPaTime inputParameters->suggestedLatency: %f\n", inputParameters->suggestedLatency ));
-        PA_LOGAPI(("\tvoid *inputParameters->hostApiSpecificStreamInfo: 0x%p\n", inputParameters->hostApiSpecificStreamInfo ));
-    }
+/* Time Pa_StartStreams() allows for starting the streams one after another,
+   beyond their latencies: ALSA primes its buffers, others wait for their threads */
+#define PA_START_STREAMS_MARGIN_ (.1)
 
-    if( outputParameters == NULL ){
-        PA_LOGAPI(("\tPaStreamParameters *outputParameters: NULL\n" ));
-    }else{
-        PA_LOGAPI(("\tPaStreamParameters *outputParameters: 0x%p\n", outputParameters ));
-        PA_LOGAPI(("\tPaDeviceIndex outputParameters->device: %d\n", outputParameters->device ));
-        PA_LOGAPI(("\tint outputParameters->channelCount: %d\n", outputParameters->channelCount ));
-        PA_LOGAPI(("\tPaSampleFormat outputParameters->sampleFormat: %d\n", outputParameters->sampleFormat ));
-        PA_LOGAPI(("\tPaTime outputParameters->suggestedLatency: %f\n", outputParameters->suggestedLatency ));
-        PA_LOGAPI(("\tvoid *outputParameters->hostApiSpecificStreamInfo: 0x%p\n", outputParameters->hostApiSpecificStreamInfo ));
-    }
+static PaTime GetStartLatency( PaStream *stream )
+{
+    const PaStreamInfo *streamInfo = &PA_STREAM_REP(stream)->streamInfo;
 
-    PA_LOGAPI(("\tdouble sampleRate: %g\n", sampleRate ));
-    PA_LOGAPI(("\tunsigned long framesPerBuffer: %d\n", framesPerBuffer ));
-    PA_LOGAPI(("\tPaStreamFlags streamFlags: 0x%x\n", streamFlags ));
-    PA_LOGAPI(("\tPaStreamCallback *streamCallback: 0x%p\n", streamCallback ));
-    PA_LOGAPI(("\tvoid *userData: 0x%p\n", userData ));
-#endif
+    return streamInfo->outputLatency > 0. ? streamInfo->outputLatency : streamInfo->inputLatency;
+}
 
-    if( !PA_IS_INITIALISED_ )
-    {
-        result = paNotInitialized;
 
-        PA_LOGAPI(("Pa_OpenStream returned:\n" ));
-        PA_LOGAPI(("\t*(PaStream** stream): undefined\n" ));
-        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
-        return result;
-    }
+PaError Pa_StartStreams( PaStream **streams, int count )
+{
+    PaError result = paNoError;
+    PaTime startTime, latency = 0., due, earliestDue;
+    unsigned char *isStarted = NULL;
+    int i, next;
 
-    /* Check for parameter errors.
-        NOTE: make sure this validation list is kept syncronised with the one
-        in pa_hostapi.h
-    */
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StartStreams" );
+    PA_LOGAPI(("\tPaStream** streams: 0x%p\n", streams ));
+    PA_LOGAPI(("\tint count: %d\n", count ));
 
-    if( stream == NULL )
+    if( count > 0 && !streams )
     {
         result = paBadStreamPtr;
-
-        PA_LOGAPI(("Pa_OpenStream returned:\n" ));
-        PA_LOGAPI(("\t*(PaStream** stream): undefined\n" ));
-        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
-        return result;
+        goto done;
     }
-
-    result = ValidateOpenStreamParameters( inputParameters,
-                                           outputParameters,
-                                           sampleRate, framesPerBuffer,
-                                           streamFlags, streamCallback,
-                                           &hostApi,
-                                           &hostApiInputDevice,
-                                           &hostApiOutputDevice );
-    if( result != paNoError )
+    for( i = 0; i < count && result == paNoError; ++i )
     {
-        PA_LOGAPI(("Pa_OpenStream returned:\n" ));
-        PA_LOGAPI(("\t*(PaStream** stream): undefined\n" ));
-        PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
-        return result;
+        result = PaUtil_ValidateStreamPointer( streams[i] );
+        if( result == paNoError )
+        {
+            result = IsStreamStopped( streams[i] );
+            if( result == 0 )
+                result = paStreamIsNotStopped;
+            else if( result == 1 )
+                result = paNoError;
+        }
+        if( result == paNoError && GetStartLatency( streams[i] ) > latency )
+            latency = GetStartLatency( streams[i] );
     }
+    if( result != paNoError || count <= 0 )
+        goto done;
 
-
-    if( inputParameters )
+    isStarted = (unsigned char*)PaUtil_AllocateMemory( count );
+    if( !isStarted )
     {
-        hostApiInputParameters.device = hostApiInputDevice;
-        hostApiInputParameters.channelCount = inputParameters->channelCount;
-        hostApiInputParameters.sampleFormat = inputParameters->sampleFormat;
-        hostApiInputParameters.suggestedLatency = inputParameters->suggestedLatency;
-        hostApiInputParameters.hostApiSpecificStreamInfo = inputParameters->hostApiSpecificStreamInfo;
-        hostApiInputParametersPtr = &hostApiInputParameters;
+        result = paInsufficientMemory;
+        goto done;
     }
-    else
+    memset( isStarted, 0, count );
+
+    /* in PaUtil_GetTime() time, converted to the time base of each stream below */
+    startTime = PaUtil_GetTime() + latency + PA_START_STREAMS_MARGIN_;
+
+    /* the streams which schedule their start first, they return right away */
+    for( i = 0; i < count && result == paNoError; ++i )
     {
-        hostApiInputParametersPtr = NULL;
+        if( PA_STREAM_INTERFACE(streams[i])->StartAtTime )
+        {
+            result = PA_STREAM_INTERFACE(streams[i])->StartAtTime( streams[i], startTime
+                    + PA_STREAM_GET_TIME( streams[i] ) - PaUtil_GetTime() );
+            isStarted[i] = (result == paNoError);
+        }
     }
 
-    if( outputParameters )
+    /* then the others, each at the start time less its latency */
+    while( result == paNoError )
     {
-        hostApiOutputParameters.device = hostApiOutputDevice;
-        hostApiOutputParameters.channelCount = outputParameters->channelCount;
-        hostApiOutputParameters.sampleFormat = outputParameters->sampleFormat;
-        hostApiOutputParameters.suggestedLatency = outputParameters->suggestedLatency;
-        hostApiOutputParameters.hostApiSpecificStreamInfo = outputParameters->hostApiSpecificStreamInfo;
-        hostApiOutputParametersPtr = &hostApiOutputParameters;
+        next = -1;
+        earliestDue = 0.;
+        for( i = 0; i < count; ++i )
+        {
+            due = startTime - GetStartLatency( streams[i] );
+            if( !isStarted[i] && (next == -1 || due < earliestDue) )
+            {
+                next = i;
+                earliestDue = due;
+            }
+        }
+        if( next == -1 )
+            break;
+
+        while( PaUtil_GetTime() < earliestDue )
+            Pa_Sleep( 1 );
+        result = PA_STREAM_INTERFACE(streams[next])->Start( streams[next] );
+        isStarted[next] = (result == paNoError);
     }
-    else
+
+    if( result != paNoError )
     {
-        hostApiOutputParametersPtr = NULL;
+        for( i = 0; i < count; ++i )
+        {
+            if( isStarted[i] )
+                PA_STREAM_INTERFACE(streams[i])->Abort( streams[i] );
+        }
     }
 
-    result = hostApi->OpenStream( hostApi, stream,
-                                  hostApiInputParametersPtr, hostApiOutputParametersPtr,
-                                  sampleRate, framesPerBuffer, streamFlags, streamCallback, userData );
-
-    if( result == paNoError )
-        AddOpenStream( *stream );
-
+done:
+    PaUtil_FreeMemory( isStarted );
 
-    PA_LOGAPI(("Pa_OpenStream returned:\n" ));
-    PA_LOGAPI(("\t*(PaStream** stream): 0x%p\n", *stream ));
-    PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StartStreams", result );
 
     return result;
 }
 
 
-PaError Pa_OpenDefaultStream( PaStream** stream,
-                              int inputChannelCount,
-                              int outputChannelCount,
-                              PaSampleFormat sampleFormat,
-                              double sampleRate,
-                              unsigned long framesPerBuffer,
-                              PaStreamCallback *streamCallback,
-                              void *userData )
+PaError Pa_StopStream( PaStream *stream )
 {
-    PaError result;
-    PaStreamParameters hostApiInputParameters, hostApiOutputParameters;
-    PaStreamParameters *hostApiInputParametersPtr, *hostApiOutputParametersPtr;
-
-    PA_LOGAPI_ENTER_PARAMS( "Pa_OpenDefaultStream" );
-    PA_LOGAPI(("\tPaStream** stream: 0x%p\n", stream ));
-    PA_LOGAPI(("\tint inputChannelCount: %d\n", inputChannelCount ));
-    PA_LOGAPI(("\tint outputChannelCount: %d\n", outputChannelCount ));
-    PA_LOGAPI(("\tPaSampleFormat sampleFormat: %d\n", sampleFormat ));
-    PA_LOGAPI(("\tdouble sampleRate: %g\n", sampleRate ));
-    PA_LOGAPI(("\tunsigned long framesPerBuffer: %d\n", framesPerBuffer ));
-    PA_LOGAPI(("\tPaStreamCallback *streamCallback: 0x%p\n", streamCallback ));
-    PA_LOGAPI(("\tvoid *userData: 0x%p\n", userData ));
-
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    int wasPaused;
 
-    if( inputChannelCount > 0 )
-    {
-        hostApiInputParameters.device = Pa_GetDefaultInputDevice();
-		if( hostApiInputParameters.device == paNoDevice )
-			return paDeviceUnavailable;
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StopStream" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
-        hostApiInputParameters.channelCount = inputChannelCount;
-        hostApiInputParameters.sampleFormat = sampleFormat;
-        /* defaultHighInputLatency is used below instead of
-           defaultLowInputLatency because it is more important for the default
-           stream to work reliably than it is for it to work with the lowest
-           latency.
-         */
-        hostApiInputParameters.suggestedLatency =
-             Pa_GetDeviceInfo( hostApiInputParameters.device )->defaultHighInputLatency;
-        hostApiInputParameters.hostApiSpecificStreamInfo = NULL;
-        hostApiInputParametersPtr = &hostApiInputParameters;
-    }
-    else
+    if( result == paNoError && PA_STREAM_REP(stream)->isStoppingAsync )
     {
-        hostApiInputParametersPtr = NULL;
+        /* Pa_StopStreamAsync() is stopping the stream, return once it has */
+        WaitForAsyncStop( stream );
     }
-
-    if( outputChannelCount > 0 )
+    else if( result == paNoError )
     {
-        hostApiOutputParameters.device = Pa_GetDefaultOutputDevice();
-		if( hostApiOutputParameters.device == paNoDevice )
-			return paDeviceUnavailable;
+        wasPaused = PA_STREAM_REP(stream)->isPaused;
+        PA_STREAM_REP(stream)->isPaused = 0;
 
-        hostApiOutputParameters.channelCount = outputChannelCount;
-        hostApiOutputParameters.sampleFormat = sampleFormat;
-        /* defaultHighOutputLatency is used below instead of
-           defaultLowOutputLatency because it is more important for the default
-           stream to work reliably than it is for it to work with the lowest
-           latency.
-         */
-        hostApiOutputParameters.suggestedLatency =
-             Pa_GetDeviceInfo( hostApiOutputParameters.device )->defaultHighOutputLatency;
-        hostApiOutputParameters.hostApiSpecificStreamInfo = NULL;
-        hostApiOutputParametersPtr = &hostApiOutputParameters;
-    }
-    else
-    {
-        hostApiOutputParametersPtr = NULL;
+        result = PA_STREAM_IS_STOPPED( stream );
+        if( result == 0 )
+        {
+            result = PA_STREAM_INTERFACE(stream)->Stop( stream );
+        }
+        else if( result == 1 )
+        {
+            /* a stream paused without Pause and Resume is already aborted */
+            result = wasPaused ? paNoError : paStreamIsStopped;
+        }
     }
 
-
-    result = Pa_OpenStream(
-                 stream, hostApiInputParametersPtr, hostApiOutputParametersPtr,
-                 sampleRate, framesPerBuffer, paNoFlag, streamCallback, userData );
-
-    PA_LOGAPI(("Pa_OpenDefaultStream returned:\n" ));
-    PA_LOGAPI(("\t*(PaStream** stream): 0x%p", *stream ));
-    PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StopStream", result );
 
     return result;
 }
 
 
-PaError PaUtil_ValidateStreamPointer( PaStream* stream )
+PaError Pa_AbortStream( PaStream *stream )
 {
-    if( !PA_IS_INITIALISED_ ) return paNotInitialized;
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    int wasPaused;
 
-    if( stream == NULL ) return paBadStreamPtr;
+    PA_LOGAPI_ENTER_PARAMS( "Pa_AbortStream" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
-    if( ((PaUtilStreamRepresentation*)stream)->magic != PA_STREAM_MAGIC )
-        return paBadStreamPtr;
+    if( result == paNoError && PA_STREAM_REP(stream)->isStoppingAsync )
+    {
+        /* Pa_StopStreamAsync() is stopping the stream, return once it has */
+        WaitForAsyncStop( stream );
+    }
+    else if( result == paNoError )
+    {
+        wasPaused = PA_STREAM_REP(stream)->isPaused;
+        PA_STREAM_REP(stream)->isPaused = 0;
 
-    return paNoError;
+        result = PA_STREAM_IS_STOPPED( stream );
+        if( result == 0 )
+        {
+            result = PA_STREAM_INTERFACE(stream)->Abort( stream );
+        }
+        else if( result == 1 )
+        {
+            /* a stream paused without Pause and Resume is already aborted */
+            result = wasPaused ? paNoError : paStreamIsStopped;
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_AbortStream", result );
+
+    return result;
 }
 
 
-PaError Pa_CloseStream( PaStream* stream )
+typedef struct PaAsyncStopRequest
 {
-    PaUtilStreamInterface *interface;
-    PaError result = PaUtil_ValidateStreamPointer( stream );
-
-    PA_LOGAPI_ENTER_PARAMS( "Pa_CloseStream" );
-    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PaStream *stream;
+    int abort;
+    PaStreamStopCallback *callback;
+    void *userData;
+}
+PaAsyncStopRequest;
 
-    /* always remove the open stream from our list, even if this function
-        eventually returns an error. Otherwise CloseOpenStreams() will
-        get stuck in an infinite loop */
-    RemoveOpenStream( stream ); /* be sure to call this _before_ closing the stream */
 
-    if( result == paNoError )
-    {
-        interface = PA_STREAM_INTERFACE(stream);
+static void AsyncStopThreadFunc( void *userData )
+{
+    PaAsyncStopRequest request = *(PaAsyncStopRequest*)userData;
+    PaError result;
 
-        /* abort the stream if it isn't stopped */
-        result = interface->IsStopped( stream );
-        if( result == 1 )
-            result = paNoError;
-        else if( result == 0 )
-            result = interface->Abort( stream );
+    PaUtil_FreeMemory( userData );
 
-        if( result == paNoError )                 /** @todo REVIEW: shouldn't we close anyway? see: http://www.portaudio.com/trac/ticket/115 */
-            result = interface->Close( stream );
-    }
+    if( request.abort )
+        result = PA_STREAM_INTERFACE(request.stream)->Abort( request.stream );
+    else
+        result = PA_STREAM_INTERFACE(request.stream)->Stop( request.stream );
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_CloseStream", result );
+    /* clear the flag before calling back, so that the callback may close the stream */
+    PaUtil_WriteMemoryBarrier();
+    PA_STREAM_REP(request.stream)->isStoppingAsync = 0;
 
-    return result;
+    if( request.callback )
+        request.callback( request.stream, result, request.userData );
 }
 
 
-PaError Pa_SetStreamFinishedCallback( PaStream *stream, PaStreamFinishedCallback* streamFinishedCallback )
+PaError Pa_StopStreamAsync( PaStream *stream, int abort,
+                            PaStreamStopCallback *callback, void *userData )
 {
     PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaAsyncStopRequest *request;
 
-    PA_LOGAPI_ENTER_PARAMS( "Pa_SetStreamFinishedCallback" );
+    PA_LOGAPI_ENTER_PARAMS( "Pa_StopStreamAsync" );
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
-    PA_LOGAPI(("\tPaStreamFinishedCallback* streamFinishedCallback: 0x%p\n", streamFinishedCallback ));
+    PA_LOGAPI(("\tint abort: %d\n", abort ));
+    PA_LOGAPI(("\tPaStreamStopCallback* callback: 0x%p\n", callback ));
+    PA_LOGAPI(("\tvoid* userData: 0x%p\n", userData ));
 
-    if( result == paNoError )
+    if( result == paNoError && PA_STREAM_REP(stream)->isPaused )
+    {
+        /* there is nothing to play out, stop right away */
+        result = Pa_AbortStream( stream );
+        if( result == paNoError && callback )
+            callback( stream, result, userData );
+    }
+    else if( result == paNoError )
     {
-        result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
+        if( PA_STREAM_REP(stream)->isStoppingAsync )
+            result = paStreamIsStopped;
+        else
+            result = PA_STREAM_IS_STOPPED( stream );
+
         if( result == 0 )
         {
-            result = paStreamIsNotStopped ;
+            request = (PaAsyncStopRequest*)PaUtil_AllocateMemory( sizeof(PaAsyncStopRequest) );
+            if( !request )
+            {
+                result = paInsufficientMemory;
+            }
+            else
+            {
+                request->stream = stream;
+                request->abort = abort;
+                request->callback = callback;
+                request->userData = userData;
+
+                PA_STREAM_REP(stream)->isStoppingAsync = 1;
+                PaUtil_WriteMemoryBarrier();
+
+                result = PaUtil_StartDetachedThread( AsyncStopThreadFunc, request );
+                if( result != paNoError )
+                {
+                    PA_STREAM_REP(stream)->isStoppingAsync = 0;
+                    PaUtil_FreeMemory( request );
+                }
+            }
         }
-        if( result == 1 )
+        else if( result == 1 )
         {
-            PA_STREAM_REP( stream )->streamFinishedCallback = streamFinishedCallback;
-            result = paNoError;
+            result = paStreamIsStopped;
         }
     }
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_SetStreamFinishedCallback", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_StopStreamAsync", result );
 
     return result;
-
 }
 
 
-PaError Pa_StartStream( PaStream *stream )
+PaError Pa_PauseStream( PaStream *stream )
 {
     PaError result = PaUtil_ValidateStreamPointer( stream );
 
-    PA_LOGAPI_ENTER_PARAMS( "Pa_StartStream" );
+    PA_LOGAPI_ENTER_PARAMS( "Pa_PauseStream" );
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
-    if( result == paNoError )
+    if( result == paNoError && !PA_STREAM_REP(stream)->isPaused )
     {
-        result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
+        if( PA_STREAM_REP(stream)->isStoppingAsync )
+            result = paStreamIsStopped;
+        else
+            result = PA_STREAM_IS_STOPPED( stream );
+
         if( result == 0 )
         {
-            result = paStreamIsNotStopped ;
+            if( PA_STREAM_INTERFACE(stream)->Pause )
+                result = PA_STREAM_INTERFACE(stream)->Pause( stream );
+            else
+                result = PA_STREAM_INTERFACE(stream)->Abort( stream );
+
+            if( result == paNoError )
+                PA_STREAM_REP(stream)->isPaused = 1;
         }
         else if( result == 1 )
         {
-            result = PA_STREAM_INTERFACE(stream)->Start( stream );
+            result = paStreamIsStopped;
         }
     }
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_StartStream", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_PauseStream", result );
 
     return result;
 }
 
 
-PaError Pa_StopStream( PaStream *stream )
+PaError Pa_ResumeStream( PaStream *stream )
 {
     PaError result = PaUtil_ValidateStreamPointer( stream );
 
-    PA_LOGAPI_ENTER_PARAMS( "Pa_StopStream" );
+    PA_LOGAPI_ENTER_PARAMS( "Pa_ResumeStream" );
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
     if( result == paNoError )
     {
-        result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
-        if( result == 0 )
+        if( !PA_STREAM_REP(stream)->isPaused )
         {
-            result = PA_STREAM_INTERFACE(stream)->Stop( stream );
+            result = PA_STREAM_IS_STOPPED( stream );
+            if( result == 0 )
+                result = paStreamIsNotStopped;
+            else if( result == 1 )
+                result = paStreamIsStopped;
         }
-        else if( result == 1 )
+        else
         {
-            result = paStreamIsStopped;
+            if( PA_STREAM_INTERFACE(stream)->Resume )
+                result = PA_STREAM_INTERFACE(stream)->Resume( stream );
+            else
+                result = PA_STREAM_INTERFACE(stream)->Start( stream );
+
+            if( result == paNoError )
+                PA_STREAM_REP(stream)->isPaused = 0;
         }
     }
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_StopStream", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_ResumeStream", result );
 
     return result;
 }
 
 
-PaError Pa_AbortStream( PaStream *stream )
+PaError Pa_ProcessStream( PaStream *stream, double timeoutSeconds )
 {
     PaError result = PaUtil_ValidateStreamPointer( stream );
 
-    PA_LOGAPI_ENTER_PARAMS( "Pa_AbortStream" );
+    PA_LOGAPI_ENTER_PARAMS( "Pa_ProcessStream" );
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tdouble timeoutSeconds: %g\n", timeoutSeconds ));
 
     if( result == paNoError )
     {
-        result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
-        if( result == 0 )
-        {
-            result = PA_STREAM_INTERFACE(stream)->Abort( stream );
-        }
-        else if( result == 1 )
-        {
+        if( !PA_STREAM_REP(stream)->processesManually )
+            result = paInvalidFlag;
+        else if( PA_STREAM_REP(stream)->isStoppingAsync )
             result = paStreamIsStopped;
-        }
+        else
+            result = PA_STREAM_INTERFACE(stream)->Process( stream, timeoutSeconds > 0. ? timeoutSeconds : 0. );
     }
 
-    PA_LOGAPI_EXIT_PAERROR( "Pa_AbortStream", result );
+    PA_LOGAPI_EXIT_PAERROR( "Pa_ProcessStream", result );
 
     return result;
 }
@@ -1514,7 +3385,7 @@ PaError Pa_IsStreamStopped( PaStream *stream )
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
     if( result == paNoError )
-        result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
+        result = IsStreamStopped( stream );
 
     PA_LOGAPI_EXIT_PAERROR( "Pa_IsStreamStopped", result );
 
@@ -1530,8 +3401,15 @@ PaError Pa_IsStreamActive( PaStream *stream )
     PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
 
     if( result == paNoError )
-        result = PA_STREAM_INTERFACE(stream)->IsActive( stream );
-
+    {
+        /* host APIs read their state flags without locking, order the
+           caller's following reads of data written by the stream after it */
+        if( PA_STREAM_REP(stream)->isPaused )
+            result = 0;
+        else
+            result = PA_STREAM_INTERFACE(stream)->IsActive( stream );
+        PaUtil_ReadMemoryBarrier();
+    }
 
     PA_LOGAPI_EXIT_PAERROR( "Pa_IsStreamActive", result );
 
@@ -1593,7 +3471,10 @@ PaTime Pa_GetStreamTime( PaStream *stream )
     }
     else
     {
-        result = PA_STREAM_INTERFACE(stream)->GetTime( stream );
+        /* interpolate while the stream is running, query the host otherwise */
+        if( !PA_STREAM_REP(stream)->clock
+                || !PaUtil_GetStreamClockTime( PA_STREAM_REP(stream)->clock, &result ) )
+            result = PA_STREAM_GET_TIME( stream );
 
         PA_LOGAPI(("Pa_GetStreamTime returned:\n" ));
         PA_LOGAPI(("\tPaTime: %g\n", result ));
@@ -1604,6 +3485,30 @@ PaTime Pa_GetStreamTime( PaStream *stream )
 }
 
 
+PaError Pa_GetStreamFramePosition( PaStream* stream, double* framePosition )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamFramePosition" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tdouble* framePosition: 0x%p\n", framePosition ));
+
+    if( result == paNoError )
+    {
+        /* the clock counts seconds of frames at the host's nominal rate */
+        if( PA_STREAM_REP(stream)->clock )
+            *framePosition = PaUtil_GetStreamClockPosition( PA_STREAM_REP(stream)->clock )
+                    * PA_STREAM_REP(stream)->streamInfo.sampleRate;
+        else
+            *framePosition = 0.;
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetStreamFramePosition", result );
+
+    return result;
+}
+
+
 double Pa_GetStreamCpuLoad( PaStream* stream )
 {
     PaError error = PaUtil_ValidateStreamPointer( stream );
@@ -1634,6 +3539,61 @@ double Pa_GetStreamCpuLoad( PaStream* stream )
 }
 
 
+PaError Pa_GetStreamStatistics( PaStream* stream, PaStreamStatistics* statistics )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamStatistics" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tPaStreamStatistics* statistics: 0x%p\n", statistics ));
+
+    if( result == paNoError )
+    {
+        if( PA_STREAM_REP(stream)->statistics )
+        {
+            PaUtil_GetStreamStatistics( PA_STREAM_REP(stream)->statistics, statistics );
+        }
+        else
+        {
+            memset( statistics, 0, sizeof(PaStreamStatistics) );
+            statistics->structVersion = 3;
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_GetStreamStatistics", result );
+
+    return result;
+}
+
+
+signed long Pa_GetStreamMemoryUsage( PaStream* stream )
+{
+    PaError error = PaUtil_ValidateStreamPointer( stream );
+    signed long result;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_GetStreamMemoryUsage" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+
+    if( error != paNoError )
+    {
+        result = error;
+    }
+    else if( PA_STREAM_REP(stream)->GetMemoryUsage )
+    {
+        result = PA_STREAM_REP(stream)->GetMemoryUsage( stream );
+    }
+    else
+    {
+        result = 0;
+    }
+
+    PA_LOGAPI(("Pa_GetStreamMemoryUsage returned:\n" ));
+    PA_LOGAPI(("\tsigned long: %ld\n", result ));
+
+    return result;
+}
+
+
 PaError Pa_ReadStream( PaStream* stream,
                        void *buffer,
                        unsigned long frames )
@@ -1656,10 +3616,10 @@ PaError Pa_ReadStream( PaStream* stream,
         }
         else
         {
-            result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
+            result = PA_STREAM_IS_STOPPED( stream );
             if( result == 0 )
             {
-                result = PA_STREAM_INTERFACE(stream)->Read( stream, buffer, frames );
+                result = PA_STREAM_READ( stream, buffer, frames );
             }
             else if( result == 1 )
             {
@@ -1696,10 +3656,10 @@ PaError Pa_WriteStream( PaStream* stream,
         }
         else
         {
-            result = PA_STREAM_INTERFACE(stream)->IsStopped( stream );
+            result = PA_STREAM_IS_STOPPED( stream );
             if( result == 0 )
             {
-                result = PA_STREAM_INTERFACE(stream)->Write( stream, buffer, frames );
+                result = PA_STREAM_WRITE( stream, buffer, frames );
             }
             else if( result == 1 )
             {
@@ -1713,6 +3673,292 @@ PaError Pa_WriteStream( PaStream* stream,
     return result;
 }
 
+PaError Pa_ReadStreamV( PaStream* stream,
+                        void * const *buffers,
+                        const unsigned long *frames,
+                        unsigned long bufferCount )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaError bufferResult;
+    unsigned long i;
+    int hasEmptyBuffers = 0;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_ReadStreamV" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tunsigned long bufferCount: %lu\n", bufferCount ));
+
+    if( result == paNoError && bufferCount != 0 )
+    {
+        if( buffers == 0 || frames == 0 )
+        {
+            result = paBadBufferPtr;
+        }
+        else
+        {
+            for( i = 0; i < bufferCount && result == paNoError; ++i )
+            {
+                if( frames[i] == 0 )
+                    hasEmptyBuffers = 1;
+                else if( buffers[i] == 0 )
+                    result = paBadBufferPtr;
+            }
+        }
+
+        if( result == paNoError )
+        {
+            result = PA_STREAM_IS_STOPPED( stream );
+            if( result == 0 )
+            {
+                if( PA_STREAM_INTERFACE(stream)->ReadV && !hasEmptyBuffers )
+                {
+                    result = PA_STREAM_INTERFACE(stream)->ReadV( stream, buffers, frames, bufferCount );
+                }
+                else
+                {
+                    /* report an overflow of any buffer, stop at the first other error */
+                    for( i = 0; i < bufferCount; ++i )
+                    {
+                        if( frames[i] == 0 )
+                            continue;
+
+                        bufferResult = PA_STREAM_READ( stream, buffers[i], frames[i] );
+                        if( bufferResult == paInputOverflowed )
+                        {
+                            result = bufferResult;
+                        }
+                        else if( bufferResult != paNoError )
+                        {
+                            result = bufferResult;
+                            break;
+                        }
+                    }
+                }
+            }
+            else if( result == 1 )
+            {
+                result = paStreamIsStopped;
+            }
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_ReadStreamV", result );
+
+    return result;
+}
+
+
+PaError Pa_WriteStreamV( PaStream* stream,
+                         const void * const *buffers,
+                         const unsigned long *frames,
+                         unsigned long bufferCount )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    PaError bufferResult;
+    unsigned long i;
+    int hasEmptyBuffers = 0;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_WriteStreamV" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tunsigned long bufferCount: %lu\n", bufferCount ));
+
+    if( result == paNoError && bufferCount != 0 )
+    {
+        if( buffers == 0 || frames == 0 )
+        {
+            result = paBadBufferPtr;
+        }
+        else
+        {
+            for( i = 0; i < bufferCount && result == paNoError; ++i )
+            {
+                if( frames[i] == 0 )
+                    hasEmptyBuffers = 1;
+                else if( buffers[i] == 0 )
+                    result = paBadBufferPtr;
+            }
+        }
+
+        if( result == paNoError )
+        {
+            result = PA_STREAM_IS_STOPPED( stream );
+            if( result == 0 )
+            {
+                if( PA_STREAM_INTERFACE(stream)->WriteV && !hasEmptyBuffers )
+                {
+                    result = PA_STREAM_INTERFACE(stream)->WriteV( stream, buffers, frames, bufferCount );
+                }
+                else
+                {
+                    /* report an underflow of any buffer, stop at the first other error */
+                    for( i = 0; i < bufferCount; ++i )
+                    {
+                        if( frames[i] == 0 )
+                            continue;
+
+                        bufferResult = PA_STREAM_WRITE( stream, buffers[i], frames[i] );
+                        if( bufferResult == paOutputUnderflowed )
+                        {
+                            result = bufferResult;
+                        }
+                        else if( bufferResult != paNoError )
+                        {
+                            result = bufferResult;
+                            break;
+                        }
+                    }
+                }
+            }
+            else if( result == 1 )
+            {
+                result = paStreamIsStopped;
+            }
+        }
+    }
+
+    PA_LOGAPI_EXIT_PAERROR( "Pa_WriteStreamV", result );
+
+    return result;
+}
+
+
+/* Wait for frames to be available to Read or Write, for host APIs without ReadTimeout and WriteTimeout. */
+static PaError WaitForAvailableFrames( PaStream* stream, signed long (*GetAvailable)( PaStream* ),
+        unsigned long frames, double timeoutSeconds )
+{
+    PaTime deadline = PaUtil_GetTime() + timeoutSeconds;
+    signed long available;
+
+    for( ;; )
+    {
+        available = GetAvailable( stream );
+        if( available < 0 )
+            return (PaError)available;
+        else if( (unsigned long)available >= frames )
+            return paNoError;
+        else if( PaUtil_GetTime() >= deadline )
+            return paTimedOut;
+
+        Pa_Sleep( 1 );
+    }
+}
+
+
+PaError Pa_ReadStreamTimeout( PaStream* stream,
+                              void *buffer,
+                              unsigned long frames,
+                              unsigned long *framesRead,
+                              double timeoutSeconds )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    unsigned long framesDone = 0;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_ReadStreamTimeout" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tdouble timeoutSeconds: %g\n", timeoutSeconds ));
+
+    if( result == paNoError && frames != 0 )
+    {
+        if( buffer == 0 )
+        {
+            result = paBadBufferPtr;
+        }
+        else
+        {
+            result = PA_STREAM_IS_STOPPED( stream );
+            if( result == 0 )
+            {
+                if( timeoutSeconds >= 0. && PA_STREAM_INTERFACE(stream)->ReadTimeout )
+                {
+                    result = PA_STREAM_INTERFACE(stream)->ReadTimeout( stream, buffer, frames, &framesDone, timeoutSeconds );
+                }
+                else
+                {
+                    if( timeoutSeconds >= 0. )
+                        result = WaitForAvailableFrames( stream, PA_STREAM_INTERFACE(stream)->GetReadAvailable, frames, timeoutSeconds );
+
+                    if( result == paNoError )
+                    {
+                        result = PA_STREAM_READ( stream, buffer, frames );
+                        if( result == paNoError || result == paInputOverflowed )
+                            framesDone = frames;
+                    }
+                }
+            }
+            else if( result == 1 )
+            {
+                result = paStreamIsStopped;
+            }
+        }
+    }
+
+    if( framesRead )
+        *framesRead = framesDone;
+
+    PA_LOGAPI(("\tunsigned long framesRead: %lu\n", framesDone ));
+    PA_LOGAPI_EXIT_PAERROR( "Pa_ReadStreamTimeout", result );
+
+    return result;
+}
+
+
+PaError Pa_WriteStreamTimeout( PaStream* stream,
+                               const void *buffer,
+                               unsigned long frames,
+                               unsigned long *framesWritten,
+                               double timeoutSeconds )
+{
+    PaError result = PaUtil_ValidateStreamPointer( stream );
+    unsigned long framesDone = 0;
+
+    PA_LOGAPI_ENTER_PARAMS( "Pa_WriteStreamTimeout" );
+    PA_LOGAPI(("\tPaStream* stream: 0x%p\n", stream ));
+    PA_LOGAPI(("\tdouble timeoutSeconds: %g\n", timeoutSeconds ));
+
+    if( result == paNoError && frames != 0 )
+    {
+        if( buffer == 0 )
+        {
+            result = paBadBufferPtr;
+        }
+        else
+        {
+            result = PA_STREAM_IS_STOPPED( stream );
+            if( result == 0 )
+            {
+                if( timeoutSeconds >= 0. && PA_STREAM_INTERFACE(stream)->WriteTimeout )
+                {
+                    result = PA_STREAM_INTERFACE(stream)->WriteTimeout( stream, buffer, frames, &framesDone, timeoutSeconds );
+                }
+                else
+                {
+                    if( timeoutSeconds >= 0. )
+                        result = WaitForAvailableFrames( stream, PA_STREAM_INTERFACE(stream)->GetWriteAvailable, frames, timeoutSeconds );
+
+                    if( result == paNoError )
+                    {
+                        result = PA_STREAM_WRITE( stream, buffer, frames );
+                        if( result == paNoError || result == paOutputUnderflowed )
+                            framesDone = frames;
+                    }
+                }
+            }
+            else if( result == 1 )
+            {
+                result = paStreamIsStopped;
+            }
+        }
+    }
+
+    if( framesWritten )
+        *framesWritten = framesDone;
+
+    PA_LOGAPI(("\tunsigned long framesWritten: %lu\n", framesDone ));
+    PA_LOGAPI_EXIT_PAERROR( "Pa_WriteStreamTimeout", result );
+
+    return result;
+}
+
+
 signed long Pa_GetStreamReadAvailable( PaStream* stream )
 {
     PaError error = PaUtil_ValidateStreamPointer( stream );
@@ -1731,7 +3977,7 @@ signed long Pa_GetStreamReadAvailable( PaStream* stream )
     }
     else
     {
-        result = PA_STREAM_INTERFACE(stream)->GetReadAvailable( stream );
+        result = PA_STREAM_GET_READ_AVAILABLE( stream );
 
         PA_LOGAPI(("Pa_GetStreamReadAvailable returned:\n" ));
         PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
@@ -1760,7 +4006,7 @@ signed long Pa_GetStreamWriteAvailable( PaStream* stream )
     }
     else
     {
-        result = PA_STREAM_INTERFACE(stream)->GetWriteAvailable( stream );
+        result = PA_STREAM_GET_WRITE_AVAILABLE( stream );
 
         PA_LOGAPI(("Pa_GetStreamWriteAvailable returned:\n" ));
         PA_LOGAPI(("\tPaError: %d ( %s )\n", result, Pa_GetErrorText( result ) ));
@@ -1796,9 +4042,14 @@ PaError Pa_GetSampleSize( PaSampleFormat format )
 
     case paFloat32:
     case paInt32:
+    case paInt24In32:
         result = 4;
         break;
 
+    case paFloat64:
+        result = 8;
+        break;
+
     default:
         result = paSampleFormatNotSupported;
         break;
@@ -0,0 +1,171 @@
+/*
+ * Portable Audio I/O Library headroom notification
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+
+/** @file
+ @ingroup common_src
+
+ @brief Headroom notification implementation.
+*/
+
+
+#include <stddef.h> /* NULL */
+
+#include "pa_headroom.h"
+#include "pa_memorybarrier.h"
+#include "pa_util.h"
+
+
+/* the thread checks for a stop request at least this often */
+#define PA_HEADROOM_POLL_SECONDS_   (1.)
+
+
+struct PaUtilHeadroomNotifier
+{
+    PaStream *stream;
+    PaTime threshold;
+    PaStreamHeadroomCallback *callback;
+    void *userData;
+
+    PaUtilSemaphore *ready;             /**< posted for each notification and for the stop request */
+    PaUtilSemaphore *done;              /**< posted by the thread as it ends */
+    volatile int stopRequested;
+
+    int belowThreshold;                 /**< of the callback thread only */
+    volatile int pending;               /**< set by the callback thread, cleared once delivered */
+    volatile PaTime headroom;           /**< of the pending notification */
+};
+
+
+static void HeadroomNotifierThread( void *userData )
+{
+    PaUtilHeadroomNotifier *notifier = (PaUtilHeadroomNotifier*)userData;
+
+    while( !notifier->stopRequested )
+    {
+        PaUtil_WaitSemaphore( notifier->ready, PA_HEADROOM_POLL_SECONDS_ );
+
+        if( notifier->pending && !notifier->stopRequested )
+        {
+            PaUtil_ReadMemoryBarrier();
+            notifier->callback( notifier->stream, notifier->headroom, notifier->userData );
+
+            PaUtil_FullMemoryBarrier();
+            notifier->pending = 0;
+        }
+    }
+
+    PaUtil_PostSemaphore( notifier->done );
+}
+
+
+PaError PaUtil_CreateHeadroomNotifier( PaUtilHeadroomNotifier **notifier, PaStream *stream,
+        PaTime threshold, PaStreamHeadroomCallback *callback, void *userData )
+{
+    PaError result;
+    PaUtilHeadroomNotifier *n;
+
+    n = (PaUtilHeadroomNotifier*)PaUtil_AllocateMemory( sizeof(PaUtilHeadroomNotifier) );
+    if( !n )
+        return paInsufficientMemory;
+
+    n->stream = stream;
+    n->threshold = threshold;
+    n->callback = callback;
+    n->userData = userData;
+    n->ready = NULL;
+    n->done = NULL;
+    n->stopRequested = 0;
+    n->belowThreshold = 0;
+    n->pending = 0;
+    n->headroom = 0.;
+
+    result = PaUtil_CreateSemaphore( &n->ready );
+    if( result != paNoError )
+        goto error;
+    result = PaUtil_CreateSemaphore( &n->done );
+    if( result != paNoError )
+        goto error;
+
+    result = PaUtil_StartDetachedThread( HeadroomNotifierThread, n );
+    if( result != paNoError )
+        goto error;
+
+    *notifier = n;
+    return paNoError;
+
+error:
+    if( n->done )
+        PaUtil_DestroySemaphore( n->done );
+    if( n->ready )
+        PaUtil_DestroySemaphore( n->ready );
+    PaUtil_FreeMemory( n );
+    return result;
+}
+
+
+void PaUtil_DestroyHeadroomNotifier( PaUtilHeadroomNotifier *notifier )
+{
+    notifier->stopRequested = 1;
+    PaUtil_WriteMemoryBarrier();
+    PaUtil_PostSemaphore( notifier->ready );
+
+    /* the thread may be calling the application */
+    while( PaUtil_WaitSemaphore( notifier->done, PA_HEADROOM_POLL_SECONDS_ ) != paNoError )
+        ;
+
+    PaUtil_DestroySemaphore( notifier->done );
+    PaUtil_DestroySemaphore( notifier->ready );
+    PaUtil_FreeMemory( notifier );
+}
+
+
+void PaUtil_CheckHeadroom( PaUtilHeadroomNotifier *notifier, PaTime headroom )
+{
+    if( headroom >= notifier->threshold )
+    {
+        notifier->belowThreshold = 0;
+        return;
+    }
+
+    /* once per fall below the threshold, and not while the last one is being delivered */
+    if( notifier->belowThreshold || notifier->pending )
+        return;
+    notifier->belowThreshold = 1;
+
+    notifier->headroom = headroom;
+    PaUtil_WriteMemoryBarrier();
+    notifier->pending = 1;
+    PaUtil_PostSemaphore( notifier->ready );
+}
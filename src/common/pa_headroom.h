@@ -0,0 +1,91 @@
+#ifndef PA_HEADROOM_H
+#define PA_HEADROOM_H
+/*
+ * Portable Audio I/O Library headroom notification
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+
+/** @file
+ @ingroup common_src
+
+ @brief Notifies the application when a stream's output headroom falls
+ below a threshold, implementing Pa_SetStreamHeadroomCallback().
+
+ The callback thread checks the headroom of each host buffer as it records
+ it in the statistics, and when the headroom drops below the threshold posts
+ a semaphore to a thread of normal priority which calls the application. It
+ does so once each time the headroom falls below the threshold, and only
+ when the previous notification has been delivered, so a slow application
+ never holds up the callback thread.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+typedef struct PaUtilHeadroomNotifier PaUtilHeadroomNotifier;
+
+
+/** Create a notifier and start its thread.
+
+ @param stream Passed to callback.
+
+ @param threshold The headroom in seconds below which callback is called.
+*/
+PaError PaUtil_CreateHeadroomNotifier( PaUtilHeadroomNotifier **notifier, PaStream *stream,
+        PaTime threshold, PaStreamHeadroomCallback *callback, void *userData );
+
+
+/** Stop the thread of a notifier, waiting for a notification being
+ delivered, and free it. Must not be called while the callback thread may
+ call PaUtil_CheckHeadroom().
+*/
+void PaUtil_DestroyHeadroomNotifier( PaUtilHeadroomNotifier *notifier );
+
+
+/** Check the headroom of a host buffer, called from the callback thread.
+ Doesn't block.
+*/
+void PaUtil_CheckHeadroom( PaUtilHeadroomNotifier *notifier, PaTime headroom );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_HEADROOM_H */
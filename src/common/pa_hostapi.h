@@ -168,6 +168,19 @@ typedef struct PaUtilPrivatePaFrontHostApiInfo {
 
 
     unsigned long baseDeviceIndex;
+
+    /* serializes the calls which open, close or query devices of the host
+       API, so that different host APIs can be used on several threads */
+    struct PaUtilSemaphore *lock;
+
+    /* whether the host API's device change notification is enabled, the
+       number of notifications it made (and of times it was enabled, as
+       changes may have been missed while it was off), and the count when
+       its devices were last enumerated; devices retained across
+       Pa_Terminate() are only enumerated again if the counts differ */
+    int notifying;
+    volatile unsigned long deviceChangeCount;
+    unsigned long enumeratedDeviceChangeCount;
 }PaUtilPrivatePaFrontHostApiInfo;
 
 
@@ -322,6 +335,66 @@ typedef struct PaUtilHostApiRepresentation {
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
                                   double sampleRate );
+
+
+    /**
+        The following functions refresh the device list for
+        Pa_RefreshDeviceList(). Host APIs which can't refresh it set all three
+        to NULL and keep their devices.
+
+        (*ScanDeviceInfos)() enumerates the devices again into a new list,
+        returned in *scanResults, without touching deviceInfos and info, as
+        streams keep running and the result may be discarded. The device
+        indices of the new list, including its default devices, are 0 based
+        within the host API, as for the initializer.
+
+        (*CommitDeviceInfos)() replaces deviceInfos, info.deviceCount,
+        info.defaultInputDevice and info.defaultOutputDevice with a list
+        returned by (*ScanDeviceInfos)() and frees the previous list. It must
+        not fail. Open streams must not depend on the previous list.
+
+        (*DisposeDeviceInfos)() frees a list returned by (*ScanDeviceInfos)()
+        which is not committed.
+    */
+    PaError (*ScanDeviceInfos)( struct PaUtilHostApiRepresentation *hostApi,
+                                PaHostApiIndex index,
+                                void **scanResults,
+                                int *deviceCount );
+
+    PaError (*CommitDeviceInfos)( struct PaUtilHostApiRepresentation *hostApi,
+                                  PaHostApiIndex index,
+                                  void *scanResults,
+                                  int deviceCount );
+
+    PaError (*DisposeDeviceInfos)( struct PaUtilHostApiRepresentation *hostApi,
+                                   void *scanResults,
+                                   int deviceCount );
+
+    /**
+        (*EnableDeviceChangeNotification)() starts calling
+        PaUtil_NotifyDeviceChange() whenever devices of the host API are
+        connected or removed, or its default devices change, if enable is
+        nonzero, and stops if it is zero. Notifications may come from any
+        thread, none are made once it returned after stopping them. Stopping
+        notifications which weren't started does nothing. NULL if the host
+        API can't detect changes of its devices.
+    */
+    PaError (*EnableDeviceChangeNotification)( struct PaUtilHostApiRepresentation *hostApi,
+                                               int enable );
+
+    /**
+        (*GetDeviceCapabilities)() returns in *capabilities the formats,
+        channel counts and sample rates supported by the host API specific
+        device index device, without opening a stream. The capabilities are
+        owned by the host API and must stay valid until the device list is
+        refreshed or Terminate() is called. Returns paNoError with
+        *capabilities set to NULL if they can't be determined now, for
+        example because the device is busy. NULL if the host API doesn't
+        provide capabilities.
+    */
+    PaError (*GetDeviceCapabilities)( struct PaUtilHostApiRepresentation *hostApi,
+                                      int device,
+                                      const PaDeviceCapabilities **capabilities );
 } PaUtilHostApiRepresentation;
 
 
@@ -356,6 +429,15 @@ typedef PaError PaUtilHostApiInitializer( PaUtilHostApiRepresentation**, PaHostA
 extern PaUtilHostApiInitializer *paHostApiInitializers[];
 
 
+/** paHostApiInitializerTypes holds the type of the host API each entry of
+ paHostApiInitializers initializes, at the same index, so that pa_front.c can
+ skip host APIs the client didn't select without initializing them.
+
+ @see Pa_InitializeWithHostApis
+*/
+extern const PaHostApiTypeId paHostApiInitializerTypes[];
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
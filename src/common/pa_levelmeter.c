@@ -0,0 +1,357 @@
+/*
+ * Portable Audio I/O Library level meter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Level meter implementation.
+*/
+
+
+#include <math.h> /* sqrt() */
+#include <string.h> /* memcpy(), memset() */
+
+#include "pa_levelmeter.h"
+#include "pa_endianness.h"
+#include "pa_memorybarrier.h"
+#include "pa_types.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PA_LEVELMETER_SSE2_
+#include <emmintrin.h>
+#endif
+
+
+#define PA_MAX_( a, b )  ( (a) > (b) ? (a) : (b) )
+
+/* a reader only retries while a single period is being published */
+#define PA_LEVEL_METER_READ_ATTEMPTS_   (1000)
+
+
+/* the sums of a channel over the current period */
+typedef struct PaUtilChannelLevelSum
+{
+    double sumOfSquares;
+    float peak;
+    unsigned long clippedSamples;
+} PaUtilChannelLevelSum;
+
+
+typedef void PaUtilLevelMeterFunction( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum );
+
+
+struct PaUtilLevelMeter
+{
+    volatile unsigned long sequence[2]; /**< odd while the levels of a direction are published,
+                                             the directions may be metered by different threads */
+    double periodFrames;
+    int channelCount[2];
+    PaUtilLevelMeterFunction *meterFunction[2]; /**< NULL for formats which aren't metered */
+    unsigned long framesInPeriod[2];
+    PaUtilChannelLevelSum *sums[2];
+    PaStreamChannelLevel *levels[2];    /**< published */
+};
+
+
+#ifdef PA_LEVELMETER_SSE2_
+static const unsigned char bitCount_[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+#endif
+
+
+static void MeterFloat32( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum )
+{
+    const float *s = (const float*)samples;
+    float peak = sum->peak, squares = 0.f;
+    unsigned long clipped = 0;
+
+#ifdef PA_LEVELMETER_SSE2_
+    if( stride == 1 && count >= 4 )
+    {
+        const __m128 absMask = _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) );
+        const __m128 one = _mm_set1_ps( 1.f );
+        __m128 peaks = _mm_set1_ps( peak ), sums = _mm_setzero_ps();
+        float lanes[4];
+
+        do
+        {
+            __m128 x = _mm_loadu_ps( s );
+            __m128 a = _mm_and_ps( x, absMask );
+
+            peaks = _mm_max_ps( peaks, a );
+            sums = _mm_add_ps( sums, _mm_mul_ps( x, x ) );
+            clipped += bitCount_[ _mm_movemask_ps( _mm_cmpge_ps( a, one ) ) ];
+            s += 4;
+            count -= 4;
+        }
+        while( count >= 4 );
+
+        _mm_storeu_ps( lanes, peaks );
+        peak = PA_MAX_( PA_MAX_( lanes[0], lanes[1] ), PA_MAX_( lanes[2], lanes[3] ) );
+        _mm_storeu_ps( lanes, sums );
+        squares = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+#endif
+
+    while( count-- )
+    {
+        float x = *s;
+        float a = x < 0.f ? -x : x;
+
+        if( a > peak )
+            peak = a;
+        squares += x * x;
+        if( a >= 1.f )
+            ++clipped;
+        s += stride;
+    }
+
+    sum->peak = peak;
+    sum->sumOfSquares += squares;
+    sum->clippedSamples += clipped;
+}
+
+
+/* meter integers of full scale FULL_SCALE, read by READ into the PaInt32 x
+   in steps of STEP elements of type */
+#define PA_METER_INTEGERS_( type, STEP, FULL_SCALE, READ )\
+    const type *s = (const type*)samples;\
+    PaInt32 peak = 0, x;\
+    double squares = 0.;\
+    unsigned long clipped = 0;\
+    \
+    while( count-- )\
+    {\
+        READ;\
+        if( x >= (FULL_SCALE) - 1 || x <= -(FULL_SCALE) )\
+            ++clipped;\
+        if( x < 0 )\
+            x = ( x == -(FULL_SCALE) ) ? (FULL_SCALE) - 1 : -x;\
+        if( x > peak )\
+            peak = x;\
+        squares += (double)x * x;\
+        s += (STEP);\
+    }\
+    \
+    if( peak * (1. / (FULL_SCALE)) > sum->peak )\
+        sum->peak = (float)(peak * (1. / (FULL_SCALE)));\
+    sum->sumOfSquares += squares * (1. / (FULL_SCALE)) * (1. / (FULL_SCALE));\
+    sum->clippedSamples += clipped;
+
+
+static void MeterInt32( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum )
+{
+    /* the low byte doesn't matter to a meter */
+    PA_METER_INTEGERS_( PaInt32, stride, 0x800000, x = *s >> 8 )
+}
+
+
+static void MeterInt24( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum )
+{
+#if defined(PA_LITTLE_ENDIAN)
+    PA_METER_INTEGERS_( unsigned char, stride * 3, 0x800000,
+            x = (PaInt32)(((PaUint32)s[0] << 8) | ((PaUint32)s[1] << 16) | ((PaUint32)s[2] << 24)) >> 8 )
+#elif defined(PA_BIG_ENDIAN)
+    PA_METER_INTEGERS_( unsigned char, stride * 3, 0x800000,
+            x = (PaInt32)(((PaUint32)s[0] << 24) | ((PaUint32)s[1] << 16) | ((PaUint32)s[2] << 8)) >> 8 )
+#endif
+}
+
+
+static void MeterInt16( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum )
+{
+    PA_METER_INTEGERS_( PaInt16, stride, 0x8000, x = *s )
+}
+
+
+static void MeterInt8( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum )
+{
+    PA_METER_INTEGERS_( signed char, stride, 0x80, x = *s )
+}
+
+
+static void MeterUInt8( const void *samples, signed int stride,
+        unsigned long count, PaUtilChannelLevelSum *sum )
+{
+    PA_METER_INTEGERS_( unsigned char, stride, 0x80, x = (PaInt32)*s - 0x80 )
+}
+
+
+static PaUtilLevelMeterFunction* SelectMeterFunction( PaSampleFormat format )
+{
+    switch( format & ~paNonInterleaved )
+    {
+    case paFloat32:
+        return MeterFloat32;
+    case paInt32:
+        return MeterInt32;
+    case paInt24:
+        return MeterInt24;
+    case paInt16:
+        return MeterInt16;
+    case paInt8:
+        return MeterInt8;
+    case paUInt8:
+        return MeterUInt8;
+    default:
+        return 0;
+    }
+}
+
+
+long PaUtil_GetLevelMeterSize( int inputChannelCount, int outputChannelCount )
+{
+    return (long)(sizeof(PaUtilLevelMeter) + (inputChannelCount + outputChannelCount)
+            * (sizeof(PaUtilChannelLevelSum) + sizeof(PaStreamChannelLevel)));
+}
+
+
+PaUtilLevelMeter* PaUtil_InitializeLevelMeter( void *memory,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        double sampleRate )
+{
+    PaUtilLevelMeter *meter = (PaUtilLevelMeter*)memory;
+    PaUtilChannelLevelSum *sums = (PaUtilChannelLevelSum*)(meter + 1);
+    PaStreamChannelLevel *levels = (PaStreamChannelLevel*)(sums + inputChannelCount + outputChannelCount);
+
+    meter->periodFrames = PA_UTIL_LEVEL_METER_PERIOD * sampleRate;
+
+    meter->channelCount[paStreamTapInput] = inputChannelCount;
+    meter->meterFunction[paStreamTapInput] = SelectMeterFunction( userInputSampleFormat );
+    meter->sums[paStreamTapInput] = sums;
+    meter->levels[paStreamTapInput] = levels;
+
+    meter->channelCount[paStreamTapOutput] = outputChannelCount;
+    meter->meterFunction[paStreamTapOutput] = SelectMeterFunction( userOutputSampleFormat );
+    meter->sums[paStreamTapOutput] = sums + inputChannelCount;
+    meter->levels[paStreamTapOutput] = levels + inputChannelCount;
+
+    meter->sequence[0] = meter->sequence[1] = 0;
+    PaUtil_ResetLevelMeter( meter );
+    return meter;
+}
+
+
+void PaUtil_ResetLevelMeter( PaUtilLevelMeter* meter )
+{
+    int i;
+
+    for( i=0; i < 2; ++i )
+    {
+        unsigned long sequence = meter->sequence[i];
+
+        meter->sequence[i] = sequence + 1;
+        PaUtil_WriteMemoryBarrier();
+
+        memset( meter->sums[i], 0, sizeof(PaUtilChannelLevelSum) * meter->channelCount[i] );
+        memset( meter->levels[i], 0, sizeof(PaStreamChannelLevel) * meter->channelCount[i] );
+        meter->framesInPeriod[i] = 0;
+
+        PaUtil_WriteMemoryBarrier();
+        meter->sequence[i] = sequence + 2;
+    }
+}
+
+
+void PaUtil_MeterChannel( PaUtilLevelMeter* meter, PaStreamTapSource source, unsigned int channel,
+        const void *samples, signed int stride, unsigned long frameCount )
+{
+    if( meter->meterFunction[source] )
+        meter->meterFunction[source]( samples, stride, frameCount, &meter->sums[source][channel] );
+}
+
+
+void PaUtil_AdvanceLevelMeter( PaUtilLevelMeter* meter, PaStreamTapSource source,
+        unsigned long frameCount )
+{
+    PaUtilChannelLevelSum *sums = meter->sums[source];
+    PaStreamChannelLevel *levels = meter->levels[source];
+    double squaresPerFrame;
+    int i;
+
+    meter->framesInPeriod[source] += frameCount;
+    if( meter->framesInPeriod[source] < meter->periodFrames || meter->framesInPeriod[source] == 0 )
+        return;
+
+    squaresPerFrame = 1. / meter->framesInPeriod[source];
+
+    meter->sequence[source]++;
+    PaUtil_WriteMemoryBarrier();
+
+    for( i=0; i < meter->channelCount[source]; ++i )
+    {
+        levels[i].peak = sums[i].peak;
+        levels[i].rms = (float)sqrt( sums[i].sumOfSquares * squaresPerFrame );
+        levels[i].clippedSamples += sums[i].clippedSamples;
+    }
+
+    PaUtil_WriteMemoryBarrier();
+    meter->sequence[source]++;
+
+    memset( sums, 0, sizeof(PaUtilChannelLevelSum) * meter->channelCount[source] );
+    meter->framesInPeriod[source] = 0;
+}
+
+
+PaError PaUtil_GetLevels( const PaUtilLevelMeter* meter, PaStreamTapSource source,
+        PaStreamChannelLevel *levels, int channelCount )
+{
+    int attempt;
+
+    if( (source != paStreamTapInput && source != paStreamTapOutput)
+            || channelCount < 1 || channelCount > meter->channelCount[source] )
+        return paInvalidChannelCount;
+
+    for( attempt = 0; attempt < PA_LEVEL_METER_READ_ATTEMPTS_; ++attempt )
+    {
+        unsigned long sequence = meter->sequence[source];
+
+        PaUtil_ReadMemoryBarrier();
+        memcpy( levels, meter->levels[source], sizeof(PaStreamChannelLevel) * channelCount );
+        PaUtil_ReadMemoryBarrier();
+
+        if( !(sequence & 1) && meter->sequence[source] == sequence )
+            break;
+    }
+
+    /* after that many attempts the copy is used as it is, it can only be
+       off by a period */
+    return paNoError;
+}
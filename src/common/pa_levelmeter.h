@@ -0,0 +1,123 @@
+#ifndef PA_LEVELMETER_H
+#define PA_LEVELMETER_H
+/*
+ * Portable Audio I/O Library level meter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Peak and RMS levels of the channels of a stream, measured by the
+ buffer processor for Pa_GetStreamLevels() with paMeterLevels.
+
+ The buffer processor meters each block of a channel right after it
+ converted it to the user's sample format, or before it converts the block
+ from it. The samples are still in the cache then, so the metering doesn't
+ cost another pass over memory. The sums of a metering period are published
+ under a sequence count like the statistics, so readers never block the
+ callback thread.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The levels are published for periods of at least this many seconds, or
+ of a host buffer if that is longer.
+*/
+#define PA_UTIL_LEVEL_METER_PERIOD      (0.02)
+
+
+typedef struct PaUtilLevelMeter PaUtilLevelMeter;
+
+
+/** The bytes of memory a level meter of the channels takes. */
+long PaUtil_GetLevelMeterSize( int inputChannelCount, int outputChannelCount );
+
+
+/** Initialize a level meter in memory of PaUtil_GetLevelMeterSize() bytes,
+ aligned for a double.
+
+ @return The meter, which is freed with the memory.
+*/
+PaUtilLevelMeter* PaUtil_InitializeLevelMeter( void *memory,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        double sampleRate );
+
+
+/** Clear the levels and clip counts when a stream is started. Must not be
+ called while the callback thread meters.
+*/
+void PaUtil_ResetLevelMeter( PaUtilLevelMeter* meter );
+
+
+/** Add frameCount samples of a channel of a user buffer to the sums of the
+ period. Called from the callback thread or a conversion worker, only one
+ thread may meter a channel at a time.
+
+ @param stride The distance of the samples in samples.
+*/
+void PaUtil_MeterChannel( PaUtilLevelMeter* meter, PaStreamTapSource source, unsigned int channel,
+        const void *samples, signed int stride, unsigned long frameCount );
+
+
+/** End the metering of frameCount frames of all channels of source, once
+ all their channels have been metered, and publish the levels at the end of
+ a period. Frames which have not been metered count as silence. Called from
+ the callback thread.
+*/
+void PaUtil_AdvanceLevelMeter( PaUtilLevelMeter* meter, PaStreamTapSource source,
+        unsigned long frameCount );
+
+
+/** Copy the published levels of the first channelCount channels of
+ source, may be called from any thread.
+
+ @return paNoError, or paInvalidChannelCount if the meter doesn't have as
+ many channels of source.
+*/
+PaError PaUtil_GetLevels( const PaUtilLevelMeter* meter, PaStreamTapSource source,
+        PaStreamChannelLevel *levels, int channelCount );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_LEVELMETER_H */
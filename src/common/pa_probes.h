@@ -0,0 +1,123 @@
+#ifndef PA_PROBES_H
+#define PA_PROBES_H
+/*
+ * Portable Audio I/O Library static tracepoints
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Static tracepoints on the real-time path, for profiling release
+ builds on live systems.
+
+ With PA_USE_USDT the probes are SystemTap SDT probes of the provider
+ "portaudio", a nop instruction each until a tracer such as bpftrace, perf
+ or SystemTap attaches to them, for example:
+
+ @code
+ bpftrace -e 'usdt:/usr/lib/libportaudio.so:portaudio:callback_entry { @t[tid] = nsecs; }
+     usdt:/usr/lib/libportaudio.so:portaudio:callback_return /@t[tid]/ { @us = hist((nsecs - @t[tid]) / 1000); }'
+ @endcode
+
+ With PA_USE_TRACELOGGING, on Windows, they are TraceLogging events of the
+ ETW provider "PortAudio" (GUID {4bbd2f23-511c-58bf-8a82-5a03d9cf829b}),
+ which cost a test of whether the provider is enabled. Otherwise the probes
+ expand to nothing.
+
+ The probes and their arguments, all integers:
+
+ - buffer_begin(statusFlags): PaUtil_BeginBufferProcessing()
+ - buffer_end(framesProcessed, callbackResult): the end of
+   PaUtil_EndBufferProcessing()
+ - callback_entry(frameCount, statusFlags), callback_return(frameCount,
+   callbackResult): around each call of the stream callback, by the buffer
+   processor or by a host API calling it directly
+ - xrun(statusFlags): a host buffer reporting an under or overflow
+ - xrun_recovery(result): a host API having restarted its device after an
+   xrun, result is the PaError of the restart
+ - host_wait(arg), host_wait_return(frames, status): around the host API's
+   wait for the device, the arguments are host API specific as for
+   paUtilTraceHostWait
+*/
+
+
+#if defined(PA_USE_USDT)
+
+#include <sys/sdt.h>
+
+#define PA_PROBE1( name, arg0 )         DTRACE_PROBE1( portaudio, name, (long)(arg0) )
+#define PA_PROBE2( name, arg0, arg1 )   DTRACE_PROBE2( portaudio, name, (long)(arg0), (long)(arg1) )
+
+#define PaUtil_InitializeProbes()       /* noop */
+#define PaUtil_TerminateProbes()        /* noop */
+
+#elif defined(PA_USE_TRACELOGGING)
+
+#include <windows.h>
+#include <TraceLoggingProvider.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+TRACELOGGING_DECLARE_PROVIDER( paUtilTraceLoggingProvider );
+
+/** Register the ETW provider, called by Pa_Initialize(). */
+void PaUtil_InitializeProbes( void );
+
+/** Unregister the ETW provider, called by Pa_Terminate(). */
+void PaUtil_TerminateProbes( void );
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#define PA_PROBE1( name, arg0 ) \
+    TraceLoggingWrite( paUtilTraceLoggingProvider, #name, TraceLoggingInt64( (__int64)(arg0), "arg0" ) )
+#define PA_PROBE2( name, arg0, arg1 ) \
+    TraceLoggingWrite( paUtilTraceLoggingProvider, #name, TraceLoggingInt64( (__int64)(arg0), "arg0" ), \
+            TraceLoggingInt64( (__int64)(arg1), "arg1" ) )
+
+#else
+
+#define PA_PROBE1( name, arg0 )         /* noop */
+#define PA_PROBE2( name, arg0, arg1 )   /* noop */
+
+#define PaUtil_InitializeProbes()       /* noop */
+#define PaUtil_TerminateProbes()        /* noop */
+
+#endif
+
+
+#endif /* PA_PROBES_H */
@@ -45,16 +45,151 @@
 
 
 #include <assert.h>
+#include <math.h> /* ceil() */
 #include <string.h> /* memset() */
 
 #include "pa_process.h"
+#include "pa_resampler.h"
+#include "pa_channelmatrix.h"
 #include "pa_util.h"
+#include "pa_memorybarrier.h"
+#include "pa_trace.h"
+#include "pa_probes.h"
+#include "pa_cpufeatures.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PA_PROCESS_SSE2_
+#include <emmintrin.h>
+#endif
 
 
 #define PA_FRAMES_PER_TEMP_BUFFER_WHEN_HOST_BUFFER_SIZE_IS_UNKNOWN_    1024
 
+/* host frames resampled per call of the user side buffer processor when
+   converting the sample rate */
+#define PA_FRAMES_PER_RESAMPLING_CHUNK_     256
+
+/* the largest relative correction of the input resampler's ratio when
+   compensating clock drift, and the constants of the loop which controls it */
+#define PA_DRIFT_MAX_CORRECTION_            (0.005)
+#define PA_DRIFT_ERROR_TIME_CONSTANT_       (1.)    /* seconds */
+#define PA_DRIFT_PROPORTIONAL_GAIN_         (0.2)   /* per second */
+#define PA_DRIFT_INTEGRAL_GAIN_             (0.01)  /* per second squared */
+
+/* frames mixed per call of the user side buffer processor when applying a
+   channel matrix */
+#define PA_FRAMES_PER_MIXING_CHUNK_         256
+
 #define PA_MIN_( a, b ) ( ((a)<(b)) ? (a) : (b) )
 
+/* host buffers remembered per silent output channel, enough for double
+   buffers converted in a few user buffers each */
+#define PA_ZEROED_HOST_BUFFERS_             8
+
+
+/* The zeroing of a silent output channel. While the channel stays silent the
+   host buffers listed here hold nothing but zeros, when the host output
+   persists (hostOutputPersists) they aren't zeroed again.
+*/
+typedef struct PaUtilZeroedHostOutput
+{
+    int silent;                         /* the channel's flag for the buffer being converted */
+    unsigned int bufferCount;
+    void *buffers[PA_ZEROED_HOST_BUFFERS_];
+    unsigned long frameCounts[PA_ZEROED_HOST_BUFFERS_];
+} PaUtilZeroedHostOutput;
+
+
+/* frames of paFloat32 output multiplied by their gain at once, on the stack of
+   the converting thread */
+#define PA_GAIN_BLOCK_FRAMES_               256
+
+/* A gain of outputGain as the thread converting the output ramps it. Over the
+   buffer being converted, frame f of the channel is multiplied by
+   blockGain + f * blockStep, the product of the channel's and the stream's
+   ramps at the ends of the buffer interpolated linearly.
+*/
+typedef struct PaUtilGainRamp
+{
+    unsigned long sequence;             /* of the setting taken last */
+    float gain;                         /* at the start of the next buffer */
+    float target;
+    float step;                         /* per frame */
+    unsigned long framesLeft;
+    float blockGain;
+    float blockStep;
+    int unity;                          /* the buffer is converted as it is */
+} PaUtilGainRamp;
+
+
+/* State of a buffer processor initialized with
+   PaUtil_InitializeResamplingBufferProcessor(). The buffer processor which
+   owns it converts between the host buffers and paFloat32 at the host rate
+   and calls SampleRateConverterCallback(). That resamples and drives
+   userBufferProcessor with interleaved paFloat32 "host" buffers at the user
+   rate, which in turn calls the stream callback.
+
+   PaUtil_InitializeDriftCompensatingBufferProcessor() sets independentClocks.
+   The buffer processor which owns the converter then only holds the host
+   buffer descriptors, PaUtil_EndBufferProcessing() passes the input to
+   inputHostProcessor, which calls DriftCompensatorInputCallback(), and the
+   output to outputHostProcessor, which calls SampleRateConverterCallback().
+*/
+typedef struct PaUtilSampleRateConverter
+{
+    PaUtilBufferProcessor userBufferProcessor;
+    PaUtilResampler inputResampler;     /* host to user rate */
+    PaUtilResampler outputResampler;    /* user to host rate */
+
+    double userSampleRate;
+    double hostSampleRate;              /* of the output when the clocks are independent */
+
+    float *inputBuffer;                 /* resampled input not passed to userBufferProcessor yet */
+    unsigned long inputBufferFrames;
+    unsigned long framesInInputBuffer;
+    unsigned long initialFramesInInputBuffer; /* silence ahead of the input of a full duplex
+                                                 stream, so that the input never runs short of
+                                                 what the output resampler asks for */
+
+    float *outputBuffer;                /* output of userBufferProcessor, to be resampled */
+    unsigned long outputBufferFrames;
+
+    int independentClocks;
+    PaUtilBufferProcessor inputHostProcessor;
+    PaUtilBufferProcessor outputHostProcessor;
+    double hostInputSampleRate;
+    unsigned long inputPeriodFrames;    /* user frames per nominal host input buffer */
+    PaTime nextInputAdcTime;            /* of the frame following the last host input */
+    int inputTimeKnown;
+    PaStreamCallbackFlags inputStatusFlags; /* not passed to the stream callback yet */
+    double filteredDriftError;          /* seconds of input buffered beyond the target */
+    double driftIntegral;
+} PaUtilSampleRateConverter;
+
+
+/* State of a buffer processor initialized with
+   PaUtil_InitializeChannelMatrixBufferProcessor(). The buffer processor
+   which owns it converts between the host buffers and non-interleaved
+   paFloat32 with the device's channel count and calls ChannelMixerCallback().
+   That mixes each chunk between the device and the stream channels and
+   drives userBufferProcessor with the stream's channels, which in turn calls
+   the stream callback.
+*/
+typedef struct PaUtilChannelMixer
+{
+    PaUtilBufferProcessor userBufferProcessor;
+    PaUtilChannelMatrix inputMatrix;    /* device to stream channels */
+    PaUtilChannelMatrix outputMatrix;   /* stream to device channels */
+
+    double sampleRate;
+
+    float *buffers;                     /* a chunk per stream channel, input channels first */
+    float **inputChannels;              /* the chunks of the stream channels */
+    float **outputChannels;
+    const float **hostInputChannels;    /* the host buffers at the current chunk */
+    float **hostOutputChannels;
+} PaUtilChannelMixer;
+
 
 /* greatest common divisor - PGCD in French */
 static unsigned long GCD( unsigned long a, unsigned long b )
@@ -62,26 +197,156 @@ static unsigned long GCD( unsigned long a, unsigned long b )
     return (b==0) ? a : GCD( b, a%b);
 }
 
-/* least common multiple - PPCM in French */
-static unsigned long LCM( unsigned long a, unsigned long b )
+#define PA_MAX_( a, b ) (((a) > (b)) ? (a) : (b))
+
+/*
+    The largest of the frame counts a full duplex stream is left with at the
+    end of a host buffer of M frames, adapted to user buffers of N frames.
+    The ends of the host buffers fall on all multiples of GCD(M,N) within a
+    user buffer, so this is N - GCD(M,N).
+*/
+static unsigned long CalculateFrameShift( unsigned long M, unsigned long N )
 {
-    return (a*b) / GCD(a,b);
+    assert( M > 0 );
+    assert( N > 0 );
+
+    return N - GCD( M, N );
 }
 
-#define PA_MAX_( a, b ) (((a) > (b)) ? (a) : (b))
 
-static unsigned long CalculateFrameShift( unsigned long M, unsigned long N )
+/* the longest cycle of host buffers for which PaUtil_InitializeBufferProcessor()
+   precomputes an adapting schedule, longer cycles are adapted by the general
+   loop of AdaptingProcess() */
+#define PA_MAX_ADAPTING_SCHEDULE_LENGTH_    (1024)
+
+/*
+    What AdaptingProcess() does with a full duplex host buffer of exactly
+    framesPerHostBuffer frames, for each framesInTempInputBuffer at its start.
+    The schedule of a stream has an entry for every multiple of
+    GCD(framesPerHostBuffer, framesPerUserBuffer) below framesPerUserBuffer,
+    the values framesInTempInputBuffer cycles through.
+
+    An entry is valid if the state it describes is reached from the initial
+    state, and the stream callback then finds the temporary output buffer
+    empty each of the callbackCount times it is called in that host buffer.
+*/
+typedef struct PaUtilAdaptingScheduleEntry
+{
+    unsigned long framesInTempOutputBuffer; /* at the start of the host buffer */
+    unsigned long callbackCount;
+    int valid;
+} PaUtilAdaptingScheduleEntry;
+
+
+/*
+    Fill in the schedule by following the frame counts AdaptingProcess()
+    maintains through a cycle of host buffers, starting with the initial
+    contents of the temporary buffers.
+*/
+static void CalculateAdaptingSchedule( PaUtilAdaptingScheduleEntry *schedule,
+        unsigned long scheduleLength, unsigned long granularity,
+        unsigned long framesPerHostBuffer, unsigned long framesPerUserBuffer,
+        unsigned long framesInTempInputBuffer, unsigned long framesInTempOutputBuffer )
 {
-    unsigned long result = 0;
+    PaUtilAdaptingScheduleEntry *entry;
+    unsigned long inputFrames, outputFrames, frameCount;
     unsigned long i;
-    unsigned long lcm;
 
-    assert( M > 0 );
-    assert( N > 0 );
+    for( i = 0; i < scheduleLength; ++i )
+        schedule[i].valid = 0;
+
+    for( i = 0; i < scheduleLength; ++i )
+    {
+        entry = &schedule[ framesInTempInputBuffer / granularity ];
+        entry->framesInTempOutputBuffer = framesInTempOutputBuffer;
+        entry->callbackCount = 0;
+
+        inputFrames = framesPerHostBuffer;
+        outputFrames = framesPerHostBuffer;
+
+        frameCount = PA_MIN_( framesInTempOutputBuffer, outputFrames );
+        framesInTempOutputBuffer -= frameCount;
+        outputFrames -= frameCount;
+
+        while( inputFrames > 0 )
+        {
+            frameCount = PA_MIN_( framesPerUserBuffer - framesInTempInputBuffer, inputFrames );
+            framesInTempInputBuffer += frameCount;
+            inputFrames -= frameCount;
+
+            if( framesInTempInputBuffer == framesPerUserBuffer )
+            {
+                if( framesInTempOutputBuffer != 0 )
+                    return; /* the callback would have to wait for output space */
+
+                ++entry->callbackCount;
+                framesInTempInputBuffer = 0;
+                framesInTempOutputBuffer = framesPerUserBuffer;
+            }
+
+            frameCount = PA_MIN_( framesInTempOutputBuffer, outputFrames );
+            framesInTempOutputBuffer -= frameCount;
+            outputFrames -= frameCount;
+        }
+
+        entry->valid = 1;
+    }
+}
+
+
+/*
+    The number of bytes PaUtil_InitializeBufferProcessor() allocates through
+    bp->allocations, so that all of it fits into the arena. Each block may
+    be moved forward by up to PA_CACHE_LINE_SIZE bytes for alignment. Only
+    the blocks the stream's formats and flags call for are counted, the
+    arena takes whole pages of locked memory.
+*/
+static long CalculateArenaSize( unsigned long framesPerTempBuffer,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        PaStreamFlags streamFlags, unsigned long adaptingScheduleLength )
+{
+    long result = 0;
+    PaError bytesPerSample;
+
+    if( adaptingScheduleLength > 0 )
+        result += sizeof(PaUtilAdaptingScheduleEntry) * adaptingScheduleLength
+                + PA_CACHE_LINE_SIZE;
 
-    lcm = LCM( M, N );
-    for( i = M; i < lcm; i += M )
-        result = PA_MAX_( result, i % N );
+    if( inputChannelCount > 0 )
+    {
+        bytesPerSample = Pa_GetSampleSize( userInputSampleFormat );
+        if( bytesPerSample > 0 )
+            result += framesPerTempBuffer * bytesPerSample * inputChannelCount;
+
+        result += sizeof(PaUtilChannelDescriptor) * inputChannelCount * 2
+                + 2 * PA_CACHE_LINE_SIZE;
+
+        if( userInputSampleFormat & paNonInterleaved )
+            result += sizeof(void*) * inputChannelCount + PA_CACHE_LINE_SIZE;
+    }
+
+    if( outputChannelCount > 0 )
+    {
+        bytesPerSample = Pa_GetSampleSize( userOutputSampleFormat );
+        if( bytesPerSample > 0 )
+            result += framesPerTempBuffer * bytesPerSample * outputChannelCount;
+
+        result += sizeof(PaUtilChannelDescriptor) * outputChannelCount * 2
+                + 2 * PA_CACHE_LINE_SIZE;
+
+        if( userOutputSampleFormat & paNonInterleaved )
+            result += sizeof(void*) * outputChannelCount + PA_CACHE_LINE_SIZE;
+
+        if( (streamFlags & paDitherNoiseShaped) && !(streamFlags & paDitherOff) )
+            result += sizeof(PaUtilNoiseShapedDitherGenerator) * outputChannelCount + PA_CACHE_LINE_SIZE;
+
+        result += (sizeof(unsigned char) + sizeof(PaUtilZeroedHostOutput)) * outputChannelCount
+                + 2 * PA_CACHE_LINE_SIZE;
+    }
+
+    if( streamFlags & paMeterLevels )
+        result += PaUtil_GetLevelMeterSize( inputChannelCount, outputChannelCount ) + PA_CACHE_LINE_SIZE;
 
     return result;
 }
@@ -103,6 +368,8 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
     PaError bytesPerSample;
     unsigned long tempInputBufferSize, tempOutputBufferSize;
     PaStreamFlags tempInputStreamFlags;
+    int softClipOutput = 0;
+    unsigned long adaptingScheduleLength = 0;
 
     if( streamFlags & paNeverDropInput )
     {
@@ -112,11 +379,46 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
             return paInvalidFlag;
     }
 
+    bp->inputBatchingLatencyFrames = 0;
+    if( (streamFlags & paBatchCallbacks) && streamCallback && outputChannelCount == 0
+            && hostBufferSizeMode == paUtilFixedHostBufferSize
+            && framesPerHostBuffer != 0 && framesPerUserBuffer > framesPerHostBuffer
+            && framesPerUserBuffer % framesPerHostBuffer == 0 )
+    {
+        /* the host API batched the callbacks with PaUtil_GetBatchedFramesPerUserBuffer().
+           A full duplex stream is delayed by the frame shift below, input only streams
+           wait for the rest of the batch */
+        bp->inputBatchingLatencyFrames = framesPerUserBuffer - framesPerHostBuffer;
+    }
+
     /* initialize buffer ptrs to zero so they can be freed if necessary in error */
     bp->tempInputBuffer = 0;
     bp->tempInputBufferPtrs = 0;
     bp->tempOutputBuffer = 0;
     bp->tempOutputBufferPtrs = 0;
+    bp->noiseShapedDitherGenerators = 0;
+    bp->allocations = 0;
+    bp->levelMeter = 0;
+    bp->silentOutputChannels.channelCount = 0;
+    bp->silentOutputChannels.silent = 0;
+    bp->silentOutputChannels.used = 0;
+    bp->zeroedHostOutput = 0;
+    bp->outputGain.channelCount = 0;
+    bp->outputGain.settings = 0;
+    bp->outputGain.used = 0;
+    bp->gainRamps = 0;
+    bp->gainOutputConverter = 0;
+    bp->hostOutputPersists = 0;
+    bp->adaptingSchedule = 0;
+    bp->sampleRateConverter = 0;
+    bp->channelMixer = 0;
+    bp->workerPool = 0;
+    bp->workerDitherGenerators = 0;
+    bp->paused = 0;
+    bp->skipSilentOutput = 0;
+    bp->silentOutputByte = 0;
+    bp->startTime = 0.;
+    bp->requestedStartTime = 0.;
 
     bp->framesPerUserBuffer = framesPerUserBuffer;
     bp->framesPerHostBuffer = framesPerHostBuffer;
@@ -178,6 +480,10 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
                         bp->initialFramesInTempInputBuffer = 0;
                         bp->initialFramesInTempOutputBuffer = frameShift;
                     }
+
+                    bp->adaptingScheduleGranularity = GCD( framesPerHostBuffer, framesPerUserBuffer );
+                    if( framesPerUserBuffer / bp->adaptingScheduleGranularity <= PA_MAX_ADAPTING_SCHEDULE_LENGTH_ )
+                        adaptingScheduleLength = framesPerUserBuffer / bp->adaptingScheduleGranularity;
                 }
                 else /* variable host buffer size, add framesPerUserBuffer latency */
                 {
@@ -198,6 +504,34 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
     bp->framesInTempInputBuffer = bp->initialFramesInTempInputBuffer;
     bp->framesInTempOutputBuffer = bp->initialFramesInTempOutputBuffer;
 
+    /* everything the callback thread touches is allocated here, at stream
+       opening, from memory which won't page fault later */
+    bp->allocations = PaUtil_CreateArenaAllocationGroup(
+            CalculateArenaSize( bp->framesPerTempBuffer,
+                    inputChannelCount, userInputSampleFormat,
+                    outputChannelCount, userOutputSampleFormat,
+                    streamFlags, adaptingScheduleLength ) );
+    if( bp->allocations == 0 )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    if( adaptingScheduleLength > 0 )
+    {
+        bp->adaptingSchedule = (PaUtilAdaptingScheduleEntry*)PaUtil_GroupAllocateAlignedMemory(
+                bp->allocations, sizeof(PaUtilAdaptingScheduleEntry) * adaptingScheduleLength,
+                PA_CACHE_LINE_SIZE );
+        if( bp->adaptingSchedule == 0 )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+
+        CalculateAdaptingSchedule( bp->adaptingSchedule, adaptingScheduleLength,
+                bp->adaptingScheduleGranularity, framesPerHostBuffer, framesPerUserBuffer,
+                bp->initialFramesInTempInputBuffer, bp->initialFramesInTempOutputBuffer );
+    }
     
     if( inputChannelCount > 0 )
     {
@@ -224,32 +558,37 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         }
 
         /* Under the assumption that no ADC in existence delivers better than 24bits resolution,
-            we disable dithering when host input format is paInt32 and user format is paInt24, 
-            since the host samples will just be padded with zeros anyway. */
+            we disable dithering when host input format is paInt32 and user format is paInt24
+            or paInt24In32, since the host samples will just be padded with zeros anyway. */
 
-        tempInputStreamFlags = streamFlags;
+        /* paSoftClip is only for output */
+        tempInputStreamFlags = streamFlags & ~paSoftClip;
         if( !(tempInputStreamFlags & paDitherOff) /* dither is on */
                 && (hostInputSampleFormat & paInt32) /* host input format is int32 */
-                && (userInputSampleFormat & paInt24) /* user requested format is int24 */ ){
+                && (userInputSampleFormat & (paInt24 | paInt24In32)) /* user requested format is int24 */ ){
 
             tempInputStreamFlags = tempInputStreamFlags | paDitherOff;
         }
 
-        bp->inputConverter =
-            PaUtil_SelectConverter( hostInputSampleFormat, userInputSampleFormat, tempInputStreamFlags );
-
         bp->inputZeroer = PaUtil_SelectZeroer( userInputSampleFormat );
             
         bp->userInputIsInterleaved = (userInputSampleFormat & paNonInterleaved)?0:1;
 		
         bp->hostInputIsInterleaved = (hostInputSampleFormat & paNonInterleaved)?0:1;
 
+        /* the strides the converter will usually be called with */
+        bp->inputConverter =
+            PaUtil_SelectConverterForStrides( hostInputSampleFormat, userInputSampleFormat, tempInputStreamFlags,
+                    bp->hostInputIsInterleaved ? inputChannelCount : 1,
+                    bp->userInputIsInterleaved ? inputChannelCount : 1 );
+
         bp->userInputSampleFormatIsEqualToHost = ((userInputSampleFormat & ~paNonInterleaved) == (hostInputSampleFormat & ~paNonInterleaved));
 
         tempInputBufferSize =
             bp->framesPerTempBuffer * bp->bytesPerUserInputSample * inputChannelCount;
          
-        bp->tempInputBuffer = PaUtil_AllocateMemory( tempInputBufferSize );
+        bp->tempInputBuffer = PaUtil_GroupAllocateAlignedMemory( bp->allocations,
+                tempInputBufferSize, PA_CACHE_LINE_SIZE );
         if( bp->tempInputBuffer == 0 )
         {
             result = paInsufficientMemory;
@@ -262,7 +601,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         if( userInputSampleFormat & paNonInterleaved )
         {
             bp->tempInputBufferPtrs =
-                (void **)PaUtil_AllocateMemory( sizeof(void*)*inputChannelCount );
+                (void **)PaUtil_GroupAllocateMemory( bp->allocations, sizeof(void*)*inputChannelCount );
             if( bp->tempInputBufferPtrs == 0 )
             {
                 result = paInsufficientMemory;
@@ -271,7 +610,8 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         }
 
         bp->hostInputChannels[0] = (PaUtilChannelDescriptor*)
-                PaUtil_AllocateMemory( sizeof(PaUtilChannelDescriptor) * inputChannelCount * 2);
+                PaUtil_GroupAllocateMemory( bp->allocations,
+                        sizeof(PaUtilChannelDescriptor) * inputChannelCount * 2);
         if( bp->hostInputChannels[0] == 0 )
         {
             result = paInsufficientMemory;
@@ -305,21 +645,57 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
             goto error;
         }
 
+        bp->userOutputIsInterleaved = (userOutputSampleFormat & paNonInterleaved)?0:1;
+
+        bp->hostOutputIsInterleaved = (hostOutputSampleFormat & paNonInterleaved)?0:1;
+
         bp->outputConverter =
-            PaUtil_SelectConverter( userOutputSampleFormat, hostOutputSampleFormat, streamFlags );
+            PaUtil_SelectConverterForStrides( userOutputSampleFormat, hostOutputSampleFormat, streamFlags,
+                    bp->userOutputIsInterleaved ? outputChannelCount : 1,
+                    bp->hostOutputIsInterleaved ? outputChannelCount : 1 );
 
-        bp->outputZeroer = PaUtil_SelectZeroer( hostOutputSampleFormat );
+        softClipOutput = ((userOutputSampleFormat & ~paNonInterleaved) == paFloat32)
+                && (streamFlags & (paSoftClip | paClipOff)) == paSoftClip;
 
-        bp->userOutputIsInterleaved = (userOutputSampleFormat & paNonInterleaved)?0:1;
+        if( (streamFlags & paDitherNoiseShaped) && !(streamFlags & paDitherOff) && !softClipOutput )
+        {
+            PaUtilConverter *noiseShapedConverter =
+                PaUtil_SelectNoiseShapedDitherConverter( userOutputSampleFormat, hostOutputSampleFormat );
+            if( noiseShapedConverter )
+            {
+                unsigned int i;
 
-        bp->hostOutputIsInterleaved = (hostOutputSampleFormat & paNonInterleaved)?0:1;
+                bp->noiseShapedDitherGenerators = (PaUtilNoiseShapedDitherGenerator*)
+                        PaUtil_GroupAllocateMemory( bp->allocations,
+                                sizeof(PaUtilNoiseShapedDitherGenerator) * outputChannelCount );
+                if( bp->noiseShapedDitherGenerators == 0 )
+                {
+                    result = paInsufficientMemory;
+                    goto error;
+                }
+
+                for( i=0; i<(unsigned int)outputChannelCount; ++i )
+                    PaUtil_InitializeNoiseShapedDitherState( &bp->noiseShapedDitherGenerators[i], i );
+
+                bp->outputConverter = noiseShapedConverter;
+            }
+            /* otherwise the default dither is used */
+        }
+
+        bp->outputZeroer = PaUtil_SelectZeroer( hostOutputSampleFormat );
+
+        bp->skipSilentOutput = (streamFlags & paSkipSilentOutput) ? 1 : 0;
+        bp->silentOutputByte = ((userOutputSampleFormat & ~paNonInterleaved) == paUInt8) ? 0x80 : 0;
 
-        bp->userOutputSampleFormatIsEqualToHost = ((userOutputSampleFormat & ~paNonInterleaved) == (hostOutputSampleFormat & ~paNonInterleaved));
+        /* soft clipped paFloat32 output is converted to a paFloat32 host buffer too */
+        bp->userOutputSampleFormatIsEqualToHost = ((userOutputSampleFormat & ~paNonInterleaved) == (hostOutputSampleFormat & ~paNonInterleaved))
+                && !softClipOutput;
 
         tempOutputBufferSize =
                 bp->framesPerTempBuffer * bp->bytesPerUserOutputSample * outputChannelCount;
 
-        bp->tempOutputBuffer = PaUtil_AllocateMemory( tempOutputBufferSize );
+        bp->tempOutputBuffer = PaUtil_GroupAllocateAlignedMemory( bp->allocations,
+                tempOutputBufferSize, PA_CACHE_LINE_SIZE );
         if( bp->tempOutputBuffer == 0 )
         {
             result = paInsufficientMemory;
@@ -332,7 +708,7 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         if( userOutputSampleFormat & paNonInterleaved )
         {
             bp->tempOutputBufferPtrs =
-                (void **)PaUtil_AllocateMemory( sizeof(void*)*outputChannelCount );
+                (void **)PaUtil_GroupAllocateMemory( bp->allocations, sizeof(void*)*outputChannelCount );
             if( bp->tempOutputBufferPtrs == 0 )
             {
                 result = paInsufficientMemory;
@@ -341,7 +717,8 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         }
 
         bp->hostOutputChannels[0] = (PaUtilChannelDescriptor*)
-                PaUtil_AllocateMemory( sizeof(PaUtilChannelDescriptor)*outputChannelCount * 2 );
+                PaUtil_GroupAllocateMemory( bp->allocations,
+                        sizeof(PaUtilChannelDescriptor)*outputChannelCount * 2 );
         if( bp->hostOutputChannels[0] == 0 )
         {                                                                     
             result = paInsufficientMemory;
@@ -349,346 +726,2621 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bp,
         }
 
         bp->hostOutputChannels[1] = &bp->hostOutputChannels[0][outputChannelCount];
+
+        bp->silentOutputChannels.silent = (volatile unsigned char*)
+                PaUtil_GroupAllocateMemory( bp->allocations, sizeof(unsigned char)*outputChannelCount );
+        bp->zeroedHostOutput = (PaUtilZeroedHostOutput*)
+                PaUtil_GroupAllocateMemory( bp->allocations, sizeof(PaUtilZeroedHostOutput)*outputChannelCount );
+        if( bp->silentOutputChannels.silent == 0 || bp->zeroedHostOutput == 0 )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+
+        memset( (void*)bp->silentOutputChannels.silent, 0, sizeof(unsigned char)*outputChannelCount );
+        memset( bp->zeroedHostOutput, 0, sizeof(PaUtilZeroedHostOutput)*outputChannelCount );
+        bp->silentOutputChannels.channelCount = outputChannelCount;
+
+        if( (userOutputSampleFormat & ~paNonInterleaved) == paFloat32 )
+        {
+            unsigned int i;
+
+            bp->outputGain.settings = (PaUtilGainSetting*)PaUtil_GroupAllocateMemory( bp->allocations,
+                    sizeof(PaUtilGainSetting) * (outputChannelCount + 1) );
+            bp->gainRamps = (PaUtilGainRamp*)PaUtil_GroupAllocateMemory( bp->allocations,
+                    sizeof(PaUtilGainRamp) * (outputChannelCount + 1) );
+            if( bp->outputGain.settings == 0 || bp->gainRamps == 0 )
+            {
+                result = paInsufficientMemory;
+                goto error;
+            }
+
+            memset( bp->gainRamps, 0, sizeof(PaUtilGainRamp) * (outputChannelCount + 1) );
+            for( i=0; i<=(unsigned int)outputChannelCount; ++i )
+            {
+                bp->outputGain.settings[i].sequence = 0;
+                bp->outputGain.settings[i].gain = 1.f;
+                bp->outputGain.settings[i].rampTime = 0.;
+                bp->gainRamps[i].gain = 1.f;
+                bp->gainRamps[i].target = 1.f;
+                bp->gainRamps[i].unity = 1;
+            }
+            bp->outputGain.channelCount = outputChannelCount;
+
+            /* the multiplied blocks are contiguous */
+            bp->gainOutputConverter = bp->noiseShapedDitherGenerators ? bp->outputConverter
+                    : PaUtil_SelectConverterForStrides( userOutputSampleFormat, hostOutputSampleFormat, streamFlags,
+                            1, bp->hostOutputIsInterleaved ? outputChannelCount : 1 );
+        }
     }
 
     PaUtil_InitializeTriangularDitherState( &bp->ditherGenerator );
 
+    if( streamFlags & paMeterLevels )
+    {
+        void *levelMeterMemory = PaUtil_GroupAllocateAlignedMemory( bp->allocations,
+                PaUtil_GetLevelMeterSize( inputChannelCount, outputChannelCount ), PA_CACHE_LINE_SIZE );
+        if( levelMeterMemory == 0 )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+        bp->levelMeter = PaUtil_InitializeLevelMeter( levelMeterMemory,
+                inputChannelCount, userInputSampleFormat,
+                outputChannelCount, userOutputSampleFormat, sampleRate );
+    }
+
+    /* when every direction is interleaved on both sides with the same format,
+       the host buffers are the user buffers */
+    bp->useIdentityProcess = bp->useNonAdaptingProcess
+            && ( inputChannelCount == 0 || ( bp->userInputSampleFormatIsEqualToHost
+                    && bp->userInputIsInterleaved && bp->hostInputIsInterleaved ) )
+            && ( outputChannelCount == 0 || ( bp->userOutputSampleFormatIsEqualToHost
+                    && bp->userOutputIsInterleaved && bp->hostOutputIsInterleaved ) );
+
     bp->samplePeriod = 1. / sampleRate;
 
+    PaUtil_InitializeStreamStatistics( &bp->statistics, sampleRate );
+    bp->recordsStatistics = 1;
+    PaUtil_InitializeStageCpuLoadMeasurer( &bp->cpuLoadMeasurer, sampleRate );
+    bp->stageMeasurer = &bp->cpuLoadMeasurer;
+    bp->callbackStage = paUtilCallbackCpuLoadStage;
+    PaUtil_InitializeTimeFilter( &bp->inputTimeFilter, sampleRate );
+    PaUtil_InitializeTimeFilter( &bp->outputTimeFilter, sampleRate );
+    PaUtil_InitializeStreamClock( &bp->clock );
+    PaUtil_InitializeStreamTaps( &bp->taps, inputChannelCount, userInputSampleFormat,
+            outputChannelCount, userOutputSampleFormat, sampleRate );
+    bp->streamTaps = &bp->taps;
+    bp->hostFramesProcessed = 0.;
+
     bp->streamCallback = streamCallback;
     bp->userData = userData;
+    bp->flushDenormals = streamCallback && (streamFlags & paFlushDenormals);
 
     return result;
 
 error:
-    if( bp->tempInputBuffer )
-        PaUtil_FreeMemory( bp->tempInputBuffer );
+    if( bp->allocations )
+    {
+        PaUtil_FreeAllAllocations( bp->allocations );
+        PaUtil_DestroyAllocationGroup( bp->allocations );
+        bp->allocations = 0;
+    }
+
+    return result;
+}
 
-    if( bp->tempInputBufferPtrs )
-        PaUtil_FreeMemory( bp->tempInputBufferPtrs );
 
-    if( bp->hostInputChannels[0] )
-        PaUtil_FreeMemory( bp->hostInputChannels[0] );
+static void ResetSampleRateConverter( PaUtilSampleRateConverter *src )
+{
+    PaUtil_ResetBufferProcessor( &src->userBufferProcessor );
 
-    if( bp->tempOutputBuffer )
-        PaUtil_FreeMemory( bp->tempOutputBuffer );
+    if( src->userBufferProcessor.inputChannelCount > 0 )
+    {
+        PaUtil_ResetResampler( &src->inputResampler );
 
-    if( bp->tempOutputBufferPtrs )
-        PaUtil_FreeMemory( bp->tempOutputBufferPtrs );
+        src->framesInInputBuffer = src->initialFramesInInputBuffer;
+        memset( src->inputBuffer, 0, src->framesInInputBuffer
+                * src->userBufferProcessor.inputChannelCount * sizeof(float) );
+    }
 
-    if( bp->hostOutputChannels[0] )
-        PaUtil_FreeMemory( bp->hostOutputChannels[0] );
+    if( src->userBufferProcessor.outputChannelCount > 0 )
+        PaUtil_ResetResampler( &src->outputResampler );
 
-    return result;
+    if( src->independentClocks )
+    {
+        PaUtil_ResetBufferProcessor( &src->inputHostProcessor );
+        PaUtil_ResetBufferProcessor( &src->outputHostProcessor );
+
+        src->inputTimeKnown = 0;
+        src->inputStatusFlags = 0;
+        src->filteredDriftError = 0.;
+        src->driftIntegral = 0.;
+        PaUtil_AdjustResamplerRatio( &src->inputResampler, 1. );
+    }
 }
 
 
-void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bp )
+static void TerminateSampleRateConverter( PaUtilSampleRateConverter *src,
+        int userBufferProcessorInitialized )
 {
-    if( bp->tempInputBuffer )
-        PaUtil_FreeMemory( bp->tempInputBuffer );
+    if( userBufferProcessorInitialized )
+        PaUtil_TerminateBufferProcessor( &src->userBufferProcessor );
+
+    if( src->independentClocks )
+    {
+        PaUtil_TerminateBufferProcessor( &src->inputHostProcessor );
+        PaUtil_TerminateBufferProcessor( &src->outputHostProcessor );
+    }
 
-    if( bp->tempInputBufferPtrs )
-        PaUtil_FreeMemory( bp->tempInputBufferPtrs );
+    PaUtil_TerminateResampler( &src->inputResampler );
+    PaUtil_TerminateResampler( &src->outputResampler );
 
-    if( bp->hostInputChannels[0] )
-        PaUtil_FreeMemory( bp->hostInputChannels[0] );
-        
-    if( bp->tempOutputBuffer )
-        PaUtil_FreeMemory( bp->tempOutputBuffer );
+    if( src->inputBuffer )
+        PaUtil_FreeAlignedMemory( src->inputBuffer );
 
-    if( bp->tempOutputBufferPtrs )
-        PaUtil_FreeMemory( bp->tempOutputBufferPtrs );
+    if( src->outputBuffer )
+        PaUtil_FreeAlignedMemory( src->outputBuffer );
 
-    if( bp->hostOutputChannels[0] )
-        PaUtil_FreeMemory( bp->hostOutputChannels[0] );
+    PaUtil_FreeMemory( src );
 }
 
 
-void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
+/* The stream callback of the host side buffer processor. Each chunk of
+   host frames is resampled into inputBuffer, then userBufferProcessor gets
+   as many frames as the output resampler needs to produce the chunk's output
+   (or all of inputBuffer for input only streams).
+*/
+static int SampleRateConverterCallback( const void *input, void *output,
+        unsigned long frameCount, const PaStreamCallbackTimeInfo* timeInfo,
+        PaStreamCallbackFlags statusFlags, void *userData )
 {
-    unsigned long tempInputBufferSize, tempOutputBufferSize;
+    PaUtilSampleRateConverter *src = (PaUtilSampleRateConverter*)userData;
+    PaUtilBufferProcessor *ubp = &src->userBufferProcessor;
+    unsigned int inputChannelCount = ubp->inputChannelCount;
+    unsigned int outputChannelCount = ubp->outputChannelCount;
+    unsigned long framesDone = 0;
+    int callbackResult = paContinue;
+
+    while( framesDone < frameCount )
+    {
+        unsigned long hostFrames = PA_MIN_( frameCount - framesDone, PA_FRAMES_PER_RESAMPLING_CHUNK_ );
+        unsigned long userFrames;
+        PaStreamCallbackFlags userStatusFlags = statusFlags;
 
-    bp->framesInTempInputBuffer = bp->initialFramesInTempInputBuffer;
-    bp->framesInTempOutputBuffer = bp->initialFramesInTempOutputBuffer;
+        if( src->independentClocks )
+        {
+            userStatusFlags |= src->inputStatusFlags;
+            src->inputStatusFlags = 0;
+        }
 
-    if( bp->framesInTempInputBuffer > 0 )
-    {
-        tempInputBufferSize =
-            bp->framesPerTempBuffer * bp->bytesPerUserInputSample * bp->inputChannelCount;
-        memset( bp->tempInputBuffer, 0, tempInputBufferSize );
-    }
+        if( inputChannelCount > 0 && input )
+        {
+            unsigned long inputFrames = hostFrames;
 
-    if( bp->framesInTempOutputBuffer > 0 )
-    {      
-        tempOutputBufferSize =
-            bp->framesPerTempBuffer * bp->bytesPerUserOutputSample * bp->outputChannelCount;
-        memset( bp->tempOutputBuffer, 0, tempOutputBufferSize );
-    }
-}
+            src->framesInInputBuffer += PaUtil_Resample( &src->inputResampler,
+                    src->inputBuffer + src->framesInInputBuffer * inputChannelCount,
+                    src->inputBufferFrames - src->framesInInputBuffer,
+                    (const float*)input + framesDone * inputChannelCount, &inputFrames );
+        }
 
+        if( outputChannelCount > 0 )
+            userFrames = PaUtil_GetResamplerRequiredInputFrameCount( &src->outputResampler, hostFrames );
+        else
+            userFrames = src->framesInInputBuffer;
 
-unsigned long PaUtil_GetBufferProcessorInputLatencyFrames( PaUtilBufferProcessor* bp )
-{
-    return bp->initialFramesInTempInputBuffer;
-}
+        if( inputChannelCount > 0 && userFrames > src->framesInInputBuffer )
+        {
+            /* only if no input was supplied, initialFramesInInputBuffer covers
+               the difference between the resamplers otherwise */
+            memset( src->inputBuffer + src->framesInInputBuffer * inputChannelCount, 0,
+                    (userFrames - src->framesInInputBuffer) * inputChannelCount * sizeof(float) );
+            src->framesInInputBuffer = userFrames;
+            userStatusFlags |= paInputUnderflow;
+        }
 
+        if( userFrames > 0 )
+        {
+            PaStreamCallbackTimeInfo userTimeInfo;
 
-unsigned long PaUtil_GetBufferProcessorOutputLatencyFrames( PaUtilBufferProcessor* bp )
-{
-    return bp->initialFramesInTempOutputBuffer;
-}
+            /* the next frame out of the input resampler and the next one
+               going into the output resampler are at the instant of their
+               next frame */
+            userTimeInfo.currentTime = timeInfo->currentTime;
+            if( src->independentClocks )
+            {
+                userTimeInfo.inputBufferAdcTime = src->nextInputAdcTime
+                        - PaUtil_GetResamplerInputDelay( &src->inputResampler ) / src->hostInputSampleRate
+                        - src->framesInInputBuffer / src->userSampleRate;
+            }
+            else if( inputChannelCount > 0 )
+            {
+                userTimeInfo.inputBufferAdcTime = timeInfo->inputBufferAdcTime
+                        + ((framesDone + hostFrames) - PaUtil_GetResamplerInputDelay( &src->inputResampler ))
+                                / src->hostSampleRate
+                        - src->framesInInputBuffer / src->userSampleRate;
+            }
+            else
+            {
+                userTimeInfo.inputBufferAdcTime = 0.;
+            }
+            if( outputChannelCount > 0 )
+            {
+                userTimeInfo.outputBufferDacTime = timeInfo->outputBufferDacTime
+                        + framesDone / src->hostSampleRate
+                        + PaUtil_GetResamplerInputDelay( &src->outputResampler ) / src->userSampleRate;
+            }
+            else
+            {
+                userTimeInfo.outputBufferDacTime = 0.;
+            }
 
+            PaUtil_BeginBufferProcessing( ubp, &userTimeInfo, userStatusFlags );
 
-void PaUtil_SetInputFrameCount( PaUtilBufferProcessor* bp,
-        unsigned long frameCount )
-{
-    if( frameCount == 0 )
-        bp->hostInputFrameCount[0] = bp->framesPerHostBuffer;
-    else
-        bp->hostInputFrameCount[0] = frameCount;
+            if( inputChannelCount > 0 )
+            {
+                PaUtil_SetInputFrameCount( ubp, userFrames );
+                PaUtil_SetInterleavedInputChannels( ubp, 0, src->inputBuffer, 0 );
+            }
+
+            if( outputChannelCount > 0 )
+            {
+                PaUtil_SetOutputFrameCount( ubp, userFrames );
+                PaUtil_SetInterleavedOutputChannels( ubp, 0, src->outputBuffer, 0 );
+            }
+
+            PaUtil_EndBufferProcessing( ubp, &callbackResult );
+
+            if( inputChannelCount > 0 )
+            {
+                src->framesInInputBuffer -= userFrames;
+                memmove( src->inputBuffer, src->inputBuffer + userFrames * inputChannelCount,
+                        src->framesInInputBuffer * inputChannelCount * sizeof(float) );
+            }
+        }
+
+        if( outputChannelCount > 0 && output )
+        {
+            float *hostOutput = (float*)output + framesDone * outputChannelCount;
+            unsigned long framesWritten;
+
+            framesWritten = PaUtil_Resample( &src->outputResampler, hostOutput, hostFrames,
+                    src->outputBuffer, &userFrames );
+
+            if( framesWritten < hostFrames ) /* not expected, userFrames was enough */
+                memset( hostOutput + framesWritten * outputChannelCount, 0,
+                        (hostFrames - framesWritten) * outputChannelCount * sizeof(float) );
+        }
+
+        framesDone += hostFrames;
+    }
+
+    return callbackResult;
 }
-        
 
-void PaUtil_SetNoInput( PaUtilBufferProcessor* bp )
+
+static void DiscardInput( PaUtilSampleRateConverter *src, unsigned long frameCount )
 {
-    assert( bp->inputChannelCount > 0 );
+    unsigned int channelCount = src->userBufferProcessor.inputChannelCount;
 
-    bp->hostInputChannels[0][0].data = 0;
+    if( frameCount > src->framesInInputBuffer )
+        frameCount = src->framesInInputBuffer;
+
+    src->framesInInputBuffer -= frameCount;
+    memmove( src->inputBuffer, src->inputBuffer + frameCount * channelCount,
+            src->framesInInputBuffer * channelCount * sizeof(float) );
 }
 
 
-void PaUtil_SetInputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data, unsigned int stride )
+static void InsertSilenceBeforeInput( PaUtilSampleRateConverter *src, unsigned long frameCount )
 {
-    assert( channel < bp->inputChannelCount );
-    
-    bp->hostInputChannels[0][channel].data = data;
-    bp->hostInputChannels[0][channel].stride = stride;
+    unsigned int channelCount = src->userBufferProcessor.inputChannelCount;
+
+    if( frameCount > src->inputBufferFrames - src->framesInInputBuffer )
+        frameCount = src->inputBufferFrames - src->framesInInputBuffer;
+
+    memmove( src->inputBuffer + frameCount * channelCount, src->inputBuffer,
+            src->framesInInputBuffer * channelCount * sizeof(float) );
+    memset( src->inputBuffer, 0, frameCount * channelCount * sizeof(float) );
+    src->framesInInputBuffer += frameCount;
 }
 
 
-void PaUtil_SetInterleavedInputChannels( PaUtilBufferProcessor* bp,
-        unsigned int firstChannel, void *data, unsigned int channelCount )
+/* The stream callback of inputHostProcessor. Resamples the host input into
+   inputBuffer, from where SampleRateConverterCallback() takes it when the
+   output device is ready.
+*/
+static int DriftCompensatorInputCallback( const void *input, void *output,
+        unsigned long frameCount, const PaStreamCallbackTimeInfo* timeInfo,
+        PaStreamCallbackFlags statusFlags, void *userData )
 {
-    unsigned int i;
-    unsigned int channel = firstChannel;
-    unsigned char *p = (unsigned char*)data;
+    PaUtilSampleRateConverter *src = (PaUtilSampleRateConverter*)userData;
+    unsigned int channelCount = src->userBufferProcessor.inputChannelCount;
+    unsigned long framesDone = 0;
 
-    if( channelCount == 0 )
-        channelCount = bp->inputChannelCount;
+    (void) output; /* unused parameter */
+
+    while( framesDone < frameCount )
+    {
+        unsigned long inputFrames = frameCount - framesDone;
+
+        src->framesInInputBuffer += PaUtil_Resample( &src->inputResampler,
+                src->inputBuffer + src->framesInInputBuffer * channelCount,
+                src->inputBufferFrames - src->framesInInputBuffer,
+                (const float*)input + framesDone * channelCount, &inputFrames );
+        framesDone += inputFrames;
+
+        if( inputFrames == 0 )
+        {
+            /* the output hasn't been taking the input for a while, keep the
+               most recent input */
+            DiscardInput( src, src->framesInInputBuffer > src->initialFramesInInputBuffer
+                    ? src->framesInInputBuffer - src->initialFramesInInputBuffer
+                    : src->framesInInputBuffer );
+            src->inputStatusFlags |= paInputOverflow;
+        }
+    }
+
+    src->nextInputAdcTime = timeInfo->inputBufferAdcTime + frameCount / src->hostInputSampleRate;
+    src->inputTimeKnown = ( timeInfo->inputBufferAdcTime != 0. || timeInfo->currentTime != 0. );
+    src->inputStatusFlags |= statusFlags & (paInputUnderflow | paInputOverflow);
+
+    return paContinue;
+}
+
+
+/* Called before the output is processed. Estimates how much input is
+   buffered: what was resampled, what is still in the input resampler and
+   what the input device captured since its last buffer, the latter keeps the
+   estimate smooth whatever the periods of the two devices. A PI controller
+   trims the input resampler's ratio to hold it at initialFramesInInputBuffer.
+*/
+static void UpdateDriftCompensation( PaUtilSampleRateConverter *src,
+        PaTime currentTime, unsigned long outputFrameCount )
+{
+    double target = (double)src->initialFramesInInputBuffer;
+    double level, error, dt, correction;
+
+    level = src->framesInInputBuffer
+            + PaUtil_GetResamplerInputDelay( &src->inputResampler )
+                    * src->userSampleRate / src->hostInputSampleRate;
+
+    if( src->inputTimeKnown )
+    {
+        double capturedFrames = (currentTime - src->nextInputAdcTime) * src->userSampleRate;
+        double limit = 2. * src->inputPeriodFrames;
+
+        if( capturedFrames > limit )
+            capturedFrames = limit;
+        else if( capturedFrames < -limit )
+            capturedFrames = -limit;
+
+        level += capturedFrames;
+    }
+
+    error = level - target;
+
+    if( fabs( error ) > .5 * target )
+    {
+        /* far more than drift can account for, e.g. after an xrun of one
+           of the devices. start over from the target */
+        unsigned long frameCount = (unsigned long)floor( fabs( error ) + .5 );
+
+        if( error > 0. )
+        {
+            DiscardInput( src, frameCount );
+            src->inputStatusFlags |= paInputOverflow;
+        }
+        else
+        {
+            InsertSilenceBeforeInput( src, frameCount );
+            src->inputStatusFlags |= paInputUnderflow;
+        }
+
+        src->filteredDriftError = 0.;
+        return;
+    }
+
+    dt = outputFrameCount / src->hostSampleRate;
+    error /= src->userSampleRate;
+
+    src->filteredDriftError += (error - src->filteredDriftError)
+            * ( dt < PA_DRIFT_ERROR_TIME_CONSTANT_ ? dt / PA_DRIFT_ERROR_TIME_CONSTANT_ : 1. );
+
+    src->driftIntegral += PA_DRIFT_INTEGRAL_GAIN_ * src->filteredDriftError * dt;
+    if( src->driftIntegral > PA_DRIFT_MAX_CORRECTION_ )
+        src->driftIntegral = PA_DRIFT_MAX_CORRECTION_;
+    else if( src->driftIntegral < -PA_DRIFT_MAX_CORRECTION_ )
+        src->driftIntegral = -PA_DRIFT_MAX_CORRECTION_;
+
+    /* more input than wanted: produce fewer frames per input frame */
+    correction = PA_DRIFT_PROPORTIONAL_GAIN_ * src->filteredDriftError + src->driftIntegral;
+    PaUtil_AdjustResamplerRatio( &src->inputResampler, 1. - correction );
+}
+
+
+/* Pass the host buffers set on bp to one of the host processors of a drift
+   compensating converter. */
+static unsigned long ProcessHostBuffers( PaUtilBufferProcessor *bp,
+        PaUtilBufferProcessor *hostProcessor, PaStreamCallbackFlags statusFlags,
+        int *streamCallbackResult )
+{
+    PaStreamCallbackTimeInfo timeInfo = *bp->timeInfo;
+    int i;
+
+    PaUtil_BeginBufferProcessing( hostProcessor, &timeInfo, statusFlags );
+
+    for( i = 0; i < 2; ++i )
+    {
+        if( hostProcessor->inputChannelCount > 0 )
+        {
+            hostProcessor->hostInputFrameCount[i] = bp->hostInputFrameCount[i];
+            memcpy( hostProcessor->hostInputChannels[i], bp->hostInputChannels[i],
+                    bp->inputChannelCount * sizeof(PaUtilChannelDescriptor) );
+        }
+
+        if( hostProcessor->outputChannelCount > 0 )
+        {
+            hostProcessor->hostOutputFrameCount[i] = bp->hostOutputFrameCount[i];
+            memcpy( hostProcessor->hostOutputChannels[i], bp->hostOutputChannels[i],
+                    bp->outputChannelCount * sizeof(PaUtilChannelDescriptor) );
+        }
+    }
+
+    return PaUtil_EndBufferProcessing( hostProcessor, streamCallbackResult );
+}
+
+
+static unsigned long EndIndependentClocksProcessing( PaUtilBufferProcessor *bp,
+        int *streamCallbackResult )
+{
+    PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+    unsigned long framesProcessed = 0;
+
+    if( bp->hostInputChannels[0][0].data /* see PaUtil_SetNoInput */ )
+    {
+        int inputResult = paContinue;
+
+        framesProcessed = ProcessHostBuffers( bp, &src->inputHostProcessor,
+                bp->callbackStatusFlags & (paInputUnderflow | paInputOverflow), &inputResult );
+    }
+
+    if( bp->hostOutputChannels[0][0].data /* see PaUtil_SetNoOutput */ )
+    {
+        UpdateDriftCompensation( src, bp->timeInfo->currentTime,
+                bp->hostOutputFrameCount[0] + bp->hostOutputFrameCount[1] );
+
+        framesProcessed = ProcessHostBuffers( bp, &src->outputHostProcessor,
+                bp->callbackStatusFlags & ~(paInputUnderflow | paInputOverflow),
+                streamCallbackResult );
+    }
+
+    return framesProcessed;
+}
+
+
+static PaError InitializeSampleRateConverter( PaUtilBufferProcessor* bp,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        PaSampleFormat hostInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        PaSampleFormat hostOutputSampleFormat,
+        double userSampleRate,
+        double hostInputSampleRate,
+        double hostSampleRate,
+        int independentClocks,
+        PaStreamFlags streamFlags,
+        unsigned long framesPerUserBuffer,
+        unsigned long framesPerHostBuffer,
+        PaUtilHostBufferSizeMode hostBufferSizeMode,
+        PaStreamCallback *streamCallback, void *userData )
+{
+    PaError result = paNoError;
+    PaUtilSampleRateConverter *src;
+    PaUtilResamplerQuality quality = paUtilResamplerMediumQuality;
+    unsigned long framesPerUserChunk;
+    int hostBufferProcessorInitialized = 0;
+    int userBufferProcessorInitialized = 0;
+    int inputHostProcessorInitialized = 0;
+    int outputHostProcessorInitialized = 0;
+
+    if( !streamCallback )
+        return paInvalidFlag;
+
+    if( streamFlags & paConvertSampleRateFast )
+        quality = paUtilResamplerFastQuality;
+    else if( streamFlags & paConvertSampleRateBest )
+        quality = paUtilResamplerBestQuality;
+
+    src = (PaUtilSampleRateConverter*)PaUtil_AllocateMemory( sizeof(PaUtilSampleRateConverter) );
+    if( !src )
+        return paInsufficientMemory;
+
+    memset( src, 0, sizeof(PaUtilSampleRateConverter) );
+    src->userSampleRate = userSampleRate;
+    src->hostSampleRate = hostSampleRate;
+    src->hostInputSampleRate = hostInputSampleRate;
+
+    /* the most user frames a chunk can produce or need, steady state plus
+       one interpolation step for rounding */
+    framesPerUserChunk = (unsigned long)ceil( PA_FRAMES_PER_RESAMPLING_CHUNK_ * userSampleRate
+            / PA_MIN_( hostInputSampleRate, hostSampleRate ) ) + 2;
+
+    if( outputChannelCount > 0 )
+    {
+        result = PaUtil_InitializeResampler( &src->outputResampler, outputChannelCount,
+                userSampleRate, hostSampleRate, quality, 0., framesPerUserChunk );
+        if( result != paNoError )
+            goto error;
+
+        /* the first chunk after a reset also fills the filter */
+        framesPerUserChunk = PaUtil_GetResamplerRequiredInputFrameCount( &src->outputResampler,
+                PA_FRAMES_PER_RESAMPLING_CHUNK_ ) + 2;
+
+        src->outputBufferFrames = framesPerUserChunk;
+        src->outputBuffer = (float*)PaUtil_AllocateAlignedMemory(
+                (long)(src->outputBufferFrames * outputChannelCount * sizeof(float)), PA_CACHE_LINE_SIZE );
+        if( !src->outputBuffer )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+    }
+
+    if( inputChannelCount > 0 )
+    {
+        result = PaUtil_InitializeResampler( &src->inputResampler, inputChannelCount,
+                hostInputSampleRate, userSampleRate, quality,
+                independentClocks ? PA_DRIFT_MAX_CORRECTION_ : 0., PA_FRAMES_PER_RESAMPLING_CHUNK_ );
+        if( result != paNoError )
+            goto error;
+
+        /* the input resampler only delivers once its filter has seen
+           enough input while the output resampler wants its filter filled
+           at once, beyond that both deviate from the exact ratio by up to a
+           frame per chunk */
+        if( outputChannelCount > 0 )
+        {
+            src->initialFramesInInputBuffer =
+                    (unsigned long)ceil( PaUtil_GetResamplerLatency( &src->inputResampler ) * userSampleRate )
+                    + (unsigned long)ceil( PaUtil_GetResamplerLatency( &src->outputResampler ) * userSampleRate )
+                    + (unsigned long)ceil( 2. * userSampleRate / hostInputSampleRate ) + 2;
+        }
+
+        if( independentClocks )
+        {
+            /* the input arrives a host buffer at a time and is taken a host
+               buffer at a time, at instants unrelated to each other, plus
+               some room for the two devices' scheduling jitter */
+            unsigned long periodFrames = framesPerHostBuffer ? framesPerHostBuffer
+                    : PA_FRAMES_PER_TEMP_BUFFER_WHEN_HOST_BUFFER_SIZE_IS_UNKNOWN_;
+            unsigned long outputPeriodFrames = (unsigned long)ceil( periodFrames * userSampleRate / hostSampleRate );
+
+            src->inputPeriodFrames = (unsigned long)ceil( periodFrames * userSampleRate / hostInputSampleRate );
+            src->initialFramesInInputBuffer += src->inputPeriodFrames + outputPeriodFrames
+                    + PA_MAX_( src->inputPeriodFrames, outputPeriodFrames ) / 2;
+
+            /* room for the input to run ahead until it is recentred */
+            src->inputBufferFrames = 2 * (src->initialFramesInInputBuffer + src->inputPeriodFrames)
+                    + 2 * framesPerUserChunk;
+        }
+        else
+        {
+            src->inputBufferFrames = src->initialFramesInInputBuffer + 2 * framesPerUserChunk;
+        }
+        src->inputBuffer = (float*)PaUtil_AllocateAlignedMemory(
+                (long)(src->inputBufferFrames * inputChannelCount * sizeof(float)), PA_CACHE_LINE_SIZE );
+        if( !src->inputBuffer )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+    }
+
+    result = PaUtil_InitializeBufferProcessor( &src->userBufferProcessor,
+            inputChannelCount, userInputSampleFormat, paFloat32,
+            outputChannelCount, userOutputSampleFormat, paFloat32,
+            userSampleRate, streamFlags, framesPerUserBuffer,
+            src->inputBufferFrames > framesPerUserChunk ? src->inputBufferFrames : framesPerUserChunk,
+            paUtilBoundedHostBufferSize, streamCallback, userData );
+    if( result != paNoError )
+        goto error;
+    userBufferProcessorInitialized = 1;
+    src->userBufferProcessor.recordsStatistics = 0;
+
+    if( independentClocks )
+    {
+        /* each device's buffers are converted at its own rate */
+        result = PaUtil_InitializeBufferProcessor( &src->inputHostProcessor,
+                inputChannelCount, paFloat32, hostInputSampleFormat,
+                0, paFloat32, hostOutputSampleFormat,
+                hostInputSampleRate, streamFlags & ~(paNeverDropInput | paMeterLevels), 0 /* any */,
+                framesPerHostBuffer, hostBufferSizeMode,
+                DriftCompensatorInputCallback, src );
+        if( result != paNoError )
+            goto error;
+        inputHostProcessorInitialized = 1;
+        src->inputHostProcessor.recordsStatistics = 0;
+
+        result = PaUtil_InitializeBufferProcessor( &src->outputHostProcessor,
+                0, paFloat32, hostInputSampleFormat,
+                outputChannelCount, paFloat32, hostOutputSampleFormat,
+                hostSampleRate, streamFlags & ~(paNeverDropInput | paMeterLevels), 0 /* any */,
+                framesPerHostBuffer, hostBufferSizeMode,
+                SampleRateConverterCallback, src );
+        if( result != paNoError )
+            goto error;
+        outputHostProcessorInitialized = 1;
+        src->outputHostProcessor.recordsStatistics = 0;
+    }
+
+    /* the host side hands paFloat32 at the host rate to the resamplers, in
+       whatever sizes the host delivers */
+    result = PaUtil_InitializeBufferProcessor( bp,
+            inputChannelCount, paFloat32, hostInputSampleFormat,
+            outputChannelCount, paFloat32, hostOutputSampleFormat,
+            hostSampleRate, streamFlags & ~(paNeverDropInput | paMeterLevels), 0 /* any */,
+            framesPerHostBuffer, hostBufferSizeMode,
+            SampleRateConverterCallback, src );
+    if( result != paNoError )
+        goto error;
+    hostBufferProcessorInitialized = 1;
+
+    src->independentClocks = independentClocks;
+    bp->sampleRateConverter = src;
+
+    /* the user side's stages count towards the host buffers, the resampling
+       in between towards neither */
+    bp->callbackStage = paUtilOtherCpuLoadStage;
+    src->userBufferProcessor.stageMeasurer = &bp->cpuLoadMeasurer;
+    if( independentClocks )
+    {
+        src->inputHostProcessor.stageMeasurer = &bp->cpuLoadMeasurer;
+        src->inputHostProcessor.callbackStage = paUtilOtherCpuLoadStage;
+        src->outputHostProcessor.stageMeasurer = &bp->cpuLoadMeasurer;
+        src->outputHostProcessor.callbackStage = paUtilOtherCpuLoadStage;
+        src->inputHostProcessor.streamTaps = 0;
+        src->outputHostProcessor.streamTaps = 0;
+    }
+
+    /* the taps are those of the user's buffers */
+    bp->taps = src->userBufferProcessor.taps;
+    bp->streamTaps = 0;
+    src->userBufferProcessor.streamTaps = &bp->taps;
+    ResetSampleRateConverter( src );
+
+    return result;
+
+error:
+    if( hostBufferProcessorInitialized )
+        PaUtil_TerminateBufferProcessor( bp );
+
+    if( inputHostProcessorInitialized )
+        PaUtil_TerminateBufferProcessor( &src->inputHostProcessor );
+
+    if( outputHostProcessorInitialized )
+        PaUtil_TerminateBufferProcessor( &src->outputHostProcessor );
+
+    TerminateSampleRateConverter( src, userBufferProcessorInitialized );
+
+    return result;
+}
+
+
+PaError PaUtil_InitializeResamplingBufferProcessor( PaUtilBufferProcessor* bp,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        PaSampleFormat hostInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        PaSampleFormat hostOutputSampleFormat,
+        double userSampleRate,
+        double hostSampleRate,
+        PaStreamFlags streamFlags,
+        unsigned long framesPerUserBuffer,
+        unsigned long framesPerHostBuffer,
+        PaUtilHostBufferSizeMode hostBufferSizeMode,
+        PaStreamCallback *streamCallback, void *userData )
+{
+    return InitializeSampleRateConverter( bp,
+            inputChannelCount, userInputSampleFormat, hostInputSampleFormat,
+            outputChannelCount, userOutputSampleFormat, hostOutputSampleFormat,
+            userSampleRate, hostSampleRate, hostSampleRate, 0 /* one clock */,
+            streamFlags, framesPerUserBuffer, framesPerHostBuffer, hostBufferSizeMode,
+            streamCallback, userData );
+}
+
+
+PaError PaUtil_InitializeDriftCompensatingBufferProcessor( PaUtilBufferProcessor* bp,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        PaSampleFormat hostInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        PaSampleFormat hostOutputSampleFormat,
+        double userSampleRate,
+        double hostInputSampleRate,
+        double hostOutputSampleRate,
+        PaStreamFlags streamFlags,
+        unsigned long framesPerUserBuffer,
+        unsigned long framesPerHostBuffer,
+        PaUtilHostBufferSizeMode hostBufferSizeMode,
+        PaStreamCallback *streamCallback, void *userData )
+{
+    if( inputChannelCount <= 0 || outputChannelCount <= 0 )
+        return paInvalidFlag; /* only full duplex streams have two clocks */
+
+    return InitializeSampleRateConverter( bp,
+            inputChannelCount, userInputSampleFormat, hostInputSampleFormat,
+            outputChannelCount, userOutputSampleFormat, hostOutputSampleFormat,
+            userSampleRate, hostInputSampleRate, hostOutputSampleRate, 1 /* independent clocks */,
+            streamFlags, framesPerUserBuffer, framesPerHostBuffer, hostBufferSizeMode,
+            streamCallback, userData );
+}
+
+
+static void TerminateChannelMixer( PaUtilChannelMixer *mixer,
+        int userBufferProcessorInitialized )
+{
+    if( userBufferProcessorInitialized )
+        PaUtil_TerminateBufferProcessor( &mixer->userBufferProcessor );
+
+    if( mixer->inputMatrix.firstTerm )
+        PaUtil_TerminateChannelMatrix( &mixer->inputMatrix );
+
+    if( mixer->outputMatrix.firstTerm )
+        PaUtil_TerminateChannelMatrix( &mixer->outputMatrix );
+
+    if( mixer->buffers )
+        PaUtil_FreeAlignedMemory( mixer->buffers );
+
+    if( mixer->inputChannels )
+        PaUtil_FreeMemory( mixer->inputChannels );
+
+    if( mixer->outputChannels )
+        PaUtil_FreeMemory( mixer->outputChannels );
+
+    if( mixer->hostInputChannels )
+        PaUtil_FreeMemory( (void*)mixer->hostInputChannels );
+
+    if( mixer->hostOutputChannels )
+        PaUtil_FreeMemory( mixer->hostOutputChannels );
+
+    PaUtil_FreeMemory( mixer );
+}
+
+
+/* The stream callback of the host side buffer processor. Each chunk of the
+   device's channels is mixed into the stream's input channels, passed
+   through userBufferProcessor and the stream's output channels are mixed
+   into the device's. A direction which the host didn't supply is passed on
+   as missing.
+*/
+static int ChannelMixerCallback( const void *input, void *output,
+        unsigned long frameCount, const PaStreamCallbackTimeInfo* timeInfo,
+        PaStreamCallbackFlags statusFlags, void *userData )
+{
+    PaUtilChannelMixer *mixer = (PaUtilChannelMixer*)userData;
+    PaUtilBufferProcessor *ubp = &mixer->userBufferProcessor;
+    unsigned int inputChannelCount = ubp->inputChannelCount;
+    unsigned int outputChannelCount = ubp->outputChannelCount;
+    unsigned long framesDone = 0;
+    int callbackResult = paContinue;
+    unsigned int i;
+
+    while( framesDone < frameCount )
+    {
+        unsigned long frames = PA_MIN_( frameCount - framesDone, PA_FRAMES_PER_MIXING_CHUNK_ );
+        PaStreamCallbackTimeInfo userTimeInfo = *timeInfo;
+
+        if( inputChannelCount > 0 )
+            userTimeInfo.inputBufferAdcTime += framesDone / mixer->sampleRate;
+        if( outputChannelCount > 0 )
+            userTimeInfo.outputBufferDacTime += framesDone / mixer->sampleRate;
+
+        if( inputChannelCount > 0 && input )
+        {
+            for( i = 0; i < (unsigned int)mixer->inputMatrix.sourceChannelCount; ++i )
+                mixer->hostInputChannels[i] = ((const float *const *)input)[i] + framesDone;
+
+            PaUtil_ApplyChannelMatrix( &mixer->inputMatrix, mixer->inputChannels,
+                    mixer->hostInputChannels, frames );
+        }
+
+        PaUtil_BeginBufferProcessing( ubp, &userTimeInfo, statusFlags );
+
+        if( inputChannelCount > 0 )
+        {
+            if( input )
+            {
+                PaUtil_SetInputFrameCount( ubp, frames );
+                for( i = 0; i < inputChannelCount; ++i )
+                    PaUtil_SetNonInterleavedInputChannel( ubp, i, mixer->inputChannels[i] );
+            }
+            else
+            {
+                PaUtil_SetNoInput( ubp );
+            }
+        }
+
+        if( outputChannelCount > 0 )
+        {
+            if( output )
+            {
+                PaUtil_SetOutputFrameCount( ubp, frames );
+                for( i = 0; i < outputChannelCount; ++i )
+                    PaUtil_SetNonInterleavedOutputChannel( ubp, i, mixer->outputChannels[i] );
+            }
+            else
+            {
+                PaUtil_SetNoOutput( ubp );
+            }
+        }
+
+        PaUtil_EndBufferProcessing( ubp, &callbackResult );
+
+        if( outputChannelCount > 0 && output )
+        {
+            for( i = 0; i < (unsigned int)mixer->outputMatrix.destinationChannelCount; ++i )
+                mixer->hostOutputChannels[i] = ((float *const *)output)[i] + framesDone;
+
+            PaUtil_ApplyChannelMatrix( &mixer->outputMatrix, mixer->hostOutputChannels,
+                    (const float *const *)mixer->outputChannels, frames );
+        }
+
+        framesDone += frames;
+    }
+
+    return callbackResult;
+}
+
+
+PaError PaUtil_InitializeChannelMatrixBufferProcessor( PaUtilBufferProcessor* bp,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        PaSampleFormat hostInputSampleFormat, const PaChannelMatrix *inputChannelMatrix,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        PaSampleFormat hostOutputSampleFormat, const PaChannelMatrix *outputChannelMatrix,
+        double sampleRate,
+        PaStreamFlags streamFlags,
+        unsigned long framesPerUserBuffer,
+        unsigned long framesPerHostBuffer,
+        PaUtilHostBufferSizeMode hostBufferSizeMode,
+        PaStreamCallback *streamCallback, void *userData )
+{
+    PaError result = paNoError;
+    PaUtilChannelMixer *mixer;
+    int hostInputChannelCount = 0, hostOutputChannelCount = 0;
+    int i;
+    int userBufferProcessorInitialized = 0;
+
+    if( !streamCallback )
+        return paInvalidFlag;
+
+    mixer = (PaUtilChannelMixer*)PaUtil_AllocateMemory( sizeof(PaUtilChannelMixer) );
+    if( !mixer )
+        return paInsufficientMemory;
+
+    memset( mixer, 0, sizeof(PaUtilChannelMixer) );
+    mixer->sampleRate = sampleRate;
+
+    mixer->buffers = (float*)PaUtil_AllocateAlignedMemory( (long)(sizeof(float) * PA_FRAMES_PER_MIXING_CHUNK_
+            * (inputChannelCount + outputChannelCount)), PA_CACHE_LINE_SIZE );
+    if( !mixer->buffers )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    if( inputChannelCount > 0 )
+    {
+        result = PaUtil_InitializeChannelMatrix( &mixer->inputMatrix, inputChannelMatrix,
+                inputChannelCount, 0 /* to the stream */ );
+        if( result != paNoError )
+            goto error;
+        hostInputChannelCount = mixer->inputMatrix.sourceChannelCount;
+
+        mixer->inputChannels = (float**)PaUtil_AllocateMemory( (long)(sizeof(float*) * inputChannelCount) );
+        mixer->hostInputChannels = (const float**)PaUtil_AllocateMemory(
+                (long)(sizeof(float*) * hostInputChannelCount) );
+        if( !mixer->inputChannels || !mixer->hostInputChannels )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+
+        for( i = 0; i < inputChannelCount; ++i )
+            mixer->inputChannels[i] = mixer->buffers + i * PA_FRAMES_PER_MIXING_CHUNK_;
+    }
+
+    if( outputChannelCount > 0 )
+    {
+        result = PaUtil_InitializeChannelMatrix( &mixer->outputMatrix, outputChannelMatrix,
+                outputChannelCount, 1 /* to the device */ );
+        if( result != paNoError )
+            goto error;
+        hostOutputChannelCount = mixer->outputMatrix.destinationChannelCount;
+
+        mixer->outputChannels = (float**)PaUtil_AllocateMemory( (long)(sizeof(float*) * outputChannelCount) );
+        mixer->hostOutputChannels = (float**)PaUtil_AllocateMemory(
+                (long)(sizeof(float*) * hostOutputChannelCount) );
+        if( !mixer->outputChannels || !mixer->hostOutputChannels )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+
+        for( i = 0; i < outputChannelCount; ++i )
+            mixer->outputChannels[i] = mixer->buffers + (inputChannelCount + i) * PA_FRAMES_PER_MIXING_CHUNK_;
+    }
+
+    result = PaUtil_InitializeBufferProcessor( &mixer->userBufferProcessor,
+            inputChannelCount, userInputSampleFormat, paFloat32 | paNonInterleaved,
+            outputChannelCount, userOutputSampleFormat, paFloat32 | paNonInterleaved,
+            sampleRate, streamFlags, framesPerUserBuffer,
+            PA_FRAMES_PER_MIXING_CHUNK_, paUtilBoundedHostBufferSize, streamCallback, userData );
+    if( result != paNoError )
+        goto error;
+    userBufferProcessorInitialized = 1;
+    mixer->userBufferProcessor.recordsStatistics = 0;
+
+    /* the host side hands the device's channels as paFloat32 to the
+       matrices, in whatever sizes the host delivers */
+    result = PaUtil_InitializeBufferProcessor( bp,
+            hostInputChannelCount, paFloat32 | paNonInterleaved, hostInputSampleFormat,
+            hostOutputChannelCount, paFloat32 | paNonInterleaved, hostOutputSampleFormat,
+            sampleRate, streamFlags & ~(paNeverDropInput | paMeterLevels), 0 /* any */,
+            framesPerHostBuffer, hostBufferSizeMode,
+            ChannelMixerCallback, mixer );
+    if( result != paNoError )
+        goto error;
+
+    bp->channelMixer = mixer;
+
+    /* likewise for the mixing */
+    bp->callbackStage = paUtilOtherCpuLoadStage;
+    mixer->userBufferProcessor.stageMeasurer = &bp->cpuLoadMeasurer;
+    bp->taps = mixer->userBufferProcessor.taps;
+    bp->streamTaps = 0;
+    mixer->userBufferProcessor.streamTaps = &bp->taps;
+
+    return result;
+
+error:
+    TerminateChannelMixer( mixer, userBufferProcessorInitialized );
+
+    return result;
+}
+
+
+void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bp )
+{
+    PaUtil_SetBufferProcessorWorkerPool( bp, 0 );
+
+    if( bp->sampleRateConverter )
+    {
+        TerminateSampleRateConverter( bp->sampleRateConverter, 1 );
+        bp->sampleRateConverter = 0;
+    }
+
+    if( bp->channelMixer )
+    {
+        TerminateChannelMixer( bp->channelMixer, 1 );
+        bp->channelMixer = 0;
+    }
+
+    if( bp->allocations )
+    {
+        PaUtil_FreeAllAllocations( bp->allocations );
+        PaUtil_DestroyAllocationGroup( bp->allocations );
+        bp->allocations = 0;
+    }
+    bp->levelMeter = 0;
+    bp->silentOutputChannels.channelCount = 0;
+    bp->silentOutputChannels.silent = 0;
+    bp->zeroedHostOutput = 0;
+    bp->outputGain.channelCount = 0;
+    bp->outputGain.settings = 0;
+    bp->gainRamps = 0;
+
+    PaUtil_TerminateStreamTaps( &bp->taps );
+}
+
+
+void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bp )
+{
+    unsigned long tempInputBufferSize, tempOutputBufferSize;
+
+    bp->framesInTempInputBuffer = bp->initialFramesInTempInputBuffer;
+    bp->framesInTempOutputBuffer = bp->initialFramesInTempOutputBuffer;
+
+    if( bp->framesInTempInputBuffer > 0 )
+    {
+        tempInputBufferSize =
+            bp->framesPerTempBuffer * bp->bytesPerUserInputSample * bp->inputChannelCount;
+        memset( bp->tempInputBuffer, 0, tempInputBufferSize );
+    }
+
+    if( bp->framesInTempOutputBuffer > 0 )
+    {      
+        tempOutputBufferSize =
+            bp->framesPerTempBuffer * bp->bytesPerUserOutputSample * bp->outputChannelCount;
+        memset( bp->tempOutputBuffer, 0, tempOutputBufferSize );
+    }
+
+    if( bp->noiseShapedDitherGenerators )
+    {
+        unsigned int i;
+        for( i=0; i<bp->outputChannelCount; ++i )
+        {
+            bp->noiseShapedDitherGenerators[i].error1 = 0.0f;
+            bp->noiseShapedDitherGenerators[i].error2 = 0.0f;
+        }
+    }
+
+    if( bp->sampleRateConverter )
+        ResetSampleRateConverter( bp->sampleRateConverter );
+
+    if( bp->channelMixer )
+        PaUtil_ResetBufferProcessor( &bp->channelMixer->userBufferProcessor );
+
+    if( bp->levelMeter )
+        PaUtil_ResetLevelMeter( bp->levelMeter );
+
+    if( bp->zeroedHostOutput )
+    {
+        /* the host API may hand out buffers which haven't been zeroed */
+        unsigned int i;
+        for( i=0; i<bp->outputChannelCount; ++i )
+            bp->zeroedHostOutput[i].bufferCount = 0;
+    }
+
+    if( bp->gainRamps )
+    {
+        /* ramps in progress end at their gains */
+        unsigned int i;
+        for( i=0; i<=bp->outputGain.channelCount; ++i )
+        {
+            bp->gainRamps[i].gain = bp->gainRamps[i].target;
+            bp->gainRamps[i].framesLeft = 0;
+        }
+    }
+
+    if( bp->recordsStatistics )
+    {
+        PaUtil_ResetStreamStatistics( &bp->statistics );
+        PaUtil_ResetTimeFilter( &bp->inputTimeFilter );
+        PaUtil_ResetTimeFilter( &bp->outputTimeFilter );
+        PaUtil_ResetStreamClock( &bp->clock );
+        PaUtil_ResetCpuLoadMeasurer( &bp->cpuLoadMeasurer );
+        bp->hostFramesProcessed = 0.;
+    }
+
+    bp->paused = 0;
+    bp->startTime = bp->requestedStartTime;
+    bp->requestedStartTime = 0.;
+}
+
+
+void PaUtil_SetBufferProcessorPaused( PaUtilBufferProcessor* bp, int paused )
+{
+    bp->paused = paused;
+}
+
+
+void PaUtil_SetBufferProcessorStartTime( PaUtilBufferProcessor* bp, PaTime startTime )
+{
+    bp->requestedStartTime = startTime;
+}
+
+
+unsigned long PaUtil_GetBatchedFramesPerUserBuffer( PaStreamFlags streamFlags,
+        unsigned long framesPerUserBuffer, unsigned long framesPerHostBuffer )
+{
+    if( !(streamFlags & paBatchCallbacks) || framesPerUserBuffer == paFramesPerBufferUnspecified
+            || framesPerHostBuffer == 0 )
+        return framesPerUserBuffer;
+
+    return ((framesPerUserBuffer + framesPerHostBuffer - 1) / framesPerHostBuffer) * framesPerHostBuffer;
+}
+
+
+unsigned long PaUtil_GetBufferProcessorInputLatencyFrames( PaUtilBufferProcessor* bp )
+{
+    PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+
+    if( src )
+    {
+        /* the host side doesn't adapt buffer sizes and adds no latency */
+        return (unsigned long)ceil( PaUtil_GetResamplerLatency( &src->inputResampler ) * src->userSampleRate )
+                + src->initialFramesInInputBuffer
+                + PaUtil_GetBufferProcessorInputLatencyFrames( &src->userBufferProcessor );
+    }
+
+    if( bp->channelMixer )
+        return PaUtil_GetBufferProcessorInputLatencyFrames( &bp->channelMixer->userBufferProcessor );
+
+    return bp->initialFramesInTempInputBuffer + bp->inputBatchingLatencyFrames;
+}
+
+
+unsigned long PaUtil_GetBufferProcessorOutputLatencyFrames( PaUtilBufferProcessor* bp )
+{
+    PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+
+    if( src )
+    {
+        return (unsigned long)ceil( PaUtil_GetResamplerLatency( &src->outputResampler ) * src->userSampleRate )
+                + PaUtil_GetBufferProcessorOutputLatencyFrames( &src->userBufferProcessor );
+    }
+
+    if( bp->channelMixer )
+        return PaUtil_GetBufferProcessorOutputLatencyFrames( &bp->channelMixer->userBufferProcessor );
+
+    return bp->initialFramesInTempOutputBuffer;
+}
+
+
+PaUtilStreamStatistics* PaUtil_GetBufferProcessorStatistics( PaUtilBufferProcessor* bp )
+{
+    return &bp->statistics;
+}
+
+
+const PaUtilStreamClock* PaUtil_GetBufferProcessorClock( PaUtilBufferProcessor* bp )
+{
+    return &bp->clock;
+}
+
+
+PaUtilStreamTaps* PaUtil_GetBufferProcessorTaps( PaUtilBufferProcessor* bp )
+{
+    return &bp->taps;
+}
+
+
+PaUtilLevelMeter* PaUtil_GetBufferProcessorLevelMeter( PaUtilBufferProcessor* bp )
+{
+    if( bp->sampleRateConverter )
+        return bp->sampleRateConverter->userBufferProcessor.levelMeter;
+    if( bp->channelMixer )
+        return bp->channelMixer->userBufferProcessor.levelMeter;
+    return bp->levelMeter;
+}
+
+
+PaUtilSilentChannels* PaUtil_GetBufferProcessorSilentOutputChannels( PaUtilBufferProcessor* bp )
+{
+    if( bp->sampleRateConverter )
+        return PaUtil_GetBufferProcessorSilentOutputChannels( &bp->sampleRateConverter->userBufferProcessor );
+    if( bp->channelMixer )
+        return PaUtil_GetBufferProcessorSilentOutputChannels( &bp->channelMixer->userBufferProcessor );
+    return ( bp->outputChannelCount != 0 ) ? &bp->silentOutputChannels : 0;
+}
+
+
+PaUtilOutputGain* PaUtil_GetBufferProcessorOutputGain( PaUtilBufferProcessor* bp )
+{
+    if( bp->sampleRateConverter )
+        return PaUtil_GetBufferProcessorOutputGain( &bp->sampleRateConverter->userBufferProcessor );
+    if( bp->channelMixer )
+        return PaUtil_GetBufferProcessorOutputGain( &bp->channelMixer->userBufferProcessor );
+    return ( bp->outputGain.settings != 0 ) ? &bp->outputGain : 0;
+}
+
+
+void PaUtil_SetBufferProcessorPersistentHostOutput( PaUtilBufferProcessor* bp )
+{
+    bp->hostOutputPersists = 1;
+}
+
+
+PaError PaUtil_SetSilentChannel( PaUtilSilentChannels *channels, int channel, int silent )
+{
+    if( channel < 0 || (unsigned int)channel >= channels->channelCount )
+        return paInvalidChannelCount;
+
+    channels->silent[channel] = (unsigned char)( silent ? 1 : 0 );
+    if( silent )
+        channels->used = 1;
+    return paNoError;
+}
+
+
+PaError PaUtil_SetOutputGain( PaUtilOutputGain *gains, int channel, float gain, double rampTime )
+{
+    PaUtilGainSetting *setting;
+
+    if( channel < -1 || channel >= (int)gains->channelCount )
+        return paInvalidChannelCount;
+
+    setting = &gains->settings[ channel == -1 ? gains->channelCount : (unsigned int)channel ];
+
+    setting->sequence++;
+    PaUtil_WriteMemoryBarrier();
+
+    setting->gain = gain;
+    setting->rampTime = ( rampTime > 0. ) ? rampTime : 0.;
+
+    PaUtil_WriteMemoryBarrier();
+    setting->sequence++;
+
+    gains->used = 1;
+    return paNoError;
+}
+
+
+long PaUtil_GetBufferProcessorMemoryUsage( PaUtilBufferProcessor* bp )
+{
+    PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+    PaUtilChannelMixer *mixer = bp->channelMixer;
+    long result = 0;
+
+    if( bp->allocations )
+        result += PaUtil_GetAllocationGroupMemoryUsage( bp->allocations );
+
+    result += PaUtil_GetStreamTapsMemoryUsage( &bp->taps );
+
+    if( bp->workerDitherGenerators )
+        result += (PaUtil_GetWorkerPoolSize( bp->workerPool ) - 1)
+                * (long)sizeof(PaUtilTriangularDitherGenerator);
+
+    if( src )
+    {
+        result += (long)sizeof(PaUtilSampleRateConverter)
+                + PaUtil_GetBufferProcessorMemoryUsage( &src->userBufferProcessor )
+                + PaUtil_GetResamplerMemoryUsage( &src->inputResampler )
+                + PaUtil_GetResamplerMemoryUsage( &src->outputResampler );
+
+        if( src->inputBuffer )
+            result += (long)(src->inputBufferFrames * bp->inputChannelCount * sizeof(float));
+
+        if( src->outputBuffer )
+            result += (long)(src->outputBufferFrames * bp->outputChannelCount * sizeof(float));
+
+        if( src->independentClocks )
+        {
+            result += PaUtil_GetBufferProcessorMemoryUsage( &src->inputHostProcessor )
+                    + PaUtil_GetBufferProcessorMemoryUsage( &src->outputHostProcessor );
+        }
+    }
+
+    if( mixer )
+    {
+        result += (long)sizeof(PaUtilChannelMixer)
+                + PaUtil_GetBufferProcessorMemoryUsage( &mixer->userBufferProcessor )
+                + PaUtil_GetChannelMatrixMemoryUsage( &mixer->inputMatrix )
+                + PaUtil_GetChannelMatrixMemoryUsage( &mixer->outputMatrix )
+                + (long)(sizeof(float) * PA_FRAMES_PER_MIXING_CHUNK_
+                    * (mixer->userBufferProcessor.inputChannelCount
+                        + mixer->userBufferProcessor.outputChannelCount))
+                + (long)(2 * sizeof(float*) * (mixer->userBufferProcessor.inputChannelCount
+                        + mixer->userBufferProcessor.outputChannelCount));
+    }
+
+    return result;
+}
+
+
+PaError PaUtil_SetBufferProcessorWorkerPool( PaUtilBufferProcessor* bp,
+        PaUtilWorkerPool *pool )
+{
+    PaError result = paNoError;
+    int i, workerCount = pool ? PaUtil_GetWorkerPoolSize( pool ) : 1;
+
+    if( bp->workerDitherGenerators )
+    {
+        PaUtil_FreeMemory( bp->workerDitherGenerators );
+        bp->workerDitherGenerators = 0;
+    }
+    bp->workerPool = 0;
+
+    if( workerCount > 1 )
+    {
+        /* worker 0 is the calling thread, which keeps using bp->ditherGenerator */
+        bp->workerDitherGenerators = (PaUtilTriangularDitherGenerator*)
+                PaUtil_AllocateMemory( (workerCount - 1) * sizeof(PaUtilTriangularDitherGenerator) );
+        if( !bp->workerDitherGenerators )
+            return paInsufficientMemory;
+
+        /* seeded apart like the noise shaped dither of different channels */
+        for( i=0; i<workerCount - 1; ++i )
+        {
+            PaUtil_InitializeTriangularDitherState( &bp->workerDitherGenerators[i] );
+            bp->workerDitherGenerators[i].randSeed1 += (i + 1) * 0x9E3779B9U;
+            bp->workerDitherGenerators[i].randSeed2 += (i + 1) * 0x7F4A7C15U;
+        }
+        bp->workerPool = pool;
+    }
+
+    if( bp->sampleRateConverter )
+    {
+        PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+
+        result = PaUtil_SetBufferProcessorWorkerPool( &src->userBufferProcessor, pool );
+        if( result == paNoError && src->independentClocks )
+        {
+            result = PaUtil_SetBufferProcessorWorkerPool( &src->inputHostProcessor, pool );
+            if( result == paNoError )
+                result = PaUtil_SetBufferProcessorWorkerPool( &src->outputHostProcessor, pool );
+        }
+    }
+
+    if( bp->channelMixer && result == paNoError )
+        result = PaUtil_SetBufferProcessorWorkerPool( &bp->channelMixer->userBufferProcessor, pool );
+
+    return result;
+}
+
+
+void PaUtil_PlaceBufferProcessor( PaUtilBufferProcessor* bp, const int *cpus, int cpuCount )
+{
+    if( bp->allocations )
+        PaUtil_PlaceAllocationGroup( bp->allocations, cpus, cpuCount );
+
+    if( bp->sampleRateConverter )
+    {
+        PaUtilSampleRateConverter *src = bp->sampleRateConverter;
+
+        PaUtil_PlaceBufferProcessor( &src->userBufferProcessor, cpus, cpuCount );
+        if( src->independentClocks )
+        {
+            PaUtil_PlaceBufferProcessor( &src->inputHostProcessor, cpus, cpuCount );
+            PaUtil_PlaceBufferProcessor( &src->outputHostProcessor, cpus, cpuCount );
+        }
+    }
+
+    if( bp->channelMixer )
+        PaUtil_PlaceBufferProcessor( &bp->channelMixer->userBufferProcessor, cpus, cpuCount );
+}
+
+
+void PaUtil_SetInputFrameCount( PaUtilBufferProcessor* bp,
+        unsigned long frameCount )
+{
+    if( frameCount == 0 )
+        bp->hostInputFrameCount[0] = bp->framesPerHostBuffer;
+    else
+        bp->hostInputFrameCount[0] = frameCount;
+}
+        
+
+void PaUtil_SetNoInput( PaUtilBufferProcessor* bp )
+{
+    assert( bp->inputChannelCount > 0 );
+
+    bp->hostInputChannels[0][0].data = 0;
+}
+
+
+void PaUtil_SetInputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data, unsigned int stride )
+{
+    assert( channel < bp->inputChannelCount );
+    
+    bp->hostInputChannels[0][channel].data = data;
+    bp->hostInputChannels[0][channel].stride = stride;
+}
+
+
+void PaUtil_SetInterleavedInputChannels( PaUtilBufferProcessor* bp,
+        unsigned int firstChannel, void *data, unsigned int channelCount )
+{
+    unsigned int i;
+    unsigned int channel = firstChannel;
+    unsigned char *p = (unsigned char*)data;
+
+    if( channelCount == 0 )
+        channelCount = bp->inputChannelCount;
+
+    assert( firstChannel < bp->inputChannelCount );
+    assert( firstChannel + channelCount <= bp->inputChannelCount );
+    assert( bp->hostInputIsInterleaved );
+
+    for( i=0; i< channelCount; ++i )
+    {
+        bp->hostInputChannels[0][channel+i].data = p;
+        p += bp->bytesPerHostInputSample;
+        bp->hostInputChannels[0][channel+i].stride = channelCount;
+    }
+}
+
+
+void PaUtil_SetSelectedInterleavedInputChannels( PaUtilBufferProcessor* bp,
+        void *data, unsigned int hostChannelCount, const int *channelSelectors )
+{
+    unsigned int i;
+
+    assert( bp->hostInputIsInterleaved );
+
+    for( i=0; i< bp->inputChannelCount; ++i )
+    {
+        assert( channelSelectors[i] >= 0 && (unsigned int)channelSelectors[i] < hostChannelCount );
+
+        bp->hostInputChannels[0][i].data =
+                (unsigned char*)data + channelSelectors[i] * bp->bytesPerHostInputSample;
+        bp->hostInputChannels[0][i].stride = hostChannelCount;
+    }
+}
+
+
+void PaUtil_SetNonInterleavedInputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data )
+{
+    assert( channel < bp->inputChannelCount );
+    assert( !bp->hostInputIsInterleaved );
+    
+    bp->hostInputChannels[0][channel].data = data;
+    bp->hostInputChannels[0][channel].stride = 1;
+}
+
+
+void PaUtil_Set2ndInputFrameCount( PaUtilBufferProcessor* bp,
+        unsigned long frameCount )
+{
+    bp->hostInputFrameCount[1] = frameCount;
+}
+
+
+void PaUtil_Set2ndInputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data, unsigned int stride )
+{
+    assert( channel < bp->inputChannelCount );
+
+    bp->hostInputChannels[1][channel].data = data;
+    bp->hostInputChannels[1][channel].stride = stride;
+}
+
+
+void PaUtil_Set2ndInterleavedInputChannels( PaUtilBufferProcessor* bp,
+        unsigned int firstChannel, void *data, unsigned int channelCount )
+{
+    unsigned int i;
+    unsigned int channel = firstChannel;
+    unsigned char *p = (unsigned char*)data;
+
+    if( channelCount == 0 )
+        channelCount = bp->inputChannelCount;
 
     assert( firstChannel < bp->inputChannelCount );
     assert( firstChannel + channelCount <= bp->inputChannelCount );
     assert( bp->hostInputIsInterleaved );
+    
+    for( i=0; i< channelCount; ++i )
+    {
+        bp->hostInputChannels[1][channel+i].data = p;
+        p += bp->bytesPerHostInputSample;
+        bp->hostInputChannels[1][channel+i].stride = channelCount;
+    }
+}
+
+        
+void PaUtil_Set2ndSelectedInterleavedInputChannels( PaUtilBufferProcessor* bp,
+        void *data, unsigned int hostChannelCount, const int *channelSelectors )
+{
+    unsigned int i;
+
+    assert( bp->hostInputIsInterleaved );
+
+    for( i=0; i< bp->inputChannelCount; ++i )
+    {
+        assert( channelSelectors[i] >= 0 && (unsigned int)channelSelectors[i] < hostChannelCount );
+
+        bp->hostInputChannels[1][i].data =
+                (unsigned char*)data + channelSelectors[i] * bp->bytesPerHostInputSample;
+        bp->hostInputChannels[1][i].stride = hostChannelCount;
+    }
+}
+
+
+void PaUtil_Set2ndNonInterleavedInputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data )
+{
+    assert( channel < bp->inputChannelCount );
+    assert( !bp->hostInputIsInterleaved );
+    
+    bp->hostInputChannels[1][channel].data = data;
+    bp->hostInputChannels[1][channel].stride = 1;
+}
+
+
+void PaUtil_SetOutputFrameCount( PaUtilBufferProcessor* bp,
+        unsigned long frameCount )
+{
+    if( frameCount == 0 )
+        bp->hostOutputFrameCount[0] = bp->framesPerHostBuffer;
+    else
+        bp->hostOutputFrameCount[0] = frameCount;
+}
+
+
+void PaUtil_SetNoOutput( PaUtilBufferProcessor* bp )
+{
+    assert( bp->outputChannelCount > 0 );
+
+    bp->hostOutputChannels[0][0].data = 0;
+
+    /* note that only NonAdaptingProcess is able to deal with no output at this stage. not implemented for AdaptingProcess */
+}
+
+
+void PaUtil_SetOutputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data, unsigned int stride )
+{
+    assert( channel < bp->outputChannelCount );
+    assert( data != NULL );
+
+    bp->hostOutputChannels[0][channel].data = data;
+    bp->hostOutputChannels[0][channel].stride = stride;
+}
+
+
+void PaUtil_SetInterleavedOutputChannels( PaUtilBufferProcessor* bp,
+        unsigned int firstChannel, void *data, unsigned int channelCount )
+{
+    unsigned int i;
+    unsigned int channel = firstChannel;
+    unsigned char *p = (unsigned char*)data;
+
+    if( channelCount == 0 )
+        channelCount = bp->outputChannelCount;
+
+    assert( firstChannel < bp->outputChannelCount );
+    assert( firstChannel + channelCount <= bp->outputChannelCount );
+    assert( bp->hostOutputIsInterleaved );
+    
+    for( i=0; i< channelCount; ++i )
+    {
+        PaUtil_SetOutputChannel( bp, channel + i, p, channelCount );
+        p += bp->bytesPerHostOutputSample;
+    }
+}
+
+
+void PaUtil_SetNonInterleavedOutputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data )
+{
+    assert( channel < bp->outputChannelCount );
+    assert( !bp->hostOutputIsInterleaved );
+
+    PaUtil_SetOutputChannel( bp, channel, data, 1 );
+}
+
+
+void PaUtil_Set2ndOutputFrameCount( PaUtilBufferProcessor* bp,
+        unsigned long frameCount )
+{
+    bp->hostOutputFrameCount[1] = frameCount;
+}
+
+
+void PaUtil_Set2ndOutputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data, unsigned int stride )
+{
+    assert( channel < bp->outputChannelCount );
+    assert( data != NULL );
+
+    bp->hostOutputChannels[1][channel].data = data;
+    bp->hostOutputChannels[1][channel].stride = stride;
+}
+
+
+void PaUtil_Set2ndInterleavedOutputChannels( PaUtilBufferProcessor* bp,
+        unsigned int firstChannel, void *data, unsigned int channelCount )
+{
+    unsigned int i;
+    unsigned int channel = firstChannel;
+    unsigned char *p = (unsigned char*)data;
+
+    if( channelCount == 0 )
+        channelCount = bp->outputChannelCount;
+
+    assert( firstChannel < bp->outputChannelCount );
+    assert( firstChannel + channelCount <= bp->outputChannelCount );
+    assert( bp->hostOutputIsInterleaved );
+    
+    for( i=0; i< channelCount; ++i )
+    {
+        PaUtil_Set2ndOutputChannel( bp, channel + i, p, channelCount );
+        p += bp->bytesPerHostOutputSample;
+    }
+}
+
+        
+void PaUtil_Set2ndNonInterleavedOutputChannel( PaUtilBufferProcessor* bp,
+        unsigned int channel, void *data )
+{
+    assert( channel < bp->outputChannelCount );
+    assert( !bp->hostOutputIsInterleaved );
+    
+    PaUtil_Set2ndOutputChannel( bp, channel, data, 1 );
+}
+
+
+/*
+    Smooth the host buffer's times, the filters are advanced by its frames
+    once they are known.
+*/
+static void FilterTimeInfo( PaUtilBufferProcessor *bp,
+        PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags callbackStatusFlags )
+{
+    if( callbackStatusFlags & (paInputUnderflow | paInputOverflow | paOutputUnderflow | paOutputOverflow) )
+    {
+        PaUtil_ResetTimeFilter( &bp->inputTimeFilter );
+        PaUtil_ResetTimeFilter( &bp->outputTimeFilter );
+    }
+
+    if( bp->inputChannelCount > 0 && timeInfo->inputBufferAdcTime != 0. )
+        timeInfo->inputBufferAdcTime = PaUtil_FilterTime( &bp->inputTimeFilter, timeInfo->inputBufferAdcTime );
+
+    if( bp->outputChannelCount > 0 && timeInfo->outputBufferDacTime != 0. )
+        timeInfo->outputBufferDacTime = PaUtil_FilterTime( &bp->outputTimeFilter, timeInfo->outputBufferDacTime );
+
+    PaUtil_RecordStreamSampleRate( &bp->statistics, PaUtil_GetTimeFilterSampleRate(
+            bp->outputChannelCount > 0 ? &bp->outputTimeFilter : &bp->inputTimeFilter ) );
+
+    bp->hostTimeInfo = *timeInfo;
+    bp->hostLocalTime = PaUtil_GetTime();
+}
+
+
+/*
+    Advance the filters by the frames of the host buffer whose times were
+    last filtered, and publish the clock for it. The position at the
+    currentTime is that of the frame at the DAC, or else of the frame
+    leaving the ADC.
+*/
+static void AdvanceStreamTime( PaUtilBufferProcessor *bp, unsigned long frameCount )
+{
+    PaStreamCallbackTimeInfo *timeInfo = &bp->hostTimeInfo;
+    PaTime streamTime = timeInfo->currentTime != 0. ? timeInfo->currentTime : bp->hostLocalTime;
+    double rate = PaUtil_GetTimeFilterSampleRate(
+            bp->outputChannelCount > 0 ? &bp->outputTimeFilter : &bp->inputTimeFilter ) * bp->samplePeriod;
+    double position = bp->hostFramesProcessed * bp->samplePeriod;
+
+    if( bp->outputChannelCount > 0 && timeInfo->outputBufferDacTime != 0. )
+        position -= (timeInfo->outputBufferDacTime - streamTime) * rate;
+    else if( bp->inputChannelCount > 0 && timeInfo->inputBufferAdcTime != 0. )
+        position += (streamTime - timeInfo->inputBufferAdcTime) * rate;
+
+    PaUtil_AdvanceTimeFilter( &bp->inputTimeFilter, frameCount );
+    PaUtil_AdvanceTimeFilter( &bp->outputTimeFilter, frameCount );
+
+    bp->hostFramesProcessed += frameCount;
+    PaUtil_PublishStreamClock( &bp->clock, bp->hostLocalTime, streamTime, position,
+            bp->hostFramesProcessed * bp->samplePeriod, rate );
+}
+
+
+int PaUtil_CanBypassBufferProcessor( PaUtilBufferProcessor* bp )
+{
+    /* the gains are only applied while converting the user output and the
+        silent channels zeroed after it, and a paused stream, like one before
+        its start time, is processed as after a callback returning paComplete */
+    return !bp->sampleRateConverter && !bp->channelMixer
+            && !bp->outputGain.used && !bp->silentOutputChannels.used
+            && !bp->paused && bp->startTime == 0.;
+}
+
+
+void PaUtil_BeginBufferProcessing( PaUtilBufferProcessor* bp,
+        PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags callbackStatusFlags )
+{
+    /* per buffer, host APIs may move the callback to another thread on restart */
+    if( bp->flushDenormals )
+        PaUtil_FlushDenormalsToZero();
+
+    /* the inner buffer processors get times the outer one has filtered */
+    if( bp->recordsStatistics )
+    {
+        PA_PROBE1( buffer_begin, callbackStatusFlags );
+        FilterTimeInfo( bp, timeInfo, callbackStatusFlags );
+    }
+
+    bp->timeInfo = timeInfo;
+
+    /* the first streamCallback will be called to process samples which are
+        currently in the input buffer before the ones starting at the timeInfo time */
+        
+    bp->timeInfo->inputBufferAdcTime -= bp->framesInTempInputBuffer * bp->samplePeriod;
+    
+    /* We just pass through timeInfo->currentTime provided by the caller. This is
+        not strictly conformant to the word of the spec, since the buffer processor 
+        might call the callback multiple times, and we never refresh currentTime. */
+
+    /* the first streamCallback will be called to generate samples which will be
+        outputted after the frames currently in the output buffer have been
+        outputted. */
+    bp->timeInfo->outputBufferDacTime += bp->framesInTempOutputBuffer * bp->samplePeriod;
+
+    bp->callbackStatusFlags = callbackStatusFlags;
+
+    bp->hostInputFrameCount[1] = 0;
+    bp->hostOutputFrameCount[1] = 0;
+}
 
-    for( i=0; i< channelCount; ++i )
+
+/*
+    Dither generator to pass to bp->outputConverter for the given output
+    channel. Noise shaped dither keeps error feedback state per channel,
+    otherwise the channels share ditherGenerator.
+*/
+static PaUtilTriangularDitherGenerator* OutputDitherGenerator( PaUtilBufferProcessor *bp,
+        unsigned int channel, PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    if( bp->noiseShapedDitherGenerators )
+        return &bp->noiseShapedDitherGenerators[channel].triangular;
+    else
+        return ditherGenerator;
+}
+
+
+/*
+    The host side of a conversion block is kept within this many bytes so
+    that it, together with the user side, stays in the L1 cache while all
+    channels of the block are converted.
+    Block lengths are a multiple of PA_CONVERSION_BLOCK_ALIGN_ frames so the
+    vector converters only see a partial vector at the end of a buffer.
+*/
+#define PA_CONVERSION_BLOCK_BYTES_  (16384)
+#define PA_CONVERSION_BLOCK_ALIGN_  (16)
+
+/*
+    Frames per converter call for ConvertInputChannels() and
+    ConvertOutputChannels(). With an interleaved host buffer and a
+    non-interleaved user buffer converting each channel over the whole
+    buffer walks the host buffer once per channel, so the channels are
+    converted a block of frames at a time instead. Other layouts are
+    converted in one call per channel.
+*/
+static unsigned long ConversionBlockFrames( unsigned int channelCount,
+        unsigned int hostStride, unsigned int bytesPerHostSample,
+        unsigned int userSampleStride, unsigned long frameCount )
+{
+    unsigned long blockFrames;
+
+    if( channelCount < 2 || hostStride < 2 || userSampleStride != 1 )
+        return frameCount;
+
+    blockFrames = PA_CONVERSION_BLOCK_BYTES_ / (hostStride * bytesPerHostSample);
+    blockFrames &= ~((unsigned long)PA_CONVERSION_BLOCK_ALIGN_ - 1);
+    if( blockFrames < PA_CONVERSION_BLOCK_ALIGN_ )
+        blockFrames = PA_CONVERSION_BLOCK_ALIGN_;
+
+    return blockFrames;
+}
+
+
+/*
+    A conversion of the channels of a host buffer to or from the user
+    buffer. Channel i of the user buffer starts at nonInterleavedUserPtrs[i],
+    or when that is NULL at userBytePtr + i * userChannelStrideBytes.
+*/
+typedef struct ConversionJob
+{
+    PaUtilBufferProcessor *bp;
+    PaUtilChannelDescriptor *hostChannels;
+    unsigned char *userBytePtr;
+    unsigned int userSampleStrideSamples;
+    unsigned int userChannelStrideBytes;
+    void **nonInterleavedUserPtrs;
+    unsigned long frameCount;
+    int workerCount;                    /* of the pool converting the channels, the rest idles */
+    int anySilent;                      /* of the output channels, see PaUtilZeroedHostOutput::silent */
+    int anyGain;                        /* of the output channels, see PaUtilGainRamp::unity */
+} ConversionJob;
+
+
+/*
+    With a worker pool, streams with at least this many channels per worker
+    are converted in parallel; handing out the job costs about as much as
+    converting a few channels of a typical host buffer.
+*/
+#define PA_PARALLEL_CONVERSION_MIN_CHANNELS_  (8)
+
+
+/*
+    Dither generator of a worker converting a range of the channels.
+*/
+static PaUtilTriangularDitherGenerator* WorkerDitherGenerator( PaUtilBufferProcessor *bp,
+        int worker )
+{
+    return worker == 0 ? &bp->ditherGenerator : &bp->workerDitherGenerators[worker - 1];
+}
+
+
+/*
+    Channels [firstChannel, endChannel) of channelCount converted by one of
+    workerCount workers, or 0 when it is not one of them.
+*/
+static int WorkerChannelRange( unsigned int channelCount, int worker, int workerCount,
+        unsigned int *firstChannel, unsigned int *endChannel )
+{
+    if( worker >= workerCount )
+        return 0;
+
+    *firstChannel = (unsigned int)(((unsigned long)channelCount * worker) / workerCount);
+    *endChannel = (unsigned int)(((unsigned long)channelCount * (worker + 1)) / workerCount);
+    return *firstChannel < *endChannel;
+}
+
+
+/*
+    The number of workers of the pool of bp to convert channelCount channels
+    with, 1 to convert them on the calling thread.
+*/
+static int ConversionWorkerCount( PaUtilBufferProcessor *bp, unsigned int channelCount )
+{
+    if( !bp->workerPool
+            || channelCount < 2 * PA_PARALLEL_CONVERSION_MIN_CHANNELS_ )
+        return 1;
+
+    return PA_MIN_( PaUtil_GetWorkerPoolSize( bp->workerPool ),
+            (int)(channelCount / PA_PARALLEL_CONVERSION_MIN_CHANNELS_) );
+}
+
+
+/*
+    Convert frameCount frames of input channels [firstChannel, endChannel)
+    from the host buffer of job into the user buffer and advance their host
+    channel pointers.
+*/
+static void ConvertInputChannelRange( const ConversionJob *job,
+        unsigned int firstChannel, unsigned int endChannel,
+        PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUtilBufferProcessor *bp = job->bp;
+    PaUtilChannelDescriptor *hostInputChannels = job->hostChannels;
+    unsigned long blockFrames = ConversionBlockFrames( endChannel - firstChannel,
+            hostInputChannels[0].stride, bp->bytesPerHostInputSample,
+            job->userSampleStrideSamples, job->frameCount );
+    unsigned long framesDone = 0;
+    unsigned int i;
+
+    while( framesDone < job->frameCount )
     {
-        bp->hostInputChannels[0][channel+i].data = p;
-        p += bp->bytesPerHostInputSample;
-        bp->hostInputChannels[0][channel+i].stride = channelCount;
+        unsigned long framesThisBlock = PA_MIN_( blockFrames, job->frameCount - framesDone );
+        unsigned long destOffsetBytes = framesDone * job->userSampleStrideSamples * bp->bytesPerUserInputSample;
+
+        for( i=firstChannel; i<endChannel; ++i )
+        {
+            unsigned char *dest = (job->nonInterleavedUserPtrs)
+                    ? (unsigned char*)job->nonInterleavedUserPtrs[i]
+                    : job->userBytePtr + i * job->userChannelStrideBytes;
+
+            bp->inputConverter( dest + destOffsetBytes, job->userSampleStrideSamples,
+                                    hostInputChannels[i].data,
+                                    hostInputChannels[i].stride,
+                                    framesThisBlock, ditherGenerator );
+
+            /* while the block is in the cache */
+            if( bp->levelMeter )
+                PaUtil_MeterChannel( bp->levelMeter, paStreamTapInput, i, dest + destOffsetBytes,
+                        job->userSampleStrideSamples, framesThisBlock );
+
+            /* advance src ptr for next iteration */
+            hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
+                    framesThisBlock * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
+        }
+
+        framesDone += framesThisBlock;
     }
 }
 
 
-void PaUtil_SetNonInterleavedInputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data )
+static void ConvertInputJob( void *userData, int worker, int workerCount )
 {
-    assert( channel < bp->inputChannelCount );
-    assert( !bp->hostInputIsInterleaved );
-    
-    bp->hostInputChannels[0][channel].data = data;
-    bp->hostInputChannels[0][channel].stride = 1;
+    const ConversionJob *job = (const ConversionJob*)userData;
+    unsigned int firstChannel, endChannel;
+
+    (void)workerCount; /* unused parameter */
+    if( WorkerChannelRange( job->bp->inputChannelCount, worker, job->workerCount, &firstChannel, &endChannel ) )
+        ConvertInputChannelRange( job, firstChannel, endChannel, WorkerDitherGenerator( job->bp, worker ) );
 }
 
 
-void PaUtil_Set2ndInputFrameCount( PaUtilBufferProcessor* bp,
+/*
+    Convert frameCount frames of all input channels from hostInputChannels
+    into the user buffer and advance the host channel pointers. Channel i of
+    the user buffer starts at nonInterleavedDestPtrs[i], or when that is NULL
+    at destBytePtr + i * destChannelStrideBytes.
+*/
+static void ConvertInputChannels( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostInputChannels,
+        unsigned char *destBytePtr, unsigned int destSampleStrideSamples,
+        unsigned int destChannelStrideBytes, void **nonInterleavedDestPtrs,
         unsigned long frameCount )
 {
-    bp->hostInputFrameCount[1] = frameCount;
+    ConversionJob job;
+    PaUtilCpuLoadStage previousStage;
+
+    job.bp = bp;
+    job.hostChannels = hostInputChannels;
+    job.userBytePtr = destBytePtr;
+    job.userSampleStrideSamples = destSampleStrideSamples;
+    job.userChannelStrideBytes = destChannelStrideBytes;
+    job.nonInterleavedUserPtrs = nonInterleavedDestPtrs;
+    job.frameCount = frameCount;
+    job.workerCount = ConversionWorkerCount( bp, bp->inputChannelCount );
+    job.anySilent = 0;
+    job.anyGain = 0;
+
+    previousStage = PaUtil_BeginCpuLoadStage( bp->stageMeasurer, paUtilInputConversionCpuLoadStage );
+    if( job.workerCount > 1 )
+        PaUtil_RunWorkerPool( bp->workerPool, ConvertInputJob, &job );
+    else
+        ConvertInputChannelRange( &job, 0, bp->inputChannelCount, &bp->ditherGenerator );
+
+    if( bp->levelMeter )
+        PaUtil_AdvanceLevelMeter( bp->levelMeter, paStreamTapInput, frameCount );
+    PaUtil_EndCpuLoadStage( bp->stageMeasurer, previousStage );
 }
 
 
-void PaUtil_Set2ndInputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data, unsigned int stride )
+/*
+    AdvanceGainRamp() takes a new setting of the gain index of outputGain, if
+    one was made, and advances its ramp by frameCount frames, returning the
+    ramp's gains at the start and the end of them.
+*/
+static void AdvanceGainRamp( PaUtilBufferProcessor *bp, unsigned int index,
+        unsigned long frameCount, float *startGain, float *endGain )
 {
-    assert( channel < bp->inputChannelCount );
+    PaUtilGainSetting *setting = &bp->outputGain.settings[index];
+    PaUtilGainRamp *ramp = &bp->gainRamps[index];
+    unsigned long sequence = setting->sequence;
 
-    bp->hostInputChannels[1][channel].data = data;
-    bp->hostInputChannels[1][channel].stride = stride;
+    if( !(sequence & 1) && sequence != ramp->sequence )
+    {
+        float target;
+        double rampTime;
+
+        PaUtil_ReadMemoryBarrier();
+        target = setting->gain;
+        rampTime = setting->rampTime;
+        PaUtil_ReadMemoryBarrier();
+
+        /* a setting being made is taken with the next buffer */
+        if( setting->sequence == sequence )
+        {
+            ramp->sequence = sequence;
+            ramp->target = target;
+            ramp->framesLeft = (unsigned long)(rampTime / bp->samplePeriod + .5);
+            if( ramp->framesLeft == 0 )
+                ramp->gain = target;
+            else
+                ramp->step = (target - ramp->gain) / (float)ramp->framesLeft;
+        }
+    }
+
+    *startGain = ramp->gain;
+    if( ramp->framesLeft > frameCount )
+    {
+        ramp->gain += ramp->step * (float)frameCount;
+        ramp->framesLeft -= frameCount;
+    }
+    else
+    {
+        /* the ramp ends within the buffer, which spreads its last part */
+        ramp->gain = ramp->target;
+        ramp->framesLeft = 0;
+    }
+    *endGain = ramp->gain;
 }
 
 
-void PaUtil_Set2ndInterleavedInputChannels( PaUtilBufferProcessor* bp,
-        unsigned int firstChannel, void *data, unsigned int channelCount )
+/*
+    TakeOutputGains() advances the gain ramps of the output channels by the
+    frameCount frames about to be converted and sets their blockGain and
+    blockStep. Returns non-zero if any channel is to be converted with a gain.
+*/
+static int TakeOutputGains( PaUtilBufferProcessor *bp, unsigned long frameCount )
 {
+    float streamStart, streamEnd, start, end;
+    int anyGain = 0;
     unsigned int i;
-    unsigned int channel = firstChannel;
-    unsigned char *p = (unsigned char*)data;
 
-    if( channelCount == 0 )
-        channelCount = bp->inputChannelCount;
+    if( !bp->outputGain.used || frameCount == 0 )
+        return 0;
 
-    assert( firstChannel < bp->inputChannelCount );
-    assert( firstChannel + channelCount <= bp->inputChannelCount );
-    assert( bp->hostInputIsInterleaved );
-    
-    for( i=0; i< channelCount; ++i )
+    AdvanceGainRamp( bp, bp->outputGain.channelCount, frameCount, &streamStart, &streamEnd );
+
+    for( i=0; i<bp->outputGain.channelCount; ++i )
     {
-        bp->hostInputChannels[1][channel+i].data = p;
-        p += bp->bytesPerHostInputSample;
-        bp->hostInputChannels[1][channel+i].stride = channelCount;
+        PaUtilGainRamp *ramp = &bp->gainRamps[i];
+
+        AdvanceGainRamp( bp, i, frameCount, &start, &end );
+        ramp->blockGain = start * streamStart;
+        ramp->blockStep = (end * streamEnd - ramp->blockGain) / (float)frameCount;
+        ramp->unity = ( ramp->blockGain == 1.f && ramp->blockStep == 0.f );
+        if( !ramp->unity )
+            anyGain = 1;
     }
+
+    return anyGain;
 }
 
-        
-void PaUtil_Set2ndNonInterleavedInputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data )
+
+/*
+    ConvertGainOutputChannel() converts frames [firstFrame, firstFrame +
+    frameCount) of the paFloat32 user output channel at src, multiplied by the
+    gain ramp of the channel, into dest. The frames are multiplied into a
+    block on the stack which the converter then reads contiguously, so the
+    gain costs a pass over the cached block and not a conversion of its own.
+*/
+static void ConvertGainOutputChannel( PaUtilBufferProcessor *bp, unsigned int channel,
+        void *dest, signed int destStride, const float *src, signed int srcStride,
+        unsigned long firstFrame, unsigned long frameCount,
+        PaUtilTriangularDitherGenerator *ditherGenerator )
 {
-    assert( channel < bp->inputChannelCount );
-    assert( !bp->hostInputIsInterleaved );
-    
-    bp->hostInputChannels[1][channel].data = data;
-    bp->hostInputChannels[1][channel].stride = 1;
+    const PaUtilGainRamp *ramp = &bp->gainRamps[channel];
+    float scaled[PA_GAIN_BLOCK_FRAMES_];
+    unsigned char *destBytePtr = (unsigned char*)dest;
+
+    while( frameCount > 0 )
+    {
+        unsigned long n = PA_MIN_( frameCount, (unsigned long)PA_GAIN_BLOCK_FRAMES_ );
+        float gain = ramp->blockGain + ramp->blockStep * (float)firstFrame;
+        float step = ramp->blockStep;
+        unsigned long j = 0;
+
+#ifdef PA_PROCESS_SSE2_
+        if( srcStride == 1 )
+        {
+            __m128 g = _mm_add_ps( _mm_set1_ps( gain ),
+                    _mm_mul_ps( _mm_set1_ps( step ), _mm_set_ps( 3.f, 2.f, 1.f, 0.f ) ) );
+            __m128 step4 = _mm_set1_ps( step * 4.f );
+
+            for( ; j + 4 <= n; j += 4 )
+            {
+                _mm_storeu_ps( &scaled[j], _mm_mul_ps( _mm_loadu_ps( &src[j] ), g ) );
+                g = _mm_add_ps( g, step4 );
+            }
+        }
+#endif
+        for( ; j < n; ++j )
+            scaled[j] = src[j * srcStride] * (gain + step * (float)j);
+
+        (*bp->gainOutputConverter)( destBytePtr, destStride, scaled, 1,
+                (unsigned int)n, OutputDitherGenerator( bp, channel, ditherGenerator ) );
+
+        destBytePtr += n * destStride * bp->bytesPerHostOutputSample;
+        src += n * srcStride;
+        firstFrame += n;
+        frameCount -= n;
+    }
+}
+
+
+/*
+    Convert frameCount frames of output channels [firstChannel, endChannel)
+    from the user buffer of job into its host buffer and advance their host
+    channel pointers.
+*/
+static void ZeroSilentOutputChannel( PaUtilBufferProcessor *bp, unsigned int channel,
+        PaUtilChannelDescriptor *hostOutputChannel, unsigned long frameCount );
+
+static void ConvertOutputChannelRange( const ConversionJob *job,
+        unsigned int firstChannel, unsigned int endChannel,
+        PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaUtilBufferProcessor *bp = job->bp;
+    PaUtilChannelDescriptor *hostOutputChannels = job->hostChannels;
+    unsigned long blockFrames = ConversionBlockFrames( endChannel - firstChannel,
+            hostOutputChannels[0].stride, bp->bytesPerHostOutputSample,
+            job->userSampleStrideSamples, job->frameCount );
+    unsigned long framesDone = 0;
+    unsigned int i;
+
+    if( job->anySilent )
+    {
+        for( i=firstChannel; i<endChannel; ++i )
+        {
+            if( bp->zeroedHostOutput[i].silent )
+                ZeroSilentOutputChannel( bp, i, &hostOutputChannels[i], job->frameCount );
+        }
+    }
+
+    while( framesDone < job->frameCount )
+    {
+        unsigned long framesThisBlock = PA_MIN_( blockFrames, job->frameCount - framesDone );
+        unsigned long srcOffsetBytes = framesDone * job->userSampleStrideSamples * bp->bytesPerUserOutputSample;
+
+        for( i=firstChannel; i<endChannel; ++i )
+        {
+            unsigned char *src;
+
+            if( job->anySilent && bp->zeroedHostOutput[i].silent )
+                continue;
+
+            src = (job->nonInterleavedUserPtrs)
+                    ? (unsigned char*)job->nonInterleavedUserPtrs[i]
+                    : job->userBytePtr + i * job->userChannelStrideBytes;
+
+            assert( hostOutputChannels[i].data != NULL );
+            if( bp->levelMeter )
+                PaUtil_MeterChannel( bp->levelMeter, paStreamTapOutput, i, src + srcOffsetBytes,
+                        job->userSampleStrideSamples, framesThisBlock );
+
+            if( job->anyGain && !bp->gainRamps[i].unity )
+                ConvertGainOutputChannel( bp, i, hostOutputChannels[i].data, hostOutputChannels[i].stride,
+                        (const float*)(src + srcOffsetBytes), job->userSampleStrideSamples,
+                        framesDone, framesThisBlock, ditherGenerator );
+            else
+                bp->outputConverter(    hostOutputChannels[i].data,
+                                        hostOutputChannels[i].stride,
+                                        src + srcOffsetBytes, job->userSampleStrideSamples,
+                                        framesThisBlock, OutputDitherGenerator( bp, i, ditherGenerator ) );
+
+            /* advance dest ptr for next iteration */
+            hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
+                    framesThisBlock * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
+        }
+
+        framesDone += framesThisBlock;
+    }
+}
+
+
+static void ConvertOutputJob( void *userData, int worker, int workerCount )
+{
+    const ConversionJob *job = (const ConversionJob*)userData;
+    unsigned int firstChannel, endChannel;
+
+    (void)workerCount; /* unused parameter */
+    if( WorkerChannelRange( job->bp->outputChannelCount, worker, job->workerCount, &firstChannel, &endChannel ) )
+        ConvertOutputChannelRange( job, firstChannel, endChannel, WorkerDitherGenerator( job->bp, worker ) );
+}
+
+
+/*
+    AdvanceHostChannels() moves the channel pointers frameCount frames on.
+*/
+static void AdvanceHostChannels( PaUtilChannelDescriptor *hostChannels,
+        unsigned int channelCount, unsigned int bytesPerHostSample, unsigned long frameCount )
+{
+    unsigned int i;
+
+    for( i=0; i<channelCount; ++i )
+    {
+        hostChannels[i].data = ((unsigned char*)hostChannels[i].data) +
+                frameCount * hostChannels[i].stride * bytesPerHostSample;
+    }
+}
+
+
+/*
+    ZeroHostOutputChannels() fills frameCount frames of the output channels
+    with silence and moves their pointers on. When the channels are those of
+    one interleaved host buffer, which is the case unless the host has more
+    channels than the stream, the frames are zeroed in one contiguous run.
+*/
+static void ZeroHostOutputChannels( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostOutputChannels, unsigned long frameCount )
+{
+    unsigned int i;
+    int contiguous = bp->outputChannelCount > 1
+            && hostOutputChannels[0].stride == bp->outputChannelCount;
+
+    for( i=1; contiguous && i<bp->outputChannelCount; ++i )
+    {
+        contiguous = hostOutputChannels[i].stride == bp->outputChannelCount
+                && (unsigned char*)hostOutputChannels[i].data ==
+                        (unsigned char*)hostOutputChannels[0].data + i * bp->bytesPerHostOutputSample;
+    }
+
+    if( contiguous )
+    {
+        bp->outputZeroer( hostOutputChannels[0].data, 1, frameCount * bp->outputChannelCount );
+    }
+    else
+    {
+        for( i=0; i<bp->outputChannelCount; ++i )
+            bp->outputZeroer( hostOutputChannels[i].data, hostOutputChannels[i].stride, frameCount );
+    }
+
+    AdvanceHostChannels( hostOutputChannels, bp->outputChannelCount, bp->bytesPerHostOutputSample, frameCount );
+}
+
+
+/*
+    ZeroSilentOutputChannel() zeroes frameCount frames of a silent output
+    channel, unless the host output persists and the same host buffer has been
+    zeroed since the channel went silent, and moves its pointer on.
+*/
+static void ZeroSilentOutputChannel( PaUtilBufferProcessor *bp, unsigned int channel,
+        PaUtilChannelDescriptor *hostOutputChannel, unsigned long frameCount )
+{
+    PaUtilZeroedHostOutput *zeroed = &bp->zeroedHostOutput[channel];
+    unsigned int i;
+
+    for( i=0; i<zeroed->bufferCount; ++i )
+    {
+        if( zeroed->buffers[i] == hostOutputChannel->data && zeroed->frameCounts[i] >= frameCount )
+            break;
+    }
+
+    if( i == zeroed->bufferCount )
+    {
+        bp->outputZeroer( hostOutputChannel->data, hostOutputChannel->stride, frameCount );
+
+        if( bp->hostOutputPersists && zeroed->bufferCount < PA_ZEROED_HOST_BUFFERS_ )
+        {
+            zeroed->buffers[zeroed->bufferCount] = hostOutputChannel->data;
+            zeroed->frameCounts[zeroed->bufferCount] = frameCount;
+            ++zeroed->bufferCount;
+        }
+    }
+
+    hostOutputChannel->data = ((unsigned char*)hostOutputChannel->data) +
+            frameCount * hostOutputChannel->stride * bp->bytesPerHostOutputSample;
+}
+
+
+/*
+    Take the silent flags of the output channels for the buffer about to be
+    converted, so that they don't change while the workers convert it, and
+    forget the host buffers zeroed for the channels which are active again.
+    Returns whether any channel is silent.
+*/
+static int TakeSilentOutputChannels( PaUtilBufferProcessor *bp )
+{
+    int anySilent = 0;
+    unsigned int i;
+
+    if( !bp->silentOutputChannels.used )
+        return 0;
+
+    for( i=0; i<bp->outputChannelCount; ++i )
+    {
+        PaUtilZeroedHostOutput *zeroed = &bp->zeroedHostOutput[i];
+
+        zeroed->silent = bp->silentOutputChannels.silent[i];
+        if( zeroed->silent )
+            anySilent = 1;
+        else
+            zeroed->bufferCount = 0;
+    }
+
+    return anySilent;
+}
+
+
+/*
+    ZeroSilentUserOutput() zeroes the silent channels of frameCount frames of
+    output which the stream callback wrote to the host buffer itself. userOutput
+    is what the callback got: the interleaved frames, or when the user buffer is
+    not interleaved the array of channel pointers, sampleStride samples apart.
+*/
+static void ZeroSilentUserOutput( PaUtilBufferProcessor *bp, void *userOutput,
+        int userIsInterleaved, unsigned int sampleStride, unsigned long frameCount )
+{
+    unsigned int i;
+
+    if( !TakeSilentOutputChannels( bp ) )
+        return;
+
+    for( i=0; i<bp->outputChannelCount; ++i )
+    {
+        if( bp->zeroedHostOutput[i].silent )
+        {
+            void *channel = (userIsInterleaved)
+                    ? (void*)((unsigned char*)userOutput + i * bp->bytesPerHostOutputSample)
+                    : ((void**)userOutput)[i];
+
+            bp->outputZeroer( channel, sampleStride, frameCount );
+            /* the host buffers hold what the callback wrote */
+            bp->zeroedHostOutput[i].bufferCount = 0;
+        }
+    }
 }
 
 
-void PaUtil_SetOutputFrameCount( PaUtilBufferProcessor* bp,
-        unsigned long frameCount )
+/*
+    Is every byte of the byteCount bytes at p silentByte? Leaves as soon as
+    one isn't, most buffers of a stream which isn't silent end the scan in
+    their first block.
+*/
+static int IsSilentBlock( const unsigned char *p, unsigned long byteCount, unsigned char silentByte )
 {
-    if( frameCount == 0 )
-        bp->hostOutputFrameCount[0] = bp->framesPerHostBuffer;
-    else
-        bp->hostOutputFrameCount[0] = frameCount;
-}
+#ifdef PA_PROCESS_SSE2_
+    const __m128i pattern = _mm_set1_epi8( (char)silentByte );
 
+    while( byteCount > 0 && ((size_t)p & 15) != 0 )
+    {
+        if( *p++ != silentByte )
+            return 0;
+        --byteCount;
+    }
 
-void PaUtil_SetNoOutput( PaUtilBufferProcessor* bp )
-{
-    assert( bp->outputChannelCount > 0 );
+    while( byteCount >= 64 )
+    {
+        __m128i difference = _mm_or_si128(
+                _mm_or_si128( _mm_xor_si128( _mm_load_si128( (const __m128i*)p ), pattern ),
+                        _mm_xor_si128( _mm_load_si128( (const __m128i*)(p + 16) ), pattern ) ),
+                _mm_or_si128( _mm_xor_si128( _mm_load_si128( (const __m128i*)(p + 32) ), pattern ),
+                        _mm_xor_si128( _mm_load_si128( (const __m128i*)(p + 48) ), pattern ) ) );
+
+        if( _mm_movemask_epi8( _mm_cmpeq_epi8( difference, _mm_setzero_si128() ) ) != 0xFFFF )
+            return 0;
+        p += 64;
+        byteCount -= 64;
+    }
+#else
+    const size_t pattern = silentByte * (((size_t)-1) / 0xFF);
 
-    bp->hostOutputChannels[0][0].data = 0;
+    while( byteCount > 0 && ((size_t)p & (sizeof(size_t) - 1)) != 0 )
+    {
+        if( *p++ != silentByte )
+            return 0;
+        --byteCount;
+    }
 
-    /* note that only NonAdaptingProcess is able to deal with no output at this stage. not implemented for AdaptingProcess */
-}
+    while( byteCount >= 4 * sizeof(size_t) )
+    {
+        const size_t *words = (const size_t*)p;
 
+        if( ((words[0] ^ pattern) | (words[1] ^ pattern) | (words[2] ^ pattern) | (words[3] ^ pattern)) != 0 )
+            return 0;
+        p += 4 * sizeof(size_t);
+        byteCount -= 4 * sizeof(size_t);
+    }
+#endif
 
-void PaUtil_SetOutputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data, unsigned int stride )
-{
-    assert( channel < bp->outputChannelCount );
-    assert( data != NULL );
+    while( byteCount > 0 )
+    {
+        if( *p++ != silentByte )
+            return 0;
+        --byteCount;
+    }
 
-    bp->hostOutputChannels[0][channel].data = data;
-    bp->hostOutputChannels[0][channel].stride = stride;
+    return 1;
 }
 
 
-void PaUtil_SetInterleavedOutputChannels( PaUtilBufferProcessor* bp,
-        unsigned int firstChannel, void *data, unsigned int channelCount )
+/*
+    Is the user output of a ConvertOutputChannels() call silent? Only
+    contiguous interleaved buffers and channel buffers are scanned, other
+    layouts are taken to be not silent.
+*/
+static int IsSilentUserOutput( PaUtilBufferProcessor *bp,
+        unsigned char *srcBytePtr, unsigned int srcSampleStrideSamples,
+        unsigned int srcChannelStrideBytes, void **nonInterleavedSrcPtrs,
+        unsigned long frameCount )
 {
+    unsigned long channelBytes = frameCount * bp->bytesPerUserOutputSample;
     unsigned int i;
-    unsigned int channel = firstChannel;
-    unsigned char *p = (unsigned char*)data;
 
-    if( channelCount == 0 )
-        channelCount = bp->outputChannelCount;
+    if( !nonInterleavedSrcPtrs && srcSampleStrideSamples == bp->outputChannelCount
+            && srcChannelStrideBytes == bp->bytesPerUserOutputSample )
+        return IsSilentBlock( srcBytePtr, channelBytes * bp->outputChannelCount, bp->silentOutputByte );
 
-    assert( firstChannel < bp->outputChannelCount );
-    assert( firstChannel + channelCount <= bp->outputChannelCount );
-    assert( bp->hostOutputIsInterleaved );
-    
-    for( i=0; i< channelCount; ++i )
+    if( srcSampleStrideSamples != 1 )
+        return 0;
+
+    for( i=0; i<bp->outputChannelCount; ++i )
     {
-        PaUtil_SetOutputChannel( bp, channel + i, p, channelCount );
-        p += bp->bytesPerHostOutputSample;
+        const unsigned char *src = (nonInterleavedSrcPtrs)
+                ? (const unsigned char*)nonInterleavedSrcPtrs[i]
+                : srcBytePtr + i * srcChannelStrideBytes;
+
+        if( !IsSilentBlock( src, channelBytes, bp->silentOutputByte ) )
+            return 0;
     }
+
+    return 1;
 }
 
 
-void PaUtil_SetNonInterleavedOutputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data )
+/*
+    Convert frameCount frames of all output channels from the user buffer
+    into hostOutputChannels and advance the host channel pointers. Channel i
+    of the user buffer starts at nonInterleavedSrcPtrs[i], or when that is
+    NULL at srcBytePtr + i * srcChannelStrideBytes.
+*/
+static void ConvertOutputChannels( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostOutputChannels,
+        unsigned char *srcBytePtr, unsigned int srcSampleStrideSamples,
+        unsigned int srcChannelStrideBytes, void **nonInterleavedSrcPtrs,
+        unsigned long frameCount )
 {
-    assert( channel < bp->outputChannelCount );
-    assert( !bp->hostOutputIsInterleaved );
+    ConversionJob job;
+    PaUtilCpuLoadStage previousStage;
+    /* ramps advance over silent buffers too */
+    int anyGain = TakeOutputGains( bp, frameCount );
 
-    PaUtil_SetOutputChannel( bp, channel, data, 1 );
-}
+    if( bp->skipSilentOutput && IsSilentUserOutput( bp, srcBytePtr, srcSampleStrideSamples,
+                srcChannelStrideBytes, nonInterleavedSrcPtrs, frameCount ) )
+    {
+        ZeroHostOutputChannels( bp, hostOutputChannels, frameCount );
+        if( bp->levelMeter )
+            PaUtil_AdvanceLevelMeter( bp->levelMeter, paStreamTapOutput, frameCount );
+        return;
+    }
 
+    job.bp = bp;
+    job.hostChannels = hostOutputChannels;
+    job.userBytePtr = srcBytePtr;
+    job.userSampleStrideSamples = srcSampleStrideSamples;
+    job.userChannelStrideBytes = srcChannelStrideBytes;
+    job.nonInterleavedUserPtrs = nonInterleavedSrcPtrs;
+    job.frameCount = frameCount;
+    job.workerCount = ConversionWorkerCount( bp, bp->outputChannelCount );
+    job.anySilent = TakeSilentOutputChannels( bp );
+    job.anyGain = anyGain;
+
+    previousStage = PaUtil_BeginCpuLoadStage( bp->stageMeasurer, paUtilOutputConversionCpuLoadStage );
+    if( job.workerCount > 1 )
+        PaUtil_RunWorkerPool( bp->workerPool, ConvertOutputJob, &job );
+    else
+        ConvertOutputChannelRange( &job, 0, bp->outputChannelCount, &bp->ditherGenerator );
 
-void PaUtil_Set2ndOutputFrameCount( PaUtilBufferProcessor* bp,
-        unsigned long frameCount )
-{
-    bp->hostOutputFrameCount[1] = frameCount;
+    if( bp->levelMeter )
+        PaUtil_AdvanceLevelMeter( bp->levelMeter, paStreamTapOutput, frameCount );
+    PaUtil_EndCpuLoadStage( bp->stageMeasurer, previousStage );
 }
 
 
-void PaUtil_Set2ndOutputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data, unsigned int stride )
+/*
+    IsIdentityBuffer() checks that the host buffers passed to NonAdaptingProcess()
+    can be handed to the streamCallback as they are: they were supplied, and
+    they hold exactly the user's channels. Some Alsa hw: devices have more host
+    channels than the user asked for, the stride tells. Output gains are only
+    applied while converting, once one was set the output is always converted.
+*/
+static int IsIdentityBuffer( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostInputChannels,
+        PaUtilChannelDescriptor *hostOutputChannels )
 {
-    assert( channel < bp->outputChannelCount );
-    assert( data != NULL );
+    if( bp->outputGain.used )
+        return 0;
 
-    bp->hostOutputChannels[1][channel].data = data;
-    bp->hostOutputChannels[1][channel].stride = stride;
+    if( bp->inputChannelCount != 0 && ( !hostInputChannels || !hostInputChannels[0].data
+            || hostInputChannels[0].stride != bp->inputChannelCount ) )
+        return 0;
+
+    if( bp->outputChannelCount != 0 && ( !hostOutputChannels || !hostOutputChannels[0].data
+            || hostOutputChannels[0].stride != bp->outputChannelCount ) )
+        return 0;
+
+    return 1;
 }
 
 
-void PaUtil_Set2ndInterleavedOutputChannels( PaUtilBufferProcessor* bp,
-        unsigned int firstChannel, void *data, unsigned int channelCount )
+/*
+    CallStreamCallback() calls the streamCallback with the current timeInfo
+    and status flags, charging the call to the callbackStage of the host
+    buffer's measurement, and publishes its buffers to the stream's taps.
+*/
+static int CallStreamCallback( PaUtilBufferProcessor *bp,
+        const void *userInput, void *userOutput, unsigned long frameCount )
 {
-    unsigned int i;
-    unsigned int channel = firstChannel;
-    unsigned char *p = (unsigned char*)data;
+    PaUtilCpuLoadStage previousStage;
+    int callbackResult;
 
-    if( channelCount == 0 )
-        channelCount = bp->outputChannelCount;
+    PA_PROBE2( callback_entry, frameCount, bp->callbackStatusFlags );
+    previousStage = PaUtil_BeginCpuLoadStage( bp->stageMeasurer, bp->callbackStage );
+    callbackResult = bp->streamCallback( userInput, userOutput, frameCount,
+            bp->timeInfo, bp->callbackStatusFlags, bp->userData );
+    PaUtil_EndCpuLoadStage( bp->stageMeasurer, previousStage );
+    PA_PROBE2( callback_return, frameCount, callbackResult );
 
-    assert( firstChannel < bp->outputChannelCount );
-    assert( firstChannel + channelCount <= bp->outputChannelCount );
-    assert( bp->hostOutputIsInterleaved );
-    
-    for( i=0; i< channelCount; ++i )
+    if( bp->streamTaps )
     {
-        PaUtil_Set2ndOutputChannel( bp, channel + i, p, channelCount );
-        p += bp->bytesPerHostOutputSample;
+        if( bp->inputChannelCount != 0 )
+            PaUtil_PublishStreamTap( bp->streamTaps, paStreamTapInput, userInput, frameCount );
+        if( bp->outputChannelCount != 0 && callbackResult != paAbort )
+            PaUtil_PublishStreamTap( bp->streamTaps, paStreamTapOutput, userOutput, frameCount );
     }
+
+    return callbackResult;
 }
 
-        
-void PaUtil_Set2ndNonInterleavedOutputChannel( PaUtilBufferProcessor* bp,
-        unsigned int channel, void *data )
+
+/*
+    MeterUserBuffer() meters frameCount frames of a host buffer which is passed
+    to the streamCallback without being converted. userBuffer is what the
+    callback gets: the interleaved frames, or when the user buffer is not
+    interleaved the array of channel pointers, sampleStride samples apart.
+*/
+static void MeterUserBuffer( PaUtilBufferProcessor *bp, PaStreamTapSource source,
+        const void *userBuffer, int userIsInterleaved, unsigned int channelCount,
+        unsigned int bytesPerSample, unsigned int sampleStride, unsigned long frameCount )
 {
-    assert( channel < bp->outputChannelCount );
-    assert( !bp->hostOutputIsInterleaved );
-    
-    PaUtil_Set2ndOutputChannel( bp, channel, data, 1 );
+    unsigned int i;
+
+    for( i=0; i<channelCount; ++i )
+    {
+        const void *samples = (userIsInterleaved)
+                ? (const void*)((const unsigned char*)userBuffer + i * bytesPerSample)
+                : ((void * const *)userBuffer)[i];
+
+        PaUtil_MeterChannel( bp->levelMeter, source, i, samples, sampleStride, frameCount );
+    }
+    PaUtil_AdvanceLevelMeter( bp->levelMeter, source, frameCount );
 }
 
 
-void PaUtil_BeginBufferProcessing( PaUtilBufferProcessor* bp,
-        PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags callbackStatusFlags )
+/*
+    IdentityProcess() is NonAdaptingProcess() for buffers accepted by
+    IsIdentityBuffer(): the host buffers are passed to the streamCallback
+    directly, without temp buffers and without a converter call per channel.
+    Only the first channel descriptor is used while processing, the others
+    are advanced once at the end like NonAdaptingProcess() does.
+*/
+static unsigned long IdentityProcess( PaUtilBufferProcessor *bp,
+        int *streamCallbackResult,
+        PaUtilChannelDescriptor *hostInputChannels,
+        PaUtilChannelDescriptor *hostOutputChannels,
+        unsigned long framesToProcess )
 {
-    bp->timeInfo = timeInfo;
+    unsigned char *userInput = 0, *userOutput = 0;
+    unsigned long bytesPerInputFrame = bp->inputChannelCount * bp->bytesPerHostInputSample;
+    unsigned long bytesPerOutputFrame = bp->outputChannelCount * bp->bytesPerHostOutputSample;
+    unsigned long frameCount;
+    unsigned long framesToGo = framesToProcess;
+    unsigned long framesProcessed = 0;
+    unsigned long inputFramesProcessed = 0;
 
-    /* the first streamCallback will be called to process samples which are
-        currently in the input buffer before the ones starting at the timeInfo time */
-        
-    bp->timeInfo->inputBufferAdcTime -= bp->framesInTempInputBuffer * bp->samplePeriod;
-    
-    /* We just pass through timeInfo->currentTime provided by the caller. This is
-        not strictly conformant to the word of the spec, since the buffer processor 
-        might call the callback multiple times, and we never refresh currentTime. */
+    if( bp->inputChannelCount != 0 )
+        userInput = (unsigned char *)hostInputChannels[0].data;
+    if( bp->outputChannelCount != 0 )
+        userOutput = (unsigned char *)hostOutputChannels[0].data;
 
-    /* the first streamCallback will be called to generate samples which will be
-        outputted after the frames currently in the output buffer have been
-        outputted. */
-    bp->timeInfo->outputBufferDacTime += bp->framesInTempOutputBuffer * bp->samplePeriod;
+    if( *streamCallbackResult == paContinue )
+    {
+        do
+        {
+            frameCount = PA_MIN_( bp->framesPerTempBuffer, framesToGo );
 
-    bp->callbackStatusFlags = callbackStatusFlags;
+            if( bp->levelMeter && userInput )
+                MeterUserBuffer( bp, paStreamTapInput, userInput, 1, bp->inputChannelCount,
+                        bp->bytesPerUserInputSample, bp->inputChannelCount, frameCount );
 
-    bp->hostInputFrameCount[1] = 0;
-    bp->hostOutputFrameCount[1] = 0;
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, frameCount );
+
+            /* the input has been consumed either way */
+            if( userInput )
+                userInput += frameCount * bytesPerInputFrame;
+            inputFramesProcessed += frameCount;
+
+            if( *streamCallbackResult == paAbort )
+            {
+                /* callback returned paAbort, don't advance framesProcessed
+                        and framesToGo, they will be handled below */
+            }
+            else
+            {
+                bp->timeInfo->inputBufferAdcTime += frameCount * bp->samplePeriod;
+                bp->timeInfo->outputBufferDacTime += frameCount * bp->samplePeriod;
+
+                if( userOutput )
+                {
+                    ZeroSilentUserOutput( bp, userOutput, 1, bp->outputChannelCount, frameCount );
+                    if( bp->levelMeter )
+                        MeterUserBuffer( bp, paStreamTapOutput, userOutput, 1, bp->outputChannelCount,
+                                bp->bytesPerUserOutputSample, bp->outputChannelCount, frameCount );
+                    userOutput += frameCount * bytesPerOutputFrame;
+                }
+
+                framesProcessed += frameCount;
+                framesToGo -= frameCount;
+            }
+        }
+        while( framesToGo > 0  && *streamCallbackResult == paContinue );
+    }
+
+    if( framesToGo > 0 )
+    {
+        /* zero any remaining frames output. There will only be remaining frames
+            if the callback has returned paComplete or paAbort */
+
+        if( userOutput )
+            bp->outputZeroer( userOutput, 1, framesToGo * bp->outputChannelCount );
+
+        framesProcessed += framesToGo;
+    }
+
+    /* advance the channel pointers for the next call */
+    AdvanceHostChannels( hostInputChannels, bp->inputChannelCount,
+            bp->bytesPerHostInputSample, inputFramesProcessed );
+    AdvanceHostChannels( hostOutputChannels, bp->outputChannelCount,
+            bp->bytesPerHostOutputSample, framesProcessed );
+
+    return framesProcessed;
 }
 
 
@@ -720,6 +3372,8 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
     int skipOutputConvert = 0;
     int skipInputConvert = 0;
 
+    if( bp->useIdentityProcess && IsIdentityBuffer( bp, hostInputChannels, hostOutputChannels ) )
+        return IdentityProcess( bp, streamCallbackResult, hostInputChannels, hostOutputChannels, framesToProcess );
 
     if( *streamCallbackResult == paContinue )
     {
@@ -798,6 +3452,11 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
 	            {
                     if( skipInputConvert )
                     {
+                        if( bp->levelMeter )
+                            MeterUserBuffer( bp, paStreamTapInput, userInput, bp->userInputIsInterleaved,
+                                    bp->inputChannelCount, bp->bytesPerUserInputSample,
+                                    hostInputChannels[0].stride, frameCount );
+
                         for( i=0; i<bp->inputChannelCount; ++i )
                         {
                             /* advance src ptr for next iteration */
@@ -807,19 +3466,8 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                     }
                     else
                     {
-                        for( i=0; i<bp->inputChannelCount; ++i )
-                        {
-                            bp->inputConverter( destBytePtr, destSampleStrideSamples,
-                                                    hostInputChannels[i].data,
-                                                    hostInputChannels[i].stride,
-                                                    frameCount, &bp->ditherGenerator );
-
-                            destBytePtr += destChannelStrideBytes;  /* skip to next destination channel */
-
-                            /* advance src ptr for next iteration */
-                            hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
-                                    frameCount * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
-                        }
+                        ConvertInputChannels( bp, hostInputChannels, destBytePtr, destSampleStrideSamples,
+                                destChannelStrideBytes, 0, frameCount );
                     }
                 }
             }
@@ -837,7 +3485,8 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                     /* process host buffer directly, or use temp buffer if formats differ or host buffer non-interleaved,
                      * or if num channels differs between the host (set in stride) and the user (eg with some Alsa hw:) */
                     if( bp->userOutputSampleFormatIsEqualToHost && bp->hostOutputIsInterleaved
-                          && bp->outputChannelCount == hostOutputChannels[0].stride )
+                          && bp->outputChannelCount == hostOutputChannels[0].stride
+                          && !bp->outputGain.used )
                     {
                         userOutput = hostOutputChannels[0].data;
                         skipOutputConvert = 1;
@@ -849,7 +3498,8 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                 }
                 else /* user output is not interleaved */
                 {
-                    if( bp->userOutputSampleFormatIsEqualToHost && !bp->hostOutputIsInterleaved )
+                    if( bp->userOutputSampleFormatIsEqualToHost && !bp->hostOutputIsInterleaved
+                            && !bp->outputGain.used )
                     {
                         for( i=0; i<bp->outputChannelCount; ++i )
                         {
@@ -870,8 +3520,7 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                 }
             }
         
-            *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                    frameCount, bp->timeInfo, bp->callbackStatusFlags, bp->userData );
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, frameCount );
 
             if( *streamCallbackResult == paAbort )
             {
@@ -889,6 +3538,13 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                 {
                     if( skipOutputConvert )
 					{
+                        ZeroSilentUserOutput( bp, userOutput, bp->userOutputIsInterleaved,
+                                hostOutputChannels[0].stride, frameCount );
+                        if( bp->levelMeter )
+                            MeterUserBuffer( bp, paStreamTapOutput, userOutput, bp->userOutputIsInterleaved,
+                                    bp->outputChannelCount, bp->bytesPerUserOutputSample,
+                                    hostOutputChannels[0].stride, frameCount );
+
 						for( i=0; i<bp->outputChannelCount; ++i )
                     	{
                         	/* advance dest ptr for next iteration */
@@ -912,19 +3568,8 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
                         	srcChannelStrideBytes = frameCount * bp->bytesPerUserOutputSample;
                     	}
 
-                    	for( i=0; i<bp->outputChannelCount; ++i )
-                    	{
-                        	bp->outputConverter(    hostOutputChannels[i].data,
-                                                	hostOutputChannels[i].stride,
-                                                	srcBytePtr, srcSampleStrideSamples,
-                                                	frameCount, &bp->ditherGenerator );
-
-                        	srcBytePtr += srcChannelStrideBytes;  /* skip to next source channel */
-
-                        	/* advance dest ptr for next iteration */
-                        	hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                                		frameCount * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-                    	}
+                    	ConvertOutputChannels( bp, hostOutputChannels, srcBytePtr, srcSampleStrideSamples,
+                    	        srcChannelStrideBytes, 0, frameCount );
 					}
                 }
              
@@ -945,16 +3590,7 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
 
         if( bp->outputChannelCount != 0 && bp->hostOutputChannels[0][0].data )
         {
-            for( i=0; i<bp->outputChannelCount; ++i )
-            {
-                bp->outputZeroer(   hostOutputChannels[i].data,
-                                    hostOutputChannels[i].stride,
-                                    frameCount );
-
-                /* advance dest ptr for next iteration */
-                hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                        frameCount * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-            }
+            ZeroHostOutputChannels( bp, hostOutputChannels, frameCount );
         }
 
         framesProcessed += frameCount;
@@ -964,10 +3600,38 @@ static unsigned long NonAdaptingProcess( PaUtilBufferProcessor *bp,
 }
 
 
+/*
+    HostInputIsUserInput() and HostOutputIsUserOutput() check whether the
+    host buffers are laid out the way the streamCallback expects its buffers,
+    so that a block of them can be passed to the callback in place of the
+    temporary buffer.
+*/
+static int HostInputIsUserInput( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostInputChannels )
+{
+    return bp->userInputSampleFormatIsEqualToHost
+            && bp->userInputIsInterleaved == bp->hostInputIsInterleaved
+            && hostInputChannels[0].data
+            && hostInputChannels[0].stride == ( bp->userInputIsInterleaved ? bp->inputChannelCount : 1 );
+}
+
+static int HostOutputIsUserOutput( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostOutputChannels )
+{
+    return bp->userOutputSampleFormatIsEqualToHost
+            && bp->userOutputIsInterleaved == bp->hostOutputIsInterleaved
+            && !bp->outputGain.used
+            && hostOutputChannels[0].data
+            && hostOutputChannels[0].stride == ( bp->userOutputIsInterleaved ? bp->outputChannelCount : 1 );
+}
+
+
 /*
     AdaptingInputOnlyProcess() is a half duplex input buffer processor. It
     converts data from the input buffers into the temporary input buffer,
     when the temporary input buffer is full, it calls the streamCallback.
+    A whole user buffer that can be used in place is passed to the
+    streamCallback directly instead.
 */
 static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
         int *streamCallbackResult,
@@ -987,6 +3651,43 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
 
     do
     {
+        if( bp->framesInTempInputBuffer == 0 && framesToGo >= bp->framesPerUserBuffer
+                && *streamCallbackResult == paContinue
+                && HostInputIsUserInput( bp, hostInputChannels ) )
+        {
+            frameCount = bp->framesPerUserBuffer;
+
+            if( bp->userInputIsInterleaved )
+            {
+                userInput = hostInputChannels[0].data;
+            }
+            else
+            {
+                for( i=0; i<bp->inputChannelCount; ++i )
+                    bp->tempInputBufferPtrs[i] = hostInputChannels[i].data;
+
+                userInput = bp->tempInputBufferPtrs;
+            }
+
+            if( bp->levelMeter )
+                MeterUserBuffer( bp, paStreamTapInput, userInput, bp->userInputIsInterleaved,
+                        bp->inputChannelCount, bp->bytesPerUserInputSample,
+                        hostInputChannels[0].stride, frameCount );
+
+            bp->timeInfo->outputBufferDacTime = 0;
+
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, frameCount );
+
+            bp->timeInfo->inputBufferAdcTime += frameCount * bp->samplePeriod;
+
+            AdvanceHostChannels( hostInputChannels, bp->inputChannelCount,
+                    bp->bytesPerHostInputSample, frameCount );
+
+            framesProcessed += frameCount;
+            framesToGo -= frameCount;
+            continue;
+        }
+
         frameCount = ( bp->framesInTempInputBuffer + framesToGo > bp->framesPerUserBuffer )
                 ? ( bp->framesPerUserBuffer - bp->framesInTempInputBuffer )
                 : framesToGo;
@@ -1022,19 +3723,8 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
             userInput = bp->tempInputBufferPtrs;
         }
 
-        for( i=0; i<bp->inputChannelCount; ++i )
-        {
-            bp->inputConverter( destBytePtr, destSampleStrideSamples,
-                                    hostInputChannels[i].data,
-                                    hostInputChannels[i].stride,
-                                    frameCount, &bp->ditherGenerator );
-
-            destBytePtr += destChannelStrideBytes;  /* skip to next destination channel */
-
-            /* advance src ptr for next iteration */
-            hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
-                    frameCount * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
-        }
+        ConvertInputChannels( bp, hostInputChannels, destBytePtr, destSampleStrideSamples,
+                destChannelStrideBytes, 0, frameCount );
 
         bp->framesInTempInputBuffer += frameCount;
 
@@ -1052,9 +3742,7 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
             {
                 bp->timeInfo->outputBufferDacTime = 0;
 
-                *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                        bp->framesPerUserBuffer, bp->timeInfo,
-                        bp->callbackStatusFlags, bp->userData );
+                *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
 
                 bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
             }
@@ -1075,6 +3763,8 @@ static unsigned long AdaptingInputOnlyProcess( PaUtilBufferProcessor *bp,
     AdaptingOutputOnlyProcess() is a half duplex output buffer processor.
     It converts data from the temporary output buffer, to the output buffers,
     when the temporary output buffer is empty, it calls the streamCallback.
+    If a whole user buffer fits into the output buffers and they can be used
+    in place, the streamCallback writes to them directly instead.
 */
 static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
         int *streamCallbackResult,
@@ -1092,6 +3782,49 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
 
     do
     {
+        if( bp->framesInTempOutputBuffer == 0 && framesToGo >= bp->framesPerUserBuffer
+                && *streamCallbackResult == paContinue
+                && HostOutputIsUserOutput( bp, hostOutputChannels ) )
+        {
+            if( bp->userOutputIsInterleaved )
+            {
+                userOutput = hostOutputChannels[0].data;
+            }
+            else
+            {
+                for( i = 0; i < bp->outputChannelCount; ++i )
+                    bp->tempOutputBufferPtrs[i] = hostOutputChannels[i].data;
+
+                userOutput = bp->tempOutputBufferPtrs;
+            }
+
+            bp->timeInfo->inputBufferAdcTime = 0;
+
+            *streamCallbackResult = CallStreamCallback( bp, 0, userOutput, bp->framesPerUserBuffer );
+
+            if( *streamCallbackResult != paAbort )
+            {
+                bp->timeInfo->outputBufferDacTime += bp->framesPerUserBuffer * bp->samplePeriod;
+
+                frameCount = bp->framesPerUserBuffer;
+                ZeroSilentUserOutput( bp, userOutput, bp->userOutputIsInterleaved,
+                        hostOutputChannels[0].stride, frameCount );
+                if( bp->levelMeter )
+                    MeterUserBuffer( bp, paStreamTapOutput, userOutput, bp->userOutputIsInterleaved,
+                            bp->outputChannelCount, bp->bytesPerUserOutputSample,
+                            hostOutputChannels[0].stride, frameCount );
+                AdvanceHostChannels( hostOutputChannels, bp->outputChannelCount,
+                        bp->bytesPerHostOutputSample, frameCount );
+
+                framesProcessed += frameCount;
+                framesToGo -= frameCount;
+                continue;
+            }
+
+            /* if the callback returned paAbort, we disregard its output,
+                it is zeroed below */
+        }
+
         if( bp->framesInTempOutputBuffer == 0 && *streamCallbackResult == paContinue )
         {
             userInput = 0;
@@ -1114,9 +3847,7 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
 
             bp->timeInfo->inputBufferAdcTime = 0;
             
-            *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                    bp->framesPerUserBuffer, bp->timeInfo,
-                    bp->callbackStatusFlags, bp->userData );
+            *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
 
             if( *streamCallbackResult == paAbort )
             {
@@ -1155,19 +3886,8 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
                 srcChannelStrideBytes = bp->framesPerUserBuffer * bp->bytesPerUserOutputSample;
             }
 
-            for( i=0; i<bp->outputChannelCount; ++i )
-            {
-                bp->outputConverter(    hostOutputChannels[i].data,
-                                        hostOutputChannels[i].stride,
-                                        srcBytePtr, srcSampleStrideSamples,
-                                        frameCount, &bp->ditherGenerator );
-
-                srcBytePtr += srcChannelStrideBytes;  /* skip to next source channel */
-
-                /* advance dest ptr for next iteration */
-                hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                        frameCount * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-            }
+            ConvertOutputChannels( bp, hostOutputChannels, srcBytePtr, srcSampleStrideSamples,
+                    srcChannelStrideBytes, 0, frameCount );
 
             bp->framesInTempOutputBuffer -= frameCount;
         }
@@ -1180,16 +3900,7 @@ static unsigned long AdaptingOutputOnlyProcess( PaUtilBufferProcessor *bp,
 
             frameCount = framesToGo;
 
-            for( i=0; i<bp->outputChannelCount; ++i )
-            {
-                bp->outputZeroer(   hostOutputChannels[i].data,
-                                    hostOutputChannels[i].stride,
-                                    frameCount );
-
-                /* advance dest ptr for next iteration */
-                hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                        frameCount * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-            }
+            ZeroHostOutputChannels( bp, hostOutputChannels, frameCount );
         }
         
         framesProcessed += frameCount;
@@ -1213,7 +3924,6 @@ static void CopyTempOutputBuffersToHostOutputBuffers( PaUtilBufferProcessor *bp)
     unsigned char *srcBytePtr;
     unsigned int srcSampleStrideSamples; /* stride from one sample to the next within a channel, in samples */
     unsigned int srcChannelStrideBytes; /* stride from one channel to the next, in bytes */
-    unsigned int i;
 
      /* copy frames from user to host output buffers */
      while( bp->framesInTempOutputBuffer > 0 &&
@@ -1252,20 +3962,8 @@ static void CopyTempOutputBuffersToHostOutputBuffers( PaUtilBufferProcessor *bp)
              srcChannelStrideBytes = bp->framesPerUserBuffer * bp->bytesPerUserOutputSample;
          }
 
-         for( i=0; i<bp->outputChannelCount; ++i )
-         {
-             assert( hostOutputChannels[i].data != NULL );
-             bp->outputConverter(    hostOutputChannels[i].data,
-                                     hostOutputChannels[i].stride,
-                                     srcBytePtr, srcSampleStrideSamples,
-                                     frameCount, &bp->ditherGenerator );
-
-             srcBytePtr += srcChannelStrideBytes;  /* skip to next source channel */
-
-             /* advance dest ptr for next iteration */
-             hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                     frameCount * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-         }
+         ConvertOutputChannels( bp, hostOutputChannels, srcBytePtr, srcSampleStrideSamples,
+                 srcChannelStrideBytes, 0, frameCount );
 
          if( bp->hostOutputFrameCount[0] > 0 )
              bp->hostOutputFrameCount[0] -= frameCount;
@@ -1276,6 +3974,141 @@ static void CopyTempOutputBuffersToHostOutputBuffers( PaUtilBufferProcessor *bp)
      }
 }
 
+/* CopyHostInputToTempInputBuffer is called from AdaptingProcess to convert frameCount
+    frames from hostInputChannels to the end of tempInputBuffer.
+*/
+static void CopyHostInputToTempInputBuffer( PaUtilBufferProcessor *bp,
+        PaUtilChannelDescriptor *hostInputChannels, unsigned long frameCount )
+{
+    unsigned char *destBytePtr;
+    unsigned int destSampleStrideSamples; /* stride from one sample to the next within a channel, in samples */
+    unsigned int destChannelStrideBytes; /* stride from one channel to the next, in bytes */
+
+    /* configure conversion destination pointers */
+    if( bp->userInputIsInterleaved )
+    {
+        destBytePtr = ((unsigned char*)bp->tempInputBuffer) +
+                bp->bytesPerUserInputSample * bp->inputChannelCount *
+                bp->framesInTempInputBuffer;
+
+        destSampleStrideSamples = bp->inputChannelCount;
+        destChannelStrideBytes = bp->bytesPerUserInputSample;
+    }
+    else /* user input is not interleaved */
+    {
+        destBytePtr = ((unsigned char*)bp->tempInputBuffer) +
+                bp->bytesPerUserInputSample * bp->framesInTempInputBuffer;
+
+        destSampleStrideSamples = 1;
+        destChannelStrideBytes = bp->framesPerUserBuffer * bp->bytesPerUserInputSample;
+    }
+
+    ConvertInputChannels( bp, hostInputChannels, destBytePtr, destSampleStrideSamples,
+            destChannelStrideBytes, 0, frameCount );
+
+    bp->framesInTempInputBuffer += frameCount;
+}
+
+/* CallAdaptingStreamCallback is called from AdaptingProcess when tempInputBuffer is full
+    and tempOutputBuffer is empty, to pass them to the streamCallback.
+*/
+static void CallAdaptingStreamCallback( PaUtilBufferProcessor *bp, int *streamCallbackResult )
+{
+    void *userInput, *userOutput;
+    unsigned int i;
+
+    /* setup userInput */
+    if( bp->userInputIsInterleaved )
+    {
+        userInput = bp->tempInputBuffer;
+    }
+    else /* user input is not interleaved */
+    {
+        for( i = 0; i < bp->inputChannelCount; ++i )
+        {
+            bp->tempInputBufferPtrs[i] = ((unsigned char*)bp->tempInputBuffer) +
+                    i * bp->framesPerUserBuffer * bp->bytesPerUserInputSample;
+        }
+
+        userInput = bp->tempInputBufferPtrs;
+    }
+
+    /* setup userOutput */
+    if( bp->userOutputIsInterleaved )
+    {
+        userOutput = bp->tempOutputBuffer;
+    }
+    else /* user output is not interleaved */
+    {
+        for( i = 0; i < bp->outputChannelCount; ++i )
+        {
+            bp->tempOutputBufferPtrs[i] = ((unsigned char*)bp->tempOutputBuffer) +
+                    i * bp->framesPerUserBuffer * bp->bytesPerUserOutputSample;
+        }
+
+        userOutput = bp->tempOutputBufferPtrs;
+    }
+
+    /* call streamCallback */
+
+    *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, bp->framesPerUserBuffer );
+
+    bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
+    bp->timeInfo->outputBufferDacTime += bp->framesPerUserBuffer * bp->samplePeriod;
+
+    bp->framesInTempInputBuffer = 0;
+
+    if( *streamCallbackResult == paAbort )
+        bp->framesInTempOutputBuffer = 0;
+    else
+        bp->framesInTempOutputBuffer = bp->framesPerUserBuffer;
+}
+
+/*
+    ScheduledAdaptingProcess is AdaptingProcess for a host buffer of exactly
+    framesPerHostBuffer frames in a single part, whose adaption is known from the
+    schedule entry. It calls the streamCallback callbackCount times without
+    checking that each user buffer fits, and returns early if the callback
+    returns anything but paContinue, leaving the rest to AdaptingProcess.
+*/
+static unsigned long ScheduledAdaptingProcess( PaUtilBufferProcessor *bp,
+        int *streamCallbackResult, unsigned long callbackCount )
+{
+    unsigned long framesProcessed = 0;
+    unsigned long frameCount;
+    unsigned long i;
+
+    /* Fill host output with remaining frames in user output (tempOutputBuffer) */
+    CopyTempOutputBuffersToHostOutputBuffers( bp );
+
+    for( i = 0; i < callbackCount; ++i )
+    {
+        frameCount = bp->framesPerUserBuffer - bp->framesInTempInputBuffer;
+
+        CopyHostInputToTempInputBuffer( bp, bp->hostInputChannels[0], frameCount );
+        bp->hostInputFrameCount[0] -= frameCount;
+        framesProcessed += frameCount;
+
+        CallAdaptingStreamCallback( bp, streamCallbackResult );
+
+        CopyTempOutputBuffersToHostOutputBuffers( bp );
+
+        if( *streamCallbackResult != paContinue )
+            return framesProcessed;
+    }
+
+    /* the start of the next user buffer */
+    frameCount = bp->hostInputFrameCount[0];
+    if( frameCount > 0 )
+    {
+        CopyHostInputToTempInputBuffer( bp, bp->hostInputChannels[0], frameCount );
+        bp->hostInputFrameCount[0] = 0;
+        framesProcessed += frameCount;
+    }
+
+    return framesProcessed;
+}
+
 /*
     AdaptingProcess is a full duplex adapting buffer processor. It converts
     data from the temporary output buffer into the host output buffers, then
@@ -1285,21 +4118,20 @@ static void CopyTempOutputBuffersToHostOutputBuffers( PaUtilBufferProcessor *bp)
     consumed and all available output space will be filled. When
     processPartialUserBuffers is non-zero, as many full user buffers
     as possible will be processed, but partial buffers will not be consumed.
+    Host buffers of a fixed size are adapted by ScheduledAdaptingProcess when
+    the schedule holds their state.
 */
 static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
         int *streamCallbackResult, int processPartialUserBuffers )
 {
-    void *userInput, *userOutput;
     unsigned long framesProcessed = 0;
     unsigned long framesAvailable;
     unsigned long endProcessingMinFrameCount;
     unsigned long maxFramesToCopy;
     PaUtilChannelDescriptor *hostInputChannels, *hostOutputChannels;
+    const PaUtilAdaptingScheduleEntry *scheduleEntry;
     unsigned int frameCount;
-    unsigned char *destBytePtr;
-    unsigned int destSampleStrideSamples; /* stride from one sample to the next within a channel, in samples */
-    unsigned int destChannelStrideBytes; /* stride from one channel to the next, in bytes */
-    unsigned int i, j;
+    unsigned int i;
  
 
     framesAvailable = bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1];/* this is assumed to be the same as the output buffer's frame count */
@@ -1309,8 +4141,30 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
     else
         endProcessingMinFrameCount = (bp->framesPerUserBuffer - 1);
 
-    /* Fill host output with remaining frames in user output (tempOutputBuffer) */
-    CopyTempOutputBuffersToHostOutputBuffers( bp );		  	
+    scheduleEntry = 0;
+    if( bp->adaptingSchedule && *streamCallbackResult == paContinue
+            && bp->hostInputFrameCount[0] == bp->framesPerHostBuffer
+            && bp->hostOutputFrameCount[0] == bp->framesPerHostBuffer
+            && bp->hostInputFrameCount[1] == 0 && bp->hostOutputFrameCount[1] == 0
+            && bp->framesInTempInputBuffer % bp->adaptingScheduleGranularity == 0 )
+    {
+        scheduleEntry = &bp->adaptingSchedule[ bp->framesInTempInputBuffer / bp->adaptingScheduleGranularity ];
+        if( !scheduleEntry->valid
+                || scheduleEntry->framesInTempOutputBuffer != bp->framesInTempOutputBuffer )
+            scheduleEntry = 0;
+    }
+
+    if( scheduleEntry )
+    {
+        framesProcessed = ScheduledAdaptingProcess( bp, streamCallbackResult,
+                scheduleEntry->callbackCount );
+        framesAvailable -= framesProcessed;
+    }
+    else
+    {
+        /* Fill host output with remaining frames in user output (tempOutputBuffer) */
+        CopyTempOutputBuffersToHostOutputBuffers( bp );
+    }
 
     while( framesAvailable > endProcessingMinFrameCount ) 
     {
@@ -1327,16 +4181,7 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
                 {
                     hostOutputChannels = bp->hostOutputChannels[i];
                     
-                    for( j=0; j<bp->outputChannelCount; ++j )
-                    {
-                        bp->outputZeroer(   hostOutputChannels[j].data,
-                                            hostOutputChannels[j].stride,
-                                            frameCount );
-
-                        /* advance dest ptr for next iteration  */
-                        hostOutputChannels[j].data = ((unsigned char*)hostOutputChannels[j].data) +
-                                frameCount * hostOutputChannels[j].stride * bp->bytesPerHostOutputSample;
-                    }
+                    ZeroHostOutputChannels( bp, hostOutputChannels, frameCount );
                     bp->hostOutputFrameCount[i] = 0;
                 }
             }
@@ -1361,45 +4206,12 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
                 frameCount = PA_MIN_( bp->hostInputFrameCount[1], maxFramesToCopy );
             }
 
-            /* configure conversion destination pointers */
-            if( bp->userInputIsInterleaved )
-            {
-                destBytePtr = ((unsigned char*)bp->tempInputBuffer) +
-                        bp->bytesPerUserInputSample * bp->inputChannelCount *
-                        bp->framesInTempInputBuffer;
-
-                destSampleStrideSamples = bp->inputChannelCount;
-                destChannelStrideBytes = bp->bytesPerUserInputSample;
-            }
-            else /* user input is not interleaved */
-            {
-                destBytePtr = ((unsigned char*)bp->tempInputBuffer) +
-                        bp->bytesPerUserInputSample * bp->framesInTempInputBuffer;
-
-                destSampleStrideSamples = 1;
-                destChannelStrideBytes = bp->framesPerUserBuffer * bp->bytesPerUserInputSample;
-            }
-
-            for( i=0; i<bp->inputChannelCount; ++i )
-            {
-                bp->inputConverter( destBytePtr, destSampleStrideSamples,
-                                        hostInputChannels[i].data,
-                                        hostInputChannels[i].stride,
-                                        frameCount, &bp->ditherGenerator );
-
-                destBytePtr += destChannelStrideBytes;  /* skip to next destination channel */
-
-                /* advance src ptr for next iteration */
-                hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
-                        frameCount * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
-            }
+            CopyHostInputToTempInputBuffer( bp, hostInputChannels, frameCount );
 
             if( bp->hostInputFrameCount[0] > 0 )
                 bp->hostInputFrameCount[0] -= frameCount;
             else
                 bp->hostInputFrameCount[1] -= frameCount;
-                
-            bp->framesInTempInputBuffer += frameCount;
 
             /* update framesAvailable and framesProcessed based on input consumed
                 unless something is very wrong this will also correspond to the
@@ -1414,53 +4226,7 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
         {
             if( *streamCallbackResult == paContinue )
             {
-                /* setup userInput */
-                if( bp->userInputIsInterleaved )
-                {
-                    userInput = bp->tempInputBuffer;
-                }
-                else /* user input is not interleaved */
-                {
-                    for( i = 0; i < bp->inputChannelCount; ++i )
-                    {
-                        bp->tempInputBufferPtrs[i] = ((unsigned char*)bp->tempInputBuffer) +
-                                i * bp->framesPerUserBuffer * bp->bytesPerUserInputSample;
-                    }
-
-                    userInput = bp->tempInputBufferPtrs;
-                }
-
-                /* setup userOutput */
-                if( bp->userOutputIsInterleaved )
-                {
-                    userOutput = bp->tempOutputBuffer;
-                }
-                else /* user output is not interleaved */
-                {
-                    for( i = 0; i < bp->outputChannelCount; ++i )
-                    {
-                        bp->tempOutputBufferPtrs[i] = ((unsigned char*)bp->tempOutputBuffer) +
-                                i * bp->framesPerUserBuffer * bp->bytesPerUserOutputSample;
-                    }
-
-                    userOutput = bp->tempOutputBufferPtrs;
-                }
-
-                /* call streamCallback */
-
-                *streamCallbackResult = bp->streamCallback( userInput, userOutput,
-                        bp->framesPerUserBuffer, bp->timeInfo,
-                        bp->callbackStatusFlags, bp->userData );
-
-                bp->timeInfo->inputBufferAdcTime += bp->framesPerUserBuffer * bp->samplePeriod;
-                bp->timeInfo->outputBufferDacTime += bp->framesPerUserBuffer * bp->samplePeriod;
-
-                bp->framesInTempInputBuffer = 0;
-
-                if( *streamCallbackResult == paAbort )
-                    bp->framesInTempOutputBuffer = 0;
-                else
-                    bp->framesInTempOutputBuffer = bp->framesPerUserBuffer;
+                CallAdaptingStreamCallback( bp, streamCallbackResult );
             }
             else
             {
@@ -1481,10 +4247,13 @@ static unsigned long AdaptingProcess( PaUtilBufferProcessor *bp,
 }
 
 
-unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *streamCallbackResult )
+static unsigned long EndBufferProcessing( PaUtilBufferProcessor* bp, int *streamCallbackResult )
 {
     unsigned long framesToProcess, framesToGo;
     unsigned long framesProcessed = 0;
+
+    if( bp->sampleRateConverter && bp->sampleRateConverter->independentClocks )
+        return EndIndependentClocksProcessing( bp, streamCallbackResult );
     
     if( bp->inputChannelCount != 0 && bp->outputChannelCount != 0
             && bp->hostInputChannels[0][0].data /* input was supplied (see PaUtil_SetNoInput) */
@@ -1653,8 +4422,218 @@ unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *stream
 }
 
 
+/* Remove the first frameCount frames from one direction's host buffers,
+   zeroing them first when zeroer isn't NULL. */
+static void SkipHostFrames( PaUtilChannelDescriptor **channels, unsigned long *frameCounts,
+        unsigned int channelCount, unsigned int bytesPerSample, PaUtilZeroer *zeroer,
+        unsigned long frameCount )
+{
+    unsigned long framesToSkip;
+    unsigned int i;
+
+    while( frameCount > 0 && frameCounts[0] > 0 )
+    {
+        framesToSkip = PA_MIN_( frameCount, frameCounts[0] );
+        for( i=0; i<channelCount; ++i )
+        {
+            PaUtilChannelDescriptor *channel = &channels[0][i];
+            if( !channel->data )
+                continue;
+            if( zeroer )
+                zeroer( channel->data, channel->stride, framesToSkip );
+            channel->data = (unsigned char*)channel->data + framesToSkip * channel->stride * bytesPerSample;
+        }
+        frameCounts[0] -= framesToSkip;
+        frameCount -= framesToSkip;
+
+        /* the second part of a split host buffer becomes the first */
+        if( frameCounts[0] == 0 && frameCounts[1] > 0 )
+        {
+            for( i=0; i<channelCount; ++i )
+                channels[0][i] = channels[1][i];
+            frameCounts[0] = frameCounts[1];
+            frameCounts[1] = 0;
+        }
+    }
+}
+
+
+/* Apply a start time set with PaUtil_SetBufferProcessorStartTime() to the host
+   buffer. Returns nonzero while the whole host buffer precedes the start time. */
+static int SkipFramesBeforeStart( PaUtilBufferProcessor* bp )
+{
+    PaTime bufferTime = bp->outputChannelCount > 0 ? bp->timeInfo->outputBufferDacTime
+            : bp->timeInfo->inputBufferAdcTime;
+    unsigned long hostFrameCount = bp->outputChannelCount > 0
+            ? bp->hostOutputFrameCount[0] + bp->hostOutputFrameCount[1]
+            : bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1];
+    double framesToStart = (bp->startTime - bufferTime) / bp->samplePeriod + .5;
+    unsigned long framesToSkip;
+
+    if( framesToStart >= (double)hostFrameCount )
+        return 1;
+
+    bp->startTime = 0.;
+    if( framesToStart < 1. )
+        return 0;
+
+    framesToSkip = (unsigned long)framesToStart;
+    if( bp->outputChannelCount > 0 )
+        SkipHostFrames( bp->hostOutputChannels, bp->hostOutputFrameCount, bp->outputChannelCount,
+                bp->bytesPerHostOutputSample, bp->outputZeroer, framesToSkip );
+    if( bp->inputChannelCount > 0 )
+        SkipHostFrames( bp->hostInputChannels, bp->hostInputFrameCount, bp->inputChannelCount,
+                bp->bytesPerHostInputSample, NULL, framesToSkip );
+
+    /* the callback's buffer starts at the start time */
+    bp->timeInfo->outputBufferDacTime += framesToSkip * bp->samplePeriod;
+    bp->timeInfo->inputBufferAdcTime += framesToSkip * bp->samplePeriod;
+    return 0;
+}
+
+unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bp, int *streamCallbackResult )
+{
+    unsigned long framesProcessed;
+    PaStreamCallbackFlags statusFlags = bp->callbackStatusFlags;
+    PaTime streamTime = bp->timeInfo->currentTime;
+    int pausedCallbackResult = paComplete;
+
+    /* the next host buffer's times follow all of this one's frames, including
+       those skipped before a start time */
+    if( bp->recordsStatistics )
+        AdvanceStreamTime( bp, bp->outputChannelCount > 0
+                ? bp->hostOutputFrameCount[0] + bp->hostOutputFrameCount[1]
+                : bp->hostInputFrameCount[0] + bp->hostInputFrameCount[1] );
+
+    /* while paused, process as after the callback returned paComplete: the
+       callback isn't called and the output is silent, but the stream's
+       result stays paContinue so the host keeps the device running */
+    if( bp->paused && *streamCallbackResult == paContinue )
+        streamCallbackResult = &pausedCallbackResult;
+
+    /* before a scheduled start, likewise */
+    if( bp->startTime != 0. && SkipFramesBeforeStart( bp ) && *streamCallbackResult == paContinue )
+        streamCallbackResult = &pausedCallbackResult;
+
+    if( !bp->recordsStatistics )
+        return EndBufferProcessing( bp, streamCallbackResult );
+
+    if( statusFlags & (paInputUnderflow | paInputOverflow | paOutputUnderflow | paOutputOverflow) )
+    {
+        PA_PROBE1( xrun, statusFlags );
+        PA_TRACE_INSTANT( paUtilTraceXrun, (long)statusFlags, 0 );
+    }
+
+    PA_TRACE_BEGIN( paUtilTraceBufferProcessing, 0, (long)statusFlags );
+    PaUtil_BeginCpuLoadMeasurement( &bp->cpuLoadMeasurer );
+    framesProcessed = EndBufferProcessing( bp, streamCallbackResult );
+    PaUtil_EndCpuLoadMeasurement( &bp->cpuLoadMeasurer, framesProcessed );
+    PaUtil_RecordStreamStatistics( &bp->statistics, bp->cpuLoadMeasurer.measurementStartTime,
+            PaUtil_GetTime(), framesProcessed, statusFlags, streamTime );
+    PaUtil_RecordStreamCpuLoad( &bp->statistics, &bp->cpuLoadMeasurer );
+    if( bp->outputChannelCount > 0 )
+        PaUtil_RecordStreamHeadroom( &bp->statistics, bp->hostTimeInfo.outputBufferDacTime, PaUtil_GetTime() );
+    PA_TRACE_END( paUtilTraceBufferProcessing, (long)framesProcessed, (long)statusFlags );
+    PA_PROBE2( buffer_end, framesProcessed, *streamCallbackResult );
+
+    return framesProcessed;
+}
+
+
+/*
+    Zero frameCount frames of a user output buffer, which is in the host's
+    sample format when the host buffer is passed to the callback directly.
+*/
+static void ZeroUserOutput( PaUtilBufferProcessor *bp, void *userOutput, unsigned long frameCount )
+{
+    unsigned int i;
+
+    if( bp->userOutputIsInterleaved )
+    {
+        bp->outputZeroer( userOutput, 1, frameCount * bp->outputChannelCount );
+    }
+    else
+    {
+        for( i=0; i<bp->outputChannelCount; ++i )
+            bp->outputZeroer( ((void**)userOutput)[i], 1, frameCount );
+    }
+}
+
+
+static void EndBufferProcessingDirectly( PaUtilBufferProcessor* bp,
+        const void *userInput, void *userOutput, unsigned long frameCount, int *streamCallbackResult )
+{
+    int outputWritten = 0;
+
+    if( *streamCallbackResult == paContinue )
+    {
+        if( bp->levelMeter && bp->inputChannelCount != 0 )
+            MeterUserBuffer( bp, paStreamTapInput, userInput, bp->userInputIsInterleaved,
+                    bp->inputChannelCount, bp->bytesPerUserInputSample,
+                    bp->userInputIsInterleaved ? bp->inputChannelCount : 1, frameCount );
+
+        *streamCallbackResult = CallStreamCallback( bp, userInput, userOutput, frameCount );
+        outputWritten = ( *streamCallbackResult != paAbort );
+
+        if( bp->levelMeter && bp->outputChannelCount != 0 && outputWritten )
+            MeterUserBuffer( bp, paStreamTapOutput, userOutput, bp->userOutputIsInterleaved,
+                    bp->outputChannelCount, bp->bytesPerUserOutputSample,
+                    bp->userOutputIsInterleaved ? bp->outputChannelCount : 1, frameCount );
+    }
+
+    /* as in the buffer processor, the output of a callback which wasn't
+        called or returned paAbort is silence */
+    if( bp->outputChannelCount != 0 && !outputWritten )
+        ZeroUserOutput( bp, userOutput, frameCount );
+}
+
+
+unsigned long PaUtil_EndBufferProcessingDirectly( PaUtilBufferProcessor* bp,
+        const void *userInput, void *userOutput, unsigned long frameCount, int *streamCallbackResult )
+{
+    PaStreamCallbackFlags statusFlags = bp->callbackStatusFlags;
+    PaTime streamTime = bp->timeInfo->currentTime;
+
+    if( !bp->recordsStatistics )
+    {
+        EndBufferProcessingDirectly( bp, userInput, userOutput, frameCount, streamCallbackResult );
+        return frameCount;
+    }
+
+    AdvanceStreamTime( bp, frameCount );
+
+    if( statusFlags & (paInputUnderflow | paInputOverflow | paOutputUnderflow | paOutputOverflow) )
+    {
+        PA_PROBE1( xrun, statusFlags );
+        PA_TRACE_INSTANT( paUtilTraceXrun, (long)statusFlags, 0 );
+    }
+
+    PA_TRACE_BEGIN( paUtilTraceBufferProcessing, 0, (long)statusFlags );
+    PaUtil_BeginCpuLoadMeasurement( &bp->cpuLoadMeasurer );
+    EndBufferProcessingDirectly( bp, userInput, userOutput, frameCount, streamCallbackResult );
+    PaUtil_EndCpuLoadMeasurement( &bp->cpuLoadMeasurer, frameCount );
+    PaUtil_RecordStreamStatistics( &bp->statistics, bp->cpuLoadMeasurer.measurementStartTime,
+            PaUtil_GetTime(), frameCount, statusFlags, streamTime );
+    PaUtil_RecordStreamCpuLoad( &bp->statistics, &bp->cpuLoadMeasurer );
+    if( bp->outputChannelCount > 0 )
+        PaUtil_RecordStreamHeadroom( &bp->statistics, bp->hostTimeInfo.outputBufferDacTime, PaUtil_GetTime() );
+    PA_TRACE_END( paUtilTraceBufferProcessing, (long)frameCount, (long)statusFlags );
+    PA_PROBE2( buffer_end, frameCount, *streamCallbackResult );
+
+    return frameCount;
+}
+
+
 int PaUtil_IsBufferProcessorOutputEmpty( PaUtilBufferProcessor* bp )
 {
+    if( bp->sampleRateConverter
+            && !PaUtil_IsBufferProcessorOutputEmpty( &bp->sampleRateConverter->userBufferProcessor ) )
+        return 0;
+
+    if( bp->channelMixer
+            && !PaUtil_IsBufferProcessorOutputEmpty( &bp->channelMixer->userBufferProcessor ) )
+        return 0;
+
     return (bp->framesInTempOutputBuffer) ? 0 : 1;
 } 
 
@@ -1680,19 +4659,8 @@ unsigned long PaUtil_CopyInput( PaUtilBufferProcessor* bp,
         destSampleStrideSamples = bp->inputChannelCount;
         destChannelStrideBytes = bp->bytesPerUserInputSample;
 
-        for( i=0; i<bp->inputChannelCount; ++i )
-        {
-            bp->inputConverter( destBytePtr, destSampleStrideSamples,
-                                hostInputChannels[i].data,
-                                hostInputChannels[i].stride,
-                                framesToCopy, &bp->ditherGenerator );
-
-            destBytePtr += destChannelStrideBytes;  /* skip to next dest channel */
-
-            /* advance source ptr for next iteration */
-            hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
-                    framesToCopy * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
-        }
+        ConvertInputChannels( bp, hostInputChannels, destBytePtr, destSampleStrideSamples,
+                destChannelStrideBytes, 0, framesToCopy );
 
         /* advance callers dest pointer (buffer) */
         *buffer = ((unsigned char *)*buffer) +
@@ -1705,23 +4673,16 @@ unsigned long PaUtil_CopyInput( PaUtilBufferProcessor* bp,
         nonInterleavedDestPtrs = (void**)*buffer;
 
         destSampleStrideSamples = 1;
-        
-        for( i=0; i<bp->inputChannelCount; ++i )
-        {
-            destBytePtr = (unsigned char*)nonInterleavedDestPtrs[i];
 
-            bp->inputConverter( destBytePtr, destSampleStrideSamples,
-                                hostInputChannels[i].data,
-                                hostInputChannels[i].stride,
-                                framesToCopy, &bp->ditherGenerator );
+        ConvertInputChannels( bp, hostInputChannels, 0, destSampleStrideSamples,
+                0, nonInterleavedDestPtrs, framesToCopy );
 
+        for( i=0; i<bp->inputChannelCount; ++i )
+        {
             /* advance callers dest pointer (nonInterleavedDestPtrs[i]) */
+            destBytePtr = (unsigned char*)nonInterleavedDestPtrs[i];
             destBytePtr += bp->bytesPerUserInputSample * framesToCopy;
             nonInterleavedDestPtrs[i] = destBytePtr;
-            
-            /* advance source ptr for next iteration */
-            hostInputChannels[i].data = ((unsigned char*)hostInputChannels[i].data) +
-                    framesToCopy * hostInputChannels[i].stride * bp->bytesPerHostInputSample;
         }
     }
 
@@ -1751,19 +4712,8 @@ unsigned long PaUtil_CopyOutput( PaUtilBufferProcessor* bp,
         srcSampleStrideSamples = bp->outputChannelCount;
         srcChannelStrideBytes = bp->bytesPerUserOutputSample;
 
-        for( i=0; i<bp->outputChannelCount; ++i )
-        {
-            bp->outputConverter(    hostOutputChannels[i].data,
-                                    hostOutputChannels[i].stride,
-                                    srcBytePtr, srcSampleStrideSamples,
-                                    framesToCopy, &bp->ditherGenerator );
-
-            srcBytePtr += srcChannelStrideBytes;  /* skip to next source channel */
-
-            /* advance dest ptr for next iteration */
-            hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                    framesToCopy * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-        }
+        ConvertOutputChannels( bp, hostOutputChannels, srcBytePtr, srcSampleStrideSamples,
+                srcChannelStrideBytes, 0, framesToCopy );
 
         /* advance callers source pointer (buffer) */
         *buffer = ((unsigned char *)*buffer) +
@@ -1777,24 +4727,16 @@ unsigned long PaUtil_CopyOutput( PaUtilBufferProcessor* bp,
         nonInterleavedSrcPtrs = (void**)*buffer;
 
         srcSampleStrideSamples = 1;
-        
-        for( i=0; i<bp->outputChannelCount; ++i )
-        {
-            srcBytePtr = (unsigned char*)nonInterleavedSrcPtrs[i];
-            
-            bp->outputConverter(    hostOutputChannels[i].data,
-                                    hostOutputChannels[i].stride,
-                                    srcBytePtr, srcSampleStrideSamples,
-                                    framesToCopy, &bp->ditherGenerator );
 
+        ConvertOutputChannels( bp, hostOutputChannels, 0, srcSampleStrideSamples,
+                0, nonInterleavedSrcPtrs, framesToCopy );
 
+        for( i=0; i<bp->outputChannelCount; ++i )
+        {
             /* advance callers source pointer (nonInterleavedSrcPtrs[i]) */
+            srcBytePtr = (unsigned char*)nonInterleavedSrcPtrs[i];
             srcBytePtr += bp->bytesPerUserOutputSample * framesToCopy;
             nonInterleavedSrcPtrs[i] = srcBytePtr;
-            
-            /* advance dest ptr for next iteration */
-            hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                    framesToCopy * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
         }
     }
 
@@ -1808,22 +4750,11 @@ unsigned long PaUtil_ZeroOutput( PaUtilBufferProcessor* bp, unsigned long frameC
 {
     PaUtilChannelDescriptor *hostOutputChannels;
     unsigned int framesToZero;
-    unsigned int i;
 
     hostOutputChannels = bp->hostOutputChannels[0];
     framesToZero = PA_MIN_( bp->hostOutputFrameCount[0], frameCount );
 
-    for( i=0; i<bp->outputChannelCount; ++i )
-    {
-        bp->outputZeroer(   hostOutputChannels[i].data,
-                            hostOutputChannels[i].stride,
-                            framesToZero );
-
-
-        /* advance dest ptr for next iteration */
-        hostOutputChannels[i].data = ((unsigned char*)hostOutputChannels[i].data) +
-                framesToZero * hostOutputChannels[i].stride * bp->bytesPerHostOutputSample;
-    }
+    ZeroHostOutputChannels( bp, hostOutputChannels, framesToZero );
 
     bp->hostOutputFrameCount[0] += framesToZero;
     
@@ -92,6 +92,21 @@
  When the buffer processor is no longer used call
  PaUtil_TerminateBufferProcessor.
 
+ A host API which opened the device at a different sample rate than the
+ user asked for (see paConvertSampleRate) initializes the buffer processor
+ with PaUtil_InitializeResamplingBufferProcessor instead. The stream callback
+ then runs at the user's rate, everything else is used in the same way.
+
+ A full duplex stream whose input and output devices run from different
+ clocks (see paCompensateClockDrift) initializes it with
+ PaUtil_InitializeDriftCompensatingBufferProcessor. The input and output
+ host buffers are then passed in separately, as each device becomes ready.
+
+ A host API which opened a device with a different number of channels than
+ the stream has (see PaChannelMatrix) initializes it with
+ PaUtil_InitializeChannelMatrixBufferProcessor. The host buffers then have
+ the device's channels while the stream callback gets the stream's.
+
  
  <h4>Using the buffer processor for a callback stream</h4>
 
@@ -116,7 +131,8 @@
         buffer.
     - Call one of the following functions one or more times to tell the
         buffer processor about the host input buffer(s): PaUtil_SetInputChannel,
-        PaUtil_SetInterleavedInputChannels, PaUtil_SetNonInterleavedInputChannel.
+        PaUtil_SetInterleavedInputChannels, PaUtil_SetNonInterleavedInputChannel
+        (or PaUtil_SetSelectedInterleavedInputChannels for a subset of them).
         Which function you call will depend on whether the host buffer(s) are
         interleaved or not.
     - If the available host data is split accross two buffers (for example a
@@ -201,8 +217,16 @@
 
 
 #include "portaudio.h"
+#include "pa_allocation.h"
 #include "pa_converters.h"
+#include "pa_cpuload.h"
 #include "pa_dither.h"
+#include "pa_streamclock.h"
+#include "pa_streamtap.h"
+#include "pa_levelmeter.h"
+#include "pa_streamstats.h"
+#include "pa_timefilter.h"
+#include "pa_util.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -237,6 +261,63 @@ typedef enum {
 }PaUtilHostBufferSizeMode;
 
 
+/** The output channels of a stream which Pa_SetStreamOutputChannelSilent()
+ marked silent. The buffer processor zeroes their host output instead of
+ converting the user's, and when the host API's output buffers keep their
+ contents (see PaUtil_SetBufferProcessorPersistentHostOutput) it zeroes them
+ once per host buffer and then skips them until they are active again.
+*/
+typedef struct PaUtilSilentChannels
+{
+    unsigned int channelCount;
+    volatile unsigned char *silent;     /**< non-zero for each silent channel */
+    volatile int used;                  /**< non-zero once any channel has been marked */
+} PaUtilSilentChannels;
+
+
+/** Mark an output channel silent or active, may be called from any thread,
+ the stream callback's included; the change applies from the next host
+ buffer.
+
+ @return paInvalidChannelCount if channel isn't a channel of the stream.
+*/
+PaError PaUtil_SetSilentChannel( PaUtilSilentChannels *channels, int channel, int silent );
+
+
+/** A gain which Pa_SetStreamOutputGain() set, published under a sequence
+ number to the thread converting the output.
+*/
+typedef struct PaUtilGainSetting
+{
+    volatile unsigned long sequence;    /**< odd while the setting is written */
+    volatile float gain;
+    volatile double rampTime;           /**< seconds to ramp linearly to gain in */
+} PaUtilGainSetting;
+
+
+/** The gains of the output channels of a stream and of the whole stream. The
+ buffer processor multiplies paFloat32 user output by them in blocks, which it
+ passes to the output converter, instead of multiplying the user buffers in a
+ pass of their own.
+*/
+typedef struct PaUtilOutputGain
+{
+    unsigned int channelCount;
+    PaUtilGainSetting *settings;        /**< one per channel, then the stream's */
+    volatile int used;                  /**< non-zero once any gain has been set */
+} PaUtilOutputGain;
+
+
+/** Set the gain of an output channel, or with channel -1 of the whole
+ stream, which multiplies those of the channels. Doesn't block and may be
+ called from any thread, the stream callback's included, as long as calls for
+ the same stream don't overlap; the ramp starts with the next host buffer.
+
+ @return paInvalidChannelCount if channel isn't a channel of the stream or -1.
+*/
+PaError PaUtil_SetOutputGain( PaUtilOutputGain *gains, int channel, float gain, double rampTime );
+
+
 /** @brief An auxilliary data structure used internally by the buffer processor
  to represent host input and output buffers. */
 typedef struct PaUtilChannelDescriptor{
@@ -256,6 +337,8 @@ typedef struct {
 
     PaUtilHostBufferSizeMode hostBufferSizeMode;
     int useNonAdaptingProcess;
+    int useIdentityProcess; /**< non-adapting processing may hand interleaved host
+                                 buffers straight to the callback, see IdentityProcess() */
     int userOutputSampleFormatIsEqualToHost;
     int userInputSampleFormatIsEqualToHost;
     unsigned long framesPerTempBuffer;
@@ -273,9 +356,15 @@ typedef struct {
     int userOutputIsInterleaved;
     PaUtilConverter *outputConverter;
     PaUtilZeroer *outputZeroer;
+    int skipSilentOutput;           /**< zero the host output instead of converting silent
+                                         user output (paSkipSilentOutput) */
+    unsigned char silentOutputByte; /**< every byte of silent user output has this value */
+    int flushDenormals;             /**< flush denormals to zero on the callback thread (paFlushDenormals) */
 
     unsigned long initialFramesInTempInputBuffer;
     unsigned long initialFramesInTempOutputBuffer;
+    unsigned long inputBatchingLatencyFrames; /**< frames the input of a half duplex paBatchCallbacks
+                                                   stream waits for the rest of a user buffer */
 
     void *tempInputBuffer;          /**< used for slips, block adaption, and conversion. */
     void **tempInputBufferPtrs;     /**< storage for non-interleaved buffer pointers, NULL for interleaved user input */
@@ -285,6 +374,12 @@ typedef struct {
     void **tempOutputBufferPtrs;    /**< storage for non-interleaved buffer pointers, NULL for interleaved user output */
     unsigned long framesInTempOutputBuffer; /**< frames remaining in input buffer from previous adaption iteration */
 
+    struct PaUtilAdaptingScheduleEntry *adaptingSchedule; /**< what AdaptingProcess does with each
+                                             full duplex host buffer, indexed by framesInTempInputBuffer
+                                             / adaptingScheduleGranularity, or NULL if the host
+                                             buffer size isn't fixed */
+    unsigned long adaptingScheduleGranularity;
+
     PaStreamCallbackTimeInfo *timeInfo;
 
     PaStreamCallbackFlags callbackStatusFlags;
@@ -305,9 +400,66 @@ typedef struct {
                                                          */
 
     PaUtilTriangularDitherGenerator ditherGenerator;
+    PaUtilNoiseShapedDitherGenerator *noiseShapedDitherGenerators; /**< one per output channel
+                                                        when outputConverter is a noise shaped
+                                                        dither converter, otherwise NULL */
+
+    PaUtilAllocationGroup *allocations; /**< all of the buffers above, in a pre-faulted
+                                             and (where permitted) locked arena */
+
+    struct PaUtilSampleRateConverter *sampleRateConverter; /**< the resamplers and the user side
+                                             buffer processor of a stream initialized with
+                                             PaUtil_InitializeResamplingBufferProcessor or
+                                             PaUtil_InitializeDriftCompensatingBufferProcessor,
+                                             otherwise NULL */
+
+    struct PaUtilChannelMixer *channelMixer; /**< the channel matrices and the user side
+                                             buffer processor of a stream initialized with
+                                             PaUtil_InitializeChannelMatrixBufferProcessor,
+                                             otherwise NULL */
+
+    PaUtilStreamStatistics statistics;  /**< of the host buffers passed to PaUtil_EndBufferProcessing */
+    int recordsStatistics;              /**< 0 for the inner buffer processors of the stages above,
+                                             their host buffers are chunks of the outer ones */
+    PaUtilTimeFilter inputTimeFilter;   /**< of the host buffers' inputBufferAdcTime */
+    PaUtilTimeFilter outputTimeFilter;  /**< of the host buffers' outputBufferDacTime, both are
+                                             only used when recordsStatistics is set */
+    PaUtilStreamClock clock;            /**< published like the statistics */
+    PaUtilStreamTaps taps;              /**< see PaUtil_GetBufferProcessorTaps */
+    PaUtilStreamTaps *streamTaps;       /**< where the buffers of streamCallback are published: &taps,
+                                             the outer buffer processor's for the inner ones, or NULL
+                                             when streamCallback is the resampler's or the mixer's */
+    PaUtilLevelMeter *levelMeter;       /**< of the user buffers, NULL without paMeterLevels and for
+                                             the host side of resampling and mixing */
+    PaUtilSilentChannels silentOutputChannels; /**< see PaUtil_GetBufferProcessorSilentOutputChannels */
+    PaUtilOutputGain outputGain;        /**< see PaUtil_GetBufferProcessorOutputGain */
+    struct PaUtilGainRamp *gainRamps;   /**< per output channel and for the stream, the ramps of outputGain */
+    PaUtilConverter *gainOutputConverter; /**< converts the blocks multiplied by outputGain */
+    struct PaUtilZeroedHostOutput *zeroedHostOutput; /**< per output channel, its silent flag for the
+                                             buffer being converted and the host buffers zeroed
+                                             since it went silent */
+    int hostOutputPersists;             /**< see PaUtil_SetBufferProcessorPersistentHostOutput */
+    PaStreamCallbackTimeInfo hostTimeInfo; /**< the filtered times of the current host buffer */
+    PaTime hostLocalTime;               /**< the PaUtil_GetTime() of hostTimeInfo */
+    double hostFramesProcessed;         /**< host frames since the buffer processor was reset */
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer; /**< the load of each stage of the host buffers,
+                                             measured when recordsStatistics is set */
+    PaUtilCpuLoadMeasurer *stageMeasurer; /**< where the stages below are charged: cpuLoadMeasurer,
+                                             or the outer buffer processor's for the inner ones */
+    PaUtilCpuLoadStage callbackStage;   /**< the stage of streamCallback, paUtilOtherCpuLoadStage
+                                             when it is the resampler's or the mixer's */
+
+    PaUtilWorkerPool *workerPool;       /**< NULL, or the pool the channels are converted on,
+                                             see PaUtil_SetBufferProcessorWorkerPool */
+    PaUtilTriangularDitherGenerator *workerDitherGenerators; /**< one per thread of workerPool */
 
     double samplePeriod;
 
+    volatile int paused;                /**< see PaUtil_SetBufferProcessorPaused */
+    PaTime requestedStartTime;          /**< see PaUtil_SetBufferProcessorStartTime */
+    PaTime startTime;                   /**< the requestedStartTime armed by PaUtil_ResetBufferProcessor,
+                                             0 once the stream callback has been called */
+
     PaStreamCallback *streamCallback;
     void *userData;
 } PaUtilBufferProcessor;
@@ -350,6 +502,8 @@ typedef struct {
  @param framesPerUserBuffer Number of frames per user buffer, as requested
  by the framesPerBuffer parameter to Pa_OpenStream. This parameter may be
  zero to indicate that the user will accept any (and varying) buffer sizes.
+ Host APIs which support paBatchCallbacks pass the result of
+ PaUtil_GetBatchedFramesPerUserBuffer() here.
 
  @param framesPerHostBuffer Specifies the number of frames per host buffer
  for the fixed buffer size mode, and the maximum number of frames
@@ -387,6 +541,135 @@ PaError PaUtil_InitializeBufferProcessor( PaUtilBufferProcessor* bufferProcessor
             PaStreamCallback *streamCallback, void *userData );
 
 
+/** Initialize a buffer processor which converts between the sample rate of
+ the host and the one requested by the user. The host side of the buffer
+ processor runs at hostSampleRate, in the same way as one initialized with
+ PaUtil_InitializeBufferProcessor, while the stream callback is called with
+ buffers at userSampleRate.
+
+ The conversion is done in paFloat32 by a polyphase filter (see
+ pa_resampler.h) whose length is chosen by the paConvertSampleRateFast and
+ paConvertSampleRateBest stream flags. Its delay is included in the
+ latencies returned by PaUtil_GetBufferProcessorInputLatencyFrames and
+ PaUtil_GetBufferProcessorOutputLatencyFrames.
+
+ The parameters are those of PaUtil_InitializeBufferProcessor, except for:
+
+ @param userSampleRate The sample rate passed to Pa_OpenStream. The stream
+ callback's buffers and time stamps are at this rate.
+
+ @param hostSampleRate The rate the host runs at. framesPerHostBuffer is
+ at this rate.
+
+ @param streamCallback Only callback streams can be converted, this may not
+ be NULL.
+
+ @return An error code indicating whether the initialization was successful.
+ paInvalidSampleRate if the rates are too different to be converted.
+
+ @see PaUtil_InitializeBufferProcessor, paConvertSampleRate
+*/
+PaError PaUtil_InitializeResamplingBufferProcessor( PaUtilBufferProcessor* bufferProcessor,
+            int inputChannelCount, PaSampleFormat userInputSampleFormat,
+            PaSampleFormat hostInputSampleFormat,
+            int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+            PaSampleFormat hostOutputSampleFormat,
+            double userSampleRate,
+            double hostSampleRate,
+            PaStreamFlags streamFlags,
+            unsigned long framesPerUserBuffer, /* 0 indicates don't care */
+            unsigned long framesPerHostBuffer,
+            PaUtilHostBufferSizeMode hostBufferSizeMode,
+            PaStreamCallback *streamCallback, void *userData );
+
+
+/** Initialize a buffer processor for a full duplex callback stream whose
+ input and output devices are not driven by the same clock. The input is
+ resampled into a buffer from which the stream callback is run whenever
+ output is processed. The ratio of the input resampler follows the amount of
+ buffered input, estimated from the time stamps of both devices, so that the
+ latency stays constant while the clocks drift apart by up to 0.5%. Larger
+ excursions, such as after an xrun, drop buffered input or insert silence
+ and are reported to the callback with paInputOverflow or paInputUnderflow.
+
+ Each call to PaUtil_EndBufferProcessing may pass input, output or both,
+ use PaUtil_SetNoInput or PaUtil_SetNoOutput for the direction which is not
+ ready. The two directions may have different frame counts. The time info
+ passed to PaUtil_BeginBufferProcessing must be valid for the directions
+ supplied, with currentTime on the same time base for both.
+
+ The parameters are those of PaUtil_InitializeResamplingBufferProcessor,
+ except for:
+
+ @param hostInputSampleRate The rate the input device runs at.
+
+ @param hostOutputSampleRate The rate the output device runs at.
+
+ @param framesPerHostBuffer The larger of the two devices' nominal periods,
+ this determines the amount of input that is kept buffered.
+
+ @return An error code indicating whether the initialization was successful.
+
+ @see PaUtil_InitializeResamplingBufferProcessor, paCompensateClockDrift
+*/
+PaError PaUtil_InitializeDriftCompensatingBufferProcessor( PaUtilBufferProcessor* bufferProcessor,
+            int inputChannelCount, PaSampleFormat userInputSampleFormat,
+            PaSampleFormat hostInputSampleFormat,
+            int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+            PaSampleFormat hostOutputSampleFormat,
+            double userSampleRate,
+            double hostInputSampleRate,
+            double hostOutputSampleRate,
+            PaStreamFlags streamFlags,
+            unsigned long framesPerUserBuffer, /* 0 indicates don't care */
+            unsigned long framesPerHostBuffer,
+            PaUtilHostBufferSizeMode hostBufferSizeMode,
+            PaStreamCallback *streamCallback, void *userData );
+
+
+/** Initialize a buffer processor for a callback stream whose device
+ channels are routed to and from the stream's channels through a channel
+ matrix. The host side of the buffer processor has the device's channel
+ count, in the same way as one initialized with
+ PaUtil_InitializeBufferProcessor, while the stream callback is called with
+ inputChannelCount and outputChannelCount channels.
+
+ The matrices are applied in paFloat32 (see pa_channelmatrix.h), a chunk of
+ frames at a time. The user side buffer processor's adaption is included in
+ the latencies returned by PaUtil_GetBufferProcessorInputLatencyFrames and
+ PaUtil_GetBufferProcessorOutputLatencyFrames.
+
+ The parameters are those of PaUtil_InitializeBufferProcessor, except for:
+
+ @param inputChannelMatrix The matrix from the input device's channels to
+ the stream's inputChannelCount channels. NULL if the device has the same
+ channels as the stream.
+
+ @param outputChannelMatrix The matrix from the stream's outputChannelCount
+ channels to the output device's channels. NULL if the device has the same
+ channels as the stream.
+
+ @param streamCallback Only callback streams can be mixed, this may not be
+ NULL.
+
+ @return An error code indicating whether the initialization was successful.
+ paInvalidChannelCount if a matrix names a channel which doesn't exist.
+
+ @see PaUtil_InitializeBufferProcessor, PaChannelMatrix
+*/
+PaError PaUtil_InitializeChannelMatrixBufferProcessor( PaUtilBufferProcessor* bufferProcessor,
+            int inputChannelCount, PaSampleFormat userInputSampleFormat,
+            PaSampleFormat hostInputSampleFormat, const PaChannelMatrix *inputChannelMatrix,
+            int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+            PaSampleFormat hostOutputSampleFormat, const PaChannelMatrix *outputChannelMatrix,
+            double sampleRate,
+            PaStreamFlags streamFlags,
+            unsigned long framesPerUserBuffer, /* 0 indicates don't care */
+            unsigned long framesPerHostBuffer,
+            PaUtilHostBufferSizeMode hostBufferSizeMode,
+            PaStreamCallback *streamCallback, void *userData );
+
+
 /** Terminate a buffer processor's representation. Deallocates any temporary
  buffers allocated by PaUtil_InitializeBufferProcessor.
  
@@ -399,18 +682,73 @@ void PaUtil_TerminateBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 
 /** Clear any internally buffered data. If you call
  PaUtil_InitializeBufferProcessor in your OpenStream routine, make sure you
- call PaUtil_ResetBufferProcessor in your StartStream call.
+ call PaUtil_ResetBufferProcessor in your StartStream call. Also clears the
+ paused state set by PaUtil_SetBufferProcessorPaused.
 
  @param bufferProcessor The buffer processor to reset.
 */
 void PaUtil_ResetBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
 
 
+/** Pause or resume calling the stream callback, for host APIs implementing
+ Pa_PauseStream() by keeping the device running. While paused,
+ PaUtil_EndBufferProcessing() processes the host buffers as if the callback
+ had returned paComplete, outputting silence and discarding input, but leaves
+ the stream callback result paContinue. May be called from any thread, it
+ takes effect at the next host buffer.
+
+ @param bufferProcessor The buffer processor.
+
+ @param paused Nonzero to pause, 0 to resume.
+*/
+void PaUtil_SetBufferProcessorPaused( PaUtilBufferProcessor* bufferProcessor, int paused );
+
+
+/** Schedule the first call of the stream callback, for host APIs implementing
+ Pa_StartStreamAtTime(). The time takes effect at the next
+ PaUtil_ResetBufferProcessor(), which the host API's start calls; a reset
+ without a start time set before it doesn't schedule the start.
+
+ Until the start time PaUtil_EndBufferProcessing() processes the host buffers
+ as while paused. The host buffer containing the start time, by the
+ outputBufferDacTime, or inputBufferAdcTime for input only streams, of the
+ PaStreamCallbackTimeInfo passed to PaUtil_BeginBufferProcessing(), is
+ processed from the frame at the start time on, the frames before it are
+ output as silence and their input discarded. Host APIs calling the stream
+ callback themselves use the buffer processor until then, see
+ PaUtil_CanBypassBufferProcessor().
+
+ @param bufferProcessor The buffer processor.
+
+ @param startTime The time of the stream callback's first frame, in the time
+ base of the PaStreamCallbackTimeInfo passed to PaUtil_BeginBufferProcessing().
+ 0 starts calling the callback with the first host buffer.
+*/
+void PaUtil_SetBufferProcessorStartTime( PaUtilBufferProcessor* bufferProcessor, PaTime startTime );
+
+
+/** Round the user's framesPerBuffer up to a whole number of host buffers if
+ paBatchCallbacks is set, for host APIs which support the flag. Such host APIs
+ choose framesPerHostBuffer as if framesPerBuffer were
+ paFramesPerBufferUnspecified and pass the result to
+ PaUtil_InitializeBufferProcessor() as framesPerUserBuffer. Host APIs which
+ size their buffers from framesPerBuffer don't call it and so ignore the flag.
+
+ @return framesPerUserBuffer rounded up to a multiple of framesPerHostBuffer,
+ or framesPerUserBuffer unchanged without paBatchCallbacks, for
+ paFramesPerBufferUnspecified or if framesPerHostBuffer is 0.
+*/
+unsigned long PaUtil_GetBatchedFramesPerUserBuffer( PaStreamFlags streamFlags,
+        unsigned long framesPerUserBuffer, unsigned long framesPerHostBuffer );
+
+
 /** Retrieve the input latency of a buffer processor, in frames.
 
  @param bufferProcessor The buffer processor examine.
 
  @return The input latency introduced by the buffer processor, in frames.
+ For a buffer processor converting the sample rate these are frames at the
+ user's sample rate.
 
  @see PaUtil_GetBufferProcessorOutputLatencyFrames
 */
@@ -421,11 +759,148 @@ unsigned long PaUtil_GetBufferProcessorInputLatencyFrames( PaUtilBufferProcessor
  @param bufferProcessor The buffer processor examine.
 
  @return The output latency introduced by the buffer processor, in frames.
+ For a buffer processor converting the sample rate these are frames at the
+ user's sample rate.
 
  @see PaUtil_GetBufferProcessorInputLatencyFrames
 */
 unsigned long PaUtil_GetBufferProcessorOutputLatencyFrames( PaUtilBufferProcessor* bufferProcessor );
 
+/** Retrieve the statistics of the host buffers processed by a callback
+ stream's buffer processor. Host APIs store the result in the statistics
+ field of their PaUtilStreamRepresentation to implement
+ Pa_GetStreamStatistics().
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @return The statistics, which are cleared by PaUtil_ResetBufferProcessor.
+
+ @see PaStreamStatistics
+*/
+PaUtilStreamStatistics* PaUtil_GetBufferProcessorStatistics( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve the clock which a callback stream's buffer processor publishes
+ for every host buffer it processes, the buffers passed to the stream
+ callback with PaUtil_EndBufferProcessingDirectly() included. Host APIs store the result in the
+ clock field of their PaUtilStreamRepresentation to implement
+ Pa_GetStreamFramePosition() and to let Pa_GetStreamTime() interpolate.
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @return The clock, which is cleared by PaUtil_ResetBufferProcessor.
+
+ @see PaUtilStreamClock
+*/
+const PaUtilStreamClock* PaUtil_GetBufferProcessorClock( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve the taps of the buffers a callback stream's buffer processor
+ passes to the stream callback. Host APIs store the result in the taps field
+ of their PaUtilStreamRepresentation to implement Pa_AddStreamTap().
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @return The taps, whose rings are freed by PaUtil_TerminateBufferProcessor.
+
+ @see PaUtilStreamTaps
+*/
+PaUtilStreamTaps* PaUtil_GetBufferProcessorTaps( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve the level meter of the user buffers of a callback stream's
+ buffer processor. Host APIs store the result in the levelMeter field of their
+ PaUtilStreamRepresentation to implement Pa_GetStreamLevels().
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @return The meter, which is cleared by PaUtil_ResetBufferProcessor, or NULL
+ if the stream wasn't opened with paMeterLevels.
+*/
+PaUtilLevelMeter* PaUtil_GetBufferProcessorLevelMeter( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve the output channels of the user buffers of a buffer processor
+ which may be marked silent. Host APIs store the result in the
+ silentOutputChannels field of their PaUtilStreamRepresentation to implement
+ Pa_SetStreamOutputChannelSilent().
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @return The channels, which keep their marks when the buffer processor is
+ reset, or NULL if the stream has no output.
+*/
+PaUtilSilentChannels* PaUtil_GetBufferProcessorSilentOutputChannels( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve the gains of the output channels of the user buffers of a buffer
+ processor. Host APIs store the result in the outputGain field of their
+ PaUtilStreamRepresentation to implement Pa_SetStreamOutputGain().
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @return The gains, which are kept when the buffer processor is reset while
+ ramps in progress end at their gains, or NULL if the stream has no
+ paFloat32 output.
+*/
+PaUtilOutputGain* PaUtil_GetBufferProcessorOutputGain( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Tell the buffer processor that the host output buffers keep what was
+ written to them until they are written again, as ASIO's double buffers do,
+ so zeroing a silent channel of one of them once is enough. Host APIs whose
+ driver or library may overwrite or clear the buffers once they have been
+ played must not call this. Silent channels of resampling and channel matrix
+ streams, which aren't converted into the host buffers directly, are zeroed
+ in every buffer.
+
+ @param bufferProcessor The buffer processor.
+*/
+void PaUtil_SetBufferProcessorPersistentHostOutput( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Retrieve the number of bytes of memory a buffer processor allocated: its
+ temporary buffers and, for the buffer processors of resampling, drift
+ compensating and channel matrix streams, the buffers of those stages. The
+ PaUtilBufferProcessor structure itself is not included.
+
+ @param bufferProcessor The buffer processor to examine.
+
+ @see Pa_GetStreamMemoryUsage
+*/
+long PaUtil_GetBufferProcessorMemoryUsage( PaUtilBufferProcessor* bufferProcessor );
+
+
+/** Split the conversion of the host buffers of a stream with many channels
+ across the workers of a pool, each converting a range of the channels in
+ parallel with the others. Streams with few channels are converted on the
+ calling thread alone.
+
+ Must not be called while the buffer processor is processing, the pool must
+ outlive its use by the buffer processor.
+
+ @param bufferProcessor The buffer processor, including the buffer
+ processors of its resampling or channel matrix stages.
+
+ @param pool The pool, or NULL to convert on the calling thread only.
+
+ @return paInsufficientMemory if the dither state of the workers can't be
+ allocated, the buffer processor then doesn't use the pool.
+*/
+PaError PaUtil_SetBufferProcessorWorkerPool( PaUtilBufferProcessor* bufferProcessor,
+        PaUtilWorkerPool *pool );
+
+
+/** Move the buffers of a buffer processor, and of its resampling or channel
+ matrix stages, to the memory nodes of the processors the callback thread
+ is pinned to. Host APIs which pin their callback thread call this once the
+ buffer processor is initialized.
+
+ @see PaUtil_PlaceAllocationGroup
+*/
+void PaUtil_PlaceBufferProcessor( PaUtilBufferProcessor* bufferProcessor,
+        const int *cpus, int cpuCount );
+
 /*@}*/
 
 
@@ -489,6 +964,21 @@ void PaUtil_SetInterleavedInputChannels( PaUtilBufferProcessor* bufferProcessor,
         unsigned int firstChannel, void *data, unsigned int channelCount );
 
 
+/** Provide the buffer processor with a pointer to an interleaved host input
+ buffer of which only some channels are the stream's, e.g. a pair of a
+ 64-channel device. Only the selected channels are converted.
+
+ @param bufferProcessor The buffer processor.
+ @param data The buffer.
+ @param hostChannelCount The number of interleaved channels in the buffer.
+ @param channelSelectors For each of the channels specified to
+ PaUtil_InitializeBufferProcessor, the host channel it is, each less than
+ hostChannelCount.
+*/
+void PaUtil_SetSelectedInterleavedInputChannels( PaUtilBufferProcessor* bufferProcessor,
+        void *data, unsigned int hostChannelCount, const int *channelSelectors );
+
+
 /** Provide the buffer processor with a pointer to one non-interleaved host
  output channel.
 
@@ -518,6 +1008,12 @@ void PaUtil_Set2ndInputChannel( PaUtilBufferProcessor* bufferProcessor,
 void PaUtil_Set2ndInterleavedInputChannels( PaUtilBufferProcessor* bufferProcessor,
         unsigned int firstChannel, void *data, unsigned int channelCount );
 
+/** Use for the second buffer half when the input buffer is split in two halves.
+ @see PaUtil_SetSelectedInterleavedInputChannels
+*/
+void PaUtil_Set2ndSelectedInterleavedInputChannels( PaUtilBufferProcessor* bufferProcessor,
+        void *data, unsigned int hostChannelCount, const int *channelSelectors );
+
 /** Use for the second buffer half when the input buffer is split in two halves.
  @see PaUtil_SetNonInterleavedInputChannel
 */
@@ -624,7 +1120,11 @@ void PaUtil_Set2ndNonInterleavedOutputChannel( PaUtilBufferProcessor* bufferProc
 
  @param timeInfo Timing information for the first sample of the host
  buffer(s). This information may be adjusted when buffer adaption is being
- performed.
+ performed. The inputBufferAdcTime and outputBufferDacTime are each replaced
+ by the output of a PaUtilTimeFilter, which is restarted by the xrun flags,
+ while times of 0, which the host API doesn't know, and the currentTime are
+ left as they are. The sample rate estimated by the filters is recorded in the
+ buffer processor's statistics.
 
  @param callbackStatusFlags Flags indicating whether underruns and overruns
  have occurred since the last time the buffer processor was called.
@@ -632,6 +1132,22 @@ void PaUtil_Set2ndNonInterleavedOutputChannel( PaUtilBufferProcessor* bufferProc
 void PaUtil_BeginBufferProcessing( PaUtilBufferProcessor* bufferProcessor,
         PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags callbackStatusFlags );
 
+
+/** Determine whether a host API which can pass its buffers to the stream
+ callback directly, with PaUtil_EndBufferProcessingDirectly, may do so for the
+ next host buffer. It may not while the buffer processor has work to do on the
+ user buffers, such as applying an output gain or zeroing silent output
+ channels, or while the stream is paused or waits for its start time, and
+ processes that host buffer with PaUtil_EndBufferProcessing instead. Host APIs
+ call this from the callback thread before every host buffer.
+
+ @param bufferProcessor The buffer processor.
+
+ @return Non-zero if the host buffer may be passed to the stream callback
+ directly.
+*/
+int PaUtil_CanBypassBufferProcessor( PaUtilBufferProcessor* bufferProcessor );
+
         
 /** Finish processing a host buffer (or a pair of host buffers in the
  full-duplex case) for a callback stream.
@@ -654,12 +1170,43 @@ void PaUtil_BeginBufferProcessing( PaUtilBufferProcessor* bufferProcessor,
  @return The number of frames processed. This usually corresponds to the
  number of frames specified by the PaUtil_Set*FrameCount functions, exept in
  the paUtilVariableHostBufferSizePartialUsageAllowed buffer size mode when a
- smaller value may be returned.
+ smaller value may be returned. For a buffer processor initialized with
+ PaUtil_InitializeDriftCompensatingBufferProcessor it is the number of output
+ frames, or of input frames if no output was supplied.
 */
 unsigned long PaUtil_EndBufferProcessing( PaUtilBufferProcessor* bufferProcessor,
         int *callbackResult );
 
 
+/** Finish processing a host buffer for a callback stream by passing it to the
+ stream callback directly, in place of PaUtil_EndBufferProcessing. Host APIs
+ whose buffers have the user's sample format and layout may call this after
+ PaUtil_BeginBufferProcessing for a host buffer of the user's buffer size, when
+ PaUtil_CanBypassBufferProcessor returns non-zero. The buffers are metered and
+ published to the stream taps as the buffer processor's own, and the stream's
+ statistics recorded.
+
+ @param bufferProcessor The buffer processor.
+
+ @param userInput The input buffer passed to the stream callback: the
+ interleaved frames, or the array of channel pointers. NULL without input.
+
+ @param userOutput The output buffer passed to the stream callback, as for
+ userInput. It is zeroed when the stream callback isn't called or returns
+ paAbort.
+
+ @param frameCount The frames of the host buffer.
+
+ @param callbackResult As for PaUtil_EndBufferProcessing.
+
+ @return frameCount.
+
+ @see PaUtil_CanBypassBufferProcessor
+*/
+unsigned long PaUtil_EndBufferProcessingDirectly( PaUtilBufferProcessor* bufferProcessor,
+        const void *userInput, void *userOutput, unsigned long frameCount, int *callbackResult );
+
+
 /** Determine whether any callback generated output remains in the bufffer
  processor's internal buffers. This method may be used to determine when to
  continue calling PaUtil_EndBufferProcessing() after the callback has returned
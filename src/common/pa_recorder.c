@@ -0,0 +1,604 @@
+/*
+ * Portable Audio I/O Library streaming file recorder
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Streaming WAV/RF64 file recorder.
+
+ The writer thread is a detached thread signalling its end through a
+ semaphore, so the recorder builds on the platform specific parts of
+ pa_util.h and needs no threading code of its own.
+*/
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* O_DIRECT */
+#endif
+
+#include <string.h> /* memcpy(), memmove(), memset() */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PA_RECORDER_USE_POSIX_IO
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <stdio.h>
+#endif
+
+#include "pa_recorder.h"
+#include "pa_ringbuffer.h"
+#include "pa_memorybarrier.h"
+#include "pa_endianness.h"
+#include "pa_util.h"
+#include "pa_debugprint.h"
+
+
+/* Sizes of files larger than 4 GB. */
+#if defined(_MSC_VER) || defined(__BORLANDC__)
+typedef unsigned __int64 PaRecorderSize;
+#elif defined( __GNUC__ )
+__extension__ typedef unsigned long long PaRecorderSize;
+#else
+typedef unsigned long long PaRecorderSize;
+#endif
+
+
+#define PA_RECORDER_MAX_BLOCK_BYTES     (1024 * 1024)
+#define PA_RECORDER_POLL_SECONDS        (0.1)
+
+/* The header: RIFF chunk, a JUNK chunk which becomes ds64 in RF64 files,
+   fmt and the data chunk's header. WAVE_FORMAT_EXTENSIBLE is used for more
+   than two channels. */
+#define PA_RECORDER_DS64_SIZE           (28)
+#define PA_RECORDER_FMT_OFFSET          (12 + 8 + PA_RECORDER_DS64_SIZE)
+#define PA_RECORDER_FMT_SIZE            (16)
+#define PA_RECORDER_FMT_EXTENSIBLE_SIZE (40)
+#define PA_RECORDER_MAX_HEADER_SIZE     (PA_RECORDER_FMT_OFFSET + 8 + PA_RECORDER_FMT_EXTENSIBLE_SIZE + 8)
+
+#define PA_RECORDER_WAVE_FORMAT_PCM         (1)
+#define PA_RECORDER_WAVE_FORMAT_IEEE_FLOAT  (3)
+#define PA_RECORDER_WAVE_FORMAT_EXTENSIBLE  (0xFFFE)
+
+
+struct PaUtilRecorder
+{
+    PaUtilRingBuffer ringBuffer;        /**< frames queued by the callback */
+    void *ringBufferData;
+    ring_buffer_size_t wakeFrames;      /**< queued frames at which the writer is woken */
+
+    int channelCount;
+    int bytesPerSample;
+    int bytesPerFrame;
+    int nonInterleaved;
+    int formatTag;
+    double sampleRate;
+
+    unsigned char *stagingMemory;
+    unsigned char *staging;             /**< stagingMemory aligned to PA_RECORDER_ALIGNMENT */
+    unsigned long blockBytes;           /**< size of each write, a multiple of PA_RECORDER_ALIGNMENT */
+    unsigned long stagingUsed;
+    int headerSize;
+    PaRecorderSize dataBytes;           /**< frames moved to the staging buffer, in bytes */
+
+#ifdef PA_RECORDER_USE_POSIX_IO
+    int fd;
+    int directIO;
+#else
+    FILE *file;
+#endif
+
+    PaUtilSemaphore *dataReady;
+    PaUtilSemaphore *writerDone;
+    volatile int stopRequested;
+    volatile unsigned long droppedFrames;
+    PaError writeError;                 /**< first failure of the writer thread */
+};
+
+
+/* file access ------------------------------------------------------------ */
+
+static PaError OpenRecorderFile( PaUtilRecorder *self, const char *path, unsigned long flags )
+{
+#ifdef PA_RECORDER_USE_POSIX_IO
+    int openFlags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    self->directIO = 0;
+#ifdef O_DIRECT
+    if( flags & paUtilRecorderDirectIO )
+    {
+        self->fd = open( path, openFlags | O_DIRECT, 0666 );
+        if( self->fd >= 0 )
+        {
+            self->directIO = 1;
+            return paNoError;
+        }
+        /* file systems such as tmpfs don't support O_DIRECT */
+        PA_DEBUG(( "%s: O_DIRECT refused for %s, errno %d\n", __FUNCTION__, path, errno ));
+    }
+#else
+    (void)flags; /* unused parameter */
+#endif
+    self->fd = open( path, openFlags, 0666 );
+    return self->fd >= 0 ? paNoError : paInternalError;
+#else
+    (void)flags; /* unused parameter */
+    self->file = fopen( path, "wb" );
+    return self->file ? paNoError : paInternalError;
+#endif
+}
+
+
+static PaError WriteRecorderFile( PaUtilRecorder *self, const unsigned char *data, unsigned long bytes )
+{
+#ifdef PA_RECORDER_USE_POSIX_IO
+    while( bytes > 0 )
+    {
+        ssize_t written = write( self->fd, data, bytes );
+        if( written < 0 )
+        {
+            if( errno == EINTR )
+                continue;
+            PA_DEBUG(( "%s: write failed, errno %d\n", __FUNCTION__, errno ));
+            return paInternalError;
+        }
+        data += written;
+        bytes -= (unsigned long)written;
+    }
+    return paNoError;
+#else
+    return fwrite( data, 1, bytes, self->file ) == bytes ? paNoError : paInternalError;
+#endif
+}
+
+
+/* Switch to buffered writes for the tail of the file and the header, which
+   aren't aligned. */
+static void EndDirectIO( PaUtilRecorder *self )
+{
+#if defined(PA_RECORDER_USE_POSIX_IO) && defined(O_DIRECT)
+    if( self->directIO )
+    {
+        int fileFlags = fcntl( self->fd, F_GETFL );
+        if( fileFlags != -1 )
+            fcntl( self->fd, F_SETFL, fileFlags & ~O_DIRECT );
+        self->directIO = 0;
+    }
+#else
+    (void)self; /* unused parameter */
+#endif
+}
+
+
+static PaError RewriteRecorderHeader( PaUtilRecorder *self, const unsigned char *header )
+{
+#ifdef PA_RECORDER_USE_POSIX_IO
+    return pwrite( self->fd, header, self->headerSize, 0 ) == self->headerSize ? paNoError : paInternalError;
+#else
+    if( fseek( self->file, 0, SEEK_SET ) != 0 )
+        return paInternalError;
+    return fwrite( header, 1, self->headerSize, self->file ) == (size_t)self->headerSize ? paNoError : paInternalError;
+#endif
+}
+
+
+static PaError CloseRecorderFile( PaUtilRecorder *self )
+{
+#ifdef PA_RECORDER_USE_POSIX_IO
+    return close( self->fd ) == 0 ? paNoError : paInternalError;
+#else
+    return fclose( self->file ) == 0 ? paNoError : paInternalError;
+#endif
+}
+
+
+/* header ----------------------------------------------------------------- */
+
+static void PutLittleEndian( unsigned char *p, PaRecorderSize value, int bytes )
+{
+    int i;
+    for( i = 0; i < bytes; ++i )
+    {
+        p[i] = (unsigned char)( value & 0xFF );
+        value >>= 8;
+    }
+}
+
+
+/* Write the header for dataBytes bytes of samples to header, which must hold
+   PA_RECORDER_MAX_HEADER_SIZE bytes, and return its size. */
+static int BuildRecorderHeader( const PaUtilRecorder *self, unsigned char *header )
+{
+    static const unsigned char subFormatGuidTail[14] =
+        { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+    int extensible = self->channelCount > 2;
+    int fmtSize = extensible ? PA_RECORDER_FMT_EXTENSIBLE_SIZE : PA_RECORDER_FMT_SIZE;
+    int size = PA_RECORDER_FMT_OFFSET + 8 + fmtSize + 8;
+    PaRecorderSize padding = self->dataBytes & 1;
+    PaRecorderSize riffBytes = (PaRecorderSize)size - 8 + self->dataBytes + padding;
+    int rf64 = riffBytes > 0xFFFFFFFFUL;
+    unsigned char *p = header;
+
+    memset( header, 0, PA_RECORDER_MAX_HEADER_SIZE );
+
+    memcpy( p, rf64 ? "RF64" : "RIFF", 4 );
+    PutLittleEndian( p + 4, rf64 ? 0xFFFFFFFFUL : riffBytes, 4 );
+    memcpy( p + 8, "WAVE", 4 );
+    p += 12;
+
+    /* ds64, or JUNK reserving its space */
+    memcpy( p, rf64 ? "ds64" : "JUNK", 4 );
+    PutLittleEndian( p + 4, PA_RECORDER_DS64_SIZE, 4 );
+    if( rf64 )
+    {
+        PutLittleEndian( p + 8, riffBytes, 8 );
+        PutLittleEndian( p + 16, self->dataBytes, 8 );
+        PutLittleEndian( p + 24, self->dataBytes / self->bytesPerFrame, 8 );
+        /* table length 0 */
+    }
+    p += 8 + PA_RECORDER_DS64_SIZE;
+
+    memcpy( p, "fmt ", 4 );
+    PutLittleEndian( p + 4, fmtSize, 4 );
+    PutLittleEndian( p + 8, extensible ? PA_RECORDER_WAVE_FORMAT_EXTENSIBLE : self->formatTag, 2 );
+    PutLittleEndian( p + 10, self->channelCount, 2 );
+    PutLittleEndian( p + 12, (PaRecorderSize)self->sampleRate, 4 );
+    PutLittleEndian( p + 16, (PaRecorderSize)self->sampleRate * self->bytesPerFrame, 4 );
+    PutLittleEndian( p + 20, self->bytesPerFrame, 2 );
+    PutLittleEndian( p + 22, self->bytesPerSample * 8, 2 );
+    if( extensible )
+    {
+        PutLittleEndian( p + 24, 22, 2 ); /* cbSize */
+        PutLittleEndian( p + 26, self->bytesPerSample * 8, 2 ); /* valid bits */
+        PutLittleEndian( p + 28, 0, 4 ); /* channel mask: no speaker positions */
+        PutLittleEndian( p + 32, self->formatTag, 2 );
+        memcpy( p + 34, subFormatGuidTail, sizeof(subFormatGuidTail) );
+    }
+    p += 8 + fmtSize;
+
+    memcpy( p, "data", 4 );
+    PutLittleEndian( p + 4, rf64 ? 0xFFFFFFFFUL : self->dataBytes, 4 );
+
+    return size;
+}
+
+
+/* writer thread ---------------------------------------------------------- */
+
+/* Copy frames from the ring buffer to the staging buffer, swapping samples
+   to little endian. */
+static void CopyToStaging( PaUtilRecorder *self, const void *frames, ring_buffer_size_t frameCount )
+{
+    unsigned long bytes = (unsigned long)frameCount * self->bytesPerFrame;
+    unsigned char *dest = self->staging + self->stagingUsed;
+
+    memcpy( dest, frames, bytes );
+#ifdef PA_BIG_ENDIAN
+    if( self->bytesPerSample > 1 )
+    {
+        unsigned long i;
+        int j;
+        for( i = 0; i < bytes; i += self->bytesPerSample )
+        {
+            for( j = 0; j < self->bytesPerSample / 2; ++j )
+            {
+                unsigned char t = dest[i + j];
+                dest[i + j] = dest[i + self->bytesPerSample - 1 - j];
+                dest[i + self->bytesPerSample - 1 - j] = t;
+            }
+        }
+    }
+#endif
+    self->stagingUsed += bytes;
+    self->dataBytes += bytes;
+}
+
+
+/* Move everything queued to the staging buffer, writing each full block. */
+static void DrainRecorder( PaUtilRecorder *self )
+{
+    ring_buffer_size_t available;
+
+    while( ( available = PaUtil_GetRingBufferReadAvailable( &self->ringBuffer ) ) > 0 )
+    {
+        /* just enough whole frames to complete the block */
+        ring_buffer_size_t frameCount = (ring_buffer_size_t)
+                ( ( self->blockBytes - self->stagingUsed + self->bytesPerFrame - 1 ) / self->bytesPerFrame );
+        void *data1, *data2;
+        ring_buffer_size_t size1, size2;
+
+        if( frameCount > available )
+            frameCount = available;
+
+        PaUtil_GetRingBufferReadRegions( &self->ringBuffer, frameCount, &data1, &size1, &data2, &size2 );
+        CopyToStaging( self, data1, size1 );
+        if( size2 > 0 )
+            CopyToStaging( self, data2, size2 );
+        PaUtil_AdvanceRingBufferReadIndex( &self->ringBuffer, size1 + size2 );
+
+        if( self->stagingUsed >= self->blockBytes )
+        {
+            /* after a failure, keep emptying the ring buffer so the callback isn't affected */
+            if( self->writeError == paNoError )
+                self->writeError = WriteRecorderFile( self, self->staging, self->blockBytes );
+
+            self->stagingUsed -= self->blockBytes;
+            memmove( self->staging, self->staging + self->blockBytes, self->stagingUsed );
+        }
+    }
+}
+
+
+static PaError FinishRecorderFile( PaUtilRecorder *self )
+{
+    unsigned char header[PA_RECORDER_MAX_HEADER_SIZE];
+    PaError result = self->writeError;
+
+    EndDirectIO( self );
+
+    /* data chunks of odd size are padded */
+    if( self->dataBytes & 1 )
+        self->staging[self->stagingUsed++] = 0;
+
+    if( result == paNoError && self->stagingUsed > 0 )
+        result = WriteRecorderFile( self, self->staging, self->stagingUsed );
+
+    BuildRecorderHeader( self, header );
+    if( result == paNoError )
+        result = RewriteRecorderHeader( self, header );
+
+    if( CloseRecorderFile( self ) != paNoError && result == paNoError )
+        result = paInternalError;
+
+    return result;
+}
+
+
+static void RecorderWriterThread( void *userData )
+{
+    PaUtilRecorder *self = (PaUtilRecorder*)userData;
+    int stopping;
+
+    do
+    {
+        PaUtil_WaitSemaphore( self->dataReady, PA_RECORDER_POLL_SECONDS );
+
+        /* frames queued before the stop request are drained below */
+        stopping = self->stopRequested;
+        PaUtil_ReadMemoryBarrier();
+
+        DrainRecorder( self );
+    }
+    while( !stopping );
+
+    self->writeError = FinishRecorderFile( self );
+    PaUtil_PostSemaphore( self->writerDone );
+}
+
+
+/* public functions ------------------------------------------------------- */
+
+static void FreeRecorder( PaUtilRecorder *self )
+{
+    if( self->dataReady )
+        PaUtil_DestroySemaphore( self->dataReady );
+    if( self->writerDone )
+        PaUtil_DestroySemaphore( self->writerDone );
+    if( self->stagingMemory )
+        PaUtil_FreeMemory( self->stagingMemory );
+    if( self->ringBufferData )
+        PaUtil_FreeMemory( self->ringBufferData );
+    PaUtil_FreeMemory( self );
+}
+
+
+PaError PaUtil_OpenRecorder( PaUtilRecorder **recorder, const char *path,
+        int channelCount, PaSampleFormat sampleFormat, double sampleRate,
+        double bufferSeconds, unsigned long flags )
+{
+    PaError result = paNoError;
+    PaUtilRecorder *self = NULL;
+    ring_buffer_size_t frameCount;
+    unsigned long ringBytes;
+    int fileOpen = 0;
+
+    *recorder = NULL;
+
+    if( channelCount <= 0 || channelCount > 0xFFFF )
+        return paInvalidChannelCount;
+
+    self = (PaUtilRecorder*)PaUtil_AllocateMemory( sizeof(PaUtilRecorder) );
+    if( !self )
+        return paInsufficientMemory;
+    memset( self, 0, sizeof(PaUtilRecorder) );
+
+    self->channelCount = channelCount;
+    self->sampleRate = sampleRate;
+    self->nonInterleaved = ( sampleFormat & paNonInterleaved ) != 0;
+    self->formatTag = PA_RECORDER_WAVE_FORMAT_PCM;
+
+    switch( sampleFormat & ~paNonInterleaved )
+    {
+    case paUInt8: self->bytesPerSample = 1; break; /* 8 bit WAV samples are unsigned */
+    case paInt16: self->bytesPerSample = 2; break;
+    case paInt24: self->bytesPerSample = 3; break;
+    case paInt32: self->bytesPerSample = 4; break;
+    case paFloat32:
+        self->bytesPerSample = 4;
+        self->formatTag = PA_RECORDER_WAVE_FORMAT_IEEE_FLOAT;
+        break;
+    case paFloat64:
+        self->bytesPerSample = 8;
+        self->formatTag = PA_RECORDER_WAVE_FORMAT_IEEE_FLOAT;
+        break;
+    default:
+        result = paSampleFormatNotSupported;
+        goto error;
+    }
+    self->bytesPerFrame = self->bytesPerSample * channelCount;
+
+    /* a power of two number of frames, holding at least four blocks */
+    frameCount = 1;
+    while( frameCount < bufferSeconds * sampleRate
+            || (unsigned long)frameCount * self->bytesPerFrame < 4 * PA_RECORDER_ALIGNMENT )
+        frameCount *= 2;
+    ringBytes = (unsigned long)frameCount * self->bytesPerFrame;
+
+    self->blockBytes = ( ringBytes / 4 ) & ~(unsigned long)( PA_RECORDER_ALIGNMENT - 1 );
+    if( self->blockBytes > PA_RECORDER_MAX_BLOCK_BYTES )
+        self->blockBytes = PA_RECORDER_MAX_BLOCK_BYTES;
+    self->wakeFrames = (ring_buffer_size_t)( self->blockBytes / self->bytesPerFrame );
+
+    self->ringBufferData = PaUtil_AllocateMemory( (long)ringBytes );
+    if( !self->ringBufferData )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+    PaUtil_InitializeRingBuffer( &self->ringBuffer, self->bytesPerFrame, frameCount, self->ringBufferData );
+
+    /* a block, the frame overlapping its end and the alignment */
+    self->stagingMemory = (unsigned char*)PaUtil_AllocateMemory(
+            (long)( self->blockBytes + self->bytesPerFrame + PA_RECORDER_ALIGNMENT ) );
+    if( !self->stagingMemory )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+    self->staging = self->stagingMemory + ( PA_RECORDER_ALIGNMENT
+            - ( (unsigned long)(size_t)self->stagingMemory & ( PA_RECORDER_ALIGNMENT - 1 ) ) );
+
+    /* the header goes out with the first block and is completed on close */
+    self->headerSize = BuildRecorderHeader( self, self->staging );
+    self->stagingUsed = self->headerSize;
+
+    if( ( result = PaUtil_CreateSemaphore( &self->dataReady ) ) != paNoError )
+        goto error;
+    if( ( result = PaUtil_CreateSemaphore( &self->writerDone ) ) != paNoError )
+        goto error;
+
+    if( ( result = OpenRecorderFile( self, path, flags ) ) != paNoError )
+        goto error;
+    fileOpen = 1;
+
+    if( ( result = PaUtil_StartDetachedThread( RecorderWriterThread, self ) ) != paNoError )
+        goto error;
+
+    *recorder = self;
+    return paNoError;
+
+error:
+    if( fileOpen )
+        CloseRecorderFile( self );
+    FreeRecorder( self );
+    return result;
+}
+
+
+unsigned long PaUtil_WriteRecorder( PaUtilRecorder *self,
+        const void *buffer, unsigned long frameCount )
+{
+    ring_buffer_size_t writable = PaUtil_GetRingBufferWriteAvailable( &self->ringBuffer );
+    ring_buffer_size_t count = ( frameCount < (unsigned long)writable ) ? (ring_buffer_size_t)frameCount : writable;
+
+    if( count > 0 )
+    {
+        if( self->nonInterleaved )
+        {
+            const unsigned char * const *channels = (const unsigned char * const *)buffer;
+            void *data[2];
+            ring_buffer_size_t size[2];
+            ring_buffer_size_t offset = 0;
+            int region, channel, i;
+
+            PaUtil_GetRingBufferWriteRegions( &self->ringBuffer, count, &data[0], &size[0], &data[1], &size[1] );
+            for( region = 0; region < 2; ++region )
+            {
+                for( channel = 0; channel < self->channelCount; ++channel )
+                {
+                    const unsigned char *src = channels[channel] + (unsigned long)offset * self->bytesPerSample;
+                    unsigned char *dest = (unsigned char*)data[region] + channel * self->bytesPerSample;
+                    ring_buffer_size_t frame;
+
+                    for( frame = 0; frame < size[region]; ++frame )
+                    {
+                        for( i = 0; i < self->bytesPerSample; ++i )
+                            dest[i] = src[i];
+                        src += self->bytesPerSample;
+                        dest += self->bytesPerFrame;
+                    }
+                }
+                offset += size[region];
+            }
+            PaUtil_AdvanceRingBufferWriteIndex( &self->ringBuffer, count );
+        }
+        else
+        {
+            PaUtil_WriteRingBuffer( &self->ringBuffer, buffer, count );
+        }
+
+        if( PaUtil_GetRingBufferReadAvailable( &self->ringBuffer ) >= self->wakeFrames )
+            PaUtil_PostSemaphore( self->dataReady );
+    }
+
+    if( (unsigned long)count < frameCount )
+        self->droppedFrames += frameCount - count;
+
+    return (unsigned long)count;
+}
+
+
+unsigned long PaUtil_GetRecorderDroppedFrames( const PaUtilRecorder *self )
+{
+    return self->droppedFrames;
+}
+
+
+PaError PaUtil_CloseRecorder( PaUtilRecorder *self )
+{
+    PaError result;
+
+    PaUtil_WriteMemoryBarrier();
+    self->stopRequested = 1;
+    PaUtil_PostSemaphore( self->dataReady );
+
+    while( PaUtil_WaitSemaphore( self->writerDone, 1.0 ) != paNoError )
+        ; /* the disk may take a while to accept the last block */
+
+    result = self->writeError;
+    FreeRecorder( self );
+    return result;
+}
@@ -0,0 +1,124 @@
+#ifndef PA_RECORDER_H
+#define PA_RECORDER_H
+/*
+ * Portable Audio I/O Library streaming file recorder
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Records a stream's input to a WAV file without doing file I/O in
+ the stream callback.
+
+ The callback copies its frames into a PaUtilRingBuffer with
+ PaUtil_WriteRecorder(), which never blocks nor allocates. A writer thread
+ moves them from the ring buffer into a staging buffer and writes it to the
+ file in large blocks aligned to PA_RECORDER_ALIGNMENT, waking when the
+ callback has queued a block. Frames the writer can't keep up with are
+ dropped and counted rather than delaying the callback.
+
+ The file starts with a fixed size WAV header reserving room for an RF64
+ ds64 chunk. When the recorder is closed, the header is rewritten with the
+ final sizes, as RF64 if the data is larger than a RIFF file can describe.
+
+ On Linux, paUtilRecorderDirectIO opens the file with O_DIRECT so that long
+ recordings don't fill the page cache. Elsewhere, or if the file system
+ refuses O_DIRECT, the flag is ignored.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** Alignment in bytes of the recorder's file writes and their sizes. */
+#define PA_RECORDER_ALIGNMENT   (4096)
+
+
+/** Flags of PaUtil_OpenRecorder(). */
+#define paUtilRecorderDirectIO  (0x01) /**< bypass the page cache where possible */
+
+
+typedef struct PaUtilRecorder PaUtilRecorder;
+
+
+/** Create a WAV file at path and start the recorder's writer thread.
+
+ @param sampleFormat paUInt8, paInt16, paInt24, paInt32, paFloat32 or paFloat64, the
+ format of the frames passed to PaUtil_WriteRecorder() and of the file.
+ With paNonInterleaved, PaUtil_WriteRecorder() takes an array of one buffer
+ per channel and interleaves them.
+
+ @param bufferSeconds How much audio the ring buffer holds, the longest the
+ writer thread may be held up by the disk without frames being dropped.
+
+ @return paNoError, paSampleFormatNotSupported, paInvalidChannelCount,
+ paInsufficientMemory, or paInternalError if the file couldn't be created.
+*/
+PaError PaUtil_OpenRecorder( PaUtilRecorder **recorder, const char *path,
+        int channelCount, PaSampleFormat sampleFormat, double sampleRate,
+        double bufferSeconds, unsigned long flags );
+
+
+/** Queue frameCount frames for writing. Safe to call from a stream
+ callback, which must be the only thread calling it.
+
+ @return The number of frames queued, less than frameCount if the ring
+ buffer was full. The others are counted as dropped.
+*/
+unsigned long PaUtil_WriteRecorder( PaUtilRecorder *recorder,
+        const void *buffer, unsigned long frameCount );
+
+
+/** The number of frames dropped because the ring buffer was full. */
+unsigned long PaUtil_GetRecorderDroppedFrames( const PaUtilRecorder *recorder );
+
+
+/** Write the queued frames, complete the file's header and free the
+ recorder. The stream writing to it must be stopped.
+
+ @return paNoError, or paInternalError if writing the file failed at any
+ point. The recorder is freed in either case.
+*/
+PaError PaUtil_CloseRecorder( PaUtilRecorder *recorder );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_RECORDER_H */
@@ -0,0 +1,589 @@
+/*
+ * Portable Audio I/O Library sample rate converter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Polyphase sample rate converter implementation.
+
+ Output frame n is centred at input time n * inputRate / outputRate. Its
+ filter covers the tapCount input frames from (tapCount / 2 - 1) frames
+ before to tapCount / 2 frames after that instant, so the history starts with
+ tapCount / 2 - 1 frames of silence and the converter lags tapCount / 2
+ input frames behind.
+
+ When downsampling the cutoff is lowered to the output Nyquist frequency and
+ the filter is stretched by the same factor to keep its transition band.
+*/
+
+
+#include <math.h>
+#include <string.h> /* memset, memmove */
+
+#include "pa_resampler.h"
+#include "pa_allocation.h"
+#include "pa_cpufeatures.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PA_RESAMPLER_SSE2_
+#include <emmintrin.h>
+
+#if defined(__clang__) || \
+    ( defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) )
+#define PA_RESAMPLER_AVX2_
+#define PA_RESAMPLER_AVX2_TARGET_ __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define PA_RESAMPLER_AVX2_
+#define PA_RESAMPLER_AVX2_TARGET_
+#endif
+
+#ifdef PA_RESAMPLER_AVX2_
+#include <immintrin.h>
+#endif
+#endif /* PA_RESAMPLER_SSE2_ */
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+
+#define PA_RESAMPLER_PI_                    (3.14159265358979323846)
+
+/* tap counts are kept a multiple of this so the dot products need no tail */
+#define PA_RESAMPLER_TAP_MULTIPLE_          (8)
+#define PA_RESAMPLER_MAX_TAPS_              (1024)
+
+/* used when the ratio is not exact */
+#define PA_RESAMPLER_INTERPOLATED_PHASES_   (512)
+#define PA_RESAMPLER_FRACTIONS_PER_PHASE_   (4194304)
+
+#define PA_RESAMPLER_ALIGNMENT_             (32)
+
+
+static const struct
+{
+    unsigned int tapCount;
+    double passband;        /* the cutoff, relative to the lower Nyquist frequency */
+    double kaiserBeta;
+}
+resamplerQualities_[] =
+{
+    { 16, 0.85, 6.0 },      /* paUtilResamplerFastQuality */
+    { 32, 0.91, 8.5 },      /* paUtilResamplerMediumQuality */
+    { 64, 0.95, 10.5 }      /* paUtilResamplerBestQuality */
+};
+
+
+#if !defined(PA_RESAMPLER_SSE2_) && !defined(__ARM_NEON__)
+
+static float DotProduct_C( const float *a, const float *b, unsigned int count )
+{
+    float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+    unsigned int i;
+
+    for( i = 0; i < count; i += 4 )
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+#endif /* !PA_RESAMPLER_SSE2_ && !__ARM_NEON__ */
+
+
+#ifdef PA_RESAMPLER_SSE2_
+
+/* a is aligned, b is not */
+static float DotProduct_SSE2( const float *a, const float *b, unsigned int count )
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    unsigned int i;
+
+    for( i = 0; i < count; i += 8 )
+    {
+        s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_load_ps( a + i ), _mm_loadu_ps( b + i ) ) );
+        s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_load_ps( a + i + 4 ), _mm_loadu_ps( b + i + 4 ) ) );
+    }
+
+    s0 = _mm_add_ps( s0, s1 );
+    s0 = _mm_add_ps( s0, _mm_movehl_ps( s0, s0 ) );
+    s0 = _mm_add_ss( s0, _mm_shuffle_ps( s0, s0, 1 ) );
+    return _mm_cvtss_f32( s0 );
+}
+
+#ifdef PA_RESAMPLER_AVX2_
+
+PA_RESAMPLER_AVX2_TARGET_ static float DotProduct_AVX2( const float *a, const float *b, unsigned int count )
+{
+    __m256 s = _mm256_setzero_ps();
+    __m128 h;
+    unsigned int i;
+
+    for( i = 0; i < count; i += 8 )
+        s = _mm256_add_ps( s, _mm256_mul_ps( _mm256_load_ps( a + i ), _mm256_loadu_ps( b + i ) ) );
+
+    h = _mm_add_ps( _mm256_castps256_ps128( s ), _mm256_extractf128_ps( s, 1 ) );
+    h = _mm_add_ps( h, _mm_movehl_ps( h, h ) );
+    h = _mm_add_ss( h, _mm_shuffle_ps( h, h, 1 ) );
+    return _mm_cvtss_f32( h );
+}
+
+#endif /* PA_RESAMPLER_AVX2_ */
+#endif /* PA_RESAMPLER_SSE2_ */
+
+
+#ifdef __ARM_NEON__
+
+static float DotProduct_NEON( const float *a, const float *b, unsigned int count )
+{
+    float32x4_t s0 = vdupq_n_f32( 0.f ), s1 = vdupq_n_f32( 0.f );
+    float32x2_t s;
+    unsigned int i;
+
+    for( i = 0; i < count; i += 8 )
+    {
+        s0 = vmlaq_f32( s0, vld1q_f32( a + i ), vld1q_f32( b + i ) );
+        s1 = vmlaq_f32( s1, vld1q_f32( a + i + 4 ), vld1q_f32( b + i + 4 ) );
+    }
+
+    s0 = vaddq_f32( s0, s1 );
+    s = vadd_f32( vget_low_f32( s0 ), vget_high_f32( s0 ) );
+    return vget_lane_f32( vpadd_f32( s, s ), 0 );
+}
+
+#endif /* __ARM_NEON__ */
+
+
+static PaUtilResamplerDotProduct* SelectDotProduct( void )
+{
+#ifdef PA_RESAMPLER_SSE2_
+#ifdef PA_RESAMPLER_AVX2_
+    if( PaUtil_GetCpuFeatures() & paCpuAVX2 )
+        return DotProduct_AVX2;
+#endif
+    return DotProduct_SSE2;
+#elif defined(__ARM_NEON__)
+    return DotProduct_NEON;
+#else
+    return DotProduct_C;
+#endif
+}
+
+
+/* zeroth order modified Bessel function of the first kind */
+static double BesselI0( double x )
+{
+    double sum = 1., term = 1., halfX = x * .5;
+    int k;
+
+    for( k = 1; k < 64 && term > sum * 1e-12; ++k )
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+    }
+
+    return sum;
+}
+
+
+static unsigned long GreatestCommonDivisor( unsigned long a, unsigned long b )
+{
+    while( b != 0 )
+    {
+        unsigned long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+
+/* Set the step for an interpolated ratio, rounded to 1 / 2^31 frames. */
+static void SetInterpolatedStep( PaUtilResampler *r, double step )
+{
+    r->integerStep = (unsigned long)floor( step );
+    r->fractionalStep = (unsigned long)floor( (step - r->integerStep) * r->phaseModulus + .5 );
+    if( r->fractionalStep == r->phaseModulus )
+    {
+        ++r->integerStep;
+        r->fractionalStep = 0;
+    }
+}
+
+
+/* Choose the phases and the step through them. The ratio is exact if both
+   rates are integers, the reduced output rate is small enough to be the
+   number of phases and the ratio is fixed. Otherwise each phase is divided
+   into fractions and the coefficients are interpolated.
+*/
+static void CalculateSteps( PaUtilResampler *r, double inputSampleRate, double outputSampleRate )
+{
+    double inputRate = floor( inputSampleRate + .5 );
+    double outputRate = floor( outputSampleRate + .5 );
+
+    r->nominalStep = inputSampleRate / outputSampleRate;
+
+    if( r->maxRatioDeviation == 0. && inputRate == inputSampleRate && outputRate == outputSampleRate
+            && inputRate <= 4294967295. && outputRate <= 4294967295. )
+    {
+        unsigned long g = GreatestCommonDivisor( (unsigned long)inputRate, (unsigned long)outputRate );
+        unsigned long in = (unsigned long)inputRate / g;
+        unsigned long out = (unsigned long)outputRate / g;
+
+        if( out <= PA_RESAMPLER_MAX_EXACT_PHASES )
+        {
+            r->phaseCount = out;
+            r->fractionsPerPhase = 1;
+            r->phaseModulus = out;
+            r->integerStep = in / out;
+            r->fractionalStep = in % out;
+            return;
+        }
+    }
+
+    r->phaseCount = PA_RESAMPLER_INTERPOLATED_PHASES_;
+    r->fractionsPerPhase = PA_RESAMPLER_FRACTIONS_PER_PHASE_;
+    r->phaseModulus = r->phaseCount * r->fractionsPerPhase;
+    SetInterpolatedStep( r, r->nominalStep );
+}
+
+
+static void CalculateCoefficients( PaUtilResampler *r, double cutoff, double kaiserBeta )
+{
+    unsigned long p;
+    unsigned int k;
+    double halfLength = r->tapCount / 2;
+    double windowScale = 1. / BesselI0( kaiserBeta );
+
+    /* one set beyond the last phase, the neighbour of the last phase when
+       interpolating */
+    for( p = 0; p <= r->phaseCount; ++p )
+    {
+        float *c = r->coefficients + p * r->tapCount;
+        double offset = (double)p / r->phaseCount;
+        double sum = 0.;
+
+        for( k = 0; k < r->tapCount; ++k )
+        {
+            double d = ((double)k - (halfLength - 1.)) - offset;
+            double x = d / halfLength;
+            double t = 2. * cutoff * d;
+            double h = 2. * cutoff;
+
+            if( t != 0. )
+                h *= sin( PA_RESAMPLER_PI_ * t ) / (PA_RESAMPLER_PI_ * t);
+
+            if( x * x < 1. )
+                h *= BesselI0( kaiserBeta * sqrt( 1. - x * x ) ) * windowScale;
+            else
+                h = 0.;
+
+            c[k] = (float)h;
+            sum += h;
+        }
+
+        /* unity gain at DC for every phase */
+        for( k = 0; k < r->tapCount; ++k )
+            c[k] = (float)(c[k] / sum);
+    }
+}
+
+
+PaError PaUtil_InitializeResampler( PaUtilResampler *r,
+        unsigned int channelCount, double inputSampleRate, double outputSampleRate,
+        PaUtilResamplerQuality quality, double maxRatioDeviation, unsigned long maxInputFrames )
+{
+    PaError result = paNoError;
+    double ratio;
+    unsigned long tapCount;
+
+    r->coefficients = 0;
+    r->history = 0;
+
+    if( channelCount == 0 || inputSampleRate <= 0. || outputSampleRate <= 0. )
+        return paInvalidSampleRate;
+
+    ratio = outputSampleRate / inputSampleRate;
+    if( ratio < 1. / 64. || ratio > 64. || maxRatioDeviation < 0. || maxRatioDeviation >= .5 )
+        return paInvalidSampleRate;
+
+    if( (unsigned int)quality >= sizeof(resamplerQualities_) / sizeof(resamplerQualities_[0]) )
+        quality = paUtilResamplerMediumQuality;
+
+    r->channelCount = channelCount;
+    r->inputSampleRate = inputSampleRate;
+    r->maxRatioDeviation = maxRatioDeviation;
+
+    tapCount = resamplerQualities_[quality].tapCount;
+    if( ratio < 1. )
+        tapCount = (unsigned long)ceil( tapCount / ratio );
+    tapCount = (tapCount + PA_RESAMPLER_TAP_MULTIPLE_ - 1) & ~(unsigned long)(PA_RESAMPLER_TAP_MULTIPLE_ - 1);
+    if( tapCount > PA_RESAMPLER_MAX_TAPS_ )
+        tapCount = PA_RESAMPLER_MAX_TAPS_;
+    r->tapCount = (unsigned int)tapCount;
+
+    CalculateSteps( r, inputSampleRate, outputSampleRate );
+
+    r->coefficients = (float*)PaUtil_AllocateAlignedMemory(
+            (long)((r->phaseCount + 1) * r->tapCount * sizeof(float)), PA_RESAMPLER_ALIGNMENT_ );
+    if( !r->coefficients )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    CalculateCoefficients( r,
+            .5 * resamplerQualities_[quality].passband * (ratio < 1. ? ratio : 1.),
+            resamplerQualities_[quality].kaiserBeta );
+
+    /* room for a full filter, a block of input and the frames stepped over
+       by one output frame at the slowest ratio */
+    r->framesPerChannel = r->tapCount + maxInputFrames
+            + (unsigned long)ceil( r->nominalStep / (1. - maxRatioDeviation) ) + 1;
+    r->framesPerChannel = (r->framesPerChannel + PA_RESAMPLER_TAP_MULTIPLE_ - 1)
+            & ~(unsigned long)(PA_RESAMPLER_TAP_MULTIPLE_ - 1);
+
+    r->history = (float*)PaUtil_AllocateAlignedMemory(
+            (long)(r->framesPerChannel * channelCount * sizeof(float)), PA_RESAMPLER_ALIGNMENT_ );
+    if( !r->history )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    r->dotProduct = SelectDotProduct();
+
+    PaUtil_ResetResampler( r );
+
+    return result;
+
+error:
+    PaUtil_TerminateResampler( r );
+    return result;
+}
+
+
+void PaUtil_TerminateResampler( PaUtilResampler *r )
+{
+    if( r->coefficients )
+    {
+        PaUtil_FreeAlignedMemory( r->coefficients );
+        r->coefficients = 0;
+    }
+
+    if( r->history )
+    {
+        PaUtil_FreeAlignedMemory( r->history );
+        r->history = 0;
+    }
+}
+
+
+long PaUtil_GetResamplerMemoryUsage( const PaUtilResampler *r )
+{
+    long result = 0;
+
+    if( r->coefficients )
+        result += (long)((r->phaseCount + 1) * r->tapCount * sizeof(float));
+
+    if( r->history )
+        result += (long)(r->framesPerChannel * r->channelCount * sizeof(float));
+
+    return result;
+}
+
+
+void PaUtil_AdjustResamplerRatio( PaUtilResampler *r, double factor )
+{
+    if( r->maxRatioDeviation == 0. )
+        return;
+
+    if( factor < 1. - r->maxRatioDeviation )
+        factor = 1. - r->maxRatioDeviation;
+    else if( factor > 1. + r->maxRatioDeviation )
+        factor = 1. + r->maxRatioDeviation;
+
+    SetInterpolatedStep( r, r->nominalStep / factor );
+}
+
+
+void PaUtil_ResetResampler( PaUtilResampler *r )
+{
+    unsigned int i;
+
+    r->historyFrames = r->tapCount / 2 - 1;
+    r->position = 0;
+    r->phase = 0;
+
+    for( i = 0; i < r->channelCount; ++i )
+        memset( r->history + i * r->framesPerChannel, 0, r->historyFrames * sizeof(float) );
+}
+
+
+double PaUtil_GetResamplerLatency( PaUtilResampler *r )
+{
+    return (r->tapCount / 2) / r->inputSampleRate;
+}
+
+
+double PaUtil_GetResamplerInputDelay( PaUtilResampler *r )
+{
+    return (double)r->historyFrames - (double)(r->position + r->tapCount / 2 - 1)
+            - (double)r->phase / r->phaseModulus;
+}
+
+
+unsigned long PaUtil_GetResamplerRequiredInputFrameCount( PaUtilResampler *r,
+        unsigned long frameCount )
+{
+    double phase;
+    unsigned long lastPosition, requiredFrames;
+
+    if( frameCount == 0 )
+        return 0;
+
+    /* the products stay well below 2^53 so the double is exact */
+    phase = (double)r->phase + (double)(frameCount - 1) * (double)r->fractionalStep;
+    lastPosition = r->position + (frameCount - 1) * r->integerStep
+            + (unsigned long)floor( phase / r->phaseModulus );
+
+    requiredFrames = lastPosition + r->tapCount;
+    return (requiredFrames > r->historyFrames) ? requiredFrames - r->historyFrames : 0;
+}
+
+
+/* drop the frames no longer under the filter */
+static void CompactHistory( PaUtilResampler *r )
+{
+    unsigned long dropped = (r->position < r->historyFrames) ? r->position : r->historyFrames;
+    unsigned int i;
+
+    if( dropped == 0 )
+        return;
+
+    for( i = 0; i < r->channelCount; ++i )
+    {
+        float *channel = r->history + i * r->framesPerChannel;
+        memmove( channel, channel + dropped, (r->historyFrames - dropped) * sizeof(float) );
+    }
+
+    r->historyFrames -= dropped;
+    r->position -= dropped;
+}
+
+
+unsigned long PaUtil_Resample( PaUtilResampler *r,
+        float *output, unsigned long maxOutputFrames,
+        const float *input, unsigned long *inputFrameCount )
+{
+    unsigned long framesWritten = 0, framesRead = 0;
+    unsigned long inputFrames = *inputFrameCount;
+    unsigned int channelCount = r->channelCount;
+    unsigned int tapCount = r->tapCount;
+    float fractionScale = 1.f / (float)r->fractionsPerPhase;
+
+    for( ;; )
+    {
+        unsigned long frameCount, i;
+        unsigned int j;
+
+        while( framesWritten < maxOutputFrames && r->position + tapCount <= r->historyFrames )
+        {
+            const float *c = r->coefficients + (r->phase / r->fractionsPerPhase) * tapCount;
+            const float *x = r->history + r->position;
+
+            if( r->fractionsPerPhase == 1 )
+            {
+                for( j = 0; j < channelCount; ++j )
+                    *output++ = r->dotProduct( c, x + j * r->framesPerChannel, tapCount );
+            }
+            else
+            {
+                float weight = (float)(r->phase % r->fractionsPerPhase) * fractionScale;
+
+                for( j = 0; j < channelCount; ++j )
+                {
+                    float y0 = r->dotProduct( c, x + j * r->framesPerChannel, tapCount );
+                    float y1 = r->dotProduct( c + tapCount, x + j * r->framesPerChannel, tapCount );
+                    *output++ = y0 + weight * (y1 - y0);
+                }
+            }
+
+            r->position += r->integerStep;
+            r->phase += r->fractionalStep;
+            if( r->phase >= r->phaseModulus )
+            {
+                r->phase -= r->phaseModulus;
+                ++r->position;
+            }
+
+            ++framesWritten;
+        }
+
+        if( framesRead == inputFrames )
+            break;
+
+        if( r->historyFrames + (inputFrames - framesRead) > r->framesPerChannel )
+            CompactHistory( r );
+
+        frameCount = r->framesPerChannel - r->historyFrames;
+        if( frameCount > inputFrames - framesRead )
+            frameCount = inputFrames - framesRead;
+        if( frameCount == 0 )
+            break; /* the output is full and so is the history */
+
+        /* append, one block per channel */
+        for( j = 0; j < channelCount; ++j )
+        {
+            float *dest = r->history + j * r->framesPerChannel + r->historyFrames;
+            const float *src = input + framesRead * channelCount + j;
+
+            for( i = 0; i < frameCount; ++i )
+            {
+                dest[i] = *src;
+                src += channelCount;
+            }
+        }
+
+        r->historyFrames += frameCount;
+        framesRead += frameCount;
+    }
+
+    *inputFrameCount = framesRead;
+    return framesWritten;
+}
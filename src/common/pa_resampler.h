@@ -0,0 +1,216 @@
+#ifndef PA_RESAMPLER_H
+#define PA_RESAMPLER_H
+/*
+ * Portable Audio I/O Library sample rate converter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Polyphase sample rate converter for interleaved paFloat32 buffers.
+
+ The converter is a Kaiser windowed sinc filter evaluated at the phases of
+ the conversion ratio. When both rates are integers whose ratio reduces to
+ at most PA_RESAMPLER_MAX_EXACT_PHASES phases (44100 <-> 48000 needs 160) one
+ set of coefficients is kept per phase and the conversion is exact, other
+ ratios interpolate between the coefficients of neighbouring phases.
+
+ Input frames are kept per channel so that every output sample is a single
+ contiguous dot product, which is done with SSE2, AVX2 or NEON where
+ available.
+
+ A resampler initialized with a nonzero maximum ratio deviation always
+ interpolates, its ratio can then be trimmed with PaUtil_AdjustResamplerRatio()
+ while it runs, for example to follow the drift between two clocks.
+
+ The buffer processor uses it to run the stream callback at a different
+ rate than the host, see PaUtil_InitializeResamplingBufferProcessor().
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The largest number of phases for which the conversion ratio is used
+ exactly, ratios needing more phases are approximated.
+*/
+#define PA_RESAMPLER_MAX_EXACT_PHASES   (1024)
+
+
+/** The filter quality of a resampler, a longer filter has a steeper
+ transition band and a higher stop band attenuation at the expense of more
+ latency and CPU time.
+*/
+typedef enum PaUtilResamplerQuality
+{
+    paUtilResamplerFastQuality,    /**< 16 taps, about 60 dB stop band attenuation */
+    paUtilResamplerMediumQuality,  /**< 32 taps, about 85 dB */
+    paUtilResamplerBestQuality     /**< 64 taps, more than 100 dB */
+} PaUtilResamplerQuality;
+
+
+typedef float PaUtilResamplerDotProduct( const float *a, const float *b, unsigned int count );
+
+
+/** The state of a resampler. All fields are private, use the functions
+ below.
+*/
+typedef struct PaUtilResampler
+{
+    unsigned int channelCount;
+    double inputSampleRate;
+
+    unsigned int tapCount;          /**< taps per phase, a multiple of 8 */
+    unsigned long phaseCount;       /**< coefficient sets, one extra set follows the last one */
+    unsigned long fractionsPerPhase;/**< 1 for an exact ratio */
+    unsigned long phaseModulus;     /**< phaseCount * fractionsPerPhase */
+    unsigned long integerStep;      /**< input frames per output frame ... */
+    unsigned long fractionalStep;   /**< ... plus fractionalStep / phaseModulus  */
+    double nominalStep;             /**< the step PaUtil_AdjustResamplerRatio() is relative to */
+    double maxRatioDeviation;
+    float *coefficients;            /**< (phaseCount + 1) * tapCount */
+    PaUtilResamplerDotProduct *dotProduct;
+
+    unsigned long framesPerChannel; /**< capacity of each channel's history */
+    float *history;                 /**< channelCount blocks of framesPerChannel frames */
+    unsigned long historyFrames;    /**< valid frames in each block */
+    unsigned long position;         /**< first frame under the filter for the next output frame */
+    unsigned long phase;            /**< its offset, in 1 / phaseModulus frames */
+} PaUtilResampler;
+
+
+/** Initialize a resampler.
+
+ @param resampler The resampler to initialize.
+
+ @param channelCount The number of interleaved channels.
+
+ @param inputSampleRate The rate of the frames passed to PaUtil_Resample().
+
+ @param outputSampleRate The rate of the frames it produces.
+
+ @param quality The filter length, see PaUtilResamplerQuality.
+
+ @param maxRatioDeviation The largest relative change of the ratio that
+ PaUtil_AdjustResamplerRatio() will be asked for, 0 for a fixed ratio.
+
+ @param maxInputFrames The largest number of frames that will be passed to
+ PaUtil_Resample() at once. Larger counts are accepted but may take more than
+ one call to be consumed.
+
+ @return paNoError, paInvalidSampleRate if the ratio of the rates is out of
+ range or paInsufficientMemory. The resampler must not be used or terminated
+ if initialization failed.
+*/
+PaError PaUtil_InitializeResampler( PaUtilResampler *resampler,
+        unsigned int channelCount, double inputSampleRate, double outputSampleRate,
+        PaUtilResamplerQuality quality, double maxRatioDeviation, unsigned long maxInputFrames );
+
+
+/** Free the memory of a resampler initialized with
+ PaUtil_InitializeResampler().
+*/
+void PaUtil_TerminateResampler( PaUtilResampler *resampler );
+
+
+/** Return the number of bytes of the filter coefficients and the history
+ allocated by PaUtil_InitializeResampler().
+*/
+long PaUtil_GetResamplerMemoryUsage( const PaUtilResampler *resampler );
+
+
+/** Produce factor times the nominal number of output frames per input
+ frame from now on. factor is limited to 1 +/- the maxRatioDeviation passed
+ to PaUtil_InitializeResampler() and ignored for a fixed ratio.
+*/
+void PaUtil_AdjustResamplerRatio( PaUtilResampler *resampler, double factor );
+
+
+/** Discard all buffered input, the next output is calculated from silence
+ followed by the next input.
+*/
+void PaUtil_ResetResampler( PaUtilResampler *resampler );
+
+
+/** The delay of the filter: the time between an input frame being passed in
+ and the output frame at the same instant being produced, in seconds.
+*/
+double PaUtil_GetResamplerLatency( PaUtilResampler *resampler );
+
+
+/** The distance from the instant of the next output frame to the end of the
+ input passed in so far, in input frames. Used to time stamp the frames going
+ in or coming out.
+*/
+double PaUtil_GetResamplerInputDelay( PaUtilResampler *resampler );
+
+
+/** Calculate how many more input frames PaUtil_Resample() needs before it
+ can produce frameCount output frames.
+*/
+unsigned long PaUtil_GetResamplerRequiredInputFrameCount( PaUtilResampler *resampler,
+        unsigned long frameCount );
+
+
+/** Convert interleaved paFloat32 frames.
+
+ @param resampler The resampler.
+
+ @param output Receives up to maxOutputFrames interleaved frames.
+
+ @param maxOutputFrames The capacity of output in frames.
+
+ @param input The interleaved input frames.
+
+ @param inputFrameCount On entry the number of input frames, on return the
+ number of frames that were consumed. All frames are consumed unless the
+ output filled up before the internal buffer had room for all of them.
+
+ @return The number of frames written to output. Input which is not
+ needed for these is kept for the next call.
+*/
+unsigned long PaUtil_Resample( PaUtilResampler *resampler,
+        float *output, unsigned long maxOutputFrames,
+        const float *input, unsigned long *inputFrameCount );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_RESAMPLER_H */
@@ -193,6 +193,26 @@ ring_buffer_size_t PaUtil_AdvanceRingBufferReadIndex( PaUtilRingBuffer *rbuf, ri
     return rbuf->readIndex = (rbuf->readIndex + elementCount) & rbuf->bigMask;
 }
 
+/***************************************************************************
+** On a mirrored buffer the second region directly follows the first one. */
+ring_buffer_size_t PaUtil_GetRingBufferContiguousWriteRegion( PaUtilRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                       void **dataPtr )
+{
+    ring_buffer_size_t size1, size2;
+    void *data2;
+    return PaUtil_GetRingBufferWriteRegions( rbuf, elementCount, dataPtr, &size1, &data2, &size2 );
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_GetRingBufferContiguousReadRegion( PaUtilRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                       void **dataPtr )
+{
+    ring_buffer_size_t size1, size2;
+    void *data2;
+    return PaUtil_GetRingBufferReadRegions( rbuf, elementCount, dataPtr, &size1, &data2, &size2 );
+}
+
 /***************************************************************************
 ** Return elements written. */
 ring_buffer_size_t PaUtil_WriteRingBuffer( PaUtilRingBuffer *rbuf, const void *data, ring_buffer_size_t elementCount )
@@ -235,3 +255,605 @@ ring_buffer_size_t PaUtil_ReadRingBuffer( PaUtilRingBuffer *rbuf, void *data, ri
     PaUtil_AdvanceRingBufferReadIndex( rbuf, numRead );
     return numRead;
 }
+
+/***************************************************************************
+ * Single-reader single-writer ring buffer with padded indices.
+ *
+ * Each index is stored by one thread and loaded by the other. The stores
+ * are releases, so the data copied into (or out of) the buffer is visible
+ * before the new index is; the loads are acquires, so nothing is read from
+ * (or written into) the buffer before the index that made room for it.
+ */
+#if (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || defined(__clang__)
+#   define PA_SPSC_LOAD_ACQUIRE_( index )           __atomic_load_n( &(index), __ATOMIC_ACQUIRE )
+#   define PA_SPSC_STORE_RELEASE_( index, value )   __atomic_store_n( &(index), (value), __ATOMIC_RELEASE )
+#else
+static ring_buffer_size_t SpscLoadAcquire( volatile ring_buffer_size_t *index )
+{
+    ring_buffer_size_t value = *index;
+    PaUtil_FullMemoryBarrier(); /* (read-after-read) and (write-after-read) */
+    return value;
+}
+
+static void SpscStoreRelease( volatile ring_buffer_size_t *index, ring_buffer_size_t value )
+{
+    PaUtil_FullMemoryBarrier(); /* (write-after-write) and (write-after-read) */
+    *index = value;
+}
+
+#   define PA_SPSC_LOAD_ACQUIRE_( index )           SpscLoadAcquire( &(index) )
+#   define PA_SPSC_STORE_RELEASE_( index, value )   SpscStoreRelease( &(index), (value) )
+#endif
+
+/***************************************************************************
+ * elementCount must be power of 2, returns -1 if not.
+ */
+ring_buffer_size_t PaUtil_InitializeSpscRingBuffer( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementSizeBytes, ring_buffer_size_t elementCount, void *dataPtr )
+{
+    if( ((elementCount-1) & elementCount) != 0) return -1; /* Not Power of two. */
+    rbuf->bufferSize = elementCount;
+    rbuf->buffer = (char *)dataPtr;
+    PaUtil_FlushSpscRingBuffer( rbuf );
+    rbuf->bigMask = (elementCount*2)-1;
+    rbuf->smallMask = (elementCount)-1;
+    rbuf->elementSizeBytes = elementSizeBytes;
+    return 0;
+}
+
+/***************************************************************************
+*/
+void PaUtil_FlushSpscRingBuffer( PaUtilSpscRingBuffer *rbuf )
+{
+    rbuf->writeIndex = rbuf->stagedWriteIndex = rbuf->cachedWriteIndex = 0;
+    rbuf->readIndex = rbuf->stagedReadIndex = rbuf->cachedReadIndex = 0;
+}
+
+/***************************************************************************
+** Fill in the region(s) for elementCount elements starting at index. */
+static void GetSpscRingBufferRegions( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t index, ring_buffer_size_t elementCount,
+                                      void **dataPtr1, ring_buffer_size_t *sizePtr1,
+                                      void **dataPtr2, ring_buffer_size_t *sizePtr2 )
+{
+    index &= rbuf->smallMask;
+    if( (index + elementCount) > rbuf->bufferSize )
+    {
+        ring_buffer_size_t firstHalf = rbuf->bufferSize - index;
+        *dataPtr1 = &rbuf->buffer[index*rbuf->elementSizeBytes];
+        *sizePtr1 = firstHalf;
+        *dataPtr2 = &rbuf->buffer[0];
+        *sizePtr2 = elementCount - firstHalf;
+    }
+    else
+    {
+        *dataPtr1 = &rbuf->buffer[index*rbuf->elementSizeBytes];
+        *sizePtr1 = elementCount;
+        *dataPtr2 = NULL;
+        *sizePtr2 = 0;
+    }
+}
+
+/***************************************************************************
+** Room the writer knows about, using its snapshot of the read index. */
+static ring_buffer_size_t GetCachedSpscRingBufferWriteAvailable( const PaUtilSpscRingBuffer *rbuf )
+{
+    return rbuf->bufferSize - ((rbuf->stagedWriteIndex - rbuf->cachedReadIndex) & rbuf->bigMask);
+}
+
+/***************************************************************************
+** Elements the reader knows about, using its snapshot of the write index. */
+static ring_buffer_size_t GetCachedSpscRingBufferReadAvailable( const PaUtilSpscRingBuffer *rbuf )
+{
+    return (rbuf->cachedWriteIndex - rbuf->stagedReadIndex) & rbuf->bigMask;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferWriteAvailable( PaUtilSpscRingBuffer *rbuf )
+{
+    rbuf->cachedReadIndex = PA_SPSC_LOAD_ACQUIRE_( rbuf->readIndex );
+    return GetCachedSpscRingBufferWriteAvailable( rbuf );
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferReadAvailable( PaUtilSpscRingBuffer *rbuf )
+{
+    rbuf->cachedWriteIndex = PA_SPSC_LOAD_ACQUIRE_( rbuf->writeIndex );
+    return GetCachedSpscRingBufferReadAvailable( rbuf );
+}
+
+/***************************************************************************
+** Only touches the reader's cache line when the snapshot of the read index
+** shows less room than requested.
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferWriteRegions( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                       void **dataPtr1, ring_buffer_size_t *sizePtr1,
+                                       void **dataPtr2, ring_buffer_size_t *sizePtr2 )
+{
+    ring_buffer_size_t available = GetCachedSpscRingBufferWriteAvailable( rbuf );
+    if( elementCount > available )
+    {
+        available = PaUtil_GetSpscRingBufferWriteAvailable( rbuf );
+        if( elementCount > available ) elementCount = available;
+    }
+    GetSpscRingBufferRegions( rbuf, rbuf->stagedWriteIndex, elementCount,
+            dataPtr1, sizePtr1, dataPtr2, sizePtr2 );
+    return elementCount;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_StageSpscRingBufferWrite( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount )
+{
+    return rbuf->stagedWriteIndex = (rbuf->stagedWriteIndex + elementCount) & rbuf->bigMask;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_CommitSpscRingBufferWrites( PaUtilSpscRingBuffer *rbuf )
+{
+    PA_SPSC_STORE_RELEASE_( rbuf->writeIndex, rbuf->stagedWriteIndex );
+    return rbuf->stagedWriteIndex;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_AdvanceSpscRingBufferWriteIndex( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount )
+{
+    PaUtil_StageSpscRingBufferWrite( rbuf, elementCount );
+    return PaUtil_CommitSpscRingBufferWrites( rbuf );
+}
+
+/***************************************************************************
+** Only touches the writer's cache line when the snapshot of the write index
+** shows less data than requested.
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferReadRegions( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                      void **dataPtr1, ring_buffer_size_t *sizePtr1,
+                                      void **dataPtr2, ring_buffer_size_t *sizePtr2 )
+{
+    ring_buffer_size_t available = GetCachedSpscRingBufferReadAvailable( rbuf );
+    if( elementCount > available )
+    {
+        available = PaUtil_GetSpscRingBufferReadAvailable( rbuf );
+        if( elementCount > available ) elementCount = available;
+    }
+    GetSpscRingBufferRegions( rbuf, rbuf->stagedReadIndex, elementCount,
+            dataPtr1, sizePtr1, dataPtr2, sizePtr2 );
+    return elementCount;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_StageSpscRingBufferRead( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount )
+{
+    return rbuf->stagedReadIndex = (rbuf->stagedReadIndex + elementCount) & rbuf->bigMask;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_CommitSpscRingBufferReads( PaUtilSpscRingBuffer *rbuf )
+{
+    PA_SPSC_STORE_RELEASE_( rbuf->readIndex, rbuf->stagedReadIndex );
+    return rbuf->stagedReadIndex;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_AdvanceSpscRingBufferReadIndex( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount )
+{
+    PaUtil_StageSpscRingBufferRead( rbuf, elementCount );
+    return PaUtil_CommitSpscRingBufferReads( rbuf );
+}
+
+/***************************************************************************
+** Return elements written. */
+ring_buffer_size_t PaUtil_WriteSpscRingBuffer( PaUtilSpscRingBuffer *rbuf, const void *data, ring_buffer_size_t elementCount )
+{
+    ring_buffer_size_t size1, size2, numWritten;
+    void *data1, *data2;
+    numWritten = PaUtil_GetSpscRingBufferWriteRegions( rbuf, elementCount, &data1, &size1, &data2, &size2 );
+    memcpy( data1, data, size1*rbuf->elementSizeBytes );
+    if( size2 > 0 )
+        memcpy( data2, ((const char *)data) + size1*rbuf->elementSizeBytes, size2*rbuf->elementSizeBytes );
+    PaUtil_AdvanceSpscRingBufferWriteIndex( rbuf, numWritten );
+    return numWritten;
+}
+
+/***************************************************************************
+** Return elements read. */
+ring_buffer_size_t PaUtil_ReadSpscRingBuffer( PaUtilSpscRingBuffer *rbuf, void *data, ring_buffer_size_t elementCount )
+{
+    ring_buffer_size_t size1, size2, numRead;
+    void *data1, *data2;
+    numRead = PaUtil_GetSpscRingBufferReadRegions( rbuf, elementCount, &data1, &size1, &data2, &size2 );
+    memcpy( data, data1, size1*rbuf->elementSizeBytes );
+    if( size2 > 0 )
+        memcpy( ((char *)data) + size1*rbuf->elementSizeBytes, data2, size2*rbuf->elementSizeBytes );
+    PaUtil_AdvanceSpscRingBufferReadIndex( rbuf, numRead );
+    return numRead;
+}
+
+/***************************************************************************
+ * Multi-reader multi-writer queue.
+ *
+ * Slot i holds a sequence number followed by the element. A slot is free
+ * for the writer claiming position p while its sequence equals p, and holds
+ * the element for the reader claiming position p while it equals p + 1.
+ * When the element is read the reader moves the sequence on to
+ * p + bufferSize, the position that uses the slot next.
+ *
+ * Positions and sequence numbers are free running unsigned counters, they
+ * are compared through their (signed) difference so wrapping is harmless.
+ */
+#if (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || defined(__clang__)
+#   define PA_MULTI_LOAD_RELAXED_( counter )            __atomic_load_n( &(counter), __ATOMIC_RELAXED )
+#   define PA_MULTI_LOAD_ACQUIRE_( counter )            __atomic_load_n( &(counter), __ATOMIC_ACQUIRE )
+#   define PA_MULTI_STORE_RELEASE_( counter, value )    __atomic_store_n( &(counter), (value), __ATOMIC_RELEASE )
+#   define PA_MULTI_COMPARE_AND_SWAP_( counter, expected, value ) \
+        __atomic_compare_exchange_n( &(counter), &(expected), (value), 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED )
+#else
+static unsigned long MultiLoadAcquire( volatile unsigned long *counter )
+{
+    unsigned long value = *counter;
+    PaUtil_FullMemoryBarrier(); /* (read-after-read) and (write-after-read) */
+    return value;
+}
+
+static void MultiStoreRelease( volatile unsigned long *counter, unsigned long value )
+{
+    PaUtil_FullMemoryBarrier(); /* (write-after-write) and (write-after-read) */
+    *counter = value;
+}
+
+/* On failure stores the current value of counter into expected. */
+static int MultiCompareAndSwap( volatile unsigned long *counter, unsigned long *expected, unsigned long value )
+{
+    unsigned long previous;
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+    previous = __sync_val_compare_and_swap( counter, *expected, value );
+#elif defined(_MSC_VER)
+    previous = (unsigned long)_InterlockedCompareExchange( (volatile long *)counter, (long)value, (long)*expected );
+#else
+#   error A compare-and-swap is not defined on this system, PaUtilMultiRingBuffer can not be built.
+#endif
+    if( previous == *expected )
+        return 1;
+    *expected = previous;
+    return 0;
+}
+
+#   define PA_MULTI_LOAD_RELAXED_( counter )            (counter)
+#   define PA_MULTI_LOAD_ACQUIRE_( counter )            MultiLoadAcquire( &(counter) )
+#   define PA_MULTI_STORE_RELEASE_( counter, value )    MultiStoreRelease( &(counter), (value) )
+#   define PA_MULTI_COMPARE_AND_SWAP_( counter, expected, value ) \
+        MultiCompareAndSwap( &(counter), &(expected), (value) )
+#endif
+
+#define PA_MULTI_SLOT_( rbuf, position ) \
+    ((volatile unsigned long *)&(rbuf)->slots[((position) & (rbuf)->smallMask) * (rbuf)->slotSizeBytes])
+
+/***************************************************************************
+*/
+static ring_buffer_size_t GetMultiRingBufferSlotSize( ring_buffer_size_t elementSizeBytes )
+{
+    ring_buffer_size_t alignment = sizeof(unsigned long);
+    return (sizeof(unsigned long) + elementSizeBytes + alignment - 1) / alignment * alignment;
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_GetMultiRingBufferStorageSize( ring_buffer_size_t elementSizeBytes, ring_buffer_size_t elementCount )
+{
+    return GetMultiRingBufferSlotSize( elementSizeBytes ) * elementCount;
+}
+
+/***************************************************************************
+ * elementCount must be power of 2, returns -1 if not.
+ */
+ring_buffer_size_t PaUtil_InitializeMultiRingBuffer( PaUtilMultiRingBuffer *rbuf, ring_buffer_size_t elementSizeBytes, ring_buffer_size_t elementCount, void *storage )
+{
+    if( ((elementCount-1) & elementCount) != 0) return -1; /* Not Power of two. */
+    rbuf->bufferSize = elementCount;
+    rbuf->smallMask = elementCount - 1;
+    rbuf->elementSizeBytes = elementSizeBytes;
+    rbuf->slotSizeBytes = GetMultiRingBufferSlotSize( elementSizeBytes );
+    rbuf->slots = (char *)storage;
+    PaUtil_FlushMultiRingBuffer( rbuf );
+    return 0;
+}
+
+/***************************************************************************
+*/
+void PaUtil_FlushMultiRingBuffer( PaUtilMultiRingBuffer *rbuf )
+{
+    ring_buffer_size_t i;
+    for( i = 0; i < rbuf->bufferSize; ++i )
+        *PA_MULTI_SLOT_( rbuf, i ) = (unsigned long)i;
+    rbuf->writePosition = 0;
+    rbuf->readPosition = 0;
+    PaUtil_FullMemoryBarrier();
+}
+
+/***************************************************************************
+*/
+ring_buffer_size_t PaUtil_GetMultiRingBufferReadAvailable( PaUtilMultiRingBuffer *rbuf )
+{
+    unsigned long readPosition = PA_MULTI_LOAD_ACQUIRE_( rbuf->readPosition );
+    long available = (long)(PA_MULTI_LOAD_ACQUIRE_( rbuf->writePosition ) - readPosition);
+
+    /* the two loads are not atomic as a pair */
+    if( available < 0 ) return 0;
+    if( available > rbuf->bufferSize ) return rbuf->bufferSize;
+    return (ring_buffer_size_t)available;
+}
+
+/***************************************************************************
+** Return 1 if the element was written, 0 if the queue is full. */
+ring_buffer_size_t PaUtil_WriteMultiRingBufferElement( PaUtilMultiRingBuffer *rbuf, const void *element )
+{
+    unsigned long position = PA_MULTI_LOAD_RELAXED_( rbuf->writePosition );
+    volatile unsigned long *slot;
+
+    for(;;)
+    {
+        long difference;
+        slot = PA_MULTI_SLOT_( rbuf, position );
+        difference = (long)(PA_MULTI_LOAD_ACQUIRE_( *slot ) - position);
+        if( difference == 0 )
+        {
+            /* the slot is free, claim the position */
+            if( PA_MULTI_COMPARE_AND_SWAP_( rbuf->writePosition, position, position + 1 ) )
+                break;
+        }
+        else if( difference < 0 )
+        {
+            return 0; /* the slot still holds the element from a lap ago */
+        }
+        else
+        {
+            position = PA_MULTI_LOAD_RELAXED_( rbuf->writePosition ); /* another writer claimed it */
+        }
+    }
+
+    memcpy( (char *)slot + sizeof(unsigned long), element, rbuf->elementSizeBytes );
+    PA_MULTI_STORE_RELEASE_( *slot, position + 1 );
+    return 1;
+}
+
+/***************************************************************************
+** Return 1 if an element was read, 0 if the queue is empty. */
+ring_buffer_size_t PaUtil_ReadMultiRingBufferElement( PaUtilMultiRingBuffer *rbuf, void *element )
+{
+    unsigned long position = PA_MULTI_LOAD_RELAXED_( rbuf->readPosition );
+    volatile unsigned long *slot;
+
+    for(;;)
+    {
+        long difference;
+        slot = PA_MULTI_SLOT_( rbuf, position );
+        difference = (long)(PA_MULTI_LOAD_ACQUIRE_( *slot ) - (position + 1));
+        if( difference == 0 )
+        {
+            /* the element is complete, claim the position */
+            if( PA_MULTI_COMPARE_AND_SWAP_( rbuf->readPosition, position, position + 1 ) )
+                break;
+        }
+        else if( difference < 0 )
+        {
+            return 0; /* not written, or still being written */
+        }
+        else
+        {
+            position = PA_MULTI_LOAD_RELAXED_( rbuf->readPosition ); /* another reader claimed it */
+        }
+    }
+
+    memcpy( element, (const char *)slot + sizeof(unsigned long), rbuf->elementSizeBytes );
+    PA_MULTI_STORE_RELEASE_( *slot, position + (unsigned long)rbuf->bufferSize );
+    return 1;
+}
+
+/***************************************************************************
+** Return elements written. */
+ring_buffer_size_t PaUtil_WriteMultiRingBuffer( PaUtilMultiRingBuffer *rbuf, const void *data, ring_buffer_size_t elementCount )
+{
+    ring_buffer_size_t numWritten = 0;
+    while( numWritten < elementCount &&
+            PaUtil_WriteMultiRingBufferElement( rbuf, (const char *)data + numWritten*rbuf->elementSizeBytes ) )
+        ++numWritten;
+    return numWritten;
+}
+
+/***************************************************************************
+** Return elements read. */
+ring_buffer_size_t PaUtil_ReadMultiRingBuffer( PaUtilMultiRingBuffer *rbuf, void *data, ring_buffer_size_t elementCount )
+{
+    ring_buffer_size_t numRead = 0;
+    while( numRead < elementCount &&
+            PaUtil_ReadMultiRingBufferElement( rbuf, (char *)data + numRead*rbuf->elementSizeBytes ) )
+        ++numRead;
+    return numRead;
+}
+
+/***************************************************************************
+ * Single-reader single-writer ring buffer of any size with 64-bit indices.
+ *
+ * The 64-bit indices must be loaded and stored atomically even on 32-bit
+ * CPUs, where a plain access takes two instructions.
+ */
+#if (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))) || defined(__clang__)
+#   define PA_RB64_LOAD_ACQUIRE_( index )           __atomic_load_n( &(index), __ATOMIC_ACQUIRE )
+#   define PA_RB64_STORE_RELEASE_( index, value )   __atomic_store_n( &(index), (value), __ATOMIC_RELEASE )
+#else
+#   if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#       define PA_RB64_COMPARE_AND_SWAP_( index, expected, value ) \
+            __sync_val_compare_and_swap( (index), (expected), (value) )
+#   elif defined(_MSC_VER)
+#       define PA_RB64_COMPARE_AND_SWAP_( index, expected, value ) \
+            (ring_buffer_index_t)_InterlockedCompareExchange64( (volatile __int64 *)(index), (__int64)(value), (__int64)(expected) )
+#   else
+#       error A 64-bit compare-and-swap is not defined on this system, PaUtilRingBuffer64 can not be built.
+#   endif
+
+/* The compare-and-swap is a full barrier. */
+static ring_buffer_index_t RingBuffer64LoadAcquire( volatile ring_buffer_index_t *index )
+{
+    return PA_RB64_COMPARE_AND_SWAP_( index, 0, 0 );
+}
+
+static void RingBuffer64StoreRelease( volatile ring_buffer_index_t *index, ring_buffer_index_t value )
+{
+    ring_buffer_index_t expected = *index; /* may be torn, then the swap fails */
+    ring_buffer_index_t previous;
+    while( (previous = PA_RB64_COMPARE_AND_SWAP_( index, expected, value )) != expected )
+        expected = previous;
+}
+
+#   define PA_RB64_LOAD_ACQUIRE_( index )           RingBuffer64LoadAcquire( &(index) )
+#   define PA_RB64_STORE_RELEASE_( index, value )   RingBuffer64StoreRelease( &(index), (value) )
+#endif
+
+/***************************************************************************
+ * Returns -1 if elementCount is 0 or the buffer is larger than the address
+ * space.
+ */
+ring_buffer_size_t PaUtil_InitializeRingBuffer64( PaUtilRingBuffer64 *rbuf, ring_buffer_size_t elementSizeBytes, ring_buffer_index_t elementCount, void *dataPtr )
+{
+    if( elementCount == 0 || elementSizeBytes <= 0 ) return -1;
+    if( elementCount > ((size_t)-1) / (size_t)elementSizeBytes ) return -1;
+    rbuf->bufferSize = elementCount;
+    rbuf->smallMask = ((elementCount-1) & elementCount) == 0 ? elementCount - 1 : 0;
+    rbuf->elementSizeBytes = elementSizeBytes;
+    rbuf->buffer = (char *)dataPtr;
+    PaUtil_FlushRingBuffer64( rbuf );
+    return 0;
+}
+
+/***************************************************************************
+*/
+void PaUtil_FlushRingBuffer64( PaUtilRingBuffer64 *rbuf )
+{
+    rbuf->writeIndex = rbuf->readIndex = 0;
+    rbuf->writeOffset = rbuf->readOffset = 0;
+}
+
+/***************************************************************************
+** The writer's own index can be read without synchronization. */
+ring_buffer_index_t PaUtil_GetRingBuffer64WriteAvailable( PaUtilRingBuffer64 *rbuf )
+{
+    return rbuf->bufferSize - (rbuf->writeIndex - PA_RB64_LOAD_ACQUIRE_( rbuf->readIndex ));
+}
+
+/***************************************************************************
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64ReadAvailable( PaUtilRingBuffer64 *rbuf )
+{
+    return PA_RB64_LOAD_ACQUIRE_( rbuf->writeIndex ) - rbuf->readIndex;
+}
+
+/***************************************************************************
+** elementCount is at most bufferSize, so a single subtraction wraps the offset. */
+static ring_buffer_index_t AdvanceRingBuffer64Offset( const PaUtilRingBuffer64 *rbuf, ring_buffer_index_t offset, ring_buffer_index_t elementCount )
+{
+    offset += elementCount;
+    if( rbuf->smallMask )
+        return offset & rbuf->smallMask;
+    return offset >= rbuf->bufferSize ? offset - rbuf->bufferSize : offset;
+}
+
+/***************************************************************************
+*/
+static void GetRingBuffer64Regions( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t offset, ring_buffer_index_t elementCount,
+                                    void **dataPtr1, ring_buffer_index_t *sizePtr1,
+                                    void **dataPtr2, ring_buffer_index_t *sizePtr2 )
+{
+    *dataPtr1 = &rbuf->buffer[(size_t)offset * (size_t)rbuf->elementSizeBytes];
+    if( elementCount > rbuf->bufferSize - offset )
+    {
+        ring_buffer_index_t firstHalf = rbuf->bufferSize - offset;
+        *sizePtr1 = firstHalf;
+        *dataPtr2 = &rbuf->buffer[0];
+        *sizePtr2 = elementCount - firstHalf;
+    }
+    else
+    {
+        *sizePtr1 = elementCount;
+        *dataPtr2 = NULL;
+        *sizePtr2 = 0;
+    }
+}
+
+/***************************************************************************
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64WriteRegions( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount,
+                                       void **dataPtr1, ring_buffer_index_t *sizePtr1,
+                                       void **dataPtr2, ring_buffer_index_t *sizePtr2 )
+{
+    ring_buffer_index_t available = PaUtil_GetRingBuffer64WriteAvailable( rbuf );
+    if( elementCount > available ) elementCount = available;
+    GetRingBuffer64Regions( rbuf, rbuf->writeOffset, elementCount, dataPtr1, sizePtr1, dataPtr2, sizePtr2 );
+    return elementCount;
+}
+
+/***************************************************************************
+*/
+ring_buffer_index_t PaUtil_AdvanceRingBuffer64WriteIndex( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount )
+{
+    ring_buffer_index_t writeIndex = rbuf->writeIndex + elementCount;
+    rbuf->writeOffset = AdvanceRingBuffer64Offset( rbuf, rbuf->writeOffset, elementCount );
+    PA_RB64_STORE_RELEASE_( rbuf->writeIndex, writeIndex );
+    return writeIndex;
+}
+
+/***************************************************************************
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64ReadRegions( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount,
+                                      void **dataPtr1, ring_buffer_index_t *sizePtr1,
+                                      void **dataPtr2, ring_buffer_index_t *sizePtr2 )
+{
+    ring_buffer_index_t available = PaUtil_GetRingBuffer64ReadAvailable( rbuf );
+    if( elementCount > available ) elementCount = available;
+    GetRingBuffer64Regions( rbuf, rbuf->readOffset, elementCount, dataPtr1, sizePtr1, dataPtr2, sizePtr2 );
+    return elementCount;
+}
+
+/***************************************************************************
+*/
+ring_buffer_index_t PaUtil_AdvanceRingBuffer64ReadIndex( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount )
+{
+    ring_buffer_index_t readIndex = rbuf->readIndex + elementCount;
+    rbuf->readOffset = AdvanceRingBuffer64Offset( rbuf, rbuf->readOffset, elementCount );
+    PA_RB64_STORE_RELEASE_( rbuf->readIndex, readIndex );
+    return readIndex;
+}
+
+/***************************************************************************
+** Return elements written. */
+ring_buffer_index_t PaUtil_WriteRingBuffer64( PaUtilRingBuffer64 *rbuf, const void *data, ring_buffer_index_t elementCount )
+{
+    ring_buffer_index_t size1, size2, numWritten;
+    void *data1, *data2;
+    numWritten = PaUtil_GetRingBuffer64WriteRegions( rbuf, elementCount, &data1, &size1, &data2, &size2 );
+    memcpy( data1, data, (size_t)size1 * (size_t)rbuf->elementSizeBytes );
+    if( size2 > 0 )
+        memcpy( data2, ((const char *)data) + (size_t)size1 * (size_t)rbuf->elementSizeBytes,
+                (size_t)size2 * (size_t)rbuf->elementSizeBytes );
+    PaUtil_AdvanceRingBuffer64WriteIndex( rbuf, numWritten );
+    return numWritten;
+}
+
+/***************************************************************************
+** Return elements read. */
+ring_buffer_index_t PaUtil_ReadRingBuffer64( PaUtilRingBuffer64 *rbuf, void *data, ring_buffer_index_t elementCount )
+{
+    ring_buffer_index_t size1, size2, numRead;
+    void *data1, *data2;
+    numRead = PaUtil_GetRingBuffer64ReadRegions( rbuf, elementCount, &data1, &size1, &data2, &size2 );
+    memcpy( data, data1, (size_t)size1 * (size_t)rbuf->elementSizeBytes );
+    if( size2 > 0 )
+        memcpy( ((char *)data) + (size_t)size1 * (size_t)rbuf->elementSizeBytes, data2,
+                (size_t)size2 * (size_t)rbuf->elementSizeBytes );
+    PaUtil_AdvanceRingBuffer64ReadIndex( rbuf, numRead );
+    return numRead;
+}
@@ -83,6 +83,15 @@ typedef long ring_buffer_size_t;
 typedef long ring_buffer_size_t;
 #endif
 
+/** Element counts and free running indices of PaUtilRingBuffer64. */
+#if defined(_MSC_VER) || defined(__BORLANDC__)
+typedef unsigned __int64 ring_buffer_index_t;
+#elif defined( __GNUC__ )
+__extension__ typedef unsigned long long ring_buffer_index_t;
+#else
+typedef unsigned long long ring_buffer_index_t;
+#endif
+
 
 
 #ifdef __cplusplus
@@ -230,6 +239,355 @@ ring_buffer_size_t PaUtil_GetRingBufferReadRegions( PaUtilRingBuffer *rbuf, ring
 */
 ring_buffer_size_t PaUtil_AdvanceRingBufferReadIndex( PaUtilRingBuffer *rbuf, ring_buffer_size_t elementCount );
 
+/** Get the address of a single region to which we can write data, for a
+ ring buffer whose memory is mirrored: the bufferSize*elementSizeBytes
+ bytes at dataPtr are mapped again directly after their end, as allocated
+ by PaUtil_AllocateMirroredMemory(). A region that wraps around the end of
+ the buffer then continues in the mirror, so the caller (e.g. a sample
+ converter) can treat it as one block.
+
+ @param rbuf The ring buffer.
+
+ @param elementCount The maximum number of elements desired.
+
+ @param dataPtr The address where the region pointer will be stored.
+
+ @return The room available to be written or elementCount, whichever is smaller.
+*/
+ring_buffer_size_t PaUtil_GetRingBufferContiguousWriteRegion( PaUtilRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                       void **dataPtr );
+
+/** Get the address of a single region from which we can read data, for a
+ ring buffer whose memory is mirrored. See
+ PaUtil_GetRingBufferContiguousWriteRegion().
+
+ @return The number of elements available for reading or elementCount, whichever is smaller.
+*/
+ring_buffer_size_t PaUtil_GetRingBufferContiguousReadRegion( PaUtilRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                       void **dataPtr );
+
+
+/** Bytes between the reader and the writer state of a PaUtilSpscRingBuffer.
+ Enough to keep them on separate cache lines, including the adjacent line
+ prefetch of x86 and the 128 byte lines of some ARM cores.
+*/
+#define PA_RING_BUFFER_PADDING (128)
+
+/** A single-reader single-writer ring buffer like PaUtilRingBuffer,
+ arranged so that the reader and the writer don't slow each other down.
+
+ o- The index each side writes lives on its own cache line, so the two
+    threads don't false-share a line on every advance.
+ o- Each side keeps a snapshot of the other side's index, and only reads
+    the shared index again (an acquire load) when the snapshot says there
+    is not enough data or room.
+ o- Indices are published with a release store instead of the full memory
+    barriers used by PaUtilRingBuffer.
+ o- Advancing can be staged: PaUtil_StageSpscRingBufferWrite() /
+    PaUtil_StageSpscRingBufferRead() move the private index only, so
+    several small transfers can be made visible to the other side with a
+    single PaUtil_CommitSpscRingBufferWrites() /
+    PaUtil_CommitSpscRingBufferReads().
+
+ The Write functions (...WriteAvailable, ...WriteRegions, ...Write...)
+ must only be called by the writer, the Read functions only by the reader.
+ Fields are private to the implementation.
+*/
+typedef struct PaUtilSpscRingBuffer
+{
+    /* constant after initialization */
+    ring_buffer_size_t  bufferSize; /**< Number of elements in FIFO. Power of 2. */
+    ring_buffer_size_t  bigMask;
+    ring_buffer_size_t  smallMask;
+    ring_buffer_size_t  elementSizeBytes;
+    char  *buffer;
+
+    char  padding0[PA_RING_BUFFER_PADDING];
+
+    /* writer */
+    volatile ring_buffer_size_t  writeIndex; /**< Published to the reader. */
+    ring_buffer_size_t  stagedWriteIndex;    /**< writeIndex plus staged, unpublished elements. */
+    ring_buffer_size_t  cachedReadIndex;     /**< Writer's snapshot of readIndex. */
+
+    char  padding1[PA_RING_BUFFER_PADDING];
+
+    /* reader */
+    volatile ring_buffer_size_t  readIndex;  /**< Published to the writer. */
+    ring_buffer_size_t  stagedReadIndex;
+    ring_buffer_size_t  cachedWriteIndex;    /**< Reader's snapshot of writeIndex. */
+
+    char  padding2[PA_RING_BUFFER_PADDING];
+}PaUtilSpscRingBuffer;
+
+/** Initialize an SPSC ring buffer to the empty state.
+ The parameters are the same as for PaUtil_InitializeRingBuffer().
+
+ @return -1 if elementCount is not a power of 2, otherwise 0.
+*/
+ring_buffer_size_t PaUtil_InitializeSpscRingBuffer( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementSizeBytes, ring_buffer_size_t elementCount, void *dataPtr );
+
+/** Reset buffer to empty, dropping staged elements too. Should only be
+ called when the buffer is NOT being read or written.
+*/
+void PaUtil_FlushSpscRingBuffer( PaUtilSpscRingBuffer *rbuf );
+
+/** Retrieve the number of elements the writer can write, not counting
+ staged elements as free. Writer only.
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferWriteAvailable( PaUtilSpscRingBuffer *rbuf );
+
+/** Retrieve the number of elements the reader can read, not counting the
+ elements it has staged. Reader only.
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferReadAvailable( PaUtilSpscRingBuffer *rbuf );
+
+/** Get address of region(s) to which we can write data, starting after any
+ staged elements. Same semantics as PaUtil_GetRingBufferWriteRegions().
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferWriteRegions( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                       void **dataPtr1, ring_buffer_size_t *sizePtr1,
+                                       void **dataPtr2, ring_buffer_size_t *sizePtr2 );
+
+/** Mark elementCount written elements as complete without publishing them
+ to the reader yet.
+
+ @return The new staged position.
+*/
+ring_buffer_size_t PaUtil_StageSpscRingBufferWrite( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount );
+
+/** Publish all staged elements to the reader.
+
+ @return The new position.
+*/
+ring_buffer_size_t PaUtil_CommitSpscRingBufferWrites( PaUtilSpscRingBuffer *rbuf );
+
+/** Stage elementCount elements and commit all staged elements.
+
+ @return The new position.
+*/
+ring_buffer_size_t PaUtil_AdvanceSpscRingBufferWriteIndex( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount );
+
+/** Get address of region(s) from which we can read data, starting after any
+ staged elements. Same semantics as PaUtil_GetRingBufferReadRegions().
+*/
+ring_buffer_size_t PaUtil_GetSpscRingBufferReadRegions( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount,
+                                      void **dataPtr1, ring_buffer_size_t *sizePtr1,
+                                      void **dataPtr2, ring_buffer_size_t *sizePtr2 );
+
+/** Mark elementCount elements as consumed without handing their space back
+ to the writer yet.
+
+ @return The new staged position.
+*/
+ring_buffer_size_t PaUtil_StageSpscRingBufferRead( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount );
+
+/** Hand the space of all staged elements back to the writer.
+
+ @return The new position.
+*/
+ring_buffer_size_t PaUtil_CommitSpscRingBufferReads( PaUtilSpscRingBuffer *rbuf );
+
+/** Stage elementCount elements and commit all staged elements.
+
+ @return The new position.
+*/
+ring_buffer_size_t PaUtil_AdvanceSpscRingBufferReadIndex( PaUtilSpscRingBuffer *rbuf, ring_buffer_size_t elementCount );
+
+/** Copy data into the ring buffer and publish it.
+
+ @return The number of elements written.
+*/
+ring_buffer_size_t PaUtil_WriteSpscRingBuffer( PaUtilSpscRingBuffer *rbuf, const void *data, ring_buffer_size_t elementCount );
+
+/** Copy data out of the ring buffer and release its space.
+
+ @return The number of elements read.
+*/
+ring_buffer_size_t PaUtil_ReadSpscRingBuffer( PaUtilSpscRingBuffer *rbuf, void *data, ring_buffer_size_t elementCount );
+
+
+/** A bounded queue of fixed size elements (e.g. frames or blocks of frames)
+ that any number of threads may write to and read from concurrently.
+
+ Each element slot carries a sequence number, so writers and readers only
+ ever compete for their own position counter with a compare-and-swap; no
+ thread waits for another one. A reader that finds its next element not
+ completely written yet reports the queue as empty, which makes it safe to
+ drain the queue from an audio callback while worker threads fill it.
+ Elements written by the same thread are read in the order they were
+ written.
+
+ The storage is allocated by the client, its size is given by
+ PaUtil_GetMultiRingBufferStorageSize(). Fields are private to the
+ implementation.
+*/
+typedef struct PaUtilMultiRingBuffer
+{
+    ring_buffer_size_t  bufferSize; /**< Number of elements. Power of 2. */
+    ring_buffer_size_t  smallMask;
+    ring_buffer_size_t  elementSizeBytes;
+    ring_buffer_size_t  slotSizeBytes; /**< Sequence number plus element, rounded up. */
+    char  *slots;
+
+    char  padding0[PA_RING_BUFFER_PADDING];
+
+    volatile unsigned long  writePosition;
+
+    char  padding1[PA_RING_BUFFER_PADDING];
+
+    volatile unsigned long  readPosition;
+
+    char  padding2[PA_RING_BUFFER_PADDING];
+}PaUtilMultiRingBuffer;
+
+/** Retrieve the number of bytes of storage needed by a PaUtilMultiRingBuffer
+ of elementCount elements of elementSizeBytes each. The storage must be
+ aligned at least like an unsigned long, as returned by malloc().
+*/
+ring_buffer_size_t PaUtil_GetMultiRingBufferStorageSize( ring_buffer_size_t elementSizeBytes, ring_buffer_size_t elementCount );
+
+/** Initialize a PaUtilMultiRingBuffer to the empty state.
+
+ @param rbuf The queue.
+
+ @param elementSizeBytes The size of a single element in bytes.
+
+ @param elementCount The number of elements in the queue (must be a power of 2).
+
+ @param storage A pointer to PaUtil_GetMultiRingBufferStorageSize() bytes.
+
+ @return -1 if elementCount is not a power of 2, otherwise 0.
+*/
+ring_buffer_size_t PaUtil_InitializeMultiRingBuffer( PaUtilMultiRingBuffer *rbuf, ring_buffer_size_t elementSizeBytes, ring_buffer_size_t elementCount, void *storage );
+
+/** Reset the queue to empty. Should only be called when it is NOT being
+ read or written.
+*/
+void PaUtil_FlushMultiRingBuffer( PaUtilMultiRingBuffer *rbuf );
+
+/** Retrieve the number of elements written and not yet read. The value is
+ only a snapshot while other threads use the queue.
+*/
+ring_buffer_size_t PaUtil_GetMultiRingBufferReadAvailable( PaUtilMultiRingBuffer *rbuf );
+
+/** Copy one element into the queue.
+
+ @return 1 if the element was written, 0 if the queue was full.
+*/
+ring_buffer_size_t PaUtil_WriteMultiRingBufferElement( PaUtilMultiRingBuffer *rbuf, const void *element );
+
+/** Copy one element out of the queue.
+
+ @return 1 if an element was read, 0 if the queue was empty.
+*/
+ring_buffer_size_t PaUtil_ReadMultiRingBufferElement( PaUtilMultiRingBuffer *rbuf, void *element );
+
+/** Copy up to elementCount elements into the queue, one at a time.
+ Elements written concurrently by other threads may be interleaved.
+
+ @return The number of elements written.
+*/
+ring_buffer_size_t PaUtil_WriteMultiRingBuffer( PaUtilMultiRingBuffer *rbuf, const void *data, ring_buffer_size_t elementCount );
+
+/** Copy up to elementCount elements out of the queue, one at a time.
+
+ @return The number of elements read.
+*/
+ring_buffer_size_t PaUtil_ReadMultiRingBuffer( PaUtilMultiRingBuffer *rbuf, void *data, ring_buffer_size_t elementCount );
+
+
+/** A single-reader single-writer ring buffer like PaUtilRingBuffer that
+ takes any number of elements, not just a power of 2, and counts them with
+ 64-bit indices, e.g. for a buffer of exactly 3 periods of 480 frames or
+ for a capture buffer holding several minutes of audio.
+
+ writeIndex and readIndex never wrap, they count the elements written and
+ read since the buffer was flushed. Each side also keeps its own offset into
+ the buffer, so no division is needed to find the regions; for power of 2
+ sizes the offsets are wrapped with a mask.
+
+ Fields are private to the implementation except for reading writeIndex
+ from the writer and readIndex from the reader.
+*/
+typedef struct PaUtilRingBuffer64
+{
+    ring_buffer_index_t  bufferSize; /**< Number of elements in FIFO. */
+    ring_buffer_index_t  smallMask;  /**< bufferSize - 1 if bufferSize is a power of 2, otherwise 0. */
+    ring_buffer_size_t  elementSizeBytes;
+    char  *buffer;
+    volatile ring_buffer_index_t  writeIndex; /**< Number of elements written. */
+    volatile ring_buffer_index_t  readIndex;  /**< Number of elements read. */
+    ring_buffer_index_t  writeOffset; /**< Writer's offset of writeIndex into buffer. */
+    ring_buffer_index_t  readOffset;  /**< Reader's offset of readIndex into buffer. */
+}PaUtilRingBuffer64;
+
+/** Initialize a PaUtilRingBuffer64 to the empty state.
+
+ @param rbuf The ring buffer.
+
+ @param elementSizeBytes The size of a single data element in bytes.
+
+ @param elementCount The number of elements in the buffer (any number but 0).
+
+ @param dataPtr A pointer to a previously allocated area where the data
+ will be maintained.  It must be elementCount*elementSizeBytes long.
+
+ @return -1 if elementCount is 0 or the buffer can't be addressed, otherwise 0.
+*/
+ring_buffer_size_t PaUtil_InitializeRingBuffer64( PaUtilRingBuffer64 *rbuf, ring_buffer_size_t elementSizeBytes, ring_buffer_index_t elementCount, void *dataPtr );
+
+/** Reset buffer to empty. Should only be called when buffer is NOT being read or written.
+*/
+void PaUtil_FlushRingBuffer64( PaUtilRingBuffer64 *rbuf );
+
+/** Retrieve the number of elements available in the ring buffer for writing.
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64WriteAvailable( PaUtilRingBuffer64 *rbuf );
+
+/** Retrieve the number of elements available in the ring buffer for reading.
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64ReadAvailable( PaUtilRingBuffer64 *rbuf );
+
+/** Get address of region(s) to which we can write data.
+ Same semantics as PaUtil_GetRingBufferWriteRegions().
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64WriteRegions( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount,
+                                       void **dataPtr1, ring_buffer_index_t *sizePtr1,
+                                       void **dataPtr2, ring_buffer_index_t *sizePtr2 );
+
+/** Advance the write index by elementCount, which must not exceed the
+ count returned by PaUtil_GetRingBuffer64WriteRegions().
+
+ @return The new write index.
+*/
+ring_buffer_index_t PaUtil_AdvanceRingBuffer64WriteIndex( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount );
+
+/** Get address of region(s) from which we can read data.
+ Same semantics as PaUtil_GetRingBufferReadRegions().
+*/
+ring_buffer_index_t PaUtil_GetRingBuffer64ReadRegions( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount,
+                                      void **dataPtr1, ring_buffer_index_t *sizePtr1,
+                                      void **dataPtr2, ring_buffer_index_t *sizePtr2 );
+
+/** Advance the read index by elementCount, which must not exceed the
+ count returned by PaUtil_GetRingBuffer64ReadRegions().
+
+ @return The new read index.
+*/
+ring_buffer_index_t PaUtil_AdvanceRingBuffer64ReadIndex( PaUtilRingBuffer64 *rbuf, ring_buffer_index_t elementCount );
+
+/** Write data to the ring buffer.
+
+ @return The number of elements written.
+*/
+ring_buffer_index_t PaUtil_WriteRingBuffer64( PaUtilRingBuffer64 *rbuf, const void *data, ring_buffer_index_t elementCount );
+
+/** Read data from the ring buffer.
+
+ @return The number of elements read.
+*/
+ring_buffer_index_t PaUtil_ReadRingBuffer64( PaUtilRingBuffer64 *rbuf, void *data, ring_buffer_index_t elementCount );
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -74,6 +74,14 @@ void PaUtil_InitializeStreamInterface( PaUtilStreamInterface *streamInterface,
     streamInterface->Write = Write;
     streamInterface->GetReadAvailable = GetReadAvailable;
     streamInterface->GetWriteAvailable = GetWriteAvailable;
+    streamInterface->ReadV = 0;
+    streamInterface->WriteV = 0;
+    streamInterface->ReadTimeout = 0;
+    streamInterface->WriteTimeout = 0;
+    streamInterface->Pause = 0;
+    streamInterface->Resume = 0;
+    streamInterface->StartAtTime = 0;
+    streamInterface->Process = 0;
 }
 
 
@@ -83,7 +91,10 @@ void PaUtil_InitializeStreamRepresentation( PaUtilStreamRepresentation *streamRe
         void *userData )
 {
     streamRepresentation->magic = PA_STREAM_MAGIC;
-    streamRepresentation->nextOpenStream = 0;
+    streamRepresentation->openStreamSlot = -1;
+    streamRepresentation->openStreamGeneration = 0;
+    streamRepresentation->arenaSlot = -1;
+    streamRepresentation->hostApi = 0;
     streamRepresentation->streamInterface = streamInterface;
     streamRepresentation->streamCallback = streamCallback;
     streamRepresentation->streamFinishedCallback = 0;
@@ -93,6 +104,18 @@ void PaUtil_InitializeStreamRepresentation( PaUtilStreamRepresentation *streamRe
     streamRepresentation->streamInfo.inputLatency = 0.;
     streamRepresentation->streamInfo.outputLatency = 0.;
     streamRepresentation->streamInfo.sampleRate = 0.;
+
+    streamRepresentation->statistics = 0;
+    streamRepresentation->headroomNotifier = 0;
+    streamRepresentation->clock = 0;
+    streamRepresentation->taps = 0;
+    streamRepresentation->levelMeter = 0;
+    streamRepresentation->silentOutputChannels = 0;
+    streamRepresentation->outputGain = 0;
+    streamRepresentation->GetMemoryUsage = 0;
+    streamRepresentation->isStoppingAsync = 0;
+    streamRepresentation->isPaused = 0;
+    streamRepresentation->processesManually = 0;
 }
 
 
@@ -77,10 +77,51 @@ typedef struct {
     PaError (*Write)( PaStream* stream, const void *buffer, unsigned long frames );
     signed long (*GetReadAvailable)( PaStream* stream );
     signed long (*GetWriteAvailable)( PaStream* stream );
+
+    /* Optional, NULL unless set by the host API after
+       PaUtil_InitializeStreamInterface(). Pa_ReadStreamV() and
+       Pa_WriteStreamV() call Read and Write once per buffer without them.
+       They are only called with a buffer count above 0 and no empty buffers. */
+    PaError (*ReadV)( PaStream* stream, void * const *buffers,
+            const unsigned long *frames, unsigned long bufferCount );
+    PaError (*WriteV)( PaStream* stream, const void * const *buffers,
+            const unsigned long *frames, unsigned long bufferCount );
+
+    /* Optional as ReadV and WriteV. Transfer as many frames as possible
+       within timeoutSeconds, which is 0 or more, store how many in
+       *framesRead or *framesWritten and return paTimedOut if that is fewer
+       than frames. Without them Pa_ReadStreamTimeout() and
+       Pa_WriteStreamTimeout() wait for all frames to be available. */
+    PaError (*ReadTimeout)( PaStream* stream, void *buffer, unsigned long frames,
+            unsigned long *framesRead, double timeoutSeconds );
+    PaError (*WriteTimeout)( PaStream* stream, const void *buffer, unsigned long frames,
+            unsigned long *framesWritten, double timeoutSeconds );
+
+    /* Optional as ReadV and WriteV. Pause an active stream keeping the device
+       configured, and resume it. Only called on a started stream, Resume only
+       after Pause; a paused stream may also be passed to Stop, Abort or Close.
+       Without them Pa_PauseStream() and Pa_ResumeStream() abort and restart
+       the stream. */
+    PaError (*Pause)( PaStream* stream );
+    PaError (*Resume)( PaStream* stream );
+
+    /* Optional as ReadV and WriteV. Start a stopped stream so that the
+       stream callback's first frame is played, or was captured, at startTime,
+       see Pa_StartStreamAtTime(). Without it Pa_StartStreamAtTime() waits
+       until the start time less the output latency and calls Start. */
+    PaError (*StartAtTime)( PaStream* stream, PaTime startTime );
+
+    /* Optional as ReadV and WriteV. Wait up to timeoutSeconds, which is 0 or
+       more, and process a host buffer of a callback stream opened with
+       paManualProcessing on the calling thread, see Pa_ProcessStream().
+       Only called for such streams, which host APIs without it can't open. */
+    PaError (*Process)( PaStream* stream, double timeoutSeconds );
 } PaUtilStreamInterface;
 
 
-/** Initialize the fields of a PaUtilStreamInterface structure.
+/** Initialize the fields of a PaUtilStreamInterface structure. The optional
+ ReadV, WriteV, ReadTimeout, WriteTimeout, Pause, Resume, StartAtTime and
+ Process fields are set to NULL.
 */
 void PaUtil_InitializeStreamInterface( PaUtilStreamInterface *streamInterface,
     PaError (*Close)( PaStream* ),
@@ -146,12 +187,41 @@ double PaUtil_DummyGetCpuLoad( PaStream* stream );
 */
 typedef struct PaUtilStreamRepresentation {
     unsigned long magic;    /**< set to PA_STREAM_MAGIC */
-    struct PaUtilStreamRepresentation *nextOpenStream; /**< field used by multi-api code */
+    int openStreamSlot;     /**< slot in the front end's open stream table, -1 if not open */
+    unsigned long openStreamGeneration; /**< generation of openStreamSlot when the stream was opened */
+    int arenaSlot;          /**< the front end's registration of the arena the stream was opened in, -1 if none */
+    struct PaUtilHostApiRepresentation *hostApi; /**< the host API which opened the stream, set by the front end */
     PaUtilStreamInterface *streamInterface;
     PaStreamCallback *streamCallback;
     PaStreamFinishedCallback *streamFinishedCallback;
     void *userData;
     PaStreamInfo streamInfo;
+    struct PaUtilStreamStatistics *statistics; /**< set by host APIs which collect them,
+                                             usually to PaUtil_GetBufferProcessorStatistics()
+                                             of the stream's buffer processor, otherwise NULL */
+    const struct PaUtilStreamClock *clock; /**< likewise, set to PaUtil_GetBufferProcessorClock(),
+                                             or NULL if the host API doesn't publish one */
+    signed long (*GetMemoryUsage)( PaStream *stream ); /**< set by host APIs which account for the
+                                             memory of their streams, see Pa_GetStreamMemoryUsage(),
+                                             otherwise NULL */
+    struct PaUtilHeadroomNotifier *headroomNotifier; /**< see Pa_SetStreamHeadroomCallback(), set
+                                             by the front end */
+    struct PaUtilStreamTaps *taps;      /**< see Pa_AddStreamTap(), set by host APIs to
+                                             PaUtil_GetBufferProcessorTaps() of the stream's buffer
+                                             processor, or NULL if their streams can't be tapped */
+    struct PaUtilLevelMeter *levelMeter; /**< see Pa_GetStreamLevels(), set by host APIs to
+                                             PaUtil_GetBufferProcessorLevelMeter(), NULL if the
+                                             stream isn't metered */
+    struct PaUtilSilentChannels *silentOutputChannels; /**< see Pa_SetStreamOutputChannelSilent(),
+                                             set by host APIs to
+                                             PaUtil_GetBufferProcessorSilentOutputChannels(), NULL
+                                             if the stream's output channels can't be silenced */
+    struct PaUtilOutputGain *outputGain; /**< see Pa_SetStreamOutputGain(), set by host APIs to
+                                             PaUtil_GetBufferProcessorOutputGain(), NULL if the
+                                             stream's output gain can't be set */
+    volatile int isStoppingAsync; /**< nonzero while Pa_StopStreamAsync() stops the stream, set by the front end */
+    volatile int isPaused; /**< nonzero between Pa_PauseStream() and Pa_ResumeStream(), set by the front end */
+    int processesManually; /**< nonzero if opened with paManualProcessing, set by the front end */
 } PaUtilStreamRepresentation;
 
 
@@ -198,6 +268,53 @@ PaError PaUtil_ValidateStreamPointer( PaStream *stream );
     PA_STREAM_REP( (stream) )->streamInterface
 
 
+/** The calls of the front end which are made for every buffer or clock
+ reading. They go through the stream's PaUtilStreamInterface, unless the
+ library is built with PA_DIRECT_STREAM_INTERFACE defined to the function
+ prefix of its only host API (e.g. PaAlsa). Then they call the host API's
+ functions PaAlsa_DirectIsStopped(), PaAlsa_DirectGetTime(),
+ PaAlsa_DirectRead(), PaAlsa_DirectWrite(), PaAlsa_DirectGetReadAvailable()
+ and PaAlsa_DirectGetWriteAvailable() directly, which behave as the fields of
+ the stream's interface, the Dummy ones included. The calls can then be
+ inlined by link time optimization, and are not indirect branches.
+*/
+#ifdef PA_DIRECT_STREAM_INTERFACE
+
+#define PA_DIRECT_STREAM_FUNCTION_( prefix, name )   prefix ## _Direct ## name
+#define PA_DIRECT_STREAM_FUNCTION_EXPAND_( prefix, name )   PA_DIRECT_STREAM_FUNCTION_( prefix, name )
+#define PA_DIRECT_STREAM_FUNCTION( name )\
+    PA_DIRECT_STREAM_FUNCTION_EXPAND_( PA_DIRECT_STREAM_INTERFACE, name )
+
+PaError PA_DIRECT_STREAM_FUNCTION( IsStopped )( PaStream *stream );
+PaTime PA_DIRECT_STREAM_FUNCTION( GetTime )( PaStream *stream );
+PaError PA_DIRECT_STREAM_FUNCTION( Read )( PaStream* stream, void *buffer, unsigned long frames );
+PaError PA_DIRECT_STREAM_FUNCTION( Write )( PaStream* stream, const void *buffer, unsigned long frames );
+signed long PA_DIRECT_STREAM_FUNCTION( GetReadAvailable )( PaStream* stream );
+signed long PA_DIRECT_STREAM_FUNCTION( GetWriteAvailable )( PaStream* stream );
+
+#define PA_STREAM_IS_STOPPED( stream )  PA_DIRECT_STREAM_FUNCTION( IsStopped )( stream )
+#define PA_STREAM_GET_TIME( stream )    PA_DIRECT_STREAM_FUNCTION( GetTime )( stream )
+#define PA_STREAM_READ( stream, buffer, frames )\
+    PA_DIRECT_STREAM_FUNCTION( Read )( stream, buffer, frames )
+#define PA_STREAM_WRITE( stream, buffer, frames )\
+    PA_DIRECT_STREAM_FUNCTION( Write )( stream, buffer, frames )
+#define PA_STREAM_GET_READ_AVAILABLE( stream )  PA_DIRECT_STREAM_FUNCTION( GetReadAvailable )( stream )
+#define PA_STREAM_GET_WRITE_AVAILABLE( stream ) PA_DIRECT_STREAM_FUNCTION( GetWriteAvailable )( stream )
+
+#else /* !PA_DIRECT_STREAM_INTERFACE */
+
+#define PA_STREAM_IS_STOPPED( stream )  PA_STREAM_INTERFACE( stream )->IsStopped( stream )
+#define PA_STREAM_GET_TIME( stream )    PA_STREAM_INTERFACE( stream )->GetTime( stream )
+#define PA_STREAM_READ( stream, buffer, frames )\
+    PA_STREAM_INTERFACE( stream )->Read( stream, buffer, frames )
+#define PA_STREAM_WRITE( stream, buffer, frames )\
+    PA_STREAM_INTERFACE( stream )->Write( stream, buffer, frames )
+#define PA_STREAM_GET_READ_AVAILABLE( stream )  PA_STREAM_INTERFACE( stream )->GetReadAvailable( stream )
+#define PA_STREAM_GET_WRITE_AVAILABLE( stream ) PA_STREAM_INTERFACE( stream )->GetWriteAvailable( stream )
+
+#endif /* PA_DIRECT_STREAM_INTERFACE */
+
+
     
 #ifdef __cplusplus
 }
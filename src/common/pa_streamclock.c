@@ -0,0 +1,144 @@
+/*
+ * Portable Audio I/O Library stream clock
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Stream clock implementation.
+*/
+
+
+#include <string.h> /* memset(), memcpy() */
+
+#include "pa_streamclock.h"
+#include "pa_memorybarrier.h"
+#include "pa_util.h"
+
+
+/* a reader only retries while a single host buffer is being published */
+#define PA_STREAM_CLOCK_READ_ATTEMPTS_ (1000)
+
+
+void PaUtil_InitializeStreamClock( PaUtilStreamClock* clock )
+{
+    memset( clock, 0, sizeof(PaUtilStreamClock) );
+}
+
+
+void PaUtil_ResetStreamClock( PaUtilStreamClock* clock )
+{
+    unsigned long sequence = clock->sequence;
+
+    clock->sequence = sequence + 1;
+    PaUtil_WriteMemoryBarrier();
+
+    memset( (void*)clock, 0, sizeof(PaUtilStreamClock) );
+
+    PaUtil_WriteMemoryBarrier();
+    clock->sequence = sequence + 2;
+}
+
+
+void PaUtil_PublishStreamClock( PaUtilStreamClock* clock, PaTime localTime,
+        PaTime streamTime, double position, double limit, double rate )
+{
+    clock->sequence++;
+    PaUtil_WriteMemoryBarrier();
+
+    clock->localTime = localTime;
+    clock->streamTime = streamTime;
+    clock->position = position;
+    clock->limit = limit;
+    clock->rate = rate;
+
+    PaUtil_WriteMemoryBarrier();
+    clock->sequence++;
+}
+
+
+static void ReadStreamClock( const PaUtilStreamClock* clock, PaUtilStreamClock* result )
+{
+    int attempt;
+
+    for( attempt = 0; attempt < PA_STREAM_CLOCK_READ_ATTEMPTS_; ++attempt )
+    {
+        unsigned long sequence = clock->sequence;
+
+        PaUtil_ReadMemoryBarrier();
+        memcpy( result, (const void*)clock, sizeof(PaUtilStreamClock) );
+        PaUtil_ReadMemoryBarrier();
+
+        if( !(sequence & 1) && clock->sequence == sequence )
+            return;
+    }
+
+    /* treat the clock as unpublished rather than keep the reader waiting */
+    result->localTime = 0.;
+}
+
+
+int PaUtil_GetStreamClockTime( const PaUtilStreamClock* clock, PaTime* streamTime )
+{
+    PaUtilStreamClock c;
+    PaTime now;
+
+    ReadStreamClock( clock, &c );
+    if( c.localTime == 0. )
+        return 0;
+
+    now = PaUtil_GetTime();
+    if( now - c.localTime > PA_UTIL_STREAM_CLOCK_MAX_AGE )
+        return 0;
+
+    *streamTime = c.streamTime + (now - c.localTime);
+    return 1;
+}
+
+
+double PaUtil_GetStreamClockPosition( const PaUtilStreamClock* clock )
+{
+    PaUtilStreamClock c;
+    double position;
+
+    ReadStreamClock( clock, &c );
+    if( c.localTime == 0. )
+        return 0.;
+
+    position = c.position + (PaUtil_GetTime() - c.localTime) * c.rate;
+    if( position > c.limit )
+        position = c.limit;
+    if( position < 0. )
+        position = 0.;
+    return position;
+}
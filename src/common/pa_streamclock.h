@@ -0,0 +1,137 @@
+#ifndef PA_STREAMCLOCK_H
+#define PA_STREAMCLOCK_H
+/*
+ * Portable Audio I/O Library stream clock
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief The position of a callback stream, published by the callback thread
+ for Pa_GetStreamTime() and Pa_GetStreamFramePosition().
+
+ With every host buffer the buffer processor publishes the stream time and
+ the frame position at a PaUtil_GetTime() time, together with the rate at
+ which the position advances. Other threads interpolate from there with a
+ PaUtil_GetTime() call of their own instead of querying the host. As with
+ the statistics, readers copy the clock under a sequence count and retry
+ while it is being published, so neither side ever blocks.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The interpolated stream time is only used for this many seconds after a
+ host buffer, when the host stops calling back the host API's GetTime
+ function is used again.
+*/
+#define PA_UTIL_STREAM_CLOCK_MAX_AGE    (1.)
+
+
+/** The clock of a stream. All fields are private, use the functions below.
+*/
+typedef struct PaUtilStreamClock
+{
+    volatile unsigned long sequence;    /**< odd while the clock is being published */
+
+    PaTime localTime;                   /**< PaUtil_GetTime() at publication, 0 before the first */
+    PaTime streamTime;                  /**< the stream's time at localTime */
+    double position;                    /**< seconds of frames at the nominal sample rate
+                                             played or captured at localTime */
+    double limit;                       /**< seconds of frames the host has been given or has
+                                             delivered, which position never passes */
+    double rate;                        /**< position advanced per second */
+} PaUtilStreamClock;
+
+
+/** Initialize the clock of a stream, which is unpublished until the first
+ PaUtil_PublishStreamClock().
+*/
+void PaUtil_InitializeStreamClock( PaUtilStreamClock* clock );
+
+
+/** Clear the clock when a stream is started. Must not be called while the
+ clock is being published.
+*/
+void PaUtil_ResetStreamClock( PaUtilStreamClock* clock );
+
+
+/** Publish the clock, called from the callback thread.
+
+ @param localTime The PaUtil_GetTime() at which streamTime and position were
+ taken.
+
+ @param streamTime The stream's time, in the time base of its
+ PaStreamCallbackTimeInfo.
+
+ @param position The frames played or captured at localTime, in seconds at
+ the nominal sample rate.
+
+ @param limit The frames through the end of the host buffer, in seconds at
+ the nominal sample rate.
+
+ @param rate The seconds of frames played per second, 1 for a device
+ running exactly at its nominal sample rate.
+*/
+void PaUtil_PublishStreamClock( PaUtilStreamClock* clock, PaTime localTime,
+        PaTime streamTime, double position, double limit, double rate );
+
+
+/** Interpolate the stream time, may be called from any thread.
+
+ @return Non-zero if the clock was published in the last
+ PA_UTIL_STREAM_CLOCK_MAX_AGE seconds and *streamTime has been set.
+*/
+int PaUtil_GetStreamClockTime( const PaUtilStreamClock* clock, PaTime* streamTime );
+
+
+/** Interpolate the position, may be called from any thread.
+
+ @return The frames played or captured, in seconds at the nominal sample
+ rate. 0 before the clock is first published, it doesn't pass the end of the
+ last host buffer published.
+*/
+double PaUtil_GetStreamClockPosition( const PaUtilStreamClock* clock );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_STREAMCLOCK_H */
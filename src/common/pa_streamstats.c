@@ -0,0 +1,296 @@
+/*
+ * Portable Audio I/O Library stream statistics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Stream statistics implementation.
+
+ Bucket 0 holds everything up to 2^-20 seconds, bucket 1 + 4 * octave + k
+ the times from (1 + k / 4) to (1 + (k + 1) / 4) times 2^(octave - 20), the
+ last bucket also everything longer. Percentiles are reported as the upper
+ edge of their bucket, no more than 19% above the exact value, and never
+ above the maximum, which is kept exactly.
+*/
+
+
+#include <math.h> /* frexp(), ldexp(), fabs() */
+#include <string.h> /* memset(), memcpy() */
+
+#include "pa_streamstats.h"
+#include "pa_memorybarrier.h"
+
+
+#define PA_STREAM_STATISTICS_MIN_EXPONENT_  (-20)
+
+/* a reader only retries while a single host buffer is being recorded */
+#define PA_STREAM_STATISTICS_READ_ATTEMPTS_ (1000)
+
+
+static int BucketOf( PaTime seconds )
+{
+    int exponent, bucket;
+    double mantissa;
+
+    if( seconds <= ldexp( 1., PA_STREAM_STATISTICS_MIN_EXPONENT_ ) )
+        return 0;
+
+    /* seconds = mantissa * 2^exponent, 0.5 <= mantissa < 1 */
+    mantissa = frexp( seconds, &exponent );
+    bucket = 1 + (exponent - 1 - PA_STREAM_STATISTICS_MIN_EXPONENT_) * PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE
+            + (int)((2. * mantissa - 1.) * PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE);
+
+    return bucket < PA_STREAM_STATISTICS_BUCKET_COUNT ? bucket : PA_STREAM_STATISTICS_BUCKET_COUNT - 1;
+}
+
+
+static PaTime UpperEdgeOf( int bucket )
+{
+    int octave, k;
+
+    if( bucket == 0 )
+        return ldexp( 1., PA_STREAM_STATISTICS_MIN_EXPONENT_ );
+
+    octave = (bucket - 1) / PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE;
+    k = (bucket - 1) % PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE;
+    return ldexp( 1. + (double)(k + 1) / PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE,
+            octave + PA_STREAM_STATISTICS_MIN_EXPONENT_ );
+}
+
+
+static PaTime Percentile( const unsigned long *histogram, unsigned long count,
+        double fraction, PaTime max )
+{
+    unsigned long target, sum = 0;
+    int bucket;
+
+    if( count == 0 )
+        return 0.;
+
+    target = (unsigned long)ceil( fraction * count );
+    if( target == 0 )
+        target = 1;
+
+    for( bucket = 0; bucket < PA_STREAM_STATISTICS_BUCKET_COUNT; ++bucket )
+    {
+        sum += histogram[bucket];
+        if( sum >= target )
+            break;
+    }
+
+    return bucket < PA_STREAM_STATISTICS_BUCKET_COUNT && UpperEdgeOf( bucket ) < max
+            ? UpperEdgeOf( bucket ) : max;
+}
+
+
+void PaUtil_InitializeStreamStatistics( PaUtilStreamStatistics* statistics, double sampleRate )
+{
+    memset( statistics, 0, sizeof(PaUtilStreamStatistics) );
+    statistics->sampleRate = sampleRate;
+}
+
+
+void PaUtil_ResetStreamStatistics( PaUtilStreamStatistics* statistics )
+{
+    unsigned long sequence = statistics->sequence;
+    double sampleRate = statistics->sampleRate;
+    PaUtilHeadroomNotifier *headroomNotifier = statistics->headroomNotifier;
+
+    statistics->sequence = sequence + 1;
+    PaUtil_WriteMemoryBarrier();
+
+    memset( (void*)statistics, 0, sizeof(PaUtilStreamStatistics) );
+    statistics->sampleRate = sampleRate;
+    statistics->headroomNotifier = headroomNotifier;
+
+    PaUtil_WriteMemoryBarrier();
+    statistics->sequence = sequence + 2;
+}
+
+
+void PaUtil_RecordStreamStatistics( PaUtilStreamStatistics* s,
+        PaTime startTime, PaTime endTime, unsigned long frameCount,
+        PaStreamCallbackFlags statusFlags, PaTime streamTime )
+{
+    PaTime duration = endTime - startTime;
+
+    s->sequence++;
+    PaUtil_WriteMemoryBarrier();
+
+    ++s->bufferCount;
+    ++s->durationHistogram[ BucketOf( duration ) ];
+    if( duration > s->maxDuration )
+        s->maxDuration = duration;
+
+    /* the host buffer is due when the previous one has been played */
+    if( s->previousStartTime > 0. )
+    {
+        PaTime jitter = fabs( (startTime - s->previousStartTime) - s->previousFrameCount / s->sampleRate );
+
+        ++s->jitterCount;
+        ++s->jitterHistogram[ BucketOf( jitter ) ];
+        if( jitter > s->maxJitter )
+            s->maxJitter = jitter;
+    }
+    s->previousStartTime = startTime;
+    s->previousFrameCount = frameCount;
+
+    if( statusFlags & paInputUnderflow )
+    {
+        ++s->inputUnderflowCount;
+        s->lastInputUnderflowTime = streamTime;
+    }
+    if( statusFlags & paInputOverflow )
+    {
+        ++s->inputOverflowCount;
+        s->lastInputOverflowTime = streamTime;
+    }
+    if( statusFlags & paOutputUnderflow )
+    {
+        ++s->outputUnderflowCount;
+        s->lastOutputUnderflowTime = streamTime;
+    }
+    if( statusFlags & paOutputOverflow )
+    {
+        ++s->outputOverflowCount;
+        s->lastOutputOverflowTime = streamTime;
+    }
+
+    PaUtil_WriteMemoryBarrier();
+    s->sequence++;
+}
+
+
+void PaUtil_RecordStreamSampleRate( PaUtilStreamStatistics* s, double estimatedSampleRate )
+{
+    s->sequence++;
+    PaUtil_WriteMemoryBarrier();
+
+    s->estimatedSampleRate = estimatedSampleRate;
+
+    PaUtil_WriteMemoryBarrier();
+    s->sequence++;
+}
+
+
+void PaUtil_RecordStreamCpuLoad( PaUtilStreamStatistics* s, PaUtilCpuLoadMeasurer* measurer )
+{
+    s->sequence++;
+    PaUtil_WriteMemoryBarrier();
+
+    s->bufferProcessingCpuLoad = PaUtil_GetCpuLoad( measurer );
+    s->inputConversionCpuLoad = PaUtil_GetCpuLoadOfStage( measurer, paUtilInputConversionCpuLoadStage );
+    s->callbackCpuLoad = PaUtil_GetCpuLoadOfStage( measurer, paUtilCallbackCpuLoadStage );
+    s->outputConversionCpuLoad = PaUtil_GetCpuLoadOfStage( measurer, paUtilOutputConversionCpuLoadStage );
+    s->threadCpuLoad = PaUtil_GetThreadCpuLoad( measurer );
+
+    PaUtil_WriteMemoryBarrier();
+    s->sequence++;
+}
+
+
+void PaUtil_RecordStreamHeadroom( PaUtilStreamStatistics* s,
+        PaTime outputBufferDacTime, PaTime time )
+{
+    PaTime headroom = outputBufferDacTime - time;
+
+    if( outputBufferDacTime == 0. )
+        return;
+
+    s->sequence++;
+    PaUtil_WriteMemoryBarrier();
+
+    if( s->headroomCount == 0 || headroom < s->outputHeadroomMin )
+        s->outputHeadroomMin = headroom;
+    s->outputHeadroom = headroom;
+    s->headroomCount++;
+
+    PaUtil_WriteMemoryBarrier();
+    s->sequence++;
+
+    if( s->headroomNotifier )
+        PaUtil_CheckHeadroom( s->headroomNotifier, headroom );
+}
+
+
+void PaUtil_SetStreamHeadroomNotifier( PaUtilStreamStatistics* statistics,
+        PaUtilHeadroomNotifier *notifier )
+{
+    statistics->headroomNotifier = notifier;
+}
+
+
+void PaUtil_GetStreamStatistics( const PaUtilStreamStatistics* statistics,
+        PaStreamStatistics* result )
+{
+    PaUtilStreamStatistics s;
+    int attempt;
+
+    for( attempt = 0; attempt < PA_STREAM_STATISTICS_READ_ATTEMPTS_; ++attempt )
+    {
+        unsigned long sequence = statistics->sequence;
+
+        PaUtil_ReadMemoryBarrier();
+        memcpy( &s, (const void*)statistics, sizeof(PaUtilStreamStatistics) );
+        PaUtil_ReadMemoryBarrier();
+
+        if( !(sequence & 1) && statistics->sequence == sequence )
+            break;
+    }
+
+    memset( result, 0, sizeof(PaStreamStatistics) );
+    result->structVersion = 4;
+    result->bufferCount = s.bufferCount;
+    result->callbackDurationMedian = Percentile( s.durationHistogram, s.bufferCount, .5, s.maxDuration );
+    result->callbackDuration99thPercentile = Percentile( s.durationHistogram, s.bufferCount, .99, s.maxDuration );
+    result->callbackDurationMax = s.maxDuration;
+    result->callbackJitter99thPercentile = Percentile( s.jitterHistogram, s.jitterCount, .99, s.maxJitter );
+    result->callbackJitterMax = s.maxJitter;
+    result->inputUnderflowCount = s.inputUnderflowCount;
+    result->inputOverflowCount = s.inputOverflowCount;
+    result->outputUnderflowCount = s.outputUnderflowCount;
+    result->outputOverflowCount = s.outputOverflowCount;
+    result->lastInputUnderflowTime = s.lastInputUnderflowTime;
+    result->lastInputOverflowTime = s.lastInputOverflowTime;
+    result->lastOutputUnderflowTime = s.lastOutputUnderflowTime;
+    result->lastOutputOverflowTime = s.lastOutputOverflowTime;
+    result->estimatedSampleRate = s.estimatedSampleRate > 0. ? s.estimatedSampleRate : s.sampleRate;
+    result->bufferProcessingCpuLoad = s.bufferProcessingCpuLoad;
+    result->inputConversionCpuLoad = s.inputConversionCpuLoad;
+    result->callbackCpuLoad = s.callbackCpuLoad;
+    result->outputConversionCpuLoad = s.outputConversionCpuLoad;
+    result->threadCpuLoad = s.threadCpuLoad;
+    result->outputHeadroom = s.outputHeadroom;
+    result->outputHeadroomMin = s.outputHeadroomMin;
+}
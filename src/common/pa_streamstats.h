@@ -0,0 +1,190 @@
+#ifndef PA_STREAMSTATS_H
+#define PA_STREAMSTATS_H
+/*
+ * Portable Audio I/O Library stream statistics
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Collects the timing and xrun statistics of a callback stream. Used to
+ implement the Pa_GetStreamStatistics() function.
+
+ The buffer processor records every host buffer it processes: how long the
+ processing took, how far the interval since the previous host buffer was
+ from the duration of that buffer and the status flags the host reported.
+ Times are kept in histograms with four buckets per octave, which is all the
+ resolution percentiles need and costs no allocation or search.
+
+ The statistics are written by the callback thread only. Readers on other
+ threads copy them under a sequence count, retrying while a host buffer is
+ being recorded, so neither side ever blocks.
+*/
+
+
+#include "portaudio.h"
+#include "pa_cpuload.h"
+#include "pa_headroom.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+#define PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE (4)
+#define PA_STREAM_STATISTICS_OCTAVES            (24) /* 2^-20 (about a microsecond) to 16 seconds */
+#define PA_STREAM_STATISTICS_BUCKET_COUNT       \
+    (PA_STREAM_STATISTICS_OCTAVES * PA_STREAM_STATISTICS_BUCKETS_PER_OCTAVE + 1)
+
+
+/** The statistics of a stream. All fields are private, use the functions
+ below.
+*/
+typedef struct PaUtilStreamStatistics
+{
+    volatile unsigned long sequence;    /**< odd while a host buffer is being recorded */
+
+    double sampleRate;
+    PaTime previousStartTime;           /**< 0 before the first host buffer */
+    unsigned long previousFrameCount;
+
+    unsigned long bufferCount;
+    unsigned long durationHistogram[PA_STREAM_STATISTICS_BUCKET_COUNT];
+    unsigned long jitterHistogram[PA_STREAM_STATISTICS_BUCKET_COUNT];
+    unsigned long jitterCount;
+    PaTime maxDuration;
+    PaTime maxJitter;
+
+    unsigned long inputUnderflowCount;
+    unsigned long inputOverflowCount;
+    unsigned long outputUnderflowCount;
+    unsigned long outputOverflowCount;
+    PaTime lastInputUnderflowTime;
+    PaTime lastInputOverflowTime;
+    PaTime lastOutputUnderflowTime;
+    PaTime lastOutputOverflowTime;
+
+    double estimatedSampleRate;         /**< 0 until recorded */
+
+    double bufferProcessingCpuLoad;
+    double inputConversionCpuLoad;
+    double callbackCpuLoad;
+    double outputConversionCpuLoad;
+    double threadCpuLoad;
+
+    unsigned long headroomCount;        /**< host buffers whose headroom was recorded */
+    PaTime outputHeadroom;
+    PaTime outputHeadroomMin;
+    PaUtilHeadroomNotifier *headroomNotifier; /**< NULL, or checks each headroom recorded,
+                                             kept by PaUtil_ResetStreamStatistics() */
+} PaUtilStreamStatistics;
+
+
+/** Initialize statistics for a stream running at sampleRate.
+*/
+void PaUtil_InitializeStreamStatistics( PaUtilStreamStatistics* statistics, double sampleRate );
+
+
+/** Clear the statistics when a stream is started. Must not be called while
+ host buffers are being recorded.
+*/
+void PaUtil_ResetStreamStatistics( PaUtilStreamStatistics* statistics );
+
+
+/** Record the processing of a host buffer, called from the callback thread.
+
+ @param startTime The PaUtil_GetTime() at which the host buffer's processing
+ began.
+
+ @param endTime The PaUtil_GetTime() at which it ended.
+
+ @param frameCount The frames of the host buffer.
+
+ @param statusFlags The flags the host passed for the host buffer.
+
+ @param streamTime The stream time of the host buffer, the currentTime of
+ its PaStreamCallbackTimeInfo. Recorded for the xruns it reports.
+*/
+void PaUtil_RecordStreamStatistics( PaUtilStreamStatistics* statistics,
+        PaTime startTime, PaTime endTime, unsigned long frameCount,
+        PaStreamCallbackFlags statusFlags, PaTime streamTime );
+
+
+/** Record the sample rate estimated from the host buffers' timestamps,
+ called from the callback thread.
+
+ @see PaUtil_GetTimeFilterSampleRate
+*/
+void PaUtil_RecordStreamSampleRate( PaUtilStreamStatistics* statistics, double estimatedSampleRate );
+
+
+/** Record the loads the buffer processor has measured, called from the
+ callback thread after each host buffer.
+
+ @param measurer A measurer initialized with
+ PaUtil_InitializeStageCpuLoadMeasurer().
+*/
+void PaUtil_RecordStreamCpuLoad( PaUtilStreamStatistics* statistics, PaUtilCpuLoadMeasurer* measurer );
+
+
+/** Record the output headroom of a host buffer, called from the callback
+ thread after its processing.
+
+ @param outputBufferDacTime The outputBufferDacTime of the host buffer, the
+ headroom isn't recorded when it is 0.
+
+ @param time The PaUtil_GetTime() at which the processing ended.
+*/
+void PaUtil_RecordStreamHeadroom( PaUtilStreamStatistics* statistics,
+        PaTime outputBufferDacTime, PaTime time );
+
+
+/** Set the notifier checking the headroom recorded, or NULL. Must not be
+ called while host buffers are being recorded.
+*/
+void PaUtil_SetStreamHeadroomNotifier( PaUtilStreamStatistics* statistics,
+        PaUtilHeadroomNotifier *notifier );
+
+
+/** Calculate the public statistics, may be called from any thread.
+*/
+void PaUtil_GetStreamStatistics( const PaUtilStreamStatistics* statistics,
+        PaStreamStatistics* result );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_STREAMSTATS_H */
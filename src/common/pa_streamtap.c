@@ -0,0 +1,349 @@
+/*
+ * Portable Audio I/O Library stream taps
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Stream tap implementation.
+*/
+
+
+#include <string.h> /* memcpy(), memmove(), memset() */
+
+#include "pa_streamtap.h"
+#include "pa_memorybarrier.h"
+#include "pa_util.h"
+
+
+/* the smallest ring, and the largest in bytes */
+#define PA_STREAM_TAP_MIN_FRAMES_   (256)
+#define PA_STREAM_TAP_MAX_BYTES_    (0x40000000)
+
+
+typedef struct PaUtilStreamTapRing
+{
+    volatile unsigned long reserved;    /**< frames whose place in the ring the writer has taken */
+    volatile unsigned long written;     /**< frames completely written, never more than reserved */
+    unsigned long frameCount;           /**< a power of 2 */
+    unsigned long bytesPerFrame;
+    unsigned int bytesPerSample;
+    int channelCount;
+    int isInterleaved;                  /**< of the buffers published */
+    unsigned char silentByte;           /**< appended for NULL buffers */
+    unsigned char *data;
+} PaUtilStreamTapRing;
+
+
+struct PaStreamTap
+{
+    PaUtilStreamTapRing *ring;
+    unsigned long readFrame;            /**< the next frame to read, at most ring->written */
+    unsigned long droppedFrames;
+};
+
+
+void PaUtil_InitializeStreamTaps( PaUtilStreamTaps* taps,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        double sampleRate )
+{
+    PaSampleFormat formats[2];
+    int i;
+
+    taps->channelCount[paStreamTapInput] = inputChannelCount;
+    taps->channelCount[paStreamTapOutput] = outputChannelCount;
+    formats[paStreamTapInput] = userInputSampleFormat;
+    formats[paStreamTapOutput] = userOutputSampleFormat;
+
+    for( i=0; i < 2; ++i )
+    {
+        PaError bytesPerSample = taps->channelCount[i] > 0 ? Pa_GetSampleSize( formats[i] ) : 0;
+
+        taps->bytesPerSample[i] = bytesPerSample > 0 ? (unsigned int)bytesPerSample : 0;
+        taps->isInterleaved[i] = !(formats[i] & paNonInterleaved);
+        taps->rings[i] = NULL;
+    }
+    /* the silence of paUInt8 is 128 */
+    taps->silentBytes = 0;
+    if( inputChannelCount > 0 && (userInputSampleFormat & ~paNonInterleaved) == paUInt8 )
+        taps->silentBytes |= 1 << paStreamTapInput;
+    if( outputChannelCount > 0 && (userOutputSampleFormat & ~paNonInterleaved) == paUInt8 )
+        taps->silentBytes |= 1 << paStreamTapOutput;
+    taps->sampleRate = sampleRate;
+}
+
+
+void PaUtil_TerminateStreamTaps( PaUtilStreamTaps* taps )
+{
+    int i;
+
+    for( i=0; i < 2; ++i )
+    {
+        if( taps->rings[i] )
+        {
+            PaUtil_FreeMemory( taps->rings[i]->data );
+            PaUtil_FreeMemory( taps->rings[i] );
+            taps->rings[i] = NULL;
+        }
+    }
+}
+
+
+long PaUtil_GetStreamTapsMemoryUsage( const PaUtilStreamTaps* taps )
+{
+    long result = 0;
+    int i;
+
+    for( i=0; i < 2; ++i )
+    {
+        if( taps->rings[i] )
+            result += (long)(sizeof(PaUtilStreamTapRing)
+                    + taps->rings[i]->frameCount * taps->rings[i]->bytesPerFrame);
+    }
+    return result;
+}
+
+
+PaError PaUtil_AddStreamTap( PaUtilStreamTaps* taps, PaStreamTapSource source,
+        PaTime bufferDuration, PaStreamTap** tap )
+{
+    PaUtilStreamTapRing *ring;
+    double frames;
+
+    if( source != paStreamTapInput && source != paStreamTapOutput )
+        return paInvalidFlag;
+    if( taps->channelCount[source] <= 0 || taps->bytesPerSample[source] == 0 )
+        return paInvalidChannelCount;
+
+    *tap = (PaStreamTap*)PaUtil_AllocateMemory( sizeof(PaStreamTap) );
+    if( !*tap )
+        return paInsufficientMemory;
+
+    ring = taps->rings[source];
+    if( !ring )
+    {
+        unsigned long bytesPerFrame = taps->channelCount[source] * taps->bytesPerSample[source];
+        unsigned long frameCount = PA_STREAM_TAP_MIN_FRAMES_;
+
+        frames = bufferDuration * taps->sampleRate;
+        if( frames * bytesPerFrame > PA_STREAM_TAP_MAX_BYTES_ )
+        {
+            PaUtil_FreeMemory( *tap );
+            return paInsufficientMemory;
+        }
+        while( frameCount < frames )
+            frameCount *= 2;
+
+        ring = (PaUtilStreamTapRing*)PaUtil_AllocateMemory( sizeof(PaUtilStreamTapRing) );
+        if( ring )
+            ring->data = (unsigned char*)PaUtil_AllocateMemory( (long)(frameCount * bytesPerFrame) );
+        if( !ring || !ring->data )
+        {
+            PaUtil_FreeMemory( ring );
+            PaUtil_FreeMemory( *tap );
+            return paInsufficientMemory;
+        }
+
+        ring->reserved = 0;
+        ring->written = 0;
+        ring->frameCount = frameCount;
+        ring->bytesPerFrame = bytesPerFrame;
+        ring->bytesPerSample = taps->bytesPerSample[source];
+        ring->channelCount = taps->channelCount[source];
+        ring->isInterleaved = taps->isInterleaved[source];
+        ring->silentByte = (unsigned char)((taps->silentBytes & (1 << source)) ? 0x80 : 0);
+
+        PaUtil_WriteMemoryBarrier();
+        taps->rings[source] = ring;
+    }
+
+    (*tap)->ring = ring;
+    (*tap)->readFrame = ring->written;
+    (*tap)->droppedFrames = 0;
+
+    return paNoError;
+}
+
+
+/* copy frames of buffer, starting at bufferFrame, to the ring at ringFrame */
+static void CopyToRing( PaUtilStreamTapRing *ring, unsigned long ringFrame,
+        const void *buffer, unsigned long bufferFrame, unsigned long frames )
+{
+    unsigned long bytesPerFrame = ring->bytesPerFrame;
+    unsigned int bytesPerSample = ring->bytesPerSample;
+
+    while( frames > 0 )
+    {
+        unsigned long position = ringFrame & (ring->frameCount - 1);
+        unsigned long chunk = ring->frameCount - position;
+        unsigned char *destination = ring->data + position * bytesPerFrame;
+
+        if( chunk > frames )
+            chunk = frames;
+
+        if( !buffer )
+        {
+            memset( destination, ring->silentByte, chunk * bytesPerFrame );
+        }
+        else if( ring->isInterleaved )
+        {
+            memcpy( destination, (const unsigned char*)buffer + bufferFrame * bytesPerFrame,
+                    chunk * bytesPerFrame );
+        }
+        else
+        {
+            int channel;
+            unsigned long i;
+
+            for( channel = 0; channel < ring->channelCount; ++channel )
+            {
+                const unsigned char *source = (const unsigned char*)((const void* const*)buffer)[channel]
+                        + bufferFrame * bytesPerSample;
+                unsigned char *d = destination + channel * bytesPerSample;
+
+                for( i=0; i < chunk; ++i )
+                {
+                    memcpy( d, source, bytesPerSample );
+                    d += bytesPerFrame;
+                    source += bytesPerSample;
+                }
+            }
+        }
+
+        ringFrame += chunk;
+        bufferFrame += chunk;
+        frames -= chunk;
+    }
+}
+
+
+void PaUtil_PublishStreamTap( PaUtilStreamTaps* taps, PaStreamTapSource source,
+        const void *buffer, unsigned long frameCount )
+{
+    PaUtilStreamTapRing *ring = taps->rings[source];
+    unsigned long start, skipped = 0;
+
+    if( !ring || frameCount == 0 )
+        return;
+
+    /* only the end of a buffer larger than the ring is kept */
+    if( frameCount > ring->frameCount )
+        skipped = frameCount - ring->frameCount;
+
+    start = ring->written;
+    ring->reserved = start + frameCount;
+    PaUtil_WriteMemoryBarrier();
+
+    CopyToRing( ring, start + skipped, buffer, skipped, frameCount - skipped );
+
+    PaUtil_WriteMemoryBarrier();
+    ring->written = start + frameCount;
+}
+
+
+signed long PaUtil_ReadStreamTap( PaStreamTap* tap, void *buffer, unsigned long frames )
+{
+    PaUtilStreamTapRing *ring = tap->ring;
+    unsigned long bytesPerFrame = ring->bytesPerFrame;
+    unsigned long written = ring->written;
+    unsigned long start, oldest, lost = 0, copied = 0;
+
+    PaUtil_ReadMemoryBarrier();
+
+    if( written - tap->readFrame > ring->frameCount )
+    {
+        tap->droppedFrames += written - ring->frameCount - tap->readFrame;
+        tap->readFrame = written - ring->frameCount;
+    }
+    start = tap->readFrame;
+    if( frames > written - start )
+        frames = written - start;
+
+    while( copied < frames )
+    {
+        unsigned long position = (start + copied) & (ring->frameCount - 1);
+        unsigned long chunk = ring->frameCount - position;
+
+        if( chunk > frames - copied )
+            chunk = frames - copied;
+        memcpy( (unsigned char*)buffer + copied * bytesPerFrame,
+                ring->data + position * bytesPerFrame, chunk * bytesPerFrame );
+        copied += chunk;
+    }
+
+    /* the frames the writer may have overwritten while they were copied */
+    PaUtil_ReadMemoryBarrier();
+    oldest = ring->reserved - ring->frameCount;
+    if( (signed long)(oldest - start) > 0 )
+        lost = oldest - start;
+
+    if( lost >= frames )
+    {
+        /* the next read finds any others */
+        tap->droppedFrames += frames;
+        tap->readFrame = start + frames;
+        return 0;
+    }
+
+    if( lost > 0 )
+    {
+        memmove( buffer, (unsigned char*)buffer + lost * bytesPerFrame, (frames - lost) * bytesPerFrame );
+        tap->droppedFrames += lost;
+    }
+    tap->readFrame = start + frames;
+
+    return (signed long)(frames - lost);
+}
+
+
+signed long PaUtil_GetStreamTapReadAvailable( PaStreamTap* tap )
+{
+    unsigned long available = tap->ring->written - tap->readFrame;
+
+    if( available > tap->ring->frameCount )
+        available = tap->ring->frameCount;
+    return (signed long)available;
+}
+
+
+unsigned long PaUtil_GetStreamTapDroppedFrames( const PaStreamTap* tap )
+{
+    return tap->droppedFrames;
+}
+
+
+void PaUtil_RemoveStreamTap( PaStreamTap* tap )
+{
+    PaUtil_FreeMemory( tap );
+}
@@ -0,0 +1,135 @@
+#ifndef PA_STREAMTAP_H
+#define PA_STREAMTAP_H
+/*
+ * Portable Audio I/O Library stream taps
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Copies of the buffers of a callback stream for threads other than
+ the callback, implementing Pa_AddStreamTap().
+
+ After each call of the stream callback, the buffer processor appends the
+ callback's input, as converted to the user's sample format, and the output
+ it returned to a ring of each direction which has taps. There is one ring
+ per direction however many taps read it. The callback thread never waits
+ for the taps: it overwrites the oldest frames when the ring is full, and
+ taps which haven't read them yet skip them and count them as dropped.
+
+ The ring is written under a pair of frame counters. The writer advances
+ reserved before it overwrites frames and written once they are complete, a
+ tap copies frames below written and keeps those which reserved has not
+ caught up with by the ring's size when the copy is done. Neither side
+ takes a lock or makes a system call.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The rings of a stream's buffer processor and the layout of the user
+ buffers they copy, indexed by PaStreamTapSource. All fields are private,
+ use the functions below.
+*/
+typedef struct PaUtilStreamTaps
+{
+    int channelCount[2];
+    unsigned int bytesPerSample[2];
+    int isInterleaved[2];               /**< of the stream callback's buffers */
+    int silentBytes;                    /**< bit 1 << source set if silence is 128, for paUInt8 */
+    double sampleRate;
+
+    struct PaUtilStreamTapRing *rings[2]; /**< NULL until the first tap of the direction */
+} PaUtilStreamTaps;
+
+
+/** Initialize the taps of a buffer processor with the channels and sample
+ formats of its user buffers, without any rings.
+*/
+void PaUtil_InitializeStreamTaps( PaUtilStreamTaps* taps,
+        int inputChannelCount, PaSampleFormat userInputSampleFormat,
+        int outputChannelCount, PaSampleFormat userOutputSampleFormat,
+        double sampleRate );
+
+
+/** Free the rings. Taps created from them must not be read anymore, but
+ still have to be removed with PaUtil_RemoveStreamTap().
+*/
+void PaUtil_TerminateStreamTaps( PaUtilStreamTaps* taps );
+
+
+/** The bytes of memory allocated for the rings. */
+long PaUtil_GetStreamTapsMemoryUsage( const PaUtilStreamTaps* taps );
+
+
+/** Create a tap of source, creating its ring if it is the first. Must not be
+ called while the stream is running. See Pa_AddStreamTap().
+*/
+PaError PaUtil_AddStreamTap( PaUtilStreamTaps* taps, PaStreamTapSource source,
+        PaTime bufferDuration, PaStreamTap** tap );
+
+
+/** Append frameCount frames of a stream callback buffer to the ring of
+ source, if it has one. Called from the callback thread.
+
+ @param buffer The buffer as passed to the stream callback, an array of
+ channel buffers for non-interleaved streams. NULL appends silence.
+*/
+void PaUtil_PublishStreamTap( PaUtilStreamTaps* taps, PaStreamTapSource source,
+        const void *buffer, unsigned long frameCount );
+
+
+/** @see Pa_ReadStreamTap */
+signed long PaUtil_ReadStreamTap( PaStreamTap* tap, void *buffer, unsigned long frames );
+
+/** @see Pa_GetStreamTapReadAvailable */
+signed long PaUtil_GetStreamTapReadAvailable( PaStreamTap* tap );
+
+/** @see Pa_GetStreamTapDroppedFrames */
+unsigned long PaUtil_GetStreamTapDroppedFrames( const PaStreamTap* tap );
+
+/** @see Pa_RemoveStreamTap */
+void PaUtil_RemoveStreamTap( PaStreamTap* tap );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_STREAMTAP_H */
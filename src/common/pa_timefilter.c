@@ -0,0 +1,121 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library callback timestamp filter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief Delay-locked loop implementation.
+
+ With the time t and frame duration s of the loop, an update after n frames
+ predicts the time t + n s, and with the error e of the measured time from
+ the prediction sets t to the prediction plus b e and adds c e / n to s. The
+ coefficients b = sqrt(2) w and c = w^2, with w = 2 pi B n s for the
+ bandwidth B, give a loop damped by 1 / sqrt(2) whose bandwidth doesn't depend
+ on the size of the buffers. As b e stays below half of n s for errors up
+ to PA_UTIL_TIME_FILTER_MAX_ERROR, the filtered times always increase.
+*/
+
+
+#include <math.h> /* fabs(), sqrt() */
+
+#include "pa_timefilter.h"
+
+
+#define PA_TIME_FILTER_TWO_PI_  (6.283185307179586)
+
+
+void PaUtil_InitializeTimeFilter( PaUtilTimeFilter* filter, double sampleRate )
+{
+    filter->nominalSecondsPerFrame = 1. / sampleRate;
+    filter->secondsPerFrame = filter->nominalSecondsPerFrame;
+    PaUtil_ResetTimeFilter( filter );
+}
+
+
+void PaUtil_ResetTimeFilter( PaUtilTimeFilter* filter )
+{
+    filter->time = 0.;
+    filter->framesSinceTime = 0;
+}
+
+
+PaTime PaUtil_FilterTime( PaUtilTimeFilter* filter, PaTime time )
+{
+    PaTime previousTime = filter->time;
+    PaTime predictedTime, error;
+    double omega;
+
+    if( previousTime == 0. )
+    {
+        filter->time = time;
+        filter->framesSinceTime = 0;
+        return time;
+    }
+
+    if( filter->framesSinceTime == 0 )
+        return previousTime;
+
+    predictedTime = previousTime + filter->framesSinceTime * filter->secondsPerFrame;
+    error = time - predictedTime;
+
+    if( fabs( error ) > PA_UTIL_TIME_FILTER_MAX_ERROR )
+    {
+        /* the measured times jumped, restart from the new one */
+        filter->time = ( time > previousTime ) ? time : predictedTime;
+    }
+    else
+    {
+        omega = PA_TIME_FILTER_TWO_PI_ * PA_UTIL_TIME_FILTER_BANDWIDTH
+                * filter->framesSinceTime * filter->secondsPerFrame;
+
+        filter->time = predictedTime + sqrt( 2. ) * omega * error;
+        filter->secondsPerFrame += omega * omega * error / filter->framesSinceTime;
+    }
+
+    filter->framesSinceTime = 0;
+    return filter->time;
+}
+
+
+void PaUtil_AdvanceTimeFilter( PaUtilTimeFilter* filter, unsigned long frameCount )
+{
+    filter->framesSinceTime += frameCount;
+}
+
+
+double PaUtil_GetTimeFilterSampleRate( const PaUtilTimeFilter* filter )
+{
+    return 1. / filter->secondsPerFrame;
+}
@@ -0,0 +1,128 @@
+#ifndef PA_TIMEFILTER_H
+#define PA_TIMEFILTER_H
+/*
+ * $Id$
+ * Portable Audio I/O Library callback timestamp filter
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief A delay-locked loop smoothing the timestamps of host buffers.
+
+ Host APIs timestamp each host buffer with the time its first frame reaches
+ the DAC or left the ADC, usually derived from when the host woke the
+ callback thread, so the times carry the scheduling jitter of that thread.
+ The filter is the second order delay-locked loop described by Fons
+ Adriaensen in "Using a DLL to filter time", which JACK uses for its frame
+ times: it predicts the time of each buffer from the previous one and the
+ frames in between, and corrects both the time and the duration of a frame
+ by a fraction of the prediction error. The result follows the device's
+ clock smoothly and monotonically, and the duration of a frame it converges
+ to gives the actual sample rate of the device measured against the
+ PaUtil_GetTime() clock.
+*/
+
+
+#include "portaudio.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The state of a filter. All fields are private, use the functions below.
+*/
+typedef struct PaUtilTimeFilter
+{
+    double nominalSecondsPerFrame;
+    double secondsPerFrame;         /**< the loop's estimate of the duration of a frame */
+    PaTime time;                    /**< the filtered time of the last update, 0 before the first */
+    unsigned long framesSinceTime;  /**< frames advanced since the last update */
+} PaUtilTimeFilter;
+
+
+/** Initialize a filter for timestamps of frames at nominally sampleRate.
+*/
+void PaUtil_InitializeTimeFilter( PaUtilTimeFilter* filter, double sampleRate );
+
+
+/** Restart the filter, so the next time passed to PaUtil_FilterTime() is
+ taken as it is. Called when a stream is started and when the host reports an
+ xrun, after which the measured times jump. The estimated sample rate is
+ kept.
+*/
+void PaUtil_ResetTimeFilter( PaUtilTimeFilter* filter );
+
+
+/** Filter the time measured for the current frame.
+
+ @param time The measured time, in the PaUtil_GetTime() time base.
+
+ @return The filtered time. It follows the measured times with the loop's
+ bandwidth, is always later than the previous result and jumps to the
+ measured time when it is further than PA_UTIL_TIME_FILTER_MAX_ERROR from the
+ prediction.
+*/
+PaTime PaUtil_FilterTime( PaUtilTimeFilter* filter, PaTime time );
+
+
+/** Advance the current frame by frameCount frames, such as the frames of the
+ host buffer whose time was last filtered.
+*/
+void PaUtil_AdvanceTimeFilter( PaUtilTimeFilter* filter, unsigned long frameCount );
+
+
+/** Retrieve the sample rate which the filter has estimated, the nominal one
+ until it has seen two buffers.
+*/
+double PaUtil_GetTimeFilterSampleRate( const PaUtilTimeFilter* filter );
+
+
+/** The bandwidth of the loop in Hz. Jitter faster than this is removed, the
+ loop settles on a new rate in a few times its inverse.
+*/
+#define PA_UTIL_TIME_FILTER_BANDWIDTH   (.5)
+
+/** Prediction errors in seconds beyond which the loop is restarted, such as
+ when a host API loses buffers without reporting an xrun.
+*/
+#define PA_UTIL_TIME_FILTER_MAX_ERROR   (.1)
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_TIMEFILTER_H */
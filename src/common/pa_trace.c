@@ -53,31 +53,323 @@
 #include "pa_util.h"
 #include "pa_debugprint.h"
 
-#if PA_TRACE_REALTIME_EVENTS
+#include "pa_memorybarrier.h"
+
+#if PA_TRACE_EVENTS
+
+#if defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#   define PA_TRACE_FETCH_AND_INCREMENT_( counter )     __sync_fetch_and_add( (counter), 1 )
+#   define PA_TRACE_THREAD_LOCAL_                       __thread
+#elif defined(_MSC_VER)
+#   include <intrin.h>
+#   define PA_TRACE_FETCH_AND_INCREMENT_( counter )     ((unsigned long)_InterlockedIncrement( (volatile long *)(counter) ) - 1)
+#   define PA_TRACE_THREAD_LOCAL_                       __declspec(thread)
+#else
+#   error An atomic increment is not defined on this system, set PA_TRACE_EVENTS to 0.
+#endif
+
+typedef struct PaUtilTraceRecord
+{
+    volatile unsigned long sequence;    /* the record's index + 1 once written, 0 while being written */
+    PaTime time;
+    const char *message;                /* paUtilTraceMessage only */
+    long arg0;
+    long arg1;
+    int thread;
+    int event;
+    int phase;
+} PaUtilTraceRecord;
+
+/*
+    The writers reserve a record with an atomic increment of writeIndex and
+    publish it with its sequence, the reader accepts a record only if the
+    sequence matches its index before and after copying it. A record can only
+    be torn if a writer is preempted for as long as the other threads take to
+    fill the whole buffer, the reader then drops it.
+*/
+typedef struct PaUtilTraceBuffer
+{
+    PaUtilTraceRecord *records;         /* 0 while not recording */
+    unsigned long mask;
+    PaTime startTime;
+    volatile unsigned long writeIndex;
+} PaUtilTraceBuffer;
+
+static PaUtilTraceBuffer traceBuffer_ = { 0, 0, 0., 0 };
+static volatile unsigned long traceThreadCount_ = 0;
+static PA_TRACE_THREAD_LOCAL_ int traceThread_ = 0; /* 1-based track of the calling thread, 0 before its first event */
+static char *traceFileName_ = 0;
+
+static const char *const traceEventNames_[] =
+{
+    "message",
+    "buffer processing",
+    "xrun",
+    "host wait"
+};
+
+typedef void TraceRecordVisitor( const PaUtilTraceRecord *record, void *userData );
+
+
+static void RecordTraceEvent( int event, int phase, const char *message, long arg0, long arg1 )
+{
+    PaUtilTraceRecord *records = traceBuffer_.records;
+    PaUtilTraceRecord *record;
+    unsigned long index;
+
+    if( !records )
+        return;
+
+    if( traceThread_ == 0 )
+        traceThread_ = (int)PA_TRACE_FETCH_AND_INCREMENT_( &traceThreadCount_ ) + 1;
+
+    index = PA_TRACE_FETCH_AND_INCREMENT_( &traceBuffer_.writeIndex );
+    record = &records[ index & traceBuffer_.mask ];
+
+    record->sequence = 0;
+    PaUtil_WriteMemoryBarrier();
+
+    record->time = PaUtil_GetTime();
+    record->message = message;
+    record->arg0 = arg0;
+    record->arg1 = arg1;
+    record->thread = traceThread_;
+    record->event = event;
+    record->phase = phase;
+
+    PaUtil_WriteMemoryBarrier();
+    record->sequence = index + 1;
+}
+
+
+/* Visit the records in the order they were reserved, returns how many of
+ them were lost. */
+static unsigned long VisitTraceRecords( TraceRecordVisitor *visitor, void *userData )
+{
+    const PaUtilTraceRecord *records = traceBuffer_.records;
+    unsigned long writeIndex, index, lostRecords = 0;
+
+    if( !records )
+        return 0;
+
+    writeIndex = traceBuffer_.writeIndex;
+    PaUtil_ReadMemoryBarrier();
+
+    index = 0;
+    if( writeIndex > traceBuffer_.mask + 1 )
+    {
+        index = writeIndex - (traceBuffer_.mask + 1);
+        lostRecords = index;
+    }
+
+    for( ; index != writeIndex; ++index )
+    {
+        const PaUtilTraceRecord *record = &records[ index & traceBuffer_.mask ];
+        PaUtilTraceRecord copy;
+        unsigned long sequence = record->sequence;
+
+        PaUtil_ReadMemoryBarrier();
+        memcpy( &copy, (const void*)record, sizeof(PaUtilTraceRecord) );
+        PaUtil_ReadMemoryBarrier();
+
+        if( sequence == index + 1 && record->sequence == sequence )
+            (*visitor)( &copy, userData );
+        else
+            ++lostRecords;
+    }
+
+    return lostRecords;
+}
+
+
+PaError PaUtil_StartTraceEvents( unsigned long recordCount )
+{
+    unsigned long size = 2;
+
+    if( traceBuffer_.records )
+    {
+        memset( traceBuffer_.records, 0, (traceBuffer_.mask + 1) * sizeof(PaUtilTraceRecord) );
+    }
+    else
+    {
+        PaUtilTraceRecord *records;
+
+        while( size < recordCount )
+            size <<= 1;
+
+        records = (PaUtilTraceRecord*)PaUtil_AllocateMemory( size * sizeof(PaUtilTraceRecord) );
+        if( !records )
+            return paInsufficientMemory;
+        memset( records, 0, size * sizeof(PaUtilTraceRecord) );
+
+        traceBuffer_.mask = size - 1;
+        traceBuffer_.records = records;
+    }
+
+    traceBuffer_.writeIndex = 0;
+    traceBuffer_.startTime = PaUtil_GetTime();
+    PaUtil_WriteMemoryBarrier();
+
+    return paNoError;
+}
+
+
+void PaUtil_StopTraceEvents( void )
+{
+    PaUtilTraceRecord *records = traceBuffer_.records;
+
+    traceBuffer_.records = 0;
+    PaUtil_WriteMemoryBarrier();
+
+    if( records )
+        PaUtil_FreeMemory( records );
+}
 
-static char const *traceTextArray[PA_MAX_TRACE_RECORDS];
-static int traceIntArray[PA_MAX_TRACE_RECORDS];
-static int traceIndex = 0;
-static int traceBlock = 0;
+
+void PaUtil_RecordTraceEvent( PaUtilTraceEventId event, PaUtilTracePhase phase, long arg0, long arg1 )
+{
+    RecordTraceEvent( event, phase, 0, arg0, arg1 );
+}
+
+
+static void WriteTraceEventName( FILE *f, const PaUtilTraceRecord *record )
+{
+    const char *name = record->event == paUtilTraceMessage ? record->message : 0;
+
+    if( !name && record->event >= 0
+            && record->event < (int)(sizeof(traceEventNames_) / sizeof(traceEventNames_[0])) )
+        name = traceEventNames_[ record->event ];
+
+    if( !name )
+    {
+        fprintf( f, "event %d", record->event );
+        return;
+    }
+
+    for( ; *name; ++name )
+    {
+        if( *name == '"' || *name == '\\' )
+            fprintf( f, "\\%c", *name );
+        else if( (unsigned char)*name < ' ' )
+            fputc( ' ', f );
+        else
+            fputc( *name, f );
+    }
+}
+
+
+typedef struct TraceEventWriter
+{
+    FILE *f;
+    unsigned long eventCount;
+} TraceEventWriter;
+
+
+static void WriteTraceEvent( const PaUtilTraceRecord *record, void *userData )
+{
+    TraceEventWriter *writer = (TraceEventWriter*)userData;
+    FILE *f = writer->f;
+
+    fprintf( f, "%s{\"name\":\"", writer->eventCount++ ? ",\n" : "" );
+    WriteTraceEventName( f, record );
+    fprintf( f, "\",\"cat\":\"portaudio\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,%s"
+            "\"args\":{\"arg0\":%ld,\"arg1\":%ld}}",
+            record->phase, (record->time - traceBuffer_.startTime) * 1e6, record->thread,
+            record->phase == paUtilTraceInstant ? "\"s\":\"t\"," : "",
+            record->arg0, record->arg1 );
+}
+
+
+PaError PaUtil_DumpTraceEvents( const char *fileName )
+{
+    FILE *f = (fileName != NULL) ? fopen( fileName, "w" ) : stdout;
+    TraceEventWriter writer;
+    unsigned long lostRecords;
+    int failed;
+
+    if( !f )
+        return paInternalError;
+
+    writer.f = f;
+    writer.eventCount = 0;
+    fprintf( f, "{\"traceEvents\":[\n" );
+    lostRecords = VisitTraceRecords( WriteTraceEvent, &writer );
+    fprintf( f, "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"lostEvents\":\"%lu\"}}\n", lostRecords );
+
+    failed = ferror( f );
+    if( f != stdout )
+        failed |= fclose( f );
+    else
+        fflush( f );
+
+    return failed ? paInternalError : paNoError;
+}
+
+
+void PaUtil_InitializeTraceEvents( void )
+{
+    const char *fileName = getenv( "PA_TRACE_FILE" );
+
+    if( !fileName || !*fileName || traceFileName_ )
+        return;
+
+    traceFileName_ = (char*)PaUtil_AllocateMemory( (long)strlen( fileName ) + 1 );
+    if( !traceFileName_ )
+        return;
+    strcpy( traceFileName_, fileName );
+
+    if( PaUtil_StartTraceEvents( PA_TRACE_EVENT_RECORDS ) != paNoError )
+    {
+        PaUtil_FreeMemory( traceFileName_ );
+        traceFileName_ = 0;
+    }
+}
+
+
+void PaUtil_TerminateTraceEvents( void )
+{
+    if( traceFileName_ )
+    {
+        if( PaUtil_DumpTraceEvents( traceFileName_ ) != paNoError )
+        {
+            PA_DEBUG(( "PaUtil_TerminateTraceEvents: could not write %s\n", traceFileName_ ));
+        }
+        PaUtil_FreeMemory( traceFileName_ );
+        traceFileName_ = 0;
+    }
+
+    PaUtil_StopTraceEvents();
+}
+
+#endif /* PA_TRACE_EVENTS */
+
+#if PA_TRACE_REALTIME_EVENTS
 
 /*********************************************************************/
 void PaUtil_ResetTraceMessages()
 {
-    traceIndex = 0;
+    PaUtil_StartTraceEvents( PA_MAX_TRACE_RECORDS );
 }
 
 /*********************************************************************/
-void PaUtil_DumpTraceMessages()
+static void PrintTraceMessage( const PaUtilTraceRecord *record, void *userData )
 {
-    int i;
-    int messageCount = (traceIndex < PA_MAX_TRACE_RECORDS) ? traceIndex : PA_MAX_TRACE_RECORDS;
+    int *messageIndex = (int*)userData;
 
-    printf("DumpTraceMessages: traceIndex = %d\n", traceIndex );
-    for( i=0; i<messageCount; i++ )
+    if( record->event == paUtilTraceMessage )
     {
         printf("%3d: %s = 0x%08X\n",
-               i, traceTextArray[i], traceIntArray[i] );
+               *messageIndex, record->message, (int)record->arg0 );
+        ++*messageIndex;
     }
+}
+
+void PaUtil_DumpTraceMessages()
+{
+    int messageIndex = 0;
+
+    printf("DumpTraceMessages: traceIndex = %lu\n", traceBuffer_.writeIndex );
+    VisitTraceRecords( PrintTraceMessage, &messageIndex );
     PaUtil_ResetTraceMessages();
     fflush(stdout);
 }
@@ -85,17 +377,7 @@ void PaUtil_DumpTraceMessages()
 /*********************************************************************/
 void PaUtil_AddTraceMessage( const char *msg, int data )
 {
-    if( (traceIndex == PA_MAX_TRACE_RECORDS) && (traceBlock == 0) )
-    {
-        traceBlock = 1;
-        /*  PaUtil_DumpTraceMessages(); */
-    }
-    else if( traceIndex < PA_MAX_TRACE_RECORDS )
-    {
-        traceTextArray[traceIndex] = msg;
-        traceIntArray[traceIndex] = data;
-        traceIndex++;
-    }
+    RecordTraceEvent( paUtilTraceMessage, paUtilTraceInstant, msg, data, 0 );
 }
 
 /************************************************************************/
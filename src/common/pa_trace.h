@@ -63,6 +63,18 @@
 
  @fn PaUtil_DumpTraceMessages
  @brief Print all messages in the trace buffer to stdout and clear the trace buffer.
+
+ Independently of the above, binary trace events can be recorded cheaply
+ enough to stay compiled in: a record is an event id, a PaUtil_GetTime()
+ timestamp and two integer arguments, stored with a single atomic increment
+ and no locking or formatting, so any thread including the callback thread
+ may record. Recording is off until PaUtil_StartTraceEvents() is called, or
+ PA_TRACE_FILE is set in the environment at Pa_Initialize(), in which case
+ the events are written to that file at Pa_Terminate(). The events are
+ dumped in the Chrome trace event JSON format, which chrome://tracing and
+ Perfetto display, with one track per recording thread.
+
+ The trace event functions are compiled out if PA_TRACE_EVENTS is set to 0.
 */
 
 #ifndef PA_TRACE_REALTIME_EVENTS
@@ -73,12 +85,101 @@
 #define PA_MAX_TRACE_RECORDS      (2048)   /**< Maximum number of records stored in trace buffer */   
 #endif
 
+#include "portaudio.h"
+
+#ifndef PA_TRACE_EVENTS
+#define PA_TRACE_EVENTS              (1)   /**< Set to 0 to compile out the trace event functions defined below */
+#endif
+
+#ifndef PA_TRACE_EVENT_RECORDS
+#define PA_TRACE_EVENT_RECORDS   (65536)   /**< Records kept when tracing is started from the environment */
+#endif
+
+#if PA_TRACE_REALTIME_EVENTS && !PA_TRACE_EVENTS
+#error PA_TRACE_REALTIME_EVENTS records into the trace events, PA_TRACE_EVENTS must be set to 1.
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif /* __cplusplus */
 
 
+/** The ids of the trace events recorded by PortAudio. */
+typedef enum PaUtilTraceEventId
+{
+    paUtilTraceMessage = 0,             /**< PaUtil_AddTraceMessage(), arg0 is its data */
+    paUtilTraceBufferProcessing,        /**< span, a host buffer in the buffer processor. arg0 is the processed frame count at the end, arg1 the status flags */
+    paUtilTraceXrun,                    /**< instant, a host buffer reporting under/overflow. arg0 is the status flags */
+    paUtilTraceHostWait,                /**< span, the host API waiting for the device. arg0 is the available frame count at the end, arg1 nonzero after an xrun */
+    paUtilTraceUserEvent = 64           /**< the first id free for ad hoc instrumentation */
+} PaUtilTraceEventId;
+
+
+/** The phase of a trace event, in the Chrome trace event format's notation. */
+typedef enum PaUtilTracePhase
+{
+    paUtilTraceBegin = 'B',
+    paUtilTraceEnd = 'E',
+    paUtilTraceInstant = 'i'
+} PaUtilTracePhase;
+
+
+#if PA_TRACE_EVENTS
+
+/** Start recording trace events, or clear the records if already started.
+ The most recent recordCount records, rounded up to a power of two, are
+ kept. Must not be called while other threads are recording.
+ @return paNoError or paInsufficientMemory.
+*/
+PaError PaUtil_StartTraceEvents( unsigned long recordCount );
+
+/** Stop recording and free the records. Must not be called while other
+ threads are recording.
+*/
+void PaUtil_StopTraceEvents( void );
+
+/** Record a trace event if recording has been started. Real-time safe.
+*/
+void PaUtil_RecordTraceEvent( PaUtilTraceEventId event, PaUtilTracePhase phase, long arg0, long arg1 );
+
+/** Write the records as Chrome trace event JSON to fileName, or stdout if it
+ is NULL. May be called while other threads are recording, events recorded
+ meanwhile may then be missing.
+ @return paNoError, or paInternalError if the file could not be written.
+*/
+PaError PaUtil_DumpTraceEvents( const char *fileName );
+
+/** Start recording if PA_TRACE_FILE is set in the environment.
+ Called by Pa_Initialize().
+*/
+void PaUtil_InitializeTraceEvents( void );
+
+/** Dump the records to PA_TRACE_FILE if recording was started by
+ PaUtil_InitializeTraceEvents(), and stop recording. Called by Pa_Terminate().
+*/
+void PaUtil_TerminateTraceEvents( void );
+
+#define PA_TRACE_BEGIN( event, arg0, arg1 )     PaUtil_RecordTraceEvent( (event), paUtilTraceBegin, (arg0), (arg1) )
+#define PA_TRACE_END( event, arg0, arg1 )       PaUtil_RecordTraceEvent( (event), paUtilTraceEnd, (arg0), (arg1) )
+#define PA_TRACE_INSTANT( event, arg0, arg1 )   PaUtil_RecordTraceEvent( (event), paUtilTraceInstant, (arg0), (arg1) )
+
+#else
+
+#define PaUtil_StartTraceEvents(recordCount) (paNoError)
+#define PaUtil_StopTraceEvents() /* noop */
+#define PaUtil_RecordTraceEvent(event,phase,arg0,arg1) /* noop */
+#define PaUtil_DumpTraceEvents(fileName) (paNoError)
+#define PaUtil_InitializeTraceEvents() /* noop */
+#define PaUtil_TerminateTraceEvents() /* noop */
+
+#define PA_TRACE_BEGIN( event, arg0, arg1 ) /* noop */
+#define PA_TRACE_END( event, arg0, arg1 ) /* noop */
+#define PA_TRACE_INSTANT( event, arg0, arg1 ) /* noop */
+
+#endif /* PA_TRACE_EVENTS */
+
+
 #if PA_TRACE_REALTIME_EVENTS
 
 void PaUtil_ResetTraceMessages();
@@ -112,6 +112,36 @@ void PaUtil_SetLastHostErrorInfo( PaHostApiTypeId hostApiType, long errorCode,
         const char *errorText );
 
 
+/** Report that devices of a host API were connected or removed, or that its
+ default devices changed, to the callback set with
+ Pa_SetDeviceChangeCallback(). Called by host APIs from any thread while
+ their device change notification is enabled.
+
+ @param hostApi The host API whose devices changed.
+*/
+void PaUtil_NotifyDeviceChange( struct PaUtilHostApiRepresentation *hostApi );
+
+
+/** Allocate size bytes from the arena of the stream which the calling thread
+ is opening with Pa_OpenStreamInArena(). Called by PaUtil_AllocateMemory().
+
+ @param handled Set to 1 if the calling thread is opening a stream in an
+ arena, the block must then not be taken from the heap, else to 0.
+
+ @return The block, or NULL if the arena is exhausted or handled is 0.
+*/
+void *PaUtil_AllocateStreamArenaMemory( long size, int *handled );
+
+
+/** Determine whether block lies in the arena of a stream opened with
+ Pa_OpenStreamInArena(). PaUtil_FreeMemory() leaves such blocks alone, the
+ arena is given back to the application as a whole when the stream closes.
+
+ @return 1 if block is arena memory, 0 otherwise.
+*/
+int PaUtil_IsStreamArenaMemory( const void *block );
+
+
         
 /* the following functions are implemented in a platform platform specific
  .c file
@@ -125,6 +155,68 @@ void *PaUtil_AllocateMemory( long size );
 void PaUtil_FreeMemory( void *block );
 
 
+/** Lock size bytes starting at buffer into physical memory, so that accessing
+ them never causes a page fault. Locking memory is a privileged operation on
+ most systems, callers have to cope with it failing.
+ @return 1 if the memory was locked, 0 otherwise.
+ @see PaUtil_CreateArenaAllocationGroup
+*/
+int PaUtil_LockMemory( void *buffer, long size );
+
+
+/** Unlock memory locked with PaUtil_LockMemory(). */
+void PaUtil_UnlockMemory( void *buffer, long size );
+
+
+/** Bind the pages of size bytes starting at buffer to the memory nodes of
+ the processors cpus, and move those already present there, so that a
+ thread pinned to cpus doesn't access them across the interconnect of a
+ multi-socket system. Only the pages wholly inside the range are bound,
+ neighbouring allocations keep their policy.
+ @return 1 if the memory was placed, 0 on systems with a single memory node
+ or where memory can't be placed, callers carry on either way.
+*/
+int PaUtil_PlaceMemory( void *buffer, long size, const int *cpus, int cpuCount );
+
+
+/** Return the size of the transparent huge pages that memory can be advised
+ to be backed by with PaUtil_AdviseHugePages(), or 0 where the system has
+ none. They are used only if the PA_HUGE_PAGES environment variable is set
+ to 1, as huge pages waste memory with small streams and make the kernel
+ compact memory to provide them.
+ @see PaUtil_CreateArenaAllocationGroup
+*/
+long PaUtil_GetHugePageSize( void );
+
+
+/** Advise that size bytes starting at buffer, which must be aligned to
+ PaUtil_GetHugePageSize(), be backed by huge pages when they are faulted in.
+ @return 1 if the advice was taken, 0 otherwise.
+*/
+int PaUtil_AdviseHugePages( void *buffer, long size );
+
+
+/** Allocate *size bytes of memory that are mapped a second time directly
+ behind the first mapping, so that result[*size + i] is result[i]. A ring
+ buffer in such memory can hand out every region as one contiguous block.
+
+ *size is rounded up to the granularity of the virtual memory system
+ (usually 4 kB, 64 kB on Windows) and must be a multiple of the ring buffer
+ element size to be useful, callers check the rounded value.
+
+ @return The first mapping, or NULL if the memory could not be mirrored,
+ in which case callers fall back to PaUtil_AllocateMemory().
+ @see PaUtil_GetRingBufferContiguousReadRegion
+*/
+void *PaUtil_AllocateMirroredMemory( long *size );
+
+
+/** Release memory allocated with PaUtil_AllocateMirroredMemory(). size is
+ the rounded size. buffer may be NULL.
+*/
+void PaUtil_FreeMirroredMemory( void *buffer, long size );
+
+
 /** Return the number of currently allocated blocks. This function can be
  used for detecting memory leaks.
 
@@ -149,6 +241,144 @@ void PaUtil_InitializeClock( void );
 double PaUtil_GetTime( void );
 
 
+/** The sources PaUtil_GetTime() can read the time from. */
+typedef enum PaUtilClockSource
+{
+    paUtilSystemClock = 0,      /**< the operating system's clock */
+    paUtilCycleCounterClock     /**< the CPU's cycle counter, steered to the system clock */
+} PaUtilClockSource;
+
+
+/** Select the source of PaUtil_GetTime(). PaUtil_InitializeClock() selects
+ the cycle counter if PA_CLOCK_SOURCE is set to "cyclecounter" in the
+ environment, or if the library was built with PA_USE_CYCLE_COUNTER_CLOCK
+ defined to 1, and the system clock otherwise.
+
+ The cycle counter is read without a system call and has a resolution in
+ the nanoseconds. It is only used where it runs at a constant rate and is
+ synchronized between cores: on x86 with an invariant time stamp counter,
+ and on AArch64 (cntvct_el0). It is calibrated against the system clock
+ when selected and then steered towards it without ever running backwards,
+ unless the system clock is set, so the times of both sources may be
+ compared.
+
+ Must not be called while other threads call PaUtil_GetTime().
+
+ @return The source in use from now on, paUtilSystemClock if the requested
+ source is not available.
+*/
+PaUtilClockSource PaUtil_SelectClockSource( PaUtilClockSource source );
+
+
+/** Return the CPU time the calling thread has consumed, in seconds, or a
+ negative value where the system doesn't keep it. Unlike PaUtil_GetTime() it
+ doesn't advance while the thread is preempted or blocked. Where the system
+ only updates it at scheduler ticks, as on Windows, it is only meaningful
+ averaged over many calls.
+*/
+double PaUtil_GetThreadCpuTime( void );
+
+
+/** A small pool of threads running a job in parallel with the thread which
+ hands it out, used to split the work of one callback period across cores.
+ Idle workers spin briefly for the next job and then sleep, so handing out
+ jobs period after period doesn't cost a system call per worker.
+*/
+typedef struct PaUtilWorkerPool PaUtilWorkerPool;
+
+
+/** A job of a PaUtilWorkerPool, run once by each worker.
+
+ @param userData As passed to PaUtil_RunWorkerPool().
+
+ @param worker 0 for the thread calling PaUtil_RunWorkerPool(), 1 to
+ workerCount - 1 for the threads of the pool.
+
+ @param workerCount The size of the pool.
+*/
+typedef void PaUtilWorkerPoolJob( void *userData, int worker, int workerCount );
+
+
+/** Create a worker pool of workerCount workers, the thread calling
+ PaUtil_RunWorkerPool() being one of them. Only implemented on Unix,
+ elsewhere paInternalError is returned.
+
+ @param realTime Nonzero to ask for real-time scheduling of the threads, as
+ for a callback thread.
+
+ @param cpus NULL or the indices of the CPUs the threads may run on.
+*/
+PaError PaUtil_CreateWorkerPool( PaUtilWorkerPool **pool, int workerCount,
+        int realTime, const int *cpus, int cpuCount );
+
+
+/** Stop the threads of a pool and free it. */
+void PaUtil_DestroyWorkerPool( PaUtilWorkerPool *pool );
+
+
+/** The number of workers of a pool, including the calling thread. */
+int PaUtil_GetWorkerPoolSize( const PaUtilWorkerPool *pool );
+
+
+/** Run job on all workers of a pool and return when all of them are done.
+ May only be called by one thread at a time.
+*/
+void PaUtil_RunWorkerPool( PaUtilWorkerPool *pool, PaUtilWorkerPoolJob *job, void *userData );
+
+
+/** A counting semaphore which an audio callback may post to wake a thread,
+ without taking a lock. Implemented per platform: POSIX semaphores on
+ Linux, Mach semaphores on Mac OS X and semaphore objects on Windows.
+*/
+typedef struct PaUtilSemaphore PaUtilSemaphore;
+
+
+/** Create a semaphore with a count of 0. */
+PaError PaUtil_CreateSemaphore( PaUtilSemaphore **semaphore );
+
+
+/** Free a semaphore no thread waits on. */
+void PaUtil_DestroySemaphore( PaUtilSemaphore *semaphore );
+
+
+/** Increment the count of a semaphore, waking a waiting thread. Safe to call
+ from an audio callback.
+*/
+void PaUtil_PostSemaphore( PaUtilSemaphore *semaphore );
+
+
+/** Wait until the count of a semaphore is above 0 and decrement it, or until
+ timeoutSeconds have passed.
+
+ @return paNoError, or paTimedOut if the semaphore wasn't posted in time.
+*/
+PaError PaUtil_WaitSemaphore( PaUtilSemaphore *semaphore, double timeoutSeconds );
+
+
+/** A function run by PaUtil_StartDetachedThread(). */
+typedef void PaUtilDetachedThreadFunction( void *userData );
+
+
+/** Run function on a new thread which nobody joins, it ends when function
+ returns. Used for work which must not block the calling thread, such as
+ Pa_StopStreamAsync(). Implemented per platform.
+*/
+PaError PaUtil_StartDetachedThread( PaUtilDetachedThreadFunction *function, void *userData );
+
+
+/** Return the number of threads Pa_Initialize() may use, from the
+ PA_INITIALIZATION_THREADS environment variable, 1 if it isn't set. With more
+ than one, host APIs are initialized concurrently on a worker pool, and host
+ APIs which probe their devices one by one may probe several at once. Host
+ APIs driving the same hardware, such as ALSA and its OSS emulation, may then
+ find devices busy; ALSA retries opening them for a while.
+
+ Implemented in pa_front.c. Platforms without worker pools initialize
+ sequentially regardless.
+*/
+int PaUtil_GetInitializationThreadCount( void );
+
+
 /* void Pa_Sleep( long msec );  must also be implemented in per-platform .c file */
 
 
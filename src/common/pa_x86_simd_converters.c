@@ -0,0 +1,2628 @@
+/*
+ * SSE2 / AVX2 implementations of PortAudio sample converter functions.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief SSE2 and AVX2 converter function implementations.
+
+ All conversions follow the portable C versions in pa_converters.c
+ bit by bit:
+    o- float -> int casts truncate (cvtt*), values out of range end up at
+       0x80000000 as with the x86 scalar cast
+    o- conversions which are done in double precision by the C versions
+       are done in double precision here, too
+    o- dither values are taken from the same generator in the same order
+
+ Vector loops only run while withAcceleration is set. The remaining samples
+ are passed to the portable converter which was installed before.
+
+ Leaves converters alone if PA_USE_C99_LRINTF is set - the rounding of that
+ variant is not reproduced.
+*/
+
+#include <string.h> /* memcpy */
+
+#include "pa_x86_simd_converters.h"
+
+#include "pa_converters.h"
+#include "pa_converter_variants.h"
+#include "pa_dither.h"
+#include "pa_types.h"
+
+#if !defined(PA_USE_C99_LRINTF) && \
+    ( defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) )
+#define PA_X86_SSE2_
+#include <emmintrin.h>
+
+/* gcc >= 4.9 and clang allow AVX2 code per function, so no need to build the
+   whole library with -mavx2. MSVC does not need any switches for intrinsics.
+*/
+#if defined(__clang__) || \
+    ( defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) )
+#define PA_X86_AVX2_
+#define PA_AVX2_TARGET_ __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define PA_X86_AVX2_
+#define PA_AVX2_TARGET_
+#endif
+
+#ifdef PA_X86_AVX2_
+#include <immintrin.h>
+#endif
+
+/* for the generators in pa_converter_variants.h */
+#define PA_CONVERTER_ATTRIBUTES_SSE2
+#define PA_CONVERTER_ATTRIBUTES_AVX2 PA_AVX2_TARGET_
+
+#endif /* PA_X86_SSE2_ */
+
+
+#ifdef PA_X86_SSE2_
+
+#define PA_SSE2_VECTOR_SIZE 4
+#define PA_AVX2_VECTOR_SIZE 8
+
+/* allow to switch acceleration on/off */
+extern volatile int withAcceleration;
+
+/* portable converters - handle the tail and the not accelerated case */
+static PaUtilConverterTable scalarConverters_;
+static int scalarConvertersSaved_ = 0;
+
+static void SaveScalarConverters( void )
+{
+    if( !scalarConvertersSaved_ )
+    {
+        scalarConverters_ = paConverters;
+        scalarConvertersSaved_ = 1;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void WriteInt24( unsigned char *dest, signed int destinationStride,
+        const PaInt32 *values, int count )
+{
+    int i;
+    PaUint32 temp;
+    for( i=0; i<count; i++ )
+    {
+        /* x86 is little endian */
+        temp = (PaUint32)values[i];
+        dest[0] = (unsigned char)(temp >> 8);
+        dest[1] = (unsigned char)(temp >> 16);
+        dest[2] = (unsigned char)(temp >> 24);
+        dest += destinationStride * 3;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static __inline PaInt32 ReadInt24( const unsigned char *src )
+{
+    return (((PaInt32)src[0]) << 8) |
+           (((PaInt32)src[1]) << 16) |
+           (((PaInt32)src[2]) << 24);
+}
+
+/* -------------------------------------------------------------------------- */
+/* SSE2 helpers */
+
+static __inline __m128 Sse2GetSourceVector( const float *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+        return _mm_loadu_ps( src );
+    return _mm_setr_ps( src[0], src[sourceStride],
+            src[2*sourceStride], src[3*sourceStride] );
+}
+
+/* same as _mm_setr_epi32 - which gcc may assemble on the stack, stalling on
+   the store forwarding once the stride is a constant */
+static __inline __m128i Sse2SetInt32( PaInt32 a, PaInt32 b, PaInt32 c, PaInt32 d )
+{
+    return _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32( _mm_cvtsi32_si128( a ), _mm_cvtsi32_si128( b ) ),
+            _mm_unpacklo_epi32( _mm_cvtsi32_si128( c ), _mm_cvtsi32_si128( d ) ) );
+}
+
+static __inline void Sse2WriteDestVectorFloat32( float *dest, signed int destinationStride,
+        __m128 result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm_storeu_ps( dest, result );
+    }
+    else
+    {
+        float values[PA_SSE2_VECTOR_SIZE];
+        int i;
+        _mm_storeu_ps( values, result );
+        for( i=0; i<PA_SSE2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = values[i];
+    }
+}
+
+static __inline void Sse2WriteDestVectorInt32( PaInt32 *dest, signed int destinationStride,
+        __m128i result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm_storeu_si128( (__m128i*)dest, result );
+    }
+    else
+    {
+        PaInt32 values[PA_SSE2_VECTOR_SIZE];
+        int i;
+        _mm_storeu_si128( (__m128i*)values, result );
+        for( i=0; i<PA_SSE2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = values[i];
+    }
+}
+
+static __inline void Sse2WriteDestVectorInt24( unsigned char *dest, signed int destinationStride,
+        __m128i result )
+{
+    if( destinationStride == 1 )
+    {
+        /* no byte shuffle in SSE2: overlapping 32 bit stores of the
+           upper 3 bytes, the last one must not write beyond the vector */
+        __m128i shifted = _mm_srli_epi32( result, 8 );
+        PaInt32 value;
+        value = _mm_cvtsi128_si32( shifted );
+        memcpy( dest, &value, 4 );
+        value = _mm_cvtsi128_si32( _mm_srli_si128( shifted, 4 ) );
+        memcpy( dest + 3, &value, 4 );
+        value = _mm_cvtsi128_si32( _mm_srli_si128( shifted, 8 ) );
+        memcpy( dest + 6, &value, 4 );
+        value = _mm_cvtsi128_si32( _mm_srli_si128( shifted, 12 ) );
+        memcpy( dest + 9, &value, 3 );
+    }
+    else
+    {
+        PaInt32 values[PA_SSE2_VECTOR_SIZE];
+        _mm_storeu_si128( (__m128i*)values, result );
+        WriteInt24( dest, destinationStride, values, PA_SSE2_VECTOR_SIZE );
+    }
+}
+
+/* result: the lower 4 16 bit lanes */
+static __inline void Sse2WriteDestVectorInt16( PaInt16 *dest, signed int destinationStride,
+        __m128i result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm_storel_epi64( (__m128i*)dest, result );
+    }
+    else
+    {
+        dest[0] = (PaInt16)_mm_extract_epi16( result, 0 );
+        dest[destinationStride] = (PaInt16)_mm_extract_epi16( result, 1 );
+        dest[2*destinationStride] = (PaInt16)_mm_extract_epi16( result, 2 );
+        dest[3*destinationStride] = (PaInt16)_mm_extract_epi16( result, 3 );
+    }
+}
+
+/* (src * 2^31) with clipping done as PA_CLIP_ on the double in the C versions:
+   cvtt returns 0x80000000 for values >= 2^31 - flip those to 0x7FFFFFFF.
+   NaN ends up at the lower limit as in the C version.
+*/
+static __inline __m128i Sse2Float32ToInt32Clip( __m128 scaled )
+{
+    __m128i result = _mm_cvttps_epi32( _mm_max_ps( scaled, _mm_set1_ps( -2147483648.0f ) ) );
+    return _mm_xor_si128( result,
+            _mm_castps_si128( _mm_cmpge_ps( scaled, _mm_set1_ps( 2147483648.0f ) ) ) );
+}
+
+/* (PaInt32)( (double)src * scaler + dither ) done in double precision */
+static __inline __m128i Sse2Float32ToInt32Double( __m128 source, __m128 dither,
+        double scaler, int clip )
+{
+    __m128d mult = _mm_set1_pd( scaler );
+    __m128d low = _mm_add_pd( _mm_mul_pd( _mm_cvtps_pd( source ), mult ),
+            _mm_cvtps_pd( dither ) );
+    __m128d high = _mm_add_pd( _mm_mul_pd( _mm_cvtps_pd( _mm_movehl_ps( source, source ) ), mult ),
+            _mm_cvtps_pd( _mm_movehl_ps( dither, dither ) ) );
+    if( clip )
+    {
+        __m128d minimum = _mm_set1_pd( -2147483648. );
+        __m128d maximum = _mm_set1_pd( 2147483647. );
+        low = _mm_min_pd( _mm_max_pd( low, minimum ), maximum );
+        high = _mm_min_pd( _mm_max_pd( high, minimum ), maximum );
+    }
+    return _mm_unpacklo_epi64( _mm_cvttpd_epi32( low ), _mm_cvttpd_epi32( high ) );
+}
+
+/* keep the lower 16 bits as the (short) cast in C does and pack them
+   to the lower 4 lanes */
+static __inline __m128i Sse2Int32ToInt16( __m128i value )
+{
+    value = _mm_srai_epi32( _mm_slli_epi32( value, 16 ), 16 );
+    return _mm_packs_epi32( value, value );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int32_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( (float)0x7FFFFFFF );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt32( dest, destinationStride,
+                    _mm_cvttps_epi32( _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int32_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int32_Dither_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            /* whole vectors only - PA_DITHER_BLOCK_SIZE is a multiple of the vector sizes */
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_SSE2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_SSE2_VECTOR_SIZE )
+            {
+                /* use smaller scaler to prevent overflow when we add the dither */
+                Sse2WriteDestVectorInt32( dest, destinationStride,
+                        Sse2Float32ToInt32Double( Sse2GetSourceVector( src, sourceStride ),
+                            _mm_loadu_ps( dithers + i ), 2147483646.0, 0 ) );
+
+                src += sourceStride * PA_SSE2_VECTOR_SIZE;
+                dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32_Dither( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int32_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( (float)0x7FFFFFFF );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt32( dest, destinationStride,
+                    Sse2Float32ToInt32Clip( _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int32_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int32_DitherClip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_SSE2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_SSE2_VECTOR_SIZE )
+            {
+                Sse2WriteDestVectorInt32( dest, destinationStride,
+                        Sse2Float32ToInt32Double( Sse2GetSourceVector( src, sourceStride ),
+                            _mm_loadu_ps( dithers + i ), 2147483646.0, 1 ) );
+
+                src += sourceStride * PA_SSE2_VECTOR_SIZE;
+                dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32_DitherClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int24_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            /* convert to 32 bit and drop the low 8 bits - adding 0.0 is exact */
+            Sse2WriteDestVectorInt24( dest, destinationStride,
+                    Sse2Float32ToInt32Double( Sse2GetSourceVector( src, sourceStride ),
+                        _mm_setzero_ps(), 2147483647.0, 0 ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * 3 * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int24_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int24_Dither_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_SSE2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_SSE2_VECTOR_SIZE )
+            {
+                Sse2WriteDestVectorInt24( dest, destinationStride,
+                        Sse2Float32ToInt32Double( Sse2GetSourceVector( src, sourceStride ),
+                            _mm_loadu_ps( dithers + i ), 2147483646.0, 0 ) );
+
+                src += sourceStride * PA_SSE2_VECTOR_SIZE;
+                dest += destinationStride * 3 * PA_SSE2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24_Dither( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int24_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( (float)0x7FFFFFFF );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt24( dest, destinationStride,
+                    Sse2Float32ToInt32Clip( _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * 3 * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int24_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int24_DitherClip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_SSE2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_SSE2_VECTOR_SIZE )
+            {
+                Sse2WriteDestVectorInt24( dest, destinationStride,
+                        Sse2Float32ToInt32Double( Sse2GetSourceVector( src, sourceStride ),
+                            _mm_loadu_ps( dithers + i ), 2147483646.0, 1 ) );
+
+                src += sourceStride * PA_SSE2_VECTOR_SIZE;
+                dest += destinationStride * 3 * PA_SSE2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24_DitherClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int16_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( 32767.0f );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt16( dest, destinationStride, Sse2Int32ToInt16(
+                    _mm_cvttps_epi32( _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int16_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int16_Dither_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* use smaller scaler to prevent overflow when we add the dither */
+        __m128 mult = _mm_set1_ps( 32766.0f );
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_SSE2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_SSE2_VECTOR_SIZE )
+            {
+                __m128 dithered = _mm_add_ps(
+                        _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ),
+                        _mm_loadu_ps( dithers + i ) );
+                Sse2WriteDestVectorInt16( dest, destinationStride,
+                        Sse2Int32ToInt16( _mm_cvttps_epi32( dithered ) ) );
+
+                src += sourceStride * PA_SSE2_VECTOR_SIZE;
+                dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16_Dither( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int16_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( 32767.0f );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i samp = _mm_cvttps_epi32(
+                    _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) );
+            /* saturating pack clips */
+            Sse2WriteDestVectorInt16( dest, destinationStride, _mm_packs_epi32( samp, samp ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int16_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static void Float32_To_Int16_DitherClip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* use smaller scaler to prevent overflow when we add the dither */
+        __m128 mult = _mm_set1_ps( 32766.0f );
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_SSE2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_SSE2_VECTOR_SIZE )
+            {
+                __m128i samp = _mm_cvttps_epi32( _mm_add_ps(
+                        _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ),
+                        _mm_loadu_ps( dithers + i ) ) );
+                /* saturating pack clips */
+                Sse2WriteDestVectorInt16( dest, destinationStride, _mm_packs_epi32( samp, samp ) );
+
+                src += sourceStride * PA_SSE2_VECTOR_SIZE;
+                dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16_DitherClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int32_To_Float32_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* 1/2^31 is exact: rounding once in cvtdq2ps gives the same result
+           as the double precision C version */
+        __m128 mult = _mm_set1_ps( (float)(1.0 / 2147483648.0) );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i source;
+            if( sourceStride == 1 )
+                source = _mm_loadu_si128( (const __m128i*)src );
+            else
+                source = Sse2SetInt32( src[0], src[sourceStride],
+                        src[2*sourceStride], src[3*sourceStride] );
+            Sse2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm_mul_ps( _mm_cvtepi32_ps( source ), mult ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int32_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( SSE2, Int32_To_Float32_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int24_To_Float32_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( (float)(1.0 / 2147483648.0) );
+        signed int srcStep = sourceStride * 3;
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i source = Sse2SetInt32( ReadInt24( src ), ReadInt24( src + srcStep ),
+                    ReadInt24( src + 2*srcStep ), ReadInt24( src + 3*srcStep ) );
+            Sse2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm_mul_ps( _mm_cvtepi32_ps( source ), mult ) );
+
+            src += sourceStride * 3 * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int24_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( SSE2, Int24_To_Float32_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int16_To_Float32_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( 1.0f / 32768.f );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i source;
+            if( sourceStride == 1 )
+                source = _mm_loadl_epi64( (const __m128i*)src );
+            else
+                source = _mm_setr_epi16( src[0], src[sourceStride],
+                        src[2*sourceStride], src[3*sourceStride], 0, 0, 0, 0 );
+            /* sign extend to 32 bit */
+            source = _mm_srai_epi32( _mm_unpacklo_epi16( source, source ), 16 );
+            Sse2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm_mul_ps( _mm_cvtepi32_ps( source ), mult ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int16_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( SSE2, Int16_To_Float32_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+/* paFloat64: a vector of PA_SSE2_VECTOR_SIZE samples is two __m128d */
+
+static __inline __m128d Sse2GetSourceVectorFloat64( const double *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+        return _mm_loadu_pd( src );
+    return _mm_setr_pd( src[0], src[sourceStride] );
+}
+
+static __inline void Sse2WriteDestVectorFloat64( double *dest, signed int destinationStride,
+        __m128d result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm_storeu_pd( dest, result );
+    }
+    else
+    {
+        _mm_storel_pd( dest, result );
+        _mm_storeh_pd( dest + destinationStride, result );
+    }
+}
+
+/* (PaInt32)( src * scaler ) of 4 samples, with clipping done as PA_CLIP_ in the
+   C versions. The limit is the first operand of max/min, which return the second
+   one for NaN: NaN reaches cvtt unclipped just as it does in C. */
+static __inline __m128i Sse2Float64ToInt32( const double *src, signed int sourceStride,
+        double scaler, double minimum, double maximum, int clip )
+{
+    __m128d mult = _mm_set1_pd( scaler );
+    __m128d low = _mm_mul_pd( Sse2GetSourceVectorFloat64( src, sourceStride ), mult );
+    __m128d high = _mm_mul_pd( Sse2GetSourceVectorFloat64( src + 2*sourceStride, sourceStride ), mult );
+    if( clip )
+    {
+        low = _mm_min_pd( _mm_set1_pd( maximum ), _mm_max_pd( _mm_set1_pd( minimum ), low ) );
+        high = _mm_min_pd( _mm_set1_pd( maximum ), _mm_max_pd( _mm_set1_pd( minimum ), high ) );
+    }
+    return _mm_unpacklo_epi64( _mm_cvttpd_epi32( low ), _mm_cvttpd_epi32( high ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Float32_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128 low = _mm_cvtpd_ps( Sse2GetSourceVectorFloat64( src, sourceStride ) );
+            __m128 high = _mm_cvtpd_ps( Sse2GetSourceVectorFloat64( src + 2*sourceStride, sourceStride ) );
+            Sse2WriteDestVectorFloat32( dest, destinationStride, _mm_movelh_ps( low, high ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float64_To_Float32_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int32_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt32( dest, destinationStride,
+                    Sse2Float64ToInt32( src, sourceStride, 2147483647.0, 0, 0, 0 ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float64_To_Int32_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int32_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt32( dest, destinationStride, Sse2Float64ToInt32( src, sourceStride,
+                    2147483647.0, -2147483648., 2147483647., 1 ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int32_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float64_To_Int32_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int16_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            Sse2WriteDestVectorInt16( dest, destinationStride, Sse2Int32ToInt16(
+                    Sse2Float64ToInt32( src, sourceStride, 32767.0, 0, 0, 0 ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int16( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float64_To_Int16_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float64_To_Int16_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            /* not the saturating pack: NaN has to end up as 0 as the (short) cast of
+               0x80000000 in C */
+            Sse2WriteDestVectorInt16( dest, destinationStride, Sse2Int32ToInt16(
+                    Sse2Float64ToInt32( src, sourceStride, 32767.0, -32768., 32767., 1 ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int16_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float64_To_Int16_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Float64_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128 source = Sse2GetSourceVector( src, sourceStride );
+            Sse2WriteDestVectorFloat64( dest, destinationStride, _mm_cvtps_pd( source ) );
+            Sse2WriteDestVectorFloat64( dest + 2*destinationStride, destinationStride,
+                    _mm_cvtps_pd( _mm_movehl_ps( source, source ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Float64( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Float64_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int32_To_Float64_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* both the conversion and the power of 2 scaling are exact */
+        __m128d mult = _mm_set1_pd( 1.0 / 2147483648.0 );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i source;
+            if( sourceStride == 1 )
+                source = _mm_loadu_si128( (const __m128i*)src );
+            else
+                source = Sse2SetInt32( src[0], src[sourceStride],
+                        src[2*sourceStride], src[3*sourceStride] );
+            Sse2WriteDestVectorFloat64( dest, destinationStride,
+                    _mm_mul_pd( _mm_cvtepi32_pd( source ), mult ) );
+            Sse2WriteDestVectorFloat64( dest + 2*destinationStride, destinationStride,
+                    _mm_mul_pd( _mm_cvtepi32_pd( _mm_srli_si128( source, 8 ) ), mult ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int32_To_Float64( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( SSE2, Int32_To_Float64_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Int16_To_Float64_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128d mult = _mm_set1_pd( 1.0 / 32768.0 );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i source;
+            if( sourceStride == 1 )
+                source = _mm_loadl_epi64( (const __m128i*)src );
+            else
+                source = _mm_setr_epi16( src[0], src[sourceStride],
+                        src[2*sourceStride], src[3*sourceStride], 0, 0, 0, 0 );
+            /* sign extend to 32 bit */
+            source = _mm_srai_epi32( _mm_unpacklo_epi16( source, source ), 16 );
+            Sse2WriteDestVectorFloat64( dest, destinationStride,
+                    _mm_mul_pd( _mm_cvtepi32_pd( source ), mult ) );
+            Sse2WriteDestVectorFloat64( dest + 2*destinationStride, destinationStride,
+                    _mm_mul_pd( _mm_cvtepi32_pd( _mm_srli_si128( source, 8 ) ), mult ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int16_To_Float64( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( SSE2, Int16_To_Float64_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+/* result: the lower 4 8 bit lanes */
+static __inline void Sse2WriteDestVectorInt8( unsigned char *dest, signed int destinationStride,
+        __m128i result )
+{
+    PaInt32 values = _mm_cvtsi128_si32( result );
+    if( destinationStride == 1 )
+    {
+        memcpy( dest, &values, 4 );
+    }
+    else
+    {
+        unsigned char bytes[PA_SSE2_VECTOR_SIZE];
+        int i;
+        memcpy( bytes, &values, 4 );
+        for( i=0; i<PA_SSE2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = bytes[i];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_Int8_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( 127.0f );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i samp = _mm_cvttps_epi32(
+                    _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) );
+            /* two saturating packs clip the 32 bit integers as the C version does */
+            samp = _mm_packs_epi32( samp, samp );
+            Sse2WriteDestVectorInt8( dest, destinationStride, _mm_packs_epi16( samp, samp ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int8_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_Int8_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+static PA_CONVERTER_KERNEL_ void Float32_To_UInt8_Clip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 mult = _mm_set1_ps( 127.0f );
+        __m128i offset = _mm_set1_epi32( 128 );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128i samp = _mm_add_epi32( offset, _mm_cvttps_epi32(
+                    _mm_mul_ps( Sse2GetSourceVector( src, sourceStride ), mult ) ) );
+            samp = _mm_packs_epi32( samp, samp );
+            Sse2WriteDestVectorInt8( dest, destinationStride, _mm_packus_epi16( samp, samp ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_UInt8_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( SSE2, Float32_To_UInt8_Clip_SSE2 )
+
+/* -------------------------------------------------------------------------- */
+
+/* Float32_To_Float32_SoftClip() with the same order of operations, the limits
+   are the first operands of max/min to let NaN through as PA_CLIP_ does */
+static void Float32_To_Float32_SoftClip_SSE2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m128 knee = _mm_set1_ps( 1.5f );
+        __m128 negativeKnee = _mm_set1_ps( -1.5f );
+        __m128 cubic = _mm_set1_ps( 4.0f / 27.0f );
+        while( count >= PA_SSE2_VECTOR_SIZE )
+        {
+            __m128 x = _mm_min_ps( knee,
+                    _mm_max_ps( negativeKnee, Sse2GetSourceVector( src, sourceStride ) ) );
+            Sse2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm_sub_ps( x, _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( cubic, x ), x ), x ) ) );
+
+            src += sourceStride * PA_SSE2_VECTOR_SIZE;
+            dest += destinationStride * PA_SSE2_VECTOR_SIZE;
+            count -= PA_SSE2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Float32_SoftClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+#ifdef PA_X86_AVX2_
+
+/* AVX2 helpers */
+
+PA_AVX2_TARGET_
+static __inline __m256i Avx2GetStrideIndexes( signed int stride )
+{
+    return _mm256_mullo_epi32( _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ),
+            _mm256_set1_epi32( stride ) );
+}
+
+PA_AVX2_TARGET_
+static __inline __m256 Avx2GetSourceVector( const float *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+        return _mm256_loadu_ps( src );
+    return _mm256_i32gather_ps( src, Avx2GetStrideIndexes( sourceStride ), 4 );
+}
+
+PA_AVX2_TARGET_
+static __inline __m256i Avx2GetSourceVectorInt32( const PaInt32 *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+        return _mm256_loadu_si256( (const __m256i*)src );
+    return _mm256_i32gather_epi32( (const int*)src, Avx2GetStrideIndexes( sourceStride ), 4 );
+}
+
+PA_AVX2_TARGET_
+static __inline __m128i Avx2GetSourceVectorInt16( const PaInt16 *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+        return _mm_loadu_si128( (const __m128i*)src );
+    return _mm_setr_epi16( src[0], src[sourceStride], src[2*sourceStride], src[3*sourceStride],
+            src[4*sourceStride], src[5*sourceStride], src[6*sourceStride], src[7*sourceStride] );
+}
+
+/* 8 packed 24 bit samples, each in the upper 3 bytes of a lane with the low
+   byte cleared as ReadInt24() returns it. Contiguous samples are expanded
+   with byte shuffles, the second load starts at byte 8 so that both stay
+   inside the 8 samples. Strided ones are gathered 4 bytes per sample and
+   shifted, which reads the byte after the last sample: the caller must only
+   use it while another sample follows, see Avx2HasSourceVectorInt24(). */
+PA_AVX2_TARGET_
+static __inline __m256i Avx2GetSourceVectorInt24( const unsigned char *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+    {
+        __m128i expandLow = _mm_setr_epi8( -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11 );
+        __m128i expandHigh = _mm_setr_epi8( -1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15 );
+        __m128i low = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)src ), expandLow );
+        __m128i high = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(src + 8) ), expandHigh );
+        return _mm256_inserti128_si256( _mm256_castsi128_si256( low ), high, 1 );
+    }
+    return _mm256_slli_epi32( _mm256_i32gather_epi32( (const int*)src,
+            Avx2GetStrideIndexes( sourceStride * 3 ), 1 ), 8 );
+}
+
+static __inline int Avx2HasSourceVectorInt24( unsigned int count, signed int sourceStride )
+{
+    return count > PA_AVX2_VECTOR_SIZE || ( count == PA_AVX2_VECTOR_SIZE && sourceStride == 1 );
+}
+
+PA_AVX2_TARGET_
+static __inline void Avx2WriteDestVectorFloat32( float *dest, signed int destinationStride,
+        __m256 result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm256_storeu_ps( dest, result );
+    }
+    else
+    {
+        float values[PA_AVX2_VECTOR_SIZE];
+        int i;
+        _mm256_storeu_ps( values, result );
+        for( i=0; i<PA_AVX2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = values[i];
+    }
+}
+
+PA_AVX2_TARGET_
+static __inline void Avx2WriteDestVectorInt32( PaInt32 *dest, signed int destinationStride,
+        __m256i result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm256_storeu_si256( (__m256i*)dest, result );
+    }
+    else
+    {
+        PaInt32 values[PA_AVX2_VECTOR_SIZE];
+        int i;
+        _mm256_storeu_si256( (__m256i*)values, result );
+        for( i=0; i<PA_AVX2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = values[i];
+    }
+}
+
+PA_AVX2_TARGET_
+static __inline void Avx2WriteDestVectorInt24( unsigned char *dest, signed int destinationStride,
+        __m256i result )
+{
+    if( destinationStride == 1 )
+    {
+        /* drop the low byte of each lane: 2 * 12 bytes */
+        __m128i compress = _mm_setr_epi8( 1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1 );
+        __m128i low = _mm_shuffle_epi8( _mm256_castsi256_si128( result ), compress );
+        __m128i high = _mm_shuffle_epi8( _mm256_extracti128_si256( result, 1 ), compress );
+        PaInt32 highTail;
+        /* the 4 surplus bytes of the first store are overwritten by the second half */
+        _mm_storeu_si128( (__m128i*)dest, low );
+        _mm_storel_epi64( (__m128i*)(dest + 12), high );
+        highTail = _mm_cvtsi128_si32( _mm_srli_si128( high, 8 ) );
+        memcpy( dest + 20, &highTail, 4 );
+    }
+    else
+    {
+        PaInt32 values[PA_AVX2_VECTOR_SIZE];
+        _mm256_storeu_si256( (__m256i*)values, result );
+        WriteInt24( dest, destinationStride, values, PA_AVX2_VECTOR_SIZE );
+    }
+}
+
+PA_AVX2_TARGET_
+static __inline void Avx2WriteDestVectorInt16( PaInt16 *dest, signed int destinationStride,
+        __m128i result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm_storeu_si128( (__m128i*)dest, result );
+    }
+    else
+    {
+        PaInt16 values[PA_AVX2_VECTOR_SIZE];
+        int i;
+        _mm_storeu_si128( (__m128i*)values, result );
+        for( i=0; i<PA_AVX2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = values[i];
+    }
+}
+
+/* see Sse2Float32ToInt32Clip */
+PA_AVX2_TARGET_
+static __inline __m256i Avx2Float32ToInt32Clip( __m256 scaled )
+{
+    __m256i result = _mm256_cvttps_epi32( _mm256_max_ps( scaled, _mm256_set1_ps( -2147483648.0f ) ) );
+    return _mm256_xor_si256( result, _mm256_castps_si256(
+            _mm256_cmp_ps( scaled, _mm256_set1_ps( 2147483648.0f ), _CMP_GE_OQ ) ) );
+}
+
+/* see Sse2Float32ToInt32Double */
+PA_AVX2_TARGET_
+static __inline __m256i Avx2Float32ToInt32Double( __m256 source, __m256 dither,
+        double scaler, int clip )
+{
+    __m256d mult = _mm256_set1_pd( scaler );
+    __m256d low = _mm256_add_pd(
+            _mm256_mul_pd( _mm256_cvtps_pd( _mm256_castps256_ps128( source ) ), mult ),
+            _mm256_cvtps_pd( _mm256_castps256_ps128( dither ) ) );
+    __m256d high = _mm256_add_pd(
+            _mm256_mul_pd( _mm256_cvtps_pd( _mm256_extractf128_ps( source, 1 ) ), mult ),
+            _mm256_cvtps_pd( _mm256_extractf128_ps( dither, 1 ) ) );
+    if( clip )
+    {
+        __m256d minimum = _mm256_set1_pd( -2147483648. );
+        __m256d maximum = _mm256_set1_pd( 2147483647. );
+        low = _mm256_min_pd( _mm256_max_pd( low, minimum ), maximum );
+        high = _mm256_min_pd( _mm256_max_pd( high, minimum ), maximum );
+    }
+    return _mm256_inserti128_si256( _mm256_castsi128_si256( _mm256_cvttpd_epi32( low ) ),
+            _mm256_cvttpd_epi32( high ), 1 );
+}
+
+/* see Sse2Int32ToInt16 - 8 lanes result */
+PA_AVX2_TARGET_
+static __inline __m128i Avx2Int32ToInt16( __m256i value )
+{
+    value = _mm256_srai_epi32( _mm256_slli_epi32( value, 16 ), 16 );
+    return _mm_packs_epi32( _mm256_castsi256_si128( value ), _mm256_extracti128_si256( value, 1 ) );
+}
+
+PA_AVX2_TARGET_
+static __inline __m128i Avx2Int32ToInt16Clip( __m256i value )
+{
+    return _mm_packs_epi32( _mm256_castsi256_si128( value ), _mm256_extracti128_si256( value, 1 ) );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( (float)0x7FFFFFFF );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt32( dest, destinationStride,
+                    _mm256_cvttps_epi32( _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static void Float32_To_Int32_Dither_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_AVX2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_AVX2_VECTOR_SIZE )
+            {
+                /* use smaller scaler to prevent overflow when we add the dither */
+                Avx2WriteDestVectorInt32( dest, destinationStride,
+                        Avx2Float32ToInt32Double( Avx2GetSourceVector( src, sourceStride ),
+                            _mm256_loadu_ps( dithers + i ), 2147483646.0, 0 ) );
+
+                src += sourceStride * PA_AVX2_VECTOR_SIZE;
+                dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32_Dither( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int32_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( (float)0x7FFFFFFF );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt32( dest, destinationStride,
+                    Avx2Float32ToInt32Clip( _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int32_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static void Float32_To_Int32_DitherClip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_AVX2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_AVX2_VECTOR_SIZE )
+            {
+                Avx2WriteDestVectorInt32( dest, destinationStride,
+                        Avx2Float32ToInt32Double( Avx2GetSourceVector( src, sourceStride ),
+                            _mm256_loadu_ps( dithers + i ), 2147483646.0, 1 ) );
+
+                src += sourceStride * PA_AVX2_VECTOR_SIZE;
+                dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int32_DitherClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int24_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            /* convert to 32 bit and drop the low 8 bits - adding 0.0 is exact */
+            Avx2WriteDestVectorInt24( dest, destinationStride,
+                    Avx2Float32ToInt32Double( Avx2GetSourceVector( src, sourceStride ),
+                        _mm256_setzero_ps(), 2147483647.0, 0 ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * 3 * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int24_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static void Float32_To_Int24_Dither_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_AVX2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_AVX2_VECTOR_SIZE )
+            {
+                Avx2WriteDestVectorInt24( dest, destinationStride,
+                        Avx2Float32ToInt32Double( Avx2GetSourceVector( src, sourceStride ),
+                            _mm256_loadu_ps( dithers + i ), 2147483646.0, 0 ) );
+
+                src += sourceStride * PA_AVX2_VECTOR_SIZE;
+                dest += destinationStride * 3 * PA_AVX2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24_Dither( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int24_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( (float)0x7FFFFFFF );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt24( dest, destinationStride,
+                    Avx2Float32ToInt32Clip( _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * 3 * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int24_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static void Float32_To_Int24_DitherClip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_AVX2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDither24Block( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_AVX2_VECTOR_SIZE )
+            {
+                Avx2WriteDestVectorInt24( dest, destinationStride,
+                        Avx2Float32ToInt32Double( Avx2GetSourceVector( src, sourceStride ),
+                            _mm256_loadu_ps( dithers + i ), 2147483646.0, 1 ) );
+
+                src += sourceStride * PA_AVX2_VECTOR_SIZE;
+                dest += destinationStride * 3 * PA_AVX2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int24_DitherClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int16_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( 32767.0f );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt16( dest, destinationStride, Avx2Int32ToInt16(
+                    _mm256_cvttps_epi32( _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int16_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static void Float32_To_Int16_Dither_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* use smaller scaler to prevent overflow when we add the dither */
+        __m256 mult = _mm256_set1_ps( 32766.0f );
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_AVX2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_AVX2_VECTOR_SIZE )
+            {
+                __m256 dithered = _mm256_add_ps(
+                        _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ),
+                        _mm256_loadu_ps( dithers + i ) );
+                Avx2WriteDestVectorInt16( dest, destinationStride,
+                        Avx2Int32ToInt16( _mm256_cvttps_epi32( dithered ) ) );
+
+                src += sourceStride * PA_AVX2_VECTOR_SIZE;
+                dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16_Dither( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int16_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( 32767.0f );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            /* saturating pack clips */
+            Avx2WriteDestVectorInt16( dest, destinationStride, Avx2Int32ToInt16Clip(
+                    _mm256_cvttps_epi32( _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int16_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static void Float32_To_Int16_DitherClip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* use smaller scaler to prevent overflow when we add the dither */
+        __m256 mult = _mm256_set1_ps( 32766.0f );
+        float dithers[PA_DITHER_BLOCK_SIZE];
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            unsigned int i, n = (count < PA_DITHER_BLOCK_SIZE ? count : PA_DITHER_BLOCK_SIZE) & ~(PA_AVX2_VECTOR_SIZE - 1);
+
+            PaUtil_GenerateFloatTriangularDitherBlock( ditherGenerator, dithers, n );
+            for( i=0; i<n; i+=PA_AVX2_VECTOR_SIZE )
+            {
+                __m256 dithered = _mm256_add_ps(
+                        _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ),
+                        _mm256_loadu_ps( dithers + i ) );
+                /* saturating pack clips */
+                Avx2WriteDestVectorInt16( dest, destinationStride,
+                        Avx2Int32ToInt16Clip( _mm256_cvttps_epi32( dithered ) ) );
+
+                src += sourceStride * PA_AVX2_VECTOR_SIZE;
+                dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            }
+            count -= n;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int16_DitherClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int32_To_Float32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* see Int32_To_Float32_SSE2 */
+        __m256 mult = _mm256_set1_ps( (float)(1.0 / 2147483648.0) );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m256i source;
+            if( sourceStride == 1 )
+                source = _mm256_loadu_si256( (const __m256i*)src );
+            else
+                source = _mm256_i32gather_epi32( (const int*)src,
+                        Avx2GetStrideIndexes( sourceStride ), 4 );
+            Avx2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm256_mul_ps( _mm256_cvtepi32_ps( source ), mult ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int32_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int32_To_Float32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int24_To_Float32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( (float)(1.0 / 2147483648.0) );
+        while( Avx2HasSourceVectorInt24( count, sourceStride ) )
+        {
+            Avx2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm256_mul_ps( _mm256_cvtepi32_ps( Avx2GetSourceVectorInt24( src, sourceStride ) ), mult ) );
+
+            src += sourceStride * 3 * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int24_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int24_To_Float32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+/* The integer conversions to and from Int24 are byte shuffles: they drop or
+   add low bytes exactly as the portable versions do. */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int24_To_Int32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( Avx2HasSourceVectorInt24( count, sourceStride ) )
+        {
+            Avx2WriteDestVectorInt32( dest, destinationStride, Avx2GetSourceVectorInt24( src, sourceStride ) );
+
+            src += sourceStride * 3 * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int24_To_Int32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int24_To_Int32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int24_To_Int16_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    unsigned char *src = (unsigned char*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( Avx2HasSourceVectorInt24( count, sourceStride ) )
+        {
+            /* the upper 2 bytes of each sample, which always fit */
+            Avx2WriteDestVectorInt16( dest, destinationStride,
+                    Avx2Int32ToInt16Clip( _mm256_srai_epi32( Avx2GetSourceVectorInt24( src, sourceStride ), 16 ) ) );
+
+            src += sourceStride * 3 * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int24_To_Int16( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int24_To_Int16_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int32_To_Int24_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt24( dest, destinationStride, Avx2GetSourceVectorInt32( src, sourceStride ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * 3 * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int32_To_Int24( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Int32_To_Int24_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int16_To_Int24_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt24( dest, destinationStride, _mm256_slli_epi32(
+                    _mm256_cvtepi16_epi32( Avx2GetSourceVectorInt16( src, sourceStride ) ), 16 ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * 3 * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int16_To_Int24( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Int16_To_Int24_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int16_To_Float32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( 1.0f / 32768.f );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m128i source = Avx2GetSourceVectorInt16( src, sourceStride );
+            Avx2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm256_mul_ps( _mm256_cvtepi32_ps( _mm256_cvtepi16_epi32( source ) ), mult ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int16_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int16_To_Float32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+/* paFloat64: a vector of PA_AVX2_VECTOR_SIZE samples is two __m256d */
+
+PA_AVX2_TARGET_
+static __inline __m256d Avx2GetSourceVectorFloat64( const double *src, signed int sourceStride )
+{
+    if( sourceStride == 1 )
+        return _mm256_loadu_pd( src );
+    return _mm256_setr_pd( src[0], src[sourceStride], src[2*sourceStride], src[3*sourceStride] );
+}
+
+PA_AVX2_TARGET_
+static __inline void Avx2WriteDestVectorFloat64( double *dest, signed int destinationStride,
+        __m256d result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm256_storeu_pd( dest, result );
+    }
+    else
+    {
+        double values[PA_AVX2_VECTOR_SIZE / 2];
+        int i;
+        _mm256_storeu_pd( values, result );
+        for( i=0; i<PA_AVX2_VECTOR_SIZE / 2; i++ )
+            dest[i*destinationStride] = values[i];
+    }
+}
+
+/* see Sse2Float64ToInt32 */
+PA_AVX2_TARGET_
+static __inline __m256i Avx2Float64ToInt32( const double *src, signed int sourceStride,
+        double scaler, double minimum, double maximum, int clip )
+{
+    __m256d mult = _mm256_set1_pd( scaler );
+    __m256d low = _mm256_mul_pd( Avx2GetSourceVectorFloat64( src, sourceStride ), mult );
+    __m256d high = _mm256_mul_pd( Avx2GetSourceVectorFloat64( src + 4*sourceStride, sourceStride ), mult );
+    if( clip )
+    {
+        low = _mm256_min_pd( _mm256_set1_pd( maximum ), _mm256_max_pd( _mm256_set1_pd( minimum ), low ) );
+        high = _mm256_min_pd( _mm256_set1_pd( maximum ), _mm256_max_pd( _mm256_set1_pd( minimum ), high ) );
+    }
+    return _mm256_inserti128_si256( _mm256_castsi128_si256( _mm256_cvttpd_epi32( low ) ),
+            _mm256_cvttpd_epi32( high ), 1 );
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float64_To_Float32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m128 low = _mm256_cvtpd_ps( Avx2GetSourceVectorFloat64( src, sourceStride ) );
+            __m128 high = _mm256_cvtpd_ps( Avx2GetSourceVectorFloat64( src + 4*sourceStride, sourceStride ) );
+            Avx2WriteDestVectorFloat32( dest, destinationStride,
+                    _mm256_insertf128_ps( _mm256_castps128_ps256( low ), high, 1 ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Float32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float64_To_Float32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float64_To_Int32_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt32( dest, destinationStride,
+                    Avx2Float64ToInt32( src, sourceStride, 2147483647.0, 0, 0, 0 ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int32( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float64_To_Int32_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float64_To_Int32_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt32 *dest = (PaInt32*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt32( dest, destinationStride, Avx2Float64ToInt32( src, sourceStride,
+                    2147483647.0, -2147483648., 2147483647., 1 ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int32_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float64_To_Int32_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float64_To_Int16_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            Avx2WriteDestVectorInt16( dest, destinationStride, Avx2Int32ToInt16(
+                    Avx2Float64ToInt32( src, sourceStride, 32767.0, 0, 0, 0 ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int16( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float64_To_Int16_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float64_To_Int16_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    double *src = (double*)sourceBuffer;
+    PaInt16 *dest = (PaInt16*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            /* see Float64_To_Int16_Clip_SSE2 */
+            Avx2WriteDestVectorInt16( dest, destinationStride, Avx2Int32ToInt16(
+                    Avx2Float64ToInt32( src, sourceStride, 32767.0, -32768., 32767., 1 ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float64_To_Int16_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float64_To_Int16_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Float64_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m256 source = Avx2GetSourceVector( src, sourceStride );
+            Avx2WriteDestVectorFloat64( dest, destinationStride,
+                    _mm256_cvtps_pd( _mm256_castps256_ps128( source ) ) );
+            Avx2WriteDestVectorFloat64( dest + 4*destinationStride, destinationStride,
+                    _mm256_cvtps_pd( _mm256_extractf128_ps( source, 1 ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Float64( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Float64_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int32_To_Float64_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt32 *src = (PaInt32*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* see Int32_To_Float64_SSE2 */
+        __m256d mult = _mm256_set1_pd( 1.0 / 2147483648.0 );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m256i source = Avx2GetSourceVectorInt32( src, sourceStride );
+            Avx2WriteDestVectorFloat64( dest, destinationStride,
+                    _mm256_mul_pd( _mm256_cvtepi32_pd( _mm256_castsi256_si128( source ) ), mult ) );
+            Avx2WriteDestVectorFloat64( dest + 4*destinationStride, destinationStride,
+                    _mm256_mul_pd( _mm256_cvtepi32_pd( _mm256_extracti128_si256( source, 1 ) ), mult ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int32_To_Float64( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int32_To_Float64_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Int16_To_Float64_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    PaInt16 *src = (PaInt16*)sourceBuffer;
+    double *dest = (double*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256d mult = _mm256_set1_pd( 1.0 / 32768.0 );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m256i source = _mm256_cvtepi16_epi32( Avx2GetSourceVectorInt16( src, sourceStride ) );
+            Avx2WriteDestVectorFloat64( dest, destinationStride,
+                    _mm256_mul_pd( _mm256_cvtepi32_pd( _mm256_castsi256_si128( source ) ), mult ) );
+            Avx2WriteDestVectorFloat64( dest + 4*destinationStride, destinationStride,
+                    _mm256_mul_pd( _mm256_cvtepi32_pd( _mm256_extracti128_si256( source, 1 ) ), mult ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Int16_To_Float64( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_INPUT_STRIDE_CONVERTERS_( AVX2, Int16_To_Float64_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+/* result: the lower 8 8 bit lanes */
+PA_AVX2_TARGET_
+static __inline void Avx2WriteDestVectorInt8( unsigned char *dest, signed int destinationStride,
+        __m128i result )
+{
+    if( destinationStride == 1 )
+    {
+        _mm_storel_epi64( (__m128i*)dest, result );
+    }
+    else
+    {
+        unsigned char bytes[16];
+        int i;
+        _mm_storeu_si128( (__m128i*)bytes, result );
+        for( i=0; i<PA_AVX2_VECTOR_SIZE; i++ )
+            dest[i*destinationStride] = bytes[i];
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_Int8_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        /* see Float32_To_Int8_Clip_SSE2 */
+        __m256 mult = _mm256_set1_ps( 127.0f );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m128i samp = Avx2Int32ToInt16Clip( _mm256_cvttps_epi32(
+                    _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) );
+            Avx2WriteDestVectorInt8( dest, destinationStride, _mm_packs_epi16( samp, samp ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Int8_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_Int8_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+PA_AVX2_TARGET_
+static PA_CONVERTER_KERNEL_ void Float32_To_UInt8_Clip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    unsigned char *dest = (unsigned char*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 mult = _mm256_set1_ps( 127.0f );
+        __m256i offset = _mm256_set1_epi32( 128 );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m128i samp = Avx2Int32ToInt16Clip( _mm256_add_epi32( offset, _mm256_cvttps_epi32(
+                    _mm256_mul_ps( Avx2GetSourceVector( src, sourceStride ), mult ) ) ) );
+            Avx2WriteDestVectorInt8( dest, destinationStride, _mm_packus_epi16( samp, samp ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_UInt8_Clip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+PA_OUTPUT_STRIDE_CONVERTERS_( AVX2, Float32_To_UInt8_Clip_AVX2 )
+
+/* -------------------------------------------------------------------------- */
+
+/* see Float32_To_Float32_SoftClip_SSE2 */
+PA_AVX2_TARGET_
+static void Float32_To_Float32_SoftClip_AVX2(
+    void *destinationBuffer, signed int destinationStride,
+    void *sourceBuffer, signed int sourceStride,
+    unsigned int count, struct PaUtilTriangularDitherGenerator *ditherGenerator )
+{
+    float *src = (float*)sourceBuffer;
+    float *dest = (float*)destinationBuffer;
+
+    if( withAcceleration )
+    {
+        __m256 knee = _mm256_set1_ps( 1.5f );
+        __m256 negativeKnee = _mm256_set1_ps( -1.5f );
+        __m256 cubic = _mm256_set1_ps( 4.0f / 27.0f );
+        while( count >= PA_AVX2_VECTOR_SIZE )
+        {
+            __m256 x = _mm256_min_ps( knee,
+                    _mm256_max_ps( negativeKnee, Avx2GetSourceVector( src, sourceStride ) ) );
+            Avx2WriteDestVectorFloat32( dest, destinationStride, _mm256_sub_ps( x,
+                    _mm256_mul_ps( _mm256_mul_ps( _mm256_mul_ps( cubic, x ), x ), x ) ) );
+
+            src += sourceStride * PA_AVX2_VECTOR_SIZE;
+            dest += destinationStride * PA_AVX2_VECTOR_SIZE;
+            count -= PA_AVX2_VECTOR_SIZE;
+        }
+    }
+
+    scalarConverters_.Float32_To_Float32_SoftClip( dest, destinationStride,
+            src, sourceStride, count, ditherGenerator );
+}
+
+#endif /* PA_X86_AVX2_ */
+
+/* -------------------------------------------------------------------------- */
+
+static const PaUtilStrideConverter *const sse2StrideConverters_[] = {
+    Float32_To_Int32_SSE2_Strides,
+    Float32_To_Int32_Clip_SSE2_Strides,
+    Float32_To_Int24_SSE2_Strides,
+    Float32_To_Int24_Clip_SSE2_Strides,
+    Float32_To_Int16_SSE2_Strides,
+    Float32_To_Int16_Clip_SSE2_Strides,
+    Int32_To_Float32_SSE2_Strides,
+    Int24_To_Float32_SSE2_Strides,
+    Int16_To_Float32_SSE2_Strides,
+    Float64_To_Float32_SSE2_Strides,
+    Float64_To_Int32_SSE2_Strides,
+    Float64_To_Int32_Clip_SSE2_Strides,
+    Float64_To_Int16_SSE2_Strides,
+    Float64_To_Int16_Clip_SSE2_Strides,
+    Float32_To_Float64_SSE2_Strides,
+    Int32_To_Float64_SSE2_Strides,
+    Int16_To_Float64_SSE2_Strides,
+    Float32_To_Int8_Clip_SSE2_Strides,
+    Float32_To_UInt8_Clip_SSE2_Strides
+};
+
+#ifdef PA_X86_AVX2_
+static const PaUtilStrideConverter *const avx2StrideConverters_[] = {
+    Float32_To_Int32_AVX2_Strides,
+    Float32_To_Int32_Clip_AVX2_Strides,
+    Float32_To_Int24_AVX2_Strides,
+    Float32_To_Int24_Clip_AVX2_Strides,
+    Float32_To_Int16_AVX2_Strides,
+    Float32_To_Int16_Clip_AVX2_Strides,
+    Int32_To_Float32_AVX2_Strides,
+    Int24_To_Float32_AVX2_Strides,
+    Int16_To_Float32_AVX2_Strides,
+    Int24_To_Int32_AVX2_Strides,
+    Int24_To_Int16_AVX2_Strides,
+    Int32_To_Int24_AVX2_Strides,
+    Int16_To_Int24_AVX2_Strides,
+    Float64_To_Float32_AVX2_Strides,
+    Float64_To_Int32_AVX2_Strides,
+    Float64_To_Int32_Clip_AVX2_Strides,
+    Float64_To_Int16_AVX2_Strides,
+    Float64_To_Int16_Clip_AVX2_Strides,
+    Float32_To_Float64_AVX2_Strides,
+    Int32_To_Float64_AVX2_Strides,
+    Int16_To_Float64_AVX2_Strides,
+    Float32_To_Int8_Clip_AVX2_Strides,
+    Float32_To_UInt8_Clip_AVX2_Strides
+};
+#endif
+
+#endif /* PA_X86_SSE2_ */
+
+/* -------------------------------------------------------------------------- */
+
+int PaUtil_InitializeX86SSE2Converters( void )
+{
+#ifdef PA_X86_SSE2_
+    SaveScalarConverters();
+
+    paConverters.Float32_To_Int32 = Float32_To_Int32_SSE2_Generic;
+    paConverters.Float32_To_Int32_Dither = Float32_To_Int32_Dither_SSE2;
+    paConverters.Float32_To_Int32_Clip = Float32_To_Int32_Clip_SSE2_Generic;
+    paConverters.Float32_To_Int32_DitherClip = Float32_To_Int32_DitherClip_SSE2;
+
+    paConverters.Float32_To_Int24 = Float32_To_Int24_SSE2_Generic;
+    paConverters.Float32_To_Int24_Dither = Float32_To_Int24_Dither_SSE2;
+    paConverters.Float32_To_Int24_Clip = Float32_To_Int24_Clip_SSE2_Generic;
+    paConverters.Float32_To_Int24_DitherClip = Float32_To_Int24_DitherClip_SSE2;
+
+    paConverters.Float32_To_Int16 = Float32_To_Int16_SSE2_Generic;
+    paConverters.Float32_To_Int16_Dither = Float32_To_Int16_Dither_SSE2;
+    paConverters.Float32_To_Int16_Clip = Float32_To_Int16_Clip_SSE2_Generic;
+    paConverters.Float32_To_Int16_DitherClip = Float32_To_Int16_DitherClip_SSE2;
+
+    paConverters.Int32_To_Float32 = Int32_To_Float32_SSE2_Generic;
+    paConverters.Int24_To_Float32 = Int24_To_Float32_SSE2_Generic;
+    paConverters.Int16_To_Float32 = Int16_To_Float32_SSE2_Generic;
+
+    paConverters.Float64_To_Float32 = Float64_To_Float32_SSE2_Generic;
+    paConverters.Float64_To_Int32 = Float64_To_Int32_SSE2_Generic;
+    paConverters.Float64_To_Int32_Clip = Float64_To_Int32_Clip_SSE2_Generic;
+    paConverters.Float64_To_Int16 = Float64_To_Int16_SSE2_Generic;
+    paConverters.Float64_To_Int16_Clip = Float64_To_Int16_Clip_SSE2_Generic;
+    paConverters.Float32_To_Float64 = Float32_To_Float64_SSE2_Generic;
+    paConverters.Int32_To_Float64 = Int32_To_Float64_SSE2_Generic;
+    paConverters.Int16_To_Float64 = Int16_To_Float64_SSE2_Generic;
+
+    paConverters.Float32_To_Int8_Clip = Float32_To_Int8_Clip_SSE2_Generic;
+    paConverters.Float32_To_UInt8_Clip = Float32_To_UInt8_Clip_SSE2_Generic;
+    paConverters.Float32_To_Float32_SoftClip = Float32_To_Float32_SoftClip_SSE2;
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+int PaUtil_InitializeX86AVX2Converters( void )
+{
+#ifdef PA_X86_AVX2_
+    SaveScalarConverters();
+
+    paConverters.Float32_To_Int32 = Float32_To_Int32_AVX2_Generic;
+    paConverters.Float32_To_Int32_Dither = Float32_To_Int32_Dither_AVX2;
+    paConverters.Float32_To_Int32_Clip = Float32_To_Int32_Clip_AVX2_Generic;
+    paConverters.Float32_To_Int32_DitherClip = Float32_To_Int32_DitherClip_AVX2;
+
+    paConverters.Float32_To_Int24 = Float32_To_Int24_AVX2_Generic;
+    paConverters.Float32_To_Int24_Dither = Float32_To_Int24_Dither_AVX2;
+    paConverters.Float32_To_Int24_Clip = Float32_To_Int24_Clip_AVX2_Generic;
+    paConverters.Float32_To_Int24_DitherClip = Float32_To_Int24_DitherClip_AVX2;
+
+    paConverters.Float32_To_Int16 = Float32_To_Int16_AVX2_Generic;
+    paConverters.Float32_To_Int16_Dither = Float32_To_Int16_Dither_AVX2;
+    paConverters.Float32_To_Int16_Clip = Float32_To_Int16_Clip_AVX2_Generic;
+    paConverters.Float32_To_Int16_DitherClip = Float32_To_Int16_DitherClip_AVX2;
+
+    paConverters.Int32_To_Float32 = Int32_To_Float32_AVX2_Generic;
+    paConverters.Int24_To_Float32 = Int24_To_Float32_AVX2_Generic;
+    paConverters.Int16_To_Float32 = Int16_To_Float32_AVX2_Generic;
+
+    paConverters.Int24_To_Int32 = Int24_To_Int32_AVX2_Generic;
+    paConverters.Int24_To_Int16 = Int24_To_Int16_AVX2_Generic;
+    paConverters.Int32_To_Int24 = Int32_To_Int24_AVX2_Generic;
+    paConverters.Int16_To_Int24 = Int16_To_Int24_AVX2_Generic;
+
+    paConverters.Float64_To_Float32 = Float64_To_Float32_AVX2_Generic;
+    paConverters.Float64_To_Int32 = Float64_To_Int32_AVX2_Generic;
+    paConverters.Float64_To_Int32_Clip = Float64_To_Int32_Clip_AVX2_Generic;
+    paConverters.Float64_To_Int16 = Float64_To_Int16_AVX2_Generic;
+    paConverters.Float64_To_Int16_Clip = Float64_To_Int16_Clip_AVX2_Generic;
+    paConverters.Float32_To_Float64 = Float32_To_Float64_AVX2_Generic;
+    paConverters.Int32_To_Float64 = Int32_To_Float64_AVX2_Generic;
+    paConverters.Int16_To_Float64 = Int16_To_Float64_AVX2_Generic;
+
+    paConverters.Float32_To_Int8_Clip = Float32_To_Int8_Clip_AVX2_Generic;
+    paConverters.Float32_To_UInt8_Clip = Float32_To_UInt8_Clip_AVX2_Generic;
+    paConverters.Float32_To_Float32_SoftClip = Float32_To_Float32_SoftClip_AVX2;
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* -------------------------------------------------------------------------- */
+
+PaUtilConverter* PaUtil_SelectX86StrideConverter( PaUtilConverter *converter,
+        signed int sourceStride, signed int destinationStride )
+{
+#ifdef PA_X86_SSE2_
+    PaUtilConverter *result = PaUtil_FindStrideConverter( sse2StrideConverters_,
+            sizeof(sse2StrideConverters_) / sizeof(sse2StrideConverters_[0]),
+            converter, sourceStride, destinationStride );
+#ifdef PA_X86_AVX2_
+    if( !result )
+        result = PaUtil_FindStrideConverter( avx2StrideConverters_,
+                sizeof(avx2StrideConverters_) / sizeof(avx2StrideConverters_[0]),
+                converter, sourceStride, destinationStride );
+#endif
+    return result;
+#else
+    (void)converter; /* unused parameter */
+    (void)sourceStride; /* unused parameter */
+    (void)destinationStride; /* unused parameter */
+    return 0;
+#endif
+}
@@ -0,0 +1,104 @@
+/*
+ * SSE2 / AVX2 implementations of PortAudio sample converter functions.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup common_src
+
+ @brief SSE2 and AVX2 converters for x86 / x86_64 processors.
+
+ The accelerated converters produce exactly the same output as the
+ portable C versions in pa_converters.c. They are only active while
+ withAcceleration is set, otherwise (and for the remaining samples which
+ do not fill a complete vector) the portable versions are called.
+*/
+
+#ifndef PA_X86_SIMD_CONVERTERS_H
+#define PA_X86_SIMD_CONVERTERS_H
+
+#include "pa_converters.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/**
+ @brief Install SSE2 converter functions.
+
+ Replaces the Float32_To_Int32/Int24/Int16 (plain, Dither, Clip and
+ DitherClip) and Int32/Int24/Int16_To_Float32 entries of paConverters,
+ and the paFloat64 ones Float64_To_Float32, Float64_To_Int32/Int16 (plain
+ and Clip) and Float32/Int32/Int16_To_Float64. Also Float32_To_Int8_Clip,
+ Float32_To_UInt8_Clip and Float32_To_Float32_SoftClip, which the other soft
+ clipping converters are built on. This is a no-op on non x86 builds.
+
+ Usually called by PaUtil_InitializeConverterTable() during Pa_Initialize.
+
+ @return 1 if the converters were installed, 0 otherwise.
+*/
+int PaUtil_InitializeX86SSE2Converters( void );
+
+
+/**
+ @brief Install AVX2 converter functions.
+
+ Same entries as PaUtil_InitializeX86SSE2Converters, plus Int24_To_Int32,
+ Int24_To_Int16, Int32_To_Int24 and Int16_To_Int24, which are byte shuffles.
+ The caller must make sure that the CPU supports AVX2. This is a no-op if the compiler cannot
+ generate AVX2 code.
+
+ @return 1 if the converters were installed, 0 otherwise.
+*/
+int PaUtil_InitializeX86AVX2Converters( void );
+
+
+/**
+ @brief Find a version of an installed SSE2 or AVX2 converter which was
+ generated for the given strides.
+
+ @return the specialized converter, or NULL if converter is not one of the
+ converters installed by the functions above or there is no version for
+ these strides.
+
+ @see PaUtil_SelectConverterForStrides
+*/
+PaUtilConverter* PaUtil_SelectX86StrideConverter( PaUtilConverter *converter,
+        signed int sourceStride, signed int destinationStride );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_X86_SIMD_CONVERTERS_H */
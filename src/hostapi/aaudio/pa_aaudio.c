@@ -0,0 +1,1111 @@
+/*
+ * $Id$
+ * PortAudio Portable Real-Time Audio Library
+ * Latest Version at: http://www.portaudio.com
+ * Android AAudio Implementation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Ross Bencina, Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/**
+ @file
+ @ingroup hostapi_src
+
+ Android AAudio host API.
+
+ Each direction of a stream is an AAudioStream in AAUDIO_PERFORMANCE_MODE_LOW_LATENCY, which by default asks for
+ AAUDIO_SHARING_MODE_EXCLUSIVE, so that devices with an MMAP path give the stream direct access to their buffer.
+ The AAudio data callback feeds the buffer processor, whose converters use NEON where the CPU has it. AAudio takes
+ interleaved float or 16 bit samples, a half duplex callback stream in one of these formats which doesn't ask for a
+ buffer size of its own gets AAudio's buffer itself.
+
+ An output's buffer is sized in whole bursts, AAudio's unit of transfer, to cover the suggested latency, two at
+ least. When the output underruns it's grown by a burst, up to its capacity.
+
+ A full duplex stream runs its callback from the data callback of the output, which reads the input's frames
+ without blocking, as AAudio suggests.
+
+ AAudio doesn't enumerate devices, the Java AudioManager does, so there is a single "Default" device which Android
+ routes. PaAAudioStreamInfo can name another device by its id.
+*/
+
+#include <string.h>
+#include <time.h>   /* clock_gettime */
+#include <assert.h>
+#include <signal.h> /* sig_atomic_t */
+
+#include <aaudio/AAudio.h>
+
+#include "pa_util.h"
+#include "pa_hostapi.h"
+#include "pa_stream.h"
+#include "pa_process.h"
+#include "pa_allocation.h"
+#include "pa_cpuload.h"
+#include "pa_blockingio.h"
+#include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+#include "pa_unix_util.h"
+#include "pa_aaudio.h"
+
+#define PA_AA_DEFAULT_RATE      (48000)
+#define PA_AA_DEFAULT_BURST     (192)    /* frames, if the default output can't be opened to ask */
+#define PA_AA_MIN_RATE          (8000)
+#define PA_AA_MAX_RATE          (192000)
+#define PA_AA_MAX_INPUT_CHANNELS (2)
+#define PA_AA_MIN_BURSTS        (2)      /* an output's buffer: one burst being played while the next is written */
+#define PA_AA_HIGH_BURSTS       (8)      /* for defaultHigh*Latency */
+#define PA_AA_TIMEOUT           (2.)     /* seconds to wait for a stream to stop */
+#define PA_AA_STATE_TIMEOUT_NANOS ((int64_t)2000000000)
+
+/* Check the result of an AAudio call, a negative aaudio_result_t */
+#define ENSURE_AA(expr) \
+    do { \
+        aaudio_result_t aaErr_ = (expr); \
+        if( UNLIKELY( aaErr_ < 0 ) ) \
+        { \
+            PaUtil_SetLastHostErrorInfo( paInDevelopment, aaErr_, AAudio_convertResultToText( aaErr_ ) ); \
+            PaUtil_DebugPrint(( "Expression '" #expr "' failed in '" __FILE__ "', line: " STRINGIZE( __LINE__ ) "\n" )); \
+            result = paUnanticipatedHostError; \
+            goto error; \
+        } \
+    } while( 0 )
+
+/*
+ * Functions that directly map to the PortAudio stream interface
+ */
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate );
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData );
+static PaError CloseStream( PaStream* stream );
+static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
+static PaError StopStream( PaStream *stream );
+static PaError AbortStream( PaStream *stream );
+static PaError IsStreamStopped( PaStream *s );
+static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaTime GetStreamTime( PaStream *stream );
+static double GetStreamCpuLoad( PaStream* stream );
+static signed long GetStreamMemoryUsage( PaStream* stream );
+static PaError BlockingReadStream( PaStream* stream, void *buffer, unsigned long frames );
+static PaError BlockingWriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static signed long BlockingGetStreamReadAvailable( PaStream* stream );
+static signed long BlockingGetStreamWriteAvailable( PaStream* stream );
+
+typedef struct
+{
+    PaUtilHostApiRepresentation commonHostApiRep;
+    PaUtilStreamInterface callbackStreamInterface;
+    PaUtilStreamInterface blockingStreamInterface;
+
+    PaUtilAllocationGroup *deviceInfoMemory;
+    PaHostApiIndex hostApiIndex;
+
+    /* What the default output runs at natively */
+    double sampleRate;
+    int32_t framesPerBurst;
+    int outputChannels;
+}
+PaAAudioHostApiRepresentation;
+
+/* One direction of a stream */
+typedef struct
+{
+    AAudioStream *aaStream;
+
+    int numChannels;
+    PaSampleFormat hostSampleFormat;    /* paFloat32 or paInt16, interleaved */
+    unsigned long bytesPerFrame;
+    int32_t framesPerBurst;
+    int32_t bufferCapacity;
+    int32_t bufferSize;         /* frames, grown by the data callback as an output underruns */
+    int32_t xRunCount;          /* AAudio's count when last checked */
+}
+PaAAudioStreamComponent;
+
+typedef struct PaAAudioStream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilBufferProcessor bufferProcessor;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaAAudioHostApiRepresentation *hostApi;
+
+    PaAAudioStreamComponent input;
+    PaAAudioStreamComponent output;
+
+    double sampleRate;
+    PaUtilAllocationGroup *streamMemory;
+
+    /* Full duplex: the input's frames of the output's data callback */
+    void *duplexInput;
+    int32_t duplexInputFrames;
+    int drainInput;             /* drop what the input queued before the output's first callback */
+
+    /* The stream is running if it's still producing samples.
+     * The stream is active if samples it produced are still being heard.
+     */
+    volatile sig_atomic_t is_running;
+    volatile sig_atomic_t is_active;
+    /* Used to signal the data callback that the stream should stop */
+    volatile sig_atomic_t doStop, doAbort;
+    /* Set by AAudio's error callback, the AAudio streams are dead */
+    volatile sig_atomic_t isDisconnected;
+
+    int callbackResult;
+    int canDirectCallback;      /* Half duplex callback stream in AAudio's format, the callback may take its buffer */
+
+    int isBlockingStream;
+    PaUtilBlockingIO blockingIO;
+}
+PaAAudioStream;
+
+/* ---- blocking emulation layer ---- */
+
+static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFrames )
+{
+    PaAAudioStream *stream = (PaAAudioStream *)s;
+
+    return PaUtil_ReadBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static PaError BlockingWriteStream( PaStream* s, const void *data, unsigned long numFrames )
+{
+    PaAAudioStream *stream = (PaAAudioStream *)s;
+
+    return PaUtil_WriteBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static signed long BlockingGetStreamReadAvailable( PaStream* s )
+{
+    PaAAudioStream *stream = (PaAAudioStream *)s;
+
+    return PaUtil_GetBlockingIOReadAvailable( &stream->blockingIO );
+}
+
+static signed long BlockingGetStreamWriteAvailable( PaStream* s )
+{
+    PaAAudioStream *stream = (PaAAudioStream *)s;
+
+    return PaUtil_GetBlockingIOWriteAvailable( &stream->blockingIO );
+}
+
+/* ---- host API ---- */
+
+/* Open and close a shared stream on the default output, to learn the rate and burst size the device runs at */
+static void ProbeDefaultOutput( PaAAudioHostApiRepresentation *aaHostApi )
+{
+    AAudioStreamBuilder *builder;
+    AAudioStream *aaStream;
+
+    aaHostApi->sampleRate = PA_AA_DEFAULT_RATE;
+    aaHostApi->framesPerBurst = PA_AA_DEFAULT_BURST;
+    aaHostApi->outputChannels = 2;
+
+    if( AAudio_createStreamBuilder( &builder ) != AAUDIO_OK )
+        return;
+    AAudioStreamBuilder_setPerformanceMode( builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY );
+    if( AAudioStreamBuilder_openStream( builder, &aaStream ) == AAUDIO_OK )
+    {
+        if( AAudioStream_getSampleRate( aaStream ) > 0 )
+            aaHostApi->sampleRate = AAudioStream_getSampleRate( aaStream );
+        if( AAudioStream_getFramesPerBurst( aaStream ) > 0 )
+            aaHostApi->framesPerBurst = AAudioStream_getFramesPerBurst( aaStream );
+        aaHostApi->outputChannels = PA_MAX( AAudioStream_getChannelCount( aaStream ), 2 );
+        AAudioStream_close( aaStream );
+    }
+    else
+    {
+        PA_DEBUG(( "%s: Couldn't open the default output\n", __FUNCTION__ ));
+    }
+    AAudioStreamBuilder_delete( builder );
+}
+
+static PaError BuildDeviceList( PaAAudioHostApiRepresentation *aaHostApi )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *commonApi = &aaHostApi->commonHostApiRep;
+    PaDeviceInfo *deviceInfo;
+    double burst = aaHostApi->framesPerBurst / aaHostApi->sampleRate;
+
+    PA_UNLESS( commonApi->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory( aaHostApi->deviceInfoMemory,
+                sizeof(PaDeviceInfo*) ), paInsufficientMemory );
+    PA_UNLESS( deviceInfo = (PaDeviceInfo*)PaUtil_GroupAllocateMemory( aaHostApi->deviceInfoMemory,
+                sizeof(PaDeviceInfo) ), paInsufficientMemory );
+
+    deviceInfo->structVersion = 2;
+    deviceInfo->hostApi = aaHostApi->hostApiIndex;
+    deviceInfo->name = "Default";
+    deviceInfo->maxInputChannels = PA_AA_MAX_INPUT_CHANNELS;
+    deviceInfo->maxOutputChannels = aaHostApi->outputChannels;
+    deviceInfo->defaultSampleRate = aaHostApi->sampleRate;
+    deviceInfo->defaultLowInputLatency = PA_AA_MIN_BURSTS * burst;
+    deviceInfo->defaultHighInputLatency = PA_AA_HIGH_BURSTS * burst;
+    deviceInfo->defaultLowOutputLatency = PA_AA_MIN_BURSTS * burst;
+    deviceInfo->defaultHighOutputLatency = PA_AA_HIGH_BURSTS * burst;
+
+    commonApi->deviceInfos[0] = deviceInfo;
+    commonApi->info.deviceCount = 1;
+    commonApi->info.defaultInputDevice = 0;
+    commonApi->info.defaultOutputDevice = 0;
+
+error:
+    return result;
+}
+
+static void DestroyHostApi( PaAAudioHostApiRepresentation *aaHostApi )
+{
+    if( aaHostApi->deviceInfoMemory )
+    {
+        PaUtil_FreeAllAllocations( aaHostApi->deviceInfoMemory );
+        PaUtil_DestroyAllocationGroup( aaHostApi->deviceInfoMemory );
+    }
+
+    PaUtil_FreeMemory( aaHostApi );
+}
+
+PaError PaAAudio_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaAAudioHostApiRepresentation *aaHostApi = NULL;
+
+    *hostApi = NULL;    /* Initialize to NULL */
+
+    PA_UNLESS( aaHostApi = (PaAAudioHostApiRepresentation*)
+        PaUtil_AllocateMemory( sizeof(PaAAudioHostApiRepresentation) ), paInsufficientMemory );
+    memset( aaHostApi, 0, sizeof(PaAAudioHostApiRepresentation) );
+    PA_UNLESS( aaHostApi->deviceInfoMemory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    aaHostApi->hostApiIndex = hostApiIndex;
+
+    ProbeDefaultOutput( aaHostApi );
+    PA_ENSURE( BuildDeviceList( aaHostApi ) );
+
+    *hostApi = &aaHostApi->commonHostApiRep;
+    (*hostApi)->info.structVersion = 1;
+    (*hostApi)->info.type = paInDevelopment;
+    (*hostApi)->info.name = "AAudio";
+
+    (*hostApi)->Terminate = Terminate;
+    (*hostApi)->OpenStream = OpenStream;
+    (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
+
+    PaUtil_InitializeStreamInterface( &aaHostApi->callbackStreamInterface,
+                                      CloseStream, StartStream,
+                                      StopStream, AbortStream,
+                                      IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, GetStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable,
+                                      PaUtil_DummyGetWriteAvailable );
+    aaHostApi->callbackStreamInterface.Pause = PauseStream;
+    aaHostApi->callbackStreamInterface.Resume = ResumeStream;
+    aaHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+
+    PaUtil_InitializeStreamInterface( &aaHostApi->blockingStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, PaUtil_DummyGetCpuLoad,
+                                      BlockingReadStream, BlockingWriteStream,
+                                      BlockingGetStreamReadAvailable, BlockingGetStreamWriteAvailable );
+
+    return result;
+
+error:
+    if( aaHostApi )
+        DestroyHostApi( aaHostApi );
+    *hostApi = NULL;
+
+    return result;
+}
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
+{
+    DestroyHostApi( (PaAAudioHostApiRepresentation*)hostApi );
+}
+
+/* AAudio's format for a user format: float carries 24 bits exactly and is what AAudio mixes in */
+static aaudio_format_t SampleFormatToAAudio( PaSampleFormat format )
+{
+    switch( format & ~paNonInterleaved )
+    {
+    case paInt16:
+    case paInt8:
+    case paUInt8:
+        return AAUDIO_FORMAT_PCM_I16;
+    default:
+        return AAUDIO_FORMAT_PCM_FLOAT;
+    }
+}
+
+static PaError ValidateParameters( struct PaUtilHostApiRepresentation *hostApi, const PaStreamParameters *parameters,
+        int isInput, double sampleRate )
+{
+    const PaDeviceInfo *deviceInfo;
+    const PaAAudioStreamInfo *streamInfo;
+
+    if( !parameters )
+        return paNoError;
+
+    /* unless alternate device specification is supported, reject the use of
+        paUseHostApiSpecificDeviceSpecification */
+    if( parameters->device == paUseHostApiSpecificDeviceSpecification )
+        return paInvalidDevice;
+
+    deviceInfo = hostApi->deviceInfos[ parameters->device ];
+    if( parameters->channelCount > (isInput ? deviceInfo->maxInputChannels : deviceInfo->maxOutputChannels) )
+        return paInvalidChannelCount;
+
+    if( parameters->sampleFormat & paCustomFormat )
+        return paSampleFormatNotSupported;
+
+    /* AAudio takes whole rates, resampling to the device's outside of the MMAP path */
+    if( sampleRate < PA_AA_MIN_RATE || sampleRate > PA_AA_MAX_RATE || sampleRate != (int32_t)sampleRate )
+        return paInvalidSampleRate;
+
+    /* validate streamInfo */
+    streamInfo = (const PaAAudioStreamInfo *)parameters->hostApiSpecificStreamInfo;
+    if( streamInfo && (streamInfo->size != sizeof(PaAAudioStreamInfo) || streamInfo->version != 1) )
+        return paIncompatibleHostApiSpecificStreamInfo;
+
+    return paNoError;
+}
+
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate )
+{
+    PaError result = paNoError;
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    return paFormatIsSupported;
+
+error:
+    return result;
+}
+
+/* ---- streams ---- */
+
+static void SilenceBuffer( void *buffer, unsigned long bytes )
+{
+    memset( buffer, 0, bytes );     /* AAudio's formats are signed */
+}
+
+static int64_t GetMonotonicNanos( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* How long until the next frame written to an output is heard, or since the next frame read from an input was
+ * captured, in seconds. AAudio timestamps a recent frame, the frames in between are counted from it. */
+static PaTime GetBufferDelay( PaAAudioStreamComponent *component, int isOutput, double sampleRate )
+{
+    int64_t framePosition, timeNanos, frames;
+    PaTime delay;
+
+    /* No timestamp until the device has run for a while */
+    if( AAudioStream_getTimestamp( component->aaStream, CLOCK_MONOTONIC, &framePosition, &timeNanos ) != AAUDIO_OK )
+        return (isOutput ? component->bufferSize : component->framesPerBurst) / sampleRate;
+
+    if( isOutput )
+    {
+        frames = AAudioStream_getFramesWritten( component->aaStream ) - framePosition;
+        delay = (timeNanos - GetMonotonicNanos()) * 1e-9 + frames / sampleRate;
+    }
+    else
+    {
+        frames = AAudioStream_getFramesRead( component->aaStream ) - framePosition;
+        delay = (GetMonotonicNanos() - timeNanos) * 1e-9 - frames / sampleRate;
+    }
+    return PA_MAX( delay, 0. );
+}
+
+/* Tell whether the component ran out of frames or room since the last call. An output which underran gets another
+ * burst of buffer, up to its capacity, trading latency for fewer glitches. */
+static int CheckXRuns( PaAAudioStreamComponent *component, int isOutput )
+{
+    int32_t xRunCount = AAudioStream_getXRunCount( component->aaStream );
+    aaudio_result_t bufferSize;
+
+    if( xRunCount <= component->xRunCount )
+        return 0;
+    component->xRunCount = xRunCount;
+
+    if( isOutput && component->bufferSize + component->framesPerBurst <= component->bufferCapacity )
+    {
+        bufferSize = AAudioStream_setBufferSizeInFrames( component->aaStream,
+                component->bufferSize + component->framesPerBurst );
+        if( bufferSize > 0 )
+            component->bufferSize = bufferSize;
+        PA_DEBUG(( "%s: Underrun, buffer now %d frames\n", __FUNCTION__, component->bufferSize ));
+    }
+    return 1;
+}
+
+/* The data callback, called by AAudio's realtime thread with a buffer of the output, or of the input of an input
+ * only stream */
+static aaudio_data_callback_result_t OnData( AAudioStream *aaStream, void *userData, void *audioData,
+        int32_t numFrames )
+{
+    PaAAudioStream *stream = (PaAAudioStream *)userData;
+    PaAAudioStreamComponent *input = &stream->input, *output = &stream->output;
+    int isOutput = aaStream == output->aaStream;
+    unsigned long frames = (unsigned long)numFrames;
+    PaStreamCallbackTimeInfo timeInfo = {0,0,0};
+    PaStreamCallbackFlags cbFlags = 0;
+    void *inputData = NULL, *outputData = NULL;
+    unsigned long framesProcessed;
+
+    if( stream->is_active && (stream->doStop || stream->doAbort) && stream->callbackResult == paContinue )
+    {
+        PA_DEBUG(( "%s: Stopping stream\n", __FUNCTION__ ));
+        stream->callbackResult = stream->doStop ? paComplete : paAbort;
+    }
+
+    /* If the user has returned !paContinue from the callback we'll want to flush the internal buffers,
+     * when these are empty we can finally mark the stream as inactive */
+    if( stream->is_active && stream->callbackResult != paContinue &&
+            PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+    {
+        stream->is_active = 0;
+        if( stream->streamRepresentation.streamFinishedCallback )
+            stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+        PA_DEBUG(( "%s: Callback finished\n", __FUNCTION__ ));
+    }
+
+    if( !stream->is_active )
+    {
+        if( isOutput )
+            SilenceBuffer( audioData, frames * output->bytesPerFrame );
+        return AAUDIO_CALLBACK_RESULT_STOP;
+    }
+
+    timeInfo.currentTime = PaUtil_GetTime();
+    if( isOutput )
+    {
+        outputData = audioData;
+        if( CheckXRuns( output, 1 ) )
+            cbFlags |= paOutputUnderflow;
+        timeInfo.outputBufferDacTime = timeInfo.currentTime + GetBufferDelay( output, 1, stream->sampleRate );
+    }
+    else
+        inputData = audioData;
+
+    PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+    if( isOutput && input->aaStream )
+    {
+        /* Full duplex, take as many frames of the input as fit this buffer of the output */
+        aaudio_result_t got;
+
+        frames = PA_MIN( frames, (unsigned long)stream->duplexInputFrames );
+        if( stream->drainInput )
+        {
+            while( AAudioStream_read( input->aaStream, stream->duplexInput, (int32_t)frames, 0 )
+                    == (aaudio_result_t)frames )
+                ;
+            stream->drainInput = 0;
+        }
+        else if( (got = AAudioStream_read( input->aaStream, stream->duplexInput, (int32_t)frames, 0 ))
+                < (aaudio_result_t)frames )
+        {
+            got = PA_MAX( got, 0 );
+            SilenceBuffer( (unsigned char *)stream->duplexInput + got * input->bytesPerFrame,
+                    (frames - got) * input->bytesPerFrame );
+            cbFlags |= paInputUnderflow;
+        }
+        inputData = stream->duplexInput;
+        /* Frames of a buffer of the output which the input's buffer can't hold aren't processed */
+        if( frames < (unsigned long)numFrames )
+            SilenceBuffer( (unsigned char *)audioData + frames * output->bytesPerFrame,
+                    (numFrames - frames) * output->bytesPerFrame );
+    }
+    if( inputData )
+    {
+        if( CheckXRuns( input, 0 ) )
+            cbFlags |= paInputOverflow;
+        timeInfo.inputBufferAdcTime = timeInfo.currentTime - GetBufferDelay( input, 0, stream->sampleRate );
+    }
+
+    PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, cbFlags );
+
+    /* Call the callback on AAudio's buffers themselves when they have the user's size */
+    if( stream->canDirectCallback && PaUtil_CanBypassBufferProcessor( &stream->bufferProcessor )
+            && ( stream->bufferProcessor.framesPerUserBuffer == paFramesPerBufferUnspecified
+                || frames == stream->bufferProcessor.framesPerUserBuffer ) )
+    {
+        framesProcessed = PaUtil_EndBufferProcessingDirectly( &stream->bufferProcessor, inputData, outputData, frames,
+                &stream->callbackResult );
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+        return AAUDIO_CALLBACK_RESULT_CONTINUE;
+    }
+
+    if( inputData )
+    {
+        PaUtil_SetInputFrameCount( &stream->bufferProcessor, frames );
+        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, inputData, 0 );
+    }
+    if( outputData )
+    {
+        PaUtil_SetOutputFrameCount( &stream->bufferProcessor, frames );
+        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, outputData, 0 );
+    }
+    framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor, &stream->callbackResult );
+    /* We've specified a host buffer size mode where every frame should be consumed by the buffer processor */
+    assert( framesProcessed == frames );
+
+    PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+
+    return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
+
+/* Called by a thread of AAudio's, typically with AAUDIO_ERROR_DISCONNECTED as the device was unplugged or the
+ * routing changed. The AAudio streams are dead, but mustn't be stopped or closed from this thread. */
+static void OnError( AAudioStream *aaStream, void *userData, aaudio_result_t error )
+{
+    PaAAudioStream *stream = (PaAAudioStream *)userData;
+    (void)aaStream; /* unused parameter */
+
+    PA_DEBUG(( "%s: %s\n", __FUNCTION__, AAudio_convertResultToText( error ) ));
+    stream->isDisconnected = 1;
+    stream->is_active = 0;
+}
+
+/* Whole bursts adding up to the suggested latency, PA_AA_MIN_BURSTS at least */
+static int32_t ChooseBufferSize( PaAAudioStreamComponent *component, double sampleRate, PaTime suggestedLatency )
+{
+    long bursts = (long)(suggestedLatency * sampleRate + component->framesPerBurst - 1) / component->framesPerBurst;
+
+    bursts = PA_MAX( bursts, PA_AA_MIN_BURSTS );
+    return (int32_t)PA_MIN( bursts * component->framesPerBurst, (long)component->bufferCapacity );
+}
+
+/* Open the AAudioStream of one direction */
+static PaError OpenComponent( PaAAudioStreamComponent *component, PaAAudioStream *stream,
+        aaudio_direction_t direction, const PaStreamParameters *parameters, double sampleRate, int exclusive,
+        int withCallback )
+{
+    PaError result = paNoError;
+    const PaAAudioStreamInfo *streamInfo = (const PaAAudioStreamInfo *)parameters->hostApiSpecificStreamInfo;
+    AAudioStreamBuilder *builder = NULL;
+    aaudio_format_t format;
+    aaudio_result_t bufferSize;
+    int isOutput = direction == AAUDIO_DIRECTION_OUTPUT;
+
+    ENSURE_AA( AAudio_createStreamBuilder( &builder ) );
+    AAudioStreamBuilder_setDirection( builder, direction );
+    if( streamInfo )
+        AAudioStreamBuilder_setDeviceId( builder, streamInfo->deviceId );
+    /* AAudio falls back to shared mode if the device can't be had exclusively */
+    AAudioStreamBuilder_setSharingMode( builder, exclusive ? AAUDIO_SHARING_MODE_EXCLUSIVE
+            : AAUDIO_SHARING_MODE_SHARED );
+    AAudioStreamBuilder_setPerformanceMode( builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY );
+    AAudioStreamBuilder_setSampleRate( builder, (int32_t)sampleRate );
+    AAudioStreamBuilder_setChannelCount( builder, parameters->channelCount );
+    AAudioStreamBuilder_setFormat( builder, SampleFormatToAAudio( parameters->sampleFormat ) );
+    if( withCallback )
+        AAudioStreamBuilder_setDataCallback( builder, OnData, stream );
+    AAudioStreamBuilder_setErrorCallback( builder, OnError, stream );
+    ENSURE_AA( AAudioStreamBuilder_openStream( builder, &component->aaStream ) );
+
+    PA_UNLESS( AAudioStream_getSampleRate( component->aaStream ) == (int32_t)sampleRate, paInvalidSampleRate );
+    PA_UNLESS( AAudioStream_getChannelCount( component->aaStream ) == parameters->channelCount,
+            paInvalidChannelCount );
+    format = AAudioStream_getFormat( component->aaStream );
+    PA_UNLESS( format == AAUDIO_FORMAT_PCM_FLOAT || format == AAUDIO_FORMAT_PCM_I16, paSampleFormatNotSupported );
+
+    component->numChannels = parameters->channelCount;
+    component->hostSampleFormat = format == AAUDIO_FORMAT_PCM_FLOAT ? paFloat32 : paInt16;
+    component->bytesPerFrame = Pa_GetSampleSize( component->hostSampleFormat ) * component->numChannels;
+    component->framesPerBurst = PA_MAX( AAudioStream_getFramesPerBurst( component->aaStream ), 1 );
+    component->bufferCapacity = AAudioStream_getBufferCapacityInFrames( component->aaStream );
+    component->bufferSize = AAudioStream_getBufferSizeInFrames( component->aaStream );
+
+    /* An input's buffer only holds what the callback hasn't read yet, an output's is the latency */
+    if( isOutput )
+    {
+        bufferSize = AAudioStream_setBufferSizeInFrames( component->aaStream,
+                ChooseBufferSize( component, sampleRate, parameters->suggestedLatency ) );
+        if( bufferSize > 0 )
+            component->bufferSize = bufferSize;
+    }
+
+    PA_DEBUG(( "%s: %s %s stream, burst %d, buffer %d of %d frames\n", __FUNCTION__,
+                AAudioStream_getSharingMode( component->aaStream ) == AAUDIO_SHARING_MODE_EXCLUSIVE ? "Exclusive"
+                : "Shared", isOutput ? "output" : "input", component->framesPerBurst, component->bufferSize,
+                component->bufferCapacity ));
+
+error:
+    if( builder )
+        AAudioStreamBuilder_delete( builder );
+    return result;
+}
+
+static void CleanUpStream( PaAAudioStream *stream, int terminateStreamRepresentation, int terminateBufferProcessor )
+{
+    assert( stream );
+
+    if( stream->input.aaStream )
+        AAudioStream_close( stream->input.aaStream );
+    if( stream->output.aaStream )
+        AAudioStream_close( stream->output.aaStream );
+
+    if( stream->isBlockingStream )
+        PaUtil_TerminateBlockingIO( &stream->blockingIO );
+
+    if( terminateStreamRepresentation )
+        PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    if( terminateBufferProcessor )
+        PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+
+    if( stream->streamMemory )
+    {
+        PaUtil_FreeAllAllocations( stream->streamMemory );
+        PaUtil_DestroyAllocationGroup( stream->streamMemory );
+    }
+    PaUtil_FreeMemory( stream );
+}
+
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData )
+{
+    PaError result = paNoError;
+    PaAAudioHostApiRepresentation *aaHostApi = (PaAAudioHostApiRepresentation*)hostApi;
+    PaAAudioStream *stream = NULL;
+    int inputChannelCount = 0, outputChannelCount = 0;
+    PaSampleFormat inputSampleFormat = 0, outputSampleFormat = 0;
+    PaTime suggestedLatency = 0.;
+    int exclusive = !(streamFlags & paAAudioSharedMode);
+    int32_t framesPerBurst;
+    int srInitialized = 0, bpInitialized = 0;
+
+    /* validate platform specific flags */
+    if( (streamFlags & paPlatformSpecificFlags & ~paAAudioSharedMode) != 0 )
+        return paInvalidFlag; /* unexpected platform specific flag */
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    if( inputParameters )
+    {
+        inputChannelCount = inputParameters->channelCount;
+        inputSampleFormat = inputParameters->sampleFormat;
+        suggestedLatency = inputParameters->suggestedLatency;
+    }
+    if( outputParameters )
+    {
+        outputChannelCount = outputParameters->channelCount;
+        outputSampleFormat = outputParameters->sampleFormat;
+        suggestedLatency = PA_MAX( suggestedLatency, outputParameters->suggestedLatency );
+    }
+
+    PA_UNLESS( stream = (PaAAudioStream*)PaUtil_AllocateMemory( sizeof(PaAAudioStream) ), paInsufficientMemory );
+    memset( stream, 0, sizeof(PaAAudioStream) );
+    PA_UNLESS( stream->streamMemory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    stream->hostApi = aaHostApi;
+    stream->sampleRate = sampleRate;
+
+    /* The output's data callback drives a full duplex stream, the input is read from it */
+    if( inputChannelCount > 0 )
+        PA_ENSURE( OpenComponent( &stream->input, stream, AAUDIO_DIRECTION_INPUT, inputParameters, sampleRate,
+                    exclusive, outputChannelCount == 0 ) );
+    if( outputChannelCount > 0 )
+        PA_ENSURE( OpenComponent( &stream->output, stream, AAUDIO_DIRECTION_OUTPUT, outputParameters, sampleRate,
+                    exclusive, 1 ) );
+    framesPerBurst = outputChannelCount > 0 ? stream->output.framesPerBurst : stream->input.framesPerBurst;
+
+    /* the blocking emulation, if necessary */
+    stream->isBlockingStream = !streamCallback;
+    if( stream->isBlockingStream )
+    {
+        /* the latency the user asked for indicates the minimum buffer size in frames, three bursts at least */
+        unsigned long minimumBufferFrames = PA_MAX( (unsigned long)(suggestedLatency * sampleRate),
+                (unsigned long)framesPerBurst * 3 );
+
+        PA_ENSURE( PaUtil_InitializeBlockingIO( &stream->blockingIO, inputChannelCount, inputSampleFormat,
+                    outputChannelCount, outputSampleFormat, minimumBufferFrames ) );
+
+        /* install our own callback for the blocking API */
+        streamCallback = PaUtil_BlockingIOCallback;
+        userData = &stream->blockingIO;
+
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &aaHostApi->blockingStreamInterface, streamCallback, userData );
+    }
+    else
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &aaHostApi->callbackStreamInterface, streamCallback, userData );
+    }
+    srInitialized = 1;
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+
+    /* The buffer processor doesn't know the burst size, round a batch up to it here */
+    if( (streamFlags & paBatchCallbacks) && framesPerBuffer != paFramesPerBufferUnspecified )
+        framesPerBuffer = (framesPerBuffer + framesPerBurst - 1) / framesPerBurst * framesPerBurst;
+
+    PA_ENSURE( PaUtil_InitializeBufferProcessor(
+                  &stream->bufferProcessor,
+                  inputChannelCount,
+                  inputSampleFormat,
+                  stream->input.hostSampleFormat,
+                  outputChannelCount,
+                  outputSampleFormat,
+                  stream->output.hostSampleFormat,
+                  sampleRate,
+                  streamFlags,
+                  framesPerBuffer,
+                  0,                            /* Ignored */
+                  paUtilUnknownHostBufferSize,  /* AAudio calls back with bursts, or whatever suits it elsewhere */
+                  streamCallback,
+                  userData ) );
+    bpInitialized = 1;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
+
+    /* A half duplex stream whose buffers are in the user's format only needs block adaption */
+    stream->canDirectCallback = !stream->isBlockingStream && !( inputChannelCount > 0 && outputChannelCount > 0 )
+            && ( inputChannelCount > 0 ? inputSampleFormat == stream->input.hostSampleFormat
+                : outputSampleFormat == stream->output.hostSampleFormat );
+
+    if( inputChannelCount > 0 && outputChannelCount > 0 )
+    {
+        /* The output never calls back with more than its capacity */
+        stream->duplexInputFrames = PA_MAX( stream->output.bufferCapacity, stream->output.framesPerBurst );
+        PA_UNLESS( stream->duplexInput = PaUtil_GroupAllocateMemory( stream->streamMemory,
+                    stream->input.bytesPerFrame * stream->duplexInputFrames ), paInsufficientMemory );
+    }
+
+    /* A burst being captured, or the output's buffer, besides what the buffer processor holds */
+    if( inputChannelCount > 0 )
+        stream->streamRepresentation.streamInfo.inputLatency = (stream->input.framesPerBurst
+                + PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+    if( outputChannelCount > 0 )
+        stream->streamRepresentation.streamInfo.outputLatency = (stream->output.bufferSize
+                + PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+    PA_DEBUG(( "%s: Direct callback %s\n", __FUNCTION__, stream->canDirectCallback ? "possible" : "not possible" ));
+
+    *s = (PaStream*)stream;
+
+    return result;
+
+error:
+    if( stream )
+        CleanUpStream( stream, srInitialized, bpInitialized );
+
+    return result;
+}
+
+/*
+    When CloseStream() is called, the multi-api layer ensures that
+    the stream has already been stopped or aborted.
+*/
+static PaError CloseStream( PaStream* s )
+{
+    CleanUpStream( (PaAAudioStream*)s, 1, 1 );
+    return paNoError;
+}
+
+static PaError StartStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    int inputStarted = 0;
+
+    PA_UNLESS( !stream->isDisconnected, paDeviceUnavailable );
+
+    /* Ready the processor, the data callback isn't called before the AAudio streams start */
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    if( stream->isBlockingStream )
+        PaUtil_ResetBlockingIO( &stream->blockingIO );
+
+    stream->callbackResult = paContinue;
+    stream->doStop = stream->doAbort = 0;
+    stream->drainInput = stream->input.aaStream && stream->output.aaStream;
+    if( stream->input.aaStream )
+        stream->input.xRunCount = AAudioStream_getXRunCount( stream->input.aaStream );
+    if( stream->output.aaStream )
+        stream->output.xRunCount = AAudioStream_getXRunCount( stream->output.aaStream );
+    stream->is_active = 1;
+    PaUtil_WriteMemoryBarrier();
+
+    /* The input starts first, so that the output's callback finds its frames */
+    if( stream->input.aaStream )
+    {
+        ENSURE_AA( AAudioStream_requestStart( stream->input.aaStream ) );
+        inputStarted = 1;
+    }
+    if( stream->output.aaStream )
+        ENSURE_AA( AAudioStream_requestStart( stream->output.aaStream ) );
+
+    stream->is_running = 1;
+    PA_DEBUG(( "%s: Stream started\n", __FUNCTION__ ));
+
+    return result;
+
+error:
+    stream->is_active = 0;
+    if( inputStarted )
+        AAudioStream_requestStop( stream->input.aaStream );
+    return result;
+}
+
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
+/* Wait for the data callback to act on doStop or doAbort. A stop lets the buffer processor's output play first. */
+static PaError WaitForInactive( PaAAudioStream *stream )
+{
+    PaError result = paNoError;
+    AAudioStream *aaStream = stream->output.aaStream ? stream->output.aaStream : stream->input.aaStream;
+    PaTime deadline = PaUtil_GetTime() + stream->streamRepresentation.streamInfo.outputLatency + PA_AA_TIMEOUT;
+    aaudio_stream_state_t state;
+
+    while( stream->is_active )
+    {
+        state = AAudioStream_getState( aaStream );
+        if( state != AAUDIO_STREAM_STATE_STARTING && state != AAUDIO_STREAM_STATE_STARTED )
+            break;
+        PA_UNLESS( PaUtil_GetTime() < deadline, paTimedOut );
+        Pa_Sleep( 1 );
+    }
+
+error:
+    return result;
+}
+
+/* Stopping an output plays what it has buffered, aborting flushes it first */
+static PaError StopComponent( PaAAudioStreamComponent *component, int isOutput, int abort )
+{
+    PaError result = paNoError;
+    aaudio_stream_state_t state;
+
+    if( !component->aaStream )
+        return result;
+
+    if( isOutput && abort && AAudioStream_requestPause( component->aaStream ) == AAUDIO_OK )
+    {
+        AAudioStream_waitForStateChange( component->aaStream, AAUDIO_STREAM_STATE_PAUSING, &state,
+                PA_AA_STATE_TIMEOUT_NANOS );
+        if( AAudioStream_requestFlush( component->aaStream ) == AAUDIO_OK )
+            AAudioStream_waitForStateChange( component->aaStream, AAUDIO_STREAM_STATE_FLUSHING, &state,
+                    PA_AA_STATE_TIMEOUT_NANOS );
+    }
+    ENSURE_AA( AAudioStream_requestStop( component->aaStream ) );
+    ENSURE_AA( AAudioStream_waitForStateChange( component->aaStream, AAUDIO_STREAM_STATE_STOPPING, &state,
+                PA_AA_STATE_TIMEOUT_NANOS ) );
+
+error:
+    return result;
+}
+
+static PaError RealStop( PaAAudioStream *stream, int abort )
+{
+    PaError result = paNoError;
+
+    /* Let the callback play what was written, allowing for a second of scheduling delays */
+    if( stream->isBlockingStream && !abort && !stream->isDisconnected )
+        PaUtil_DrainBlockingIO( &stream->blockingIO,
+                PaUtil_GetBlockingIORingBufferFrames( &stream->blockingIO )
+                / stream->streamRepresentation.streamInfo.sampleRate + 1. );
+
+    if( abort )
+        stream->doAbort = 1;
+    else
+        stream->doStop = 1;
+    result = WaitForInactive( stream );
+
+    /* A disconnected stream has stopped for good, AAudio only lets it be closed */
+    if( stream->isDisconnected )
+        result = paDeviceUnavailable;
+    else
+    {
+        PaError stopResult = StopComponent( &stream->output, 1, abort );
+
+        if( result == paNoError )
+            result = stopResult;
+        stopResult = StopComponent( &stream->input, 0, abort );
+        if( result == paNoError )
+            result = stopResult;
+    }
+
+    /* A timed out stream is deactivated now */
+    stream->is_active = 0;
+    stream->is_running = 0;
+    stream->doStop = stream->doAbort = 0;
+    if( stream->isBlockingStream )
+        PaUtil_StopBlockingIO( &stream->blockingIO );
+
+    PA_DEBUG(( "%s: Stream stopped\n", __FUNCTION__ ));
+
+    return result;
+}
+
+static PaError StopStream( PaStream *s )
+{
+    assert(s);
+    return RealStop( (PaAAudioStream *)s, 0 );
+}
+
+static PaError AbortStream( PaStream *s )
+{
+    assert(s);
+    return RealStop( (PaAAudioStream *)s, 1 );
+}
+
+static PaError IsStreamStopped( PaStream *s )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    return !stream->is_running;
+}
+
+
+static PaError IsStreamActive( PaStream *s )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    return stream->is_active;
+}
+
+
+/* While paused the AAudio streams keep running and the buffer processor outputs silence
+   instead of calling the callback, so resuming takes effect with the next burst. */
+static PaError PauseStream( PaStream *s )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
+static PaTime GetStreamTime( PaStream *s )
+{
+    (void)s; /* unused parameter */
+    return PaUtil_GetTime();
+}
+
+
+static double GetStreamCpuLoad( PaStream* s )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
+}
+
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaAAudioStream *stream = (PaAAudioStream*)s;
+    return (signed long)sizeof(PaAAudioStream)
+            + PaUtil_GetAllocationGroupMemoryUsage( stream->streamMemory )
+            + PaUtil_GetBlockingIOMemoryUsage( &stream->blockingIO )
+            + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+}
+
+PaError PaAAudio_IsExclusive( PaStream *s )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *hostApi;
+    PaAAudioHostApiRepresentation *aaHostApi;
+    PaAAudioStream *stream = (PaAAudioStream *)s;
+
+    PA_ENSURE( PaUtil_ValidateStreamPointer( s ) );
+    PA_ENSURE( PaUtil_GetHostApiRepresentation( &hostApi, paInDevelopment ) );
+    aaHostApi = (PaAAudioHostApiRepresentation*)hostApi;
+    PA_UNLESS( PA_STREAM_REP( s )->streamInterface == &aaHostApi->callbackStreamInterface
+            || PA_STREAM_REP( s )->streamInterface == &aaHostApi->blockingStreamInterface,
+        paIncompatibleStreamHostApi );
+
+    if( stream->input.aaStream
+            && AAudioStream_getSharingMode( stream->input.aaStream ) != AAUDIO_SHARING_MODE_EXCLUSIVE )
+        return 0;
+    if( stream->output.aaStream
+            && AAudioStream_getSharingMode( stream->output.aaStream ) != AAUDIO_SHARING_MODE_EXCLUSIVE )
+        return 0;
+    return 1;
+
+error:
+    return result;
+}
@@ -0,0 +1,1529 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library AES67 / RTP network host API implementation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Ross Bencina, Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup unix_src
+
+ @brief Host API sending and receiving AES67 audio, RTP streams of L16 or L24 samples, over the network.
+
+ Each configured network source is an input device, each sink an output device. A stream receiving from a
+ source joins its multicast group (or binds its unicast port), reading whatever packets have arrived once per
+ host buffer with recvmmsg() into a jitter buffer. The packets' RTP timestamps place them in the jitter buffer,
+ the gaps of lost packets are filled with silence; the callback receives the frames once the jitter buffer holds
+ the stream's suggested latency of them. A stream sending to a sink splits each host buffer into packets of the
+ packet time and sends them with one sendmmsg(), the RTP headers gathered with the samples in place.
+
+ The samples are converted by the buffer processor from and to native Int16 or Int24, byte swapped to network
+ order in place. The RTP timestamps are the media clock of AES67, the PTP time in frames since the PTP epoch,
+ taken from CLOCK_TAI. It follows PTP as far as the system clock does, which phc2sys synchronizes to the clock
+ of a network interface which ptp4l synchronizes to the grandmaster; the stream timing is the system clock's.
+
+ The devices and the network's parameters are configured from the environment at Pa_Initialize():
+ - PA_AES67_RECEIVE, PA_AES67_SEND: comma separated lists of the sources and the sinks, each
+   name@address:port[/channels[/L16|L24]], for example "stage@239.69.1.10:5004/8/L24". The address is the
+   multicast group, or a unicast address of this host, or of the destination for sinks. 2 channels of L24 by
+   default.
+ - PA_AES67_RATE: the sample rate of all streams, 48000 by default.
+ - PA_AES67_PACKET_TIME: the packet time in microseconds, 1000 by default.
+ - PA_AES67_INTERFACE: the IPv4 address of the interface to send from and join groups on, the system's
+   choice by default.
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg(), sendmmsg() */
+#endif
+
+#include <string.h>
+#include <stdlib.h> /* getenv(), strtol() */
+#include <time.h>   /* clock_gettime(), nanosleep() */
+#include <errno.h>
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <arpa/inet.h>
+
+#include "pa_util.h"
+#include "pa_unix_util.h"
+#include "pa_allocation.h"
+#include "pa_hostapi.h"
+#include "pa_stream.h"
+#include "pa_cpuload.h"
+#include "pa_process.h"
+#include "pa_probes.h"
+#include "pa_blockingio.h"
+#include "pa_ringbuffer.h"
+#include "pa_endianness.h"
+#include "pa_debugprint.h"
+
+
+/* prototypes for functions declared in this file */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+PaError PaAes67_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate );
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData );
+static PaError CloseStream( PaStream* stream );
+static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
+static PaError StopStream( PaStream *stream );
+static PaError AbortStream( PaStream *stream );
+static PaError IsStreamStopped( PaStream *s );
+static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaTime GetStreamTime( PaStream *stream );
+static double GetStreamCpuLoad( PaStream* stream );
+static PaError BlockingReadStream( PaStream* stream, void *buffer, unsigned long frames );
+static PaError BlockingWriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static signed long BlockingGetStreamReadAvailable( PaStream* stream );
+static signed long BlockingGetStreamWriteAvailable( PaStream* stream );
+static signed long GetStreamMemoryUsage( PaStream* stream );
+
+
+#define PA_AES67_MAX_CHANNELS_ (64)
+#define PA_AES67_DEFAULT_CHANNELS_ (2)
+#define PA_AES67_DEFAULT_SAMPLE_RATE_ (48000)
+#define PA_AES67_DEFAULT_PACKET_TIME_ (1000)
+#define PA_AES67_RTP_HEADER_BYTES_ (12)
+/** The payload dynamic RTP payload type of the packets sent, as announced by SDP */
+#define PA_AES67_PAYLOAD_TYPE_ (96)
+/** Largest payload of the packets sent: an Ethernet MTU less the IP, UDP and RTP headers, rounded down */
+#define PA_AES67_MAX_PAYLOAD_ (1440)
+/** Largest packet received, anything longer isn't AES67 */
+#define PA_AES67_MAX_PACKET_ (1500)
+/** Packets received per recvmmsg() */
+#define PA_AES67_RECEIVE_BATCH_ (32)
+/** Hops of the multicast packets sent, AES67 streams are expected to cross routers of the media network */
+#define PA_AES67_MULTICAST_TTL_ (15)
+/** DSCP EF, the class AES67 recommends for media packets, in the TOS byte */
+#define PA_AES67_TOS_ (46 << 2)
+#define PA_AES67_RECEIVE_BUFFER_BYTES_ (1 << 18)
+
+typedef struct
+{
+    PaDeviceInfo baseDeviceInfo;
+
+    struct sockaddr_in address;
+    int channels;
+    int bytesPerSample;     /**< 2 for L16, 3 for L24 */
+}
+PaAes67DeviceInfo;
+
+/* PaAes67HostApiRepresentation - host api datastructure specific to this implementation */
+
+typedef struct
+{
+    PaUtilHostApiRepresentation inheritedHostApiRep;
+    PaUtilStreamInterface callbackStreamInterface;
+    PaUtilStreamInterface blockingStreamInterface;
+
+    PaUtilAllocationGroup *allocations;
+
+    double sampleRate;
+    unsigned long packetFrames;
+    struct in_addr interfaceAddress;
+}
+PaAes67HostApiRepresentation;
+
+/** A stream's socket and jitter buffer of a network source */
+typedef struct
+{
+    int socket;
+    int channels;
+    unsigned long bytesPerSample;
+    unsigned long bytesPerFrame;
+
+    PaUtilRingBuffer jitterBuffer;      /**< Of native samples */
+    void *jitterBufferData;
+    /** Frames the jitter buffer fills up to before the callback gets them */
+    unsigned long jitterFrames;
+    int isPrimed;
+
+    unsigned char *packets;             /**< PA_AES67_RECEIVE_BATCH_ buffers of PA_AES67_MAX_PACKET_ */
+    struct mmsghdr messages[PA_AES67_RECEIVE_BATCH_];
+    struct iovec iovecs[PA_AES67_RECEIVE_BATCH_];
+
+    int isLocked;                       /**< ssrc and expectedTimestamp are those of the source */
+    uint32_t ssrc;
+    uint32_t expectedTimestamp;         /**< Of the frame following the jitter buffer's last one */
+    PaStreamCallbackFlags pendingFlags; /**< Lost or dropped packets, reported with the next host buffer */
+    unsigned long lostPackets;
+    unsigned long latePackets;
+}
+PaAes67Receiver;
+
+/** A stream's socket and packets of a network sink */
+typedef struct
+{
+    int socket;
+    int channels;
+    unsigned long bytesPerSample;
+    unsigned long bytesPerFrame;
+
+    unsigned char *buffer;              /**< The host buffer, sent as the payloads of packetCount packets */
+    unsigned long packetCount;
+    unsigned char *headers;             /**< packetCount RTP headers */
+    struct mmsghdr *messages;
+    struct iovec *iovecs;               /**< A header and a payload of each message */
+
+    int isSynchronized;                 /**< timestamp continues the previous packets */
+    uint16_t sequence;
+    uint32_t timestamp;
+    uint32_t ssrc;
+}
+PaAes67Sender;
+
+
+/* PaAes67Stream - a stream data structure specifically for this implementation */
+
+typedef struct PaAes67Stream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaUtilBufferProcessor bufferProcessor;
+
+    int inputChannelCount;
+    int outputChannelCount;
+    PaAes67Receiver receiver;   /**< If inputChannelCount > 0 */
+    PaAes67Sender sender;       /**< If outputChannelCount > 0 */
+    unsigned long framesPerHostBuffer;
+    unsigned long packetFrames;
+    double sampleRate;
+    /** Silence for the callback while the jitter buffer is short */
+    unsigned char *inputScratch;
+
+    int isBlockingStream;
+    PaUtilBlockingIO blockingIO;
+
+    PaUnixThread thread;
+    volatile sig_atomic_t isActive;
+    volatile sig_atomic_t isStopped;
+}
+PaAes67Stream;
+
+
+/* ---- blocking emulation layer ---- */
+
+static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFrames )
+{
+    PaAes67Stream *stream = (PaAes67Stream *)s;
+
+    return PaUtil_ReadBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static PaError BlockingWriteStream( PaStream* s, const void *data, unsigned long numFrames )
+{
+    PaAes67Stream *stream = (PaAes67Stream *)s;
+
+    return PaUtil_WriteBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static signed long BlockingGetStreamReadAvailable( PaStream* s )
+{
+    PaAes67Stream *stream = (PaAes67Stream *)s;
+
+    return PaUtil_GetBlockingIOReadAvailable( &stream->blockingIO );
+}
+
+static signed long BlockingGetStreamWriteAvailable( PaStream* s )
+{
+    PaAes67Stream *stream = (PaAes67Stream *)s;
+
+    return PaUtil_GetBlockingIOWriteAvailable( &stream->blockingIO );
+}
+
+
+/* ---- devices ---- */
+
+static long GetEnvNumber( const char *name, long defaultValue, long minimum, long maximum )
+{
+    const char *value = getenv( name );
+    char *end;
+    long number;
+
+    if( !value || !*value )
+        return defaultValue;
+    number = strtol( value, &end, 10 );
+    if( *end || number < minimum || number > maximum )
+    {
+        PA_DEBUG(( "%s: Ignoring %s=%s\n", __FUNCTION__, name, value ));
+        return defaultValue;
+    }
+    return number;
+}
+
+
+/** Parse one name@address:port[/channels[/L16|L24]] entry into deviceInfo, the entry is modified.
+ @return 0 if it's malformed. */
+static int ParseDevice( PaAes67HostApiRepresentation *aes67HostApi, PaAes67DeviceInfo *deviceInfo, char *entry )
+{
+    char *address = strchr( entry, '@' ), *port, *channels = NULL, *encoding = NULL, *end, *name;
+    long value;
+
+    deviceInfo->channels = PA_AES67_DEFAULT_CHANNELS_;
+    deviceInfo->bytesPerSample = 3;
+    if( !address || address == entry )
+        return 0;
+    *address++ = '\0';
+    if( (channels = strchr( address, '/' )) )
+    {
+        *channels++ = '\0';
+        if( (encoding = strchr( channels, '/' )) )
+            *encoding++ = '\0';
+    }
+    if( !(port = strchr( address, ':' )) )
+        return 0;
+    *port++ = '\0';
+
+    memset( &deviceInfo->address, 0, sizeof(deviceInfo->address) );
+    deviceInfo->address.sin_family = AF_INET;
+    if( inet_pton( AF_INET, address, &deviceInfo->address.sin_addr ) != 1 )
+        return 0;
+    value = strtol( port, &end, 10 );
+    if( *end || value < 1 || value > 65535 )
+        return 0;
+    deviceInfo->address.sin_port = htons( (uint16_t)value );
+
+    if( channels )
+    {
+        value = strtol( channels, &end, 10 );
+        if( *end || value < 1 || value > PA_AES67_MAX_CHANNELS_ )
+            return 0;
+        deviceInfo->channels = (int)value;
+    }
+    if( encoding )
+    {
+        if( !strcmp( encoding, "L16" ) )
+            deviceInfo->bytesPerSample = 2;
+        else if( strcmp( encoding, "L24" ) )
+            return 0;
+    }
+    if( aes67HostApi->packetFrames * deviceInfo->channels * deviceInfo->bytesPerSample > PA_AES67_MAX_PAYLOAD_ )
+    {
+        PA_DEBUG(( "%s: %d channels of %lu frames don't fit in a packet\n", __FUNCTION__,
+                    deviceInfo->channels, aes67HostApi->packetFrames ));
+        return 0;
+    }
+
+    if( !(name = (char*)PaUtil_GroupAllocateMemory( aes67HostApi->allocations, (long)strlen( entry ) + 1 )) )
+        return 0;
+    strcpy( name, entry );
+    deviceInfo->baseDeviceInfo.name = name;
+    return 1;
+}
+
+
+static int CountEntries( const char *list )
+{
+    int count = 0;
+
+    if( list && *list )
+    {
+        for( count = 1; *list; ++list )
+        {
+            if( *list == ',' )
+                ++count;
+        }
+    }
+    return count;
+}
+
+
+/** Append the devices of one of the lists to the device list */
+static PaError AddDevices( PaAes67HostApiRepresentation *aes67HostApi, PaHostApiIndex hostApiIndex,
+        const char *devices, int isInput, PaAes67DeviceInfo *deviceInfos )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *commonApi = &aes67HostApi->inheritedHostApiRep;
+    char *list, *entry, *next;
+
+    if( !devices || !*devices )
+        return result;
+    PA_UNLESS( list = (char*)PaUtil_GroupAllocateMemory( aes67HostApi->allocations, (long)strlen( devices ) + 1 ),
+            paInsufficientMemory );
+    strcpy( list, devices );
+
+    for( entry = list; entry; entry = next )
+    {
+        PaAes67DeviceInfo *deviceInfo = &deviceInfos[commonApi->info.deviceCount];
+        PaDeviceInfo *baseDeviceInfo = &deviceInfo->baseDeviceInfo;
+        PaTime packetTime = aes67HostApi->packetFrames / aes67HostApi->sampleRate;
+
+        if( (next = strchr( entry, ',' )) )
+            *next++ = '\0';
+        if( !*entry )
+            continue;
+        if( !ParseDevice( aes67HostApi, deviceInfo, entry ) )
+        {
+            PA_DEBUG(( "%s: Ignoring malformed device '%s'\n", __FUNCTION__, entry ));
+            continue;
+        }
+
+        baseDeviceInfo->structVersion = 2;
+        baseDeviceInfo->hostApi = hostApiIndex;
+        baseDeviceInfo->defaultSampleRate = aes67HostApi->sampleRate;
+        /* the network's jitter is what the latencies allow for, a few packets at least */
+        if( isInput )
+        {
+            baseDeviceInfo->maxInputChannels = deviceInfo->channels;
+            baseDeviceInfo->defaultLowInputLatency = PA_MAX( 4 * packetTime, .004 );
+            baseDeviceInfo->defaultHighInputLatency = PA_MAX( 16 * packetTime, .02 );
+            if( commonApi->info.defaultInputDevice == paNoDevice )
+                commonApi->info.defaultInputDevice = commonApi->info.deviceCount;
+        }
+        else
+        {
+            baseDeviceInfo->maxOutputChannels = deviceInfo->channels;
+            baseDeviceInfo->defaultLowOutputLatency = PA_MAX( 2 * packetTime, .002 );
+            baseDeviceInfo->defaultHighOutputLatency = PA_MAX( 8 * packetTime, .01 );
+            if( commonApi->info.defaultOutputDevice == paNoDevice )
+                commonApi->info.defaultOutputDevice = commonApi->info.deviceCount;
+        }
+
+        commonApi->deviceInfos[commonApi->info.deviceCount++] = baseDeviceInfo;
+    }
+
+error:
+    return result;
+}
+
+
+/** Build the device list from PA_AES67_RECEIVE and PA_AES67_SEND */
+static PaError BuildDeviceList( PaAes67HostApiRepresentation *aes67HostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *commonApi = &aes67HostApi->inheritedHostApiRep;
+    const char *sources = getenv( "PA_AES67_RECEIVE" ), *sinks = getenv( "PA_AES67_SEND" );
+    int maxDevices = CountEntries( sources ) + CountEntries( sinks );
+    PaAes67DeviceInfo *deviceInfos;
+
+    commonApi->info.deviceCount = 0;
+    commonApi->info.defaultInputDevice = paNoDevice;
+    commonApi->info.defaultOutputDevice = paNoDevice;
+    if( maxDevices == 0 )
+        return result;
+
+    PA_UNLESS( commonApi->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory( aes67HostApi->allocations,
+                sizeof(PaDeviceInfo*) * maxDevices ), paInsufficientMemory );
+    PA_UNLESS( deviceInfos = (PaAes67DeviceInfo*)PaUtil_GroupAllocateMemory( aes67HostApi->allocations,
+                sizeof(PaAes67DeviceInfo) * maxDevices ), paInsufficientMemory );
+    memset( deviceInfos, 0, sizeof(PaAes67DeviceInfo) * maxDevices );
+
+    PA_ENSURE( AddDevices( aes67HostApi, hostApiIndex, sources, 1, deviceInfos ) );
+    PA_ENSURE( AddDevices( aes67HostApi, hostApiIndex, sinks, 0, deviceInfos ) );
+
+error:
+    return result;
+}
+
+
+PaError PaAes67_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaAes67HostApiRepresentation *aes67HostApi;
+    const char *interfaceAddress = getenv( "PA_AES67_INTERFACE" );
+    long packetTime;
+
+    *hostApi = NULL;
+
+    PA_UNLESS( aes67HostApi = (PaAes67HostApiRepresentation*)PaUtil_AllocateMemory(
+                sizeof(PaAes67HostApiRepresentation) ), paInsufficientMemory );
+    memset( aes67HostApi, 0, sizeof(PaAes67HostApiRepresentation) );
+    /* matched in Terminate(), which the error path calls */
+    PA_ENSURE( PaUnixThreading_Initialize() );
+    PA_UNLESS( aes67HostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+
+    aes67HostApi->sampleRate = GetEnvNumber( "PA_AES67_RATE", PA_AES67_DEFAULT_SAMPLE_RATE_, 8000, 384000 );
+    packetTime = GetEnvNumber( "PA_AES67_PACKET_TIME", PA_AES67_DEFAULT_PACKET_TIME_, 100, 20000 );
+    aes67HostApi->packetFrames = (unsigned long)PA_MAX( aes67HostApi->sampleRate * packetTime / 1000000 + .5, 1 );
+    aes67HostApi->interfaceAddress.s_addr = htonl( INADDR_ANY );
+    if( interfaceAddress && *interfaceAddress
+            && inet_pton( AF_INET, interfaceAddress, &aes67HostApi->interfaceAddress ) != 1 )
+    {
+        PA_DEBUG(( "%s: Ignoring PA_AES67_INTERFACE=%s\n", __FUNCTION__, interfaceAddress ));
+        aes67HostApi->interfaceAddress.s_addr = htonl( INADDR_ANY );
+    }
+
+    PA_ENSURE( BuildDeviceList( aes67HostApi, hostApiIndex ) );
+    /* Without sources or sinks this API cannot be used. The V19 development docs say that if an implementation
+     * detects that it cannot be used, it should return a NULL interface and paNoError */
+    if( aes67HostApi->inheritedHostApiRep.info.deviceCount == 0 )
+    {
+        PA_DEBUG(( "%s: No devices in PA_AES67_RECEIVE or PA_AES67_SEND\n", __FUNCTION__ ));
+        Terminate( &aes67HostApi->inheritedHostApiRep );
+        return paNoError;
+    }
+
+    *hostApi = &aes67HostApi->inheritedHostApiRep;
+    (*hostApi)->info.structVersion = 1;
+    (*hostApi)->info.type = paInDevelopment;
+    (*hostApi)->info.name = "AES67";
+
+    (*hostApi)->Terminate = Terminate;
+    (*hostApi)->OpenStream = OpenStream;
+    (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
+
+    PaUtil_InitializeStreamInterface( &aes67HostApi->callbackStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, GetStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable, PaUtil_DummyGetWriteAvailable );
+    aes67HostApi->callbackStreamInterface.Pause = PauseStream;
+    aes67HostApi->callbackStreamInterface.Resume = ResumeStream;
+    aes67HostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+
+    PaUtil_InitializeStreamInterface( &aes67HostApi->blockingStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, PaUtil_DummyGetCpuLoad,
+                                      BlockingReadStream, BlockingWriteStream,
+                                      BlockingGetStreamReadAvailable, BlockingGetStreamWriteAvailable );
+
+    PA_DEBUG(( "%s: %d devices at %.0f Hz, packets of %lu frames\n", __FUNCTION__, (*hostApi)->info.deviceCount,
+               aes67HostApi->sampleRate, aes67HostApi->packetFrames ));
+
+    return result;
+
+error:
+    if( aes67HostApi )
+        Terminate( &aes67HostApi->inheritedHostApiRep );
+    return result;
+}
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
+{
+    PaAes67HostApiRepresentation *aes67HostApi = (PaAes67HostApiRepresentation*)hostApi;
+
+    if( aes67HostApi->allocations )
+    {
+        PaUtil_FreeAllAllocations( aes67HostApi->allocations );
+        PaUtil_DestroyAllocationGroup( aes67HostApi->allocations );
+    }
+
+    PaUtil_FreeMemory( aes67HostApi );
+
+    PaUnixThreading_Terminate();
+}
+
+
+/** Checks common to IsFormatSupported and OpenStream for one direction of a stream. */
+static PaError ValidateParameters( struct PaUtilHostApiRepresentation *hostApi,
+                                   const PaStreamParameters *parameters, int isInput, double sampleRate )
+{
+    const PaDeviceInfo *deviceInfo;
+
+    if( !parameters )
+        return paNoError;
+
+    /* all standard sample formats are supported by the buffer adapter,
+        this implementation doesn't support any custom sample formats */
+    if( parameters->sampleFormat & paCustomFormat )
+        return paSampleFormatNotSupported;
+
+    /* alternate device specification isn't supported */
+    if( parameters->device == paUseHostApiSpecificDeviceSpecification )
+        return paInvalidDevice;
+
+    deviceInfo = hostApi->deviceInfos[ parameters->device ];
+    if( parameters->channelCount > (isInput ? deviceInfo->maxInputChannels : deviceInfo->maxOutputChannels) )
+        return paInvalidChannelCount;
+
+    /* the network runs at one rate */
+    if( sampleRate != deviceInfo->defaultSampleRate )
+        return paInvalidSampleRate;
+
+    /* this implementation doesn't use custom stream info */
+    if( parameters->hostApiSpecificStreamInfo )
+        return paIncompatibleHostApiSpecificStreamInfo;
+
+    return paNoError;
+}
+
+
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate )
+{
+    PaError result = paNoError;
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    return paFormatIsSupported;
+
+error:
+    return result;
+}
+
+
+/* ---- network ---- */
+
+/** The AES67 media clock: the frames since the PTP epoch, modulo 2^32. */
+static uint32_t GetMediaClock( double sampleRate )
+{
+    struct timespec ts;
+    uint64_t rate = (uint64_t)sampleRate;
+
+#ifdef CLOCK_TAI
+    if( clock_gettime( CLOCK_TAI, &ts ) != 0 )
+#endif
+        clock_gettime( CLOCK_REALTIME, &ts );
+    return (uint32_t)((uint64_t)ts.tv_sec * rate + (uint64_t)ts.tv_nsec * rate / 1000000000u);
+}
+
+
+/** Byte swap count native samples to network order or back, in place. */
+static void SwapSamples( unsigned char *samples, unsigned long count, unsigned long bytesPerSample )
+{
+#ifdef PA_LITTLE_ENDIAN
+    unsigned char *end = samples + count * bytesPerSample, swap;
+
+    for( ; samples != end; samples += bytesPerSample )
+    {
+        swap = samples[0];
+        samples[0] = samples[bytesPerSample - 1];
+        samples[bytesPerSample - 1] = swap;
+    }
+#else
+    (void)samples; /* unused parameters */
+    (void)count;
+    (void)bytesPerSample;
+#endif
+}
+
+
+static PaError SetSocketOption( int fd, int level, int name, const void *value, socklen_t length )
+{
+    if( setsockopt( fd, level, name, value, length ) != 0 )
+    {
+        PaUtil_SetLastHostErrorInfo( paInDevelopment, errno, strerror( errno ) );
+        PA_DEBUG(( "%s: setsockopt( %d, %d ) failed: %s\n", __FUNCTION__, level, name, strerror( errno ) ));
+        return paUnanticipatedHostError;
+    }
+    return paNoError;
+}
+
+
+/** Open a socket receiving from or sending to the device's address. */
+static PaError OpenSocket( const PaAes67HostApiRepresentation *aes67HostApi, const PaAes67DeviceInfo *deviceInfo,
+        int isSender, int *socketFd )
+{
+    PaError result = paNoError;
+    int fd = socket( AF_INET, SOCK_DGRAM, 0 ), one = 1;
+    int isMulticast = IN_MULTICAST( ntohl( deviceInfo->address.sin_addr.s_addr ) );
+
+    if( fd == -1 )
+    {
+        PaUtil_SetLastHostErrorInfo( paInDevelopment, errno, strerror( errno ) );
+        return paUnanticipatedHostError;
+    }
+
+    if( isSender )
+    {
+        int ttl = PA_AES67_MULTICAST_TTL_, tos = PA_AES67_TOS_;
+
+        PA_ENSURE( SetSocketOption( fd, IPPROTO_IP, IP_TOS, &tos, sizeof (tos) ) );
+        if( isMulticast )
+        {
+            PA_ENSURE( SetSocketOption( fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof (ttl) ) );
+            PA_ENSURE( SetSocketOption( fd, IPPROTO_IP, IP_MULTICAST_IF, &aes67HostApi->interfaceAddress,
+                        sizeof (aes67HostApi->interfaceAddress) ) );
+        }
+        /* connected, so the messages needn't carry the address */
+        PA_UNLESS( connect( fd, (const struct sockaddr*)&deviceInfo->address, sizeof (deviceInfo->address) ) == 0,
+                paDeviceUnavailable );
+    }
+    else
+    {
+        int receiveBuffer = PA_AES67_RECEIVE_BUFFER_BYTES_;
+
+        /* other applications may receive the same group */
+        PA_ENSURE( SetSocketOption( fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one) ) );
+        PA_ENSURE( SetSocketOption( fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof (receiveBuffer) ) );
+        PA_UNLESS( bind( fd, (const struct sockaddr*)&deviceInfo->address, sizeof (deviceInfo->address) ) == 0,
+                paDeviceUnavailable );
+        if( isMulticast )
+        {
+            struct ip_mreq membership;
+
+            membership.imr_multiaddr = deviceInfo->address.sin_addr;
+            membership.imr_interface = aes67HostApi->interfaceAddress;
+            PA_ENSURE( SetSocketOption( fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof (membership) ) );
+        }
+    }
+
+    *socketFd = fd;
+    return result;
+
+error:
+    if( result == paDeviceUnavailable )
+    {
+        PaUtil_SetLastHostErrorInfo( paInDevelopment, errno, strerror( errno ) );
+        PA_DEBUG(( "%s: Couldn't %s %s: %s\n", __FUNCTION__, isSender ? "connect to" : "bind",
+                    deviceInfo->baseDeviceInfo.name, strerror( errno ) ));
+    }
+    close( fd );
+    return result;
+}
+
+
+static PaError InitializeReceiver( PaAes67Receiver *receiver, const PaAes67HostApiRepresentation *aes67HostApi,
+        const PaAes67DeviceInfo *deviceInfo, unsigned long framesPerHostBuffer, PaTime suggestedLatency )
+{
+    PaError result = paNoError;
+    ring_buffer_size_t ringFrames = 1;
+    int i;
+
+    receiver->channels = deviceInfo->channels;
+    receiver->bytesPerSample = deviceInfo->bytesPerSample;
+    receiver->bytesPerFrame = receiver->bytesPerSample * receiver->channels;
+    receiver->jitterFrames = PA_MAX( (unsigned long)(suggestedLatency * aes67HostApi->sampleRate),
+            2 * aes67HostApi->packetFrames );
+    /* room for the jitter, a host buffer and the packets of another one arriving in a burst */
+    while( (unsigned long)ringFrames < receiver->jitterFrames + 3 * framesPerHostBuffer )
+        ringFrames <<= 1;
+
+    PA_UNLESS( receiver->jitterBufferData = PaUtil_AllocateMemory( ringFrames * receiver->bytesPerFrame ),
+            paInsufficientMemory );
+    PA_UNLESS( PaUtil_InitializeRingBuffer( &receiver->jitterBuffer, (ring_buffer_size_t)receiver->bytesPerFrame,
+                ringFrames, receiver->jitterBufferData ) == 0, paInternalError );
+
+    PA_UNLESS( receiver->packets = (unsigned char*)PaUtil_AllocateMemory(
+                PA_AES67_RECEIVE_BATCH_ * PA_AES67_MAX_PACKET_ ), paInsufficientMemory );
+    memset( receiver->messages, 0, sizeof(receiver->messages) );
+    for( i = 0; i < PA_AES67_RECEIVE_BATCH_; ++i )
+    {
+        receiver->iovecs[i].iov_base = receiver->packets + i * PA_AES67_MAX_PACKET_;
+        receiver->iovecs[i].iov_len = PA_AES67_MAX_PACKET_;
+        receiver->messages[i].msg_hdr.msg_iov = &receiver->iovecs[i];
+        receiver->messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    PA_ENSURE( OpenSocket( aes67HostApi, deviceInfo, 0, &receiver->socket ) );
+
+error:
+    return result;
+}
+
+
+static PaError InitializeSender( PaAes67Sender *sender, const PaAes67HostApiRepresentation *aes67HostApi,
+        const PaAes67DeviceInfo *deviceInfo, unsigned long framesPerHostBuffer )
+{
+    PaError result = paNoError;
+    unsigned long payloadBytes, i;
+
+    sender->channels = deviceInfo->channels;
+    sender->bytesPerSample = deviceInfo->bytesPerSample;
+    sender->bytesPerFrame = sender->bytesPerSample * sender->channels;
+    sender->packetCount = framesPerHostBuffer / aes67HostApi->packetFrames;
+    payloadBytes = aes67HostApi->packetFrames * sender->bytesPerFrame;
+    sender->ssrc = (uint32_t)getpid() * 2654435761u ^ GetMediaClock( aes67HostApi->sampleRate )
+            ^ ntohl( deviceInfo->address.sin_addr.s_addr ) ^ ntohs( deviceInfo->address.sin_port );
+
+    PA_UNLESS( sender->buffer = (unsigned char*)PaUtil_AllocateMemory( framesPerHostBuffer * sender->bytesPerFrame ),
+            paInsufficientMemory );
+    PA_UNLESS( sender->headers = (unsigned char*)PaUtil_AllocateMemory(
+                sender->packetCount * PA_AES67_RTP_HEADER_BYTES_ ), paInsufficientMemory );
+    PA_UNLESS( sender->messages = (struct mmsghdr*)PaUtil_AllocateMemory(
+                sender->packetCount * sizeof(struct mmsghdr) ), paInsufficientMemory );
+    PA_UNLESS( sender->iovecs = (struct iovec*)PaUtil_AllocateMemory(
+                2 * sender->packetCount * sizeof(struct iovec) ), paInsufficientMemory );
+    memset( sender->messages, 0, sender->packetCount * sizeof(struct mmsghdr) );
+
+    /* each packet gathers its header and its part of the host buffer */
+    for( i = 0; i < sender->packetCount; ++i )
+    {
+        unsigned char *header = sender->headers + i * PA_AES67_RTP_HEADER_BYTES_;
+
+        header[0] = 0x80; /* version 2 */
+        header[1] = PA_AES67_PAYLOAD_TYPE_;
+        header[8] = (unsigned char)(sender->ssrc >> 24);
+        header[9] = (unsigned char)(sender->ssrc >> 16);
+        header[10] = (unsigned char)(sender->ssrc >> 8);
+        header[11] = (unsigned char)sender->ssrc;
+        sender->iovecs[2 * i].iov_base = header;
+        sender->iovecs[2 * i].iov_len = PA_AES67_RTP_HEADER_BYTES_;
+        sender->iovecs[2 * i + 1].iov_base = sender->buffer + i * payloadBytes;
+        sender->iovecs[2 * i + 1].iov_len = payloadBytes;
+        sender->messages[i].msg_hdr.msg_iov = &sender->iovecs[2 * i];
+        sender->messages[i].msg_hdr.msg_iovlen = 2;
+    }
+
+    PA_ENSURE( OpenSocket( aes67HostApi, deviceInfo, 1, &sender->socket ) );
+
+error:
+    return result;
+}
+
+
+static void TerminateReceiver( PaAes67Receiver *receiver )
+{
+    if( receiver->socket >= 0 )
+        close( receiver->socket );
+    PaUtil_FreeMemory( receiver->jitterBufferData );
+    PaUtil_FreeMemory( receiver->packets );
+}
+
+
+static void TerminateSender( PaAes67Sender *sender )
+{
+    if( sender->socket >= 0 )
+        close( sender->socket );
+    PaUtil_FreeMemory( sender->buffer );
+    PaUtil_FreeMemory( sender->headers );
+    PaUtil_FreeMemory( sender->messages );
+    PaUtil_FreeMemory( sender->iovecs );
+}
+
+
+static uint32_t ReadUint32( const unsigned char *bytes )
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+
+/** Write frames of silence to the jitter buffer, for packets which were lost */
+static void WriteSilence( PaAes67Receiver *receiver, unsigned long frames )
+{
+    void *data1, *data2;
+    ring_buffer_size_t size1, size2;
+
+    frames = PaUtil_GetRingBufferWriteRegions( &receiver->jitterBuffer, (ring_buffer_size_t)frames,
+            &data1, &size1, &data2, &size2 );
+    memset( data1, 0, size1 * receiver->bytesPerFrame );
+    if( size2 > 0 )
+        memset( data2, 0, size2 * receiver->bytesPerFrame );
+    PaUtil_AdvanceRingBufferWriteIndex( &receiver->jitterBuffer, (ring_buffer_size_t)frames );
+}
+
+
+/** Place the samples of an RTP packet in the jitter buffer, by its timestamp. */
+static void HandlePacket( PaAes67Receiver *receiver, unsigned char *packet, unsigned long length )
+{
+    unsigned long headerBytes = PA_AES67_RTP_HEADER_BYTES_, frames;
+    ring_buffer_size_t ringFrames = receiver->jitterBuffer.bufferSize;
+    uint32_t timestamp, ssrc;
+    int32_t delta;
+
+    if( length < headerBytes || (packet[0] >> 6) != 2 )
+        return;
+    headerBytes += 4 * (packet[0] & 0x0f); /* CSRCs */
+    if( (packet[0] & 0x10) && length >= headerBytes + 4 ) /* extension */
+        headerBytes += 4 + 4 * (((unsigned long)packet[headerBytes + 2] << 8) | packet[headerBytes + 3]);
+    if( (packet[0] & 0x20) && length > headerBytes ) /* padding */
+        length -= packet[length - 1];
+    if( length <= headerBytes )
+        return;
+
+    timestamp = ReadUint32( packet + 4 );
+    ssrc = ReadUint32( packet + 8 );
+    frames = (length - headerBytes) / receiver->bytesPerFrame;
+
+    /* a new source, or the source restarted */
+    if( !receiver->isLocked || ssrc != receiver->ssrc )
+    {
+        PA_DEBUG(( "%s: Receiving ssrc %08x\n", __FUNCTION__, (unsigned)ssrc ));
+        receiver->isLocked = 1;
+        receiver->ssrc = ssrc;
+        receiver->expectedTimestamp = timestamp;
+    }
+
+    delta = (int32_t)(timestamp - receiver->expectedTimestamp);
+    if( delta < 0 )
+    {
+        /* late or duplicated, its frames have been filled with silence already */
+        ++receiver->latePackets;
+        return;
+    }
+    if( delta > ringFrames )
+    {
+        /* the source jumped, start over from here */
+        PA_DEBUG(( "%s: Timestamp jumped by %d frames\n", __FUNCTION__, (int)delta ));
+        receiver->expectedTimestamp = timestamp;
+        delta = 0;
+    }
+    else if( delta > 0 )
+    {
+        ++receiver->lostPackets;
+        receiver->pendingFlags |= paInputUnderflow;
+        WriteSilence( receiver, (unsigned long)delta );
+    }
+
+    SwapSamples( packet + headerBytes, frames * receiver->channels, receiver->bytesPerSample );
+    if( PaUtil_WriteRingBuffer( &receiver->jitterBuffer, packet + headerBytes, (ring_buffer_size_t)frames )
+            < (ring_buffer_size_t)frames )
+        receiver->pendingFlags |= paInputOverflow;
+    receiver->expectedTimestamp = timestamp + (uint32_t)frames;
+}
+
+
+/** Move the packets which have arrived to the jitter buffer, without waiting. */
+static void ReceivePackets( PaAes67Receiver *receiver )
+{
+    int received, i;
+
+    do
+    {
+        received = recvmmsg( receiver->socket, receiver->messages, PA_AES67_RECEIVE_BATCH_, MSG_DONTWAIT, NULL );
+        for( i = 0; i < received; ++i )
+            HandlePacket( receiver, (unsigned char*)receiver->iovecs[i].iov_base, receiver->messages[i].msg_len );
+    }
+    while( received == PA_AES67_RECEIVE_BATCH_ );
+
+    if( received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR )
+    {
+        PA_DEBUG(( "%s: recvmmsg failed: %s\n", __FUNCTION__, strerror( errno ) ));
+    }
+}
+
+
+/** Send the host buffer as the payloads of its packets, continuing the RTP timeline unless the stream
+ fell behind. */
+static void SendPackets( PaAes67Sender *sender, unsigned long framesPerHostBuffer, unsigned long packetFrames,
+        double sampleRate )
+{
+    unsigned long i;
+    int sent;
+
+    if( !sender->isSynchronized )
+        sender->timestamp = GetMediaClock( sampleRate );
+
+    SwapSamples( sender->buffer, framesPerHostBuffer * sender->channels, sender->bytesPerSample );
+    for( i = 0; i < sender->packetCount; ++i )
+    {
+        unsigned char *header = sender->headers + i * PA_AES67_RTP_HEADER_BYTES_;
+
+        /* the marker starts a talkspurt, after the start or a gap */
+        header[1] = PA_AES67_PAYLOAD_TYPE_ | (i == 0 && !sender->isSynchronized ? 0x80 : 0);
+        header[2] = (unsigned char)(sender->sequence >> 8);
+        header[3] = (unsigned char)sender->sequence;
+        header[4] = (unsigned char)(sender->timestamp >> 24);
+        header[5] = (unsigned char)(sender->timestamp >> 16);
+        header[6] = (unsigned char)(sender->timestamp >> 8);
+        header[7] = (unsigned char)sender->timestamp;
+        ++sender->sequence;
+        sender->timestamp += (uint32_t)packetFrames;
+    }
+    sender->isSynchronized = 1;
+
+    sent = sendmmsg( sender->socket, sender->messages, (unsigned int)sender->packetCount, MSG_DONTWAIT );
+    if( sent < (int)sender->packetCount )
+    {
+        PA_DEBUG(( "%s: Sent %d of %lu packets: %s\n", __FUNCTION__, sent, sender->packetCount,
+                    sent < 0 ? strerror( errno ) : "" ));
+    }
+}
+
+
+/* ---- streams ---- */
+
+static void CleanUpStream( PaAes67Stream *stream )
+{
+    TerminateReceiver( &stream->receiver );
+    TerminateSender( &stream->sender );
+    if( stream->isBlockingStream )
+        PaUtil_TerminateBlockingIO( &stream->blockingIO );
+    PaUtil_FreeMemory( stream->inputScratch );
+    PaUtil_FreeMemory( stream );
+}
+
+
+/* see pa_hostapi.h for a list of validity guarantees made about OpenStream parameters */
+
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData )
+{
+    PaError result = paNoError;
+    PaAes67HostApiRepresentation *aes67HostApi = (PaAes67HostApiRepresentation*)hostApi;
+    PaAes67Stream *stream = NULL;
+    const PaAes67DeviceInfo *inputDeviceInfo = NULL, *outputDeviceInfo = NULL;
+    unsigned long framesPerHostBuffer, packetFrames = aes67HostApi->packetFrames;
+    int inputChannelCount = 0, outputChannelCount = 0;
+    PaSampleFormat inputSampleFormat = paInt24, outputSampleFormat = paInt24;
+    PaSampleFormat hostInputSampleFormat = paInt24, hostOutputSampleFormat = paInt24;
+    PaTime suggestedLatency = 0.;
+    int bpInitialized = 0;
+
+    /* validate platform specific flags */
+    if( (streamFlags & paPlatformSpecificFlags) != 0 )
+        return paInvalidFlag; /* unexpected platform specific flag */
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    if( inputParameters )
+    {
+        inputDeviceInfo = (const PaAes67DeviceInfo*)hostApi->deviceInfos[ inputParameters->device ];
+        inputChannelCount = inputParameters->channelCount;
+        inputSampleFormat = inputParameters->sampleFormat;
+        hostInputSampleFormat = inputDeviceInfo->bytesPerSample == 2 ? paInt16 : paInt24;
+        suggestedLatency = inputParameters->suggestedLatency;
+    }
+    if( outputParameters )
+    {
+        outputDeviceInfo = (const PaAes67DeviceInfo*)hostApi->deviceInfos[ outputParameters->device ];
+        outputChannelCount = outputParameters->channelCount;
+        outputSampleFormat = outputParameters->sampleFormat;
+        hostOutputSampleFormat = outputDeviceInfo->bytesPerSample == 2 ? paInt16 : paInt24;
+        suggestedLatency = PA_MAX( suggestedLatency, outputParameters->suggestedLatency );
+    }
+
+    /* The host buffer size is the callback buffer size, unless the callbacks are batched, else half the
+        suggested latency (double buffering), in whole packets */
+    if( framesPerBuffer != paFramesPerBufferUnspecified && !(streamFlags & paBatchCallbacks) )
+        framesPerHostBuffer = framesPerBuffer;
+    else
+        framesPerHostBuffer = (unsigned long)(suggestedLatency * sampleRate / 2);
+    framesPerHostBuffer = PA_MAX( (framesPerHostBuffer + packetFrames - 1) / packetFrames, 1 ) * packetFrames;
+
+    PA_UNLESS( stream = (PaAes67Stream*)PaUtil_AllocateMemory( sizeof(PaAes67Stream) ), paInsufficientMemory );
+    memset( stream, 0, sizeof(PaAes67Stream) );
+    stream->receiver.socket = -1;
+    stream->sender.socket = -1;
+    stream->inputChannelCount = inputChannelCount;
+    stream->outputChannelCount = outputChannelCount;
+    stream->framesPerHostBuffer = framesPerHostBuffer;
+    stream->packetFrames = packetFrames;
+    stream->sampleRate = sampleRate;
+    stream->isStopped = 1;
+
+    if( inputParameters )
+    {
+        PA_ENSURE( InitializeReceiver( &stream->receiver, aes67HostApi, inputDeviceInfo, framesPerHostBuffer,
+                    inputParameters->suggestedLatency ) );
+        PA_UNLESS( stream->inputScratch = (unsigned char*)PaUtil_AllocateMemory(
+                    framesPerHostBuffer * stream->receiver.bytesPerFrame ), paInsufficientMemory );
+        memset( stream->inputScratch, 0, framesPerHostBuffer * stream->receiver.bytesPerFrame );
+    }
+    if( outputParameters )
+        PA_ENSURE( InitializeSender( &stream->sender, aes67HostApi, outputDeviceInfo, framesPerHostBuffer ) );
+
+    /* the blocking emulation, if necessary */
+    stream->isBlockingStream = !streamCallback;
+    if( stream->isBlockingStream )
+    {
+        /* the latency the user asked for indicates the minimum buffer size in frames, three host buffers at least */
+        unsigned long minimumBufferFrames = PA_MAX( (unsigned long)(suggestedLatency * sampleRate),
+                framesPerHostBuffer * 3 );
+
+        PA_ENSURE( PaUtil_InitializeBlockingIO( &stream->blockingIO, inputChannelCount, inputSampleFormat,
+                    outputChannelCount, outputSampleFormat, minimumBufferFrames ) );
+
+        /* install our own callback for the blocking API */
+        streamCallback = PaUtil_BlockingIOCallback;
+        userData = &stream->blockingIO;
+
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &aes67HostApi->blockingStreamInterface, streamCallback, userData );
+    }
+    else
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &aes67HostApi->callbackStreamInterface, streamCallback, userData );
+    }
+
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+
+    PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
+              inputChannelCount, inputSampleFormat, hostInputSampleFormat,
+              outputChannelCount, outputSampleFormat, hostOutputSampleFormat,
+              sampleRate, streamFlags, PaUtil_GetBatchedFramesPerUserBuffer( streamFlags, framesPerBuffer, framesPerHostBuffer ),
+              framesPerHostBuffer, paUtilFixedHostBufferSize,
+              streamCallback, userData ) );
+    bpInitialized = 1;
+
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
+
+    /* The jitter buffer is filled when the callback gets frames, the receivers of the output add their own */
+    stream->streamRepresentation.streamInfo.inputLatency = inputParameters ?
+            (PaTime)(PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )
+                    + stream->receiver.jitterFrames + framesPerHostBuffer) / sampleRate : 0.;
+    stream->streamRepresentation.streamInfo.outputLatency = outputParameters ?
+            (PaTime)(PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )
+                    + framesPerHostBuffer) / sampleRate : 0.;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+
+    *s = (PaStream*)stream;
+
+    return result;
+
+error:
+    if( stream )
+    {
+        if( bpInitialized )
+            PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+        CleanUpStream( stream );
+    }
+
+    return result;
+}
+
+
+/** Sleep until the given PaUtil_GetTime() time. */
+static void SleepUntil( PaTime deadline )
+{
+    PaTime delay;
+
+    while( (delay = deadline - PaUtil_GetTime()) > 0. )
+    {
+        struct timespec ts;
+        ts.tv_sec = (time_t)delay;
+        ts.tv_nsec = (long)((delay - ts.tv_sec) * 1e9);
+        nanosleep( &ts, NULL );
+    }
+}
+
+
+/** Register up to 2 regions of the jitter buffer, or the silence, as the host input buffer. */
+static void SetInputChannels( PaAes67Stream *stream, void *data1, unsigned long frames1, void *data2,
+        unsigned long frames2 )
+{
+    PaUtilBufferProcessor *bp = &stream->bufferProcessor;
+    unsigned long bytesPerSample = stream->receiver.bytesPerSample;
+    int i;
+
+    PaUtil_SetInputFrameCount( bp, frames1 );
+    for( i = 0; i < stream->inputChannelCount; ++i )
+        PaUtil_SetInputChannel( bp, i, (unsigned char*)data1 + i * bytesPerSample, stream->receiver.channels );
+    if( frames2 > 0 )
+    {
+        PaUtil_Set2ndInputFrameCount( bp, frames2 );
+        for( i = 0; i < stream->inputChannelCount; ++i )
+            PaUtil_Set2ndInputChannel( bp, i, (unsigned char*)data2 + i * bytesPerSample, stream->receiver.channels );
+    }
+}
+
+
+/** Take a host buffer from the jitter buffer, once it holds the jitter latency, else silence.
+ @return The frames to advance the jitter buffer by once the host buffer has been processed. */
+static unsigned long TakeInput( PaAes67Stream *stream, PaStreamCallbackFlags *cbFlags, PaTime *inputDelay,
+        void **data1, ring_buffer_size_t *size1, void **data2, ring_buffer_size_t *size2 )
+{
+    PaAes67Receiver *receiver = &stream->receiver;
+    unsigned long frames = stream->framesPerHostBuffer;
+    unsigned long available = (unsigned long)PaUtil_GetRingBufferReadAvailable( &receiver->jitterBuffer );
+
+    *cbFlags |= receiver->pendingFlags;
+    receiver->pendingFlags = 0;
+
+    if( !receiver->isPrimed && available >= receiver->jitterFrames + frames )
+        receiver->isPrimed = 1;
+    if( !receiver->isPrimed || available < frames )
+    {
+        if( receiver->isPrimed )
+        {
+            /* ran dry, fill up to the jitter latency again */
+            *cbFlags |= paInputUnderflow;
+            receiver->isPrimed = 0;
+        }
+        *data1 = stream->inputScratch;
+        *size1 = (ring_buffer_size_t)frames;
+        *size2 = 0;
+        *inputDelay = 0.;
+        return 0;
+    }
+
+    /* the source got ahead, drop what exceeds the jitter latency */
+    if( available > receiver->jitterFrames + 2 * frames )
+    {
+        PaUtil_AdvanceRingBufferReadIndex( &receiver->jitterBuffer,
+                (ring_buffer_size_t)(available - receiver->jitterFrames - frames) );
+        available = receiver->jitterFrames + frames;
+        *cbFlags |= paInputOverflow;
+    }
+
+    PaUtil_GetRingBufferReadRegions( &receiver->jitterBuffer, (ring_buffer_size_t)frames, data1, size1,
+            data2, size2 );
+
+    /* by the timestamps, the first frame is this old */
+    *inputDelay = (PaTime)(int32_t)(GetMediaClock( stream->sampleRate )
+            - (receiver->expectedTimestamp - (uint32_t)available)) / stream->sampleRate;
+    if( *inputDelay < 0. )
+        *inputDelay = 0.;
+    return frames;
+}
+
+
+/** Clean up after the callback thread exits, for whichever reason.
+ Calls the stream finished callback.
+ */
+static void OnThreadExit( void *userData )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)userData;
+
+    assert( stream );
+
+    PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+
+    if( stream->streamRepresentation.streamFinishedCallback )
+        stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+
+    stream->isActive = 0;
+}
+
+
+/** Callback thread.
+ Wakes up once per host buffer of the system clock: takes in the packets which have arrived, processes a host
+ buffer and sends its packets. When it is more than a host buffer late, the missed time is reported as an xrun
+ and skipped, and the packets sent start a new RTP timeline of the media clock.
+ */
+static void *CallbackThreadFunc( void *userData )
+{
+    PaError result = paNoError;
+    PaAes67Stream *stream = (PaAes67Stream*)userData;
+    PaUtilBufferProcessor *bp = &stream->bufferProcessor;
+    unsigned long frames = stream->framesPerHostBuffer;
+    int callbackResult = paContinue;
+    PaTime period, nextTime;
+
+    assert( stream );
+
+    period = frames / stream->sampleRate;
+
+    pthread_cleanup_push( &OnThreadExit, stream );
+
+    PA_ENSURE( PaUnixThread_PrepareNotify( &stream->thread ) );
+    nextTime = PaUtil_GetTime() + period;
+    PA_ENSURE( PaUnixThread_NotifyParent( &stream->thread ) );
+
+    while( 1 )
+    {
+        PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+        PaStreamCallbackFlags cbFlags = 0;
+        PaTime inputDelay = 0., now;
+        unsigned long framesProcessed, inputFramesTaken = 0;
+        void *inputData1 = NULL, *inputData2 = NULL;
+        ring_buffer_size_t inputFrames1 = 0, inputFrames2 = 0;
+
+        pthread_testcancel();
+
+        /* drain the buffer processor if the main thread has requested a stop */
+        if( PaUnixThread_StopRequested( &stream->thread ) && (callbackResult == paContinue) )
+            callbackResult = paComplete;
+
+        if( callbackResult != paContinue )
+        {
+            if( callbackResult == paAbort ||
+                    PaUtil_IsBufferProcessorOutputEmpty( bp ) )
+                goto end;
+        }
+
+        now = PaUtil_GetTime();
+        if( now < nextTime )
+        {
+            PA_PROBE1( host_wait, 0 );
+            SleepUntil( nextTime );
+            PA_PROBE2( host_wait_return, 0, 0 );
+        }
+        else if( now - nextTime > period )
+        {
+            PA_DEBUG(( "%s: %.3f ms late\n", __FUNCTION__, (now - nextTime) * 1000. ));
+            if( stream->outputChannelCount > 0 )
+                cbFlags |= paOutputUnderflow;
+            stream->sender.isSynchronized = 0;
+            nextTime = now;
+        }
+        nextTime += period;
+
+        PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+        if( stream->inputChannelCount > 0 )
+        {
+            ReceivePackets( &stream->receiver );
+            inputFramesTaken = TakeInput( stream, &cbFlags, &inputDelay, &inputData1, &inputFrames1,
+                    &inputData2, &inputFrames2 );
+        }
+
+        timeInfo.currentTime = PaUtil_GetTime();
+        timeInfo.inputBufferAdcTime = timeInfo.currentTime - inputDelay;
+        timeInfo.outputBufferDacTime = timeInfo.currentTime + period;
+        PaUtil_BeginBufferProcessing( bp, &timeInfo, cbFlags );
+        if( stream->inputChannelCount > 0 )
+            SetInputChannels( stream, inputData1, (unsigned long)inputFrames1, inputData2,
+                    (unsigned long)inputFrames2 );
+        if( stream->outputChannelCount > 0 )
+        {
+            int i;
+
+            /* the sink's channels the stream doesn't have carry silence */
+            if( stream->outputChannelCount < stream->sender.channels )
+                memset( stream->sender.buffer, 0, frames * stream->sender.bytesPerFrame );
+            PaUtil_SetOutputFrameCount( bp, frames );
+            for( i = 0; i < stream->outputChannelCount; ++i )
+                PaUtil_SetOutputChannel( bp, i, stream->sender.buffer + i * stream->sender.bytesPerSample,
+                        stream->sender.channels );
+        }
+        framesProcessed = PaUtil_EndBufferProcessing( bp, &callbackResult );
+
+        if( inputFramesTaken > 0 )
+            PaUtil_AdvanceRingBufferReadIndex( &stream->receiver.jitterBuffer, (ring_buffer_size_t)inputFramesTaken );
+        if( stream->outputChannelCount > 0 )
+            SendPackets( &stream->sender, frames, stream->packetFrames, stream->sampleRate );
+
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+    }
+
+end:
+    /* The loop is left through end, so that OnThreadExit() runs here; pthread_cleanup_push() may be a macro
+       opening a block which pthread_cleanup_pop() closes, so they must occur in pairs */
+    pthread_cleanup_pop( 1 );
+
+    PaUnixThreading_EXIT( result );
+error:
+    goto end;
+}
+
+
+/*
+    When CloseStream() is called, the multi-api layer ensures that
+    the stream has already been stopped or aborted.
+*/
+static PaError CloseStream( PaStream* s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+    PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    CleanUpStream( stream );
+
+    return paNoError;
+}
+
+
+static PaError StartStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    if( stream->isBlockingStream )
+        PaUtil_ResetBlockingIO( &stream->blockingIO );
+
+    /* the packets which queued up while stopped are stale */
+    if( stream->inputChannelCount > 0 )
+    {
+        ReceivePackets( &stream->receiver );
+        PaUtil_FlushRingBuffer( &stream->receiver.jitterBuffer );
+        stream->receiver.isLocked = 0;
+        stream->receiver.isPrimed = 0;
+        stream->receiver.pendingFlags = 0;
+    }
+    stream->sender.isSynchronized = 0;
+
+    stream->isStopped = 0;
+    stream->isActive = 1;
+
+    /* the thread starts the clock, wait for it up to a second */
+    result = PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., NULL, NULL, 0 );
+    if( result != paNoError )
+    {
+        stream->isActive = 0;
+        stream->isStopped = 1;
+    }
+
+    return result;
+}
+
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
+
+static PaError RealStop( PaAes67Stream *stream, int abort )
+{
+    PaError result = paNoError;
+    PaError threadResult;
+
+    /* Let the callback send what was written, allowing for a second of scheduling delays */
+    if( stream->isBlockingStream && !abort )
+        PaUtil_DrainBlockingIO( &stream->blockingIO,
+                PaUtil_GetBlockingIORingBufferFrames( &stream->blockingIO ) / stream->sampleRate + 1. );
+
+    PA_ENSURE( PaUnixThread_Terminate( &stream->thread, !abort, &threadResult ) );
+    if( threadResult != paNoError )
+    {
+        PA_DEBUG(( "%s: callback thread returned %d\n", __FUNCTION__, threadResult ));
+    }
+
+error:
+    stream->isActive = 0;
+    stream->isStopped = 1;
+    if( stream->isBlockingStream )
+        PaUtil_StopBlockingIO( &stream->blockingIO );
+    PA_DEBUG(( "%s: %lu packets lost, %lu late\n", __FUNCTION__, stream->receiver.lostPackets,
+                stream->receiver.latePackets ));
+    return result;
+}
+
+
+static PaError StopStream( PaStream *s )
+{
+    return RealStop( (PaAes67Stream*)s, 0 );
+}
+
+
+static PaError AbortStream( PaStream *s )
+{
+    return RealStop( (PaAes67Stream*)s, 1 );
+}
+
+
+static PaError IsStreamStopped( PaStream *s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    return stream->isStopped;
+}
+
+
+static PaError IsStreamActive( PaStream *s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    return stream->isActive;
+}
+
+
+/* The callback thread keeps receiving and sending while paused, without calling the callback */
+static PaError PauseStream( PaStream *s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
+static PaTime GetStreamTime( PaStream *s )
+{
+    /* the stream clock is the system clock */
+    (void) s;
+
+    return PaUtil_GetTime();
+}
+
+
+static double GetStreamCpuLoad( PaStream* s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+
+    return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
+}
+
+
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaAes67Stream *stream = (PaAes67Stream*)s;
+    signed long usage = (signed long)sizeof(PaAes67Stream)
+            + PaUtil_GetBlockingIOMemoryUsage( &stream->blockingIO )
+            + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+
+    if( stream->inputChannelCount > 0 )
+        usage += (signed long)(stream->receiver.jitterBuffer.bufferSize * stream->receiver.bytesPerFrame
+                + PA_AES67_RECEIVE_BATCH_ * PA_AES67_MAX_PACKET_
+                + stream->framesPerHostBuffer * stream->receiver.bytesPerFrame);
+    if( stream->outputChannelCount > 0 )
+        usage += (signed long)(stream->framesPerHostBuffer * stream->sender.bytesPerFrame
+                + stream->sender.packetCount * (PA_AES67_RTP_HEADER_BYTES_ + sizeof(struct mmsghdr)
+                    + 2 * sizeof(struct iovec)));
+    return usage;
+}
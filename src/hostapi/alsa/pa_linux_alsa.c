@@ -54,6 +54,8 @@
 #undef ALSA_PCM_NEW_SW_PARAMS_API
 
 #include <sys/poll.h>
+#include <sys/inotify.h>
+#include <stddef.h> /* offsetof() */
 #include <string.h> /* strlen() */
 #include <limits.h>
 #include <math.h>
@@ -61,6 +63,13 @@
 #include <signal.h>
 #include <time.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h> /* sysconf(), pipe() */
+#include <fcntl.h>
+#include <errno.h>
 #include <signal.h> /* For sig_atomic_t */
 #ifdef PA_ALSA_DYNAMIC
     #include <dlfcn.h> /* For dlXXX functions */
@@ -76,6 +85,8 @@
 #include "pa_process.h"
 #include "pa_endianness.h"
 #include "pa_debugprint.h"
+#include "pa_trace.h"
+#include "pa_probes.h"
 
 #include "pa_linux_alsa.h"
 
@@ -87,9 +98,31 @@
 /* Combine version elements into a single (unsigned) integer */
 #define ALSA_VERSION_INT(major, minor, subminor)  ((major << 16) | (minor << 8) | subminor)
 
+/* The number of negotiated stream configurations remembered by the host API, see PaAlsaStream_ApplyCachedConfig() */
+#define CONFIG_CACHE_SIZE 8
+
+/* The number of sample rates GetDeviceCapabilities() tests, see standardSampleRates_ */
+#define NUM_STANDARD_SAMPLE_RATES 16
+
 /* The acceptable tolerance of sample rate set, to that requested (as a ratio, eg 50 is 2%, 100 is 1%) */
 #define RATE_MAX_DEVIATE_RATIO 100
 
+/* The share of each period the callback thread reserves under SCHED_DEADLINE. A callback needing more is close
+ * to dropping out anyway, and half a CPU per stream leaves room for several streams to be admitted */
+#define DEADLINE_RUNTIME_RATIO 0.5
+
+/* The hardware buffer asked for by timer scheduled streams (paAlsaTimerScheduling), in seconds. Only the suggested
+ * latency of it is kept filled, the rest gives the callback thread time to catch up after a stall */
+#define TIMER_SCHEDULING_BUFFER_TIME 2.
+
+/* The output a low-power stream (paAlsaLowPowerOutput) lets drain before refilling, in seconds, enough to ride out
+ * the wakeup of the callback thread from a deep sleep of the CPU */
+#define LOW_POWER_HEADROOM_TIME 0.1
+
+/* How long the devices of /dev/snd have to stay unchanged before a change is reported, in milliseconds. A card coming
+ * or going changes several of them, and udev sets their permissions right after they appear */
+#define DEVICE_CHANGE_SETTLE_TIME 50
+
 /* Defines Alsa function types and pointers to these functions. */
 #define _PA_DEFINE_FUNC(x)  typedef typeof(x) x##_ft; static x##_ft *alsa_##x = 0
 
@@ -97,6 +130,7 @@
 #define __alsa_snd_alloca(ptr,type) do { size_t __alsa_alloca_size = alsa_##type##_sizeof(); (*ptr) = (type##_t *) alloca(__alsa_alloca_size); memset(*ptr, 0, __alsa_alloca_size); } while (0)
 
 _PA_DEFINE_FUNC(snd_pcm_open);
+_PA_DEFINE_FUNC(snd_pcm_open_lconf);
 _PA_DEFINE_FUNC(snd_pcm_close);
 _PA_DEFINE_FUNC(snd_pcm_nonblock);
 _PA_DEFINE_FUNC(snd_pcm_frames_to_bytes);
@@ -106,6 +140,7 @@ _PA_DEFINE_FUNC(snd_pcm_resume);
 _PA_DEFINE_FUNC(snd_pcm_wait);
 _PA_DEFINE_FUNC(snd_pcm_state);
 _PA_DEFINE_FUNC(snd_pcm_avail_update);
+_PA_DEFINE_FUNC(snd_pcm_forward);
 _PA_DEFINE_FUNC(snd_pcm_areas_silence);
 _PA_DEFINE_FUNC(snd_pcm_mmap_begin);
 _PA_DEFINE_FUNC(snd_pcm_mmap_commit);
@@ -116,6 +151,7 @@ _PA_DEFINE_FUNC(snd_pcm_writen);
 _PA_DEFINE_FUNC(snd_pcm_drain);
 _PA_DEFINE_FUNC(snd_pcm_recover);
 _PA_DEFINE_FUNC(snd_pcm_drop);
+_PA_DEFINE_FUNC(snd_pcm_pause);
 _PA_DEFINE_FUNC(snd_pcm_area_copy);
 _PA_DEFINE_FUNC(snd_pcm_poll_descriptors);
 _PA_DEFINE_FUNC(snd_pcm_poll_descriptors_count);
@@ -154,6 +190,7 @@ _PA_DEFINE_FUNC(snd_pcm_hw_params_get_channels_max);
 
 _PA_DEFINE_FUNC(snd_pcm_hw_params_test_period_size);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_test_format);
+_PA_DEFINE_FUNC(snd_pcm_hw_params_test_rate);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_test_access);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_dump);
 _PA_DEFINE_FUNC(snd_pcm_hw_params);
@@ -167,6 +204,8 @@ _PA_DEFINE_FUNC(snd_pcm_hw_params_get_buffer_size_max);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_get_rate_min);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_get_rate_max);
 _PA_DEFINE_FUNC(snd_pcm_hw_params_get_rate_numden);
+_PA_DEFINE_FUNC(snd_pcm_hw_params_set_period_wakeup);
+_PA_DEFINE_FUNC(snd_pcm_hw_params_can_disable_period_wakeup);
 #define alsa_snd_pcm_hw_params_alloca(ptr) __alsa_snd_alloca(ptr, snd_pcm_hw_params)
 
 _PA_DEFINE_FUNC(snd_pcm_sw_params_sizeof);
@@ -204,6 +243,9 @@ _PA_DEFINE_FUNC(snd_ctl_card_info_free);
 _PA_DEFINE_FUNC(snd_ctl_card_info);
 _PA_DEFINE_FUNC(snd_ctl_card_info_sizeof);
 _PA_DEFINE_FUNC(snd_ctl_card_info_get_name);
+_PA_DEFINE_FUNC(snd_ctl_card_info_get_id);
+_PA_DEFINE_FUNC(snd_ctl_card_info_get_driver);
+_PA_DEFINE_FUNC(snd_ctl_card_info_get_longname);
 #define alsa_snd_ctl_card_info_alloca(ptr) __alsa_snd_alloca(ptr, snd_ctl_card_info)
 
 _PA_DEFINE_FUNC(snd_config);
@@ -216,6 +258,11 @@ _PA_DEFINE_FUNC(snd_config_iterator_next);
 _PA_DEFINE_FUNC(snd_config_get_string);
 _PA_DEFINE_FUNC(snd_config_get_id);
 _PA_DEFINE_FUNC(snd_config_update_free_global);
+_PA_DEFINE_FUNC(snd_config_copy);
+_PA_DEFINE_FUNC(snd_config_load);
+_PA_DEFINE_FUNC(snd_config_delete);
+_PA_DEFINE_FUNC(snd_input_buffer_open);
+_PA_DEFINE_FUNC(snd_input_close);
 
 _PA_DEFINE_FUNC(snd_pcm_status);
 _PA_DEFINE_FUNC(snd_pcm_status_sizeof);
@@ -223,6 +270,9 @@ _PA_DEFINE_FUNC(snd_pcm_status_get_tstamp);
 _PA_DEFINE_FUNC(snd_pcm_status_get_state);
 _PA_DEFINE_FUNC(snd_pcm_status_get_trigger_tstamp);
 _PA_DEFINE_FUNC(snd_pcm_status_get_delay);
+_PA_DEFINE_FUNC(snd_pcm_status_get_avail);
+_PA_DEFINE_FUNC(snd_pcm_status_get_htstamp);
+_PA_DEFINE_FUNC(snd_pcm_status_get_audio_htstamp);
 #define alsa_snd_pcm_status_alloca(ptr) __alsa_snd_alloca(ptr, snd_pcm_status)
 
 _PA_DEFINE_FUNC(snd_card_next);
@@ -378,6 +428,7 @@ static int PaAlsa_LoadLibrary()
 #endif
 
     _PA_LOAD_FUNC(snd_pcm_open);
+    _PA_LOAD_FUNC(snd_pcm_open_lconf);
     _PA_LOAD_FUNC(snd_pcm_close);
     _PA_LOAD_FUNC(snd_pcm_nonblock);
     _PA_LOAD_FUNC(snd_pcm_frames_to_bytes);
@@ -387,6 +438,7 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_wait);
     _PA_LOAD_FUNC(snd_pcm_state);
     _PA_LOAD_FUNC(snd_pcm_avail_update);
+    _PA_LOAD_FUNC(snd_pcm_forward);
     _PA_LOAD_FUNC(snd_pcm_areas_silence);
     _PA_LOAD_FUNC(snd_pcm_mmap_begin);
     _PA_LOAD_FUNC(snd_pcm_mmap_commit);
@@ -397,6 +449,7 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_drain);
     _PA_LOAD_FUNC(snd_pcm_recover);
     _PA_LOAD_FUNC(snd_pcm_drop);
+    _PA_LOAD_FUNC(snd_pcm_pause);
     _PA_LOAD_FUNC(snd_pcm_area_copy);
     _PA_LOAD_FUNC(snd_pcm_poll_descriptors);
     _PA_LOAD_FUNC(snd_pcm_poll_descriptors_count);
@@ -435,6 +488,7 @@ static int PaAlsa_LoadLibrary()
 
     _PA_LOAD_FUNC(snd_pcm_hw_params_test_period_size);
     _PA_LOAD_FUNC(snd_pcm_hw_params_test_format);
+    _PA_LOAD_FUNC(snd_pcm_hw_params_test_rate);
     _PA_LOAD_FUNC(snd_pcm_hw_params_test_access);
     _PA_LOAD_FUNC(snd_pcm_hw_params_dump);
     _PA_LOAD_FUNC(snd_pcm_hw_params);
@@ -448,6 +502,8 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_hw_params_get_rate_min);
     _PA_LOAD_FUNC(snd_pcm_hw_params_get_rate_max);
     _PA_LOAD_FUNC(snd_pcm_hw_params_get_rate_numden);
+    _PA_LOAD_FUNC(snd_pcm_hw_params_set_period_wakeup);
+    _PA_LOAD_FUNC(snd_pcm_hw_params_can_disable_period_wakeup);
 
     _PA_LOAD_FUNC(snd_pcm_sw_params_sizeof);
     _PA_LOAD_FUNC(snd_pcm_sw_params_malloc);
@@ -482,6 +538,9 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_ctl_card_info);
     _PA_LOAD_FUNC(snd_ctl_card_info_sizeof);
     _PA_LOAD_FUNC(snd_ctl_card_info_get_name);
+    _PA_LOAD_FUNC(snd_ctl_card_info_get_id);
+    _PA_LOAD_FUNC(snd_ctl_card_info_get_driver);
+    _PA_LOAD_FUNC(snd_ctl_card_info_get_longname);
 
     _PA_LOAD_FUNC(snd_config);
     _PA_LOAD_FUNC(snd_config_update);
@@ -493,6 +552,11 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_config_get_string);
     _PA_LOAD_FUNC(snd_config_get_id);
     _PA_LOAD_FUNC(snd_config_update_free_global);
+    _PA_LOAD_FUNC(snd_config_copy);
+    _PA_LOAD_FUNC(snd_config_load);
+    _PA_LOAD_FUNC(snd_config_delete);
+    _PA_LOAD_FUNC(snd_input_buffer_open);
+    _PA_LOAD_FUNC(snd_input_close);
 
     _PA_LOAD_FUNC(snd_pcm_status);
     _PA_LOAD_FUNC(snd_pcm_status_sizeof);
@@ -500,6 +564,9 @@ static int PaAlsa_LoadLibrary()
     _PA_LOAD_FUNC(snd_pcm_status_get_state);
     _PA_LOAD_FUNC(snd_pcm_status_get_trigger_tstamp);
     _PA_LOAD_FUNC(snd_pcm_status_get_delay);
+    _PA_LOAD_FUNC(snd_pcm_status_get_avail);
+    _PA_LOAD_FUNC(snd_pcm_status_get_htstamp);
+    _PA_LOAD_FUNC(snd_pcm_status_get_audio_htstamp);
 
     _PA_LOAD_FUNC(snd_card_next);
     _PA_LOAD_FUNC(snd_asoundlib_version);
@@ -586,6 +653,7 @@ static void PaAlsa_CloseLibrary()
 
 static int numPeriods_ = 4;
 static int busyRetries_ = 100;
+static const char *deviceCachePath_ = NULL;
 
 int PaAlsa_SetNumPeriods( int numPeriods )
 {
@@ -605,14 +673,21 @@ typedef struct
     int numUserChannels, numHostChannels;
     int userInterleaved, hostInterleaved;
     int canMmap;
-    void *nonMmapBuffer;
+    void *nonMmapBuffer;            /* Without mmap, the host format frames read or written, converted in place */
     unsigned int nonMmapBufferSize;
+    unsigned long nonMmapBufferFrames;  /* The frames nonMmapBuffer holds, a host buffer's worth */
     PaDeviceIndex device;     /* Keep the device index */
     int deviceIsPlug; /* Distinguish plug types from direct 'hw:' devices */
     int useReventFix; /* Alsa older than 1.0.16, plug devices need a fix */
 
     snd_pcm_t *pcm;
     snd_pcm_uframes_t framesPerPeriod, alsaBufferSize;
+    snd_pcm_uframes_t fillLevel; /* The frames a timer scheduled buffer is kept filled with, else 0 */
+    snd_pcm_uframes_t maxFillLevel; /* The fill level an output with paAlsaAutoLatency may rise to, else 0 */
+    snd_pcm_uframes_t wakeLevel; /* The frames queued at which a timer scheduled output is refilled, else 0 for a
+                                    period below the fill level */
+    int runsThroughUnderruns;   /* Is the output kept running on underruns, their frames being skipped? */
+    snd_pcm_uframes_t underrunFrames; /* Frames skipped since the stream last took note of them */
     snd_pcm_format_t nativeFormat;
     unsigned int nfds;
     int ready;  /* Marked ready from poll */
@@ -621,8 +696,36 @@ typedef struct
     StreamDirection streamDir;
 
     snd_pcm_channel_area_t *channelAreas;  /* Needed for channel adaption */
+
+    /* The status of the device, queried once per wakeup of the callback thread (PaAlsaStreamComponent_GetStatus) */
+    snd_pcm_status_t *status;
+    int statusValid;            /* bool: has status been queried since the last wakeup? */
+    PaTime statusTime;          /* The system time of status */
+    PaTime statusDelay;         /* The delay of status in seconds */
+    snd_pcm_uframes_t framesTransferred;  /* Frames read or written since the device was prepared */
+    snd_pcm_uframes_t statusFrames;       /* framesTransferred at the time of status */
+
+    char *fallbackDevice;       /* NULL or the device to reopen the component on when its own goes away (PaAlsaStreamInfo) */
+    int *channelSelectors;      /* NULL or the host channel of each user channel of a capture component (PaAlsaStreamInfo) */
 } PaAlsaStreamComponent;
 
+/* State of a stream serviced by the thread of a PaAlsaCallbackGroup (paAlsaSharedCallbackThread), protected by
+   the mutex of the group */
+typedef struct
+{
+    struct PaAlsaCallbackGroup *group;  /* The group the stream was started in, NULL if it has a thread of its own */
+    struct PaAlsaStream *next;          /* Next stream serviced by the group thread */
+    int running;                        /* bool: is the group thread servicing the stream? */
+    int stopRequested;                  /* bool: has StopStream or AbortStream been called? */
+    int polled;                         /* bool: were the pcms part of the last poll()? */
+    int pollCapture, pollPlayback;      /* bool: which pcms are still waited for? */
+    int pollTimeout;
+    PaTime waitStart;                   /* When the wait for the pcms began */
+    struct pollfd *capturePfds, *playbackPfds;
+    PaStreamCallbackFlags cbFlags;
+    int callbackResult;
+} PaAlsaGroupMember;
+
 /* Implementation specific stream structure */
 typedef struct PaAlsaStream
 {
@@ -637,19 +740,45 @@ typedef struct PaAlsaStream
     int callbackMode;              /* bool: are we running in callback mode? */
     int pcmsSynced;                /* Have we successfully synced pcms */
     int rtSched;
+    int runawayProtection;         /* bool: demote a callback thread running away? (PaAlsa_EnableWatchdog) */
+    int shareCallbackThread;       /* bool: join a callback thread of streams with the same period? (paAlsaSharedCallbackThread) */
+    int timerScheduling;           /* bool: sleep on a timer rather than poll for period wakeups? (paAlsaTimerScheduling) */
+    int autoLatency;               /* bool: raise the output's fill level on underruns? (paAlsaAutoLatency) */
+    int lowPowerOutput;            /* bool: let the output drain before refilling it? (paAlsaLowPowerOutput) */
+    int manualProcessing;          /* bool: is the callback run by Pa_ProcessStream() rather than a thread? (paManualProcessing) */
+    int manualCallbackResult;      /* The last result of the callback of a manually processed stream */
+    PaStreamCallbackFlags manualCbFlags;
+    PaTime waitDeadline;           /* When PaAlsaStream_WaitForFrames gives up on a manually processed stream, else 0 */
+    int waitTimedOut;              /* bool: did the last PaAlsaStream_WaitForFrames end at waitDeadline? */
+    struct PaAlsaHostApiRepresentation *alsaApi;
+    PaAlsaGroupMember member;
+    int *callbackCpus;             /* NULL or the CPUs the callback thread is pinned to (PaAlsaStreamInfo) */
+    int callbackCpuCount;
+    volatile int callbackCpu;      /* The CPU the callback thread last ran on, -1 if not running or unknown */
+    int conversionThreadCount;     /* Threads converting the samples, the callback thread included (PaAlsaStreamInfo) */
+    PaUtilWorkerPool *workerPool;  /* The other conversionThreadCount - 1 threads while started, else NULL */
 
     /* the callback thread uses these to poll the sound device(s), waiting
      * for data to be ready/available */
     struct pollfd* pfds;
     int pollTimeout;
+    int stopFds[2];                /* Pipe interrupting the waits of the callback thread of its own, else -1 */
+    int wokenByStop;               /* bool: did the last PaAlsaStream_WaitForFrames end on the stop pipe? */
 
     /* Used in communication between threads */
     volatile sig_atomic_t callback_finished; /* bool: are we in the "callback finished" state? */
     volatile sig_atomic_t callbackAbort;    /* Drop frames? */
+    volatile sig_atomic_t stopRequested;    /* bool: has StopStream or AbortStream been called? */
     volatile sig_atomic_t isActive;         /* Is stream in active state? (Between StartStream and StopStream || !paContinue) */
-    PaUnixMutex stateMtx;                   /* Used to synchronize access to stream state */
+    int pausedByDrop;                       /* bool: was a paused blocking stream dropped, as its pcms can't pause? */
+    PaUnixMutex stateMtx;                   /* Serializes the restarts of a blocking stream */
 
     int neverDropInput;
+    int zeroCopy;                  /* bool: may the callback work on the host buffers? (paAlsaZeroCopy) */
+    int convertSampleRate;         /* bool: does the callback run at another rate than the device? (paConvertSampleRate) */
+    double hostSampleRate;         /* The rate of the device, streamInfo.sampleRate is the callback's */
+    int independentClocks;         /* bool: are capture and playback serviced separately? (paCompensateClockDrift) */
+    double captureSampleRate;      /* The rate of the capture device, only differs from hostSampleRate if independentClocks */
 
     PaTime underrun;
     PaTime overrun;
@@ -658,8 +787,80 @@ typedef struct PaAlsaStream
 }
 PaAlsaStream;
 
+/* Callback streams with the same period sharing one thread, which polls the pcms of all of them */
+typedef struct PaAlsaCallbackGroup
+{
+    struct PaAlsaCallbackGroup *next;
+    snd_pcm_uframes_t framesPerPeriod;
+    double sampleRate;
+
+    PaUnixThread thread;
+    PaUnixMutex mtx;
+    pthread_cond_t runningChanged;      /* Signalled when streams stop being serviced */
+    int wakeFds[2];                     /* Pipe interrupting the poll() of the thread */
+    int failed;                         /* bool: has the thread quit on an error? */
+
+    int streamCount;                    /* Streams started in the group and not stopped yet */
+    PaAlsaStream *running;              /* The streams being serviced */
+    struct pollfd *pfds;
+    unsigned int pfdsCapacity;
+}
+PaAlsaCallbackGroup;
+
+/* A device list built by BuildDeviceList(), owning the memory of its devices */
+typedef struct
+{
+    PaUtilAllocationGroup *allocations;
+    PaDeviceInfo **deviceInfos;
+    int deviceCount;
+    PaDeviceIndex defaultInputDevice;
+    PaDeviceIndex defaultOutputDevice;
+    char *cachePath;                /* The device cache the list was built with, NULL if disabled */
+}
+PaAlsaDeviceList;
+
+/* Watches /dev/snd for sound cards being added or removed while device change notification is enabled */
+typedef struct
+{
+    int inotifyFd;                  /* -1 while not watching */
+    int devWatch;                   /* Watches /dev for /dev/snd to appear */
+    int sndWatch;                   /* Watches /dev/snd, -1 if it doesn't exist */
+    int stopFds[2];                 /* Written to make the thread stop */
+    int running;                    /* bool: has the thread been started? */
+    PaUnixThread thread;
+}
+PaAlsaDeviceMonitor;
+
 /* PaAlsaHostApiRepresentation - host api datastructure specific to this implementation */
 
+/* The period size negotiated for one direction of a stream, and what it depends on */
+typedef struct
+{
+    PaDeviceIndex device;                   /* paNoDevice if the direction isn't opened */
+    PaSampleFormat hostSampleFormat;
+    int numHostChannels;
+    int hostInterleaved;
+    int canMmap;
+    PaTime suggestedLatency;
+    snd_pcm_uframes_t framesPerPeriod;
+}
+PaAlsaCachedComponentConfig;
+
+/* A configuration PaAlsaStream_DetermineFramesPerBuffer() settled on, keyed by the parameters it depends on once the
+ * hardware parameters' format, channels and rate are set */
+typedef struct
+{
+    int used;
+    unsigned long lastUse;
+    double sampleRate;
+    unsigned long framesPerUserBuffer;
+    unsigned numPeriods;
+    PaAlsaCachedComponentConfig capture, playback;
+    unsigned long maxFramesPerHostBuffer;
+    PaUtilHostBufferSizeMode hostBufferSizeMode;
+}
+PaAlsaCachedConfig;
+
 typedef struct PaAlsaHostApiRepresentation
 {
     PaUtilHostApiRepresentation baseHostApiRep;
@@ -670,6 +871,15 @@ typedef struct PaAlsaHostApiRepresentation
 
     PaHostApiIndex hostApiIndex;
     PaUint32 alsaLibVersion; /* Retrieved from the library at run-time */
+
+    PaAlsaCallbackGroup *callbackGroups;
+    PaUnixMutex callbackGroupsMtx;  /* Guards callbackGroups and the stream counts of the groups */
+
+    PaAlsaDeviceList devices;       /* The device list in use, baseHostApiRep refers to it */
+    PaAlsaDeviceMonitor deviceMonitor;
+
+    PaAlsaCachedConfig configCache[CONFIG_CACHE_SIZE]; /* Negotiated period sizes, cleared with the device list */
+    unsigned long configCacheClock;
 }
 PaAlsaHostApiRepresentation;
 
@@ -680,12 +890,26 @@ typedef struct PaAlsaDeviceInfo
     int isPlug;
     int minInputChannels;
     int minOutputChannels;
+    int fromCache;          /* bool: were the capabilities read from the device cache instead of probed? */
+    int hasCapabilities;    /* bool: has GetDeviceCapabilities() filled in capabilities? */
+    PaDeviceCapabilities capabilities;
+    double inputSampleRates[NUM_STANDARD_SAMPLE_RATES];
+    double outputSampleRates[NUM_STANDARD_SAMPLE_RATES];
 }
 PaAlsaDeviceInfo;
 
 /* prototypes for functions declared in this file */
 
 static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError ScanDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaHostApiIndex index,
+        void **scanResults, int *deviceCount );
+static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaHostApiIndex index,
+        void *scanResults, int deviceCount );
+static PaError DisposeDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, void *scanResults,
+        int deviceCount );
+static PaError EnableDeviceChangeNotification( struct PaUtilHostApiRepresentation *hostApi, int enable );
+static PaError GetDeviceCapabilities( struct PaUtilHostApiRepresentation *hostApi, int device,
+        const PaDeviceCapabilities **capabilities );
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
@@ -701,25 +925,44 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            void *userData );
 static PaError CloseStream( PaStream* stream );
 static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
 static PaError StopStream( PaStream *stream );
 static PaError AbortStream( PaStream *stream );
 static PaError IsStreamStopped( PaStream *s );
 static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaError ProcessStream( PaStream *stream, double timeoutSeconds );
 static PaTime GetStreamTime( PaStream *stream );
 static double GetStreamCpuLoad( PaStream* stream );
-static PaError BuildDeviceList( PaAlsaHostApiRepresentation *hostApi );
+static PaError BuildDeviceList( PaAlsaHostApiRepresentation *hostApi, PaAlsaDeviceList *list );
+static void CommitDeviceList( PaAlsaHostApiRepresentation *hostApi, PaAlsaDeviceList *list );
+static void DisposeDeviceList( PaAlsaDeviceList *list );
 static int SetApproximateSampleRate( snd_pcm_t *pcm, snd_pcm_hw_params_t *hwParams, double sampleRate );
 static int GetExactSampleRate( snd_pcm_hw_params_t *hwParams, double *sampleRate );
 static PaUint32 PaAlsaVersionNum(void);
 
 /* Callback prototypes */
 static void *CallbackThreadFunc( void *userData );
+static void OnExit( void *data );
+static PaError AlsaStop( PaAlsaStream *stream, int abort );
+static PaError PaAlsaCallbackGroup_Join( PaAlsaStream *stream, const PaUnixThreadScheduling *scheduling );
+static PaError PaAlsaCallbackGroup_Leave( PaAlsaStream *stream, int abort );
 
 /* Blocking prototypes */
 static signed long GetStreamReadAvailable( PaStream* s );
 static signed long GetStreamWriteAvailable( PaStream* s );
+static signed long GetStreamMemoryUsage( PaStream* s );
 static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
 static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static PaError ReadStreamV( PaStream* stream, void * const *buffers, const unsigned long *frames,
+        unsigned long bufferCount );
+static PaError ReadStreamTimeout( PaStream* stream, void *buffer, unsigned long frames,
+        unsigned long *framesRead, double timeoutSeconds );
+static PaError WriteStreamTimeout( PaStream* stream, const void *buffer, unsigned long frames,
+        unsigned long *framesWritten, double timeoutSeconds );
+static PaError WriteStreamV( PaStream* stream, const void * const *buffers, const unsigned long *frames,
+        unsigned long bufferCount );
 
 
 static const PaAlsaDeviceInfo *GetDeviceInfo( const PaUtilHostApiRepresentation *hostApi, int device )
@@ -738,6 +981,7 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
 {
     PaError result = paNoError;
     PaAlsaHostApiRepresentation *alsaHostApi = NULL;
+    PaAlsaDeviceList devices;
 
     /* Try loading Alsa library. */
     if (!PaAlsa_LoadLibrary())
@@ -748,6 +992,14 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
     PA_UNLESS( alsaHostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
     alsaHostApi->hostApiIndex = hostApiIndex;
     alsaHostApi->alsaLibVersion = PaAlsaVersionNum();
+    memset( alsaHostApi->configCache, 0, sizeof (alsaHostApi->configCache) );
+    alsaHostApi->configCacheClock = 0;
+    alsaHostApi->callbackGroups = NULL;
+    memset( &alsaHostApi->devices, 0, sizeof (alsaHostApi->devices) );
+    alsaHostApi->deviceMonitor.inotifyFd = -1;
+    alsaHostApi->deviceMonitor.stopFds[0] = alsaHostApi->deviceMonitor.stopFds[1] = -1;
+    alsaHostApi->deviceMonitor.running = 0;
+    PA_ENSURE( PaUnixMutex_Initialize( &alsaHostApi->callbackGroupsMtx ) );
 
     *hostApi = (PaUtilHostApiRepresentation*)alsaHostApi;
     (*hostApi)->info.structVersion = 1;
@@ -757,13 +1009,21 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = ScanDeviceInfos;
+    (*hostApi)->CommitDeviceInfos = CommitDeviceInfos;
+    (*hostApi)->DisposeDeviceInfos = DisposeDeviceInfos;
+    (*hostApi)->EnableDeviceChangeNotification = EnableDeviceChangeNotification;
+    (*hostApi)->GetDeviceCapabilities = GetDeviceCapabilities;
+    (*hostApi)->deviceInfos = NULL;
+    (*hostApi)->info.deviceCount = 0;
 
     /** If AlsaErrorHandler is to be used, do not forget to unregister callback pointer in
         Terminate function.
     */
     /*ENSURE_( snd_lib_error_set_handler(AlsaErrorHandler), paUnanticipatedHostError );*/
 
-    PA_ENSURE( BuildDeviceList( alsaHostApi ) );
+    PA_ENSURE( BuildDeviceList( alsaHostApi, &devices ) );
+    CommitDeviceList( alsaHostApi, &devices );
 
     PaUtil_InitializeStreamInterface( &alsaHostApi->callbackStreamInterface,
                                       CloseStream, StartStream,
@@ -773,6 +1033,10 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
                                       PaUtil_DummyRead, PaUtil_DummyWrite,
                                       PaUtil_DummyGetReadAvailable,
                                       PaUtil_DummyGetWriteAvailable );
+    alsaHostApi->callbackStreamInterface.Pause = PauseStream;
+    alsaHostApi->callbackStreamInterface.Resume = ResumeStream;
+    alsaHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+    alsaHostApi->callbackStreamInterface.Process = ProcessStream;
 
     PaUtil_InitializeStreamInterface( &alsaHostApi->blockingStreamInterface,
                                       CloseStream, StartStream,
@@ -782,6 +1046,12 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
                                       ReadStream, WriteStream,
                                       GetStreamReadAvailable,
                                       GetStreamWriteAvailable );
+    alsaHostApi->blockingStreamInterface.ReadV = ReadStreamV;
+    alsaHostApi->blockingStreamInterface.WriteV = WriteStreamV;
+    alsaHostApi->blockingStreamInterface.ReadTimeout = ReadStreamTimeout;
+    alsaHostApi->blockingStreamInterface.WriteTimeout = WriteStreamTimeout;
+    alsaHostApi->blockingStreamInterface.Pause = PauseStream;
+    alsaHostApi->blockingStreamInterface.Resume = ResumeStream;
 
     PA_ENSURE( PaUnixThreading_Initialize() );
 
@@ -790,6 +1060,7 @@ PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
 error:
     if( alsaHostApi )
     {
+        DisposeDeviceList( &alsaHostApi->devices );
         if( alsaHostApi->allocations )
         {
             PaUtil_FreeAllAllocations( alsaHostApi->allocations );
@@ -812,6 +1083,12 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
     */
     /*snd_lib_error_set_handler(NULL);*/
 
+    /* Every group ends with its last stream */
+    assert( !alsaHostApi->callbackGroups );
+    PaUnixMutex_Terminate( &alsaHostApi->callbackGroupsMtx );
+
+    EnableDeviceChangeNotification( hostApi, 0 );
+    DisposeDeviceList( &alsaHostApi->devices );
     if( alsaHostApi->allocations )
     {
         PaUtil_FreeAllAllocations( alsaHostApi->allocations );
@@ -823,6 +1100,213 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
 
     /* Close Alsa library. */
     PaAlsa_CloseLibrary();
+
+    PaUnixThreading_Terminate();
+}
+
+/* Build a new device list for Pa_RefreshDeviceList(), the streams of the current one keep running meanwhile */
+static PaError ScanDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaHostApiIndex index,
+        void **scanResults, int *deviceCount )
+{
+    PaError result = paNoError;
+    PaAlsaHostApiRepresentation *alsaHostApi = (PaAlsaHostApiRepresentation*)hostApi;
+    PaAlsaDeviceList *list = NULL;
+
+    (void)index;    /* The devices of the list are numbered by pa_front.c */
+
+    /* Have alsa-lib reread its configuration if it changed, so that new plugins are listed */
+    ENSURE_( alsa_snd_config_update(), paUnanticipatedHostError );
+
+    PA_UNLESS( list = (PaAlsaDeviceList *)PaUtil_AllocateMemory( sizeof (PaAlsaDeviceList) ), paInsufficientMemory );
+    PA_ENSURE( BuildDeviceList( alsaHostApi, list ) );
+
+    *scanResults = list;
+    *deviceCount = list->deviceCount;
+
+end:
+    return result;
+
+error:
+    PaUtil_FreeMemory( list );
+    goto end;
+}
+
+static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaHostApiIndex index,
+        void *scanResults, int deviceCount )
+{
+    PaAlsaDeviceList *list = (PaAlsaDeviceList *)scanResults;
+
+    (void)index;
+    (void)deviceCount;
+
+    CommitDeviceList( (PaAlsaHostApiRepresentation*)hostApi, list );
+    PaUtil_FreeMemory( list );
+    return paNoError;
+}
+
+static PaError DisposeDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, void *scanResults,
+        int deviceCount )
+{
+    PaAlsaDeviceList *list = (PaAlsaDeviceList *)scanResults;
+
+    (void)hostApi;
+    (void)deviceCount;
+
+    if( list )
+    {
+        DisposeDeviceList( list );
+        PaUtil_FreeMemory( list );
+    }
+    return paNoError;
+}
+
+#define DEVICE_MONITOR_EVENTS_ (IN_CREATE | IN_DELETE | IN_ATTRIB | IN_ONLYDIR)
+
+/* Handle the events read from the inotify descriptor, return whether the devices of /dev/snd changed */
+static int HandleDeviceMonitorEvents( PaAlsaDeviceMonitor *self, const char *events, ssize_t length )
+{
+    int changed = 0;
+    ssize_t offset;
+
+    for( offset = 0; offset + (ssize_t)sizeof (struct inotify_event) <= length; )
+    {
+        const struct inotify_event *event = (const struct inotify_event *)(events + offset);
+
+        if( event->wd == self->devWatch )
+        {
+            /* The first card creates /dev/snd */
+            if( event->len && !strcmp( event->name, "snd" ) && self->sndWatch < 0 )
+            {
+                self->sndWatch = inotify_add_watch( self->inotifyFd, "/dev/snd", DEVICE_MONITOR_EVENTS_ );
+                changed = 1;
+            }
+        }
+        else if( event->wd == self->sndWatch )
+        {
+            if( event->mask & IN_IGNORED )
+                self->sndWatch = -1;
+            /* A card has a control device, its pcm devices come and go with it */
+            else if( event->len && (!strncmp( event->name, "controlC", 8 ) || !strncmp( event->name, "pcmC", 4 )) )
+                changed = 1;
+        }
+
+        offset += sizeof (struct inotify_event) + event->len;
+    }
+
+    return changed;
+}
+
+/* Report changes of /dev/snd until stopped, once they settled */
+static void *DeviceMonitorThreadFunc( void *userData )
+{
+    PaAlsaHostApiRepresentation *alsaApi = (PaAlsaHostApiRepresentation *)userData;
+    PaAlsaDeviceMonitor *self = &alsaApi->deviceMonitor;
+    struct pollfd pfds[2];
+    union
+    {
+        struct inotify_event align;
+        char buf[4096];
+    } events;
+    int changed = 0, ret;
+    ssize_t length;
+
+    pfds[0].fd = self->inotifyFd;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = self->stopFds[0];
+    pfds[1].events = POLLIN;
+
+    for( ;; )
+    {
+        if( (ret = poll( pfds, 2, changed ? DEVICE_CHANGE_SETTLE_TIME : -1 )) < 0 )
+        {
+            if( EINTR == errno )
+                continue;
+            PA_DEBUG(( "%s: poll failed: %s\n", __FUNCTION__, strerror( errno ) ));
+            break;
+        }
+        if( pfds[1].revents )
+            break;
+
+        if( 0 == ret )
+        {
+            changed = 0;
+            PaUtil_NotifyDeviceChange( &alsaApi->baseHostApiRep );
+        }
+        else if( pfds[0].revents & POLLIN )
+        {
+            while( (length = read( self->inotifyFd, events.buf, sizeof (events.buf) )) > 0 )
+                changed |= HandleDeviceMonitorEvents( self, events.buf, length );
+        }
+    }
+
+    return NULL;
+}
+
+/* Stop the monitor thread and close the descriptors of a monitor */
+static void StopDeviceMonitor( PaAlsaDeviceMonitor *self )
+{
+    char c = 0;
+    int i;
+
+    if( self->running )
+    {
+        if( write( self->stopFds[1], &c, 1 ) < 0 )
+        {
+            /* The pipe is only written to once, it can't be full */
+        }
+        PaUnixThread_Terminate( &self->thread, 1, NULL );
+        self->running = 0;
+    }
+    if( self->inotifyFd >= 0 )
+        close( self->inotifyFd );
+    self->inotifyFd = -1;
+    for( i = 0; i < 2; ++i )
+    {
+        if( self->stopFds[i] >= 0 )
+            close( self->stopFds[i] );
+        self->stopFds[i] = -1;
+    }
+}
+
+/* Sound cards appear and disappear in /dev/snd, watched with inotify on a thread of our own */
+static PaError EnableDeviceChangeNotification( struct PaUtilHostApiRepresentation *hostApi, int enable )
+{
+    PaError result = paNoError;
+    PaAlsaHostApiRepresentation *alsaApi = (PaAlsaHostApiRepresentation*)hostApi;
+    PaAlsaDeviceMonitor *self = &alsaApi->deviceMonitor;
+    int i;
+
+    if( !enable )
+    {
+        StopDeviceMonitor( self );
+        return paNoError;
+    }
+    if( self->running )
+        return paNoError;
+
+    PA_UNLESS( (self->inotifyFd = inotify_init()) >= 0, paInternalError );
+    PA_UNLESS( !pipe( self->stopFds ), paInternalError );
+    for( i = 0; i < 2; ++i )
+    {
+        PA_UNLESS( !fcntl( self->stopFds[i], F_SETFD, FD_CLOEXEC ), paInternalError );
+    }
+    PA_UNLESS( !fcntl( self->inotifyFd, F_SETFL, fcntl( self->inotifyFd, F_GETFL ) | O_NONBLOCK ), paInternalError );
+    PA_UNLESS( !fcntl( self->inotifyFd, F_SETFD, FD_CLOEXEC ), paInternalError );
+
+    /* Watch /dev before /dev/snd, so that it can't appear unnoticed in between */
+    PA_UNLESS( (self->devWatch = inotify_add_watch( self->inotifyFd, "/dev", IN_CREATE | IN_ONLYDIR )) >= 0,
+            paInternalError );
+    self->sndWatch = inotify_add_watch( self->inotifyFd, "/dev/snd", DEVICE_MONITOR_EVENTS_ );
+
+    PA_ENSURE( PaUnixThread_New( &self->thread, &DeviceMonitorThreadFunc, alsaApi, 0., NULL, NULL, 0 ) );
+    self->running = 1;
+
+end:
+    return result;
+
+error:
+    StopDeviceMonitor( self );
+    goto end;
 }
 
 /** Determine max channels and default latencies.
@@ -1042,7 +1526,7 @@ static const HwDevInfo *FindDeviceName( const char *name )
     return NULL;
 }
 
-static PaError PaAlsa_StrDup( PaAlsaHostApiRepresentation *alsaApi,
+static PaError PaAlsa_StrDup( PaUtilAllocationGroup *allocations,
         char **dst,
         const char *src)
 {
@@ -1051,7 +1535,7 @@ static PaError PaAlsa_StrDup( PaAlsaHostApiRepresentation *alsaApi,
 
     /* PA_DEBUG(("PaStrDup %s %d\n", src, len)); */
 
-    PA_UNLESS( *dst = (char *)PaUtil_GroupAllocateMemory( alsaApi->allocations, len ),
+    PA_UNLESS( *dst = (char *)PaUtil_GroupAllocateMemory( allocations, len ),
             paInsufficientMemory );
     strncpy( *dst, src, len );
 
@@ -1118,16 +1602,18 @@ static char *SkipCardDetailsInName( char *infoSkipName, char *cardRefName )
  * @param mode: Open mode (e.g., SND_PCM_BLOCKING).
  * @param waitOnBusy: Retry opening busy device for up to one second?
  **/
-static int OpenPcm( snd_pcm_t **pcmp, const char *name, snd_pcm_stream_t stream, int mode, int waitOnBusy )
+/* Open a PCM, looking its name up in lconf instead of the global configuration if that isn't NULL */
+static int OpenPcm( snd_pcm_t **pcmp, const char *name, snd_config_t *lconf, snd_pcm_stream_t stream, int mode,
+        int waitOnBusy )
 {
     int ret, tries = 0, maxTries = waitOnBusy ? busyRetries_ : 0;
 
-    ret = alsa_snd_pcm_open( pcmp, name, stream, mode );
+    ret = lconf ? alsa_snd_pcm_open_lconf( pcmp, name, stream, mode, lconf ) : alsa_snd_pcm_open( pcmp, name, stream, mode );
 
     for( tries = 0; tries < maxTries && -EBUSY == ret; ++tries )
     {
         Pa_Sleep( 10 );
-        ret = alsa_snd_pcm_open( pcmp, name, stream, mode );
+        ret = lconf ? alsa_snd_pcm_open_lconf( pcmp, name, stream, mode, lconf ) : alsa_snd_pcm_open( pcmp, name, stream, mode );
         if( -EBUSY != ret )
         {
             PA_DEBUG(( "%s: Successfully opened initially busy device after %d tries\n", __FUNCTION__, tries ));
@@ -1146,133 +1632,598 @@ static int OpenPcm( snd_pcm_t **pcmp, const char *name, snd_pcm_stream_t stream,
     return ret;
 }
 
-static PaError FillInDevInfo( PaAlsaHostApiRepresentation *alsaApi, HwDevInfo* deviceHwInfo, int blocking,
-        PaAlsaDeviceInfo* devInfo, int* devIdx )
+/* The device cache
+ *
+ * Probing a device means opening it for each direction and groping its configuration space, which adds up to
+ * seconds with many cards and plugins. The capabilities found are therefore kept in a file and read back by the
+ * next initialization, which only probes devices missing from it. The file starts with a key describing what the
+ * capabilities depend on: the ALSA version, the configuration files and the cards present. It is discarded when
+ * the key doesn't match any more, and removed when a device it describes fails to open, since the device has
+ * gone in a way the key didn't catch.
+ *
+ * Each device is a line with its ALSA name and capabilities, latencies in microseconds and the sample rate in
+ * millihertz, so the file doesn't depend on the locale.
+ */
+
+typedef struct
 {
-    PaError result = 0;
-    PaDeviceInfo *baseDeviceInfo = &devInfo->baseDeviceInfo;
-    snd_pcm_t *pcm = NULL;
-    PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
+    char *text;
+    size_t length;
+    size_t size;
+}
+PaAlsaCacheText;
 
-    PA_DEBUG(( "%s: Filling device info for: %s\n", __FUNCTION__, deviceHwInfo->name ));
+typedef struct
+{
+    const char *path;           /* NULL if the cache is disabled */
+    PaAlsaCacheText key;
+    PaAlsaCacheText entries;    /* The devices to write back */
+    char *contents;             /* The file as read, NULL if missing or stale */
+    int dirty;                  /* bool: were devices probed? */
+}
+PaAlsaDeviceCache;
 
-    /* Zero fields */
-    InitializeDeviceInfo( baseDeviceInfo );
+#define DEVICE_CACHE_VERSION_ 1
 
-    /* To determine device capabilities, we must open the device and query the
-     * hardware parameter configuration space */
+/* The configuration files and directories of ALSA besides those named by ALSA_CONFIG_PATH */
+static const char *deviceCacheConfigPaths_[] = { "/usr/share/alsa/alsa.conf.d", "/usr/share/alsa/cards",
+    "/usr/share/alsa/pcm", "/etc/alsa/conf.d", "/etc/asound.conf", NULL };
 
-    /* Query capture */
-    if( deviceHwInfo->hasCapture &&
-        OpenPcm( &pcm, deviceHwInfo->alsaName, SND_PCM_STREAM_CAPTURE, blocking, 0 ) >= 0 )
+static PaError PaAlsaCacheText_Append( PaAlsaCacheText *self, const char *format, ... )
+{
+    va_list args;
+    int length;
+
+    va_start( args, format );
+    length = vsnprintf( NULL, 0, format, args );
+    va_end( args );
+    if( length < 0 )
+        return paInternalError;
+
+    if( self->length + length + 1 > self->size )
     {
-        if( GropeDevice( pcm, deviceHwInfo->isPlug, StreamDirection_In, blocking, devInfo ) != paNoError )
-        {
-            /* Error */
-            PA_DEBUG(( "%s: Failed groping %s for capture\n", __FUNCTION__, deviceHwInfo->alsaName ));
-            goto end;
-        }
+        size_t size = PA_MAX( 2 * self->size, self->length + length + 1 );
+        char *text = (char *)realloc( self->text, size );
+        if( !text )
+            return paInsufficientMemory;
+        self->text = text;
+        self->size = size;
     }
 
-    /* Query playback */
-    if( deviceHwInfo->hasPlayback &&
-        OpenPcm( &pcm, deviceHwInfo->alsaName, SND_PCM_STREAM_PLAYBACK, blocking, 0 ) >= 0 )
+    va_start( args, format );
+    vsnprintf( self->text + self->length, length + 1, format, args );
+    va_end( args );
+    self->length += length;
+
+    return paNoError;
+}
+
+/* Add a configuration file to the key of the cache, and the files in it if it's a directory */
+static PaError AddConfigToDeviceCacheKey( PaAlsaDeviceCache *self, const char *path, int recurse )
+{
+    PaError result = paNoError;
+    struct stat st;
+    DIR *dir = NULL;
+    struct dirent *entry;
+    char entryPath[PATH_MAX];
+
+    if( stat( path, &st ) < 0 )
+        return PaAlsaCacheText_Append( &self->key, "config %s -\n", path );
+
+    PA_ENSURE( PaAlsaCacheText_Append( &self->key, "config %s %lu %ld %ld\n", path, (unsigned long)st.st_ino,
+                (long)st.st_mtime, (long)st.st_size ) );
+
+    /* The mtime of a directory only changes with its entries, not when they are edited */
+    if( S_ISDIR( st.st_mode ) && recurse && (dir = opendir( path )) )
     {
-        if( GropeDevice( pcm, deviceHwInfo->isPlug, StreamDirection_Out, blocking, devInfo ) != paNoError )
+        while( (entry = readdir( dir )) )
         {
-            /* Error */
-            PA_DEBUG(( "%s: Failed groping %s for playback\n", __FUNCTION__, deviceHwInfo->alsaName ));
-            goto end;
+            if( entry->d_name[0] == '.' )
+                continue;
+            snprintf( entryPath, sizeof (entryPath), "%s/%s", path, entry->d_name );
+            PA_ENSURE( AddConfigToDeviceCacheKey( self, entryPath, 0 ) );
         }
     }
 
-    baseDeviceInfo->structVersion = 2;
-    baseDeviceInfo->hostApi = alsaApi->hostApiIndex;
-    baseDeviceInfo->name = deviceHwInfo->name;
-    devInfo->alsaName = deviceHwInfo->alsaName;
-    devInfo->isPlug = deviceHwInfo->isPlug;
+error:
+    if( dir )
+        closedir( dir );
+    return result;
+}
 
-    /* A: Storing pointer to PaAlsaDeviceInfo object as pointer to PaDeviceInfo object.
-     * Should now be safe to add device info, unless the device supports neither capture nor playback
-     */
-    if( baseDeviceInfo->maxInputChannels > 0 || baseDeviceInfo->maxOutputChannels > 0 )
+/* Begin the key of the cache with the ALSA version and configuration; the cards are added while enumerating them */
+static PaError InitializeDeviceCache( PaAlsaDeviceCache *self, PaAlsaDeviceList *list )
+{
+    PaError result = paNoError;
+    const char *path = getenv( "PA_ALSA_DEVICE_CACHE" ), *configs, *home = getenv( "HOME" );
+    char buf[PATH_MAX];
+    size_t len;
+    int i;
+
+    memset( self, 0, sizeof (*self) );
+
+    /* PA_ALSA_DEVICE_CACHE overrides PaAlsa_SetDeviceCachePath(): 0 disables the cache, 1 selects the default
+     * location, anything else is the path of the file */
+    if( !path )
+        path = deviceCachePath_;
+    else if( !strcmp( path, "0" ) )
+        path = NULL;
+    else if( !strcmp( path, "1" ) )
+        path = "";
+    if( !path )
+        return paNoError;
+
+    if( !*path )
     {
-        /* Make device default if there isn't already one or it is the ALSA "default" device */
-        if( ( baseApi->info.defaultInputDevice == paNoDevice ||
-            !strcmp( deviceHwInfo->alsaName, "default" ) ) && baseDeviceInfo->maxInputChannels > 0 )
-        {
-            baseApi->info.defaultInputDevice = *devIdx;
-            PA_DEBUG(( "Default input device: %s\n", deviceHwInfo->name ));
-        }
-        if( ( baseApi->info.defaultOutputDevice == paNoDevice ||
-            !strcmp( deviceHwInfo->alsaName, "default" ) ) && baseDeviceInfo->maxOutputChannels > 0 )
+        if( getenv( "XDG_CACHE_HOME" ) && *getenv( "XDG_CACHE_HOME" ) )
+            snprintf( buf, sizeof (buf), "%s/portaudio/alsa-devices", getenv( "XDG_CACHE_HOME" ) );
+        else if( home )
+            snprintf( buf, sizeof (buf), "%s/.cache/portaudio/alsa-devices", home );
+        else
+            return paNoError;
+        path = buf;
+    }
+    PA_ENSURE( PaAlsa_StrDup( list->allocations, &list->cachePath, path ) );
+    self->path = list->cachePath;
+    PA_DEBUG(( "%s: Using device cache %s\n", __FUNCTION__, self->path ));
+
+    PA_ENSURE( PaAlsaCacheText_Append( &self->key, "PortAudio ALSA device cache %d\nalsa %s\n", DEVICE_CACHE_VERSION_,
+                alsa_snd_asoundlib_version() ) );
+
+    /* The top level configuration files, as alsa-lib looks them up */
+    configs = getenv( "ALSA_CONFIG_PATH" );
+    if( !configs || !*configs )
+        configs = "/usr/share/alsa/alsa.conf";
+    while( *configs )
+    {
+        len = strcspn( configs, ": " );
+        if( len > 0 && len < sizeof (buf) )
         {
-            baseApi->info.defaultOutputDevice = *devIdx;
-            PA_DEBUG(( "Default output device: %s\n", deviceHwInfo->name ));
+            memcpy( buf, configs, len );
+            buf[len] = '\0';
+            PA_ENSURE( AddConfigToDeviceCacheKey( self, buf, 1 ) );
         }
-        PA_DEBUG(( "%s: Adding device %s: %d\n", __FUNCTION__, deviceHwInfo->name, *devIdx ));
-        baseApi->deviceInfos[*devIdx] = (PaDeviceInfo *) devInfo;
-        (*devIdx) += 1;
+        configs += len;
+        configs += strspn( configs, ": " );
     }
-    else
+
+    for( i = 0; deviceCacheConfigPaths_[i]; ++i )
     {
-        PA_DEBUG(( "%s: Skipped device: %s, all channels == 0\n", __FUNCTION__, deviceHwInfo->name ));
+        PA_ENSURE( AddConfigToDeviceCacheKey( self, deviceCacheConfigPaths_[i], 1 ) );
+    }
+    if( home )
+    {
+        snprintf( buf, sizeof (buf), "%s/.asoundrc", home );
+        PA_ENSURE( AddConfigToDeviceCacheKey( self, buf, 0 ) );
     }
+    if( getenv( "XDG_CONFIG_HOME" ) && *getenv( "XDG_CONFIG_HOME" ) )
+        snprintf( buf, sizeof (buf), "%s/alsa/asoundrc", getenv( "XDG_CONFIG_HOME" ) );
+    else if( home )
+        snprintf( buf, sizeof (buf), "%s/.config/alsa/asoundrc", home );
+    else
+        buf[0] = '\0';
+    if( buf[0] )
+        PA_ENSURE( AddConfigToDeviceCacheKey( self, buf, 0 ) );
 
-end:
+error:
     return result;
 }
 
-/* Build PaDeviceInfo list, ignore devices for which we cannot determine capabilities (possibly busy, sigh) */
-static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
+/* Read the cache, once the key is complete */
+static void ReadDeviceCache( PaAlsaDeviceCache *self )
 {
-    PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
-    PaAlsaDeviceInfo *deviceInfoArray;
-    int cardIdx = -1, devIdx = 0;
-    snd_ctl_card_info_t *cardInfo;
-    PaError result = paNoError;
-    size_t numDeviceNames = 0, maxDeviceNames = 1, i;
-    HwDevInfo *hwDevInfos = NULL;
-    snd_config_t *topNode = NULL;
-    snd_pcm_info_t *pcmInfo;
-    int res;
-    int blocking = SND_PCM_NONBLOCK;
-    int usePlughw = 0;
-    char *hwPrefix = "";
-    char alsaCardName[50];
-#ifdef PA_ENABLE_DEBUG_OUTPUT
-    PaTime startTime = PaUtil_GetTime();
-#endif
+    FILE *file;
+    long size;
+    size_t length;
 
-    if( getenv( "PA_ALSA_INITIALIZE_BLOCK" ) && atoi( getenv( "PA_ALSA_INITIALIZE_BLOCK" ) ) )
-        blocking = 0;
+    if( !self->path || PaAlsaCacheText_Append( &self->key, "\n" ) != paNoError )
+    {
+        self->path = NULL;
+        return;
+    }
+    if( !(file = fopen( self->path, "r" )) )
+        return;
 
-    /* If PA_ALSA_PLUGHW is 1 (non-zero), use the plughw: pcm throughout instead of hw: */
-    if( getenv( "PA_ALSA_PLUGHW" ) && atoi( getenv( "PA_ALSA_PLUGHW" ) ) )
+    if( fseek( file, 0, SEEK_END ) == 0 && (size = ftell( file )) > 0 && fseek( file, 0, SEEK_SET ) == 0 &&
+            (self->contents = (char *)malloc( size + 1 )) )
     {
-        usePlughw = 1;
-        hwPrefix = "plug";
-        PA_DEBUG(( "%s: Using Plughw\n", __FUNCTION__ ));
+        length = fread( self->contents, 1, size, file );
+        self->contents[length] = '\0';
+        if( length < self->key.length || memcmp( self->contents, self->key.text, self->key.length ) )
+        {
+            PA_DEBUG(( "%s: Device cache is stale\n", __FUNCTION__ ));
+            free( self->contents );
+            self->contents = NULL;
+        }
     }
+    fclose( file );
+}
 
-    /* These two will be set to the first working input and output device, respectively */
-    baseApi->info.defaultInputDevice = paNoDevice;
-    baseApi->info.defaultOutputDevice = paNoDevice;
+/* Fill in the capabilities of a device from the cache, returns 0 if it isn't in there */
+static int LookUpDeviceCache( const PaAlsaDeviceCache *self, const char *alsaName, PaAlsaDeviceInfo *devInfo )
+{
+    PaDeviceInfo *baseDeviceInfo = &devInfo->baseDeviceInfo;
+    const char *line, *next;
+    size_t nameLength = strlen( alsaName );
+    int minIn, maxIn, minOut, maxOut;
+    long lowIn, highIn, lowOut, highOut, sampleRate;
 
-    /* Gather info about hw devices
+    if( !self->contents )
+        return 0;
 
-     * alsa_snd_card_next() modifies the integer passed to it to be:
-     *      the index of the first card if the parameter is -1
-     *      the index of the next card if the parameter is the index of a card
-     *      -1 if there are no more cards
-     *
-     * The function itself returns 0 if it succeeded. */
-    cardIdx = -1;
-    alsa_snd_ctl_card_info_alloca( &cardInfo );
-    alsa_snd_pcm_info_alloca( &pcmInfo );
-    while( alsa_snd_card_next( &cardIdx ) == 0 && cardIdx >= 0 )
+    for( line = self->contents + self->key.length; (next = strchr( line, '\n' )); line = next + 1 )
     {
-        char *cardName;
+        if( strncmp( line, alsaName, nameLength ) || line[nameLength] != '\t' )
+            continue;
+        if( sscanf( line + nameLength + 1, "%d %d %d %d %ld %ld %ld %ld %ld", &minIn, &maxIn, &minOut, &maxOut,
+                    &lowIn, &highIn, &lowOut, &highOut, &sampleRate ) != 9 )
+            return 0;
+
+        devInfo->minInputChannels = minIn;
+        baseDeviceInfo->maxInputChannels = maxIn;
+        devInfo->minOutputChannels = minOut;
+        baseDeviceInfo->maxOutputChannels = maxOut;
+        baseDeviceInfo->defaultLowInputLatency = lowIn < 0 ? -1. : lowIn / 1e6;
+        baseDeviceInfo->defaultHighInputLatency = highIn < 0 ? -1. : highIn / 1e6;
+        baseDeviceInfo->defaultLowOutputLatency = lowOut < 0 ? -1. : lowOut / 1e6;
+        baseDeviceInfo->defaultHighOutputLatency = highOut < 0 ? -1. : highOut / 1e6;
+        baseDeviceInfo->defaultSampleRate = sampleRate < 0 ? -1. : sampleRate / 1e3;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Microseconds, or -1 if unknown */
+static long DeviceCacheMicroseconds( double seconds )
+{
+    return seconds < 0. ? -1 : (long)floor( seconds * 1e6 + .5 );
+}
+
+static PaError AddToDeviceCache( PaAlsaDeviceCache *self, const char *alsaName, const PaAlsaDeviceInfo *devInfo )
+{
+    const PaDeviceInfo *baseDeviceInfo = &devInfo->baseDeviceInfo;
+
+    /* Names that would break the line format are probed every time */
+    if( !self->path || strpbrk( alsaName, "\t\n" ) )
+        return paNoError;
+
+    return PaAlsaCacheText_Append( &self->entries, "%s\t%d %d %d %d %ld %ld %ld %ld %ld\n", alsaName,
+            devInfo->minInputChannels, baseDeviceInfo->maxInputChannels,
+            devInfo->minOutputChannels, baseDeviceInfo->maxOutputChannels,
+            DeviceCacheMicroseconds( baseDeviceInfo->defaultLowInputLatency ),
+            DeviceCacheMicroseconds( baseDeviceInfo->defaultHighInputLatency ),
+            DeviceCacheMicroseconds( baseDeviceInfo->defaultLowOutputLatency ),
+            DeviceCacheMicroseconds( baseDeviceInfo->defaultHighOutputLatency ),
+            baseDeviceInfo->defaultSampleRate < 0. ? -1 : (long)floor( baseDeviceInfo->defaultSampleRate * 1e3 + .5 ) );
+}
+
+/* Write the cache if devices were probed, by renaming a new file over it so readers never see half of it */
+static void WriteDeviceCache( PaAlsaDeviceCache *self )
+{
+    char tmpPath[PATH_MAX], *slash;
+    FILE *file;
+    int failed;
+
+    if( !self->path || !self->dirty )
+        return;
+
+    /* Create the directories leading to the file, such as ~/.cache/portaudio */
+    snprintf( tmpPath, sizeof (tmpPath), "%s", self->path );
+    for( slash = strchr( tmpPath + 1, '/' ); slash; slash = strchr( slash + 1, '/' ) )
+    {
+        *slash = '\0';
+        mkdir( tmpPath, 0755 );
+        *slash = '/';
+    }
+
+    snprintf( tmpPath, sizeof (tmpPath), "%s.%ld", self->path, (long)getpid() );
+    if( !(file = fopen( tmpPath, "w" )) )
+    {
+        PA_DEBUG(( "%s: Unable to write device cache %s\n", __FUNCTION__, tmpPath ));
+        return;
+    }
+    failed = fwrite( self->key.text, 1, self->key.length, file ) != self->key.length;
+    if( self->entries.length > 0 )
+        failed |= fwrite( self->entries.text, 1, self->entries.length, file ) != self->entries.length;
+    failed |= fclose( file ) != 0;
+
+    if( failed || rename( tmpPath, self->path ) < 0 )
+    {
+        PA_DEBUG(( "%s: Unable to write device cache %s\n", __FUNCTION__, self->path ));
+        unlink( tmpPath );
+    }
+}
+
+static void TerminateDeviceCache( PaAlsaDeviceCache *self )
+{
+    free( self->key.text );
+    free( self->entries.text );
+    free( self->contents );
+}
+
+/* Determine the capabilities of a device by opening it. Fails if groping the device fails; *cacheable is cleared if
+ * the capabilities found aren't worth caching, as the device was busy */
+static PaError ProbeDevice( const HwDevInfo* deviceHwInfo, int blocking, int waitOnBusy, PaAlsaDeviceInfo* devInfo,
+        int *cacheable )
+{
+    PaError result = paNoError;
+    snd_pcm_t *pcm = NULL;
+    int ret;
+
+    *cacheable = 1;
+
+    /* To determine device capabilities, we must open the device and query the
+     * hardware parameter configuration space */
+
+    /* Query capture */
+    if( deviceHwInfo->hasCapture )
+    {
+        if( (ret = OpenPcm( &pcm, deviceHwInfo->alsaName, NULL, SND_PCM_STREAM_CAPTURE, blocking, waitOnBusy )) >= 0 )
+        {
+            if( (result = GropeDevice( pcm, deviceHwInfo->isPlug, StreamDirection_In, blocking, devInfo )) != paNoError )
+            {
+                /* Error */
+                PA_DEBUG(( "%s: Failed groping %s for capture\n", __FUNCTION__, deviceHwInfo->alsaName ));
+                return result;
+            }
+        }
+        else if( -EBUSY == ret )
+            *cacheable = 0;
+    }
+
+    /* Query playback */
+    if( deviceHwInfo->hasPlayback )
+    {
+        if( (ret = OpenPcm( &pcm, deviceHwInfo->alsaName, NULL, SND_PCM_STREAM_PLAYBACK, blocking, waitOnBusy )) >= 0 )
+        {
+            if( (result = GropeDevice( pcm, deviceHwInfo->isPlug, StreamDirection_Out, blocking, devInfo )) != paNoError )
+            {
+                /* Error */
+                PA_DEBUG(( "%s: Failed groping %s for playback\n", __FUNCTION__, deviceHwInfo->alsaName ));
+                return result;
+            }
+        }
+        else if( -EBUSY == ret )
+            *cacheable = 0;
+    }
+
+    return result;
+}
+
+/* The outcome of finding the capabilities of a device */
+typedef struct
+{
+    PaError result;     /* The device is skipped if this isn't paNoError */
+    int cacheable;      /* bool: are the capabilities worth caching? */
+}
+PaAlsaProbeResult;
+
+/* Devices with capabilities to find, in the range [begin, end) of hwDevInfos */
+typedef struct
+{
+    const HwDevInfo *hwDevInfos;
+    PaAlsaDeviceInfo *deviceInfos;
+    PaAlsaProbeResult *results;
+    size_t begin, end;
+    int probedLast;     /* bool: find those of 'dmix' and 'default' instead of the others? */
+    int blocking;
+    int waitOnBusy;     /* bool: retry opening busy devices, others are being probed concurrently */
+    const PaAlsaDeviceCache *cache;
+}
+PaAlsaProbeJob;
+
+/* The 'dmix' plugin may cause the underlying hardware device to be busy for a short while even after it (dmix) is
+ * closed, and the 'default' plugin may point to it, so they are probed after the other devices */
+static int IsProbedLast( const HwDevInfo *deviceHwInfo )
+{
+    return !strcmp( deviceHwInfo->name, "dmix" ) || !strcmp( deviceHwInfo->name, "default" );
+}
+
+/* Fill in the capabilities of every workerCount'th device of a job, from the cache or by probing it */
+static void ProbeDevicesJob( void *userData, int worker, int workerCount )
+{
+    PaAlsaProbeJob *job = (PaAlsaProbeJob *)userData;
+    size_t i;
+
+    for( i = job->begin + worker; i < job->end; i += workerCount )
+    {
+        const HwDevInfo *deviceHwInfo = &job->hwDevInfos[i];
+        PaAlsaDeviceInfo *devInfo = &job->deviceInfos[i];
+        PaAlsaProbeResult *result = &job->results[i];
+
+        if( IsProbedLast( deviceHwInfo ) != job->probedLast )
+            continue;
+
+        PA_DEBUG(( "%s: Filling device info for: %s\n", __FUNCTION__, deviceHwInfo->name ));
+
+        /* Zero fields */
+        InitializeDeviceInfo( &devInfo->baseDeviceInfo );
+        devInfo->minInputChannels = 0;
+        devInfo->minOutputChannels = 0;
+        devInfo->hasCapabilities = 0;
+
+        /* Devices found in the cache aren't opened; those unable to open now fail once they're used */
+        if( (devInfo->fromCache = LookUpDeviceCache( job->cache, deviceHwInfo->alsaName, devInfo )) )
+        {
+            PA_DEBUG(( "%s: Found %s in device cache\n", __FUNCTION__, deviceHwInfo->alsaName ));
+            result->result = paNoError;
+            result->cacheable = 1;
+        }
+        else
+        {
+            result->result = ProbeDevice( deviceHwInfo, job->blocking, job->waitOnBusy, devInfo, &result->cacheable );
+        }
+    }
+}
+
+/* A device busy while the list is rebuilt is most likely held by a stream of ours, take over what the previous list
+ * knew about it */
+static void KeepPreviousCapabilities( const PaAlsaDeviceList *previous, const char *alsaName, PaAlsaDeviceInfo* devInfo )
+{
+    int i;
+
+    for( i = 0; i < previous->deviceCount; ++i )
+    {
+        const PaAlsaDeviceInfo *previousInfo = (const PaAlsaDeviceInfo *)previous->deviceInfos[i];
+
+        if( !strcmp( previousInfo->alsaName, alsaName ) )
+        {
+            PA_DEBUG(( "%s: Keeping the capabilities of busy device %s\n", __FUNCTION__, alsaName ));
+            devInfo->baseDeviceInfo = previousInfo->baseDeviceInfo;
+            devInfo->minInputChannels = previousInfo->minInputChannels;
+            devInfo->minOutputChannels = previousInfo->minOutputChannels;
+            return;
+        }
+    }
+}
+
+/* Add a device to the device list once its capabilities are known */
+static PaError FillInDevInfo( PaAlsaHostApiRepresentation *alsaApi, PaAlsaDeviceList *list,
+        const PaAlsaDeviceList *previous, const HwDevInfo* deviceHwInfo,
+        const PaAlsaProbeResult *probeResult, PaAlsaDeviceCache *cache, PaAlsaDeviceInfo* devInfo, int* devIdx )
+{
+    PaError result = 0;
+    PaDeviceInfo *baseDeviceInfo = &devInfo->baseDeviceInfo;
+
+    if( !devInfo->fromCache )
+        cache->dirty = 1;
+    if( probeResult->result != paNoError )
+        goto end;
+    if( probeResult->cacheable )
+    {
+        PA_ENSURE( AddToDeviceCache( cache, deviceHwInfo->alsaName, devInfo ) );
+    }
+    else if( !devInfo->fromCache )
+        KeepPreviousCapabilities( previous, deviceHwInfo->alsaName, devInfo );
+
+    baseDeviceInfo->structVersion = 2;
+    baseDeviceInfo->hostApi = alsaApi->hostApiIndex;
+    baseDeviceInfo->name = deviceHwInfo->name;
+    devInfo->alsaName = deviceHwInfo->alsaName;
+    devInfo->isPlug = deviceHwInfo->isPlug;
+
+    /* A: Storing pointer to PaAlsaDeviceInfo object as pointer to PaDeviceInfo object.
+     * Should now be safe to add device info, unless the device supports neither capture nor playback
+     */
+    if( baseDeviceInfo->maxInputChannels > 0 || baseDeviceInfo->maxOutputChannels > 0 )
+    {
+        /* Make device default if there isn't already one or it is the ALSA "default" device */
+        if( ( list->defaultInputDevice == paNoDevice ||
+            !strcmp( deviceHwInfo->alsaName, "default" ) ) && baseDeviceInfo->maxInputChannels > 0 )
+        {
+            list->defaultInputDevice = *devIdx;
+            PA_DEBUG(( "Default input device: %s\n", deviceHwInfo->name ));
+        }
+        if( ( list->defaultOutputDevice == paNoDevice ||
+            !strcmp( deviceHwInfo->alsaName, "default" ) ) && baseDeviceInfo->maxOutputChannels > 0 )
+        {
+            list->defaultOutputDevice = *devIdx;
+            PA_DEBUG(( "Default output device: %s\n", deviceHwInfo->name ));
+        }
+        PA_DEBUG(( "%s: Adding device %s: %d\n", __FUNCTION__, deviceHwInfo->name, *devIdx ));
+        list->deviceInfos[*devIdx] = (PaDeviceInfo *) devInfo;
+        (*devIdx) += 1;
+    }
+    else
+    {
+        PA_DEBUG(( "%s: Skipped device: %s, all channels == 0\n", __FUNCTION__, deviceHwInfo->name ));
+    }
+
+end:
+    return result;
+
+error:
+    goto end;
+}
+
+/* Free the memory of a device list */
+static void DisposeDeviceList( PaAlsaDeviceList *list )
+{
+    if( list->allocations )
+    {
+        PaUtil_FreeAllAllocations( list->allocations );
+        PaUtil_DestroyAllocationGroup( list->allocations );
+    }
+    memset( list, 0, sizeof (*list) );
+}
+
+/* Make a device list built by BuildDeviceList() the one in use, disposing the previous one */
+static void CommitDeviceList( PaAlsaHostApiRepresentation *alsaApi, PaAlsaDeviceList *list )
+{
+    PaUtilHostApiRepresentation *baseApi = &alsaApi->baseHostApiRep;
+
+    DisposeDeviceList( &alsaApi->devices );
+    alsaApi->devices = *list;
+    /* The device indices of the cached configurations may refer to other devices now */
+    memset( alsaApi->configCache, 0, sizeof (alsaApi->configCache) );
+    baseApi->deviceInfos = list->deviceInfos;
+    baseApi->info.deviceCount = list->deviceCount;
+    baseApi->info.defaultInputDevice = list->defaultInputDevice;
+    baseApi->info.defaultOutputDevice = list->defaultOutputDevice;
+}
+
+/* Build PaDeviceInfo list, ignore devices for which we cannot determine capabilities (possibly busy, sigh). The list
+ * in use is left alone, devices it has which are busy now keep their capabilities in the new one */
+static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi, PaAlsaDeviceList *list )
+{
+    PaAlsaDeviceInfo *deviceInfoArray;
+    int cardIdx = -1, devIdx = 0;
+    snd_ctl_card_info_t *cardInfo;
+    PaError result = paNoError;
+    size_t numDeviceNames = 0, maxDeviceNames = 1, i;
+    HwDevInfo *hwDevInfos = NULL;
+    snd_config_t *topNode = NULL;
+    snd_pcm_info_t *pcmInfo;
+    int res;
+    int blocking = SND_PCM_NONBLOCK;
+    int usePlughw = 0;
+    char *hwPrefix = "";
+    char alsaCardName[50];
+    PaAlsaDeviceCache cache;
+    size_t numHwDeviceNames;
+    PaAlsaProbeResult *probeResults = NULL;
+    PaAlsaProbeJob job;
+    PaUtilWorkerPool *pool = NULL;
+    int threadCount;
+#ifdef PA_ENABLE_DEBUG_OUTPUT
+    PaTime startTime = PaUtil_GetTime();
+#endif
+
+    if( getenv( "PA_ALSA_INITIALIZE_BLOCK" ) && atoi( getenv( "PA_ALSA_INITIALIZE_BLOCK" ) ) )
+        blocking = 0;
+
+    /* If PA_ALSA_PLUGHW is 1 (non-zero), use the plughw: pcm throughout instead of hw: */
+    if( getenv( "PA_ALSA_PLUGHW" ) && atoi( getenv( "PA_ALSA_PLUGHW" ) ) )
+    {
+        usePlughw = 1;
+        hwPrefix = "plug";
+        PA_DEBUG(( "%s: Using Plughw\n", __FUNCTION__ ));
+    }
+
+    memset( list, 0, sizeof (*list) );
+    memset( &cache, 0, sizeof (cache) );
+    PA_UNLESS( list->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    PA_ENSURE( InitializeDeviceCache( &cache, list ) );
+
+    /* These two will be set to the first working input and output device, respectively */
+    list->defaultInputDevice = paNoDevice;
+    list->defaultOutputDevice = paNoDevice;
+
+    /* Gather info about hw devices
+
+     * alsa_snd_card_next() modifies the integer passed to it to be:
+     *      the index of the first card if the parameter is -1
+     *      the index of the next card if the parameter is the index of a card
+     *      -1 if there are no more cards
+     *
+     * The function itself returns 0 if it succeeded. */
+    cardIdx = -1;
+    alsa_snd_ctl_card_info_alloca( &cardInfo );
+    alsa_snd_pcm_info_alloca( &pcmInfo );
+    while( alsa_snd_card_next( &cardIdx ) == 0 && cardIdx >= 0 )
+    {
+        char *cardName;
         int devIdx = -1;
         snd_ctl_t *ctl;
         char buf[50];
@@ -1287,8 +2238,14 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
             continue;
         }
         alsa_snd_ctl_card_info( ctl, cardInfo );
+        if( cache.path )
+        {
+            PA_ENSURE( PaAlsaCacheText_Append( &cache.key, "card %d %s %s %s\n", cardIdx,
+                        alsa_snd_ctl_card_info_get_id( cardInfo ), alsa_snd_ctl_card_info_get_driver( cardInfo ),
+                        alsa_snd_ctl_card_info_get_longname( cardInfo ) ) );
+        }
 
-        PA_ENSURE( PaAlsa_StrDup( alsaApi, &cardName, alsa_snd_ctl_card_info_get_name( cardInfo )) );
+        PA_ENSURE( PaAlsa_StrDup( list->allocations, &cardName, alsa_snd_ctl_card_info_get_name( cardInfo )) );
 
         while( alsa_snd_ctl_pcm_next_device( ctl, &devIdx ) == 0 && devIdx >= 0 )
         {
@@ -1323,7 +2280,7 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
 
             /* The length of the string written by snprintf plus terminating 0 */
             len = snprintf( NULL, 0, "%s: %s (%s)", cardName, infoName, buf ) + 1;
-            PA_UNLESS( deviceName = (char *)PaUtil_GroupAllocateMemory( alsaApi->allocations, len ),
+            PA_UNLESS( deviceName = (char *)PaUtil_GroupAllocateMemory( list->allocations, len ),
                     paInsufficientMemory );
             snprintf( deviceName, len, "%s: %s (%s)", cardName, infoName, buf );
 
@@ -1335,7 +2292,7 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
                         paInsufficientMemory );
             }
 
-            PA_ENSURE( PaAlsa_StrDup( alsaApi, &alsaDeviceName, buf ) );
+            PA_ENSURE( PaAlsa_StrDup( list->allocations, &alsaDeviceName, buf ) );
 
             hwDevInfos[ numDeviceNames - 1 ].alsaName = alsaDeviceName;
             hwDevInfos[ numDeviceNames - 1 ].name = deviceName;
@@ -1345,6 +2302,7 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
         }
         alsa_snd_ctl_close( ctl );
     }
+    numHwDeviceNames = numDeviceNames;
 
     /* Iterate over plugin devices */
     if( NULL == (*alsa_snd_config) )
@@ -1386,10 +2344,10 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
             }
             PA_DEBUG(( "%s: Found plugin [%s] of type [%s]\n", __FUNCTION__, idStr, tpStr ));
 
-            PA_UNLESS( alsaDeviceName = (char*)PaUtil_GroupAllocateMemory( alsaApi->allocations,
+            PA_UNLESS( alsaDeviceName = (char*)PaUtil_GroupAllocateMemory( list->allocations,
                                                             strlen(idStr) + 6 ), paInsufficientMemory );
             strcpy( alsaDeviceName, idStr );
-            PA_UNLESS( deviceName = (char*)PaUtil_GroupAllocateMemory( alsaApi->allocations,
+            PA_UNLESS( deviceName = (char*)PaUtil_GroupAllocateMemory( list->allocations,
                                                             strlen(idStr) + 1 ), paInsufficientMemory );
             strcpy( deviceName, idStr );
 
@@ -1423,12 +2381,16 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
         PA_DEBUG(( "%s: Iterating over ALSA plugins failed: %s\n", __FUNCTION__, alsa_snd_strerror( res ) ));
 
     /* allocate deviceInfo memory based on the number of devices */
-    PA_UNLESS( baseApi->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory(
-            alsaApi->allocations, sizeof(PaDeviceInfo*) * (numDeviceNames) ), paInsufficientMemory );
+    PA_UNLESS( list->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory(
+            list->allocations, sizeof(PaDeviceInfo*) * (numDeviceNames) ), paInsufficientMemory );
 
     /* allocate all device info structs in a contiguous block */
     PA_UNLESS( deviceInfoArray = (PaAlsaDeviceInfo*)PaUtil_GroupAllocateMemory(
-            alsaApi->allocations, sizeof(PaAlsaDeviceInfo) * numDeviceNames ), paInsufficientMemory );
+            list->allocations, sizeof(PaAlsaDeviceInfo) * numDeviceNames ), paInsufficientMemory );
+
+    PA_UNLESS( probeResults = (PaAlsaProbeResult *)malloc( sizeof (PaAlsaProbeResult) * numDeviceNames ),
+            paInsufficientMemory );
+    ReadDeviceCache( &cache );
 
     /* Loop over list of cards, filling in info. If a device is deemed unavailable (can't get name),
      * it's ignored.
@@ -1437,80 +2399,238 @@ static PaError BuildDeviceList( PaAlsaHostApiRepresentation *alsaApi )
      * plugin may cause the underlying hardware device to be busy for a short while even after it
      * (dmix) is closed. The 'default' plugin may also point to the dmix plugin, so the same goes
      * for this.
+     *
+     * The hardware devices are independent of each other, so they are probed on several threads if
+     * Pa_Initialize() may use them. Plugins may share hardware with them and each other, so they
+     * follow in turn.
      */
     PA_DEBUG(( "%s: Filling device info for %d devices\n", __FUNCTION__, numDeviceNames ));
+    job.hwDevInfos = hwDevInfos;
+    job.deviceInfos = deviceInfoArray;
+    job.results = probeResults;
+    job.begin = 0;
+    job.end = numHwDeviceNames;
+    job.probedLast = 0;
+    job.blocking = blocking;
+    job.waitOnBusy = 1;
+    job.cache = &cache;
+    threadCount = PA_MIN( PaUtil_GetInitializationThreadCount(), (int)numHwDeviceNames );
+    if( threadCount > 1 && PaUtil_CreateWorkerPool( &pool, threadCount, 0, NULL, 0 ) == paNoError )
+    {
+        PaUtil_RunWorkerPool( pool, ProbeDevicesJob, &job );
+        PaUtil_DestroyWorkerPool( pool );
+        job.begin = numHwDeviceNames;
+    }
+    job.end = numDeviceNames;
+    job.waitOnBusy = 0;
+    ProbeDevicesJob( &job, 0, 1 );
+
     for( i = 0, devIdx = 0; i < numDeviceNames; ++i )
     {
-        PaAlsaDeviceInfo* devInfo = &deviceInfoArray[i];
-        HwDevInfo* hwInfo = &hwDevInfos[i];
-        if( !strcmp( hwInfo->name, "dmix" ) || !strcmp( hwInfo->name, "default" ) )
-        {
-            continue;
-        }
-
-        PA_ENSURE( FillInDevInfo( alsaApi, hwInfo, blocking, devInfo, &devIdx ) );
+        if( !IsProbedLast( &hwDevInfos[i] ) )
+            PA_ENSURE( FillInDevInfo( alsaApi, list, &alsaApi->devices, &hwDevInfos[i], &probeResults[i], &cache, &deviceInfoArray[i], &devIdx ) );
     }
     assert( devIdx < numDeviceNames );
     /* Now inspect 'dmix' and 'default' plugins */
+    job.begin = 0;
+    job.probedLast = 1;
+    ProbeDevicesJob( &job, 0, 1 );
     for( i = 0; i < numDeviceNames; ++i )
     {
-        PaAlsaDeviceInfo* devInfo = &deviceInfoArray[i];
-        HwDevInfo* hwInfo = &hwDevInfos[i];
-        if( strcmp( hwInfo->name, "dmix" ) && strcmp( hwInfo->name, "default" ) )
-        {
-            continue;
-        }
-
-        PA_ENSURE( FillInDevInfo( alsaApi, hwInfo, blocking, devInfo, &devIdx ) );
+        if( IsProbedLast( &hwDevInfos[i] ) )
+            PA_ENSURE( FillInDevInfo( alsaApi, list, &alsaApi->devices, &hwDevInfos[i], &probeResults[i], &cache, &deviceInfoArray[i], &devIdx ) );
     }
-    free( hwDevInfos );
+    WriteDeviceCache( &cache );
 
-    baseApi->info.deviceCount = devIdx;   /* Number of successfully queried devices */
+    list->deviceCount = devIdx;   /* Number of successfully queried devices */
 
 #ifdef PA_ENABLE_DEBUG_OUTPUT
     PA_DEBUG(( "%s: Building device list took %f seconds\n", __FUNCTION__, PaUtil_GetTime() - startTime ));
 #endif
 
 end:
+    free( hwDevInfos );
+    free( probeResults );
+    TerminateDeviceCache( &cache );
     return result;
 
 error:
-    /* No particular action */
+    DisposeDeviceList( list );
     goto end;
 }
 
+/* The size of a version 1 PaAlsaStreamInfo, which ended with deviceString */
+#define PA_ALSA_STREAM_INFO_V1_SIZE_ (offsetof( PaAlsaStreamInfo, channelMatrix ))
+#define PA_ALSA_STREAM_INFO_V2_SIZE_ (offsetof( PaAlsaStreamInfo, callbackCpus ))
+#define PA_ALSA_STREAM_INFO_V3_SIZE_ (offsetof( PaAlsaStreamInfo, conversionThreadCount ))
+#define PA_ALSA_STREAM_INFO_V4_SIZE_ (offsetof( PaAlsaStreamInfo, fallbackDeviceString ))
+#define PA_ALSA_STREAM_INFO_V5_SIZE_ (offsetof( PaAlsaStreamInfo, aggregateDevices ))
+#define PA_ALSA_STREAM_INFO_V6_SIZE_ (offsetof( PaAlsaStreamInfo, channelSelectors ))
+
+/* The name the PCM combining the devices of an aggregate stream is defined with, see OpenAggregatePcm() */
+#define AGGREGATE_PCM_NAME "portaudio_aggregate"
+
+/* The device string of a stream's PaAlsaStreamInfo, NULL if the device is given by its index */
+static const char *GetDeviceString( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo ? streamInfo->deviceString : NULL;
+}
+
+/* The channel matrix of a stream's PaAlsaStreamInfo, NULL if the device has the stream's channels */
+static const PaChannelMatrix *GetChannelMatrix( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo && streamInfo->version >= 2 ? streamInfo->channelMatrix : NULL;
+}
+
+/* The CPUs a stream's PaAlsaStreamInfo pins the callback thread to, NULL if any will do */
+static const int *GetCallbackCpus( const PaStreamParameters *parameters, int *cpuCount )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters ? parameters->hostApiSpecificStreamInfo : NULL;
+
+    *cpuCount = 0;
+    if( !streamInfo || streamInfo->version < 3 || streamInfo->callbackCpuCount <= 0 )
+        return NULL;
+
+    *cpuCount = streamInfo->callbackCpuCount;
+    return streamInfo->callbackCpus;
+}
+
+/* The number of threads a stream's PaAlsaStreamInfo asks to convert the samples with, 1 by default */
+static int GetConversionThreadCount( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters ? parameters->hostApiSpecificStreamInfo : NULL;
+
+    if( !streamInfo || streamInfo->version < 4 || streamInfo->conversionThreadCount < 1 )
+        return 1;
+    return streamInfo->conversionThreadCount;
+}
+
+/* The device a stream's PaAlsaStreamInfo has the stream fail over to, NULL if there is none */
+static const char *GetFallbackDeviceString( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo && streamInfo->version >= 5 ? streamInfo->fallbackDeviceString : NULL;
+}
+
+/* The devices a stream's PaAlsaStreamInfo combines into one, NULL if it doesn't aggregate devices */
+static const PaAlsaAggregateDevice *GetAggregateDevices( const PaStreamParameters *parameters, int *deviceCount )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+
+    *deviceCount = 0;
+    if( !streamInfo || streamInfo->version < 6 || streamInfo->aggregateDeviceCount <= 0 )
+        return NULL;
+
+    *deviceCount = streamInfo->aggregateDeviceCount;
+    return streamInfo->aggregateDevices;
+}
+
+/* The device channels a stream's PaAlsaStreamInfo selects for its channels, NULL if they are the first ones */
+static const int *GetChannelSelectors( const PaStreamParameters *parameters )
+{
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+    return streamInfo && streamInfo->version >= 7 ? streamInfo->channelSelectors : NULL;
+}
+
+/* The number of channels the device is to be opened with, before adapting to its minimum */
+static int GetDeviceChannelCount( const PaStreamParameters *parameters )
+{
+    const PaChannelMatrix *channelMatrix = GetChannelMatrix( parameters );
+    const int *channelSelectors = GetChannelSelectors( parameters );
+    int i, channelCount = 0;
+
+    if( channelMatrix )
+        return channelMatrix->deviceChannelCount;
+    if( !channelSelectors )
+        return parameters->channelCount;
+
+    /* Up to the highest channel selected */
+    for( i = 0; i < parameters->channelCount; ++i )
+        channelCount = PA_MAX( channelCount, channelSelectors[i] + 1 );
+    return channelCount;
+}
+
 /* Check against known device capabilities */
 static PaError ValidateParameters( const PaStreamParameters *parameters, PaUtilHostApiRepresentation *hostApi, StreamDirection mode )
 {
     PaError result = paNoError;
     int maxChans;
     const PaAlsaDeviceInfo *deviceInfo = NULL;
+    const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
     assert( parameters );
 
-    if( parameters->device != paUseHostApiSpecificDeviceSpecification )
-    {
-        assert( parameters->device < hostApi->info.deviceCount );
-        PA_UNLESS( parameters->hostApiSpecificStreamInfo == NULL, paBadIODeviceCombination );
-        deviceInfo = GetDeviceInfo( hostApi, parameters->device );
-    }
-    else
+    if( streamInfo )
     {
-        const PaAlsaStreamInfo *streamInfo = parameters->hostApiSpecificStreamInfo;
+        const int *cpus, *selectors;
+        const PaAlsaAggregateDevice *devices;
+        int cpuCount, deviceCount, i;
 
-        PA_UNLESS( parameters->device == paUseHostApiSpecificDeviceSpecification, paInvalidDevice );
-        PA_UNLESS( streamInfo->size == sizeof (PaAlsaStreamInfo) && streamInfo->version == 1,
+        PA_UNLESS( ( streamInfo->size == PA_ALSA_STREAM_INFO_V1_SIZE_ && streamInfo->version == 1 )
+                || ( streamInfo->size == PA_ALSA_STREAM_INFO_V2_SIZE_ && streamInfo->version == 2 )
+                || ( streamInfo->size == PA_ALSA_STREAM_INFO_V3_SIZE_ && streamInfo->version == 3 )
+                || ( streamInfo->size == PA_ALSA_STREAM_INFO_V4_SIZE_ && streamInfo->version == 4 )
+                || ( streamInfo->size == PA_ALSA_STREAM_INFO_V5_SIZE_ && streamInfo->version == 5 )
+                || ( streamInfo->size == PA_ALSA_STREAM_INFO_V6_SIZE_ && streamInfo->version == 6 )
+                || ( streamInfo->size == sizeof (PaAlsaStreamInfo) && streamInfo->version == 7 ),
                 paIncompatibleHostApiSpecificStreamInfo );
-        PA_UNLESS( streamInfo->deviceString != NULL, paInvalidDevice );
 
-        /* Skip further checking */
-        return paNoError;
-    }
+        selectors = GetChannelSelectors( parameters );
+        if( selectors )
+        {
+            PA_UNLESS( StreamDirection_In == mode && !GetChannelMatrix( parameters ),
+                    paIncompatibleHostApiSpecificStreamInfo );
+            for( i = 0; i < parameters->channelCount; ++i )
+                PA_UNLESS( selectors[i] >= 0, paInvalidChannelCount );
+        }
+        PA_UNLESS( GetDeviceChannelCount( parameters ) > 0, paInvalidChannelCount );
+
+        cpus = GetCallbackCpus( parameters, &cpuCount );
+        PA_UNLESS( !cpuCount || cpus, paIncompatibleHostApiSpecificStreamInfo );
+        for( i = 0; i < cpuCount; ++i )
+            PA_UNLESS( cpus[i] >= 0 && cpus[i] < sysconf( _SC_NPROCESSORS_CONF ), paIncompatibleHostApiSpecificStreamInfo );
+
+        devices = GetAggregateDevices( parameters, &deviceCount );
+        PA_UNLESS( !deviceCount || devices, paIncompatibleHostApiSpecificStreamInfo );
+        if( devices )
+        {
+            int channelCount = 0;
+
+            PA_UNLESS( parameters->device == paUseHostApiSpecificDeviceSpecification && !streamInfo->deviceString,
+                    paBadIODeviceCombination );
+            for( i = 0; i < deviceCount; ++i )
+            {
+                PA_UNLESS( devices[i].deviceString && devices[i].channelCount > 0, paIncompatibleHostApiSpecificStreamInfo );
+                channelCount += devices[i].channelCount;
+            }
+            PA_UNLESS( channelCount == GetDeviceChannelCount( parameters ), paInvalidChannelCount );
+
+            /* Skip further checking, as for a device string */
+            return paNoError;
+        }
+    }
+
+    if( parameters->device != paUseHostApiSpecificDeviceSpecification )
+    {
+        assert( parameters->device < hostApi->info.deviceCount );
+        /* Only a stream info without a device string may accompany a device index */
+        PA_UNLESS( GetDeviceString( parameters ) == NULL, paBadIODeviceCombination );
+        PA_UNLESS( !streamInfo || streamInfo->version >= 2, paBadIODeviceCombination );
+        deviceInfo = GetDeviceInfo( hostApi, parameters->device );
+    }
+    else
+    {
+        PA_UNLESS( streamInfo && streamInfo->deviceString != NULL, paInvalidDevice );
+
+        /* Skip further checking */
+        return paNoError;
+    }
 
     assert( deviceInfo );
-    assert( parameters->hostApiSpecificStreamInfo == NULL );
     maxChans = ( StreamDirection_In == mode ? deviceInfo->baseDeviceInfo.maxInputChannels :
         deviceInfo->baseDeviceInfo.maxOutputChannels );
-    PA_UNLESS( parameters->channelCount <= maxChans, paInvalidChannelCount );
+    PA_UNLESS( GetDeviceChannelCount( parameters ) <= maxChans, paInvalidChannelCount );
 
 error:
     return result;
@@ -1525,6 +2645,9 @@ static PaSampleFormat GetAvailableFormats( snd_pcm_t *pcm )
 
     alsa_snd_pcm_hw_params_any( pcm, hwParams );
 
+    if( alsa_snd_pcm_hw_params_test_format( pcm, hwParams, SND_PCM_FORMAT_FLOAT64 ) >= 0)
+        available |= paFloat64;
+
     if( alsa_snd_pcm_hw_params_test_format( pcm, hwParams, SND_PCM_FORMAT_FLOAT ) >= 0)
         available |= paFloat32;
 
@@ -1539,6 +2662,9 @@ static PaSampleFormat GetAvailableFormats( snd_pcm_t *pcm )
         available |= paInt24;
 #endif
 
+    if( alsa_snd_pcm_hw_params_test_format( pcm, hwParams, SND_PCM_FORMAT_S24 ) >= 0)
+        available |= paInt24In32;
+
     if( alsa_snd_pcm_hw_params_test_format( pcm, hwParams, SND_PCM_FORMAT_S16 ) >= 0)
         available |= paInt16;
 
@@ -1677,6 +2803,9 @@ static snd_pcm_format_t Pa2AlsaFormat( PaSampleFormat paFormat )
 {
     switch( paFormat )
     {
+        case paFloat64:
+            return SND_PCM_FORMAT_FLOAT64;
+
         case paFloat32:
             return SND_PCM_FORMAT_FLOAT;
 
@@ -1690,6 +2819,9 @@ static snd_pcm_format_t Pa2AlsaFormat( PaSampleFormat paFormat )
             return SND_PCM_FORMAT_S24_3BE;
 #endif
 
+        case paInt24In32:
+            return SND_PCM_FORMAT_S24;
+
         case paInt32:
             return SND_PCM_FORMAT_S32;
 
@@ -1709,29 +2841,141 @@ static snd_pcm_format_t Pa2AlsaFormat( PaSampleFormat paFormat )
  * The device to be open can be specified by name in a custom PaAlsaStreamInfo struct, or it will be by
  * the Portaudio device number supplied in the stream parameters.
  */
+/* Append a string to the definition of an aggregate PCM, quoted if quote is nonzero */
+static void AppendAggregateConfig( char *config, size_t *length, const char *text, int quote )
+{
+    if( quote )
+        config[(*length)++] = '"';
+    for( ; *text; ++text )
+    {
+        if( quote && ( '"' == *text || '\\' == *text ) )
+            config[(*length)++] = '\\';
+        config[(*length)++] = *text;
+    }
+    if( quote )
+        config[(*length)++] = '"';
+    config[*length] = '\0';
+}
+
+/* Open the devices of an aggregate stream as one PCM.
+ *
+ * ALSA's multi plugin does the aggregation: it exposes the channels of its slaves as those of one PCM, has them share
+ * the hardware parameters, reports the frames available as the least of theirs and links the slaves so that they
+ * start and stop together, in the driver if they support snd_pcm_link(). Its definition is added to a copy of the
+ * global configuration, so that the slaves can be any device the configuration knows.
+ */
+static int OpenAggregatePcm( snd_pcm_t **pcmp, const PaAlsaAggregateDevice *devices, int deviceCount,
+        snd_pcm_stream_t stream, int mode, int waitOnBusy )
+{
+    int ret, i, channel = 0, channelCount = 0;
+    size_t size = 64, length = 0;
+    char *config = NULL, number[64];
+    snd_config_t *lconf = NULL;
+    snd_input_t *input = NULL;
+
+    /* Every character of a device string may be escaped, each slave and channel takes a line */
+    for( i = 0; i < deviceCount; ++i )
+    {
+        size += 2 * strlen( devices[i].deviceString ) + 128;
+        channelCount += devices[i].channelCount;
+    }
+    size += (size_t)channelCount * 96;
+
+    if( !(config = PaUtil_AllocateMemory( size )) )
+        return -ENOMEM;
+    config[0] = '\0';
+
+    AppendAggregateConfig( config, &length, "pcm." AGGREGATE_PCM_NAME " {\n type multi\n", 0 );
+    for( i = 0; i < deviceCount; ++i )
+    {
+        sprintf( number, "%d", i );
+        AppendAggregateConfig( config, &length, " slaves.", 0 );
+        AppendAggregateConfig( config, &length, number, 0 );
+        AppendAggregateConfig( config, &length, ".pcm ", 0 );
+        AppendAggregateConfig( config, &length, devices[i].deviceString, 1 );
+        sprintf( number, "%d.channels %d\n", i, devices[i].channelCount );
+        AppendAggregateConfig( config, &length, "\n slaves.", 0 );
+        AppendAggregateConfig( config, &length, number, 0 );
+    }
+    for( i = 0; i < deviceCount; ++i )
+    {
+        int slaveChannel;
+        for( slaveChannel = 0; slaveChannel < devices[i].channelCount; ++slaveChannel, ++channel )
+        {
+            sprintf( number, "%d.slave %d\n", channel, i );
+            AppendAggregateConfig( config, &length, " bindings.", 0 );
+            AppendAggregateConfig( config, &length, number, 0 );
+            sprintf( number, "%d.channel %d\n", channel, slaveChannel );
+            AppendAggregateConfig( config, &length, " bindings.", 0 );
+            AppendAggregateConfig( config, &length, number, 0 );
+        }
+    }
+    AppendAggregateConfig( config, &length, "}\n", 0 );
+    assert( length < size );
+    PA_DEBUG(( "%s: Aggregate definition:\n%s", __FUNCTION__, config ));
+
+    if( NULL == (*alsa_snd_config) && (ret = alsa_snd_config_update()) < 0 )
+        goto end;
+    if( (ret = alsa_snd_config_copy( &lconf, *alsa_snd_config )) < 0 )
+    {
+        lconf = NULL;
+        goto end;
+    }
+    if( (ret = alsa_snd_input_buffer_open( &input, config, (ssize_t)length )) < 0 )
+    {
+        input = NULL;
+        goto end;
+    }
+    if( (ret = alsa_snd_config_load( lconf, input )) < 0 )
+        goto end;
+
+    ret = OpenPcm( pcmp, AGGREGATE_PCM_NAME, lconf, stream, mode, waitOnBusy );
+
+end:
+    if( input )
+        alsa_snd_input_close( input );
+    /* The PCM doesn't refer to the configuration once opened */
+    if( lconf )
+        alsa_snd_config_delete( lconf );
+    PaUtil_FreeMemory( config );
+    return ret;
+}
+
 static PaError AlsaOpen( const PaUtilHostApiRepresentation *hostApi, const PaStreamParameters *params, StreamDirection
         streamDir, snd_pcm_t **pcm )
 {
     PaError result = paNoError;
-    int ret;
+    int ret, aggregateDeviceCount;
     const char* deviceName = "";
     const PaAlsaDeviceInfo *deviceInfo = NULL;
-    PaAlsaStreamInfo *streamInfo = (PaAlsaStreamInfo *)params->hostApiSpecificStreamInfo;
+    const PaAlsaAggregateDevice *aggregateDevices = GetAggregateDevices( params, &aggregateDeviceCount );
+    snd_pcm_stream_t stream = streamDir == StreamDirection_In ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK;
 
-    if( !streamInfo )
+    if( aggregateDevices )
+        deviceName = AGGREGATE_PCM_NAME;
+    else if( !GetDeviceString( params ) )
     {
         deviceInfo = GetDeviceInfo( hostApi, params->device );
         deviceName = deviceInfo->alsaName;
     }
     else
-        deviceName = streamInfo->deviceString;
+        deviceName = GetDeviceString( params );
 
     PA_DEBUG(( "%s: Opening device %s\n", __FUNCTION__, deviceName ));
-    if( (ret = OpenPcm( pcm, deviceName, streamDir == StreamDirection_In ? SND_PCM_STREAM_CAPTURE : SND_PCM_STREAM_PLAYBACK,
-                    SND_PCM_NONBLOCK, 1 )) < 0 )
+    if( (ret = aggregateDevices ?
+                OpenAggregatePcm( pcm, aggregateDevices, aggregateDeviceCount, stream, SND_PCM_NONBLOCK, 1 ) :
+                OpenPcm( pcm, deviceName, NULL, stream, SND_PCM_NONBLOCK, 1 )) < 0 )
     {
         /* Not to be closed */
         *pcm = NULL;
+        /* A device the cache lists that can't be opened has changed in a way its key didn't catch, have the next
+         * initialization probe the devices again */
+        if( deviceInfo && deviceInfo->fromCache && -EBUSY != ret &&
+                ((const PaAlsaHostApiRepresentation *)hostApi)->devices.cachePath )
+        {
+            PA_DEBUG(( "%s: Removing stale device cache\n", __FUNCTION__ ));
+            unlink( ((const PaAlsaHostApiRepresentation *)hostApi)->devices.cachePath );
+        }
         ENSURE_( ret, -EBUSY == ret ? paDeviceUnavailable : paBadIODeviceCombination );
     }
     ENSURE_( alsa_snd_pcm_nonblock( *pcm, 0 ), paUnanticipatedHostError );
@@ -1755,14 +2999,14 @@ static PaError TestParameters( const PaUtilHostApiRepresentation *hostApi, const
     snd_pcm_hw_params_t *hwParams;
     alsa_snd_pcm_hw_params_alloca( &hwParams );
 
-    if( !parameters->hostApiSpecificStreamInfo )
+    if( parameters->device != paUseHostApiSpecificDeviceSpecification )
     {
         const PaAlsaDeviceInfo *devInfo = GetDeviceInfo( hostApi, parameters->device );
-        numHostChannels = PA_MAX( parameters->channelCount, StreamDirection_In == streamDir ?
+        numHostChannels = PA_MAX( GetDeviceChannelCount( parameters ), StreamDirection_In == streamDir ?
                 devInfo->minInputChannels : devInfo->minOutputChannels );
     }
     else
-        numHostChannels = parameters->channelCount;
+        numHostChannels = GetDeviceChannelCount( parameters );
 
     PA_ENSURE( AlsaOpen( hostApi, parameters, streamDir, &pcm ) );
 
@@ -1823,6 +3067,150 @@ error:
     goto end;
 }
 
+/* The sample rates tested for PaDeviceCapabilities, in ascending order */
+static const double standardSampleRates_[NUM_STANDARD_SAMPLE_RATES] = {
+    8000.0, 9600.0, 11025.0, 12000.0, 16000.0, 22050.0, 24000.0, 32000.0,
+    44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0, 352800.0, 384000.0
+};
+
+/* Open one direction of a device to find the formats, channel counts and standard sample rates it supports, each
+ * tested on its own */
+static PaError ProbeCapabilities( const PaUtilHostApiRepresentation *hostApi, int device, StreamDirection streamDir,
+        PaSampleFormat *sampleFormats, int *minChannels, int *maxChannels, double *sampleRates, int *sampleRateCount )
+{
+    PaError result = paNoError;
+    snd_pcm_t *pcm = NULL;
+    PaStreamParameters parameters;
+    snd_pcm_hw_params_t *hwParams;
+    unsigned int channels;
+    int i;
+    alsa_snd_pcm_hw_params_alloca( &hwParams );
+
+    parameters.device = device;
+    parameters.channelCount = 1;
+    parameters.sampleFormat = paFloat32;
+    parameters.suggestedLatency = 0.;
+    parameters.hostApiSpecificStreamInfo = NULL;
+    PA_ENSURE( AlsaOpen( hostApi, &parameters, streamDir, &pcm ) );
+
+    *sampleFormats = GetAvailableFormats( pcm );
+
+    alsa_snd_pcm_hw_params_any( pcm, hwParams );
+    ENSURE_( alsa_snd_pcm_hw_params_get_channels_min( hwParams, &channels ), paUnanticipatedHostError );
+    *minChannels = (int)channels;
+    ENSURE_( alsa_snd_pcm_hw_params_get_channels_max( hwParams, &channels ), paUnanticipatedHostError );
+    *maxChannels = (int)channels;
+
+    *sampleRateCount = 0;
+    for( i = 0; i < NUM_STANDARD_SAMPLE_RATES; ++i )
+    {
+        if( alsa_snd_pcm_hw_params_test_rate( pcm, hwParams, (unsigned int)standardSampleRates_[i], 0 ) >= 0 )
+            sampleRates[(*sampleRateCount)++] = standardSampleRates_[i];
+    }
+
+end:
+    if( pcm )
+        alsa_snd_pcm_close( pcm );
+    return result;
+
+error:
+    goto end;
+}
+
+/* Determine the capabilities of a device the first time they're asked for, a device which is busy is probed again
+ * next time */
+static PaError GetDeviceCapabilities( struct PaUtilHostApiRepresentation *hostApi, int device,
+        const PaDeviceCapabilities **capabilities )
+{
+    PaError result = paNoError;
+    PaAlsaDeviceInfo *devInfo = (PaAlsaDeviceInfo *)hostApi->deviceInfos[device];
+    PaDeviceCapabilities *caps = &devInfo->capabilities;
+
+    *capabilities = NULL;
+    if( !devInfo->hasCapabilities )
+    {
+        memset( caps, 0, sizeof (*caps) );
+        caps->structVersion = 1;
+        caps->inputSampleRates = devInfo->inputSampleRates;
+        caps->outputSampleRates = devInfo->outputSampleRates;
+
+        if( devInfo->baseDeviceInfo.maxInputChannels > 0 )
+            PA_ENSURE( ProbeCapabilities( hostApi, device, StreamDirection_In, &caps->inputSampleFormats,
+                        &caps->minInputChannels, &caps->maxInputChannels, devInfo->inputSampleRates,
+                        &caps->inputSampleRateCount ) );
+        if( devInfo->baseDeviceInfo.maxOutputChannels > 0 )
+            PA_ENSURE( ProbeCapabilities( hostApi, device, StreamDirection_Out, &caps->outputSampleFormats,
+                        &caps->minOutputChannels, &caps->maxOutputChannels, devInfo->outputSampleRates,
+                        &caps->outputSampleRateCount ) );
+
+        devInfo->hasCapabilities = 1;
+    }
+    *capabilities = caps;
+
+end:
+    return result;
+
+error:
+    if( paDeviceUnavailable == result )
+        result = paNoError;
+    goto end;
+}
+
+/* Answer IsFormatSupported() for one direction from the capabilities of the device, for the sample rates they list,
+ * returns 0 if the device has to be tested instead */
+static int CheckCapabilities( struct PaUtilHostApiRepresentation *hostApi, const PaStreamParameters *parameters,
+        double sampleRate, StreamDirection streamDir, PaError *result )
+{
+    const PaDeviceCapabilities *caps = NULL;
+    const PaAlsaDeviceInfo *devInfo;
+    const double *sampleRates;
+    int sampleRateCount, minChannels, maxChannels, i;
+    PaSampleFormat sampleFormats;
+
+    if( parameters->device == paUseHostApiSpecificDeviceSpecification
+            || GetDeviceCapabilities( hostApi, parameters->device, &caps ) != paNoError || !caps )
+        return 0;
+
+    devInfo = GetDeviceInfo( hostApi, parameters->device );
+    if( StreamDirection_In == streamDir )
+    {
+        sampleFormats = caps->inputSampleFormats;
+        minChannels = PA_MAX( caps->minInputChannels, devInfo->minInputChannels );
+        maxChannels = caps->maxInputChannels;
+        sampleRates = caps->inputSampleRates;
+        sampleRateCount = caps->inputSampleRateCount;
+    }
+    else
+    {
+        sampleFormats = caps->outputSampleFormats;
+        minChannels = PA_MAX( caps->minOutputChannels, devInfo->minOutputChannels );
+        maxChannels = caps->maxOutputChannels;
+        sampleRates = caps->outputSampleRates;
+        sampleRateCount = caps->outputSampleRateCount;
+    }
+
+    /* Like TestParameters(), open fewer channels than the device's minimum by adapting */
+    if( PA_MAX( GetDeviceChannelCount( parameters ), minChannels ) > maxChannels )
+    {
+        *result = paInvalidChannelCount;
+        return 1;
+    }
+    if( PaUtil_SelectClosestAvailableFormat( sampleFormats, parameters->sampleFormat ) == paSampleFormatNotSupported )
+    {
+        *result = paSampleFormatNotSupported;
+        return 1;
+    }
+    for( i = 0; i < sampleRateCount; ++i )
+    {
+        if( sampleRates[i] == sampleRate )
+        {
+            *result = paNoError;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
@@ -1848,16 +3236,19 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
         outputSampleFormat = outputParameters->sampleFormat;
     }
 
+    /* The device is only opened if its capabilities don't settle the question */
     if( inputChannelCount )
     {
-        if( ( result = TestParameters( hostApi, inputParameters, sampleRate, StreamDirection_In ) )
-                != paNoError )
+        if( !CheckCapabilities( hostApi, inputParameters, sampleRate, StreamDirection_In, &result ) )
+            result = TestParameters( hostApi, inputParameters, sampleRate, StreamDirection_In );
+        if( result != paNoError )
             goto error;
     }
     if ( outputChannelCount )
     {
-        if( ( result = TestParameters( hostApi, outputParameters, sampleRate, StreamDirection_Out ) )
-                != paNoError )
+        if( !CheckCapabilities( hostApi, outputParameters, sampleRate, StreamDirection_Out, &result ) )
+            result = TestParameters( hostApi, outputParameters, sampleRate, StreamDirection_Out );
+        if( result != paNoError )
             goto error;
     }
 
@@ -1868,20 +3259,101 @@ error:
 }
 
 
+/** Replace the pcm of a component opened on a plughw: device by the hw: device behind it (paAlsaPreferHw).
+ *
+ * The hw: device is only used if it takes the channels and sample rate of the stream with mmap access, the sample
+ * format is then converted by PortAudio's converters, directly in the device's buffer, instead of by the plug
+ * plugin in a buffer of its own. Otherwise the plughw: device is kept.
+ */
+static void PaAlsaStreamComponent_PreferHw( PaAlsaStreamComponent *self, const PaUtilHostApiRepresentation *hostApi,
+        const PaStreamParameters *params, double sampleRate )
+{
+    const char *deviceName = GetDeviceString( params );
+    snd_pcm_t *pcm = NULL;
+    snd_pcm_hw_params_t *hwParams;
+    unsigned int minChans = 0, maxChans = 0;
+    int usable, aggregateDeviceCount;
+
+    if( GetAggregateDevices( params, &aggregateDeviceCount ) )
+        return;
+    if( !deviceName && params->device != paUseHostApiSpecificDeviceSpecification )
+        deviceName = GetDeviceInfo( hostApi, params->device )->alsaName;
+    if( !deviceName || strncmp( "plughw:", deviceName, 7 ) != 0 )
+        return;
+
+    /* "plughw:0,0" is the plug plugin on top of "hw:0,0" */
+    if( OpenPcm( &pcm, deviceName + 4, NULL, StreamDirection_In == self->streamDir ? SND_PCM_STREAM_CAPTURE :
+                SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK, 0 ) < 0 )
+        return;
+
+    alsa_snd_pcm_hw_params_alloca( &hwParams );
+    usable = alsa_snd_pcm_hw_params_any( pcm, hwParams ) >= 0 &&
+        alsa_snd_pcm_hw_params_get_channels_min( hwParams, &minChans ) >= 0 &&
+        alsa_snd_pcm_hw_params_get_channels_max( hwParams, &maxChans ) >= 0 &&
+        minChans <= (unsigned int)self->numHostChannels && (unsigned int)self->numHostChannels <= maxChans &&
+        alsa_snd_pcm_hw_params_test_rate( pcm, hwParams, (unsigned int)sampleRate, 0 ) >= 0 &&
+        ( alsa_snd_pcm_hw_params_test_access( pcm, hwParams, SND_PCM_ACCESS_MMAP_INTERLEAVED ) >= 0 ||
+          alsa_snd_pcm_hw_params_test_access( pcm, hwParams, SND_PCM_ACCESS_MMAP_NONINTERLEAVED ) >= 0 ) &&
+        alsa_snd_pcm_nonblock( pcm, 0 ) >= 0;
+    if( !usable )
+    {
+        alsa_snd_pcm_close( pcm );
+        return;
+    }
+
+    PA_DEBUG(( "%s: Using %s instead of %s\n", __FUNCTION__, deviceName + 4, deviceName ));
+    alsa_snd_pcm_close( self->pcm );
+    self->pcm = pcm;
+    self->deviceIsPlug = 0;
+    self->useReventFix = 0;
+}
+
+/** The formats of the hw: device behind a plughw: device, which the plug plugin passes on without converting them
+ * (paPreferCheapestConversion). 0 for other plug devices, whose native formats aren't known.
+ */
+static PaSampleFormat GetPlugHwNativeFormats( const PaUtilHostApiRepresentation *hostApi,
+        const PaStreamParameters *params, StreamDirection streamDir )
+{
+    const char *deviceName = GetDeviceString( params );
+    snd_pcm_t *pcm = NULL;
+    PaSampleFormat nativeFormats;
+    int aggregateDeviceCount;
+
+    if( GetAggregateDevices( params, &aggregateDeviceCount ) )
+        return 0;
+    if( !deviceName && params->device != paUseHostApiSpecificDeviceSpecification )
+        deviceName = GetDeviceInfo( hostApi, params->device )->alsaName;
+    if( !deviceName || strncmp( "plughw:", deviceName, 7 ) != 0 )
+        return 0;
+
+    if( OpenPcm( &pcm, deviceName + 4, NULL, StreamDirection_In == streamDir ? SND_PCM_STREAM_CAPTURE :
+                SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK, 0 ) < 0 )
+        return 0;
+    nativeFormats = GetAvailableFormats( pcm );
+    alsa_snd_pcm_close( pcm );
+    return nativeFormats;
+}
+
+/**
+ * @param streamFlags paAlsaPreferHw opens the hw: device behind a plughw: device if it takes the stream as is,
+ * paPreferCheapestConversion selects the host format by the cost of converting to it, the other flags select the
+ * converters this is weighed for.
+ */
 static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, PaAlsaHostApiRepresentation *alsaApi,
-        const PaStreamParameters *params, StreamDirection streamDir, int callbackMode )
+        const PaStreamParameters *params, StreamDirection streamDir, int callbackMode, double sampleRate,
+        PaStreamFlags streamFlags )
 {
     PaError result = paNoError;
-    PaSampleFormat userSampleFormat = params->sampleFormat, hostSampleFormat = paNoError;
+    PaSampleFormat userSampleFormat = params->sampleFormat, hostSampleFormat = paNoError, nativeFormats = 0;
     assert( params->channelCount > 0 );
 
     /* Make sure things have an initial value */
     memset( self, 0, sizeof (PaAlsaStreamComponent) );
 
-    if( NULL == params->hostApiSpecificStreamInfo )
+    if( params->device != paUseHostApiSpecificDeviceSpecification )
     {
         const PaAlsaDeviceInfo *devInfo = GetDeviceInfo( &alsaApi->baseHostApiRep, params->device );
-        self->numHostChannels = PA_MAX( params->channelCount, StreamDirection_In == streamDir ? devInfo->minInputChannels
+        self->numHostChannels = PA_MAX( GetDeviceChannelCount( params ), StreamDirection_In == streamDir ? devInfo->minInputChannels
                 : devInfo->minOutputChannels );
         self->deviceIsPlug = devInfo->isPlug;
         PA_DEBUG(( "%s: Host Chans %c %i\n", __FUNCTION__, streamDir == StreamDirection_In ? 'C' : 'P', self->numHostChannels ));
@@ -1889,9 +3361,9 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
     else
     {
         /* We're blissfully unaware of the minimum channelCount */
-        self->numHostChannels = params->channelCount;
-        /* Check if device name does not start with hw: to determine if it is a 'plug' device */
-        if( strncmp( "hw:", ((PaAlsaStreamInfo *)params->hostApiSpecificStreamInfo)->deviceString, 3 ) != 0  )
+        self->numHostChannels = GetDeviceChannelCount( params );
+        /* Check if device name does not start with hw: to determine if it is a 'plug' device, an aggregate is one */
+        if( !GetDeviceString( params ) || strncmp( "hw:", GetDeviceString( params ), 3 ) != 0  )
             self->deviceIsPlug = 1; /* An Alsa plug device, not a direct hw device */
     }
     if( self->deviceIsPlug && alsaApi->alsaLibVersion < ALSA_VERSION_INT( 1, 0, 16 ) )
@@ -1899,19 +3371,39 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
 
     self->device = params->device;
 
+    /* The hw: device is probed before the plughw: device on top of it holds it open */
+    if( self->deviceIsPlug && ( streamFlags & paPreferCheapestConversion ) )
+        nativeFormats = GetPlugHwNativeFormats( &alsaApi->baseHostApiRep, params, streamDir );
+
     PA_ENSURE( AlsaOpen( &alsaApi->baseHostApiRep, params, streamDir, &self->pcm ) );
+    self->streamDir = streamDir;
+    if( streamFlags & paAlsaPreferHw )
+        PaAlsaStreamComponent_PreferHw( self, &alsaApi->baseHostApiRep, params, sampleRate );
     self->nfds = alsa_snd_pcm_poll_descriptors_count( self->pcm );
+    PA_UNLESS( self->status = (snd_pcm_status_t *)PaUtil_AllocateMemory( alsa_snd_pcm_status_sizeof() ),
+            paInsufficientMemory );
+    memset( self->status, 0, alsa_snd_pcm_status_sizeof() );
 
-    PA_ENSURE( hostSampleFormat = PaUtil_SelectClosestAvailableFormat( GetAvailableFormats( self->pcm ), userSampleFormat ) );
+    if( streamFlags & paPreferCheapestConversion )
+    {
+        PaSampleFormat availableFormats = GetAvailableFormats( self->pcm );
+        PA_ENSURE( hostSampleFormat = PaUtil_SelectCheapestAvailableFormat( availableFormats,
+                    self->deviceIsPlug ? nativeFormats : availableFormats, userSampleFormat,
+                    StreamDirection_Out == streamDir, streamFlags ) );
+    }
+    else
+        PA_ENSURE( hostSampleFormat = PaUtil_SelectClosestAvailableFormat( GetAvailableFormats( self->pcm ), userSampleFormat ) );
 
     self->hostSampleFormat = hostSampleFormat;
     self->nativeFormat = Pa2AlsaFormat( hostSampleFormat );
     self->hostInterleaved = self->userInterleaved = !( userSampleFormat & paNonInterleaved );
-    self->numUserChannels = params->channelCount;
-    self->streamDir = streamDir;
+    /* With a channel matrix the buffer processor mixes between the stream's and the device's channels, with channel
+       selectors it converts the selected device channels only */
+    self->numUserChannels = GetChannelSelectors( params ) ? params->channelCount : GetDeviceChannelCount( params );
     self->canMmap = 0;
     self->nonMmapBuffer = NULL;
     self->nonMmapBufferSize = 0;
+    self->nonMmapBufferFrames = 0;
 
     if( !callbackMode && !self->userInterleaved )
     {
@@ -1920,6 +3412,20 @@ static PaError PaAlsaStreamComponent_Initialize( PaAlsaStreamComponent *self, Pa
                 paInsufficientMemory );
     }
 
+    if( GetFallbackDeviceString( params ) )
+    {
+        PA_UNLESS( self->fallbackDevice = PaUtil_AllocateMemory( strlen( GetFallbackDeviceString( params ) ) + 1 ),
+                paInsufficientMemory );
+        strcpy( self->fallbackDevice, GetFallbackDeviceString( params ) );
+    }
+
+    if( GetChannelSelectors( params ) )
+    {
+        PA_UNLESS( self->channelSelectors = PaUtil_AllocateMemory( sizeof (int) * self->numUserChannels ),
+                paInsufficientMemory );
+        memcpy( self->channelSelectors, GetChannelSelectors( params ), sizeof (int) * self->numUserChannels );
+    }
+
 error:
 
     /* Log all available formats. */
@@ -1936,7 +3442,10 @@ static void PaAlsaStreamComponent_Terminate( PaAlsaStreamComponent *self )
 {
     alsa_snd_pcm_close( self->pcm );
     PaUtil_FreeMemory( self->userBuffers ); /* (Ptr can be NULL; PaUtil_FreeMemory includes a NULL check) */
+    PaUtil_FreeMemory( self->status );
     PaUtil_FreeMemory( self->nonMmapBuffer );
+    PaUtil_FreeMemory( self->fallbackDevice );
+    PaUtil_FreeMemory( self->channelSelectors );
 }
 
 /*
@@ -1949,9 +3458,10 @@ static int nearbyint_(float value) {
 
 /** Initiate configuration, preparing for determining a period size suitable for both capture and playback components.
  *
+ * @param anyRate Accept the closest rate the device supports, however far it is from the one requested.
  */
 static PaError PaAlsaStreamComponent_InitialConfigure( PaAlsaStreamComponent *self, const PaStreamParameters *params,
-        int primeBuffers, snd_pcm_hw_params_t *hwParams, double *sampleRate )
+        int primeBuffers, int anyRate, snd_pcm_hw_params_t *hwParams, double *sampleRate )
 {
     /* Configuration consists of setting all of ALSA's parameters.
      * These parameters come in two flavors: hardware parameters
@@ -2039,8 +3549,10 @@ static PaError PaAlsaStreamComponent_InitialConfigure( PaAlsaStreamComponent *se
         ENSURE_( GetExactSampleRate( hwParams, &sr ), paUnanticipatedHostError );
         if( result == paInvalidSampleRate ) /* From the SetApproximateSampleRate() call above */
         { /* The sample rate was returned as 'out of tolerance' of the one requested */
-            PA_DEBUG(( "%s: Wanted %.3f, closest sample rate was %.3f\n", __FUNCTION__, sampleRate, sr ));
-            PA_ENSURE( paInvalidSampleRate );
+            PA_DEBUG(( "%s: Wanted %.3f, closest sample rate was %.3f\n", __FUNCTION__, *sampleRate, sr ));
+            if( !anyRate )
+                PA_ENSURE( paInvalidSampleRate );
+            result = paNoError;
         }
     }
     else
@@ -2060,22 +3572,96 @@ error:
     goto end;
 }
 
+/** Disable the period wakeups of the component's device for paAlsaTimerScheduling, where the driver allows it. */
+static PaError PaAlsaStreamComponent_DisablePeriodWakeup( PaAlsaStreamComponent *self, snd_pcm_hw_params_t *hwParams )
+{
+    PaError result = paNoError;
+
+    /* ALSA-lib only lets go of period wakeups for pcms in non-blocking mode */
+    if( alsa_snd_pcm_hw_params_set_period_wakeup != NULL && alsa_snd_pcm_hw_params_can_disable_period_wakeup != NULL
+            && alsa_snd_pcm_hw_params_can_disable_period_wakeup( hwParams ) )
+    {
+        int err;
+        ENSURE_( alsa_snd_pcm_nonblock( self->pcm, 1 ), paUnanticipatedHostError );
+        err = alsa_snd_pcm_hw_params_set_period_wakeup( self->pcm, hwParams, 0 );
+        ENSURE_( alsa_snd_pcm_nonblock( self->pcm, 0 ), paUnanticipatedHostError );
+        (void)err;  /* Prevent unused variable warning if debug output is turned off */
+        PA_DEBUG(( "%s: Disabling period wakeups %s\n", __FUNCTION__, err < 0 ? "failed" : "succeeded" ));
+    }
+    else
+        PA_DEBUG(( "%s: Period wakeups can't be disabled, the timer wakes up the thread anyway\n", __FUNCTION__ ));
+
+error:
+    return result;
+}
+
+/** Set the software parameters of the component's device, once its period and buffer size are known. */
+static PaError PaAlsaStreamComponent_ConfigureSoftware( PaAlsaStreamComponent *self, int primeBuffers )
+{
+    PaError result = paNoError;
+    snd_pcm_sw_params_t* swParams;
+    snd_pcm_uframes_t boundary;
+
+    alsa_snd_pcm_sw_params_alloca( &swParams );
+
+    ENSURE_( alsa_snd_pcm_sw_params_current( self->pcm, swParams ), paUnanticipatedHostError );
+    ENSURE_( alsa_snd_pcm_sw_params_get_boundary( swParams, &boundary ), paUnanticipatedHostError );
+
+    ENSURE_( alsa_snd_pcm_sw_params_set_start_threshold( self->pcm, swParams, self->framesPerPeriod ), paUnanticipatedHostError );
+    /* An output running through underruns never stops by itself, see PaAlsaStreamComponent_SkipUnderrun() */
+    ENSURE_( alsa_snd_pcm_sw_params_set_stop_threshold( self->pcm, swParams, self->runsThroughUnderruns ? boundary :
+                self->alsaBufferSize ), paUnanticipatedHostError );
+
+    /* Silence buffer in the case of underrun */
+    if( !primeBuffers ) /* XXX: Make sense? */
+    {
+        ENSURE_( alsa_snd_pcm_sw_params_set_silence_threshold( self->pcm, swParams, 0 ), paUnanticipatedHostError );
+        ENSURE_( alsa_snd_pcm_sw_params_set_silence_size( self->pcm, swParams, boundary ), paUnanticipatedHostError );
+    }
+
+    ENSURE_( alsa_snd_pcm_sw_params_set_avail_min( self->pcm, swParams, self->framesPerPeriod ), paUnanticipatedHostError );
+    ENSURE_( alsa_snd_pcm_sw_params_set_xfer_align( self->pcm, swParams, 1 ), paUnanticipatedHostError );
+    ENSURE_( alsa_snd_pcm_sw_params_set_tstamp_mode( self->pcm, swParams, SND_PCM_TSTAMP_ENABLE ), paUnanticipatedHostError );
+
+    /* Set the parameters! */
+    ENSURE_( alsa_snd_pcm_sw_params( self->pcm, swParams ), paUnanticipatedHostError );
+
+error:
+    return result;
+}
+
 /** Finish the configuration of the component's ALSA device.
  *
  * As part of this method, the component's alsaBufferSize attribute will be set.
+ * @param timerScheduling: Configure for paAlsaTimerScheduling, setting the component's fillLevel attribute.
+ * @param autoLatency: Start an output at the lowest fill level for paAlsaAutoLatency, the suggested latency being the
+ * highest it may be raised to. Needs timerScheduling.
  * @param latency: The latency for this component.
  */
 static PaError PaAlsaStreamComponent_FinishConfigure( PaAlsaStreamComponent *self, snd_pcm_hw_params_t* hwParams,
-        const PaStreamParameters *params, int primeBuffers, double sampleRate, PaTime* latency )
+        const PaStreamParameters *params, int primeBuffers, int timerScheduling, int autoLatency, double sampleRate,
+        PaTime* latency )
 {
     PaError result = paNoError;
-    snd_pcm_sw_params_t* swParams;
     snd_pcm_uframes_t bufSz = 0;
     *latency = -1.;
 
-    alsa_snd_pcm_sw_params_alloca( &swParams );
-
     bufSz = params->suggestedLatency * sampleRate + self->framesPerPeriod;
+    self->fillLevel = 0;
+    self->maxFillLevel = 0;
+    if( timerScheduling )
+    {
+        /* The latency is that of the fill level, the buffer may be as large as the device takes */
+        self->fillLevel = PA_MAX( bufSz, 2 * self->framesPerPeriod );
+        bufSz = PA_MAX( self->fillLevel, (snd_pcm_uframes_t)( TIMER_SCHEDULING_BUFFER_TIME * sampleRate ) );
+        PA_ENSURE( PaAlsaStreamComponent_DisablePeriodWakeup( self, hwParams ) );
+        if( autoLatency )
+        {
+            /* Double buffering to start with */
+            self->maxFillLevel = self->fillLevel;
+            self->fillLevel = 2 * self->framesPerPeriod;
+        }
+    }
     ENSURE_( alsa_snd_pcm_hw_params_set_buffer_size_near( self->pcm, hwParams, &bufSz ), paUnanticipatedHostError );
 
     /* Set the parameters! */
@@ -2101,29 +3687,17 @@ static PaError PaAlsaStreamComponent_FinishConfigure( PaAlsaStreamComponent *sel
     }
 
     /* Latency in seconds */
-    *latency = (self->alsaBufferSize - self->framesPerPeriod) / sampleRate;
-
-    /* Now software parameters... */
-    ENSURE_( alsa_snd_pcm_sw_params_current( self->pcm, swParams ), paUnanticipatedHostError );
-
-    ENSURE_( alsa_snd_pcm_sw_params_set_start_threshold( self->pcm, swParams, self->framesPerPeriod ), paUnanticipatedHostError );
-    ENSURE_( alsa_snd_pcm_sw_params_set_stop_threshold( self->pcm, swParams, self->alsaBufferSize ), paUnanticipatedHostError );
-
-    /* Silence buffer in the case of underrun */
-    if( !primeBuffers ) /* XXX: Make sense? */
+    if( timerScheduling )
     {
-        snd_pcm_uframes_t boundary;
-        ENSURE_( alsa_snd_pcm_sw_params_get_boundary( swParams, &boundary ), paUnanticipatedHostError );
-        ENSURE_( alsa_snd_pcm_sw_params_set_silence_threshold( self->pcm, swParams, 0 ), paUnanticipatedHostError );
-        ENSURE_( alsa_snd_pcm_sw_params_set_silence_size( self->pcm, swParams, boundary ), paUnanticipatedHostError );
+        self->fillLevel = PA_MIN( self->fillLevel, self->alsaBufferSize );
+        self->maxFillLevel = PA_MIN( self->maxFillLevel, self->alsaBufferSize );
+        *latency = (self->fillLevel - self->framesPerPeriod) / sampleRate;
     }
+    else
+        *latency = (self->alsaBufferSize - self->framesPerPeriod) / sampleRate;
 
-    ENSURE_( alsa_snd_pcm_sw_params_set_avail_min( self->pcm, swParams, self->framesPerPeriod ), paUnanticipatedHostError );
-    ENSURE_( alsa_snd_pcm_sw_params_set_xfer_align( self->pcm, swParams, 1 ), paUnanticipatedHostError );
-    ENSURE_( alsa_snd_pcm_sw_params_set_tstamp_mode( self->pcm, swParams, SND_PCM_TSTAMP_ENABLE ), paUnanticipatedHostError );
-
-    /* Set the parameters! */
-    ENSURE_( alsa_snd_pcm_sw_params( self->pcm, swParams ), paUnanticipatedHostError );
+    /* Now software parameters... */
+    PA_ENSURE( PaAlsaStreamComponent_ConfigureSoftware( self, primeBuffers ) );
 
 error:
     return result;
@@ -2137,6 +3711,7 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
     assert( self );
 
     memset( self, 0, sizeof( PaAlsaStream ) );
+    self->stopFds[0] = self->stopFds[1] = -1;
 
     if( NULL != callback )
     {
@@ -2154,6 +3729,17 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
 
     self->framesPerUserBuffer = framesPerUserBuffer;
     self->neverDropInput = streamFlags & paNeverDropInput;
+    self->convertSampleRate = NULL != callback && ( streamFlags & paConvertSampleRate );
+    self->independentClocks = NULL != callback && inParams && outParams && ( streamFlags & paCompensateClockDrift );
+    /* The application's thread polls for period wakeups itself, there is no thread to share or to sleep on a timer */
+    self->manualProcessing = NULL != callback && ( streamFlags & paManualProcessing );
+    self->shareCallbackThread = NULL != callback && !self->independentClocks && !self->manualProcessing &&
+        ( streamFlags & paAlsaSharedCallbackThread );
+    self->timerScheduling = NULL != callback && !self->independentClocks && !self->shareCallbackThread &&
+        !self->manualProcessing && ( streamFlags & ( paAlsaTimerScheduling | paAlsaAutoLatency | paAlsaLowPowerOutput ) );
+    self->autoLatency = self->timerScheduling && outParams && ( streamFlags & paAlsaAutoLatency );
+    self->lowPowerOutput = self->timerScheduling && outParams && !inParams && ( streamFlags & paAlsaLowPowerOutput );
+    self->alsaApi = alsaApi;
     /* XXX: Ignore paPrimeOutputBuffersUsingStreamCallback untill buffer priming is fully supported in pa_process.c */
     /*
     if( outParams & streamFlags & paPrimeOutputBuffersUsingStreamCallback )
@@ -2163,17 +3749,54 @@ static PaError PaAlsaStream_Initialize( PaAlsaStream *self, PaAlsaHostApiReprese
     memset( &self->playback, 0, sizeof (PaAlsaStreamComponent) );
     if( inParams )
     {
-        PA_ENSURE( PaAlsaStreamComponent_Initialize( &self->capture, alsaApi, inParams, StreamDirection_In, NULL != callback ) );
+        PA_ENSURE( PaAlsaStreamComponent_Initialize( &self->capture, alsaApi, inParams, StreamDirection_In, NULL != callback,
+                    sampleRate, streamFlags ) );
     }
     if( outParams )
     {
-        PA_ENSURE( PaAlsaStreamComponent_Initialize( &self->playback, alsaApi, outParams, StreamDirection_Out, NULL != callback ) );
+        PA_ENSURE( PaAlsaStreamComponent_Initialize( &self->playback, alsaApi, outParams, StreamDirection_Out, NULL != callback,
+                    sampleRate, streamFlags ) );
     }
 
     assert( self->capture.nfds || self->playback.nfds );
 
+    /* One more for the stop pipe */
     PA_UNLESS( self->pfds = (struct pollfd*)PaUtil_AllocateMemory( ( self->capture.nfds +
-                    self->playback.nfds ) * sizeof( struct pollfd ) ), paInsufficientMemory );
+                    self->playback.nfds + 1 ) * sizeof( struct pollfd ) ), paInsufficientMemory );
+
+    self->callbackCpu = -1;
+    if( NULL != callback )
+    {
+        int i;
+
+        /* RealStop wakes a thread of the stream's own through the pipe rather than cancelling it. Neither end
+           blocks, the thread empties the pipe when it wakes up */
+        if( !self->shareCallbackThread && !self->manualProcessing )
+        {
+            PA_UNLESS( !pipe( self->stopFds ), paInternalError );
+            for( i = 0; i < 2; ++i )
+            {
+                PA_UNLESS( !fcntl( self->stopFds[i], F_SETFL, fcntl( self->stopFds[i], F_GETFL ) | O_NONBLOCK ),
+                        paInternalError );
+                PA_UNLESS( !fcntl( self->stopFds[i], F_SETFD, FD_CLOEXEC ), paInternalError );
+            }
+        }
+
+        int cpuCount;
+        const int *cpus = GetCallbackCpus( outParams, &cpuCount );
+        if( !cpus )
+            cpus = GetCallbackCpus( inParams, &cpuCount );
+
+        if( cpus )
+        {
+            PA_UNLESS( self->callbackCpus = (int*)PaUtil_AllocateMemory( cpuCount * sizeof(int) ), paInsufficientMemory );
+            memcpy( self->callbackCpus, cpus, cpuCount * sizeof(int) );
+            self->callbackCpuCount = cpuCount;
+        }
+
+        self->conversionThreadCount = PA_MAX( GetConversionThreadCount( inParams ),
+                GetConversionThreadCount( outParams ) );
+    }
 
     PaUtil_InitializeCpuLoadMeasurer( &self->cpuLoadMeasurer, sampleRate );
     ASSERT_CALL_( PaUnixMutex_Initialize( &self->stateMtx ), paNoError );
@@ -2200,6 +3823,12 @@ static void PaAlsaStream_Terminate( PaAlsaStream *self )
     }
 
     PaUtil_FreeMemory( self->pfds );
+    if( self->callbackCpus )
+        PaUtil_FreeMemory( self->callbackCpus );
+    if( self->stopFds[0] >= 0 )
+        close( self->stopFds[0] );
+    if( self->stopFds[1] >= 0 )
+        close( self->stopFds[1] );
     ASSERT_CALL_( PaUnixMutex_Terminate( &self->stateMtx ), paNoError );
 
     PaUtil_FreeMemory( self );
@@ -2212,9 +3841,25 @@ static void PaAlsaStream_Terminate( PaAlsaStream *self )
  */
 static int CalculatePollTimeout( const PaAlsaStream *stream, unsigned long frames )
 {
-    assert( stream->streamRepresentation.streamInfo.sampleRate > 0.0 );
+    assert( stream->hostSampleRate > 0.0 );
     /* Period in msecs, rounded up */
-    return (int)ceil( 1000 * frames / stream->streamRepresentation.streamInfo.sampleRate );
+    return (int)ceil( 1000 * frames / stream->hostSampleRate );
+}
+
+/** Empty the stop pipe of a stream.
+ *
+ * @return Whether RealStop had written to it.
+ */
+static int PaAlsaStream_DrainStopPipe( PaAlsaStream *self )
+{
+    char buf[16];
+    int woken = 0;
+
+    if( self->stopFds[0] < 0 )
+        return 0;
+    while( read( self->stopFds[0], buf, sizeof (buf) ) > 0 )
+        woken = 1;
+    return woken;
 }
 
 /** Align value in backward direction.
@@ -2695,53 +4340,255 @@ error:
     return result;
 }
 
-/** Set up ALSA stream parameters.
+/** Fill in the key of a cached configuration for one direction, returns 0 if it can't be cached. */
+static int PaAlsaStreamComponent_GetConfigKey( const PaAlsaStreamComponent *self, const PaStreamParameters *params,
+        PaAlsaCachedComponentConfig *key )
+{
+    memset( key, 0, sizeof (*key) );
+    key->device = paNoDevice;
+    if( !self->pcm )
+        return 1;
+    /* A device given by name (PaAlsaStreamInfo) has no index to be found by */
+    if( self->device < 0 )
+        return 0;
+
+    key->device = self->device;
+    key->hostSampleFormat = self->hostSampleFormat;
+    key->numHostChannels = self->numHostChannels;
+    key->hostInterleaved = self->hostInterleaved;
+    key->canMmap = self->canMmap;
+    key->suggestedLatency = params->suggestedLatency;
+    return 1;
+}
+
+static int PaAlsaCachedComponentConfig_Matches( const PaAlsaCachedComponentConfig *self,
+        const PaAlsaCachedComponentConfig *key )
+{
+    return self->device == key->device && self->hostSampleFormat == key->hostSampleFormat &&
+        self->numHostChannels == key->numHostChannels && self->hostInterleaved == key->hostInterleaved &&
+        self->canMmap == key->canMmap && self->suggestedLatency == key->suggestedLatency;
+}
+
+/** Fill in the key of the configuration a stream is about to negotiate, returns 0 if it can't be cached. */
+static int PaAlsaStream_GetConfigKey( const PaAlsaStream *self, const PaStreamParameters *inParams,
+        const PaStreamParameters *outParams, double sampleRate, unsigned long framesPerUserBuffer, PaAlsaCachedConfig *key )
+{
+    memset( key, 0, sizeof (*key) );
+    key->sampleRate = sampleRate;
+    key->framesPerUserBuffer = framesPerUserBuffer;
+    key->numPeriods = numPeriods_;
+    return PaAlsaStreamComponent_GetConfigKey( &self->capture, inParams, &key->capture ) &&
+        PaAlsaStreamComponent_GetConfigKey( &self->playback, outParams, &key->playback );
+}
+
+/** Set the period sizes negotiated before for the same configuration, skipping PaAlsaStream_DetermineFramesPerBuffer.
+ *
+ * Reopening a stream with the same devices and parameters otherwise probes the period sizes all over again. The cached
+ * sizes are only tested, so if the hardware no longer takes them the hardware parameters are left as they were and 0
+ * is returned, to negotiate anew.
+ */
+static int PaAlsaStream_ApplyCachedConfig( PaAlsaStream *self, const PaAlsaCachedConfig *key,
+        snd_pcm_hw_params_t *hwParamsCapture, snd_pcm_hw_params_t *hwParamsPlayback,
+        PaUtilHostBufferSizeMode *hostBufferSizeMode )
+{
+    PaAlsaHostApiRepresentation *alsaApi = self->alsaApi;
+    PaAlsaCachedConfig *config = NULL;
+    int i;
+
+    for( i = 0; i < CONFIG_CACHE_SIZE; ++i )
+    {
+        PaAlsaCachedConfig *c = &alsaApi->configCache[i];
+        if( c->used && c->sampleRate == key->sampleRate && c->framesPerUserBuffer == key->framesPerUserBuffer &&
+                c->numPeriods == key->numPeriods && PaAlsaCachedComponentConfig_Matches( &c->capture, &key->capture ) &&
+                PaAlsaCachedComponentConfig_Matches( &c->playback, &key->playback ) )
+        {
+            config = c;
+            break;
+        }
+    }
+    if( !config )
+        return 0;
+
+    if( ( self->capture.pcm && alsa_snd_pcm_hw_params_test_period_size( self->capture.pcm, hwParamsCapture,
+                    config->capture.framesPerPeriod, 0 ) < 0 ) ||
+            ( self->playback.pcm && alsa_snd_pcm_hw_params_test_period_size( self->playback.pcm, hwParamsPlayback,
+                    config->playback.framesPerPeriod, 0 ) < 0 ) )
+    {
+        config->used = 0;
+        return 0;
+    }
+
+    if( ( self->capture.pcm && alsa_snd_pcm_hw_params_set_period_size( self->capture.pcm, hwParamsCapture,
+                    config->capture.framesPerPeriod, 0 ) < 0 ) ||
+            ( self->playback.pcm && alsa_snd_pcm_hw_params_set_period_size( self->playback.pcm, hwParamsPlayback,
+                    config->playback.framesPerPeriod, 0 ) < 0 ) )
+    {
+        /* Tested fine above, so this shouldn't happen, the hardware parameters may be narrowed down though */
+        config->used = 0;
+        return 0;
+    }
+
+    PA_DEBUG(( "%s: Using cached period sizes, capture %lu, playback %lu\n", __FUNCTION__,
+                config->capture.framesPerPeriod, config->playback.framesPerPeriod ));
+    self->capture.framesPerPeriod = config->capture.framesPerPeriod;
+    self->playback.framesPerPeriod = config->playback.framesPerPeriod;
+    self->maxFramesPerHostBuffer = config->maxFramesPerHostBuffer;
+    *hostBufferSizeMode = config->hostBufferSizeMode;
+    config->lastUse = ++alsaApi->configCacheClock;
+    return 1;
+}
+
+/** Remember the period sizes PaAlsaStream_DetermineFramesPerBuffer negotiated, replacing the least recently used entry. */
+static void PaAlsaStream_CacheConfig( PaAlsaStream *self, const PaAlsaCachedConfig *key,
+        PaUtilHostBufferSizeMode hostBufferSizeMode )
+{
+    PaAlsaHostApiRepresentation *alsaApi = self->alsaApi;
+    PaAlsaCachedConfig *config = &alsaApi->configCache[0];
+    int i;
+
+    for( i = 0; i < CONFIG_CACHE_SIZE && config->used; ++i )
+    {
+        if( !alsaApi->configCache[i].used || alsaApi->configCache[i].lastUse < config->lastUse )
+            config = &alsaApi->configCache[i];
+    }
+
+    *config = *key;
+    config->used = 1;
+    config->lastUse = ++alsaApi->configCacheClock;
+    config->capture.framesPerPeriod = self->capture.pcm ? self->capture.framesPerPeriod : 0;
+    config->playback.framesPerPeriod = self->playback.pcm ? self->playback.framesPerPeriod : 0;
+    config->maxFramesPerHostBuffer = self->maxFramesPerHostBuffer;
+    config->hostBufferSizeMode = hostBufferSizeMode;
+}
+
+/** Set up ALSA stream parameters.
  *
  */
+/** Allocate the buffer a component without mmap access reads or writes through, for frames host frames. */
+static PaError PaAlsaStreamComponent_AllocateNonMmapBuffer( PaAlsaStreamComponent *self, unsigned long frames )
+{
+    PaError result = paNoError;
+
+    if( !self->pcm || self->canMmap )
+        goto error;
+
+    PaUtil_FreeMemory( self->nonMmapBuffer );
+    self->nonMmapBufferFrames = frames;
+    self->nonMmapBufferSize = self->numHostChannels * alsa_snd_pcm_format_size( self->nativeFormat, frames );
+    PA_UNLESS( self->nonMmapBuffer = PaUtil_AllocateMemory( self->nonMmapBufferSize ), paInsufficientMemory );
+
+error:
+    return result;
+}
+
 static PaError PaAlsaStream_Configure( PaAlsaStream *self, const PaStreamParameters *inParams, const PaStreamParameters*
         outParams, double sampleRate, unsigned long framesPerUserBuffer, double* inputLatency, double* outputLatency,
         PaUtilHostBufferSizeMode* hostBufferSizeMode )
 {
     PaError result = paNoError;
-    double realSr = sampleRate;
+    double realSr = sampleRate, captureSr;
     snd_pcm_hw_params_t* hwParamsCapture, * hwParamsPlayback;
+    PaAlsaCachedConfig configKey;
+    int cacheable;
+    PaStreamParameters autoInParams, autoOutParams;
+    const PaStreamParameters *periodInParams = inParams, *periodOutParams = outParams;
 
     alsa_snd_pcm_hw_params_alloca( &hwParamsCapture );
     alsa_snd_pcm_hw_params_alloca( &hwParamsPlayback );
 
     if( self->capture.pcm )
-        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->capture, inParams, self->primeBuffers, hwParamsCapture,
-                    &realSr ) );
+        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->capture, inParams, self->primeBuffers,
+                    self->convertSampleRate || self->independentClocks, hwParamsCapture, &realSr ) );
+    captureSr = realSr;
+    if( self->independentClocks )
+    {
+        /* The input is resampled to the playback clock anyway, so each device may run at its own rate */
+        realSr = sampleRate;
+        self->convertSampleRate = 0;
+    }
     if( self->playback.pcm )
-        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->playback, outParams, self->primeBuffers, hwParamsPlayback,
-                    &realSr ) );
+        PA_ENSURE( PaAlsaStreamComponent_InitialConfigure( &self->playback, outParams, self->primeBuffers,
+                    self->convertSampleRate || self->independentClocks, hwParamsPlayback, &realSr ) );
+
+    if( realSr == sampleRate )
+        self->convertSampleRate = 0;
+    if( self->independentClocks )
+    {
+        PA_DEBUG(( "%s: Compensating drift between capture at %.3f and playback at %.3f\n", __FUNCTION__,
+                    captureSr, realSr ));
+        PaUtil_InitializeCpuLoadMeasurer( &self->cpuLoadMeasurer, realSr );
+    }
+    else if( self->convertSampleRate )
+    {
+        /* Aim for periods of the duration of the user's buffers, the buffer processor adapts between them */
+        PA_DEBUG(( "%s: Converting from %.3f to the device rate %.3f\n", __FUNCTION__, sampleRate, realSr ));
+        if( framesPerUserBuffer != paFramesPerBufferUnspecified )
+            framesPerUserBuffer = (unsigned long)ceil( framesPerUserBuffer * realSr / sampleRate );
+        PaUtil_InitializeCpuLoadMeasurer( &self->cpuLoadMeasurer, realSr );
+    }
+
+    if( self->autoLatency )
+    {
+        /* The smallest periods the devices take, which the fill level is raised by */
+        if( inParams )
+        {
+            autoInParams = *inParams;
+            autoInParams.suggestedLatency = 0.;
+            periodInParams = &autoInParams;
+        }
+        autoOutParams = *outParams;
+        autoOutParams.suggestedLatency = 0.;
+        periodOutParams = &autoOutParams;
+    }
 
-    PA_ENSURE( PaAlsaStream_DetermineFramesPerBuffer( self, realSr, inParams, outParams, framesPerUserBuffer,
-                hwParamsCapture, hwParamsPlayback, hostBufferSizeMode ) );
+    cacheable = PaAlsaStream_GetConfigKey( self, periodInParams, periodOutParams, realSr, framesPerUserBuffer,
+            &configKey );
+    if( !cacheable || !PaAlsaStream_ApplyCachedConfig( self, &configKey, hwParamsCapture, hwParamsPlayback,
+                hostBufferSizeMode ) )
+    {
+        PA_ENSURE( PaAlsaStream_DetermineFramesPerBuffer( self, realSr, periodInParams, periodOutParams,
+                    framesPerUserBuffer, hwParamsCapture, hwParamsPlayback, hostBufferSizeMode ) );
+        if( cacheable )
+            PaAlsaStream_CacheConfig( self, &configKey, *hostBufferSizeMode );
+    }
 
     if( self->capture.pcm )
     {
         assert( self->capture.framesPerPeriod != 0 );
-        PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->capture, hwParamsCapture, inParams, self->primeBuffers, realSr,
-                    inputLatency ) );
+        PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->capture, hwParamsCapture, inParams, self->primeBuffers,
+                    self->timerScheduling, 0, captureSr, inputLatency ) );
         PA_DEBUG(( "%s: Capture period size: %lu, latency: %f\n", __FUNCTION__, self->capture.framesPerPeriod, *inputLatency ));
     }
     if( self->playback.pcm )
     {
         assert( self->playback.framesPerPeriod != 0 );
-        PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->playback, hwParamsPlayback, outParams, self->primeBuffers, realSr,
-                    outputLatency ) );
+        /* The device silences the frames it played, so a callback stream can play on through an underrun */
+        self->playback.runsThroughUnderruns = self->callbackMode && self->playback.canMmap && !self->primeBuffers;
+        PA_ENSURE( PaAlsaStreamComponent_FinishConfigure( &self->playback, hwParamsPlayback, outParams, self->primeBuffers,
+                    self->timerScheduling, self->autoLatency, realSr, outputLatency ) );
+        self->playback.wakeLevel = 0;
+        if( self->lowPowerOutput )
+        {
+            /* Sleep until the output has all but drained, then refill it in one go */
+            snd_pcm_uframes_t headroom = PA_MAX( (snd_pcm_uframes_t)( LOW_POWER_HEADROOM_TIME * realSr ),
+                    2 * self->playback.framesPerPeriod );
+            self->playback.wakeLevel = PA_MIN( headroom, self->playback.fillLevel - self->playback.framesPerPeriod );
+        }
         PA_DEBUG(( "%s: Playback period size: %lu, latency: %f\n", __FUNCTION__, self->playback.framesPerPeriod, *outputLatency ));
     }
 
     /* Should be exact now */
-    self->streamRepresentation.streamInfo.sampleRate = realSr;
+    self->hostSampleRate = realSr;
+    self->captureSampleRate = captureSr;
+    self->streamRepresentation.streamInfo.sampleRate = self->convertSampleRate || self->independentClocks ?
+        sampleRate : realSr;
 
     /* this will cause the two streams to automatically start/stop/prepare in sync.
      * We only need to execute these operations on one of the pair.
      * A: We don't want to do this on a blocking stream.
+     * B: Nor on one whose pcms are serviced independently, an xrun in one direction shouldn't stop the other.
      */
-    if( self->callbackMode && self->capture.pcm && self->playback.pcm )
+    if( self->callbackMode && self->capture.pcm && self->playback.pcm && !self->independentClocks )
     {
         int err = alsa_snd_pcm_link( self->capture.pcm, self->playback.pcm );
         if( err == 0 )
@@ -2759,6 +4606,10 @@ static PaError PaAlsaStream_Configure( PaAlsaStream *self, const PaStreamParamet
         /* self->threading.throttledSleepTime = (unsigned long) (minFramesPerHostBuffer / sampleRate / 4 * 1000); */
     }
 
+    /* No transfer is larger than a host buffer */
+    PA_ENSURE( PaAlsaStreamComponent_AllocateNonMmapBuffer( &self->capture, self->maxFramesPerHostBuffer ) );
+    PA_ENSURE( PaAlsaStreamComponent_AllocateNonMmapBuffer( &self->playback, self->maxFramesPerHostBuffer ) );
+
     if( self->callbackMode )
     {
         /* If the user expects a certain number of frames per callback we will either have to rely on block adaption
@@ -2784,6 +4635,76 @@ error:
     return result;
 }
 
+/** Can the user buffers of this component be the host buffers? */
+static int PaAlsaStreamComponent_CanZeroCopy( const PaAlsaStreamComponent *self, PaSampleFormat userSampleFormat )
+{
+    if( ( userSampleFormat & ~paNonInterleaved ) != self->hostSampleFormat )
+        return 0;
+    if( self->userInterleaved != self->hostInterleaved )
+        return 0;
+    /* Surplus host channels are handled by channel adaption, but only for separate channel buffers, an
+     * interleaved user frame has to be a host frame */
+    if( self->hostInterleaved && self->numUserChannels != self->numHostChannels )
+        return 0;
+    /* The callback's channels are the first ones of the device */
+    if( self->channelSelectors )
+        return 0;
+    return 1;
+}
+
+/** Decide whether the callback can be handed the ALSA buffers directly (paAlsaZeroCopy).
+ *
+ * This is possible when neither format conversion nor block adaption is needed. Otherwise the stream silently goes
+ * through the buffer processor as usual.
+ */
+static PaError PaAlsaStream_ConfigureZeroCopy( PaAlsaStream *self, PaSampleFormat inputSampleFormat,
+        PaSampleFormat outputSampleFormat, PaUtilHostBufferSizeMode hostBufferSizeMode )
+{
+    PaError result = paNoError;
+
+    self->zeroCopy = 0;
+    if( self->capture.pcm && !PaAlsaStreamComponent_CanZeroCopy( &self->capture, inputSampleFormat ) )
+        goto end;
+    if( self->playback.pcm && !PaAlsaStreamComponent_CanZeroCopy( &self->playback, outputSampleFormat ) )
+        goto end;
+    if( self->framesPerUserBuffer != paFramesPerBufferUnspecified &&
+            !( paUtilFixedHostBufferSize == hostBufferSizeMode && self->maxFramesPerHostBuffer == self->framesPerUserBuffer ) )
+        goto end;
+
+    if( self->capture.pcm && !self->capture.userInterleaved )
+    {
+        PA_UNLESS( self->capture.userBuffers = PaUtil_AllocateMemory( sizeof (void *) * self->capture.numUserChannels ),
+                paInsufficientMemory );
+    }
+    if( self->playback.pcm && !self->playback.userInterleaved )
+    {
+        PA_UNLESS( self->playback.userBuffers = PaUtil_AllocateMemory( sizeof (void *) * self->playback.numUserChannels ),
+                paInsufficientMemory );
+    }
+    self->zeroCopy = 1;
+
+end:
+    PA_DEBUG(( "%s: Zero copy callback %s\n", __FUNCTION__, self->zeroCopy ? "enabled" : "not possible" ));
+error:
+    return result;
+}
+
+/** Move the buffers the callback thread works on to the memory nodes of the CPUs it is pinned to, the arena of the
+ * buffer processor and the buffers of components without mmap access. The pages are migrated, as they were faulted in
+ * by the opening thread (PaAlsaStreamInfo::callbackCpus).
+ */
+static void PaAlsaStream_PlaceBuffers( PaAlsaStream *self )
+{
+    PaUtil_PlaceBufferProcessor( &self->bufferProcessor, self->callbackCpus, self->callbackCpuCount );
+
+    if( self->capture.nonMmapBuffer )
+        PaUtil_PlaceMemory( self->capture.nonMmapBuffer, self->capture.nonMmapBufferSize,
+                self->callbackCpus, self->callbackCpuCount );
+    if( self->playback.nonMmapBuffer )
+        PaUtil_PlaceMemory( self->playback.nonMmapBuffer, self->playback.nonMmapBufferSize,
+                self->callbackCpus, self->callbackCpuCount );
+}
+
 static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            PaStream** s,
                            const PaStreamParameters *inputParameters,
@@ -2800,12 +4721,14 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     PaSampleFormat hostInputSampleFormat = 0, hostOutputSampleFormat = 0;
     PaSampleFormat inputSampleFormat = 0, outputSampleFormat = 0;
     int numInputChannels = 0, numOutputChannels = 0;
+    const PaChannelMatrix *inputChannelMatrix = NULL, *outputChannelMatrix = NULL;
     PaTime inputLatency, outputLatency;
     /* Operate with fixed host buffer size by default, since other modes will invariably lead to block adaption */
     /* XXX: Use Bounded by default? Output tends to get stuttery with Fixed ... */
     PaUtilHostBufferSizeMode hostBufferSizeMode = paUtilFixedHostBufferSize;
 
-    if( ( streamFlags & paPlatformSpecificFlags ) != 0 )
+    if( ( streamFlags & paPlatformSpecificFlags & ~( paAlsaZeroCopy | paAlsaSharedCallbackThread | paAlsaTimerScheduling |
+                    paAlsaPreferHw | paAlsaAutoLatency | paAlsaLowPowerOutput ) ) != 0 )
         return paInvalidFlag;
 
     if( inputParameters )
@@ -2814,6 +4737,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
         numInputChannels = inputParameters->channelCount;
         inputSampleFormat = inputParameters->sampleFormat;
+        inputChannelMatrix = GetChannelMatrix( inputParameters );
     }
     if( outputParameters )
     {
@@ -2821,6 +4745,15 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
         numOutputChannels = outputParameters->channelCount;
         outputSampleFormat = outputParameters->sampleFormat;
+        outputChannelMatrix = GetChannelMatrix( outputParameters );
+    }
+
+    /* The channel matrices are applied by the buffer processor of a callback stream, without
+       converting the sample rate */
+    if( inputChannelMatrix || outputChannelMatrix )
+    {
+        PA_UNLESS( callback, paIncompatibleHostApiSpecificStreamInfo );
+        PA_UNLESS( !( streamFlags & ( paConvertSampleRate | paCompensateClockDrift ) ), paInvalidFlag );
     }
 
     /* XXX: Why do we support this anyway? */
@@ -2834,16 +4767,67 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     PA_ENSURE( PaAlsaStream_Initialize( stream, alsaHostApi, inputParameters, outputParameters, sampleRate,
                 framesPerBuffer, callback, streamFlags, userData ) );
 
-    PA_ENSURE( PaAlsaStream_Configure( stream, inputParameters, outputParameters, sampleRate, framesPerBuffer,
+    /* Batched callbacks leave the period size to the suggested latency */
+    PA_ENSURE( PaAlsaStream_Configure( stream, inputParameters, outputParameters, sampleRate,
+                ( streamFlags & paBatchCallbacks ) ? paFramesPerBufferUnspecified : framesPerBuffer,
                 &inputLatency, &outputLatency, &hostBufferSizeMode ) );
     hostInputSampleFormat = stream->capture.hostSampleFormat | (!stream->capture.hostInterleaved ? paNonInterleaved : 0);
     hostOutputSampleFormat = stream->playback.hostSampleFormat | (!stream->playback.hostInterleaved ? paNonInterleaved : 0);
 
-    PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
-                    numInputChannels, inputSampleFormat, hostInputSampleFormat,
-                    numOutputChannels, outputSampleFormat, hostOutputSampleFormat,
-                    sampleRate, streamFlags, framesPerBuffer, stream->maxFramesPerHostBuffer,
-                    hostBufferSizeMode, callback, userData ) );
+    /* Batched callbacks get a whole number of periods, streams converting the rate call
+        back with framesPerBuffer */
+    if( hostBufferSizeMode == paUtilFixedHostBufferSize && !stream->independentClocks && !stream->convertSampleRate )
+        framesPerBuffer = PaUtil_GetBatchedFramesPerUserBuffer( streamFlags, framesPerBuffer, stream->maxFramesPerHostBuffer );
+
+    if( stream->independentClocks )
+    {
+        PA_ENSURE( PaUtil_InitializeDriftCompensatingBufferProcessor( &stream->bufferProcessor,
+                        numInputChannels, inputSampleFormat, hostInputSampleFormat,
+                        numOutputChannels, outputSampleFormat, hostOutputSampleFormat,
+                        sampleRate, stream->captureSampleRate, stream->hostSampleRate, streamFlags, framesPerBuffer,
+                        stream->maxFramesPerHostBuffer, hostBufferSizeMode, callback, userData ) );
+    }
+    else if( stream->convertSampleRate )
+    {
+        PA_ENSURE( PaUtil_InitializeResamplingBufferProcessor( &stream->bufferProcessor,
+                        numInputChannels, inputSampleFormat, hostInputSampleFormat,
+                        numOutputChannels, outputSampleFormat, hostOutputSampleFormat,
+                        sampleRate, stream->hostSampleRate, streamFlags, framesPerBuffer, stream->maxFramesPerHostBuffer,
+                        hostBufferSizeMode, callback, userData ) );
+    }
+    else if( inputChannelMatrix || outputChannelMatrix )
+    {
+        PA_ENSURE( PaUtil_InitializeChannelMatrixBufferProcessor( &stream->bufferProcessor,
+                        numInputChannels, inputSampleFormat, hostInputSampleFormat, inputChannelMatrix,
+                        numOutputChannels, outputSampleFormat, hostOutputSampleFormat, outputChannelMatrix,
+                        sampleRate, streamFlags, framesPerBuffer, stream->maxFramesPerHostBuffer,
+                        hostBufferSizeMode, callback, userData ) );
+    }
+    else
+    {
+        PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
+                        numInputChannels, inputSampleFormat, hostInputSampleFormat,
+                        numOutputChannels, outputSampleFormat, hostOutputSampleFormat,
+                        sampleRate, streamFlags, framesPerBuffer, stream->maxFramesPerHostBuffer,
+                        hostBufferSizeMode, callback, userData ) );
+    }
+
+    if( ( streamFlags & paAlsaZeroCopy ) && stream->callbackMode && !stream->convertSampleRate
+            && !stream->independentClocks && !inputChannelMatrix && !outputChannelMatrix )
+    {
+        PA_ENSURE( PaAlsaStream_ConfigureZeroCopy( stream, inputSampleFormat, outputSampleFormat, hostBufferSizeMode ) );
+    }
+
+    if( stream->callbackCpus )
+        PaAlsaStream_PlaceBuffers( stream );
+
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
 
     /* Ok, buffer processor is initialized, now we can deduce it's latency */
     if( numInputChannels > 0 )
@@ -2887,9 +4871,12 @@ static void SilenceBuffer( PaAlsaStream *stream )
     const snd_pcm_channel_area_t *areas;
     snd_pcm_uframes_t frames = (snd_pcm_uframes_t)alsa_snd_pcm_avail_update( stream->playback.pcm ), offset;
 
+    if( stream->playback.fillLevel )
+        frames = PA_MIN( frames, stream->playback.fillLevel );
     alsa_snd_pcm_mmap_begin( stream->playback.pcm, &areas, &offset, &frames );
     alsa_snd_pcm_areas_silence( areas, offset, stream->playback.numHostChannels, frames, stream->playback.nativeFormat );
     alsa_snd_pcm_mmap_commit( stream->playback.pcm, offset, frames );
+    stream->playback.framesTransferred += frames;
 }
 
 /** Start/prepare pcm(s) for streaming.
@@ -2905,6 +4892,8 @@ static PaError AlsaStart( PaAlsaStream *stream, int priming )
 {
     PaError result = paNoError;
 
+    /* Preparing resets the position of the devices */
+    stream->capture.framesTransferred = stream->playback.framesTransferred = 0;
     if( stream->playback.pcm )
     {
         if( stream->callbackMode )
@@ -2976,6 +4965,50 @@ error:
 }
 #endif
 
+/** Start the threads converting samples alongside the callback thread (PaAlsaStreamInfo::conversionThreadCount). */
+static PaError StartConversionThreads( PaAlsaStream *stream )
+{
+    PaError result = paNoError;
+
+    if( stream->conversionThreadCount > 1 )
+    {
+        PA_ENSURE( PaUtil_CreateWorkerPool( &stream->workerPool, stream->conversionThreadCount, stream->rtSched,
+                    stream->callbackCpus, stream->callbackCpuCount ) );
+        result = PaUtil_SetBufferProcessorWorkerPool( &stream->bufferProcessor, stream->workerPool );
+        if( paNoError != result )
+        {
+            PaUtil_DestroyWorkerPool( stream->workerPool );
+            stream->workerPool = NULL;
+        }
+    }
+
+error:
+    return result;
+}
+
+/** Stop the threads started by StartConversionThreads, once the callback thread doesn't process anymore. */
+static void StopConversionThreads( PaAlsaStream *stream )
+{
+    if( stream->workerPool )
+    {
+        PaUtil_SetBufferProcessorWorkerPool( &stream->bufferProcessor, NULL );
+        PaUtil_DestroyWorkerPool( stream->workerPool );
+        stream->workerPool = NULL;
+    }
+}
+
+/** The period the callback thread wakes up with, the shorter one of a full-duplex stream. */
+static snd_pcm_uframes_t GetCallbackFramesPerPeriod( const PaAlsaStream *stream )
+{
+    snd_pcm_uframes_t framesPerPeriod = stream->capture.pcm ? stream->capture.framesPerPeriod
+            : stream->playback.framesPerPeriod;
+
+    if( stream->capture.pcm && stream->playback.pcm && stream->playback.framesPerPeriod < framesPerPeriod )
+        framesPerPeriod = stream->playback.framesPerPeriod;
+
+    return framesPerPeriod;
+}
+
 static PaError StartStream( PaStream *s )
 {
     PaError result = paNoError;
@@ -2987,10 +5020,42 @@ static PaError StartStream( PaStream *s )
 
     /* Set now, so we can test for activity further down */
     stream->isActive = 1;
+    stream->pausedByDrop = 0;
 
     if( stream->callbackMode )
     {
-        PA_ENSURE( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., stream->rtSched ) );
+        PaUnixThreadScheduling scheduling;
+
+        /* The callback thread wakes up once per period */
+        scheduling.realTime = stream->rtSched;
+        scheduling.period = GetCallbackFramesPerPeriod( stream ) / stream->hostSampleRate;
+        scheduling.runtime = scheduling.period * DEADLINE_RUNTIME_RATIO;
+        scheduling.runawayProtection = stream->runawayProtection;
+
+        PA_ENSURE( StartConversionThreads( stream ) );
+        if( stream->manualProcessing )
+        {
+            /* Pa_ProcessStream takes it from here, on the application's thread */
+            stream->manualCallbackResult = paContinue;
+            stream->manualCbFlags = 0;
+            PA_ENSURE( AlsaStart( stream, 0 ) );
+            streamStarted = 1;
+        }
+        else if( stream->shareCallbackThread )
+        {
+            /* The group thread is already running, so start the pcms here */
+            PA_ENSURE( AlsaStart( stream, 0 ) );
+            streamStarted = 1;
+            PA_ENSURE( PaAlsaCallbackGroup_Join( stream, &scheduling ) );
+        }
+        else
+        {
+            /* A stop of the previous run may have left its wakeup in the pipe */
+            PaAlsaStream_DrainStopPipe( stream );
+            stream->stopRequested = 0;
+            PA_ENSURE( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., &scheduling,
+                        stream->callbackCpus, stream->callbackCpuCount ) );
+        }
     }
     else
     {
@@ -3003,13 +5068,27 @@ end:
 error:
     if( streamStarted )
     {
-        AbortStream( stream );
+        AlsaStop( stream, 1 );
     }
+    StopConversionThreads( stream );
     stream->isActive = 0;
 
     goto end;
 }
 
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
 /** Stop PCM handle, either softly or abruptly.
  */
 static PaError AlsaStop( PaAlsaStream *stream, int abort )
@@ -3071,10 +5150,11 @@ error:
 
 /** Stop or abort stream.
  *
- * If a stream is in callback mode we will have to inspect whether the background thread has
- * finished, or we will have to take it out. In either case we join the thread before
- * returning. In blocking mode, we simply tell ALSA to stop abruptly (abort) or finish
- * buffers (drain)
+ * If a stream is in callback mode we wake the background thread through the stop pipe, it
+ * flushes (or drops if abort) the output and exits, and we join it before returning. The
+ * thread is never cancelled, so it can't be interrupted in the middle of processing. A stream sharing a callback thread (paAlsaSharedCallbackThread) waits for the
+ * thread to let go of it instead. In blocking mode, we simply tell ALSA to stop abruptly
+ * (abort) or finish buffers (drain)
  *
  * Stream will be considered inactive (!PaAlsaStream::isActive) after a call to this function
  */
@@ -3085,16 +5165,39 @@ static PaError RealStop( PaAlsaStream *stream, int abort )
     /* First deal with the callback thread, cancelling and/or joining
      * it if necessary
      */
-    if( stream->callbackMode )
+    if( stream->member.group )
+    {
+        PA_ENSURE( PaAlsaCallbackGroup_Leave( stream, abort ) );
+        StopConversionThreads( stream );
+        stream->callback_finished = 0;
+    }
+    else if( stream->manualProcessing )
+    {
+        /* Unless Pa_ProcessStream already finished it, stop the pcms and notify as the callback thread would */
+        if( stream->isActive )
+        {
+            stream->callbackAbort = 1;
+            OnExit( stream );
+        }
+        StopConversionThreads( stream );
+        stream->callback_finished = 0;
+    }
+    else if( stream->callbackMode )
     {
         PaError threadRes;
+        char c = 0;
         stream->callbackAbort = abort;
+        stream->stopRequested = 1;
 
         if( !abort )
         {
             PA_DEBUG(( "Stopping callback\n" ));
         }
-        PA_ENSURE( PaUnixThread_Terminate( &stream->thread, !abort, &threadRes ) );
+        if( write( stream->stopFds[1], &c, 1 ) < 0 )
+        {
+            /* The pipe is only written to once per run, it can't be full */
+        }
+        PA_ENSURE( PaUnixThread_Terminate( &stream->thread, 1, &threadRes ) );
         if( threadRes != paNoError )
         {
             PA_DEBUG(( "Callback thread returned: %d\n", threadRes ));
@@ -3103,6 +5206,7 @@ static PaError RealStop( PaAlsaStream *stream, int abort )
         if( watchdogRes != paNoError )
             PA_DEBUG(( "Watchdog thread returned: %d\n", watchdogRes ));
 #endif
+        StopConversionThreads( stream );
 
         stream->callback_finished = 0;
     }
@@ -3148,6 +5252,83 @@ static PaError IsStreamActive( PaStream *s )
     return stream->isActive;
 }
 
+/** Pause or resume a pcm of a blocking stream. Only running pcms are paused, an output pcm which hasn't been
+ * written to yet is merely prepared and starts with the next write anyway.
+ */
+static int AlsaPauseComponent( PaAlsaStreamComponent *self, int enable )
+{
+    snd_pcm_state_t state;
+
+    if( !self->pcm )
+        return 0;
+
+    state = alsa_snd_pcm_state( self->pcm );
+    if( enable ? state != SND_PCM_STATE_RUNNING : state != SND_PCM_STATE_PAUSED )
+        return 0;
+
+    return alsa_snd_pcm_pause( self->pcm, enable );
+}
+
+/** Pause a stream, keeping its pcms configured.
+ *
+ * A callback thread keeps servicing the pcms while the buffer processor doesn't call the callback, pausing the
+ * pcms underneath the thread would stall its poll(). The pcms of a blocking stream are paused with
+ * snd_pcm_pause(), or dropped and prepared again on resume if the hardware can't pause.
+ */
+static PaError PauseStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    int err;
+
+    if( stream->callbackMode )
+    {
+        PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+        return paNoError;
+    }
+
+    err = AlsaPauseComponent( &stream->playback, 1 );
+    if( err >= 0 && !stream->pcmsSynced )
+        err = AlsaPauseComponent( &stream->capture, 1 );
+
+    if( err < 0 )
+    {
+        PA_DEBUG(( "%s: pausing failed (%s), dropping frames\n", __FUNCTION__, alsa_snd_strerror( err ) ));
+        PA_ENSURE( AlsaStop( stream, 1 ) );
+        stream->pausedByDrop = 1;
+    }
+
+error:
+    return result;
+}
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+
+    if( stream->callbackMode )
+    {
+        PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+        return paNoError;
+    }
+
+    if( stream->pausedByDrop )
+    {
+        PA_ENSURE( AlsaStart( stream, 0 ) );
+        stream->pausedByDrop = 0;
+    }
+    else
+    {
+        ENSURE_( AlsaPauseComponent( &stream->playback, 0 ), paUnanticipatedHostError );
+        if( !stream->pcmsSynced )
+            ENSURE_( AlsaPauseComponent( &stream->capture, 0 ), paUnanticipatedHostError );
+    }
+
+error:
+    return result;
+}
+
 static PaTime GetStreamTime( PaStream *s )
 {
     PaAlsaStream *stream = (PaAlsaStream*)s;
@@ -3231,71 +5412,287 @@ static int GetExactSampleRate( snd_pcm_hw_params_t *hwParams, double *sampleRate
 
 /* Utility functions for blocking/callback interfaces */
 
-/* Atomic restart of stream (we don't want the intermediate state visible) */
+/* Atomic restart of stream (we don't want the intermediate state visible)
+ *
+ * Only the reading and writing threads of a blocking stream can restart it concurrently, the callback thread is the
+ * only one restarting a callback stream and doesn't take the mutex, so it can't be held up by a thread of the
+ * application.
+ */
 static PaError AlsaRestart( PaAlsaStream *stream )
 {
     PaError result = paNoError;
+    int locked = 0;
 
-    PA_ENSURE( PaUnixMutex_Lock( &stream->stateMtx ) );
+    if( !stream->callbackMode )
+    {
+        PA_ENSURE( PaUnixMutex_Lock( &stream->stateMtx ) );
+        locked = 1;
+    }
     PA_ENSURE( AlsaStop( stream, 0 ) );
     PA_ENSURE( AlsaStart( stream, 0 ) );
 
     PA_DEBUG(( "%s: Restarted audio\n", __FUNCTION__ ));
 
 error:
-    PA_ENSURE( PaUnixMutex_Unlock( &stream->stateMtx ) );
+    if( locked )
+        ASSERT_CALL_( PaUnixMutex_Unlock( &stream->stateMtx ), paNoError );
 
     return result;
 }
 
-/** Recover from xrun state.
+/** Query the status of the component's device, to be used until the next wakeup of the callback thread.
  *
+ * For hardware devices whose driver reports an audio timestamp the delay is derived from the time of the audio
+ * played or captured so far and the frames transferred, which is more accurate than the hardware pointer the
+ * delay is otherwise counted from.
  */
-static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
+static PaError PaAlsaStreamComponent_UpdateStatus( PaAlsaStreamComponent *self, double sampleRate )
 {
     PaError result = paNoError;
-    snd_pcm_status_t *st;
-    PaTime now = PaUtil_GetTime();
-    snd_timestamp_t t;
-    int restartAlsa = 0; /* do not restart Alsa by default */
+    snd_htimestamp_t ts;
 
-    alsa_snd_pcm_status_alloca( &st );
+    self->statusValid = 0;
+    ENSURE_( alsa_snd_pcm_status( self->pcm, self->status ), paUnanticipatedHostError );
+    self->statusValid = 1;
+    self->statusFrames = self->framesTransferred;
 
-    if( self->playback.pcm )
+    alsa_snd_pcm_status_get_htstamp( self->status, &ts );
+    self->statusTime = ts.tv_sec + ts.tv_nsec / 1e9;
+    self->statusDelay = alsa_snd_pcm_status_get_delay( self->status ) / sampleRate;
+
+    if( !self->deviceIsPlug && alsa_snd_pcm_status_get_audio_htstamp != NULL &&
+            SND_PCM_STATE_RUNNING == alsa_snd_pcm_status_get_state( self->status ) )
     {
-        alsa_snd_pcm_status( self->playback.pcm, st );
-        if( alsa_snd_pcm_status_get_state( st ) == SND_PCM_STATE_XRUN )
-        {
-            alsa_snd_pcm_status_get_trigger_tstamp( st, &t );
-            self->underrun = now * 1000 - ( (PaTime)t.tv_sec * 1000 + (PaTime)t.tv_usec / 1000 );
+        PaTime audioTime, transferredTime, delay;
 
-            if( !self->playback.canMmap )
-            {
-                if( alsa_snd_pcm_recover( self->playback.pcm, -EPIPE, 0 ) < 0 )
-                {
-                    PA_DEBUG(( "%s: [playback] non-MMAP-PCM failed recovering from XRUN, will restart Alsa\n", __FUNCTION__ ));
-                    ++ restartAlsa; /* did not manage to recover */
-                }
-            }
-            else
-                ++ restartAlsa; /* always restart MMAPed device */
-        }
+        alsa_snd_pcm_status_get_audio_htstamp( self->status, &ts );
+        audioTime = ts.tv_sec + ts.tv_nsec / 1e9;
+        transferredTime = self->framesTransferred / sampleRate;
+        delay = StreamDirection_Out == self->streamDir ? transferredTime - audioTime : audioTime - transferredTime;
+
+        /* Drivers without audio timestamps leave them 0, don't trust one that is further off than a period either */
+        if( audioTime > 0. && fabs( delay - self->statusDelay ) < self->framesPerPeriod / sampleRate )
+            self->statusDelay = delay;
     }
-    if( self->capture.pcm )
-    {
-        alsa_snd_pcm_status( self->capture.pcm, st );
-        if( alsa_snd_pcm_status_get_state( st ) == SND_PCM_STATE_XRUN )
-        {
-            alsa_snd_pcm_status_get_trigger_tstamp( st, &t );
-            self->overrun = now * 1000 - ((PaTime) t.tv_sec * 1000 + (PaTime) t.tv_usec / 1000);
 
-            if (!self->capture.canMmap)
-            {
-                if (alsa_snd_pcm_recover( self->capture.pcm, -EPIPE, 0 ) < 0)
-                {
-                    PA_DEBUG(( "%s: [capture] non-MMAP-PCM failed recovering from XRUN, will restart Alsa\n", __FUNCTION__ ));
+error:
+    return result;
+}
+
+/** Get the status of the component's device, querying it if that hasn't been done since the last wakeup. */
+static PaError PaAlsaStreamComponent_GetStatus( PaAlsaStreamComponent *self, double sampleRate )
+{
+    if( self->statusValid )
+        return paNoError;
+    return PaAlsaStreamComponent_UpdateStatus( self, sampleRate );
+}
+
+/** Make the next use of the status of the stream's devices query them anew, at a wakeup or once they were restarted. */
+static void PaAlsaStream_InvalidateStatus( PaAlsaStream *self )
+{
+    self->capture.statusValid = self->playback.statusValid = 0;
+}
+
+/** Reopen the component on its fallback device, its own device having gone away.
+ *
+ * The fallback is configured like the device it replaces, with the same access, sample format, channels, rate and
+ * period size, so that the buffers of the component and the buffer processor of the stream carry on unchanged; only
+ * the size of the hardware buffer may differ. The old device is closed once the fallback is set up, it is up to the
+ * caller to restart the stream. A component fails over once, its fallback device is then cleared.
+ */
+static PaError PaAlsaStreamComponent_FailOver( PaAlsaStreamComponent *self, PaAlsaStream *stream, double sampleRate )
+{
+    PaError result = paNoError;
+    snd_pcm_t *oldPcm = self->pcm;
+    snd_pcm_uframes_t oldBufferSize = self->alsaBufferSize, oldFillLevel = self->fillLevel;
+    snd_pcm_uframes_t bufferSize = self->alsaBufferSize;
+    snd_pcm_hw_params_t *hwParams;
+    snd_pcm_access_t accessMode;
+    unsigned int nfds;
+    double sr = 0.;
+    int ret;
+
+    alsa_snd_pcm_hw_params_alloca( &hwParams );
+    PA_DEBUG(( "%s: Failing %s over to %s\n", __FUNCTION__, StreamDirection_In == self->streamDir ? "capture" :
+                "playback", self->fallbackDevice ));
+
+    /* Don't wait for a busy fallback, the stream is silent meanwhile */
+    if( (ret = OpenPcm( &self->pcm, self->fallbackDevice, NULL, StreamDirection_In == self->streamDir ? SND_PCM_STREAM_CAPTURE :
+                    SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK, 0 )) < 0 )
+    {
+        self->pcm = oldPcm;
+        ENSURE_( ret, -EBUSY == ret ? paDeviceUnavailable : paBadIODeviceCombination );
+    }
+    ENSURE_( alsa_snd_pcm_nonblock( self->pcm, 0 ), paUnanticipatedHostError );
+
+    if( self->canMmap )
+        accessMode = self->hostInterleaved ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_MMAP_NONINTERLEAVED;
+    else
+        accessMode = self->hostInterleaved ? SND_PCM_ACCESS_RW_INTERLEAVED : SND_PCM_ACCESS_RW_NONINTERLEAVED;
+
+    ENSURE_( alsa_snd_pcm_hw_params_any( self->pcm, hwParams ), paUnanticipatedHostError );
+    ENSURE_( alsa_snd_pcm_hw_params_set_periods_integer( self->pcm, hwParams ), paUnanticipatedHostError );
+    ENSURE_( alsa_snd_pcm_hw_params_set_access( self->pcm, hwParams, accessMode ), paSampleFormatNotSupported );
+    ENSURE_( alsa_snd_pcm_hw_params_set_format( self->pcm, hwParams, self->nativeFormat ), paSampleFormatNotSupported );
+    ENSURE_( alsa_snd_pcm_hw_params_set_channels( self->pcm, hwParams, self->numHostChannels ), paInvalidChannelCount );
+    PA_ENSURE( SetApproximateSampleRate( self->pcm, hwParams, sampleRate ) );
+    ENSURE_( GetExactSampleRate( hwParams, &sr ), paUnanticipatedHostError );
+    PA_UNLESS( sr == sampleRate, paInvalidSampleRate );
+    ENSURE_( alsa_snd_pcm_hw_params_set_period_size( self->pcm, hwParams, self->framesPerPeriod, 0 ),
+            paUnanticipatedHostError );
+    if( self->fillLevel )
+    {
+        PA_ENSURE( PaAlsaStreamComponent_DisablePeriodWakeup( self, hwParams ) );
+    }
+    ENSURE_( alsa_snd_pcm_hw_params_set_buffer_size_near( self->pcm, hwParams, &bufferSize ), paUnanticipatedHostError );
+    ENSURE_( alsa_snd_pcm_hw_params( self->pcm, hwParams ), paUnanticipatedHostError );
+    if( alsa_snd_pcm_hw_params_get_buffer_size != NULL )
+    {
+        ENSURE_( alsa_snd_pcm_hw_params_get_buffer_size( hwParams, &bufferSize ), paUnanticipatedHostError );
+    }
+
+    self->alsaBufferSize = bufferSize;
+    self->fillLevel = PA_MIN( self->fillLevel, bufferSize );
+    self->runsThroughUnderruns = self->runsThroughUnderruns && self->canMmap;
+    PA_ENSURE( PaAlsaStreamComponent_ConfigureSoftware( self, stream->primeBuffers ) );
+
+    /* The pollfds of the stream must hold those of the fallback */
+    nfds = alsa_snd_pcm_poll_descriptors_count( self->pcm );
+    if( nfds > self->nfds )
+    {
+        struct pollfd *pfds;
+        PA_UNLESS( pfds = (struct pollfd*)PaUtil_AllocateMemory( ( stream->capture.nfds + stream->playback.nfds -
+                        self->nfds + nfds + 1 ) * sizeof( struct pollfd ) ), paInsufficientMemory );
+        PaUtil_FreeMemory( stream->pfds );
+        stream->pfds = pfds;
+    }
+    self->nfds = nfds;
+
+    /* Closing the old device unlinks it, the fallback doesn't share the clock of the other direction */
+    alsa_snd_pcm_close( oldPcm );
+    stream->pcmsSynced = 0;
+    self->statusValid = 0;
+    self->device = paUseHostApiSpecificDeviceSpecification;
+    self->deviceIsPlug = strncmp( "hw:", self->fallbackDevice, 3 ) != 0;
+    self->useReventFix = self->deviceIsPlug && stream->alsaApi->alsaLibVersion < ALSA_VERSION_INT( 1, 0, 16 );
+    PaUtil_FreeMemory( self->fallbackDevice );
+    self->fallbackDevice = NULL;
+
+end:
+    return result;
+
+error:
+    if( self->pcm != oldPcm )
+    {
+        alsa_snd_pcm_close( self->pcm );
+        self->pcm = oldPcm;
+    }
+    self->alsaBufferSize = oldBufferSize;
+    self->fillLevel = oldFillLevel;
+    goto end;
+}
+
+/** Fail the component over to its fallback device when its own device went away, which is the case when its
+ * status can't be queried or says it was disconnected.
+ *
+ * @param failedOver Return whether the component is now on its fallback device.
+ */
+static PaError PaAlsaStream_HandleDisconnect( PaAlsaStream *self, PaAlsaStreamComponent *component, double sampleRate,
+        int *failedOver )
+{
+    PaError result = PaAlsaStreamComponent_UpdateStatus( component, sampleRate );
+
+    *failedOver = 0;
+    if( !component->fallbackDevice || ( paNoError == result &&
+                SND_PCM_STATE_DISCONNECTED != alsa_snd_pcm_status_get_state( component->status ) ) )
+        return result;
+
+    PA_ENSURE( PaAlsaStreamComponent_FailOver( component, self, sampleRate ) );
+    *failedOver = 1;
+
+error:
+    return result;
+}
+
+/** Raise the fill level of the output of a paAlsaAutoLatency stream by a period after an underrun, up to the suggested
+ * latency of the output, and report the latency in the stream's info. The device carries on with its configuration.
+ */
+static void PaAlsaStream_RaiseOutputLatency( PaAlsaStream *self )
+{
+    PaAlsaStreamComponent *playback = &self->playback;
+    snd_pcm_uframes_t fillLevel;
+
+    if( !self->autoLatency || playback->fillLevel >= playback->maxFillLevel )
+        return;
+
+    fillLevel = PA_MIN( playback->fillLevel + playback->framesPerPeriod, playback->maxFillLevel );
+    self->streamRepresentation.streamInfo.outputLatency += (PaTime)( fillLevel - playback->fillLevel ) / self->hostSampleRate;
+    playback->fillLevel = fillLevel;
+    PA_DEBUG(( "%s: Output fill level raised to %lu frames\n", __FUNCTION__, (unsigned long)fillLevel ));
+}
+
+/** Recover from xrun state.
+ *
+ * A component whose device went away is failed over to its fallback device, if it has one, and the stream restarted.
+ * An output that runsThroughUnderruns doesn't get here on underruns, see PaAlsaStreamComponent_SkipUnderrun().
+ */
+static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
+{
+    PaError result = paNoError;
+    PaTime now = PaUtil_GetTime();
+    snd_timestamp_t t;
+    int restartAlsa = 0; /* do not restart Alsa by default */
+    int failedOver;
+
+    if( self->playback.pcm )
+    {
+        PA_ENSURE( PaAlsaStream_HandleDisconnect( self, &self->playback, self->hostSampleRate, &failedOver ) );
+        if( failedOver )
+        {
+            /* Report the gap as an underrun */
+            self->underrun = PA_MAX( ( PaUtil_GetTime() - now ) * 1000, 1. );
+            ++ restartAlsa;
+        }
+        else if( alsa_snd_pcm_status_get_state( self->playback.status ) == SND_PCM_STATE_XRUN )
+        {
+            alsa_snd_pcm_status_get_trigger_tstamp( self->playback.status, &t );
+            self->underrun = now * 1000 - ( (PaTime)t.tv_sec * 1000 + (PaTime)t.tv_usec / 1000 );
+            PaAlsaStream_RaiseOutputLatency( self );
+
+            if( !self->playback.canMmap )
+            {
+                if( alsa_snd_pcm_recover( self->playback.pcm, -EPIPE, 0 ) < 0 )
+                {
+                    PA_DEBUG(( "%s: [playback] non-MMAP-PCM failed recovering from XRUN, will restart Alsa\n", __FUNCTION__ ));
+                    ++ restartAlsa; /* did not manage to recover */
+                }
+                self->playback.framesTransferred = 0;
+            }
+            else
+                ++ restartAlsa; /* always restart MMAPed device */
+        }
+    }
+    if( self->capture.pcm )
+    {
+        PA_ENSURE( PaAlsaStream_HandleDisconnect( self, &self->capture, self->captureSampleRate, &failedOver ) );
+        if( failedOver )
+        {
+            self->overrun = PA_MAX( ( PaUtil_GetTime() - now ) * 1000, 1. );
+            ++ restartAlsa;
+        }
+        else if( alsa_snd_pcm_status_get_state( self->capture.status ) == SND_PCM_STATE_XRUN )
+        {
+            alsa_snd_pcm_status_get_trigger_tstamp( self->capture.status, &t );
+            self->overrun = now * 1000 - ((PaTime) t.tv_sec * 1000 + (PaTime) t.tv_usec / 1000);
+
+            if (!self->capture.canMmap)
+            {
+                if (alsa_snd_pcm_recover( self->capture.pcm, -EPIPE, 0 ) < 0)
+                {
+                    PA_DEBUG(( "%s: [capture] non-MMAP-PCM failed recovering from XRUN, will restart Alsa\n", __FUNCTION__ ));
                     ++ restartAlsa; /* did not manage to recover */
                 }
+                self->capture.framesTransferred = 0;
             }
             else
                 ++ restartAlsa; /* always restart MMAPed device */
@@ -3305,10 +5702,13 @@ static PaError PaAlsaStream_HandleXrun( PaAlsaStream *self )
     if( restartAlsa )
     {
         PA_DEBUG(( "%s: restarting Alsa to recover from XRUN\n", __FUNCTION__ ));
-        PA_ENSURE( AlsaRestart( self ) );
+        result = AlsaRestart( self );
+        PA_PROBE1( xrun_recovery, result );
+        PA_ENSURE( result );
     }
 
 end:
+    PaAlsaStream_InvalidateStatus( self );
     return result;
 error:
     goto end;
@@ -3317,12 +5717,11 @@ error:
 /** Decide if we should continue polling for specified direction, eventually adjust the poll timeout.
  *
  */
-static PaError ContinuePoll( const PaAlsaStream *stream, StreamDirection streamDir, int *pollTimeout, int *continuePoll )
+static PaError ContinuePoll( PaAlsaStream *stream, StreamDirection streamDir, int *pollTimeout, int *continuePoll )
 {
     PaError result = paNoError;
     snd_pcm_sframes_t delay, margin;
-    int err;
-    const PaAlsaStreamComponent *component = NULL, *otherComponent = NULL;
+    PaAlsaStreamComponent *component = NULL, *otherComponent = NULL;
 
     *continuePoll = 1;
 
@@ -3337,18 +5736,15 @@ static PaError ContinuePoll( const PaAlsaStream *stream, StreamDirection streamD
         otherComponent = &stream->capture;
     }
 
-    /* ALSA docs say that negative delay should indicate xrun, but in my experience alsa_snd_pcm_delay returns -EPIPE */
-    if( ( err = alsa_snd_pcm_delay( otherComponent->pcm, &delay ) ) < 0 )
+    /* The status is queried anew for each poll, the last one serves the callback's time info as well */
+    PA_ENSURE( PaAlsaStreamComponent_UpdateStatus( otherComponent, StreamDirection_In == streamDir ?
+                stream->hostSampleRate : stream->captureSampleRate ) );
+    if( alsa_snd_pcm_status_get_state( otherComponent->status ) == SND_PCM_STATE_XRUN )
     {
-        if( err == -EPIPE )
-        {
-            /* Xrun */
-            *continuePoll = 0;
-            goto error;
-        }
-
-        ENSURE_( err, paUnanticipatedHostError );
+        *continuePoll = 0;
+        goto error;
     }
+    delay = alsa_snd_pcm_status_get_delay( otherComponent->status );
 
     if( StreamDirection_Out == streamDir )
     {
@@ -3394,43 +5790,33 @@ static void OnExit( void *data )
     {
         stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
     }
+    stream->callbackCpu = -1;
     stream->isActive = 0;
 }
 
+/** Fill in the time info of the callback from the status of the devices.
+ *
+ * The status is queried once per wakeup, for the host buffers after the first one the delays are adjusted by the
+ * frames transferred since.
+ */
 static void CalculateTimeInfo( PaAlsaStream *stream, PaStreamCallbackTimeInfo *timeInfo )
 {
-    snd_pcm_status_t *capture_status, *playback_status;
-    snd_timestamp_t capture_timestamp, playback_timestamp;
     PaTime capture_time = 0., playback_time = 0.;
 
-    alsa_snd_pcm_status_alloca( &capture_status );
-    alsa_snd_pcm_status_alloca( &playback_status );
-
-    if( stream->capture.pcm )
+    if( stream->capture.pcm && paNoError == PaAlsaStreamComponent_GetStatus( &stream->capture, stream->captureSampleRate ) )
     {
-        snd_pcm_sframes_t capture_delay;
+        PaAlsaStreamComponent *capture = &stream->capture;
 
-        alsa_snd_pcm_status( stream->capture.pcm, capture_status );
-        alsa_snd_pcm_status_get_tstamp( capture_status, &capture_timestamp );
-
-        capture_time = capture_timestamp.tv_sec +
-            ( (PaTime)capture_timestamp.tv_usec / 1000000.0 );
+        capture_time = capture->statusTime;
         timeInfo->currentTime = capture_time;
-
-        capture_delay = alsa_snd_pcm_status_get_delay( capture_status );
-        timeInfo->inputBufferAdcTime = timeInfo->currentTime -
-            (PaTime)capture_delay / stream->streamRepresentation.streamInfo.sampleRate;
+        timeInfo->inputBufferAdcTime = capture_time - capture->statusDelay +
+            (PaTime)( capture->framesTransferred - capture->statusFrames ) / stream->captureSampleRate;
     }
-    if( stream->playback.pcm )
+    if( stream->playback.pcm && paNoError == PaAlsaStreamComponent_GetStatus( &stream->playback, stream->hostSampleRate ) )
     {
-        snd_pcm_sframes_t playback_delay;
-
-        alsa_snd_pcm_status( stream->playback.pcm, playback_status );
-        alsa_snd_pcm_status_get_tstamp( playback_status, &playback_timestamp );
-
-        playback_time = playback_timestamp.tv_sec +
-            ((PaTime)playback_timestamp.tv_usec / 1000000.0);
+        PaAlsaStreamComponent *playback = &stream->playback;
 
+        playback_time = playback->statusTime;
         if( stream->capture.pcm ) /* Full duplex */
         {
             /* Hmm, we have both a playback and a capture timestamp.
@@ -3441,9 +5827,8 @@ static void CalculateTimeInfo( PaAlsaStream *stream, PaStreamCallbackTimeInfo *t
         else
             timeInfo->currentTime = playback_time;
 
-        playback_delay = alsa_snd_pcm_status_get_delay( playback_status );
-        timeInfo->outputBufferDacTime = timeInfo->currentTime +
-            (PaTime)playback_delay / stream->streamRepresentation.streamInfo.sampleRate;
+        timeInfo->outputBufferDacTime = playback_time + playback->statusDelay +
+            (PaTime)( playback->framesTransferred - playback->statusFrames ) / stream->hostSampleRate;
     }
 }
 
@@ -3473,7 +5858,8 @@ static PaError PaAlsaStreamComponent_EndProcessing( PaAlsaStreamComponent *self,
         else
         {
             void *bufs[self->numHostChannels];
-            int bufsize = alsa_snd_pcm_format_size( self->nativeFormat, self->framesPerPeriod + 1 );
+            /* The channels as PaAlsaStreamComponent_RegisterChannels laid them out */
+            unsigned int bufsize = self->nonMmapBufferSize / self->numHostChannels;
             unsigned char *buffer = self->nonMmapBuffer;
             int i;
             for( i = 0; i < self->numHostChannels; ++i )
@@ -3488,13 +5874,14 @@ static PaError PaAlsaStreamComponent_EndProcessing( PaAlsaStreamComponent *self,
     if( self->canMmap )
         res = alsa_snd_pcm_mmap_commit( self->pcm, self->offset, numFrames );
 
-    if( res == -EPIPE || res == -ESTRPIPE )
+    if( res == -EPIPE || res == -ESTRPIPE || ( res == -ENODEV && self->fallbackDevice ) )
     {
         *xrun = 1;
     }
     else
     {
         ENSURE_( res, paUnanticipatedHostError );
+        self->framesTransferred += numFrames;
     }
 
 end:
@@ -3604,13 +5991,36 @@ error:
 /** Update the number of available frames.
  *
  */
+/** Catch up with an output that played on through an underrun (runsThroughUnderruns), instead of restarting the stream.
+ *
+ * The device went past the frames written into those the kernel had silenced. The application pointer is moved forward
+ * past the frames missed and one period more, which are silent too, so the frames written next are again a period ahead
+ * of the device, and a capture linked to the output keeps running. The frames skipped are added to underrunFrames.
+ *
+ * @param framesAvail The frames available according to snd_pcm_avail_update(), more than the buffer holds, updated.
+ */
+static PaError PaAlsaStreamComponent_SkipUnderrun( PaAlsaStreamComponent *self, snd_pcm_sframes_t *framesAvail )
+{
+    PaError result = paNoError;
+    snd_pcm_sframes_t skip = *framesAvail - (snd_pcm_sframes_t)self->alsaBufferSize + self->framesPerPeriod, skipped;
+
+    skip = PA_MIN( skip, *framesAvail );
+    ENSURE_( skipped = alsa_snd_pcm_forward( self->pcm, skip ), paUnanticipatedHostError );
+    self->underrunFrames += skipped;
+    *framesAvail -= skipped;
+
+error:
+    return result;
+}
+
 static PaError PaAlsaStreamComponent_GetAvailableFrames( PaAlsaStreamComponent *self, unsigned long *numFrames, int *xrunOccurred )
 {
     PaError result = paNoError;
     snd_pcm_sframes_t framesAvail = alsa_snd_pcm_avail_update( self->pcm );
     *xrunOccurred = 0;
 
-    if( -EPIPE == framesAvail )
+    /* A device that went away is recovered from as an xrun by failing over to the fallback device */
+    if( -EPIPE == framesAvail || ( -ENODEV == framesAvail && self->fallbackDevice ) )
     {
         *xrunOccurred = 1;
         framesAvail = 0;
@@ -3620,6 +6030,18 @@ static PaError PaAlsaStreamComponent_GetAvailableFrames( PaAlsaStreamComponent *
         ENSURE_( framesAvail, paUnanticipatedHostError );
     }
 
+    if( self->runsThroughUnderruns && (snd_pcm_uframes_t)framesAvail > self->alsaBufferSize )
+    {
+        PA_ENSURE( PaAlsaStreamComponent_SkipUnderrun( self, &framesAvail ) );
+    }
+
+    if( self->fillLevel && StreamDirection_Out == self->streamDir )
+    {
+        /* Don't fill a timer scheduled buffer beyond the latency asked for */
+        snd_pcm_sframes_t queued = self->alsaBufferSize - framesAvail;
+        framesAvail = PA_MAX( (snd_pcm_sframes_t)self->fillLevel - queued, 0 );
+    }
+
     *numFrames = framesAvail;
 
 error:
@@ -3693,6 +6115,18 @@ error:
  * @param available The returned number of frames
  * @param xrunOccurred Return whether an xrun has occurred
  */
+/** Report the frames the output skipped through PaAlsaStreamComponent_SkipUnderrun() as an output underflow. */
+static void PaAlsaStream_NoteSkippedUnderrun( PaAlsaStream *self )
+{
+    if( !self->playback.underrunFrames )
+        return;
+
+    self->underrun = PA_MAX( self->playback.underrunFrames * 1000. / self->hostSampleRate, 1. );
+    self->playback.underrunFrames = 0;
+    PaAlsaStream_RaiseOutputLatency( self );
+    PA_PROBE1( xrun_recovery, paNoError );
+}
+
 static PaError PaAlsaStream_GetAvailableFrames( PaAlsaStream *self, int queryCapture, int queryPlayback, unsigned long
         *available, int *xrunOccurred )
 {
@@ -3719,6 +6153,7 @@ static PaError PaAlsaStream_GetAvailableFrames( PaAlsaStream *self, int queryCap
         {
             goto end;
         }
+        PaAlsaStream_NoteSkippedUnderrun( self );
     }
 
     if( queryCapture && queryPlayback )
@@ -3740,6 +6175,171 @@ error:
     return result;
 }
 
+/** Get the number of available frames for the pcms that are marked ready.
+ *
+ * @concern FullDuplex If only one direction is marked ready (from poll), the number of frames available for
+ * the other direction is returned. Output is normally preferred over capture however, so capture frames may be
+ * discarded to avoid overrun unless paNeverDropInput is specified.
+ */
+static PaError PaAlsaStream_CollectFrames( PaAlsaStream *self, unsigned long *framesAvail, int *xrun )
+{
+    PaError result = paNoError;
+    int captureReady = self->capture.pcm ? self->capture.ready : 0,
+        playbackReady = self->playback.pcm ? self->playback.ready : 0;
+
+    PA_ENSURE( PaAlsaStream_GetAvailableFrames( self, captureReady, playbackReady, framesAvail, xrun ) );
+
+    if( self->capture.pcm && self->playback.pcm )
+    {
+        if( !self->playback.ready && !self->neverDropInput && !self->independentClocks )
+        {
+            /* Drop input, a period's worth */
+            assert( self->capture.ready );
+            PaAlsaStreamComponent_EndProcessing( &self->capture, PA_MIN( self->capture.framesPerPeriod,
+                        *framesAvail ), xrun );
+            *framesAvail = 0;
+            self->capture.ready = 0;
+        }
+    }
+    else if( self->capture.pcm )
+        assert( self->capture.ready );
+    else
+        assert( self->playback.ready );
+
+error:
+    return result;
+}
+
+/* As the poll() of PaAlsaStream_WaitForFrames, a timer scheduled wait gives up on the devices after this long */
+#define TIMER_WAIT_LIMIT_ (2.)
+
+/** Determine how long a timer scheduled component still has to be waited for.
+ *
+ * Capture is ready once a period has been captured, playback once a period fits into the buffer without the delay
+ * exceeding the fill level, or once the delay dropped to the wake level of a low-power output. Querying the status synchronizes with the hardware pointer, which is not brought up to
+ * date by period interrupts in this case.
+ *
+ * @param wait Returns the time in seconds until the component is ready, 0 if it is ready.
+ */
+static PaError PaAlsaStreamComponent_GetTimerWait( PaAlsaStreamComponent *self, double sampleRate, PaTime *wait,
+        int *xrun )
+{
+    PaError result = paNoError;
+    PaTime ready;
+
+    *wait = 0.;
+    PA_ENSURE( PaAlsaStreamComponent_UpdateStatus( self, sampleRate ) );
+    if( alsa_snd_pcm_status_get_state( self->status ) == SND_PCM_STATE_XRUN )
+    {
+        *xrun = 1;
+        goto error;
+    }
+
+    if( StreamDirection_In == self->streamDir )
+        ready = ( (PaTime)self->framesPerPeriod - alsa_snd_pcm_status_get_avail( self->status ) ) / sampleRate;
+    else
+        ready = self->statusDelay - ( self->wakeLevel ? self->wakeLevel : self->fillLevel - self->framesPerPeriod ) /
+            sampleRate;
+    if( ready > 0. )
+        *wait = ready;
+
+error:
+    return result;
+}
+
+/** Sleep until the pcms of a timer scheduled stream (paAlsaTimerScheduling) are ready, marking them so.
+ *
+ * This takes the place of polling in PaAlsaStream_WaitForFrames, with the same compromise between the directions
+ * of a full-duplex stream.
+ */
+static PaError PaAlsaStream_SleepForFrames( PaAlsaStream *self, int *xrun )
+{
+    PaError result = paNoError;
+    int waitCapture = self->capture.pcm != NULL, waitPlayback = self->playback.pcm != NULL;
+    PaTime waitStart = PaUtil_GetTime(), waitLimit = TIMER_WAIT_LIMIT_;
+    int firstWait = 1;
+
+    self->capture.ready = self->playback.ready = 0;
+    while( waitCapture || waitPlayback )
+    {
+        PaTime wait = TIMER_WAIT_LIMIT_, componentWait;
+        int timeout = -1;
+        struct timespec ts;
+
+        if( waitCapture )
+        {
+            PA_ENSURE( PaAlsaStreamComponent_GetTimerWait( &self->capture, self->hostSampleRate, &componentWait, xrun ) );
+            if( 0. == componentWait )
+            {
+                self->capture.ready = 1;
+                waitCapture = 0;
+            }
+            else
+                wait = PA_MIN( wait, componentWait );
+        }
+        if( waitPlayback && !*xrun )
+        {
+            PA_ENSURE( PaAlsaStreamComponent_GetTimerWait( &self->playback, self->hostSampleRate, &componentWait, xrun ) );
+            if( 0. == componentWait )
+            {
+                self->playback.ready = 1;
+                waitPlayback = 0;
+            }
+            else
+            {
+                wait = PA_MIN( wait, componentWait );
+                /* A low-power output may be due further ahead than the limit, only waiting beyond that is a stall */
+                if( firstWait )
+                    waitLimit += componentWait;
+            }
+        }
+        firstWait = 0;
+        if( *xrun )
+            break;
+
+        if( waitCapture && !waitPlayback && self->playback.pcm )
+        {
+            PA_ENSURE( ContinuePoll( self, StreamDirection_In, &timeout, &waitCapture ) );
+        }
+        else if( waitPlayback && !waitCapture && self->capture.pcm )
+        {
+            PA_ENSURE( ContinuePoll( self, StreamDirection_Out, &timeout, &waitPlayback ) );
+        }
+        if( !waitCapture && !waitPlayback )
+            break;
+        if( timeout >= 0 )
+            wait = PA_MIN( wait, timeout / 1000. );
+
+        if( PaUtil_GetTime() - waitStart > waitLimit )
+        {
+            /* Suspended, paused or failed device, try recovering it */
+            PA_DEBUG(( "%s: Timed out waiting for the device\n", __FUNCTION__ ));
+            *xrun = 1;
+            break;
+        }
+
+        if( self->stopFds[0] >= 0 && wait >= 1e-3 )
+        {
+            /* Sleep the whole milliseconds in poll(), so that RealStop can wake the thread, and the rest below */
+            struct pollfd pfd;
+            pfd.fd = self->stopFds[0];
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if( poll( &pfd, 1, (int)( wait * 1000. ) ) > 0 )
+                break;
+            continue;
+        }
+
+        ts.tv_sec = (time_t)wait;
+        ts.tv_nsec = (long)( ( wait - ts.tv_sec ) * 1e9 );
+        while( EINTR == clock_nanosleep( CLOCK_MONOTONIC, 0, &ts, &ts ) )
+            ;
+    }
+
+error:
+    return result;
+}
+
 /** Wait for and report available buffer space from ALSA.
  *
  * Unless ALSA reports a minimum of frames available for I/O, we poll the ALSA filedescriptors for more.
@@ -3761,6 +6361,9 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
     assert( self );
     assert( framesAvail );
 
+    self->wokenByStop = 0;
+    self->waitTimedOut = 0;
+    PaAlsaStream_InvalidateStatus( self );
     if( !self->callbackMode )
     {
         /* In blocking mode we will only wait if necessary */
@@ -3783,14 +6386,32 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
         }
     }
 
+    if( self->timerScheduling )
+    {
+        /* There are no period wakeups to poll for */
+        PA_ENSURE( PaAlsaStream_SleepForFrames( self, &xrun ) );
+        pollPlayback = pollCapture = 0;
+        if( !xrun && PaAlsaStream_DrainStopPipe( self ) )
+        {
+            self->wokenByStop = 1;
+            *framesAvail = 0;
+            goto end;
+        }
+    }
+
     while( pollPlayback || pollCapture )
     {
-        int totalFds = 0;
-        struct pollfd *capturePfds = NULL, *playbackPfds = NULL;
+        int totalFds = 0, timeout = pollTimeout;
+        struct pollfd *capturePfds = NULL, *playbackPfds = NULL, *stopPfd = NULL;
+
+        if( self->waitDeadline > 0. )
+        {
+            /* Pa_ProcessStream waits no longer than its timeout */
+            PaTime left = self->waitDeadline - PaUtil_GetTime();
+            if( left < timeout / 1000. )
+                timeout = left > 0. ? (int)ceil( left * 1000. ) : 0;
+        }
 
-#ifdef PTHREAD_CANCELED
-        pthread_testcancel();
-#endif
         if( pollCapture )
         {
             capturePfds = self->pfds;
@@ -3804,23 +6425,17 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
             PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &self->playback, playbackPfds ) );
             totalFds += self->playback.nfds;
         }
-
-#ifdef PTHREAD_CANCELED
-        if( self->callbackMode )
+        if( self->stopFds[0] >= 0 )
         {
-            /* To allow 'Abort' to terminate the callback thread, enable cancelability just for poll() (& disable after) */
-            pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
+            /* Allow StopStream and AbortStream to interrupt the wait */
+            stopPfd = self->pfds + totalFds;
+            stopPfd->fd = self->stopFds[0];
+            stopPfd->events = POLLIN;
+            stopPfd->revents = 0;
+            ++totalFds;
         }
-#endif
 
-        pollResults = poll( self->pfds, totalFds, pollTimeout );
-
-#ifdef PTHREAD_CANCELED
-        if( self->callbackMode )
-        {
-            pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
-        }
-#endif
+        pollResults = poll( self->pfds, totalFds, timeout );
 
         if( pollResults < 0 )
         {
@@ -3865,6 +6480,14 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
             /* reset timouts counter */
             timeouts = 0;
 
+            if( stopPfd && stopPfd->revents )
+            {
+                PaAlsaStream_DrainStopPipe( self );
+                self->wokenByStop = 1;
+                *framesAvail = 0;
+                goto end;
+            }
+
             /* check the return status of our pfds */
             if( pollCapture )
             {
@@ -3880,13 +6503,26 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
             }
         }
 
+        if( ( pollCapture || pollPlayback ) && self->waitDeadline > 0. && PaUtil_GetTime() >= self->waitDeadline )
+        {
+            self->waitTimedOut = 1;
+            *framesAvail = 0;
+            goto end;
+        }
+
         /* @concern FullDuplex If only one of two pcms is ready we may want to compromise between the two.
          * If there is less than half a period's worth of samples left of frames in the other pcm's buffer we will
          * stop polling.
          */
         if( self->capture.pcm && self->playback.pcm )
         {
-            if( pollCapture && !pollPlayback )
+            if( self->independentClocks )
+            {
+                /* Each pcm is serviced as soon as it is ready, see PaAlsaStream_ProcessIndependently */
+                if( !pollCapture || !pollPlayback )
+                    break;
+            }
+            else if( pollCapture && !pollPlayback )
             {
                 PA_ENSURE( ContinuePoll( self, StreamDirection_In, &pollTimeout, &pollCapture ) );
             }
@@ -3899,32 +6535,8 @@ static PaError PaAlsaStream_WaitForFrames( PaAlsaStream *self, unsigned long *fr
 
     if( !xrun )
     {
-        /* Get the number of available frames for the pcms that are marked ready.
-         * @concern FullDuplex If only one direction is marked ready (from poll), the number of frames available for
-         * the other direction is returned. Output is normally preferred over capture however, so capture frames may be
-         * discarded to avoid overrun unless paNeverDropInput is specified.
-         */
-        int captureReady = self->capture.pcm ? self->capture.ready : 0,
-            playbackReady = self->playback.pcm ? self->playback.ready : 0;
-        PA_ENSURE( PaAlsaStream_GetAvailableFrames( self, captureReady, playbackReady, framesAvail, &xrun ) );
-
-        if( self->capture.pcm && self->playback.pcm )
-        {
-            if( !self->playback.ready && !self->neverDropInput )
-            {
-                /* Drop input, a period's worth */
-                assert( self->capture.ready );
-                PaAlsaStreamComponent_EndProcessing( &self->capture, PA_MIN( self->capture.framesPerPeriod,
-                            *framesAvail ), &xrun );
-                *framesAvail = 0;
-                self->capture.ready = 0;
-            }
-        }
-        else if( self->capture.pcm )
-            assert( self->capture.ready );
-        else
-            assert( self->playback.ready );
-    }
+        PA_ENSURE( PaAlsaStream_CollectFrames( self, framesAvail, &xrun ) );
+    }
 
 end:
 error:
@@ -3981,16 +6593,9 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
     }
     else
     {
-        unsigned int bufferSize = self->numHostChannels * alsa_snd_pcm_format_size( self->nativeFormat, *numFrames );
-        if( bufferSize > self->nonMmapBufferSize )
-        {
-            self->nonMmapBuffer = realloc( self->nonMmapBuffer, ( self->nonMmapBufferSize = bufferSize ) );
-            if( !self->nonMmapBuffer )
-            {
-                result = paInsufficientMemory;
-                goto error;
-            }
-        }
+        /* The buffer processor converts straight into the buffer passed to snd_pcm_writei (or from the one
+           filled by snd_pcm_readi), which is allocated once for a host buffer */
+        *numFrames = PA_MIN( *numFrames, self->nonMmapBufferFrames );
     }
 
     if( self->hostInterleaved )
@@ -3998,11 +6603,19 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
         int swidth = alsa_snd_pcm_format_size( self->nativeFormat, 1 );
 
         p = buffer = self->canMmap ? ExtractAddress( areas, self->offset ) : self->nonMmapBuffer;
-        for( i = 0; i < self->numUserChannels; ++i )
+        if( self->channelSelectors )
         {
-            /* We're setting the channels up to userChannels, but the stride will be hostChannels samples */
-            setChannel( bp, i, p, self->numHostChannels );
-            p += swidth;
+            /* Only the selected channels are converted */
+            PaUtil_SetSelectedInterleavedInputChannels( bp, buffer, self->numHostChannels, self->channelSelectors );
+        }
+        else
+        {
+            for( i = 0; i < self->numUserChannels; ++i )
+            {
+                /* We're setting the channels up to userChannels, but the stride will be hostChannels samples */
+                setChannel( bp, i, p, self->numHostChannels );
+                p += swidth;
+            }
         }
     }
     else
@@ -4011,7 +6624,7 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
         {
             for( i = 0; i < self->numUserChannels; ++i )
             {
-                area = areas + i;
+                area = areas + ( self->channelSelectors ? self->channelSelectors[i] : i );
                 buffer = ExtractAddress( area, self->offset );
                 setChannel( bp, i, buffer, 1 );
             }
@@ -4019,11 +6632,11 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
         else
         {
             unsigned int buf_per_ch_size = self->nonMmapBufferSize / self->numHostChannels;
-            buffer = self->nonMmapBuffer;
             for( i = 0; i < self->numUserChannels; ++i )
             {
+                buffer = (unsigned char *)self->nonMmapBuffer +
+                    ( self->channelSelectors ? self->channelSelectors[i] : i ) * buf_per_ch_size;
                 setChannel( bp, i, buffer, 1 );
-                buffer += buf_per_ch_size;
             }
         }
     }
@@ -4047,7 +6660,7 @@ static PaError PaAlsaStreamComponent_RegisterChannels( PaAlsaStreamComponent* se
             }
             res = alsa_snd_pcm_readn( self->pcm, bufs, *numFrames );
         }
-        if( res == -EPIPE || res == -ESTRPIPE )
+        if( res == -EPIPE || res == -ESTRPIPE || ( res == -ENODEV && self->fallbackDevice ) )
         {
             *xrun = 1;
             *numFrames = 0;
@@ -4171,6 +6784,243 @@ error:
     return result;
 }
 
+/** Get the buffer(s) registered by PaAlsaStreamComponent_RegisterChannels in the form the user callback expects.
+ */
+static void *PaAlsaStreamComponent_GetUserBuffer( PaAlsaStreamComponent *self )
+{
+    int i;
+
+    if( self->userInterleaved )
+        return self->canMmap ? ExtractAddress( self->channelAreas, self->offset ) : self->nonMmapBuffer;
+
+    for( i = 0; i < self->numUserChannels; ++i )
+    {
+        self->userBuffers[i] = self->canMmap ? ExtractAddress( self->channelAreas + i, self->offset ) :
+            (unsigned char *)self->nonMmapBuffer + i * ( self->nonMmapBufferSize / self->numHostChannels );
+    }
+    return self->userBuffers;
+}
+
+/** Is the buffer set up by PaAlsaStream_SetUpBuffers suitable for calling the callback on it directly?
+ *
+ * Both directions must be ready, the buffer must have the size the user asked for and the buffer processor must have
+ * nothing to do on it, anything else is left to the buffer processor.
+ */
+static int PaAlsaStream_CanZeroCopy( PaAlsaStream *self, unsigned long numFrames )
+{
+    if( !self->zeroCopy || !PaUtil_CanBypassBufferProcessor( &self->bufferProcessor ) )
+        return 0;
+    if( ( self->capture.pcm && !self->capture.ready ) || ( self->playback.pcm && !self->playback.ready ) )
+        return 0;
+    return self->framesPerUserBuffer == paFramesPerBufferUnspecified || numFrames == self->framesPerUserBuffer;
+}
+
+/** Call the user callback directly on the ALSA buffers, in place of PaUtil_EndBufferProcessing.
+ */
+static void PaAlsaStream_ZeroCopyCallback( PaAlsaStream *self, unsigned long numFrames, int *callbackResult )
+{
+    void *input = self->capture.pcm ? PaAlsaStreamComponent_GetUserBuffer( &self->capture ) : NULL;
+    void *output = self->playback.pcm ? PaAlsaStreamComponent_GetUserBuffer( &self->playback ) : NULL;
+
+    PaUtil_EndBufferProcessingDirectly( &self->bufferProcessor, input, output, numFrames, callbackResult );
+}
+
+/** Process what is available in one direction of a stream whose pcms are serviced independently.
+ *
+ * The other pcm is hidden meanwhile, as in ReadStream and WriteStream, so that the functions shared with the other
+ * modes deal with this one only.
+ */
+static PaError PaAlsaStream_ProcessDirection( PaAlsaStream *self, StreamDirection streamDir,
+        PaStreamCallbackFlags statusFlags, int *callbackResult, unsigned long *framesProcessed )
+{
+    PaError result = paNoError;
+    PaAlsaStreamComponent *other = StreamDirection_In == streamDir ? &self->playback : &self->capture;
+    snd_pcm_t *otherPcm = other->pcm;
+    PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+    unsigned long framesAvail, framesGot;
+    int xrun = 0;
+
+    *framesProcessed = 0;
+    other->pcm = NULL;
+
+    PA_ENSURE( PaAlsaStream_GetAvailableFrames( self, StreamDirection_In == streamDir, StreamDirection_Out == streamDir,
+                &framesAvail, &xrun ) );
+    if( xrun )
+    {
+        PA_ENSURE( PaAlsaStream_HandleXrun( self ) );
+        goto error;
+    }
+
+    while( framesAvail > 0 )
+    {
+        CalculateTimeInfo( self, &timeInfo );
+        PaUtil_BeginBufferProcessing( &self->bufferProcessor, &timeInfo, statusFlags );
+        statusFlags = 0;
+
+        framesGot = PA_MIN( framesAvail, self->maxFramesPerHostBuffer );
+        PA_ENSURE( PaAlsaStream_SetUpBuffers( self, &framesGot, &xrun ) );
+        if( 0 == framesGot )
+            break;
+        framesAvail -= framesGot;
+
+        if( StreamDirection_In == streamDir )
+            PaUtil_SetNoOutput( &self->bufferProcessor );
+        else
+            PaUtil_SetNoInput( &self->bufferProcessor );
+        PaUtil_EndBufferProcessing( &self->bufferProcessor, callbackResult );
+        PA_ENSURE( PaAlsaStream_EndProcessing( self, framesGot, &xrun ) );
+        *framesProcessed += framesGot;
+
+        if( paContinue != *callbackResult )
+            break;
+    }
+
+error:
+    other->pcm = otherPcm;
+    return result;
+}
+
+/** Service the pcms of a stream whose devices don't share a clock (paCompensateClockDrift), each as it is ready.
+ *
+ * The buffer processor resamples the input to the playback clock and calls the callback as the playback is processed.
+ */
+static PaError PaAlsaStream_ProcessIndependently( PaAlsaStream *self, PaStreamCallbackFlags *cbFlags,
+        int *callbackResult )
+{
+    PaError result = paNoError;
+    int captureReady = self->capture.ready, playbackReady = self->playback.ready;
+    unsigned long captureFrames = 0, playbackFrames = 0;
+
+    /** @concern Xruns Under/overflows are to be reported to the callback */
+    if( self->underrun > 0.0 )
+    {
+        *cbFlags |= paOutputUnderflow;
+        self->underrun = 0.0;
+    }
+    if( self->overrun > 0.0 )
+    {
+        *cbFlags |= paInputOverflow;
+        self->overrun = 0.0;
+    }
+
+    PaUtil_BeginCpuLoadMeasurement( &self->cpuLoadMeasurer );
+
+    if( captureReady )
+    {
+        PA_ENSURE( PaAlsaStream_ProcessDirection( self, StreamDirection_In, *cbFlags & paInputOverflow,
+                    callbackResult, &captureFrames ) );
+        *cbFlags &= ~paInputOverflow;
+    }
+    if( playbackReady )
+    {
+        PA_ENSURE( PaAlsaStream_ProcessDirection( self, StreamDirection_Out, *cbFlags, callbackResult,
+                    &playbackFrames ) );
+        *cbFlags = 0;
+    }
+
+error:
+    /* The callback runs with the playback, measure the load relative to it */
+    PaUtil_EndCpuLoadMeasurement( &self->cpuLoadMeasurer, playbackFrames );
+    return result;
+}
+
+/** Process the frames available from the pcms of a stream, in as many host buffers as it takes. */
+static PaError PaAlsaStream_ProcessFrames( PaAlsaStream *self, unsigned long framesAvail, PaStreamCallbackFlags *cbFlags,
+        int *callbackResult )
+{
+    PaError result = paNoError;
+    PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+    unsigned long framesGot;
+    int xrun;
+
+    /* Consume buffer space. Once we have a number of frames available for consumption we must retrieve the
+     * mmapped buffers from ALSA, this is contiguously accessible memory however, so we may receive smaller
+     * portions at a time than is available as a whole. Therefore we should be prepared to process several
+     * chunks successively. The buffers are passed to the PA buffer processor.
+     */
+    while( framesAvail > 0 )
+    {
+        xrun = 0;
+
+        /** @concern Xruns Under/overflows are to be reported to the callback */
+        if( self->underrun > 0.0 )
+        {
+            *cbFlags |= paOutputUnderflow;
+            self->underrun = 0.0;
+        }
+        if( self->overrun > 0.0 )
+        {
+            *cbFlags |= paInputOverflow;
+            self->overrun = 0.0;
+        }
+        if( self->capture.pcm && self->playback.pcm )
+        {
+            /** @concern FullDuplex It's possible that only one direction is being processed to avoid an
+             * under- or overflow, this should be reported correspondingly */
+            if( !self->capture.ready )
+            {
+                *cbFlags |= paInputUnderflow;
+                PA_DEBUG(( "%s: Input underflow\n", __FUNCTION__ ));
+            }
+            else if( !self->playback.ready )
+            {
+                *cbFlags |= paOutputOverflow;
+                PA_DEBUG(( "%s: Output overflow\n", __FUNCTION__ ));
+            }
+        }
+
+#if 0
+        CallbackUpdate( &self->threading );
+#endif
+
+        CalculateTimeInfo( self, &timeInfo );
+        PaUtil_BeginBufferProcessing( &self->bufferProcessor, &timeInfo, *cbFlags );
+        *cbFlags = 0;
+
+        /* CPU load measurement should include processing activity external to the stream callback */
+        PaUtil_BeginCpuLoadMeasurement( &self->cpuLoadMeasurer );
+
+        framesGot = framesAvail;
+        if( paUtilFixedHostBufferSize == self->bufferProcessor.hostBufferSizeMode )
+        {
+            /* We've committed to a fixed host buffer size, stick to that */
+            framesGot = framesGot >= self->maxFramesPerHostBuffer ? self->maxFramesPerHostBuffer : 0;
+        }
+        else
+        {
+            /* We've committed to an upper bound on the size of host buffers */
+            assert( paUtilBoundedHostBufferSize == self->bufferProcessor.hostBufferSizeMode );
+            framesGot = PA_MIN( framesGot, self->maxFramesPerHostBuffer );
+        }
+        PA_ENSURE( PaAlsaStream_SetUpBuffers( self, &framesGot, &xrun ) );
+        /* Check the host buffer size against the buffer processor configuration */
+        framesAvail -= framesGot;
+
+        if( framesGot > 0 )
+        {
+            assert( !xrun );
+            if( PaAlsaStream_CanZeroCopy( self, framesGot ) )
+                PaAlsaStream_ZeroCopyCallback( self, framesGot, callbackResult );
+            else
+                PaUtil_EndBufferProcessing( &self->bufferProcessor, callbackResult );
+            PA_ENSURE( PaAlsaStream_EndProcessing( self, framesGot, &xrun ) );
+        }
+        PaUtil_EndCpuLoadMeasurement( &self->cpuLoadMeasurer, framesGot );
+
+        if( 0 == framesGot )
+        {
+            /* Go back to polling for more frames */
+            break;
+        }
+
+        if( paContinue != *callbackResult )
+            break;
+    }
+
+error:
+    return result;
+}
+
 /** Callback thread's function.
  *
  * Roughly, the workflow can be described in the following way: The number of available frames that can be processed
@@ -4183,7 +7033,6 @@ static void *CallbackThreadFunc( void *userData )
 {
     PaError result = paNoError;
     PaAlsaStream *stream = (PaAlsaStream*) userData;
-    PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
     snd_pcm_sframes_t startThreshold = 0;
     int callbackResult = paContinue;
     PaStreamCallbackFlags cbFlags = 0;  /* We might want to keep state across iterations */
@@ -4196,10 +7045,8 @@ static void *CallbackThreadFunc( void *userData )
     /* Execute OnExit when exiting */
     pthread_cleanup_push( &OnExit, stream );
 #ifdef PTHREAD_CANCELED
-    /* 'Abort' will use thread cancellation to terminate the callback thread, but the Alsa-lib functions
-     * are NOT cancel-safe, (and can end up in an inconsistent state).  So, disable cancelability for
-     * the thread here, and just re-enable it for the poll() in PaAlsaStream_WaitForFrames(). */
-    pthread_testcancel();
+    /* RealStop wakes the thread through the stop pipe instead of cancelling it, the Alsa-lib functions
+     * are NOT cancel-safe (and can end up in an inconsistent state). */
     pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
 #endif
 
@@ -4233,20 +7080,22 @@ static void *CallbackThreadFunc( void *userData )
 
     while( 1 )
     {
-        unsigned long framesAvail, framesGot;
+        unsigned long framesAvail;
         int xrun = 0;
 
-#ifdef PTHREAD_CANCELED
-        pthread_testcancel();
-#endif
-
         /* @concern StreamStop if the main thread has requested a stop and the stream has not been effectively
-         * stopped we signal this condition by modifying callbackResult (we'll want to flush buffered output).
+         * stopped we signal this condition by modifying callbackResult (we'll want to flush buffered output,
+         * unless aborting).
          */
-        if( PaUnixThread_StopRequested( &stream->thread ) && paContinue == callbackResult )
+        if( stream->stopRequested )
         {
-            PA_DEBUG(( "Setting callbackResult to paComplete\n" ));
-            callbackResult = paComplete;
+            if( stream->callbackAbort )
+                callbackResult = paAbort;
+            else if( paContinue == callbackResult )
+            {
+                PA_DEBUG(( "Setting callbackResult to paComplete\n" ));
+                callbackResult = paComplete;
+            }
         }
 
         if( paContinue != callbackResult )
@@ -4266,7 +7115,17 @@ static void *CallbackThreadFunc( void *userData )
         /* Wait for data to become available, this comes down to polling the ALSA file descriptors untill we have
          * a number of available frames.
          */
+        PA_TRACE_BEGIN( paUtilTraceHostWait, 0, 0 );
+        PA_PROBE1( host_wait, 0 );
         PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
+        PA_PROBE2( host_wait_return, framesAvail, xrun );
+        PA_TRACE_END( paUtilTraceHostWait, (long)framesAvail, xrun );
+        stream->callbackCpu = PaUnixThread_GetCurrentCpu();
+        if( stream->wokenByStop )
+        {
+            /* RealStop was called */
+            continue;
+        }
         if( xrun )
         {
             assert( 0 == framesAvail );
@@ -4277,110 +7136,575 @@ static void *CallbackThreadFunc( void *userData )
              */
         }
 
-        /* Consume buffer space. Once we have a number of frames available for consumption we must retrieve the
-         * mmapped buffers from ALSA, this is contiguously accessible memory however, so we may receive smaller
-         * portions at a time than is available as a whole. Therefore we should be prepared to process several
-         * chunks successively. The buffers are passed to the PA buffer processor.
-         */
-        while( framesAvail > 0 )
+        if( stream->independentClocks )
         {
-            xrun = 0;
+            PA_ENSURE( PaAlsaStream_ProcessIndependently( stream, &cbFlags, &callbackResult ) );
+            continue;
+        }
 
-            /** @concern Xruns Under/overflows are to be reported to the callback */
-            if( stream->underrun > 0.0 )
-            {
-                cbFlags |= paOutputUnderflow;
-                stream->underrun = 0.0;
-            }
-            if( stream->overrun > 0.0 )
-            {
-                cbFlags |= paInputOverflow;
-                stream->overrun = 0.0;
-            }
-            if( stream->capture.pcm && stream->playback.pcm )
+        PA_ENSURE( PaAlsaStream_ProcessFrames( stream, framesAvail, &cbFlags, &callbackResult ) );
+    }
+
+end:
+    ; /* Hack to fix "label at end of compound statement" error caused by pthread_cleanup_pop(1) macro. */
+    /* Match pthread_cleanup_push */
+    pthread_cleanup_pop( 1 );
+
+    PA_DEBUG(( "%s: Thread %d exiting\n ", __FUNCTION__, pthread_self() ));
+    PaUnixThreading_EXIT( result );
+
+error:
+    PA_DEBUG(( "%s: Thread %d is canceled due to error %d\n ", __FUNCTION__, pthread_self(), result ));
+    goto end;
+}
+
+/** Process a stream opened with paManualProcessing, an iteration of CallbackThreadFunc on the application's thread.
+ *
+ * The pcms were started by StartStream. Once the callback is done and the buffered output flushed, the stream is
+ * stopped by OnExit as when the callback thread exits.
+ */
+static PaError ProcessStream( PaStream *s, double timeoutSeconds )
+{
+    PaError result = paNoError;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    unsigned long framesAvail = 0;
+    int xrun = 0;
+
+    if( !stream->isActive )
+        return paStreamIsStopped;
+
+    stream->waitDeadline = PaUtil_GetTime() + timeoutSeconds;
+    PA_TRACE_BEGIN( paUtilTraceHostWait, 0, 0 );
+    PA_PROBE1( host_wait, 0 );
+    result = PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun );
+    PA_PROBE2( host_wait_return, framesAvail, xrun );
+    PA_TRACE_END( paUtilTraceHostWait, (long)framesAvail, xrun );
+    stream->waitDeadline = 0.;
+    PA_ENSURE( result );
+    stream->callbackCpu = PaUnixThread_GetCurrentCpu();
+
+    if( stream->waitTimedOut )
+    {
+        result = paTimedOut;
+        goto end;
+    }
+    if( xrun )
+        goto end;
+
+    if( stream->independentClocks )
+    {
+        PA_ENSURE( PaAlsaStream_ProcessIndependently( stream, &stream->manualCbFlags, &stream->manualCallbackResult ) );
+    }
+    else
+    {
+        PA_ENSURE( PaAlsaStream_ProcessFrames( stream, framesAvail, &stream->manualCbFlags,
+                    &stream->manualCallbackResult ) );
+    }
+
+    /* @concern BlockAdaption As in CallbackThreadFunc, the stream finishes once the adaption buffers are empty */
+    if( paContinue != stream->manualCallbackResult )
+    {
+        stream->callbackAbort = ( paAbort == stream->manualCallbackResult );
+        if( stream->callbackAbort || PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+            OnExit( stream );
+    }
+
+end:
+    return result;
+
+error:
+    goto end;
+}
+
+/* Shared callback threads (paAlsaSharedCallbackThread) */
+
+/* A device is given up on when a stream has waited this long for it, as in PaAlsaStream_WaitForFrames */
+#define GROUP_WAIT_LIMIT_ (2.)
+
+/** Interrupt the poll() of a group thread, so it takes note of streams coming or going. */
+static void PaAlsaCallbackGroup_Wake( PaAlsaCallbackGroup *self )
+{
+    char c = 0;
+
+    if( write( self->wakeFds[1], &c, 1 ) < 0 )
+    {
+        /* The pipe is full, the thread is going to wake up anyway */
+    }
+}
+
+static void PaAlsaGroupMember_BeginWaiting( PaAlsaStream *stream )
+{
+    PaAlsaGroupMember *self = &stream->member;
+
+    PaAlsaStream_InvalidateStatus( stream );
+    self->pollCapture = stream->capture.pcm != NULL;
+    self->pollPlayback = stream->playback.pcm != NULL;
+    self->pollTimeout = stream->pollTimeout;
+    self->waitStart = PaUtil_GetTime();
+}
+
+/** Fill in the pollfd objects for the pcms of a stream that are still waited for.
+ *
+ * @param nfds Returns the number of pollfd objects used.
+ */
+static PaError PaAlsaGroupMember_BeginPolling( PaAlsaStream *stream, struct pollfd *pfds, unsigned int *nfds )
+{
+    PaError result = paNoError;
+    PaAlsaGroupMember *self = &stream->member;
+
+    *nfds = 0;
+    self->capturePfds = self->playbackPfds = NULL;
+    if( self->pollCapture )
+    {
+        self->capturePfds = pfds;
+        PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &stream->capture, self->capturePfds ) );
+        *nfds += stream->capture.nfds;
+    }
+    if( self->pollPlayback )
+    {
+        self->playbackPfds = pfds + *nfds;
+        PA_ENSURE( PaAlsaStreamComponent_BeginPolling( &stream->playback, self->playbackPfds ) );
+        *nfds += stream->playback.nfds;
+    }
+    self->polled = 1;
+
+error:
+    return result;
+}
+
+/** Service a stream of a group after poll() returned, the counterpart of an iteration of CallbackThreadFunc.
+ *
+ * @param finished Returns whether the stream is done, it is then stopped by the caller.
+ */
+static PaError PaAlsaGroupMember_Service( PaAlsaStream *stream, int *finished )
+{
+    PaError result = paNoError;
+    PaAlsaGroupMember *self = &stream->member;
+    unsigned long framesAvail = 0;
+    int xrun = 0;
+
+    /* @concern StreamStop As in CallbackThreadFunc, flush buffered output unless aborting */
+    if( self->stopRequested )
+    {
+        if( stream->callbackAbort )
+            self->callbackResult = paAbort;
+        else if( paContinue == self->callbackResult )
+            self->callbackResult = paComplete;
+    }
+
+    if( paContinue != self->callbackResult )
+    {
+        stream->callbackAbort = ( paAbort == self->callbackResult );
+        if( stream->callbackAbort || PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+        {
+            *finished = 1;
+            goto end;
+        }
+    }
+
+    /* The stream may have joined after the pollfds were gathered */
+    if( !self->polled )
+        goto end;
+    self->polled = 0;
+
+    if( self->pollCapture )
+    {
+        PA_ENSURE( PaAlsaStreamComponent_EndPolling( &stream->capture, self->capturePfds, &self->pollCapture, &xrun ) );
+    }
+    if( self->pollPlayback )
+    {
+        PA_ENSURE( PaAlsaStreamComponent_EndPolling( &stream->playback, self->playbackPfds, &self->pollPlayback, &xrun ) );
+    }
+
+    /* @concern FullDuplex See PaAlsaStream_WaitForFrames */
+    if( !xrun && stream->capture.pcm && stream->playback.pcm )
+    {
+        if( self->pollCapture && !self->pollPlayback )
+        {
+            PA_ENSURE( ContinuePoll( stream, StreamDirection_In, &self->pollTimeout, &self->pollCapture ) );
+        }
+        else if( self->pollPlayback && !self->pollCapture )
+        {
+            PA_ENSURE( ContinuePoll( stream, StreamDirection_Out, &self->pollTimeout, &self->pollPlayback ) );
+        }
+    }
+
+    if( !xrun && ( self->pollCapture || self->pollPlayback ) )
+    {
+        if( PaUtil_GetTime() - self->waitStart < GROUP_WAIT_LIMIT_ )
+            goto end;
+
+        PA_DEBUG(( "%s: poll timed out\n", __FUNCTION__ ));
+        xrun = 1;
+    }
+
+    PaAlsaGroupMember_BeginWaiting( stream );
+    stream->callbackCpu = PaUnixThread_GetCurrentCpu();
+
+    if( !xrun )
+    {
+        PA_ENSURE( PaAlsaStream_CollectFrames( stream, &framesAvail, &xrun ) );
+    }
+    if( xrun )
+    {
+        PA_ENSURE( PaAlsaStream_HandleXrun( stream ) );
+        goto end;
+    }
+    PA_UNLESS( 0 == framesAvail || stream->capture.ready || stream->playback.ready, paInternalError );
+
+    PA_ENSURE( PaAlsaStream_ProcessFrames( stream, framesAvail, &self->cbFlags, &self->callbackResult ) );
+
+end:
+error:
+    return result;
+}
+
+/** Stop the streams of a list that the group thread let go of, and tell StopStream they are done.
+ *
+ * The mutex of the group is released meanwhile, the finished callbacks may stop other streams of the group.
+ */
+static void PaAlsaCallbackGroup_StopStreams( PaAlsaCallbackGroup *self, PaAlsaStream *streams )
+{
+    PaAlsaStream *stream;
+
+    ASSERT_CALL_( PaUnixMutex_Unlock( &self->mtx ), paNoError );
+    for( stream = streams; stream; stream = stream->member.next )
+        OnExit( stream );
+    ASSERT_CALL_( PaUnixMutex_Lock( &self->mtx ), paNoError );
+
+    for( stream = streams; stream; stream = stream->member.next )
+        stream->member.running = 0;
+    ASSERT_CALL_( pthread_cond_broadcast( &self->runningChanged ), 0 );
+}
+
+/** Group thread's function.
+ *
+ * Polls the pcms of all streams of the group at once and services those that are ready in turn. The mutex of the
+ * group is held except in poll() and while finished streams are stopped.
+ */
+static void *SharedCallbackThreadFunc( void *userData )
+{
+    PaError result = paNoError;
+    PaAlsaCallbackGroup *group = (PaAlsaCallbackGroup*)userData;
+    PaAlsaStream *stream, *finished, **link;
+
+    ASSERT_CALL_( PaUnixMutex_Lock( &group->mtx ), paNoError );
+
+    while( group->streamCount > 0 )
+    {
+        unsigned int nfds = 1, streamFds;
+        int pollTimeout = -1, pollResults;
+        char drain[16];
+
+        for( stream = group->running; stream; stream = stream->member.next )
+            nfds += stream->capture.nfds + stream->playback.nfds;
+        if( nfds > group->pfdsCapacity )
+        {
+            /* Only when a stream joins */
+            PaUtil_FreeMemory( group->pfds );
+            group->pfdsCapacity = 0;
+            PA_UNLESS( group->pfds = (struct pollfd*)PaUtil_AllocateMemory( nfds * sizeof(struct pollfd) ),
+                    paInsufficientMemory );
+            group->pfdsCapacity = nfds;
+        }
+
+        group->pfds[0].fd = group->wakeFds[0];
+        group->pfds[0].events = POLLIN;
+        group->pfds[0].revents = 0;
+        nfds = 1;
+        for( stream = group->running; stream; stream = stream->member.next )
+        {
+            PA_ENSURE( PaAlsaGroupMember_BeginPolling( stream, group->pfds + nfds, &streamFds ) );
+            nfds += streamFds;
+            if( pollTimeout < 0 || stream->member.pollTimeout < pollTimeout )
+                pollTimeout = stream->member.pollTimeout;
+        }
+
+        ASSERT_CALL_( PaUnixMutex_Unlock( &group->mtx ), paNoError );
+        PA_TRACE_BEGIN( paUtilTraceHostWait, (long)nfds, 0 );
+        PA_PROBE1( host_wait, nfds );
+        pollResults = poll( group->pfds, nfds, pollTimeout );
+        PA_PROBE2( host_wait_return, nfds, pollResults );
+        PA_TRACE_END( paUtilTraceHostWait, (long)nfds, pollResults );
+        ASSERT_CALL_( PaUnixMutex_Lock( &group->mtx ), paNoError );
+
+        if( pollResults < 0 )
+        {
+            /* The streams are polled again */
+            PA_UNLESS( EINTR == errno, paInternalError );
+            continue;
+        }
+        if( group->pfds[0].revents & POLLIN )
+        {
+            while( read( group->wakeFds[0], drain, sizeof (drain) ) > 0 )
+                ;
+        }
+
+        finished = NULL;
+        link = &group->running;
+        while( ( stream = *link ) )
+        {
+            int done = 0;
+            PaError serviceResult = PaAlsaGroupMember_Service( stream, &done );
+
+            if( paNoError != serviceResult || done )
             {
-                /** @concern FullDuplex It's possible that only one direction is being processed to avoid an
-                 * under- or overflow, this should be reported correspondingly */
-                if( !stream->capture.ready )
+                if( paNoError != serviceResult )
                 {
-                    cbFlags |= paInputUnderflow;
-                    PA_DEBUG(( "%s: Input underflow\n", __FUNCTION__ ));
-                }
-                else if( !stream->playback.ready )
-                {
-                    cbFlags |= paOutputOverflow;
-                    PA_DEBUG(( "%s: Output overflow\n", __FUNCTION__ ));
+                    PA_DEBUG(( "%s: Stream is stopped due to error %d\n", __FUNCTION__, serviceResult ));
                 }
+                *link = stream->member.next;
+                stream->member.next = finished;
+                finished = stream;
             }
+            else
+                link = &stream->member.next;
+        }
+
+        if( finished )
+            PaAlsaCallbackGroup_StopStreams( group, finished );
+    }
+
+end:
+    ASSERT_CALL_( PaUnixMutex_Unlock( &group->mtx ), paNoError );
+    PaUnixThreading_EXIT( result );
+
+error:
+    /* Let go of all streams, else StopStream would wait for them forever */
+    PA_DEBUG(( "%s: Thread %d is canceled due to error %d\n ", __FUNCTION__, pthread_self(), result ));
+    group->failed = 1;
+    finished = group->running;
+    group->running = NULL;
+    PaAlsaCallbackGroup_StopStreams( group, finished );
+    goto end;
+}
+
+static void PaAlsaCallbackGroup_Free( PaAlsaCallbackGroup *self )
+{
+    if( self->wakeFds[0] >= 0 )
+        close( self->wakeFds[0] );
+    if( self->wakeFds[1] >= 0 )
+        close( self->wakeFds[1] );
+    ASSERT_CALL_( pthread_cond_destroy( &self->runningChanged ), 0 );
+    ASSERT_CALL_( PaUnixMutex_Terminate( &self->mtx ), paNoError );
+    PaUtil_FreeMemory( self->pfds );
+    PaUtil_FreeMemory( self );
+}
+
+static PaError PaAlsaCallbackGroup_New( PaAlsaCallbackGroup **group, snd_pcm_uframes_t framesPerPeriod, double sampleRate )
+{
+    PaError result = paNoError;
+    PaAlsaCallbackGroup *self;
+    int i;
+
+    PA_UNLESS( self = (PaAlsaCallbackGroup*)PaUtil_AllocateMemory( sizeof (PaAlsaCallbackGroup) ), paInsufficientMemory );
+    memset( self, 0, sizeof (PaAlsaCallbackGroup) );
+    self->framesPerPeriod = framesPerPeriod;
+    self->sampleRate = sampleRate;
+    ASSERT_CALL_( PaUnixMutex_Initialize( &self->mtx ), paNoError );
+    ASSERT_CALL_( pthread_cond_init( &self->runningChanged, NULL ), 0 );
+
+    /* Neither end may block, the thread drains the pipe and a full pipe wakes it up anyway */
+    self->wakeFds[0] = self->wakeFds[1] = -1;
+    PA_UNLESS( !pipe( self->wakeFds ), paInternalError );
+    for( i = 0; i < 2; ++i )
+    {
+        PA_UNLESS( !fcntl( self->wakeFds[i], F_SETFL, fcntl( self->wakeFds[i], F_GETFL ) | O_NONBLOCK ),
+                paInternalError );
+        PA_UNLESS( !fcntl( self->wakeFds[i], F_SETFD, FD_CLOEXEC ), paInternalError );
+    }
+
+    *group = self;
+
+end:
+    return result;
+error:
+    if( self )
+        PaAlsaCallbackGroup_Free( self );
+    goto end;
+}
+
+/** Have a started stream serviced by the thread of the group with its period, creating the group if there is none.
+ *
+ * @param scheduling The scheduling of the thread if it's created.
+ */
+static PaError PaAlsaCallbackGroup_Join( PaAlsaStream *stream, const PaUnixThreadScheduling *scheduling )
+{
+    PaError result = paNoError;
+    PaAlsaHostApiRepresentation *alsaApi = stream->alsaApi;
+    PaAlsaCallbackGroup *group;
+    snd_pcm_uframes_t framesPerPeriod = GetCallbackFramesPerPeriod( stream );
+    int created = 0;
+
+    ASSERT_CALL_( PaUnixMutex_Lock( &alsaApi->callbackGroupsMtx ), paNoError );
+
+    for( group = alsaApi->callbackGroups; group; group = group->next )
+    {
+        if( group->framesPerPeriod == framesPerPeriod && group->sampleRate == stream->hostSampleRate )
+            break;
+    }
+    if( !group )
+    {
+        PA_ENSURE( PaAlsaCallbackGroup_New( &group, framesPerPeriod, stream->hostSampleRate ) );
+        created = 1;
+    }
+
+    ASSERT_CALL_( PaUnixMutex_Lock( &group->mtx ), paNoError );
+    if( group->failed )
+    {
+        ASSERT_CALL_( PaUnixMutex_Unlock( &group->mtx ), paNoError );
+        PA_ENSURE( paInternalError );
+    }
+
+    memset( &stream->member, 0, sizeof (PaAlsaGroupMember) );
+    stream->member.group = group;
+    stream->member.running = 1;
+    stream->member.callbackResult = paContinue;
+    PaAlsaGroupMember_BeginWaiting( stream );
+    stream->member.next = group->running;
+    group->running = stream;
+    ++group->streamCount;
+    ASSERT_CALL_( PaUnixMutex_Unlock( &group->mtx ), paNoError );
+
+    if( created )
+    {
+        /* The thread lives as long as the group has streams */
+        result = PaUnixThread_New( &group->thread, &SharedCallbackThreadFunc, group, 0., scheduling,
+                stream->callbackCpus, stream->callbackCpuCount );
+        if( paNoError != result )
+        {
+            memset( &stream->member, 0, sizeof (PaAlsaGroupMember) );
+            PaAlsaCallbackGroup_Free( group );
+            goto error;
+        }
+        group->next = alsaApi->callbackGroups;
+        alsaApi->callbackGroups = group;
+    }
+    else
+        PaAlsaCallbackGroup_Wake( group );
 
-#if 0
-            CallbackUpdate( &stream->threading );
-#endif
+end:
+    ASSERT_CALL_( PaUnixMutex_Unlock( &alsaApi->callbackGroupsMtx ), paNoError );
+    return result;
+error:
+    goto end;
+}
 
-            CalculateTimeInfo( stream, &timeInfo );
-            PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, cbFlags );
-            cbFlags = 0;
+/** Stop having a stream serviced by its group, ending the thread with the last stream of the group.
+ *
+ * Unless the stream finished on its own, the thread flushes (or drops if abort) the output and stops the stream.
+ */
+static PaError PaAlsaCallbackGroup_Leave( PaAlsaStream *stream, int abort )
+{
+    PaError result = paNoError;
+    PaAlsaHostApiRepresentation *alsaApi = stream->alsaApi;
+    PaAlsaCallbackGroup *group = stream->member.group, **link;
+    int last;
 
-            /* CPU load measurement should include processing activity external to the stream callback */
-            PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+    ASSERT_CALL_( PaUnixMutex_Lock( &group->mtx ), paNoError );
+    if( stream->member.running )
+    {
+        stream->callbackAbort = abort;
+        stream->member.stopRequested = 1;
+        PaAlsaCallbackGroup_Wake( group );
 
-            framesGot = framesAvail;
-            if( paUtilFixedHostBufferSize == stream->bufferProcessor.hostBufferSizeMode )
-            {
-                /* We've committed to a fixed host buffer size, stick to that */
-                framesGot = framesGot >= stream->maxFramesPerHostBuffer ? stream->maxFramesPerHostBuffer : 0;
-            }
-            else
-            {
-                /* We've committed to an upper bound on the size of host buffers */
-                assert( paUtilBoundedHostBufferSize == stream->bufferProcessor.hostBufferSizeMode );
-                framesGot = PA_MIN( framesGot, stream->maxFramesPerHostBuffer );
-            }
-            PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
-            /* Check the host buffer size against the buffer processor configuration */
-            framesAvail -= framesGot;
+        while( stream->member.running )
+            ASSERT_CALL_( pthread_cond_wait( &group->runningChanged, &group->mtx.mtx ), 0 );
+    }
+    ASSERT_CALL_( PaUnixMutex_Unlock( &group->mtx ), paNoError );
 
-            if( framesGot > 0 )
-            {
-                assert( !xrun );
-                PaUtil_EndBufferProcessing( &stream->bufferProcessor, &callbackResult );
-                PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
-            }
-            PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesGot );
+    /* No stream may join while the group is taken down */
+    ASSERT_CALL_( PaUnixMutex_Lock( &alsaApi->callbackGroupsMtx ), paNoError );
+    ASSERT_CALL_( PaUnixMutex_Lock( &group->mtx ), paNoError );
+    last = 0 == --group->streamCount;
+    ASSERT_CALL_( PaUnixMutex_Unlock( &group->mtx ), paNoError );
+    if( last )
+    {
+        for( link = &alsaApi->callbackGroups; *link != group; link = &(*link)->next )
+            ;
+        *link = group->next;
+    }
+    ASSERT_CALL_( PaUnixMutex_Unlock( &alsaApi->callbackGroupsMtx ), paNoError );
+    stream->member.group = NULL;
 
-            if( 0 == framesGot )
-            {
-                /* Go back to polling for more frames */
-                break;
-            }
+    if( last )
+    {
+        PaError threadRes;
 
-            if( paContinue != callbackResult )
-                break;
+        PaAlsaCallbackGroup_Wake( group );
+        PA_ENSURE( PaUnixThread_Terminate( &group->thread, 1, &threadRes ) );
+        if( threadRes != paNoError )
+        {
+            PA_DEBUG(( "Shared callback thread returned: %d\n", threadRes ));
         }
+        PaAlsaCallbackGroup_Free( group );
     }
 
 end:
-    ; /* Hack to fix "label at end of compound statement" error caused by pthread_cleanup_pop(1) macro. */
-    /* Match pthread_cleanup_push */
-    pthread_cleanup_pop( 1 );
-
-    PA_DEBUG(( "%s: Thread %d exiting\n ", __FUNCTION__, pthread_self() ));
-    PaUnixThreading_EXIT( result );
-
+    return result;
 error:
-    PA_DEBUG(( "%s: Thread %d is canceled due to error %d\n ", __FUNCTION__, pthread_self(), result ));
     goto end;
 }
 
 /* Blocking interface */
 
+/* Wait until frames can be transferred to or from a pcm of a blocking stream, or until deadline. *ready is
+ * set unless the deadline passed first, also if an xrun needs recovering by PaAlsaStream_WaitForFrames */
+static PaError PaAlsaStreamComponent_WaitUntil( PaAlsaStreamComponent *self, struct pollfd *pfds,
+        PaTime deadline, int *ready )
+{
+    PaError result = paNoError;
+    unsigned long framesAvail;
+    int xrun, pollResults = 0;
+    PaTime timeLeft;
+
+    *ready = 0;
+    for( ;; )
+    {
+        PA_ENSURE( PaAlsaStreamComponent_GetAvailableFrames( self, &framesAvail, &xrun ) );
+        if( framesAvail > 0 || xrun )
+        {
+            *ready = 1;
+            break;
+        }
+
+        timeLeft = deadline - PaUtil_GetTime();
+        if( timeLeft <= 0. )
+            break;
+
+        if( pollResults > 0 )
+        {
+            /* Ready without frames, as a timer scheduled buffer filled up to its fill level */
+            Pa_Sleep( 1 ); /* avoid hot loop */
+        }
+
+        PA_ENSURE( PaAlsaStreamComponent_BeginPolling( self, pfds ) );
+        pollResults = poll( pfds, self->nfds, (int)ceil( timeLeft * 1000. ) );
+        if( pollResults < 0 && errno != EINTR )
+        {
+            PA_ENSURE( paInternalError );
+        }
+    }
+
+error:
+    return result;
+}
+
 static PaError ReadStream( PaStream* s, void *buffer, unsigned long frames )
+{
+    return ReadStreamTimeout( s, buffer, frames, NULL, -1. );
+}
+
+/* A negative timeoutSeconds waits as long as it takes */
+static PaError ReadStreamTimeout( PaStream* s, void *buffer, unsigned long frames,
+        unsigned long *framesRead, double timeoutSeconds )
 {
     PaError result = paNoError;
     PaAlsaStream *stream = (PaAlsaStream*)s;
-    unsigned long framesGot, framesAvail;
+    unsigned long framesGot, framesAvail, framesDone = 0;
     void *userBuffer;
     snd_pcm_t *save = stream->playback.pcm;
+    PaTime deadline = timeoutSeconds >= 0. ? PaUtil_GetTime() + timeoutSeconds : 0.;
 
     assert( stream );
 
@@ -4412,22 +7736,36 @@ static PaError ReadStream( PaStream* s, void *buffer, unsigned long frames )
         ENSURE_( alsa_snd_pcm_start( stream->capture.pcm ), paUnanticipatedHostError );
     }
 
-    while( frames > 0 )
+    while( frames > framesDone )
     {
         int xrun = 0;
+
+        if( timeoutSeconds >= 0. )
+        {
+            int ready;
+            PA_ENSURE( PaAlsaStreamComponent_WaitUntil( &stream->capture, stream->pfds, deadline, &ready ) );
+            if( !ready )
+            {
+                result = paTimedOut;
+                break;
+            }
+        }
+
         PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
-        framesGot = PA_MIN( framesAvail, frames );
+        framesGot = PA_MIN( framesAvail, frames - framesDone );
 
         PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
         if( framesGot > 0 )
         {
             framesGot = PaUtil_CopyInput( &stream->bufferProcessor, &userBuffer, framesGot );
             PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
-            frames -= framesGot;
+            framesDone += framesGot;
         }
     }
 
 end:
+    if( framesRead )
+        *framesRead = framesDone;
     stream->playback.pcm = save;
     return result;
 error:
@@ -4435,13 +7773,22 @@ error:
 }
 
 static PaError WriteStream( PaStream* s, const void *buffer, unsigned long frames )
+{
+    return WriteStreamTimeout( s, buffer, frames, NULL, -1. );
+}
+
+/* As ReadStreamTimeout */
+static PaError WriteStreamTimeout( PaStream* s, const void *buffer, unsigned long frames,
+        unsigned long *framesWritten, double timeoutSeconds )
 {
     PaError result = paNoError;
     signed long err;
     PaAlsaStream *stream = (PaAlsaStream*)s;
     snd_pcm_uframes_t framesGot, framesAvail;
+    unsigned long framesDone = 0;
     const void *userBuffer;
     snd_pcm_t *save = stream->capture.pcm;
+    PaTime deadline = timeoutSeconds >= 0. ? PaUtil_GetTime() + timeoutSeconds : 0.;
 
     assert( stream );
 
@@ -4464,20 +7811,196 @@ static PaError WriteStream( PaStream* s, const void *buffer, unsigned long frame
         memcpy( (void *)userBuffer, buffer, sizeof (void *) * stream->playback.numUserChannels );
     }
 
-    while( frames > 0 )
+    while( frames > framesDone )
     {
         int xrun = 0;
         snd_pcm_uframes_t hwAvail;
 
+        if( timeoutSeconds >= 0. )
+        {
+            int ready;
+            PA_ENSURE( PaAlsaStreamComponent_WaitUntil( &stream->playback, stream->pfds, deadline, &ready ) );
+            if( !ready )
+            {
+                result = paTimedOut;
+                break;
+            }
+        }
+
         PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
-        framesGot = PA_MIN( framesAvail, frames );
+        framesGot = PA_MIN( framesAvail, frames - framesDone );
 
         PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
         if( framesGot > 0 )
         {
             framesGot = PaUtil_CopyOutput( &stream->bufferProcessor, &userBuffer, framesGot );
             PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
-            frames -= framesGot;
+            framesDone += framesGot;
+        }
+
+        /* Start stream after one period of samples worth */
+
+        /* Frames residing in buffer */
+        PA_ENSURE( err = GetStreamWriteAvailable( stream ) );
+        framesAvail = err;
+        hwAvail = stream->playback.alsaBufferSize - framesAvail;
+
+        if( alsa_snd_pcm_state( stream->playback.pcm ) == SND_PCM_STATE_PREPARED &&
+                hwAvail >= stream->playback.framesPerPeriod )
+        {
+            ENSURE_( alsa_snd_pcm_start( stream->playback.pcm ), paUnanticipatedHostError );
+        }
+    }
+
+end:
+    if( framesWritten )
+        *framesWritten = framesDone;
+    stream->capture.pcm = save;
+    return result;
+error:
+    goto end;
+}
+
+/* Read into several user buffers. Each host region waited for and mapped is filled into as many of them as
+ * it spans, so small buffers don't cost a wait and an mmap commit each. The channel pointers of
+ * non-interleaved buffers are copied into userBuffers since PaUtil_CopyInput() advances them. */
+static PaError ReadStreamV( PaStream* s, void * const *buffers, const unsigned long *frames,
+        unsigned long bufferCount )
+{
+    PaError result = paNoError;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    unsigned long framesGot, framesAvail, framesCopied, framesLeft = 0, bufferFramesLeft = 0, i;
+    void *userBuffer = NULL;
+    snd_pcm_t *save = stream->playback.pcm;
+
+    assert( stream );
+
+    PA_UNLESS( stream->capture.pcm, paCanNotReadFromAnOutputOnlyStream );
+
+    /* Disregard playback */
+    stream->playback.pcm = NULL;
+
+    if( stream->overrun > 0. )
+    {
+        result = paInputOverflowed;
+        stream->overrun = 0.0;
+    }
+
+    for( i = 0; i < bufferCount; ++i )
+        framesLeft += frames[i];
+
+    /* Start stream if in prepared state */
+    if( alsa_snd_pcm_state( stream->capture.pcm ) == SND_PCM_STATE_PREPARED )
+    {
+        ENSURE_( alsa_snd_pcm_start( stream->capture.pcm ), paUnanticipatedHostError );
+    }
+
+    i = 0;
+    while( framesLeft > 0 )
+    {
+        int xrun = 0;
+        PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
+        framesGot = PA_MIN( framesAvail, framesLeft );
+
+        PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
+        if( framesGot > 0 )
+        {
+            for( framesCopied = 0; framesCopied < framesGot; )
+            {
+                unsigned long n;
+
+                if( bufferFramesLeft == 0 )
+                {
+                    if( stream->capture.userInterleaved )
+                        userBuffer = buffers[i];
+                    else
+                    {
+                        userBuffer = stream->capture.userBuffers;
+                        memcpy( userBuffer, buffers[i], sizeof (void *) * stream->capture.numUserChannels );
+                    }
+                    bufferFramesLeft = frames[i++];
+                }
+
+                n = PaUtil_CopyInput( &stream->bufferProcessor, &userBuffer,
+                        PA_MIN( framesGot - framesCopied, bufferFramesLeft ) );
+                framesCopied += n;
+                bufferFramesLeft -= n;
+            }
+            PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
+            framesLeft -= framesGot;
+        }
+    }
+
+end:
+    stream->playback.pcm = save;
+    return result;
+error:
+    goto end;
+}
+
+/* Write from several user buffers, as ReadStreamV */
+static PaError WriteStreamV( PaStream* s, const void * const *buffers, const unsigned long *frames,
+        unsigned long bufferCount )
+{
+    PaError result = paNoError;
+    signed long err;
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+    snd_pcm_uframes_t framesGot, framesAvail, framesCopied;
+    unsigned long framesLeft = 0, bufferFramesLeft = 0, i;
+    const void *userBuffer = NULL;
+    snd_pcm_t *save = stream->capture.pcm;
+
+    assert( stream );
+
+    PA_UNLESS( stream->playback.pcm, paCanNotWriteToAnInputOnlyStream );
+
+    /* Disregard capture */
+    stream->capture.pcm = NULL;
+
+    if( stream->underrun > 0. )
+    {
+        result = paOutputUnderflowed;
+        stream->underrun = 0.0;
+    }
+
+    for( i = 0; i < bufferCount; ++i )
+        framesLeft += frames[i];
+
+    i = 0;
+    while( framesLeft > 0 )
+    {
+        int xrun = 0;
+        snd_pcm_uframes_t hwAvail;
+
+        PA_ENSURE( PaAlsaStream_WaitForFrames( stream, &framesAvail, &xrun ) );
+        framesGot = PA_MIN( framesAvail, framesLeft );
+
+        PA_ENSURE( PaAlsaStream_SetUpBuffers( stream, &framesGot, &xrun ) );
+        if( framesGot > 0 )
+        {
+            for( framesCopied = 0; framesCopied < framesGot; )
+            {
+                unsigned long n;
+
+                if( bufferFramesLeft == 0 )
+                {
+                    if( stream->playback.userInterleaved )
+                        userBuffer = buffers[i];
+                    else
+                    {
+                        userBuffer = stream->playback.userBuffers;
+                        memcpy( (void *)userBuffer, buffers[i], sizeof (void *) * stream->playback.numUserChannels );
+                    }
+                    bufferFramesLeft = frames[i++];
+                }
+
+                n = PaUtil_CopyOutput( &stream->bufferProcessor, &userBuffer,
+                        PA_MIN( framesGot - framesCopied, bufferFramesLeft ) );
+                framesCopied += n;
+                bufferFramesLeft -= n;
+            }
+            PA_ENSURE( PaAlsaStream_EndProcessing( stream, framesGot, &xrun ) );
+            framesLeft -= framesGot;
         }
 
         /* Start stream after one period of samples worth */
@@ -4551,14 +8074,98 @@ error:
     return result;
 }
 
+#ifdef PA_DIRECT_STREAM_INTERFACE
+/* The stream functions the front end calls directly in builds with only ALSA,
+ * see pa_stream.h. Callback streams answer as the Dummy functions of their
+ * interface. */
+
+PaError PaAlsa_DirectIsStopped( PaStream *s )
+{
+    return IsStreamStopped( s );
+}
+
+PaTime PaAlsa_DirectGetTime( PaStream *s )
+{
+    return GetStreamTime( s );
+}
+
+PaError PaAlsa_DirectRead( PaStream* s, void *buffer, unsigned long frames )
+{
+    if( ((PaAlsaStream*)s)->callbackMode )
+        return paCanNotReadFromACallbackStream;
+    return ReadStream( s, buffer, frames );
+}
+
+PaError PaAlsa_DirectWrite( PaStream* s, const void *buffer, unsigned long frames )
+{
+    if( ((PaAlsaStream*)s)->callbackMode )
+        return paCanNotWriteToACallbackStream;
+    return WriteStream( s, buffer, frames );
+}
+
+signed long PaAlsa_DirectGetReadAvailable( PaStream* s )
+{
+    if( ((PaAlsaStream*)s)->callbackMode )
+        return paCanNotReadFromACallbackStream;
+    return GetStreamReadAvailable( s );
+}
+
+signed long PaAlsa_DirectGetWriteAvailable( PaStream* s )
+{
+    if( ((PaAlsaStream*)s)->callbackMode )
+        return paCanNotWriteToACallbackStream;
+    return GetStreamWriteAvailable( s );
+}
+#endif /* PA_DIRECT_STREAM_INTERFACE */
+
+/** The memory of a stream component */
+static signed long PaAlsaStreamComponent_GetMemoryUsage( const PaAlsaStreamComponent *self )
+{
+    signed long result = 0;
+
+    if( !self->pcm )
+        return 0;
+
+    if( self->status )
+        result += (signed long)alsa_snd_pcm_status_sizeof();
+    if( self->userBuffers )
+        result += (signed long)( sizeof (void *) * self->numUserChannels );
+    if( self->fallbackDevice )
+        result += (signed long)strlen( self->fallbackDevice ) + 1;
+    if( self->channelSelectors )
+        result += (signed long)( sizeof (int) * self->numUserChannels );
+
+    return result + (signed long)self->nonMmapBufferSize;
+}
+
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaAlsaStream *stream = (PaAlsaStream*)s;
+
+    return (signed long)sizeof (PaAlsaStream)
+        + (signed long)( ( stream->capture.nfds + stream->playback.nfds + 1 ) * sizeof (struct pollfd) )
+        + (signed long)( stream->callbackCpus ? stream->callbackCpuCount * sizeof (int) : 0 )
+        + PaAlsaStreamComponent_GetMemoryUsage( &stream->capture )
+        + PaAlsaStreamComponent_GetMemoryUsage( &stream->playback )
+        + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+}
+
 /* Extensions */
 
 void PaAlsa_InitializeStreamInfo( PaAlsaStreamInfo *info )
 {
     info->size = sizeof (PaAlsaStreamInfo);
     info->hostApiType = paALSA;
-    info->version = 1;
+    info->version = 7;
     info->deviceString = NULL;
+    info->channelMatrix = NULL;
+    info->callbackCpus = NULL;
+    info->callbackCpuCount = 0;
+    info->conversionThreadCount = 0;
+    info->fallbackDeviceString = NULL;
+    info->aggregateDevices = NULL;
+    info->aggregateDeviceCount = 0;
+    info->channelSelectors = NULL;
 }
 
 void PaAlsa_EnableRealtimeScheduling( PaStream *s, int enable )
@@ -4567,13 +8174,11 @@ void PaAlsa_EnableRealtimeScheduling( PaStream *s, int enable )
     stream->rtSched = enable;
 }
 
-#if 0
 void PaAlsa_EnableWatchdog( PaStream *s, int enable )
 {
     PaAlsaStream *stream = (PaAlsaStream *) s;
-    stream->thread.useWatchdog = enable;
+    stream->runawayProtection = enable;
 }
-#endif
 
 static PaError GetAlsaStreamPointer( PaStream* s, PaAlsaStream** stream )
 {
@@ -4594,6 +8199,18 @@ error:
     return paNoError;
 }
 
+PaError PaAlsa_GetStreamCallbackCpu( PaStream* s, int* cpu )
+{
+    PaAlsaStream *stream;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+    *cpu = stream->callbackCpu;
+
+error:
+    return result;
+}
+
 PaError PaAlsa_GetStreamInputCard( PaStream* s, int* card )
 {
     PaAlsaStream *stream;
@@ -4632,8 +8249,36 @@ error:
     return result;
 }
 
+PaError PaAlsa_GetStreamPollDescriptors( PaStream* s, int output, struct pollfd* pfds, int* count )
+{
+    PaAlsaStream *stream;
+    PaAlsaStreamComponent *component;
+    PaError result = paNoError;
+
+    PA_ENSURE( GetAlsaStreamPointer( s, &stream ) );
+    PA_UNLESS( !stream->callbackMode, paCanNotReadFromACallbackStream );
+
+    component = output ? &stream->playback : &stream->capture;
+    PA_UNLESS( component->pcm, output ? paCanNotWriteToAnInputOnlyStream : paCanNotReadFromAnOutputOnlyStream );
+
+    if( pfds )
+    {
+        PA_UNLESS( *count >= component->nfds, paBufferTooSmall );
+        ENSURE_( alsa_snd_pcm_poll_descriptors( component->pcm, pfds, component->nfds ), paUnanticipatedHostError );
+    }
+    *count = component->nfds;
+
+error:
+    return result;
+}
+
 PaError PaAlsa_SetRetriesBusy( int retries )
 {
     busyRetries_ = retries;
     return paNoError;
 }
+
+void PaAlsa_SetDeviceCachePath( const char *pathName )
+{
+    deviceCachePath_ = pathName;
+}
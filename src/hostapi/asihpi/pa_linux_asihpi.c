@@ -98,14 +98,26 @@
  sample-synchronised when they reside on the same adapter, as most AudioScience adapters
  derive their ADC and DAC clocks from one master clock. When combining two adapters
  into one full-duplex stream, however, the use of a word clock connection between the
- adapters is strongly recommended.
+ adapters is strongly recommended. When both reside on the same adapter, the two HPI
+ streams are made an HPI stream group while the PA stream runs, so that starting the
+ output starts the input along with it.
 
  The HPI interface is inherently blocking, making use of read and write calls to
  transfer data between user buffers and driver buffers. The callback interface therefore
- requires a helper thread ("callback engine") which periodically transfers data (one thread
- per PA stream, in fact). The current implementation explicitly sleeps via Pa_Sleep() until
- enough samples can be transferred (select() or poll() would be better, but currently seems
- impossible...). The thread implementation makes use of the Unix thread helper functions
+ requires a helper thread ("callback engine") which periodically transfers data (shared
+ by the PA streams of an adapter, see below). The current implementation explicitly sleeps until enough samples
+ can be transferred (select() or poll() would be better, but currently seems impossible, as
+ the HPI user-space interface offers no way to block on adapter interrupts or host buffer
+ notifications...). To keep the polling cost low with small buffers, the sleep is computed
+ from the number of missing frames with microsecond resolution (see PaAsiHpi_SleepFrames())
+ instead of being rounded up to whole milliseconds.
+
+ As AudioScience adapters host many streams, the callback streams started on one adapter
+ are serviced by a single thread of their adapter's callback group rather than a thread
+ each: it polls all of them in turn and sleeps until the first of them can move a host
+ buffer (see PaAsiHpi_GroupThreadFunc()). Setting the PA_ASIHPI_SHARED_THREAD environment
+ variable to "0" gives each callback stream a thread of its own again, which keeps a slow
+ callback of one stream from delaying the others. The thread implementation makes use of the Unix thread helper functions
  and some pthread calls here and there. If a unified PA thread exists, this host API
  implementation might also compile on Windows, as this is the only real Linux-specific
  part of the code.
@@ -147,6 +159,8 @@
 #include <pthread.h>         /* pthreads and friends */
 #include <assert.h>          /* assert */
 #include <math.h>            /* ceil, floor */
+#include <time.h>            /* nanosleep */
+#include <errno.h>           /* EINTR */
 
 #include <asihpi/hpi.h>      /* HPI API */
 
@@ -160,6 +174,7 @@
 #include "pa_process.h"      /* Buffer processor */
 #include "pa_converters.h"   /* PaUtilZeroer */
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h" /* PaUtil_WriteMemoryBarrier etc. */
 
 /* -------------------------------------------------------------------------- */
 
@@ -242,11 +257,19 @@
 #define PA_ASIHPI_AVAILABLE_FORMATS_ (paFloat32 | paInt32 | paInt24 | paInt16 | paUInt8)
 /** Enable background bus mastering (BBM) for buffer transfers, if available (see HPI docs) */
 #define PA_ASIHPI_USE_BBM_ 1
+/** Let the callback engine process audio directly in the BBM host buffer, bypassing the
+ temp buffer and the HPI read/write calls. This requires an HPI library that exports
+ HPI_StreamHostBufferGetInfo(); if the call fails at runtime, the copying path is used. */
+#ifndef PA_ASIHPI_USE_ZERO_COPY_
+#define PA_ASIHPI_USE_ZERO_COPY_ 0
+#endif
 /** Minimum number of frames in HPI buffer (for either data or available space).
  If buffer contains less data/space, it indicates xrun or completion. */
 #define PA_ASIHPI_MIN_FRAMES_ 1152
 /** Minimum polling interval in milliseconds, which determines minimum host buffer size */
-#define PA_ASIHPI_MIN_POLLING_INTERVAL_ 10
+#define PA_ASIHPI_MIN_POLLING_INTERVAL_ 2
+/** Shortest sleep in microseconds when waiting for frames, to avoid spinning on the adapter */
+#define PA_ASIHPI_MIN_SLEEP_USEC_ 250
 
 /* -------------------------------------------------------------------------- */
 
@@ -267,6 +290,13 @@ typedef struct PaAsiHpiHostApiRepresentation
     /* implementation specific data goes here */
 
     PaHostApiIndex hostApiIndex;
+
+    /** Callback groups of the adapters with started callback streams */
+    struct PaAsiHpiCallbackGroup *callbackGroups;
+    /** Protects the list of callback groups */
+    PaUnixMutex callbackGroupsMtx;
+    /** Service the callback streams of an adapter with one thread? (PA_ASIHPI_SHARED_THREAD) */
+    int shareCallbackThread;
 }
 PaAsiHpiHostApiRepresentation;
 
@@ -345,10 +375,36 @@ typedef struct PaAsiHpiStreamComponent
     uint8_t *tempBuffer;
     /** Sample buffer size, in bytes */
     uint32_t tempBufferSize;
+    /** BBM host buffer mapped into our address space (zero-copy mode only, else NULL) */
+    uint8_t *hostBuffer;
+    /** Shared status block of BBM host buffer, holding the host and DSP ring indices */
+    struct hpi_hostbuffer_status *hostBufferStatus;
+    /** Number of bytes handed to the buffer processor in the current zero-copy cycle */
+    uint32_t hostBufferPending;
 }
 PaAsiHpiStreamComponent;
 
 
+/** State of a callback stream serviced by the thread of its adapter's callback group.
+ This is protected by the mutex of the group. */
+typedef struct PaAsiHpiGroupMember
+{
+    /** The group the stream was started in, NULL if it has a thread of its own */
+    struct PaAsiHpiCallbackGroup *group;
+    /** Next stream serviced by the group thread */
+    struct PaAsiHpiStream *next;
+    /** Is the group thread servicing the stream? */
+    int running;
+    /** Has StopStream or AbortStream been called? */
+    int stopRequested;
+    /** Overflows and underflows collected for the next callback */
+    PaStreamCallbackFlags cbFlags;
+    /** Latest return value of the user callback */
+    int callbackResult;
+}
+PaAsiHpiGroupMember;
+
+
 /** Stream data */
 typedef struct PaAsiHpiStream
 {
@@ -361,6 +417,8 @@ typedef struct PaAsiHpiStream
 
     /* implementation specific data goes here */
 
+    /** Host API that opened the stream */
+    PaAsiHpiHostApiRepresentation *hpiHostApi;
     /** Separate structs for input and output sides of stream */
     PaAsiHpiStreamComponent *input, *output;
 
@@ -372,6 +430,8 @@ typedef struct PaAsiHpiStream
     unsigned long maxFramesPerHostBuffer;
     /** Indicates that the stream is in the paNeverDropInput mode */
     int neverDropInput;
+    /** Are the input and output HPI streams started and stopped as one HPI stream group? */
+    int hpiGrouped;
     /** Contains copy of user buffers, used by blocking interface to transfer non-interleaved data.
      It went here instead of to each stream component, as the stream component buffer setup in
      PaAsiHpi_SetupBuffers doesn't know the stream details such as callbackMode.
@@ -389,10 +449,34 @@ typedef struct PaAsiHpiStream
     /** True if stream stopped via exiting callback with paComplete/paAbort flag
      (as opposed to explicit call to StopStream/AbortStream) */
     volatile sig_atomic_t callbackFinished;
+    /** Membership of the callback group of the adapter (shared callback thread) */
+    PaAsiHpiGroupMember member;
 }
 PaAsiHpiStream;
 
 
+/** Callback group of an adapter: one thread servicing all callback streams started on it */
+typedef struct PaAsiHpiCallbackGroup
+{
+    struct PaAsiHpiCallbackGroup *next;
+    /** Adapter of the streams */
+    uint16_t adapterIndex;
+
+    PaUnixThread thread;
+    PaUnixMutex mtx;
+    /** Signalled when streams join or are asked to stop, interrupting the sleep of the thread */
+    pthread_cond_t wake;
+    /** Signalled when streams stop being serviced */
+    pthread_cond_t runningChanged;
+
+    /** Streams started in the group and not stopped yet */
+    int streamCount;
+    /** The streams being serviced */
+    PaAsiHpiStream *running;
+}
+PaAsiHpiCallbackGroup;
+
+
 /** Stream state information, collected together for convenience */
 typedef struct PaAsiHpiStreamInfo
 {
@@ -491,11 +575,18 @@ static void PaAsiHpi_StreamComponentDump( PaAsiHpiStreamComponent *streamComp, P
 static void PaAsiHpi_StreamDump( PaAsiHpiStream *stream );
 static PaError PaAsiHpi_SetupBuffers( PaAsiHpiStreamComponent *streamComp, uint32_t pollingInterval,
                                       unsigned long framesPerPaHostBuffer, PaTime suggestedLatency );
+static void PaAsiHpi_MapHostBuffer( PaAsiHpiStreamComponent *streamComp );
+static void PaAsiHpi_SetHostBufferChannels( PaAsiHpiStream *stream, PaAsiHpiStreamComponent *streamComp,
+                                            unsigned long numFrames );
 static PaError PaAsiHpi_PrimeOutputWithSilence( PaAsiHpiStream *stream );
+static void PaAsiHpi_SleepFrames( double frames, double sampleRate );
 static PaError PaAsiHpi_StartStream( PaAsiHpiStream *stream, int outputPrimed );
 static PaError PaAsiHpi_StopStream( PaAsiHpiStream *stream, int abort );
 static PaError PaAsiHpi_ExplicitStop( PaAsiHpiStream *stream, int abort );
 static void PaAsiHpi_OnThreadExit( void *userData );
+static PaError PaAsiHpi_GetOutputBacklog( PaAsiHpiStream *stream, uint32_t *frames );
+static PaError PaAsiHpi_CheckFrames( PaAsiHpiStream *stream, unsigned long *framesAvail,
+                                     PaStreamCallbackFlags *cbFlags, uint32_t *framesLeft );
 static PaError PaAsiHpi_WaitForFrames( PaAsiHpiStream *stream, unsigned long *framesAvail,
                                        PaStreamCallbackFlags *cbFlags );
 static void PaAsiHpi_CalculateTimeInfo( PaAsiHpiStream *stream, PaStreamCallbackTimeInfo *timeInfo );
@@ -503,6 +594,10 @@ static PaError PaAsiHpi_BeginProcessing( PaAsiHpiStream* stream, unsigned long*
         PaStreamCallbackFlags *cbFlags );
 static PaError PaAsiHpi_EndProcessing( PaAsiHpiStream *stream, unsigned long numFrames,
                                        PaStreamCallbackFlags *cbFlags );
+static PaError PaAsiHpi_ProcessFrames( PaAsiHpiStream *stream, unsigned long framesAvail,
+                                       PaStreamCallbackFlags *cbFlags, int *callbackResult );
+static PaError PaAsiHpi_JoinCallbackGroup( PaAsiHpiStream *stream );
+static PaError PaAsiHpi_LeaveCallbackGroup( PaAsiHpiStream *stream, int abort );
 
 /* ==========================================================================
  * ============================= IMPLEMENTATION =============================
@@ -771,6 +866,11 @@ PaError PaAsiHpi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &hpiHostApi->callbackStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
@@ -783,7 +883,15 @@ PaError PaAsiHpi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
                                       GetStreamTime, PaUtil_DummyGetCpuLoad,
                                       ReadStream, WriteStream, GetStreamReadAvailable, GetStreamWriteAvailable );
 
-    /* Store identity of main thread */
+    /* Callback streams of an adapter share a thread, unless PA_ASIHPI_SHARED_THREAD is "0" */
+    {
+        const char *sharedThread = getenv( "PA_ASIHPI_SHARED_THREAD" );
+        hpiHostApi->shareCallbackThread = !sharedThread || strcmp( sharedThread, "0" ) != 0;
+    }
+    hpiHostApi->callbackGroups = NULL;
+    PA_ENSURE_( PaUnixMutex_Initialize( &hpiHostApi->callbackGroupsMtx ) );
+
+    /* Store identity of main thread, last as Terminate() matches it */
     PA_ENSURE_( PaUnixThreading_Initialize() );
 
     return result;
@@ -826,6 +934,10 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
         /* Finally dismantle HPI subsystem */
         HPI_SubSysFree( NULL );
 
+        /* All streams are closed, so are the callback groups */
+        assert( !hpiHostApi->callbackGroups );
+        PaUnixMutex_Terminate( &hpiHostApi->callbackGroupsMtx );
+
         if( hpiHostApi->allocations )
         {
             PaUtil_FreeAllAllocations( hpiHostApi->allocations );
@@ -833,6 +945,8 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
         }
 
         PaUtil_FreeMemory( hpiHostApi );
+
+        PaUnixThreading_Terminate();
     }
 error:
     return;
@@ -1127,8 +1241,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
     if( inputParameters )
     {
         hpi_handle_t hpiStream;
-        PA_DEBUG(( "%s: Checking input params: dev=%d, sr=%d, chans=%d, fmt=%d\n",
-                   __FUNCTION__, inputParameters->device, (int)sampleRate,
+        PA_DEBUG(( "Checking input params: dev=%d, sr=%d, chans=%d, fmt=%d\n",
+                   inputParameters->device, (int)sampleRate,
                    inputParameters->channelCount, inputParameters->sampleFormat ));
         /* Create and validate format */
         PA_ENSURE_( PaAsiHpi_CreateFormat( hostApi, inputParameters, sampleRate,
@@ -1143,8 +1257,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
     if( outputParameters )
     {
         hpi_handle_t hpiStream;
-        PA_DEBUG(( "%s: Checking output params: dev=%d, sr=%d, chans=%d, fmt=%d\n",
-                   __FUNCTION__, outputParameters->device, (int)sampleRate,
+        PA_DEBUG(( "Checking output params: dev=%d, sr=%d, chans=%d, fmt=%d\n",
+                   outputParameters->device, (int)sampleRate,
                    outputParameters->channelCount, outputParameters->sampleFormat ));
         /* Create and validate format */
         PA_ENSURE_( PaAsiHpi_CreateFormat( hostApi, outputParameters, sampleRate,
@@ -1489,9 +1603,9 @@ static PaError PaAsiHpi_SetupBuffers( PaAsiHpiStreamComponent *streamComp, uint3
         hpi_err_t hpiError = 0;
         PaTime pollingOverhead;
 
-        /* Check overhead of Pa_Sleep() call (minimum sleep duration in ms -> OS dependent) */
+        /* Check overhead of a minimal polling sleep (OS dependent) */
         pollingOverhead = PaUtil_GetTime();
-        Pa_Sleep( 0 );
+        PaAsiHpi_SleepFrames( 0.0, streamComp->hpiFormat.dwSampleRate );
         pollingOverhead = 1000*(PaUtil_GetTime() - pollingOverhead);
         PA_DEBUG(( "polling overhead = %f ms (length of 0-second sleep)\n", pollingOverhead ));
         /* Obtain minimum recommended size for host buffer (in bytes) */
@@ -1774,6 +1888,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     /* Initialize various other stream parameters */
     stream->neverDropInput = streamFlags & paNeverDropInput;
     stream->state = paAsiHpiStoppedState;
+    stream->hpiHostApi = hpiHostApi;
 
     /* Initialize either callback or blocking interface */
     if( streamCallback )
@@ -1794,6 +1909,14 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                     paInsufficientMemory );
         stream->callbackMode = 0;
     }
+    /* Zero-copy processing is tied to the callback engine; blocking streams use HPI calls */
+    if( stream->callbackMode && PA_ASIHPI_USE_ZERO_COPY_ )
+    {
+        if( stream->input )
+            PaAsiHpi_MapHostBuffer( stream->input );
+        if( stream->output )
+            PaAsiHpi_MapHostBuffer( stream->output );
+    }
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
 
     /* Following pa_linux_alsa's lead, we operate with fixed host buffer size by default, */
@@ -1804,6 +1927,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                 sampleRate, streamFlags,
                 framesPerBuffer, framesPerHostBuffer, paUtilFixedHostBufferSize,
                 streamCallback, userData ) );
+    stream->baseStreamRep.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->baseStreamRep.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->baseStreamRep.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->baseStreamRep.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->baseStreamRep.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->baseStreamRep.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
     stream->baseStreamRep.streamInfo.structVersion = 1;
     stream->baseStreamRep.streamInfo.sampleRate = sampleRate;
@@ -1905,6 +2034,143 @@ error:
 }
 
 
+/** Obtain direct access to the BBM host buffer of a stream component.
+ In zero-copy mode the buffer processor reads from and writes into the host buffer itself,
+ and the callback engine moves the host index of the buffer instead of calling
+ HPI_InStreamReadBuf / HPI_OutStreamWriteBuf. This is only possible if BBM is active and
+ the buffer holds a whole number of frames, so that no frame straddles the ring boundary.
+ Any failure simply leaves the component in copying mode.
+
+ @param streamComp Pointer to stream component (input or output) struct
+ */
+static void PaAsiHpi_MapHostBuffer( PaAsiHpiStreamComponent *streamComp )
+{
+    uint8_t *buffer = NULL;
+    struct hpi_hostbuffer_status *status = NULL;
+    hpi_err_t hpiError;
+
+    assert( streamComp );
+    streamComp->hostBuffer = NULL;
+    streamComp->hostBufferStatus = NULL;
+    streamComp->hostBufferPending = 0;
+
+    if( streamComp->hostBufferSize == 0 )
+        return;
+    hpiError = HPI_StreamHostBufferGetInfo( NULL, streamComp->hpiStream, &buffer, &status );
+    if( hpiError || !buffer || !status )
+    {
+        PA_DEBUG(( "host buffer not accessible (HPI error %d), using copy mode\n",
+                   hpiError ));
+        return;
+    }
+    if( status->dwSizeInBytes == 0 || status->dwSizeInBytes % streamComp->bytesPerFrame )
+    {
+        PA_DEBUG(( "host buffer size %d not a multiple of frame size, using copy mode\n",
+                   status->dwSizeInBytes ));
+        return;
+    }
+    streamComp->hostBuffer = buffer;
+    streamComp->hostBufferStatus = status;
+    PA_DEBUG(( "zero-copy processing in %d-byte host buffer\n",
+               status->dwSizeInBytes ));
+}
+
+
+/** Register the next region of a BBM host buffer with the buffer processor.
+ The host index of the buffer marks where the host reads (input) or writes (output) next.
+ If the region wraps around the end of the ring, the remainder is registered as the
+ second buffer of the buffer processor. The host index itself is only moved in
+ PaAsiHpi_EndProcessing, after the buffer processor is done with the region.
+
+ @param stream Pointer to stream struct
+
+ @param streamComp Pointer to stream component (input or output) in zero-copy mode
+
+ @param numFrames Number of frames to process
+ */
+static void PaAsiHpi_SetHostBufferChannels( PaAsiHpiStream *stream, PaAsiHpiStreamComponent *streamComp,
+                                            unsigned long numFrames )
+{
+    uint32_t ringSize, offset, bytes, firstBytes;
+    unsigned long firstFrames;
+    int isOutput;
+
+    assert( stream );
+    assert( streamComp && streamComp->hostBufferStatus );
+
+    isOutput = streamComp->hpiDevice->streamIsOutput;
+    ringSize = streamComp->hostBufferStatus->dwSizeInBytes;
+    offset = streamComp->hostBufferStatus->dwHostIndex % ringSize;
+    bytes = numFrames * streamComp->bytesPerFrame;
+    assert( bytes <= ringSize );
+    firstBytes = PA_MIN( bytes, ringSize - offset );
+    firstFrames = firstBytes / streamComp->bytesPerFrame;
+    /* Make sure we see the samples the DSP has delivered so far */
+    if( !isOutput )
+        PaUtil_ReadMemoryBarrier();
+
+    /* HPI interface only allows interleaved channels */
+    if( isOutput )
+    {
+        PaUtil_SetOutputFrameCount( &stream->bufferProcessor, firstFrames );
+        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0,
+                                             streamComp->hostBuffer + offset,
+                                             streamComp->hpiFormat.wChannels );
+        if( firstFrames < numFrames )
+        {
+            PaUtil_Set2ndOutputFrameCount( &stream->bufferProcessor, numFrames - firstFrames );
+            PaUtil_Set2ndInterleavedOutputChannels( &stream->bufferProcessor, 0,
+                                                    streamComp->hostBuffer,
+                                                    streamComp->hpiFormat.wChannels );
+        }
+    }
+    else
+    {
+        PaUtil_SetInputFrameCount( &stream->bufferProcessor, firstFrames );
+        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0,
+                                            streamComp->hostBuffer + offset,
+                                            streamComp->hpiFormat.wChannels );
+        if( firstFrames < numFrames )
+        {
+            PaUtil_Set2ndInputFrameCount( &stream->bufferProcessor, numFrames - firstFrames );
+            PaUtil_Set2ndInterleavedInputChannels( &stream->bufferProcessor, 0,
+                                                   streamComp->hostBuffer,
+                                                   streamComp->hpiFormat.wChannels );
+        }
+    }
+    streamComp->hostBufferPending = bytes;
+}
+
+
+/** Sleep for the time it takes the adapter to process a number of frames.
+ The HPI user-space interface has no way of blocking until the adapter signals that data
+ or space is available, so the callback engine polls. Pa_Sleep() works in whole
+ milliseconds, which rounds up the wait for a small number of frames by as much as a
+ full ms and makes small host buffers unreliable. This sleeps with microsecond
+ resolution instead, clamped to PA_ASIHPI_MIN_SLEEP_USEC_ to avoid spinning.
+
+ @param frames Number of frames to wait for
+
+ @param sampleRate Sample rate of stream
+ */
+static void PaAsiHpi_SleepFrames( double frames, double sampleRate )
+{
+    struct timespec req, rem;
+    double usec = 0.0;
+
+    if( sampleRate > 0.0 )
+        usec = ceil( 1e6 * frames / sampleRate );
+    if( usec < PA_ASIHPI_MIN_SLEEP_USEC_ )
+        usec = PA_ASIHPI_MIN_SLEEP_USEC_;
+
+    req.tv_sec = (time_t)(usec / 1e6);
+    req.tv_nsec = (long)(usec - 1e6 * req.tv_sec) * 1000;
+    /* Resume the sleep if interrupted by a signal */
+    while( nanosleep( &req, &rem ) == -1 && errno == EINTR )
+        req = rem;
+}
+
+
 /** Prime HPI output stream with silence.
  This resets the output stream and uses PortAudio helper routines to fill the
  temp buffer with silence. It then writes two host buffers to the stream. This is supposed
@@ -1962,18 +2228,32 @@ static PaError PaAsiHpi_StartStream( PaAsiHpiStream *stream, int outputPrimed )
 {
     PaError result = paNoError;
 
-    if( stream->input )
+    if( stream->output && !outputPrimed )
+    {
+        /* Buffer isn't primed, so load stream with silence */
+        PA_ENSURE_( PaAsiHpi_PrimeOutputWithSilence( stream ) );
+    }
+    /* Input and output on one adapter are grouped, so that starting the output starts both
+     on the same sample clock tick. Adapters without stream grouping start them one by one. */
+    stream->hpiGrouped = 0;
+    if( stream->input && stream->output &&
+            stream->input->hpiDevice->adapterIndex == stream->output->hpiDevice->adapterIndex )
+    {
+        hpi_err_t hpiError = HPI_OutStreamGroupAdd( NULL, stream->output->hpiStream,
+                                                    stream->input->hpiStream );
+        if( hpiError )
+        {
+            PA_DEBUG(( "HPI stream grouping unavailable (error %d), starting streams separately\n", hpiError ));
+        }
+        stream->hpiGrouped = !hpiError;
+    }
+    if( stream->input && !stream->hpiGrouped )
     {
         PA_ASIHPI_UNLESS_( HPI_InStreamStart( NULL,
                                               stream->input->hpiStream ), paUnanticipatedHostError );
     }
     if( stream->output )
     {
-        if( !outputPrimed )
-        {
-            /* Buffer isn't primed, so load stream with silence */
-            PA_ENSURE_( PaAsiHpi_PrimeOutputWithSilence( stream ) );
-        }
         PA_ASIHPI_UNLESS_( HPI_OutStreamStart( NULL,
                                                stream->output->hpiStream ), paUnanticipatedHostError );
     }
@@ -1983,16 +2263,24 @@ static PaError PaAsiHpi_StartStream( PaAsiHpiStream *stream, int outputPrimed )
     /* Report stream info for debugging purposes */
     /*    PaAsiHpi_StreamDump( stream );   */
 
-error:
+end:
     return result;
+error:
+    if( stream->hpiGrouped )
+    {
+        HPI_OutStreamGroupReset( NULL, stream->output->hpiStream );
+        stream->hpiGrouped = 0;
+    }
+    goto end;
 }
 
 
 /** Start PortAudio stream.
  If the stream has a callback interface, this starts a helper thread to feed the user callback.
  The thread will then take care of starting the HPI streams, and this function will block
- until the streams actually start. In the case of a blocking interface, the HPI streams
- are simply started.
+ until the streams actually start. A stream sharing the thread of its adapter's callback
+ group starts its HPI streams here and then joins the group. In the case of a blocking
+ interface, the HPI streams are simply started.
 
  @param s Pointer to PortAudio stream
 
@@ -2008,11 +2296,22 @@ static PaError StartStream( PaStream *s )
     /* Ready the processor */
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
 
-    if( stream->callbackMode )
+    if( stream->callbackMode && stream->hpiHostApi->shareCallbackThread )
+    {
+        PA_ENSURE_( PaAsiHpi_StartStream( stream, 0 ) );
+        result = PaAsiHpi_JoinCallbackGroup( stream );
+        if( result != paNoError )
+        {
+            PaAsiHpi_StopStream( stream, 1 );
+            stream->state = paAsiHpiStoppedState;
+            goto error;
+        }
+    }
+    else if( stream->callbackMode )
     {
         /* Create and start callback engine thread */
         /* Also waits 1 second for stream to be started by engine thread (otherwise aborts) */
-        PA_ENSURE_( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., 0 /*rtSched*/ ) );
+        PA_ENSURE_( PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., NULL /*scheduling*/, NULL, 0 ) );
     }
     else
     {
@@ -2057,23 +2356,23 @@ static PaError PaAsiHpi_StopStream( PaAsiHpiStream *stream, int abort )
             /* Wait until HPI output stream is drained */
             while( 1 )
             {
-                PaAsiHpiStreamInfo streamInfo;
-                PaTime timeLeft;
-
-                /* Obtain number of samples waiting to be played */
-                PA_ENSURE_( PaAsiHpi_GetStreamInfo( stream->output, &streamInfo ) );
-                /* Check if stream is drained */
-                if( (streamInfo.state != HPI_STATE_PLAYING) &&
-                        (streamInfo.dataSize < stream->output->bytesPerFrame * PA_ASIHPI_MIN_FRAMES_) )
+                uint32_t framesLeft;
+
+                PA_ENSURE_( PaAsiHpi_GetOutputBacklog( stream, &framesLeft ) );
+                if( framesLeft == 0 )
                     break;
                 /* Sleep amount of time represented by remaining samples */
-                timeLeft = 1000.0 * streamInfo.dataSize / stream->output->bytesPerFrame
-                           / stream->baseStreamRep.streamInfo.sampleRate;
-                Pa_Sleep( (long)ceil( timeLeft ) );
+                PaAsiHpi_SleepFrames( framesLeft, stream->baseStreamRep.streamInfo.sampleRate );
             }
         }
         PA_ASIHPI_UNLESS_( HPI_OutStreamReset( NULL,
                                                stream->output->hpiStream ), paUnanticipatedHostError );
+        if( stream->hpiGrouped )
+        {
+            PA_ASIHPI_UNLESS_( HPI_OutStreamGroupReset( NULL,
+                                                        stream->output->hpiStream ), paNoError );
+            stream->hpiGrouped = 0;
+        }
     }
 
     /* Report stream info for debugging purposes */
@@ -2084,6 +2383,35 @@ error:
 }
 
 
+/** Number of frames an output stream still has to play before it counts as drained.
+
+ @param stream Pointer to stream struct
+
+ @param frames Returns the number of frames left, 0 if the output is drained (or if there is none)
+
+ @return PortAudio error code
+ */
+static PaError PaAsiHpi_GetOutputBacklog( PaAsiHpiStream *stream, uint32_t *frames )
+{
+    PaError result = paNoError;
+    PaAsiHpiStreamInfo streamInfo;
+
+    *frames = 0;
+    if( !stream->output )
+        return result;
+
+    /* Obtain number of samples waiting to be played */
+    PA_ENSURE_( PaAsiHpi_GetStreamInfo( stream->output, &streamInfo ) );
+    /* Check if stream is drained */
+    if( (streamInfo.state == HPI_STATE_PLAYING) ||
+            (streamInfo.dataSize >= stream->output->bytesPerFrame * PA_ASIHPI_MIN_FRAMES_) )
+        *frames = PA_MAX( streamInfo.dataSize / stream->output->bytesPerFrame, 1 );
+
+error:
+    return result;
+}
+
+
 /** Stop or abort PortAudio stream.
 
  This function is used to explicitly stop the PortAudio stream (via StopStream/AbortStream),
@@ -2106,7 +2434,13 @@ static PaError PaAsiHpi_ExplicitStop( PaAsiHpiStream *stream, int abort )
     PaError result = paNoError;
 
     /* First deal with the callback thread, cancelling and/or joining it if necessary */
-    if( stream->callbackMode )
+    if( stream->callbackMode && stream->member.group )
+    {
+        /* The group thread stops the HPI streams, draining the output unless aborting */
+        PA_DEBUG(( "%s callback of shared thread\n", abort ? "Aborting" : "Stopping" ));
+        PA_ENSURE_( PaAsiHpi_LeaveCallbackGroup( stream, abort ) );
+    }
+    else if( stream->callbackMode )
     {
         PaError threadRes;
         stream->callbackAbort = abort;
@@ -2249,9 +2583,9 @@ static void PaAsiHpi_OnThreadExit( void *userData )
 
     PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
 
-    PA_DEBUG(( "%s: Stopping HPI streams\n", __FUNCTION__ ));
+    PA_DEBUG(( "Stopping HPI streams\n", __FUNCTION__ ));
     PaAsiHpi_StopStream( stream, stream->callbackAbort );
-    PA_DEBUG(( "%s: Stoppage\n", __FUNCTION__ ));
+    PA_DEBUG(( "Stoppage\n", __FUNCTION__ ));
 
     /* Eventually notify user all buffers have played */
     if( stream->baseStreamRep.streamFinishedCallback )
@@ -2267,107 +2601,103 @@ static void PaAsiHpi_OnThreadExit( void *userData )
 }
 
 
-/** Wait until there is enough frames to fill a host buffer.
- The routine attempts to sleep until at least a full host buffer can be retrieved from the
- input HPI stream and passed to the output HPI stream. It will first sleep until enough
- output space is available, as this is usually easily achievable. If it is an output-only
- stream, it will also sleep if the hardware buffer is too full, thereby throttling the
- filling of the output buffer and reducing output latency. The routine then blocks until
- enough input samples are available, unless this will cause an output underflow. In the
- process, input overflows and output underflows are indicated.
+/** Check whether there is enough frames to fill a host buffer.
+ A full host buffer has to be retrievable from the input HPI stream and accepted by the
+ output HPI stream. Output space is checked first, as this is usually easily achievable. If it
+ is an output-only stream, the hardware buffer must also not be too full, thereby throttling
+ the filling of the output buffer and reducing output latency. Input is then waited for unless
+ this will cause an output underflow. In the process, input overflows and output underflows
+ are indicated.
 
  @param stream Pointer to stream struct
 
- @param framesAvail Returns the number of available frames
+ @param framesAvail Returns the number of available frames, if framesLeft is 0
 
  @param cbFlags Overflows and underflows indicated in here
 
+ @param framesLeft Returns the number of frames to wait for before checking again, or 0 if
+                   the stream is ready
+
  @return PortAudio error code (only paUnanticipatedHostError expected)
  */
-static PaError PaAsiHpi_WaitForFrames( PaAsiHpiStream *stream, unsigned long *framesAvail,
-                                       PaStreamCallbackFlags *cbFlags )
+static PaError PaAsiHpi_CheckFrames( PaAsiHpiStream *stream, unsigned long *framesAvail,
+                                     PaStreamCallbackFlags *cbFlags, uint32_t *framesLeft )
 {
     PaError result = paNoError;
-    double sampleRate;
     unsigned long framesTarget;
-    uint32_t outputData = 0, outputSpace = 0, inputData = 0, framesLeft = 0;
+    uint32_t outputData = 0, outputSpace = 0, inputData = 0;
+    PaAsiHpiStreamInfo info;
 
     assert( stream );
     assert( stream->input || stream->output );
 
-    sampleRate = stream->baseStreamRep.streamInfo.sampleRate;
     /* We have to come up with this much frames on both input and output */
     framesTarget = stream->bufferProcessor.framesPerHostBuffer;
     assert( framesTarget > 0 );
+    *framesLeft = 0;
 
-    while( 1 )
+    /* Check output first, as this takes priority in the default full-duplex mode */
+    if( stream->output )
     {
-        PaAsiHpiStreamInfo info;
-        /* Check output first, as this takes priority in the default full-duplex mode */
-        if( stream->output )
+        PA_ENSURE_( PaAsiHpi_GetStreamInfo( stream->output, &info ) );
+        /* Wait until enough space is available in output buffer to receive a full block */
+        if( info.availableFrames < framesTarget )
         {
-            PA_ENSURE_( PaAsiHpi_GetStreamInfo( stream->output, &info ) );
-            /* Wait until enough space is available in output buffer to receive a full block */
-            if( info.availableFrames < framesTarget )
-            {
-                framesLeft = framesTarget - info.availableFrames;
-                Pa_Sleep( (long)ceil( 1000 * framesLeft / sampleRate ) );
-                continue;
-            }
-            /* Wait until the data in hardware buffer has dropped to a sensible level.
-             Without this, the hardware buffer quickly fills up in the absence of an input
-             stream to regulate its data rate (if data generation is fast). This leads to
-             large latencies, as the AudioScience hardware buffers are humongous.
-             This is similar to the default "Hardware Buffering=off" option in the
-             AudioScience WAV driver. */
-            if( !stream->input && (stream->output->outputBufferCap > 0) &&
-                    ( info.totalBufferedData > stream->output->outputBufferCap / stream->output->bytesPerFrame ) )
-            {
-                framesLeft = info.totalBufferedData - stream->output->outputBufferCap / stream->output->bytesPerFrame;
-                Pa_Sleep( (long)ceil( 1000 * framesLeft / sampleRate ) );
-                continue;
-            }
-            outputData = info.totalBufferedData;
-            outputSpace = info.availableFrames;
-            /* Report output underflow to callback */
-            if( info.underflow )
-            {
-                *cbFlags |= paOutputUnderflow;
-            }
+            *framesLeft = framesTarget - info.availableFrames;
+            return result;
         }
+        /* Wait until the data in hardware buffer has dropped to a sensible level.
+         Without this, the hardware buffer quickly fills up in the absence of an input
+         stream to regulate its data rate (if data generation is fast). This leads to
+         large latencies, as the AudioScience hardware buffers are humongous.
+         This is similar to the default "Hardware Buffering=off" option in the
+         AudioScience WAV driver. */
+        if( !stream->input && (stream->output->outputBufferCap > 0) &&
+                ( info.totalBufferedData > stream->output->outputBufferCap / stream->output->bytesPerFrame ) )
+        {
+            *framesLeft = info.totalBufferedData - stream->output->outputBufferCap / stream->output->bytesPerFrame;
+            return result;
+        }
+        outputData = info.totalBufferedData;
+        outputSpace = info.availableFrames;
+        /* Report output underflow to callback */
+        if( info.underflow )
+        {
+            *cbFlags |= paOutputUnderflow;
+        }
+    }
 
-        /* Now check input side */
-        if( stream->input )
+    /* Now check input side */
+    if( stream->input )
+    {
+        PA_ENSURE_( PaAsiHpi_GetStreamInfo( stream->input, &info ) );
+        /* If a full block of samples hasn't been recorded yet, wait for it if possible */
+        if( info.availableFrames < framesTarget )
         {
-            PA_ENSURE_( PaAsiHpi_GetStreamInfo( stream->input, &info ) );
-            /* If a full block of samples hasn't been recorded yet, wait for it if possible */
-            if( info.availableFrames < framesTarget )
+            uint32_t inputLeft = framesTarget - info.availableFrames;
+            /* As long as output is not disrupted in the process, wait for a full
+            block of input samples */
+            if( !stream->output || (outputData > inputLeft) )
             {
-                framesLeft = framesTarget - info.availableFrames;
-                /* As long as output is not disrupted in the process, wait for a full
-                block of input samples */
-                if( !stream->output || (outputData > framesLeft) )
-                {
-                    Pa_Sleep( (long)ceil( 1000 * framesLeft / sampleRate ) );
-                    continue;
-                }
-            }
-            inputData = info.availableFrames;
-            /** @todo The paInputOverflow flag should be set in the callback containing the
-             first input sample following the overflow. That means the block currently sitting
-             at the fore-front of recording, i.e. typically the one containing the newest (last)
-             sample in the HPI buffer system. This is most likely not the same as the current
-             block of data being passed to the callback. The current overflow should ideally
-             be noted in an overflow list of sorts, with an indication of when it should be
-             reported. The trouble starts if there are several separate overflow incidents,
-             given a big input buffer. Oh well, something to try out later... */
-            if( info.overflow )
-            {
-                *cbFlags |= paInputOverflow;
+                *framesLeft = inputLeft;
+                return result;
             }
         }
-        break;
+        inputData = info.availableFrames;
+        /** @todo The paInputOverflow flag should be set in the callback containing the
+         first input sample following the overflow. That means the block currently sitting
+         at the fore-front of recording, i.e. typically the one containing the newest (last)
+         sample in the HPI buffer system. This is most likely not the same as the current
+         block of data being passed to the callback. The current overflow should ideally
+         be noted in an overflow list of sorts, with an indication of when it should be
+         reported. The trouble starts if there are several separate overflow incidents,
+         given a big input buffer. Oh well, something to try out later... */
+        if( info.overflow )
+        {
+            *cbFlags |= paInputOverflow;
+        }
     }
+
     /* Full-duplex stream */
     if( stream->input && stream->output )
     {
@@ -2387,6 +2717,37 @@ error:
 }
 
 
+/** Wait until there is enough frames to fill a host buffer.
+ The routine sleeps and checks again until PaAsiHpi_CheckFrames() finds that a full host
+ buffer can be retrieved from the input HPI stream and passed to the output HPI stream.
+
+ @param stream Pointer to stream struct
+
+ @param framesAvail Returns the number of available frames
+
+ @param cbFlags Overflows and underflows indicated in here
+
+ @return PortAudio error code (only paUnanticipatedHostError expected)
+ */
+static PaError PaAsiHpi_WaitForFrames( PaAsiHpiStream *stream, unsigned long *framesAvail,
+                                       PaStreamCallbackFlags *cbFlags )
+{
+    PaError result = paNoError;
+    uint32_t framesLeft;
+
+    while( 1 )
+    {
+        PA_ENSURE_( PaAsiHpi_CheckFrames( stream, framesAvail, cbFlags, &framesLeft ) );
+        if( framesLeft == 0 )
+            break;
+        PaAsiHpi_SleepFrames( framesLeft, stream->baseStreamRep.streamInfo.sampleRate );
+    }
+
+error:
+    return result;
+}
+
+
 /** Obtain recording, current and playback timestamps of stream.
  The current time is determined by the system clock. This "now" timestamp occurs at the
  forefront of recording (and playback in the full-duplex case), which happens later than the
@@ -2485,27 +2846,46 @@ static PaError PaAsiHpi_BeginProcessing( PaAsiHpiStream *stream, unsigned long *
                    stream->input->tempBufferSize / Pa_GetSampleSize(inputFormat) );
         }
 
-        /* Read block of data into temp buffer */
-        PA_ASIHPI_UNLESS_( HPI_InStreamReadBuf( NULL,
-                                             stream->input->hpiStream,
-                                             stream->input->tempBuffer,
-                                             framesToGet * stream->input->bytesPerFrame),
-                           paUnanticipatedHostError );
-        /* Register temp buffer with buffer processor (always FULL buffer) */
-        PaUtil_SetInputFrameCount( &stream->bufferProcessor, *numFrames );
-        /* HPI interface only allows interleaved channels */
-        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor,
-                                            0, stream->input->tempBuffer,
-                                            stream->input->hpiFormat.wChannels );
+        if( stream->input->hostBufferStatus && (framesToGet == *numFrames) )
+        {
+            /* Zero-copy: buffer processor reads straight from the host buffer, which is
+             released in PaAsiHpi_EndProcessing once the callback is done with it */
+            PaAsiHpi_SetHostBufferChannels( stream, stream->input, *numFrames );
+        }
+        else
+        {
+            /* Read block of data into temp buffer (also used for partial blocks in
+             zero-copy mode, as the temp buffer supplies the padding) */
+            PA_ASIHPI_UNLESS_( HPI_InStreamReadBuf( NULL,
+                                                 stream->input->hpiStream,
+                                                 stream->input->tempBuffer,
+                                                 framesToGet * stream->input->bytesPerFrame),
+                               paUnanticipatedHostError );
+            /* Register temp buffer with buffer processor (always FULL buffer) */
+            PaUtil_SetInputFrameCount( &stream->bufferProcessor, *numFrames );
+            /* HPI interface only allows interleaved channels */
+            PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor,
+                                                0, stream->input->tempBuffer,
+                                                stream->input->hpiFormat.wChannels );
+        }
     }
     if( stream->output )
     {
-        /* Register temp buffer with buffer processor */
-        PaUtil_SetOutputFrameCount( &stream->bufferProcessor, *numFrames );
-        /* HPI interface only allows interleaved channels */
-        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor,
-                                             0, stream->output->tempBuffer,
-                                             stream->output->hpiFormat.wChannels );
+        if( stream->output->hostBufferStatus )
+        {
+            /* Zero-copy: buffer processor writes straight into the host buffer
+             (PaAsiHpi_WaitForFrames made sure there is enough space) */
+            PaAsiHpi_SetHostBufferChannels( stream, stream->output, *numFrames );
+        }
+        else
+        {
+            /* Register temp buffer with buffer processor */
+            PaUtil_SetOutputFrameCount( &stream->bufferProcessor, *numFrames );
+            /* HPI interface only allows interleaved channels */
+            PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor,
+                                                 0, stream->output->tempBuffer,
+                                                 stream->output->hpiFormat.wChannels );
+        }
     }
 
 error:
@@ -2516,7 +2896,8 @@ error:
 /** Flush output buffers to HPI output stream.
  This completes the processing cycle by writing the temp buffer to the HPI interface.
  Additional output underflows are caught before data is written to the stream, as this
- action typically remedies the underflow and hides it in the process.
+ action typically remedies the underflow and hides it in the process. In zero-copy mode
+ the data is already in place, and the host buffer indices are advanced instead.
 
  @param stream Pointer to stream struct
 
@@ -2531,6 +2912,15 @@ static PaError PaAsiHpi_EndProcessing( PaAsiHpiStream *stream, unsigned long num
 
     assert( stream );
 
+    /* Hand consumed input region back to the adapter (zero-copy mode) */
+    if( stream->input && stream->input->hostBufferPending )
+    {
+        /* Samples must have been read before the DSP may overwrite them */
+        PaUtil_FullMemoryBarrier();
+        stream->input->hostBufferStatus->dwHostIndex += stream->input->hostBufferPending;
+        stream->input->hostBufferPending = 0;
+    }
+
     if( stream->output )
     {
         PaAsiHpiStreamInfo info;
@@ -2541,13 +2931,109 @@ static PaError PaAsiHpi_EndProcessing( PaAsiHpiStream *stream, unsigned long num
             *cbFlags |= paOutputUnderflow;
         }
 
-        /* Write temp buffer to HPI stream */
-        PA_ASIHPI_UNLESS_( HPI_OutStreamWriteBuf( NULL,
-                                           stream->output->hpiStream,
-                                           stream->output->tempBuffer,
-                                           numFrames * stream->output->bytesPerFrame,
-                                           &stream->output->hpiFormat),
-                           paUnanticipatedHostError );
+        if( stream->output->hostBufferStatus )
+        {
+            /* Publish samples in host buffer to DSP (only after they have been written) */
+            PaUtil_WriteMemoryBarrier();
+            stream->output->hostBufferStatus->dwHostIndex += numFrames * stream->output->bytesPerFrame;
+            stream->output->hostBufferPending = 0;
+        }
+        else
+        {
+            /* Write temp buffer to HPI stream */
+            PA_ASIHPI_UNLESS_( HPI_OutStreamWriteBuf( NULL,
+                                               stream->output->hpiStream,
+                                               stream->output->tempBuffer,
+                                               numFrames * stream->output->bytesPerFrame,
+                                               &stream->output->hpiFormat),
+                               paUnanticipatedHostError );
+        }
+    }
+
+error:
+    return result;
+}
+
+
+/** Pass available frames through the user callback.
+ Once we have a number of frames available for consumption we must retrieve the data from
+ the HPI interface and pass it to the PA buffer processor. We should be prepared to process
+ several chunks successively.
+
+ @param stream Pointer to stream struct
+
+ @param framesAvail The number of frames found by PaAsiHpi_WaitForFrames()
+
+ @param cbFlags Overflows and underflows to report to the callback, cleared once reported
+
+ @param callbackResult Returns the result of the last user callback
+
+ @return PortAudio error code
+ */
+static PaError PaAsiHpi_ProcessFrames( PaAsiHpiStream *stream, unsigned long framesAvail,
+                                       PaStreamCallbackFlags *cbFlags, int *callbackResult )
+{
+    PaError result = paNoError;
+    unsigned long framesGot;
+
+    while( framesAvail > 0 )
+    {
+        PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+
+        pthread_testcancel();
+
+        framesGot = framesAvail;
+        if( stream->bufferProcessor.hostBufferSizeMode == paUtilFixedHostBufferSize )
+        {
+            /* We've committed to a fixed host buffer size, stick to that */
+            framesGot = framesGot >= stream->maxFramesPerHostBuffer ? stream->maxFramesPerHostBuffer : 0;
+        }
+        else
+        {
+            /* We've committed to an upper bound on the size of host buffers */
+            assert( stream->bufferProcessor.hostBufferSizeMode == paUtilBoundedHostBufferSize );
+            framesGot = PA_MIN( framesGot, stream->maxFramesPerHostBuffer );
+        }
+
+        /* Obtain buffer timestamps */
+        PaAsiHpi_CalculateTimeInfo( stream, &timeInfo );
+        PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, *cbFlags );
+        /* CPU load measurement should include processing activivity external to the stream callback */
+        PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+        if( framesGot > 0 )
+        {
+            /* READ FROM HPI INPUT STREAM */
+            PA_ENSURE_( PaAsiHpi_BeginProcessing( stream, &framesGot, cbFlags ) );
+            /* Input overflow in a full-duplex stream makes for interesting times */
+            if( stream->input && stream->output && (*cbFlags & paInputOverflow) )
+            {
+                /* Special full-duplex paNeverDropInput mode */
+                if( stream->neverDropInput )
+                {
+                    PaUtil_SetNoOutput( &stream->bufferProcessor );
+                    *cbFlags |= paOutputOverflow;
+                }
+            }
+            /* CALL USER CALLBACK WITH INPUT DATA, AND OBTAIN OUTPUT DATA */
+            PaUtil_EndBufferProcessing( &stream->bufferProcessor, callbackResult );
+            /* Clear overflow and underflow information (but PaAsiHpi_EndProcessing might
+            still show up output underflow that will carry over to next round) */
+            *cbFlags = 0;
+            /*  WRITE TO HPI OUTPUT STREAM */
+            PA_ENSURE_( PaAsiHpi_EndProcessing( stream, framesGot, cbFlags ) );
+            /* Advance frame counter */
+            framesAvail -= framesGot;
+        }
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesGot );
+
+        if( framesGot == 0 )
+        {
+            /* Go back to polling for more frames */
+            break;
+
+        }
+        if( *callbackResult != paContinue )
+            break;
     }
 
 error:
@@ -2585,7 +3071,7 @@ static void *CallbackThreadFunc( void *userData )
     while( 1 )
     {
         PaStreamCallbackFlags cbFlags = 0;
-        unsigned long framesAvail, framesGot;
+        unsigned long framesAvail;
 
         pthread_testcancel();
 
@@ -2608,7 +3094,7 @@ static void *CallbackThreadFunc( void *userData )
             {
                 goto end;
             }
-            PA_DEBUG(( "%s: Flushing buffer processor\n", __FUNCTION__ ));
+            PA_DEBUG(( "Flushing buffer processor\n", __FUNCTION__ ));
             /* There is still buffered output that needs to be processed */
         }
 
@@ -2617,85 +3103,386 @@ static void *CallbackThreadFunc( void *userData )
         polls the HPI interface until a full block of frames can be moved. */
         PA_ENSURE_( PaAsiHpi_WaitForFrames( stream, &framesAvail, &cbFlags ) );
 
-        /* Consume buffer space. Once we have a number of frames available for consumption we
-        must retrieve the data from the HPI interface and pass it to the PA buffer processor.
-        We should be prepared to process several chunks successively. */
-        while( framesAvail > 0 )
+        /* Consume buffer space, passing it through the user callback */
+        PA_ENSURE_( PaAsiHpi_ProcessFrames( stream, framesAvail, &cbFlags, &callbackResult ) );
+    }
+
+end:
+    /* Indicates normal exit of callback, as opposed to the thread getting killed explicitly */
+    stream->callbackFinished = 1;
+    PA_DEBUG(( "Thread %d exiting (callbackResult = %d)\n ",
+               pthread_self(), callbackResult ));
+
+    /* The loop is left through end, so that PaAsiHpi_OnThreadExit() runs here. This is
+     * important to include regardless because it is possibly a macro with a closing
+     * brace to match the opening brace in pthread_cleanup_push() above.  The
+     * documentation states that they must always occur in pairs. */
+    pthread_cleanup_pop( 1 );
+
+    /* Exit from thread and report any PortAudio error in the process */
+    PaUnixThreading_EXIT( result );
+error:
+    goto end;
+}
+
+/* --------------------------- Callback Groups --------------------------- */
+
+/** Service a stream of a callback group, the counterpart of an iteration of CallbackThreadFunc.
+ Instead of sleeping until the stream is ready, this reports how long the group thread may
+ sleep before the stream has to be serviced again. A stream that finished flushing its
+ buffered output also lets its output drain that way, rather than blocking the other streams
+ of the group in PaAsiHpi_StopStream.
+
+ @param stream Pointer to stream struct
+
+ @param finished Returns whether the stream is done, it is then stopped by the caller
+
+ @param waitTime Returns the time (in seconds) before the stream needs servicing again,
+                 left as is if the stream should be serviced again right away
+
+ @return PortAudio error code
+ */
+static PaError PaAsiHpi_ServiceGroupMember( PaAsiHpiStream *stream, int *finished, double *waitTime )
+{
+    PaError result = paNoError;
+    PaAsiHpiGroupMember *self = &stream->member;
+    double sampleRate = stream->baseStreamRep.streamInfo.sampleRate;
+    unsigned long framesAvail = 0;
+    uint32_t framesLeft;
+
+    /** @concern StreamStop As in CallbackThreadFunc, flush buffered output unless aborting */
+    if( self->stopRequested )
+    {
+        if( stream->callbackAbort )
+            self->callbackResult = paAbort;
+        else if( self->callbackResult == paContinue )
+            self->callbackResult = paComplete;
+    }
+
+    if( self->callbackResult != paContinue )
+    {
+        stream->callbackAbort = (self->callbackResult == paAbort);
+        if( stream->callbackAbort )
         {
-            PaStreamCallbackTimeInfo timeInfo = {0, 0, 0};
+            *finished = 1;
+            goto end;
+        }
+        if( PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+        {
+            PA_ENSURE_( PaAsiHpi_GetOutputBacklog( stream, &framesLeft ) );
+            if( framesLeft == 0 )
+                *finished = 1;
+            else
+                *waitTime = framesLeft / sampleRate;
+            goto end;
+        }
+    }
+
+    PA_ENSURE_( PaAsiHpi_CheckFrames( stream, &framesAvail, &self->cbFlags, &framesLeft ) );
+    if( framesLeft > 0 )
+    {
+        *waitTime = framesLeft / sampleRate;
+        goto end;
+    }
+    PA_ENSURE_( PaAsiHpi_ProcessFrames( stream, framesAvail, &self->cbFlags, &self->callbackResult ) );
+    self->cbFlags = 0;
+
+end:
+error:
+    return result;
+}
+
+
+/** Stop the streams of a list that the group thread let go of, and tell StopStream they are done.
+ The mutex of the group is released meanwhile, as the finished callbacks may stop other
+ streams of the group.
+
+ @param self Pointer to callback group
+
+ @param streams The streams to stop, linked by their member.next
+ */
+static void PaAsiHpi_StopGroupStreams( PaAsiHpiCallbackGroup *self, PaAsiHpiStream *streams )
+{
+    PaAsiHpiStream *stream;
+
+    PaUnixMutex_Unlock( &self->mtx );
+    for( stream = streams; stream; stream = stream->member.next )
+    {
+        stream->callbackFinished = 1;
+        PaAsiHpi_OnThreadExit( stream );
+    }
+    PaUnixMutex_Lock( &self->mtx );
+
+    for( stream = streams; stream; stream = stream->member.next )
+        stream->member.running = 0;
+    pthread_cond_broadcast( &self->runningChanged );
+}
+
+
+/** Sleep in the group thread, releasing the mutex of the group meanwhile.
+ The sleep ends early when a stream joins the group or is asked to stop.
+
+ @param self Pointer to callback group
+
+ @param seconds Time to sleep for, or a negative value to sleep until woken up
+ */
+static void PaAsiHpi_SleepInGroup( PaAsiHpiCallbackGroup *self, double seconds )
+{
+    struct timespec deadline;
+
+    if( seconds < 0.0 )
+    {
+        pthread_cond_wait( &self->wake, &self->mtx.mtx );
+        return;
+    }
+    /* As in PaAsiHpi_SleepFrames, don't spin on the adapter */
+    if( seconds < PA_ASIHPI_MIN_SLEEP_USEC_ / 1e6 )
+        seconds = PA_ASIHPI_MIN_SLEEP_USEC_ / 1e6;
+
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += (time_t)seconds;
+    deadline.tv_nsec += (long)((seconds - floor( seconds )) * 1e9);
+    if( deadline.tv_nsec >= 1000000000 )
+    {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait( &self->wake, &self->mtx.mtx, &deadline );
+}
+
+
+/** Group thread's function.
+ This services all streams of the adapter's callback group in turn, then sleeps until the
+ first of them can move a host buffer again. The mutex of the group is held except while
+ sleeping and while finished streams are stopped.
+
+ @param userData Pointer to callback group
+ */
+static void *PaAsiHpi_GroupThreadFunc( void *userData )
+{
+    PaError result = paNoError;
+    PaAsiHpiCallbackGroup *group = (PaAsiHpiCallbackGroup *) userData;
+    PaAsiHpiStream *stream, *finished, **link;
+
+    PaUnixMutex_Lock( &group->mtx );
 
-            pthread_testcancel();
+    while( group->streamCount > 0 )
+    {
+        /* Sleep until woken up if no stream is being serviced */
+        double waitTime = -1.0;
+        int waiting = 0;
+
+        finished = NULL;
+        link = &group->running;
+        while( (stream = *link) )
+        {
+            int done = 0;
+            double streamWait = 0.0;
+            PaError serviceResult = PaAsiHpi_ServiceGroupMember( stream, &done, &streamWait );
 
-            framesGot = framesAvail;
-            if( stream->bufferProcessor.hostBufferSizeMode == paUtilFixedHostBufferSize )
+            if( serviceResult != paNoError || done )
             {
-                /* We've committed to a fixed host buffer size, stick to that */
-                framesGot = framesGot >= stream->maxFramesPerHostBuffer ? stream->maxFramesPerHostBuffer : 0;
+                if( serviceResult != paNoError )
+                {
+                    PA_DEBUG(( "%s: Stream is stopped due to error %d\n", __FUNCTION__, serviceResult ));
+                    stream->callbackAbort = 1;
+                }
+                *link = stream->member.next;
+                stream->member.next = finished;
+                finished = stream;
             }
             else
             {
-                /* We've committed to an upper bound on the size of host buffers */
-                assert( stream->bufferProcessor.hostBufferSizeMode == paUtilBoundedHostBufferSize );
-                framesGot = PA_MIN( framesGot, stream->maxFramesPerHostBuffer );
+                /* Sleep until the first of the streams needs servicing */
+                if( !waiting || streamWait < waitTime )
+                    waitTime = streamWait;
+                waiting = 1;
+                link = &stream->member.next;
             }
+        }
 
-            /* Obtain buffer timestamps */
-            PaAsiHpi_CalculateTimeInfo( stream, &timeInfo );
-            PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, cbFlags );
-            /* CPU load measurement should include processing activivity external to the stream callback */
-            PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
-            if( framesGot > 0 )
-            {
-                /* READ FROM HPI INPUT STREAM */
-                PA_ENSURE_( PaAsiHpi_BeginProcessing( stream, &framesGot, &cbFlags ) );
-                /* Input overflow in a full-duplex stream makes for interesting times */
-                if( stream->input && stream->output && (cbFlags & paInputOverflow) )
-                {
-                    /* Special full-duplex paNeverDropInput mode */
-                    if( stream->neverDropInput )
-                    {
-                        PaUtil_SetNoOutput( &stream->bufferProcessor );
-                        cbFlags |= paOutputOverflow;
-                    }
-                }
-                /* CALL USER CALLBACK WITH INPUT DATA, AND OBTAIN OUTPUT DATA */
-                PaUtil_EndBufferProcessing( &stream->bufferProcessor, &callbackResult );
-                /* Clear overflow and underflow information (but PaAsiHpi_EndProcessing might
-                still show up output underflow that will carry over to next round) */
-                cbFlags = 0;
-                /*  WRITE TO HPI OUTPUT STREAM */
-                PA_ENSURE_( PaAsiHpi_EndProcessing( stream, framesGot, &cbFlags ) );
-                /* Advance frame counter */
-                framesAvail -= framesGot;
-            }
-            PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesGot );
+        if( finished )
+        {
+            PaAsiHpi_StopGroupStreams( group, finished );
+            /* Look at the remaining streams again, as they may have been stopped meanwhile */
+            continue;
+        }
+        if( waitTime != 0.0 )
+            PaAsiHpi_SleepInGroup( group, waitTime );
+    }
 
-            if( framesGot == 0 )
-            {
-                /* Go back to polling for more frames */
-                break;
+    PaUnixMutex_Unlock( &group->mtx );
+    PaUnixThreading_EXIT( result );
+}
 
-            }
-            if( callbackResult != paContinue )
-                break;
+
+/** Free a callback group, whose thread has quit.
+
+ @param self Pointer to callback group
+ */
+static void PaAsiHpi_FreeCallbackGroup( PaAsiHpiCallbackGroup *self )
+{
+    pthread_cond_destroy( &self->runningChanged );
+    pthread_cond_destroy( &self->wake );
+    PaUnixMutex_Terminate( &self->mtx );
+    PaUtil_FreeMemory( self );
+}
+
+
+/** Create the callback group of an adapter, without starting its thread.
+
+ @param group Returns the new group
+
+ @param adapterIndex Adapter of the streams of the group
+
+ @return PortAudio error code
+ */
+static PaError PaAsiHpi_NewCallbackGroup( PaAsiHpiCallbackGroup **group, uint16_t adapterIndex )
+{
+    PaError result = paNoError;
+    PaAsiHpiCallbackGroup *self;
+
+    PA_UNLESS_( self = (PaAsiHpiCallbackGroup *) PaUtil_AllocateMemory( sizeof(PaAsiHpiCallbackGroup) ),
+                paInsufficientMemory );
+    memset( self, 0, sizeof(PaAsiHpiCallbackGroup) );
+    self->adapterIndex = adapterIndex;
+    result = PaUnixMutex_Initialize( &self->mtx );
+    if( result != paNoError )
+    {
+        PaUtil_FreeMemory( self );
+        goto error;
+    }
+    pthread_cond_init( &self->wake, NULL );
+    pthread_cond_init( &self->runningChanged, NULL );
+
+    *group = self;
+
+error:
+    return result;
+}
+
+
+/** Have a started callback stream serviced by the thread of its adapter's callback group,
+ creating the group if there is none.
+
+ @param stream Pointer to stream struct, whose HPI streams are started
+
+ @return PortAudio error code
+ */
+static PaError PaAsiHpi_JoinCallbackGroup( PaAsiHpiStream *stream )
+{
+    PaError result = paNoError;
+    PaAsiHpiHostApiRepresentation *hpiHostApi = stream->hpiHostApi;
+    PaAsiHpiCallbackGroup *group;
+    /* A full-duplex stream spanning two adapters is serviced with the streams of its input adapter */
+    uint16_t adapterIndex = (stream->input ? stream->input : stream->output)->hpiDevice->adapterIndex;
+    int created = 0;
+
+    PaUnixMutex_Lock( &hpiHostApi->callbackGroupsMtx );
+
+    for( group = hpiHostApi->callbackGroups; group; group = group->next )
+    {
+        if( group->adapterIndex == adapterIndex )
+            break;
+    }
+    if( !group )
+    {
+        PA_ENSURE_( PaAsiHpi_NewCallbackGroup( &group, adapterIndex ) );
+        created = 1;
+    }
+
+    PaUnixMutex_Lock( &group->mtx );
+    memset( &stream->member, 0, sizeof(PaAsiHpiGroupMember) );
+    stream->member.group = group;
+    stream->member.running = 1;
+    stream->member.callbackResult = paContinue;
+    stream->member.next = group->running;
+    group->running = stream;
+    ++group->streamCount;
+    pthread_cond_signal( &group->wake );
+    PaUnixMutex_Unlock( &group->mtx );
+
+    if( created )
+    {
+        /* The thread lives as long as the group has streams */
+        result = PaUnixThread_New( &group->thread, &PaAsiHpi_GroupThreadFunc, group, 0., NULL /*scheduling*/, NULL, 0 );
+        if( result != paNoError )
+        {
+            memset( &stream->member, 0, sizeof(PaAsiHpiGroupMember) );
+            PaAsiHpi_FreeCallbackGroup( group );
+            goto error;
         }
+        group->next = hpiHostApi->callbackGroups;
+        hpiHostApi->callbackGroups = group;
     }
 
-    /* This code is unreachable, but important to include regardless because it
-     * is possibly a macro with a closing brace to match the opening brace in
-     * pthread_cleanup_push() above.  The documentation states that they must
-     * always occur in pairs. */
-    pthread_cleanup_pop( 1 );
+error:
+    PaUnixMutex_Unlock( &hpiHostApi->callbackGroupsMtx );
+    return result;
+}
+
+
+/** Stop having a stream serviced by its callback group, ending the thread with the last
+ stream of the group. Unless the stream finished on its own, the thread flushes (or drops,
+ if abort) the output and stops the HPI streams.
+
+ Don't call this from the callback engine thread!
+
+ @param stream Pointer to stream struct
+
+ @param abort True if samples in output buffer should be discarded
+
+ @return PortAudio error code
+ */
+static PaError PaAsiHpi_LeaveCallbackGroup( PaAsiHpiStream *stream, int abort )
+{
+    PaError result = paNoError;
+    PaAsiHpiHostApiRepresentation *hpiHostApi = stream->hpiHostApi;
+    PaAsiHpiCallbackGroup *group = stream->member.group, **link;
+    int last;
+
+    PaUnixMutex_Lock( &group->mtx );
+    if( stream->member.running )
+    {
+        stream->callbackAbort = abort;
+        stream->member.stopRequested = 1;
+        pthread_cond_signal( &group->wake );
+
+        while( stream->member.running )
+            pthread_cond_wait( &group->runningChanged, &group->mtx.mtx );
+    }
+    PaUnixMutex_Unlock( &group->mtx );
+
+    /* No stream may join while the group is taken down */
+    PaUnixMutex_Lock( &hpiHostApi->callbackGroupsMtx );
+    PaUnixMutex_Lock( &group->mtx );
+    last = --group->streamCount == 0;
+    if( last )
+        pthread_cond_signal( &group->wake );
+    PaUnixMutex_Unlock( &group->mtx );
+    if( last )
+    {
+        for( link = &hpiHostApi->callbackGroups; *link != group; link = &(*link)->next )
+            ;
+        *link = group->next;
+    }
+    PaUnixMutex_Unlock( &hpiHostApi->callbackGroupsMtx );
+    stream->member.group = NULL;
+
+    if( last )
+    {
+        PaError threadRes;
+
+        PA_ENSURE_( PaUnixThread_Terminate( &group->thread, 1, &threadRes ) );
+        if( threadRes != paNoError )
+        {
+            PA_DEBUG(( "Shared callback thread returned: %d\n", threadRes ));
+        }
+        PaAsiHpi_FreeCallbackGroup( group );
+    }
 
-end:
-    /* Indicates normal exit of callback, as opposed to the thread getting killed explicitly */
-    stream->callbackFinished = 1;
-    PA_DEBUG(( "%s: Thread %d exiting (callbackResult = %d)\n ",
-               __FUNCTION__, pthread_self(), callbackResult ));
-    /* Exit from thread and report any PortAudio error in the process */
-    PaUnixThreading_EXIT( result );
 error:
-    goto end;
+    return result;
 }
 
 /* --------------------------- Blocking Interface --------------------------- */
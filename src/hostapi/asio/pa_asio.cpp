@@ -100,6 +100,7 @@
 #include "pa_process.h"
 #include "pa_debugprint.h"
 #include "pa_ringbuffer.h"
+#include "pa_cpufeatures.h"
 
 #include "pa_win_coinitialize.h"
 
@@ -593,6 +594,258 @@ static void ConvertFloat32ToFloat64( void *buffer, long shift, long count )
         *out-- = *in--;
 }
 
+/*
+    SIMD versions of the swap and shift converters above. With many channels these run for
+    every channel on every bufferSwitch, so they matter. They produce exactly the same
+    results as the scalar versions, which handle the remaining samples.
+    The scalar converters are selected first and then replaced by
+    SelectOptimizedConverter().
+*/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PA_ASIO_SSE2_
+#include <emmintrin.h>
+
+#if defined(__clang__) || \
+    ( defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) )
+#define PA_ASIO_AVX2_
+#define PA_ASIO_AVX2_TARGET_ __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && _MSC_VER >= 1700
+#define PA_ASIO_AVX2_
+#define PA_ASIO_AVX2_TARGET_
+#endif
+
+#ifdef PA_ASIO_AVX2_
+#include <immintrin.h>
+#endif
+#endif /* PA_ASIO_SSE2_ */
+
+
+#ifdef PA_ASIO_SSE2_
+
+static __m128i Swap16Bytes_SSE2( __m128i v )
+{
+    return _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+}
+
+static __m128i Swap32Bytes_SSE2( __m128i v )
+{
+    /* swap the 16 bit halves, then the bytes within them */
+    v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, _MM_SHUFFLE(2,3,0,1) ), _MM_SHUFFLE(2,3,0,1) );
+    return Swap16Bytes_SSE2( v );
+}
+
+static void Swap16_SSE2( void *buffer, long shift, long count )
+{
+    unsigned short *p = (unsigned short*)buffer;
+    long i, vectorCount = count & ~7L;
+
+    for( i = 0; i < vectorCount; i += 8 )
+        _mm_storeu_si128( (__m128i*)(p + i), Swap16Bytes_SSE2( _mm_loadu_si128( (const __m128i*)(p + i) ) ) );
+
+    Swap16( p + i, shift, count - i );
+}
+
+static void Swap32_SSE2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~3L;
+
+    for( i = 0; i < vectorCount; i += 4 )
+        _mm_storeu_si128( (__m128i*)(p + i), Swap32Bytes_SSE2( _mm_loadu_si128( (const __m128i*)(p + i) ) ) );
+
+    Swap32( p + i, shift, count - i );
+}
+
+static void SwapShiftLeft32_SSE2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~3L;
+    __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 4 )
+        _mm_storeu_si128( (__m128i*)(p + i),
+                _mm_sll_epi32( Swap32Bytes_SSE2( _mm_loadu_si128( (const __m128i*)(p + i) ) ), s ) );
+
+    SwapShiftLeft32( p + i, shift, count - i );
+}
+
+static void ShiftRightSwap32_SSE2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~3L;
+    __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 4 )
+        _mm_storeu_si128( (__m128i*)(p + i),
+                Swap32Bytes_SSE2( _mm_srl_epi32( _mm_loadu_si128( (const __m128i*)(p + i) ), s ) ) );
+
+    ShiftRightSwap32( p + i, shift, count - i );
+}
+
+static void ShiftLeft32_SSE2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~3L;
+    __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 4 )
+        _mm_storeu_si128( (__m128i*)(p + i), _mm_sll_epi32( _mm_loadu_si128( (const __m128i*)(p + i) ), s ) );
+
+    ShiftLeft32( p + i, shift, count - i );
+}
+
+static void ShiftRight32_SSE2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~3L;
+    __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 4 )
+        _mm_storeu_si128( (__m128i*)(p + i), _mm_srl_epi32( _mm_loadu_si128( (const __m128i*)(p + i) ), s ) );
+
+    ShiftRight32( p + i, shift, count - i );
+}
+
+#ifdef PA_ASIO_AVX2_
+
+/* byte order reversal masks for _mm256_shuffle_epi8, per 128 bit lane */
+#define PA_ASIO_SWAP16_MASK_ \
+    _mm256_setr_epi8( 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14 )
+#define PA_ASIO_SWAP32_MASK_ \
+    _mm256_setr_epi8( 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12 )
+
+PA_ASIO_AVX2_TARGET_ static void Swap16_AVX2( void *buffer, long shift, long count )
+{
+    unsigned short *p = (unsigned short*)buffer;
+    long i, vectorCount = count & ~15L;
+    const __m256i mask = PA_ASIO_SWAP16_MASK_;
+
+    for( i = 0; i < vectorCount; i += 16 )
+        _mm256_storeu_si256( (__m256i*)(p + i), _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)(p + i) ), mask ) );
+
+    _mm256_zeroupper();
+    Swap16_SSE2( p + i, shift, count - i );
+}
+
+PA_ASIO_AVX2_TARGET_ static void Swap24_AVX2( void *buffer, long shift, long count )
+{
+    /* 5 samples (15 bytes) per 16 byte load, the 16th byte is stored back unchanged.
+        Stop while there are at least 16 bytes left so we never access past the buffer. */
+    unsigned char *p = (unsigned char*)buffer;
+    const __m128i mask = _mm_setr_epi8( 2,1,0, 5,4,3, 8,7,6, 11,10,9, 14,13,12, 15 );
+
+    while( count >= 6 )
+    {
+        _mm_storeu_si128( (__m128i*)p, _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)p ), mask ) );
+        p += 15;
+        count -= 5;
+    }
+
+    Swap24( p, shift, count );
+}
+
+PA_ASIO_AVX2_TARGET_ static void Swap32_AVX2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~7L;
+    const __m256i mask = PA_ASIO_SWAP32_MASK_;
+
+    for( i = 0; i < vectorCount; i += 8 )
+        _mm256_storeu_si256( (__m256i*)(p + i), _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)(p + i) ), mask ) );
+
+    _mm256_zeroupper();
+    Swap32_SSE2( p + i, shift, count - i );
+}
+
+PA_ASIO_AVX2_TARGET_ static void SwapShiftLeft32_AVX2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~7L;
+    const __m256i mask = PA_ASIO_SWAP32_MASK_;
+    const __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 8 )
+        _mm256_storeu_si256( (__m256i*)(p + i),
+                _mm256_sll_epi32( _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)(p + i) ), mask ), s ) );
+
+    _mm256_zeroupper();
+    SwapShiftLeft32_SSE2( p + i, shift, count - i );
+}
+
+PA_ASIO_AVX2_TARGET_ static void ShiftRightSwap32_AVX2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~7L;
+    const __m256i mask = PA_ASIO_SWAP32_MASK_;
+    const __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 8 )
+        _mm256_storeu_si256( (__m256i*)(p + i),
+                _mm256_shuffle_epi8( _mm256_srl_epi32( _mm256_loadu_si256( (const __m256i*)(p + i) ), s ), mask ) );
+
+    _mm256_zeroupper();
+    ShiftRightSwap32_SSE2( p + i, shift, count - i );
+}
+
+PA_ASIO_AVX2_TARGET_ static void ShiftLeft32_AVX2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~7L;
+    const __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 8 )
+        _mm256_storeu_si256( (__m256i*)(p + i), _mm256_sll_epi32( _mm256_loadu_si256( (const __m256i*)(p + i) ), s ) );
+
+    _mm256_zeroupper();
+    ShiftLeft32_SSE2( p + i, shift, count - i );
+}
+
+PA_ASIO_AVX2_TARGET_ static void ShiftRight32_AVX2( void *buffer, long shift, long count )
+{
+    unsigned int *p = (unsigned int*)buffer;
+    long i, vectorCount = count & ~7L;
+    const __m128i s = _mm_cvtsi32_si128( (int)shift );
+
+    for( i = 0; i < vectorCount; i += 8 )
+        _mm256_storeu_si256( (__m256i*)(p + i), _mm256_srl_epi32( _mm256_loadu_si256( (const __m256i*)(p + i) ), s ) );
+
+    _mm256_zeroupper();
+    ShiftRight32_SSE2( p + i, shift, count - i );
+}
+
+#endif /* PA_ASIO_AVX2_ */
+#endif /* PA_ASIO_SSE2_ */
+
+
+typedef void PaAsioBufferConverter( void *, long, long );
+
+/* Returns the fastest converter equivalent to the scalar converter passed in */
+static PaAsioBufferConverter *SelectOptimizedConverter( PaAsioBufferConverter *converter )
+{
+#ifdef PA_ASIO_SSE2_
+#ifdef PA_ASIO_AVX2_
+    if( PaUtil_GetCpuFeatures() & paCpuAVX2 )
+    {
+        if( converter == Swap16 ) return Swap16_AVX2;
+        if( converter == Swap24 ) return Swap24_AVX2;
+        if( converter == Swap32 ) return Swap32_AVX2;
+        if( converter == SwapShiftLeft32 ) return SwapShiftLeft32_AVX2;
+        if( converter == ShiftRightSwap32 ) return ShiftRightSwap32_AVX2;
+        if( converter == ShiftLeft32 ) return ShiftLeft32_AVX2;
+        if( converter == ShiftRight32 ) return ShiftRight32_AVX2;
+    }
+#endif
+    if( converter == Swap16 ) return Swap16_SSE2;
+    if( converter == Swap32 ) return Swap32_SSE2;
+    if( converter == SwapShiftLeft32 ) return SwapShiftLeft32_SSE2;
+    if( converter == ShiftRightSwap32 ) return ShiftRightSwap32_SSE2;
+    if( converter == ShiftLeft32 ) return ShiftLeft32_SSE2;
+    if( converter == ShiftRight32 ) return ShiftRight32_SSE2;
+#endif
+    return converter;
+}
+
 #ifdef MAC
 #define PA_MSB_IS_NATIVE_
 #undef PA_LSB_IS_NATIVE_
@@ -603,8 +856,6 @@ static void ConvertFloat32ToFloat64( void *buffer, long shift, long count )
 #define PA_LSB_IS_NATIVE_
 #endif
 
-typedef void PaAsioBufferConverter( void *, long, long );
-
 static void SelectAsioToPaConverter( ASIOSampleType type, PaAsioBufferConverter **converter, long *shift )
 {
     *shift = 0;
@@ -1356,6 +1607,11 @@ PaError PaAsio_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &asioHostApi->callbackStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
@@ -1623,6 +1879,8 @@ typedef struct PaAsioStream
     PaAsioBufferConverter *outputBufferConverter;
     long outputShift;
 
+    bool zeroCopy; /* callback is handed the ASIO buffers directly, see bufferSwitchTimeInfo() */
+
     volatile bool stopProcessing;
     int stopPlayoutCount;
     HANDLE completedBuffersPlayedEvent;
@@ -2293,8 +2551,10 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                 ? suggestedInputLatencyFrames 
                 : suggestedOutputLatencyFrames);
 
+        /* Batched callbacks leave the host buffer size to the suggested latency */
         framesPerHostBuffer = SelectHostBufferSize( targetBufferingLatencyFrames, 
-                framesPerBuffer, driverInfo );
+                ( streamFlags & paBatchCallbacks ) ? paFramesPerBufferUnspecified : framesPerBuffer,
+                driverInfo );
     }
 
 
@@ -2416,6 +2676,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         hostInputSampleFormat = AsioSampleTypeToPaNativeSampleFormat( inputType );
 
         SelectAsioToPaConverter( inputType, &stream->inputBufferConverter, &stream->inputShift );
+        stream->inputBufferConverter = SelectOptimizedConverter( stream->inputBufferConverter );
     }
     else
     {
@@ -2437,6 +2698,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         hostOutputSampleFormat = AsioSampleTypeToPaNativeSampleFormat( outputType );
 
         SelectPaToAsioConverter( outputType, &stream->outputBufferConverter, &stream->outputShift );
+        stream->outputBufferConverter = SelectOptimizedConverter( stream->outputBufferConverter );
     }
     else
     {
@@ -2445,8 +2707,11 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
 
     /* Values returned by ASIOGetLatencies() include the latency introduced by 
-       the ASIO double buffer. */
+       the ASIO double buffer. Drivers which support ASIOOutputReady() report
+       the output latency without the extra buffer they would otherwise keep
+       in flight, as we call it after every bufferSwitch. */
     ASIOGetLatencies( &stream->asioInputLatencyFrames, &stream->asioOutputLatencyFrames );
+    PA_DEBUG(("PaAsio : ASIOOutputReady() %s\n", driverInfo->postOutput ? "supported" : "not supported"));
 
 
     /* Using blocking i/o interface... */
@@ -2499,6 +2764,14 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             goto error;
         }
         callbackBufferProcessorInited = TRUE;
+        /* nothing but the buffer processor writes the ASIO double buffers */
+        PaUtil_SetBufferProcessorPersistentHostOutput( &stream->bufferProcessor );
+        stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+        stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+        stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+        stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+        stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+        stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
         /* Initialize the blocking i/o buffer processor. */
         result = PaUtil_InitializeBufferProcessor(&stream->blockingState->bufferProcessor,
@@ -2705,6 +2978,9 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     }
     else /* Using callback interface... */
     {
+        /* Batched callbacks get a whole number of ASIO buffers */
+        framesPerBuffer = PaUtil_GetBatchedFramesPerUserBuffer( streamFlags, framesPerBuffer, framesPerHostBuffer );
+
         result =  PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
                         inputChannelCount, inputSampleFormat, (hostInputSampleFormat | paNonInterleaved),
                         outputChannelCount, outputSampleFormat, (hostOutputSampleFormat | paNonInterleaved),
@@ -2716,6 +2992,28 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             goto error;
         }
         callbackBufferProcessorInited = TRUE;
+        /* nothing but the buffer processor writes the ASIO double buffers */
+        PaUtil_SetBufferProcessorPersistentHostOutput( &stream->bufferProcessor );
+        stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+        stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+        stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+        stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+        stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+        stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+
+        /* If the user format is the native non-interleaved ASIO format and the user buffer
+            size is the ASIO buffer size, the buffer processor would only copy. In that case
+            the callback gets the ASIO half-buffer pointers directly. */
+        stream->zeroCopy =
+                ( inputChannelCount == 0
+                    || ( stream->inputBufferConverter == 0
+                        && inputSampleFormat == (hostInputSampleFormat | paNonInterleaved) ) )
+                && ( outputChannelCount == 0
+                    || ( stream->outputBufferConverter == 0
+                        && outputSampleFormat == (hostOutputSampleFormat | paNonInterleaved) ) )
+                && ( framesPerBuffer == paFramesPerBufferUnspecified
+                    || framesPerBuffer == framesPerHostBuffer );
+        PA_DEBUG(("PaAsio : zero-copy callback %s\n", stream->zeroCopy ? "enabled" : "disabled"));
 
         stream->streamRepresentation.streamInfo.inputLatency =
                 (double)( PaUtil_GetBufferProcessorInputLatencyFrames(&stream->bufferProcessor)
@@ -3114,25 +3412,43 @@ previousTime = paTimeInfo.currentTime;
                     }
                 }
 
-                PaUtil_BeginBufferProcessing( &theAsioStream->bufferProcessor, &paTimeInfo, theAsioStream->callbackFlags );
-
-                /* reset status flags once they've been passed to the callback */
-                theAsioStream->callbackFlags = 0;
-
-                PaUtil_SetInputFrameCount( &theAsioStream->bufferProcessor, 0 /* default to host buffer size */ );
-                for( i=0; i<theAsioStream->inputChannelCount; ++i )
-                    PaUtil_SetNonInterleavedInputChannel( &theAsioStream->bufferProcessor, i, theAsioStream->inputBufferPtrs[index][i] );
-
-                PaUtil_SetOutputFrameCount( &theAsioStream->bufferProcessor, 0 /* default to host buffer size */ );
-                for( i=0; i<theAsioStream->outputChannelCount; ++i )
-                    PaUtil_SetNonInterleavedOutputChannel( &theAsioStream->bufferProcessor, i, theAsioStream->outputBufferPtrs[index][i] );
-
                 int callbackResult;
                 if( theAsioStream->stopProcessing )
                     callbackResult = paComplete;
                 else
                     callbackResult = paContinue;
-                unsigned long framesProcessed = PaUtil_EndBufferProcessing( &theAsioStream->bufferProcessor, &callbackResult );
+                unsigned long framesProcessed;
+
+                if( theAsioStream->zeroCopy && PaUtil_CanBypassBufferProcessor( &theAsioStream->bufferProcessor ) )
+                {
+                    /* hand the ASIO buffers to the callback, the buffer processor silences
+                        them when the callback isn't called or returns paAbort */
+                    PaUtil_BeginBufferProcessing( &theAsioStream->bufferProcessor, &paTimeInfo, theAsioStream->callbackFlags );
+
+                    /* reset status flags once they've been passed to the callback */
+                    theAsioStream->callbackFlags = 0;
+
+                    framesProcessed = PaUtil_EndBufferProcessingDirectly( &theAsioStream->bufferProcessor,
+                            theAsioStream->inputBufferPtrs[index], theAsioStream->outputBufferPtrs[index],
+                            theAsioStream->framesPerHostCallback, &callbackResult );
+                }
+                else
+                {
+                    PaUtil_BeginBufferProcessing( &theAsioStream->bufferProcessor, &paTimeInfo, theAsioStream->callbackFlags );
+
+                    /* reset status flags once they've been passed to the callback */
+                    theAsioStream->callbackFlags = 0;
+
+                    PaUtil_SetInputFrameCount( &theAsioStream->bufferProcessor, 0 /* default to host buffer size */ );
+                    for( i=0; i<theAsioStream->inputChannelCount; ++i )
+                        PaUtil_SetNonInterleavedInputChannel( &theAsioStream->bufferProcessor, i, theAsioStream->inputBufferPtrs[index][i] );
+
+                    PaUtil_SetOutputFrameCount( &theAsioStream->bufferProcessor, 0 /* default to host buffer size */ );
+                    for( i=0; i<theAsioStream->outputChannelCount; ++i )
+                        PaUtil_SetNonInterleavedOutputChannel( &theAsioStream->bufferProcessor, i, theAsioStream->outputBufferPtrs[index][i] );
+
+                    framesProcessed = PaUtil_EndBufferProcessing( &theAsioStream->bufferProcessor, &callbackResult );
+                }
 
                 if( theAsioStream->outputBufferConverter )
                 {
@@ -3257,8 +3573,28 @@ static long asioMessages(long selector, long value, void* message, double* opt)
             // This will inform the host application that the drivers were latencies changed.
             // Beware, it this does not mean that the buffer sizes have changed!
             // You might need to update internal delay data.
+            // Some drivers only drop the extra output buffer once they have seen
+            // ASIOOutputReady() being called, and tell us so here.
+            if( theAsioStream )
+            {
+                long inputLatencyFrames, outputLatencyFrames;
+                double sampleRate = theAsioStream->streamRepresentation.streamInfo.sampleRate;
+
+                if( ASIOGetLatencies( &inputLatencyFrames, &outputLatencyFrames ) == ASE_OK )
+                {
+                    /* the latencies reported by the driver are the only part of the
+                        stream latencies which can change */
+                    theAsioStream->streamRepresentation.streamInfo.inputLatency +=
+                            (double)(inputLatencyFrames - theAsioStream->asioInputLatencyFrames) / sampleRate;
+                    theAsioStream->streamRepresentation.streamInfo.outputLatency +=
+                            (double)(outputLatencyFrames - theAsioStream->asioOutputLatencyFrames) / sampleRate;
+                    theAsioStream->asioInputLatencyFrames = inputLatencyFrames;
+                    theAsioStream->asioOutputLatencyFrames = outputLatencyFrames;
+                    PA_DEBUG(("kAsioLatenciesChanged : input %ld, output %ld frames\n",
+                            inputLatencyFrames, outputLatencyFrames));
+                }
+            }
             ret = 1L;
-            //printf("kAsioLatenciesChanged \n");
             break;
 
         case kAsioEngineVersion:
@@ -65,7 +65,13 @@
 #include "pa_mac_core_internal.h"
 
 #include <string.h> /* strlen(), memcmp() etc. */
+#include <unistd.h> /* getpid() */
 #include <libkern/OSAtomic.h>
+#if defined(MAC_OS_X_VERSION_MAX_ALLOWED) && MAC_OS_X_VERSION_MAX_ALLOWED >= 110000
+#include <errno.h>
+#include <os/workgroup.h>
+#define PA_MAC_CORE_HAVE_WORKGROUP_ 1
+#endif
 
 #include "pa_mac_core.h"
 #include "pa_mac_core_utilities.h"
@@ -92,10 +98,11 @@ void PaMacCore_SetupStreamInfo(  PaMacCoreStreamInfo *data, const unsigned long
    bzero( data, sizeof( PaMacCoreStreamInfo ) );
    data->size = sizeof( PaMacCoreStreamInfo );
    data->hostApiType = paCoreAudio;
-   data->version = 0x01;
+   data->version = 0x02;
    data->flags = flags;
    data->channelMap = NULL;
    data->channelMapSize = 0;
+   data->ioCycleUsage = 1.0f;
 }
 
 /*
@@ -251,6 +258,100 @@ AudioDeviceID PaMacCore_GetStreamOutputDevice( PaStream* s )
     return ( stream->outputDevice );
 }
 
+PaError PaMacCore_GetStreamWorkgroup( PaStream* s, void **workgroup )
+{
+    PaMacCoreStream *stream = (PaMacCoreStream*)s;
+    VVDBUG(("PaMacCore_GetStreamWorkgroup()\n"));
+
+    *workgroup = NULL;
+#ifdef PA_MAC_CORE_HAVE_WORKGROUP_
+    if( __builtin_available( macOS 11.0, * ) )
+    {
+        /* For duplex streams on two devices the output device drives the callback. */
+        AudioDeviceID device = stream->outputDevice != kAudioDeviceUnknown
+                ? stream->outputDevice : stream->inputDevice;
+        AudioObjectPropertyAddress address = { kAudioDevicePropertyIOThreadOSWorkgroup,
+                                               kAudioObjectPropertyScopeGlobal,
+                                               kAudioObjectPropertyElementMaster };
+        os_workgroup_t group = NULL;
+        UInt32 propSize = sizeof( group );
+        OSStatus err = AudioObjectGetPropertyData( device, &address, 0, NULL, &propSize, &group );
+        if( err != noErr )
+            return ERR( err );
+        *workgroup = (void *)group;
+    }
+#else
+    (void) stream;
+#endif
+    return paNoError;
+}
+
+#ifdef PA_MAC_CORE_HAVE_WORKGROUP_
+typedef struct PaMacCoreWorkgroupMembership
+{
+    os_workgroup_t workgroup;
+    os_workgroup_join_token_s token;
+}
+PaMacCoreWorkgroupMembership;
+#endif
+
+PaError PaMacCore_JoinStreamWorkgroup( PaStream* s, void **membership )
+{
+#ifdef PA_MAC_CORE_HAVE_WORKGROUP_
+    PaError result;
+    void *group = NULL;
+    PaMacCoreWorkgroupMembership *m;
+    int err;
+
+    *membership = NULL;
+    result = PaMacCore_GetStreamWorkgroup( s, &group );
+    if( result != paNoError || group == NULL )
+        return result;
+
+    if( __builtin_available( macOS 11.0, * ) )
+    {
+        m = (PaMacCoreWorkgroupMembership *) malloc( sizeof( PaMacCoreWorkgroupMembership ) );
+        if( !m )
+        {
+            os_release( group );
+            return paInsufficientMemory;
+        }
+        m->workgroup = (os_workgroup_t)group;
+        err = os_workgroup_join( m->workgroup, &m->token );
+        if( err != 0 )
+        {
+            os_release( group );
+            free( m );
+            /* EALREADY: the thread is already in a workgroup, e.g. the IO thread. */
+            return err == EALREADY ? paNoError : UNIX_ERR( err );
+        }
+        *membership = m;
+    }
+    return paNoError;
+#else
+    (void) s;
+    *membership = NULL;
+    return paNoError;
+#endif
+}
+
+void PaMacCore_LeaveStreamWorkgroup( void *membership )
+{
+#ifdef PA_MAC_CORE_HAVE_WORKGROUP_
+    PaMacCoreWorkgroupMembership *m = (PaMacCoreWorkgroupMembership *)membership;
+    if( !m )
+        return;
+    if( __builtin_available( macOS 11.0, * ) )
+    {
+        os_workgroup_leave( m->workgroup, &m->token );
+        os_release( m->workgroup );
+    }
+    free( m );
+#else
+    (void) membership;
+#endif
+}
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -258,6 +359,7 @@ AudioDeviceID PaMacCore_GetStreamOutputDevice( PaStream* s )
 #define RING_BUFFER_ADVANCE_DENOMINATOR (4)
 
 static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError EnableDeviceChangeNotification( struct PaUtilHostApiRepresentation *hostApi, int enable );
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
@@ -273,10 +375,13 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            void *userData );
 static PaError CloseStream( PaStream* stream );
 static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
 static PaError StopStream( PaStream *stream );
 static PaError AbortStream( PaStream *stream );
 static PaError IsStreamStopped( PaStream *s );
 static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
 static PaTime GetStreamTime( PaStream *stream );
 static OSStatus AudioIOProc( void *inRefCon,
                                AudioUnitRenderActionFlags *ioActionFlags,
@@ -284,10 +389,18 @@ static OSStatus AudioIOProc( void *inRefCon,
                                UInt32 inBusNumber,
                                UInt32 inNumberFrames,
                                AudioBufferList *ioData );
+static OSStatus HALIOProc( AudioDeviceID inDevice,
+                           const AudioTimeStamp *inNow,
+                           const AudioBufferList *inInputData,
+                           const AudioTimeStamp *inInputTime,
+                           AudioBufferList *outOutputData,
+                           const AudioTimeStamp *inOutputTime,
+                           void *inClientData );
 static double GetStreamCpuLoad( PaStream* stream );
 
 static PaError GetChannelInfo( PaMacAUHAL *auhalHostApi,
                                PaDeviceInfo *deviceInfo,
+                               PaMacCoreDeviceCache *cache,
                                AudioDeviceID macCoreDeviceId,
                                int isInput);
 
@@ -351,6 +464,9 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
     if( auhalHostApi->devIds )
         PaUtil_GroupFreeMemory(auhalHostApi->allocations, auhalHostApi->devIds);
     auhalHostApi->devIds = NULL;
+    if( auhalHostApi->devCaches )
+        PaUtil_GroupFreeMemory(auhalHostApi->allocations, auhalHostApi->devCaches);
+    auhalHostApi->devCaches = NULL;
 
     /* -- figure out how many devices there are -- */
     AudioHardwareGetPropertyInfo( kAudioHardwarePropertyDevices,
@@ -369,6 +485,21 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
     AudioHardwareGetProperty( kAudioHardwarePropertyDevices,
                                   &propsize,
                                   auhalHostApi->devIds );
+
+    /* -- the device properties are fetched by InitializeDeviceInfo(), except
+          for the sample rates which are left until they are needed -- */
+    if( auhalHostApi->devCount > 0 )
+    {
+       int i;
+       auhalHostApi->devCaches = (PaMacCoreDeviceCache *)PaUtil_GroupAllocateMemory(
+                                auhalHostApi->allocations,
+                                sizeof(PaMacCoreDeviceCache) * auhalHostApi->devCount );
+       if( !auhalHostApi->devCaches )
+           return paInsufficientMemory;
+       memset( auhalHostApi->devCaches, 0, sizeof(PaMacCoreDeviceCache) * auhalHostApi->devCount );
+       for( i=0; i<auhalHostApi->devCount; ++i )
+          auhalHostApi->devCaches[i].changed = PA_MAC_CORE_RATES_CHANGED;
+    }
 #ifdef MAC_CORE_VERBOSE_DEBUG
     {
        int i;
@@ -394,7 +525,7 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
        VDBUG((" I will substitute the first available input Device."));
        for( i=0; i<auhalHostApi->devCount; ++i ) {
           PaDeviceInfo devInfo;
-          if( 0 != GetChannelInfo( auhalHostApi, &devInfo,
+          if( 0 != GetChannelInfo( auhalHostApi, &devInfo, &auhalHostApi->devCaches[i],
                                    auhalHostApi->devIds[i], TRUE ) )
              if( devInfo.maxInputChannels ) {
                 auhalHostApi->defaultIn = auhalHostApi->devIds[i];
@@ -411,7 +542,7 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
        VDBUG((" I will substitute the first available output Device."));
        for( i=0; i<auhalHostApi->devCount; ++i ) {
           PaDeviceInfo devInfo;
-          if( 0 != GetChannelInfo( auhalHostApi, &devInfo,
+          if( 0 != GetChannelInfo( auhalHostApi, &devInfo, &auhalHostApi->devCaches[i],
                                    auhalHostApi->devIds[i], FALSE ) )
              if( devInfo.maxOutputChannels ) {
                 auhalHostApi->defaultOut = auhalHostApi->devIds[i];
@@ -431,17 +562,17 @@ static PaError gatherDeviceInfo(PaMacAUHAL *auhalHostApi)
  * @internal
  * @brief Clip the desired size against the allowed IO buffer size range for the device.
  */
-static PaError ClipToDeviceBufferSize( AudioDeviceID macCoreDeviceId,
+static void ClipToDeviceBufferSize( const PaMacCoreDeviceCache *cache,
 									int isInput, UInt32 desiredSize, UInt32 *allowedSize )
 {
 	UInt32 resultSize = desiredSize;
-	AudioValueRange audioRange;
-	UInt32 propSize = sizeof( audioRange );
-	PaError err = WARNING(AudioDeviceGetProperty( macCoreDeviceId, 0, isInput, kAudioDevicePropertyBufferFrameSizeRange, &propSize, &audioRange ) );
-	resultSize = MAX( resultSize, audioRange.mMinimum );
-	resultSize = MIN( resultSize, audioRange.mMaximum );
+	const AudioValueRange *audioRange = &cache->bufferSizeRange[isInput ? 1 : 0];
+	if( audioRange->mMaximum > 0 ) /* else the range is unknown */
+	{
+		resultSize = MAX( resultSize, audioRange->mMinimum );
+		resultSize = MIN( resultSize, audioRange->mMaximum );
+	}
 	*allowedSize = resultSize;
-	return err;
 }
 
 /* =================================================================================================== */
@@ -541,22 +672,28 @@ error:
 
 /* =================================================================================================== */
 static PaError CalculateDefaultDeviceLatencies( AudioDeviceID macCoreDeviceId,
-                                               int isInput, UInt32 *lowLatencyFramesPtr,
+                                               int isInput, PaMacCoreDeviceCache *cache,
+                                               UInt32 *lowLatencyFramesPtr,
                                                UInt32 *highLatencyFramesPtr )
 {
     UInt32 propSize;
     UInt32 bufferFrames = 0;
     UInt32 fixedLatency = 0;
     UInt32 clippedMinBufferSize = 0;
+    AudioValueRange audioRange;
     
     //DumpDeviceProperties( macCoreDeviceId, isInput );
     
     PaError err = CalculateFixedDeviceLatency( macCoreDeviceId, isInput, &fixedLatency );
     if( err != paNoError ) goto error;
+    cache->fixedLatency[isInput ? 1 : 0] = fixedLatency;
     
     // For low latency use a small fixed size buffer clipped to the device range.
-    err = ClipToDeviceBufferSize( macCoreDeviceId, isInput, PA_MAC_SMALL_BUFFER_SIZE, &clippedMinBufferSize );
+    propSize = sizeof( audioRange );
+    err = WARNING(AudioDeviceGetProperty( macCoreDeviceId, 0, isInput, kAudioDevicePropertyBufferFrameSizeRange, &propSize, &audioRange ) );
     if( err != paNoError ) goto error;
+    cache->bufferSizeRange[isInput ? 1 : 0] = audioRange;
+    ClipToDeviceBufferSize( cache, isInput, PA_MAC_SMALL_BUFFER_SIZE, &clippedMinBufferSize );
     
     // For high latency use the default device buffer size.
     propSize = sizeof(UInt32);
@@ -575,6 +712,7 @@ error:
 
 static PaError GetChannelInfo( PaMacAUHAL *auhalHostApi,
                                PaDeviceInfo *deviceInfo,
+                               PaMacCoreDeviceCache *cache,
                                AudioDeviceID macCoreDeviceId,
                                int isInput)
 {
@@ -607,6 +745,9 @@ static PaError GetChannelInfo( PaMacAUHAL *auhalHostApi,
         deviceInfo->maxInputChannels = numChannels;
     else
         deviceInfo->maxOutputChannels = numChannels;
+
+    cache->fixedLatency[isInput ? 1 : 0] = 0;
+    memset( &cache->bufferSizeRange[isInput ? 1 : 0], 0, sizeof(AudioValueRange) );
       
     if (numChannels > 0) /* do not try to retrieve the latency if there are no channels. */
     {
@@ -618,7 +759,7 @@ static PaError GetChannelInfo( PaMacAUHAL *auhalHostApi,
         deviceInfo->defaultHighOutputLatency = .10;        
         UInt32 lowLatencyFrames = 0;
         UInt32 highLatencyFrames = 0;
-        err = CalculateDefaultDeviceLatencies( macCoreDeviceId, isInput, &lowLatencyFrames, &highLatencyFrames );
+        err = CalculateDefaultDeviceLatencies( macCoreDeviceId, isInput, cache, &lowLatencyFrames, &highLatencyFrames );
         if( err == 0 )
         {
             
@@ -643,13 +784,30 @@ static PaError GetChannelInfo( PaMacAUHAL *auhalHostApi,
     return err;
 }
 
+/* =================================================================================================== */
+static void GetDefaultSampleRate( PaDeviceInfo *deviceInfo,
+                                  PaMacCoreDeviceCache *cache,
+                                  AudioDeviceID macCoreDeviceId )
+{
+    Float64 sampleRate;
+    UInt32 propSize;
+
+    /* Try to get the default sample rate.  Don't fail if we can't get this. */
+    propSize = sizeof(Float64);
+    if (ERR(AudioDeviceGetProperty(macCoreDeviceId, 0, 0, kAudioDevicePropertyNominalSampleRate, &propSize, &sampleRate)))
+        deviceInfo->defaultSampleRate = 0.0;
+    else
+        deviceInfo->defaultSampleRate = sampleRate;
+    cache->nominalSampleRate = deviceInfo->defaultSampleRate;
+}
+
 /* =================================================================================================== */
 static PaError InitializeDeviceInfo( PaMacAUHAL *auhalHostApi,
                                      PaDeviceInfo *deviceInfo,
+                                     PaMacCoreDeviceCache *cache,
                                      AudioDeviceID macCoreDeviceId,
                                      PaHostApiIndex hostApiIndex )
 {
-    Float64 sampleRate;
     char *name;
     PaError err = paNoError;
 	CFStringRef nameRef;
@@ -694,27 +852,157 @@ static PaError InitializeDeviceInfo( PaMacAUHAL *auhalHostApi,
 	}
     deviceInfo->name = name;
 
-    /* Try to get the default sample rate.  Don't fail if we can't get this. */
-    propSize = sizeof(Float64);
-    err = ERR(AudioDeviceGetProperty(macCoreDeviceId, 0, 0, kAudioDevicePropertyNominalSampleRate, &propSize, &sampleRate));
-    if (err)
-        deviceInfo->defaultSampleRate = 0.0;
-    else
-        deviceInfo->defaultSampleRate = sampleRate;
+    GetDefaultSampleRate(deviceInfo, cache, macCoreDeviceId);
 
     /* Get the maximum number of input and output channels.  Fail if we can't get this. */
 
-    err = GetChannelInfo(auhalHostApi, deviceInfo, macCoreDeviceId, 1);
+    err = GetChannelInfo(auhalHostApi, deviceInfo, cache, macCoreDeviceId, 1);
     if (err)
         return err;
 
-    err = GetChannelInfo(auhalHostApi, deviceInfo, macCoreDeviceId, 0);
+    err = GetChannelInfo(auhalHostApi, deviceInfo, cache, macCoreDeviceId, 0);
     if (err)
         return err;
 
     return paNoError;
 }
 
+/* =================================================================================================== */
+/* The properties of a device which are kept in its PaMacCoreDeviceCache or PaDeviceInfo */
+static const AudioObjectPropertyAddress deviceCacheAddresses[] = {
+    { kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster },
+    { kAudioDevicePropertyAvailableNominalSampleRates, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster },
+    { kAudioDevicePropertyStreamConfiguration, kAudioObjectPropertyScopeWildcard, kAudioObjectPropertyElementWildcard },
+    { kAudioDevicePropertyStreams, kAudioObjectPropertyScopeWildcard, kAudioObjectPropertyElementWildcard },
+    { kAudioDevicePropertyLatency, kAudioObjectPropertyScopeWildcard, kAudioObjectPropertyElementWildcard },
+    { kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeWildcard, kAudioObjectPropertyElementWildcard },
+    { kAudioDevicePropertyBufferFrameSize, kAudioObjectPropertyScopeWildcard, kAudioObjectPropertyElementWildcard },
+    { kAudioDevicePropertyBufferFrameSizeRange, kAudioObjectPropertyScopeWildcard, kAudioObjectPropertyElementWildcard }
+};
+#define DEVICE_CACHE_ADDRESS_COUNT (sizeof(deviceCacheAddresses) / sizeof(deviceCacheAddresses[0]))
+
+/* Called on the HAL's notification thread, only marks the cache. */
+static OSStatus DeviceCacheListenerProc( AudioObjectID inObjectID,
+                                         UInt32 inNumberAddresses,
+                                         const AudioObjectPropertyAddress inAddresses[],
+                                         void *inClientData )
+{
+    PaMacCoreDeviceCache *cache = (PaMacCoreDeviceCache *) inClientData;
+    UInt32 changed = 0;
+    UInt32 i;
+    (void) inObjectID;
+
+    for( i=0; i<inNumberAddresses; ++i )
+    {
+        if( inAddresses[i].mSelector == kAudioDevicePropertyAvailableNominalSampleRates )
+            changed |= PA_MAC_CORE_RATES_CHANGED;
+        else
+            changed |= PA_MAC_CORE_DEVICE_CHANGED;
+    }
+    __sync_fetch_and_or( &cache->changed, changed );
+    return noErr;
+}
+
+static void AddDeviceCacheListeners( PaMacAUHAL *auhalHostApi )
+{
+    int i, j;
+
+    for( i=0; i<auhalHostApi->devCount; ++i )
+    {
+        PaMacCoreDeviceCache *cache = &auhalHostApi->devCaches[i];
+
+        for( j=0; j<DEVICE_CACHE_ADDRESS_COUNT; ++j )
+        {
+            if( AudioObjectAddPropertyListener( auhalHostApi->devIds[i], &deviceCacheAddresses[j],
+                                                DeviceCacheListenerProc, cache ) != noErr )
+                break;
+        }
+        if( j == DEVICE_CACHE_ADDRESS_COUNT )
+        {
+            cache->listening = 1;
+        }
+        else
+        {
+            /* without listeners, the properties are fetched every time */
+            VDBUG(("Could not listen to the properties of device %ld.\n", auhalHostApi->devIds[i]));
+            while( --j >= 0 )
+                AudioObjectRemovePropertyListener( auhalHostApi->devIds[i], &deviceCacheAddresses[j],
+                                                   DeviceCacheListenerProc, cache );
+        }
+    }
+}
+
+static void RemoveDeviceCacheListeners( PaMacAUHAL *auhalHostApi )
+{
+    int i, j;
+
+    for( i=0; i<auhalHostApi->devCount; ++i )
+    {
+        PaMacCoreDeviceCache *cache = &auhalHostApi->devCaches[i];
+
+        if( !cache->listening )
+            continue;
+        for( j=0; j<DEVICE_CACHE_ADDRESS_COUNT; ++j )
+            AudioObjectRemovePropertyListener( auhalHostApi->devIds[i], &deviceCacheAddresses[j],
+                                               DeviceCacheListenerProc, cache );
+        cache->listening = 0;
+    }
+}
+
+/* Fetch again the properties of a device which changed since they were
+   cached, the sample rates only if needRates. Updates the PaDeviceInfo of
+   the device, called by OpenStream() and IsFormatSupported(), which the
+   front end serializes. */
+static void RefreshDeviceCache( PaMacAUHAL *auhalHostApi, PaDeviceIndex device, int needRates )
+{
+    PaMacCoreDeviceCache *cache = &auhalHostApi->devCaches[device];
+    PaDeviceInfo *deviceInfo = auhalHostApi->inheritedHostApiRep.deviceInfos[device];
+    AudioDeviceID macCoreDeviceId = auhalHostApi->devIds[device];
+    UInt32 wanted = PA_MAC_CORE_DEVICE_CHANGED | ( needRates ? PA_MAC_CORE_RATES_CHANGED : 0 );
+    UInt32 changed;
+
+    /* clear the bits before fetching, so that changes made meanwhile aren't lost */
+    if( cache->listening )
+        changed = __sync_fetch_and_and( &cache->changed, ~wanted ) & wanted;
+    else
+        changed = wanted;
+
+    if( changed & PA_MAC_CORE_DEVICE_CHANGED )
+    {
+        VDBUG(("Device %ld changed, fetching its properties again.\n", macCoreDeviceId));
+        GetDefaultSampleRate( deviceInfo, cache, macCoreDeviceId );
+        /* keep the last channel counts if the device doesn't answer now */
+        GetChannelInfo( auhalHostApi, deviceInfo, cache, macCoreDeviceId, 1 );
+        GetChannelInfo( auhalHostApi, deviceInfo, cache, macCoreDeviceId, 0 );
+    }
+
+    if( changed & PA_MAC_CORE_RATES_CHANGED )
+    {
+        UInt32 propSize = sizeof(cache->rateRanges);
+        if( WARNING(AudioDeviceGetProperty( macCoreDeviceId, 0, 0, kAudioDevicePropertyAvailableNominalSampleRates,
+                                            &propSize, cache->rateRanges )) == paNoError )
+            cache->rateRangeCount = propSize / sizeof(AudioValueRange);
+        else
+            cache->rateRangeCount = 0;
+    }
+}
+
+/* The device can run at sampleRate without conversion, according to the
+   cached rates. Devices of unknown rates are given the benefit of the doubt. */
+static int IsCachedSampleRate( const PaMacCoreDeviceCache *cache, double sampleRate )
+{
+    UInt32 i;
+
+    if( cache->rateRangeCount == 0 )
+        return 1;
+    for( i=0; i<cache->rateRangeCount; ++i )
+    {
+        if( sampleRate >= cache->rateRanges[i].mMinimum && sampleRate <= cache->rateRanges[i].mMaximum )
+            return 1;
+    }
+    return 0;
+}
+
 PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
 {
     PaError result = paNoError;
@@ -760,7 +1048,9 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
     }
 
     auhalHostApi->devIds = NULL;
+    auhalHostApi->devCaches = NULL;
     auhalHostApi->devCount = 0;
+    auhalHostApi->deviceChangeListening = 0;
 
     /* get the info we need about the devices */
     result = gatherDeviceInfo( auhalHostApi );
@@ -800,6 +1090,7 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
         {
             int err;
             err = InitializeDeviceInfo( auhalHostApi, &deviceInfoArray[i],
+                                      &auhalHostApi->devCaches[i],
                                       auhalHostApi->devIds[i],
                                       hostApiIndex );
             if (err == paNoError)
@@ -816,15 +1107,25 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
                 int j;
                 auhalHostApi->devCount--;
                 for( j=i; j<auhalHostApi->devCount; ++j )
+                {
                    auhalHostApi->devIds[j] = auhalHostApi->devIds[j+1];
+                   auhalHostApi->devCaches[j] = auhalHostApi->devCaches[j+1];
+                }
                 i--;
             }
         }
+
+        AddDeviceCacheListeners( auhalHostApi );
     }
 
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = EnableDeviceChangeNotification;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &auhalHostApi->callbackStreamInterface,
                                       CloseStream, StartStream,
@@ -834,6 +1135,9 @@ PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIn
                                       PaUtil_DummyRead, PaUtil_DummyWrite,
                                       PaUtil_DummyGetReadAvailable,
                                       PaUtil_DummyGetWriteAvailable );
+    auhalHostApi->callbackStreamInterface.Pause = PauseStream;
+    auhalHostApi->callbackStreamInterface.Resume = ResumeStream;
+    auhalHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
 
     PaUtil_InitializeStreamInterface( &auhalHostApi->blockingStreamInterface,
                                       CloseStream, StartStream,
@@ -869,6 +1173,9 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
 
     VVDBUG(("Terminate()\n"));
 
+    EnableDeviceChangeNotification( hostApi, 0 );
+    RemoveDeviceCacheListeners( auhalHostApi );
+
     unixErr = destroyXRunListenerList();
     if( 0 != unixErr )
        UNIX_ERR(unixErr);
@@ -889,13 +1196,75 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
 }
 
 
+/* The properties of the system object which change with the devices */
+static const AudioObjectPropertyAddress deviceChangeAddresses[] = {
+    { kAudioHardwarePropertyDevices, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster },
+    { kAudioHardwarePropertyDefaultInputDevice, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster },
+    { kAudioHardwarePropertyDefaultOutputDevice, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster }
+};
+#define DEVICE_CHANGE_ADDRESS_COUNT (sizeof(deviceChangeAddresses) / sizeof(deviceChangeAddresses[0]))
+
+static OSStatus DeviceChangeListenerProc( AudioObjectID inObjectID,
+                                          UInt32 inNumberAddresses,
+                                          const AudioObjectPropertyAddress inAddresses[],
+                                          void *inClientData )
+{
+    (void) inObjectID;
+    (void) inNumberAddresses;
+    (void) inAddresses;
+
+    PaUtil_NotifyDeviceChange( (PaUtilHostApiRepresentation *) inClientData );
+    return noErr;
+}
+
+static PaError EnableDeviceChangeNotification( struct PaUtilHostApiRepresentation *hostApi, int enable )
+{
+    PaMacAUHAL *auhalHostApi = (PaMacAUHAL*)hostApi;
+    OSStatus err = noErr;
+    int i;
+
+    if( !auhalHostApi->deviceChangeListening == !enable )
+        return paNoError;
+
+    if( enable )
+    {
+        for( i=0; i<DEVICE_CHANGE_ADDRESS_COUNT; ++i )
+        {
+            err = AudioObjectAddPropertyListener( kAudioObjectSystemObject, &deviceChangeAddresses[i],
+                                                  DeviceChangeListenerProc, hostApi );
+            if( err != noErr )
+            {
+                /* leave no listener behind */
+                while( --i >= 0 )
+                    AudioObjectRemovePropertyListener( kAudioObjectSystemObject, &deviceChangeAddresses[i],
+                                                       DeviceChangeListenerProc, hostApi );
+                return ERR( err );
+            }
+        }
+        auhalHostApi->deviceChangeListening = 1;
+    }
+    else
+    {
+        for( i=0; i<DEVICE_CHANGE_ADDRESS_COUNT; ++i )
+            AudioObjectRemovePropertyListener( kAudioObjectSystemObject, &deviceChangeAddresses[i],
+                                               DeviceChangeListenerProc, hostApi );
+        auhalHostApi->deviceChangeListening = 0;
+    }
+
+    return paNoError;
+}
+
+
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
                                   double sampleRate )
 {
+    PaMacAUHAL *auhalHostApi = (PaMacAUHAL*)hostApi;
     int inputChannelCount, outputChannelCount;
     PaSampleFormat inputSampleFormat, outputSampleFormat;
+    const PaStreamParameters *parameters[2];
+    int i, atNominalRate;
 
     VVDBUG(("IsFormatSupported(): in chan=%d, in fmt=%ld, out chan=%d, out fmt=%ld sampleRate=%g\n",
                 inputParameters  ? inputParameters->channelCount  : -1,
@@ -922,6 +1291,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
         if( inputParameters->device == paUseHostApiSpecificDeviceSpecification )
             return paInvalidDevice;
 
+        RefreshDeviceCache( auhalHostApi, inputParameters->device, TRUE );
+
         /* check that input device can support inputChannelCount */
         if( inputChannelCount > hostApi->deviceInfos[ inputParameters->device ]->maxInputChannels )
             return paInvalidChannelCount;
@@ -947,6 +1318,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
         if( outputParameters->device == paUseHostApiSpecificDeviceSpecification )
             return paInvalidDevice;
 
+        RefreshDeviceCache( auhalHostApi, outputParameters->device, TRUE );
+
         /* check that output device can support outputChannelCount */
         if( outputChannelCount > hostApi->deviceInfos[ outputParameters->device ]->maxOutputChannels )
             return paInvalidChannelCount;
@@ -956,6 +1329,35 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
     {
         outputChannelCount = 0;
     }
+
+    /* Answer from the cached device properties where we can: a device which
+       must run at exactly sampleRate fails if that isn't one of its rates,
+       and plain streams at the devices' nominal rates need neither a change
+       of the devices nor a converter, so they are not opened to find out. */
+    parameters[0] = inputParameters;
+    parameters[1] = outputParameters;
+    atNominalRate = 1;
+    for( i=0; i<2; ++i )
+    {
+        const PaMacCoreDeviceCache *cache;
+        const PaMacCoreStreamInfo *streamInfo;
+
+        if( !parameters[i] )
+            continue;
+        cache = &auhalHostApi->devCaches[ parameters[i]->device ];
+        streamInfo = (const PaMacCoreStreamInfo *) parameters[i]->hostApiSpecificStreamInfo;
+
+        if( streamInfo
+            && (streamInfo->flags & paMacCoreChangeDeviceParameters)
+            && (streamInfo->flags & paMacCoreFailIfConversionRequired)
+            && !IsCachedSampleRate( cache, sampleRate ) )
+            return paInvalidSampleRate;
+
+        if( streamInfo || cache->nominalSampleRate != sampleRate )
+            atNominalRate = 0;
+    }
+    if( atNominalRate )
+        return paFormatIsSupported;
  
     /* FEEDBACK */
     /*        I think the only way to check a given format SR combo is     */
@@ -1017,12 +1419,12 @@ static void UpdateTimeStampOffsets( PaMacCoreStream *stream )
     Float64 outputSoftwareLatency = 0.0;
     Float64 outputHardwareLatency = 0.0;
     
-    if( stream->inputUnit != NULL )
+    if( stream->inputUnit != NULL || stream->halInputChannels )
     {
         inputSoftwareLatency = CalculateSoftwareLatencyFromProperties( stream, &stream->inputProperties );
         inputHardwareLatency = CalculateHardwareLatencyFromProperties( stream, &stream->inputProperties );
     }    
-    if( stream->outputUnit != NULL )
+    if( stream->outputUnit != NULL || stream->halOutputChannels )
     {
         outputSoftwareLatency = CalculateSoftwareLatencyFromProperties( stream, &stream->outputProperties );
         outputHardwareLatency = CalculateHardwareLatencyFromProperties( stream, &stream->outputProperties );
@@ -1158,6 +1560,304 @@ static void CleanupDevicePropertyListeners( PaMacCoreStream *stream, AudioDevice
                                    AudioDevicePropertyGenericListenerProc );
 }
 
+/* ================================================================================= */
+/*
+ * Returns the UID of a device as a CFString, which the caller must release,
+ * or NULL if it could not be retrieved. */
+static CFStringRef CopyDeviceUID( AudioDeviceID deviceID )
+{
+    CFStringRef uid = NULL;
+    UInt32 propSize = sizeof(uid);
+
+    if( AudioDeviceGetProperty( deviceID, 0, 0, kAudioDevicePropertyDeviceUID, &propSize, &uid ) != noErr )
+        return NULL;
+    return uid;
+}
+
+static CFDictionaryRef CreateSubDeviceDescription( CFStringRef uid, Boolean driftCompensation )
+{
+    CFMutableDictionaryRef subDevice;
+    int one = 1;
+
+    subDevice = CFDictionaryCreateMutable( NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks );
+    if( !subDevice )
+        return NULL;
+    CFDictionarySetValue( subDevice, CFSTR(kAudioSubDeviceUIDKey), uid );
+    if( driftCompensation )
+    {
+        CFNumberRef number = CFNumberCreate( NULL, kCFNumberIntType, &one );
+        if( number )
+        {
+            CFDictionarySetValue( subDevice, CFSTR(kAudioSubDeviceDriftCompensationKey), number );
+            CFRelease( number );
+        }
+    }
+    return subDevice;
+}
+
+/*
+ * Builds a private aggregate device from the input and output devices of a
+ * full duplex stream so that a single AUHAL can service both directions.
+ * The output device is the clock master; the input device is drift
+ * compensated against it.
+ *
+ * The AUHAL always exposes the first channels of the aggregate, so the
+ * sub-devices are ordered such that the first input channels belong to the
+ * input device and the first output channels to the output device. That is
+ * only possible when one of the two devices has no channels in the other
+ * direction. If it is not possible, or if the devices are not running at the
+ * same nominal sample rate, *aggregateDevice is set to kAudioDeviceUnknown
+ * and paNoError is returned so the caller can fall back to the two unit path.
+ */
+static PaError CreateAggregateDuplexDevice( const PaMacCoreStream *stream,
+                                            const PaMacAUHAL *auhalHostApi,
+                                            const PaStreamParameters *inputParameters,
+                                            const PaStreamParameters *outputParameters,
+                                            AudioDeviceID *aggregateDevice )
+{
+    PaError result = paNoError;
+    AudioDeviceID inputDevice = auhalHostApi->devIds[inputParameters->device];
+    AudioDeviceID outputDevice = auhalHostApi->devIds[outputParameters->device];
+    const PaDeviceInfo *inputInfo = auhalHostApi->inheritedHostApiRep.deviceInfos[inputParameters->device];
+    const PaDeviceInfo *outputInfo = auhalHostApi->inheritedHostApiRep.deviceInfos[outputParameters->device];
+    Float64 inputRate = 0, outputRate = 0;
+    UInt32 propSize;
+    Boolean inputFirst;
+    CFStringRef inputUID = NULL, outputUID = NULL, aggregateUID = NULL;
+    CFDictionaryRef inputSubDevice = NULL, outputSubDevice = NULL;
+    CFArrayRef subDevices = NULL;
+    CFMutableDictionaryRef description = NULL;
+    CFNumberRef isPrivate = NULL;
+    const void *subDeviceList[2];
+    int one = 1;
+
+    *aggregateDevice = kAudioDeviceUnknown;
+
+    if( outputInfo->maxInputChannels == 0 )
+        inputFirst = FALSE;
+    else if( inputInfo->maxOutputChannels == 0 )
+        inputFirst = TRUE;
+    else
+    {
+        VDBUG(("Aggregate duplex: both devices are bidirectional, not using an aggregate.\n"));
+        return paNoError;
+    }
+
+    propSize = sizeof(inputRate);
+    if( AudioDeviceGetProperty( inputDevice, 0, TRUE, kAudioDevicePropertyNominalSampleRate, &propSize, &inputRate ) != noErr )
+        return paNoError;
+    propSize = sizeof(outputRate);
+    if( AudioDeviceGetProperty( outputDevice, 0, FALSE, kAudioDevicePropertyNominalSampleRate, &propSize, &outputRate ) != noErr )
+        return paNoError;
+    if( inputRate != outputRate )
+    {
+        VDBUG(("Aggregate duplex: nominal rates differ (%g, %g), not using an aggregate.\n", inputRate, outputRate));
+        return paNoError;
+    }
+
+    inputUID = CopyDeviceUID( inputDevice );
+    outputUID = CopyDeviceUID( outputDevice );
+    if( !inputUID || !outputUID )
+        goto done; /* fall back */
+
+    inputSubDevice = CreateSubDeviceDescription( inputUID, TRUE );
+    outputSubDevice = CreateSubDeviceDescription( outputUID, FALSE );
+    aggregateUID = CFStringCreateWithFormat( NULL, NULL, CFSTR("org.portaudio.aggregate.%d.%p"), (int)getpid(), stream );
+    isPrivate = CFNumberCreate( NULL, kCFNumberIntType, &one );
+    description = CFDictionaryCreateMutable( NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks );
+    if( !inputSubDevice || !outputSubDevice || !aggregateUID || !isPrivate || !description )
+    {
+        result = paInsufficientMemory;
+        goto done;
+    }
+
+    subDeviceList[0] = inputFirst ? inputSubDevice : outputSubDevice;
+    subDeviceList[1] = inputFirst ? outputSubDevice : inputSubDevice;
+    subDevices = CFArrayCreate( NULL, subDeviceList, 2, &kCFTypeArrayCallBacks );
+    if( !subDevices )
+    {
+        result = paInsufficientMemory;
+        goto done;
+    }
+
+    CFDictionarySetValue( description, CFSTR(kAudioAggregateDeviceUIDKey), aggregateUID );
+    CFDictionarySetValue( description, CFSTR(kAudioAggregateDeviceNameKey), CFSTR("PortAudio Duplex") );
+    CFDictionarySetValue( description, CFSTR(kAudioAggregateDeviceIsPrivateKey), isPrivate );
+    CFDictionarySetValue( description, CFSTR(kAudioAggregateDeviceSubDeviceListKey), subDevices );
+    CFDictionarySetValue( description, CFSTR(kAudioAggregateDeviceMasterSubDeviceKey), outputUID );
+
+    if( AudioHardwareCreateAggregateDevice( description, aggregateDevice ) != noErr )
+    {
+        VDBUG(("Aggregate duplex: AudioHardwareCreateAggregateDevice failed, not using an aggregate.\n"));
+        *aggregateDevice = kAudioDeviceUnknown;
+    }
+    else
+    {
+        VDBUG(("Aggregate duplex: created device %ld (input %s).\n", (long)*aggregateDevice, inputFirst ? "first" : "second"));
+    }
+
+done:
+    if( description ) CFRelease( description );
+    if( subDevices ) CFRelease( subDevices );
+    if( isPrivate ) CFRelease( isPrivate );
+    if( aggregateUID ) CFRelease( aggregateUID );
+    if( outputSubDevice ) CFRelease( outputSubDevice );
+    if( inputSubDevice ) CFRelease( inputSubDevice );
+    if( outputUID ) CFRelease( outputUID );
+    if( inputUID ) CFRelease( inputUID );
+    return result;
+}
+
+/* ================================================================================= */
+/*
+ * Sums the channels of the device's streams in one direction. Fails if any
+ * stream's virtual format is not packed, interleaved, native endian Float32,
+ * which is what HALIOProc() hands to the buffer processor. */
+static bool GetHALFloat32ChannelCount( AudioDeviceID device, Boolean isInput, UInt32 *channelCount )
+{
+    AudioStreamID *streamIDs;
+    UInt32 propSize = 0;
+    UInt32 i, streamCount;
+    bool ok = true;
+
+    *channelCount = 0;
+    if( AudioDeviceGetPropertyInfo( device, 0, isInput, kAudioDevicePropertyStreams, &propSize, NULL ) != noErr )
+        return false;
+    streamCount = propSize / sizeof(AudioStreamID);
+    if( streamCount == 0 )
+        return false;
+    streamIDs = (AudioStreamID *) malloc( propSize );
+    if( !streamIDs )
+        return false;
+    if( AudioDeviceGetProperty( device, 0, isInput, kAudioDevicePropertyStreams, &propSize, streamIDs ) != noErr )
+        ok = false;
+
+    for( i = 0; ok && i < streamCount; ++i )
+    {
+        AudioStreamBasicDescription format;
+        UInt32 formatSize = sizeof(format);
+        if( AudioStreamGetProperty( streamIDs[i], 0, kAudioStreamPropertyVirtualFormat, &formatSize, &format ) != noErr
+            || format.mFormatID != kAudioFormatLinearPCM
+            || !(format.mFormatFlags & kAudioFormatFlagIsFloat)
+            || (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved)
+            || (format.mFormatFlags & kAudioFormatFlagIsBigEndian) != (kAudioFormatFlagsNativeEndian & kAudioFormatFlagIsBigEndian)
+            || format.mBitsPerChannel != 32
+            || format.mBytesPerFrame != format.mChannelsPerFrame * sizeof(float) )
+        {
+            ok = false;
+        }
+        else
+        {
+            *channelCount += format.mChannelsPerFrame;
+        }
+    }
+
+    free( streamIDs );
+    return ok;
+}
+
+/*
+ * Registers HALIOProc() directly on the device for paMacCoreUseHALIOProc.
+ * For full duplex the device is either shared by input and output or is the
+ * stream's aggregate device. If the device can not be driven directly, the
+ * stream is left without an IOProc and paNoError is returned so the caller
+ * falls back to the AUHAL.
+ */
+static PaError OpenHALIOProc( PaMacCoreStream *stream,
+                              const PaMacAUHAL *auhalHostApi,
+                              const PaStreamParameters *inputParameters,
+                              const PaStreamParameters *outputParameters,
+                              UInt32 requestedFramesPerBuffer,
+                              double sampleRate,
+                              unsigned long macFlags )
+{
+    PaError result = paNoError;
+    AudioDeviceID device;
+    UInt32 inputChannels = 0, outputChannels = 0;
+    UInt32 framesPerBuffer = 0;
+    Float64 nominalRate = 0;
+    UInt32 propSize;
+    OSStatus err;
+
+    if( stream->aggregateDevice != kAudioDeviceUnknown )
+        device = stream->aggregateDevice;
+    else if( inputParameters && outputParameters && inputParameters->device != outputParameters->device )
+        return paNoError;
+    else
+        device = auhalHostApi->devIds[ inputParameters ? inputParameters->device : outputParameters->device ];
+
+    /* Channel maps are an AUHAL feature. */
+    if( ( inputParameters && inputParameters->hostApiSpecificStreamInfo
+          && ((PaMacCoreStreamInfo*)inputParameters->hostApiSpecificStreamInfo)->channelMap )
+        || ( outputParameters && outputParameters->hostApiSpecificStreamInfo
+          && ((PaMacCoreStreamInfo*)outputParameters->hostApiSpecificStreamInfo)->channelMap ) )
+        return paNoError;
+
+    if( inputParameters
+        && ( !GetHALFloat32ChannelCount( device, TRUE, &inputChannels )
+             || inputChannels < (UInt32)inputParameters->channelCount ) )
+    {
+        VDBUG(("HAL IOProc: unsuitable input format on device %ld, using AUHAL.\n", (long)device));
+        return paNoError;
+    }
+    if( outputParameters
+        && ( !GetHALFloat32ChannelCount( device, FALSE, &outputChannels )
+             || outputChannels < (UInt32)outputParameters->channelCount ) )
+    {
+        VDBUG(("HAL IOProc: unsuitable output format on device %ld, using AUHAL.\n", (long)device));
+        return paNoError;
+    }
+
+    /* The IOProc gets the device's buffer, so the device buffer size is the host buffer size. */
+    result = setBestFramesPerBuffer( device, outputParameters != NULL,
+                                     requestedFramesPerBuffer, &framesPerBuffer );
+    if( result != paNoError )
+        return result;
+    if( macFlags & paMacCoreChangeDeviceParameters )
+    {
+        result = setBestSampleRateForDevice( device, outputParameters != NULL,
+                                             (macFlags & paMacCoreFailIfConversionRequired) != 0,
+                                             sampleRate );
+        if( result != paNoError )
+            return result;
+    }
+
+    /* There is no converter in this path, so the device must run at the stream rate. */
+    propSize = sizeof(nominalRate);
+    err = AudioDeviceGetProperty( device, 0, outputParameters ? FALSE : TRUE,
+                                  kAudioDevicePropertyNominalSampleRate, &propSize, &nominalRate );
+    if( err != noErr || nominalRate != sampleRate )
+    {
+        VDBUG(("HAL IOProc: device rate %g differs from %g, using AUHAL.\n", nominalRate, sampleRate));
+        return paNoError;
+    }
+
+    err = AudioDeviceCreateIOProcID( device, HALIOProc, stream, &stream->halIOProcID );
+    if( err != noErr )
+    {
+        stream->halIOProcID = NULL;
+        return ERR( err );
+    }
+
+    stream->halDevice = device;
+    stream->halInputChannels = inputChannels;
+    stream->halOutputChannels = outputChannels;
+    stream->inputDevice = inputParameters ? device : kAudioDeviceUnknown;
+    stream->outputDevice = outputParameters ? device : kAudioDeviceUnknown;
+    stream->inputFramesPerBuffer = inputParameters ? framesPerBuffer : 0;
+    stream->outputFramesPerBuffer = outputParameters ? framesPerBuffer : 0;
+
+    err = AudioDeviceAddPropertyListener( device, 0, outputParameters ? false : true,
+                                          kAudioDeviceProcessorOverload,
+                                          xrunCallback,
+                                          addToXRunListenerList( (void *)stream ) );
+    if( err != noErr && err != kAudioHardwareIllegalOperationError )
+        return ERR( err );
+
+    VDBUG(("HAL IOProc: opened device %ld, %ld frames per buffer.\n", (long)device, (long)framesPerBuffer));
+    return paNoError;
+}
+
 /* ================================================================================= */
 static PaError OpenAndSetupOneAudioUnit(
                                    const PaMacCoreStream *stream,
@@ -1290,14 +1990,16 @@ static PaError OpenAndSetupOneAudioUnit(
 
     /* -- set the devices -- */
     /* make sure input and output are the same device if we are doing input and
-       output. */
-    if( inStreamParams && outStreamParams )
+       output, unless both run through a private aggregate device. */
+    if( inStreamParams && outStreamParams && stream->aggregateDevice == kAudioDeviceUnknown )
     {
        assert( outStreamParams->device == inStreamParams->device );
     }
     if( inStreamParams )
     {
-       *audioDevice = auhalHostApi->devIds[inStreamParams->device] ;
+       *audioDevice = stream->aggregateDevice != kAudioDeviceUnknown
+             ? stream->aggregateDevice
+             : auhalHostApi->devIds[inStreamParams->device] ;
        ERR_WRAP( AudioUnitSetProperty( *audioUnit,
                     kAudioOutputUnitProperty_CurrentDevice,
                     kAudioUnitScope_Global,
@@ -1307,7 +2009,9 @@ static PaError OpenAndSetupOneAudioUnit(
     }
     if( outStreamParams && outStreamParams != inStreamParams )
     {
-       *audioDevice = auhalHostApi->devIds[outStreamParams->device] ;
+       *audioDevice = stream->aggregateDevice != kAudioDeviceUnknown
+             ? stream->aggregateDevice
+             : auhalHostApi->devIds[outStreamParams->device] ;
        ERR_WRAP( AudioUnitSetProperty( *audioUnit,
                     kAudioOutputUnitProperty_CurrentDevice,
                     kAudioUnitScope_Global,
@@ -1614,6 +2318,96 @@ static PaError OpenAndSetupOneAudioUnit(
        return paResult;
 }
 
+/* =================================================================================================== */
+/**
+ * Take hog mode on device for paMacCoreHogDevice. *hogged is only set if
+ * hog mode was taken for this stream, not if this process already held it.
+ */
+static PaError HogDevice( AudioDeviceID device, bool *hogged )
+{
+    AudioObjectPropertyAddress address = { kAudioDevicePropertyHogMode, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+    pid_t owner = -1;
+    UInt32 propSize = sizeof(owner);
+    PaError err;
+
+    *hogged = false;
+    err = ERR( AudioObjectGetPropertyData( device, &address, 0, NULL, &propSize, &owner ) );
+    if( err != paNoError )
+        return err;
+    if( owner == getpid() )
+        return paNoError;
+    if( owner != -1 )
+    {
+        VDBUG(("Device %ld is hogged by process %ld.\n", (long)device, (long)owner));
+        return paDeviceUnavailable;
+    }
+
+    /* setting the property toggles hog mode for this process, whatever the value */
+    owner = getpid();
+    err = ERR( AudioObjectSetPropertyData( device, &address, 0, NULL, sizeof(owner), &owner ) );
+    if( err != paNoError )
+        return err;
+    propSize = sizeof(owner);
+    err = ERR( AudioObjectGetPropertyData( device, &address, 0, NULL, &propSize, &owner ) );
+    if( err != paNoError )
+        return err;
+    if( owner != getpid() )
+        return paDeviceUnavailable;
+
+    VDBUG(("Hogged device %ld.\n", (long)device));
+    *hogged = true;
+    return paNoError;
+}
+
+static void ReleaseHogMode( AudioDeviceID device )
+{
+    AudioObjectPropertyAddress address = { kAudioDevicePropertyHogMode, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+    pid_t owner = -1;
+    UInt32 propSize = sizeof(owner);
+
+    if( AudioObjectGetPropertyData( device, &address, 0, NULL, &propSize, &owner ) == noErr
+        && owner == getpid() )
+        ERR( AudioObjectSetPropertyData( device, &address, 0, NULL, sizeof(owner), &owner ) );
+}
+
+/* The ioCycleUsage asked for with paMacCoreSetIOCycleUsage, or -1 */
+static Float32 GetRequestedIOCycleUsage( const PaStreamParameters *parameters )
+{
+    const PaMacCoreStreamInfo *streamInfo;
+
+    if( !parameters || !parameters->hostApiSpecificStreamInfo )
+        return -1;
+    streamInfo = (const PaMacCoreStreamInfo *) parameters->hostApiSpecificStreamInfo;
+    if( !(streamInfo->flags & paMacCoreSetIOCycleUsage) || streamInfo->version < 0x02
+        || streamInfo->size < sizeof(PaMacCoreStreamInfo) )
+        return -1;
+    return MIN( MAX( streamInfo->ioCycleUsage, 0.0f ), 1.0f );
+}
+
+/**
+ * Set the IO cycle usage of device for paMacCoreSetIOCycleUsage, keeping the
+ * previous usage in the stream's slot index to be restored on close.
+ */
+static PaError SetIOCycleUsage( PaMacCoreStream *stream, int index, AudioDeviceID device, Float32 usage )
+{
+    AudioObjectPropertyAddress address = { kAudioDevicePropertyIOCycleUsage, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+    Float32 previous = 1.0f;
+    UInt32 propSize = sizeof(previous);
+    PaError err;
+
+    err = ERR( AudioObjectGetPropertyData( device, &address, 0, NULL, &propSize, &previous ) );
+    if( err != paNoError )
+        return err;
+    err = ERR( AudioObjectSetPropertyData( device, &address, 0, NULL, sizeof(usage), &usage ) );
+    if( err != paNoError )
+        return err;
+
+    VDBUG(("IO cycle usage of device %ld set to %g, was %g.\n", (long)device, usage, previous));
+    stream->ioCycleDevices[index] = device;
+    stream->savedIOCycleUsage[index] = previous;
+    return paNoError;
+}
+
 /* =================================================================================================== */
 
 static UInt32 CalculateOptimalBufferSize( PaMacAUHAL *auhalHostApi,
@@ -1664,16 +2458,16 @@ static UInt32 CalculateOptimalBufferSize( PaMacAUHAL *auhalHostApi,
     // Clip to the capabilities of the device.
     if( inputParameters )
     {
-        ClipToDeviceBufferSize( auhalHostApi->devIds[inputParameters->device],
+        ClipToDeviceBufferSize( &auhalHostApi->devCaches[inputParameters->device],
                                true, // In the old code isInput was false!
                                resultBufferSizeFrames, &resultBufferSizeFrames );
     }
     if( outputParameters )
     {
-        ClipToDeviceBufferSize( auhalHostApi->devIds[outputParameters->device],
+        ClipToDeviceBufferSize( &auhalHostApi->devCaches[outputParameters->device],
                                false, resultBufferSizeFrames, &resultBufferSizeFrames );
     }
-    VDBUG(("After querying hardware, setting block size to %ld.\n", resultBufferSizeFrames));
+    VDBUG(("After clipping to the device, setting block size to %ld.\n", resultBufferSizeFrames));
 
     return resultBufferSizeFrames;
 }
@@ -1702,6 +2496,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     UInt32 inputLatencyFrames = 0;
     UInt32 outputLatencyFrames = 0;
     UInt32 suggestedLatencyFramesPerBuffer = requestedFramesPerBuffer;
+    unsigned long macFlags = 0; /* PaMacCoreStreamInfo flags of both directions */
     
     VVDBUG(("OpenStream(): in chan=%d, in fmt=%ld, out chan=%d, out fmt=%ld SR=%g, FPB=%ld\n",
                 inputParameters  ? inputParameters->channelCount  : -1,
@@ -1730,6 +2525,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         if( inputParameters->device == paUseHostApiSpecificDeviceSpecification )
             return paInvalidDevice;
 
+        RefreshDeviceCache( auhalHostApi, inputParameters->device, FALSE );
+
         /* check that input device can support inputChannelCount */
         if( inputChannelCount > hostApi->deviceInfos[ inputParameters->device ]->maxInputChannels )
             return paInvalidChannelCount;
@@ -1760,6 +2557,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         if( outputParameters->device == paUseHostApiSpecificDeviceSpecification )
             return paInvalidDevice;
 
+        RefreshDeviceCache( auhalHostApi, outputParameters->device, FALSE );
+
         /* check that output device can support inputChannelCount */
         if( outputChannelCount > hostApi->deviceInfos[ outputParameters->device ]->maxOutputChannels )
             return paInvalidChannelCount;
@@ -1819,12 +2618,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     
     if( inputParameters )
     {
-        CalculateFixedDeviceLatency( auhalHostApi->devIds[inputParameters->device], true, &fixedInputLatency );
+        fixedInputLatency = auhalHostApi->devCaches[inputParameters->device].fixedLatency[1];
         inputLatencyFrames += fixedInputLatency;
     }
     if( outputParameters )
     {        
-        CalculateFixedDeviceLatency( auhalHostApi->devIds[outputParameters->device], false, &fixedOutputLatency );
+        fixedOutputLatency = auhalHostApi->devCaches[outputParameters->device].fixedLatency[0];
         outputLatencyFrames += fixedOutputLatency;
 
     }
@@ -1837,9 +2636,63 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         requestedFramesPerBuffer = suggestedLatencyFramesPerBuffer;
     }
 
+    if( inputParameters && inputParameters->hostApiSpecificStreamInfo )
+       macFlags |= ((PaMacCoreStreamInfo*)inputParameters->hostApiSpecificStreamInfo)->flags;
+    if( outputParameters && outputParameters->hostApiSpecificStreamInfo )
+       macFlags |= ((PaMacCoreStreamInfo*)outputParameters->hostApiSpecificStreamInfo)->flags;
+
+    /* -- Optionally claim the devices for this process. -- */
+    if( macFlags & paMacCoreHogDevice )
+    {
+       bool hogged;
+       if( inputParameters )
+       {
+          result = HogDevice( auhalHostApi->devIds[inputParameters->device], &hogged );
+          if( result != paNoError )
+             goto error;
+          if( hogged )
+             stream->hoggedDevices[0] = auhalHostApi->devIds[inputParameters->device];
+       }
+       if( outputParameters && !(inputParameters && inputParameters->device == outputParameters->device) )
+       {
+          result = HogDevice( auhalHostApi->devIds[outputParameters->device], &hogged );
+          if( result != paNoError )
+             goto error;
+          if( hogged )
+             stream->hoggedDevices[1] = auhalHostApi->devIds[outputParameters->device];
+       }
+    }
+
+    /* -- Optionally join two duplex devices into one aggregate device. -- */
+    if( inputParameters && outputParameters && outputParameters->device != inputParameters->device
+        && (macFlags & paMacCoreUseAggregateDevice) )
+    {
+       result = CreateAggregateDuplexDevice( stream, auhalHostApi,
+                                             inputParameters, outputParameters,
+                                             &stream->aggregateDevice );
+       if( result != paNoError )
+          goto error;
+    }
+
+    /* -- Optionally bypass the AUHAL with an IOProc on the device. -- */
+    if( macFlags & paMacCoreUseHALIOProc )
+    {
+       result = OpenHALIOProc( stream, auhalHostApi,
+                               inputParameters, outputParameters,
+                               suggestedLatencyFramesPerBuffer,
+                               sampleRate, macFlags );
+       if( result != paNoError )
+          goto error;
+    }
+
     /* -- Now we actually open and setup streams. -- */
-    if( inputParameters && outputParameters && outputParameters->device == inputParameters->device )
-    { /* full duplex. One device. */
+    if( stream->halIOProcID )
+    { /* direct HAL IOProc, no AudioUnits. Everything was set up above. */
+    }
+    else if( inputParameters && outputParameters
+        && ( outputParameters->device == inputParameters->device
+             || stream->aggregateDevice != kAudioDeviceUnknown ) )
+    { /* full duplex. One device, possibly an aggregate of two. */
        UInt32 inputFramesPerBuffer  = (UInt32) stream->inputFramesPerBuffer;
        UInt32 outputFramesPerBuffer = (UInt32) stream->outputFramesPerBuffer;
        result = OpenAndSetupOneAudioUnit( stream,
@@ -1896,6 +2749,32 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
        stream->inputFramesPerBuffer = inputFramesPerBuffer;
        stream->outputFramesPerBuffer = outputFramesPerBuffer;
     }
+
+    /* -- Optionally change the IO cycle usage of the devices that run the stream. -- */
+    {
+       Float32 usage = GetRequestedIOCycleUsage( inputParameters );
+       if( usage < 0 )
+          usage = GetRequestedIOCycleUsage( outputParameters );
+       if( usage >= 0 )
+       {
+          AudioDeviceID first = kAudioDeviceUnknown, second = kAudioDeviceUnknown;
+          if( stream->halIOProcID )
+             first = stream->halDevice;
+          else if( stream->aggregateDevice != kAudioDeviceUnknown )
+             first = stream->aggregateDevice;
+          else
+          {
+             first = stream->inputUnit ? stream->inputDevice : stream->outputDevice;
+             if( stream->inputUnit && stream->outputUnit && stream->outputDevice != stream->inputDevice )
+                second = stream->outputDevice;
+          }
+          result = SetIOCycleUsage( stream, 0, first, usage );
+          if( result == paNoError && second != kAudioDeviceUnknown )
+             result = SetIOCycleUsage( stream, 1, second, usage );
+          if( result != paNoError )
+             goto error;
+       }
+    }
     
     inputLatencyFrames += stream->inputFramesPerBuffer;
     outputLatencyFrames += stream->outputFramesPerBuffer;
@@ -2018,6 +2897,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
            goto error;
     }
     stream->bufferProcessorIsInitialized = TRUE;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
     // Calculate actual latency from the sum of individual latencies.
     if( inputParameters ) 
@@ -2052,7 +2937,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 	stream->timingInformationMutexIsInitialized = 1;
     InitializeDeviceProperties( &stream->inputProperties );     // zeros the struct. doesn't actually init it to useful values
     InitializeDeviceProperties( &stream->outputProperties );    // zeros the struct. doesn't actually init it to useful values
-	if( stream->outputUnit )
+	if( stream->outputUnit || stream->halOutputChannels )
     {
         Boolean isInput = FALSE;
         
@@ -2068,7 +2953,7 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         
         SetupDevicePropertyListeners( stream, stream->outputDevice, isInput );
     }
-	if( stream->inputUnit )
+	if( stream->inputUnit || stream->halInputChannels )
     {
         Boolean isInput = TRUE;
        
@@ -2597,6 +3482,119 @@ stop_stream:
     return noErr;
 }
 
+/*
+ * Called by the HAL for paMacCoreUseHALIOProc streams. Input and output
+ * arrive together in the device's own Float32 buffers, which are handed to
+ * the buffer processor in place, one channel at a time, so device streams
+ * of any channel count can be covered.
+ */
+static OSStatus HALIOProc( AudioDeviceID inDevice,
+                           const AudioTimeStamp *inNow,
+                           const AudioBufferList *inInputData,
+                           const AudioTimeStamp *inInputTime,
+                           AudioBufferList *outOutputData,
+                           const AudioTimeStamp *inOutputTime,
+                           void *inClientData )
+{
+   PaMacCoreStream *stream           = (PaMacCoreStream*)inClientData;
+   PaStreamCallbackTimeInfo timeInfo = {0,0,0};
+   int callbackResult                = paContinue;
+   unsigned long framesProcessed     = 0;
+   unsigned long frames              = 0;
+   UInt32 i, c, channel;
+
+   (void) inNow;
+
+   if( stream->outputDevice != kAudioDeviceUnknown && outOutputData && outOutputData->mNumberBuffers > 0 )
+   {
+      /* unused device channels must be silent, and so must everything after
+         the callback has finished but before the device has stopped. */
+      if( stream->halOutputChannels > stream->userOutChan || stream->state == CALLBACK_STOPPED )
+      {
+         for( i = 0; i < outOutputData->mNumberBuffers; ++i )
+            memset( outOutputData->mBuffers[i].mData, 0, outOutputData->mBuffers[i].mDataByteSize );
+      }
+      if( outOutputData->mBuffers[0].mNumberChannels )
+         frames = outOutputData->mBuffers[0].mDataByteSize
+                  / ( sizeof(float) * outOutputData->mBuffers[0].mNumberChannels );
+   }
+   else if( inInputData && inInputData->mNumberBuffers > 0 && inInputData->mBuffers[0].mNumberChannels )
+   {
+      frames = inInputData->mBuffers[0].mDataByteSize
+               / ( sizeof(float) * inInputData->mBuffers[0].mNumberChannels );
+   }
+
+   if( stream->state == CALLBACK_STOPPED || frames == 0 )
+      return noErr;
+
+   PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+   if( pthread_mutex_trylock( &stream->timingInformationMutex ) == 0 ){
+      stream->timestampOffsetCombined_ioProcCopy = stream->timestampOffsetCombined;
+      stream->timestampOffsetInputDevice_ioProcCopy = stream->timestampOffsetInputDevice;
+      stream->timestampOffsetOutputDevice_ioProcCopy = stream->timestampOffsetOutputDevice;
+      pthread_mutex_unlock( &stream->timingInformationMutex );
+   }
+
+   /* Unlike the AUHAL render callback, the HAL gives us the input and the
+      output timestamps directly. */
+   timeInfo.currentTime = HOST_TIME_TO_PA_TIME( AudioGetCurrentHostTime() );
+   if( stream->userInChan )
+      timeInfo.inputBufferAdcTime = HOST_TIME_TO_PA_TIME( inInputTime->mHostTime )
+            - stream->timestampOffsetInputDevice_ioProcCopy;
+   if( stream->userOutChan )
+      timeInfo.outputBufferDacTime = HOST_TIME_TO_PA_TIME( inOutputTime->mHostTime )
+            + stream->timestampOffsetOutputDevice_ioProcCopy;
+
+   PaUtil_BeginBufferProcessing( &(stream->bufferProcessor),
+                                 &timeInfo,
+                                 stream->xrunFlags );
+   stream->xrunFlags = 0;
+
+   if( stream->userInChan )
+   {
+      PaUtil_SetInputFrameCount( &(stream->bufferProcessor), frames );
+      channel = 0;
+      for( i = 0; i < inInputData->mNumberBuffers && channel < stream->userInChan; ++i )
+      {
+         const AudioBuffer *buffer = &inInputData->mBuffers[i];
+         for( c = 0; c < buffer->mNumberChannels && channel < stream->userInChan; ++c, ++channel )
+            PaUtil_SetInputChannel( &(stream->bufferProcessor), channel,
+                                    (float *)buffer->mData + c, buffer->mNumberChannels );
+      }
+   }
+   if( stream->userOutChan )
+   {
+      PaUtil_SetOutputFrameCount( &(stream->bufferProcessor), frames );
+      channel = 0;
+      for( i = 0; i < outOutputData->mNumberBuffers && channel < stream->userOutChan; ++i )
+      {
+         AudioBuffer *buffer = &outOutputData->mBuffers[i];
+         for( c = 0; c < buffer->mNumberChannels && channel < stream->userOutChan; ++c, ++channel )
+            PaUtil_SetOutputChannel( &(stream->bufferProcessor), channel,
+                                     (float *)buffer->mData + c, buffer->mNumberChannels );
+      }
+   }
+
+   framesProcessed = PaUtil_EndBufferProcessing( &(stream->bufferProcessor),
+                                                 &callbackResult );
+
+   if( callbackResult != paContinue )
+   {
+      PaStreamFinishedCallback *sfc = stream->streamRepresentation.streamFinishedCallback;
+      stream->halStoppedByCallback = true;
+      stream->state = CALLBACK_STOPPED;
+      /* AudioDeviceStop() may be called from the IOProc; it takes effect
+         once this cycle's output has been delivered. */
+      AudioDeviceStop( inDevice, stream->halIOProcID );
+      if( sfc )
+         sfc( stream->streamRepresentation.userData );
+   }
+
+   PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+   return noErr;
+}
+
 /*
     When CloseStream() is called, the multi-api layer ensures that
     the stream has already been stopped or aborted.
@@ -2607,23 +3605,36 @@ static PaError CloseStream( PaStream* s )
        Therefore, each piece of info is treated seperately. */
     PaError result = paNoError;
     PaMacCoreStream *stream = (PaMacCoreStream*)s;
+    int i;
 
     VVDBUG(("CloseStream()\n"));
     VDBUG( ( "Closing stream.\n" ) );
 
     if( stream ) {
 		
-		if( stream->outputUnit )
+		if( stream->outputUnit || stream->halOutputChannels )
         {
             Boolean isInput = FALSE;
             CleanupDevicePropertyListeners( stream, stream->outputDevice, isInput );
 		}
 		
-		if( stream->inputUnit )
+		if( stream->inputUnit || stream->halInputChannels )
         {
             Boolean isInput = TRUE;
             CleanupDevicePropertyListeners( stream, stream->inputDevice, isInput );
 		}
+
+       if( stream->halIOProcID ) {
+          int count = removeFromXRunListenerList( stream );
+          if( count == 0 )
+             AudioDeviceRemovePropertyListener( stream->halDevice,
+                                                0,
+                                                stream->halOutputChannels ? false : true,
+                                                kAudioDeviceProcessorOverload,
+                                                xrunCallback );
+          ERR( AudioDeviceDestroyIOProcID( stream->halDevice, stream->halIOProcID ) );
+          stream->halIOProcID = NULL;
+       }
 		
        if( stream->outputUnit ) {
           int count = removeFromXRunListenerList( stream );
@@ -2665,6 +3676,27 @@ static PaError CloseStream( PaStream* s )
        if( stream->inputAudioBufferList.mBuffers[0].mData )
           free( stream->inputAudioBufferList.mBuffers[0].mData );
        stream->inputAudioBufferList.mBuffers[0].mData = NULL;
+       /* Restore the devices this process shares with others. */
+       for( i=0; i<2; ++i )
+       {
+          if( stream->ioCycleDevices[i] != kAudioDeviceUnknown )
+          {
+             AudioObjectPropertyAddress address = { kAudioDevicePropertyIOCycleUsage, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+             ERR( AudioObjectSetPropertyData( stream->ioCycleDevices[i], &address, 0, NULL,
+                                              sizeof(Float32), &stream->savedIOCycleUsage[i] ) );
+             stream->ioCycleDevices[i] = kAudioDeviceUnknown;
+          }
+          if( stream->hoggedDevices[i] != kAudioDeviceUnknown )
+          {
+             ReleaseHogMode( stream->hoggedDevices[i] );
+             stream->hoggedDevices[i] = kAudioDeviceUnknown;
+          }
+       }
+
+       /* The units are closed above, so nothing refers to the aggregate anymore. */
+       if( stream->aggregateDevice != kAudioDeviceUnknown )
+          ERR( AudioHardwareDestroyAggregateDevice( stream->aggregateDevice ) );
+       stream->aggregateDevice = kAudioDeviceUnknown;
 
        result = destroyBlioRingBuffers( &stream->blio );
        if( result )
@@ -2698,6 +3730,10 @@ static PaError StartStream( PaStream *s )
 
     /* -- start -- */
     stream->state = ACTIVE;
+    if( stream->halIOProcID ) {
+       stream->halStoppedByCallback = false;
+       ERR_WRAP( AudioDeviceStart(stream->halDevice, stream->halIOProcID) );
+    }
     if( stream->inputUnit ) {
        ERR_WRAP( AudioOutputUnitStart(stream->inputUnit) );
     }
@@ -2709,6 +3745,19 @@ static PaError StartStream( PaStream *s )
 #undef ERR_WRAP
 }
 
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaMacCoreStream *stream = (PaMacCoreStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
 // it's not clear from appl's docs that this really waits
 // until all data is flushed.
 static ComponentResult BlockWhileAudioUnitIsRunning( AudioUnit audioUnit, AudioUnitElement element )
@@ -2731,7 +3780,16 @@ static PaError FinishStoppingStream( PaMacCoreStream *stream )
 
 #define ERR_WRAP(mac_err) do { result = mac_err ; if ( result != noErr ) return ERR(result) ; } while(0)
     /* -- stop and reset -- */
-    if( stream->inputUnit == stream->outputUnit && stream->inputUnit )
+    if( stream->halIOProcID )
+    {
+       /* Off the IO thread AudioDeviceStop() returns once the IOProc has stopped. */
+       ERR_WRAP( AudioDeviceStop(stream->halDevice, stream->halIOProcID) );
+       /* There is no IsRunning notification as for the AUHAL, so report the
+          end of the stream here unless the IOProc already did. */
+       if( !stream->halStoppedByCallback && stream->streamRepresentation.streamFinishedCallback )
+          stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+    }
+    else if( stream->inputUnit == stream->outputUnit && stream->inputUnit )
     {
        ERR_WRAP( AudioOutputUnitStop(stream->inputUnit) );
        ERR_WRAP( BlockWhileAudioUnitIsRunning(stream->inputUnit,0) );
@@ -2788,6 +3846,7 @@ static PaError StopStream( PaStream *s )
 
     /* Tell WriteStream to stop filling the buffer. */
     stream->state = STOPPING;
+    PaUtil_StopBlockingIO( &stream->blio );
 
     if( stream->userOutChan > 0 ) /* Does this stream do output? */
     {
@@ -2806,6 +3865,7 @@ static PaError AbortStream( PaStream *s )
     PaMacCoreStream *stream = (PaMacCoreStream*)s;
     VDBUG( ( "AbortStream()\n" ) );
     stream->state = STOPPING;
+    PaUtil_StopBlockingIO( &stream->blio );
     return FinishStoppingStream( stream );
 }
 
@@ -2827,6 +3887,24 @@ static PaError IsStreamActive( PaStream *s )
 }
 
 
+/* While paused the audio units keep running and the buffer processor outputs silence
+   instead of calling the callback, so resuming takes effect with the next buffer. */
+static PaError PauseStream( PaStream *s )
+{
+    PaMacCoreStream *stream = (PaMacCoreStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaMacCoreStream *stream = (PaMacCoreStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
 static double GetStreamCpuLoad( PaStream* s )
 {
     PaMacCoreStream *stream = (PaMacCoreStream*)s;
@@ -59,56 +59,25 @@
 #ifndef PA_MAC_CORE_BLOCKING_H_
 #define PA_MAC_CORE_BLOCKING_H_
 
-#include "pa_ringbuffer.h"
+#include "pa_blockingio.h"
 #include "portaudio.h"
 #include "pa_mac_core_utilities.h"
 
 /*
- * Number of milliseconds to busy wait while waiting for data in blocking calls.
+ * A blocked read or write is woken by the callback once the rest of the
+ * request, but at most ringBufferFrames / PA_MAC_BLIO_WAKEUP_WATERMARK_DENOMINATOR
+ * frames, can be transferred.
  */
-#define PA_MAC_BLIO_BUSY_WAIT_SLEEP_INTERVAL (5)
+#define PA_MAC_BLIO_WAKEUP_WATERMARK_DENOMINATOR (4)
+
 /*
- * Define exactly one of these blocking methods
- * PA_MAC_BLIO_MUTEX is not actively maintained.
+ * The ring buffers, semaphores and xrun reporting are the common blocking
+ * i/o emulation, see pa_blockingio.h.
  */
-#define PA_MAC_BLIO_BUSY_WAIT
-/*
-#define PA_MAC_BLIO_MUTEX
-*/
-
-typedef struct {
-    PaUtilRingBuffer inputRingBuffer;
-    PaUtilRingBuffer outputRingBuffer;
-    ring_buffer_size_t ringBufferFrames;
-    PaSampleFormat inputSampleFormat;
-    size_t inputSampleSizeActual;
-    size_t inputSampleSizePow2;
-    PaSampleFormat outputSampleFormat;
-    size_t outputSampleSizeActual;
-    size_t outputSampleSizePow2;
-
-    int inChan;
-    int outChan;
-
-    //PaStreamCallbackFlags statusFlags;
-    uint32_t statusFlags;
-    PaError errors;
-
-    /* Here we handle blocking, using condition variables. */
-#ifdef  PA_MAC_BLIO_MUTEX
-    volatile bool isInputEmpty;
-    pthread_mutex_t inputMutex;
-    pthread_cond_t inputCond;
-
-    volatile bool isOutputFull;
-    pthread_mutex_t outputMutex;
-    pthread_cond_t outputCond;
-#endif
-}
-PaMacBlio;
+typedef PaUtilBlockingIO PaMacBlio;
 
 /*
- * These functions operate on condition and related variables.
+ * These functions set up the blocking i/o of a stream.
  */
 
 PaError initializeBlioRingBuffers(
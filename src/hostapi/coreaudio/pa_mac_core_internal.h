@@ -96,6 +96,29 @@ PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
 PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
 signed long GetStreamReadAvailable( PaStream* stream );
 signed long GetStreamWriteAvailable( PaStream* stream );
+
+/* The bits of PaMacCoreDeviceCache.changed */
+#define PA_MAC_CORE_DEVICE_CHANGED  (0x01) /* channels, latencies, buffer sizes or nominal rate */
+#define PA_MAC_CORE_RATES_CHANGED   (0x02) /* available nominal sample rates */
+
+#define PA_MAC_CORE_MAX_RATE_RANGES (32)
+
+/* Properties of a device kept between queries. Property listeners on the
+   device set the bits of changed, the properties are then fetched again the
+   next time a stream is opened on the device or checked for support. */
+typedef struct PaMacCoreDeviceCache
+{
+    volatile UInt32 changed;
+    int listening; /*are the property listeners installed?*/
+
+    UInt32 fixedLatency[2];             /*indexed by isInput, 0 without channels*/
+    AudioValueRange bufferSizeRange[2]; /*indexed by isInput, 0 without channels*/
+    Float64 nominalSampleRate;
+    UInt32 rateRangeCount;
+    AudioValueRange rateRanges[PA_MAC_CORE_MAX_RATE_RANGES];
+}
+PaMacCoreDeviceCache;
+
 /* PaMacAUHAL - host api datastructure specific to this implementation */
 typedef struct
 {
@@ -108,8 +131,10 @@ typedef struct
     /* implementation specific data goes here */
     long devCount;
     AudioDeviceID *devIds; /*array of all audio devices*/
+    PaMacCoreDeviceCache *devCaches; /*cached properties of devIds, in the same order*/
     AudioDeviceID defaultIn;
     AudioDeviceID defaultOut;
+    int deviceChangeListening; /*are the device change listeners installed?*/
 }
 PaMacAUHAL;
 
@@ -143,6 +168,24 @@ typedef struct PaMacCoreStream
     AudioUnit outputUnit;
     AudioDeviceID inputDevice;
     AudioDeviceID outputDevice;
+    /* Private aggregate device used for paMacCoreUseAggregateDevice duplex,
+       kAudioDeviceUnknown otherwise. Owned and destroyed by the stream. */
+    AudioDeviceID aggregateDevice;
+    /* Direct HAL IOProc for paMacCoreUseHALIOProc, NULL when the AUHAL is
+       used. In that mode inputUnit and outputUnit are NULL and the device
+       channel totals below are non-zero for the directions in use. */
+    AudioDeviceIOProcID halIOProcID;
+    AudioDeviceID halDevice;
+    UInt32 halInputChannels;
+    UInt32 halOutputChannels;
+    /* Devices hogged for paMacCoreHogDevice, to be released on close. */
+    AudioDeviceID hoggedDevices[2];
+    /* Devices whose IO cycle usage was set for paMacCoreSetIOCycleUsage,
+       with the usage to restore on close. */
+    AudioDeviceID ioCycleDevices[2];
+    Float32 savedIOCycleUsage[2];
+    /* Set by the HAL IOProc when the callback ended the stream. */
+    volatile bool halStoppedByCallback;
     size_t userInChan;
     size_t userOutChan;
     size_t inputFramesPerBuffer;
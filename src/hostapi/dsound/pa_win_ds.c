@@ -49,6 +49,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stddef.h> /* offsetof() */
 #include <string.h> /* strlen() */
 
 #define _WIN32_WINNT 0x0400 /* required to get waitable timer APIs */
@@ -88,6 +89,7 @@
 #include "pa_win_waveformat.h"
 #include "pa_win_wdmks_utils.h"
 #include "pa_win_coinitialize.h"
+#include "pa_win_util.h"
 
 #if (defined(WIN32) && (defined(_MSC_VER) && (_MSC_VER >= 1200))) /* MSC version 6 and above */
 #pragma comment( lib, "dsound.lib" )
@@ -122,6 +124,12 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg );
 #define PA_WIN_DS_USE_WAITABLE_TIMER_OBJECT /* use waitable timer where possible, otherwise we use a WaitForSingleObject timeout */
 #endif
 
+/* Drive the processing thread from IDirectSoundNotify position events where the buffer supports
+   them. The timer above is only used when notifications could not be set up. */
+#define PA_WIN_DS_USE_NOTIFY_POSITIONS
+
+#define PA_DS_MAX_NOTIFY_POSITIONS (16)
+
 #endif /* !PA_WIN_DS_USE_WMME_TIMER */
 
 
@@ -308,6 +316,13 @@ typedef struct PaWinDsStream
     HANDLE           processingThread;
     PA_THREAD_ID     processingThreadId;
     HANDLE           processingThreadCompleted;
+    int             *processingThreadCpus; /* NULL to run on any processor */
+    int              processingThreadCpuCount;
+
+#ifdef PA_WIN_DS_USE_NOTIFY_POSITIONS
+    HANDLE           notifyEvent; /* auto-reset, signaled at each notification position. NULL if notifications are not used */
+    double           notifyPeriodSeconds; /* time between notification positions */
+#endif
 #endif
 
 } PaWinDsStream;
@@ -1327,6 +1342,11 @@ PaError PaWinDs_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInde
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &winDsHostApi->callbackStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
@@ -1371,14 +1391,36 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
     PaWinDs_TerminateDSoundEntryPoints();
 }
 
+/* The size of a version 2 PaWinDirectSoundStreamInfo, which ended with channelMask */
+#define PA_WIN_DS_STREAM_INFO_V2_SIZE_ (offsetof( PaWinDirectSoundStreamInfo, callbackCpus ))
+
+#if !defined(PA_WIN_DS_USE_WMME_TIMER)
+/* The processors a stream's PaWinDirectSoundStreamInfo pins the processing thread to, NULL if any will do */
+static const int *GetCallbackCpus( const PaWinDirectSoundStreamInfo *streamInfo, int *cpuCount )
+{
+    *cpuCount = 0;
+    if( !streamInfo || streamInfo->version < 3 || streamInfo->callbackCpuCount <= 0 )
+        return NULL;
+
+    *cpuCount = streamInfo->callbackCpuCount;
+    return streamInfo->callbackCpus;
+}
+#endif
+
 static PaError ValidateWinDirectSoundSpecificStreamInfo(
         const PaStreamParameters *streamParameters,
         const PaWinDirectSoundStreamInfo *streamInfo )
 {
     if( streamInfo )
     {
-        if( streamInfo->size != sizeof( PaWinDirectSoundStreamInfo )
-                || streamInfo->version != 2 )
+        if( !( streamInfo->size == PA_WIN_DS_STREAM_INFO_V2_SIZE_ && streamInfo->version == 2 )
+                && !( streamInfo->size == sizeof( PaWinDirectSoundStreamInfo ) && streamInfo->version == 3 ) )
+        {
+            return paIncompatibleHostApiSpecificStreamInfo;
+        }
+
+        if( streamInfo->version >= 3
+                && PaWinUtil_ValidateCpus( streamInfo->callbackCpus, streamInfo->callbackCpuCount ) != paNoError )
         {
             return paIncompatibleHostApiSpecificStreamInfo;
         }
@@ -1535,6 +1577,9 @@ static HRESULT InitFullDuplexInputOutputBuffers( PaWinDsStream *stream,
     ZeroMemory(&secondaryRenderDesc, sizeof(DSBUFFERDESC));
     secondaryRenderDesc.dwSize = sizeof(DSBUFFERDESC);
     secondaryRenderDesc.dwFlags = DSBCAPS_GLOBALFOCUS | DSBCAPS_GETCURRENTPOSITION2;
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+    secondaryRenderDesc.dwFlags |= DSBCAPS_CTRLPOSITIONNOTIFY;
+#endif
     secondaryRenderDesc.dwBufferBytes = bytesPerOutputBuffer;
     secondaryRenderDesc.lpwfxFormat = (WAVEFORMATEX*)&renderWaveFormat;
 
@@ -1714,6 +1759,9 @@ static HRESULT InitOutputBuffer( PaWinDsStream *stream, PaWinDsDeviceInfo *devic
     ZeroMemory(&secondaryDesc, sizeof(DSBUFFERDESC));
     secondaryDesc.dwSize = sizeof(DSBUFFERDESC);
     secondaryDesc.dwFlags = DSBCAPS_GLOBALFOCUS | DSBCAPS_GETCURRENTPOSITION2;
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+    secondaryDesc.dwFlags |= DSBCAPS_CTRLPOSITIONNOTIFY;
+#endif
     secondaryDesc.dwBufferBytes = bytesPerBuffer;
     secondaryDesc.lpwfxFormat = (WAVEFORMATEX*)&waveFormat; /* waveFormat contains whatever format was negotiated for the primary buffer above */
     // Create the secondary buffer
@@ -1735,6 +1783,72 @@ error:
 }
 
 
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+/* Places notification positions evenly over the buffer, one per polling period (at least two,
+   i.e. at each half of the buffer). Must be called while the buffer is stopped. */
+static HRESULT SetNotificationPositions( PaWinDsStream *stream, LPDIRECTSOUNDNOTIFY pNotify,
+        int frameSizeBytes, unsigned long pollingPeriodFrames, double sampleRate )
+{
+    DSBPOSITIONNOTIFY positions[PA_DS_MAX_NOTIFY_POSITIONS];
+    unsigned long positionCount = (pollingPeriodFrames > 0) ? stream->hostBufferSizeFrames / pollingPeriodFrames : 0;
+    unsigned long framesPerPosition;
+    unsigned long i;
+
+    if( positionCount < 2 )
+        positionCount = 2;
+    else if( positionCount > PA_DS_MAX_NOTIFY_POSITIONS )
+        positionCount = PA_DS_MAX_NOTIFY_POSITIONS;
+
+    framesPerPosition = stream->hostBufferSizeFrames / positionCount;
+    for( i = 0; i < positionCount; ++i )
+    {
+        positions[i].dwOffset = i * framesPerPosition * frameSizeBytes;
+        positions[i].hEventNotify = stream->notifyEvent;
+    }
+
+    stream->notifyPeriodSeconds = framesPerPosition / sampleRate;
+
+    return IDirectSoundNotify_SetNotificationPositions( pNotify, positionCount, positions );
+}
+
+/* Registers stream->notifyEvent with the output buffer, or the input buffer for input-only
+   streams. On failure the event is closed and the processing thread falls back to the timer. */
+static void InitNotificationPositions( PaWinDsStream *stream, unsigned long pollingPeriodFrames, double sampleRate )
+{
+    LPDIRECTSOUNDNOTIFY pNotify = NULL;
+    HRESULT hr = E_FAIL;
+    int frameSizeBytes = 0;
+
+    stream->notifyEvent = CreateEvent( NULL, /* bManualReset = */ FALSE, /* bInitialState = */ FALSE, NULL );
+    if( stream->notifyEvent == NULL )
+        return;
+
+    if( stream->pDirectSoundOutputBuffer )
+    {
+        hr = IDirectSoundBuffer_QueryInterface( stream->pDirectSoundOutputBuffer, &IID_IDirectSoundNotify, (LPVOID*)&pNotify );
+        frameSizeBytes = stream->outputFrameSizeBytes;
+    }
+    else if( stream->pDirectSoundInputBuffer )
+    {
+        hr = IDirectSoundCaptureBuffer_QueryInterface( stream->pDirectSoundInputBuffer, &IID_IDirectSoundNotify, (LPVOID*)&pNotify );
+        frameSizeBytes = stream->inputFrameSizeBytes;
+    }
+
+    if( hr == DS_OK )
+    {
+        hr = SetNotificationPositions( stream, pNotify, frameSizeBytes, pollingPeriodFrames, sampleRate );
+        IDirectSoundNotify_Release( pNotify );
+    }
+
+    if( hr != DS_OK )
+    {
+        PA_DEBUG(("DirectSound position notifications not available (0x%x), using timer\n", hr));
+        CloseHandle( stream->notifyEvent );
+        stream->notifyEvent = NULL;
+    }
+}
+#endif /* PA_WIN_DS_USE_NOTIFY_POSITIONS && !PA_WIN_DS_USE_WMME_TIMER */
+
 static void CalculateBufferSettings( unsigned long *hostBufferSizeFrames, 
                                     unsigned long *pollingPeriodFrames,
                                     int isFullDuplex,
@@ -1796,6 +1910,11 @@ static void CalculateBufferSettings( unsigned long *hostBufferSizeFrames,
         *hostBufferSizeFrames = userFramesPerBuffer 
                 + max( userFramesPerBuffer + pollingJitterFrames, targetBufferingLatencyFrames);
 
+        /* hold whole user buffers, so that the wrap of the ring doesn't split one in two lock
+           regions, and TimeSlice() can have each one rendered directly into the locked buffer */
+        *hostBufferSizeFrames = ((*hostBufferSizeFrames + userFramesPerBuffer - 1) / userFramesPerBuffer)
+                * userFramesPerBuffer;
+
         *pollingPeriodFrames = max( max(1, userFramesPerBuffer / 4), targetBufferingLatencyFrames / 16 );
 
         if( *pollingPeriodFrames > maximumPollingPeriodFrames )
@@ -2023,6 +2142,27 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
     memset( stream, 0, sizeof(PaWinDsStream) ); /* initialize all stream variables to 0 */
 
+#if !defined(PA_WIN_DS_USE_WMME_TIMER)
+    {
+        int cpuCount;
+        const int *cpus = GetCallbackCpus( outputParameters ? outputStreamInfo : NULL, &cpuCount );
+        if( !cpus )
+            cpus = GetCallbackCpus( inputParameters ? inputStreamInfo : NULL, &cpuCount );
+
+        if( cpus && streamCallback )
+        {
+            stream->processingThreadCpus = (int*)PaUtil_AllocateMemory( cpuCount * sizeof(int) );
+            if( !stream->processingThreadCpus )
+            {
+                result = paInsufficientMemory;
+                goto error;
+            }
+            memcpy( stream->processingThreadCpus, cpus, cpuCount * sizeof(int) );
+            stream->processingThreadCpuCount = cpuCount;
+        }
+    }
+#endif
+
     if( streamCallback )
     {
         PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
@@ -2081,6 +2221,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         goto error;
 
     bufferProcessorIsInitialized = 1;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
    
 /* DirectSound specific initialization */ 
@@ -2100,7 +2246,10 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 #endif
 
 #ifdef PA_WIN_DS_USE_WAITABLE_TIMER_OBJECT
-        stream->waitableTimer = (HANDLE)CreateWaitableTimer( 0, FALSE, NULL );
+        /* a high resolution timer keeps the polling period where the system has one */
+        stream->waitableTimer = (HANDLE)PaWinUtil_CreateHighResolutionTimer();
+        if( stream->waitableTimer == NULL )
+            stream->waitableTimer = (HANDLE)CreateWaitableTimer( 0, FALSE, NULL );
         if( stream->waitableTimer == NULL )
         {
             result = paUnanticipatedHostError;
@@ -2130,6 +2279,13 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             */
             stream->hostBufferSizeFrames = max( userRequestedHostInputBufferSizeFrames, userRequestedHostOutputBufferSizeFrames );
 
+            /* hold whole user buffers, as CalculateBufferSettings() does */
+            if( framesPerBuffer != paFramesPerBufferUnspecified )
+            {
+                stream->hostBufferSizeFrames = ((stream->hostBufferSizeFrames + framesPerBuffer - 1) / framesPerBuffer)
+                        * framesPerBuffer;
+            }
+
             CalculatePollingPeriodFrames( 
                     stream->hostBufferSizeFrames, &pollingPeriodFrames,
                     sampleRate, framesPerBuffer );
@@ -2292,6 +2448,11 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         }
     }
 
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+    if( streamCallback )
+        InitNotificationPositions( stream, pollingPeriodFrames, sampleRate );
+#endif
+
     SetStreamInfoLatencies( stream, framesPerBuffer, pollingPeriodFrames, sampleRate );
 
     stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
@@ -2316,6 +2477,11 @@ error:
             CloseHandle( stream->processingThreadCompleted );
 #endif
 
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+        if( stream->notifyEvent != NULL )
+            CloseHandle( stream->notifyEvent );
+#endif
+
         if( stream->pDirectSoundOutputBuffer )
         {
             IDirectSoundBuffer_Stop( stream->pDirectSoundOutputBuffer );
@@ -2361,6 +2527,9 @@ error:
         if( streamRepresentationIsInitialized )
             PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
 
+#if !defined(PA_WIN_DS_USE_WMME_TIMER)
+        PaUtil_FreeMemory( stream->processingThreadCpus );
+#endif
         PaUtil_FreeMemory( stream );
     }
 
@@ -2530,6 +2699,12 @@ static int TimeSlice( PaWinDsStream *stream )
         framesToXfer = (numOutFramesReady < numInFramesReady) ? numOutFramesReady : numInFramesReady;
     }
 
+    /* Transfer whole user buffers only. The buffer processor then calls the callback directly on
+       the lock regions when the user and host formats match, instead of going through its
+       temporary buffers for the partial user buffer that would otherwise end each slice. */
+    if( stream->bufferProcessor.framesPerUserBuffer != paFramesPerBufferUnspecified )
+        framesToXfer -= framesToXfer % (long)stream->bufferProcessor.framesPerUserBuffer;
+
     if( framesToXfer > 0 )
     {
         PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
@@ -2762,11 +2937,96 @@ static void CALLBACK WaitableTimerAPCProc(
 #endif /* PA_WIN_DS_USE_WAITABLE_TIMER_OBJECT */
 
 
+#ifdef PA_WIN_DS_USE_NOTIFY_POSITIONS
+
+/*
+    Processing driven by notification positions. Notifications are delivered at a regular rate
+    once the buffer runs, so the cursor is predicted to reach the next position one notify
+    period after the last one arrived. If nothing arrives by then (plus half a period of slack)
+    the notification is considered lost and we process anyway, so a driver that drops or delays
+    notifications costs latency but never stalls the stream.
+*/
+static void NotificationProcessingLoop( PaWinDsStream *stream )
+{
+    HANDLE events[2];
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    LONGLONG periodTicks;
+    LONGLONG nextNotifyTicks;
+    DWORD waitResult;
+
+    events[0] = stream->processingCompleted;
+    events[1] = stream->notifyEvent;
+
+    if( !QueryPerformanceFrequency( &frequency ) || frequency.QuadPart == 0 )
+        frequency.QuadPart = 1000;
+    periodTicks = (LONGLONG)(stream->notifyPeriodSeconds * frequency.QuadPart);
+    if( periodTicks < 1 )
+        periodTicks = 1;
+
+    /* invoke first time slice immediately */
+    TimerCallback( 0, 0, (DWORD_PTR)stream, 0, 0 );
+    QueryPerformanceCounter( &now );
+    nextNotifyTicks = now.QuadPart + periodTicks;
+
+    for(;;)
+    {
+        LONGLONG timeoutTicks;
+        DWORD timeoutMs;
+
+        QueryPerformanceCounter( &now );
+        timeoutTicks = nextNotifyTicks + (periodTicks / 2) - now.QuadPart;
+        timeoutMs = (timeoutTicks > 0) ? (DWORD)((timeoutTicks * MSECS_PER_SECOND + frequency.QuadPart - 1) / frequency.QuadPart) : 0;
+        if( timeoutMs < 1 )
+            timeoutMs = 1;
+
+        waitResult = WaitForMultipleObjects( 2, events, /* bWaitAll = */ FALSE, timeoutMs );
+        if( waitResult == WAIT_OBJECT_0 + 1 )
+        {
+            /* re-anchor the prediction on the notification */
+            QueryPerformanceCounter( &now );
+            nextNotifyTicks = now.QuadPart + periodTicks;
+        }
+        else if( waitResult == WAIT_TIMEOUT )
+        {
+            /* missed notification, keep to the predicted schedule */
+            QueryPerformanceCounter( &now );
+            nextNotifyTicks += periodTicks;
+            if( nextNotifyTicks <= now.QuadPart )
+                nextNotifyTicks = now.QuadPart + periodTicks;
+        }
+        else
+        {
+            /* processingCompleted signaled, or the wait failed */
+            break;
+        }
+
+        TimerCallback( 0, 0, (DWORD_PTR)stream, 0, 0 );
+    }
+}
+
+#endif /* PA_WIN_DS_USE_NOTIFY_POSITIONS */
+
+
 PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
 {
     PaWinDsStream *stream = (PaWinDsStream *)pArg;
     LARGE_INTEGER dueTime;
     int timerPeriodMs;
+    void *mmcssTask;
+
+    /* on top of THREAD_PRIORITY_TIME_CRITICAL where MMCSS is available */
+    mmcssTask = PaWinUtil_RegisterMmcssThread( NULL, paWinUtilMmcssDefaultPriority );
+
+#ifdef PA_WIN_DS_USE_NOTIFY_POSITIONS
+    if( stream->notifyEvent != NULL )
+    {
+        NotificationProcessingLoop( stream );
+        PaWinUtil_RevertMmcssThread( mmcssTask );
+        SetEvent( stream->processingThreadCompleted );
+        return 0;
+    }
+#endif
 
     timerPeriodMs = (int)(stream->pollingPeriodSeconds * MSECS_PER_SECOND);
     if( timerPeriodMs < 1 )
@@ -2802,6 +3062,7 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
     }
 #endif /* PA_WIN_DS_USE_WAITABLE_TIMER_OBJECT */
 
+    PaWinUtil_RevertMmcssThread( mmcssTask );
     SetEvent( stream->processingThreadCompleted );
 
     return 0;
@@ -2829,6 +3090,11 @@ static PaError CloseStream( PaStream* s )
     CloseHandle( stream->processingThreadCompleted );
 #endif
 
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+    if( stream->notifyEvent != NULL )
+        CloseHandle( stream->notifyEvent );
+#endif
+
     // Cleanup the sound buffers
     if( stream->pDirectSoundOutputBuffer )
     {
@@ -2872,6 +3138,9 @@ static PaError CloseStream( PaStream* s )
 
     PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
     PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+#if !defined(PA_WIN_DS_USE_WMME_TIMER)
+    PaUtil_FreeMemory( stream->processingThreadCpus );
+#endif
     PaUtil_FreeMemory( stream );
 
     return result;
@@ -2927,6 +3196,11 @@ static PaError StartStream( PaStream *s )
     ResetEvent( stream->processingThreadCompleted );
 #endif
 
+#if defined(PA_WIN_DS_USE_NOTIFY_POSITIONS) && !defined(PA_WIN_DS_USE_WMME_TIMER)
+    if( stream->notifyEvent != NULL )
+        ResetEvent( stream->notifyEvent );
+#endif
+
     if( stream->bufferProcessor.inputChannelCount > 0 )
     {
         // Start the buffer capture
@@ -3050,6 +3324,17 @@ static PaError StartStream( PaStream *s )
             PA_DS_SET_LAST_DIRECTSOUND_ERROR( GetLastError() );
             goto error;
         }
+
+        if( stream->processingThreadCpus )
+        {
+            result = PaWinUtil_SetThreadCpuAffinity( stream->processingThread,
+                    stream->processingThreadCpus, stream->processingThreadCpuCount );
+            if( result != paNoError )
+            {
+                PA_DS_SET_LAST_DIRECTSOUND_ERROR( GetLastError() );
+                goto error;
+            }
+        }
 #endif
     }
 
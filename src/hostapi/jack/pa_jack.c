@@ -57,7 +57,6 @@
 #include <errno.h>  /* EBUSY */
 #include <signal.h> /* sig_atomic_t */
 #include <math.h>
-#include <semaphore.h>
 
 #include <jack/types.h>
 #include <jack/jack.h>
@@ -68,8 +67,11 @@
 #include "pa_process.h"
 #include "pa_allocation.h"
 #include "pa_cpuload.h"
-#include "pa_ringbuffer.h"
+#include "pa_blockingio.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+#include "pa_unix_util.h"
+#include "pa_jack.h"
 
 static pthread_t mainThread_;
 static char *jackErr_ = NULL;
@@ -138,14 +140,18 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            void *userData );
 static PaError CloseStream( PaStream* stream );
 static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
 static PaError StopStream( PaStream *stream );
 static PaError AbortStream( PaStream *stream );
 static PaError IsStreamStopped( PaStream *s );
 static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
 /*static PaTime GetStreamInputLatency( PaStream *stream );*/
 /*static PaTime GetStreamOutputLatency( PaStream *stream );*/
 static PaTime GetStreamTime( PaStream *stream );
 static double GetStreamCpuLoad( PaStream* stream );
+static signed long GetStreamMemoryUsage( PaStream* stream );
 
 
 /*
@@ -172,9 +178,12 @@ typedef struct
 
     /* For dealing with the process thread */
     volatile int xrun;     /* Received xrun notification from JACK? */
-    struct PaJackStream * volatile toAdd, * volatile toRemove;
-    struct PaJackStream *processQueue;
+    /* The streams processed by the JACK callback, which walks the list without locking. Only changed under mtx, a
+     * stream taken off the list is only let go once the callback can't be walking it (SynchronizeProcessQueue). */
+    struct PaJackStream * volatile processQueue;
+    volatile unsigned long processCycles;  /* Odd while the JACK callback walks processQueue */
     volatile sig_atomic_t jackIsDown;
+    volatile sig_atomic_t freewheeling;    /* Is the server running the clients as fast as it can? */
 }
 PaJackHostApiRepresentation;
 
@@ -195,10 +204,15 @@ typedef struct PaJackStream
     jack_port_t **remote_input_ports;
     jack_port_t **remote_output_ports;
 
+    /* the port buffers of the current cycle, handed to a direct callback */
+    jack_default_audio_sample_t **input_buffers;
+    jack_default_audio_sample_t **output_buffers;
+
     int num_incoming_connections;
     int num_outgoing_connections;
 
     jack_client_t *jack_client;
+    int dedicatedClient;    /* jack_client is the stream's own, which processes it (paJackDedicatedClient) */
 
     /* The stream is running if it's still producing samples.
      * The stream is active if samples it produced are still being heard.
@@ -217,18 +231,16 @@ typedef struct PaJackStream
     int callbackResult;
     int isSilenced;
     int xrun;
+    int convertSampleRate;  /* The callback runs at streamInfo.sampleRate instead of JACK's rate (paConvertSampleRate) */
+    int canDirectCallback;  /* The callback takes JACK's format at JACK's rate, directCallback at a fitting buffer size */
+    int directCallback;     /* The callback takes the port buffers as they are, bypassing the buffer processor */
 
     /* These are useful for the blocking API */
 
     int                     isBlockingStream;
-    PaUtilRingBuffer        inFIFO;
-    PaUtilRingBuffer        outFIFO;
-    volatile sig_atomic_t   data_available;
-    sem_t                   data_semaphore;
-    int                     bytesPerFrame;
-    int                     samplesPerFrame;
-
-    struct PaJackStream *next;
+    PaUtilBlockingIO        blockingIO;
+
+    struct PaJackStream * volatile next;
 }
 PaJackStream;
 
@@ -244,6 +256,7 @@ PaJackStream;
  */
 
 static int JackCallback( jack_nframes_t frames, void *userData );
+static PaError ProcessStream( PaJackStream *stream, jack_nframes_t frames );
 
 
 /*
@@ -254,166 +267,18 @@ static int JackCallback( jack_nframes_t frames, void *userData );
 
 /* ---- blocking emulation layer ---- */
 
-/* Allocate buffer. */
-static PaError BlockingInitFIFO( PaUtilRingBuffer *rbuf, long numFrames, long bytesPerFrame )
-{
-    long numBytes = numFrames * bytesPerFrame;
-    char *buffer = (char *) malloc( numBytes );
-    if( buffer == NULL ) return paInsufficientMemory;
-    memset( buffer, 0, numBytes );
-    return (PaError) PaUtil_InitializeRingBuffer( rbuf, 1, numBytes, buffer );
-}
-
-/* Free buffer. */
-static PaError BlockingTermFIFO( PaUtilRingBuffer *rbuf )
-{
-    if( rbuf->buffer ) free( rbuf->buffer );
-    rbuf->buffer = NULL;
-    return paNoError;
-}
-
-static int
-BlockingCallback( const void                      *inputBuffer,
-                  void                            *outputBuffer,
-		  unsigned long                    framesPerBuffer,
-		  const PaStreamCallbackTimeInfo*  timeInfo,
-		  PaStreamCallbackFlags            statusFlags,
-		  void                             *userData )
-{
-    struct PaJackStream *stream = (PaJackStream *)userData;
-    long numBytes = stream->bytesPerFrame * framesPerBuffer;
-
-    /* This may get called with NULL inputBuffer during initial setup. */
-    if( inputBuffer != NULL )
-    {
-        PaUtil_WriteRingBuffer( &stream->inFIFO, inputBuffer, numBytes );
-    }
-    if( outputBuffer != NULL )
-    {
-        int numRead = PaUtil_ReadRingBuffer( &stream->outFIFO, outputBuffer, numBytes );
-        /* Zero out remainder of buffer if we run out of data. */
-        memset( (char *)outputBuffer + numRead, 0, numBytes - numRead );
-    }
-
-    if( !stream->data_available )
-    {
-        stream->data_available = 1;
-        sem_post( &stream->data_semaphore );
-    }
-    return paContinue;
-}
-
-static PaError
-BlockingBegin( PaJackStream *stream, int minimum_buffer_size )
-{
-    long    doRead = 0;
-    long    doWrite = 0;
-    PaError result = paNoError;
-    long    numFrames;
-
-    doRead = stream->local_input_ports != NULL;
-    doWrite = stream->local_output_ports != NULL;
-    /* <FIXME> */
-    stream->samplesPerFrame = 2;
-    stream->bytesPerFrame = sizeof(float) * stream->samplesPerFrame;
-    /* </FIXME> */
-    numFrames = 32;
-    while (numFrames < minimum_buffer_size)
-        numFrames *= 2;
-
-    if( doRead )
-    {
-        ENSURE_PA( BlockingInitFIFO( &stream->inFIFO, numFrames, stream->bytesPerFrame ) );
-    }
-    if( doWrite )
-    {
-        long numBytes;
-
-        ENSURE_PA( BlockingInitFIFO( &stream->outFIFO, numFrames, stream->bytesPerFrame ) );
-
-        /* Make Write FIFO appear full initially. */
-        numBytes = PaUtil_GetRingBufferWriteAvailable( &stream->outFIFO );
-        PaUtil_AdvanceRingBufferWriteIndex( &stream->outFIFO, numBytes );
-    }
-
-    stream->data_available = 0;
-    sem_init( &stream->data_semaphore, 0, 0 );
-
-error:
-    return result;
-}
-
-static void
-BlockingEnd( PaJackStream *stream )
-{
-    BlockingTermFIFO( &stream->inFIFO );
-    BlockingTermFIFO( &stream->outFIFO );
-
-    sem_destroy( &stream->data_semaphore );
-}
-
 static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFrames )
 {
-    PaError result = paNoError;
     PaJackStream *stream = (PaJackStream *)s;
 
-    long bytesRead;
-    char *p = (char *) data;
-    long numBytes = stream->bytesPerFrame * numFrames;
-    while( numBytes > 0 )
-    {
-        bytesRead = PaUtil_ReadRingBuffer( &stream->inFIFO, p, numBytes );
-        numBytes -= bytesRead;
-        p += bytesRead;
-        if( numBytes > 0 )
-        {
-            /* see write for an explanation */
-            if( stream->data_available )
-                stream->data_available = 0;
-            else
-                sem_wait( &stream->data_semaphore );
-        }
-    }
-
-    return result;
+    return PaUtil_ReadBlockingIO( &stream->blockingIO, data, numFrames );
 }
 
 static PaError BlockingWriteStream( PaStream* s, const void *data, unsigned long numFrames )
 {
-    PaError result = paNoError;
     PaJackStream *stream = (PaJackStream *)s;
-    long bytesWritten;
-    char *p = (char *) data;
-    long numBytes = stream->bytesPerFrame * numFrames;
-    while( numBytes > 0 )
-    {
-        bytesWritten = PaUtil_WriteRingBuffer( &stream->outFIFO, p, numBytes );
-        numBytes -= bytesWritten;
-        p += bytesWritten;
-        if( numBytes > 0 )
-        {
-            /* we use the following algorithm:
-             *   (1) write data
-             *   (2) if some data didn't fit into the ringbuffer, set data_available to 0
-             *       to indicate to the audio that if space becomes available, we want to know
-             *   (3) retry to write data (because it might be that between (1) and (2)
-             *       new space in the buffer became available)
-             *   (4) if this failed, we are sure that the buffer is really empty and
-             *       we will definitely receive a notification when it becomes available
-             *       thus we can safely sleep
-             *
-             * if the algorithm bailed out in step (3) before, it leaks a count of 1
-             * on the semaphore; however, it doesn't matter, because if we block in (4),
-             * we also do it in a loop
-             */
-            if( stream->data_available )
-                stream->data_available = 0;
-            else
-                sem_wait( &stream->data_semaphore );
-        }
-    }
 
-    return result;
+    return PaUtil_WriteBlockingIO( &stream->blockingIO, data, numFrames );
 }
 
 static signed long
@@ -421,8 +286,7 @@ BlockingGetStreamReadAvailable( PaStream* s )
 {
     PaJackStream *stream = (PaJackStream *)s;
 
-    int bytesFull = PaUtil_GetRingBufferReadAvailable( &stream->inFIFO );
-    return bytesFull / stream->bytesPerFrame;
+    return PaUtil_GetBlockingIOReadAvailable( &stream->blockingIO );
 }
 
 static signed long
@@ -430,21 +294,7 @@ BlockingGetStreamWriteAvailable( PaStream* s )
 {
     PaJackStream *stream = (PaJackStream *)s;
 
-    int bytesEmpty = PaUtil_GetRingBufferWriteAvailable( &stream->outFIFO );
-    return bytesEmpty / stream->bytesPerFrame;
-}
-
-static PaError
-BlockingWaitEmpty( PaStream *s )
-{
-    PaJackStream *stream = (PaJackStream *)s;
-
-    while( PaUtil_GetRingBufferReadAvailable( &stream->outFIFO ) > 0 )
-    {
-        stream->data_available = 0;
-        sem_wait( &stream->data_semaphore );
-    }
-    return 0;
+    return PaUtil_GetBlockingIOWriteAvailable( &stream->blockingIO );
 }
 
 /* ---- jack driver ---- */
@@ -644,6 +494,10 @@ error:
 
 static void UpdateSampleRate( PaJackStream *stream, double sampleRate )
 {
+    /* XXX: The converter keeps running for the rate the stream was opened with */
+    if( stream->convertSampleRate )
+        return;
+
     /* XXX: Maybe not the cleanest way of going about this? */
     stream->cpuLoadMeasurer.samplingPeriod = stream->bufferProcessor.samplePeriod = 1. / sampleRate;
     stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
@@ -698,6 +552,59 @@ static int JackSrCb( jack_nframes_t nframes, void *arg )
     return 0;
 }
 
+/* Adapt a stream to JACK's buffer size: whether the callback can run directly on the port buffers, and the
+ * latencies. The buffer processor takes host buffers of any size, so it needs no reconfiguration. */
+static void UpdateBufferSize( PaJackStream *stream, jack_nframes_t bufferSize )
+{
+    const double jackSr = jack_get_sample_rate( stream->jack_client );
+    /* The port latencies are in JACK's frames, the buffer processor's in the callback's */
+    const double sampleRate = stream->convertSampleRate ? stream->streamRepresentation.streamInfo.sampleRate : jackSr;
+    unsigned long framesPerUserBuffer = stream->bufferProcessor.framesPerUserBuffer;
+
+    stream->directCallback = stream->canDirectCallback
+        && ( framesPerUserBuffer == paFramesPerBufferUnspecified || framesPerUserBuffer == bufferSize );
+
+    if( stream->num_incoming_connections > 0 )
+        stream->streamRepresentation.streamInfo.inputLatency = (jack_port_get_latency( stream->remote_output_ports[0] )
+                - bufferSize) / jackSr  /* One buffer is not counted as latency */
+            + ( stream->directCallback ? 0 : PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor ) / sampleRate );
+    if( stream->num_outgoing_connections > 0 )
+        stream->streamRepresentation.streamInfo.outputLatency = (jack_port_get_latency( stream->remote_input_ports[0] )
+                - bufferSize) / jackSr  /* One buffer is not counted as latency */
+            + ( stream->directCallback ? 0 : PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor ) / sampleRate );
+}
+
+/* JACK changes its buffer size in between process cycles, the streams carry on with the new size */
+static int JackBufSizeCb( jack_nframes_t nframes, void *arg )
+{
+    PaJackHostApiRepresentation *jackApi = (PaJackHostApiRepresentation *)arg;
+    PaJackStream *stream = jackApi->processQueue;
+
+    PA_DEBUG(( "%s: Acting on change in JACK buffer size: %u\n", __FUNCTION__, (unsigned)nframes ));
+    jackApi->jack_buffer_size = nframes;
+    for( ; stream; stream = stream->next )
+        UpdateBufferSize( stream, nframes );
+
+    return 0;
+}
+
+/* In freewheel mode the server runs the process cycles back to back, not at the pace of the sound card */
+static void JackFreewheelCb( int starting, void *arg )
+{
+    PaJackHostApiRepresentation *jackApi = (PaJackHostApiRepresentation *)arg;
+
+    PA_DEBUG(( "%s: Freewheel mode %s\n", __FUNCTION__, starting ? "entered" : "left" ));
+    jackApi->freewheeling = starting;
+}
+
+/* The frame time of the current cycle for the time infos. The frame time of JACK is extrapolated from the last
+ * cycle's at the wall clock, which doesn't keep pace with a freewheeling server, whose cycles are counted instead. */
+static jack_nframes_t GetFrameTime( PaJackStream *stream )
+{
+    return stream->hostApi->freewheeling ? jack_last_frame_time( stream->jack_client )
+        : jack_frame_time( stream->jack_client );
+}
+
 static int JackXRunCb(void *arg) {
     PaJackHostApiRepresentation *hostApi = (PaJackHostApiRepresentation *)arg;
     assert( hostApi );
@@ -720,7 +627,7 @@ PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi,
     UNLESS( jackHostApi->deviceInfoMemory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
 
     mainThread_ = pthread_self();
-    ASSERT_CALL( pthread_mutex_init( &jackHostApi->mtx, NULL ), 0 );
+    ASSERT_CALL( PaUnix_InitializeMutex( &jackHostApi->mtx ), 0 );
     ASSERT_CALL( pthread_cond_init( &jackHostApi->cond, NULL ), 0 );
 
     /* Try to become a client of the JACK server.  If we cannot do
@@ -756,6 +663,11 @@ PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi,
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &jackHostApi->callbackStreamInterface,
                                       CloseStream, StartStream,
@@ -765,6 +677,9 @@ PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi,
                                       PaUtil_DummyRead, PaUtil_DummyWrite,
                                       PaUtil_DummyGetReadAvailable,
                                       PaUtil_DummyGetWriteAvailable );
+    jackHostApi->callbackStreamInterface.Pause = PauseStream;
+    jackHostApi->callbackStreamInterface.Resume = ResumeStream;
+    jackHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
 
     PaUtil_InitializeStreamInterface( &jackHostApi->blockingStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
@@ -774,16 +689,21 @@ PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi,
 
     jackHostApi->inputBase = jackHostApi->outputBase = 0;
     jackHostApi->xrun = 0;
-    jackHostApi->toAdd = jackHostApi->toRemove = NULL;
     jackHostApi->processQueue = NULL;
+    jackHostApi->processCycles = 0;
     jackHostApi->jackIsDown = 0;
+    jackHostApi->freewheeling = 0;
 
     jack_on_shutdown( jackHostApi->jack_client, JackOnShutdown, jackHostApi );
     jack_set_error_function( JackErrorCallback );
     jackHostApi->jack_buffer_size = jack_get_buffer_size ( jackHostApi->jack_client );
     /* Don't check for error, may not be supported (deprecated in at least jackdmp) */
     jack_set_sample_rate_callback( jackHostApi->jack_client, JackSrCb, jackHostApi );
+    UNLESS( !jack_set_buffer_size_callback( jackHostApi->jack_client, JackBufSizeCb, jackHostApi ),
+            paUnanticipatedHostError );
     UNLESS( !jack_set_xrun_callback( jackHostApi->jack_client, JackXRunCb, jackHostApi ), paUnanticipatedHostError );
+    UNLESS( !jack_set_freewheel_callback( jackHostApi->jack_client, JackFreewheelCb, jackHostApi ),
+            paUnanticipatedHostError );
     UNLESS( !jack_set_process_callback( jackHostApi->jack_client, JackCallback, jackHostApi ), paUnanticipatedHostError );
     UNLESS( !jack_activate( jackHostApi->jack_client ), paUnanticipatedHostError );
     activated = 1;
@@ -836,6 +756,22 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
     jackErr_ = NULL;
 }
 
+/* Check the host API specific stream info of a direction, streamInfo is set to NULL if it has none */
+static PaError ValidateStreamInfo( const PaStreamParameters *parameters, const PaJackStreamInfo **streamInfo )
+{
+    const PaJackStreamInfo *info = (const PaJackStreamInfo *)parameters->hostApiSpecificStreamInfo;
+
+    *streamInfo = NULL;
+    if( !info )
+        return paNoError;
+    if( info->size != sizeof (PaJackStreamInfo) || info->hostApiType != paJACK || info->version != 1
+            || ( info->flags & ~paJackDedicatedClient ) )
+        return paIncompatibleHostApiSpecificStreamInfo;
+
+    *streamInfo = info;
+    return paNoError;
+}
+
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
@@ -843,6 +779,7 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
 {
     int inputChannelCount = 0, outputChannelCount = 0;
     PaSampleFormat inputSampleFormat, outputSampleFormat;
+    const PaJackStreamInfo *inputStreamInfo = NULL, *outputStreamInfo = NULL;
 
     if( inputParameters )
     {
@@ -860,8 +797,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate inputStreamInfo */
-        if( inputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( ValidateStreamInfo( inputParameters, &inputStreamInfo ) != paNoError )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -884,8 +821,8 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate outputStreamInfo */
-        if( outputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( ValidateStreamInfo( outputParameters, &outputStreamInfo ) != paNoError )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -944,6 +881,8 @@ static PaError InitializeStream( PaJackStream *stream, PaJackHostApiRepresentati
                 (jack_port_t**) PaUtil_GroupAllocateMemory( stream->stream_memory, sizeof(jack_port_t*) * numInputChannels ),
                 paInsufficientMemory );
         memset( stream->remote_output_ports, 0, sizeof(jack_port_t*) * numInputChannels );
+        UNLESS( stream->input_buffers = (jack_default_audio_sample_t**) PaUtil_GroupAllocateMemory(
+                    stream->stream_memory, sizeof(jack_default_audio_sample_t*) * numInputChannels ), paInsufficientMemory );
     }
     if( numOutputChannels > 0 )
     {
@@ -955,6 +894,8 @@ static PaError InitializeStream( PaJackStream *stream, PaJackHostApiRepresentati
                 (jack_port_t**) PaUtil_GroupAllocateMemory( stream->stream_memory, sizeof(jack_port_t*) * numOutputChannels ),
                 paInsufficientMemory );
         memset( stream->remote_input_ports, 0, sizeof(jack_port_t*) * numOutputChannels );
+        UNLESS( stream->output_buffers = (jack_default_audio_sample_t**) PaUtil_GroupAllocateMemory(
+                    stream->stream_memory, sizeof(jack_default_audio_sample_t*) * numOutputChannels ), paInsufficientMemory );
     }
 
     stream->num_incoming_connections = numInputChannels;
@@ -975,7 +916,7 @@ static void CleanUpStream( PaJackStream *stream, int terminateStreamRepresentati
     assert( stream );
 
     if( stream->isBlockingStream )
-        BlockingEnd( stream );
+        PaUtil_TerminateBlockingIO( &stream->blockingIO );
 
     for( i = 0; i < stream->num_incoming_connections; ++i )
     {
@@ -988,6 +929,9 @@ static void CleanUpStream( PaJackStream *stream, int terminateStreamRepresentati
             ASSERT_CALL( jack_port_unregister( stream->jack_client, stream->local_output_ports[i] ), 0 );
     }
 
+    if( stream->dedicatedClient )
+        ASSERT_CALL( jack_client_close( stream->jack_client ), 0 );
+
     if( terminateStreamRepresentation )
         PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
     if( terminateBufferProcessor )
@@ -1021,20 +965,57 @@ error:
     return result;
 }
 
+/* Wait until the JACK callback can't be walking a version of the process queue from before the last change to it.
+ *
+ * The callback makes processCycles odd before reading processQueue and even once done with it. If it is odd after
+ * the change was published, the callback may have read the old list, in which case the end of that cycle is waited
+ * for; the next cycle reads the new list.
+ */
+static PaError SynchronizeProcessQueue( PaJackHostApiRepresentation *hostApi )
+{
+    PaError result = paNoError;
+    PaTime start = PaUtil_GetTime();
+    unsigned long cycles;
+
+    PaUtil_FullMemoryBarrier();
+    cycles = hostApi->processCycles;
+    if( cycles & 1 )
+    {
+        while( hostApi->processCycles == cycles && !hostApi->jackIsDown )
+        {
+            UNLESS( PaUtil_GetTime() - start < 10 * 60 /* 10 minutes, as WaitCondition */, paTimedOut );
+            Pa_Sleep( 1 );
+        }
+    }
+
+error:
+    return result;
+}
+
+/* Add stream to the end of the processing queue */
 static PaError AddStream( PaJackStream *stream )
 {
     PaError result = paNoError;
     PaJackHostApiRepresentation *hostApi = stream->hostApi;
-    /* Add to queue of streams that should be processed */
+    const double jackSr = jack_get_sample_rate( hostApi->jack_client );
+
     ASSERT_CALL( pthread_mutex_lock( &hostApi->mtx ), 0 );
     if( !hostApi->jackIsDown )
     {
-        hostApi->toAdd = stream;
-        /* Unlock mutex and await signal from processing thread */
-        result = WaitCondition( stream->hostApi );
+        PaJackStream * volatile *link = &hostApi->processQueue;
+        while( *link )
+            link = &(*link)->next;
+
+        /* If necessary, update stream state */
+        if( stream->streamRepresentation.streamInfo.sampleRate != jackSr )
+            UpdateSampleRate( stream, jackSr );
+        stream->next = NULL;
+
+        /* The stream must be complete before the callback can find it */
+        PaUtil_WriteMemoryBarrier();
+        *link = stream;
     }
     ASSERT_CALL( pthread_mutex_unlock( &hostApi->mtx ), 0 );
-    ENSURE_PA( result );
 
     UNLESS( !hostApi->jackIsDown, paDeviceUnavailable );
 
@@ -1047,17 +1028,99 @@ static PaError RemoveStream( PaJackStream *stream )
 {
     PaError result = paNoError;
     PaJackHostApiRepresentation *hostApi = stream->hostApi;
+    PaJackStream * volatile *link;
+    int removed = 0;
 
-    /* Add to queue over streams that should be processed */
     ASSERT_CALL( pthread_mutex_lock( &hostApi->mtx ), 0 );
-    if( !hostApi->jackIsDown )
+    for( link = &hostApi->processQueue; *link; link = &(*link)->next )
     {
-        hostApi->toRemove = stream;
-        /* Unlock mutex and await signal from processing thread */
-        result = WaitCondition( stream->hostApi );
+        if( *link == stream )
+        {
+            /* The stream keeps its next, the callback may still be on it */
+            *link = stream->next;
+            removed = 1;
+            break;
+        }
     }
     ASSERT_CALL( pthread_mutex_unlock( &hostApi->mtx ), 0 );
-    ENSURE_PA( result );
+    UNLESS( removed, paInternalError );
+    PA_DEBUG(( "%s: Removed stream from processing queue\n", __FUNCTION__ ));
+
+    ENSURE_PA( SynchronizeProcessQueue( hostApi ) );
+
+error:
+    return result;
+}
+
+/* The process callback of a dedicated client */
+static int JackStreamCallback( jack_nframes_t frames, void *arg )
+{
+    return ProcessStream( (PaJackStream *)arg, frames ) == paNoError ? 0 : -1;
+}
+
+static int JackStreamSrCb( jack_nframes_t nframes, void *arg )
+{
+    PaJackStream *stream = (PaJackStream *)arg;
+
+    if( stream->streamRepresentation.streamInfo.sampleRate != (double)nframes )
+        UpdateSampleRate( stream, (double)nframes );
+    return 0;
+}
+
+static int JackStreamBufSizeCb( jack_nframes_t nframes, void *arg )
+{
+    UpdateBufferSize( (PaJackStream *)arg, nframes );
+    return 0;
+}
+
+static int JackStreamXRunCb( void *arg )
+{
+    ((PaJackStream *)arg)->xrun = TRUE;
+    return 0;
+}
+
+/* The server going down takes all clients with it, down to the one of the host API */
+static void JackStreamOnShutdown( void *arg )
+{
+    PaJackStream *stream = (PaJackStream *)arg;
+    PaJackHostApiRepresentation *jackApi = stream->hostApi;
+
+    stream->is_active = 0;
+    ASSERT_CALL( pthread_mutex_lock( &jackApi->mtx ), 0 );
+    jackApi->jackIsDown = 1;
+    ASSERT_CALL( pthread_cond_signal( &jackApi->cond ), 0 );
+    ASSERT_CALL( pthread_mutex_unlock( &jackApi->mtx ), 0 );
+}
+
+/* Open a client of the stream's own (paJackDedicatedClient), activated once the stream is complete */
+static PaError OpenDedicatedClient( PaJackStream *stream, const char *clientName )
+{
+    PaError result = paNoError;
+    jack_client_t *client;
+    jack_status_t jackStatus = 0;
+
+    if( !clientName )
+        clientName = jack_get_client_name( stream->hostApi->jack_client );
+    UNLESS( strlen( clientName ) < (size_t)jack_client_name_size(), paIncompatibleHostApiSpecificStreamInfo );
+
+    client = jack_client_open( clientName, JackNoStartServer, &jackStatus );
+    if( !client )
+    {
+        PA_DEBUG(( "%s: Couldn't open a client, status: %d\n", __FUNCTION__, jackStatus ));
+        result = paUnanticipatedHostError;
+        goto error;
+    }
+    stream->jack_client = client;
+    stream->dedicatedClient = 1;
+
+    jack_on_shutdown( stream->jack_client, JackStreamOnShutdown, stream );
+    /* Don't check for error, may not be supported (deprecated in at least jackdmp) */
+    jack_set_sample_rate_callback( stream->jack_client, JackStreamSrCb, stream );
+    UNLESS( !jack_set_buffer_size_callback( stream->jack_client, JackStreamBufSizeCb, stream ), paUnanticipatedHostError );
+    UNLESS( !jack_set_xrun_callback( stream->jack_client, JackStreamXRunCb, stream ), paUnanticipatedHostError );
+    UNLESS( !jack_set_freewheel_callback( stream->jack_client, JackFreewheelCb, stream->hostApi ),
+            paUnanticipatedHostError );
+    UNLESS( !jack_set_process_callback( stream->jack_client, JackStreamCallback, stream ), paUnanticipatedHostError );
 
 error:
     return result;
@@ -1088,6 +1151,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     PaSampleFormat inputSampleFormat = 0, outputSampleFormat = 0;
     int bpInitialized = 0, srInitialized = 0;   /* Initialized buffer processor and stream representation? */
     unsigned long ofs;
+    const PaJackStreamInfo *inputStreamInfo = NULL, *outputStreamInfo = NULL;
+    unsigned long jackFlags;
 
     /* validate platform specific flags */
     if( (streamFlags & paPlatformSpecificFlags) != 0 )
@@ -1122,8 +1187,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate inputStreamInfo */
-        if( inputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( ValidateStreamInfo( inputParameters, &inputStreamInfo ) != paNoError )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -1146,8 +1211,8 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             return paInvalidChannelCount;
 
         /* validate outputStreamInfo */
-        if( outputParameters->hostApiSpecificStreamInfo )
-            return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+        if( ValidateStreamInfo( outputParameters, &outputStreamInfo ) != paNoError )
+            return paIncompatibleHostApiSpecificStreamInfo;
     }
     else
     {
@@ -1158,13 +1223,21 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
      * A: This rate isn't necessarily constant though? */
 
 #define ABS(x) ( (x) > 0 ? (x) : -(x) )
-    if( ABS(sampleRate - jackSr) > 1 )
+    if( ABS(sampleRate - jackSr) > 1 && !( streamCallback && (streamFlags & paConvertSampleRate) ) )
        return paInvalidSampleRate;
 #undef ABS
 
     UNLESS( stream = (PaJackStream*)PaUtil_AllocateMemory( sizeof(PaJackStream) ), paInsufficientMemory );
     ENSURE_PA( InitializeStream( stream, jackHostApi, inputChannelCount, outputChannelCount ) );
 
+    jackFlags = ( inputStreamInfo ? inputStreamInfo->flags : 0 ) | ( outputStreamInfo ? outputStreamInfo->flags : 0 );
+    if( jackFlags & paJackDedicatedClient )
+    {
+        const char *clientName = outputStreamInfo && outputStreamInfo->clientName ? outputStreamInfo->clientName
+            : inputStreamInfo && inputStreamInfo->clientName ? inputStreamInfo->clientName : NULL;
+        ENSURE_PA( OpenDedicatedClient( stream, clientName ) );
+    }
+
     /* the blocking emulation, if necessary */
     stream->isBlockingStream = !streamCallback;
     if( stream->isBlockingStream )
@@ -1184,12 +1257,13 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         if( jackHostApi->jack_buffer_size * 3 > minimum_buffer_frames )
             minimum_buffer_frames = jackHostApi->jack_buffer_size * 3;
 
-        /* setup blocking API data structures (FIXME: can fail) */
-        BlockingBegin( stream, minimum_buffer_frames );
+        /* setup blocking API data structures, with the user's formats the buffer processor converts to */
+        ENSURE_PA( PaUtil_InitializeBlockingIO( &stream->blockingIO, inputChannelCount, inputSampleFormat,
+                    outputChannelCount, outputSampleFormat, minimum_buffer_frames ) );
 
         /* install our own callback for the blocking API */
-        streamCallback = BlockingCallback;
-        userData = stream;
+        streamCallback = PaUtil_BlockingIOCallback;
+        userData = &stream->blockingIO;
 
         PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
                                                &jackHostApi->blockingStreamInterface, streamCallback, userData );
@@ -1208,25 +1282,28 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     /* Register a unique set of ports for this stream
      * TODO: Robust allocation of new port names */
 
-    ofs = jackHostApi->inputBase;
+    /* The ports of a dedicated client are numbered on their own */
+    ofs = stream->dedicatedClient ? 0 : jackHostApi->inputBase;
     for( i = 0; i < inputChannelCount; i++ )
     {
         snprintf( port_string, jack_port_name_size(), "in_%lu", ofs + i );
         UNLESS( stream->local_input_ports[i] = jack_port_register(
-              jackHostApi->jack_client, port_string,
+              stream->jack_client, port_string,
               JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0 ), paInsufficientMemory );
     }
-    jackHostApi->inputBase += inputChannelCount;
+    if( !stream->dedicatedClient )
+        jackHostApi->inputBase += inputChannelCount;
 
-    ofs = jackHostApi->outputBase;
+    ofs = stream->dedicatedClient ? 0 : jackHostApi->outputBase;
     for( i = 0; i < outputChannelCount; i++ )
     {
         snprintf( port_string, jack_port_name_size(), "out_%lu", ofs + i );
         UNLESS( stream->local_output_ports[i] = jack_port_register(
-             jackHostApi->jack_client, port_string,
+             stream->jack_client, port_string,
              JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0 ), paInsufficientMemory );
     }
-    jackHostApi->outputBase += outputChannelCount;
+    if( !stream->dedicatedClient )
+        jackHostApi->outputBase += outputChannelCount;
 
     /* look up the jack_port_t's for the remote ports.  We could do
      * this at stream start time, but doing it here ensures the
@@ -1280,37 +1357,80 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
         UNLESS( i == outputChannelCount, paInternalError );
     }
 
-    ENSURE_PA( PaUtil_InitializeBufferProcessor(
-                  &stream->bufferProcessor,
-                  inputChannelCount,
-                  inputSampleFormat,
-                  paFloat32 | paNonInterleaved, /* hostInputSampleFormat */
-                  outputChannelCount,
-                  outputSampleFormat,
-                  paFloat32 | paNonInterleaved, /* hostOutputSampleFormat */
-                  jackSr,
-                  streamFlags,
-                  framesPerBuffer,
-                  0,                            /* Ignored */
-                  paUtilUnknownHostBufferSize,  /* Buffer size may vary on JACK's discretion */
-                  streamCallback,
-                  userData ) );
-    bpInitialized = 1;
+    /* only callback streams get here with a rate JACK isn't running at */
+    stream->convertSampleRate = sampleRate != jackSr && !stream->isBlockingStream
+            && (streamFlags & paConvertSampleRate);
+    if( stream->convertSampleRate )
+    {
+        ENSURE_PA( PaUtil_InitializeResamplingBufferProcessor(
+                      &stream->bufferProcessor,
+                      inputChannelCount,
+                      inputSampleFormat,
+                      paFloat32 | paNonInterleaved, /* hostInputSampleFormat */
+                      outputChannelCount,
+                      outputSampleFormat,
+                      paFloat32 | paNonInterleaved, /* hostOutputSampleFormat */
+                      sampleRate,
+                      jackSr,
+                      streamFlags,
+                      framesPerBuffer,
+                      0,                            /* Ignored */
+                      paUtilUnknownHostBufferSize,  /* Buffer size may vary on JACK's discretion */
+                      streamCallback,
+                      userData ) );
+    }
+    else
+    {
+        /* The buffer processor doesn't know JACK's buffer size, round a batch up to it here */
+        if( (streamFlags & paBatchCallbacks) && framesPerBuffer != paFramesPerBufferUnspecified )
+        {
+            unsigned long jackBufferSize = jack_get_buffer_size( jackHostApi->jack_client );
+            framesPerBuffer = (framesPerBuffer + jackBufferSize - 1) / jackBufferSize * jackBufferSize;
+        }
 
-    if( stream->num_incoming_connections > 0 )
-        stream->streamRepresentation.streamInfo.inputLatency = (jack_port_get_latency( stream->remote_output_ports[0] )
-                - jack_get_buffer_size( jackHostApi->jack_client )  /* One buffer is not counted as latency */
-            + PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
-    if( stream->num_outgoing_connections > 0 )
-        stream->streamRepresentation.streamInfo.outputLatency = (jack_port_get_latency( stream->remote_input_ports[0] )
-                - jack_get_buffer_size( jackHostApi->jack_client )  /* One buffer is not counted as latency */
-            + PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+        ENSURE_PA( PaUtil_InitializeBufferProcessor(
+                      &stream->bufferProcessor,
+                      inputChannelCount,
+                      inputSampleFormat,
+                      paFloat32 | paNonInterleaved, /* hostInputSampleFormat */
+                      outputChannelCount,
+                      outputSampleFormat,
+                      paFloat32 | paNonInterleaved, /* hostOutputSampleFormat */
+                      jackSr,
+                      streamFlags,
+                      framesPerBuffer,
+                      0,                            /* Ignored */
+                      paUtilUnknownHostBufferSize,  /* Buffer size may vary on JACK's discretion */
+                      streamCallback,
+                      userData ) );
+    }
+    bpInitialized = 1;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
+
+    /* A callback taking JACK's own format at JACK's rate and buffer size needs no conversion nor block adaption */
+    stream->canDirectCallback = !stream->isBlockingStream && !stream->convertSampleRate
+            && ( !inputChannelCount || inputSampleFormat == (paFloat32 | paNonInterleaved) )
+            && ( !outputChannelCount || outputSampleFormat == (paFloat32 | paNonInterleaved) );
+
+    if( !stream->convertSampleRate )
+        sampleRate = jackSr;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+    UpdateBufferSize( stream, jack_get_buffer_size( jackHostApi->jack_client ) );
+    PA_DEBUG(( "%s: Direct callback %s\n", __FUNCTION__, stream->directCallback ? "enabled" : "not possible" ));
 
-    stream->streamRepresentation.streamInfo.sampleRate = jackSr;
     stream->t0 = jack_frame_time( jackHostApi->jack_client );   /* A: Time should run from Pa_OpenStream */
 
-    /* Add to queue of opened streams */
-    ENSURE_PA( AddStream( stream ) );
+    /* Add to queue of opened streams, or have the stream's own client process it */
+    if( stream->dedicatedClient )
+        UNLESS( !jack_activate( stream->jack_client ), paUnanticipatedHostError );
+    else
+        ENSURE_PA( AddStream( stream ) );
 
     *s = (PaStream*)stream;
 
@@ -1332,14 +1452,37 @@ static PaError CloseStream( PaStream* s )
     PaError result = paNoError;
     PaJackStream *stream = (PaJackStream*)s;
 
-    /* Remove this stream from the processing queue */
-    ENSURE_PA( RemoveStream( stream ) );
+    /* Remove this stream from the processing queue, a dedicated client is done with it once deactivated */
+    if( stream->dedicatedClient )
+        UNLESS( !jack_deactivate( stream->jack_client ), paUnanticipatedHostError );
+    else
+        ENSURE_PA( RemoveStream( stream ) );
 
 error:
     CleanUpStream( stream, 1, 1 );
     return result;
 }
 
+/* Run the callback of a directCallback stream on the port buffers, in place of the buffer processor. */
+static unsigned long DirectProcess( PaJackStream *stream, jack_nframes_t frames, PaStreamCallbackTimeInfo *timeInfo,
+        PaStreamCallbackFlags cbFlags )
+{
+    int chn;
+
+    for( chn = 0; chn < stream->num_incoming_connections; chn++ )
+        stream->input_buffers[chn] = (jack_default_audio_sample_t*)
+            jack_port_get_buffer( stream->local_input_ports[chn], frames );
+    for( chn = 0; chn < stream->num_outgoing_connections; chn++ )
+        stream->output_buffers[chn] = (jack_default_audio_sample_t*)
+            jack_port_get_buffer( stream->local_output_ports[chn], frames );
+
+    PaUtil_BeginBufferProcessing( &stream->bufferProcessor, timeInfo, cbFlags );
+    return PaUtil_EndBufferProcessingDirectly( &stream->bufferProcessor,
+            stream->num_incoming_connections > 0 ? stream->input_buffers : NULL,
+            stream->num_outgoing_connections > 0 ? stream->output_buffers : NULL,
+            frames, &stream->callbackResult );
+}
+
 static PaError RealProcess( PaJackStream *stream, jack_nframes_t frames )
 {
     PaError result = paNoError;
@@ -1362,7 +1505,7 @@ static PaError RealProcess( PaJackStream *stream, jack_nframes_t frames )
         goto end;
     }
 
-    timeInfo.currentTime = (jack_frame_time( stream->jack_client ) - stream->t0) / sr;
+    timeInfo.currentTime = (GetFrameTime( stream ) - stream->t0) / sr;
     if( stream->num_incoming_connections > 0 )
         timeInfo.inputBufferAdcTime = timeInfo.currentTime - jack_port_get_latency( stream->remote_output_ports[0] )
             / sr;
@@ -1378,6 +1521,20 @@ static PaError RealProcess( PaJackStream *stream, jack_nframes_t frames )
         cbFlags = paOutputUnderflow | paInputOverflow;
         stream->xrun = FALSE;
     }
+    if( stream->hostApi->freewheeling )
+        cbFlags |= paJackFreewheeling;
+
+    /* directCallback follows JACK's buffer size (JackBufSizeCb). Should the buffer processor take over again, the
+     * frames it held from before are played first, a glitch at a buffer size change anyway */
+    if( stream->directCallback && PaUtil_CanBypassBufferProcessor( &stream->bufferProcessor )
+            && ( stream->bufferProcessor.framesPerUserBuffer == paFramesPerBufferUnspecified
+                || frames == stream->bufferProcessor.framesPerUserBuffer ) )
+    {
+        framesProcessed = DirectProcess( stream, frames, &timeInfo, cbFlags );
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+        goto end;
+    }
+
     PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo,
             cbFlags );
 
@@ -1419,81 +1576,80 @@ end:
     return result;
 }
 
-/* Update the JACK callback's stream processing queue. */
-static PaError UpdateQueue( PaJackHostApiRepresentation *hostApi )
+/* Run a stream for a JACK cycle: act on the requests to start or stop it, process it and silence its output once
+ * it stops. Called from the process callback of the client the stream is on. */
+static PaError ProcessStream( PaJackStream *stream, jack_nframes_t frames )
 {
     PaError result = paNoError;
-    int queueModified = 0;
-    const double jackSr = jack_get_sample_rate( hostApi->jack_client );
-    int err;
 
-    if( (err = pthread_mutex_trylock( &hostApi->mtx )) != 0 )
+    /* See if this stream is to be started */
+    if( stream->doStart )
     {
-        assert( err == EBUSY );
-        return paNoError;
-    }
-
-    if( hostApi->toAdd )
-    {
-        if( hostApi->processQueue )
+        /* If we can't obtain a lock, we'll try next time */
+        int err = pthread_mutex_trylock( &stream->hostApi->mtx );
+        if( !err )
         {
-            PaJackStream *node = hostApi->processQueue;
-            /* Advance to end of queue */
-            while( node->next )
-                node = node->next;
+            if( stream->doStart )   /* Could potentially change before obtaining the lock */
+            {
+                stream->is_active = 1;
+                stream->doStart = 0;
+                PA_DEBUG(( "%s: Starting stream\n", __FUNCTION__ ));
+                ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
+                stream->callbackResult = paContinue;
+                stream->isSilenced = 0;
+            }
 
-            node->next = hostApi->toAdd;
+            ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
         }
         else
+            assert( err == EBUSY );
+    }
+    else if( stream->doStop || stream->doAbort )    /* Should we stop/abort stream? */
+    {
+        if( stream->callbackResult == paContinue )     /* Ok, make it stop */
         {
-            /* The only queue entry. */
-            hostApi->processQueue = (PaJackStream *)hostApi->toAdd;
+            PA_DEBUG(( "%s: Stopping stream\n", __FUNCTION__ ));
+            stream->callbackResult = stream->doStop ? paComplete : paAbort;
         }
-
-        /* If necessary, update stream state */
-        if( hostApi->toAdd->streamRepresentation.streamInfo.sampleRate != jackSr )
-            UpdateSampleRate( hostApi->toAdd, jackSr );
-
-        hostApi->toAdd = NULL;
-        queueModified = 1;
     }
-    if( hostApi->toRemove )
+
+    if( stream->is_active )
+        ENSURE_PA( RealProcess( stream, frames ) );
+    /* If we have just entered inactive state, silence output */
+    if( !stream->is_active && !stream->isSilenced )
     {
-        int removed = 0;
-        PaJackStream *node = hostApi->processQueue, *prev = NULL;
-        assert( hostApi->processQueue );
+        int i;
 
-        while( node )
+        /* Silence buffer after entering inactive state */
+        PA_DEBUG(( "Silencing the output\n" ));
+        for( i = 0; i < stream->num_outgoing_connections; ++i )
         {
-            if( node == hostApi->toRemove )
-            {
-                if( prev )
-                    prev->next = node->next;
-                else
-                    hostApi->processQueue = (PaJackStream *)node->next;
-
-                removed = 1;
-                break;
-            }
-
-            prev = node;
-            node = node->next;
+            jack_default_audio_sample_t *buffer = jack_port_get_buffer( stream->local_output_ports[i], frames );
+            memset( buffer, 0, sizeof (jack_default_audio_sample_t) * frames );
         }
-        UNLESS( removed, paInternalError );
-        hostApi->toRemove = NULL;
-        PA_DEBUG(( "%s: Removed stream from processing queue\n", __FUNCTION__ ));
-        queueModified = 1;
+
+        stream->isSilenced = 1;
     }
 
-    if( queueModified )
+    if( stream->doStop || stream->doAbort )
     {
-        /* Signal that we've done what was asked of us */
-        ASSERT_CALL( pthread_cond_signal( &hostApi->cond ), 0 );
+        /* See if RealProcess has acted on the request */
+        if( !stream->is_active )   /* Ok, signal to the main thread that we've carried out the operation */
+        {
+            /* If we can't obtain a lock, we'll try next time */
+            int err = pthread_mutex_trylock( &stream->hostApi->mtx );
+            if( !err )
+            {
+                stream->doStop = stream->doAbort = 0;
+                ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
+                ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
+            }
+            else
+                assert( err == EBUSY );
+        }
     }
 
 error:
-    ASSERT_CALL( pthread_mutex_unlock( &hostApi->mtx ), 0 );
-
     return result;
 }
 
@@ -1508,7 +1664,9 @@ static int JackCallback( jack_nframes_t frames, void *userData )
 
     assert( hostApi );
 
-    ENSURE_PA( UpdateQueue( hostApi ) );
+    /* Let stream removal know the queue is being walked before reading it (SynchronizeProcessQueue) */
+    ++hostApi->processCycles;
+    PaUtil_FullMemoryBarrier();
 
     /* Process each stream */
     stream = hostApi->processQueue;
@@ -1517,77 +1675,15 @@ static int JackCallback( jack_nframes_t frames, void *userData )
         if( xrun )  /* Don't override if already set */
             stream->xrun = 1;
 
-        /* See if this stream is to be started */
-        if( stream->doStart )
-        {
-            /* If we can't obtain a lock, we'll try next time */
-            int err = pthread_mutex_trylock( &stream->hostApi->mtx );
-            if( !err )
-            {
-                if( stream->doStart )   /* Could potentially change before obtaining the lock */
-                {
-                    stream->is_active = 1;
-                    stream->doStart = 0;
-                    PA_DEBUG(( "%s: Starting stream\n", __FUNCTION__ ));
-                    ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
-                    stream->callbackResult = paContinue;
-                    stream->isSilenced = 0;
-                }
-
-                ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
-            }
-            else
-                assert( err == EBUSY );
-        }
-        else if( stream->doStop || stream->doAbort )    /* Should we stop/abort stream? */
-        {
-            if( stream->callbackResult == paContinue )     /* Ok, make it stop */
-            {
-                PA_DEBUG(( "%s: Stopping stream\n", __FUNCTION__ ));
-                stream->callbackResult = stream->doStop ? paComplete : paAbort;
-            }
-        }
-
-        if( stream->is_active )
-            ENSURE_PA( RealProcess( stream, frames ) );
-        /* If we have just entered inactive state, silence output */
-        if( !stream->is_active && !stream->isSilenced )
-        {
-            int i;
-
-            /* Silence buffer after entering inactive state */
-            PA_DEBUG(( "Silencing the output\n" ));
-            for( i = 0; i < stream->num_outgoing_connections; ++i )
-            {
-                jack_default_audio_sample_t *buffer = jack_port_get_buffer( stream->local_output_ports[i], frames );
-                memset( buffer, 0, sizeof (jack_default_audio_sample_t) * frames );
-            }
-
-            stream->isSilenced = 1;
-        }
-
-        if( stream->doStop || stream->doAbort )
-        {
-            /* See if RealProcess has acted on the request */
-            if( !stream->is_active )   /* Ok, signal to the main thread that we've carried out the operation */
-            {
-                /* If we can't obtain a lock, we'll try next time */
-                int err = pthread_mutex_trylock( &stream->hostApi->mtx );
-                if( !err )
-                {
-                    stream->doStop = stream->doAbort = 0;
-                    ASSERT_CALL( pthread_cond_signal( &stream->hostApi->cond ), 0 );
-                    ASSERT_CALL( pthread_mutex_unlock( &stream->hostApi->mtx ), 0 );
-                }
-                else
-                    assert( err == EBUSY );
-            }
-        }
+        ENSURE_PA( ProcessStream( stream, frames ) );
     }
 
-    return 0;
 error:
-    return -1;
+    /* Done with the queue */
+    PaUtil_FullMemoryBarrier();
+    ++hostApi->processCycles;
+
+    return result == paNoError ? 0 : -1;
 }
 
 static PaError StartStream( PaStream *s )
@@ -1623,6 +1719,8 @@ static PaError StartStream( PaStream *s )
     }
 
     stream->xrun = FALSE;
+    if( stream->isBlockingStream )
+        PaUtil_ResetBlockingIO( &stream->blockingIO );
 
     /* Enable processing */
 
@@ -1653,13 +1751,29 @@ error:
     return result;
 }
 
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaJackStream *stream = (PaJackStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
 static PaError RealStop( PaJackStream *stream, int abort )
 {
     PaError result = paNoError;
     int i;
 
-    if( stream->isBlockingStream )
-        BlockingWaitEmpty ( stream );
+    /* Let the callback play what was written, allowing for a second of scheduling delays */
+    if( stream->isBlockingStream && !abort )
+        PaUtil_DrainBlockingIO( &stream->blockingIO,
+                PaUtil_GetBlockingIORingBufferFrames( &stream->blockingIO )
+                / stream->streamRepresentation.streamInfo.sampleRate + 1. );
 
     ASSERT_CALL( pthread_mutex_lock( &stream->hostApi->mtx ), 0 );
     if( abort )
@@ -1678,6 +1792,8 @@ static PaError RealStop( PaJackStream *stream, int abort )
 
 error:
     stream->is_running = FALSE;
+    if( stream->isBlockingStream )
+        PaUtil_StopBlockingIO( &stream->blockingIO );
 
     /* Disconnect ports belonging to this stream */
 
@@ -1730,12 +1846,30 @@ static PaError IsStreamActive( PaStream *s )
 }
 
 
+/* While paused the JACK client stays active and the buffer processor outputs silence
+   instead of calling the callback, so resuming takes effect with the next buffer. */
+static PaError PauseStream( PaStream *s )
+{
+    PaJackStream *stream = (PaJackStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaJackStream *stream = (PaJackStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
 static PaTime GetStreamTime( PaStream *s )
 {
     PaJackStream *stream = (PaJackStream*)s;
 
     /* A: Is this relevant?? --> TODO: what if we're recording-only? */
-    return (jack_frame_time( stream->jack_client ) - stream->t0) / (PaTime)jack_get_sample_rate( stream->jack_client );
+    return (GetFrameTime( stream ) - stream->t0) / (PaTime)jack_get_sample_rate( stream->jack_client );
 }
 
 
@@ -1745,6 +1879,24 @@ static double GetStreamCpuLoad( PaStream* s )
     return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
 }
 
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaJackStream *stream = (PaJackStream*)s;
+    return (signed long)sizeof(PaJackStream)
+            + PaUtil_GetAllocationGroupMemoryUsage( stream->stream_memory )
+            + PaUtil_GetBlockingIOMemoryUsage( &stream->blockingIO )
+            + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+}
+
+void PaJack_InitializeStreamInfo( PaJackStreamInfo *info )
+{
+    info->size = sizeof (PaJackStreamInfo);
+    info->hostApiType = paJACK;
+    info->version = 1;
+    info->flags = 0;
+    info->clientName = NULL;
+}
+
 PaError PaJack_SetClientName( const char* name )
 {
     if( strlen( name ) > jack_client_name_size() )
@@ -1767,3 +1919,49 @@ PaError PaJack_GetClientName(const char** clientName)
 error:
     return result;
 }
+
+static PaError GetJackStreamPointer( PaStream *s, PaJackStream **stream )
+{
+    PaError result = paNoError;
+    PaJackHostApiRepresentation* jackHostApi = NULL;
+    PaJackHostApiRepresentation** ref = &jackHostApi;
+
+    ENSURE_PA( PaUtil_ValidateStreamPointer( s ) );
+    ENSURE_PA( PaUtil_GetHostApiRepresentation( (PaUtilHostApiRepresentation**)ref, paJACK ) );
+    UNLESS( PA_STREAM_REP( s )->streamInterface == &jackHostApi->callbackStreamInterface
+            || PA_STREAM_REP( s )->streamInterface == &jackHostApi->blockingStreamInterface,
+            paIncompatibleStreamHostApi );
+
+    *stream = (PaJackStream*)s;
+
+error:
+    return result;
+}
+
+PaError PaJack_SetLowWatermark( PaStream *s, unsigned long frames )
+{
+    PaError result = paNoError;
+    PaJackStream *stream;
+
+    ENSURE_PA( GetJackStreamPointer( s, &stream ) );
+    UNLESS( stream->isBlockingStream, paCanNotReadFromACallbackStream );
+    PaUtil_SetBlockingIOWakeupFrames( &stream->blockingIO, frames );
+
+error:
+    return result;
+}
+
+signed long PaJack_ReadStreamAvailable( PaStream *s, void *buffer, unsigned long frames )
+{
+    PaError result = paNoError;
+    PaJackStream *stream;
+
+    ENSURE_PA( GetJackStreamPointer( s, &stream ) );
+    UNLESS( stream->isBlockingStream, paCanNotReadFromACallbackStream );
+    UNLESS( stream->local_input_ports, paCanNotReadFromAnOutputOnlyStream );
+
+    return (signed long)PaUtil_ReadBlockingIOAvailable( &stream->blockingIO, buffer, frames );
+
+error:
+    return result;
+}
@@ -0,0 +1,1457 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library null / loopback host API implementation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Ross Bencina, Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup unix_src
+
+ @brief Null host API with a clock driven callback thread and a loopback device.
+
+ This host API talks to no audio hardware at all. Its devices are driven by
+ the system clock, so pa_front.c, the buffer processor and the sample
+ converters can be exercised and timed end-to-end on machines without a
+ sound card, e.g. in continuous integration.
+
+ Two devices are provided:
+ - "Null Device" delivers silence on input and discards its output.
+ - "Loopback Device" feeds everything written to its output back to its
+   input, delayed by the fake device latency. A full-duplex stream on it,
+   or one output and one input stream, can be used for round trip tests.
+   Only one stream may write to and one stream may read from it at a time.
+
+ The host side of every stream is interleaved, with PA_NULL_MAX_CHANNELS_
+ channels per frame in the host sample format; streams with fewer channels
+ use the first ones, the others carry silence.
+
+ Configuration is read from the environment at Pa_Initialize():
+ - PA_NULL_LATENCY_MSEC: fake device latency in milliseconds (default 10).
+   It is added to the reported stream latencies and time stamps, and is
+   the delay of the loopback device.
+ - PA_NULL_PERIOD_FRAMES: host buffer size in frames, overriding the one
+   derived from framesPerBuffer or the suggested latency.
+ - PA_NULL_FREERUN: if nonzero, don't wait for the clock but process
+   buffers as fast as possible, for throughput benchmarks.
+ - PA_NULL_HOST_FORMAT: host sample format, one of float64, float32,
+   int32, int24, int24in32, int16 (default), int8 or uint8.
+
+ Streams may also be rendered offline from and to buffers or files, as fast
+ as their callback returns, see paNullOffline in pa_null.h. The host side of
+ an offline stream has the sample format and channels of the stream, so that
+ it is the data read or written.
+*/
+
+
+#include <string.h> /* strlen() */
+#include <stdlib.h> /* getenv() */
+#include <stdio.h>  /* fopen() */
+#include <errno.h>
+#include <time.h>   /* nanosleep() */
+#include <assert.h>
+#include <pthread.h>
+
+#include "pa_util.h"
+#include "pa_unix_util.h"
+#include "pa_allocation.h"
+#include "pa_hostapi.h"
+#include "pa_stream.h"
+#include "pa_cpuload.h"
+#include "pa_process.h"
+#include "pa_probes.h"
+#include "pa_ringbuffer.h"
+#include "pa_debugprint.h"
+#include "pa_null.h"
+
+
+/* prototypes for functions declared in this file */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+PaError PaNull_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate );
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData );
+static PaError CloseStream( PaStream* stream );
+static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
+static PaError StopStream( PaStream *stream );
+static PaError AbortStream( PaStream *stream );
+static PaError IsStreamStopped( PaStream *s );
+static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaError ProcessStream( PaStream *stream, double timeoutSeconds );
+static PaTime GetStreamTime( PaStream *stream );
+static double GetStreamCpuLoad( PaStream* stream );
+static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
+static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static signed long GetStreamReadAvailable( PaStream* stream );
+static signed long GetStreamWriteAvailable( PaStream* stream );
+static signed long GetStreamMemoryUsage( PaStream* stream );
+
+
+/** Maximum number of channels of every device, also the number of channels of a host frame */
+#define PA_NULL_MAX_CHANNELS_ (8)
+/** Default sample rate reported for the devices */
+#define PA_NULL_DEFAULT_SAMPLE_RATE_ (48000.)
+/** Default fake device latency in milliseconds */
+#define PA_NULL_DEFAULT_LATENCY_MSEC_ (10.)
+/** Capacity of the loopback device in frames, must be a power of 2 */
+#define PA_NULL_LOOPBACK_FRAMES_ (32768)
+/** Smallest host buffer size derived from a suggested latency */
+#define PA_NULL_MIN_PERIOD_FRAMES_ (16)
+
+/** Device indices within this host API */
+enum
+{
+    PA_NULL_DEVICE_ = 0,
+    PA_NULL_LOOPBACK_DEVICE_,
+    PA_NULL_DEVICE_COUNT_
+};
+
+/* PaNullHostApiRepresentation - host api datastructure specific to this implementation */
+
+typedef struct
+{
+    PaUtilHostApiRepresentation inheritedHostApiRep;
+    PaUtilStreamInterface callbackStreamInterface;
+    PaUtilStreamInterface blockingStreamInterface;
+
+    PaUtilAllocationGroup *allocations;
+
+    /** Sample format of the host side of all streams */
+    PaSampleFormat hostSampleFormat;
+    /** Size of a host frame (PA_NULL_MAX_CHANNELS_ samples) in bytes */
+    int bytesPerHostFrame;
+    /** Fake device latency in seconds */
+    PaTime latency;
+    /** Host buffer size forced from the environment, 0 if not set */
+    unsigned long periodFrames;
+    /** Don't wait for the clock, process as fast as possible */
+    int freeRun;
+
+    /** Frames written to the loopback device, waiting to be read back */
+    PaUtilRingBuffer loopback;
+}
+PaNullHostApiRepresentation;
+
+
+/* PaNullStream - a stream data structure specifically for this implementation */
+
+typedef struct PaNullStream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaUtilBufferProcessor bufferProcessor;
+
+    PaNullHostApiRepresentation *nullHostApi;
+
+    int inputChannelCount;
+    int outputChannelCount;
+    /** Does the input / output side use the loopback device? */
+    int inputLoopback;
+    int outputLoopback;
+    /** Host buffers, interleaved with PA_NULL_MAX_CHANNELS_ channels in the host sample format,
+        or in the format of the stream for offline streams */
+    unsigned char *hostInputBuffer;
+    unsigned char *hostOutputBuffer;
+    int inputHostChannels;
+    int outputHostChannels;
+    int inputBytesPerHostFrame;
+    int outputBytesPerHostFrame;
+    unsigned long framesPerHostBuffer;
+    /** Fake device latency in frames */
+    unsigned long latencyFrames;
+    double sampleRate;
+    int callbackMode;
+    int freeRun;
+
+    /** Rendered offline (paNullOffline)? */
+    int offline;
+    /** The buffers or files an offline stream reads from and writes to, and the frames read and written */
+    const unsigned char *offlineInput;
+    unsigned long offlineInputFrames;
+    unsigned char *offlineOutput;
+    unsigned long offlineOutputFrames;
+    FILE *inputFile;
+    FILE *outputFile;
+    unsigned long offlineFramesRead;
+    unsigned long offlineFramesWritten;
+    /** Frames an offline callback stream has rendered since it started, its timeline */
+    double framesRendered;
+
+    /** Time the clock of the stream started at */
+    PaTime startTime;
+    /** Frames transferred by the blocking interface since the stream started */
+    double framesRead;
+    double framesWritten;
+
+    PaUnixThread thread;
+    volatile sig_atomic_t isActive;
+    volatile sig_atomic_t isStopped;
+    /** Set when the thread ends through the callback return value rather than Stop/AbortStream */
+    volatile sig_atomic_t callbackFinished;
+
+    /** Processed by Pa_ProcessStream() rather than a thread (paManualProcessing)? */
+    int manualProcessing;
+    /** The callback thread's state for Pa_ProcessStream(): the callback's last return value
+        and the time of the next period */
+    int manualCallbackResult;
+    PaTime manualNextTime;
+}
+PaNullStream;
+
+
+/** Read a numeric setting from the environment, def if it isn't set. */
+static double PaNull_GetEnvNumber( const char *name, double def )
+{
+    const char *value = getenv( name );
+
+    if( value && *value )
+        return atof( value );
+    return def;
+}
+
+
+/** Map the PA_NULL_HOST_FORMAT setting to a sample format. */
+static PaSampleFormat PaNull_GetEnvHostFormat( void )
+{
+    const char *value = getenv( "PA_NULL_HOST_FORMAT" );
+
+    if( !value || !*value )
+        return paInt16;
+    if( !strcmp( value, "float32" ) )
+        return paFloat32;
+    if( !strcmp( value, "float64" ) )
+        return paFloat64;
+    if( !strcmp( value, "int32" ) )
+        return paInt32;
+    if( !strcmp( value, "int24" ) )
+        return paInt24;
+    if( !strcmp( value, "int24in32" ) )
+        return paInt24In32;
+    if( !strcmp( value, "int8" ) )
+        return paInt8;
+    if( !strcmp( value, "uint8" ) )
+        return paUInt8;
+    if( strcmp( value, "int16" ) )
+    {
+        PA_DEBUG(( "%s: unknown host format '%s', using int16\n", __FUNCTION__, value ));
+    }
+    return paInt16;
+}
+
+
+PaError PaNull_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    int i;
+    PaNullHostApiRepresentation *nullHostApi;
+    PaDeviceInfo *deviceInfoArray;
+    void *loopbackData;
+    static const char *deviceNames[PA_NULL_DEVICE_COUNT_] = { "Null Device", "Loopback Device" };
+
+    nullHostApi = (PaNullHostApiRepresentation*)PaUtil_AllocateMemory( sizeof(PaNullHostApiRepresentation) );
+    if( !nullHostApi )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    nullHostApi->allocations = PaUtil_CreateAllocationGroup();
+    if( !nullHostApi->allocations )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    nullHostApi->hostSampleFormat = PaNull_GetEnvHostFormat();
+    nullHostApi->bytesPerHostFrame = PA_NULL_MAX_CHANNELS_ * Pa_GetSampleSize( nullHostApi->hostSampleFormat );
+    nullHostApi->latency = PaNull_GetEnvNumber( "PA_NULL_LATENCY_MSEC", PA_NULL_DEFAULT_LATENCY_MSEC_ ) / 1000.;
+    if( nullHostApi->latency < 0. )
+        nullHostApi->latency = 0.;
+    nullHostApi->periodFrames = (unsigned long)PaNull_GetEnvNumber( "PA_NULL_PERIOD_FRAMES", 0. );
+    nullHostApi->freeRun = PaNull_GetEnvNumber( "PA_NULL_FREERUN", 0. ) != 0.;
+
+    loopbackData = PaUtil_GroupAllocateMemory( nullHostApi->allocations,
+            (long)nullHostApi->bytesPerHostFrame * PA_NULL_LOOPBACK_FRAMES_ );
+    if( !loopbackData )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+    if( PaUtil_InitializeRingBuffer( &nullHostApi->loopback, nullHostApi->bytesPerHostFrame,
+                PA_NULL_LOOPBACK_FRAMES_, loopbackData ) != 0 )
+    {
+        result = paInternalError;
+        goto error;
+    }
+
+    *hostApi = &nullHostApi->inheritedHostApiRep;
+    (*hostApi)->info.structVersion = 1;
+    (*hostApi)->info.type = paInDevelopment;
+    (*hostApi)->info.name = "Null";
+
+    (*hostApi)->info.defaultInputDevice = PA_NULL_DEVICE_;
+    (*hostApi)->info.defaultOutputDevice = PA_NULL_DEVICE_;
+
+    (*hostApi)->info.deviceCount = 0;
+
+    (*hostApi)->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory(
+            nullHostApi->allocations, sizeof(PaDeviceInfo*) * PA_NULL_DEVICE_COUNT_ );
+    if( !(*hostApi)->deviceInfos )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    /* allocate all device info structs in a contiguous block */
+    deviceInfoArray = (PaDeviceInfo*)PaUtil_GroupAllocateMemory(
+            nullHostApi->allocations, sizeof(PaDeviceInfo) * PA_NULL_DEVICE_COUNT_ );
+    if( !deviceInfoArray )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    for( i=0; i < PA_NULL_DEVICE_COUNT_; ++i )
+    {
+        PaDeviceInfo *deviceInfo = &deviceInfoArray[i];
+        memset( deviceInfo, 0, sizeof(PaDeviceInfo) );
+        deviceInfo->structVersion = 2;
+        deviceInfo->hostApi = hostApiIndex;
+        deviceInfo->name = deviceNames[i];
+
+        deviceInfo->maxInputChannels = PA_NULL_MAX_CHANNELS_;
+        deviceInfo->maxOutputChannels = PA_NULL_MAX_CHANNELS_;
+
+        deviceInfo->defaultLowInputLatency = nullHostApi->latency;
+        deviceInfo->defaultLowOutputLatency = nullHostApi->latency;
+        deviceInfo->defaultHighInputLatency = 4 * nullHostApi->latency;
+        deviceInfo->defaultHighOutputLatency = 4 * nullHostApi->latency;
+
+        deviceInfo->defaultSampleRate = PA_NULL_DEFAULT_SAMPLE_RATE_;
+
+        (*hostApi)->deviceInfos[i] = deviceInfo;
+        ++(*hostApi)->info.deviceCount;
+    }
+
+    (*hostApi)->Terminate = Terminate;
+    (*hostApi)->OpenStream = OpenStream;
+    (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
+
+    PaUtil_InitializeStreamInterface( &nullHostApi->callbackStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, GetStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable, PaUtil_DummyGetWriteAvailable );
+    nullHostApi->callbackStreamInterface.Pause = PauseStream;
+    nullHostApi->callbackStreamInterface.Resume = ResumeStream;
+    nullHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+    nullHostApi->callbackStreamInterface.Process = ProcessStream;
+
+    PaUtil_InitializeStreamInterface( &nullHostApi->blockingStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, PaUtil_DummyGetCpuLoad,
+                                      ReadStream, WriteStream, GetStreamReadAvailable, GetStreamWriteAvailable );
+
+    PA_DEBUG(( "%s: latency %.1f ms, period %lu frames, free run %d\n", __FUNCTION__,
+               nullHostApi->latency * 1000., nullHostApi->periodFrames, nullHostApi->freeRun ));
+
+    PA_ENSURE( PaUnixThreading_Initialize() );
+
+    return result;
+
+error:
+    if( nullHostApi )
+    {
+        if( nullHostApi->allocations )
+        {
+            PaUtil_FreeAllAllocations( nullHostApi->allocations );
+            PaUtil_DestroyAllocationGroup( nullHostApi->allocations );
+        }
+
+        PaUtil_FreeMemory( nullHostApi );
+    }
+    return result;
+}
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
+{
+    PaNullHostApiRepresentation *nullHostApi = (PaNullHostApiRepresentation*)hostApi;
+
+    if( nullHostApi->allocations )
+    {
+        PaUtil_FreeAllAllocations( nullHostApi->allocations );
+        PaUtil_DestroyAllocationGroup( nullHostApi->allocations );
+    }
+
+    PaUtil_FreeMemory( nullHostApi );
+
+    PaUnixThreading_Terminate();
+}
+
+
+/** Checks common to IsFormatSupported and OpenStream for one direction of a stream. */
+static PaError PaNull_ValidateParameters( struct PaUtilHostApiRepresentation *hostApi,
+                                          const PaStreamParameters *parameters, int isInput )
+{
+    const PaDeviceInfo *deviceInfo;
+
+    /* all standard sample formats are supported by the buffer adapter,
+        this implementation doesn't support any custom sample formats */
+    if( parameters->sampleFormat & paCustomFormat )
+        return paSampleFormatNotSupported;
+
+    /* alternate device specification isn't supported */
+    if( parameters->device == paUseHostApiSpecificDeviceSpecification )
+        return paInvalidDevice;
+
+    deviceInfo = hostApi->deviceInfos[ parameters->device ];
+    if( parameters->channelCount > (isInput ? deviceInfo->maxInputChannels : deviceInfo->maxOutputChannels) )
+        return paInvalidChannelCount;
+
+    if( parameters->hostApiSpecificStreamInfo )
+    {
+        const PaNullStreamInfo *streamInfo = (const PaNullStreamInfo*)parameters->hostApiSpecificStreamInfo;
+
+        if( streamInfo->size != sizeof(PaNullStreamInfo) || streamInfo->version != 1
+                || (streamInfo->flags & ~paNullOffline) || (streamInfo->buffer && streamInfo->fileName) )
+            return paIncompatibleHostApiSpecificStreamInfo;
+    }
+
+    return paNoError;
+}
+
+
+/** The offline rendering asked for by one direction of a stream. */
+static int PaNull_IsOffline( const PaStreamParameters *parameters )
+{
+    const PaNullStreamInfo *streamInfo = parameters ? (const PaNullStreamInfo*)parameters->hostApiSpecificStreamInfo : NULL;
+
+    return streamInfo && (streamInfo->flags & paNullOffline);
+}
+
+
+/** Set up the buffer or the file an offline stream reads from (isInput) or writes to. */
+static PaError PaNull_OpenOfflineData( PaNullStream *stream, const PaStreamParameters *parameters, int isInput )
+{
+    const PaNullStreamInfo *streamInfo = (const PaNullStreamInfo*)parameters->hostApiSpecificStreamInfo;
+    FILE *file;
+
+    if( !streamInfo )
+        return paNoError;
+
+    if( streamInfo->fileName )
+    {
+        file = fopen( streamInfo->fileName, isInput ? "rb" : "wb" );
+        if( !file )
+        {
+            PaUtil_SetLastHostErrorInfo( paInDevelopment, errno, "Couldn't open the file of an offline stream" );
+            return paUnanticipatedHostError;
+        }
+        if( isInput )
+            stream->inputFile = file;
+        else
+            stream->outputFile = file;
+    }
+    else if( isInput )
+    {
+        stream->offlineInput = (const unsigned char*)streamInfo->buffer;
+        stream->offlineInputFrames = streamInfo->buffer ? streamInfo->bufferFrames : 0;
+    }
+    else
+    {
+        stream->offlineOutput = (unsigned char*)streamInfo->buffer;
+        stream->offlineOutputFrames = streamInfo->buffer ? streamInfo->bufferFrames : 0;
+    }
+
+    return paNoError;
+}
+
+
+/** Close the files of an offline stream. */
+static void PaNull_CloseOfflineData( PaNullStream *stream )
+{
+    if( stream->inputFile )
+        fclose( stream->inputFile );
+    if( stream->outputFile )
+        fclose( stream->outputFile );
+    stream->inputFile = stream->outputFile = NULL;
+}
+
+
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate )
+{
+    PaError result;
+
+    if( inputParameters )
+    {
+        result = PaNull_ValidateParameters( hostApi, inputParameters, 1 );
+        if( result != paNoError )
+            return result;
+    }
+
+    if( outputParameters )
+    {
+        result = PaNull_ValidateParameters( hostApi, outputParameters, 0 );
+        if( result != paNoError )
+            return result;
+    }
+
+    /* the clock runs at any rate pa_front lets through */
+    (void) sampleRate;
+
+    return paFormatIsSupported;
+}
+
+
+/* see pa_hostapi.h for a list of validity guarantees made about OpenStream parameters */
+
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData )
+{
+    PaError result = paNoError;
+    PaNullHostApiRepresentation *nullHostApi = (PaNullHostApiRepresentation*)hostApi;
+    PaNullStream *stream = 0;
+    unsigned long framesPerHostBuffer;
+    unsigned long hostBufferBytes;
+    int inputChannelCount, outputChannelCount;
+    PaSampleFormat inputSampleFormat, outputSampleFormat;
+    PaSampleFormat hostInputSampleFormat, hostOutputSampleFormat;
+    PaTime suggestedLatency = 0.;
+
+    if( inputParameters )
+    {
+        result = PaNull_ValidateParameters( hostApi, inputParameters, 1 );
+        if( result != paNoError )
+            return result;
+
+        inputChannelCount = inputParameters->channelCount;
+        inputSampleFormat = inputParameters->sampleFormat;
+        hostInputSampleFormat = nullHostApi->hostSampleFormat;
+        suggestedLatency = inputParameters->suggestedLatency;
+    }
+    else
+    {
+        inputChannelCount = 0;
+        inputSampleFormat = hostInputSampleFormat = paInt16; /* Surpress 'uninitialised var' warnings. */
+    }
+
+    if( outputParameters )
+    {
+        result = PaNull_ValidateParameters( hostApi, outputParameters, 0 );
+        if( result != paNoError )
+            return result;
+
+        outputChannelCount = outputParameters->channelCount;
+        outputSampleFormat = outputParameters->sampleFormat;
+        hostOutputSampleFormat = nullHostApi->hostSampleFormat;
+        suggestedLatency = PA_MAX( suggestedLatency, outputParameters->suggestedLatency );
+    }
+    else
+    {
+        outputChannelCount = 0;
+        outputSampleFormat = hostOutputSampleFormat = paInt16; /* Surpress 'uninitialized var' warnings. */
+    }
+
+    /* validate platform specific flags */
+    if( (streamFlags & paPlatformSpecificFlags) != 0 )
+        return paInvalidFlag; /* unexpected platform specific flag */
+
+    /* The host buffer size is the period of the clock: forced from the environment,
+        else the callback buffer size, unless the callbacks are batched, else half the
+        suggested latency (double buffering) */
+    if( nullHostApi->periodFrames > 0 )
+        framesPerHostBuffer = nullHostApi->periodFrames;
+    else if( framesPerBuffer != paFramesPerBufferUnspecified && !(streamFlags & paBatchCallbacks) )
+        framesPerHostBuffer = framesPerBuffer;
+    else
+        framesPerHostBuffer = (unsigned long)(suggestedLatency * sampleRate / 2);
+    if( framesPerHostBuffer < PA_NULL_MIN_PERIOD_FRAMES_ )
+        framesPerHostBuffer = PA_NULL_MIN_PERIOD_FRAMES_;
+    if( framesPerHostBuffer > PA_NULL_LOOPBACK_FRAMES_ / 4 )
+        framesPerHostBuffer = PA_NULL_LOOPBACK_FRAMES_ / 4;
+
+    stream = (PaNullStream*)PaUtil_AllocateMemory( sizeof(PaNullStream) );
+    if( !stream )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+    memset( stream, 0, sizeof(PaNullStream) );
+
+    stream->nullHostApi = nullHostApi;
+    stream->inputChannelCount = inputChannelCount;
+    stream->outputChannelCount = outputChannelCount;
+    stream->offline = PaNull_IsOffline( inputParameters ) || PaNull_IsOffline( outputParameters );
+    stream->inputLoopback = !stream->offline && inputParameters && inputParameters->device == PA_NULL_LOOPBACK_DEVICE_;
+    stream->outputLoopback = !stream->offline && outputParameters && outputParameters->device == PA_NULL_LOOPBACK_DEVICE_;
+    stream->framesPerHostBuffer = framesPerHostBuffer;
+    stream->sampleRate = sampleRate;
+    stream->freeRun = nullHostApi->freeRun || stream->offline;
+    stream->manualProcessing = streamCallback && (streamFlags & paManualProcessing);
+    stream->latencyFrames = stream->offline ? 0 : (unsigned long)(nullHostApi->latency * sampleRate);
+    /* the loopback device must be able to hold the delayed frames plus a couple of periods */
+    if( stream->latencyFrames > PA_NULL_LOOPBACK_FRAMES_ / 2 )
+        stream->latencyFrames = PA_NULL_LOOPBACK_FRAMES_ / 2;
+    stream->isStopped = 1;
+
+    /* the host side of an offline stream is its data: the channels of the stream in its sample format */
+    if( stream->offline )
+    {
+        hostInputSampleFormat = inputSampleFormat & ~paNonInterleaved;
+        hostOutputSampleFormat = outputSampleFormat & ~paNonInterleaved;
+        stream->inputHostChannels = inputChannelCount;
+        stream->outputHostChannels = outputChannelCount;
+        if( inputParameters && (result = PaNull_OpenOfflineData( stream, inputParameters, 1 )) != paNoError )
+            goto error;
+        if( outputParameters && (result = PaNull_OpenOfflineData( stream, outputParameters, 0 )) != paNoError )
+            goto error;
+    }
+    else
+    {
+        stream->inputHostChannels = stream->outputHostChannels = PA_NULL_MAX_CHANNELS_;
+    }
+    stream->inputBytesPerHostFrame = stream->inputHostChannels * Pa_GetSampleSize( hostInputSampleFormat );
+    stream->outputBytesPerHostFrame = stream->outputHostChannels * Pa_GetSampleSize( hostOutputSampleFormat );
+
+    /* unused host channels are never touched by the buffer processor, so they stay silent */
+    if( inputParameters )
+    {
+        hostBufferBytes = framesPerHostBuffer * stream->inputBytesPerHostFrame;
+        stream->hostInputBuffer = (unsigned char*)PaUtil_AllocateMemory( hostBufferBytes );
+        if( !stream->hostInputBuffer )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+        memset( stream->hostInputBuffer, 0, hostBufferBytes );
+    }
+    if( outputParameters )
+    {
+        hostBufferBytes = framesPerHostBuffer * stream->outputBytesPerHostFrame;
+        stream->hostOutputBuffer = (unsigned char*)PaUtil_AllocateMemory( hostBufferBytes );
+        if( !stream->hostOutputBuffer )
+        {
+            result = paInsufficientMemory;
+            goto error;
+        }
+        memset( stream->hostOutputBuffer, 0, hostBufferBytes );
+    }
+
+    if( streamCallback )
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &nullHostApi->callbackStreamInterface, streamCallback, userData );
+        stream->callbackMode = 1;
+    }
+    else
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &nullHostApi->blockingStreamInterface, streamCallback, userData );
+    }
+
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+
+    /* the clock always delivers full periods to the callback, the blocking interface
+        transfers whatever fits */
+    result =  PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
+              inputChannelCount, inputSampleFormat, hostInputSampleFormat,
+              outputChannelCount, outputSampleFormat, hostOutputSampleFormat,
+              sampleRate, streamFlags, PaUtil_GetBatchedFramesPerUserBuffer( streamFlags, framesPerBuffer, framesPerHostBuffer ),
+              framesPerHostBuffer, streamCallback ? paUtilFixedHostBufferSize : paUtilBoundedHostBufferSize,
+              streamCallback, userData );
+    if( result != paNoError )
+        goto error;
+
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    /* the clock interpolates in real time, offline streams aren't rendered in it */
+    if( !stream->offline )
+        stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
+
+    stream->streamRepresentation.streamInfo.inputLatency = inputParameters ?
+            (PaTime)(PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )
+                    + framesPerHostBuffer + stream->latencyFrames) / sampleRate : 0.;
+    stream->streamRepresentation.streamInfo.outputLatency = outputParameters ?
+            (PaTime)(PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )
+                    + framesPerHostBuffer + stream->latencyFrames) / sampleRate : 0.;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+
+    *s = (PaStream*)stream;
+
+    return result;
+
+error:
+    if( stream )
+    {
+        PaNull_CloseOfflineData( stream );
+        PaUtil_FreeMemory( stream->hostInputBuffer );
+        PaUtil_FreeMemory( stream->hostOutputBuffer );
+        PaUtil_FreeMemory( stream );
+    }
+
+    return result;
+}
+
+
+/** Sleep until the given PaUtil_GetTime() time. */
+static void PaNull_SleepUntil( PaTime deadline )
+{
+    PaTime delay;
+
+    while( (delay = deadline - PaUtil_GetTime()) > 0. )
+    {
+        struct timespec ts;
+        ts.tv_sec = (time_t)delay;
+        ts.tv_nsec = (long)((delay - ts.tv_sec) * 1e9);
+        nanosleep( &ts, NULL );
+    }
+}
+
+
+/** Frames the clock of the stream has played or recorded since the stream started. */
+static double PaNull_GetClockFrames( PaNullStream *stream )
+{
+    return (PaUtil_GetTime() - stream->startTime) * stream->sampleRate;
+}
+
+
+/** Register the host buffers with the buffer processor.
+ A host frame may have more channels than the stream, so each stream channel is
+ registered separately with the stride of a host frame.
+ */
+static void PaNull_SetHostChannels( PaNullStream *stream, unsigned long frames )
+{
+    int i;
+    unsigned int bytesPerSample;
+
+    if( stream->hostInputBuffer )
+    {
+        bytesPerSample = stream->inputBytesPerHostFrame / stream->inputHostChannels;
+        PaUtil_SetInputFrameCount( &stream->bufferProcessor, frames );
+        for( i = 0; i < stream->inputChannelCount; ++i )
+            PaUtil_SetInputChannel( &stream->bufferProcessor, i,
+                    stream->hostInputBuffer + i * bytesPerSample, stream->inputHostChannels );
+    }
+    if( stream->hostOutputBuffer )
+    {
+        bytesPerSample = stream->outputBytesPerHostFrame / stream->outputHostChannels;
+        PaUtil_SetOutputFrameCount( &stream->bufferProcessor, frames );
+        for( i = 0; i < stream->outputChannelCount; ++i )
+            PaUtil_SetOutputChannel( &stream->bufferProcessor, i,
+                    stream->hostOutputBuffer + i * bytesPerSample, stream->outputHostChannels );
+    }
+}
+
+
+/** Fill the host input buffer from the loopback device.
+ Missing frames are replaced with silence.
+
+ @return The number of frames that were available.
+ */
+static unsigned long PaNull_ReadLoopback( PaNullStream *stream, unsigned long frames )
+{
+    int bytesPerHostFrame = stream->nullHostApi->bytesPerHostFrame;
+    unsigned long got;
+
+    got = (unsigned long)PaUtil_ReadRingBuffer( &stream->nullHostApi->loopback,
+            stream->hostInputBuffer, (ring_buffer_size_t)frames );
+    if( got < frames )
+        memset( stream->hostInputBuffer + got * bytesPerHostFrame, 0, (frames - got) * bytesPerHostFrame );
+    return got;
+}
+
+
+/** Queue the host output buffer on the loopback device, dropping what doesn't fit. */
+static void PaNull_WriteLoopback( PaNullStream *stream, unsigned long frames )
+{
+    PaUtil_WriteRingBuffer( &stream->nullHostApi->loopback, stream->hostOutputBuffer,
+            (ring_buffer_size_t)frames );
+}
+
+
+/** Reset the loopback device to hold just the fake latency worth of silence. */
+static void PaNull_PrimeLoopback( PaNullStream *stream )
+{
+    PaUtilRingBuffer *loopback = &stream->nullHostApi->loopback;
+    void *data1, *data2;
+    ring_buffer_size_t size1, size2;
+    int bytesPerHostFrame = stream->nullHostApi->bytesPerHostFrame;
+
+    PaUtil_FlushRingBuffer( loopback );
+    PaUtil_GetRingBufferWriteRegions( loopback, (ring_buffer_size_t)stream->latencyFrames,
+            &data1, &size1, &data2, &size2 );
+    memset( data1, 0, size1 * bytesPerHostFrame );
+    if( size2 > 0 )
+        memset( data2, 0, size2 * bytesPerHostFrame );
+    PaUtil_AdvanceRingBufferWriteIndex( loopback, size1 + size2 );
+}
+
+
+/** Fill the host input buffer of an offline stream from its buffer or file.
+ Frames past their end are replaced with silence, as is all input without either.
+
+ @return The number of frames read.
+ */
+static unsigned long PaNull_ReadOffline( PaNullStream *stream, unsigned long frames )
+{
+    int bytesPerHostFrame = stream->inputBytesPerHostFrame;
+    unsigned long got = 0;
+
+    if( stream->inputFile )
+    {
+        got = (unsigned long)fread( stream->hostInputBuffer, bytesPerHostFrame, frames, stream->inputFile );
+    }
+    else if( stream->offlineInput )
+    {
+        got = PA_MIN( frames, stream->offlineInputFrames - stream->offlineFramesRead );
+        memcpy( stream->hostInputBuffer, stream->offlineInput + stream->offlineFramesRead * bytesPerHostFrame,
+                got * bytesPerHostFrame );
+    }
+    else
+    {
+        got = frames;
+        memset( stream->hostInputBuffer, 0, frames * bytesPerHostFrame );
+    }
+
+    if( got < frames )
+        memset( stream->hostInputBuffer + got * bytesPerHostFrame, 0, (frames - got) * bytesPerHostFrame );
+    stream->offlineFramesRead += got;
+    return got;
+}
+
+
+/** Write the host output buffer of an offline stream to its buffer or file, dropping what doesn't fit.
+ Output without either is discarded.
+
+ @return The number of frames written.
+ */
+static unsigned long PaNull_WriteOffline( PaNullStream *stream, unsigned long frames )
+{
+    int bytesPerHostFrame = stream->outputBytesPerHostFrame;
+    unsigned long put = frames;
+
+    if( stream->outputFile )
+    {
+        put = (unsigned long)fwrite( stream->hostOutputBuffer, bytesPerHostFrame, frames, stream->outputFile );
+    }
+    else if( stream->offlineOutput )
+    {
+        put = PA_MIN( frames, stream->offlineOutputFrames - stream->offlineFramesWritten );
+        memcpy( stream->offlineOutput + stream->offlineFramesWritten * bytesPerHostFrame, stream->hostOutputBuffer,
+                put * bytesPerHostFrame );
+    }
+
+    stream->offlineFramesWritten += put;
+    return put;
+}
+
+
+/** Run one period of a callback stream through the buffer processor. */
+static void PaNull_ProcessBuffer( PaNullStream *stream, PaStreamCallbackFlags cbFlags, int *callbackResult )
+{
+    PaStreamCallbackTimeInfo timeInfo;
+    unsigned long frames = stream->framesPerHostBuffer;
+    unsigned long framesProcessed;
+
+    PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+    int endOfData = 0;
+
+    if( stream->inputLoopback && PaNull_ReadLoopback( stream, frames ) < frames && stream->hostOutputBuffer )
+        cbFlags |= paInputUnderflow;
+    if( stream->offline && stream->hostInputBuffer )
+        endOfData = PaNull_ReadOffline( stream, frames ) < frames;
+
+    /* an offline stream runs on the timeline of the frames it rendered */
+    timeInfo.currentTime = stream->offline ? stream->framesRendered / stream->sampleRate : PaUtil_GetTime();
+    timeInfo.inputBufferAdcTime = timeInfo.currentTime - stream->streamRepresentation.streamInfo.inputLatency;
+    timeInfo.outputBufferDacTime = timeInfo.currentTime + stream->streamRepresentation.streamInfo.outputLatency;
+
+    PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, cbFlags );
+    PaNull_SetHostChannels( stream, frames );
+    framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor, callbackResult );
+
+    if( stream->outputLoopback )
+        PaNull_WriteLoopback( stream, frames );
+    if( stream->offline && stream->hostOutputBuffer )
+        endOfData |= PaNull_WriteOffline( stream, frames ) < frames;
+
+    if( stream->offline )
+    {
+        stream->framesRendered += frames;
+        /* the input is read to its end or the output is full, finish the render */
+        if( endOfData && *callbackResult == paContinue )
+            *callbackResult = paComplete;
+    }
+
+    PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+}
+
+
+/** Clean up after the callback thread exits, for whichever reason.
+ Calls the stream finished callback.
+ */
+static void PaNull_OnThreadExit( void *userData )
+{
+    PaNullStream *stream = (PaNullStream*)userData;
+
+    assert( stream );
+
+    PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+
+    if( stream->streamRepresentation.streamFinishedCallback )
+        stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+
+    stream->isActive = 0;
+}
+
+
+/** Callback thread.
+ Wakes up once per period of the stream clock and processes a host buffer. When it
+ is more than a period late, the missed time is reported as an xrun and skipped. In
+ free running mode it doesn't wait at all.
+ */
+static void *PaNull_CallbackThreadFunc( void *userData )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)userData;
+    int callbackResult = paContinue;
+    PaTime period, nextTime;
+
+    assert( stream );
+
+    period = stream->framesPerHostBuffer / stream->sampleRate;
+
+    pthread_cleanup_push( &PaNull_OnThreadExit, stream );
+
+    PA_ENSURE( PaUnixThread_PrepareNotify( &stream->thread ) );
+    stream->startTime = nextTime = PaUtil_GetTime();
+    PA_ENSURE( PaUnixThread_NotifyParent( &stream->thread ) );
+
+    while( 1 )
+    {
+        PaStreamCallbackFlags cbFlags = 0;
+
+        pthread_testcancel();
+
+        /* drain the buffer processor if the main thread has requested a stop */
+        if( PaUnixThread_StopRequested( &stream->thread ) && (callbackResult == paContinue) )
+            callbackResult = paComplete;
+
+        if( callbackResult != paContinue )
+        {
+            if( callbackResult == paAbort ||
+                    PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+                goto end;
+        }
+
+        if( !stream->freeRun )
+        {
+            PaTime now = PaUtil_GetTime();
+
+            if( now < nextTime )
+            {
+                PA_PROBE1( host_wait, 0 );
+                PaNull_SleepUntil( nextTime );
+                PA_PROBE2( host_wait_return, 0, 0 );
+            }
+            else if( now - nextTime > period )
+            {
+                PA_DEBUG(( "%s: %.3f ms late\n", __FUNCTION__, (now - nextTime) * 1000. ));
+                if( stream->hostInputBuffer )
+                    cbFlags |= paInputOverflow;
+                if( stream->hostOutputBuffer )
+                    cbFlags |= paOutputUnderflow;
+                nextTime = now;
+            }
+            nextTime += period;
+        }
+
+        PaNull_ProcessBuffer( stream, cbFlags, &callbackResult );
+    }
+
+end:
+    stream->callbackFinished = 1;
+
+    /* The loop is left through end, so that PaNull_OnThreadExit() runs here; pthread_cleanup_push() may be a
+       macro opening a block which pthread_cleanup_pop() closes, so they must occur in pairs */
+    pthread_cleanup_pop( 1 );
+
+    PaUnixThreading_EXIT( result );
+error:
+    goto end;
+}
+
+
+/** Pa_ProcessStream() of paManualProcessing streams.
+ Runs one iteration of the callback thread's loop on the calling thread, which waits for
+ the next period for at most timeoutSeconds.
+ */
+static PaError ProcessStream( PaStream *s, double timeoutSeconds )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+    PaStreamCallbackFlags cbFlags = 0;
+
+    if( !stream->isActive )
+        return paStreamIsStopped;
+
+    if( !stream->freeRun )
+    {
+        PaTime period = stream->framesPerHostBuffer / stream->sampleRate;
+        PaTime now = PaUtil_GetTime();
+
+        if( now < stream->manualNextTime )
+        {
+            if( stream->manualNextTime - now > timeoutSeconds )
+            {
+                PaNull_SleepUntil( now + timeoutSeconds );
+                return paTimedOut;
+            }
+
+            PA_PROBE1( host_wait, 0 );
+            PaNull_SleepUntil( stream->manualNextTime );
+            PA_PROBE2( host_wait_return, 0, 0 );
+        }
+        else if( now - stream->manualNextTime > period )
+        {
+            PA_DEBUG(( "%s: %.3f ms late\n", __FUNCTION__, (now - stream->manualNextTime) * 1000. ));
+            if( stream->hostInputBuffer )
+                cbFlags |= paInputOverflow;
+            if( stream->hostOutputBuffer )
+                cbFlags |= paOutputUnderflow;
+            stream->manualNextTime = now;
+        }
+        stream->manualNextTime += period;
+    }
+
+    PaNull_ProcessBuffer( stream, cbFlags, &stream->manualCallbackResult );
+
+    if( stream->manualCallbackResult != paContinue )
+    {
+        if( stream->manualCallbackResult == paAbort ||
+                PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+        {
+            stream->callbackFinished = 1;
+            PaNull_OnThreadExit( stream );
+        }
+    }
+
+    return paNoError;
+}
+
+
+/*
+    When CloseStream() is called, the multi-api layer ensures that
+    the stream has already been stopped or aborted.
+*/
+static PaError CloseStream( PaStream* s )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+
+    PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+    PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    PaNull_CloseOfflineData( stream );
+    PaUtil_FreeMemory( stream->hostInputBuffer );
+    PaUtil_FreeMemory( stream->hostOutputBuffer );
+    PaUtil_FreeMemory( stream );
+
+    return result;
+}
+
+
+static PaError StartStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+
+    if( stream->outputLoopback )
+        PaNull_PrimeLoopback( stream );
+
+    stream->framesRead = 0.;
+    stream->framesWritten = 0.;
+    if( stream->offline )
+    {
+        /* every start renders from the beginning */
+        stream->offlineFramesRead = stream->offlineFramesWritten = 0;
+        stream->framesRendered = 0.;
+        if( stream->inputFile )
+            rewind( stream->inputFile );
+        if( stream->outputFile )
+            rewind( stream->outputFile );
+    }
+    stream->callbackFinished = 0;
+    stream->isStopped = 0;
+    stream->isActive = 1;
+
+    if( stream->callbackMode && stream->manualProcessing )
+    {
+        stream->startTime = stream->manualNextTime = PaUtil_GetTime();
+        stream->manualCallbackResult = paContinue;
+    }
+    else if( stream->callbackMode )
+    {
+        /* the thread starts the clock, wait for it up to a second */
+        result = PaUnixThread_New( &stream->thread, &PaNull_CallbackThreadFunc, stream, 1., NULL, NULL, 0 );
+        if( result != paNoError )
+        {
+            stream->isActive = 0;
+            stream->isStopped = 1;
+            goto error;
+        }
+    }
+    else
+    {
+        stream->startTime = PaUtil_GetTime();
+    }
+
+error:
+    return result;
+}
+
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
+
+static PaError PaNull_RealStop( PaNullStream *stream, int abort )
+{
+    PaError result = paNoError;
+
+    if( stream->callbackMode && stream->manualProcessing )
+    {
+        /* Pa_ProcessStream() calls the finished callback when the callback ends the stream */
+        if( stream->isActive )
+            PaNull_OnThreadExit( stream );
+    }
+    else if( stream->callbackMode )
+    {
+        PaError threadResult;
+
+        PA_ENSURE( PaUnixThread_Terminate( &stream->thread, !abort, &threadResult ) );
+        if( threadResult != paNoError )
+        {
+            PA_DEBUG(( "%s: callback thread returned %d\n", __FUNCTION__, threadResult ));
+        }
+    }
+
+error:
+    stream->isActive = 0;
+    stream->isStopped = 1;
+    return result;
+}
+
+
+static PaError StopStream( PaStream *s )
+{
+    return PaNull_RealStop( (PaNullStream*)s, 0 );
+}
+
+
+static PaError AbortStream( PaStream *s )
+{
+    return PaNull_RealStop( (PaNullStream*)s, 1 );
+}
+
+
+static PaError IsStreamStopped( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return stream->isStopped;
+}
+
+
+static PaError IsStreamActive( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return stream->isActive;
+}
+
+
+/* The callback thread keeps running while paused, without calling the callback */
+static PaError PauseStream( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
+static PaTime GetStreamTime( PaStream *s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    /* the stream clock is the system clock, but for offline streams */
+    if( stream->offline )
+        return PA_MAX( stream->framesRendered, PA_MAX( stream->framesRead, stream->framesWritten ) ) / stream->sampleRate;
+    return PaUtil_GetTime();
+}
+
+
+static double GetStreamCpuLoad( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
+}
+
+
+/*
+    As separate stream interfaces are used for blocking and callback
+    streams, the following functions can be guaranteed to only be called
+    for blocking streams.
+
+    The blocking interface follows the clock of the stream: input frames
+    become available as the clock records them, output may run ahead of
+    the clock by a period plus the fake latency.
+*/
+
+static PaError ReadStream( PaStream* s,
+                           void *buffer,
+                           unsigned long frames )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+    void *userBuffer = buffer;
+    void *nonInterleavedBuffers[PA_NULL_MAX_CHANNELS_];
+    double queueFrames = stream->framesPerHostBuffer + stream->latencyFrames;
+
+    /* the buffer processor advances non-interleaved buffer pointers, work on a copy */
+    if( stream->bufferProcessor.userInputIsInterleaved == 0 )
+    {
+        memcpy( nonInterleavedBuffers, buffer, sizeof(void*) * stream->inputChannelCount );
+        userBuffer = nonInterleavedBuffers;
+    }
+
+    while( frames > 0 )
+    {
+        unsigned long framesGot = PA_MIN( frames, stream->framesPerHostBuffer );
+
+        if( !stream->freeRun )
+        {
+            /* frames the clock recorded more than a queue's worth ago are lost */
+            double clockFrames = PaNull_GetClockFrames( stream );
+            if( clockFrames - stream->framesRead > queueFrames )
+            {
+                stream->framesRead = clockFrames - queueFrames;
+                result = paInputOverflowed;
+            }
+            PaNull_SleepUntil( stream->startTime + (stream->framesRead + framesGot) / stream->sampleRate );
+        }
+
+        if( stream->inputLoopback )
+            PaNull_ReadLoopback( stream, framesGot );
+        else if( stream->offline )
+            PaNull_ReadOffline( stream, framesGot );
+
+        PaNull_SetHostChannels( stream, framesGot );
+        framesGot = PaUtil_CopyInput( &stream->bufferProcessor, &userBuffer, framesGot );
+        stream->framesRead += framesGot;
+        frames -= framesGot;
+    }
+
+    return result;
+}
+
+
+static PaError WriteStream( PaStream* s,
+                            const void *buffer,
+                            unsigned long frames )
+{
+    PaError result = paNoError;
+    PaNullStream *stream = (PaNullStream*)s;
+    const void *userBuffer = buffer;
+    const void *nonInterleavedBuffers[PA_NULL_MAX_CHANNELS_];
+    double queueFrames = stream->framesPerHostBuffer + stream->latencyFrames;
+
+    /* the buffer processor advances non-interleaved buffer pointers, work on a copy */
+    if( stream->bufferProcessor.userOutputIsInterleaved == 0 )
+    {
+        memcpy( (void*)nonInterleavedBuffers, buffer, sizeof(void*) * stream->outputChannelCount );
+        userBuffer = nonInterleavedBuffers;
+    }
+
+    while( frames > 0 )
+    {
+        unsigned long framesGot = PA_MIN( frames, stream->framesPerHostBuffer );
+
+        if( !stream->freeRun )
+        {
+            /* the clock played more than was written, the device plays silence
+                until the first write though */
+            double clockFrames = PaNull_GetClockFrames( stream );
+            if( clockFrames > stream->framesWritten )
+            {
+                if( stream->framesWritten > 0. )
+                    result = paOutputUnderflowed;
+                stream->framesWritten = clockFrames;
+            }
+            PaNull_SleepUntil( stream->startTime
+                    + (stream->framesWritten + framesGot - queueFrames) / stream->sampleRate );
+        }
+
+        PaNull_SetHostChannels( stream, framesGot );
+        framesGot = PaUtil_CopyOutput( &stream->bufferProcessor, &userBuffer, framesGot );
+        if( stream->outputLoopback )
+            PaNull_WriteLoopback( stream, framesGot );
+        else if( stream->offline )
+            PaNull_WriteOffline( stream, framesGot );
+        stream->framesWritten += framesGot;
+        frames -= framesGot;
+    }
+
+    return result;
+}
+
+
+static signed long GetStreamReadAvailable( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+    double available;
+
+    if( stream->freeRun )
+        return (signed long)stream->framesPerHostBuffer;
+
+    available = PaNull_GetClockFrames( stream ) - stream->framesRead;
+    available = PA_MIN( available, stream->framesPerHostBuffer + stream->latencyFrames );
+    return available > 0. ? (signed long)available : 0;
+}
+
+
+static signed long GetStreamWriteAvailable( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+    double queueFrames = stream->framesPerHostBuffer + stream->latencyFrames;
+    double available;
+
+    if( stream->freeRun )
+        return (signed long)stream->framesPerHostBuffer;
+
+    available = PaNull_GetClockFrames( stream ) + queueFrames - stream->framesWritten;
+    available = PA_MIN( available, queueFrames );
+    return available > 0. ? (signed long)available : 0;
+}
+
+
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaNullStream *stream = (PaNullStream*)s;
+
+    return (signed long)sizeof(PaNullStream)
+            + (stream->hostInputBuffer ? (signed long)(stream->framesPerHostBuffer * stream->inputBytesPerHostFrame) : 0)
+            + (stream->hostOutputBuffer ? (signed long)(stream->framesPerHostBuffer * stream->outputBytesPerHostFrame) : 0)
+            + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+}
+
+
+/* Extensions */
+
+void PaNull_InitializeStreamInfo( PaNullStreamInfo *info )
+{
+    info->size = sizeof(PaNullStreamInfo);
+    info->hostApiType = paInDevelopment;
+    info->version = 1;
+    info->flags = 0;
+    info->buffer = NULL;
+    info->bufferFrames = 0;
+    info->fileName = NULL;
+}
@@ -60,6 +60,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include <semaphore.h>
 
@@ -87,6 +88,7 @@
 #include "pa_stream.h"
 #include "pa_cpuload.h"
 #include "pa_process.h"
+#include "pa_probes.h"
 #include "pa_unix_util.h"
 #include "pa_debugprint.h"
 
@@ -157,6 +159,15 @@ typedef struct
     double latency;
     unsigned long hostFrames, numBufs;
     void **userBuffers; /* For non-interleaved blocking */
+
+    /* Aspect MmapIO: When the DMA buffer is mapped, the buffer processor works directly on it and
+     * the hardware position, from SNDCTL_DSP_GETIPTR/GETOPTR, replaces read()/write() */
+    void *mmapBuffer;
+    size_t mmapBytes;
+    unsigned long mmapFrames;   /* Size of the DMA ring in frames */
+    unsigned long mmapOffset;   /* Next frame to process */
+    unsigned long mmapAvail;    /* Frames ready to be read or free to be written */
+    int mmapLastBytes;          /* count_info.bytes when the position was last sampled */
 } PaOssStreamComponent;
 
 /** Implementation specific representation of a PaStream.
@@ -187,6 +198,32 @@ typedef struct PaOssStream
     int callbackMode;
     volatile int callbackStop, callbackAbort;
 
+    /* Aspect ManualProcessing: With paManualProcessing, Pa_ProcessStream runs the iterations of
+     * PaOSS_AudioThreadProc on the application's thread, waiting no longer than waitDeadline */
+    int manualProcessing;
+    int manualInitiate;     /* Process the first host buffer blocking, as the thread does on a restart */
+    int manualCallbackResult;
+    PaStreamCallbackFlags manualCbFlags;
+    PaTime waitDeadline;    /* 0 unless waiting in Pa_ProcessStream */
+    int waitTimedOut;
+
+    int useMmap;    /* All components have their DMA buffer mapped */
+    PaStreamCallbackFlags mmapXrunFlags;
+
+    /* Aspect DelayTiming: The device position, sampled when the last wait ended: the frames queued for
+     * playback and ready for capture, and the PaUtil_GetTime() time they were sampled at. Waits sleep
+     * until it says a host buffer is due, and the callback's timestamps are derived from it */
+    PaTime positionTime;
+    long playbackDelayFrames;
+    long captureQueuedFrames;
+
+    /* Aspect AutoTune: Limit on the number of playback fragments kept queued, adapted to the observed
+     * wakeup jitter. The window tracks the smallest queue level seen when waking up. */
+    int autoTune;
+    unsigned long targetFragments;
+    unsigned long tuneWindowWakeups, tuneWindowLength;
+    long tuneMinQueuedFrames;
+
     PaOssStreamComponent *capture, *playback;
     unsigned long pollTimeout;
     sem_t semaphore;
@@ -222,8 +259,13 @@ static PaError IsStreamStopped( PaStream *s );
 static PaError IsStreamActive( PaStream *stream );
 static PaTime GetStreamTime( PaStream *stream );
 static double GetStreamCpuLoad( PaStream* stream );
+static PaError ProcessStream( PaStream* stream, double timeoutSeconds );
 static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
 static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static PaError ReadStreamTimeout( PaStream* stream, void *buffer, unsigned long frames,
+        unsigned long *framesRead, double timeoutSeconds );
+static PaError WriteStreamTimeout( PaStream* stream, const void *buffer, unsigned long frames,
+        unsigned long *framesWritten, double timeoutSeconds );
 static signed long GetStreamReadAvailable( PaStream* stream );
 static signed long GetStreamWriteAvailable( PaStream* stream );
 static PaError BuildDeviceList( PaOSSHostApiRepresentation *hostApi );
@@ -256,6 +298,11 @@ PaError PaOSS_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PA_ENSURE( BuildDeviceList( ossHostApi ) );
 
@@ -265,11 +312,14 @@ PaError PaOSS_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
                                       PaUtil_DummyRead, PaUtil_DummyWrite,
                                       PaUtil_DummyGetReadAvailable,
                                       PaUtil_DummyGetWriteAvailable );
+    ossHostApi->callbackStreamInterface.Process = ProcessStream;
 
     PaUtil_InitializeStreamInterface( &ossHostApi->blockingStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
                                       GetStreamTime, PaUtil_DummyGetCpuLoad,
                                       ReadStream, WriteStream, GetStreamReadAvailable, GetStreamWriteAvailable );
+    ossHostApi->blockingStreamInterface.ReadTimeout = ReadStreamTimeout;
+    ossHostApi->blockingStreamInterface.WriteTimeout = WriteStreamTimeout;
 
     mainThread_ = pthread_self();
 
@@ -774,6 +824,8 @@ static void PaOssStreamComponent_Terminate( PaOssStreamComponent *component )
 {
     assert( component );
 
+    if( component->mmapBuffer )
+        munmap( component->mmapBuffer, component->mmapBytes );
     if( component->fd >= 0 )
         close( component->fd );
     if( component->buffer )
@@ -892,6 +944,7 @@ static PaError PaOssStream_Initialize( PaOssStream *stream, const PaStreamParame
         PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
                                                &ossApi->callbackStreamInterface, callback, userData );
         stream->callbackMode = 1;
+        stream->manualProcessing = (streamFlags & paManualProcessing) != 0;
     }
     else
     {
@@ -1031,6 +1084,23 @@ static PaError PaOssStreamComponent_Configure( PaOssStreamComponent *component,
          * Least significant byte: exponent of fragment size (i.e., for 256, 8)
          */
         frgmt = (numBufs << 16) + (CalcHigherLogTwo( bytesPerBuf ) & 0xffff);
+#ifdef SNDCTL_DSP_POLICY
+        /* Aspect BufferSettings: On OSSv4 let the driver pick the fragment layout from a timing policy when
+         * the user hasn't asked for a specific buffer size. Policy 0 is the lowest latency, 10 the highest, and
+         * each step roughly doubles the latency, starting at about 1 ms. */
+        if( framesPerBuffer == paFramesPerBufferUnspecified )
+        {
+            int policy = 0;
+            while( policy < 10 && (1 << (policy + 1)) <= component->latency * 1000. )
+                ++policy;
+            if( ioctl( component->fd, SNDCTL_DSP_POLICY, &policy ) < 0 )
+            {
+                PA_DEBUG(( "%s: SNDCTL_DSP_POLICY failed, using SNDCTL_DSP_SETFRAGMENT\n", __FUNCTION__ ));
+                ENSURE_( ioctl( component->fd, SNDCTL_DSP_SETFRAGMENT, &frgmt ), paUnanticipatedHostError );
+            }
+        }
+        else
+#endif
         ENSURE_( ioctl( component->fd, SNDCTL_DSP_SETFRAGMENT, &frgmt ), paUnanticipatedHostError );
 
         /* A: according to the OSS programmer's guide parameters should be set in this order:
@@ -1111,6 +1181,113 @@ error:
     return result;
 }
 
+/** Map the component's DMA buffer.
+ *
+ * Aspect MmapIO: This is an optimization only, so any failure leaves the component using read()/write().
+ * The driver must support mmap and triggering, and the ring must hold a whole number of host buffers
+ * so processing never has to wrap around its end.
+ */
+static void PaOssStreamComponent_MapBuffer( PaOssStreamComponent *component, StreamMode streamMode,
+        unsigned long framesPerHostBuffer )
+{
+    int caps = 0;
+    audio_buf_info bufInfo;
+    unsigned int frameSize = PaOssStreamComponent_FrameSize( component );
+    void *mapped;
+
+    if( ioctl( component->fd, SNDCTL_DSP_GETCAPS, &caps ) < 0
+            || !(caps & DSP_CAP_MMAP) || !(caps & DSP_CAP_TRIGGER) )
+        return;
+    if( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETISPACE : SNDCTL_DSP_GETOSPACE,
+                &bufInfo ) < 0 )
+        return;
+    if( bufInfo.fragsize % frameSize != 0
+            || ((unsigned long)bufInfo.fragstotal * bufInfo.fragsize / frameSize) % framesPerHostBuffer != 0 )
+        return;
+
+    component->mmapBytes = (size_t)bufInfo.fragstotal * bufInfo.fragsize;
+    mapped = mmap( NULL, component->mmapBytes, streamMode == StreamMode_In ? PROT_READ : PROT_WRITE,
+            MAP_SHARED, component->fd, 0 );
+    if( mapped == MAP_FAILED )
+    {
+        PA_DEBUG(( "%s: mmap of %s failed: %s\n", __FUNCTION__, component->devName, strerror( errno ) ));
+        component->mmapBytes = 0;
+        return;
+    }
+
+    component->mmapBuffer = mapped;
+    component->mmapFrames = component->mmapBytes / frameSize;
+}
+
+static void PaOssStreamComponent_UnmapBuffer( PaOssStreamComponent *component )
+{
+    if( component->mmapBuffer )
+        munmap( component->mmapBuffer, component->mmapBytes );
+    component->mmapBuffer = NULL;
+    component->mmapBytes = 0;
+    component->mmapFrames = 0;
+}
+
+/** Advance the component's available frame count by the hardware progress since the last call.
+ *
+ * Aspect MmapIO: count_info.bytes is used rather than count_info.blocks, since the latter is reset on every
+ * query and GetStreamTime() queries the position too.
+ */
+static PaError PaOssStreamComponent_UpdateMmapPosition( PaOssStreamComponent *component, StreamMode streamMode,
+        PaStreamCallbackFlags *xrunFlags )
+{
+    PaError result = paNoError;
+    count_info info;
+    unsigned int frameSize = PaOssStreamComponent_FrameSize( component );
+    unsigned long framesAdvanced;
+
+    ENSURE_( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETIPTR : SNDCTL_DSP_GETOPTR, &info ),
+            paUnanticipatedHostError );
+    framesAdvanced = (unsigned int)(info.bytes - component->mmapLastBytes) / frameSize;
+    component->mmapLastBytes += framesAdvanced * frameSize;
+    component->mmapAvail += framesAdvanced;
+
+    if( component->mmapAvail > component->mmapFrames )
+    {
+        /* The hardware lapped us; the ring content is stale or partly overwritten */
+        *xrunFlags |= streamMode == StreamMode_In ? paInputOverflow : paOutputUnderflow;
+        component->mmapAvail = component->mmapFrames;
+    }
+
+error:
+    return result;
+}
+
+/** Reset the position bookkeeping before the device is triggered.
+ */
+static PaError PaOssStreamComponent_ResetMmapPosition( PaOssStreamComponent *component, StreamMode streamMode )
+{
+    PaError result = paNoError;
+    count_info info;
+
+    ENSURE_( ioctl( component->fd, streamMode == StreamMode_In ? SNDCTL_DSP_GETIPTR : SNDCTL_DSP_GETOPTR, &info ),
+            paUnanticipatedHostError );
+    component->mmapLastBytes = info.bytes;
+    component->mmapOffset = 0;
+    component->mmapAvail = 0;
+
+error:
+    return result;
+}
+
+/** Address of the next frame to process in the mapped ring.
+ */
+static void *PaOssStreamComponent_MmapPointer( PaOssStreamComponent *component )
+{
+    return (char *)component->mmapBuffer + component->mmapOffset * PaOssStreamComponent_FrameSize( component );
+}
+
+static void PaOssStreamComponent_AdvanceMmap( PaOssStreamComponent *component, unsigned long frames )
+{
+    component->mmapOffset = (component->mmapOffset + frames) % component->mmapFrames;
+    component->mmapAvail -= frames;
+}
+
 /** Configure the stream according to input/output parameters.
  *
  * Aspect StreamChannels: The minimum number of channels supported by the device may exceed that requested by
@@ -1160,6 +1337,38 @@ static PaError PaOssStream_Configure( PaOssStream *stream, double sampleRate, un
     stream->framesPerHostBuffer = framesPerHostBuffer;
     stream->pollTimeout = (int) ceil( 1e6 * framesPerHostBuffer / sampleRate );    /* Period in usecs, rounded up */
 
+    /* Aspect MmapIO: Only callback streams on separate device handles are mapped, and either every component
+     * is mapped or none, so the processing loop doesn't have to mix the two schemes */
+    if( stream->useMmap )
+    {
+        if( stream->capture )
+            PaOssStreamComponent_MapBuffer( stream->capture, StreamMode_In, framesPerHostBuffer );
+        if( stream->playback )
+            PaOssStreamComponent_MapBuffer( stream->playback, StreamMode_Out, framesPerHostBuffer );
+
+        if( (stream->capture && !stream->capture->mmapBuffer) || (stream->playback && !stream->playback->mmapBuffer) )
+        {
+            PA_DEBUG(( "%s: Could not map all DMA buffers, using read/write\n", __FUNCTION__ ));
+            if( stream->capture )
+                PaOssStreamComponent_UnmapBuffer( stream->capture );
+            if( stream->playback )
+                PaOssStreamComponent_UnmapBuffer( stream->playback );
+            stream->useMmap = 0;
+        }
+    }
+
+    /* Aspect AutoTune: Start out with the whole buffer, as without tuning, and work down from there. The
+     * mapped ring is always kept full, so tuning only applies to read()/write() streams. */
+    if( stream->useMmap )
+        stream->autoTune = 0;
+    if( stream->autoTune )
+    {
+        stream->targetFragments = stream->playback->numBufs;
+        stream->tuneWindowLength = PA_MAX( (unsigned long)(sampleRate / framesPerHostBuffer), 1 );   /* About a second */
+        stream->tuneWindowWakeups = 0;
+        stream->tuneMinQueuedFrames = LONG_MAX;
+    }
+
     stream->sampleRate = stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
 
 error:
@@ -1248,6 +1457,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     PA_UNLESS( stream = (PaOssStream*)PaUtil_AllocateMemory( sizeof(PaOssStream) ), paInsufficientMemory );
     PA_ENSURE( PaOssStream_Initialize( stream, inputParameters, outputParameters, streamCallback, userData, streamFlags, ossHostApi ) );
 
+    /* Aspect MmapIO: Opt in through the environment, as there is no OSS specific stream info */
+    if( streamCallback && !stream->sharedDevice && getenv( "PA_OSS_MMAP" ) && atoi( getenv( "PA_OSS_MMAP" ) ) )
+        stream->useMmap = 1;
+    if( streamCallback && outputParameters && getenv( "PA_OSS_AUTOTUNE" ) && atoi( getenv( "PA_OSS_AUTOTUNE" ) ) )
+        stream->autoTune = 1;
+
     PA_ENSURE( PaOssStream_Configure( stream, sampleRate, framesPerBuffer, &inLatency, &outLatency ) );
 
     PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
@@ -1274,6 +1489,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
               outputHostFormat, sampleRate, streamFlags, framesPerBuffer, stream->framesPerHostBuffer,
               paUtilFixedHostBufferSize, streamCallback, userData ) );
     bpInitialized = 1;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
     *s = (PaStream*)stream;
 
@@ -1288,6 +1509,176 @@ error:
     return result;
 }
 
+/** Adapt the playback queue limit to the queue level observed on wakeup.
+ *
+ * Aspect AutoTune: The queue level at wakeup is what is left to cover for our scheduling latency. If it drops
+ * below half a host buffer we are close to an underrun and immediately allow one more fragment. If over a
+ * whole window it never dropped below two host buffers we have headroom and give up a fragment.
+ */
+static void PaOssStream_AutoTune( PaOssStream *stream, long queuedFrames )
+{
+    PaOssStreamComponent *playback = stream->playback;
+
+    if( queuedFrames < (long)stream->framesPerHostBuffer / 2 )
+    {
+        if( stream->targetFragments < playback->numBufs )
+        {
+            ++stream->targetFragments;
+            PA_DEBUG(( "%s: Queued %ld frames on wakeup, raising target to %lu fragments\n", __FUNCTION__,
+                        queuedFrames, stream->targetFragments ));
+        }
+        stream->tuneWindowWakeups = 0;
+        stream->tuneMinQueuedFrames = LONG_MAX;
+        return;
+    }
+
+    stream->tuneMinQueuedFrames = PA_MIN( stream->tuneMinQueuedFrames, queuedFrames );
+    if( ++stream->tuneWindowWakeups < stream->tuneWindowLength )
+        return;
+
+    if( stream->tuneMinQueuedFrames >= 2 * (long)stream->framesPerHostBuffer
+            && (stream->targetFragments - 1) * playback->hostFrames >= 2 * stream->framesPerHostBuffer )
+    {
+        --stream->targetFragments;
+        PA_DEBUG(( "%s: At least %ld frames queued on wakeup, lowering target to %lu fragments\n", __FUNCTION__,
+                    stream->tuneMinQueuedFrames, stream->targetFragments ));
+    }
+    stream->tuneWindowWakeups = 0;
+    stream->tuneMinQueuedFrames = LONG_MAX;
+}
+
+/** Sample the device position into the stream.
+ *
+ * Aspect DelayTiming: The playback delay is what has been written but not played yet, from SNDCTL_DSP_GETODELAY
+ * where available, else the ring less its free space. The captured frames are those ready to be read. Mapped
+ * rings are sampled by their position update.
+ */
+static PaError PaOssStream_SamplePosition( PaOssStream *stream )
+{
+    PaError result = paNoError;
+    audio_buf_info bufInfo;
+
+    if( stream->playback )
+    {
+        if( stream->useMmap )
+            stream->playbackDelayFrames = (long)(stream->playback->mmapFrames - stream->playback->mmapAvail);
+        else
+        {
+#ifdef SNDCTL_DSP_GETODELAY
+            int delay;
+            ENSURE_( ioctl( stream->playback->fd, SNDCTL_DSP_GETODELAY, &delay ), paUnanticipatedHostError );
+#else
+            int delay;
+            ENSURE_( ioctl( stream->playback->fd, SNDCTL_DSP_GETOSPACE, &bufInfo ), paUnanticipatedHostError );
+            delay = (int)PaOssStreamComponent_BufferSize( stream->playback ) - bufInfo.bytes;
+#endif
+            stream->playbackDelayFrames = PA_MAX( delay, 0 ) / (long)PaOssStreamComponent_FrameSize( stream->playback );
+        }
+    }
+    if( stream->capture )
+    {
+        if( stream->useMmap )
+            stream->captureQueuedFrames = (long)stream->capture->mmapAvail;
+        else
+        {
+            ENSURE_( ioctl( stream->capture->fd, SNDCTL_DSP_GETISPACE, &bufInfo ), paUnanticipatedHostError );
+            stream->captureQueuedFrames = bufInfo.bytes / (long)PaOssStreamComponent_FrameSize( stream->capture );
+        }
+    }
+    stream->positionTime = PaUtil_GetTime();
+
+error:
+    return result;
+}
+
+/** Time until a host buffer can be processed in both directions, according to the sampled device position.
+ *
+ * Aspect DelayTiming: select() reports a direction ready once whole fragments are, so a host buffer is due once
+ * the fragments covering it have been played or captured.
+ */
+static PaTime PaOssStream_TimeUntilReady( PaOssStream *stream )
+{
+    long missing = 0;
+
+    if( stream->playback )
+    {
+        long needed = (long)((stream->framesPerHostBuffer + stream->playback->hostFrames - 1) /
+                stream->playback->hostFrames * stream->playback->hostFrames);
+        long freeFrames = (long)(stream->playback->hostFrames * stream->playback->numBufs) - stream->playbackDelayFrames;
+        missing = PA_MAX( missing, needed - freeFrames );
+    }
+    if( stream->capture )
+    {
+        long needed = (long)((stream->framesPerHostBuffer + stream->capture->hostFrames - 1) /
+                stream->capture->hostFrames * stream->capture->hostFrames);
+        missing = PA_MAX( missing, needed - stream->captureQueuedFrames );
+    }
+
+    return missing / stream->sampleRate;
+}
+
+/** Wait until at least one host buffer can be processed in the mapped rings.
+ *
+ * Aspect MmapIO: Readiness of a mapped buffer isn't reliably reported by select() across OSS implementations,
+ * so we sample the hardware position and sleep for the time the missing frames take to play.
+ */
+static PaError PaOssStream_WaitForMmapFrames( PaOssStream *stream, unsigned long *frames )
+{
+    PaError result = paNoError;
+    unsigned long commonAvail;
+    PaTime wait;
+
+    stream->waitTimedOut = 0;
+    while( 1 )
+    {
+#ifdef PTHREAD_CANCELED
+        pthread_testcancel();
+#else
+        if( stream->callbackStop || stream->callbackAbort )
+        {
+            PA_DEBUG(( "Cancelling PaOssStream_WaitForMmapFrames\n" ));
+            (*frames) = 0;
+            return paNoError;
+        }
+#endif
+        commonAvail = ULONG_MAX;
+        if( stream->capture )
+        {
+            PA_ENSURE( PaOssStreamComponent_UpdateMmapPosition( stream->capture, StreamMode_In, &stream->mmapXrunFlags ) );
+            commonAvail = PA_MIN( commonAvail, stream->capture->mmapAvail );
+        }
+        if( stream->playback )
+        {
+            PA_ENSURE( PaOssStreamComponent_UpdateMmapPosition( stream->playback, StreamMode_Out, &stream->mmapXrunFlags ) );
+            commonAvail = PA_MIN( commonAvail, stream->playback->mmapAvail );
+        }
+
+        if( commonAvail >= stream->framesPerHostBuffer )
+            break;
+
+        wait = (stream->framesPerHostBuffer - commonAvail) / stream->sampleRate;
+        if( stream->waitDeadline > 0. )
+        {
+            /* Aspect ManualProcessing: Give up at the deadline of Pa_ProcessStream */
+            PaTime left = stream->waitDeadline - PaUtil_GetTime();
+            if( left <= 0. )
+            {
+                stream->waitTimedOut = 1;
+                *frames = 0;
+                return paNoError;
+            }
+            wait = PA_MIN( wait, left );
+        }
+        usleep( (useconds_t) ceil( 1e6 * wait ) );
+    }
+
+    *frames = commonAvail - commonAvail % stream->framesPerHostBuffer;
+    PA_ENSURE( PaOssStream_SamplePosition( stream ) );
+
+error:
+    return result;
+}
+
 /*! Poll on I/O filedescriptors.
 
   Poll till we've determined there's data for read or write. In the full-duplex case,
@@ -1297,6 +1688,9 @@ error:
   state, and go on with what we got. We align the number of frames on a host buffer
   boundary because it is possible that the buffer size differs for the two directions and
   the host buffer size is a compromise between the two.
+
+  Aspect DelayTiming: Before polling we sleep for as long as the device position says no host buffer can be
+  due, so select() confirms readiness rather than waking up at fragment boundaries and on fds that timed out.
   */
 static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *frames )
 {
@@ -1310,10 +1704,15 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     struct timeval selectTimeval = {0, 0};
     unsigned long timeout = stream->pollTimeout;    /* In usecs */
     int captureFd = -1, playbackFd = -1;
+    PaTime wait;
 
     assert( stream );
     assert( frames );
 
+    if( stream->useMmap )
+        return PaOssStream_WaitForMmapFrames( stream, frames );
+    stream->waitTimedOut = 0;
+
     if( stream->capture )
     {
         pollCapture = 1;
@@ -1330,6 +1729,26 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     FD_ZERO( &readFds );
     FD_ZERO( &writeFds );
 
+    PA_ENSURE( PaOssStream_SamplePosition( stream ) );
+    if( (wait = PaOssStream_TimeUntilReady( stream )) > 0. )
+    {
+        if( stream->waitDeadline > 0. )
+            wait = PA_MIN( wait, stream->waitDeadline - PaUtil_GetTime() );
+        if( wait > 0. )
+        {
+            PA_PROBE1( host_wait, 0 );
+            usleep( (useconds_t) ceil( 1e6 * wait ) );
+            PA_PROBE2( host_wait_return, 0, 0 );
+        }
+#ifndef PTHREAD_CANCELED
+        if( stream->callbackStop || stream->callbackAbort )
+        {
+            (*frames) = 0;
+            return paNoError;
+        }
+#endif
+    }
+
     while( pollPlayback || pollCapture )
     {
 #ifdef PTHREAD_CANCELED
@@ -1346,6 +1765,13 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
 
         /* select may modify the timeout parameter */
         selectTimeval.tv_usec = timeout;
+        if( stream->waitDeadline > 0. )
+        {
+            /* Aspect ManualProcessing: Wait no longer than Pa_ProcessStream allows */
+            PaTime left = stream->waitDeadline - PaUtil_GetTime();
+            if( left < timeout / 1e6 )
+                selectTimeval.tv_usec = left > 0. ? (long)ceil( left * 1e6 ) : 0;
+        }
         nfds = 0;
 
         if( pollCapture )
@@ -1358,7 +1784,9 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
             FD_SET( playbackFd, &writeFds );
             nfds = PA_MAX( nfds, playbackFd + 1 );
         }
+        PA_PROBE1( host_wait, nfds );
         ENSURE_( select( nfds, &readFds, &writeFds, NULL, &selectTimeval ), paUnanticipatedHostError );
+        PA_PROBE2( host_wait_return, nfds, 0 );
         /*
         if( poll( stream->pfds + ofs, nfds, stream->pollTimeout ) < 0 )
         {
@@ -1418,6 +1846,13 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
                             __FUNCTION__, stream->pollTimeout ));*/
             }
         }
+
+        if( ( pollCapture || pollPlayback ) && stream->waitDeadline > 0. && PaUtil_GetTime() >= stream->waitDeadline )
+        {
+            stream->waitTimedOut = 1;
+            (*frames) = 0;
+            return paNoError;
+        }
     }
 
     if( stream->capture )
@@ -1433,6 +1868,35 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     {
         ENSURE_( ioctl( playbackFd, SNDCTL_DSP_GETOSPACE, &bufInfo ), paUnanticipatedHostError );
         playbackAvail = bufInfo.fragments * stream->playback->hostFrames;
+        if( stream->autoTune )
+        {
+            /* Aspect AutoTune: Only keep targetFragments queued, waiting for the device to drain if we are
+             * ahead of that */
+            unsigned long totalFrames = stream->playback->numBufs * stream->playback->hostFrames;
+            unsigned long targetFrames;
+            long queuedFrames = (long)totalFrames - bufInfo.bytes / (long)PaOssStreamComponent_FrameSize( stream->playback );
+
+            PaOssStream_AutoTune( stream, queuedFrames );
+            targetFrames = stream->targetFragments * stream->playback->hostFrames;
+            while( queuedFrames > (long)targetFrames - (long)stream->framesPerHostBuffer )
+            {
+#ifndef PTHREAD_CANCELED
+                if( stream->callbackStop || stream->callbackAbort )
+                {
+                    (*frames) = 0;
+                    return paNoError;
+                }
+#endif
+                usleep( (useconds_t) ceil( 1e6 * (queuedFrames - ((long)targetFrames - (long)stream->framesPerHostBuffer))
+                            / stream->sampleRate ) );
+#ifdef PTHREAD_CANCELED
+                pthread_testcancel();
+#endif
+                ENSURE_( ioctl( playbackFd, SNDCTL_DSP_GETOSPACE, &bufInfo ), paUnanticipatedHostError );
+                queuedFrames = (long)totalFrames - bufInfo.bytes / (long)PaOssStreamComponent_FrameSize( stream->playback );
+            }
+            playbackAvail = PA_MIN( playbackAvail, (int)(targetFrames - queuedFrames) );
+        }
         if( !playbackAvail )
         {
             PA_DEBUG(( "%s: playbackAvail: 0\n", __FUNCTION__ ));
@@ -1449,6 +1913,7 @@ static PaError PaOssStream_WaitForFrames( PaOssStream *stream, unsigned long *fr
     assert( commonAvail != INT_MAX );
     assert( commonAvail >= 0 );
     *frames = commonAvail;
+    PA_ENSURE( PaOssStream_SamplePosition( stream ) );
 
 error:
     return result;
@@ -1472,7 +1937,20 @@ static PaError PaOssStream_Prepare( PaOssStream *stream )
     if( stream->capture )
         ENSURE_( ioctl( stream->capture->fd, SNDCTL_DSP_SETTRIGGER, &enableBits ), paUnanticipatedHostError );
 
-    if( stream->playback )
+    if( stream->useMmap )
+    {
+        /* Aspect MmapIO: The whole output ring starts out as silence, and becomes ours as it is played */
+        if( stream->playback )
+        {
+            memset( stream->playback->mmapBuffer, stream->playback->hostFormat == paUInt8 ? 0x80 : 0,
+                    stream->playback->mmapBytes );
+            PA_ENSURE( PaOssStreamComponent_ResetMmapPosition( stream->playback, StreamMode_Out ) );
+        }
+        if( stream->capture )
+            PA_ENSURE( PaOssStreamComponent_ResetMmapPosition( stream->capture, StreamMode_In ) );
+        stream->mmapXrunFlags = 0;
+    }
+    else if( stream->playback )
     {
         size_t bufSz = PaOssStreamComponent_BufferSize( stream->playback );
         memset( stream->playback->buffer, 0, bufSz );
@@ -1540,6 +2018,25 @@ static PaError PaOssStream_Stop( PaOssStream *stream, int abort )
         }
     }
 
+    /* Aspect MmapIO: A mapped device only runs while triggered, and must be triggered again on restart */
+    if( stream->useMmap )
+    {
+        int enableBits = 0;
+        if( stream->playback && !abort )
+        {
+            /* Let what has been queued in the ring play out before the device is halted */
+            PaStreamCallbackFlags ignored = 0;
+            if( PaOssStreamComponent_UpdateMmapPosition( stream->playback, StreamMode_Out, &ignored ) == paNoError )
+                usleep( (useconds_t) ceil( 1e6 * (stream->playback->mmapFrames - stream->playback->mmapAvail)
+                            / stream->sampleRate ) );
+        }
+        if( stream->capture )
+            ioctl( stream->capture->fd, SNDCTL_DSP_SETTRIGGER, &enableBits );
+        if( stream->playback )
+            ioctl( stream->playback->fd, SNDCTL_DSP_SETTRIGGER, &enableBits );
+        stream->triggered = 0;
+    }
+
     if( captureErr || playbackErr )
     {
         result = paUnanticipatedHostError;
@@ -1577,13 +2074,15 @@ static PaError SetUpBuffers( PaOssStream *stream, unsigned long framesAvail )
 
     if( stream->capture )
     {
-        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, stream->capture->buffer,
+        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, stream->useMmap ?
+                PaOssStreamComponent_MmapPointer( stream->capture ) : stream->capture->buffer,
                 stream->capture->hostChannelCount );
         PaUtil_SetInputFrameCount( &stream->bufferProcessor, framesAvail );
     }
     if( stream->playback )
     {
-        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, stream->playback->buffer,
+        PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, stream->useMmap ?
+                PaOssStreamComponent_MmapPointer( stream->playback ) : stream->playback->buffer,
                 stream->playback->hostChannelCount );
         PaUtil_SetOutputFrameCount( &stream->bufferProcessor, framesAvail );
     }
@@ -1591,6 +2090,128 @@ static PaError SetUpBuffers( PaOssStream *stream, unsigned long framesAvail )
     return result;
 }
 
+/** Process the frames PaOssStream_WaitForFrames found available, an iteration of PaOSS_AudioThreadProc.
+ *
+ * Aspect MmapIO: Mapped devices are processed a host buffer at a time.
+ */
+static PaError PaOssStream_ProcessFrames( PaOssStream *stream, unsigned long framesAvail,
+        PaStreamCallbackFlags *cbFlags, int *callbackResult )
+{
+    PaError result = paNoError;
+    unsigned long framesProcessed = 0;
+    unsigned long framesDone = 0;
+    PaStreamCallbackTimeInfo timeInfo = {0,0,0};
+
+    while( framesAvail > 0 )
+    {
+        unsigned long frames = framesAvail;
+        /* Aspect MmapIO: Process one host buffer at a time, so a chunk never straddles the end of a ring */
+        unsigned long framesThisTime = stream->useMmap ? stream->framesPerHostBuffer : framesAvail;
+
+#ifdef PTHREAD_CANCELED
+        pthread_testcancel();
+#else
+        if( stream->callbackStop )
+        {
+            PA_DEBUG(( "Setting callbackResult to paComplete\n" ));
+            *callbackResult = paComplete;
+        }
+
+        if( stream->callbackAbort ) /* avoid indefinite waiting on thread not supporting cancelation */
+        {
+            PA_DEBUG(( "Aborting callback thread\n" ));
+            break;
+        }
+#endif
+        PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+        /* Read data */
+        if ( stream->capture && !stream->useMmap )
+        {
+            PA_ENSURE( PaOssStreamComponent_Read( stream->capture, &frames ) );
+            if( frames < framesAvail )
+            {
+                PA_DEBUG(( "Read %lu less frames than requested\n", framesAvail - frames ));
+                framesAvail = frames;
+            }
+        }
+
+#if ( SOUND_VERSION >= 0x030904 )
+        /*
+           Check with OSS to see if there have been any under/overruns
+           since last time we checked.
+           */
+        /*
+        if( ioctl( stream->deviceHandle, SNDCTL_DSP_GETERROR, &errinfo ) >= 0 )
+        {
+            if( errinfo.play_underruns )
+                cbFlags |= paOutputUnderflow ;
+            if( errinfo.record_underruns )
+                cbFlags |= paInputUnderflow ;
+        }
+        else
+            PA_DEBUG(( "SNDCTL_DSP_GETERROR command failed: %s\n", strerror( errno ) ));
+            */
+#endif
+
+        if( stream->useMmap )
+        {
+            *cbFlags |= stream->mmapXrunFlags;
+            stream->mmapXrunFlags = 0;
+        }
+
+        /* Aspect DelayTiming: The frames of this chunk follow those that were queued for playback and those of
+         * earlier chunks, and were captured before the frames that were still ready at the sampled position */
+        timeInfo.currentTime = PaUtil_GetTime();
+        if( stream->playback )
+            timeInfo.outputBufferDacTime = stream->positionTime +
+                    (stream->playbackDelayFrames + (long)framesDone) / stream->sampleRate;
+        if( stream->capture )
+            timeInfo.inputBufferAdcTime = stream->positionTime -
+                    (stream->captureQueuedFrames - (long)framesDone) / stream->sampleRate;
+
+        PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo,
+                *cbFlags );
+        *cbFlags = 0;
+        PA_ENSURE( SetUpBuffers( stream, framesThisTime ) );
+
+        framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor,
+                callbackResult );
+        assert( framesProcessed == framesThisTime );
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+
+        if( stream->useMmap )
+        {
+            /* The data is already in place, just hand the frames over */
+            if( stream->capture )
+                PaOssStreamComponent_AdvanceMmap( stream->capture, framesProcessed );
+            if( stream->playback )
+                PaOssStreamComponent_AdvanceMmap( stream->playback, framesProcessed );
+        }
+        else if ( stream->playback )
+        {
+            frames = framesAvail;
+
+            PA_ENSURE( PaOssStreamComponent_Write( stream->playback, &frames ) );
+            if( frames < framesAvail )
+            {
+                /* TODO: handle bytesWritten != bytesRequested (slippage?) */
+                PA_DEBUG(( "Wrote %lu less frames than requested\n", framesAvail - frames ));
+            }
+        }
+
+        framesAvail -= framesProcessed;
+        framesDone += framesProcessed;
+        stream->framesProcessed += framesProcessed;
+
+        if( *callbackResult != paContinue )
+            break;
+    }
+
+error:
+    return result;
+}
+
 /** Thread procedure for callback processing.
  *
  * Aspect StreamState: StartStream will wait on this to initiate audio processing, useful in case the
@@ -1602,12 +2223,11 @@ static void *PaOSS_AudioThreadProc( void *userData )
 {
     PaError result = paNoError;
     PaOssStream *stream = (PaOssStream*)userData;
-    unsigned long framesAvail = 0, framesProcessed = 0;
+    unsigned long framesAvail = 0;
     int callbackResult = paContinue;
     int triggered = stream->triggered;  /* See if SNDCTL_DSP_TRIGGER has been issued already */
     int initiateProcessing = triggered;    /* Already triggered? */
     PaStreamCallbackFlags cbFlags = 0;  /* We might want to keep state across iterations */
-    PaStreamCallbackTimeInfo timeInfo = {0,0,0}; /* TODO: IMPLEMENT ME */
 
     /*
 #if ( SOUND_VERSION > 0x030904 )
@@ -1666,86 +2286,10 @@ static void *PaOSS_AudioThreadProc( void *userData )
         else
         {
             framesAvail = stream->framesPerHostBuffer;
+            PA_ENSURE( PaOssStream_SamplePosition( stream ) );
         }
 
-        while( framesAvail > 0 )
-        {
-            unsigned long frames = framesAvail;
-
-#ifdef PTHREAD_CANCELED
-            pthread_testcancel();
-#else
-            if( stream->callbackStop )
-            {
-                PA_DEBUG(( "Setting callbackResult to paComplete\n" ));
-                callbackResult = paComplete;
-            }
-
-            if( stream->callbackAbort ) /* avoid indefinite waiting on thread not supporting cancelation */
-            {
-                PA_DEBUG(( "Aborting callback thread\n" ));
-                break;
-            }
-#endif
-            PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
-
-            /* Read data */
-            if ( stream->capture )
-            {
-                PA_ENSURE( PaOssStreamComponent_Read( stream->capture, &frames ) );
-                if( frames < framesAvail )
-                {
-                    PA_DEBUG(( "Read %lu less frames than requested\n", framesAvail - frames ));
-                    framesAvail = frames;
-                }
-            }
-
-#if ( SOUND_VERSION >= 0x030904 )
-            /*
-               Check with OSS to see if there have been any under/overruns
-               since last time we checked.
-               */
-            /*
-            if( ioctl( stream->deviceHandle, SNDCTL_DSP_GETERROR, &errinfo ) >= 0 )
-            {
-                if( errinfo.play_underruns )
-                    cbFlags |= paOutputUnderflow ;
-                if( errinfo.record_underruns )
-                    cbFlags |= paInputUnderflow ;
-            }
-            else
-                PA_DEBUG(( "SNDCTL_DSP_GETERROR command failed: %s\n", strerror( errno ) ));
-                */
-#endif
-
-            PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo,
-                    cbFlags );
-            cbFlags = 0;
-            PA_ENSURE( SetUpBuffers( stream, framesAvail ) );
-
-            framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor,
-                    &callbackResult );
-            assert( framesProcessed == framesAvail );
-            PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
-
-            if ( stream->playback )
-            {
-                frames = framesAvail;
-
-                PA_ENSURE( PaOssStreamComponent_Write( stream->playback, &frames ) );
-                if( frames < framesAvail )
-                {
-                    /* TODO: handle bytesWritten != bytesRequested (slippage?) */
-                    PA_DEBUG(( "Wrote %lu less frames than requested\n", framesAvail - frames ));
-                }
-            }
-
-            framesAvail -= framesProcessed;
-            stream->framesProcessed += framesProcessed;
-
-            if( callbackResult != paContinue )
-                break;
-        }
+        PA_ENSURE( PaOssStream_ProcessFrames( stream, framesAvail, &cbFlags, &callbackResult ) );
 
         if( initiateProcessing || !triggered )
         {
@@ -1773,6 +2317,59 @@ error:
     pthread_exit( NULL );
 }
 
+/** Process a stream opened with paManualProcessing, an iteration of PaOSS_AudioThreadProc on the
+ * application's thread.
+ *
+ * Aspect StreamState: Once the callback is done and the buffered output flushed, the stream is stopped by
+ * OnExit as when the thread exits.
+ */
+static PaError ProcessStream( PaStream *s, double timeoutSeconds )
+{
+    PaError result = paNoError;
+    PaOssStream *stream = (PaOssStream*)s;
+    unsigned long framesAvail = 0;
+
+    if( !stream->isActive )
+        return paStreamIsStopped;
+
+    if( !stream->manualInitiate )
+    {
+        stream->waitDeadline = PaUtil_GetTime() + timeoutSeconds;
+        result = PaOssStream_WaitForFrames( stream, &framesAvail );
+        stream->waitDeadline = 0.;
+        PA_ENSURE( result );
+        if( stream->waitTimedOut )
+            return paTimedOut;
+    }
+    else
+    {
+        framesAvail = stream->framesPerHostBuffer;
+        PA_ENSURE( PaOssStream_SamplePosition( stream ) );
+    }
+
+    PA_ENSURE( PaOssStream_ProcessFrames( stream, framesAvail, &stream->manualCbFlags, &stream->manualCallbackResult ) );
+
+    if( stream->manualInitiate )
+    {
+        /* Non-blocking from now on */
+        if( stream->capture )
+            PA_ENSURE( ModifyBlocking( stream->capture->fd, 0 ) );
+        if( stream->playback && !stream->sharedDevice )
+            PA_ENSURE( ModifyBlocking( stream->playback->fd, 0 ) );
+        stream->manualInitiate = 0;
+    }
+
+    if( stream->manualCallbackResult != paContinue )
+    {
+        stream->callbackAbort = stream->manualCallbackResult == paAbort;
+        if( stream->callbackAbort || PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+            OnExit( stream );
+    }
+
+error:
+    return result;
+}
+
 /** Close the stream.
  *
  */
@@ -1806,8 +2403,21 @@ static PaError StartStream( PaStream *s )
     stream->lastStreamBytes = 0;
     stream->framesProcessed = 0;
 
+    if( stream->manualProcessing )
+    {
+        /* Aspect ManualProcessing: Start as PaOSS_AudioThreadProc does, Pa_ProcessStream does the rest */
+        int blocking = stream->manualInitiate = stream->triggered;
+
+        stream->manualCallbackResult = paContinue;
+        stream->manualCbFlags = 0;
+        PA_ENSURE( PaOssStream_Prepare( stream ) );
+        if( stream->capture )
+            PA_ENSURE( ModifyBlocking( stream->capture->fd, blocking ) );
+        if( stream->playback && !stream->sharedDevice )
+            PA_ENSURE( ModifyBlocking( stream->playback->fd, blocking ) );
+    }
     /* only use the thread for callback streams */
-    if( stream->bufferProcessor.streamCallback )
+    else if( stream->bufferProcessor.streamCallback )
     {
         PA_ENSURE( PaUtil_StartThreading( &stream->threading, &PaOSS_AudioThreadProc, stream ) );
         sem_wait( &stream->semaphore );
@@ -1823,7 +2433,16 @@ static PaError RealStop( PaOssStream *stream, int abort )
 {
     PaError result = paNoError;
 
-    if( stream->callbackMode )
+    if( stream->manualProcessing )
+    {
+        /* Unless Pa_ProcessStream already finished it */
+        if( stream->isActive )
+        {
+            stream->callbackAbort = abort;
+            OnExit( stream );
+        }
+    }
+    else if( stream->callbackMode )
     {
         if( abort )
             stream->callbackAbort = 1;
@@ -1924,15 +2543,53 @@ static double GetStreamCpuLoad( PaStream* s )
 */
 
 
+/* Wait until a fragment can be read from or written to fd, or until deadline. */
+static PaError WaitForFragment( int fd, short events, PaTime deadline, int *ready )
+{
+    PaError result = paNoError;
+    struct pollfd pfd;
+    PaTime timeLeft;
+    int pollResult;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    do
+    {
+        timeLeft = PA_MAX( deadline - PaUtil_GetTime(), 0. );
+        pollResult = poll( &pfd, 1, (int)ceil( timeLeft * 1000. ) );
+    }
+    while( pollResult < 0 && errno == EINTR );
+    ENSURE_( pollResult, paUnanticipatedHostError );
+
+    *ready = pollResult > 0;
+
+error:
+    return result;
+}
+
+
 static PaError ReadStream( PaStream* s,
                            void *buffer,
                            unsigned long frames )
+{
+    return ReadStreamTimeout( s, buffer, frames, NULL, -1. );
+}
+
+
+/* A negative timeoutSeconds waits as long as it takes. Fragments are read whole, so a fragment is only read
+ * once the device signals one is ready. */
+static PaError ReadStreamTimeout( PaStream* s,
+                                  void *buffer,
+                                  unsigned long frames,
+                                  unsigned long *framesRead,
+                                  double timeoutSeconds )
 {
     PaError result = paNoError;
     PaOssStream *stream = (PaOssStream*)s;
     int bytesRequested, bytesRead;
-    unsigned long framesRequested;
+    unsigned long framesRequested, framesDone = 0;
     void *userBuffer;
+    PaTime deadline = timeoutSeconds >= 0. ? PaUtil_GetTime() + timeoutSeconds : 0.;
 
     /* If user input is non-interleaved, PaUtil_CopyInput will manipulate the channel pointers,
      * so we copy the user provided pointers */
@@ -1944,9 +2601,20 @@ static PaError ReadStream( PaStream* s,
         memcpy( (void *)userBuffer, buffer, sizeof (void *) * stream->capture->userChannelCount );
     }
 
-    while( frames )
+    while( frames > framesDone )
     {
-        framesRequested = PA_MIN( frames, stream->capture->hostFrames );
+        if( timeoutSeconds >= 0. )
+        {
+            int ready;
+            PA_ENSURE( WaitForFragment( stream->capture->fd, POLLIN, deadline, &ready ) );
+            if( !ready )
+            {
+                result = paTimedOut;
+                break;
+            }
+        }
+
+        framesRequested = PA_MIN( frames - framesDone, stream->capture->hostFrames );
 
 	bytesRequested = framesRequested * PaOssStreamComponent_FrameSize( stream->capture );
 	ENSURE_( (bytesRead = read( stream->capture->fd, stream->capture->buffer, bytesRequested )),
@@ -1954,27 +2622,38 @@ static PaError ReadStream( PaStream* s,
 	if ( bytesRequested != bytesRead )
 	{
 	    PA_DEBUG(( "Requested %d bytes, read %d\n", bytesRequested, bytesRead ));
-	    return paUnanticipatedHostError;
+	    PA_ENSURE( paUnanticipatedHostError );
 	}
 
 	PaUtil_SetInputFrameCount( &stream->bufferProcessor, stream->capture->hostFrames );
 	PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, stream->capture->buffer, stream->capture->hostChannelCount );
         PaUtil_CopyInput( &stream->bufferProcessor, &userBuffer, framesRequested );
-	frames -= framesRequested;
+	framesDone += framesRequested;
     }
 
 error:
+    if( framesRead )
+        *framesRead = framesDone;
     return result;
 }
 
 
 static PaError WriteStream( PaStream *s, const void *buffer, unsigned long frames )
+{
+    return WriteStreamTimeout( s, buffer, frames, NULL, -1. );
+}
+
+
+/* As ReadStreamTimeout */
+static PaError WriteStreamTimeout( PaStream *s, const void *buffer, unsigned long frames,
+                                   unsigned long *framesWritten, double timeoutSeconds )
 {
     PaError result = paNoError;
     PaOssStream *stream = (PaOssStream*)s;
     int bytesRequested, bytesWritten;
-    unsigned long framesConverted;
+    unsigned long framesConverted, framesDone = 0;
     const void *userBuffer;
+    PaTime deadline = timeoutSeconds >= 0. ? PaUtil_GetTime() + timeoutSeconds : 0.;
 
     /* If user output is non-interleaved, PaUtil_CopyOutput will manipulate the channel pointers,
      * so we copy the user provided pointers */
@@ -1987,13 +2666,23 @@ static PaError WriteStream( PaStream *s, const void *buffer, unsigned long frame
         memcpy( (void *)userBuffer, buffer, sizeof (void *) * stream->playback->userChannelCount );
     }
 
-    while( frames )
+    while( frames > framesDone )
     {
+        if( timeoutSeconds >= 0. )
+        {
+            int ready;
+            PA_ENSURE( WaitForFragment( stream->playback->fd, POLLOUT, deadline, &ready ) );
+            if( !ready )
+            {
+                result = paTimedOut;
+                break;
+            }
+        }
+
 	PaUtil_SetOutputFrameCount( &stream->bufferProcessor, stream->playback->hostFrames );
 	PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, stream->playback->buffer, stream->playback->hostChannelCount );
 
-	framesConverted = PaUtil_CopyOutput( &stream->bufferProcessor, &userBuffer, frames );
-	frames -= framesConverted;
+	framesConverted = PaUtil_CopyOutput( &stream->bufferProcessor, &userBuffer, frames - framesDone );
 
 	bytesRequested = framesConverted * PaOssStreamComponent_FrameSize( stream->playback );
 	ENSURE_( (bytesWritten = write( stream->playback->fd, stream->playback->buffer, bytesRequested )),
@@ -2002,11 +2691,14 @@ static PaError WriteStream( PaStream *s, const void *buffer, unsigned long frame
 	if ( bytesRequested != bytesWritten )
 	{
 	    PA_DEBUG(( "Requested %d bytes, wrote %d\n", bytesRequested, bytesWritten ));
-	    return paUnanticipatedHostError;
+	    PA_ENSURE( paUnanticipatedHostError );
 	}
+	framesDone += framesConverted;
     }
 
 error:
+    if( framesWritten )
+        *framesWritten = framesDone;
     return result;
 }
 
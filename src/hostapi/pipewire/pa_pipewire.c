@@ -0,0 +1,1479 @@
+/*
+ * $Id$
+ * PortAudio Portable Real-Time Audio Library
+ * Latest Version at: http://www.portaudio.com
+ * PipeWire Implementation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Ross Bencina, Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/**
+ @file
+ @ingroup hostapi_src
+
+ PipeWire host API.
+
+ Each direction of a stream is a pw_stream with PW_STREAM_FLAG_RT_PROCESS, so
+ its process callback runs in PipeWire's realtime data thread and feeds the
+ buffer processor directly, once per graph cycle (quantum). The streams
+ negotiate the user's sample format and interleaving, leaving conversion to
+ the graph's format and rate to PipeWire, so the buffer processor only adapts
+ buffer sizes. A half duplex callback stream which doesn't ask for a buffer
+ size other than the quantum gets the mapped SPA buffers themselves.
+
+ A full duplex stream is a capture and a playback pw_stream in one node
+ group, driven by the same cycle. The capture cycle hands its frames to the
+ playback cycle through a ring buffer, which runs the callback.
+
+ The device list is built once when the host API is initialized: a "Default"
+ device, which lets the session manager pick the nodes, and one device per
+ audio sink and source node of the graph.
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h> /* ULONG_MAX */
+#include <assert.h>
+#include <errno.h>  /* EPIPE */
+#include <signal.h> /* sig_atomic_t */
+
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+
+#include "pa_util.h"
+#include "pa_hostapi.h"
+#include "pa_stream.h"
+#include "pa_process.h"
+#include "pa_allocation.h"
+#include "pa_cpuload.h"
+#include "pa_blockingio.h"
+#include "pa_ringbuffer.h"
+#include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+#include "pa_unix_util.h"
+#include "pa_pipewire.h"
+
+/* Added in PipeWire 0.3.64, older session managers take the node name as node.target */
+#ifndef PW_KEY_TARGET_OBJECT
+#define PW_KEY_TARGET_OBJECT "target.object"
+#endif
+
+#define PA_PW_DEFAULT_RATE      (48000)
+#define PA_PW_MIN_RATE          (1000)
+#define PA_PW_MAX_RATE          (768000)
+#define PA_PW_MIN_QUANTUM       (32)
+#define PA_PW_LOW_QUANTUM       (256)    /* for defaultLow*Latency */
+#define PA_PW_HIGH_QUANTUM      (1024)   /* PipeWire's default quantum, for defaultHigh*Latency */
+#define PA_PW_MAX_QUANTUM       (8192)
+#define PA_PW_DUPLEX_RING_FRAMES (2 * PA_PW_MAX_QUANTUM)
+#define PA_PW_TIMEOUT           (5.)     /* seconds to wait for the server */
+
+static const char *appName_ = "PortAudio";
+
+/* Check the result of a PipeWire call, a negative errno */
+#define ENSURE_PW(expr) \
+    do { \
+        int pwErr_ = (expr); \
+        if( UNLIKELY( pwErr_ < 0 ) ) \
+        { \
+            PaUtil_SetLastHostErrorInfo( paInDevelopment, pwErr_, strerror( -pwErr_ ) ); \
+            PaUtil_DebugPrint(( "Expression '" #expr "' failed in '" __FILE__ "', line: " STRINGIZE( __LINE__ ) "\n" )); \
+            result = paUnanticipatedHostError; \
+            goto error; \
+        } \
+    } while( 0 )
+
+/*
+ * Functions that directly map to the PortAudio stream interface
+ */
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate );
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData );
+static PaError CloseStream( PaStream* stream );
+static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
+static PaError StopStream( PaStream *stream );
+static PaError AbortStream( PaStream *stream );
+static PaError IsStreamStopped( PaStream *s );
+static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaTime GetStreamTime( PaStream *stream );
+static double GetStreamCpuLoad( PaStream* stream );
+static signed long GetStreamMemoryUsage( PaStream* stream );
+static PaError BlockingReadStream( PaStream* stream, void *buffer, unsigned long frames );
+static PaError BlockingWriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static signed long BlockingGetStreamReadAvailable( PaStream* stream );
+static signed long BlockingGetStreamWriteAvailable( PaStream* stream );
+
+/* An audio node found in the registry, which becomes a device */
+typedef struct PaPipeWireNode
+{
+    const char *name;           /* node.name, the target.object of streams opened on the device */
+    const char *description;
+    int isSource;
+    int isSink;
+    int channels;
+    double sampleRate;
+    struct PaPipeWireNode *next;
+}
+PaPipeWireNode;
+
+typedef struct
+{
+    PaDeviceInfo baseDeviceInfo;
+
+    const char *target;         /* NULL for the default device */
+}
+PaPipeWireDeviceInfo;
+
+typedef struct
+{
+    PaUtilHostApiRepresentation commonHostApiRep;
+    PaUtilStreamInterface callbackStreamInterface;
+    PaUtilStreamInterface blockingStreamInterface;
+
+    PaUtilAllocationGroup *deviceInfoMemory;
+    PaHostApiIndex hostApiIndex;
+
+    int pwInitialized;
+    struct pw_thread_loop *loop;    /* runs the main loop, events other than process are handled in its thread */
+    struct pw_context *context;
+    struct pw_core *core;
+    struct spa_hook coreListener;
+    int coreListening;
+    struct pw_registry *registry;
+    struct spa_hook registryListener;
+
+    PaPipeWireNode *nodes;
+    PaPipeWireNode **lastNode;
+    int numNodes;
+    int nodeAllocationFailed;
+
+    int syncSeq;
+    int syncDone;
+    volatile sig_atomic_t serverDown;
+}
+PaPipeWireHostApiRepresentation;
+
+struct PaPipeWireStream;
+
+/* One direction of a stream */
+typedef struct
+{
+    struct PaPipeWireStream *stream;
+    struct pw_stream *pwStream;
+    struct spa_hook listener;
+    int listening;
+    volatile int state;         /* enum pw_stream_state */
+    int drained;
+
+    int numChannels;
+    PaSampleFormat hostSampleFormat;    /* the format negotiated with PipeWire, the user's unless noted */
+    int numPlanes;              /* 1 if interleaved, else numChannels */
+    unsigned long stride;       /* bytes per frame of a plane */
+    void **planes;              /* the planes of the buffer of the current cycle */
+}
+PaPipeWireStreamComponent;
+
+typedef struct PaPipeWireStream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilBufferProcessor bufferProcessor;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaPipeWireHostApiRepresentation *hostApi;
+
+    PaPipeWireStreamComponent capture;
+    PaPipeWireStreamComponent playback;
+
+    unsigned long quantum;      /* frames per cycle asked for with node.latency */
+
+    PaUtilAllocationGroup *streamMemory;
+
+    /* Full duplex: the capture cycle's frames, read by the playback cycle */
+    PaUtilSpscRingBuffer duplexRing;
+    void *duplexInput;          /* PA_PW_MAX_QUANTUM frames of input for the callback */
+    volatile sig_atomic_t duplexOverflow;
+
+    /* The stream is running if it's still producing samples.
+     * The stream is active if samples it produced are still being heard.
+     */
+    volatile sig_atomic_t is_running;
+    volatile sig_atomic_t is_active;
+    /* Used to signal the process callback that the stream should stop */
+    volatile sig_atomic_t doStop, doAbort;
+
+    int callbackResult;
+    int canDirectCallback;      /* Half duplex callback stream, the callback may take the SPA buffers as they are */
+
+    int isBlockingStream;
+    PaUtilBlockingIO blockingIO;
+}
+PaPipeWireStream;
+
+/* ---- blocking emulation layer ---- */
+
+static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFrames )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream *)s;
+
+    return PaUtil_ReadBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static PaError BlockingWriteStream( PaStream* s, const void *data, unsigned long numFrames )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream *)s;
+
+    return PaUtil_WriteBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static signed long BlockingGetStreamReadAvailable( PaStream* s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream *)s;
+
+    return PaUtil_GetBlockingIOReadAvailable( &stream->blockingIO );
+}
+
+static signed long BlockingGetStreamWriteAvailable( PaStream* s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream *)s;
+
+    return PaUtil_GetBlockingIOWriteAvailable( &stream->blockingIO );
+}
+
+/* ---- PipeWire core and registry ---- */
+
+static void OnCoreDone( void *data, uint32_t id, int seq )
+{
+    PaPipeWireHostApiRepresentation *pwHostApi = (PaPipeWireHostApiRepresentation *)data;
+
+    if( id == PW_ID_CORE && seq == pwHostApi->syncSeq )
+    {
+        pwHostApi->syncDone = 1;
+        pw_thread_loop_signal( pwHostApi->loop, false );
+    }
+}
+
+static void OnCoreError( void *data, uint32_t id, int seq, int res, const char *message )
+{
+    PaPipeWireHostApiRepresentation *pwHostApi = (PaPipeWireHostApiRepresentation *)data;
+    (void)seq; /* unused parameter */
+
+    PA_DEBUG(( "%s: Error %d on object %u: %s\n", __FUNCTION__, res, id, message ));
+    if( id == PW_ID_CORE && res == -EPIPE )
+        pwHostApi->serverDown = 1;
+    pw_thread_loop_signal( pwHostApi->loop, false );
+}
+
+static const struct pw_core_events coreEvents_ =
+{
+    .version = PW_VERSION_CORE_EVENTS,
+    .done = OnCoreDone,
+    .error = OnCoreError,
+};
+
+static char *CopyString( PaPipeWireHostApiRepresentation *pwHostApi, const char *s )
+{
+    char *copy = (char *)PaUtil_GroupAllocateMemory( pwHostApi->deviceInfoMemory, strlen( s ) + 1 );
+    if( copy )
+        strcpy( copy, s );
+    return copy;
+}
+
+static void OnRegistryGlobal( void *data, uint32_t id, uint32_t permissions, const char *type, uint32_t version,
+        const struct spa_dict *props )
+{
+    PaPipeWireHostApiRepresentation *pwHostApi = (PaPipeWireHostApiRepresentation *)data;
+    PaPipeWireNode *node;
+    const char *mediaClass, *name, *description, *value;
+    int isSource, isSink;
+    (void)id; /* unused parameter */
+    (void)permissions; /* unused parameter */
+    (void)version; /* unused parameter */
+
+    if( strcmp( type, PW_TYPE_INTERFACE_Node ) != 0 || !props )
+        return;
+    if( !(mediaClass = spa_dict_lookup( props, PW_KEY_MEDIA_CLASS )) || !(name = spa_dict_lookup( props, PW_KEY_NODE_NAME )) )
+        return;
+
+    /* Sources include Audio/Source/Virtual */
+    isSource = strncmp( mediaClass, "Audio/Source", 12 ) == 0 || strcmp( mediaClass, "Audio/Duplex" ) == 0;
+    isSink = strcmp( mediaClass, "Audio/Sink" ) == 0 || strcmp( mediaClass, "Audio/Duplex" ) == 0;
+    if( !isSource && !isSink )
+        return;
+
+    if( !(description = spa_dict_lookup( props, PW_KEY_NODE_DESCRIPTION )) &&
+            !(description = spa_dict_lookup( props, PW_KEY_NODE_NICK )) )
+        description = name;
+
+    if( !(node = (PaPipeWireNode *)PaUtil_GroupAllocateMemory( pwHostApi->deviceInfoMemory, sizeof(PaPipeWireNode) ))
+            || !(node->name = CopyString( pwHostApi, name ))
+            || !(node->description = CopyString( pwHostApi, description )) )
+    {
+        pwHostApi->nodeAllocationFailed = 1;
+        return;
+    }
+    node->isSource = isSource;
+    node->isSink = isSink;
+    node->channels = (value = spa_dict_lookup( props, PW_KEY_AUDIO_CHANNELS )) ? atoi( value ) : 0;
+    if( node->channels <= 0 )
+        node->channels = 2;
+    node->channels = PA_MIN( node->channels, SPA_AUDIO_MAX_CHANNELS );
+    node->sampleRate = (value = spa_dict_lookup( props, PW_KEY_AUDIO_RATE )) ? atof( value ) : 0.;
+    if( node->sampleRate <= 0. )
+        node->sampleRate = PA_PW_DEFAULT_RATE;
+
+    /* Keep the registry's order */
+    node->next = NULL;
+    *pwHostApi->lastNode = node;
+    pwHostApi->lastNode = &node->next;
+    ++pwHostApi->numNodes;
+}
+
+static const struct pw_registry_events registryEvents_ =
+{
+    .version = PW_VERSION_REGISTRY_EVENTS,
+    .global = OnRegistryGlobal,
+};
+
+/* Collect the audio nodes the registry announces until a core roundtrip is done. Called with the loop locked. */
+static PaError EnumerateNodes( PaPipeWireHostApiRepresentation *pwHostApi )
+{
+    PaError result = paNoError;
+    PaTime deadline = PaUtil_GetTime() + PA_PW_TIMEOUT;
+
+    pwHostApi->nodes = NULL;
+    pwHostApi->lastNode = &pwHostApi->nodes;
+    pwHostApi->numNodes = 0;
+
+    PA_UNLESS( pwHostApi->registry = pw_core_get_registry( pwHostApi->core, PW_VERSION_REGISTRY, 0 ),
+            paInsufficientMemory );
+    pw_registry_add_listener( pwHostApi->registry, &pwHostApi->registryListener, &registryEvents_, pwHostApi );
+
+    pwHostApi->syncDone = 0;
+    pwHostApi->syncSeq = pw_core_sync( pwHostApi->core, PW_ID_CORE, 0 );
+    while( !pwHostApi->syncDone )
+    {
+        PA_UNLESS( !pwHostApi->serverDown, paDeviceUnavailable );
+        PA_UNLESS( PaUtil_GetTime() < deadline, paTimedOut );
+        pw_thread_loop_timed_wait( pwHostApi->loop, 1 );
+    }
+    PA_UNLESS( !pwHostApi->nodeAllocationFailed, paInsufficientMemory );
+
+error:
+    /* The device list isn't updated, the registry isn't needed any more */
+    if( pwHostApi->registry )
+    {
+        spa_hook_remove( &pwHostApi->registryListener );
+        pw_proxy_destroy( (struct pw_proxy *)pwHostApi->registry );
+        pwHostApi->registry = NULL;
+    }
+    return result;
+}
+
+static void InitializeDeviceInfo( PaPipeWireHostApiRepresentation *pwHostApi, PaPipeWireDeviceInfo *deviceInfo,
+        const char *name, const char *target, int maxInputChannels, int maxOutputChannels, double sampleRate )
+{
+    PaDeviceInfo *baseDeviceInfo = &deviceInfo->baseDeviceInfo;
+
+    deviceInfo->target = target;
+    baseDeviceInfo->structVersion = 2;
+    baseDeviceInfo->hostApi = pwHostApi->hostApiIndex;
+    baseDeviceInfo->name = name;
+    baseDeviceInfo->maxInputChannels = maxInputChannels;
+    baseDeviceInfo->maxOutputChannels = maxOutputChannels;
+    baseDeviceInfo->defaultSampleRate = sampleRate;
+
+    /* PipeWire runs at any quantum the graph agrees on, these are its usual low latency and default ones */
+    baseDeviceInfo->defaultLowInputLatency = maxInputChannels > 0 ? PA_PW_LOW_QUANTUM / sampleRate : 0.;
+    baseDeviceInfo->defaultHighInputLatency = maxInputChannels > 0 ? PA_PW_HIGH_QUANTUM / sampleRate : 0.;
+    baseDeviceInfo->defaultLowOutputLatency = maxOutputChannels > 0 ? PA_PW_LOW_QUANTUM / sampleRate : 0.;
+    baseDeviceInfo->defaultHighOutputLatency = maxOutputChannels > 0 ? PA_PW_HIGH_QUANTUM / sampleRate : 0.;
+}
+
+static PaError BuildDeviceList( PaPipeWireHostApiRepresentation *pwHostApi )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *commonApi = &pwHostApi->commonHostApiRep;
+    PaPipeWireDeviceInfo *deviceInfos;
+    PaPipeWireNode *node;
+    int numDevices = pwHostApi->numNodes + 1;
+    int maxInputChannels = 0, maxOutputChannels = 0;
+    int i;
+
+    commonApi->info.defaultInputDevice = paNoDevice;
+    commonApi->info.defaultOutputDevice = paNoDevice;
+    commonApi->info.deviceCount = 0;
+
+    for( node = pwHostApi->nodes; node; node = node->next )
+    {
+        if( node->isSource )
+            maxInputChannels = PA_MAX( maxInputChannels, node->channels );
+        if( node->isSink )
+            maxOutputChannels = PA_MAX( maxOutputChannels, node->channels );
+    }
+
+    PA_UNLESS( commonApi->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory( pwHostApi->deviceInfoMemory,
+                sizeof(PaDeviceInfo*) * numDevices ), paInsufficientMemory );
+    PA_UNLESS( deviceInfos = (PaPipeWireDeviceInfo*)PaUtil_GroupAllocateMemory( pwHostApi->deviceInfoMemory,
+                sizeof(PaPipeWireDeviceInfo) * numDevices ), paInsufficientMemory );
+
+    /* The default device leaves the choice of nodes to the session manager */
+    InitializeDeviceInfo( pwHostApi, &deviceInfos[0], "Default", NULL, maxInputChannels, maxOutputChannels,
+            PA_PW_DEFAULT_RATE );
+    for( node = pwHostApi->nodes, i = 1; node; node = node->next, ++i )
+    {
+        InitializeDeviceInfo( pwHostApi, &deviceInfos[i], node->description, node->name,
+                node->isSource ? node->channels : 0, node->isSink ? node->channels : 0, node->sampleRate );
+    }
+
+    for( i = 0; i < numDevices; ++i )
+        commonApi->deviceInfos[i] = &deviceInfos[i].baseDeviceInfo;
+    commonApi->info.deviceCount = numDevices;
+    if( maxInputChannels > 0 )
+        commonApi->info.defaultInputDevice = 0;
+    if( maxOutputChannels > 0 )
+        commonApi->info.defaultOutputDevice = 0;
+
+error:
+    return result;
+}
+
+static void DestroyHostApi( PaPipeWireHostApiRepresentation *pwHostApi )
+{
+    /* With the loop stopped its objects are destroyed without locking it */
+    if( pwHostApi->loop )
+        pw_thread_loop_stop( pwHostApi->loop );
+
+    if( pwHostApi->core )
+    {
+        if( pwHostApi->coreListening )
+            spa_hook_remove( &pwHostApi->coreListener );
+        pw_core_disconnect( pwHostApi->core );
+    }
+    if( pwHostApi->context )
+        pw_context_destroy( pwHostApi->context );
+    if( pwHostApi->loop )
+        pw_thread_loop_destroy( pwHostApi->loop );
+    if( pwHostApi->pwInitialized )
+        pw_deinit();
+
+    if( pwHostApi->deviceInfoMemory )
+    {
+        PaUtil_FreeAllAllocations( pwHostApi->deviceInfoMemory );
+        PaUtil_DestroyAllocationGroup( pwHostApi->deviceInfoMemory );
+    }
+
+    PaUtil_FreeMemory( pwHostApi );
+}
+
+PaError PaPipeWire_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaPipeWireHostApiRepresentation *pwHostApi = NULL;
+    int locked = 0;
+
+    *hostApi = NULL;    /* Initialize to NULL */
+
+    PA_UNLESS( pwHostApi = (PaPipeWireHostApiRepresentation*)
+        PaUtil_AllocateMemory( sizeof(PaPipeWireHostApiRepresentation) ), paInsufficientMemory );
+    memset( pwHostApi, 0, sizeof(PaPipeWireHostApiRepresentation) );
+    PA_UNLESS( pwHostApi->deviceInfoMemory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    pwHostApi->hostApiIndex = hostApiIndex;
+
+    pw_init( NULL, NULL );
+    pwHostApi->pwInitialized = 1;
+
+    PA_UNLESS( pwHostApi->loop = pw_thread_loop_new( "PortAudio", NULL ), paInsufficientMemory );
+    PA_UNLESS( pwHostApi->context = pw_context_new( pw_thread_loop_get_loop( pwHostApi->loop ), NULL, 0 ),
+            paInsufficientMemory );
+    ENSURE_PW( pw_thread_loop_start( pwHostApi->loop ) );
+
+    pw_thread_loop_lock( pwHostApi->loop );
+    locked = 1;
+
+    /* Without a PipeWire server this API cannot be used. The V19 development docs say that if an implementation
+     * detects that it cannot be used, it should return a NULL interface and paNoError */
+    if( !(pwHostApi->core = pw_context_connect( pwHostApi->context, NULL, 0 )) )
+    {
+        PA_DEBUG(( "%s: Couldn't connect to PipeWire\n", __FUNCTION__ ));
+        goto error;
+    }
+    pw_core_add_listener( pwHostApi->core, &pwHostApi->coreListener, &coreEvents_, pwHostApi );
+    pwHostApi->coreListening = 1;
+
+    result = EnumerateNodes( pwHostApi );
+    if( result == paTimedOut || result == paDeviceUnavailable )
+    {
+        PA_DEBUG(( "%s: PipeWire didn't answer\n", __FUNCTION__ ));
+        result = paNoError;
+        goto error;
+    }
+    PA_ENSURE( result );
+
+    pw_thread_loop_unlock( pwHostApi->loop );
+    locked = 0;
+
+    PA_ENSURE( BuildDeviceList( pwHostApi ) );
+
+    *hostApi = &pwHostApi->commonHostApiRep;
+    (*hostApi)->info.structVersion = 1;
+    (*hostApi)->info.type = paInDevelopment;
+    (*hostApi)->info.name = "PipeWire";
+
+    (*hostApi)->Terminate = Terminate;
+    (*hostApi)->OpenStream = OpenStream;
+    (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
+
+    PaUtil_InitializeStreamInterface( &pwHostApi->callbackStreamInterface,
+                                      CloseStream, StartStream,
+                                      StopStream, AbortStream,
+                                      IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, GetStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable,
+                                      PaUtil_DummyGetWriteAvailable );
+    pwHostApi->callbackStreamInterface.Pause = PauseStream;
+    pwHostApi->callbackStreamInterface.Resume = ResumeStream;
+    pwHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+
+    PaUtil_InitializeStreamInterface( &pwHostApi->blockingStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, PaUtil_DummyGetCpuLoad,
+                                      BlockingReadStream, BlockingWriteStream,
+                                      BlockingGetStreamReadAvailable, BlockingGetStreamWriteAvailable );
+
+    return result;
+
+error:
+    if( locked )
+        pw_thread_loop_unlock( pwHostApi->loop );
+    if( pwHostApi )
+        DestroyHostApi( pwHostApi );
+    *hostApi = NULL;
+
+    return result;
+}
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
+{
+    DestroyHostApi( (PaPipeWireHostApiRepresentation*)hostApi );
+}
+
+static enum spa_audio_format SampleFormatToSpa( PaSampleFormat format )
+{
+    int planar = (format & paNonInterleaved) != 0;
+
+    switch( format & ~paNonInterleaved )
+    {
+    case paFloat32:
+        return planar ? SPA_AUDIO_FORMAT_F32P : SPA_AUDIO_FORMAT_F32;
+    case paFloat64:
+        return planar ? SPA_AUDIO_FORMAT_F64P : SPA_AUDIO_FORMAT_F64;
+    case paInt32:
+        return planar ? SPA_AUDIO_FORMAT_S32P : SPA_AUDIO_FORMAT_S32;
+    case paInt24In32:
+        return planar ? SPA_AUDIO_FORMAT_S24_32P : SPA_AUDIO_FORMAT_S24_32;
+    case paInt24:
+        return planar ? SPA_AUDIO_FORMAT_S24P : SPA_AUDIO_FORMAT_S24;
+    case paInt16:
+        return planar ? SPA_AUDIO_FORMAT_S16P : SPA_AUDIO_FORMAT_S16;
+    case paInt8:
+        return planar ? SPA_AUDIO_FORMAT_S8P : SPA_AUDIO_FORMAT_S8;
+    case paUInt8:
+        return planar ? SPA_AUDIO_FORMAT_U8P : SPA_AUDIO_FORMAT_U8;
+    default:
+        return SPA_AUDIO_FORMAT_UNKNOWN;
+    }
+}
+
+/* Assign positions like ALSA's default channel maps, so that PipeWire can mix the channels into the node's */
+static void SetChannelPositions( struct spa_audio_info_raw *info )
+{
+    static const uint32_t surround[] = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+        SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR, SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+        SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR };
+    uint32_t i;
+
+    if( info->channels == 1 )
+        info->position[0] = SPA_AUDIO_CHANNEL_MONO;
+    else if( info->channels == 2 || info->channels == 4 || info->channels == 6 || info->channels == 8 )
+        memcpy( info->position, surround, sizeof(uint32_t) * info->channels );
+    else
+    {
+        for( i = 0; i < info->channels; ++i )
+            info->position[i] = SPA_AUDIO_CHANNEL_AUX0 + i;
+    }
+}
+
+static PaError ValidateParameters( struct PaUtilHostApiRepresentation *hostApi, const PaStreamParameters *parameters,
+        int isInput, double sampleRate )
+{
+    const PaDeviceInfo *deviceInfo;
+
+    if( !parameters )
+        return paNoError;
+
+    /* unless alternate device specification is supported, reject the use of
+        paUseHostApiSpecificDeviceSpecification */
+    if( parameters->device == paUseHostApiSpecificDeviceSpecification )
+        return paInvalidDevice;
+
+    deviceInfo = hostApi->deviceInfos[ parameters->device ];
+    if( parameters->channelCount > (isInput ? deviceInfo->maxInputChannels : deviceInfo->maxOutputChannels) )
+        return paInvalidChannelCount;
+
+    /* PipeWire converts from and to any of the sample formats but paCustomFormat */
+    if( SampleFormatToSpa( parameters->sampleFormat ) == SPA_AUDIO_FORMAT_UNKNOWN )
+        return paSampleFormatNotSupported;
+
+    /* ... and resamples to the graph's rate */
+    if( sampleRate < PA_PW_MIN_RATE || sampleRate > PA_PW_MAX_RATE )
+        return paInvalidSampleRate;
+
+    /* validate streamInfo */
+    if( parameters->hostApiSpecificStreamInfo )
+        return paIncompatibleHostApiSpecificStreamInfo; /* this implementation doesn't use custom stream info */
+
+    return paNoError;
+}
+
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate )
+{
+    PaError result = paNoError;
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    return paFormatIsSupported;
+
+error:
+    return result;
+}
+
+/* ---- streams ---- */
+
+static void OnStreamStateChanged( void *data, enum pw_stream_state old, enum pw_stream_state state, const char *error )
+{
+    PaPipeWireStreamComponent *component = (PaPipeWireStreamComponent *)data;
+    (void)old; /* unused parameter */
+
+    PA_DEBUG(( "%s: %s stream state %d%s%s\n", __FUNCTION__, component == &component->stream->capture ? "Capture" :
+                "Playback", state, error ? ": " : "", error ? error : "" ));
+    component->state = state;
+    pw_thread_loop_signal( component->stream->hostApi->loop, false );
+}
+
+static void OnStreamDrained( void *data )
+{
+    PaPipeWireStreamComponent *component = (PaPipeWireStreamComponent *)data;
+
+    component->drained = 1;
+    pw_thread_loop_signal( component->stream->hostApi->loop, false );
+}
+
+static void SilenceBuffer( void *buffer, PaSampleFormat format, unsigned long bytes )
+{
+    memset( buffer, (format & ~paNonInterleaved) == paUInt8 ? 0x80 : 0, bytes );
+}
+
+/* The graph's delay, in seconds, of the frames of the current cycle */
+static PaTime GetGraphDelay( PaPipeWireStreamComponent *component )
+{
+    struct pw_time time;
+
+    if( pw_stream_get_time_n( component->pwStream, &time, sizeof(time) ) < 0 || time.rate.denom == 0 )
+        return 0.;
+    return (PaTime)time.delay * time.rate.num / time.rate.denom;
+}
+
+/* Point component->planes at the data of buffer and return its frames: those captured for input, those the graph
+ * asks for (requested) for output. 0 if the buffer doesn't fit the format. */
+static unsigned long MapBuffer( PaPipeWireStreamComponent *component, struct spa_buffer *buffer, int isOutput,
+        unsigned long requested )
+{
+    unsigned long frames = isOutput ? (requested ? requested : component->stream->quantum) : ULONG_MAX;
+    int i;
+
+    if( buffer->n_datas < (uint32_t)component->numPlanes )
+        return 0;
+
+    for( i = 0; i < component->numPlanes; ++i )
+    {
+        struct spa_data *d = &buffer->datas[i];
+        unsigned long offset, bytes;
+
+        if( !d->data )
+            return 0;
+        if( isOutput )
+        {
+            offset = 0;
+            bytes = d->maxsize;
+        }
+        else
+        {
+            offset = PA_MIN( d->chunk->offset, d->maxsize );
+            bytes = PA_MIN( d->chunk->size, d->maxsize - offset );
+        }
+        component->planes[i] = (unsigned char *)d->data + offset;
+        frames = PA_MIN( frames, bytes / component->stride );
+    }
+    return frames;
+}
+
+static void CommitOutputBuffer( PaPipeWireStreamComponent *component, struct spa_buffer *buffer, unsigned long frames )
+{
+    int i;
+
+    for( i = 0; i < component->numPlanes && i < (int)buffer->n_datas; ++i )
+    {
+        struct spa_chunk *chunk = buffer->datas[i].chunk;
+
+        chunk->offset = 0;
+        chunk->stride = component->stride;
+        chunk->size = frames * component->stride;
+    }
+}
+
+/* Run the callback of a canDirectCallback stream on the buffer of the cycle, in place of the buffer processor. */
+static unsigned long DirectProcess( PaPipeWireStream *stream, unsigned long frames,
+        PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags cbFlags )
+{
+    PaPipeWireStreamComponent *capture = &stream->capture, *playback = &stream->playback;
+    const void *input = NULL;
+    void *output = NULL;
+
+    if( capture->numChannels > 0 )
+        input = capture->hostSampleFormat & paNonInterleaved ? (void *)capture->planes : capture->planes[0];
+    if( playback->numChannels > 0 )
+        output = playback->hostSampleFormat & paNonInterleaved ? (void *)playback->planes : playback->planes[0];
+
+    PaUtil_BeginBufferProcessing( &stream->bufferProcessor, timeInfo, cbFlags );
+    return PaUtil_EndBufferProcessingDirectly( &stream->bufferProcessor, input, output, frames,
+            &stream->callbackResult );
+}
+
+/* Process one cycle of frames of the planes of the components, return the frames of output produced */
+static unsigned long ProcessCycle( PaPipeWireStream *stream, unsigned long frames )
+{
+    PaPipeWireStreamComponent *capture = &stream->capture, *playback = &stream->playback;
+    PaStreamCallbackTimeInfo timeInfo = {0,0,0};
+    PaStreamCallbackFlags cbFlags = 0;
+    unsigned long framesProcessed;
+    int i;
+
+    if( stream->is_active && (stream->doStop || stream->doAbort) && stream->callbackResult == paContinue )
+    {
+        PA_DEBUG(( "%s: Stopping stream\n", __FUNCTION__ ));
+        stream->callbackResult = stream->doStop ? paComplete : paAbort;
+    }
+
+    /* If the user has returned !paContinue from the callback we'll want to flush the internal buffers,
+     * when these are empty we can finally mark the stream as inactive */
+    if( stream->is_active && stream->callbackResult != paContinue &&
+            PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+    {
+        stream->is_active = 0;
+        if( stream->streamRepresentation.streamFinishedCallback )
+            stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+        PA_DEBUG(( "%s: Callback finished\n", __FUNCTION__ ));
+    }
+
+    if( !stream->is_active )
+    {
+        for( i = 0; i < playback->numChannels && i < playback->numPlanes; ++i )
+            SilenceBuffer( playback->planes[i], playback->hostSampleFormat, frames * playback->stride );
+        return frames;
+    }
+
+    timeInfo.currentTime = PaUtil_GetTime();
+    if( capture->numChannels > 0 )
+        timeInfo.inputBufferAdcTime = timeInfo.currentTime - GetGraphDelay( capture );
+    if( playback->numChannels > 0 )
+        timeInfo.outputBufferDacTime = timeInfo.currentTime + GetGraphDelay( playback );
+
+    PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+    if( capture->numChannels > 0 && playback->numChannels > 0 )
+    {
+        /* Take the frames the capture cycle left, which usually ran first */
+        ring_buffer_size_t got;
+
+        frames = PA_MIN( frames, PA_PW_MAX_QUANTUM );
+        got = PaUtil_ReadSpscRingBuffer( &stream->duplexRing, stream->duplexInput, (ring_buffer_size_t)frames );
+        if( (unsigned long)got < frames )
+        {
+            SilenceBuffer( (unsigned char *)stream->duplexInput + got * capture->stride, capture->hostSampleFormat,
+                    (frames - got) * capture->stride );
+            cbFlags |= paInputUnderflow;
+        }
+        if( stream->duplexOverflow )
+        {
+            cbFlags |= paInputOverflow;
+            stream->duplexOverflow = 0;
+        }
+        capture->planes[0] = stream->duplexInput;
+    }
+
+    if( stream->canDirectCallback && PaUtil_CanBypassBufferProcessor( &stream->bufferProcessor )
+            && ( stream->bufferProcessor.framesPerUserBuffer == paFramesPerBufferUnspecified
+                || frames == stream->bufferProcessor.framesPerUserBuffer ) )
+    {
+        framesProcessed = DirectProcess( stream, frames, &timeInfo, cbFlags );
+        PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+        return framesProcessed;
+    }
+
+    PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, cbFlags );
+
+    if( capture->numChannels > 0 )
+    {
+        PaUtil_SetInputFrameCount( &stream->bufferProcessor, frames );
+        if( capture->hostSampleFormat & paNonInterleaved )
+        {
+            for( i = 0; i < capture->numChannels; ++i )
+                PaUtil_SetNonInterleavedInputChannel( &stream->bufferProcessor, i, capture->planes[i] );
+        }
+        else
+            PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor, 0, capture->planes[0], 0 );
+    }
+    if( playback->numChannels > 0 )
+    {
+        PaUtil_SetOutputFrameCount( &stream->bufferProcessor, frames );
+        if( playback->hostSampleFormat & paNonInterleaved )
+        {
+            for( i = 0; i < playback->numChannels; ++i )
+                PaUtil_SetNonInterleavedOutputChannel( &stream->bufferProcessor, i, playback->planes[i] );
+        }
+        else
+            PaUtil_SetInterleavedOutputChannels( &stream->bufferProcessor, 0, playback->planes[0], 0 );
+    }
+
+    framesProcessed = PaUtil_EndBufferProcessing( &stream->bufferProcessor, &stream->callbackResult );
+    /* We've specified a host buffer size mode where every frame should be consumed by the buffer processor */
+    assert( framesProcessed == frames );
+
+    PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+
+    return framesProcessed;
+}
+
+/* Process callback, called once per cycle in PipeWire's realtime data thread */
+static void OnStreamProcess( void *data )
+{
+    PaPipeWireStreamComponent *component = (PaPipeWireStreamComponent *)data;
+    PaPipeWireStream *stream = component->stream;
+    int isOutput = component == &stream->playback;
+    struct pw_buffer *buffer;
+    unsigned long frames;
+
+    if( !(buffer = pw_stream_dequeue_buffer( component->pwStream )) )
+        return;     /* None is free, PipeWire calls again with the next cycle */
+
+    frames = MapBuffer( component, buffer->buffer, isOutput, isOutput ? (unsigned long)buffer->requested : 0 );
+    if( frames > 0 )
+    {
+        if( !isOutput && stream->playback.numChannels > 0 )
+        {
+            /* The capture half of a full duplex stream, the playback cycle runs the callback */
+            if( stream->is_active && PaUtil_WriteSpscRingBuffer( &stream->duplexRing, component->planes[0],
+                        (ring_buffer_size_t)frames ) < (ring_buffer_size_t)frames )
+                stream->duplexOverflow = 1;
+        }
+        else
+            frames = ProcessCycle( stream, frames );
+    }
+
+    if( isOutput )
+        CommitOutputBuffer( component, buffer->buffer, frames );
+    pw_stream_queue_buffer( component->pwStream, buffer );
+}
+
+static const struct pw_stream_events streamEvents_ =
+{
+    .version = PW_VERSION_STREAM_EVENTS,
+    .state_changed = OnStreamStateChanged,
+    .process = OnStreamProcess,
+    .drained = OnStreamDrained,
+};
+
+/* Create and connect, inactive, the pw_stream of one direction. Called with the loop locked. */
+static PaError InitializeComponent( PaPipeWireStreamComponent *component, PaPipeWireStream *stream,
+        enum spa_direction direction, int numChannels, PaSampleFormat hostSampleFormat, const char *target,
+        double sampleRate )
+{
+    PaError result = paNoError;
+    struct pw_properties *props;
+    struct spa_audio_info_raw info;
+    struct spa_pod_builder builder;
+    uint8_t podBuffer[1024];
+    const struct spa_pod *params[1];
+    int isCapture = direction == PW_DIRECTION_INPUT;
+
+    component->stream = stream;
+    component->numChannels = numChannels;
+    component->hostSampleFormat = hostSampleFormat;
+    component->numPlanes = hostSampleFormat & paNonInterleaved ? numChannels : 1;
+    component->stride = Pa_GetSampleSize( hostSampleFormat ) * (hostSampleFormat & paNonInterleaved ? 1 : numChannels);
+    PA_UNLESS( component->planes = (void **)PaUtil_GroupAllocateMemory( stream->streamMemory,
+                sizeof(void *) * component->numPlanes ), paInsufficientMemory );
+
+    PA_UNLESS( props = pw_properties_new( PW_KEY_MEDIA_TYPE, "Audio",
+                PW_KEY_MEDIA_CATEGORY, isCapture ? "Capture" : "Playback",
+                PW_KEY_APP_NAME, appName_,
+                NULL ), paInsufficientMemory );
+    /* Ask for quantum sized cycles at the stream's rate. The graph may run at others, PipeWire adapts */
+    pw_properties_setf( props, PW_KEY_NODE_LATENCY, "%lu/%u", stream->quantum, (unsigned)sampleRate );
+    pw_properties_setf( props, PW_KEY_NODE_RATE, "1/%u", (unsigned)sampleRate );
+    if( target )
+        pw_properties_set( props, PW_KEY_TARGET_OBJECT, target );
+    /* The halves of a full duplex stream run in the same cycle */
+    if( stream->capture.numChannels > 0 && stream->playback.numChannels > 0 )
+        pw_properties_setf( props, PW_KEY_NODE_GROUP, "portaudio-%p", (void *)stream );
+
+    /* pw_stream_new() takes props, even if it fails */
+    PA_UNLESS( component->pwStream = pw_stream_new( stream->hostApi->core, appName_, props ), paInsufficientMemory );
+    component->state = PW_STREAM_STATE_UNCONNECTED;
+    pw_stream_add_listener( component->pwStream, &component->listener, &streamEvents_, component );
+    component->listening = 1;
+
+    memset( &info, 0, sizeof(info) );
+    info.format = SampleFormatToSpa( hostSampleFormat );
+    info.rate = (uint32_t)sampleRate;
+    info.channels = numChannels;
+    SetChannelPositions( &info );
+
+    spa_pod_builder_init( &builder, podBuffer, sizeof(podBuffer) );
+    PA_UNLESS( params[0] = spa_format_audio_raw_build( &builder, SPA_PARAM_EnumFormat, &info ), paInternalError );
+
+    ENSURE_PW( pw_stream_connect( component->pwStream, direction, PW_ID_ANY,
+                PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_INACTIVE | PW_STREAM_FLAG_MAP_BUFFERS
+                | PW_STREAM_FLAG_RT_PROCESS, params, 1 ) );
+
+error:
+    return result;
+}
+
+/* Called with the loop locked */
+static void TerminateComponent( PaPipeWireStreamComponent *component )
+{
+    if( component->listening )
+        spa_hook_remove( &component->listener );
+    component->listening = 0;
+    if( component->pwStream )
+        pw_stream_destroy( component->pwStream );
+    component->pwStream = NULL;
+}
+
+/* Wait until the streams have been added to the graph and agreed on a format. Called with the loop locked. */
+static PaError WaitForNegotiation( PaPipeWireStream *stream )
+{
+    PaError result = paNoError;
+    PaPipeWireStreamComponent *components[2];
+    PaTime deadline = PaUtil_GetTime() + PA_PW_TIMEOUT;
+    int i, pending;
+
+    components[0] = &stream->capture;
+    components[1] = &stream->playback;
+    for( ;; )
+    {
+        pending = 0;
+        for( i = 0; i < 2; ++i )
+        {
+            const char *err = NULL;
+
+            if( !components[i]->pwStream )
+                continue;
+            if( components[i]->state == PW_STREAM_STATE_ERROR )
+            {
+                pw_stream_get_state( components[i]->pwStream, &err );
+                PaUtil_SetLastHostErrorInfo( paInDevelopment, -1, err ? err : "unknown error" );
+                result = paUnanticipatedHostError;
+                goto error;
+            }
+            if( components[i]->state < PW_STREAM_STATE_PAUSED )
+                pending = 1;
+        }
+        if( !pending )
+            break;
+
+        PA_UNLESS( !stream->hostApi->serverDown, paDeviceUnavailable );
+        PA_UNLESS( PaUtil_GetTime() < deadline, paTimedOut );
+        pw_thread_loop_timed_wait( stream->hostApi->loop, 1 );
+    }
+
+error:
+    return result;
+}
+
+static void CleanUpStream( PaPipeWireStream *stream, int terminateStreamRepresentation, int terminateBufferProcessor )
+{
+    assert( stream );
+
+    pw_thread_loop_lock( stream->hostApi->loop );
+    TerminateComponent( &stream->capture );
+    TerminateComponent( &stream->playback );
+    pw_thread_loop_unlock( stream->hostApi->loop );
+
+    if( stream->isBlockingStream )
+        PaUtil_TerminateBlockingIO( &stream->blockingIO );
+
+    if( terminateStreamRepresentation )
+        PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    if( terminateBufferProcessor )
+        PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+
+    if( stream->streamMemory )
+    {
+        PaUtil_FreeAllAllocations( stream->streamMemory );
+        PaUtil_DestroyAllocationGroup( stream->streamMemory );
+    }
+    PaUtil_FreeMemory( stream );
+}
+
+/* Cycles of a power of 2 frames making up about half the suggested latency, unless the user fixed the buffer size */
+static unsigned long ChooseQuantum( double sampleRate, unsigned long framesPerBuffer, PaTime suggestedLatency )
+{
+    unsigned long quantum = PA_PW_MIN_QUANTUM;
+    double target = suggestedLatency * sampleRate / 2;
+
+    if( framesPerBuffer != paFramesPerBufferUnspecified )
+        return PA_MAX( PA_MIN( framesPerBuffer, PA_PW_MAX_QUANTUM ), PA_PW_MIN_QUANTUM );
+
+    while( quantum * 2 <= target && quantum < PA_PW_MAX_QUANTUM )
+        quantum *= 2;
+    return quantum;
+}
+
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData )
+{
+    PaError result = paNoError;
+    PaPipeWireHostApiRepresentation *pwHostApi = (PaPipeWireHostApiRepresentation*)hostApi;
+    PaPipeWireStream *stream = NULL;
+    int inputChannelCount = 0, outputChannelCount = 0;
+    PaSampleFormat inputSampleFormat = 0, outputSampleFormat = 0;
+    PaSampleFormat hostInputSampleFormat = 0, hostOutputSampleFormat = 0;
+    const char *inputTarget = NULL, *outputTarget = NULL;
+    PaTime suggestedLatency = 0.;
+    int srInitialized = 0, bpInitialized = 0, locked = 0;
+
+    /* validate platform specific flags */
+    if( (streamFlags & paPlatformSpecificFlags) != 0 )
+        return paInvalidFlag; /* unexpected platform specific flag */
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    if( inputParameters )
+    {
+        inputChannelCount = inputParameters->channelCount;
+        inputSampleFormat = inputParameters->sampleFormat;
+        inputTarget = ((PaPipeWireDeviceInfo *)hostApi->deviceInfos[ inputParameters->device ])->target;
+        suggestedLatency = inputParameters->suggestedLatency;
+    }
+    if( outputParameters )
+    {
+        outputChannelCount = outputParameters->channelCount;
+        outputSampleFormat = outputParameters->sampleFormat;
+        outputTarget = ((PaPipeWireDeviceInfo *)hostApi->deviceInfos[ outputParameters->device ])->target;
+        suggestedLatency = PA_MAX( suggestedLatency, outputParameters->suggestedLatency );
+    }
+
+    /* PipeWire takes the user's formats. The capture half of a full duplex stream is interleaved, for its ring
+     * buffer */
+    hostInputSampleFormat = inputSampleFormat;
+    if( outputChannelCount > 0 )
+        hostInputSampleFormat &= ~paNonInterleaved;
+    hostOutputSampleFormat = outputSampleFormat;
+
+    PA_UNLESS( stream = (PaPipeWireStream*)PaUtil_AllocateMemory( sizeof(PaPipeWireStream) ), paInsufficientMemory );
+    memset( stream, 0, sizeof(PaPipeWireStream) );
+    PA_UNLESS( stream->streamMemory = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+    stream->hostApi = pwHostApi;
+    stream->capture.numChannels = inputChannelCount;
+    stream->playback.numChannels = outputChannelCount;
+    /* A batch of callbacks is several cycles, which follow the latency */
+    stream->quantum = ChooseQuantum( sampleRate, (streamFlags & paBatchCallbacks) ? paFramesPerBufferUnspecified
+            : framesPerBuffer, suggestedLatency );
+
+    /* the blocking emulation, if necessary */
+    stream->isBlockingStream = !streamCallback;
+    if( stream->isBlockingStream )
+    {
+        /* the latency the user asked for indicates the minimum buffer size in frames, three cycles at least */
+        unsigned long minimumBufferFrames = PA_MAX( (unsigned long)(suggestedLatency * sampleRate),
+                stream->quantum * 3 );
+
+        PA_ENSURE( PaUtil_InitializeBlockingIO( &stream->blockingIO, inputChannelCount, inputSampleFormat,
+                    outputChannelCount, outputSampleFormat, minimumBufferFrames ) );
+
+        /* install our own callback for the blocking API */
+        streamCallback = PaUtil_BlockingIOCallback;
+        userData = &stream->blockingIO;
+
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &pwHostApi->blockingStreamInterface, streamCallback, userData );
+    }
+    else
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &pwHostApi->callbackStreamInterface, streamCallback, userData );
+    }
+    srInitialized = 1;
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+
+    /* The buffer processor doesn't know the quantum, round a batch up to it here */
+    if( (streamFlags & paBatchCallbacks) && framesPerBuffer != paFramesPerBufferUnspecified )
+        framesPerBuffer = (framesPerBuffer + stream->quantum - 1) / stream->quantum * stream->quantum;
+
+    PA_ENSURE( PaUtil_InitializeBufferProcessor(
+                  &stream->bufferProcessor,
+                  inputChannelCount,
+                  inputSampleFormat,
+                  hostInputSampleFormat,
+                  outputChannelCount,
+                  outputSampleFormat,
+                  hostOutputSampleFormat,
+                  sampleRate,
+                  streamFlags,
+                  framesPerBuffer,
+                  0,                            /* Ignored */
+                  paUtilUnknownHostBufferSize,  /* The graph may change the quantum */
+                  streamCallback,
+                  userData ) );
+    bpInitialized = 1;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
+
+    /* The SPA buffers of a half duplex stream are in the user's format, only block adaption may be needed */
+    stream->canDirectCallback = !stream->isBlockingStream && !( inputChannelCount > 0 && outputChannelCount > 0 );
+
+    if( inputChannelCount > 0 && outputChannelCount > 0 )
+    {
+        unsigned long bytesPerFrame = Pa_GetSampleSize( hostInputSampleFormat ) * inputChannelCount;
+        void *ringData;
+
+        PA_UNLESS( ringData = PaUtil_GroupAllocateMemory( stream->streamMemory,
+                    bytesPerFrame * PA_PW_DUPLEX_RING_FRAMES ), paInsufficientMemory );
+        PA_UNLESS( stream->duplexInput = PaUtil_GroupAllocateMemory( stream->streamMemory,
+                    bytesPerFrame * PA_PW_MAX_QUANTUM ), paInsufficientMemory );
+        PA_UNLESS( PaUtil_InitializeSpscRingBuffer( &stream->duplexRing, bytesPerFrame, PA_PW_DUPLEX_RING_FRAMES,
+                    ringData ) == 0, paInternalError );
+    }
+
+    pw_thread_loop_lock( pwHostApi->loop );
+    locked = 1;
+    if( inputChannelCount > 0 )
+        PA_ENSURE( InitializeComponent( &stream->capture, stream, PW_DIRECTION_INPUT, inputChannelCount,
+                    hostInputSampleFormat, inputTarget, sampleRate ) );
+    if( outputChannelCount > 0 )
+        PA_ENSURE( InitializeComponent( &stream->playback, stream, PW_DIRECTION_OUTPUT, outputChannelCount,
+                    hostOutputSampleFormat, outputTarget, sampleRate ) );
+    PA_ENSURE( WaitForNegotiation( stream ) );
+    pw_thread_loop_unlock( pwHostApi->loop );
+    locked = 0;
+
+    /* A cycle being filled and one being played, besides what the buffer processor holds */
+    if( inputChannelCount > 0 )
+        stream->streamRepresentation.streamInfo.inputLatency = (stream->quantum
+                + PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+    if( outputChannelCount > 0 )
+        stream->streamRepresentation.streamInfo.outputLatency = (2 * stream->quantum
+                + PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )) / sampleRate;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+    PA_DEBUG(( "%s: Quantum %lu, direct callback %s\n", __FUNCTION__, stream->quantum,
+                stream->canDirectCallback ? "possible" : "not possible" ));
+
+    *s = (PaStream*)stream;
+
+    return result;
+
+error:
+    if( locked )
+        pw_thread_loop_unlock( pwHostApi->loop );
+    if( stream )
+        CleanUpStream( stream, srInitialized, bpInitialized );
+
+    return result;
+}
+
+/*
+    When CloseStream() is called, the multi-api layer ensures that
+    the stream has already been stopped or aborted.
+*/
+static PaError CloseStream( PaStream* s )
+{
+    CleanUpStream( (PaPipeWireStream*)s, 1, 1 );
+    return paNoError;
+}
+
+/* Activate or deactivate the pw_streams. Called with the loop locked. */
+static PaError SetStreamActive( PaPipeWireStream *stream, int active )
+{
+    PaError result = paNoError;
+
+    if( stream->capture.pwStream )
+        ENSURE_PW( pw_stream_set_active( stream->capture.pwStream, active ) );
+    if( stream->playback.pwStream )
+        ENSURE_PW( pw_stream_set_active( stream->playback.pwStream, active ) );
+
+error:
+    return result;
+}
+
+static PaError StartStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+
+    /* Ready the processor, the process callbacks don't run while the streams are inactive */
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    if( stream->capture.numChannels > 0 && stream->playback.numChannels > 0 )
+    {
+        PaUtil_FlushSpscRingBuffer( &stream->duplexRing );
+        stream->duplexOverflow = 0;
+    }
+    if( stream->isBlockingStream )
+        PaUtil_ResetBlockingIO( &stream->blockingIO );
+
+    stream->callbackResult = paContinue;
+    stream->doStop = stream->doAbort = 0;
+    stream->is_active = 1;
+    PaUtil_WriteMemoryBarrier();
+
+    pw_thread_loop_lock( stream->hostApi->loop );
+    result = SetStreamActive( stream, 1 );
+    pw_thread_loop_unlock( stream->hostApi->loop );
+    if( result != paNoError )
+        stream->is_active = 0;
+    PA_ENSURE( result );
+
+    stream->is_running = 1;
+    PA_DEBUG(( "%s: Stream started\n", __FUNCTION__ ));
+
+error:
+    return result;
+}
+
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
+/* Wait for the process callback to act on doStop or doAbort. A stop lets the buffer processor's output play
+ * first. Streams which aren't linked into the graph aren't processed and aren't waited for. */
+static PaError WaitForInactive( PaPipeWireStream *stream )
+{
+    PaError result = paNoError;
+    PaTime deadline = PaUtil_GetTime() + PA_PW_TIMEOUT;
+
+    while( stream->is_active )
+    {
+        if( stream->capture.state != PW_STREAM_STATE_STREAMING && stream->playback.state != PW_STREAM_STATE_STREAMING )
+            break;
+        PA_UNLESS( !stream->hostApi->serverDown, paDeviceUnavailable );
+        PA_UNLESS( PaUtil_GetTime() < deadline, paTimedOut );
+        Pa_Sleep( 1 );
+    }
+
+error:
+    return result;
+}
+
+static PaError RealStop( PaPipeWireStream *stream, int abort )
+{
+    PaError result = paNoError;
+    PaPipeWireStreamComponent *playback = &stream->playback;
+
+    /* Let the callback play what was written, allowing for a second of scheduling delays */
+    if( stream->isBlockingStream && !abort )
+        PaUtil_DrainBlockingIO( &stream->blockingIO,
+                PaUtil_GetBlockingIORingBufferFrames( &stream->blockingIO )
+                / stream->streamRepresentation.streamInfo.sampleRate + 1. );
+
+    if( abort )
+        stream->doAbort = 1;
+    else
+        stream->doStop = 1;
+    result = WaitForInactive( stream );
+
+    pw_thread_loop_lock( stream->hostApi->loop );
+    /* ... and the graph play the queued buffers */
+    if( !abort && result == paNoError && playback->pwStream && playback->state == PW_STREAM_STATE_STREAMING )
+    {
+        PaTime deadline = PaUtil_GetTime() + stream->streamRepresentation.streamInfo.outputLatency + 1.;
+
+        playback->drained = 0;
+        if( pw_stream_flush( playback->pwStream, true ) == 0 )
+        {
+            while( !playback->drained && !stream->hostApi->serverDown && PaUtil_GetTime() < deadline )
+                pw_thread_loop_timed_wait( stream->hostApi->loop, 1 );
+        }
+    }
+    if( SetStreamActive( stream, 0 ) != paNoError && result == paNoError )
+        result = paUnanticipatedHostError;
+    if( stream->capture.pwStream )
+        pw_stream_flush( stream->capture.pwStream, false );
+    if( playback->pwStream )
+        pw_stream_flush( playback->pwStream, false );
+    pw_thread_loop_unlock( stream->hostApi->loop );
+
+    /* An unlinked or timed out stream is deactivated now */
+    stream->is_active = 0;
+    stream->is_running = 0;
+    stream->doStop = stream->doAbort = 0;
+    if( stream->isBlockingStream )
+        PaUtil_StopBlockingIO( &stream->blockingIO );
+
+    PA_DEBUG(( "%s: Stream stopped\n", __FUNCTION__ ));
+
+    return result;
+}
+
+static PaError StopStream( PaStream *s )
+{
+    assert(s);
+    return RealStop( (PaPipeWireStream *)s, 0 );
+}
+
+static PaError AbortStream( PaStream *s )
+{
+    assert(s);
+    return RealStop( (PaPipeWireStream *)s, 1 );
+}
+
+static PaError IsStreamStopped( PaStream *s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    return !stream->is_running;
+}
+
+
+static PaError IsStreamActive( PaStream *s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    return stream->is_active;
+}
+
+
+/* While paused the streams stay active and the buffer processor outputs silence
+   instead of calling the callback, so resuming takes effect with the next cycle. */
+static PaError PauseStream( PaStream *s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
+static PaTime GetStreamTime( PaStream *s )
+{
+    (void)s; /* unused parameter */
+    return PaUtil_GetTime();
+}
+
+
+static double GetStreamCpuLoad( PaStream* s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
+}
+
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaPipeWireStream *stream = (PaPipeWireStream*)s;
+    return (signed long)sizeof(PaPipeWireStream)
+            + PaUtil_GetAllocationGroupMemoryUsage( stream->streamMemory )
+            + PaUtil_GetBlockingIOMemoryUsage( &stream->blockingIO )
+            + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+}
+
+PaError PaPipeWire_SetAppName( const char* name )
+{
+    if( !name )
+        return paBadBufferPtr;
+    appName_ = name;
+    return paNoError;
+}
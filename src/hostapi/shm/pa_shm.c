@@ -0,0 +1,1318 @@
+/*
+ * $Id$
+ * Portable Audio I/O Library shared memory host API implementation
+ *
+ * Based on the Open Source API proposed by Ross Bencina
+ * Copyright (c) 1999-2002 Ross Bencina, Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup unix_src
+
+ @brief Host API connecting the streams of different processes through named shared memory devices.
+
+ Each device is a ring buffer in a POSIX shared memory object, "/portaudio-<name>", created by whichever process
+ opens it first. A stream writing to a device's output fills the ring, a stream of another process reading the
+ device's input drains it, so of a pipeline of sandboxed processes one's output feeds the next one's input. One
+ stream may write to and one may read from a device at a time; the object stays around for later streams until it
+ is removed from /dev/shm.
+
+ The frames are interleaved float32 with the device's channel count, streams with fewer channels use the first
+ ones. The ring's memory is mapped twice in a row, so every transfer is a single contiguous region of the shared
+ memory, which the buffer processor converts from and to directly, or the callback gets itself.
+
+ A stream which writes but doesn't read is driven by the system clock, one host buffer per period. A stream which
+ reads is driven by its device's writer: the reader sleeps on a futex in the shared memory which the writer wakes
+ as it commits a host buffer, so the frames move on within microseconds. Without a writer the reader keeps the
+ clock's time, delivering silence. Full duplex streams read one device and write another, as the stages of a
+ pipeline do. A writer drops the frames the ring has no room for, a reader skips what would queue up beyond its
+ suggested latency.
+
+ The devices are configured from the environment at Pa_Initialize(), the same way by all processes involved:
+ - PA_SHM_DEVICES: a comma separated list of devices, each name[:channels[:rate]], for example
+   "mix:2,effects:2:44100". The channels default to 2 and the rate to 48000. Names consist of letters, digits,
+   '.', '_' and '-'. Without devices the host API isn't available.
+ - PA_SHM_RING_FRAMES: the capacity of the rings in frames, rounded up to a power of 2 (default 8192).
+*/
+
+
+#include <string.h>
+#include <stdlib.h> /* getenv(), strtol() */
+#include <stdio.h>  /* snprintf() */
+#include <time.h>   /* nanosleep() */
+#include <errno.h>
+#include <signal.h> /* kill() */
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "pa_util.h"
+#include "pa_unix_util.h"
+#include "pa_allocation.h"
+#include "pa_hostapi.h"
+#include "pa_stream.h"
+#include "pa_cpuload.h"
+#include "pa_process.h"
+#include "pa_probes.h"
+#include "pa_blockingio.h"
+#include "pa_ringbuffer.h"
+#include "pa_memorybarrier.h"
+#include "pa_debugprint.h"
+
+
+/* prototypes for functions declared in this file */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+PaError PaShm_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate );
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData );
+static PaError CloseStream( PaStream* stream );
+static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
+static PaError StopStream( PaStream *stream );
+static PaError AbortStream( PaStream *stream );
+static PaError IsStreamStopped( PaStream *s );
+static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaTime GetStreamTime( PaStream *stream );
+static double GetStreamCpuLoad( PaStream* stream );
+static PaError BlockingReadStream( PaStream* stream, void *buffer, unsigned long frames );
+static PaError BlockingWriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static signed long BlockingGetStreamReadAvailable( PaStream* stream );
+static signed long BlockingGetStreamWriteAvailable( PaStream* stream );
+static signed long GetStreamMemoryUsage( PaStream* stream );
+
+
+#if defined(__linux__) && defined(SYS_futex)
+#define PA_SHM_HAVE_FUTEX_
+#endif
+
+/** Identifies an initialized ring, "PASH" */
+#define PA_SHM_MAGIC_ (0x50415348)
+/** Version of the layout of PaShmRingHeader, processes must agree on it */
+#define PA_SHM_VERSION_ (1)
+#define PA_SHM_MAX_NAME_ (64)
+#define PA_SHM_MAX_CHANNELS_ (64)
+#define PA_SHM_DEFAULT_CHANNELS_ (2)
+#define PA_SHM_DEFAULT_SAMPLE_RATE_ (48000)
+#define PA_SHM_DEFAULT_RING_FRAMES_ (8192)
+#define PA_SHM_MAX_RING_FRAMES_ (1 << 20)
+/** Smallest host buffer size derived from a suggested latency */
+#define PA_SHM_MIN_PERIOD_FRAMES_ (16)
+/** Seconds to wait for the process creating a ring to initialize it */
+#define PA_SHM_CREATE_TIMEOUT_ (1.)
+/** Seconds between looks at the ring while a reader waits, without futexes */
+#define PA_SHM_POLL_SECONDS_ (0.00025)
+
+/** The start of a device's shared memory object, followed by the ring's frames from the next page on.
+ The indices count frames and run freely, wrapping at 2^32. */
+typedef struct PaShmRingHeader
+{
+    /* constant once magic is set by the process creating the ring */
+    volatile uint32_t magic;
+    uint32_t version;
+    uint32_t channels;
+    uint32_t sampleRate;
+    uint32_t ringFrames;        /**< Power of 2 */
+    uint32_t dataOffset;        /**< Bytes from the start of the object to the frames, a page multiple */
+
+    char padding0[PA_RING_BUFFER_PADDING];
+
+    /* writer */
+    volatile uint32_t writeIndex;
+    volatile uint32_t writerPid;        /**< The process writing, 0 if none */
+    volatile int32_t dataSequence;      /**< Futex word, bumped after writeIndex advanced */
+
+    char padding1[PA_RING_BUFFER_PADDING];
+
+    /* reader */
+    volatile uint32_t readIndex;
+    volatile uint32_t readerPid;        /**< The process reading, 0 if none */
+    volatile int32_t readerSleeping;    /**< The reader waits on dataSequence */
+
+    char padding2[PA_RING_BUFFER_PADDING];
+}
+PaShmRingHeader;
+
+typedef struct
+{
+    PaDeviceInfo baseDeviceInfo;
+
+    char objectName[PA_SHM_MAX_NAME_ + 16];     /**< Of the shared memory object, "/portaudio-<name>" */
+    int channels;
+}
+PaShmDeviceInfo;
+
+/* PaShmHostApiRepresentation - host api datastructure specific to this implementation */
+
+typedef struct
+{
+    PaUtilHostApiRepresentation inheritedHostApiRep;
+    PaUtilStreamInterface callbackStreamInterface;
+    PaUtilStreamInterface blockingStreamInterface;
+
+    PaUtilAllocationGroup *allocations;
+
+    uint32_t ringFrames;
+}
+PaShmHostApiRepresentation;
+
+/** A stream's mapping of a device's ring, as its reader or its writer */
+typedef struct
+{
+    PaShmRingHeader *header;
+    long headerBytes;
+    unsigned char *frames;      /**< Mapped twice in a row */
+    long framesBytes;
+    uint32_t ringFrames;
+    unsigned long bytesPerFrame;
+    int channels;
+    volatile uint32_t *owner;   /**< header->writerPid or header->readerPid, once claimed */
+}
+PaShmRing;
+
+
+/* PaShmStream - a stream data structure specifically for this implementation */
+
+typedef struct PaShmStream
+{
+    PaUtilStreamRepresentation streamRepresentation;
+    PaUtilCpuLoadMeasurer cpuLoadMeasurer;
+    PaUtilBufferProcessor bufferProcessor;
+
+    PaShmHostApiRepresentation *shmHostApi;
+
+    int inputChannelCount;
+    int outputChannelCount;
+    PaShmRing input;            /**< Read, if inputChannelCount > 0 */
+    PaShmRing output;           /**< Written, if outputChannelCount > 0 */
+    unsigned long framesPerHostBuffer;
+    /** Frames a reader lets queue up before it skips them */
+    uint32_t maxQueuedFrames;
+    double sampleRate;
+    /** Silence for a reader without frames, room for frames a writer drops */
+    unsigned char *inputScratch;
+    unsigned char *outputScratch;
+    int canDirectCallback;
+
+    int isBlockingStream;
+    PaUtilBlockingIO blockingIO;
+
+    PaUnixThread thread;
+    volatile sig_atomic_t isActive;
+    volatile sig_atomic_t isStopped;
+}
+PaShmStream;
+
+
+/* ---- blocking emulation layer ---- */
+
+static PaError BlockingReadStream( PaStream* s, void *data, unsigned long numFrames )
+{
+    PaShmStream *stream = (PaShmStream *)s;
+
+    return PaUtil_ReadBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static PaError BlockingWriteStream( PaStream* s, const void *data, unsigned long numFrames )
+{
+    PaShmStream *stream = (PaShmStream *)s;
+
+    return PaUtil_WriteBlockingIO( &stream->blockingIO, data, numFrames );
+}
+
+static signed long BlockingGetStreamReadAvailable( PaStream* s )
+{
+    PaShmStream *stream = (PaShmStream *)s;
+
+    return PaUtil_GetBlockingIOReadAvailable( &stream->blockingIO );
+}
+
+static signed long BlockingGetStreamWriteAvailable( PaStream* s )
+{
+    PaShmStream *stream = (PaShmStream *)s;
+
+    return PaUtil_GetBlockingIOWriteAvailable( &stream->blockingIO );
+}
+
+
+/* ---- devices ---- */
+
+static int IsValidName( const char *name )
+{
+    size_t i, length = strlen( name );
+
+    if( length == 0 || length > PA_SHM_MAX_NAME_ )
+        return 0;
+    for( i = 0; i < length; ++i )
+    {
+        char c = name[i];
+        if( !( (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                    || c == '.' || c == '_' || c == '-' ) )
+            return 0;
+    }
+    return 1;
+}
+
+
+/** Parse one name[:channels[:rate]] entry of PA_SHM_DEVICES into deviceInfo, the entry is modified.
+ @return 0 if it's malformed. */
+static int ParseDevice( PaShmHostApiRepresentation *shmHostApi, PaShmDeviceInfo *deviceInfo, char *entry )
+{
+    PaDeviceInfo *baseDeviceInfo = &deviceInfo->baseDeviceInfo;
+    char *channels = strchr( entry, ':' ), *rate = NULL, *end;
+    long value;
+    char *name;
+
+    baseDeviceInfo->defaultSampleRate = PA_SHM_DEFAULT_SAMPLE_RATE_;
+    deviceInfo->channels = PA_SHM_DEFAULT_CHANNELS_;
+    if( channels )
+    {
+        *channels++ = '\0';
+        if( (rate = strchr( channels, ':' )) )
+            *rate++ = '\0';
+        value = strtol( channels, &end, 10 );
+        if( *end || value < 1 || value > PA_SHM_MAX_CHANNELS_ )
+            return 0;
+        deviceInfo->channels = (int)value;
+    }
+    if( rate )
+    {
+        value = strtol( rate, &end, 10 );
+        if( *end || value < 1000 || value > 768000 )
+            return 0;
+        baseDeviceInfo->defaultSampleRate = value;
+    }
+    if( !IsValidName( entry ) )
+        return 0;
+
+    if( !(name = (char*)PaUtil_GroupAllocateMemory( shmHostApi->allocations, (long)strlen( entry ) + 1 )) )
+        return 0;
+    strcpy( name, entry );
+    baseDeviceInfo->name = name;
+    snprintf( deviceInfo->objectName, sizeof (deviceInfo->objectName), "/portaudio-%s", entry );
+    return 1;
+}
+
+
+/** Build the device list from PA_SHM_DEVICES */
+static PaError BuildDeviceList( PaShmHostApiRepresentation *shmHostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaUtilHostApiRepresentation *commonApi = &shmHostApi->inheritedHostApiRep;
+    const char *devices = getenv( "PA_SHM_DEVICES" );
+    PaShmDeviceInfo *deviceInfos;
+    char *list, *entry, *next;
+    int maxDevices = 1, i;
+
+    commonApi->info.deviceCount = 0;
+    commonApi->info.defaultInputDevice = paNoDevice;
+    commonApi->info.defaultOutputDevice = paNoDevice;
+    if( !devices || !*devices )
+        return result;
+
+    for( i = 0; devices[i]; ++i )
+    {
+        if( devices[i] == ',' )
+            ++maxDevices;
+    }
+
+    PA_UNLESS( list = (char*)PaUtil_GroupAllocateMemory( shmHostApi->allocations, (long)strlen( devices ) + 1 ),
+            paInsufficientMemory );
+    strcpy( list, devices );
+    PA_UNLESS( commonApi->deviceInfos = (PaDeviceInfo**)PaUtil_GroupAllocateMemory( shmHostApi->allocations,
+                sizeof(PaDeviceInfo*) * maxDevices ), paInsufficientMemory );
+    PA_UNLESS( deviceInfos = (PaShmDeviceInfo*)PaUtil_GroupAllocateMemory( shmHostApi->allocations,
+                sizeof(PaShmDeviceInfo) * maxDevices ), paInsufficientMemory );
+    memset( deviceInfos, 0, sizeof(PaShmDeviceInfo) * maxDevices );
+
+    for( entry = list; entry; entry = next )
+    {
+        PaShmDeviceInfo *deviceInfo = &deviceInfos[commonApi->info.deviceCount];
+        PaDeviceInfo *baseDeviceInfo = &deviceInfo->baseDeviceInfo;
+        PaTime period;
+
+        if( (next = strchr( entry, ',' )) )
+            *next++ = '\0';
+        if( !*entry )
+            continue;
+        if( !ParseDevice( shmHostApi, deviceInfo, entry ) )
+        {
+            PA_DEBUG(( "%s: Ignoring malformed device '%s'\n", __FUNCTION__, entry ));
+            continue;
+        }
+
+        /* The latencies are the host buffers, which can be as short as the callback wants */
+        period = PA_SHM_MIN_PERIOD_FRAMES_ * 4 / baseDeviceInfo->defaultSampleRate;
+        baseDeviceInfo->structVersion = 2;
+        baseDeviceInfo->hostApi = hostApiIndex;
+        baseDeviceInfo->maxInputChannels = deviceInfo->channels;
+        baseDeviceInfo->maxOutputChannels = deviceInfo->channels;
+        baseDeviceInfo->defaultLowInputLatency = period;
+        baseDeviceInfo->defaultLowOutputLatency = period;
+        baseDeviceInfo->defaultHighInputLatency = 16 * period;
+        baseDeviceInfo->defaultHighOutputLatency = 16 * period;
+
+        commonApi->deviceInfos[commonApi->info.deviceCount++] = baseDeviceInfo;
+    }
+
+    if( commonApi->info.deviceCount > 0 )
+    {
+        commonApi->info.defaultInputDevice = 0;
+        commonApi->info.defaultOutputDevice = 0;
+    }
+
+error:
+    return result;
+}
+
+
+PaError PaShm_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex hostApiIndex )
+{
+    PaError result = paNoError;
+    PaShmHostApiRepresentation *shmHostApi;
+    const char *ringFrames = getenv( "PA_SHM_RING_FRAMES" );
+    long pageSize = sysconf( _SC_PAGESIZE );
+
+    *hostApi = NULL;
+
+    PA_UNLESS( shmHostApi = (PaShmHostApiRepresentation*)PaUtil_AllocateMemory(
+                sizeof(PaShmHostApiRepresentation) ), paInsufficientMemory );
+    memset( shmHostApi, 0, sizeof(PaShmHostApiRepresentation) );
+    /* matched in Terminate(), which the error path calls */
+    PA_ENSURE( PaUnixThreading_Initialize() );
+    PA_UNLESS( shmHostApi->allocations = PaUtil_CreateAllocationGroup(), paInsufficientMemory );
+
+    /* A power of 2 of whole pages even of mono frames, so that the frames can be mirrored */
+    shmHostApi->ringFrames = PA_SHM_DEFAULT_RING_FRAMES_;
+    if( ringFrames && *ringFrames )
+        shmHostApi->ringFrames = (uint32_t)PA_MIN( PA_MAX( atol( ringFrames ), 1 ), PA_SHM_MAX_RING_FRAMES_ );
+    if( pageSize <= 0 )
+        pageSize = 4096;
+    shmHostApi->ringFrames = PA_MAX( shmHostApi->ringFrames, (uint32_t)(pageSize / sizeof(float)) );
+    while( shmHostApi->ringFrames & (shmHostApi->ringFrames - 1) )
+        shmHostApi->ringFrames += shmHostApi->ringFrames & -shmHostApi->ringFrames;
+
+    PA_ENSURE( BuildDeviceList( shmHostApi, hostApiIndex ) );
+    /* Without devices this API cannot be used. The V19 development docs say that if an implementation
+     * detects that it cannot be used, it should return a NULL interface and paNoError */
+    if( shmHostApi->inheritedHostApiRep.info.deviceCount == 0 )
+    {
+        PA_DEBUG(( "%s: No devices in PA_SHM_DEVICES\n", __FUNCTION__ ));
+        Terminate( &shmHostApi->inheritedHostApiRep );
+        return paNoError;
+    }
+
+    *hostApi = &shmHostApi->inheritedHostApiRep;
+    (*hostApi)->info.structVersion = 1;
+    (*hostApi)->info.type = paInDevelopment;
+    (*hostApi)->info.name = "Shared Memory";
+
+    (*hostApi)->Terminate = Terminate;
+    (*hostApi)->OpenStream = OpenStream;
+    (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
+
+    PaUtil_InitializeStreamInterface( &shmHostApi->callbackStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, GetStreamCpuLoad,
+                                      PaUtil_DummyRead, PaUtil_DummyWrite,
+                                      PaUtil_DummyGetReadAvailable, PaUtil_DummyGetWriteAvailable );
+    shmHostApi->callbackStreamInterface.Pause = PauseStream;
+    shmHostApi->callbackStreamInterface.Resume = ResumeStream;
+    shmHostApi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+
+    PaUtil_InitializeStreamInterface( &shmHostApi->blockingStreamInterface, CloseStream, StartStream,
+                                      StopStream, AbortStream, IsStreamStopped, IsStreamActive,
+                                      GetStreamTime, PaUtil_DummyGetCpuLoad,
+                                      BlockingReadStream, BlockingWriteStream,
+                                      BlockingGetStreamReadAvailable, BlockingGetStreamWriteAvailable );
+
+    PA_DEBUG(( "%s: %d devices, rings of %u frames\n", __FUNCTION__, (*hostApi)->info.deviceCount,
+               (unsigned)shmHostApi->ringFrames ));
+
+    return result;
+
+error:
+    if( shmHostApi )
+        Terminate( &shmHostApi->inheritedHostApiRep );
+    return result;
+}
+
+
+static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
+{
+    PaShmHostApiRepresentation *shmHostApi = (PaShmHostApiRepresentation*)hostApi;
+
+    if( shmHostApi->allocations )
+    {
+        PaUtil_FreeAllAllocations( shmHostApi->allocations );
+        PaUtil_DestroyAllocationGroup( shmHostApi->allocations );
+    }
+
+    PaUtil_FreeMemory( shmHostApi );
+
+    PaUnixThreading_Terminate();
+}
+
+
+/** Checks common to IsFormatSupported and OpenStream for one direction of a stream. */
+static PaError ValidateParameters( struct PaUtilHostApiRepresentation *hostApi,
+                                   const PaStreamParameters *parameters, int isInput, double sampleRate )
+{
+    const PaDeviceInfo *deviceInfo;
+
+    if( !parameters )
+        return paNoError;
+
+    /* all standard sample formats are supported by the buffer adapter,
+        this implementation doesn't support any custom sample formats */
+    if( parameters->sampleFormat & paCustomFormat )
+        return paSampleFormatNotSupported;
+
+    /* alternate device specification isn't supported */
+    if( parameters->device == paUseHostApiSpecificDeviceSpecification )
+        return paInvalidDevice;
+
+    deviceInfo = hostApi->deviceInfos[ parameters->device ];
+    if( parameters->channelCount > (isInput ? deviceInfo->maxInputChannels : deviceInfo->maxOutputChannels) )
+        return paInvalidChannelCount;
+
+    /* the writer and the reader of a ring run at the device's rate, nothing resamples */
+    if( sampleRate != deviceInfo->defaultSampleRate )
+        return paInvalidSampleRate;
+
+    /* this implementation doesn't use custom stream info */
+    if( parameters->hostApiSpecificStreamInfo )
+        return paIncompatibleHostApiSpecificStreamInfo;
+
+    return paNoError;
+}
+
+
+static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
+                                  const PaStreamParameters *inputParameters,
+                                  const PaStreamParameters *outputParameters,
+                                  double sampleRate )
+{
+    PaError result = paNoError;
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+
+    /* a full duplex stream on one device would read back its own output */
+    if( inputParameters && outputParameters && inputParameters->device == outputParameters->device )
+        return paInvalidDevice;
+
+    return paFormatIsSupported;
+
+error:
+    return result;
+}
+
+
+/* ---- rings ---- */
+
+/** Take the side of the ring whose process id is *owner for this process. The side of a process which died
+ without releasing it is taken over. */
+static PaError ClaimRing( PaShmRing *ring, volatile uint32_t *owner )
+{
+    uint32_t pid = (uint32_t)getpid(), current;
+
+    for( ;; )
+    {
+        current = *owner;
+        if( current == pid || (current != 0 && (kill( (pid_t)current, 0 ) == 0 || errno != ESRCH)) )
+        {
+            PA_DEBUG(( "%s: Ring in use by process %u\n", __FUNCTION__, (unsigned)current ));
+            return paDeviceUnavailable;
+        }
+        if( __sync_bool_compare_and_swap( owner, current, pid ) )
+            break;
+    }
+    ring->owner = owner;
+    return paNoError;
+}
+
+
+static void UnmapRing( PaShmRing *ring )
+{
+    if( ring->owner )
+        __sync_bool_compare_and_swap( ring->owner, (uint32_t)getpid(), 0 );
+    ring->owner = NULL;
+    PaUnix_UnmapMirroredFile( ring->frames, ring->framesBytes );
+    ring->frames = NULL;
+    if( ring->header )
+        munmap( ring->header, ring->headerBytes );
+    ring->header = NULL;
+}
+
+
+/** Open, or create and initialize, the ring of a device and map it. A creating process fills in the header and
+ sets its magic last, the others wait for that and check that they agree on the ring's geometry. */
+static PaError MapRing( PaShmRing *ring, const PaShmDeviceInfo *deviceInfo, uint32_t ringFrames, int isWriter )
+{
+    PaError result = paNoError;
+    long pageSize = sysconf( _SC_PAGESIZE );
+    PaTime deadline = PaUtil_GetTime() + PA_SHM_CREATE_TIMEOUT_;
+    struct stat status;
+    PaShmRingHeader *header;
+    int fd, created = 1;
+
+    if( pageSize <= 0 )
+        pageSize = 4096;
+    ring->channels = deviceInfo->channels;
+    ring->bytesPerFrame = sizeof(float) * deviceInfo->channels;
+    ring->ringFrames = ringFrames;
+    ring->headerBytes = (sizeof(PaShmRingHeader) + pageSize - 1) / pageSize * pageSize;
+    ring->framesBytes = (long)ring->bytesPerFrame * ringFrames;
+
+    if( (fd = shm_open( deviceInfo->objectName, O_RDWR | O_CREAT | O_EXCL, 0600 )) == -1 && errno == EEXIST )
+    {
+        created = 0;
+        fd = shm_open( deviceInfo->objectName, O_RDWR, 0 );
+    }
+    if( fd == -1 )
+    {
+        PaUtil_SetLastHostErrorInfo( paInDevelopment, errno, strerror( errno ) );
+        PA_DEBUG(( "%s: Couldn't open %s: %s\n", __FUNCTION__, deviceInfo->objectName, strerror( errno ) ));
+        return paUnanticipatedHostError;
+    }
+
+    if( created )
+    {
+        PA_UNLESS( ftruncate( fd, ring->headerBytes + ring->framesBytes ) == 0, paInsufficientMemory );
+    }
+    else
+    {
+        /* the creator may not have sized it yet */
+        while( fstat( fd, &status ) == 0 && status.st_size < ring->headerBytes )
+        {
+            PA_UNLESS( PaUtil_GetTime() < deadline, paTimedOut );
+            Pa_Sleep( 1 );
+        }
+    }
+
+    header = (PaShmRingHeader*)mmap( NULL, ring->headerBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    PA_UNLESS( header != MAP_FAILED, paInsufficientMemory );
+    ring->header = header;
+
+    if( created )
+    {
+        header->version = PA_SHM_VERSION_;
+        header->channels = deviceInfo->channels;
+        header->sampleRate = (uint32_t)deviceInfo->baseDeviceInfo.defaultSampleRate;
+        header->ringFrames = ringFrames;
+        header->dataOffset = (uint32_t)ring->headerBytes;
+        PaUtil_WriteMemoryBarrier();
+        header->magic = PA_SHM_MAGIC_;
+    }
+    else
+    {
+        while( header->magic != PA_SHM_MAGIC_ )
+        {
+            PA_UNLESS( PaUtil_GetTime() < deadline, paTimedOut );
+            Pa_Sleep( 1 );
+        }
+        PaUtil_ReadMemoryBarrier();
+        if( header->version != PA_SHM_VERSION_ || header->channels != (uint32_t)deviceInfo->channels
+                || header->sampleRate != (uint32_t)deviceInfo->baseDeviceInfo.defaultSampleRate
+                || header->ringFrames != ringFrames || header->dataOffset != (uint32_t)ring->headerBytes )
+        {
+            PA_DEBUG(( "%s: %s has %u channels at %u Hz, %u frames, expected %d at %.0f Hz, %u\n", __FUNCTION__,
+                        deviceInfo->objectName, (unsigned)header->channels, (unsigned)header->sampleRate,
+                        (unsigned)header->ringFrames, deviceInfo->channels,
+                        deviceInfo->baseDeviceInfo.defaultSampleRate, (unsigned)ringFrames ));
+            PaUtil_SetLastHostErrorInfo( paInDevelopment, 0, "Shared memory device configured differently" );
+            result = paUnanticipatedHostError;
+            goto error;
+        }
+    }
+
+    PA_ENSURE( ClaimRing( ring, isWriter ? &header->writerPid : &header->readerPid ) );
+    PA_UNLESS( ring->frames = (unsigned char*)PaUnix_MapMirroredFile( fd, ring->headerBytes, ring->framesBytes ),
+            paInsufficientMemory );
+    close( fd );
+
+    PA_DEBUG(( "%s: %s %s as %s\n", __FUNCTION__, created ? "Created" : "Opened", deviceInfo->objectName,
+                isWriter ? "writer" : "reader" ));
+    return result;
+
+error:
+    close( fd );
+    UnmapRing( ring );
+    return result;
+}
+
+
+/** Sleep until the writer bumps the ring's dataSequence from sequence, or for delay seconds */
+static void SleepOnRing( PaShmRing *ring, int32_t sequence, PaTime delay )
+{
+    struct timespec ts;
+
+#ifdef PA_SHM_HAVE_FUTEX_
+    ts.tv_sec = (time_t)delay;
+    ts.tv_nsec = (long)((delay - ts.tv_sec) * 1e9);
+    /* Full barrier: either the writer sees us sleeping, or we see the new sequence */
+    __sync_fetch_and_add( &ring->header->readerSleeping, 1 );
+    if( ring->header->dataSequence == sequence )
+        syscall( SYS_futex, &ring->header->dataSequence, FUTEX_WAIT, sequence, &ts, NULL, 0 );
+    __sync_fetch_and_sub( &ring->header->readerSleeping, 1 );
+#else
+    (void)sequence; /* unused parameter */
+    delay = PA_MIN( delay, PA_SHM_POLL_SECONDS_ );
+    ts.tv_sec = 0;
+    ts.tv_nsec = (long)(delay * 1e9);
+    nanosleep( &ts, NULL );
+#endif
+}
+
+
+/** Wait until the ring holds frames frames, or the deadline passes.
+ @return The frames the ring holds. */
+static uint32_t WaitForFrames( PaShmRing *ring, uint32_t frames, PaTime deadline )
+{
+    PaShmRingHeader *header = ring->header;
+    uint32_t available;
+    int32_t sequence;
+    PaTime delay;
+
+    for( ;; )
+    {
+        sequence = header->dataSequence;
+        PaUtil_FullMemoryBarrier();
+        available = header->writeIndex - header->readIndex;
+        if( available >= frames || (delay = deadline - PaUtil_GetTime()) <= 0. )
+            break;
+        SleepOnRing( ring, sequence, delay );
+    }
+    PaUtil_ReadMemoryBarrier();
+    return available;
+}
+
+
+/** Publish frames written to the ring, and wake its reader */
+static void CommitFrames( PaShmRing *ring, uint32_t frames )
+{
+    PaShmRingHeader *header = ring->header;
+
+    PaUtil_WriteMemoryBarrier();
+    header->writeIndex += frames;
+    __sync_fetch_and_add( &header->dataSequence, 1 );
+#ifdef PA_SHM_HAVE_FUTEX_
+    if( header->readerSleeping )
+        syscall( SYS_futex, &header->dataSequence, FUTEX_WAKE, 1, NULL, NULL, 0 );
+#endif
+}
+
+
+/* ---- streams ---- */
+
+static void CleanUpStream( PaShmStream *stream )
+{
+    UnmapRing( &stream->input );
+    UnmapRing( &stream->output );
+    if( stream->isBlockingStream )
+        PaUtil_TerminateBlockingIO( &stream->blockingIO );
+    PaUtil_FreeMemory( stream->inputScratch );
+    PaUtil_FreeMemory( stream->outputScratch );
+    PaUtil_FreeMemory( stream );
+}
+
+
+/* see pa_hostapi.h for a list of validity guarantees made about OpenStream parameters */
+
+static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
+                           PaStream** s,
+                           const PaStreamParameters *inputParameters,
+                           const PaStreamParameters *outputParameters,
+                           double sampleRate,
+                           unsigned long framesPerBuffer,
+                           PaStreamFlags streamFlags,
+                           PaStreamCallback *streamCallback,
+                           void *userData )
+{
+    PaError result = paNoError;
+    PaShmHostApiRepresentation *shmHostApi = (PaShmHostApiRepresentation*)hostApi;
+    PaShmStream *stream = NULL;
+    unsigned long framesPerHostBuffer;
+    int inputChannelCount = 0, outputChannelCount = 0;
+    PaSampleFormat inputSampleFormat = paFloat32, outputSampleFormat = paFloat32;
+    PaTime suggestedLatency = 0.;
+    int bpInitialized = 0;
+
+    /* validate platform specific flags */
+    if( (streamFlags & paPlatformSpecificFlags) != 0 )
+        return paInvalidFlag; /* unexpected platform specific flag */
+
+    PA_ENSURE( ValidateParameters( hostApi, inputParameters, 1, sampleRate ) );
+    PA_ENSURE( ValidateParameters( hostApi, outputParameters, 0, sampleRate ) );
+    if( inputParameters && outputParameters && inputParameters->device == outputParameters->device )
+        return paInvalidDevice;
+
+    if( inputParameters )
+    {
+        inputChannelCount = inputParameters->channelCount;
+        inputSampleFormat = inputParameters->sampleFormat;
+        suggestedLatency = inputParameters->suggestedLatency;
+    }
+    if( outputParameters )
+    {
+        outputChannelCount = outputParameters->channelCount;
+        outputSampleFormat = outputParameters->sampleFormat;
+        suggestedLatency = PA_MAX( suggestedLatency, outputParameters->suggestedLatency );
+    }
+
+    /* The host buffer size is the callback buffer size, unless the callbacks are batched, else half the
+        suggested latency (double buffering) */
+    if( framesPerBuffer != paFramesPerBufferUnspecified && !(streamFlags & paBatchCallbacks) )
+        framesPerHostBuffer = framesPerBuffer;
+    else
+        framesPerHostBuffer = (unsigned long)(suggestedLatency * sampleRate / 2);
+    framesPerHostBuffer = PA_MAX( framesPerHostBuffer, PA_SHM_MIN_PERIOD_FRAMES_ );
+    framesPerHostBuffer = PA_MIN( framesPerHostBuffer, shmHostApi->ringFrames / 4 );
+
+    PA_UNLESS( stream = (PaShmStream*)PaUtil_AllocateMemory( sizeof(PaShmStream) ), paInsufficientMemory );
+    memset( stream, 0, sizeof(PaShmStream) );
+    stream->shmHostApi = shmHostApi;
+    stream->inputChannelCount = inputChannelCount;
+    stream->outputChannelCount = outputChannelCount;
+    stream->framesPerHostBuffer = framesPerHostBuffer;
+    stream->sampleRate = sampleRate;
+    stream->isStopped = 1;
+    /* a reader keeps up to the suggested latency queued, at least two host buffers */
+    stream->maxQueuedFrames = (uint32_t)PA_MIN( PA_MAX( (unsigned long)(suggestedLatency * sampleRate),
+                2 * framesPerHostBuffer ), shmHostApi->ringFrames - framesPerHostBuffer );
+
+    if( inputParameters )
+    {
+        PA_ENSURE( MapRing( &stream->input, (PaShmDeviceInfo*)hostApi->deviceInfos[ inputParameters->device ],
+                    shmHostApi->ringFrames, 0 ) );
+        PA_UNLESS( stream->inputScratch = (unsigned char*)PaUtil_AllocateMemory(
+                    framesPerHostBuffer * stream->input.bytesPerFrame ), paInsufficientMemory );
+        memset( stream->inputScratch, 0, framesPerHostBuffer * stream->input.bytesPerFrame );
+    }
+    if( outputParameters )
+    {
+        PA_ENSURE( MapRing( &stream->output, (PaShmDeviceInfo*)hostApi->deviceInfos[ outputParameters->device ],
+                    shmHostApi->ringFrames, 1 ) );
+        PA_UNLESS( stream->outputScratch = (unsigned char*)PaUtil_AllocateMemory(
+                    framesPerHostBuffer * stream->output.bytesPerFrame ), paInsufficientMemory );
+    }
+
+    /* the blocking emulation, if necessary */
+    stream->isBlockingStream = !streamCallback;
+    if( stream->isBlockingStream )
+    {
+        /* the latency the user asked for indicates the minimum buffer size in frames, three host buffers at least */
+        unsigned long minimumBufferFrames = PA_MAX( (unsigned long)(suggestedLatency * sampleRate),
+                framesPerHostBuffer * 3 );
+
+        PA_ENSURE( PaUtil_InitializeBlockingIO( &stream->blockingIO, inputChannelCount, inputSampleFormat,
+                    outputChannelCount, outputSampleFormat, minimumBufferFrames ) );
+
+        /* install our own callback for the blocking API */
+        streamCallback = PaUtil_BlockingIOCallback;
+        userData = &stream->blockingIO;
+
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &shmHostApi->blockingStreamInterface, streamCallback, userData );
+    }
+    else
+    {
+        PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
+                                               &shmHostApi->callbackStreamInterface, streamCallback, userData );
+    }
+
+    PaUtil_InitializeCpuLoadMeasurer( &stream->cpuLoadMeasurer, sampleRate );
+
+    PA_ENSURE( PaUtil_InitializeBufferProcessor( &stream->bufferProcessor,
+              inputChannelCount, inputSampleFormat, paFloat32,
+              outputChannelCount, outputSampleFormat, paFloat32,
+              sampleRate, streamFlags, PaUtil_GetBatchedFramesPerUserBuffer( streamFlags, framesPerBuffer, framesPerHostBuffer ),
+              framesPerHostBuffer, paUtilFixedHostBufferSize,
+              streamCallback, userData ) );
+    bpInitialized = 1;
+
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
+    stream->streamRepresentation.GetMemoryUsage = GetStreamMemoryUsage;
+
+    /* Frames in the ring in the stream's format, the callback can have them where it asks for all channels */
+    stream->canDirectCallback = !stream->isBlockingStream
+            && ( framesPerBuffer == paFramesPerBufferUnspecified || framesPerBuffer == framesPerHostBuffer )
+            && ( !inputParameters || (inputSampleFormat == paFloat32 && inputChannelCount == stream->input.channels) )
+            && ( !outputParameters
+                    || (outputSampleFormat == paFloat32 && outputChannelCount == stream->output.channels) );
+
+    /* A reader waits for a host buffer the writer commits right away */
+    stream->streamRepresentation.streamInfo.inputLatency = inputParameters ?
+            (PaTime)(PaUtil_GetBufferProcessorInputLatencyFrames( &stream->bufferProcessor )
+                    + framesPerHostBuffer) / sampleRate : 0.;
+    stream->streamRepresentation.streamInfo.outputLatency = outputParameters ?
+            (PaTime)(PaUtil_GetBufferProcessorOutputLatencyFrames( &stream->bufferProcessor )
+                    + framesPerHostBuffer) / sampleRate : 0.;
+    stream->streamRepresentation.streamInfo.sampleRate = sampleRate;
+
+    *s = (PaStream*)stream;
+
+    return result;
+
+error:
+    if( stream )
+    {
+        if( bpInitialized )
+            PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+        CleanUpStream( stream );
+    }
+
+    return result;
+}
+
+
+/** Sleep until the given PaUtil_GetTime() time. */
+static void SleepUntil( PaTime deadline )
+{
+    PaTime delay;
+
+    while( (delay = deadline - PaUtil_GetTime()) > 0. )
+    {
+        struct timespec ts;
+        ts.tv_sec = (time_t)delay;
+        ts.tv_nsec = (long)((delay - ts.tv_sec) * 1e9);
+        nanosleep( &ts, NULL );
+    }
+}
+
+
+/** Register the host buffers with the buffer processor, frames of the ring's channel count each. */
+static void SetHostChannels( PaShmStream *stream, void *input, void *output, unsigned long frames )
+{
+    int i;
+
+    if( input )
+    {
+        PaUtil_SetInputFrameCount( &stream->bufferProcessor, frames );
+        for( i = 0; i < stream->inputChannelCount; ++i )
+            PaUtil_SetInputChannel( &stream->bufferProcessor, i, (float*)input + i, stream->input.channels );
+    }
+    if( output )
+    {
+        PaUtil_SetOutputFrameCount( &stream->bufferProcessor, frames );
+        for( i = 0; i < stream->outputChannelCount; ++i )
+            PaUtil_SetOutputChannel( &stream->bufferProcessor, i, (float*)output + i, stream->output.channels );
+    }
+}
+
+
+/** Run one host buffer. input and output point into the rings, or to the scratch buffers. */
+static void ProcessBuffer( PaShmStream *stream, void *input, void *output, PaTime inputDelay,
+        PaTime outputDelay, PaStreamCallbackFlags cbFlags, int *callbackResult )
+{
+    PaStreamCallbackTimeInfo timeInfo;
+    PaUtilBufferProcessor *bp = &stream->bufferProcessor;
+    unsigned long frames = stream->framesPerHostBuffer;
+    unsigned long framesProcessed = frames;
+
+    PaUtil_BeginCpuLoadMeasurement( &stream->cpuLoadMeasurer );
+
+    timeInfo.currentTime = PaUtil_GetTime();
+    timeInfo.inputBufferAdcTime = timeInfo.currentTime - inputDelay;
+    timeInfo.outputBufferDacTime = timeInfo.currentTime + outputDelay;
+
+    /* the writer's channels the stream doesn't have carry silence */
+    if( output && stream->outputChannelCount < stream->output.channels )
+        memset( output, 0, frames * stream->output.bytesPerFrame );
+
+    PaUtil_BeginBufferProcessing( bp, &timeInfo, cbFlags );
+    if( stream->canDirectCallback && PaUtil_CanBypassBufferProcessor( bp ) )
+    {
+        framesProcessed = PaUtil_EndBufferProcessingDirectly( bp, input, output, frames, callbackResult );
+    }
+    else
+    {
+        SetHostChannels( stream, input, output, frames );
+        framesProcessed = PaUtil_EndBufferProcessing( bp, callbackResult );
+    }
+
+    PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
+}
+
+
+/** Clean up after the callback thread exits, for whichever reason.
+ Calls the stream finished callback.
+ */
+static void OnThreadExit( void *userData )
+{
+    PaShmStream *stream = (PaShmStream*)userData;
+
+    assert( stream );
+
+    PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+
+    if( stream->streamRepresentation.streamFinishedCallback )
+        stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
+
+    stream->isActive = 0;
+}
+
+
+/** Callback thread.
+ A stream reading a ring processes a host buffer as soon as the writer has committed one, waiting at most a
+ period past the clock for it before it delivers silence. A stream which only writes wakes up once per period of
+ its clock; when it is more than a period late, the missed time is reported as an xrun and skipped.
+ */
+static void *CallbackThreadFunc( void *userData )
+{
+    PaError result = paNoError;
+    PaShmStream *stream = (PaShmStream*)userData;
+    PaShmRing *input = &stream->input, *output = &stream->output;
+    uint32_t frames = (uint32_t)stream->framesPerHostBuffer;
+    int callbackResult = paContinue;
+    PaTime period, nextTime;
+
+    assert( stream );
+
+    period = frames / stream->sampleRate;
+
+    pthread_cleanup_push( &OnThreadExit, stream );
+
+    PA_ENSURE( PaUnixThread_PrepareNotify( &stream->thread ) );
+    nextTime = PaUtil_GetTime() + period;
+    PA_ENSURE( PaUnixThread_NotifyParent( &stream->thread ) );
+
+    while( 1 )
+    {
+        PaStreamCallbackFlags cbFlags = 0;
+        void *inputData = NULL, *outputData = NULL;
+        PaTime inputDelay = 0., outputDelay = 0.;
+        uint32_t queued = 0;
+
+        pthread_testcancel();
+
+        /* drain the buffer processor if the main thread has requested a stop */
+        if( PaUnixThread_StopRequested( &stream->thread ) && (callbackResult == paContinue) )
+            callbackResult = paComplete;
+
+        if( callbackResult != paContinue )
+        {
+            if( callbackResult == paAbort ||
+                    PaUtil_IsBufferProcessorOutputEmpty( &stream->bufferProcessor ) )
+                goto end;
+        }
+
+        if( input->header )
+        {
+            queued = WaitForFrames( input, frames, nextTime + period );
+            if( queued >= frames )
+            {
+                /* skip what queued up beyond the latency, the writer ran while we didn't */
+                if( queued > stream->maxQueuedFrames + frames )
+                {
+                    input->header->readIndex += queued - stream->maxQueuedFrames;
+                    queued = stream->maxQueuedFrames;
+                    cbFlags |= paInputOverflow;
+                }
+                inputData = input->frames + (input->header->readIndex & (input->ringFrames - 1))
+                        * input->bytesPerFrame;
+                inputDelay = (PaTime)queued / stream->sampleRate;
+                /* follow the writer's clock */
+                nextTime = PaUtil_GetTime() + period;
+            }
+            else
+            {
+                inputData = stream->inputScratch;
+                cbFlags |= paInputUnderflow;
+                nextTime += period;
+            }
+        }
+        else
+        {
+            PaTime now = PaUtil_GetTime();
+
+            if( now < nextTime )
+            {
+                PA_PROBE1( host_wait, 0 );
+                SleepUntil( nextTime );
+                PA_PROBE2( host_wait_return, 0, 0 );
+            }
+            else if( now - nextTime > period )
+            {
+                PA_DEBUG(( "%s: %.3f ms late\n", __FUNCTION__, (now - nextTime) * 1000. ));
+                cbFlags |= paOutputUnderflow;
+                nextTime = now;
+            }
+            nextTime += period;
+        }
+
+        if( output->header )
+        {
+            uint32_t writeIndex = output->header->writeIndex;
+            uint32_t used = writeIndex - output->header->readIndex;
+
+            /* the reader may be gone, or not started yet: drop what the ring has no room for */
+            if( used + frames <= output->ringFrames )
+                outputData = output->frames + (writeIndex & (output->ringFrames - 1)) * output->bytesPerFrame;
+            else
+            {
+                outputData = stream->outputScratch;
+                cbFlags |= paOutputOverflow;
+            }
+            outputDelay = (PaTime)PA_MIN( used, output->ringFrames ) / stream->sampleRate;
+        }
+
+        ProcessBuffer( stream, inputData, outputData, inputDelay, outputDelay, cbFlags, &callbackResult );
+
+        if( inputData && inputData != stream->inputScratch )
+        {
+            /* the frames have been read before the writer may overwrite them */
+            PaUtil_FullMemoryBarrier();
+            input->header->readIndex += frames;
+        }
+        if( outputData && outputData != stream->outputScratch )
+            CommitFrames( output, frames );
+    }
+
+end:
+    /* The loop is left through end, so that OnThreadExit() runs here; pthread_cleanup_push() may be a macro
+       opening a block which pthread_cleanup_pop() closes, so they must occur in pairs */
+    pthread_cleanup_pop( 1 );
+
+    PaUnixThreading_EXIT( result );
+error:
+    goto end;
+}
+
+
+/*
+    When CloseStream() is called, the multi-api layer ensures that
+    the stream has already been stopped or aborted.
+*/
+static PaError CloseStream( PaStream* s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+
+    PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
+    PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    CleanUpStream( stream );
+
+    return paNoError;
+}
+
+
+static PaError StartStream( PaStream *s )
+{
+    PaError result = paNoError;
+    PaShmStream *stream = (PaShmStream*)s;
+
+    PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
+    if( stream->isBlockingStream )
+        PaUtil_ResetBlockingIO( &stream->blockingIO );
+
+    /* a reader starts with what the writer writes from now on */
+    if( stream->input.header )
+    {
+        stream->input.header->readIndex = stream->input.header->writeIndex;
+        PaUtil_FullMemoryBarrier();
+    }
+
+    stream->isStopped = 0;
+    stream->isActive = 1;
+
+    /* the thread starts the clock, wait for it up to a second */
+    result = PaUnixThread_New( &stream->thread, &CallbackThreadFunc, stream, 1., NULL, NULL, 0 );
+    if( result != paNoError )
+    {
+        stream->isActive = 0;
+        stream->isStopped = 1;
+    }
+
+    return result;
+}
+
+
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+    PaError result;
+
+    PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+    result = StartStream( s );
+    if( result != paNoError )
+        PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+    return result;
+}
+
+
+static PaError RealStop( PaShmStream *stream, int abort )
+{
+    PaError result = paNoError;
+    PaError threadResult;
+
+    /* Let the callback write what was written, allowing for a second of scheduling delays */
+    if( stream->isBlockingStream && !abort )
+        PaUtil_DrainBlockingIO( &stream->blockingIO,
+                PaUtil_GetBlockingIORingBufferFrames( &stream->blockingIO ) / stream->sampleRate + 1. );
+
+    PA_ENSURE( PaUnixThread_Terminate( &stream->thread, !abort, &threadResult ) );
+    if( threadResult != paNoError )
+    {
+        PA_DEBUG(( "%s: callback thread returned %d\n", __FUNCTION__, threadResult ));
+    }
+
+error:
+    stream->isActive = 0;
+    stream->isStopped = 1;
+    if( stream->isBlockingStream )
+        PaUtil_StopBlockingIO( &stream->blockingIO );
+    return result;
+}
+
+
+static PaError StopStream( PaStream *s )
+{
+    return RealStop( (PaShmStream*)s, 0 );
+}
+
+
+static PaError AbortStream( PaStream *s )
+{
+    return RealStop( (PaShmStream*)s, 1 );
+}
+
+
+static PaError IsStreamStopped( PaStream *s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+
+    return stream->isStopped;
+}
+
+
+static PaError IsStreamActive( PaStream *s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+
+    return stream->isActive;
+}
+
+
+/* The callback thread keeps running while paused, without calling the callback */
+static PaError PauseStream( PaStream *s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 1 );
+    return paNoError;
+}
+
+
+static PaError ResumeStream( PaStream *s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+
+    PaUtil_SetBufferProcessorPaused( &stream->bufferProcessor, 0 );
+    return paNoError;
+}
+
+
+static PaTime GetStreamTime( PaStream *s )
+{
+    /* the stream clock is the system clock */
+    (void) s;
+
+    return PaUtil_GetTime();
+}
+
+
+static double GetStreamCpuLoad( PaStream* s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+
+    return PaUtil_GetCpuLoad( &stream->cpuLoadMeasurer );
+}
+
+
+static signed long GetStreamMemoryUsage( PaStream* s )
+{
+    PaShmStream *stream = (PaShmStream*)s;
+    signed long usage = (signed long)sizeof(PaShmStream)
+            + PaUtil_GetBlockingIOMemoryUsage( &stream->blockingIO )
+            + PaUtil_GetBufferProcessorMemoryUsage( &stream->bufferProcessor );
+
+    /* the rings are shared, only what the stream allocated for itself counts */
+    if( stream->inputScratch )
+        usage += (signed long)(stream->framesPerHostBuffer * stream->input.bytesPerFrame);
+    if( stream->outputScratch )
+        usage += (signed long)(stream->framesPerHostBuffer * stream->output.bytesPerFrame);
+    return usage;
+}
@@ -46,6 +46,7 @@
 #include <stdio.h>
 #include <process.h>
 #include <assert.h>
+#include <stddef.h> // offsetof()
 
 // WinRT
 #if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
@@ -77,10 +78,12 @@
 #include "pa_stream.h"
 #include "pa_cpuload.h"
 #include "pa_process.h"
+#include "pa_probes.h"
 #include "pa_win_wasapi.h"
 #include "pa_debugprint.h"
 #include "pa_ringbuffer.h"
 #include "pa_win_coinitialize.h"
+#include "pa_win_util.h"
 
 #if !defined(NTDDI_VERSION)
  
@@ -213,6 +216,8 @@
 PA_DEFINE_IID(IAudioClient,         1cb9ad4c, dbfa, 4c32, b1, 78, c2, f5, 68, a7, 03, b2);
 // "726778CD-F60A-4EDA-82DE-E47610CD78AA"
 PA_DEFINE_IID(IAudioClient2,        726778cd, f60a, 4eda, 82, de, e4, 76, 10, cd, 78, aa);
+// "7ED4EE07-8E67-4CD4-8C1A-2B7A5987AD42"
+PA_DEFINE_IID(IAudioClient3,        7ed4ee07, 8e67, 4cd4, 8c, 1a, 2b, 7a, 59, 87, ad, 42);
 // "1BE09788-6894-4089-8586-9A2A6C265AC5"
 PA_DEFINE_IID(IMMEndpoint,          1be09788, 6894, 4089, 85, 86, 9a, 2a, 6c, 26, 5a, c5);
 // "A95664D2-9614-4F35-A746-DE8DB63617E6"
@@ -229,12 +234,22 @@ PA_DEFINE_IID(IDeviceTopology,      2A07407E, 6497, 4A18, 97, 87, 32, f7, 9b, d0
 PA_DEFINE_IID(IPart,                AE2DE0E4, 5BCA, 4F2D, aa, 46, 5d, 13, f8, fd, b3, a9);
 // *4509F757-2D46-4637-8E62-CE7DB944F57B*
 PA_DEFINE_IID(IKsJackDescription,   4509F757, 2D46, 4637, 8e, 62, ce, 7d, b9, 44, f5, 7b);
+// "7991EEC9-7E89-4D85-8390-6C703CEC60C0"
+PA_DEFINE_IID(IMMNotificationClient,7991eec9, 7e89, 4d85, 83, 90, 6c, 70, 3c, ec, 60, c0);
+// "00000000-0000-0000-C000-000000000046"
+PA_DEFINE_IID(IUnknown,             00000000, 0000, 0000, c0, 00, 00, 00, 00, 00, 00, 46);
 
 // Media formats:
 __DEFINE_GUID(pa_KSDATAFORMAT_SUBTYPE_PCM,        0x00000001, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 );
 __DEFINE_GUID(pa_KSDATAFORMAT_SUBTYPE_ADPCM,      0x00000002, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 );
 __DEFINE_GUID(pa_KSDATAFORMAT_SUBTYPE_IEEE_FLOAT, 0x00000003, 0x0000, 0x0010, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 );
 
+#ifndef PA_WINRT
+// PKEY_AudioDevice_RawProcessingSupported "8943B373-388C-4395-B557-BC6DBCFFAFDB", 2 (Windows 8.1 SDK and up)
+static const PROPERTYKEY pa_PKEY_AudioDevice_RawProcessingSupported GUID_SECT =
+	{ { 0x8943b373, 0x388c, 0x4395, { 0xb5, 0x57, 0xbc, 0x6d, 0xbc, 0xff, 0xaf, 0xdb } }, 2 };
+#endif
+
 #ifdef __IAudioClient2_INTERFACE_DEFINED__
 typedef enum _pa_AUDCLNT_STREAMOPTIONS { 
 	pa_AUDCLNT_STREAMOPTIONS_NONE          = 0x00,
@@ -314,16 +329,10 @@ typedef void (*MixMonoToStereoF) (void *__to, void *__from, UINT32 count);
 typedef BOOL   (WINAPI *FAvRtCreateThreadOrderingGroup)  (PHANDLE,PLARGE_INTEGER,GUID*,PLARGE_INTEGER);
 typedef BOOL   (WINAPI *FAvRtDeleteThreadOrderingGroup)  (HANDLE);
 typedef BOOL   (WINAPI *FAvRtWaitOnThreadOrderingGroup)  (HANDLE);
-typedef HANDLE (WINAPI *FAvSetMmThreadCharacteristics)   (LPCSTR,LPDWORD);
-typedef BOOL   (WINAPI *FAvRevertMmThreadCharacteristics)(HANDLE);
-typedef BOOL   (WINAPI *FAvSetMmThreadPriority)          (HANDLE,AVRT_PRIORITY);
 static HMODULE hDInputDLL = 0;
 FAvRtCreateThreadOrderingGroup   pAvRtCreateThreadOrderingGroup = NULL;
 FAvRtDeleteThreadOrderingGroup   pAvRtDeleteThreadOrderingGroup = NULL;
 FAvRtWaitOnThreadOrderingGroup   pAvRtWaitOnThreadOrderingGroup = NULL;
-FAvSetMmThreadCharacteristics    pAvSetMmThreadCharacteristics = NULL;
-FAvRevertMmThreadCharacteristics pAvRevertMmThreadCharacteristics = NULL;
-FAvSetMmThreadPriority           pAvSetMmThreadPriority = NULL;
 #endif
 
 #define _GetProc(fun, type, name)  {                                                        \
@@ -355,6 +364,7 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
 
 // ------------------------------------------------------------------------------------------
 static void Terminate( struct PaUtilHostApiRepresentation *hostApi );
+static PaError EnableDeviceChangeNotification( struct PaUtilHostApiRepresentation *hostApi, int enable );
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const PaStreamParameters *inputParameters,
                                   const PaStreamParameters *outputParameters,
@@ -370,10 +380,14 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            void *userData );
 static PaError CloseStream( PaStream* stream );
 static PaError StartStream( PaStream *stream );
+static PaError StartStreamAtTime( PaStream *stream, PaTime startTime );
 static PaError StopStream( PaStream *stream );
 static PaError AbortStream( PaStream *stream );
 static PaError IsStreamStopped( PaStream *s );
 static PaError IsStreamActive( PaStream *stream );
+static PaError PauseStream( PaStream *stream );
+static PaError ResumeStream( PaStream *stream );
+static PaError ProcessStream( PaStream *stream, double timeoutSeconds );
 static PaTime GetStreamTime( PaStream *stream );
 static double GetStreamCpuLoad( PaStream* stream );
 static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
@@ -381,6 +395,20 @@ static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long
 static signed long GetStreamReadAvailable( PaStream* stream );
 static signed long GetStreamWriteAvailable( PaStream* stream );
 
+// ------------------------------------------------------------------------------------------
+/* PaWasapiFormatAnswer - cached answer of IsFormatSupported() for an Exclusive mode format */
+#define PA_WASAPI_FORMAT_ANSWERS_ 8
+typedef struct PaWasapiFormatAnswer
+{
+	LONG           generation;  // of PaWasapiHostApiRepresentation::formatGeneration, 0 if unused
+	double         sampleRate;
+	int            channelCount;
+	PaSampleFormat sampleFormat;
+	DWORD          channelMask; // 0 unless paWinWasapiUseChannelMask
+	PaError        answer;
+}
+PaWasapiFormatAnswer;
+
 // ------------------------------------------------------------------------------------------
 /*
  These are fields that can be gathered from IDevice and IAudioDevice PRIOR to Initialize, and
@@ -413,9 +441,34 @@ typedef struct PaWasapiDeviceInfo
 
 	// Formfactor
 	EndpointFormFactor formFactor;
+
+	// The device may be opened with AUDCLNT_STREAMOPTIONS_RAW (from PKEY_AudioDevice_RawProcessingSupported)
+	BOOL rawProcessingSupported;
+
+	// The periods were queried by ProbeDeviceInfo()
+	BOOL periodsProbed;
+
+	// Input device capturing what the render endpoint plays (AUDCLNT_STREAMFLAGS_LOOPBACK)
+	BOOL loopBack;
+
+	// Answers of IsFormatSupported() probing for Exclusive mode, replaced round-robin
+	PaWasapiFormatAnswer formatAnswers[PA_WASAPI_FORMAT_ANSWERS_];
+	UINT32 nextFormatAnswer;
 }
 PaWasapiDeviceInfo;
 
+// ------------------------------------------------------------------------------------------
+#ifndef PA_WINRT
+/* PaWasapiNotificationClient - reports device changes while registered with the enumerator */
+typedef struct PaWasapiNotificationClient
+{
+	IMMNotificationClient parent;
+	PaUtilHostApiRepresentation *hostApi;
+	BOOL registered;
+}
+PaWasapiNotificationClient;
+#endif
+
 // ------------------------------------------------------------------------------------------
 /* PaWasapiHostApiRepresentation - host api datastructure specific to this implementation */
 typedef struct
@@ -433,6 +486,7 @@ typedef struct
     //in case we later need the synch
 #ifndef PA_WINRT
     IMMDeviceEnumerator *enumerator;
+    PaWasapiNotificationClient notificationClient;
 #endif
 
     //this is the REAL number of devices, whether they are usefull to PA or not!
@@ -445,6 +499,9 @@ typedef struct
 
 	// Is true when WOW64 Vista/7 Workaround is needed
 	BOOL useWOW64Workaround;
+
+	// Advanced when device properties change, discarding the cached format answers of all devices
+	volatile LONG formatGeneration;
 }
 PaWasapiHostApiRepresentation;
 
@@ -497,6 +554,8 @@ typedef struct PaWasapiSubStream
 
 	PaUtilRingBuffer    *tailBuffer;       //!< buffer with trailing sample for blocking mode operations (only for Input)
 	void                *tailBufferMemory; //!< tail buffer memory region
+
+	int                 *channelSelectors; //!< NULL or the device channel of each user channel (only for Input)
 }
 PaWasapiSubStream;
 
@@ -526,6 +585,17 @@ typedef struct PaWasapiStream
 	IAudioCaptureClient       *captureClient;
     IAudioEndpointVolume      *inVol;
 
+	// QPC time of the first frame of the last input packet in seconds, 0 if unknown (loopback only)
+	PaTime                     inputPacketTime;
+
+	// Silent render stream on the endpoint of an event driven loopback input, whose events drive the capture
+	PaWasapiSubStream          loopbackRender;
+	IAudioRenderClient        *loopbackRenderClientParent;
+#ifndef PA_WINRT
+	IStream                   *loopbackRenderClientStream;
+#endif
+	IAudioRenderClient        *loopbackRenderClient;
+
 	// output
 	PaWasapiSubStream          out;
     IAudioRenderClient        *renderClientParent;
@@ -552,6 +622,8 @@ typedef struct PaWasapiStream
 	HANDLE hThreadExit;         //!< signalled by thread on exit
 	HANDLE hBlockingOpStreamRD;
 	HANDLE hBlockingOpStreamWR;
+	HANDLE hBlockingTimerRD;    //!< high-resolution timer of ReadStream() waits, NULL if not available
+	HANDLE hBlockingTimerWR;    //!< high-resolution timer of WriteStream() waits, NULL if not available
 
     // Host callback Output overrider
 	PaWasapiHostProcessor hostProcessOverrideOutput;
@@ -562,9 +634,28 @@ typedef struct PaWasapiStream
 	// Defines blocking/callback interface used
 	BOOL bBlocking;
 
+	// Callback is processed by Pa_ProcessStream() on the application's thread (paManualProcessing)
+	BOOL bManualProcessing;
+
+	// Host processors used by Pa_ProcessStream()
+	PaWasapiHostProcessor manualProcessor[S_COUNT];
+
+	// High-resolution timer of Pa_ProcessStream() polling waits, NULL if not available
+	HANDLE hManualTimer;
+
+	// Callback may run directly on the GetBuffer memory, the user and host formats being the same
+	BOOL bZeroCopy;
+
+	// COM pointers were obtained in the MTA, processing thread joins MTA and uses them without marshaling
+	BOOL bMtaComPointers;
+
 	// Av Task (MM thread management)
 	HANDLE hAvTask;
 
+	// Processors the processing thread is pinned to, NULL for any
+	int *threadCpus;
+	int threadCpuCount;
+
 	// Thread priority level
 	PaWasapiThreadPriority nThreadPriority;
 }
@@ -582,6 +673,7 @@ static void ReleaseUnmarshaledComPointers(PaWasapiStream *stream);
 static void _StreamOnStop(PaWasapiStream *stream);
 static void _StreamFinish(PaWasapiStream *stream);
 static void _StreamCleanup(PaWasapiStream *stream);
+static PaError _StreamStartManual(PaWasapiStream *stream);
 static HRESULT _PollGetOutputFramesAvailable(PaWasapiStream *stream, UINT32 *available);
 static HRESULT _PollGetInputFramesAvailable(PaWasapiStream *stream, UINT32 *available);
 static void *PaWasapi_ReallocateMemory(void *ptr, size_t size);
@@ -691,6 +783,89 @@ static UINT32 ThreadIdleScheduler_NextSleep(ThreadIdleScheduler *sched)
 	return 0;
 }
 
+// ------------------------------------------------------------------------------------------
+/*! \class ThreadTimerScheduler
+           Wakes polling thread at deadlines spaced by a fixed period using high-resolution
+		   waitable timer (Windows 10 1803 and up), thus independent of Sleep() granularity and
+		   without timeBeginPeriod() affecting whole system. Deadlines advance from the previous
+		   deadline, not from wake up time, so that wake up jitter does not accumulate. If timer
+		   is not available scheduler falls back to WaitForSingleObject with millisecond timeout.
+*/
+typedef struct ThreadTimerScheduler
+{
+	HANDLE   m_timer;    //!< high-resolution waitable timer, NULL if not available
+	LONGLONG m_period;   //!< period in 100-nanosecond units
+	LONGLONG m_deadline; //!< next deadline in 100-nanosecond units of performance counter
+	LONGLONG m_freq;     //!< performance counter frequency
+}
+ThreadTimerScheduler;
+//! Current time in 100-nanosecond units.
+static LONGLONG ThreadTimerScheduler_Now(ThreadTimerScheduler *sched)
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (LONGLONG)((double)now.QuadPart * 10000000.0 / (double)sched->m_freq);
+}
+//! Setup scheduler, timer is not used if microseconds is 0.
+static void ThreadTimerScheduler_Setup(ThreadTimerScheduler *sched, UINT32 microseconds)
+{
+	LARGE_INTEGER freq;
+
+	memset(sched, 0, sizeof(*sched));
+
+	if ((microseconds == 0) || !QueryPerformanceFrequency(&freq) || (freq.QuadPart == 0))
+		return;
+
+	sched->m_timer = PaWinUtil_CreateHighResolutionTimer();
+	if (sched->m_timer == NULL)
+		return; // older OS
+
+	sched->m_freq     = freq.QuadPart;
+	sched->m_period   = (LONGLONG)microseconds * 10;
+	sched->m_deadline = ThreadTimerScheduler_Now(sched);
+}
+//! Release timer.
+static void ThreadTimerScheduler_Close(ThreadTimerScheduler *sched)
+{
+	if (sched->m_timer != NULL)
+		CloseHandle(sched->m_timer);
+	sched->m_timer = NULL;
+}
+//! Wait for next deadline or close event, returns WAIT_TIMEOUT on deadline as WaitForSingleObject does.
+static DWORD ThreadTimerScheduler_Wait(ThreadTimerScheduler *sched, HANDLE hCloseRequest, DWORD fallbackMilliseconds)
+{
+	HANDLE handles[2];
+	LARGE_INTEGER due;
+	LONGLONG now;
+
+	if (sched->m_timer == NULL)
+		return WaitForSingleObject(hCloseRequest, fallbackMilliseconds);
+
+	now = ThreadTimerScheduler_Now(sched);
+	sched->m_deadline += sched->m_period;
+
+	// Behind schedule: restart deadlines from now instead of firing a burst of late wake ups
+	if (sched->m_deadline <= now)
+	{
+		sched->m_deadline = now;
+		return WaitForSingleObject(hCloseRequest, 0);
+	}
+
+	// Negative due time is relative, thus not affected by system time changes
+	due.QuadPart = -(sched->m_deadline - now);
+	if (!SetWaitableTimer(sched->m_timer, &due, 0, NULL, NULL, FALSE))
+		return WaitForSingleObject(hCloseRequest, fallbackMilliseconds);
+
+	handles[0] = hCloseRequest;
+	handles[1] = sched->m_timer;
+	switch (WaitForMultipleObjects(2, handles, FALSE, INFINITE))
+	{
+	case WAIT_OBJECT_0 + 1: return WAIT_TIMEOUT;
+	case WAIT_OBJECT_0:     return WAIT_OBJECT_0;
+	default:                return WAIT_FAILED;
+	}
+}
+
 // ------------------------------------------------------------------------------------------
 /*static double nano100ToMillis(REFERENCE_TIME ref)
 {
@@ -735,14 +910,18 @@ static REFERENCE_TIME MakeHnsPeriod(UINT32 nFrames, DWORD nSamplesPerSec)
 }
 
 // ------------------------------------------------------------------------------------------
-// Converts PaSampleFormat to bits per sample value
+// Converts PaSampleFormat to bits per sample value. 24 bits go in 32 bit containers whose
+// valid bits are the upper ones, WaveToPaFormat() reports these as paInt32, so paInt24In32
+// is converted from and to them by a shift.
 static WORD PaSampleFormatToBitsPerSample(PaSampleFormat format_id)
 {
 	switch (format_id & ~paNonInterleaved)
 	{
+		case paFloat64: return 64;
 		case paFloat32:
 		case paInt32: return 32;
-		case paInt24: return 24;
+		case paInt24:
+		case paInt24In32: return 24;
 		case paInt16: return 16;
 		case paInt8:
 		case paUInt8: return 8;
@@ -869,16 +1048,10 @@ static BOOL SetupAVRT()
     _GetProc(pAvRtCreateThreadOrderingGroup,  FAvRtCreateThreadOrderingGroup,  "AvRtCreateThreadOrderingGroup");
     _GetProc(pAvRtDeleteThreadOrderingGroup,  FAvRtDeleteThreadOrderingGroup,  "AvRtDeleteThreadOrderingGroup");
     _GetProc(pAvRtWaitOnThreadOrderingGroup,  FAvRtWaitOnThreadOrderingGroup,  "AvRtWaitOnThreadOrderingGroup");
-    _GetProc(pAvSetMmThreadCharacteristics,   FAvSetMmThreadCharacteristics,   "AvSetMmThreadCharacteristicsA");
-	_GetProc(pAvRevertMmThreadCharacteristics,FAvRevertMmThreadCharacteristics,"AvRevertMmThreadCharacteristics");
-    _GetProc(pAvSetMmThreadPriority,          FAvSetMmThreadPriority,          "AvSetMmThreadPriority");
 
 	return pAvRtCreateThreadOrderingGroup &&
 		pAvRtDeleteThreadOrderingGroup &&
-		pAvRtWaitOnThreadOrderingGroup &&
-		pAvSetMmThreadCharacteristics &&
-		pAvRevertMmThreadCharacteristics &&
-		pAvSetMmThreadPriority;
+		pAvRtWaitOnThreadOrderingGroup;
 }
 #endif
 
@@ -892,6 +1065,25 @@ static void CloseAVRT()
 #endif
 }
 
+// ------------------------------------------------------------------------------------------
+static BOOL IsThreadInMTA()
+{
+#ifndef PA_WINRT
+	/*
+	CoInitializeEx returns S_FALSE if the thread is already in the MTA, RPC_E_CHANGED_MODE
+	if it is in an STA. S_OK means COM was not initialized for this thread, it is undone and
+	the thread is not considered to be in the MTA as it did not obtain COM pointers there.
+	*/
+	HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+	if (SUCCEEDED(hr))
+		CoUninitialize();
+
+	return (hr == S_FALSE);
+#else
+	return FALSE;
+#endif
+}
+
 // ------------------------------------------------------------------------------------------
 static BOOL IsWow64()
 {
@@ -1099,7 +1291,11 @@ static const IID *GetAudioClientIID()
 		{
 			switch (cli_version)
 			{
+		#ifdef __IAudioClient3_INTERFACE_DEFINED__
+			case 3:  cli_iid = &pa_IID_IAudioClient3; cli_version = 3; break; // IAudioClient3 for low-latency Shared mode of Windows 10+
+		#else
 			case 3:  cli_iid = &pa_IID_IAudioClient2; cli_version = 2; break; // use IAudioClient2 for Windows 10+ until IAudioClient3 functions are required
+		#endif
 			default: cli_iid = &pa_IID_IAudioClient2; cli_version = 2; break;
 			}
 		}
@@ -1179,7 +1375,7 @@ static void _MixMonoToStereo_1TO2_32f(void *__to, void *__from, UINT32 count) {
 // ------------------------------------------------------------------------------------------
 static void _MixMonoToStereo_2TO1_8(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_INT32(BYTE); }
 static void _MixMonoToStereo_2TO1_16(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_INT32(short); }
-static void _MixMonoToStereo_2TO1_24(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_INT32(int); /* !!! int24 data is contained in 32-bit containers*/ }
+static void _MixMonoToStereo_2TO1_24(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_INT64(int); /* !!! int24 data is contained in 32-bit containers*/ }
 static void _MixMonoToStereo_2TO1_32(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_INT64(int); }
 static void _MixMonoToStereo_2TO1_32f(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_FLT32(float); }
 
@@ -1190,6 +1386,286 @@ static void _MixMonoToStereo_2TO1_24_L(void *__to, void *__from, UINT32 count) {
 static void _MixMonoToStereo_2TO1_32_L(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_L(int); }
 static void _MixMonoToStereo_2TO1_32f_L(void *__to, void *__from, UINT32 count) { _WASAPI_MONO_TO_STEREO_MIXER_2_TO_1_L(float); }
 
+// ------------------------------------------------------------------------------------------
+/* SIMD versions of the mixers, each processes whole vectors and leaves the tail to the scalar
+   version. Results are bit-exact with the scalar mixers. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define PA_WASAPI_SSE2_
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON__)
+	#define PA_WASAPI_NEON_
+	#include <arm_neon.h>
+#endif
+
+#ifdef PA_WASAPI_SSE2_
+static void _MixMonoToStereo_1TO2_8_SIMD(void *__to, void *__from, UINT32 count)
+{
+	BYTE *to = (BYTE *)__to, *from = (BYTE *)__from;
+	UINT32 i, n = count & ~15;
+	for (i = 0; i < n; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(from + i));
+		_mm_storeu_si128((__m128i *)(to + i * 2), _mm_unpacklo_epi8(x, x));
+		_mm_storeu_si128((__m128i *)(to + i * 2 + 16), _mm_unpackhi_epi8(x, x));
+	}
+	_MixMonoToStereo_1TO2_8(to + i * 2, from + i, count - n);
+}
+static void _MixMonoToStereo_1TO2_16_SIMD(void *__to, void *__from, UINT32 count)
+{
+	short *to = (short *)__to, *from = (short *)__from;
+	UINT32 i, n = count & ~7;
+	for (i = 0; i < n; i += 8)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(from + i));
+		_mm_storeu_si128((__m128i *)(to + i * 2), _mm_unpacklo_epi16(x, x));
+		_mm_storeu_si128((__m128i *)(to + i * 2 + 8), _mm_unpackhi_epi16(x, x));
+	}
+	_MixMonoToStereo_1TO2_16(to + i * 2, from + i, count - n);
+}
+// int24 (32-bit container), int32 and float32 samples are duplicated as 32-bit words
+static void _MixMonoToStereo_1TO2_32_SIMD(void *__to, void *__from, UINT32 count)
+{
+	int *to = (int *)__to, *from = (int *)__from;
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(from + i));
+		_mm_storeu_si128((__m128i *)(to + i * 2), _mm_unpacklo_epi32(x, x));
+		_mm_storeu_si128((__m128i *)(to + i * 2 + 4), _mm_unpackhi_epi32(x, x));
+	}
+	_MixMonoToStereo_1TO2_32(to + i * 2, from + i, count - n);
+}
+static void _MixMonoToStereo_2TO1_8_SIMD(void *__to, void *__from, UINT32 count)
+{
+	BYTE *to = (BYTE *)__to, *from = (BYTE *)__from;
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	UINT32 i, n = count & ~15;
+	for (i = 0; i < n; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(from + i * 2));
+		__m128i b = _mm_loadu_si128((const __m128i *)(from + i * 2 + 16));
+		__m128i sa = _mm_srli_epi16(_mm_add_epi16(_mm_and_si128(a, lowBytes), _mm_srli_epi16(a, 8)), 1);
+		__m128i sb = _mm_srli_epi16(_mm_add_epi16(_mm_and_si128(b, lowBytes), _mm_srli_epi16(b, 8)), 1);
+		_mm_storeu_si128((__m128i *)(to + i), _mm_packus_epi16(sa, sb));
+	}
+	_MixMonoToStereo_2TO1_8(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_16_SIMD(void *__to, void *__from, UINT32 count)
+{
+	short *to = (short *)__to, *from = (short *)__from;
+	const __m128i ones = _mm_set1_epi16(1);
+	UINT32 i, n = count & ~7;
+	for (i = 0; i < n; i += 8)
+	{
+		// madd sums adjacent (left, right) pairs to 32 bits
+		__m128i a = _mm_srai_epi32(_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(from + i * 2)), ones), 1);
+		__m128i b = _mm_srai_epi32(_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(from + i * 2 + 8)), ones), 1);
+		_mm_storeu_si128((__m128i *)(to + i), _mm_packs_epi32(a, b));
+	}
+	_MixMonoToStereo_2TO1_16(to + i, from + i * 2, count - n);
+}
+// floor((l + r) / 2) = (l >> 1) + (r >> 1) + (l & r & 1) without 64-bit intermediate
+static void _MixMonoToStereo_2TO1_32_SIMD(void *__to, void *__from, UINT32 count)
+{
+	int *to = (int *)__to, *from = (int *)__from;
+	const __m128i one = _mm_set1_epi32(1);
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		__m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(from + i * 2)));
+		__m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(from + i * 2 + 4)));
+		__m128i l = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i r = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128i m = _mm_add_epi32(_mm_add_epi32(_mm_srai_epi32(l, 1), _mm_srai_epi32(r, 1)),
+			_mm_and_si128(_mm_and_si128(l, r), one));
+		_mm_storeu_si128((__m128i *)(to + i), m);
+	}
+	_MixMonoToStereo_2TO1_32(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_32f_SIMD(void *__to, void *__from, UINT32 count)
+{
+	float *to = (float *)__to, *from = (float *)__from;
+	const __m128 half = _mm_set1_ps(0.5f);
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(from + i * 2);
+		__m128 b = _mm_loadu_ps(from + i * 2 + 4);
+		__m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		_mm_storeu_ps(to + i, _mm_mul_ps(_mm_add_ps(l, r), half));
+	}
+	_MixMonoToStereo_2TO1_32f(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_8_L_SIMD(void *__to, void *__from, UINT32 count)
+{
+	BYTE *to = (BYTE *)__to, *from = (BYTE *)__from;
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	UINT32 i, n = count & ~15;
+	for (i = 0; i < n; i += 16)
+	{
+		__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(from + i * 2)), lowBytes);
+		__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(from + i * 2 + 16)), lowBytes);
+		_mm_storeu_si128((__m128i *)(to + i), _mm_packus_epi16(a, b));
+	}
+	_MixMonoToStereo_2TO1_8_L(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_16_L_SIMD(void *__to, void *__from, UINT32 count)
+{
+	short *to = (short *)__to, *from = (short *)__from;
+	UINT32 i, n = count & ~7;
+	for (i = 0; i < n; i += 8)
+	{
+		// sign-extend left samples of each 32-bit pair
+		__m128i a = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(from + i * 2)), 16), 16);
+		__m128i b = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(from + i * 2 + 8)), 16), 16);
+		_mm_storeu_si128((__m128i *)(to + i), _mm_packs_epi32(a, b));
+	}
+	_MixMonoToStereo_2TO1_16_L(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_32_L_SIMD(void *__to, void *__from, UINT32 count)
+{
+	float *to = (float *)__to, *from = (float *)__from; // bit copy, valid for any 32-bit sample
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		__m128 a = _mm_loadu_ps(from + i * 2);
+		__m128 b = _mm_loadu_ps(from + i * 2 + 4);
+		_mm_storeu_ps(to + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+	}
+	_MixMonoToStereo_2TO1_32_L(to + i, from + i * 2, count - n);
+}
+#endif // PA_WASAPI_SSE2_
+
+#ifdef PA_WASAPI_NEON_
+static void _MixMonoToStereo_1TO2_8_SIMD(void *__to, void *__from, UINT32 count)
+{
+	BYTE *to = (BYTE *)__to, *from = (BYTE *)__from;
+	UINT32 i, n = count & ~15;
+	for (i = 0; i < n; i += 16)
+	{
+		uint8x16x2_t x;
+		x.val[0] = x.val[1] = vld1q_u8(from + i);
+		vst2q_u8(to + i * 2, x);
+	}
+	_MixMonoToStereo_1TO2_8(to + i * 2, from + i, count - n);
+}
+static void _MixMonoToStereo_1TO2_16_SIMD(void *__to, void *__from, UINT32 count)
+{
+	short *to = (short *)__to, *from = (short *)__from;
+	UINT32 i, n = count & ~7;
+	for (i = 0; i < n; i += 8)
+	{
+		int16x8x2_t x;
+		x.val[0] = x.val[1] = vld1q_s16(from + i);
+		vst2q_s16(to + i * 2, x);
+	}
+	_MixMonoToStereo_1TO2_16(to + i * 2, from + i, count - n);
+}
+// int24 (32-bit container), int32 and float32 samples are duplicated as 32-bit words
+static void _MixMonoToStereo_1TO2_32_SIMD(void *__to, void *__from, UINT32 count)
+{
+	int *to = (int *)__to, *from = (int *)__from;
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		int32x4x2_t x;
+		x.val[0] = x.val[1] = vld1q_s32(from + i);
+		vst2q_s32(to + i * 2, x);
+	}
+	_MixMonoToStereo_1TO2_32(to + i * 2, from + i, count - n);
+}
+// halving adds give floor((l + r) / 2) without wider intermediate
+static void _MixMonoToStereo_2TO1_8_SIMD(void *__to, void *__from, UINT32 count)
+{
+	BYTE *to = (BYTE *)__to, *from = (BYTE *)__from;
+	UINT32 i, n = count & ~15;
+	for (i = 0; i < n; i += 16)
+	{
+		uint8x16x2_t x = vld2q_u8(from + i * 2);
+		vst1q_u8(to + i, vhaddq_u8(x.val[0], x.val[1]));
+	}
+	_MixMonoToStereo_2TO1_8(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_16_SIMD(void *__to, void *__from, UINT32 count)
+{
+	short *to = (short *)__to, *from = (short *)__from;
+	UINT32 i, n = count & ~7;
+	for (i = 0; i < n; i += 8)
+	{
+		int16x8x2_t x = vld2q_s16(from + i * 2);
+		vst1q_s16(to + i, vhaddq_s16(x.val[0], x.val[1]));
+	}
+	_MixMonoToStereo_2TO1_16(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_32_SIMD(void *__to, void *__from, UINT32 count)
+{
+	int *to = (int *)__to, *from = (int *)__from;
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		int32x4x2_t x = vld2q_s32(from + i * 2);
+		vst1q_s32(to + i, vhaddq_s32(x.val[0], x.val[1]));
+	}
+	_MixMonoToStereo_2TO1_32(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_32f_SIMD(void *__to, void *__from, UINT32 count)
+{
+	float *to = (float *)__to, *from = (float *)__from;
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+	{
+		float32x4x2_t x = vld2q_f32(from + i * 2);
+		vst1q_f32(to + i, vmulq_n_f32(vaddq_f32(x.val[0], x.val[1]), 0.5f));
+	}
+	_MixMonoToStereo_2TO1_32f(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_8_L_SIMD(void *__to, void *__from, UINT32 count)
+{
+	BYTE *to = (BYTE *)__to, *from = (BYTE *)__from;
+	UINT32 i, n = count & ~15;
+	for (i = 0; i < n; i += 16)
+		vst1q_u8(to + i, vld2q_u8(from + i * 2).val[0]);
+	_MixMonoToStereo_2TO1_8_L(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_16_L_SIMD(void *__to, void *__from, UINT32 count)
+{
+	short *to = (short *)__to, *from = (short *)__from;
+	UINT32 i, n = count & ~7;
+	for (i = 0; i < n; i += 8)
+		vst1q_s16(to + i, vld2q_s16(from + i * 2).val[0]);
+	_MixMonoToStereo_2TO1_16_L(to + i, from + i * 2, count - n);
+}
+static void _MixMonoToStereo_2TO1_32_L_SIMD(void *__to, void *__from, UINT32 count)
+{
+	int *to = (int *)__to, *from = (int *)__from; // bit copy, valid for any 32-bit sample
+	UINT32 i, n = count & ~3;
+	for (i = 0; i < n; i += 4)
+		vst1q_s32(to + i, vld2q_s32(from + i * 2).val[0]);
+	_MixMonoToStereo_2TO1_32_L(to + i, from + i * 2, count - n);
+}
+#endif // PA_WASAPI_NEON_
+
+#if defined(PA_WASAPI_SSE2_) || defined(PA_WASAPI_NEON_)
+// 32-bit kernels are format independent, tails go to the scalar mixer of the format
+#define _WASAPI_MONO_TO_STEREO_MIXER_SIMD_32(NAME, KERNEL, TO_CHANNELS, FROM_CHANNELS)\
+static void NAME##_SIMD(void *__to, void *__from, UINT32 count)\
+{\
+	UINT32 n = count & ~3;\
+	KERNEL(__to, __from, n);\
+	NAME((int *)__to + n * TO_CHANNELS, (int *)__from + n * FROM_CHANNELS, count - n);\
+}
+_WASAPI_MONO_TO_STEREO_MIXER_SIMD_32(_MixMonoToStereo_1TO2_24,    _MixMonoToStereo_1TO2_32_SIMD,   2, 1)
+_WASAPI_MONO_TO_STEREO_MIXER_SIMD_32(_MixMonoToStereo_1TO2_32f,   _MixMonoToStereo_1TO2_32_SIMD,   2, 1)
+_WASAPI_MONO_TO_STEREO_MIXER_SIMD_32(_MixMonoToStereo_2TO1_24,    _MixMonoToStereo_2TO1_32_SIMD,   1, 2)
+_WASAPI_MONO_TO_STEREO_MIXER_SIMD_32(_MixMonoToStereo_2TO1_24_L,  _MixMonoToStereo_2TO1_32_L_SIMD, 1, 2)
+_WASAPI_MONO_TO_STEREO_MIXER_SIMD_32(_MixMonoToStereo_2TO1_32f_L, _MixMonoToStereo_2TO1_32_L_SIMD, 1, 2)
+
+	#define PA_WASAPI_MIXER(NAME) NAME##_SIMD
+#else
+	#define PA_WASAPI_MIXER(NAME) NAME
+#endif
+
 // ------------------------------------------------------------------------------------------
 static MixMonoToStereoF _GetMonoToStereoMixer(PaSampleFormat format, EMixerDir dir)
 {
@@ -1198,33 +1674,33 @@ static MixMonoToStereoF _GetMonoToStereoMixer(PaSampleFormat format, EMixerDir d
 	case MIX_DIR__1TO2:
 		switch (format & ~paNonInterleaved)
 		{
-		case paUInt8:	return _MixMonoToStereo_1TO2_8;
-		case paInt16:	return _MixMonoToStereo_1TO2_16;
-		case paInt24:	return _MixMonoToStereo_1TO2_24;
-		case paInt32:	return _MixMonoToStereo_1TO2_32;
-		case paFloat32: return _MixMonoToStereo_1TO2_32f;
+		case paUInt8:	return PA_WASAPI_MIXER(_MixMonoToStereo_1TO2_8);
+		case paInt16:	return PA_WASAPI_MIXER(_MixMonoToStereo_1TO2_16);
+		case paInt24:	return PA_WASAPI_MIXER(_MixMonoToStereo_1TO2_24);
+		case paInt32:	return PA_WASAPI_MIXER(_MixMonoToStereo_1TO2_32);
+		case paFloat32: return PA_WASAPI_MIXER(_MixMonoToStereo_1TO2_32f);
 		}
 		break;
 
 	case MIX_DIR__2TO1:
 		switch (format & ~paNonInterleaved)
 		{
-		case paUInt8:	return _MixMonoToStereo_2TO1_8;
-		case paInt16:	return _MixMonoToStereo_2TO1_16;
-		case paInt24:	return _MixMonoToStereo_2TO1_24;
-		case paInt32:	return _MixMonoToStereo_2TO1_32;
-		case paFloat32: return _MixMonoToStereo_2TO1_32f;
+		case paUInt8:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_8);
+		case paInt16:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_16);
+		case paInt24:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_24);
+		case paInt32:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_32);
+		case paFloat32: return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_32f);
 		}
 		break;
 
 	case MIX_DIR__2TO1_L:
 		switch (format & ~paNonInterleaved)
 		{
-		case paUInt8:	return _MixMonoToStereo_2TO1_8_L;
-		case paInt16:	return _MixMonoToStereo_2TO1_16_L;
-		case paInt24:	return _MixMonoToStereo_2TO1_24_L;
-		case paInt32:	return _MixMonoToStereo_2TO1_32_L;
-		case paFloat32: return _MixMonoToStereo_2TO1_32f_L;
+		case paUInt8:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_8_L);
+		case paInt16:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_16_L);
+		case paInt24:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_24_L);
+		case paInt32:	return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_32_L);
+		case paFloat32: return PA_WASAPI_MIXER(_MixMonoToStereo_2TO1_32f_L);
 		}
 		break;
 	}
@@ -1342,6 +1818,134 @@ static IActivateAudioInterfaceCompletionHandler *CreateActivateAudioInterfaceCom
 }
 #endif
 
+// ------------------------------------------------------------------------------------------
+#ifndef PA_WINRT
+static HRESULT (STDMETHODCALLTYPE PaWasapiNotificationClient_QueryInterface)(
+    IMMNotificationClient *This, REFIID riid, void **ppvObject)
+{
+	if (IsEqualIID(riid, &pa_IID_IUnknown) ||
+		IsEqualIID(riid, &pa_IID_IMMNotificationClient))
+	{
+		(*ppvObject) = This;
+		return S_OK;
+	}
+
+	(*ppvObject) = NULL;
+	return E_NOINTERFACE;
+}
+
+// The client is part of the host API representation, which outlives its registration
+static ULONG (STDMETHODCALLTYPE PaWasapiNotificationClient_AddRef)(IMMNotificationClient *This)
+{
+	(void)This;
+	return 1;
+}
+
+static ULONG (STDMETHODCALLTYPE PaWasapiNotificationClient_Release)(IMMNotificationClient *This)
+{
+	(void)This;
+	return 1;
+}
+
+static HRESULT (STDMETHODCALLTYPE PaWasapiNotificationClient_OnDeviceStateChanged)(
+    IMMNotificationClient *This, LPCWSTR pwstrDeviceId, DWORD dwNewState)
+{
+	(void)pwstrDeviceId;
+	(void)dwNewState;
+	InterlockedIncrement(&((PaWasapiHostApiRepresentation *)((PaWasapiNotificationClient *)This)->hostApi)->formatGeneration);
+	PaUtil_NotifyDeviceChange(((PaWasapiNotificationClient *)This)->hostApi);
+	return S_OK;
+}
+
+static HRESULT (STDMETHODCALLTYPE PaWasapiNotificationClient_OnDeviceAdded)(
+    IMMNotificationClient *This, LPCWSTR pwstrDeviceId)
+{
+	(void)pwstrDeviceId;
+	PaUtil_NotifyDeviceChange(((PaWasapiNotificationClient *)This)->hostApi);
+	return S_OK;
+}
+
+static HRESULT (STDMETHODCALLTYPE PaWasapiNotificationClient_OnDeviceRemoved)(
+    IMMNotificationClient *This, LPCWSTR pwstrDeviceId)
+{
+	(void)pwstrDeviceId;
+	PaUtil_NotifyDeviceChange(((PaWasapiNotificationClient *)This)->hostApi);
+	return S_OK;
+}
+
+static HRESULT (STDMETHODCALLTYPE PaWasapiNotificationClient_OnDefaultDeviceChanged)(
+    IMMNotificationClient *This, EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId)
+{
+	(void)flow;
+	(void)pwstrDefaultDeviceId;
+
+	// Reported for every role, the default devices of PortAudio are those of eMultimedia
+	if (role == eMultimedia)
+		PaUtil_NotifyDeviceChange(((PaWasapiNotificationClient *)This)->hostApi);
+	return S_OK;
+}
+
+static HRESULT (STDMETHODCALLTYPE PaWasapiNotificationClient_OnPropertyValueChanged)(
+    IMMNotificationClient *This, LPCWSTR pwstrDeviceId, const PROPERTYKEY key)
+{
+	(void)pwstrDeviceId;
+	(void)key;
+
+	// A changed device format or exclusive mode setting may change the answers of IsFormatSupported()
+	InterlockedIncrement(&((PaWasapiHostApiRepresentation *)((PaWasapiNotificationClient *)This)->hostApi)->formatGeneration);
+	return S_OK;
+}
+
+static IMMNotificationClientVtbl PaWasapiNotificationClientVtbl =
+{
+	PaWasapiNotificationClient_QueryInterface,
+	PaWasapiNotificationClient_AddRef,
+	PaWasapiNotificationClient_Release,
+	PaWasapiNotificationClient_OnDeviceStateChanged,
+	PaWasapiNotificationClient_OnDeviceAdded,
+	PaWasapiNotificationClient_OnDeviceRemoved,
+	PaWasapiNotificationClient_OnDefaultDeviceChanged,
+	PaWasapiNotificationClient_OnPropertyValueChanged
+};
+#endif
+
+// ------------------------------------------------------------------------------------------
+static PaError EnableDeviceChangeNotification( struct PaUtilHostApiRepresentation *hostApi, int enable )
+{
+#ifndef PA_WINRT
+	PaWasapiHostApiRepresentation *paWasapi = (PaWasapiHostApiRepresentation*)hostApi;
+	PaWasapiNotificationClient *client = &paWasapi->notificationClient;
+	HRESULT hr;
+
+	if ((client->registered != FALSE) == (enable != 0) || paWasapi->enumerator == NULL)
+		return paNoError;
+
+	if (enable)
+	{
+		client->parent.lpVtbl = &PaWasapiNotificationClientVtbl;
+		client->hostApi = hostApi;
+		hr = IMMDeviceEnumerator_RegisterEndpointNotificationCallback(paWasapi->enumerator, &client->parent);
+		if (FAILED(hr))
+		{
+			LogHostError(hr);
+			return paUnanticipatedHostError;
+		}
+		client->registered = TRUE;
+	}
+	else
+	{
+		IMMDeviceEnumerator_UnregisterEndpointNotificationCallback(paWasapi->enumerator, &client->parent);
+		client->registered = FALSE;
+	}
+	return paNoError;
+#else
+	// No enumerator to register with, device changes go unnoticed
+	(void)hostApi;
+	(void)enable;
+	return paNoError;
+#endif
+}
+
 // ------------------------------------------------------------------------------------------
 #ifdef PA_WINRT
 static HRESULT ActivateAudioInterface_WINRT(const PaWasapiDeviceInfo *deviceInfo, const IID *iid, void **obj)
@@ -1403,6 +2007,59 @@ static HRESULT ActivateAudioInterface(const PaWasapiDeviceInfo *deviceInfo, IAud
 #endif
 }
 
+// ------------------------------------------------------------------------------------------
+static void GetDevicePeriods(PaWasapiDeviceInfo *deviceInfo, IAudioClient *client)
+{
+	HRESULT hr = IAudioClient_GetDevicePeriod(client, &deviceInfo->DefaultDevicePeriod, &deviceInfo->MinimumDevicePeriod);
+	if (FAILED(hr))
+	{
+		PA_DEBUG(("WASAPI: failed getting min/default periods by IAudioClient::GetDevicePeriod() with error[%08X], will use 30000/100000 hns\n", (UINT32)hr));
+
+		// assign WASAPI common values
+		deviceInfo->DefaultDevicePeriod = 100000;
+		deviceInfo->MinimumDevicePeriod = 30000;
+	}
+	deviceInfo->periodsProbed = TRUE;
+}
+
+// ------------------------------------------------------------------------------------------
+/* Query what initialization skipped for a device, once, before it is opened. The periods become
+   the default latencies of its PaDeviceInfo. */
+static PaError ProbeDeviceInfo(PaWasapiHostApiRepresentation *paWasapi, PaDeviceIndex index)
+{
+	PaWasapiDeviceInfo *info = &paWasapi->devInfo[index];
+	PaDeviceInfo *deviceInfo = paWasapi->inheritedHostApiRep.deviceInfos[index];
+	IAudioClient *tmpClient = NULL;
+	HRESULT hr;
+
+	if (info->periodsProbed)
+		return paNoError;
+
+	hr = ActivateAudioInterface(info, &tmpClient);
+	if (hr != S_OK)
+	{
+		LogHostError(hr);
+		return paInvalidDevice;
+	}
+	GetDevicePeriods(info, tmpClient);
+	SAFE_RELEASE(tmpClient);
+
+	if ((info->flow == eRender) && !info->loopBack)
+	{
+		deviceInfo->defaultHighOutputLatency = nano100ToSeconds(info->DefaultDevicePeriod);
+		deviceInfo->defaultLowOutputLatency  = nano100ToSeconds(info->MinimumDevicePeriod);
+	}
+	else
+	{
+		deviceInfo->defaultHighInputLatency = nano100ToSeconds(info->DefaultDevicePeriod);
+		deviceInfo->defaultLowInputLatency  = nano100ToSeconds(info->MinimumDevicePeriod);
+	}
+	PA_DEBUG(("WASAPI:%d| probed latency{hi[%f] lo[%f]}\n", index, (float)nano100ToSeconds(info->DefaultDevicePeriod),
+		(float)nano100ToSeconds(info->MinimumDevicePeriod)));
+
+	return paNoError;
+}
+
 // ------------------------------------------------------------------------------------------
 #ifdef PA_WINRT
 static DWORD SignalObjectAndWait(HANDLE hObjectToSignal, HANDLE hObjectToWaitOn, DWORD dwMilliseconds, BOOL bAlertable)
@@ -1419,7 +2076,7 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
     PaWasapiHostApiRepresentation *paWasapi;
     PaDeviceInfo *deviceInfoArray;
     HRESULT hr = S_OK;
-	UINT i;
+	UINT i, deviceCapacity;
 #ifndef PA_WINRT
     IMMDeviceCollection* pEndPoints = NULL;
 #else
@@ -1534,23 +2191,26 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
 	// [IF_FAILED_JUMP(hResult, error);]
 	IF_FAILED_INTERNAL_ERROR_JUMP(hr, result, error);
 
+	// Room for a loopback device after the endpoints for each render endpoint
+	deviceCapacity = paWasapi->deviceCount * 2;
 #else
 	paWasapi->deviceCount = 2;
+	deviceCapacity = paWasapi->deviceCount;
 #endif
 
-    paWasapi->devInfo = (PaWasapiDeviceInfo *)PaUtil_AllocateMemory(sizeof(PaWasapiDeviceInfo) * paWasapi->deviceCount);
+    paWasapi->devInfo = (PaWasapiDeviceInfo *)PaUtil_AllocateMemory(sizeof(PaWasapiDeviceInfo) * deviceCapacity);
     if (paWasapi->devInfo == NULL)
 	{
         result = paInsufficientMemory;
         goto error;
     }
-	for (i = 0; i < paWasapi->deviceCount; ++i)
+	for (i = 0; i < deviceCapacity; ++i)
 		memset(&paWasapi->devInfo[i], 0, sizeof(PaWasapiDeviceInfo));
 
     if (paWasapi->deviceCount > 0)
     {
         (*hostApi)->deviceInfos = (PaDeviceInfo **)PaUtil_GroupAllocateMemory(
-                paWasapi->allocations, sizeof(PaDeviceInfo *) * paWasapi->deviceCount);
+                paWasapi->allocations, sizeof(PaDeviceInfo *) * deviceCapacity);
         if ((*hostApi)->deviceInfos == NULL)
 		{
             result = paInsufficientMemory;
@@ -1559,7 +2219,7 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
 
         /* allocate all device info structs in a contiguous block */
         deviceInfoArray = (PaDeviceInfo *)PaUtil_GroupAllocateMemory(
-                paWasapi->allocations, sizeof(PaDeviceInfo) * paWasapi->deviceCount);
+                paWasapi->allocations, sizeof(PaDeviceInfo) * deviceCapacity);
         if (deviceInfoArray == NULL)
 		{
             result = paInsufficientMemory;
@@ -1678,6 +2338,17 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
                     PropVariantClear(&value);
                 }
 
+                // Raw processing support, the property is only present on Windows 8.1 and up
+                {
+                    PROPVARIANT value;
+                    PropVariantInit(&value);
+                    hr = IPropertyStore_GetValue(pProperty, &pa_PKEY_AudioDevice_RawProcessingSupported, &value);
+					paWasapi->devInfo[i].rawProcessingSupported = (SUCCEEDED(hr) && (value.vt == VT_BOOL) && (value.boolVal != VARIANT_FALSE));
+					PA_DEBUG(("WASAPI:%d| raw-processing[%d]\n", i, paWasapi->devInfo[i].rawProcessingSupported));
+                    // cleanup
+                    PropVariantClear(&value);
+                }
+
 				SAFE_RELEASE(pProperty);
             }
 			
@@ -1693,39 +2364,31 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
             }
 		#endif
 
+		#ifndef PA_WINRT
+            // Activating an IAudioClient of every endpoint made initialization slow with many devices,
+            // ProbeDeviceInfo() queries the periods when the device is first used, WASAPI's common
+            // periods are reported until then
+            paWasapi->devInfo[i].DefaultDevicePeriod = 100000;
+            paWasapi->devInfo[i].MinimumDevicePeriod = 30000;
+		#else
             // Getting a temporary IAudioClient for more fields
             // we make sure NOT to call Initialize yet!
             {
-			#ifdef PA_WINRT
+				// Create temp Audio Client instance to query additional details
+                IAudioClient *tmpClient = NULL;
+
 				// Set flow as ActivateAudioInterface depends on it and selects corresponding 
 				// direction for the Audio Client
 				paWasapi->devInfo[i].flow = (i == 0 ? eRender : eCapture);
-			#endif
 
-				// Create temp Audio Client instance to query additional details
-                IAudioClient *tmpClient = NULL;
                 hr = ActivateAudioInterface(&paWasapi->devInfo[i], &tmpClient);
 				// We need to set the result to a value otherwise we will return paNoError
 				// [IF_FAILED_JUMP(hResult, error);]
 				IF_FAILED_INTERNAL_ERROR_JUMP(hr, result, error);
 
 				// Get latency
-                hr = IAudioClient_GetDevicePeriod(tmpClient,
-                    &paWasapi->devInfo[i].DefaultDevicePeriod,
-                    &paWasapi->devInfo[i].MinimumDevicePeriod);
-				if (FAILED(hr))
-				{
-					PA_DEBUG(("WASAPI:%d| failed getting min/default periods by IAudioClient::GetDevicePeriod() with error[%08X], will use 30000/100000 hns\n", i, (UINT32)hr));
+				GetDevicePeriods(&paWasapi->devInfo[i], tmpClient);
 
-					// assign WASAPI common values
-					paWasapi->devInfo[i].DefaultDevicePeriod = 100000;
-					paWasapi->devInfo[i].MinimumDevicePeriod = 30000;
-
-					// ignore error, let continue further without failing with paInternalError
-					hr = S_OK;
-				}
-				
-			#ifdef PA_WINRT
 				// Get mix format which will treat as default device format
 				hr = IAudioClient_GetMixFormat(tmpClient, &mixFormat);
 				if (SUCCEEDED(hr))
@@ -1757,7 +2420,6 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
 					_snprintf((char *)deviceInfo->name, MAX_STR_LEN - 1, "WASAPI_%s:%d", (i == 0 ? "Output" : "Input"), i);
 					PA_DEBUG(("WASAPI:%d| name[%s]\n", i, deviceInfo->name));
 				}
-			#endif
 
 				// Release tmp client
 				SAFE_RELEASE(tmpClient);
@@ -1773,6 +2435,7 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
 					goto error;
 				}
             }
+		#endif
 			
             // we can now fill in portaudio device data
             deviceInfo->maxInputChannels  = 0;
@@ -1805,17 +2468,67 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
             (*hostApi)->deviceInfos[i] = deviceInfo;
             ++(*hostApi)->info.deviceCount;
         }
+
+	#ifndef PA_WINRT
+        // Loopback devices: the render endpoints once more, as input devices capturing what they play
+        for (i = 0; i < deviceCapacity / 2; ++i)
+		{
+            PaWasapiDeviceInfo *info = &paWasapi->devInfo[paWasapi->deviceCount];
+            PaDeviceInfo *deviceInfo = &deviceInfoArray[paWasapi->deviceCount];
+            char *deviceName;
+
+            if (paWasapi->devInfo[i].flow != eRender)
+                continue;
+
+            if ((deviceName = (char *)PaUtil_GroupAllocateMemory(paWasapi->allocations, MAX_STR_LEN + 1)) == NULL)
+			{
+                result = paInsufficientMemory;
+                goto error;
+            }
+            _snprintf(deviceName, MAX_STR_LEN - 1, "%s [Loopback]", deviceInfoArray[i].name);
+            deviceName[MAX_STR_LEN - 1] = 0;
+
+            (*info) = paWasapi->devInfo[i];
+            info->loopBack = TRUE;
+            info->nextFormatAnswer = 0;
+            memset(info->formatAnswers, 0, sizeof(info->formatAnswers));
+            IMMDevice_AddRef(info->device);
+
+            (*deviceInfo) = deviceInfoArray[i];
+            deviceInfo->name                     = deviceName;
+            deviceInfo->maxInputChannels         = deviceInfo->maxOutputChannels;
+            deviceInfo->defaultLowInputLatency   = deviceInfo->defaultLowOutputLatency;
+            deviceInfo->defaultHighInputLatency  = deviceInfo->defaultHighOutputLatency;
+            deviceInfo->maxOutputChannels        = 0;
+            deviceInfo->defaultLowOutputLatency  = 0;
+            deviceInfo->defaultHighOutputLatency = 0;
+			PA_DEBUG(("WASAPI:%d| name[%s]\n", paWasapi->deviceCount, deviceInfo->name));
+
+            (*hostApi)->deviceInfos[paWasapi->deviceCount] = deviceInfo;
+            ++paWasapi->deviceCount;
+            ++(*hostApi)->info.deviceCount;
+        }
+	#endif
     }
 
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = EnableDeviceChangeNotification;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &paWasapi->callbackStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
                                       GetStreamTime, GetStreamCpuLoad,
                                       PaUtil_DummyRead, PaUtil_DummyWrite,
                                       PaUtil_DummyGetReadAvailable, PaUtil_DummyGetWriteAvailable );
+    paWasapi->callbackStreamInterface.Pause = PauseStream;
+    paWasapi->callbackStreamInterface.Resume = ResumeStream;
+    paWasapi->callbackStreamInterface.StartAtTime = StartStreamAtTime;
+    paWasapi->callbackStreamInterface.Process = ProcessStream;
 
     PaUtil_InitializeStreamInterface( &paWasapi->blockingStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
@@ -1826,6 +2539,9 @@ PaError PaWasapi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
 	// findout if platform workaround is required
 	paWasapi->useWOW64Workaround = UseWOW64Workaround();
 
+	// cached format answers are valid from generation 1
+	paWasapi->formatGeneration = 1;
+
 #ifndef PA_WINRT
     SAFE_RELEASE(pEndPoints);
 #endif
@@ -1862,6 +2578,7 @@ static void Terminate( PaUtilHostApiRepresentation *hostApi )
 
 	// Release IMMDeviceEnumerator
 #ifndef PA_WINRT
+    EnableDeviceChangeNotification(hostApi, 0);
     SAFE_RELEASE(paWasapi->enumerator);
 #endif
 
@@ -1963,6 +2680,29 @@ int PaWasapi_GetDeviceRole( PaDeviceIndex nDevice )
 	return paWasapi->devInfo[ index ].formFactor;
 }
 
+// ------------------------------------------------------------------------------------------
+int PaWasapi_IsLoopback( PaDeviceIndex nDevice )
+{
+	PaError ret;
+	PaDeviceIndex index;
+
+	// Get API
+	PaWasapiHostApiRepresentation *paWasapi = _GetHostApi(&ret);
+	if (paWasapi == NULL)
+		return paNotInitialized;
+
+	// Get device index
+	ret = PaUtil_DeviceIndexToHostApiDeviceIndex(&index, nDevice, &paWasapi->inheritedHostApiRep);
+    if (ret != paNoError)
+        return ret;
+
+	// Validate index
+	if ((UINT32)index >= paWasapi->deviceCount)
+		return paInvalidDevice;
+
+	return (paWasapi->devInfo[ index ].loopBack ? 1 : 0);
+}
+
 // ------------------------------------------------------------------------------------------
 PaError PaWasapi_GetFramesPerHostBuffer( PaStream *pStream, unsigned int *nInput, unsigned int *nOutput )
 {
@@ -1976,7 +2716,110 @@ PaError PaWasapi_GetFramesPerHostBuffer( PaStream *pStream, unsigned int *nInput
 	if (nOutput != NULL)
 		(*nOutput) = stream->out.framesPerHostCallback;
 
-	return paNoError;
+	return paNoError;
+}
+
+// ------------------------------------------------------------------------------------------
+PaError PaWasapi_GetSharedModeEnginePeriod( PaDeviceIndex nDevice, unsigned int *nDefault,
+	unsigned int *nFundamental, unsigned int *nMin, unsigned int *nMax )
+{
+#ifdef __IAudioClient3_INTERFACE_DEFINED__
+	PaError ret;
+	PaDeviceIndex index;
+	HRESULT hr;
+	IAudioClient *audioClient = NULL;
+	UINT32 defaultPeriod, fundamentalPeriod, minPeriod, maxPeriod;
+
+	// Get API
+	PaWasapiHostApiRepresentation *paWasapi = _GetHostApi(&ret);
+	if (paWasapi == NULL)
+		return paNotInitialized;
+
+	// Get device index
+	ret = PaUtil_DeviceIndexToHostApiDeviceIndex(&index, nDevice, &paWasapi->inheritedHostApiRep);
+    if (ret != paNoError)
+        return ret;
+
+	// Validate index
+	if ((UINT32)index >= paWasapi->deviceCount)
+		return paInvalidDevice;
+
+	if (GetAudioClientVersion() < 3)
+		return paIncompatibleHostApiSpecificStreamInfo;
+
+	hr = ActivateAudioInterface(&paWasapi->devInfo[ index ], &audioClient);
+	if (hr != S_OK)
+	{
+		LogHostError(hr);
+		return paUnanticipatedHostError;
+	}
+
+	hr = IAudioClient3_GetSharedModeEnginePeriod((IAudioClient3 *)audioClient, &paWasapi->devInfo[ index ].DefaultFormat.Format,
+		&defaultPeriod, &fundamentalPeriod, &minPeriod, &maxPeriod);
+	SAFE_RELEASE(audioClient);
+	if (hr != S_OK)
+	{
+		LogHostError(hr);
+		return paUnanticipatedHostError;
+	}
+
+	if (nDefault != NULL)
+		(*nDefault) = defaultPeriod;
+	if (nFundamental != NULL)
+		(*nFundamental) = fundamentalPeriod;
+	if (nMin != NULL)
+		(*nMin) = minPeriod;
+	if (nMax != NULL)
+		(*nMax) = maxPeriod;
+
+	return paNoError;
+#else
+	(void)nDevice;
+	(void)nDefault;
+	(void)nFundamental;
+	(void)nMin;
+	(void)nMax;
+
+	// SDK does not provide IAudioClient3
+	return paIncompatibleHostApiSpecificStreamInfo;
+#endif
+}
+
+// ------------------------------------------------------------------------------------------
+PaError PaWasapi_IsRawStreamSupported( PaDeviceIndex nDevice, int *bSupported )
+{
+#ifndef PA_WINRT
+	PaError ret;
+	PaDeviceIndex index;
+
+	// Get API
+	PaWasapiHostApiRepresentation *paWasapi = _GetHostApi(&ret);
+	if (paWasapi == NULL)
+		return paNotInitialized;
+
+	if (bSupported == NULL)
+		return paBadBufferPtr;
+
+	// Get device index
+	ret = PaUtil_DeviceIndexToHostApiDeviceIndex(&index, nDevice, &paWasapi->inheritedHostApiRep);
+    if (ret != paNoError)
+        return ret;
+
+	// Validate index
+	if ((UINT32)index >= paWasapi->deviceCount)
+		return paInvalidDevice;
+
+	(*bSupported) = (paWasapi->devInfo[ index ].rawProcessingSupported &&
+		(GetWindowsVersion() >= WINDOWS_8_1_SERVER2012R2) && (GetAudioClientVersion() >= 2));
+
+	return paNoError;
+#else
+	(void)nDevice;
+	(void)bSupported;
+
+	// UWP devices have no property store to query
+	return paIncompatibleHostApiSpecificStreamInfo;
+#endif
 }
 
 // ------------------------------------------------------------------------------------------
@@ -2044,6 +2887,8 @@ static PaSampleFormat WaveToPaFormat(const WAVEFORMATEXTENSIBLE *in)
 		{
             if (in->Samples.wValidBitsPerSample == 32)
                 return paFloat32;
+            if (in->Samples.wValidBitsPerSample == 64)
+                return paFloat64;
         }
         else
 		if (IsEqualGUID(&in->SubFormat, &pa_KSDATAFORMAT_SUBTYPE_PCM))
@@ -2059,7 +2904,7 @@ static PaSampleFormat WaveToPaFormat(const WAVEFORMATEXTENSIBLE *in)
 		break; }
 
     case WAVE_FORMAT_IEEE_FLOAT:
-		return paFloat32;
+		return (old->wBitsPerSample == 64 ? paFloat64 : paFloat32);
 
     case WAVE_FORMAT_PCM: {
         switch (old->wBitsPerSample)
@@ -2097,7 +2942,7 @@ static PaError MakeWaveFormatFromParams(WAVEFORMATEXTENSIBLE *wavex, const PaStr
     old					 = (WAVEFORMATEX *)wavex;
     old->nChannels       = (WORD)params->channelCount;
     old->nSamplesPerSec  = (DWORD)sampleRate;
-	if ((old->wBitsPerSample = bitsPerSample) > 16)
+	if (((old->wBitsPerSample = bitsPerSample) > 16) && (bitsPerSample < 32))
 	{
 		old->wBitsPerSample = 32; // 20 or 24 bits must go in 32 bit containers (ints)
 	}
@@ -2116,7 +2961,8 @@ static PaError MakeWaveFormatFromParams(WAVEFORMATEXTENSIBLE *wavex, const PaStr
         old->wFormatTag = WAVE_FORMAT_EXTENSIBLE;
         old->cbSize		= sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
 
-        if ((params->sampleFormat & ~paNonInterleaved) == paFloat32)
+        if (((params->sampleFormat & ~paNonInterleaved) == paFloat32) ||
+            ((params->sampleFormat & ~paNonInterleaved) == paFloat64))
             wavex->SubFormat = pa_KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
         else
             wavex->SubFormat = pa_KSDATAFORMAT_SUBTYPE_PCM;
@@ -2355,6 +3201,71 @@ static PaError GetClosestFormat(IAudioClient *myClient, double sampleRate,
 	return answer;
 }
 
+// ------------------------------------------------------------------------------------------
+// The size of a version 1 PaWasapiStreamInfo, which ended with streamOption
+#define PA_WASAPI_STREAM_INFO_V1_SIZE_ (offsetof(PaWasapiStreamInfo, callbackCpus))
+// The size of a version 2 PaWasapiStreamInfo, which ended with callbackCpuCount
+#define PA_WASAPI_STREAM_INFO_V2_SIZE_ (offsetof(PaWasapiStreamInfo, channelSelectors))
+
+static BOOL IsWasapiStreamInfoValid(const PaWasapiStreamInfo *streamInfo)
+{
+	if (streamInfo->hostApiType != paWASAPI)
+		return FALSE;
+
+	if (!((streamInfo->size == PA_WASAPI_STREAM_INFO_V1_SIZE_) && (streamInfo->version == 1)) &&
+		!((streamInfo->size == PA_WASAPI_STREAM_INFO_V2_SIZE_) && (streamInfo->version == 2)) &&
+		!((streamInfo->size == sizeof(PaWasapiStreamInfo)) && (streamInfo->version == 3)))
+		return FALSE;
+
+	if ((streamInfo->flags & paWinWasapiUseChannelSelectors) &&
+		((streamInfo->version < 3) || (streamInfo->channelSelectors == NULL)))
+		return FALSE;
+
+	if ((streamInfo->version >= 2) &&
+		(PaWinUtil_ValidateCpus(streamInfo->callbackCpus, streamInfo->callbackCpuCount) != paNoError))
+		return FALSE;
+
+	return TRUE;
+}
+
+// The processors a stream's PaWasapiStreamInfo pins the processing thread to, NULL if any will do
+static const int *GetCallbackCpus(const PaStreamParameters *params, int *cpuCount)
+{
+	const PaWasapiStreamInfo *streamInfo = (params != NULL ? (const PaWasapiStreamInfo *)params->hostApiSpecificStreamInfo : NULL);
+
+	(*cpuCount) = 0;
+	if ((streamInfo == NULL) || (streamInfo->version < 2) || (streamInfo->callbackCpuCount <= 0))
+		return NULL;
+
+	(*cpuCount) = streamInfo->callbackCpuCount;
+	return streamInfo->callbackCpus;
+}
+
+// The device channels a stream's PaWasapiStreamInfo selects for its channels, NULL if they are the first ones
+static const int *GetChannelSelectors(const PaStreamParameters *params)
+{
+	const PaWasapiStreamInfo *streamInfo = (const PaWasapiStreamInfo *)params->hostApiSpecificStreamInfo;
+
+	if ((streamInfo == NULL) || (streamInfo->version < 3) || !(streamInfo->flags & paWinWasapiUseChannelSelectors))
+		return NULL;
+
+	return streamInfo->channelSelectors;
+}
+
+// The number of channels the device is to be opened with, up to the highest channel selected
+static int GetDeviceChannelCount(const PaStreamParameters *params)
+{
+	const int *channelSelectors = GetChannelSelectors(params);
+	int i, channelCount = 0;
+
+	if (channelSelectors == NULL)
+		return params->channelCount;
+
+	for (i = 0; i < params->channelCount; ++i)
+		channelCount = max(channelCount, channelSelectors[i] + 1);
+	return channelCount;
+}
+
 // ------------------------------------------------------------------------------------------
 static PaError IsStreamParamsValid(struct PaUtilHostApiRepresentation *hostApi,
                                    const  PaStreamParameters *inputParameters,
@@ -2378,22 +3289,32 @@ static PaError IsStreamParamsValid(struct PaUtilHostApiRepresentation *hostApi,
         if (inputParameters->device == paUseHostApiSpecificDeviceSpecification)
             return paInvalidDevice;
 
-        /* check that input device can support inputChannelCount */
-        if (inputParameters->channelCount > hostApi->deviceInfos[ inputParameters->device ]->maxInputChannels)
-            return paInvalidChannelCount;
-
         /* validate inputStreamInfo */
         if (inputParameters->hostApiSpecificStreamInfo)
 		{
 			PaWasapiStreamInfo *inputStreamInfo = (PaWasapiStreamInfo *)inputParameters->hostApiSpecificStreamInfo;
-	        if ((inputStreamInfo->size != sizeof(PaWasapiStreamInfo)) ||
-	            (inputStreamInfo->version != 1) ||
-                (inputStreamInfo->hostApiType != paWASAPI))
+	        if (!IsWasapiStreamInfoValid(inputStreamInfo))
 	        {
 	            return paIncompatibleHostApiSpecificStreamInfo;
 	        }
 		}
 
+        /* check the selected channels */
+        if (GetChannelSelectors(inputParameters) != NULL)
+        {
+            const int *channelSelectors = GetChannelSelectors(inputParameters);
+            int i;
+            for (i = 0; i < inputParameters->channelCount; ++i)
+            {
+                if (channelSelectors[i] < 0)
+                    return paInvalidChannelCount;
+            }
+        }
+
+        /* check that input device can support inputChannelCount */
+        if (GetDeviceChannelCount(inputParameters) > hostApi->deviceInfos[ inputParameters->device ]->maxInputChannels)
+            return paInvalidChannelCount;
+
         return paNoError;
     }
 
@@ -2417,9 +3338,7 @@ static PaError IsStreamParamsValid(struct PaUtilHostApiRepresentation *hostApi,
         if(outputParameters->hostApiSpecificStreamInfo)
         {
 			PaWasapiStreamInfo *outputStreamInfo = (PaWasapiStreamInfo *)outputParameters->hostApiSpecificStreamInfo;
-	        if ((outputStreamInfo->size != sizeof(PaWasapiStreamInfo)) ||
-	            (outputStreamInfo->version != 1) ||
-                (outputStreamInfo->hostApiType != paWASAPI))
+	        if (!IsWasapiStreamInfoValid(outputStreamInfo) || (outputStreamInfo->flags & paWinWasapiUseChannelSelectors))
 	        {
 	            return paIncompatibleHostApiSpecificStreamInfo;
 	        }
@@ -2431,15 +3350,81 @@ static PaError IsStreamParamsValid(struct PaUtilHostApiRepresentation *hostApi,
 	return (inputParameters || outputParameters ? paNoError : paInternalError);
 }
 
+// ------------------------------------------------------------------------------------------
+/* Answer IsFormatSupported() for one direction. Applications tend to probe many formats, each with
+   an IAudioClient activation, so Exclusive mode answers (which depend on the device only) are cached
+   per device until device properties change, as reported while device change notification is enabled. */
+static PaError GetFormatAnswer(PaWasapiHostApiRepresentation *paWasapi, const PaStreamParameters *params,
+	double sampleRate, BOOL output)
+{
+	PaWasapiDeviceInfo *info = &paWasapi->devInfo[params->device];
+	const PaWasapiStreamInfo *streamInfo = (const PaWasapiStreamInfo *)params->hostApiSpecificStreamInfo;
+	const LONG generation = paWasapi->formatGeneration;
+	AUDCLNT_SHAREMODE shareMode = AUDCLNT_SHAREMODE_SHARED;
+	DWORD channelMask = 0;
+	IAudioClient *tmpClient = NULL;
+	WAVEFORMATEXTENSIBLE wavex;
+	PaWasapiFormatAnswer *entry;
+	PaError answer;
+	HRESULT hr;
+	UINT32 i;
+
+	if (streamInfo != NULL)
+	{
+		if (streamInfo->flags & paWinWasapiExclusive)
+			shareMode = AUDCLNT_SHAREMODE_EXCLUSIVE;
+		if (streamInfo->flags & paWinWasapiUseChannelMask)
+			channelMask = streamInfo->channelMask;
+	}
+
+	if (shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE)
+	{
+		for (i = 0; i < PA_WASAPI_FORMAT_ANSWERS_; ++i)
+		{
+			entry = &info->formatAnswers[i];
+			if ((entry->generation == generation) && (entry->sampleRate == sampleRate) &&
+				(entry->channelCount == params->channelCount) && (entry->sampleFormat == params->sampleFormat) &&
+				(entry->channelMask == channelMask))
+			{
+				return entry->answer;
+			}
+		}
+	}
+
+	hr = ActivateAudioInterface(info, &tmpClient);
+	if (hr != S_OK)
+	{
+		LogHostError(hr);
+		return paInvalidDevice;
+	}
+
+	answer = GetClosestFormat(tmpClient, sampleRate, params, shareMode, &wavex, output);
+	SAFE_RELEASE(tmpClient);
+
+	if (shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE)
+	{
+		entry = &info->formatAnswers[info->nextFormatAnswer];
+		info->nextFormatAnswer = (info->nextFormatAnswer + 1) % PA_WASAPI_FORMAT_ANSWERS_;
+
+		entry->generation   = generation;
+		entry->sampleRate   = sampleRate;
+		entry->channelCount = params->channelCount;
+		entry->sampleFormat = params->sampleFormat;
+		entry->channelMask  = channelMask;
+		entry->answer       = answer;
+	}
+
+	return answer;
+}
+
 // ------------------------------------------------------------------------------------------
 static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
                                   const  PaStreamParameters *inputParameters,
                                   const  PaStreamParameters *outputParameters,
                                   double sampleRate )
 {
-	IAudioClient *tmpClient = NULL;
 	PaWasapiHostApiRepresentation *paWasapi = (PaWasapiHostApiRepresentation*)hostApi;
-	PaWasapiStreamInfo *inputStreamInfo = NULL, *outputStreamInfo = NULL;
+	PaError answer;
 
 	// Validate PaStreamParameters
 	PaError error;
@@ -2448,51 +3433,17 @@ static PaError IsFormatSupported( struct PaUtilHostApiRepresentation *hostApi,
 
     if (inputParameters != NULL)
     {
-		WAVEFORMATEXTENSIBLE wavex;
-		HRESULT hr;
-		PaError answer;
-		AUDCLNT_SHAREMODE shareMode = AUDCLNT_SHAREMODE_SHARED;
-		inputStreamInfo = (PaWasapiStreamInfo *)inputParameters->hostApiSpecificStreamInfo;
-
-		if (inputStreamInfo && (inputStreamInfo->flags & paWinWasapiExclusive))
-			shareMode  = AUDCLNT_SHAREMODE_EXCLUSIVE;
-
-		hr = ActivateAudioInterface(&paWasapi->devInfo[inputParameters->device], &tmpClient);
-		if (hr != S_OK)
-		{
-			LogHostError(hr);
-			return paInvalidDevice;
-		}
-
-		answer = GetClosestFormat(tmpClient, sampleRate, inputParameters, shareMode, &wavex, FALSE);
-		SAFE_RELEASE(tmpClient);
+		// the device is opened with the channels up to the highest one selected
+		PaStreamParameters deviceParameters = (*inputParameters);
+		deviceParameters.channelCount = GetDeviceChannelCount(inputParameters);
 
-		if (answer != paFormatIsSupported)
+		if ((answer = GetFormatAnswer(paWasapi, &deviceParameters, sampleRate, FALSE)) != paFormatIsSupported)
 			return answer;
     }
 
     if (outputParameters != NULL)
     {
-		HRESULT hr;
-		WAVEFORMATEXTENSIBLE wavex;
-		PaError answer;
-		AUDCLNT_SHAREMODE shareMode = AUDCLNT_SHAREMODE_SHARED;
-        outputStreamInfo = (PaWasapiStreamInfo *)outputParameters->hostApiSpecificStreamInfo;
-
-		if (outputStreamInfo && (outputStreamInfo->flags & paWinWasapiExclusive))
-			shareMode  = AUDCLNT_SHAREMODE_EXCLUSIVE;
-
-		hr = ActivateAudioInterface(&paWasapi->devInfo[outputParameters->device], &tmpClient);
-		if (hr != S_OK)
-		{
-			LogHostError(hr);
-			return paInvalidDevice;
-		}
-
-		answer = GetClosestFormat(tmpClient, sampleRate, outputParameters, shareMode, &wavex, TRUE);
-		SAFE_RELEASE(tmpClient);
-
-		if (answer != paFormatIsSupported)
+		if ((answer = GetFormatAnswer(paWasapi, outputParameters, sampleRate, TRUE)) != paFormatIsSupported)
 			return answer;
     }
 
@@ -2550,6 +3501,60 @@ static void _CalculateAlignedPeriod(PaWasapiSubStream *pSub, UINT32 *nFramesPerL
 	pSub->period = MakeHnsPeriod((*nFramesPerLatency), pSub->wavex.Format.nSamplesPerSec);
 }
 
+// ------------------------------------------------------------------------------------------
+#ifdef __IAudioClient3_INTERFACE_DEFINED__
+static UINT32 _AlignSharedEnginePeriod(UINT32 nFrames, UINT32 nFundamental, UINT32 nMin, UINT32 nMax)
+{
+	// Period must be nMin plus a multiple of nFundamental, round up to not go below requested latency
+	if (nFrames <= nMin)
+		return nMin;
+	if (nFundamental != 0)
+		nFrames = nMin + (((nFrames - nMin) + nFundamental - 1) / nFundamental) * nFundamental;
+	if (nFrames > nMax)
+		nFrames = nMax;
+
+	return nFrames;
+}
+
+// ------------------------------------------------------------------------------------------
+static HRESULT _InitializeSharedLowLatency(IAudioClient *audioClient, PaWasapiSubStream *pSub, UINT32 *nFramesPerLatency)
+{
+	HRESULT hr;
+	UINT32 defaultPeriod, fundamentalPeriod, minPeriod, maxPeriod, period;
+
+	hr = IAudioClient3_GetSharedModeEnginePeriod((IAudioClient3 *)audioClient, &pSub->wavex.Format,
+		&defaultPeriod, &fundamentalPeriod, &minPeriod, &maxPeriod);
+	if (hr != S_OK)
+		return hr;
+
+	period = _AlignSharedEnginePeriod((*nFramesPerLatency), fundamentalPeriod, minPeriod, maxPeriod);
+
+	hr = IAudioClient3_InitializeSharedAudioStream((IAudioClient3 *)audioClient, pSub->streamFlags, period,
+		&pSub->wavex.Format, NULL);
+	if (hr != S_OK)
+		return hr;
+
+	PRINT(("WASAPI: CreateAudioClient: low-latency Shared mode period = %d frames (min = %d, max = %d, fundamental = %d)\n",
+		period, minPeriod, maxPeriod, fundamentalPeriod));
+
+	(*nFramesPerLatency) = period;
+	pSub->period = MakeHnsPeriod(period, pSub->wavex.Format.nSamplesPerSec);
+
+	return S_OK;
+}
+#endif
+
+// ------------------------------------------------------------------------------------------
+// The flags IAudioClient::Initialize() is called with. A loopback capture is not signalled itself,
+// event driven loopback streams wait for the events of their silent render stream instead.
+static DWORD _GetInitializeStreamFlags(const PaWasapiSubStream *pSub)
+{
+	if (pSub->params.device_info->loopBack)
+		return (pSub->streamFlags & ~AUDCLNT_STREAMFLAGS_EVENTCALLBACK) | AUDCLNT_STREAMFLAGS_LOOPBACK;
+
+	return pSub->streamFlags;
+}
+
 // ------------------------------------------------------------------------------------------
 static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSub, BOOL output, PaError *pa_error)
 {
@@ -2566,6 +3571,13 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 	const UINT32 userFramesPerBuffer = framesPerLatency;
     IAudioClient *audioClient	     = NULL;
 
+	// IAudioClient3 low-latency Shared mode (paWinWasapiLowLatencyShared)
+	const BOOL lowLatencyShared      = (pSub->shareMode == AUDCLNT_SHAREMODE_SHARED) &&
+	                                   (pSub->flags & paWinWasapiLowLatencyShared) &&
+	                                   (pSub->streamFlags & AUDCLNT_STREAMFLAGS_EVENTCALLBACK) &&
+	                                   (pInfo != NULL) && !pInfo->loopBack &&
+	                                   (GetAudioClientVersion() >= 3);
+
 	// Assume default failure due to some reason
 	(*pa_error) = paInvalidDevice;
 
@@ -2608,7 +3620,7 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 		}*/
 
 		// select mixer
-		pSub->monoMixer = _GetMonoToStereoMixer(WaveToPaFormat(&pSub->wavex), (pInfo->flow == eRender ? MIX_DIR__1TO2 : MIX_DIR__2TO1_L));
+		pSub->monoMixer = _GetMonoToStereoMixer(WaveToPaFormat(&pSub->wavex), (output ? MIX_DIR__1TO2 : MIX_DIR__2TO1_L));
 		if (pSub->monoMixer == NULL)
 		{
 			(*pa_error) = paInvalidChannelCount;
@@ -2639,7 +3651,8 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 		// Use Polling if overall latency is > 5ms as it allows to use 100% CPU in a callback,
 		// or user specified latency parameter
 		overall = MakeHnsPeriod(framesPerLatency, pSub->wavex.Format.nSamplesPerSec);
-		if ((overall >= (106667*2)/*21.33ms*/) || ((INT32)(params->suggestedLatency*100000.0) != 0/*0.01 msec granularity*/))
+		if (!lowLatencyShared &&
+			((overall >= (106667*2)/*21.33ms*/) || ((INT32)(params->suggestedLatency*100000.0) != 0/*0.01 msec granularity*/)))
 		{
 			framesPerLatency = PaUtil_GetFramesPerHostBuffer(userFramesPerBuffer,
 				params->suggestedLatency, pSub->wavex.Format.nSamplesPerSec, 0/*,
@@ -2749,6 +3762,14 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 		case eStreamOptionRaw:
 			if (GetWindowsVersion() >= WINDOWS_8_1_SERVER2012R2)
 				audioProps.Options = pa_AUDCLNT_STREAMOPTIONS_RAW;
+		#ifndef PA_WINRT
+			// Devices without raw processing fail the properties as a whole, the category would be lost too
+			if (!pInfo->rawProcessingSupported)
+			{
+				PRINT(("WASAPI: device does not support raw processing, stream goes through the audio effects\n"));
+				audioProps.Options = pa_AUDCLNT_STREAMOPTIONS_NONE;
+			}
+		#endif
 			break;
 		case eStreamOptionMatchFormat:
 			if (GetWindowsVersion() >= WINDOWS_10_SERVER2016)
@@ -2768,10 +3789,25 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 	}
 #endif
 
+	// Open low-latency Shared mode stream with one of the periods of the audio engine,
+	// Windows may fail it for formats other than mix format, fall back to the default period of IAudioClient then
+#ifdef __IAudioClient3_INTERFACE_DEFINED__
+	if (lowLatencyShared)
+	{
+		UINT32 sharedFrames = (userFramesPerBuffer != 0 ? userFramesPerBuffer :
+			MakeFramesFromHns(SecondsTonano100(params->suggestedLatency), pSub->wavex.Format.nSamplesPerSec));
+
+		if ((hr = _InitializeSharedLowLatency(audioClient, pSub, &sharedFrames)) == S_OK)
+			goto client_initialized;
+
+		PRINT(("WASAPI: CreateAudioClient: IAudioClient3 low-latency Shared mode failed with error = %08X, using default period\n", (UINT32)hr));
+	}
+#endif
+
 	// Open the stream and associate it with an audio session
     hr = IAudioClient_Initialize(audioClient,
         pSub->shareMode,
-        pSub->streamFlags,
+        _GetInitializeStreamFlags(pSub),
 		pSub->period,
 		(pSub->shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE ? pSub->period : 0),
 		&pSub->wavex.Format,
@@ -2807,7 +3843,7 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 		// Open the stream and associate it with an audio session
 		hr = IAudioClient_Initialize(audioClient,
 			pSub->shareMode,
-			pSub->streamFlags,
+			_GetInitializeStreamFlags(pSub),
 			pSub->period,
 			(pSub->shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE ? pSub->period : 0),
 			&pSub->wavex.Format,
@@ -2838,7 +3874,7 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 		// Open the stream and associate it with an audio session
 		hr = IAudioClient_Initialize(audioClient,
 			pSub->shareMode,
-			pSub->streamFlags,
+			_GetInitializeStreamFlags(pSub),
 			pSub->period,
 			(pSub->shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE ? pSub->period : 0),
 			&pSub->wavex.Format,
@@ -2893,7 +3929,7 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 			}*/
 
 			// Select mixer
-			pSub->monoMixer = _GetMonoToStereoMixer(WaveToPaFormat(&pSub->wavex), (pInfo->flow == eRender ? MIX_DIR__1TO2 : MIX_DIR__2TO1_L));
+			pSub->monoMixer = _GetMonoToStereoMixer(WaveToPaFormat(&pSub->wavex), (output ? MIX_DIR__1TO2 : MIX_DIR__2TO1_L));
 			if (pSub->monoMixer == NULL)
 			{
 				(*pa_error) = paInvalidChannelCount;
@@ -2908,7 +3944,7 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
         // Open the stream and associate it with an audio session
         hr = IAudioClient_Initialize(audioClient,
             pSub->shareMode,
-            pSub->streamFlags,
+            _GetInitializeStreamFlags(pSub),
 			pSub->period,
 			(pSub->shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE ? pSub->period : 0),
             &pSub->wavex.Format,
@@ -2928,6 +3964,10 @@ static HRESULT CreateAudioClient(PaWasapiStream *pStream, PaWasapiSubStream *pSu
 		goto done;
     }
 
+#ifdef __IAudioClient3_INTERFACE_DEFINED__
+client_initialized:
+#endif
+
     // Set client
 	pSub->clientParent = audioClient;
     IAudioClient_AddRef(pSub->clientParent);
@@ -3092,6 +4132,93 @@ error:
 	return result;
 }
 
+// ------------------------------------------------------------------------------------------
+// Open the silent render stream of an event driven loopback input on the same endpoint. Loopback
+// captures are not signalled before Windows 10 1703 and get no packets while nothing plays on the
+// endpoint, the events of a Shared mode render stream playing silence at the period of the capture
+// drive the capture instead and keep the endpoint running. The event is set here and kept for
+// restarts, as the processing thread keeps the events it creates.
+static PaError CreateLoopbackRenderClient(PaWasapiStream *stream)
+{
+	PaWasapiSubStream *sub = &stream->loopbackRender;
+	WAVEFORMATEX *mixFormat = NULL;
+	HRESULT hr;
+
+	sub->shareMode          = AUDCLNT_SHAREMODE_SHARED;
+	sub->streamFlags        = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+	sub->period             = stream->in.period;
+	sub->params.device_info = stream->in.params.device_info;
+
+	if ((hr = ActivateAudioInterface(sub->params.device_info, &sub->clientParent)) != S_OK)
+		goto error;
+
+	// The silence is written with AUDCLNT_BUFFERFLAGS_SILENT, the mix format needs no conversion
+	if ((hr = IAudioClient_GetMixFormat(sub->clientParent, &mixFormat)) != S_OK)
+		goto error;
+	hr = IAudioClient_Initialize(sub->clientParent, AUDCLNT_SHAREMODE_SHARED, AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+		sub->period, 0, mixFormat, NULL);
+	if (hr == S_OK)
+	{
+		memcpy(&sub->wavex, mixFormat, min(sizeof(sub->wavex), sizeof(*mixFormat) + mixFormat->cbSize));
+		sub->framesPerHostCallback = MakeFramesFromHns(sub->period, mixFormat->nSamplesPerSec);
+	}
+	CoTaskMemFree(mixFormat);
+	if (hr != S_OK)
+		goto error;
+
+	if ((hr = IAudioClient_GetBufferSize(sub->clientParent, &sub->bufferSize)) != S_OK)
+		goto error;
+	if ((hr = IAudioClient_GetService(sub->clientParent, &pa_IID_IAudioRenderClient,
+		(void **)&stream->loopbackRenderClientParent)) != S_OK)
+		goto error;
+
+	if ((stream->event[S_INPUT] = CreateEvent(NULL, FALSE, FALSE, NULL)) == NULL)
+		return paInsufficientMemory;
+	if ((hr = IAudioClient_SetEventHandle(sub->clientParent, stream->event[S_INPUT])) != S_OK)
+		goto error;
+
+	PRINT(("WASAPI::OpenStream(input): loopback driven by silent render stream, period[ %d ] buffer[ %d ] frames\n",
+		sub->framesPerHostCallback, sub->bufferSize));
+
+	return paNoError;
+
+error:
+
+	LogHostError(hr);
+	return paUnanticipatedHostError;
+}
+
+// ------------------------------------------------------------------------------------------
+// Keep the silent render stream of a loopback input filled, one period per event of it
+static HRESULT FillLoopbackSilence(PaWasapiStream *stream, UINT32 frames)
+{
+	HRESULT hr;
+	BYTE *data = NULL;
+
+	if (stream->loopbackRenderClient == NULL)
+		return S_OK;
+
+	if ((hr = IAudioRenderClient_GetBuffer(stream->loopbackRenderClient, frames, &data)) != S_OK)
+		return (hr == AUDCLNT_E_BUFFER_TOO_LARGE ? S_OK : LogHostError(hr)); // still full, try again next time
+
+	return IAudioRenderClient_ReleaseBuffer(stream->loopbackRenderClient, frames, AUDCLNT_BUFFERFLAGS_SILENT);
+}
+
+// ------------------------------------------------------------------------------------------
+// Prefill and start the silent render stream of a loopback input, after the capture was started
+static HRESULT StartLoopbackRender(PaWasapiStream *stream)
+{
+	HRESULT hr;
+
+	if (stream->loopbackRender.clientProc == NULL)
+		return S_OK;
+
+	if ((hr = FillLoopbackSilence(stream, stream->loopbackRender.bufferSize)) != S_OK)
+		return hr;
+
+	return IAudioClient_Start(stream->loopbackRender.clientProc);
+}
+
 // ------------------------------------------------------------------------------------------
 static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                            PaStream** s,
@@ -3120,6 +4247,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 	if ((result = IsStreamParamsValid(hostApi, inputParameters, outputParameters, sampleRate)) != paNoError)
 		return LogPaError(result);
 
+	// Query the device periods which initialization left for the first use of a device
+	if ((inputParameters != NULL) && ((result = ProbeDeviceInfo(paWasapi, inputParameters->device)) != paNoError))
+		return LogPaError(result);
+	if ((outputParameters != NULL) && ((result = ProbeDeviceInfo(paWasapi, outputParameters->device)) != paNoError))
+		return LogPaError(result);
+
     // Validate platform specific flags
     if ((streamFlags & paPlatformSpecificFlags) != 0)
 	{
@@ -3137,6 +4270,26 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 	// Default thread priority is Audio: for exclusive mode we will use Pro Audio.
 	stream->nThreadPriority = eThreadPriorityAudio;
 
+	// Processors of the processing thread, output's have precedence
+	if (streamCallback != NULL)
+	{
+		int cpuCount;
+		const int *cpus = GetCallbackCpus(outputParameters, &cpuCount);
+		if (cpus == NULL)
+			cpus = GetCallbackCpus(inputParameters, &cpuCount);
+
+		if (cpus != NULL)
+		{
+			if ((stream->threadCpus = (int *)PaUtil_AllocateMemory(cpuCount * sizeof(int))) == NULL)
+			{
+				LogPaError(result = paInsufficientMemory);
+				goto error;
+			}
+			memcpy(stream->threadCpus, cpus, cpuCount * sizeof(int));
+			stream->threadCpuCount = cpuCount;
+		}
+	}
+
 	// Set default number of frames: paFramesPerBufferUnspecified
 	if (framesPerBuffer == paFramesPerBufferUnspecified)
 	{
@@ -3196,8 +4349,17 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 			}
 		}
 
-		// Choose processing mode
-		stream->in.streamFlags = (stream->in.shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE ? AUDCLNT_STREAMFLAGS_EVENTCALLBACK : 0);
+		// Loopback capture only works in Shared mode
+		if (info->loopBack && (stream->in.shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE))
+		{
+			LogPaError(result = paInvalidFlag);
+			goto error;
+		}
+
+		// Choose processing mode, loopback is driven by the events of its silent render stream
+		stream->in.streamFlags = (((stream->in.shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE) || info->loopBack ||
+			((inputStreamInfo != NULL) && (inputStreamInfo->flags & paWinWasapiLowLatencyShared) && (GetAudioClientVersion() >= 3))) ?
+			AUDCLNT_STREAMFLAGS_EVENTCALLBACK : 0);
 		if (paWasapi->useWOW64Workaround)
 			stream->in.streamFlags = 0; // polling interface
 		else
@@ -3213,12 +4375,24 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 		// Fill parameters for Audio Client creation
 		stream->in.params.device_info       = info;
 		stream->in.params.stream_params     = (*inputParameters);
+		stream->in.params.stream_params.channelCount = GetDeviceChannelCount(inputParameters);
 		stream->in.params.frames_per_buffer = framesPerBuffer;
 		stream->in.params.sample_rate       = sampleRate;
 		stream->in.params.blocking          = (streamCallback == NULL);
 		stream->in.params.full_duplex       = fullDuplex;
 		stream->in.params.wow64_workaround  = paWasapi->useWOW64Workaround;
 
+		// The buffer processor converts the selected device channels only
+		if (GetChannelSelectors(inputParameters) != NULL)
+		{
+			if ((stream->in.channelSelectors = (int *)PaUtil_AllocateMemory(sizeof(int) * inputChannelCount)) == NULL)
+			{
+				LogPaError(result = paInsufficientMemory);
+				goto error;
+			}
+			memcpy(stream->in.channelSelectors, GetChannelSelectors(inputParameters), sizeof(int) * inputChannelCount);
+		}
+
 		// Create and activate audio client
 		hr = ActivateAudioClientInput(stream);
         if (hr != S_OK)
@@ -3247,6 +4421,13 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 			goto error;
 		}
 
+		// Event driven loopback needs the silent render stream for its events
+		if (info->loopBack && (stream->in.streamFlags & AUDCLNT_STREAMFLAGS_EVENTCALLBACK))
+		{
+			if ((result = CreateLoopbackRenderClient(stream)) != paNoError)
+				goto error;
+		}
+
 		// Create ring buffer for blocking mode (It is needed because we fetch Input packets, not frames,
 		// and thus we have to save partial packet if such remains unread)
 		if (stream->in.params.blocking == TRUE)
@@ -3324,7 +4505,9 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 		}
 
 		// Choose processing mode
-		stream->out.streamFlags = (stream->out.shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE ? AUDCLNT_STREAMFLAGS_EVENTCALLBACK : 0);
+		stream->out.streamFlags = (((stream->out.shareMode == AUDCLNT_SHAREMODE_EXCLUSIVE) ||
+			((outputStreamInfo != NULL) && (outputStreamInfo->flags & paWinWasapiLowLatencyShared) && (GetAudioClientVersion() >= 3))) ?
+			AUDCLNT_STREAMFLAGS_EVENTCALLBACK : 0);
 		if (paWasapi->useWOW64Workaround)
 			stream->out.streamFlags = 0; // polling interface
 		else
@@ -3401,10 +4584,23 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 		}
 	}
 
+	// paManualProcessing runs a single direction per Pa_ProcessStream() call, full-duplex
+	// polling must match input and output packets itself and stays on the processing thread
+	if ((streamCallback != NULL) && (streamFlags & paManualProcessing))
+	{
+		if (fullDuplex)
+		{
+			LogPaError(result = paInvalidFlag);
+			goto error;
+		}
+		stream->bManualProcessing = TRUE;
+	}
+
 	// Initialize stream representation
     if (streamCallback)
     {
 		stream->bBlocking = FALSE;
+		stream->bMtaComPointers = IsThreadInMTA();
         PaUtil_InitializeStreamRepresentation(&stream->streamRepresentation,
                                               &paWasapi->callbackStreamInterface,
 											  streamCallback, userData);
@@ -3482,6 +4678,19 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 		LogPaError(result);
         goto error;
 	}
+	stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics(&stream->bufferProcessor);
+	stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock(&stream->bufferProcessor);
+	stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps(&stream->bufferProcessor);
+	stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter(&stream->bufferProcessor);
+	stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels(&stream->bufferProcessor);
+	stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain(&stream->bufferProcessor);
+
+	// Callback can write to IAudioRenderClient::GetBuffer and read from IAudioCaptureClient::GetBuffer memory
+	// directly if no conversion is needed, block adaption is checked for each buffer (WaspiZeroCopyProcess)
+	stream->bZeroCopy = !stream->bBlocking &&
+		(!inputChannelCount || ((inputSampleFormat == hostInputSampleFormat) && (stream->in.channelSelectors == NULL))) &&
+		(!outputChannelCount || (outputSampleFormat == hostOutputSampleFormat));
+	PRINT(("WASAPI: zero-copy callback %s\n", (stream->bZeroCopy ? "possible" : "not possible")));
 
 	// Set Input latency
     stream->streamRepresentation.streamInfo.inputLatency =
@@ -3521,8 +4730,10 @@ static PaError CloseStream( PaStream* s )
 
     SAFE_RELEASE(stream->captureClientParent);
     SAFE_RELEASE(stream->renderClientParent);
+    SAFE_RELEASE(stream->loopbackRenderClientParent);
     SAFE_RELEASE(stream->out.clientParent);
     SAFE_RELEASE(stream->in.clientParent);
+    SAFE_RELEASE(stream->loopbackRender.clientParent);
 	SAFE_RELEASE(stream->inVol);
 	SAFE_RELEASE(stream->outVol);
 
@@ -3540,6 +4751,10 @@ static PaError CloseStream( PaStream* s )
 	PaUtil_FreeMemory(stream->out.tailBuffer);
 	PaUtil_FreeMemory(stream->out.tailBufferMemory);
 
+	PaUtil_FreeMemory(stream->in.channelSelectors);
+
+	PaUtil_FreeMemory(stream->threadCpus);
+
     PaUtil_TerminateBufferProcessor(&stream->bufferProcessor);
     PaUtil_TerminateStreamRepresentation(&stream->streamRepresentation);
     PaUtil_FreeMemory(stream);
@@ -3547,28 +4762,71 @@ static PaError CloseStream( PaStream* s )
     return result;
 }
 
-// ------------------------------------------------------------------------------------------
-HRESULT UnmarshalSubStreamComPointers(PaWasapiSubStream *substream) 
-{
-#ifndef PA_WINRT
-	HRESULT hResult = S_OK;
-	HRESULT hFirstBadResult = S_OK;
-	substream->clientProc = NULL;
+// ------------------------------------------------------------------------------------------
+HRESULT UnmarshalSubStreamComPointers(PaWasapiSubStream *substream) 
+{
+#ifndef PA_WINRT
+	HRESULT hResult = S_OK;
+	HRESULT hFirstBadResult = S_OK;
+	substream->clientProc = NULL;
+
+	// IAudioClient
+	hResult = CoGetInterfaceAndReleaseStream(substream->clientStream, GetAudioClientIID(), (LPVOID*)&substream->clientProc);
+	substream->clientStream = NULL;
+	if (hResult != S_OK) 
+	{
+		hFirstBadResult = (hFirstBadResult == S_OK) ? hResult : hFirstBadResult;
+	}
+
+	return hFirstBadResult;
+
+#else
+	(void)substream;
+	return S_OK;
+#endif
+}
+
+// ------------------------------------------------------------------------------------------
+// Use parent COM pointers directly, valid if the processing thread is in the same apartment
+static HRESULT ReferenceStreamComPointers(PaWasapiStream *stream)
+{
+	if (stream->in.clientParent != NULL)
+	{
+		stream->in.clientProc = stream->in.clientParent;
+		IAudioClient_AddRef(stream->in.clientParent);
+	}
+
+	if (stream->out.clientParent != NULL)
+	{
+		stream->out.clientProc = stream->out.clientParent;
+		IAudioClient_AddRef(stream->out.clientParent);
+	}
+
+	if (stream->renderClientParent != NULL)
+	{
+		stream->renderClient = stream->renderClientParent;
+		IAudioRenderClient_AddRef(stream->renderClientParent);
+	}
+
+	if (stream->captureClientParent != NULL)
+	{
+		stream->captureClient = stream->captureClientParent;
+		IAudioCaptureClient_AddRef(stream->captureClientParent);
+	}
 
-	// IAudioClient
-	hResult = CoGetInterfaceAndReleaseStream(substream->clientStream, GetAudioClientIID(), (LPVOID*)&substream->clientProc);
-	substream->clientStream = NULL;
-	if (hResult != S_OK) 
+	if (stream->loopbackRender.clientParent != NULL)
 	{
-		hFirstBadResult = (hFirstBadResult == S_OK) ? hResult : hFirstBadResult;
+		stream->loopbackRender.clientProc = stream->loopbackRender.clientParent;
+		IAudioClient_AddRef(stream->loopbackRender.clientParent);
 	}
 
-	return hFirstBadResult;
+	if (stream->loopbackRenderClientParent != NULL)
+	{
+		stream->loopbackRenderClient = stream->loopbackRenderClientParent;
+		IAudioRenderClient_AddRef(stream->loopbackRenderClientParent);
+	}
 
-#else
-	(void)substream;
 	return S_OK;
-#endif
 }
 
 // ------------------------------------------------------------------------------------------
@@ -3579,8 +4837,14 @@ HRESULT UnmarshalStreamComPointers(PaWasapiStream *stream)
 	HRESULT hFirstBadResult = S_OK;
 	stream->captureClient = NULL;
 	stream->renderClient = NULL;
+	stream->loopbackRenderClient = NULL;
 	stream->in.clientProc = NULL;
 	stream->out.clientProc = NULL;
+	stream->loopbackRender.clientProc = NULL;
+
+	// MTA fast path: nothing was marshaled
+	if (stream->bMtaComPointers)
+		return ReferenceStreamComPointers(stream);
 
 	if (NULL != stream->in.clientParent) 
 	{
@@ -3618,33 +4882,27 @@ HRESULT UnmarshalStreamComPointers(PaWasapiStream *stream)
 		}
 	}
 
-	return hFirstBadResult;
-#else
-	if (stream->in.clientParent != NULL)
-	{
-		stream->in.clientProc = stream->in.clientParent;
-		IAudioClient_AddRef(stream->in.clientParent);
-	}
-
-	if (stream->out.clientParent != NULL)
-	{
-		stream->out.clientProc = stream->out.clientParent;
-		IAudioClient_AddRef(stream->out.clientParent);
-	}
-
-	if (stream->renderClientParent != NULL)
+	if (NULL != stream->loopbackRender.clientParent) 
 	{
-		stream->renderClient = stream->renderClientParent;
-		IAudioRenderClient_AddRef(stream->renderClientParent);
-	}
+		// SubStream pointers
+		hResult = UnmarshalSubStreamComPointers(&stream->loopbackRender);
+		if (hResult != S_OK) 
+		{
+			hFirstBadResult = (hFirstBadResult == S_OK) ? hResult : hFirstBadResult;
+		}
 
-	if (stream->captureClientParent != NULL)
-	{
-		stream->captureClient = stream->captureClientParent;
-		IAudioCaptureClient_AddRef(stream->captureClientParent);
+		// IAudioRenderClient of loopback
+		hResult = CoGetInterfaceAndReleaseStream(stream->loopbackRenderClientStream, &pa_IID_IAudioRenderClient, (LPVOID*)&stream->loopbackRenderClient);
+		stream->loopbackRenderClientStream = NULL;
+		if (hResult != S_OK) 
+		{
+			hFirstBadResult = (hFirstBadResult == S_OK) ? hResult : hFirstBadResult;
+		}
 	}
 
-	return S_OK;
+	return hFirstBadResult;
+#else
+	return ReferenceStreamComPointers(stream);
 #endif
 }
 
@@ -3660,10 +4918,12 @@ void ReleaseUnmarshaledComPointers(PaWasapiStream *stream)
 	// Release AudioClient services first
 	SAFE_RELEASE(stream->captureClient);
 	SAFE_RELEASE(stream->renderClient);
+	SAFE_RELEASE(stream->loopbackRenderClient);
 
 	// Release AudioClients
 	ReleaseUnmarshaledSubComPointers(&stream->in);
 	ReleaseUnmarshaledSubComPointers(&stream->out);
+	ReleaseUnmarshaledSubComPointers(&stream->loopbackRender);
 }
 
 // ------------------------------------------------------------------------------------------
@@ -3701,6 +4961,12 @@ HRESULT MarshalStreamComPointers(PaWasapiStream *stream)
 	stream->in.clientStream = NULL;
 	stream->renderClientStream = NULL;
 	stream->out.clientStream = NULL;
+	stream->loopbackRenderClientStream = NULL;
+	stream->loopbackRender.clientStream = NULL;
+
+	// MTA fast path: processing thread joins MTA and can use parent pointers directly
+	if (stream->bMtaComPointers)
+		return S_OK;
 
 	if (NULL != stream->in.clientParent) 
 	{
@@ -3728,6 +4994,19 @@ HRESULT MarshalStreamComPointers(PaWasapiStream *stream)
 			goto marshal_error;
 	}
 
+	if (NULL != stream->loopbackRender.clientParent) 
+	{
+		// SubStream pointers
+		hResult = MarshalSubStreamComPointers(&stream->loopbackRender);
+		if (hResult != S_OK) 
+			goto marshal_error;
+
+		// IAudioRenderClient of loopback
+		hResult = CoMarshalInterThreadInterfaceInStream(&pa_IID_IAudioRenderClient, (LPUNKNOWN)stream->loopbackRenderClientParent, &stream->loopbackRenderClientStream);
+		if (hResult != S_OK) 
+			goto marshal_error;
+	}
+
 	return hResult;
 
 	// If marshaling error occurred, make sure to release everything.
@@ -3765,6 +5044,13 @@ static PaError StartStream( PaStream *s )
 		goto start_error;
 	}
 
+	// Application's thread processes the stream
+	if (stream->bManualProcessing)
+	{
+		if ((result = _StreamStartManual(stream)) != paNoError)
+			goto start_error;
+	}
+	else
 	// Create thread
 	if (!stream->bBlocking)
 	{
@@ -3805,6 +5091,16 @@ static PaError StartStream( PaStream *s )
 			}
 		}
 
+		// Pin thread to the processors of PaWasapiStreamInfo
+		if (stream->threadCpus != NULL)
+		{
+			if ((result = PaWinUtil_SetThreadCpuAffinity(stream->hThread, stream->threadCpus, stream->threadCpuCount)) != paNoError)
+			{
+				PRINT(("Failed setting thread affinity."));
+				goto nonblocking_start_error;
+			}
+		}
+
 		// Wait for thread to start
 		if (WaitForSingleObject(stream->hThreadStart, 60*1000) == WAIT_TIMEOUT) 
 		{
@@ -3823,6 +5119,7 @@ static PaError StartStream( PaStream *s )
 				result = paInsufficientMemory;
 				goto start_error;
 			}
+			stream->hBlockingTimerWR = PaWinUtil_CreateHighResolutionTimer();
 		}
 		if (stream->in.clientParent != NULL) 
 		{
@@ -3831,6 +5128,7 @@ static PaError StartStream( PaStream *s )
 				result = paInsufficientMemory;
 				goto start_error;
 			}
+			stream->hBlockingTimerRD = PaWinUtil_CreateHighResolutionTimer();
 		}
 
 		// Initialize event & start INPUT stream
@@ -3881,9 +5179,28 @@ start_error:
 	return result;
 }
 
+static PaError StartStreamAtTime( PaStream *s, PaTime startTime )
+{
+	PaWasapiStream *stream = (PaWasapiStream*)s;
+	PaError result;
+
+	PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, startTime );
+	result = StartStream( s );
+	if( result != paNoError )
+		PaUtil_SetBufferProcessorStartTime( &stream->bufferProcessor, 0. );
+	return result;
+}
+
 // ------------------------------------------------------------------------------------------
 void _StreamFinish(PaWasapiStream *stream)
 {
+	// Pa_ProcessStream() must not be running, there is no thread to wait for
+	if (stream->bManualProcessing)
+	{
+		if (stream->running)
+			_StreamOnStop(stream);
+	}
+	else
 	// Issue command to thread to stop processing and wait for thread exit
 	if (!stream->bBlocking)
 	{
@@ -3918,6 +5235,9 @@ void _StreamCleanup(PaWasapiStream *stream)
 	SAFE_CLOSE(stream->hCloseRequest);
 	SAFE_CLOSE(stream->hBlockingOpStreamRD);
 	SAFE_CLOSE(stream->hBlockingOpStreamWR);
+	SAFE_CLOSE(stream->hBlockingTimerRD);
+	SAFE_CLOSE(stream->hBlockingTimerWR);
+	SAFE_CLOSE(stream->hManualTimer);
 }
 
 // ------------------------------------------------------------------------------------------
@@ -3948,6 +5268,22 @@ static PaError IsStreamActive( PaStream *s )
     return ((PaWasapiStream *)s)->running;
 }
 
+// ------------------------------------------------------------------------------------------
+// The client keeps running while paused, the buffer processor outputs silence instead of
+// calling the callback, so that resuming doesn't re-activate the audio client.
+static PaError PauseStream( PaStream *s )
+{
+    PaUtil_SetBufferProcessorPaused( &((PaWasapiStream *)s)->bufferProcessor, 1 );
+    return paNoError;
+}
+
+// ------------------------------------------------------------------------------------------
+static PaError ResumeStream( PaStream *s )
+{
+    PaUtil_SetBufferProcessorPaused( &((PaWasapiStream *)s)->bufferProcessor, 0 );
+    return paNoError;
+}
+
 // ------------------------------------------------------------------------------------------
 static PaTime GetStreamTime( PaStream *s )
 {
@@ -3965,6 +5301,20 @@ static double GetStreamCpuLoad( PaStream* s )
 	return PaUtil_GetCpuLoad(&((PaWasapiStream *)s)->cpuLoadMeasurer);
 }
 
+// ------------------------------------------------------------------------------------------
+// Register an interleaved host input buffer with the buffer processor, of which only the selected
+// channels are converted if the stream has channel selectors
+static void SetInputChannels( PaWasapiStream *stream, void *buffer )
+{
+	if (stream->in.channelSelectors != NULL)
+	{
+		PaUtil_SetSelectedInterleavedInputChannels(&stream->bufferProcessor, buffer,
+			stream->in.params.stream_params.channelCount, stream->in.channelSelectors);
+	}
+	else
+		PaUtil_SetInterleavedInputChannels(&stream->bufferProcessor, 0, buffer, stream->bufferProcessor.inputChannelCount);
+}
+
 // ------------------------------------------------------------------------------------------
 static PaError ReadStream( PaStream* s, void *_buffer, unsigned long frames )
 {
@@ -4023,7 +5373,7 @@ static PaError ReadStream( PaStream* s, void *_buffer, unsigned long frames )
 			PaUtil_SetInputFrameCount(&stream->bufferProcessor, buf1_size);
 
 			// Register host buffer pointer to processor
-			PaUtil_SetInterleavedInputChannels(&stream->bufferProcessor, 0, buf1, stream->bufferProcessor.inputChannelCount);
+			SetInputChannels(stream, buf1);
 
 			// Copy user data to host buffer (with conversion if applicable)
 			processed = PaUtil_CopyInput(&stream->bufferProcessor, (void **)&user_buffer, buf1_size);
@@ -4036,7 +5386,7 @@ static PaError ReadStream( PaStream* s, void *_buffer, unsigned long frames )
 			PaUtil_SetInputFrameCount(&stream->bufferProcessor, buf2_size);
 
 			// Register host buffer pointer to processor
-			PaUtil_SetInterleavedInputChannels(&stream->bufferProcessor, 0, buf2, stream->bufferProcessor.inputChannelCount);
+			SetInputChannels(stream, buf2);
 
 			// Copy user data to host buffer (with conversion if applicable)
 			processed = PaUtil_CopyInput(&stream->bufferProcessor, (void **)&user_buffer, buf2_size);
@@ -4051,7 +5401,7 @@ static PaError ReadStream( PaStream* s, void *_buffer, unsigned long frames )
 	while (frames != 0)
 	{
 		// Check if blocking call must be interrupted
-		if (WaitForSingleObject(stream->hCloseRequest, sleep) != WAIT_TIMEOUT)
+		if (PaWinUtil_WaitWithTimer(stream->hBlockingTimerRD, stream->hCloseRequest, sleep * 0.001) != WAIT_TIMEOUT)
 			break;
 
 		// Get available frames (must be finding out available frames before call to IAudioCaptureClient_GetBuffer
@@ -4088,7 +5438,7 @@ static PaError ReadStream( PaStream* s, void *_buffer, unsigned long frames )
 			{
 				if ((sleep = ThreadIdleScheduler_NextSleep(&sched)) != 0)
 				{
-					Sleep(sleep);
+					PaWinUtil_WaitWithTimer(stream->hBlockingTimerRD, NULL, sleep * 0.001);
 					sleep = 0;
 				}
 			}
@@ -4113,7 +5463,7 @@ static PaError ReadStream( PaStream* s, void *_buffer, unsigned long frames )
         PaUtil_SetInputFrameCount(&stream->bufferProcessor, available);
 
 		// Register host buffer pointer to processor
-        PaUtil_SetInterleavedInputChannels(&stream->bufferProcessor, 0, wasapi_buffer, stream->bufferProcessor.inputChannelCount);
+        SetInputChannels(stream, wasapi_buffer);
 
 		// Copy user data to host buffer (with conversion if applicable)
 		processed = PaUtil_CopyInput(&stream->bufferProcessor, (void **)&user_buffer, frames);
@@ -4186,7 +5536,7 @@ static PaError WriteStream( PaStream* s, const void *_buffer, unsigned long fram
 	while (frames != 0)
 	{
 		// Check if blocking call must be interrupted
-		if (WaitForSingleObject(stream->hCloseRequest, sleep) != WAIT_TIMEOUT)
+		if (PaWinUtil_WaitWithTimer(stream->hBlockingTimerWR, stream->hCloseRequest, sleep * 0.001) != WAIT_TIMEOUT)
 			break;
 
 		// Get frames available
@@ -4313,6 +5663,40 @@ static signed long GetStreamWriteAvailable( PaStream* s )
 }
 
 
+// ------------------------------------------------------------------------------------------
+// Call user callback directly on the host buffers in place of the buffer processor, if the stream
+// allows it (bZeroCopy) and the buffers have the size the callback expects. Returns FALSE if the
+// buffer processor must be used.
+static BOOL WaspiZeroCopyProcess( PaWasapiStream *stream, void *inputBuffer, long inputFrames,
+                                  void *outputBuffer, long outputFrames,
+                                  PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags flags,
+                                  int *callbackResult )
+{
+	PaUtilBufferProcessor *bp = &stream->bufferProcessor;
+	unsigned long frames = (bp->inputChannelCount > 0 ? inputFrames : outputFrames);
+
+	if (!stream->bZeroCopy)
+		return FALSE;
+
+	// a scheduled start, pause or output gain is applied by the buffer processor
+	if (!PaUtil_CanBypassBufferProcessor(bp))
+		return FALSE;
+
+	// Full-duplex callback must get both directions at once
+	if ((bp->inputChannelCount > 0) && (inputBuffer == NULL))
+		return FALSE;
+	if ((bp->outputChannelCount > 0) && ((outputBuffer == NULL) || ((unsigned long)outputFrames != frames)))
+		return FALSE;
+	if ((bp->framesPerUserBuffer != paFramesPerBufferUnspecified) && (bp->framesPerUserBuffer != frames))
+		return FALSE;
+
+	PaUtil_BeginBufferProcessing(bp, timeInfo, flags);
+	PaUtil_EndBufferProcessingDirectly(bp, inputBuffer, outputBuffer, frames, callbackResult);
+
+	PaUtil_EndCpuLoadMeasurement(&stream->cpuLoadMeasurer, frames);
+	return TRUE;
+}
+
 // ------------------------------------------------------------------------------------------
 static void WaspiHostProcessingLoop( void *inputBuffer,  long inputFrames,
                                      void *outputBuffer, long outputFrames,
@@ -4344,6 +5728,10 @@ static void WaspiHostProcessingLoop( void *inputBuffer,  long inputFrames,
 			pending_time = (PaTime)stream->in.latencySeconds;
 
 		timeInfo.inputBufferAdcTime = timeInfo.currentTime + pending_time;
+
+		// Loopback packets carry the QPC time of their first frame, the clock of PaUtil_GetTime()
+		if (stream->inputPacketTime != 0)
+			timeInfo.inputBufferAdcTime = stream->inputPacketTime;
 	}
 	// Query output current latency
 	if (stream->out.clientProc != NULL)
@@ -4362,6 +5750,10 @@ static void WaspiHostProcessingLoop( void *inputBuffer,  long inputFrames,
         portaudio format, do it here.
     */
 
+	callbackResult = paContinue;
+	if (WaspiZeroCopyProcess(stream, inputBuffer, inputFrames, outputBuffer, outputFrames, &timeInfo, flags, &callbackResult))
+		goto done;
+
     PaUtil_BeginBufferProcessing( &stream->bufferProcessor, &timeInfo, flags );
 
     /*
@@ -4373,10 +5765,7 @@ static void WaspiHostProcessingLoop( void *inputBuffer,  long inputFrames,
     if (stream->bufferProcessor.inputChannelCount > 0)
     {
         PaUtil_SetInputFrameCount( &stream->bufferProcessor, inputFrames );
-        PaUtil_SetInterleavedInputChannels( &stream->bufferProcessor,
-            0, /* first channel of inputBuffer is channel 0 */
-            inputBuffer,
-            0 ); /* 0 - use inputChannelCount passed to init buffer processor */
+        SetInputChannels( stream, inputBuffer );
     }
 
     if (stream->bufferProcessor.outputChannelCount > 0)
@@ -4404,6 +5793,7 @@ static void WaspiHostProcessingLoop( void *inputBuffer,  long inputFrames,
 
 	PaUtil_EndCpuLoadMeasurement( &stream->cpuLoadMeasurer, framesProcessed );
 
+done:
     if (callbackResult == paContinue)
     {
         /* nothing special to do */
@@ -4425,19 +5815,12 @@ static void WaspiHostProcessingLoop( void *inputBuffer,  long inputFrames,
 HANDLE MMCSS_activate(const char *name)
 {
 #ifndef PA_WINRT
-    DWORD task_idx = 0;
-    HANDLE hTask = pAvSetMmThreadCharacteristics(name, &task_idx);
+    HANDLE hTask = (HANDLE)PaWinUtil_RegisterMmcssThread(name, paWinUtilMmcssDefaultPriority);
     if (hTask == NULL)
 	{
         PRINT(("WASAPI: AvSetMmThreadCharacteristics failed!\n"));
     }
 
-    /*BOOL priority_ok = pAvSetMmThreadPriority(hTask, AVRT_PRIORITY_NORMAL);
-    if (priority_ok == FALSE)
-	{
-        PRINT(("WASAPI: AvSetMmThreadPriority failed!\n"));
-    }*/
-
 	// debug
     {
         int    cur_priority		  = GetThreadPriority(GetCurrentThread());
@@ -4459,10 +5842,7 @@ void MMCSS_deactivate(HANDLE hTask)
 		return;
 
 #ifndef PA_WINRT
-	if (pAvRevertMmThreadCharacteristics(hTask) == FALSE)
-	{
-        PRINT(("WASAPI: AvRevertMmThreadCharacteristics failed!\n"));
-    }
+	PaWinUtil_RevertMmcssThread(hTask);
 #endif
 }
 
@@ -4485,7 +5865,7 @@ PaError PaWasapi_ThreadPriorityBoost(void **hTask, PaWasapiThreadPriority nPrior
 	if (hTask == NULL)
 		return paUnanticipatedHostError;
 
-	if ((UINT32)nPriorityClass >= STATIC_ARRAY_SIZE(mmcs_name))
+	if ((UINT32)nPriorityClass >= STATIC_ARRAY_SIZE(mmcs_name) || mmcs_name[nPriorityClass] == NULL)
 		return paUnanticipatedHostError;
 
 	task = MMCSS_activate(mmcs_name[nPriorityClass]);
@@ -4876,6 +6256,12 @@ HRESULT ProcessInputBuffer(PaWasapiStream *stream, PaWasapiHostProcessor *proces
 	UINT32 frames;
 	BYTE *data = NULL;
 	DWORD flags = 0;
+	UINT64 qpcPosition = 0;
+	const BOOL loopBack = stream->in.params.device_info->loopBack;
+
+	// Event of the silent render stream of loopback, keep it playing
+	if ((hr = FillLoopbackSilence(stream, stream->loopbackRender.framesPerHostCallback)) != S_OK)
+		return hr;
 
 	for (;;)
 	{
@@ -4893,7 +6279,8 @@ HRESULT ProcessInputBuffer(PaWasapiStream *stream, PaWasapiHostProcessor *proces
 			break;
 
 		// Get the available data in the shared buffer.
-		if ((hr = IAudioCaptureClient_GetBuffer(stream->captureClient, &data, &frames, &flags, NULL, NULL)) != S_OK)
+		if ((hr = IAudioCaptureClient_GetBuffer(stream->captureClient, &data, &frames, &flags, NULL,
+			(loopBack ? &qpcPosition : NULL))) != S_OK)
 		{
 			if (hr == AUDCLNT_S_BUFFER_EMPTY)
 			{
@@ -4909,6 +6296,11 @@ HRESULT ProcessInputBuffer(PaWasapiStream *stream, PaWasapiHostProcessor *proces
 		// if (flags & AUDCLNT_BUFFERFLAGS_SILENT)
 		//	data = NULL;
 
+		// QPC position is in 100-nanosecond units
+		if (loopBack)
+			stream->inputPacketTime = ((qpcPosition != 0) && !(flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) ?
+				(PaTime)qpcPosition * 1e-7 : 0);
+
 		// Process data
 		if (stream->in.monoMixer != NULL)
 		{
@@ -4948,6 +6340,13 @@ void _StreamOnStop(PaWasapiStream *stream)
 			IAudioClient_Stop(stream->in.clientProc);
 		if (stream->out.clientProc != NULL)
 			IAudioClient_Stop(stream->out.clientProc);
+
+		// Silent render stream of loopback, reset to prefill it with silence again on restart
+		if (stream->loopbackRender.clientProc != NULL)
+		{
+			IAudioClient_Stop(stream->loopbackRender.clientProc);
+			IAudioClient_Reset(stream->loopbackRender.clientProc);
+		}
 	} 
 	else 
 	{
@@ -4969,6 +6368,209 @@ void _StreamOnStop(PaWasapiStream *stream)
         stream->streamRepresentation.streamFinishedCallback(stream->streamRepresentation.userData);
 }
 
+// ------------------------------------------------------------------------------------------
+// Start a paManualProcessing stream as the processing threads do, but on the application's
+// thread, which uses the stream's COM pointers directly as blocking streams do.
+PaError _StreamStartManual(PaWasapiStream *stream)
+{
+	HRESULT hr;
+	PaError result = paNoError;
+	PaWasapiHostProcessor defaultProcessor;
+	const int i = (stream->in.clientParent != NULL ? S_INPUT : S_OUTPUT);
+	const BOOL bEvent = ((i == S_INPUT ? stream->in.streamFlags : stream->out.streamFlags) &
+		AUDCLNT_STREAMFLAGS_EVENTCALLBACK) != 0;
+
+	// Set parent to working pointers to use shared functions
+	stream->captureClient  = stream->captureClientParent;
+	stream->renderClient   = stream->renderClientParent;
+	stream->in.clientProc  = stream->in.clientParent;
+	stream->out.clientProc = stream->out.clientParent;
+	stream->loopbackRenderClient      = stream->loopbackRenderClientParent;
+	stream->loopbackRender.clientProc = stream->loopbackRender.clientParent;
+
+	// Setup data processors
+	defaultProcessor.processor = WaspiHostProcessingLoop;
+	defaultProcessor.userData  = stream;
+	stream->manualProcessor[S_INPUT] = (stream->hostProcessOverrideInput.processor != NULL ? stream->hostProcessOverrideInput : defaultProcessor);
+	stream->manualProcessor[S_OUTPUT] = (stream->hostProcessOverrideOutput.processor != NULL ? stream->hostProcessOverrideOutput : defaultProcessor);
+
+	if (bEvent)
+	{
+		// Create & set handle, it is kept for restarts as by ProcThreadEvent
+		if (stream->event[i] == NULL)
+		{
+			if ((stream->event[i] = CreateEvent(NULL, FALSE, FALSE, NULL)) == NULL)
+				return paInsufficientMemory;
+
+			if ((hr = IAudioClient_SetEventHandle((i == S_INPUT ? stream->in.clientProc : stream->out.clientProc),
+				stream->event[i])) != S_OK)
+			{
+				CloseHandle(stream->event[i]);
+				stream->event[i] = NULL;
+				LogHostError(hr);
+				return paUnanticipatedHostError;
+			}
+		}
+	}
+	else
+	{
+		stream->hManualTimer = PaWinUtil_CreateHighResolutionTimer();
+	}
+
+	// Start INPUT stream
+	if (stream->in.clientProc)
+	{
+		if ((hr = IAudioClient_Start(stream->in.clientProc)) != S_OK)
+		{
+			LogHostError(hr);
+			return paUnanticipatedHostError;
+		}
+
+		// Start silent render stream driving loopback
+		if ((hr = StartLoopbackRender(stream)) != S_OK)
+		{
+			LogHostError(hr);
+			result = paUnanticipatedHostError;
+			goto error;
+		}
+	}
+
+	// Preload buffer (obligatory, othervise ->Start() will fail) & start OUTPUT stream
+	if (stream->out.clientProc)
+	{
+		UINT32 frames = stream->out.framesPerBuffer;
+
+		if (!bEvent)
+		{
+			if (_PollGetOutputFramesAvailable(stream, &frames) != S_OK)
+				frames = 0; // not fatal, logged
+			else
+			if (stream->bufferMode == paUtilFixedHostBufferSize)
+				frames = (frames >= stream->out.framesPerBuffer ? stream->out.framesPerBuffer : 0);
+		}
+
+		if ((frames != 0) && ((hr = ProcessOutputBuffer(stream, stream->manualProcessor, frames)) != S_OK))
+		{
+			LogHostError(hr);
+			if (bEvent)
+			{
+				result = paUnanticipatedHostError;
+				goto error;
+			}
+		}
+
+		if ((hr = IAudioClient_Start(stream->out.clientProc)) != S_OK)
+		{
+			LogHostError(hr);
+			result = paUnanticipatedHostError;
+			goto error;
+		}
+	}
+
+	// Signal: stream running
+	stream->running = TRUE;
+
+	return paNoError;
+
+error:
+
+	if (stream->in.clientProc)
+		IAudioClient_Stop(stream->in.clientProc);
+	return result;
+}
+
+// ------------------------------------------------------------------------------------------
+// Pa_ProcessStream() of paManualProcessing streams, runs one iteration of the processing
+// threads' loops for the single direction of the stream.
+static PaError ProcessStream( PaStream *s, double timeoutSeconds )
+{
+	HRESULT hr = S_OK;
+	PaWasapiStream *stream = (PaWasapiStream *)s;
+	const int i = (stream->in.clientProc != NULL ? S_INPUT : S_OUTPUT);
+	const PaTime deadline = PaUtil_GetTime() + timeoutSeconds;
+	UINT32 frames = 0;
+
+	if (!stream->running)
+		return paStreamIsStopped;
+
+	if (((i == S_INPUT ? stream->in.streamFlags : stream->out.streamFlags) & AUDCLNT_STREAMFLAGS_EVENTCALLBACK) != 0)
+	{
+		DWORD dwResult;
+		DWORD timeout = (timeoutSeconds < 86400.0 ? (DWORD)(timeoutSeconds * 1000.0 + 0.999) : INFINITE);
+
+		PA_PROBE1(host_wait, 1);
+		dwResult = WaitForSingleObject(stream->event[i], timeout);
+		PA_PROBE2(host_wait_return, 1, dwResult);
+
+		if (dwResult == WAIT_TIMEOUT)
+			return paTimedOut;
+		if (dwResult != WAIT_OBJECT_0)
+		{
+			hr = HRESULT_FROM_WIN32(GetLastError());
+			goto host_error;
+		}
+
+		frames = stream->out.framesPerBuffer;
+	}
+	else
+	{
+		// Poll until input packets arrived or the output has room, input packets expire easily
+		// thus poll every millisecond as ProcThreadPoll does at most
+		for (;;)
+		{
+			double remaining;
+
+			if (i == S_INPUT)
+				hr = _PollGetInputFramesAvailable(stream, &frames);
+			else
+			{
+				hr = _PollGetOutputFramesAvailable(stream, &frames);
+				if (stream->bufferMode == paUtilFixedHostBufferSize)
+					frames = (frames >= stream->out.framesPerBuffer ? stream->out.framesPerBuffer : 0);
+			}
+			if (hr != S_OK)
+				goto host_error;
+			if (frames != 0)
+				break;
+
+			if ((remaining = deadline - PaUtil_GetTime()) <= 0.)
+				return paTimedOut;
+
+			PA_PROBE1(host_wait, 0);
+			PaWinUtil_WaitWithTimer(stream->hManualTimer, NULL, (remaining < 0.001 ? remaining : 0.001));
+			PA_PROBE2(host_wait_return, 0, 0);
+		}
+	}
+
+	if (i == S_INPUT)
+	{
+		if ((hr = ProcessInputBuffer(stream, stream->manualProcessor)) != S_OK)
+			goto host_error;
+	}
+	else
+	{
+		if ((hr = ProcessOutputBuffer(stream, stream->manualProcessor, frames)) != S_OK)
+			goto host_error;
+	}
+
+	// Callback returned paComplete or paAbort
+	if (WaitForSingleObject(stream->hCloseRequest, 0) != WAIT_TIMEOUT)
+	{
+		_StreamOnStop(stream);
+		stream->running = FALSE;
+	}
+
+	return paNoError;
+
+host_error:
+
+	// Stop as the processing threads do on errors
+	LogHostError(hr);
+	_StreamOnStop(stream);
+	stream->running = FALSE;
+	return paUnanticipatedHostError;
+}
+
 // ------------------------------------------------------------------------------------------
 PA_THREAD_FUNC ProcThreadEvent(void *param)
 {
@@ -4988,7 +6590,7 @@ PA_THREAD_FUNC ProcThreadEvent(void *param)
 	but we need to be careful to not call CoUninitialize() if 
 	RPC_E_CHANGED_MODE was returned.
 	*/
-	hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+	hr = CoInitializeEx(NULL, (stream->bMtaComPointers ? COINIT_MULTITHREADED : COINIT_APARTMENTTHREADED));
 	if (FAILED(hr) && (hr != RPC_E_CHANGED_MODE))
 	{
 		PRINT(("WASAPI: failed ProcThreadEvent CoInitialize"));
@@ -5056,6 +6658,13 @@ PA_THREAD_FUNC ProcThreadEvent(void *param)
 			LogHostError(hr);
 			goto thread_error;
 		}
+
+		// Start silent render stream driving loopback
+		if ((hr = StartLoopbackRender(stream)) != S_OK)
+		{
+			LogHostError(hr);
+			goto thread_error;
+		}
 	}
 
 	// Initialize event & start OUTPUT stream
@@ -5097,7 +6706,9 @@ PA_THREAD_FUNC ProcThreadEvent(void *param)
 	for (;;)
     {
 	    // 10 sec timeout (on timeout stream will auto-stop when processed by WAIT_TIMEOUT case)
+        PA_PROBE1(host_wait, S_COUNT);
         dwResult = WaitForMultipleObjects(S_COUNT, stream->event, bWaitAllEvents, 10*1000);
+        PA_PROBE2(host_wait_return, S_COUNT, dwResult);
 
 		// Check for close event (after wait for buffers to avoid any calls to user
 		// callback when hCloseRequest was set)
@@ -5180,11 +6791,13 @@ PA_THREAD_FUNC ProcThreadPoll(void *param)
 	PaWasapiHostProcessor defaultProcessor;
 	INT32 i;
 	ThreadIdleScheduler scheduler;
+	ThreadTimerScheduler timer;
 
 	// Calculate the actual duration of the allocated buffer.
 	DWORD sleep_ms     = 0;
 	DWORD sleep_ms_in;
 	DWORD sleep_ms_out;
+	UINT32 sleep_us_in, sleep_us_out;
 
 	BOOL bThreadComInitialized = FALSE;
 
@@ -5195,7 +6808,7 @@ PA_THREAD_FUNC ProcThreadPoll(void *param)
 	but we need to be careful to not call CoUninitialize() if 
 	RPC_E_CHANGED_MODE was returned.
 	*/
-	hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+	hr = CoInitializeEx(NULL, (stream->bMtaComPointers ? COINIT_MULTITHREADED : COINIT_APARTMENTTHREADED));
 	if (FAILED(hr) && (hr != RPC_E_CHANGED_MODE))
 	{
 		PRINT(("WASAPI: failed ProcThreadPoll CoInitialize"));
@@ -5212,6 +6825,16 @@ PA_THREAD_FUNC ProcThreadPoll(void *param)
 		return 0;
 	}
 
+	// Setup high-resolution timer with the same polling period, input is limited to 2 milliseconds as below
+	sleep_us_in  = GetFramesSleepTimeMicroseconds(stream->in.framesPerHostCallback/WASAPI_PACKETS_PER_INPUT_BUFFER, stream->in.wavex.Format.nSamplesPerSec);
+	sleep_us_out = GetFramesSleepTimeMicroseconds((stream->bufferMode != paUtilFixedHostBufferSize ?
+		stream->bufferProcessor.framesPerUserBuffer : stream->out.framesPerBuffer), stream->out.wavex.Format.nSamplesPerSec);
+	if (sleep_us_in > 2000)
+		sleep_us_in = 2000;
+	ThreadTimerScheduler_Setup(&timer, ((sleep_us_in != 0) && (sleep_us_out != 0) ? min(sleep_us_in, sleep_us_out) :
+		(sleep_us_in ? sleep_us_in : sleep_us_out)));
+	PRINT(("WASAPI: polling with %s\n", (timer.m_timer != NULL ? "high-resolution timer" : "Sleep")));
+
 	// Calculate timeout for next polling attempt.
 	sleep_ms_in  = GetFramesSleepTime(stream->in.framesPerHostCallback/WASAPI_PACKETS_PER_INPUT_BUFFER, stream->in.wavex.Format.nSamplesPerSec);
 	sleep_ms_out = GetFramesSleepTime(stream->out.framesPerBuffer, stream->out.wavex.Format.nSamplesPerSec);
@@ -5331,7 +6954,7 @@ PA_THREAD_FUNC ProcThreadPoll(void *param)
 	{
 		// Processing Loop
 		UINT32 next_sleep = sleep_ms;
-		while (WaitForSingleObject(stream->hCloseRequest, next_sleep) == WAIT_TIMEOUT)
+		while (ThreadTimerScheduler_Wait(&timer, stream->hCloseRequest, next_sleep) == WAIT_TIMEOUT)
 		{
 			// Get next sleep time
 			if (sleep_ms == 0)
@@ -5526,7 +7149,7 @@ PA_THREAD_FUNC ProcThreadPoll(void *param)
 #else
 		// Processing Loop
 		UINT32 next_sleep = sleep_ms;
-		while (WaitForSingleObject(stream->hCloseRequest, next_sleep) == WAIT_TIMEOUT)
+		while (ThreadTimerScheduler_Wait(&timer, stream->hCloseRequest, next_sleep) == WAIT_TIMEOUT)
 		{
 			UINT32 i_frames = 0, i_processed = 0;
 			BYTE *i_data = NULL, *o_data = NULL, *o_data_host = NULL;
@@ -5672,6 +7295,9 @@ thread_end:
 	// Release unmarshaled COM pointers
 	ReleaseUnmarshaledComPointers(stream);
 
+	// Release polling timer
+	ThreadTimerScheduler_Close(&timer);
+
 	// Cleanup COM for this thread
 	if (bThreadComInitialized == TRUE)
 		CoUninitialize();
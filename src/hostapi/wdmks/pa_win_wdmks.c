@@ -67,6 +67,7 @@ of a device for the duration of active stream using those devices
 #define WINVER 0x0501
 #endif
 
+#include <stddef.h> /* offsetof() */
 #include <string.h> /* strlen() */
 #include <assert.h>
 #include <wchar.h>  /* iswspace() */
@@ -83,6 +84,7 @@ of a device for the duration of active stream using those devices
 #include "pa_ringbuffer.h"
 #include "pa_trace.h"
 #include "pa_win_waveformat.h"
+#include "pa_win_util.h"
 
 #include "pa_win_wdmks.h"
 
@@ -202,26 +204,6 @@ typedef /*KSDDKAPI*/ DWORD WINAPI KSCREATEPIN(HANDLE, PKSPIN_CONNECT, ACCESS_MAS
 extern HMODULE      DllKsUser;
 extern KSCREATEPIN* FunctionKsCreatePin;
 
-/* These definitions allows the use of AVRT.DLL on Vista and later OSs */
-typedef enum _PA_AVRT_PRIORITY
-{
-    PA_AVRT_PRIORITY_LOW = -1,
-    PA_AVRT_PRIORITY_NORMAL,
-    PA_AVRT_PRIORITY_HIGH,
-    PA_AVRT_PRIORITY_CRITICAL
-} PA_AVRT_PRIORITY, *PPA_AVRT_PRIORITY;
-
-typedef struct
-{
-    HINSTANCE hInstance;
-
-    HANDLE  (WINAPI *AvSetMmThreadCharacteristics) (LPCSTR, LPDWORD);
-    BOOL    (WINAPI *AvRevertMmThreadCharacteristics) (HANDLE);
-    BOOL    (WINAPI *AvSetMmThreadPriority) (HANDLE, PA_AVRT_PRIORITY);
-} PaWinWDMKSAvRtEntryPoints;
-
-static PaWinWDMKSAvRtEntryPoints paWinWDMKSAvRtEntryPoints = {0};
-
 /* An unspecified channel count (-1) is not treated correctly, so we replace it with
 * an arbitrarily large number */ 
 #define MAXIMUM_NUMBER_OF_CHANNELS 256
@@ -314,6 +296,7 @@ struct __PaWinWdmFilter
     KSMULTIPLE_ITEM* connections;
     KSMULTIPLE_ITEM* nodes;
     int              filterRefCount;
+    FILETIME         changeTime;    /* last write of the device interface key, zero if unknown */
 };
 
 
@@ -367,6 +350,10 @@ typedef struct __PaWinWdmIOInfo
     /* WaveRT polled mode */
     unsigned            lastPosition; 
     unsigned            pollCntr;
+    int                 positionScheduling; /* paWinWDMKSPositionScheduling (WaveRT) */
+    /* WaveCyclic packet completion timing, written by the processing thread */
+    PaWinWDMKSPacketTiming timing;
+    PaTime              lastCompletionTime;
 } PaWinWdmIOInfo;
 
 /* PaWinWdmStream - a stream data structure specifically for this implementation */
@@ -390,6 +377,8 @@ struct __PaWinWdmStream
     int                         streamAbort;
     int                         oldProcessPriority;
     HANDLE                      streamThread;
+    int*                        streamThreadCpus;       /* NULL to run on any processor */
+    int                         streamThreadCpuCount;
     HANDLE                      eventAbort;
     HANDLE                      eventStreamStart[StreamStart_kCnt];        /* 0 = OK, 1 = Failed */
     PaError                     threadResult;
@@ -422,8 +411,8 @@ struct __PaProcessThreadInfo
     unsigned                    captureTail;
     unsigned                    renderHead;
     unsigned                    renderTail;
-    PaIOPacket                  capturePackets[4];
-    PaIOPacket                  renderPackets[4];
+    PaIOPacket                  capturePackets[16];
+    PaIOPacket                  renderPackets[16];
 };
 
 /* Used for transferring device infos during scanning / rescanning */
@@ -434,7 +423,10 @@ typedef struct __PaWinWDMScanDeviceInfosResults
     PaDeviceIndex defaultOutputDevice;
 } PaWinWDMScanDeviceInfosResults;
 
-static const unsigned cPacketsArrayMask = 3;
+/* Packets completed but not yet resubmitted are queued in capturePackets/renderPackets,
+   so the maximum number of WaveCyclic packets is bound by their size */
+static const unsigned cPacketsArrayMask = 15;
+#define PA_WDMKS_MAX_PACKETS    (16)
 
 HMODULE      DllKsUser = NULL;
 KSCREATEPIN* FunctionKsCreatePin = NULL;
@@ -579,7 +571,7 @@ static signed long GetStreamWriteAvailable( PaStream* stream );
 
 /* Utility functions */
 static unsigned long GetWfexSize(const WAVEFORMATEX* wfex);
-static PaWinWdmFilter** BuildFilterList(int* filterCount, int* noOfPaDevices, PaError* result);
+static PaWinWdmFilter** BuildFilterList(PaWinWdmHostApiRepresentation* wdmHostApi, int* filterCount, int* noOfPaDevices, PaError* result);
 static BOOL PinWrite(HANDLE h, DATAPACKET* p);
 static BOOL PinRead(HANDLE h, DATAPACKET* p);
 static void DuplicateFirstChannelInt16(void* buffer, int channels, int samples);
@@ -3051,8 +3043,55 @@ static void TrimString(wchar_t* str, size_t length)
 *
 * Vista and later: Also check KSCATEGORY_REALTIME for WaveRT devices.
 */
-//PaError BuildFilterList( PaWinWdmHostApiRepresentation* wdmHostApi, int* noOfPaDevices )
-PaWinWdmFilter** BuildFilterList( int* pFilterCount, int* pNoOfPaDevices, PaError* pResult )
+/**
+* Get the time the device interface's registry key was last written, which changes when the
+* driver of the device is installed, updated or reconfigured.
+*/
+static BOOL GetDeviceInterfaceChangeTime(HDEVINFO handle, SP_DEVICE_INTERFACE_DATA* interfaceData, FILETIME* changeTime)
+{
+    HKEY hkey = SetupDiOpenDeviceInterfaceRegKey(handle, interfaceData, 0, KEY_QUERY_VALUE);
+    LONG result;
+
+    memset(changeTime, 0, sizeof(FILETIME));
+    if (hkey == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    result = RegQueryInfoKeyW(hkey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, changeTime);
+    RegCloseKey(hkey);
+    return (result == ERROR_SUCCESS);
+}
+
+/**
+* Look up the filter of a device interface in the current device list. Creating a filter opens
+* it and queries every pin and the topology with many IOCTLs, which are skipped on a rescan
+* for interfaces which haven't changed since.
+*/
+static PaWinWdmFilter* FindCachedFilter(PaWinWdmHostApiRepresentation* wdmHostApi, PaWDMKSType type, DWORD devNode,
+                                        const wchar_t* filterName, const FILETIME* changeTime)
+{
+    PaUtilHostApiRepresentation* hostApi = &wdmHostApi->inheritedHostApiRep;
+    int i;
+
+    if (hostApi->deviceInfos == NULL || (changeTime->dwLowDateTime == 0 && changeTime->dwHighDateTime == 0))
+        return NULL;
+
+    for (i = 0; i < hostApi->info.deviceCount; ++i)
+    {
+        PaWinWdmFilter* filter = ((PaWinWdmDeviceInfo*)hostApi->deviceInfos[i])->filter;
+
+        if (filter != NULL &&
+            filter->devInfo.streamingType == type &&
+            filter->deviceNode == devNode &&
+            CompareFileTime(&filter->changeTime, changeTime) == 0 &&
+            _wcsicmp(filter->devInfo.filterPath, filterName) == 0)
+        {
+            return filter;
+        }
+    }
+    return NULL;
+}
+
+PaWinWdmFilter** BuildFilterList( PaWinWdmHostApiRepresentation* wdmHostApi, int* pFilterCount, int* pNoOfPaDevices, PaError* pResult )
 {
     PaWinWdmFilter** ppFilters = NULL;
     HDEVINFO handle = NULL;
@@ -3212,6 +3251,7 @@ PaWinWdmFilter** BuildFilterList( int* pFilterCount, int* pNoOfPaDevices, PaErro
             DWORD type;
             WCHAR friendlyName[MAX_PATH] = {0};
             DWORD sizeFriendlyName;
+            FILETIME changeTime;
             PaWinWdmFilter* newFilter = 0;
 
             PaError result = paNoError;
@@ -3258,11 +3298,28 @@ PaWinWdmFilter** BuildFilterList( int* pFilterCount, int* pNoOfPaDevices, PaErro
 
             TrimString(friendlyName, sizeFriendlyName);
 
-            newFilter = FilterNew(streamingType, 
-                devInfoData.DevInst,
-                devInterfaceDetails->DevicePath,
-                friendlyName,
-                &result);
+            GetDeviceInterfaceChangeTime(handle, &interfaceData, &changeTime);
+
+            /* The devices of an unchanged filter take a reference of their own to it in
+            * ScanDeviceInfos, the old device list keeps it alive until then */
+            newFilter = FindCachedFilter(wdmHostApi, streamingType, devInfoData.DevInst,
+                devInterfaceDetails->DevicePath, &changeTime);
+            if (newFilter != NULL)
+            {
+                PA_DEBUG(("Filter '%S' unchanged since the last scan\n", newFilter->friendlyName));
+            }
+            else
+            {
+                newFilter = FilterNew(streamingType, 
+                    devInfoData.DevInst,
+                    devInterfaceDetails->DevicePath,
+                    friendlyName,
+                    &result);
+                if (newFilter != NULL)
+                {
+                    newFilter->changeTime = changeTime;
+                }
+            }
 
             if( result == paNoError )
             {
@@ -3458,7 +3515,7 @@ static PaError ScanDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, PaH
     wchar_t* defaultInDevPath = 0;
     wchar_t* defaultOutDevPath = 0;
 
-    ppFilters = BuildFilterList( &filterCount, &totalDeviceCount, &result );
+    ppFilters = BuildFilterList( wdmHostApi, &filterCount, &totalDeviceCount, &result );
     if( result != paNoError )
     {
         goto error;
@@ -3708,10 +3765,6 @@ static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, P
 {
     PaWinWdmHostApiRepresentation *wdmHostApi = (PaWinWdmHostApiRepresentation*)hostApi;
 
-    hostApi->info.deviceCount = 0;
-    hostApi->info.defaultInputDevice = paNoDevice;
-    hostApi->info.defaultOutputDevice = paNoDevice;
-
     /* Free any old memory which might be in the device info */
     if( hostApi->deviceInfos )
     {
@@ -3719,11 +3772,15 @@ static PaError CommitDeviceInfos( struct PaUtilHostApiRepresentation *hostApi, P
             wdmHostApi->allocations, sizeof(PaWinWDMScanDeviceInfosResults));
         localScanResults->deviceInfos = hostApi->deviceInfos;
 
-        DisposeDeviceInfos(hostApi, &localScanResults, hostApi->info.deviceCount);
+        DisposeDeviceInfos(hostApi, localScanResults, hostApi->info.deviceCount);
 
         hostApi->deviceInfos = NULL;
     }
 
+    hostApi->info.deviceCount = 0;
+    hostApi->info.defaultInputDevice = paNoDevice;
+    hostApi->info.defaultOutputDevice = paNoDevice;
+
     if( scanResults != NULL )
     {
         PaWinWDMScanDeviceInfosResults *scanDeviceInfosResults = ( PaWinWDMScanDeviceInfosResults * ) scanResults;
@@ -3804,21 +3861,6 @@ PaError PaWinWdm_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
     if(FunctionKsCreatePin == NULL)
         goto error;
 
-    /* Attempt to load AVRT.DLL, if we can't, then we'll just use time critical prio instead... */
-    if(paWinWDMKSAvRtEntryPoints.hInstance == NULL)
-    {
-        paWinWDMKSAvRtEntryPoints.hInstance = LoadLibrary(TEXT("avrt.dll"));
-        if (paWinWDMKSAvRtEntryPoints.hInstance != NULL)
-        {
-            paWinWDMKSAvRtEntryPoints.AvSetMmThreadCharacteristics =
-                (HANDLE(WINAPI*)(LPCSTR,LPDWORD))GetProcAddress(paWinWDMKSAvRtEntryPoints.hInstance,"AvSetMmThreadCharacteristicsA");
-            paWinWDMKSAvRtEntryPoints.AvRevertMmThreadCharacteristics =
-                (BOOL(WINAPI*)(HANDLE))GetProcAddress(paWinWDMKSAvRtEntryPoints.hInstance, "AvRevertMmThreadCharacteristics");
-            paWinWDMKSAvRtEntryPoints.AvSetMmThreadPriority =
-                (BOOL(WINAPI*)(HANDLE,PA_AVRT_PRIORITY))GetProcAddress(paWinWDMKSAvRtEntryPoints.hInstance, "AvSetMmThreadPriority");
-        }
-    }
-
     wdmHostApi = (PaWinWdmHostApiRepresentation*)PaUtil_AllocateMemory( sizeof(PaWinWdmHostApiRepresentation) );
     if( !wdmHostApi )
     {
@@ -3855,11 +3897,11 @@ PaError PaWinWdm_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
-    /* In preparation for hotplug
     (*hostApi)->ScanDeviceInfos = ScanDeviceInfos;
     (*hostApi)->CommitDeviceInfos = CommitDeviceInfos;
     (*hostApi)->DisposeDeviceInfos = DisposeDeviceInfos;
-    */
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
     PaUtil_InitializeStreamInterface( &wdmHostApi->callbackStreamInterface, CloseStream, StartStream,
         StopStream, AbortStream, IsStreamStopped, IsStreamActive,
         GetStreamTime, GetStreamCpuLoad,
@@ -3894,12 +3936,6 @@ static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
         DllKsUser = NULL;
     }
 
-    if( paWinWDMKSAvRtEntryPoints.hInstance != NULL )
-    {
-        FreeLibrary( paWinWDMKSAvRtEntryPoints.hInstance );
-        paWinWDMKSAvRtEntryPoints.hInstance = NULL;
-    }
-
     if( wdmHostApi)
     {
         PaWinWDMScanDeviceInfosResults* localScanResults = (PaWinWDMScanDeviceInfosResults*)PaUtil_GroupAllocateMemory(
@@ -4262,6 +4298,22 @@ static unsigned NextPowerOf2(unsigned val)
     return ++val;
 }
 
+/* The size of a version 1 PaWinWDMKSInfo, which ended with channelMask */
+#define PA_WDMKS_INFO_V1_SIZE_ (offsetof( PaWinWDMKSInfo, callbackCpus ))
+
+/* The processors a stream's PaWinWDMKSInfo pins the processing thread to, NULL if any will do */
+static const int *GetCallbackCpus( const PaStreamParameters *parameters, int *cpuCount )
+{
+    const PaWinWDMKSInfo *streamInfo = parameters ? parameters->hostApiSpecificStreamInfo : NULL;
+
+    *cpuCount = 0;
+    if( !streamInfo || streamInfo->version < 2 || streamInfo->callbackCpuCount <= 0 )
+        return NULL;
+
+    *cpuCount = streamInfo->callbackCpuCount;
+    return streamInfo->callbackCpus;
+}
+
 static PaError ValidateSpecificStreamParameters(
     const PaStreamParameters *streamParameters,
     const PaWinWDMKSInfo *streamInfo,
@@ -4269,23 +4321,30 @@ static PaError ValidateSpecificStreamParameters(
 {
     if( streamInfo )
     {
-        if( streamInfo->size != sizeof( PaWinWDMKSInfo )
-            || streamInfo->version != 1 )
+        if( !( streamInfo->size == PA_WDMKS_INFO_V1_SIZE_ && streamInfo->version == 1 )
+            && !( streamInfo->size == sizeof( PaWinWDMKSInfo ) && streamInfo->version == 2 ) )
         {
             PA_DEBUG(("Stream parameters: size or version not correct"));
             return paIncompatibleHostApiSpecificStreamInfo;
         }
 
-        if (!!(streamInfo->flags & ~(paWinWDMKSOverrideFramesize | paWinWDMKSUseGivenChannelMask)))
+        if (streamInfo->version >= 2
+            && PaWinUtil_ValidateCpus(streamInfo->callbackCpus, streamInfo->callbackCpuCount) != paNoError)
+        {
+            PA_DEBUG(("Stream parameters: callbackCpus not valid"));
+            return paIncompatibleHostApiSpecificStreamInfo;
+        }
+
+        if (!!(streamInfo->flags & ~(paWinWDMKSOverrideFramesize | paWinWDMKSUseGivenChannelMask | paWinWDMKSPositionScheduling)))
         {
             PA_DEBUG(("Stream parameters: non supported flags set"));
             return paIncompatibleHostApiSpecificStreamInfo;
         }
 
         if (streamInfo->noOfPackets != 0 &&
-            (streamInfo->noOfPackets < 2 || streamInfo->noOfPackets > 8))
+            (streamInfo->noOfPackets < 2 || streamInfo->noOfPackets > PA_WDMKS_MAX_PACKETS))
         {
-            PA_DEBUG(("Stream parameters: noOfPackets %u out of range [2,8]", streamInfo->noOfPackets));
+            PA_DEBUG(("Stream parameters: noOfPackets %u out of range [2,%u]", streamInfo->noOfPackets, PA_WDMKS_MAX_PACKETS));
             return paIncompatibleHostApiSpecificStreamInfo;
         }
 
@@ -4432,6 +4491,25 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     /* Zero the stream object */
     /* memset((void*)stream,0,sizeof(PaWinWdmStream)); */
 
+    {
+        int cpuCount;
+        const int *cpus = GetCallbackCpus( outputParameters, &cpuCount );
+        if( !cpus )
+            cpus = GetCallbackCpus( inputParameters, &cpuCount );
+
+        if( cpus )
+        {
+            stream->streamThreadCpus = (int*)PaUtil_GroupAllocateMemory( stream->allocGroup, cpuCount * sizeof(int) );
+            if( !stream->streamThreadCpus )
+            {
+                result = paInsufficientMemory;
+                goto error;
+            }
+            memcpy( stream->streamThreadCpus, cpus, cpuCount * sizeof(int) );
+            stream->streamThreadCpuCount = cpuCount;
+        }
+    }
+
     if( streamCallback )
     {
         PaUtil_InitializeStreamRepresentation( &stream->streamRepresentation,
@@ -4745,6 +4823,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             {
                 stream->capture.noOfPackets = pInfo->noOfPackets;
             }
+
+            if (stream->capture.pPin->parentFilter->devInfo.streamingType == Type_kWaveRT &&
+                (pInfo->flags & paWinWDMKSPositionScheduling))
+            {
+                stream->capture.positionScheduling = 1;
+            }
         }
     }
 
@@ -4774,6 +4858,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             {
                 stream->render.noOfPackets = pInfo->noOfPackets;
             }
+
+            if (stream->render.pPin->parentFilter->devInfo.streamingType == Type_kWaveRT &&
+                (pInfo->flags & paWinWDMKSPositionScheduling))
+            {
+                stream->render.positionScheduling = 1;
+            }
         }
     }
 
@@ -4794,6 +4884,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
             max(stream->capture.framesPerBuffer, stream->render.framesPerBuffer));
         goto error;
     }
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
     /* Allocate/get all the buffers for host I/O */
     if (stream->userInputChannels > 0)
@@ -4828,6 +4924,11 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                 BOOL bCallMemoryBarrier = FALSE;
                 ULONG hwFifoLatency = 0;
                 ULONG dummy;
+                if (stream->capture.positionScheduling)
+                {
+                    /* Position driven processing uses the polled handlers, notification is not needed */
+                    stream->capture.pPin->pinKsSubType = SubType_kPolled;
+                }
                 result = PinGetBuffer(stream->capture.pPin, (void**)&stream->capture.hostBuffer, &dwRequestedSize, &bCallMemoryBarrier);
                 if (!result) 
                 {
@@ -4923,6 +5024,11 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
                 BOOL bCallMemoryBarrier = FALSE;
                 ULONG hwFifoLatency = 0;
                 ULONG dummy;
+                if (stream->render.positionScheduling)
+                {
+                    /* Position driven processing uses the polled handlers, notification is not needed */
+                    stream->render.pPin->pinKsSubType = SubType_kPolled;
+                }
                 result = PinGetBuffer(stream->render.pPin, (void**)&stream->render.hostBuffer, &dwRequestedSize, &bCallMemoryBarrier);
                 if (!result) 
                 {
@@ -5506,30 +5612,12 @@ Increase the priority of the calling thread to RT
 static HANDLE BumpThreadPriority() 
 {
     HANDLE hThread = GetCurrentThread();
-    DWORD dwTask = 0;
-    HANDLE hAVRT = NULL;
+    HANDLE hAVRT;
 
     /* If we have access to AVRT.DLL (Vista and later), use it */
-    if (paWinWDMKSAvRtEntryPoints.AvSetMmThreadCharacteristics != NULL) 
-    {
-        hAVRT = paWinWDMKSAvRtEntryPoints.AvSetMmThreadCharacteristics("Pro Audio", &dwTask);
-        if (hAVRT != NULL && hAVRT != INVALID_HANDLE_VALUE) 
-        {
-            BOOL bret = paWinWDMKSAvRtEntryPoints.AvSetMmThreadPriority(hAVRT, PA_AVRT_PRIORITY_CRITICAL);
-            if (!bret)
-            {
-                PA_DEBUG(("Set mm thread prio to critical failed!\n"));
-            }
-            else
-            {
-                return hAVRT;
-            }
-        }
-        else
-        {
-            PA_DEBUG(("Set mm thread characteristic to 'Pro Audio' failed, reverting to SetThreadPriority\n"));
-        }
-    }
+    hAVRT = (HANDLE)PaWinUtil_RegisterMmcssThread(NULL, paWinUtilMmcssDefaultPriority);
+    if (hAVRT != NULL)
+        return hAVRT;
 
     /* For XP and earlier, or if AvSetMmThreadCharacteristics fails (MMCSS disabled ?) */
     if (timeBeginPeriod(1) != TIMERR_NOERROR) {
@@ -5552,8 +5640,7 @@ static void DropThreadPriority(HANDLE hAVRT)
 
     if (hAVRT != NULL) 
     {
-        paWinWDMKSAvRtEntryPoints.AvSetMmThreadPriority(hAVRT, PA_AVRT_PRIORITY_NORMAL);
-        paWinWDMKSAvRtEntryPoints.AvRevertMmThreadCharacteristics(hAVRT);
+        PaWinUtil_RevertMmcssThread(hAVRT);
         return;
     }
 
@@ -5861,6 +5948,83 @@ static VOID CALLBACK TimerAPCWaveRTPolledMode(
     if (pHandles[1]) SetEvent(pHandles[1]);
 }
 
+/* State of the one-shot timer used for paWinWDMKSPositionScheduling */
+typedef struct __PaWinWdmPositionTimer
+{
+    HANDLE              hTimer;     /* set to NULL before the timer is closed */
+    HANDLE*             pHandles;   /* timerEventHandles of the processing thread */
+    PaProcessThreadInfo* pInfo;
+} PaWinWdmPositionTimer;
+
+/* Returns the time in 100ns units until the position register of the pin reaches the next half
+   of its host buffer, which is where the polled handlers have work to do. */
+static LONGLONG PositionTimeToNextHalf(PaWinWdmIOInfo* pIo, double sampleRate)
+{
+    unsigned long pos = 0;
+    unsigned long bytesToBoundary;
+    const unsigned long halfBuffer = pIo->hostBufferSize >> 1;
+    PaWinWdmPin* pin = pIo->pPin;
+
+    if (halfBuffer == 0 || pIo->bytesPerFrame == 0)
+        return 0;
+
+    pin->fnAudioPosition(pin, &pos);
+    pos += pin->hwLatency;
+    pos %= pIo->hostBufferSize;
+    pos &= ~(pIo->bytesPerFrame - 1);
+
+    bytesToBoundary = halfBuffer - (pos % halfBuffer);
+    return (LONGLONG)(((bytesToBoundary / pIo->bytesPerFrame) * 10000000.0) / sampleRate);
+}
+
+/* Arms the one-shot timer for the nearest half buffer boundary over all position scheduled pins */
+static BOOL ArmPositionTimer(PaWinWdmPositionTimer* pTimer);
+
+static VOID CALLBACK TimerAPCWaveRTPositionMode(
+    LPVOID lpArgToCompletionRoutine,
+    DWORD dwTimerLowValue,
+    DWORD dwTimerHighValue)
+{
+    PaWinWdmPositionTimer* pTimer = (PaWinWdmPositionTimer*)lpArgToCompletionRoutine;
+    (void)dwTimerLowValue;
+    (void)dwTimerHighValue;
+    if (pTimer->hTimer == NULL)
+        return;
+    if (pTimer->pHandles[0]) SetEvent(pTimer->pHandles[0]);
+    if (pTimer->pHandles[1]) SetEvent(pTimer->pHandles[1]);
+    ArmPositionTimer(pTimer);
+}
+
+static BOOL ArmPositionTimer(PaWinWdmPositionTimer* pTimer)
+{
+    /* Wake up slightly after the boundary, so the position register has passed it. The minimum
+       keeps us from spinning when the position is read right at a boundary. */
+    const LONGLONG margin = 2000;       /* 200 us */
+    const LONGLONG minimum = 1000;      /* 100 us */
+    PaWinWdmStream* stream = pTimer->pInfo->stream;
+    const double sampleRate = stream->streamRepresentation.streamInfo.sampleRate;
+    LONGLONG delay = -1;
+    LARGE_INTEGER dueTime;
+
+    if (stream->capture.pPin != 0 && stream->capture.positionScheduling)
+    {
+        delay = PositionTimeToNextHalf(&stream->capture, sampleRate);
+    }
+    if (stream->render.pPin != 0 && stream->render.positionScheduling)
+    {
+        const LONGLONG renderDelay = PositionTimeToNextHalf(&stream->render, sampleRate);
+        if (delay < 0 || renderDelay < delay)
+            delay = renderDelay;
+    }
+    if (delay < 0)
+        delay = 0;
+    delay = max(delay + margin, minimum);
+
+    /* Negative due time is relative */
+    dueTime.QuadPart = -delay;
+    return SetWaitableTimer(pTimer->hTimer, &dueTime, 0, TimerAPCWaveRTPositionMode, pTimer, FALSE);
+}
+
 static DWORD GetCurrentTimeInMillisecs()
 {
     return timeGetTime();
@@ -5878,6 +6042,7 @@ PA_THREAD_FUNC ProcessingThread(void* pParam)
     unsigned renderEvents = 0;
     unsigned timerPeriod = 0;
     DWORD timeStamp[2] = {0};
+    PaWinWdmPositionTimer positionTimer = {0};
 
     PaProcessThreadInfo info;
     memset(&info, 0, sizeof(PaProcessThreadInfo));
@@ -5935,6 +6100,10 @@ PA_THREAD_FUNC ProcessingThread(void* pParam)
     handleArray[noOfHandles++] = info.stream->eventAbort;
     assert(noOfHandles <= (info.stream->capture.noOfPackets + info.stream->render.noOfPackets + 1));
 
+    /* Packet timing is reported from stream start */
+    ResetPacketTiming(&info.stream->capture, info.stream->streamRepresentation.streamInfo.sampleRate);
+    ResetPacketTiming(&info.stream->render, info.stream->streamRepresentation.streamInfo.sampleRate);
+
     /* Prepare render and capture pins */
     if ((result = PreparePinsForStart(&info)) != paNoError) 
     {
@@ -5978,13 +6147,45 @@ PA_THREAD_FUNC ProcessingThread(void* pParam)
             timerPeriod = min(timerPeriod, (1000*info.stream->render.framesPerBuffer)/fs);
         }
 
-        if (timerEventHandles[0] || timerEventHandles[1])
+        if ((info.stream->capture.pPin != 0 && info.stream->capture.positionScheduling) ||
+            (info.stream->render.pPin != 0 && info.stream->render.positionScheduling))
+        {
+            /* Position scheduled: the timer is re-armed from the APC at each half buffer boundary */
+            LARGE_INTEGER dueTime = {0};
+
+            hTimer = PaWinUtil_CreateHighResolutionTimer();
+            if (hTimer == NULL)
+            {
+                hTimer = CreateWaitableTimer(0, FALSE, NULL);
+            }
+            if (hTimer == NULL)
+            {
+                result = paUnanticipatedHostError;
+                goto error;
+            }
+            positionTimer.hTimer = hTimer;
+            positionTimer.pHandles = timerEventHandles;
+            positionTimer.pInfo = &info;
+            /* Invoke first timeout immediately, the APC then follows the position register */
+            if (!SetWaitableTimer(hTimer, &dueTime, 0, TimerAPCWaveRTPositionMode, &positionTimer, FALSE))
+            {
+                positionTimer.hTimer = NULL;
+                result = paUnanticipatedHostError;
+                goto error;
+            }
+            PA_DEBUG(("Position scheduling timer started\n"));
+        }
+        else if (timerEventHandles[0] || timerEventHandles[1])
         {
             LARGE_INTEGER dueTime = {0};
 
             timerPeriod=max(timerPeriod/5,1);
             PA_DEBUG(("Timer event handles=0x%04X,0x%04X period=%u ms", timerEventHandles[0], timerEventHandles[1], timerPeriod));
-            hTimer = CreateWaitableTimer(0, FALSE, NULL);
+            hTimer = PaWinUtil_CreateHighResolutionTimer();
+            if (hTimer == NULL)
+            {
+                hTimer = CreateWaitableTimer(0, FALSE, NULL);
+            }
             if (hTimer == NULL)
             {
                 result = paUnanticipatedHostError;
@@ -6160,6 +6361,8 @@ error:
 bailout:
     if (hTimer)
     {
+        /* Keeps a pending position APC from re-arming the timer */
+        positionTimer.hTimer = NULL;
         PA_DEBUG(("Waitable timer stopped\n", timerPeriod));
         CancelWaitableTimer(hTimer);
         CloseHandle(hTimer);
@@ -6237,6 +6440,18 @@ static PaError StartStream( PaStream *s )
         result = paInsufficientMemory;
         goto end;
     }
+    if (stream->streamThreadCpus != NULL)
+    {
+        result = PaWinUtil_SetThreadCpuAffinity(stream->streamThread, stream->streamThreadCpus, stream->streamThreadCpuCount);
+        if (result != paNoError)
+        {
+            PaWinWDM_SetLastErrorInfo(result, "Failed to set the processing thread's processor affinity");
+            TerminateThread(stream->streamThread, 0);
+            CloseHandle(stream->streamThread);
+            stream->streamThread = 0;
+            goto end;
+        }
+    }
     ResumeThread(stream->streamThread);
 
     switch (WaitForMultipleObjects(2, stream->eventStreamStart, FALSE, 5000))
@@ -6421,6 +6636,42 @@ static double GetStreamCpuLoad( PaStream* s )
 }
 
 
+PaError PaWinWDMKS_GetPacketTiming( PaStream *s, int input, PaWinWDMKSPacketTiming *timing )
+{
+    PaError result = paNoError;
+    PaWinWdmHostApiRepresentation *wdmHostApi = NULL;
+    PaWinWdmStream *stream;
+
+    PA_LOGE_;
+
+    if( timing == NULL )
+    {
+        result = paBadBufferPtr;
+        goto error;
+    }
+
+    if( (result = PaUtil_ValidateStreamPointer( s )) != paNoError )
+        goto error;
+
+    if( (result = PaUtil_GetHostApiRepresentation( (PaUtilHostApiRepresentation**)&wdmHostApi, paWDMKS )) != paNoError )
+        goto error;
+
+    if( PA_STREAM_REP( s )->streamInterface != &wdmHostApi->callbackStreamInterface
+        && PA_STREAM_REP( s )->streamInterface != &wdmHostApi->blockingStreamInterface )
+    {
+        result = paIncompatibleStreamHostApi;
+        goto error;
+    }
+
+    stream = (PaWinWdmStream*)s;
+    *timing = (input ? stream->capture.timing : stream->render.timing);
+
+error:
+    PA_LOGL_;
+    return result;
+}
+
+
 /*
 As separate stream interfaces are used for blocking and callback
 streams, the following functions can be guaranteed to only be called
@@ -6497,6 +6748,39 @@ static signed long GetStreamWriteAvailable( PaStream* s )
 /* Event and submit handlers for WaveCyclic                                            */
 /***************************************************************************************/
 
+static void RecordPacketCompletion(PaWinWdmIOInfo* io)
+{
+    PaWinWDMKSPacketTiming* timing = &io->timing;
+    PaTime now = PaUtil_GetTime();
+
+    if (timing->completedPackets != 0)
+    {
+        double interval = now - io->lastCompletionTime;
+
+        if (timing->completedPackets == 1 || interval < timing->minInterval)
+            timing->minInterval = interval;
+        if (interval > timing->maxInterval)
+            timing->maxInterval = interval;
+        if (interval > 1.5 * timing->expectedInterval)
+            ++timing->lateCompletions;
+
+        timing->lastInterval = interval;
+        timing->meanInterval += (interval - timing->meanInterval) / (double)timing->completedPackets;
+    }
+    io->lastCompletionTime = now;
+    ++timing->completedPackets;
+}
+
+static void ResetPacketTiming(PaWinWdmIOInfo* io, double sampleRate)
+{
+    memset(&io->timing, 0, sizeof(io->timing));
+    if (io->pPin != 0 && io->pPin->parentFilter->devInfo.streamingType == Type_kWaveCyclic)
+    {
+        io->timing.noOfPackets = io->noOfPackets;
+        io->timing.expectedInterval = io->framesPerBuffer / sampleRate;
+    }
+}
+
 static PaError PaPinCaptureEventHandler_WaveCyclic(PaProcessThreadInfo* pInfo, unsigned eventIndex)
 {
     PaError result = paNoError;
@@ -6518,6 +6802,7 @@ static PaError PaPinCaptureEventHandler_WaveCyclic(PaProcessThreadInfo* pInfo, u
     else
     {
         pInfo->capturePackets[pInfo->captureHead & cPacketsArrayMask].packet = packet;
+        RecordPacketCompletion(&pInfo->stream->capture);
 
         frameCount = PaUtil_WriteRingBuffer(&pInfo->stream->ringBuffer, packet->Header.Data, pInfo->stream->capture.framesPerBuffer);
 
@@ -6548,6 +6833,10 @@ static PaError PaPinRenderEventHandler_WaveCyclic(PaProcessThreadInfo* pInfo, un
     assert( eventIndex < pInfo->stream->render.noOfPackets );
 
     pInfo->renderPackets[pInfo->renderHead & cPacketsArrayMask].packet = pInfo->stream->render.packets + eventIndex;
+    if (!pInfo->priming)
+    {
+        RecordPacketCompletion(&pInfo->stream->render);
+    }
     PA_HP_TRACE((pInfo->stream->hLog, "<<< Render event : idx=%u head=%u", eventIndex, pInfo->renderHead));
     ++pInfo->renderHead;
     --pInfo->pending;
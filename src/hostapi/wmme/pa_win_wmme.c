@@ -71,10 +71,13 @@
     How it works:
 
     For both callback and blocking read/write streams we open the MME devices
-    in CALLBACK_EVENT mode. In this mode, MME signals an Event object whenever
-    it has finished with a buffer (either filled it for input, or played it
-    for output). Where necessary, we block waiting for Event objects using
-    WaitMultipleObjects().
+    in CALLBACK_FUNCTION mode. MME calls WaveCompletionProc() whenever it has
+    finished with a buffer (either filled it for input, or played it for
+    output), which counts the buffer as done in lock-free per-buffer counters
+    and signals an Event object, as CALLBACK_EVENT mode would. Where necessary,
+    we block waiting for Event objects using WaitMultipleObjects(), and then
+    only look at the counters of the buffers we expect next instead of scanning
+    the flags of every wave header of every device.
 
     When implementing a PA callback stream, we set up a high priority thread
     which waits on the MME buffer Events and drains/fills the buffers when
@@ -94,6 +97,8 @@
 #include <process.h>
 #endif
 #include <assert.h>
+#include <stddef.h> /* offsetof() */
+#include <string.h> /* memset(), memcpy() */
 /* PLB20010422 - "memory.h" doesn't work on CodeWarrior for PC. Thanks Mike Berry for the mod. */
 #ifndef __MWERKS__
 #include <malloc.h>
@@ -109,9 +114,11 @@
 #include "pa_cpuload.h"
 #include "pa_process.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
 
 #include "pa_win_wmme.h"
 #include "pa_win_waveformat.h"
+#include "pa_win_util.h"
 
 #ifdef PAWIN_USE_WDMKS_DEVICE_INFO
 #include "pa_win_wdmks_utils.h"
@@ -292,6 +299,10 @@ static PaTime GetStreamTime( PaStream *stream );
 static double GetStreamCpuLoad( PaStream* stream );
 static PaError ReadStream( PaStream* stream, void *buffer, unsigned long frames );
 static PaError WriteStream( PaStream* stream, const void *buffer, unsigned long frames );
+static PaError ReadStreamTimeout( PaStream* stream, void *buffer, unsigned long frames,
+        unsigned long *framesRead, double timeoutSeconds );
+static PaError WriteStreamTimeout( PaStream* stream, const void *buffer, unsigned long frames,
+        unsigned long *framesWritten, double timeoutSeconds );
 static signed long GetStreamReadAvailable( PaStream* stream );
 static signed long GetStreamWriteAvailable( PaStream* stream );
 
@@ -418,6 +429,28 @@ static PaError CloseHandleWithPaError( HANDLE handle )
 }
 
 
+/* PaWinMmeWaveHeaderPoolEntry - an array of wave headers with their buffers, kept by the host
+    api after a stream is closed so that the next stream on the same device with the same buffer
+    layout can reuse it.
+
+    Preparation is bound to the HWAVEIN/HWAVEOUT handle, which doesn't outlive the stream, so
+    pooled headers are always unprepared. Only the allocations are reused.
+*/
+
+#define PA_MME_WAVE_HEADER_POOL_SIZE_   (8)
+
+typedef struct
+{
+    int inUse;
+    PaDeviceIndex device;
+    int isInput;
+    unsigned long bufferBytes;
+    unsigned long bufferCount;
+    WAVEHDR *waveHeaders;   /* bufferCount headers, each with a bufferBytes buffer in lpData */
+}
+PaWinMmeWaveHeaderPoolEntry;
+
+
 /* PaWinMmeHostApiRepresentation - host api datastructure specific to this implementation */
 
 typedef struct
@@ -436,6 +469,8 @@ typedef struct
         device ids.
      */ 
     UINT *winMmeDeviceIds;
+
+    PaWinMmeWaveHeaderPoolEntry waveHeaderPool[ PA_MME_WAVE_HEADER_POOL_SIZE_ ];
 }
 PaWinMmeHostApiRepresentation;
 
@@ -993,6 +1028,8 @@ PaError PaWinMme_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
         goto error;
     }
 
+    memset( winMmeHostApi->waveHeaderPool, 0, sizeof(winMmeHostApi->waveHeaderPool) );
+
     *hostApi = &winMmeHostApi->inheritedHostApiRep;
     (*hostApi)->info.structVersion = 1;
     (*hostApi)->info.type = paMME;
@@ -1155,6 +1192,11 @@ PaError PaWinMme_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
     (*hostApi)->Terminate = Terminate;
     (*hostApi)->OpenStream = OpenStream;
     (*hostApi)->IsFormatSupported = IsFormatSupported;
+    (*hostApi)->ScanDeviceInfos = NULL;
+    (*hostApi)->CommitDeviceInfos = NULL;
+    (*hostApi)->DisposeDeviceInfos = NULL;
+    (*hostApi)->EnableDeviceChangeNotification = NULL;
+    (*hostApi)->GetDeviceCapabilities = NULL;
 
     PaUtil_InitializeStreamInterface( &winMmeHostApi->callbackStreamInterface, CloseStream, StartStream,
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
@@ -1166,6 +1208,8 @@ PaError PaWinMme_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiInd
                                       StopStream, AbortStream, IsStreamStopped, IsStreamActive,
                                       GetStreamTime, PaUtil_DummyGetCpuLoad,
                                       ReadStream, WriteStream, GetStreamReadAvailable, GetStreamWriteAvailable );
+    winMmeHostApi->blockingStreamInterface.ReadTimeout = ReadStreamTimeout;
+    winMmeHostApi->blockingStreamInterface.WriteTimeout = WriteStreamTimeout;
 
     return result;
 
@@ -1185,9 +1229,24 @@ error:
 }
 
 
+static void FreeWaveHeaderArray( WAVEHDR *waveHeaders, unsigned long bufferCount );
+
 static void Terminate( struct PaUtilHostApiRepresentation *hostApi )
 {
     PaWinMmeHostApiRepresentation *winMmeHostApi = (PaWinMmeHostApiRepresentation*)hostApi;
+    int i;
+
+    /* all streams are closed by now, so no pool entry is in use */
+    for( i = 0; i < PA_MME_WAVE_HEADER_POOL_SIZE_; ++i )
+    {
+        PaWinMmeWaveHeaderPoolEntry *entry = &winMmeHostApi->waveHeaderPool[i];
+        if( entry->waveHeaders )
+        {
+            assert( !entry->inUse );
+            FreeWaveHeaderArray( entry->waveHeaders, entry->bufferCount );
+            entry->waveHeaders = 0;
+        }
+    }
 
     if( winMmeHostApi->allocations )
     {
@@ -1791,10 +1850,14 @@ typedef struct
     unsigned int deviceCount;
     /* unsigned int channelCount; */
     WAVEHDR **waveHeaders;                  /* waveHeaders[device][buffer] */
-    unsigned int bufferCount;
+    PaWinMmeWaveHeaderPoolEntry *waveHeaderPool; /* pool that waveHeaders[device] are returned to */
+    unsigned int allocatedBufferCount;      /* headers allocated per device */
+    unsigned int bufferCount;               /* headers in the ring, <= allocatedBufferCount */
     unsigned int currentBufferIndex;
     unsigned int framesPerBuffer;
     unsigned int framesUsedInCurrentBuffer;
+    volatile LONG *doneDeviceCounts;        /* doneDeviceCounts[buffer]: devices done with the buffer, == deviceCount when all are */
+    volatile LONG queuedHeaderCount;        /* headers queued with the devices and not yet done */
 }PaWinMmeSingleDirectionHandlesAndBuffers;
 
 /* prototypes for functions operating on PaWinMmeSingleDirectionHandlesAndBuffers */
@@ -1807,7 +1870,8 @@ static PaError InitializeWaveHandles( PaWinMmeHostApiRepresentation *winMmeHostA
         double sampleRate, PaWinMmeDeviceAndChannelCount *devices,
         unsigned int deviceCount, PaWinWaveFormatChannelMask channelMask, int isInput );
 static PaError TerminateWaveHandles( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers, int isInput, int currentlyProcessingAnError );
-static PaError InitializeWaveHeaders( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers,
+static PaError InitializeWaveHeaders( PaWinMmeHostApiRepresentation *winMmeHostApi,
+        PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers,
         unsigned long hostBufferCount,
         PaSampleFormat hostSampleFormat,
         unsigned long framesPerHostBuffer,
@@ -1822,9 +1886,65 @@ static void InitializeSingleDirectionHandlesAndBuffers( PaWinMmeSingleDirectionH
     handlesAndBuffers->waveHandles = 0;
     handlesAndBuffers->deviceCount = 0;
     handlesAndBuffers->waveHeaders = 0;
+    handlesAndBuffers->waveHeaderPool = 0;
+    handlesAndBuffers->allocatedBufferCount = 0;
     handlesAndBuffers->bufferCount = 0;
+    handlesAndBuffers->doneDeviceCounts = 0;
+    handlesAndBuffers->queuedHeaderCount = 0;
 }    
 
+
+/* Completion counters. The devices' completion callbacks and the thread processing the buffers
+    update them concurrently, so they are only changed with interlocked operations. */
+
+/* called before buffer bufferIndex is queued with all devices */
+static void BeginQueueingBuffers( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers, unsigned int bufferIndex )
+{
+    InterlockedExchange( &handlesAndBuffers->doneDeviceCounts[ bufferIndex ], 0 );
+    InterlockedExchangeAdd( &handlesAndBuffers->queuedHeaderCount, (LONG)handlesAndBuffers->deviceCount );
+}
+
+/* called when a device is done with its header of buffer bufferIndex, or failed to queue it */
+static void MarkWaveHeaderDone( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers, unsigned int bufferIndex )
+{
+    InterlockedIncrement( &handlesAndBuffers->doneDeviceCounts[ bufferIndex ] );
+    InterlockedDecrement( &handlesAndBuffers->queuedHeaderCount );
+}
+
+
+/* CALLBACK_FUNCTION callback of the wave devices, instance is the
+    PaWinMmeSingleDirectionHandlesAndBuffers of the device. Called on a system thread, which
+    must not call other functions than SetEvent() and a few more, see waveOutProc() */
+static void CALLBACK WaveCompletionProc( HANDLE waveHandle, UINT message, DWORD_PTR instance,
+        DWORD_PTR param1, DWORD_PTR param2 )
+{
+    PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers = (PaWinMmeSingleDirectionHandlesAndBuffers*)instance;
+    WAVEHDR *waveHeader = (WAVEHDR*)param1;
+    unsigned int i;
+
+    (void)waveHandle; /* unused parameter */
+    (void)param2; /* unused parameter */
+
+    if( (message == WIM_DATA || message == WOM_DONE) && handlesAndBuffers->waveHeaders )
+    {
+        /* find the buffer index from the device's header array holding the header */
+        for( i=0; i < handlesAndBuffers->deviceCount; ++i )
+        {
+            WAVEHDR *deviceWaveHeaders = handlesAndBuffers->waveHeaders[i];
+
+            if( deviceWaveHeaders && waveHeader >= deviceWaveHeaders
+                    && waveHeader < deviceWaveHeaders + handlesAndBuffers->allocatedBufferCount )
+            {
+                MarkWaveHeaderDone( handlesAndBuffers, (unsigned int)(waveHeader - deviceWaveHeaders) );
+                break;
+            }
+        }
+    }
+
+    /* signal for open and close too, as CALLBACK_EVENT does */
+    SetEvent( handlesAndBuffers->bufferEvent );
+}
+
 static PaError InitializeWaveHandles( PaWinMmeHostApiRepresentation *winMmeHostApi,
         PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers,
         unsigned long winMmeSpecificFlags,
@@ -1903,13 +2023,13 @@ static PaError InitializeWaveHandles( PaWinMmeHostApiRepresentation *winMmeHostA
             {
                 mmresult = waveInOpen( &((HWAVEIN*)handlesAndBuffers->waveHandles)[i], winMmeDeviceId, 
                                     (WAVEFORMATEX*)&waveFormat,
-                               (DWORD_PTR)handlesAndBuffers->bufferEvent, (DWORD_PTR)0, CALLBACK_EVENT );
+                               (DWORD_PTR)WaveCompletionProc, (DWORD_PTR)handlesAndBuffers, CALLBACK_FUNCTION );
             }
             else
             {
                 mmresult = waveOutOpen( &((HWAVEOUT*)handlesAndBuffers->waveHandles)[i], winMmeDeviceId, 
                                     (WAVEFORMATEX*)&waveFormat,
-                                (DWORD_PTR)handlesAndBuffers->bufferEvent, (DWORD_PTR)0, CALLBACK_EVENT );
+                                (DWORD_PTR)WaveCompletionProc, (DWORD_PTR)handlesAndBuffers, CALLBACK_FUNCTION );
             }
 
             if( mmresult == MMSYSERR_NOERROR )
@@ -2023,7 +2143,116 @@ static PaError TerminateWaveHandles( PaWinMmeSingleDirectionHandlesAndBuffers *h
 }
 
 
-static PaError InitializeWaveHeaders( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers,
+static void FreeWaveHeaderArray( WAVEHDR *waveHeaders, unsigned long bufferCount )
+{
+    signed int j;
+
+    for( j = bufferCount-1; j >= 0; --j )
+    {
+        if( waveHeaders[j].lpData )
+            PaUtil_FreeMemory( waveHeaders[j].lpData );
+    }
+
+    PaUtil_FreeMemory( waveHeaders );
+}
+
+
+/* Takes a matching header array from the pool, or allocates a new one and registers it in a
+    free (or evicted) pool slot. Returns 0 if out of memory. */
+static WAVEHDR *AcquireWaveHeaderArray( PaWinMmeWaveHeaderPoolEntry *pool, PaDeviceIndex device,
+        int isInput, unsigned long bufferBytes, unsigned long bufferCount )
+{
+    PaWinMmeWaveHeaderPoolEntry *slot = 0;
+    WAVEHDR *waveHeaders;
+    signed int i;
+
+    for( i = 0; i < PA_MME_WAVE_HEADER_POOL_SIZE_; ++i )
+    {
+        PaWinMmeWaveHeaderPoolEntry *entry = &pool[i];
+        if( entry->inUse )
+            continue;
+
+        if( entry->waveHeaders && entry->device == device && entry->isInput == isInput
+                && entry->bufferBytes == bufferBytes && entry->bufferCount == bufferCount )
+        {
+            entry->inUse = 1;
+            waveHeaders = entry->waveHeaders;
+            for( i = 0; i < (signed int)bufferCount; ++i )
+            {
+                char *data = waveHeaders[i].lpData;
+                memset( &waveHeaders[i], 0, sizeof(WAVEHDR) );
+                waveHeaders[i].lpData = data;
+                waveHeaders[i].dwBufferLength = bufferBytes;
+                waveHeaders[i].dwUser = 0xFFFFFFFF;
+            }
+            return waveHeaders;
+        }
+
+        /* prefer an empty slot, otherwise evict the first unused one */
+        if( !slot || (slot->waveHeaders && !entry->waveHeaders) )
+            slot = entry;
+    }
+
+    waveHeaders = (WAVEHDR *) PaUtil_AllocateMemory( sizeof(WAVEHDR)*bufferCount );
+    if( !waveHeaders )
+        return 0;
+
+    for( i=0; i < (signed int)bufferCount; ++i )
+        waveHeaders[i].lpData = 0;
+
+    for( i=0; i < (signed int)bufferCount; ++i )
+    {
+        waveHeaders[i].lpData = (char *)PaUtil_AllocateMemory( bufferBytes );
+        if( !waveHeaders[i].lpData )
+        {
+            FreeWaveHeaderArray( waveHeaders, bufferCount );
+            return 0;
+        }
+        waveHeaders[i].dwBufferLength = bufferBytes;
+        waveHeaders[i].dwUser = 0xFFFFFFFF; /* indicates that *PrepareHeader() has not yet been called, for error clean up code */
+    }
+
+    if( slot )
+    {
+        if( slot->waveHeaders )
+            FreeWaveHeaderArray( slot->waveHeaders, slot->bufferCount );
+
+        slot->inUse = 1;
+        slot->device = device;
+        slot->isInput = isInput;
+        slot->bufferBytes = bufferBytes;
+        slot->bufferCount = bufferCount;
+        slot->waveHeaders = waveHeaders;
+    }
+
+    return waveHeaders;
+}
+
+
+/* Returns a header array to the pool it came from, or frees it if it isn't pooled. The headers
+    must already be unprepared. */
+static void ReleaseWaveHeaderArray( PaWinMmeWaveHeaderPoolEntry *pool, WAVEHDR *waveHeaders, unsigned long bufferCount )
+{
+    signed int i;
+
+    if( pool )
+    {
+        for( i = 0; i < PA_MME_WAVE_HEADER_POOL_SIZE_; ++i )
+        {
+            if( pool[i].inUse && pool[i].waveHeaders == waveHeaders )
+            {
+                pool[i].inUse = 0;
+                return;
+            }
+        }
+    }
+
+    FreeWaveHeaderArray( waveHeaders, bufferCount );
+}
+
+
+static PaError InitializeWaveHeaders( PaWinMmeHostApiRepresentation *winMmeHostApi,
+        PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers,
         unsigned long hostBufferCount,
         PaSampleFormat hostSampleFormat,
         unsigned long framesPerHostBuffer,
@@ -2051,7 +2280,21 @@ static PaError InitializeWaveHeaders( PaWinMmeSingleDirectionHandlesAndBuffers *
     for( i = 0; i < (signed int)handlesAndBuffers->deviceCount; ++i )
         handlesAndBuffers->waveHeaders[i] = 0;
 
+    /* no buffer is done or queued until the stream is started */
+    handlesAndBuffers->doneDeviceCounts = (volatile LONG*)PaUtil_AllocateMemory( sizeof(LONG) * hostBufferCount );
+    if( !handlesAndBuffers->doneDeviceCounts )
+    {
+        result = paInsufficientMemory;
+        goto error;
+    }
+
+    for( j = 0; j < (signed int)hostBufferCount; ++j )
+        handlesAndBuffers->doneDeviceCounts[j] = 0;
+    handlesAndBuffers->queuedHeaderCount = 0;
+
+    handlesAndBuffers->allocatedBufferCount = hostBufferCount;
     handlesAndBuffers->bufferCount = hostBufferCount;
+    handlesAndBuffers->waveHeaderPool = winMmeHostApi->waveHeaderPool;
 
     for( i = 0; i < (signed int)handlesAndBuffers->deviceCount; ++i )
     {
@@ -2063,31 +2306,20 @@ static PaError InitializeWaveHeaders( PaWinMmeSingleDirectionHandlesAndBuffers *
             goto error;
         }
 
-        /* Allocate an array of wave headers for device i */
-        deviceWaveHeaders = (WAVEHDR *) PaUtil_AllocateMemory( sizeof(WAVEHDR)*hostBufferCount );
+        /* Get an array of wave headers with buffers for device i, reusing a pooled one if possible */
+        deviceWaveHeaders = AcquireWaveHeaderArray( winMmeHostApi->waveHeaderPool, devices[i].device,
+                isInput, bufferBytes, hostBufferCount );
         if( !deviceWaveHeaders )
         {
             result = paInsufficientMemory;
             goto error;
         }
 
-        for( j=0; j < (signed int)hostBufferCount; ++j )
-            deviceWaveHeaders[j].lpData = 0;
-
         handlesAndBuffers->waveHeaders[i] = deviceWaveHeaders;
 
-        /* Allocate a buffer for each wave header */
+        /* Prepare each wave header */
         for( j=0; j < (signed int)hostBufferCount; ++j )
         {
-            deviceWaveHeaders[j].lpData = (char *)PaUtil_AllocateMemory( bufferBytes );
-            if( !deviceWaveHeaders[j].lpData )
-            {
-                result = paInsufficientMemory;
-                goto error;
-            }
-            deviceWaveHeaders[j].dwBufferLength = bufferBytes;
-            deviceWaveHeaders[j].dwUser = 0xFFFFFFFF; /* indicates that *PrepareHeader() has not yet been called, for error clean up code */
-
             if( isInput )
             {
                 mmresult = waveInPrepareHeader( ((HWAVEIN*)handlesAndBuffers->waveHandles)[i], &deviceWaveHeaders[j], sizeof(WAVEHDR) );
@@ -2133,7 +2365,7 @@ static void TerminateWaveHeaders( PaWinMmeSingleDirectionHandlesAndBuffers *hand
             deviceWaveHeaders = handlesAndBuffers->waveHeaders[i];  /* wave headers for device i */
             if( deviceWaveHeaders )
             {
-                for( j = handlesAndBuffers->bufferCount-1; j >= 0; --j )
+                for( j = handlesAndBuffers->allocatedBufferCount-1; j >= 0; --j )
                 {
                     if( deviceWaveHeaders[j].lpData )
                     {
@@ -2144,18 +2376,22 @@ static void TerminateWaveHeaders( PaWinMmeSingleDirectionHandlesAndBuffers *hand
                             else
                                 waveOutUnprepareHeader( ((HWAVEOUT*)handlesAndBuffers->waveHandles)[i], &deviceWaveHeaders[j], sizeof(WAVEHDR) );
                         }
-
-                        PaUtil_FreeMemory( deviceWaveHeaders[j].lpData );
                     }
                 }
 
-                PaUtil_FreeMemory( deviceWaveHeaders );
+                ReleaseWaveHeaderArray( handlesAndBuffers->waveHeaderPool, deviceWaveHeaders, handlesAndBuffers->allocatedBufferCount );
             }
         }
 
         PaUtil_FreeMemory( handlesAndBuffers->waveHeaders );
         handlesAndBuffers->waveHeaders = 0;
     }
+
+    if( handlesAndBuffers->doneDeviceCounts )
+    {
+        PaUtil_FreeMemory( (void*)handlesAndBuffers->doneDeviceCounts );
+        handlesAndBuffers->doneDeviceCounts = 0;
+    }
 }
 
 
@@ -2177,6 +2413,8 @@ struct PaWinMmeStream
     HANDLE abortEvent;
     HANDLE processingThread;
     PA_THREAD_ID processingThreadId;
+    int *processingThreadCpus; /* NULL to run on any processor */
+    int processingThreadCpuCount;
 
     char throttleProcessingThreadOnOverload; /* 0 -> don't throtte, non-0 -> throttle */
     int processingThreadPriority;
@@ -2190,8 +2428,26 @@ struct PaWinMmeStream
     volatile int abortProcessing; /* stop thread immediately */
 
     DWORD allBuffersDurationMs; /* used to calculate timeouts */
+
+    /* paWinMmeAdaptiveOutputBufferCount */
+    int adaptiveOutputBufferCount;
+    DWORD outputRingSampleOffset; /* added to the wave out position to map it onto the output ring */
 };
 
+/* The size of a version 1 PaWinMmeStreamInfo, which ended with channelMask */
+#define PA_WIN_MME_STREAM_INFO_V1_SIZE_ (offsetof( PaWinMmeStreamInfo, callbackCpus ))
+
+/* The processors a stream's PaWinMmeStreamInfo pins the processing thread to, NULL if any will do */
+static const int *GetCallbackCpus( const PaWinMmeStreamInfo *streamInfo, int *cpuCount )
+{
+    *cpuCount = 0;
+    if( !streamInfo || streamInfo->version < 2 || streamInfo->callbackCpuCount <= 0 )
+        return NULL;
+
+    *cpuCount = streamInfo->callbackCpuCount;
+    return streamInfo->callbackCpus;
+}
+
 /* updates deviceCount if PaWinMmeUseMultipleDevices is used */
 
 static PaError ValidateWinMmeSpecificStreamInfo(
@@ -2203,8 +2459,14 @@ static PaError ValidateWinMmeSpecificStreamInfo(
 {
     if( streamInfo )
     {
-        if( streamInfo->size != sizeof( PaWinMmeStreamInfo )
-                || streamInfo->version != 1 )
+        if( !( streamInfo->size == PA_WIN_MME_STREAM_INFO_V1_SIZE_ && streamInfo->version == 1 )
+                && !( streamInfo->size == sizeof( PaWinMmeStreamInfo ) && streamInfo->version == 2 ) )
+        {
+            return paIncompatibleHostApiSpecificStreamInfo;
+        }
+
+        if( streamInfo->version >= 2
+                && PaWinUtil_ValidateCpus( streamInfo->callbackCpus, streamInfo->callbackCpuCount ) != paNoError )
         {
             return paIncompatibleHostApiSpecificStreamInfo;
         }
@@ -2501,6 +2763,28 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
     stream->abortEvent = 0;
     stream->processingThread = 0;
+    stream->processingThreadCpus = 0;
+    stream->processingThreadCpuCount = 0;
+
+    if( streamCallback )
+    {
+        int cpuCount;
+        const int *cpus = GetCallbackCpus( outputParameters ? outputStreamInfo : NULL, &cpuCount );
+        if( !cpus )
+            cpus = GetCallbackCpus( inputParameters ? inputStreamInfo : NULL, &cpuCount );
+
+        if( cpus )
+        {
+            stream->processingThreadCpus = (int*)PaUtil_AllocateMemory( cpuCount * sizeof(int) );
+            if( !stream->processingThreadCpus )
+            {
+                result = paInsufficientMemory;
+                goto error;
+            }
+            memcpy( stream->processingThreadCpus, cpus, cpuCount * sizeof(int) );
+            stream->processingThreadCpuCount = cpuCount;
+        }
+    }
 
     stream->throttleProcessingThreadOnOverload = throttleProcessingThreadOnOverload;
 
@@ -2550,6 +2834,12 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
     if( result != paNoError ) goto error;
     
     bufferProcessorIsInitialized = 1;
+    stream->streamRepresentation.statistics = PaUtil_GetBufferProcessorStatistics( &stream->bufferProcessor );
+    stream->streamRepresentation.clock = PaUtil_GetBufferProcessorClock( &stream->bufferProcessor );
+    stream->streamRepresentation.taps = PaUtil_GetBufferProcessorTaps( &stream->bufferProcessor );
+    stream->streamRepresentation.levelMeter = PaUtil_GetBufferProcessorLevelMeter( &stream->bufferProcessor );
+    stream->streamRepresentation.silentOutputChannels = PaUtil_GetBufferProcessorSilentOutputChannels( &stream->bufferProcessor );
+    stream->streamRepresentation.outputGain = PaUtil_GetBufferProcessorOutputGain( &stream->bufferProcessor );
 
     /* stream info input latency is the minimum buffering latency (unlike suggested and default which are *maximums*) */
     stream->streamRepresentation.streamInfo.inputLatency =
@@ -2597,17 +2887,34 @@ static PaError OpenStream( struct PaUtilHostApiRepresentation *hostApi,
 
     if( inputParameters )
     {
-        result = InitializeWaveHeaders( &stream->input, hostInputBufferCount,
+        result = InitializeWaveHeaders( winMmeHostApi, &stream->input, hostInputBufferCount,
                 hostInputSampleFormat, framesPerHostInputBuffer, inputDevices, 1 /* isInput */ );
         if( result != paNoError ) goto error;
     }
 
     if( outputParameters )
     {
-        result = InitializeWaveHeaders( &stream->output, hostOutputBufferCount,
+        result = InitializeWaveHeaders( winMmeHostApi, &stream->output, hostOutputBufferCount,
                 hostOutputSampleFormat, framesPerHostOutputBuffer, outputDevices, 0 /* not isInput */ );
         if( result != paNoError ) goto error;
 
+        if( (winMmeSpecificOutputFlags & paWinMmeAdaptiveOutputBufferCount) && streamCallback
+                && hostOutputBufferCount > PA_MME_MIN_HOST_OUTPUT_BUFFER_COUNT_ )
+        {
+            unsigned int j;
+
+            /* start with the minimum ring, the remaining headers are brought in on underflow.
+                They are marked done so that they look like played-out buffers when they join. */
+            for( j=0; j < stream->output.allocatedBufferCount; ++j )
+                stream->output.doneDeviceCounts[j] = (LONG)stream->output.deviceCount;
+
+            stream->adaptiveOutputBufferCount = 1;
+            stream->output.bufferCount = PA_MME_MIN_HOST_OUTPUT_BUFFER_COUNT_;
+            stream->streamRepresentation.streamInfo.outputLatency =
+                    (double)(PaUtil_GetBufferProcessorOutputLatencyFrames(&stream->bufferProcessor)
+                        + (framesPerHostOutputBuffer * (stream->output.bufferCount-1))) / sampleRate;
+        }
+
         stream->allBuffersDurationMs = (DWORD) (1000.0 * (framesPerHostOutputBuffer * stream->output.bufferCount) / sampleRate);
     }
     else
@@ -2646,6 +2953,7 @@ error:
         if( streamRepresentationIsInitialized )
             PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
 
+        PaUtil_FreeMemory( stream->processingThreadCpus );
         PaUtil_FreeMemory( stream );
     }
 
@@ -2653,53 +2961,32 @@ error:
 }
 
 
-/* return non-zero if all current buffers are done */
-static int BuffersAreDone( WAVEHDR **waveHeaders, unsigned int deviceCount, int bufferIndex )
+/* return non-zero if all devices are done with buffer bufferIndex */
+static int BuffersAreDone( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers, unsigned int bufferIndex )
 {
-    unsigned int i;
-    
-    for( i=0; i < deviceCount; ++i )
-    {
-        if( !(waveHeaders[i][ bufferIndex ].dwFlags & WHDR_DONE) )
-        {
-            return 0;
-        }         
-    }
+    if( handlesAndBuffers->doneDeviceCounts[ bufferIndex ] != (LONG)handlesAndBuffers->deviceCount )
+        return 0;
 
+    /* the buffers' contents are read after the counter which says they are done */
+    PaUtil_ReadMemoryBarrier();
     return 1;
 }
 
 static int CurrentInputBuffersAreDone( PaWinMmeStream *stream )
 {
-    return BuffersAreDone( stream->input.waveHeaders, stream->input.deviceCount, stream->input.currentBufferIndex );
+    return BuffersAreDone( &stream->input, stream->input.currentBufferIndex );
 }
 
 static int CurrentOutputBuffersAreDone( PaWinMmeStream *stream )
 {
-    return BuffersAreDone( stream->output.waveHeaders, stream->output.deviceCount, stream->output.currentBufferIndex );
+    return BuffersAreDone( &stream->output, stream->output.currentBufferIndex );
 }
 
 
-/* return non-zero if any buffers are queued */
+/* return non-zero if no buffers are queued */
 static int NoBuffersAreQueued( PaWinMmeSingleDirectionHandlesAndBuffers *handlesAndBuffers )
 {
-    unsigned int i, j;
-
-    if( handlesAndBuffers->waveHandles )
-    {
-        for( i=0; i < handlesAndBuffers->bufferCount; ++i )
-        {
-            for( j=0; j < handlesAndBuffers->deviceCount; ++j )
-            {
-                if( !( handlesAndBuffers->waveHeaders[ j ][ i ].dwFlags & WHDR_DONE) )
-                {
-                    return 0;
-                }
-            }
-        }
-    }
-
-    return 1;
+    return !handlesAndBuffers->waveHandles || handlesAndBuffers->queuedHeaderCount == 0;
 }
 
 
@@ -2715,7 +3002,7 @@ static signed long GetAvailableFrames( PaWinMmeSingleDirectionHandlesAndBuffers
     signed long result = 0;
     unsigned int i;
     
-    if( BuffersAreDone( handlesAndBuffers->waveHeaders, handlesAndBuffers->deviceCount, handlesAndBuffers->currentBufferIndex ) )
+    if( BuffersAreDone( handlesAndBuffers, handlesAndBuffers->currentBufferIndex ) )
     {
         /* we could calculate the following in O(1) if we kept track of the
             last done buffer */
@@ -2724,7 +3011,7 @@ static signed long GetAvailableFrames( PaWinMmeSingleDirectionHandlesAndBuffers
         i = PA_CIRCULAR_INCREMENT_( handlesAndBuffers->currentBufferIndex, handlesAndBuffers->bufferCount );
         while( i != handlesAndBuffers->currentBufferIndex )
         {
-            if( BuffersAreDone( handlesAndBuffers->waveHeaders, handlesAndBuffers->deviceCount, i ) )
+            if( BuffersAreDone( handlesAndBuffers, i ) )
             {
                 result += handlesAndBuffers->framesPerBuffer;
                 i = PA_CIRCULAR_INCREMENT_( i, handlesAndBuffers->bufferCount );
@@ -2744,14 +3031,15 @@ static PaError AdvanceToNextInputBuffer( PaWinMmeStream *stream )
     MMRESULT mmresult;
     unsigned int i;
 
+    BeginQueueingBuffers( &stream->input, stream->input.currentBufferIndex );
     for( i=0; i < stream->input.deviceCount; ++i )
     {
-        stream->input.waveHeaders[i][ stream->input.currentBufferIndex ].dwFlags &= ~WHDR_DONE;
         mmresult = waveInAddBuffer( ((HWAVEIN*)stream->input.waveHandles)[i],
                                     &stream->input.waveHeaders[i][ stream->input.currentBufferIndex ],
                                     sizeof(WAVEHDR) );
         if( mmresult != MMSYSERR_NOERROR )
         {
+            MarkWaveHeaderDone( &stream->input, stream->input.currentBufferIndex );
             result = paUnanticipatedHostError;
             PA_MME_SET_LAST_WAVEIN_ERROR( mmresult );
         }
@@ -2772,6 +3060,7 @@ static PaError AdvanceToNextOutputBuffer( PaWinMmeStream *stream )
     MMRESULT mmresult;
     unsigned int i;
 
+    BeginQueueingBuffers( &stream->output, stream->output.currentBufferIndex );
     for( i=0; i < stream->output.deviceCount; ++i )
     {
         mmresult = waveOutWrite( ((HWAVEOUT*)stream->output.waveHandles)[i],
@@ -2779,6 +3068,7 @@ static PaError AdvanceToNextOutputBuffer( PaWinMmeStream *stream )
                                  sizeof(WAVEHDR) );
         if( mmresult != MMSYSERR_NOERROR )
         {
+            MarkWaveHeaderDone( &stream->output, stream->output.currentBufferIndex );
             result = paUnanticipatedHostError;
             PA_MME_SET_LAST_WAVEOUT_ERROR( mmresult );
         }
@@ -2843,6 +3133,53 @@ static PaError CatchUpOutputBuffers( PaWinMmeStream *stream )
 }
 
 
+/* paWinMmeAdaptiveOutputBufferCount: called after an output underflow has been detected, before
+    the output is caught up. Brings the next allocated buffer into the output ring, so that the
+    catch up queues one more buffer than before.
+    nextPlayedBufferIndex is the buffer that will play first once the output has been caught up.
+
+    Ring order has to stay the order in which buffers are written. The new buffer sits between the
+    last and first buffers of the old ring, so if the last written buffer was the last of the
+    old ring the new buffer is the next one to write.
+*/
+static void GrowOutputBufferRing( PaWinMmeStream *stream, unsigned int nextPlayedBufferIndex )
+{
+    unsigned int oldBufferCount = stream->output.bufferCount;
+    unsigned long framesPerBuffer = stream->bufferProcessor.framesPerHostBuffer;
+    DWORD framesInBufferRing;
+    MMTIME mmtime;
+
+    if( !stream->adaptiveOutputBufferCount || oldBufferCount >= stream->output.allocatedBufferCount )
+        return;
+
+    stream->output.bufferCount = oldBufferCount + 1;
+    if( stream->output.currentBufferIndex == 0 )
+    {
+        if( nextPlayedBufferIndex == 0 )
+            nextPlayedBufferIndex = oldBufferCount;
+        stream->output.currentBufferIndex = oldBufferCount;
+    }
+
+    /* re-map the wave out position so that the current position corresponds to the start of
+        the buffer which plays next. used to calculate outputBufferDacTime */
+    framesInBufferRing = stream->output.bufferCount * framesPerBuffer;
+    mmtime.wType = TIME_SAMPLES;
+    if( waveOutGetPosition( ((HWAVEOUT*)stream->output.waveHandles)[0], &mmtime, sizeof(MMTIME) ) == MMSYSERR_NOERROR
+            && mmtime.wType == TIME_SAMPLES )
+    {
+        stream->outputRingSampleOffset = (nextPlayedBufferIndex * framesPerBuffer
+                + framesInBufferRing - (mmtime.u.sample % framesInBufferRing)) % framesInBufferRing;
+    }
+
+    stream->allBuffersDurationMs = (DWORD) (1000.0 * framesInBufferRing * stream->bufferProcessor.samplePeriod);
+    stream->streamRepresentation.streamInfo.outputLatency =
+            (double)(PaUtil_GetBufferProcessorOutputLatencyFrames(&stream->bufferProcessor)
+                + (framesPerBuffer * (stream->output.bufferCount-1))) * stream->bufferProcessor.samplePeriod;
+
+    PA_DEBUG(("WinMME: output underflow, now using %d output buffers\n", stream->output.bufferCount));
+}
+
+
 PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
 {
     PaWinMmeStream *stream = (PaWinMmeStream *)pArg;
@@ -2858,6 +3195,11 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
     int done = 0;
     unsigned int channel, i;
     unsigned long framesProcessed;
+    void *mmcssTask;
+
+    /* MMCSS leaves a share of the CPU to other threads itself, so the thread
+        is only throttled on overload when it runs at a fixed priority */
+    mmcssTask = PaWinUtil_RegisterMmcssThread( NULL, paWinUtilMmcssDefaultPriority );
     
     /* prepare event array for call to WaitForMultipleObjects() */
     if( stream->input.bufferEvent )
@@ -2875,12 +3217,11 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
 
           When this indicates that one or more buffers are available
           NoBuffersAreQueued() and Current*BuffersAreDone are used below to
-          poll for additional done buffers. NoBuffersAreQueued() will fail
-          to identify an underrun/overflow if the driver doesn't mark all done
-          buffers prior to signalling the event. Some drivers do this
-          (eg RME Digi96, and others don't eg VIA PC 97 input). This isn't a
-          huge problem, it just means that we won't always be able to detect
-          underflow/overflow.
+          poll for additional done buffers. Both read the completion counters
+          which WaveCompletionProc() updates for every header the driver
+          returns, so they only look at the buffers to be processed next and
+          detect underflow/overflow regardless of how the driver batches its
+          notifications.
         */
         waitResult = WaitForMultipleObjects( eventCount, events, FALSE /* wait all = FALSE */, timeout );
         if( waitResult == WAIT_FAILED )
@@ -2977,6 +3318,8 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
                             case is handled further down.
                             */
 
+                            GrowOutputBufferRing( stream, stream->output.currentBufferIndex );
+
                             result = CatchUpOutputBuffers( stream );
                             if( result != paNoError )
                                 done = 1;
@@ -3019,7 +3362,7 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
                         time = timeBeforeGetPosition + (timeAfterGetPosition - timeBeforeGetPosition) * .5;
                         
                         framesInBufferRing = stream->output.bufferCount * stream->bufferProcessor.framesPerHostBuffer;
-                        playbackPosition = mmtime.u.sample % framesInBufferRing;
+                        playbackPosition = (mmtime.u.sample + stream->outputRingSampleOffset) % framesInBufferRing;
 
                         writePosition = stream->output.currentBufferIndex * stream->bufferProcessor.framesPerHostBuffer
                                 + stream->output.framesUsedInCurrentBuffer;
@@ -3153,6 +3496,7 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
                                 but recover from underflow after enquing it. This ensures
                                 that the most recent audio segment is repeated */
                             int outputUnderflow = NoBuffersAreQueued( &stream->output );
+                            unsigned int justQueuedBufferIndex = stream->output.currentBufferIndex;
 
                             result = AdvanceToNextOutputBuffer( stream );
                             if( result != paNoError )
@@ -3164,6 +3508,8 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
                                     underflow occured while processing the buffer
                                     we just finished */
 
+                                GrowOutputBufferRing( stream, justQueuedBufferIndex );
+
                                 result = CatchUpOutputBuffers( stream );
                                 if( result != paNoError )
                                     done = 1;
@@ -3173,7 +3519,7 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
                         }
                     }
                     
-                    if( stream->throttleProcessingThreadOnOverload != 0 )
+                    if( stream->throttleProcessingThreadOnOverload != 0 && mmcssTask == NULL )
                     {
                         if( stream->stopProcessing || stream->abortProcessing )
                         {
@@ -3192,7 +3538,7 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
                             }
 
                             /* sleep to give other processes a go */
-                            Sleep( stream->throttledSleepMsecs );
+                            PaWinUtil_Sleep( stream->throttledSleepMsecs * .001 );
                         }
                         else
                         {
@@ -3223,6 +3569,8 @@ PA_THREAD_FUNC ProcessingThreadProc( void *pArg )
         stream->streamRepresentation.streamFinishedCallback( stream->streamRepresentation.userData );
 
     PaUtil_ResetCpuLoadMeasurer( &stream->cpuLoadMeasurer );
+
+    PaWinUtil_RevertMmcssThread( mmcssTask );
     
     return result;
 }
@@ -3248,6 +3596,7 @@ static PaError CloseStream( PaStream* s )
     
     PaUtil_TerminateBufferProcessor( &stream->bufferProcessor );
     PaUtil_TerminateStreamRepresentation( &stream->streamRepresentation );
+    PaUtil_FreeMemory( stream->processingThreadCpus );
     PaUtil_FreeMemory( stream );
 
 error:
@@ -3269,16 +3618,25 @@ static PaError StartStream( PaStream *s )
     
     PaUtil_ResetBufferProcessor( &stream->bufferProcessor );
     
+    /* waveOutReset() in StopStream() sets the position back to zero, which is the first buffer of the ring */
+    stream->outputRingSampleOffset = 0;
+
+    /* the devices returned all buffers when the stream was stopped, nothing is queued, even if
+        a previous start failed part way */
+    stream->input.queuedHeaderCount = 0;
+    stream->output.queuedHeaderCount = 0;
+
     if( PA_IS_INPUT_STREAM_(stream) )
     {
         for( i=0; i<stream->input.bufferCount; ++i )
         {
+            BeginQueueingBuffers( &stream->input, i );
             for( j=0; j<stream->input.deviceCount; ++j )
             {
-                stream->input.waveHeaders[j][i].dwFlags &= ~WHDR_DONE;
                 mmresult = waveInAddBuffer( ((HWAVEIN*)stream->input.waveHandles)[j], &stream->input.waveHeaders[j][i], sizeof(WAVEHDR) );
                 if( mmresult != MMSYSERR_NOERROR )
                 {
+                    MarkWaveHeaderDone( &stream->input, i );
                     result = paUnanticipatedHostError;
                     PA_MME_SET_LAST_WAVEIN_ERROR( mmresult );
                     goto error;
@@ -3362,11 +3720,13 @@ static PaError StartStream( PaStream *s )
             /* we queue all channels of a single buffer frame (accross all
                 devices, because some multidevice multichannel drivers work
                 better this way */
+            BeginQueueingBuffers( &stream->output, i );
             for( j=0; j<stream->output.deviceCount; ++j )
             {
                 mmresult = waveOutWrite( ((HWAVEOUT*)stream->output.waveHandles)[j], &stream->output.waveHeaders[j][i], sizeof(WAVEHDR) );
                 if( mmresult != MMSYSERR_NOERROR )
                 {
+                    MarkWaveHeaderDone( &stream->output, i );
                     result = paUnanticipatedHostError;
                     PA_MME_SET_LAST_WAVEOUT_ERROR( mmresult );
                     goto error;
@@ -3418,6 +3778,17 @@ static PaError StartStream( PaStream *s )
             goto error;
         }
         stream->processingThreadPriority = stream->highThreadPriority;
+
+        if( stream->processingThreadCpus )
+        {
+            result = PaWinUtil_SetThreadCpuAffinity( stream->processingThread,
+                    stream->processingThreadCpus, stream->processingThreadCpuCount );
+            if( result != paNoError )
+            {
+                PA_MME_SET_LAST_SYSTEM_ERROR( GetLastError() );
+                goto error;
+            }
+        }
     }
     else
     {
@@ -3728,9 +4099,50 @@ static double GetStreamCpuLoad( PaStream* s )
     for blocking streams.
 */
 
+/* Wait for MME to signal that a buffer is done, for at most timeoutMs and until deadline if
+    timeoutSeconds isn't negative. *timedOut is set once the deadline has passed.
+*/
+static PaError WaitForBufferEvent( HANDLE bufferEvent, DWORD timeoutMs,
+        double timeoutSeconds, PaTime deadline, int *timedOut )
+{
+    DWORD waitResult;
+    PaTime timeLeft = 0.;
+
+    if( timeoutSeconds >= 0. )
+    {
+        timeLeft = deadline - PaUtil_GetTime();
+        if( timeLeft < 0. )
+            timeLeft = 0.;
+        if( timeLeft * 1000. < timeoutMs )
+            timeoutMs = (DWORD)ceil( timeLeft * 1000. );
+    }
+
+    waitResult = WaitForSingleObject( bufferEvent, timeoutMs );
+    if( waitResult == WAIT_FAILED )
+        return paUnanticipatedHostError;
+
+    /* if a timeout is encountered without a deadline, continue,
+        perhaps we should give up eventually
+    */
+    *timedOut = waitResult == WAIT_TIMEOUT && timeoutSeconds >= 0. && timeLeft * 1000. <= timeoutMs;
+    return paNoError;
+}
+
+
 static PaError ReadStream( PaStream* s,
                            void *buffer,
                            unsigned long frames )
+{
+    return ReadStreamTimeout( s, buffer, frames, NULL, -1. );
+}
+
+
+/* A negative timeoutSeconds waits as long as it takes */
+static PaError ReadStreamTimeout( PaStream* s,
+                                  void *buffer,
+                                  unsigned long frames,
+                                  unsigned long *framesReadOut,
+                                  double timeoutSeconds )
 {
     PaError result = paNoError;
     PaWinMmeStream *stream = (PaWinMmeStream*)s;
@@ -3738,8 +4150,9 @@ static PaError ReadStream( PaStream* s,
     unsigned long framesRead = 0;
     unsigned long framesProcessed;
     signed int hostInputBufferIndex;
-    DWORD waitResult;
     DWORD timeout = (unsigned long)(stream->allBuffersDurationMs * 0.5);
+    PaTime deadline = timeoutSeconds >= 0. ? PaUtil_GetTime() + timeoutSeconds : 0.;
+    int timedOut;
     unsigned int channel, i;
     
     if( PA_IS_INPUT_STREAM_(stream) )
@@ -3809,18 +4222,18 @@ static PaError ReadStream( PaStream* s,
 
             }else{
                 /* wait for MME to signal that a buffer is available */
-                waitResult = WaitForSingleObject( stream->input.bufferEvent, timeout );
-                if( waitResult == WAIT_FAILED )
+                PaError waitResult = WaitForBufferEvent( stream->input.bufferEvent, timeout,
+                        timeoutSeconds, deadline, &timedOut );
+                if( waitResult != paNoError )
                 {
-                    result = paUnanticipatedHostError;
+                    result = waitResult;
                     break;
                 }
-                else if( waitResult == WAIT_TIMEOUT )
+                else if( timedOut )
                 {
-                    /* if a timeout is encountered, continue,
-                        perhaps we should give up eventually
-                    */
-                }         
+                    result = paTimedOut;
+                    break;
+                }
             }
         }while( framesRead < frames );
     }
@@ -3829,6 +4242,9 @@ static PaError ReadStream( PaStream* s,
         result = paCanNotReadFromAnOutputOnlyStream;
     }
 
+    if( framesReadOut )
+        *framesReadOut = framesRead;
+
     return result;
 }
 
@@ -3836,6 +4252,17 @@ static PaError ReadStream( PaStream* s,
 static PaError WriteStream( PaStream* s,
                             const void *buffer,
                             unsigned long frames )
+{
+    return WriteStreamTimeout( s, buffer, frames, NULL, -1. );
+}
+
+
+/* As ReadStreamTimeout */
+static PaError WriteStreamTimeout( PaStream* s,
+                                   const void *buffer,
+                                   unsigned long frames,
+                                   unsigned long *framesWrittenOut,
+                                   double timeoutSeconds )
 {
     PaError result = paNoError;
     PaWinMmeStream *stream = (PaWinMmeStream*)s;
@@ -3843,8 +4270,9 @@ static PaError WriteStream( PaStream* s,
     unsigned long framesWritten = 0;
     unsigned long framesProcessed;
     signed int hostOutputBufferIndex;
-    DWORD waitResult;
     DWORD timeout = (unsigned long)(stream->allBuffersDurationMs * 0.5);
+    PaTime deadline = timeoutSeconds >= 0. ? PaUtil_GetTime() + timeoutSeconds : 0.;
+    int timedOut;
     unsigned int channel, i;
 
         
@@ -3917,18 +4345,18 @@ static PaError WriteStream( PaStream* s,
             else
             {
                 /* wait for MME to signal that a buffer is available */
-                waitResult = WaitForSingleObject( stream->output.bufferEvent, timeout );
-                if( waitResult == WAIT_FAILED )
+                PaError waitResult = WaitForBufferEvent( stream->output.bufferEvent, timeout,
+                        timeoutSeconds, deadline, &timedOut );
+                if( waitResult != paNoError )
                 {
-                    result = paUnanticipatedHostError;
+                    result = waitResult;
                     break;
                 }
-                else if( waitResult == WAIT_TIMEOUT )
+                else if( timedOut )
                 {
-                    /* if a timeout is encountered, continue,
-                        perhaps we should give up eventually
-                    */
-                }             
+                    result = paTimedOut;
+                    break;
+                }
             }        
         }while( framesWritten < frames );
     }
@@ -3936,6 +4364,9 @@ static PaError WriteStream( PaStream* s,
     {
         result = paCanNotWriteToAnInputOnlyStream;
     }
+
+    if( framesWrittenOut )
+        *framesWrittenOut = framesWritten;
     
     return result;
 }
@@ -4053,3 +4484,27 @@ HWAVEOUT PaWinMME_GetStreamOutputHandle( PaStream* s, int handleIndex )
     else
         return 0;
 }
+
+
+HANDLE PaWinMME_GetStreamInputEvent( PaStream* s )
+{
+    PaWinMmeStream *stream;
+    PaError result = GetWinMMEStreamPointer( &stream, s );
+
+    if( result == paNoError && PA_IS_INPUT_STREAM_(stream) )
+        return stream->input.bufferEvent;
+    else
+        return 0;
+}
+
+
+HANDLE PaWinMME_GetStreamOutputEvent( PaStream* s )
+{
+    PaWinMmeStream *stream;
+    PaError result = GetWinMMEStreamPointer( &stream, s );
+
+    if( result == paNoError && PA_IS_OUTPUT_STREAM_(stream) )
+        return stream->output.bufferEvent;
+    else
+        return 0;
+}
@@ -43,6 +43,8 @@
 #include "pa_hostapi.h"
 
 PaError PaJack_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+PaError PaPipeWire_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+PaError PaAAudio_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
 PaError PaAlsa_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
 PaError PaOSS_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
 /* Added for IRIX, Pieter, oct 2, 2003: */
@@ -51,12 +53,30 @@ PaError PaSGI_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex
 PaError PaAsiHpi_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
 PaError PaMacCore_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
 PaError PaSkeleton_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+/* Clock driven null and loopback devices, for testing without audio hardware */
+PaError PaNull_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+/* Named shared memory devices connecting the streams of different processes */
+PaError PaShm_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+/* AES67 network sources and sinks */
+PaError PaAes67_Initialize( PaUtilHostApiRepresentation **hostApi, PaHostApiIndex index );
+
+/* The front end can only call the stream functions of one host API directly */
+#if defined(PA_DIRECT_STREAM_INTERFACE) && ( PA_USE_AAUDIO + PA_USE_ALSA + PA_USE_OSS + PA_USE_JACK \
+        + PA_USE_PIPEWIRE + PA_USE_SGI + PA_USE_ASIHPI + PA_USE_COREAUDIO + PA_USE_SKELETON \
+        + PA_USE_SHM + PA_USE_AES67 + PA_USE_NULL ) != 1
+#error "PA_DIRECT_STREAM_INTERFACE requires a build with a single host API"
+#endif
 
 /** Note that on Linux, ALSA is placed before OSS so that the former is preferred over the latter.
+ On Android, which is Linux too, AAudio comes first.
  */
 
 PaUtilHostApiInitializer *paHostApiInitializers[] =
     {
+#if PA_USE_AAUDIO
+        PaAAudio_Initialize,
+#endif
+
 #ifdef __linux__
 
 #if PA_USE_ALSA
@@ -82,6 +102,10 @@ PaUtilHostApiInitializer *paHostApiInitializers[] =
 #if PA_USE_JACK
         PaJack_Initialize,
 #endif
+
+#if PA_USE_PIPEWIRE
+        PaPipeWire_Initialize,
+#endif
                     /* Added for IRIX, Pieter, oct 2, 2003: */
 #if PA_USE_SGI 
         PaSGI_Initialize,
@@ -99,5 +123,85 @@ PaUtilHostApiInitializer *paHostApiInitializers[] =
         PaSkeleton_Initialize,
 #endif
 
+#if PA_USE_SHM
+        PaShm_Initialize,
+#endif
+
+#if PA_USE_AES67
+        PaAes67_Initialize,
+#endif
+
+#if PA_USE_NULL
+        PaNull_Initialize, /* last in list so it isn't marked as default */
+#endif
+
         0   /* NULL terminated array */
     };
+
+/* Keep in the order of paHostApiInitializers */
+const PaHostApiTypeId paHostApiInitializerTypes[] =
+    {
+#if PA_USE_AAUDIO
+        paInDevelopment,
+#endif
+
+#ifdef __linux__
+
+#if PA_USE_ALSA
+        paALSA,
+#endif
+
+#if PA_USE_OSS
+        paOSS,
+#endif
+
+#else   /* __linux__ */
+
+#if PA_USE_OSS
+        paOSS,
+#endif
+
+#if PA_USE_ALSA
+        paALSA,
+#endif
+
+#endif  /* __linux__ */
+
+#if PA_USE_JACK
+        paJACK,
+#endif
+
+#if PA_USE_PIPEWIRE
+        paInDevelopment,
+#endif
+
+#if PA_USE_SGI
+        paAL,
+#endif
+
+#if PA_USE_ASIHPI
+        paAudioScienceHPI,
+#endif
+
+#if PA_USE_COREAUDIO
+        paCoreAudio,
+#endif
+
+#if PA_USE_SKELETON
+        paInDevelopment,
+#endif
+
+#if PA_USE_SHM
+        paInDevelopment,
+#endif
+
+#if PA_USE_AES67
+        paInDevelopment,
+#endif
+
+#if PA_USE_NULL
+        paInDevelopment,
+#endif
+
+        paInDevelopment   /* matches the terminating NULL */
+    };
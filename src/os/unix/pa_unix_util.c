@@ -40,16 +40,39 @@
 /** @file
  @ingroup unix_src
 */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* pthread_attr_setaffinity_np(), sched_getcpu() */
+#endif
  
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdio.h> /* sprintf() */
 #include <time.h>
 #include <sys/time.h>
 #include <assert.h>
 #include <string.h> /* For memset */
 #include <math.h>
+#include <limits.h> /* INT_MAX */
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h> /* mmap(), mlock() */
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/syscall.h> /* SYS_memfd_create, SYS_sched_setattr, SYS_gettid */
+#include <sys/resource.h> /* RLIMIT_RTTIME */
+#include <linux/futex.h>
+#include <linux/mempolicy.h> /* MPOL_BIND, MPOL_MF_MOVE */
+#include <dirent.h>
+#endif
+#if defined(PA_USE_RTKIT) && !defined(__linux__)
+#undef PA_USE_RTKIT /* rtkit is a Linux service */
+#endif
+#ifdef PA_USE_RTKIT
+#include <dlfcn.h>
+#endif
 
 #if defined(__APPLE__) && !defined(HAVE_MACH_ABSOLUTE_TIME)
 #define HAVE_MACH_ABSOLUTE_TIME
@@ -57,10 +80,17 @@
 #ifdef HAVE_MACH_ABSOLUTE_TIME
 #include <mach/mach_time.h>
 #endif
+#ifdef __APPLE__
+#include <mach/mach.h> /* semaphore_create() */
+#else
+#include <semaphore.h>
+#endif
 
 #include "pa_util.h"
 #include "pa_unix_util.h"
 #include "pa_debugprint.h"
+#include "pa_memorybarrier.h"
+#include "pa_cpufeatures.h"
 
 /*
    Track memory allocations to avoid leaks.
@@ -73,7 +103,13 @@ static int numAllocations_ = 0;
 
 void *PaUtil_AllocateMemory( long size )
 {
-    void *result = malloc( size );
+    int handled;
+    void *result = PaUtil_AllocateStreamArenaMemory( size, &handled );
+
+    if( handled )
+        return result;
+
+    result = malloc( size );
 
 #if PA_TRACK_MEMORY
     if( result != NULL ) numAllocations_ += 1;
@@ -84,7 +120,7 @@ void *PaUtil_AllocateMemory( long size )
 
 void PaUtil_FreeMemory( void *block )
 {
-    if( block != NULL )
+    if( block != NULL && !PaUtil_IsStreamArenaMemory( block ) )
     {
         free( block );
 #if PA_TRACK_MEMORY
@@ -95,6 +131,254 @@ void PaUtil_FreeMemory( void *block )
 }
 
 
+int PaUtil_LockMemory( void *buffer, long size )
+{
+#if defined(_POSIX_MEMLOCK_RANGE) && (_POSIX_MEMLOCK_RANGE != -1)
+    if( mlock( buffer, size ) == 0 )
+        return 1;
+
+    /* EPERM / ENOMEM when RLIMIT_MEMLOCK is exceeded, not fatal */
+    PA_DEBUG(( "%s: Failed locking %ld bytes of memory: %s\n", __FUNCTION__, size, strerror( errno ) ));
+#else
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+#endif
+    return 0;
+}
+
+
+void PaUtil_UnlockMemory( void *buffer, long size )
+{
+#if defined(_POSIX_MEMLOCK_RANGE) && (_POSIX_MEMLOCK_RANGE != -1)
+    munlock( buffer, size );
+#else
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+#endif
+}
+
+
+#if defined(__linux__) && defined(SYS_mbind)
+
+/* the nodes a node mask of PaUtil_PlaceMemory() has room for */
+#define PA_MAX_MEMORY_NODES_ (1024)
+
+#define PA_NODE_MASK_BITS_ (8 * sizeof(unsigned long))
+
+/* Returns the memory node of cpu from its nodeN link in sysfs, or -1. */
+static int GetCpuMemoryNode( int cpu )
+{
+    char path[64];
+    DIR *dir;
+    struct dirent *entry;
+    char *end;
+    long node = -1;
+
+    sprintf( path, "/sys/devices/system/cpu/cpu%d", cpu );
+    if( cpu < 0 || !(dir = opendir( path )) )
+        return -1;
+
+    while( (entry = readdir( dir )) )
+    {
+        if( strncmp( entry->d_name, "node", 4 ) != 0 )
+            continue;
+
+        node = strtol( entry->d_name + 4, &end, 10 );
+        if( end != entry->d_name + 4 && *end == '\0' && node >= 0 && node < PA_MAX_MEMORY_NODES_ )
+            break;
+        node = -1;
+    }
+    closedir( dir );
+
+    return (int)node;
+}
+
+#endif /* __linux__ && SYS_mbind */
+
+
+int PaUtil_PlaceMemory( void *buffer, long size, const int *cpus, int cpuCount )
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    unsigned long nodeMask[PA_MAX_MEMORY_NODES_ / PA_NODE_MASK_BITS_];
+    long pageSize = sysconf( _SC_PAGESIZE );
+    uintptr_t begin, end;
+    int i, node, nodeCount = 0;
+
+    if( !buffer || !cpus || cpuCount <= 0 || pageSize <= 0 )
+        return 0;
+
+    /* nothing to gain with a single node */
+    if( access( "/sys/devices/system/node/node1", F_OK ) != 0 )
+        return 0;
+
+    memset( nodeMask, 0, sizeof(nodeMask) );
+    for( i = 0; i < cpuCount; ++i )
+    {
+        node = GetCpuMemoryNode( cpus[i] );
+        if( node >= 0 )
+        {
+            nodeMask[node / PA_NODE_MASK_BITS_] |= 1UL << (node % PA_NODE_MASK_BITS_);
+            ++nodeCount;
+        }
+    }
+    if( nodeCount == 0 )
+        return 0;
+
+    begin = ((uintptr_t)buffer + (uintptr_t)pageSize - 1) & ~(uintptr_t)(pageSize - 1);
+    end = ((uintptr_t)buffer + (uintptr_t)size) & ~(uintptr_t)(pageSize - 1);
+    if( end <= begin )
+        return 0;
+
+    /* the kernel takes the mask's bit count plus one */
+    if( syscall( SYS_mbind, (void*)begin, (unsigned long)(end - begin), MPOL_BIND, nodeMask,
+            (unsigned long)PA_MAX_MEMORY_NODES_ + 1, MPOL_MF_MOVE ) != 0 )
+    {
+        PA_DEBUG(( "%s: Failed placing %ld bytes of memory: %s\n", __FUNCTION__, size, strerror( errno ) ));
+        return 0;
+    }
+    return 1;
+#else
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+    (void)cpus; /* unused parameter */
+    (void)cpuCount; /* unused parameter */
+    return 0;
+#endif
+}
+
+
+long PaUtil_GetHugePageSize( void )
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    const char *hugePages = getenv( "PA_HUGE_PAGES" );
+    FILE *file;
+    long size = 0;
+
+    if( !hugePages || strcmp( hugePages, "1" ) != 0 )
+        return 0;
+
+    /* the size of the pages a page middle directory entry maps, 2 MB on x86-64 */
+    file = fopen( "/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r" );
+    if( file )
+    {
+        if( fscanf( file, "%ld", &size ) != 1 || size <= 0 || (size & (size - 1)) != 0 )
+            size = 0;
+        fclose( file );
+    }
+    return size;
+#else
+    return 0;
+#endif
+}
+
+
+int PaUtil_AdviseHugePages( void *buffer, long size )
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if( madvise( buffer, size, MADV_HUGEPAGE ) == 0 )
+        return 1;
+
+    PA_DEBUG(( "%s: Failed advising huge pages: %s\n", __FUNCTION__, strerror( errno ) ));
+#else
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+#endif
+    return 0;
+}
+
+
+/* Returns a file descriptor for size bytes of anonymous shared memory, or -1. */
+static int CreateMirrorFile( long size )
+{
+    int fd;
+#if defined(__linux__) && defined(SYS_memfd_create)
+    fd = (int)syscall( SYS_memfd_create, "portaudio-mirror", 0 );
+#else
+    static int counter_ = 0;
+    char name[64];
+    sprintf( name, "/portaudio-mirror-%ld-%d", (long)getpid(), counter_++ );
+    fd = shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 );
+    if( fd != -1 )
+        shm_unlink( name ); /* the mappings keep the memory alive */
+#endif
+    if( fd != -1 && ftruncate( fd, size ) != 0 )
+    {
+        close( fd );
+        fd = -1;
+    }
+    return fd;
+}
+
+
+void *PaUnix_MapMirroredFile( int fd, long offset, long size )
+{
+    char *region;
+
+    /* reserve the address range of both mappings, then map the file over each half */
+    region = (char *)mmap( NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANON, -1, 0 );
+    if( region == MAP_FAILED )
+        return NULL;
+    if( mmap( region, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, (off_t)offset ) == MAP_FAILED
+            || mmap( region + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, (off_t)offset )
+            == MAP_FAILED )
+    {
+        PA_DEBUG(( "%s: Failed mapping %ld bytes twice: %s\n", __FUNCTION__, size, strerror( errno ) ));
+        munmap( region, 2 * size );
+        return NULL;
+    }
+    return region;
+}
+
+
+void PaUnix_UnmapMirroredFile( void *buffer, long size )
+{
+    if( buffer != NULL )
+        munmap( buffer, 2 * size );
+}
+
+
+void *PaUtil_AllocateMirroredMemory( long *size )
+{
+    long pageSize = sysconf( _SC_PAGESIZE );
+    char *region;
+    int fd;
+
+    if( pageSize <= 0 )
+        pageSize = 4096;
+    *size = (*size + pageSize - 1) / pageSize * pageSize;
+
+    fd = CreateMirrorFile( *size );
+    if( fd == -1 )
+    {
+        PA_DEBUG(( "%s: Failed creating %ld bytes of shared memory: %s\n", __FUNCTION__, *size, strerror( errno ) ));
+        return NULL;
+    }
+
+    region = (char *)PaUnix_MapMirroredFile( fd, 0, *size );
+    close( fd );
+
+    if( !region )
+        return NULL;
+
+#if PA_TRACK_MEMORY
+    numAllocations_ += 1;
+#endif
+    return region;
+}
+
+
+void PaUtil_FreeMirroredMemory( void *buffer, long size )
+{
+    if( buffer != NULL )
+    {
+        PaUnix_UnmapMirroredFile( buffer, size );
+#if PA_TRACK_MEMORY
+        numAllocations_ -= 1;
+#endif
+    }
+}
+
+
 int PaUtil_CountCurrentlyAllocatedBlocks( void )
 {
 #if PA_TRACK_MEMORY
@@ -143,130 +427,1056 @@ void Pa_Sleep( long msec )
 static double machSecondsConversionScaler_ = 0.0; 
 #endif
 
+#if !defined(HAVE_MACH_ABSOLUTE_TIME) && defined(__GNUC__) \
+        && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)) \
+        && (defined(__i386__) || defined(__x86_64__) || defined(__aarch64__))
+#define PA_HAVE_CYCLE_COUNTER_
+#endif
+
+#if defined(__linux__) && defined(SYS_sched_setattr)
+#define PA_HAVE_SCHED_DEADLINE_
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE (6)
+#endif
+#endif
+
+#if defined(__linux__) && defined(SYS_futex)
+#define PA_HAVE_FUTEX_
+#endif
+
+#ifndef PA_USE_CYCLE_COUNTER_CLOCK
+#define PA_USE_CYCLE_COUNTER_CLOCK (0)
+#endif
+
+static PaUtilClockSource clockSource_ = paUtilSystemClock;
+
+
+static PaTime GetSystemTime( void )
+{
+#ifdef HAVE_MACH_ABSOLUTE_TIME
+    return mach_absolute_time() * machSecondsConversionScaler_;
+#elif defined(HAVE_CLOCK_GETTIME)
+    struct timespec tp;
+    clock_gettime(CLOCK_REALTIME, &tp);
+    return (PaTime)(tp.tv_sec + tp.tv_nsec * 1e-9);
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return (PaTime) tv.tv_usec * 1e-6 + tv.tv_sec;
+#endif
+}
+
+
+#ifdef PA_HAVE_CYCLE_COUNTER_
+
+/*
+    The cycle counter clock converts the counter to time linearly from an
+    anchor: time = anchor.time + (counter - anchor.cycles) * secondsPerCycle.
+
+    Once a second the first thread to notice places a new anchor on the
+    current line, so the times never jump, with secondsPerCycle measured over
+    all the time since calibration and corrected so that the remaining
+    difference to the system clock is gone after the next second. The
+    correction is limited to 0.1%, which keeps the clock monotonic, so only
+    when the system clock is set by more than a tenth of a second does the
+    clock follow it in a step.
+
+    The new anchor is written to the slot not in use before it is published.
+    A reader could only see a torn anchor if it were preempted between
+    reading the slot index and the anchor for the two seconds until that
+    slot is written again.
+*/
+
+__extension__ typedef unsigned long long PaUtilCycleCount;
+
+typedef struct PaUtilCycleClockAnchor
+{
+    PaUtilCycleCount cycles;
+    PaTime time;
+    double secondsPerCycle;
+} PaUtilCycleClockAnchor;
+
+#define PA_CYCLE_CLOCK_CALIBRATION_SECONDS_ (0.002)
+#define PA_CYCLE_CLOCK_ADJUSTMENT_SECONDS_  (1.0)
+#define PA_CYCLE_CLOCK_MAX_SLEW_            (1e-3)
+#define PA_CYCLE_CLOCK_MAX_ERROR_SECONDS_   (0.1)
+
+static PaUtilCycleClockAnchor cycleClockAnchors_[2];
+static volatile int cycleClockAnchor_ = 0;
+static volatile int cycleClockAdjusting_ = 0;
+static PaUtilCycleCount cycleClockAdjustmentCycles_;
+static PaUtilCycleCount cycleClockCalibrationCycles_;
+static PaTime cycleClockCalibrationTime_;
+
+
+static PaUtilCycleCount ReadCycleCounter( void )
+{
+#if defined(__aarch64__)
+    PaUtilCycleCount cycles;
+    __asm__ __volatile__( "isb\n\tmrs %0, cntvct_el0" : "=r"(cycles) : : "memory" );
+    return cycles;
+#else
+    unsigned int low, high;
+    __asm__ __volatile__( "rdtsc" : "=a"(low), "=d"(high) );
+    return ((PaUtilCycleCount)high << 32) | low;
+#endif
+}
+
+
+static int CycleCounterIsUsable( void )
+{
+#if defined(__aarch64__)
+    return 1;
+#else
+    return (PaUtil_GetCpuFeatures() & paCpuInvariantTSC) != 0;
+#endif
+}
+
+
+/* Measure the counter's rate against the system clock, for
+ PA_CYCLE_CLOCK_CALIBRATION_SECONDS_ on x86. */
+static double CalibrateCycleCounter( PaUtilCycleCount *cycles, PaTime *time )
+{
+#if defined(__aarch64__)
+    PaUtilCycleCount frequency;
+    __asm__ __volatile__( "mrs %0, cntfrq_el0" : "=r"(frequency) );
+    *time = GetSystemTime();
+    *cycles = ReadCycleCounter();
+    return frequency ? 1. / (double)frequency : 0.;
+#else
+    PaTime startTime, endTime;
+    PaUtilCycleCount startCycles, endCycles;
+
+    startTime = GetSystemTime();
+    startCycles = ReadCycleCounter();
+    do
+    {
+        endTime = GetSystemTime();
+        endCycles = ReadCycleCounter();
+    }
+    while( endTime - startTime < PA_CYCLE_CLOCK_CALIBRATION_SECONDS_ );
+
+    *time = endTime;
+    *cycles = endCycles;
+    return endCycles > startCycles ? (endTime - startTime) / (double)(endCycles - startCycles) : 0.;
+#endif
+}
+
+
+static void AdjustCycleCounterClock( const PaUtilCycleClockAnchor *anchor, PaUtilCycleCount cycles )
+{
+    int next = 1 - cycleClockAnchor_;
+    PaUtilCycleClockAnchor *nextAnchor = &cycleClockAnchors_[next];
+    PaTime systemTime = GetSystemTime();
+    PaTime clockTime = anchor->time + (double)(cycles - anchor->cycles) * anchor->secondsPerCycle;
+    PaTime error = systemTime - clockTime;
+
+    if( fabs( error ) > PA_CYCLE_CLOCK_MAX_ERROR_SECONDS_ || cycles <= cycleClockCalibrationCycles_ )
+    {
+        /* the system clock was set, start over from it */
+        cycleClockCalibrationCycles_ = cycles;
+        cycleClockCalibrationTime_ = systemTime;
+        nextAnchor->cycles = cycles;
+        nextAnchor->time = systemTime;
+        nextAnchor->secondsPerCycle = anchor->secondsPerCycle;
+    }
+    else
+    {
+        double secondsPerCycle = (systemTime - cycleClockCalibrationTime_)
+                / (double)(cycles - cycleClockCalibrationCycles_);
+        double slew = error / PA_CYCLE_CLOCK_ADJUSTMENT_SECONDS_;
+
+        if( slew > PA_CYCLE_CLOCK_MAX_SLEW_ )
+            slew = PA_CYCLE_CLOCK_MAX_SLEW_;
+        else if( slew < -PA_CYCLE_CLOCK_MAX_SLEW_ )
+            slew = -PA_CYCLE_CLOCK_MAX_SLEW_;
+
+        nextAnchor->cycles = cycles;
+        nextAnchor->time = clockTime;
+        nextAnchor->secondsPerCycle = secondsPerCycle * (1. + slew);
+    }
+
+    PaUtil_WriteMemoryBarrier();
+    cycleClockAnchor_ = next;
+}
+
+
+static PaTime GetCycleCounterTime( void )
+{
+    PaUtilCycleCount cycles = ReadCycleCounter();
+    const PaUtilCycleClockAnchor *anchor = &cycleClockAnchors_[ cycleClockAnchor_ ];
+
+    PaUtil_ReadMemoryBarrier();
+
+    if( cycles > anchor->cycles
+            && cycles - anchor->cycles >= cycleClockAdjustmentCycles_
+            && __sync_bool_compare_and_swap( &cycleClockAdjusting_, 0, 1 ) )
+    {
+        if( anchor == &cycleClockAnchors_[ cycleClockAnchor_ ] )
+            AdjustCycleCounterClock( anchor, cycles );
+        PaUtil_WriteMemoryBarrier();
+        cycleClockAdjusting_ = 0;
+
+        anchor = &cycleClockAnchors_[ cycleClockAnchor_ ];
+        PaUtil_ReadMemoryBarrier();
+    }
+
+    /* the counters of other cores may lag the anchor by a few cycles */
+    if( cycles < anchor->cycles )
+        return anchor->time;
+
+    return anchor->time + (double)(cycles - anchor->cycles) * anchor->secondsPerCycle;
+}
+
+
+static int StartCycleCounterClock( void )
+{
+    PaUtilCycleClockAnchor *anchor = &cycleClockAnchors_[0];
+
+    if( !CycleCounterIsUsable() )
+        return 0;
+
+    anchor->secondsPerCycle = CalibrateCycleCounter( &anchor->cycles, &anchor->time );
+    if( anchor->secondsPerCycle <= 0. )
+        return 0;
+
+    cycleClockCalibrationCycles_ = anchor->cycles;
+    cycleClockCalibrationTime_ = anchor->time;
+    cycleClockAdjustmentCycles_ = (PaUtilCycleCount)(PA_CYCLE_CLOCK_ADJUSTMENT_SECONDS_ / anchor->secondsPerCycle);
+    cycleClockAnchor_ = 0;
+    cycleClockAdjusting_ = 0;
+    PaUtil_WriteMemoryBarrier();
+
+    return 1;
+}
+
+#endif /* PA_HAVE_CYCLE_COUNTER_ */
+
+
+PaUtilClockSource PaUtil_SelectClockSource( PaUtilClockSource source )
+{
+    clockSource_ = paUtilSystemClock;
+
+#ifdef PA_HAVE_CYCLE_COUNTER_
+    if( source == paUtilCycleCounterClock && StartCycleCounterClock() )
+        clockSource_ = paUtilCycleCounterClock;
+#else
+    (void)source; /* unused parameter */
+#endif
+
+    PaUtil_WriteMemoryBarrier();
+    return clockSource_;
+}
+
+
 void PaUtil_InitializeClock( void )
 {
+    const char *source = getenv( "PA_CLOCK_SOURCE" );
+
 #ifdef HAVE_MACH_ABSOLUTE_TIME
     mach_timebase_info_data_t info;
     kern_return_t err = mach_timebase_info( &info );
     if( err == 0  )
         machSecondsConversionScaler_ = 1e-9 * (double) info.numer / (double) info.denom;
 #endif
+
+    if( source ? strcmp( source, "cyclecounter" ) == 0 : PA_USE_CYCLE_COUNTER_CLOCK )
+    {
+        if( PaUtil_SelectClockSource( paUtilCycleCounterClock ) != paUtilCycleCounterClock )
+        {
+            PA_DEBUG(( "%s: the cycle counter is not usable, using the system clock\n", __FUNCTION__ ));
+        }
+    }
+    else
+    {
+        PaUtil_SelectClockSource( paUtilSystemClock );
+    }
 }
 
 
 PaTime PaUtil_GetTime( void )
 {
-#ifdef HAVE_MACH_ABSOLUTE_TIME
-    return mach_absolute_time() * machSecondsConversionScaler_;
-#elif defined(HAVE_CLOCK_GETTIME)
+#ifdef PA_HAVE_CYCLE_COUNTER_
+    if( clockSource_ == paUtilCycleCounterClock )
+        return GetCycleCounterTime();
+#endif
+    return GetSystemTime();
+}
+
+
+double PaUtil_GetThreadCpuTime( void )
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
     struct timespec tp;
-    clock_gettime(CLOCK_REALTIME, &tp);
-    return (PaTime)(tp.tv_sec + tp.tv_nsec * 1e-9);
+    if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &tp ) == 0 )
+        return (double)tp.tv_sec + tp.tv_nsec * 1e-9;
+#endif
+    return -1.;
+}
+
+PaError PaUtil_InitializeThreading( PaUtilThreading *threading )
+{
+    (void) paUtilErr_;
+    return paNoError;
+}
+
+void PaUtil_TerminateThreading( PaUtilThreading *threading )
+{
+}
+
+PaError PaUtil_StartThreading( PaUtilThreading *threading, void *(*threadRoutine)(void *), void *data )
+{
+    pthread_create( &threading->callbackThread, NULL, threadRoutine, data );
+    return paNoError;
+}
+
+PaError PaUtil_CancelThreading( PaUtilThreading *threading, int wait, PaError *exitResult )
+{
+    PaError result = paNoError;
+    void *pret;
+
+    if( exitResult )
+        *exitResult = paNoError;
+
+    /* If pthread_cancel is not supported (Android platform) whole this function can lead to indefinite waiting if 
+       working thread (callbackThread) has'n received any stop signals from outside, please keep 
+       this in mind when considering using PaUtil_CancelThreading
+    */
+#ifdef PTHREAD_CANCELED
+    /* Only kill the thread if it isn't in the process of stopping (flushing adaptation buffers) */
+    if( !wait )
+        pthread_cancel( threading->callbackThread );   /* XXX: Safe to call this if the thread has exited on its own? */
+#endif
+    pthread_join( threading->callbackThread, &pret );
+
+#ifdef PTHREAD_CANCELED
+    if( pret && PTHREAD_CANCELED != pret )
 #else
-    struct timeval tv;
-    gettimeofday( &tv, NULL );
-    return (PaTime) tv.tv_usec * 1e-6 + tv.tv_sec;
+    /* !wait means the thread may have been canceled */
+    if( pret && wait )
+#endif
+    {
+        if( exitResult )
+            *exitResult = *(PaError *) pret;
+        free( pret );
+    }
+
+    return result;
+}
+
+/* Threading */
+/* paUnixMainThread 
+ * We have to be a bit careful with defining this global variable,
+ * as explained below. */
+#ifdef __APPLE__
+/* apple/gcc has a "problem" with global vars and dynamic libs.
+   Initializing it seems to fix the problem.
+   Described a bit in this thread:
+   http://gcc.gnu.org/ml/gcc/2005-06/msg00179.html
+*/
+pthread_t paUnixMainThread = 0;
+#else
+/*pthreads are opaque. We don't know that asigning it an int value
+  always makes sense, so we don't initialize it unless we have to.*/
+pthread_t paUnixMainThread = 0;
+#endif
+
+/* Raise the calling thread to SCHED_FIFO, returns 1 on success and 0 without the permission */
+static PaError BoostPriority( void )
+{
+    PaError result = paNoError;
+    struct sched_param spm = { 0 };
+    int err;
+    /* Priority should only matter between contending FIFO threads? */
+    spm.sched_priority = 1;
+
+    if( (err = pthread_setschedparam( pthread_self(), SCHED_FIFO, &spm )) != 0 )
+    {
+        PA_UNLESS( err == EPERM, paInternalError );  /* Lack permission to raise priority */
+        PA_DEBUG(( "Failed bumping priority\n" ));
+        result = 0;
+    }
+    else
+    {
+        result = 1; /* Success */
+    }
+error:
+    return result;
+}
+
+#ifdef PA_HAVE_SCHED_DEADLINE_
+/* sched_setattr() has no glibc wrapper, this is the kernel's struct sched_attr */
+typedef struct PaUnixSchedAttr
+{
+    uint32_t size;
+    uint32_t schedPolicy;
+    uint64_t schedFlags;
+    int32_t schedNice;
+    uint32_t schedPriority;
+    uint64_t schedRuntime;      /* ns */
+    uint64_t schedDeadline;     /* ns */
+    uint64_t schedPeriod;       /* ns */
+} PaUnixSchedAttr;
+
+/* Put the calling thread under SCHED_DEADLINE, returns 1 on success and 0 if the
+ kernel refused, e.g. for lack of permission, bandwidth or a restricted affinity */
+static int SetDeadlineScheduling( PaTime period, PaTime runtime )
+{
+    PaUnixSchedAttr attr;
+
+    memset( &attr, 0, sizeof (attr) );
+    attr.size = sizeof (attr);
+    attr.schedPolicy = SCHED_DEADLINE;
+    attr.schedRuntime = (uint64_t)(runtime * 1e9);
+    attr.schedDeadline = attr.schedPeriod = (uint64_t)(period * 1e9);
+
+    if( syscall( SYS_sched_setattr, 0, &attr, 0 ) != 0 )
+    {
+        PA_DEBUG(( "%s: SCHED_DEADLINE with a runtime of %g of %g s refused: %s\n", __FUNCTION__,
+                runtime, period, strerror( errno ) ));
+        return 0;
+    }
+    return 1;
+}
+#endif /* PA_HAVE_SCHED_DEADLINE_ */
+
+#ifdef PA_USE_RTKIT
+/*
+    rtkit grants SCHED_RR to the threads of unprivileged processes over D-Bus.
+    libdbus-1 is loaded at run time, so PortAudio neither builds nor runs
+    against it unless rtkit is actually needed. The declarations below are the
+    parts of its stable ABI used here.
+*/
+typedef struct PaUnixDBusError
+{
+    const char *name;
+    const char *message;
+    unsigned int dummy;         /* the bit fields of DBusError */
+    void *padding;
+} PaUnixDBusError;
+
+#define PA_DBUS_BUS_SYSTEM_     (1)
+#define PA_DBUS_TYPE_INVALID_   (0)
+#define PA_DBUS_TYPE_UINT32_    ((int)'u')
+#define PA_DBUS_TYPE_UINT64_    ((int)'t')
+
+/* rtkit only serves processes that limit the real-time CPU time of their threads */
+#define PA_RTKIT_RTTIME_USEC_   (200000)
+
+static int MakeRealTimeWithRtkit( int priority )
+{
+    void *dbus;
+    void (*errorInit)( PaUnixDBusError* );
+    void (*errorFree)( PaUnixDBusError* );
+    unsigned int (*errorIsSet)( const PaUnixDBusError* );
+    void *(*busGetPrivate)( int, PaUnixDBusError* );
+    void (*setExitOnDisconnect)( void*, unsigned int );
+    void *(*newMethodCall)( const char*, const char*, const char*, const char* );
+    unsigned int (*appendArgs)( void*, int, ... );
+    void *(*sendWithReplyAndBlock)( void*, void*, int, PaUnixDBusError* );
+    unsigned int (*setErrorFromMessage)( PaUnixDBusError*, void* );
+    void (*messageUnref)( void* );
+    void (*connectionClose)( void* );
+    void (*connectionUnref)( void* );
+    PaUnixDBusError error;
+    void *connection = NULL, *message = NULL, *reply = NULL;
+    uint64_t thread = (uint64_t)syscall( SYS_gettid );
+    uint32_t rtkitPriority = (uint32_t)priority;
+    struct rlimit rlimit;
+    int result = 0;
+
+    if( !(dbus = dlopen( "libdbus-1.so.3", RTLD_NOW | RTLD_LOCAL )) )
+    {
+        PA_DEBUG(( "%s: libdbus-1 not available\n", __FUNCTION__ ));
+        return 0;
+    }
+
+    *(void**)&errorInit = dlsym( dbus, "dbus_error_init" );
+    *(void**)&errorFree = dlsym( dbus, "dbus_error_free" );
+    *(void**)&errorIsSet = dlsym( dbus, "dbus_error_is_set" );
+    *(void**)&busGetPrivate = dlsym( dbus, "dbus_bus_get_private" );
+    *(void**)&setExitOnDisconnect = dlsym( dbus, "dbus_connection_set_exit_on_disconnect" );
+    *(void**)&newMethodCall = dlsym( dbus, "dbus_message_new_method_call" );
+    *(void**)&appendArgs = dlsym( dbus, "dbus_message_append_args" );
+    *(void**)&sendWithReplyAndBlock = dlsym( dbus, "dbus_connection_send_with_reply_and_block" );
+    *(void**)&setErrorFromMessage = dlsym( dbus, "dbus_set_error_from_message" );
+    *(void**)&messageUnref = dlsym( dbus, "dbus_message_unref" );
+    *(void**)&connectionClose = dlsym( dbus, "dbus_connection_close" );
+    *(void**)&connectionUnref = dlsym( dbus, "dbus_connection_unref" );
+    if( !errorInit || !errorFree || !errorIsSet || !busGetPrivate || !setExitOnDisconnect || !newMethodCall
+            || !appendArgs || !sendWithReplyAndBlock || !setErrorFromMessage || !messageUnref
+            || !connectionClose || !connectionUnref )
+        goto end;
+
+    (*errorInit)( &error );
+    if( !(connection = (*busGetPrivate)( PA_DBUS_BUS_SYSTEM_, &error )) )
+        goto end_error;
+    (*setExitOnDisconnect)( connection, 0 );
+
+    if( !(message = (*newMethodCall)( "org.freedesktop.RealtimeKit1", "/org/freedesktop/RealtimeKit1",
+                    "org.freedesktop.RealtimeKit1", "MakeThreadRealtime" ))
+            || !(*appendArgs)( message, PA_DBUS_TYPE_UINT64_, &thread, PA_DBUS_TYPE_UINT32_, &rtkitPriority,
+                    PA_DBUS_TYPE_INVALID_ ) )
+        goto end_error;
+
+    /* only limited once rtkit is reachable */
+    if( getrlimit( RLIMIT_RTTIME, &rlimit ) == 0
+            && (rlimit.rlim_max == RLIM_INFINITY || rlimit.rlim_max > PA_RTKIT_RTTIME_USEC_) )
+    {
+        rlimit.rlim_cur = rlimit.rlim_max = PA_RTKIT_RTTIME_USEC_;
+        if( setrlimit( RLIMIT_RTTIME, &rlimit ) != 0 )
+            goto end_error;
+    }
+
+    if( (reply = (*sendWithReplyAndBlock)( connection, message, -1, &error )) != NULL
+            && !(*setErrorFromMessage)( &error, reply ) )
+        result = 1;
+
+end_error:
+    if( (*errorIsSet)( &error ) )
+    {
+        PA_DEBUG(( "%s: rtkit refused: %s\n", __FUNCTION__, error.message ));
+        (*errorFree)( &error );
+    }
+    if( reply )
+        (*messageUnref)( reply );
+    if( message )
+        (*messageUnref)( message );
+    if( connection )
+    {
+        (*connectionClose)( connection );
+        (*connectionUnref)( connection );
+    }
+end:
+    dlclose( dbus );
+    return result;
+}
+#endif /* PA_USE_RTKIT */
+
+/* Schedule the calling thread as requested, trying SCHED_DEADLINE, SCHED_FIFO and
+ rtkit in this order. Failing to get real-time scheduling is not an error. */
+static void SetRealTimeScheduling( PaUnixThread *self )
+{
+    const PaUnixThreadScheduling *scheduling = &self->scheduling;
+
+    self->schedulingPolicy = SCHED_OTHER;
+
+#ifdef PA_HAVE_SCHED_DEADLINE_
+    if( scheduling->period > 0. && scheduling->runtime > 0.
+            && SetDeadlineScheduling( scheduling->period, scheduling->runtime ) )
+    {
+        self->schedulingPolicy = SCHED_DEADLINE;
+        return;
+    }
+#endif
+
+    if( BoostPriority() == 1 )
+    {
+        self->schedulingPolicy = SCHED_FIFO;
+        return;
+    }
+
+#ifdef PA_USE_RTKIT
+    if( MakeRealTimeWithRtkit( 1 ) )
+    {
+        self->schedulingPolicy = SCHED_RR;
+        return;
+    }
+#endif
+
+    PA_DEBUG(( "%s: no real-time scheduling available\n", __FUNCTION__ ));
+}
+
+#if defined(__linux__) && defined(RLIMIT_RTTIME) && defined(SYS_gettid)
+#define PA_HAVE_RUNAWAY_PROTECTION_
+#endif
+
+#ifdef PA_HAVE_RUNAWAY_PROTECTION_
+
+/* the threads protected at once, one per callback thread */
+#define PA_MAX_PROTECTED_THREADS_ (64)
+
+typedef struct
+{
+    volatile pid_t tid;         /* 0 for a free entry */
+    PaUnixThread *thread;
+} PaUnixProtectedThread;
+
+/* All protected threads of the process share one limit and one SIGXCPU handler, registered while any of them runs.
+ The handler only reads the table, which is changed under the mutex. */
+static pthread_mutex_t protectionMtx_ = PTHREAD_MUTEX_INITIALIZER;
+static PaUnixProtectedThread protectedThreads_[PA_MAX_PROTECTED_THREADS_];
+static int protectedThreadCount_ = 0;
+static struct rlimit previousRtTimeLimit_;
+static struct sigaction previousSigXcpuAction_;
+
+/* Demote the real-time thread the kernel caught running without blocking. The kernel signals the thread exceeding the
+ limit, unless it blocks SIGXCPU, so signals delivered to other threads are passed on or, if only PortAudio set the
+ limit, ignored. */
+static void OnSigXcpu( int sig, siginfo_t *info, void *context )
+{
+    pid_t tid = (pid_t)syscall( SYS_gettid );
+    struct sched_param spm = { 0 };
+    int i;
+
+    for( i = 0; i < PA_MAX_PROTECTED_THREADS_; ++i )
+    {
+        if( protectedThreads_[i].tid == tid )
+        {
+            if( sched_setscheduler( 0, SCHED_OTHER, &spm ) == 0 )
+                protectedThreads_[i].thread->schedulingPolicy = SCHED_OTHER;
+            return;
+        }
+    }
+
+    if( previousSigXcpuAction_.sa_flags & SA_SIGINFO )
+        (*previousSigXcpuAction_.sa_sigaction)( sig, info, context );
+    else if( previousSigXcpuAction_.sa_handler != SIG_DFL && previousSigXcpuAction_.sa_handler != SIG_IGN )
+        (*previousSigXcpuAction_.sa_handler)( sig );
+    else if( previousSigXcpuAction_.sa_handler == SIG_DFL && previousRtTimeLimit_.rlim_cur != RLIM_INFINITY )
+    {
+        /* the limit which was there before PortAudio's, terminate as the kernel would have */
+        signal( SIGXCPU, SIG_DFL );
+        raise( SIGXCPU );
+    }
+}
+
+/* Protect the calling real-time thread, returns the index of its table entry or -1 */
+static int ProtectThread( PaUnixThread *self )
+{
+    struct rlimit limit;
+    struct sigaction action;
+    rlim_t rtTime = (rlim_t)(PA_UNIX_RUNAWAY_RTTIME * 1e6);
+    int index = -1, i;
+
+    PA_ASSERT_CALL( pthread_mutex_lock( &protectionMtx_ ), 0 );
+
+    for( i = 0; i < PA_MAX_PROTECTED_THREADS_ && index < 0; ++i )
+    {
+        if( protectedThreads_[i].tid == 0 )
+            index = i;
+    }
+    if( index < 0 )
+        goto end;
+
+    if( protectedThreadCount_ == 0 )
+    {
+        if( getrlimit( RLIMIT_RTTIME, &previousRtTimeLimit_ ) != 0 )
+        {
+            index = -1;
+            goto end;
+        }
+
+        memset( &action, 0, sizeof (action) );
+        action.sa_sigaction = OnSigXcpu;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset( &action.sa_mask );
+        if( sigaction( SIGXCPU, &action, &previousSigXcpuAction_ ) != 0 )
+        {
+            index = -1;
+            goto end;
+        }
+
+        /* below a hard limit, such as rtkit's, so the thread is demoted before it is killed */
+        limit = previousRtTimeLimit_;
+        if( limit.rlim_max != RLIM_INFINITY && limit.rlim_max / 2 < rtTime )
+            rtTime = limit.rlim_max / 2;
+        if( limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > rtTime )
+            limit.rlim_cur = rtTime;
+        if( setrlimit( RLIMIT_RTTIME, &limit ) != 0 )
+        {
+            PA_DEBUG(( "%s: Failed limiting the real-time CPU time: %s\n", __FUNCTION__, strerror( errno ) ));
+            sigaction( SIGXCPU, &previousSigXcpuAction_, NULL );
+            index = -1;
+            goto end;
+        }
+    }
+
+    protectedThreads_[index].thread = self;
+    protectedThreads_[index].tid = (pid_t)syscall( SYS_gettid );
+    ++protectedThreadCount_;
+
+end:
+    PA_ASSERT_CALL( pthread_mutex_unlock( &protectionMtx_ ), 0 );
+    return index;
+}
+
+/* Cleanup handler of a protected thread, takes its table entry */
+static void UnprotectThread( void *entry )
+{
+    PaUnixProtectedThread *protectedThread = (PaUnixProtectedThread*)entry;
+
+    PA_ASSERT_CALL( pthread_mutex_lock( &protectionMtx_ ), 0 );
+
+    protectedThread->tid = 0;
+    protectedThread->thread = NULL;
+    if( --protectedThreadCount_ == 0 )
+    {
+        setrlimit( RLIMIT_RTTIME, &previousRtTimeLimit_ );
+        sigaction( SIGXCPU, &previousSigXcpuAction_, NULL );
+    }
+
+    PA_ASSERT_CALL( pthread_mutex_unlock( &protectionMtx_ ), 0 );
+}
+
+#endif /* PA_HAVE_RUNAWAY_PROTECTION_ */
+
+/* Run the thread function on the calling thread, which is scheduled already */
+static void *RunThreadFunc( PaUnixThread *self )
+{
+    void *result;
+#ifdef PA_HAVE_RUNAWAY_PROTECTION_
+    int protectedIndex = -1;
+#endif
+
+#ifdef PA_HAVE_RUNAWAY_PROTECTION_
+    if( self->scheduling.runawayProtection
+            && ( self->schedulingPolicy == SCHED_FIFO || self->schedulingPolicy == SCHED_RR ) )
+        protectedIndex = ProtectThread( self );
+
+    if( protectedIndex >= 0 )
+    {
+        /* the entry is released however the thread ends, it may be canceled */
+        pthread_cleanup_push( UnprotectThread, &protectedThreads_[protectedIndex] );
+        result = (*self->threadFunc)( self->threadArg );
+        pthread_cleanup_pop( 1 );
+        return result;
+    }
 #endif
+
+    result = (*self->threadFunc)( self->threadArg );
+    return result;
 }
 
-PaError PaUtil_InitializeThreading( PaUtilThreading *threading )
-{
-    (void) paUtilErr_;
-    return paNoError;
+/* The entry point of a thread of its own, which schedules the thread before handing over */
+static void *ThreadEntry( void *userData )
+{
+    PaUnixThread *self = (PaUnixThread*)userData;
+
+    if( self->scheduling.realTime )
+        SetRealTimeScheduling( self );
+
+    return RunThreadFunc( self );
+}
+
+/* Restrict the CPUs a thread created with attr may run on */
+static PaError SetCpuAffinity( pthread_attr_t *attr, const int *cpus, int cpuCount )
+{
+    PaError result = paNoError;
+#ifdef __linux__
+    cpu_set_t *cpuSet;
+    size_t cpuSetSize;
+    int maxCpu = 0, i, err;
+
+    for( i = 0; i < cpuCount; ++i )
+    {
+        PA_UNLESS( cpus[i] >= 0, paInternalError );
+        if( cpus[i] > maxCpu )
+            maxCpu = cpus[i];
+    }
+
+    PA_UNLESS( cpuSet = CPU_ALLOC( maxCpu + 1 ), paInsufficientMemory );
+    cpuSetSize = CPU_ALLOC_SIZE( maxCpu + 1 );
+    CPU_ZERO_S( cpuSetSize, cpuSet );
+    for( i = 0; i < cpuCount; ++i )
+        CPU_SET_S( cpus[i], cpuSetSize, cpuSet );
+
+    err = pthread_attr_setaffinity_np( attr, cpuSetSize, cpuSet );
+    CPU_FREE( cpuSet );
+    PA_UNLESS( !err, paInternalError );
+#else
+    (void)attr; /* unused parameter */
+    (void)cpus; /* unused parameter */
+    (void)cpuCount; /* unused parameter */
+    PA_DEBUG(( "%s: CPU affinity is not supported on this system, ignored\n", __FUNCTION__ ));
+#endif
+
+error:
+    return result;
+}
+
+int PaUnixThread_GetCurrentCpu( void )
+{
+#ifdef __linux__
+    return sched_getcpu();
+#else
+    return -1;
+#endif
+}
+
+/* The pool of PaUnixThread_New(). A pooled thread is scheduled once, when it is created, and waits for a thread
+ function to run. When that returns, the thread goes back on the idle list of its kind, unless it has been canceled
+ meanwhile or left with other scheduling, then it ends and is joined by PaUnixThread_Terminate() as a thread of its
+ own would be. */
+
+#define PA_UNIX_THREAD_POOL_SIZE_ (1)
+
+typedef enum
+{
+    paUnixPooledThreadIdle,
+    paUnixPooledThreadRunning,
+    paUnixPooledThreadCanceling,    /* canceled by PaUnixThread_Terminate() */
+    paUnixPooledThreadDone,         /* the thread function returned jobResult */
+    paUnixPooledThreadRetired,      /* as done, but the thread ends */
+    paUnixPooledThreadExited        /* the thread function was canceled or called pthread_exit() */
+} PaUnixPooledThreadState;
+
+typedef struct PaUnixPooledThread
+{
+    pthread_t thread;
+    struct PaUnixPooledThread *next;    /* in the idle list */
+    int realTime;
+    int schedulingPolicy;
+    int schedulingPriority;
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    PaUnixPooledThreadState state;
+    int quit;
+    PaUnixThread *job;                  /* the thread whose function runs */
+    void *jobResult;
+} PaUnixPooledThread;
+
+static pthread_mutex_t threadPoolMtx_ = PTHREAD_MUTEX_INITIALIZER;
+static PaUnixPooledThread *idleThreads_[2] = { NULL, NULL };    /* indexed by realTime */
+static int idleThreadCounts_[2] = { 0, 0 };
+static int threadPoolUsers_ = 0;
+static int threadPoolSize_ = 0;
+
+static void DestroyPooledThread( PaUnixPooledThread *self )
+{
+    PA_ASSERT_CALL( pthread_mutex_destroy( &self->mtx ), 0 );
+    PA_ASSERT_CALL( pthread_cond_destroy( &self->cond ), 0 );
+    free( self );
+}
+
+/* Cleanup handler of the thread function running on a pooled thread */
+static void OnPooledThreadFuncExit( void *userData )
+{
+    PaUnixPooledThread *self = (PaUnixPooledThread*)userData;
+
+    PA_ASSERT_CALL( pthread_mutex_lock( &self->mtx ), 0 );
+    self->state = paUnixPooledThreadExited;
+    PA_ASSERT_CALL( pthread_cond_broadcast( &self->cond ), 0 );
+    PA_ASSERT_CALL( pthread_mutex_unlock( &self->mtx ), 0 );
+}
+
+/* Run the thread function, cancelable as a thread of its own is */
+static void *RunPooledThreadFunc( PaUnixPooledThread *self )
+{
+    void *result;
+
+    pthread_cleanup_push( OnPooledThreadFuncExit, self );
+    pthread_setcancelstate( PTHREAD_CANCEL_ENABLE, NULL );
+
+    result = RunThreadFunc( self->job );
+
+    pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+    pthread_cleanup_pop( 0 );
+
+    return result;
+}
+
+/* Whether the thread function left the thread scheduled as it found it */
+static int KeepsScheduling( PaUnixPooledThread *self )
+{
+    struct sched_param spm;
+    int policy;
+
+    if( pthread_getschedparam( pthread_self(), &policy, &spm ) != 0 )
+        return 0;
+    return policy == self->schedulingPolicy && spm.sched_priority == self->schedulingPriority;
+}
+
+static void *PooledThreadFunc( void *userData )
+{
+    PaUnixPooledThread *self = (PaUnixPooledThread*)userData;
+    PaUnixThread scheduled;
+    struct sched_param spm;
+    void *result;
+
+    /* only the thread functions are cancelable */
+    pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, NULL );
+
+    if( self->realTime )
+    {
+        memset( &scheduled, 0, sizeof (scheduled) );
+        scheduled.scheduling.realTime = 1;
+        SetRealTimeScheduling( &scheduled );
+    }
+    if( pthread_getschedparam( pthread_self(), &self->schedulingPolicy, &spm ) != 0 )
+        self->schedulingPolicy = SCHED_OTHER;
+    self->schedulingPriority = spm.sched_priority;
+
+    PA_ASSERT_CALL( pthread_mutex_lock( &self->mtx ), 0 );
+    while( 1 )
+    {
+        while( self->state != paUnixPooledThreadRunning && !self->quit )
+            PA_ASSERT_CALL( pthread_cond_wait( &self->cond, &self->mtx ), 0 );
+        if( self->quit )
+            break;
+
+        self->job->schedulingPolicy = self->schedulingPolicy;
+        PA_ASSERT_CALL( pthread_mutex_unlock( &self->mtx ), 0 );
+
+        result = RunPooledThreadFunc( self );
+
+        PA_ASSERT_CALL( pthread_mutex_lock( &self->mtx ), 0 );
+        self->jobResult = result;
+        /* a cancellation may still be pending, which mustn't hit the next thread function */
+        if( self->state == paUnixPooledThreadCanceling || !KeepsScheduling( self ) )
+        {
+            self->state = paUnixPooledThreadRetired;
+            PA_ASSERT_CALL( pthread_cond_broadcast( &self->cond ), 0 );
+            break;
+        }
+        self->state = paUnixPooledThreadDone;
+        PA_ASSERT_CALL( pthread_cond_broadcast( &self->cond ), 0 );
+    }
+    PA_ASSERT_CALL( pthread_mutex_unlock( &self->mtx ), 0 );
+
+    return NULL;
+}
+
+/* Create an idle pooled thread, returns NULL on failure */
+static PaUnixPooledThread *NewPooledThread( int realTime )
+{
+    PaUnixPooledThread *self;
+    pthread_attr_t attr;
+    int err;
+
+    if( !(self = (PaUnixPooledThread*)malloc( sizeof (PaUnixPooledThread) )) )
+        return NULL;
+    memset( self, 0, sizeof (PaUnixPooledThread) );
+    self->realTime = realTime;
+    self->state = paUnixPooledThreadIdle;
+    PaUnix_InitializeMutex( &self->mtx );
+    PA_ASSERT_CALL( pthread_cond_init( &self->cond, NULL ), 0 );
+
+    if( pthread_attr_init( &attr ) != 0 )
+    {
+        DestroyPooledThread( self );
+        return NULL;
+    }
+    pthread_attr_setscope( &attr, PTHREAD_SCOPE_SYSTEM );
+    err = pthread_create( &self->thread, &attr, PooledThreadFunc, self );
+    pthread_attr_destroy( &attr );
+    if( err != 0 )
+    {
+        DestroyPooledThread( self );
+        return NULL;
+    }
+
+    return self;
 }
 
-void PaUtil_TerminateThreading( PaUtilThreading *threading )
+/* Stop an idle pooled thread */
+static void StopPooledThread( PaUnixPooledThread *self )
 {
-}
+    PA_ASSERT_CALL( pthread_mutex_lock( &self->mtx ), 0 );
+    self->quit = 1;
+    PA_ASSERT_CALL( pthread_cond_broadcast( &self->cond ), 0 );
+    PA_ASSERT_CALL( pthread_mutex_unlock( &self->mtx ), 0 );
 
-PaError PaUtil_StartThreading( PaUtilThreading *threading, void *(*threadRoutine)(void *), void *data )
-{
-    pthread_create( &threading->callbackThread, NULL, threadRoutine, data );
-    return paNoError;
+    pthread_join( self->thread, NULL );
+    DestroyPooledThread( self );
 }
 
-PaError PaUtil_CancelThreading( PaUtilThreading *threading, int wait, PaError *exitResult )
+/* Take an idle thread of the pool, creating one if there is none. Returns NULL without a pool */
+static PaUnixPooledThread *TakePooledThread( int realTime )
 {
-    PaError result = paNoError;
-    void *pret;
+    PaUnixPooledThread *self = NULL;
+    int pooling;
 
-    if( exitResult )
-        *exitResult = paNoError;
+    PA_ASSERT_CALL( pthread_mutex_lock( &threadPoolMtx_ ), 0 );
+    pooling = threadPoolUsers_ > 0 && threadPoolSize_ > 0;
+    if( pooling && idleThreads_[realTime] )
+    {
+        self = idleThreads_[realTime];
+        idleThreads_[realTime] = self->next;
+        --idleThreadCounts_[realTime];
+        self->next = NULL;
+    }
+    PA_ASSERT_CALL( pthread_mutex_unlock( &threadPoolMtx_ ), 0 );
 
-    /* If pthread_cancel is not supported (Android platform) whole this function can lead to indefinite waiting if 
-       working thread (callbackThread) has'n received any stop signals from outside, please keep 
-       this in mind when considering using PaUtil_CancelThreading
-    */
-#ifdef PTHREAD_CANCELED
-    /* Only kill the thread if it isn't in the process of stopping (flushing adaptation buffers) */
-    if( !wait )
-        pthread_cancel( threading->callbackThread );   /* XXX: Safe to call this if the thread has exited on its own? */
-#endif
-    pthread_join( threading->callbackThread, &pret );
+    if( pooling && !self )
+        self = NewPooledThread( realTime );
+    return self;
+}
 
-#ifdef PTHREAD_CANCELED
-    if( pret && PTHREAD_CANCELED != pret )
-#else
-    /* !wait means the thread may have been canceled */
-    if( pret && wait )
-#endif
+/* Put a thread whose function returned back on the idle list, or stop it if the list is full */
+static void ReleasePooledThread( PaUnixPooledThread *self )
+{
+    int kept = 0;
+
+    PA_ASSERT_CALL( pthread_mutex_lock( &threadPoolMtx_ ), 0 );
+    if( threadPoolUsers_ > 0 && idleThreadCounts_[self->realTime] < threadPoolSize_ )
     {
-        if( exitResult )
-            *exitResult = *(PaError *) pret;
-        free( pret );
+        self->next = idleThreads_[self->realTime];
+        idleThreads_[self->realTime] = self;
+        ++idleThreadCounts_[self->realTime];
+        kept = 1;
     }
+    PA_ASSERT_CALL( pthread_mutex_unlock( &threadPoolMtx_ ), 0 );
 
-    return result;
+    if( !kept )
+        StopPooledThread( self );
 }
 
-/* Threading */
-/* paUnixMainThread 
- * We have to be a bit careful with defining this global variable,
- * as explained below. */
-#ifdef __APPLE__
-/* apple/gcc has a "problem" with global vars and dynamic libs.
-   Initializing it seems to fix the problem.
-   Described a bit in this thread:
-   http://gcc.gnu.org/ml/gcc/2005-06/msg00179.html
-*/
-pthread_t paUnixMainThread = 0;
-#else
-/*pthreads are opaque. We don't know that asigning it an int value
-  always makes sense, so we don't initialize it unless we have to.*/
-pthread_t paUnixMainThread = 0;
-#endif
-
 PaError PaUnixThreading_Initialize()
 {
+    const char *size = getenv( "PA_UNIX_THREAD_POOL" );
+    PaUnixPooledThread *thread;
+    int start = 0, i;
+
     paUnixMainThread = pthread_self();
+
+    PA_ASSERT_CALL( pthread_mutex_lock( &threadPoolMtx_ ), 0 );
+    if( threadPoolUsers_++ == 0 )
+    {
+        threadPoolSize_ = size ? atoi( size ) : PA_UNIX_THREAD_POOL_SIZE_;
+        if( threadPoolSize_ < 0 )
+            threadPoolSize_ = 0;
+        start = threadPoolSize_;
+    }
+    PA_ASSERT_CALL( pthread_mutex_unlock( &threadPoolMtx_ ), 0 );
+
+    /* not having the threads ahead of use isn't an error */
+    for( i = 0; i < start && (thread = NewPooledThread( 1 )); ++i )
+        ReleasePooledThread( thread );
+
     return paNoError;
 }
 
-static PaError BoostPriority( PaUnixThread* self )
+void PaUnixThreading_Terminate( void )
 {
-    PaError result = paNoError;
-    struct sched_param spm = { 0 };
-    /* Priority should only matter between contending FIFO threads? */
-    spm.sched_priority = 1;
-
-    assert( self );
+    PaUnixPooledThread *threads[2] = { NULL, NULL }, *thread;
+    int i;
 
-    if( pthread_setschedparam( self->thread, SCHED_FIFO, &spm ) != 0 )
+    PA_ASSERT_CALL( pthread_mutex_lock( &threadPoolMtx_ ), 0 );
+    assert( threadPoolUsers_ > 0 );
+    if( --threadPoolUsers_ == 0 )
     {
-        PA_UNLESS( errno == EPERM, paInternalError );  /* Lack permission to raise priority */
-        PA_DEBUG(( "Failed bumping priority\n" ));
-        result = 0;
+        for( i = 0; i < 2; ++i )
+        {
+            threads[i] = idleThreads_[i];
+            idleThreads_[i] = NULL;
+            idleThreadCounts_[i] = 0;
+        }
     }
-    else
+    PA_ASSERT_CALL( pthread_mutex_unlock( &threadPoolMtx_ ), 0 );
+
+    for( i = 0; i < 2; ++i )
     {
-        result = 1; /* Success */
+        while( (thread = threads[i]) )
+        {
+            threads[i] = thread->next;
+            StopPooledThread( thread );
+        }
     }
-error:
-    return result;
 }
 
 PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void* threadArg, PaTime waitForChild,
-        int rtSched )
+        const PaUnixThreadScheduling *scheduling, const int *cpus, int cpuCount )
 {
     PaError result = paNoError;
     pthread_attr_t attr;
@@ -277,80 +1487,47 @@ PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void
     PA_ASSERT_CALL( pthread_cond_init( &self->cond, NULL ), 0 );
 
     self->parentWaiting = 0 != waitForChild;
+    self->threadFunc = threadFunc;
+    self->threadArg = threadArg;
+    if( scheduling )
+        self->scheduling = *scheduling;
+    self->schedulingPolicy = SCHED_OTHER;
 
-    /* Spawn thread */
+    /* Borrow a thread of the pool, which has been scheduled already */
+    if( cpuCount == 0 && !( scheduling && scheduling->period > 0. ) )
+        self->pooled = TakePooledThread( self->scheduling.realTime ? 1 : 0 );
 
-/* Temporarily disabled since we should test during configuration for presence of required mman.h header */
-#if 0
-#if defined _POSIX_MEMLOCK && (_POSIX_MEMLOCK != -1)
-    if( rtSched )
+    if( self->pooled )
     {
-        if( mlockall( MCL_CURRENT | MCL_FUTURE ) < 0 )
-        {
-            int savedErrno = errno;             /* In case errno gets overwritten */
-            assert( savedErrno != EINVAL );     /* Most likely a programmer error */
-            PA_UNLESS( (savedErrno == EPERM), paInternalError );
-            PA_DEBUG(( "%s: Failed locking memory\n", __FUNCTION__ ));
-        }
-        else
-            PA_DEBUG(( "%s: Successfully locked memory\n", __FUNCTION__ ));
+        PA_ASSERT_CALL( pthread_mutex_lock( &self->pooled->mtx ), 0 );
+        self->thread = self->pooled->thread;
+        self->pooled->job = self;
+        self->pooled->state = paUnixPooledThreadRunning;
+        PA_ASSERT_CALL( pthread_cond_broadcast( &self->pooled->cond ), 0 );
+        PA_ASSERT_CALL( pthread_mutex_unlock( &self->pooled->mtx ), 0 );
+        started = 1;
+        goto wait;
     }
-#endif
-#endif
+
+    /* Spawn thread */
+
+/* Memory used by the callback is pre-faulted and locked per stream, see
+   PaUtil_CreateArenaAllocationGroup(), instead of locking the whole process */
 
     PA_UNLESS( !pthread_attr_init( &attr ), paInternalError );
     /* Priority relative to other processes */
     PA_UNLESS( !pthread_attr_setscope( &attr, PTHREAD_SCOPE_SYSTEM ), paInternalError );   
+    /* Pinned from the start, so the thread never runs on another CPU */
+    if( cpuCount > 0 )
+    {
+        PA_ENSURE( SetCpuAffinity( &attr, cpus, cpuCount ) );
+    }
 
-    PA_UNLESS( !pthread_create( &self->thread, &attr, threadFunc, threadArg ), paInternalError );
+    /* The thread schedules itself, SCHED_DEADLINE and rtkit can only be asked for by the thread */
+    PA_UNLESS( !pthread_create( &self->thread, &attr, ThreadEntry, self ), paInternalError );
     started = 1;
 
-    if( rtSched )
-    {
-#if 0
-        if( self->useWatchdog )
-        {
-            int err;
-            struct sched_param wdSpm = { 0 };
-            /* Launch watchdog, watchdog sets callback thread priority */
-            int prio = PA_MIN( self->rtPrio + 4, sched_get_priority_max( SCHED_FIFO ) );
-            wdSpm.sched_priority = prio;
-
-            PA_UNLESS( !pthread_attr_init( &attr ), paInternalError );
-            PA_UNLESS( !pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED ), paInternalError );
-            PA_UNLESS( !pthread_attr_setscope( &attr, PTHREAD_SCOPE_SYSTEM ), paInternalError );
-            PA_UNLESS( !pthread_attr_setschedpolicy( &attr, SCHED_FIFO ), paInternalError );
-            PA_UNLESS( !pthread_attr_setschedparam( &attr, &wdSpm ), paInternalError );
-            if( (err = pthread_create( &self->watchdogThread, &attr, &WatchdogFunc, self )) )
-            {
-                PA_UNLESS( err == EPERM, paInternalError );
-                /* Permission error, go on without realtime privileges */
-                PA_DEBUG(( "Failed bumping priority\n" ));
-            }
-            else
-            {
-                int policy;
-                self->watchdogRunning = 1;
-                PA_ENSURE_SYSTEM( pthread_getschedparam( self->watchdogThread, &policy, &wdSpm ), 0 );
-                /* Check if priority is right, policy could potentially differ from SCHED_FIFO (but that's alright) */
-                if( wdSpm.sched_priority != prio )
-                {
-                    PA_DEBUG(( "Watchdog priority not set correctly (%d)\n", wdSpm.sched_priority ));
-                    PA_ENSURE( paInternalError );
-                }
-            }
-        }
-        else
-#endif
-            PA_ENSURE( BoostPriority( self ) );
-
-        {
-            int policy;
-            struct sched_param spm;
-            pthread_getschedparam(self->thread, &policy, &spm);
-        }
-    }
-    
+wait:
     if( self->parentWaiting )
     {
         PaTime till;
@@ -429,6 +1606,44 @@ PaError PaUnixThread_Terminate( PaUnixThread* self, int wait, PaError* exitResul
     /* Only kill the thread if it isn't in the process of stopping (flushing adaptation buffers) */
     /* TODO: Make join time out */
     self->stopRequested = wait;
+    if( self->pooled )
+    {
+        PaUnixPooledThread *pooled = self->pooled;
+        PaUnixPooledThreadState state;
+
+        PA_ASSERT_CALL( pthread_mutex_lock( &pooled->mtx ), 0 );
+        if( !wait && pooled->state == paUnixPooledThreadRunning )
+        {
+            PA_DEBUG(( "%s: Canceling pooled thread %d\n", __FUNCTION__, self->thread ));
+            pooled->state = paUnixPooledThreadCanceling;
+            pthread_cancel( pooled->thread );
+        }
+        while( pooled->state == paUnixPooledThreadRunning || pooled->state == paUnixPooledThreadCanceling )
+            PA_ASSERT_CALL( pthread_cond_wait( &pooled->cond, &pooled->mtx ), 0 );
+        state = pooled->state;
+        pret = pooled->jobResult;
+        pooled->job = NULL;
+        pooled->jobResult = NULL;
+        if( state == paUnixPooledThreadDone )
+            pooled->state = paUnixPooledThreadIdle;
+        PA_ASSERT_CALL( pthread_mutex_unlock( &pooled->mtx ), 0 );
+        self->pooled = NULL;
+
+        if( state == paUnixPooledThreadDone )
+        {
+            ReleasePooledThread( pooled );
+        }
+        else
+        {
+            /* the thread ends, and with pthread_exit() it passed its result on to pthread_join() */
+            void *exitResult;
+            PA_ENSURE_SYSTEM( pthread_join( pooled->thread, &exitResult ), 0 );
+            if( state == paUnixPooledThreadExited )
+                pret = exitResult;
+            DestroyPooledThread( pooled );
+        }
+        goto result;
+    }
     if( !wait )
     {
         PA_DEBUG(( "%s: Canceling thread %d\n", __FUNCTION__, self->thread ));
@@ -440,6 +1655,7 @@ PaError PaUnixThread_Terminate( PaUnixThread* self, int wait, PaError* exitResul
     PA_DEBUG(( "%s: Joining thread %d\n", __FUNCTION__, self->thread ));
     PA_ENSURE_SYSTEM( pthread_join( self->thread, &pret ), 0 );
 
+result:
 #ifdef PTHREAD_CANCELED
     if( pret && PTHREAD_CANCELED != pret )
 #else
@@ -497,10 +1713,32 @@ int PaUnixThread_StopRequested( PaUnixThread* self )
     return self->stopRequested;
 }
 
+int PaUnix_InitializeMutex( pthread_mutex_t *mtx )
+{
+#if defined(_POSIX_THREAD_PRIO_INHERIT) && (_POSIX_THREAD_PRIO_INHERIT > 0)
+    pthread_mutexattr_t attr;
+    int err;
+
+    if( pthread_mutexattr_init( &attr ) == 0 )
+    {
+        /* a holder is raised to the priority of the highest waiter while it holds the mutex */
+        if( pthread_mutexattr_setprotocol( &attr, PTHREAD_PRIO_INHERIT ) == 0 )
+        {
+            err = pthread_mutex_init( mtx, &attr );
+            pthread_mutexattr_destroy( &attr );
+            return err;
+        }
+        pthread_mutexattr_destroy( &attr );
+    }
+    PA_DEBUG(( "%s: Priority inheritance is not supported\n", __FUNCTION__ ));
+#endif
+    return pthread_mutex_init( mtx, NULL );
+}
+
 PaError PaUnixMutex_Initialize( PaUnixMutex* self )
 {
     PaError result = paNoError;
-    PA_ASSERT_CALL( pthread_mutex_init( &self->mtx, NULL ), 0 );
+    PA_ASSERT_CALL( PaUnix_InitializeMutex( &self->mtx ), 0 );
     return result;
 }
 
@@ -549,6 +1787,330 @@ error:
 }
 
 
+/* PaUtilWorkerPool */
+
+/* How often a waiting thread checks for its event before it sleeps, some microseconds */
+#define PA_WORKER_POOL_SPIN_COUNT_ (2000)
+
+typedef struct
+{
+    struct PaUtilWorkerPool *pool;
+    int index;
+    PaUnixThread thread;
+}
+PaUtilPoolWorker;
+
+struct PaUtilWorkerPool
+{
+    int workerCount;
+    int spinCount;                      /* 0 on a single CPU, where the other side can't run meanwhile */
+    PaUtilPoolWorker *workers;          /* workerCount - 1 threads */
+    int threadCount;                    /* of workers that were started */
+
+    PaUtilWorkerPoolJob *job;
+    void *jobData;
+
+    volatile int generation;            /* Advanced to hand out a job, or to quit */
+    volatile int pending;               /* Workers yet to finish the job */
+    volatile int quit;
+    volatile int sleepingWorkers;       /* Threads sleeping for generation to advance */
+    volatile int sleepingCaller;        /* Threads sleeping for pending to drop */
+#ifndef PA_HAVE_FUTEX_
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+#endif
+};
+
+static void CpuRelax( void )
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "pause" );
+#elif defined(__aarch64__)
+    __asm__ __volatile__( "yield" );
+#endif
+}
+
+/* Wait while *word is value, spinning first. *sleepers counts the threads that went to sleep */
+static void WaitWhileEqual( PaUtilWorkerPool *self, volatile int *word, int value, volatile int *sleepers )
+{
+    int i;
+
+    for( i = 0; i < self->spinCount; ++i )
+    {
+        if( *word != value )
+            return;
+        CpuRelax();
+    }
+
+    /* Full barrier: either the thread changing *word sees us sleeping, or we see the change */
+    __sync_fetch_and_add( sleepers, 1 );
+#ifdef PA_HAVE_FUTEX_
+    while( *word == value )
+        syscall( SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0 );
+#else
+    pthread_mutex_lock( &self->mtx );
+    while( *word == value )
+        pthread_cond_wait( &self->cond, &self->mtx );
+    pthread_mutex_unlock( &self->mtx );
+#endif
+    __sync_fetch_and_sub( sleepers, 1 );
+}
+
+/* Wake the threads waiting for *word to change, which it just did with a full barrier */
+static void WakeAll( PaUtilWorkerPool *self, volatile int *word, volatile int *sleepers )
+{
+    if( *sleepers == 0 )
+        return;
+
+#ifdef PA_HAVE_FUTEX_
+    (void)self; /* unused parameter */
+    syscall( SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0 );
+#else
+    (void)word; /* unused parameter */
+    pthread_mutex_lock( &self->mtx );
+    pthread_cond_broadcast( &self->cond );
+    pthread_mutex_unlock( &self->mtx );
+#endif
+}
+
+static void *WorkerThreadFunc( void *userData )
+{
+    PaUtilPoolWorker *worker = (PaUtilPoolWorker*)userData;
+    PaUtilWorkerPool *pool = worker->pool;
+    int generation = 0;
+
+    while( 1 )
+    {
+        WaitWhileEqual( pool, &pool->generation, generation, &pool->sleepingWorkers );
+        generation = pool->generation;
+        PaUtil_FullMemoryBarrier();
+        if( pool->quit )
+            break;
+
+        pool->job( pool->jobData, worker->index, pool->workerCount );
+
+        if( __sync_sub_and_fetch( &pool->pending, 1 ) == 0 )
+            WakeAll( pool, &pool->pending, &pool->sleepingCaller );
+    }
+
+    return NULL;
+}
+
+PaError PaUtil_CreateWorkerPool( PaUtilWorkerPool **pool, int workerCount,
+        int realTime, const int *cpus, int cpuCount )
+{
+    PaError result = paNoError;
+    PaUtilWorkerPool *self = NULL;
+    PaUnixThreadScheduling scheduling;
+    int i;
+
+    PA_UNLESS( workerCount > 0, paInternalError );
+    PA_UNLESS( self = (PaUtilWorkerPool*)PaUtil_AllocateMemory( sizeof (PaUtilWorkerPool) ), paInsufficientMemory );
+    memset( self, 0, sizeof (PaUtilWorkerPool) );
+    self->workerCount = workerCount;
+    self->spinCount = sysconf( _SC_NPROCESSORS_ONLN ) > 1 ? PA_WORKER_POOL_SPIN_COUNT_ : 0;
+#ifndef PA_HAVE_FUTEX_
+    PA_ASSERT_CALL( PaUnix_InitializeMutex( &self->mtx ), 0 );
+    PA_ASSERT_CALL( pthread_cond_init( &self->cond, NULL ), 0 );
+#endif
+
+    if( workerCount > 1 )
+    {
+        PA_UNLESS( self->workers = (PaUtilPoolWorker*)PaUtil_AllocateMemory(
+                    (workerCount - 1) * sizeof (PaUtilPoolWorker) ), paInsufficientMemory );
+    }
+
+    /* The workers run whenever the thread handing out the jobs does, they have no period of their own */
+    scheduling.realTime = realTime;
+    scheduling.period = 0.;
+    scheduling.runtime = 0.;
+    scheduling.runawayProtection = 0;
+    for( i = 0; i < workerCount - 1; ++i )
+    {
+        self->workers[i].pool = self;
+        self->workers[i].index = i + 1;
+        PA_ENSURE( PaUnixThread_New( &self->workers[i].thread, &WorkerThreadFunc, &self->workers[i], 0.,
+                    &scheduling, cpus, cpuCount ) );
+        ++self->threadCount;
+    }
+
+    *pool = self;
+
+end:
+    return result;
+error:
+    if( self )
+        PaUtil_DestroyWorkerPool( self );
+    goto end;
+}
+
+void PaUtil_DestroyWorkerPool( PaUtilWorkerPool *self )
+{
+    int i;
+
+    self->quit = 1;
+    __sync_fetch_and_add( &self->generation, 1 );
+    WakeAll( self, &self->generation, &self->sleepingWorkers );
+
+    for( i = 0; i < self->threadCount; ++i )
+        PaUnixThread_Terminate( &self->workers[i].thread, 1, NULL );
+
+#ifndef PA_HAVE_FUTEX_
+    PA_ASSERT_CALL( pthread_cond_destroy( &self->cond ), 0 );
+    PA_ASSERT_CALL( pthread_mutex_destroy( &self->mtx ), 0 );
+#endif
+    if( self->workers )
+        PaUtil_FreeMemory( self->workers );
+    PaUtil_FreeMemory( self );
+}
+
+int PaUtil_GetWorkerPoolSize( const PaUtilWorkerPool *self )
+{
+    return self->workerCount;
+}
+
+void PaUtil_RunWorkerPool( PaUtilWorkerPool *self, PaUtilWorkerPoolJob *job, void *userData )
+{
+    int pending;
+
+    self->job = job;
+    self->jobData = userData;
+    self->pending = self->workerCount - 1;
+    __sync_fetch_and_add( &self->generation, 1 );
+    WakeAll( self, &self->generation, &self->sleepingWorkers );
+
+    job( userData, 0, self->workerCount );
+
+    while( ( pending = self->pending ) != 0 )
+        WaitWhileEqual( self, &self->pending, pending, &self->sleepingCaller );
+    PaUtil_FullMemoryBarrier();
+}
+
+/* Mac OS X doesn't implement unnamed POSIX semaphores, sem_init() fails there */
+struct PaUtilSemaphore
+{
+#ifdef __APPLE__
+    semaphore_t sem;
+#else
+    sem_t sem;
+#endif
+};
+
+PaError PaUtil_CreateSemaphore( PaUtilSemaphore **semaphore )
+{
+    PaError result = paNoError;
+    PaUtilSemaphore *self = NULL;
+
+    PA_UNLESS( self = (PaUtilSemaphore*)PaUtil_AllocateMemory( sizeof (PaUtilSemaphore) ), paInsufficientMemory );
+#ifdef __APPLE__
+    PA_UNLESS( semaphore_create( mach_task_self(), &self->sem, SYNC_POLICY_FIFO, 0 ) == KERN_SUCCESS,
+            paInsufficientMemory );
+#else
+    PA_UNLESS( sem_init( &self->sem, 0, 0 ) == 0, paInsufficientMemory );
+#endif
+
+    *semaphore = self;
+
+end:
+    return result;
+error:
+    if( self )
+        PaUtil_FreeMemory( self );
+    goto end;
+}
+
+void PaUtil_DestroySemaphore( PaUtilSemaphore *self )
+{
+#ifdef __APPLE__
+    semaphore_destroy( mach_task_self(), self->sem );
+#else
+    PA_ASSERT_CALL( sem_destroy( &self->sem ), 0 );
+#endif
+    PaUtil_FreeMemory( self );
+}
+
+void PaUtil_PostSemaphore( PaUtilSemaphore *self )
+{
+#ifdef __APPLE__
+    semaphore_signal( self->sem );
+#else
+    sem_post( &self->sem );
+#endif
+}
+
+PaError PaUtil_WaitSemaphore( PaUtilSemaphore *self, double timeoutSeconds )
+{
+#ifdef __APPLE__
+    mach_timespec_t timeout;
+    kern_return_t err;
+
+    timeout.tv_sec = (unsigned int)timeoutSeconds;
+    timeout.tv_nsec = (clock_res_t)( ( timeoutSeconds - timeout.tv_sec ) * 1e9 );
+    err = semaphore_timedwait( self->sem, timeout );
+    return err == KERN_SUCCESS || err == KERN_ABORTED ? paNoError : paTimedOut;
+#else
+    struct timespec deadline;
+    int res;
+
+    /* sem_timedwait() takes an absolute CLOCK_REALTIME deadline */
+    clock_gettime( CLOCK_REALTIME, &deadline );
+    deadline.tv_sec += (time_t)timeoutSeconds;
+    deadline.tv_nsec += (long)( ( timeoutSeconds - (time_t)timeoutSeconds ) * 1e9 );
+    if( deadline.tv_nsec >= 1000000000 )
+    {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while( ( res = sem_timedwait( &self->sem, &deadline ) ) != 0 && errno == EINTR )
+        ;
+    return res == 0 ? paNoError : paTimedOut;
+#endif
+}
+
+/* PaUtil_StartDetachedThread */
+
+typedef struct
+{
+    PaUtilDetachedThreadFunction *function;
+    void *userData;
+}
+PaUtilDetachedThread;
+
+static void *DetachedThreadFunc( void *arg )
+{
+    PaUtilDetachedThread thread = *(PaUtilDetachedThread*)arg;
+    PaUtil_FreeMemory( arg );
+    thread.function( thread.userData );
+    return NULL;
+}
+
+PaError PaUtil_StartDetachedThread( PaUtilDetachedThreadFunction *function, void *userData )
+{
+    PaError result = paNoError;
+    PaUtilDetachedThread *thread = NULL;
+    pthread_attr_t attr;
+    pthread_t tid;
+    int attrInitialized = 0;
+
+    PA_UNLESS( thread = (PaUtilDetachedThread*)PaUtil_AllocateMemory( sizeof (PaUtilDetachedThread) ), paInsufficientMemory );
+    thread->function = function;
+    thread->userData = userData;
+
+    PA_ENSURE_SYSTEM( pthread_attr_init( &attr ), 0 );
+    attrInitialized = 1;
+    PA_ENSURE_SYSTEM( pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED ), 0 );
+    PA_ENSURE_SYSTEM( pthread_create( &tid, &attr, DetachedThreadFunc, thread ), 0 );
+    pthread_attr_destroy( &attr );
+    return result;
+
+error:
+    if( attrInitialized )
+        pthread_attr_destroy( &attr );
+    if( thread )
+        PaUtil_FreeMemory( thread );
+    return result;
+}
+
 #if 0
 static void OnWatchdogExit( void *userData )
 {
@@ -139,33 +139,73 @@ typedef struct
     pthread_mutex_t mtx;
 } PaUnixMutex;
 
+/** Initialize a mutex with priority inheritance where the system supports
+ it (PTHREAD_PRIO_INHERIT), else a default one. Mutexes that real-time
+ threads wait for are initialized this way, so a real-time thread is never
+ kept waiting by a holder which is preempted by threads of a lower priority
+ than its own. PaUnixMutex_Initialize() uses it too.
+
+ @return 0 on success, else the error of pthread_mutex_init().
+*/
+int PaUnix_InitializeMutex( pthread_mutex_t *mtx );
+
 PaError PaUnixMutex_Initialize( PaUnixMutex* self );
 PaError PaUnixMutex_Terminate( PaUnixMutex* self );
 PaError PaUnixMutex_Lock( PaUnixMutex* self );
 PaError PaUnixMutex_Unlock( PaUnixMutex* self );
 
+/** How PaUnixThread_New() schedules a thread. */
+typedef struct
+{
+    int realTime;       /**< Nonzero to ask for real-time scheduling, else the thread inherits its scheduling */
+    PaTime period;      /**< The interval the thread does its work in, 0 if it has none. Enables SCHED_DEADLINE */
+    PaTime runtime;     /**< The CPU time the thread is granted each period under SCHED_DEADLINE */
+    int runawayProtection;  /**< Nonzero to demote a SCHED_FIFO or SCHED_RR thread to SCHED_OTHER once it runs for
+                                 PA_UNIX_RUNAWAY_RTTIME seconds without blocking, see PaUnixThread_New() */
+} PaUnixThreadScheduling;
+
+/** The CPU time a real-time thread with runaway protection may take without blocking. A callback thread blocks once
+ per period, so only a thread stuck in a loop gets there.
+*/
+#define PA_UNIX_RUNAWAY_RTTIME (0.1)
+
 typedef struct
 {
     pthread_t thread;
+    void* (*threadFunc)( void* );
+    void* threadArg;
+    PaUnixThreadScheduling scheduling;
+    int schedulingPolicy;   /* SCHED_DEADLINE, SCHED_FIFO, SCHED_RR (rtkit) or SCHED_OTHER, once the thread runs */
     int parentWaiting;
     int stopRequested;
     int locked;
     PaUnixMutex mtx;
     pthread_cond_t cond;
     volatile sig_atomic_t stopRequest;
+    struct PaUnixPooledThread *pooled;  /* the pool's thread running threadFunc, NULL for a thread of its own */
 } PaUnixThread;
 
 /** Initialize global threading state.
+ *
+ * Each call is matched by PaUnixThreading_Terminate(). While any host API has threading initialized,
+ * PaUnixThread_New() runs thread functions on a pool of threads which are kept after the functions return, so
+ * starting a stream doesn't wait for a thread to be created and scheduled. The first call starts
+ * PA_UNIX_THREAD_POOL (environment variable, 1 by default) real-time threads ahead of use, and as many idle threads
+ * of each kind are kept. PA_UNIX_THREAD_POOL=0 disables the pool.
  */
 PaError PaUnixThreading_Initialize();
 
+/** Terminate global threading state, stopping the idle threads of the pool with the last call.
+ */
+void PaUnixThreading_Terminate( void );
+
 /** Perish, passing on eventual error code.
  *
- * A thin wrapper around pthread_exit, will automatically pass on any error code to the joining thread.
- * If the result indicates an error, i.e. it is not equal to paNoError, this function will automatically
- * allocate a pointer so the error is passed on with pthread_exit. If the result indicates that all is
- * well however, only a NULL pointer will be handed to pthread_exit. Thus, the joining thread should
- * check whether a non-NULL result pointer is obtained from pthread_join and make sure to free it.
+ * Returns from the thread function, so it is to be used in the thread function itself once every
+ * pthread_cleanup_push() is matched, and passes on any error code to PaUnixThread_Terminate(). If the result
+ * indicates an error, i.e. it is not equal to paNoError, this function will automatically allocate a pointer so the
+ * error is passed on. If the result indicates that all is well however, only a NULL pointer is returned. A thread
+ * of the pool survives the thread function returning, while one which calls pthread_exit() is replaced.
  * @param result: The error code to pass on to the joining thread.
  */
 #define PaUnixThreading_EXIT(result) \
@@ -176,7 +216,7 @@ PaError PaUnixThreading_Initialize();
             pres = malloc( sizeof (PaError) ); \
             *pres = (result); \
         } \
-        pthread_exit( pres ); \
+        return pres; \
     } while (0);
 
 /** Spawn a thread.
@@ -187,11 +227,26 @@ PaError PaUnixThreading_Initialize();
  * @param threadFunc: The function to be executed in the child thread.
  * @param waitForChild: If not 0, wait for child thread to call PaUnixThread_NotifyParent. Less than 0 means
  * wait for ever, greater than 0 wait for the specified time.
- * @param rtSched: Enable realtime scheduling?
+ * @param scheduling: NULL or how to schedule the thread. Real-time scheduling is tried as SCHED_DEADLINE if a
+ * period is given, then as SCHED_FIFO, then through rtkit for unprivileged processes if PortAudio is built with
+ * PA_USE_RTKIT. The thread runs with the default scheduling if all of them fail. A SCHED_FIFO or SCHED_RR thread with
+ * runawayProtection is watched by the kernel instead of a watchdog thread: while such threads run, the soft
+ * RLIMIT_RTTIME of the process is at most PA_UNIX_RUNAWAY_RTTIME, and the handler of the SIGXCPU sent to a thread
+ * exceeding it demotes the thread to SCHED_OTHER. SCHED_DEADLINE threads are throttled by the kernel anyway.
+ * @param cpus: The indices of the CPUs the thread may run on, ignored where CPU affinity is unsupported.
+ * @param cpuCount: The number of cpus, 0 to let the thread run on any CPU the process may use.
+ * Threads without cpus or a period are taken from the pool, see PaUnixThreading_Initialize(), those which need a
+ * real-time one from its threads which have been scheduled already.
  * @return: If timed out waiting on child, paTimedOut.
  */
 PaError PaUnixThread_New( PaUnixThread* self, void* (*threadFunc)( void* ), void* threadArg, PaTime waitForChild,
-        int rtSched );
+        const PaUnixThreadScheduling *scheduling, const int *cpus, int cpuCount );
+
+/** The index of the CPU the calling thread runs on, -1 where this is unknown.
+ *
+ * Cheap enough to be called from the callback thread.
+ */
+int PaUnixThread_GetCurrentCpu( void );
 
 /** Terminate thread.
  *
@@ -218,6 +273,18 @@ PaError PaUnixThread_NotifyParent( PaUnixThread* self );
  */
 int PaUnixThread_StopRequested( PaUnixThread* self );
 
+/** Map size bytes of the file fd from offset twice, the second mapping directly following the first, like
+ * PaUtil_AllocateMirroredMemory() does with memory of its own. The mappings are shared, so other processes which map
+ * the file see the same frames. offset and size must be multiples of the page size.
+ *
+ * @return: The first mapping, or NULL.
+ */
+void *PaUnix_MapMirroredFile( int fd, long offset, long size );
+
+/** Unmap both mappings of PaUnix_MapMirroredFile(). buffer may be NULL.
+ */
+void PaUnix_UnmapMirroredFile( void *buffer, long size );
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -100,3 +100,35 @@ PaUtilHostApiInitializer *paHostApiInitializers[] =
     };
 
 
+/* Keep in the order of paHostApiInitializers */
+const PaHostApiTypeId paHostApiInitializerTypes[] =
+    {
+
+#if PA_USE_WMME
+        paMME,
+#endif
+
+#if PA_USE_DS
+        paDirectSound,
+#endif
+
+#if PA_USE_ASIO
+        paASIO,
+#endif
+
+#if PA_USE_WASAPI
+        paWASAPI,
+#endif
+
+#if PA_USE_WDMKS
+        paWDMKS,
+#endif
+
+#if PA_USE_SKELETON
+        paInDevelopment,
+#endif
+
+        paInDevelopment   /* matches the terminating NULL */
+    };
+
+
@@ -54,7 +54,13 @@
 	#endif
 #endif
 
+#include <stdlib.h> /* getenv() */
+#include <string.h> /* strcmp(), memset() */
+
 #include "pa_util.h"
+#include "pa_win_util.h"
+#include "pa_probes.h"
+#include "pa_debugprint.h"
 
 /*
    Track memory allocations to avoid leaks.
@@ -67,7 +73,13 @@ static int numAllocations_ = 0;
 
 void *PaUtil_AllocateMemory( long size )
 {
-    void *result = GlobalAlloc( GPTR, size );
+    int handled;
+    void *result = PaUtil_AllocateStreamArenaMemory( size, &handled );
+
+    if( handled )
+        return result;
+
+    result = GlobalAlloc( GPTR, size );
 
 #if PA_TRACK_MEMORY
     if( result != NULL ) numAllocations_ += 1;
@@ -78,7 +90,7 @@ void *PaUtil_AllocateMemory( long size )
 
 void PaUtil_FreeMemory( void *block )
 {
-    if( block != NULL )
+    if( block != NULL && !PaUtil_IsStreamArenaMemory( block ) )
     {
         GlobalFree( block );
 #if PA_TRACK_MEMORY
@@ -89,6 +101,124 @@ void PaUtil_FreeMemory( void *block )
 }
 
 
+int PaUtil_LockMemory( void *buffer, long size )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+    return 0;
+#else
+    /* limited by the working set size of the process */
+    return VirtualLock( buffer, size ) ? 1 : 0;
+#endif
+}
+
+
+void PaUtil_UnlockMemory( void *buffer, long size )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+#else
+    VirtualUnlock( buffer, size );
+#endif
+}
+
+
+/* Committed memory can't be moved between nodes on Windows, it stays on the
+ node of the thread which first touched it. */
+int PaUtil_PlaceMemory( void *buffer, long size, const int *cpus, int cpuCount )
+{
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+    (void)cpus; /* unused parameter */
+    (void)cpuCount; /* unused parameter */
+    return 0;
+}
+
+
+/* Large pages need the SeLockMemoryPrivilege and VirtualAlloc(MEM_LARGE_PAGES),
+ there are no transparent ones. */
+long PaUtil_GetHugePageSize( void )
+{
+    return 0;
+}
+
+
+int PaUtil_AdviseHugePages( void *buffer, long size )
+{
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+    return 0;
+}
+
+
+void *PaUtil_AllocateMirroredMemory( long *size )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)size; /* unused parameter */
+    return NULL;
+#else
+    SYSTEM_INFO systemInfo;
+    HANDLE mapping;
+    void *result = NULL;
+    int attempt;
+
+    /* views must start on the allocation granularity */
+    GetSystemInfo( &systemInfo );
+    *size = (*size + (long)systemInfo.dwAllocationGranularity - 1)
+            / (long)systemInfo.dwAllocationGranularity * (long)systemInfo.dwAllocationGranularity;
+
+    mapping = CreateFileMapping( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, (DWORD)*size, NULL );
+    if( mapping == NULL )
+        return NULL;
+
+    /* Find a free range for both views, release it and map the views into
+       it. Another thread may take the range in between, so retry a few times. */
+    for( attempt = 0; attempt < 16 && result == NULL; ++attempt )
+    {
+        char *region = (char *)VirtualAlloc( NULL, 2 * *size, MEM_RESERVE, PAGE_NOACCESS );
+        if( region == NULL )
+            break;
+        VirtualFree( region, 0, MEM_RELEASE );
+
+        if( MapViewOfFileEx( mapping, FILE_MAP_ALL_ACCESS, 0, 0, *size, region ) == region )
+        {
+            if( MapViewOfFileEx( mapping, FILE_MAP_ALL_ACCESS, 0, 0, *size, region + *size ) == region + *size )
+                result = region;
+            else
+                UnmapViewOfFile( region );
+        }
+    }
+
+    CloseHandle( mapping ); /* the views keep the mapping alive */
+
+#if PA_TRACK_MEMORY
+    if( result != NULL ) numAllocations_ += 1;
+#endif
+    return result;
+#endif
+}
+
+
+void PaUtil_FreeMirroredMemory( void *buffer, long size )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)buffer; /* unused parameter */
+    (void)size; /* unused parameter */
+#else
+    if( buffer != NULL )
+    {
+        UnmapViewOfFile( (char *)buffer + size );
+        UnmapViewOfFile( buffer );
+#if PA_TRACK_MEMORY
+        numAllocations_ -= 1;
+#endif
+    }
+#endif
+}
+
+
 int PaUtil_CountCurrentlyAllocatedBlocks( void )
 {
 #if PA_TRACK_MEMORY
@@ -101,10 +231,12 @@ int PaUtil_CountCurrentlyAllocatedBlocks( void )
 
 void Pa_Sleep( long msec )
 {
-    Sleep( msec );
+    /* Sleep() rounds up to the system timer tick, 15.6 ms by default */
+    PaWinUtil_Sleep( msec * .001 );
 }
 
 static int usePerformanceCounter_;
+static LONGLONG ticksPerSecond_;
 static double secondsPerTick_;
 
 void PaUtil_InitializeClock( void )
@@ -114,6 +246,7 @@ void PaUtil_InitializeClock( void )
     if( QueryPerformanceFrequency( &ticksPerSecond ) != 0 )
     {
         usePerformanceCounter_ = 1;
+        ticksPerSecond_ = ticksPerSecond.QuadPart;
         secondsPerTick_ = 1.0 / (double)ticksPerSecond.QuadPart;
     }
     else
@@ -143,7 +276,11 @@ double PaUtil_GetTime( void )
             For now we just use QueryPerformanceCounter(). It's good, most of the time.
         */
         QueryPerformanceCounter( &time );
-        return time.QuadPart * secondsPerTick_;
+
+        /* whole seconds apart from the fraction, so that the rounding of
+           secondsPerTick_ doesn't grow with the uptime of the system */
+        return (double)( time.QuadPart / ticksPerSecond_ )
+                + (double)( time.QuadPart % ticksPerSecond_ ) * secondsPerTick_;
     }
     else
     {
@@ -158,3 +295,587 @@ double PaUtil_GetTime( void )
 #endif                
     }
 }
+
+
+double PaUtil_GetThreadCpuTime( void )
+{
+    /* QueryThreadCycleTime() is more precise but counts cycles at no
+       documented rate, the times are in units of 100 ns */
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+
+    if( !GetThreadTimes( GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime ) )
+        return -1.;
+    return ( ( (double)kernelTime.dwHighDateTime + userTime.dwHighDateTime ) * 4294967296.
+            + (double)kernelTime.dwLowDateTime + userTime.dwLowDateTime ) * 1e-7;
+}
+
+
+PaUtilClockSource PaUtil_SelectClockSource( PaUtilClockSource source )
+{
+    /* QueryPerformanceCounter() already reads an invariant time stamp counter
+       without entering the kernel where the hardware allows it. */
+    (void)source; /* unused parameter */
+    return paUtilSystemClock;
+}
+
+
+/* Worker pools aren't implemented on Windows yet, buffer processors then
+   convert all channels on the callback thread. */
+
+PaError PaUtil_CreateWorkerPool( PaUtilWorkerPool **pool, int workerCount,
+        int realTime, const int *cpus, int cpuCount )
+{
+    (void)workerCount; /* unused parameter */
+    (void)realTime; /* unused parameter */
+    (void)cpus; /* unused parameter */
+    (void)cpuCount; /* unused parameter */
+    *pool = NULL;
+    return paInternalError;
+}
+
+
+void PaUtil_DestroyWorkerPool( PaUtilWorkerPool *pool )
+{
+    (void)pool; /* unused parameter */
+}
+
+
+int PaUtil_GetWorkerPoolSize( const PaUtilWorkerPool *pool )
+{
+    (void)pool; /* unused parameter */
+    return 1;
+}
+
+
+void PaUtil_RunWorkerPool( PaUtilWorkerPool *pool, PaUtilWorkerPoolJob *job, void *userData )
+{
+    (void)pool; /* unused parameter */
+    job( userData, 0, 1 );
+}
+
+
+/* The handle is the semaphore, PaUtilSemaphore is never defined. */
+
+PaError PaUtil_CreateSemaphore( PaUtilSemaphore **semaphore )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    HANDLE handle = CreateSemaphoreExW( NULL, 0, 0x7FFFFFFF, NULL, 0, SEMAPHORE_ALL_ACCESS );
+#else
+    HANDLE handle = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL );
+#endif
+    if( handle == NULL )
+        return paInsufficientMemory;
+    *semaphore = (PaUtilSemaphore*)handle;
+    return paNoError;
+}
+
+
+void PaUtil_DestroySemaphore( PaUtilSemaphore *semaphore )
+{
+    CloseHandle( (HANDLE)semaphore );
+}
+
+
+void PaUtil_PostSemaphore( PaUtilSemaphore *semaphore )
+{
+    ReleaseSemaphore( (HANDLE)semaphore, 1, NULL );
+}
+
+
+PaError PaUtil_WaitSemaphore( PaUtilSemaphore *semaphore, double timeoutSeconds )
+{
+    DWORD result = WaitForSingleObjectEx( (HANDLE)semaphore, (DWORD)( timeoutSeconds * 1000. ), FALSE );
+    return result == WAIT_OBJECT_0 ? paNoError : paTimedOut;
+}
+
+
+/* PaUtil_StartDetachedThread */
+
+typedef struct
+{
+    PaUtilDetachedThreadFunction *function;
+    void *userData;
+}
+PaUtilDetachedThread;
+
+static DWORD WINAPI DetachedThreadFunc( LPVOID arg )
+{
+    PaUtilDetachedThread thread = *(PaUtilDetachedThread*)arg;
+    PaUtil_FreeMemory( arg );
+    thread.function( thread.userData );
+    return 0;
+}
+
+PaError PaUtil_StartDetachedThread( PaUtilDetachedThreadFunction *function, void *userData )
+{
+    PaUtilDetachedThread *thread;
+    HANDLE handle;
+
+    thread = (PaUtilDetachedThread*)PaUtil_AllocateMemory( sizeof (PaUtilDetachedThread) );
+    if( thread == NULL )
+        return paInsufficientMemory;
+    thread->function = function;
+    thread->userData = userData;
+
+    handle = CreateThread( NULL, 0, DetachedThreadFunc, thread, 0, NULL );
+    if( handle == NULL )
+    {
+        PaUtil_FreeMemory( thread );
+        return paInsufficientMemory;
+    }
+    CloseHandle( handle ); /* the thread keeps running */
+    return paNoError;
+}
+
+
+/* MMCSS registration, AvSetMmThreadCharacteristics() and friends are
+   looked up at run time as avrt.dll isn't there before Vista */
+
+#if !(defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP))
+
+typedef HANDLE (WINAPI *PaWinUtilAvSetMmThreadCharacteristics)( LPCSTR, LPDWORD );
+typedef BOOL (WINAPI *PaWinUtilAvRevertMmThreadCharacteristics)( HANDLE );
+typedef BOOL (WINAPI *PaWinUtilAvSetMmThreadPriority)( HANDLE, int );
+
+static PaWinUtilAvSetMmThreadCharacteristics avSetMmThreadCharacteristics_;
+static PaWinUtilAvRevertMmThreadCharacteristics avRevertMmThreadCharacteristics_;
+static PaWinUtilAvSetMmThreadPriority avSetMmThreadPriority_;
+static volatile LONG avrtLoaded_;
+
+static void LoadAvrt( void )
+{
+    HMODULE avrt;
+
+    if( avrtLoaded_ )
+        return;
+
+    /* threads racing here look up the same addresses, the library stays
+       loaded for the life of the process */
+    avrt = LoadLibraryA( "avrt.dll" );
+    if( avrt != NULL )
+    {
+        avSetMmThreadCharacteristics_ = (PaWinUtilAvSetMmThreadCharacteristics)
+                GetProcAddress( avrt, "AvSetMmThreadCharacteristicsA" );
+        avRevertMmThreadCharacteristics_ = (PaWinUtilAvRevertMmThreadCharacteristics)
+                GetProcAddress( avrt, "AvRevertMmThreadCharacteristics" );
+        avSetMmThreadPriority_ = (PaWinUtilAvSetMmThreadPriority)
+                GetProcAddress( avrt, "AvSetMmThreadPriority" );
+        if( !avSetMmThreadCharacteristics_ || !avRevertMmThreadCharacteristics_ || !avSetMmThreadPriority_ )
+            avSetMmThreadCharacteristics_ = NULL;
+    }
+
+    InterlockedExchange( (LONG*)&avrtLoaded_, 1 ); /* a full barrier */
+}
+
+
+static PaWinUtilMmcssPriority DefaultMmcssPriority( void )
+{
+    static const char *names[] = { "low", "normal", "high", "critical" };
+    const char *priority = getenv( "PA_MMCSS_PRIORITY" );
+    int i;
+
+    if( priority != NULL )
+    {
+        for( i = 0; i < 4; ++i )
+        {
+            if( strcmp( priority, names[i] ) == 0 )
+                return (PaWinUtilMmcssPriority)( paWinUtilMmcssLowPriority + i );
+        }
+        PA_DEBUG(( "PaWinUtil_RegisterMmcssThread: unknown PA_MMCSS_PRIORITY %s\n", priority ));
+    }
+
+    return paWinUtilMmcssCriticalPriority;
+}
+
+#endif /* !WINAPI_FAMILY_APP */
+
+
+void *PaWinUtil_RegisterMmcssThread( const char *taskName, PaWinUtilMmcssPriority priority )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)taskName; /* unused parameter */
+    (void)priority; /* unused parameter */
+    return NULL;
+#else
+    HANDLE task;
+    DWORD taskIndex = 0;
+
+    LoadAvrt();
+    if( avSetMmThreadCharacteristics_ == NULL )
+        return NULL;
+
+    if( taskName == NULL )
+    {
+        taskName = getenv( "PA_MMCSS_TASK" );
+        if( taskName == NULL )
+            taskName = "Pro Audio";
+    }
+    if( priority == paWinUtilMmcssDefaultPriority )
+        priority = DefaultMmcssPriority();
+
+    task = avSetMmThreadCharacteristics_( taskName, &taskIndex );
+    if( task == NULL || task == INVALID_HANDLE_VALUE )
+    {
+        /* unknown task or MMCSS disabled */
+        PA_DEBUG(( "PaWinUtil_RegisterMmcssThread: AvSetMmThreadCharacteristics( \"%s\" ) failed with %lu\n",
+                taskName, (unsigned long)GetLastError() ));
+        return NULL;
+    }
+
+    if( !avSetMmThreadPriority_( task, (int)priority ) )
+    {
+        /* the thread keeps the task's normal priority */
+        PA_DEBUG(( "PaWinUtil_RegisterMmcssThread: AvSetMmThreadPriority( %d ) failed\n", (int)priority ));
+    }
+
+    return (void*)task;
+#endif
+}
+
+
+void PaWinUtil_RevertMmcssThread( void *task )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)task; /* unused parameter */
+#else
+    if( task == NULL )
+        return;
+
+    if( !avRevertMmThreadCharacteristics_( (HANDLE)task ) )
+    {
+        PA_DEBUG(( "PaWinUtil_RevertMmcssThread: AvRevertMmThreadCharacteristics failed\n" ));
+    }
+#endif
+}
+
+
+/* Processor groups and CPU sets, looked up at run time as they came with
+   Windows 7 and 10. The structures are declared here with the layout of
+   GROUP_AFFINITY and the head of SYSTEM_CPU_SET_INFORMATION, which older
+   SDKs lack. */
+
+#if !(defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP))
+
+typedef struct PaWinUtilGroupAffinity
+{
+    KAFFINITY mask;
+    WORD group;
+    WORD reserved[3];
+}
+PaWinUtilGroupAffinity;
+
+typedef struct PaWinUtilCpuSetInformation
+{
+    DWORD size;             /* of the entry, entries follow each other */
+    DWORD type;             /* CpuSetInformation (0) */
+    DWORD id;
+    WORD group;
+    BYTE logicalProcessorIndex;
+}
+PaWinUtilCpuSetInformation;
+
+typedef WORD (WINAPI *PaWinUtilGetActiveProcessorGroupCount)( void );
+typedef DWORD (WINAPI *PaWinUtilGetActiveProcessorCount)( WORD );
+typedef BOOL (WINAPI *PaWinUtilSetThreadGroupAffinity)( HANDLE, const PaWinUtilGroupAffinity*, PaWinUtilGroupAffinity* );
+typedef BOOL (WINAPI *PaWinUtilGetSystemCpuSetInformation)( PaWinUtilCpuSetInformation*, ULONG, PULONG, HANDLE, ULONG );
+typedef BOOL (WINAPI *PaWinUtilSetThreadSelectedCpuSets)( HANDLE, const ULONG*, ULONG );
+
+static FARPROC GetKernel32Function( const char *name )
+{
+    HMODULE kernel32 = GetModuleHandleA( "kernel32.dll" );
+    return kernel32 != NULL ? GetProcAddress( kernel32, name ) : NULL;
+}
+
+
+/* The group and the number within it of PortAudio's processor cpu, 0 if
+   there are no groups */
+static int GetCpuGroup( int cpu, WORD *group, BYTE *number )
+{
+    PaWinUtilGetActiveProcessorGroupCount getActiveProcessorGroupCount = (PaWinUtilGetActiveProcessorGroupCount)
+            GetKernel32Function( "GetActiveProcessorGroupCount" );
+    PaWinUtilGetActiveProcessorCount getActiveProcessorCount = (PaWinUtilGetActiveProcessorCount)
+            GetKernel32Function( "GetActiveProcessorCount" );
+    WORD groupCount, g;
+    DWORD count;
+
+    if( getActiveProcessorGroupCount == NULL || getActiveProcessorCount == NULL )
+        return 0;
+
+    groupCount = getActiveProcessorGroupCount();
+    for( g = 0; g < groupCount; ++g )
+    {
+        count = getActiveProcessorCount( g );
+        if( (DWORD)cpu < count )
+        {
+            *group = g;
+            *number = (BYTE)cpu;
+            return 1;
+        }
+        cpu -= (int)count;
+    }
+    return 0;
+}
+
+
+static PaError SetThreadCpuSets( HANDLE thread, const int *cpus, int cpuCount )
+{
+    PaWinUtilGetSystemCpuSetInformation getSystemCpuSetInformation = (PaWinUtilGetSystemCpuSetInformation)
+            GetKernel32Function( "GetSystemCpuSetInformation" );
+    PaWinUtilSetThreadSelectedCpuSets setThreadSelectedCpuSets = (PaWinUtilSetThreadSelectedCpuSets)
+            GetKernel32Function( "SetThreadSelectedCpuSets" );
+    PaError result = paUnanticipatedHostError;
+    ULONG length = 0, offset, idCount = 0;
+    char *information = NULL;
+    ULONG *ids = NULL;
+    WORD group;
+    BYTE number;
+    int i;
+
+    if( getSystemCpuSetInformation == NULL || setThreadSelectedCpuSets == NULL )
+        return paUnanticipatedHostError;
+
+    getSystemCpuSetInformation( NULL, 0, &length, GetCurrentProcess(), 0 );
+    information = (char*)PaUtil_AllocateMemory( (long)length );
+    ids = (ULONG*)PaUtil_AllocateMemory( (long)( cpuCount * sizeof(ULONG) ) );
+    if( information == NULL || ids == NULL )
+    {
+        result = paInsufficientMemory;
+        goto done;
+    }
+    if( !getSystemCpuSetInformation( (PaWinUtilCpuSetInformation*)information, length, &length,
+            GetCurrentProcess(), 0 ) )
+        goto done;
+
+    for( i = 0; i < cpuCount; ++i )
+    {
+        if( !GetCpuGroup( cpus[i], &group, &number ) )
+            continue;
+
+        for( offset = 0; offset < length; offset += ((PaWinUtilCpuSetInformation*)( information + offset ))->size )
+        {
+            const PaWinUtilCpuSetInformation *cpuSet = (const PaWinUtilCpuSetInformation*)( information + offset );
+            if( cpuSet->size == 0 )
+                break;
+            if( cpuSet->type == 0 && cpuSet->group == group && cpuSet->logicalProcessorIndex == number )
+            {
+                ids[idCount++] = cpuSet->id;
+                break;
+            }
+        }
+    }
+
+    if( idCount > 0 && setThreadSelectedCpuSets( thread, ids, idCount ) )
+        result = paNoError;
+
+done:
+    PaUtil_FreeMemory( ids );
+    PaUtil_FreeMemory( information );
+    return result;
+}
+
+#endif /* !WINAPI_FAMILY_APP */
+
+
+int PaWinUtil_GetCpuCount( void )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    SYSTEM_INFO systemInfo;
+
+    GetNativeSystemInfo( &systemInfo );
+    return (int)systemInfo.dwNumberOfProcessors;
+#else
+    PaWinUtilGetActiveProcessorCount getActiveProcessorCount = (PaWinUtilGetActiveProcessorCount)
+            GetKernel32Function( "GetActiveProcessorCount" );
+    SYSTEM_INFO systemInfo;
+
+    if( getActiveProcessorCount != NULL )
+        return (int)getActiveProcessorCount( 0xFFFF ); /* ALL_PROCESSOR_GROUPS */
+
+    GetSystemInfo( &systemInfo );
+    return (int)systemInfo.dwNumberOfProcessors;
+#endif
+}
+
+
+PaError PaWinUtil_ValidateCpus( const int *cpus, int cpuCount )
+{
+    int cpuTotal, i;
+
+    if( cpuCount == 0 )
+        return paNoError;
+    if( cpuCount < 0 || cpus == NULL )
+        return paIncompatibleHostApiSpecificStreamInfo;
+
+    cpuTotal = PaWinUtil_GetCpuCount();
+    for( i = 0; i < cpuCount; ++i )
+    {
+        if( cpus[i] < 0 || cpus[i] >= cpuTotal )
+            return paIncompatibleHostApiSpecificStreamInfo;
+    }
+    return paNoError;
+}
+
+
+PaError PaWinUtil_SetThreadCpuAffinity( void *thread, const int *cpus, int cpuCount )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    (void)thread; /* unused parameter */
+    (void)cpus; /* unused parameter */
+    (void)cpuCount; /* unused parameter */
+    return paNoError;
+#else
+    PaWinUtilSetThreadGroupAffinity setThreadGroupAffinity = (PaWinUtilSetThreadGroupAffinity)
+            GetKernel32Function( "SetThreadGroupAffinity" );
+    PaWinUtilGroupAffinity affinity;
+    WORD group;
+    BYTE number;
+    int i, singleGroup = 1;
+
+    if( cpuCount <= 0 )
+        return paNoError;
+
+    memset( &affinity, 0, sizeof(affinity) );
+    if( setThreadGroupAffinity == NULL || !GetCpuGroup( cpus[0], &affinity.group, &number ) )
+    {
+        /* no processor groups before Windows 7, and only 64 processors */
+        DWORD_PTR mask = 0;
+
+        for( i = 0; i < cpuCount; ++i )
+        {
+            if( cpus[i] < (int)( sizeof(DWORD_PTR) * 8 ) )
+                mask |= (DWORD_PTR)1 << cpus[i];
+        }
+        if( mask == 0 || SetThreadAffinityMask( (HANDLE)thread, mask ) == 0 )
+            return paUnanticipatedHostError;
+        return paNoError;
+    }
+
+    for( i = 0; i < cpuCount; ++i )
+    {
+        if( GetCpuGroup( cpus[i], &group, &number ) && group == affinity.group )
+            affinity.mask |= (KAFFINITY)1 << number;
+        else
+            singleGroup = 0;
+    }
+
+    if( !singleGroup )
+    {
+        if( SetThreadCpuSets( (HANDLE)thread, cpus, cpuCount ) == paNoError )
+            return paNoError;
+
+        PA_DEBUG(( "PaWinUtil_SetThreadCpuAffinity: no CPU sets, the thread is restricted to group %d\n",
+                (int)affinity.group ));
+    }
+
+    if( !setThreadGroupAffinity( (HANDLE)thread, &affinity, NULL ) )
+    {
+        PA_DEBUG(( "PaWinUtil_SetThreadCpuAffinity: SetThreadGroupAffinity failed with %lu\n",
+                (unsigned long)GetLastError() ));
+        return paUnanticipatedHostError;
+    }
+    return paNoError;
+#endif
+}
+
+
+/* CreateWaitableTimerExW() came with Vista and is looked up at run time,
+   high resolution timers with Windows 10 version 1803 */
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION (0x00000002)
+#endif
+#ifndef TIMER_ALL_ACCESS
+#define TIMER_ALL_ACCESS (0x001F0003)
+#endif
+
+#if !(defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP))
+typedef HANDLE (WINAPI *PaWinUtilCreateWaitableTimerExW)( LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD );
+#endif
+
+
+void *PaWinUtil_CreateHighResolutionTimer( void )
+{
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_APP)
+    return CreateWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+#else
+    PaWinUtilCreateWaitableTimerExW createWaitableTimerExW = (PaWinUtilCreateWaitableTimerExW)
+            GetKernel32Function( "CreateWaitableTimerExW" );
+
+    if( createWaitableTimerExW == NULL )
+        return NULL;
+
+    /* fails with ERROR_INVALID_PARAMETER where the flag is unknown */
+    return createWaitableTimerExW( NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+#endif
+}
+
+
+unsigned long PaWinUtil_WaitWithTimer( void *timer, void *handle, double seconds )
+{
+    LARGE_INTEGER due;
+    HANDLE handles[2];
+    DWORD milliseconds, result;
+
+    if( seconds < 0. )
+        seconds = 0.;
+
+    if( timer != NULL && seconds > 0. )
+    {
+        /* negative due times are relative, in 100 ns units */
+        due.QuadPart = -(LONGLONG)( seconds * 10000000. + .5 );
+        if( SetWaitableTimer( (HANDLE)timer, &due, 0, NULL, NULL, FALSE ) )
+        {
+            if( handle == NULL )
+                return WaitForSingleObject( (HANDLE)timer, INFINITE ) == WAIT_OBJECT_0 ? WAIT_TIMEOUT : WAIT_FAILED;
+
+            handles[0] = (HANDLE)handle;
+            handles[1] = (HANDLE)timer;
+            result = WaitForMultipleObjects( 2, handles, FALSE, INFINITE );
+            if( result == WAIT_OBJECT_0 )
+            {
+                CancelWaitableTimer( (HANDLE)timer );
+                return WAIT_OBJECT_0;
+            }
+            return result == WAIT_OBJECT_0 + 1 ? WAIT_TIMEOUT : WAIT_FAILED;
+        }
+    }
+
+    milliseconds = (DWORD)( seconds * 1000. + .5 );
+    if( handle == NULL )
+    {
+        Sleep( milliseconds );
+        return WAIT_TIMEOUT;
+    }
+    return WaitForSingleObject( (HANDLE)handle, milliseconds );
+}
+
+
+void PaWinUtil_Sleep( double seconds )
+{
+    HANDLE timer = ( seconds > 0. ) ? (HANDLE)PaWinUtil_CreateHighResolutionTimer() : NULL;
+
+    PaWinUtil_WaitWithTimer( timer, NULL, seconds );
+
+    if( timer != NULL )
+        CloseHandle( timer );
+}
+
+
+#if defined(PA_USE_TRACELOGGING)
+
+/* "PortAudio" hashed as an EventSource name, so tools can also enable the
+   provider by name */
+TRACELOGGING_DEFINE_PROVIDER( paUtilTraceLoggingProvider, "PortAudio",
+        ( 0x4bbd2f23, 0x511c, 0x58bf, 0x8a, 0x82, 0x5a, 0x03, 0xd9, 0xcf, 0x82, 0x9b ) );
+
+void PaUtil_InitializeProbes( void )
+{
+    TraceLoggingRegister( paUtilTraceLoggingProvider );
+}
+
+void PaUtil_TerminateProbes( void )
+{
+    TraceLoggingUnregister( paUtilTraceLoggingProvider );
+}
+
+#endif /* PA_USE_TRACELOGGING */
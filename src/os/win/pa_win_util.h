@@ -0,0 +1,165 @@
+/*
+ * Portable Audio I/O Library
+ * Win32 platform-specific support functions
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+
+/** @file
+ @ingroup win_src
+
+ @brief Scheduling of the audio threads of the Windows host APIs: their
+ Multimedia Class Scheduler Service (MMCSS) registration, their affinity
+ to processors and the high resolution waits of their polling loops.
+
+ MMCSS raises a registered thread to the real-time priority range for the
+ share of each scheduling period that its task is configured for, which keeps
+ it from being starved by other threads without it starving the rest of the
+ system. The functions load avrt.dll on first use and register nothing where
+ it isn't available (Windows XP and earlier, UWP applications) or MMCSS is
+ disabled, host APIs then fall back to SetThreadPriority().
+
+ The task and priority which threads are registered with by default are
+ "Pro Audio" and paWinUtilMmcssCriticalPriority. The PA_MMCSS_TASK environment
+ variable may name another task of
+ HKLM\\SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Multimedia\\SystemProfile\\Tasks
+ and PA_MMCSS_PRIORITY may be one of "low", "normal", "high" or "critical".
+*/
+
+#ifndef PA_WIN_UTIL_H
+#define PA_WIN_UTIL_H
+
+#include "portaudio.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+
+/** The priority of a thread within its MMCSS task, the values of
+ AVRT_PRIORITY.
+*/
+typedef enum PaWinUtilMmcssPriority
+{
+    paWinUtilMmcssDefaultPriority = -2, /**< PA_MMCSS_PRIORITY, or critical */
+    paWinUtilMmcssLowPriority = -1,
+    paWinUtilMmcssNormalPriority = 0,
+    paWinUtilMmcssHighPriority = 1,
+    paWinUtilMmcssCriticalPriority = 2
+} PaWinUtilMmcssPriority;
+
+
+/** Register the calling thread with MMCSS.
+
+ @param taskName The MMCSS task, NULL for the default of PA_MMCSS_TASK or
+ "Pro Audio".
+
+ @param priority The thread's priority within the task.
+
+ @return A handle to pass to PaWinUtil_RevertMmcssThread() on the same thread
+ before it exits, NULL if the thread couldn't be registered.
+*/
+void *PaWinUtil_RegisterMmcssThread( const char *taskName, PaWinUtilMmcssPriority priority );
+
+
+/** Revert the registration made by PaWinUtil_RegisterMmcssThread(), does
+ nothing if task is NULL.
+*/
+void PaWinUtil_RevertMmcssThread( void *task );
+
+
+/** The number of logical processors of the system, in all processor groups.
+
+ PortAudio numbers the processors of a system with more than 64 of them
+ group by group: the processors of group 0 first, then those of group 1 and
+ so on, as in the callbackCpus of the host API specific stream infos.
+*/
+int PaWinUtil_GetCpuCount( void );
+
+
+/** Check the processors of a host API specific stream info.
+
+ @return paNoError if cpuCount is 0 or cpus are cpuCount valid processor
+ numbers, else paIncompatibleHostApiSpecificStreamInfo.
+*/
+PaError PaWinUtil_ValidateCpus( const int *cpus, int cpuCount );
+
+
+/** Restrict a thread to the logical processors cpus, numbered as for
+ PaWinUtil_GetCpuCount(). Processors of a single group are set with
+ SetThreadGroupAffinity(). Threads can only have a hard affinity to one
+ group though, processors of several groups are set as the thread's selected
+ CPU sets where the system has them (Windows 10 and up), or else restricted
+ to the group of cpus[0]. Ignored for UWP applications.
+
+ @param thread The HANDLE of the thread.
+
+ @return paNoError, or paUnanticipatedHostError if the system refused.
+*/
+PaError PaWinUtil_SetThreadCpuAffinity( void *thread, const int *cpus, int cpuCount );
+
+
+/** Create a high resolution waitable timer, whose waits end within about a
+ millisecond of their due time instead of at the next system timer tick,
+ every 15.6 ms if no application raised the timer resolution with
+ timeBeginPeriod().
+
+ @return The HANDLE of an auto-reset waitable timer, to be closed with
+ CloseHandle(), or NULL where the system has no high resolution timers
+ (before Windows 10 version 1803).
+*/
+void *PaWinUtil_CreateHighResolutionTimer( void );
+
+
+/** Wait for handle to be signaled for at most seconds, timed by timer.
+
+ @param timer A timer of PaWinUtil_CreateHighResolutionTimer(), or NULL to
+ time the wait with the millisecond timeout of WaitForSingleObject().
+
+ @param handle The HANDLE to wait for, or NULL to just sleep.
+
+ @return WAIT_OBJECT_0 if handle was signaled, else WAIT_TIMEOUT, or
+ WAIT_FAILED.
+*/
+unsigned long PaWinUtil_WaitWithTimer( void *timer, void *handle, double seconds );
+
+
+/** Sleep for seconds on a high resolution timer, or with Sleep() where the
+ system has none. Pa_Sleep() is implemented with this.
+*/
+void PaWinUtil_Sleep( double seconds );
+
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* PA_WIN_UTIL_H */
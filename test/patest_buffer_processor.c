@@ -0,0 +1,369 @@
+/** @file patest_buffer_processor.c
+	@ingroup test_src
+	@brief Checks the buffer processor paths which pass host buffers to the callback.
+
+    When the user and host formats match, the buffer processor passes the host
+    buffers to the stream callback in place of its temporary buffers: all of
+    them in IdentityProcess(), one direction in NonAdaptingProcess(), or a
+    whole user buffer in the half duplex adapting processors. This program
+    runs the buffer processor over such layouts, interleaved and not, with
+    paMeterLevels, and checks that the levels of both directions are metered
+    as they are when the buffers are converted. Each layout with output is run
+    again with a silent output channel, which must be zeroed in the host
+    buffer although the callback wrote to it.
+
+    The program returns a non-zero exit status if any check fails.
+
+    Usage: patest_buffer_processor [-v]
+*/
+/*
+ * $Id: $
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "portaudio.h"
+#include "pa_process.h"
+#include "pa_levelmeter.h"
+
+#define SAMPLE_RATE         (48000.)
+#define CHANNEL_COUNT       (2)
+#define FRAMES_PER_USER     (256)
+#define MAX_HOST_FRAMES     (512)
+#define HOST_BUFFER_COUNT   (20)
+
+#define INPUT_LEVEL         (.5f)
+#define OUTPUT_LEVEL        (.25f)
+#define LEVEL_TOLERANCE     (.001f)
+
+
+typedef struct
+{
+    const char *name;
+    int inputChannelCount;
+    PaSampleFormat userInputFormat, hostInputFormat;
+    int outputChannelCount;
+    PaSampleFormat userOutputFormat, hostOutputFormat;
+    unsigned long framesPerHostBuffer;
+    PaUtilHostBufferSizeMode hostBufferSizeMode;
+    int direct;     /* the host buffers are passed with PaUtil_EndBufferProcessingDirectly() when allowed */
+}
+Layout;
+
+static const Layout layouts_[] =
+{
+    { "interleaved identity",
+        CHANNEL_COUNT, paFloat32, paFloat32, CHANNEL_COUNT, paFloat32, paFloat32,
+        FRAMES_PER_USER, paUtilFixedHostBufferSize },
+    { "interleaved input in place, converted output",
+        CHANNEL_COUNT, paFloat32, paFloat32, CHANNEL_COUNT, paFloat32, paInt16,
+        FRAMES_PER_USER, paUtilFixedHostBufferSize },
+    { "interleaved converted input, output in place",
+        CHANNEL_COUNT, paFloat32, paInt16, CHANNEL_COUNT, paFloat32, paFloat32,
+        FRAMES_PER_USER, paUtilFixedHostBufferSize },
+    { "non-interleaved in place",
+        CHANNEL_COUNT, paFloat32|paNonInterleaved, paFloat32|paNonInterleaved,
+        CHANNEL_COUNT, paFloat32|paNonInterleaved, paFloat32|paNonInterleaved,
+        FRAMES_PER_USER, paUtilFixedHostBufferSize },
+    { "interleaved adapting input only",
+        CHANNEL_COUNT, paFloat32, paFloat32, 0, 0, 0,
+        MAX_HOST_FRAMES, paUtilBoundedHostBufferSize },
+    { "non-interleaved adapting input only",
+        CHANNEL_COUNT, paFloat32|paNonInterleaved, paFloat32|paNonInterleaved, 0, 0, 0,
+        MAX_HOST_FRAMES, paUtilBoundedHostBufferSize },
+    { "interleaved adapting output only",
+        0, 0, 0, CHANNEL_COUNT, paFloat32, paFloat32,
+        MAX_HOST_FRAMES, paUtilBoundedHostBufferSize },
+    { "non-interleaved adapting output only",
+        0, 0, 0, CHANNEL_COUNT, paFloat32|paNonInterleaved, paFloat32|paNonInterleaved,
+        MAX_HOST_FRAMES, paUtilBoundedHostBufferSize },
+    { "interleaved direct",
+        CHANNEL_COUNT, paFloat32, paFloat32, CHANNEL_COUNT, paFloat32, paFloat32,
+        FRAMES_PER_USER, paUtilFixedHostBufferSize, 1 },
+    { "non-interleaved direct",
+        CHANNEL_COUNT, paFloat32|paNonInterleaved, paFloat32|paNonInterleaved,
+        CHANNEL_COUNT, paFloat32|paNonInterleaved, paFloat32|paNonInterleaved,
+        FRAMES_PER_USER, paUtilFixedHostBufferSize, 1 },
+};
+
+static int verbose_ = 0;
+
+
+/* Writes OUTPUT_LEVEL to every output sample, whatever the layout. */
+static int LevelCallback( const void *input, void *output, unsigned long frameCount,
+        const PaStreamCallbackTimeInfo *timeInfo, PaStreamCallbackFlags statusFlags, void *userData )
+{
+    const Layout *layout = (const Layout*)userData;
+    unsigned long i;
+    int c;
+
+    (void)input; (void)timeInfo; (void)statusFlags;
+
+    if( layout->outputChannelCount == 0 )
+        return paContinue;
+
+    for( c = 0; c < layout->outputChannelCount; ++c )
+    {
+        float *out = (layout->userOutputFormat & paNonInterleaved)
+                ? ((float**)output)[c] : (float*)output + c;
+        int stride = (layout->userOutputFormat & paNonInterleaved) ? 1 : layout->outputChannelCount;
+
+        for( i = 0; i < frameCount; ++i )
+            out[i * stride] = OUTPUT_LEVEL;
+    }
+
+    return paContinue;
+}
+
+
+static void FillHostInput( void *buffer, PaSampleFormat format, unsigned long sampleCount )
+{
+    unsigned long i;
+
+    for( i = 0; i < sampleCount; ++i )
+    {
+        if( (format & ~paNonInterleaved) == paInt16 )
+            ((short*)buffer)[i] = (short)(INPUT_LEVEL * 32768.f);
+        else
+            ((float*)buffer)[i] = INPUT_LEVEL;
+    }
+}
+
+
+static void SetHostChannels( PaUtilBufferProcessor *bp, int isInput, int channelCount,
+        PaSampleFormat format, unsigned char *buffer, unsigned long frameCount )
+{
+    int c;
+
+    if( !(format & paNonInterleaved) )
+    {
+        if( isInput )
+            PaUtil_SetInterleavedInputChannels( bp, 0, buffer, 0 );
+        else
+            PaUtil_SetInterleavedOutputChannels( bp, 0, buffer, 0 );
+        return;
+    }
+
+    for( c = 0; c < channelCount; ++c )
+    {
+        unsigned char *channel = buffer + c * frameCount * Pa_GetSampleSize( format );
+
+        if( isInput )
+            PaUtil_SetNonInterleavedInputChannel( bp, c, channel );
+        else
+            PaUtil_SetNonInterleavedOutputChannel( bp, c, channel );
+    }
+}
+
+
+/* The buffer passed to the callback for a host buffer in the user's format, or NULL without channels. */
+static void *UserBuffer( int channelCount, PaSampleFormat format, unsigned char *buffer,
+        unsigned long frameCount, void **channels )
+{
+    int c;
+
+    if( channelCount == 0 )
+        return NULL;
+    if( !(format & paNonInterleaved) )
+        return buffer;
+
+    for( c = 0; c < channelCount; ++c )
+        channels[c] = buffer + c * frameCount * Pa_GetSampleSize( format );
+    return channels;
+}
+
+
+static float HostOutputSample( const Layout *layout, const unsigned char *buffer,
+        int channel, unsigned long frame, unsigned long frameCount )
+{
+    unsigned long index = (layout->hostOutputFormat & paNonInterleaved)
+            ? channel * frameCount + frame
+            : frame * layout->outputChannelCount + channel;
+
+    if( (layout->hostOutputFormat & ~paNonInterleaved) == paInt16 )
+        return ((const short*)buffer)[index] / 32768.f;
+    return ((const float*)buffer)[index];
+}
+
+
+static int CheckHostOutput( const Layout *layout, const unsigned char *buffer,
+        unsigned long frameCount, int silentChannel )
+{
+    unsigned long i;
+    int c;
+
+    for( c = 0; c < layout->outputChannelCount; ++c )
+    {
+        float expected = ( c == silentChannel ) ? 0.f : OUTPUT_LEVEL;
+
+        for( i = 0; i < frameCount; ++i )
+        {
+            float sample = HostOutputSample( layout, buffer, c, i, frameCount );
+
+            if( fabs( sample - expected ) > LEVEL_TOLERANCE )
+            {
+                printf( "FAIL %s: host output channel %d frame %lu is %.3f, expected %.3f\n",
+                        layout->name, c, i, sample, expected );
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+static int CheckLevels( const Layout *layout, PaUtilBufferProcessor *bp,
+        PaStreamTapSource source, int channelCount, float expected, int silentChannel )
+{
+    PaStreamChannelLevel levels[CHANNEL_COUNT];
+    int c, failed = 0;
+
+    if( channelCount == 0 )
+        return 0;
+
+    if( PaUtil_GetLevels( PaUtil_GetBufferProcessorLevelMeter( bp ), source, levels, channelCount ) != paNoError )
+    {
+        printf( "FAIL %s: no %s levels\n", layout->name, source == paStreamTapInput ? "input" : "output" );
+        return 1;
+    }
+
+    for( c = 0; c < channelCount; ++c )
+    {
+        float channelExpected = ( c == silentChannel ) ? 0.f : expected;
+        int channelFailed = fabs( levels[c].peak - channelExpected ) > LEVEL_TOLERANCE
+                || fabs( levels[c].rms - channelExpected ) > LEVEL_TOLERANCE;
+
+        if( channelFailed || verbose_ )
+            printf( "%s %s: %s channel %d peak %.3f rms %.3f, expected %.3f\n",
+                    channelFailed ? "FAIL" : "ok", layout->name,
+                    source == paStreamTapInput ? "input" : "output", c,
+                    levels[c].peak, levels[c].rms, channelExpected );
+        failed |= channelFailed;
+    }
+
+    return failed;
+}
+
+
+/* Runs the layout, with output channel silentChannel made silent unless it is -1. */
+static int TestLayout( const Layout *layout, int silentChannel )
+{
+    static unsigned char hostInput[MAX_HOST_FRAMES * CHANNEL_COUNT * sizeof(float)];
+    static unsigned char hostOutput[MAX_HOST_FRAMES * CHANNEL_COUNT * sizeof(float)];
+    void *inputChannels[CHANNEL_COUNT], *outputChannels[CHANNEL_COUNT];
+    PaUtilBufferProcessor bp;
+    PaStreamCallbackTimeInfo timeInfo = { 0, 0, 0 };
+    unsigned long frameCount = layout->framesPerHostBuffer;
+    int i, callbackResult, failed = 0;
+    PaError result;
+
+    result = PaUtil_InitializeBufferProcessor( &bp,
+            layout->inputChannelCount, layout->userInputFormat, layout->hostInputFormat,
+            layout->outputChannelCount, layout->userOutputFormat, layout->hostOutputFormat,
+            SAMPLE_RATE, paClipOff | paDitherOff | paMeterLevels, FRAMES_PER_USER,
+            layout->framesPerHostBuffer, layout->hostBufferSizeMode, LevelCallback, (void*)layout );
+    if( result != paNoError )
+    {
+        printf( "FAIL %s: PaUtil_InitializeBufferProcessor returned %d\n", layout->name, result );
+        return 1;
+    }
+
+    if( silentChannel >= 0 )
+        PaUtil_SetSilentChannel( PaUtil_GetBufferProcessorSilentOutputChannels( &bp ), silentChannel, 1 );
+
+    if( layout->inputChannelCount )
+        FillHostInput( hostInput, layout->hostInputFormat, frameCount * layout->inputChannelCount );
+
+    for( i = 0; i < HOST_BUFFER_COUNT; ++i )
+    {
+        PaUtil_BeginBufferProcessing( &bp, &timeInfo, 0 );
+        if( layout->inputChannelCount )
+        {
+            PaUtil_SetInputFrameCount( &bp, frameCount );
+            SetHostChannels( &bp, 1, layout->inputChannelCount, layout->hostInputFormat, hostInput, frameCount );
+        }
+        if( layout->outputChannelCount )
+        {
+            PaUtil_SetOutputFrameCount( &bp, frameCount );
+            SetHostChannels( &bp, 0, layout->outputChannelCount, layout->hostOutputFormat, hostOutput, frameCount );
+        }
+        callbackResult = paContinue;
+        if( layout->direct && PaUtil_CanBypassBufferProcessor( &bp ) )
+            PaUtil_EndBufferProcessingDirectly( &bp,
+                    UserBuffer( layout->inputChannelCount, layout->hostInputFormat, hostInput,
+                            frameCount, inputChannels ),
+                    UserBuffer( layout->outputChannelCount, layout->hostOutputFormat, hostOutput,
+                            frameCount, outputChannels ),
+                    frameCount, &callbackResult );
+        else
+            PaUtil_EndBufferProcessing( &bp, &callbackResult );
+    }
+
+    failed |= CheckLevels( layout, &bp, paStreamTapInput, layout->inputChannelCount, INPUT_LEVEL, -1 );
+    failed |= CheckLevels( layout, &bp, paStreamTapOutput, layout->outputChannelCount, OUTPUT_LEVEL, silentChannel );
+    if( layout->outputChannelCount )
+        failed |= CheckHostOutput( layout, hostOutput, frameCount, silentChannel );
+
+    PaUtil_TerminateBufferProcessor( &bp );
+
+    return failed;
+}
+
+
+int main( int argc, char *argv[] )
+{
+    int failures = 0;
+    size_t i;
+
+    if( argc > 1 && strcmp( argv[1], "-v" ) == 0 )
+        verbose_ = 1;
+
+    for( i = 0; i < sizeof(layouts_) / sizeof(layouts_[0]); ++i )
+    {
+        failures += TestLayout( &layouts_[i], -1 );
+        if( layouts_[i].outputChannelCount > 1 )
+            failures += TestLayout( &layouts_[i], 1 );
+    }
+
+    if( failures )
+        printf( "%d runs failed\n", failures );
+    else
+        printf( "all runs passed\n" );
+
+    return failures ? 1 : 0;
+}
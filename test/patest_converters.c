@@ -63,17 +63,17 @@
 #define MAX_CHANNEL_COUNT               (8)
 
 
-#define SAMPLE_FORMAT_COUNT (6)
+#define SAMPLE_FORMAT_COUNT (8)
 
 static PaSampleFormat sampleFormats_[ SAMPLE_FORMAT_COUNT ] = 
-    { paFloat32, paInt32, paInt24, paInt16, paInt8, paUInt8 }; /* all standard PA sample formats */
+    { paFloat64, paFloat32, paInt32, paInt24, paInt24In32, paInt16, paInt8, paUInt8 }; /* all standard PA sample formats */
 
 static const char* sampleFormatNames_[SAMPLE_FORMAT_COUNT] = 
-    { "paFloat32", "paInt32", "paInt24", "paInt16", "paInt8", "paUInt8" };
+    { "paFloat64", "paFloat32", "paInt32", "paInt24", "paInt24In32", "paInt16", "paInt8", "paUInt8" };
 
 
 static const char* abbreviatedSampleFormatNames_[SAMPLE_FORMAT_COUNT] = 
-    { "f32", "i32", "i24", "i16", " i8", "ui8" };
+    { "f64", "f32", "i32", "i24", "s24", "i16", " i8", "ui8" }; /* s24 is ALSA's name for paInt24In32 */
 
 
 PaError My_Pa_GetSampleSize( PaSampleFormat format );
@@ -114,6 +114,16 @@ static void GenerateOneCycleSine( PaSampleFormat format, void *buffer, int frame
 {
     switch( format ){
 
+        case paFloat64:
+            {
+                int i;
+                double *out = (double*)buffer;
+                for( i=0; i < frameCount; ++i ){
+                    *out = .9 * sin( ((double)i/(double)frameCount) * 2. * M_PI );
+                    out += strideFrames;
+                }
+            }
+            break;
         case paFloat32:
             {
                 int i;
@@ -154,6 +164,16 @@ static void GenerateOneCycleSine( PaSampleFormat format, void *buffer, int frame
                 }
             }
             break;
+        case paInt24In32:
+            {
+                int i;
+                PaInt32 *out = (PaInt32*)buffer;
+                for( i=0; i < frameCount; ++i ){
+                    *out = (PaInt32)(.9 * sin( ((double)i/(double)frameCount) * 2. * M_PI ) * 0x7FFFFF);
+                    out += strideFrames;
+                }
+            }
+            break;
         case paInt16:
             {
                 int i;
@@ -235,11 +255,11 @@ int main( const char **argv, int argc )
 
     PaUtil_InitializeTriangularDitherState( &ditherState );
 
-    /* allocate more than enough space, we use sizeof(float) but we need to fit any 32 bit datum */
+    /* allocate more than enough space, we use sizeof(double) to fit any datum */
 
-    destinationBuffer = (void*)malloc( MAX_PER_CHANNEL_FRAME_COUNT * MAX_CHANNEL_COUNT * sizeof(float) );
-    sourceBuffer = (void*)malloc( MAX_PER_CHANNEL_FRAME_COUNT * MAX_CHANNEL_COUNT * sizeof(float) );
-    referenceBuffer = (void*)malloc( MAX_PER_CHANNEL_FRAME_COUNT * MAX_CHANNEL_COUNT * sizeof(float) );
+    destinationBuffer = (void*)malloc( MAX_PER_CHANNEL_FRAME_COUNT * MAX_CHANNEL_COUNT * sizeof(double) );
+    sourceBuffer = (void*)malloc( MAX_PER_CHANNEL_FRAME_COUNT * MAX_CHANNEL_COUNT * sizeof(double) );
+    referenceBuffer = (void*)malloc( MAX_PER_CHANNEL_FRAME_COUNT * MAX_CHANNEL_COUNT * sizeof(double) );
 
 
     /* the first round of tests simply iterates through the buffer combinations testing
@@ -383,9 +403,14 @@ PaError My_Pa_GetSampleSize( PaSampleFormat format )
 
     case paFloat32:
     case paInt32:
+    case paInt24In32:
         result = 4;
         break;
 
+    case paFloat64:
+        result = 8;
+        break;
+
     default:
         result = paSampleFormatNotSupported;
         break;
@@ -176,6 +176,12 @@ int main(void)
     printf("\nClip and Dither..\n");
     fflush(stdout);
     err = PlaySine( &DATA, paNoFlag, amplitude );
+    if( err < 0 ) goto done;
+
+    /* only differs from the above with a 16 bit host format */
+    printf("\nClip and Noise Shaped Dither..\n");
+    fflush(stdout);
+    err = PlaySine( &DATA, paDitherNoiseShaped, amplitude );
 done:
     if (err)
         {
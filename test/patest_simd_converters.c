@@ -0,0 +1,617 @@
+/** @file patest_simd_converters.c
+	@ingroup test_src
+	@brief Checks the accelerated converters against the scalar C versions.
+
+    Each converter PortAudio can select is run from the portable C table with
+    withAcceleration cleared, which is the reference, and then from each
+    accelerated set the machine supports, at the strides the buffer processor
+    uses and some it doesn't, over counts which don't fill whole vectors, with
+    sources holding clip boundaries, denormals and rounding boundaries, and
+    with the dither generator started at several points of its sequence. The
+    destinations must match the reference bit for bit, apart from the
+    documented tolerances of the table below, and samples between the strided
+    ones must be left untouched.
+
+    The sets are the C versions at the strides they are specialized for
+    (NEON on ARM builds, whose C versions hold the NEON sections), SSE2 and
+    AVX2. The program returns a non-zero exit status if any conversion fails.
+
+    Usage: patest_simd_converters [-v]
+*/
+/*
+ * $Id: $
+ *
+ * This program uses the PortAudio Portable Audio Library.
+ * For more information see: http://www.portaudio.com/
+ * Copyright (c) 1999-2008 Ross Bencina and Phil Burk
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files
+ * (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The text above constitutes the entire PortAudio license; however,
+ * the PortAudio community also makes the following non-binding requests:
+ *
+ * Any person wishing to distribute modifications to the Software is
+ * requested to send the modifications to the original developer so that
+ * they can be incorporated into the canonical version. It is also
+ * requested that these non-binding requests be included along with the
+ * license above.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#include "portaudio.h"
+#include "pa_converters.h"
+#include "pa_x86_simd_converters.h"
+#include "pa_cpufeatures.h"
+#include "pa_dither.h"
+#include "pa_types.h"
+#include "pa_endianness.h"
+
+/* defined in pa_converters.c, gates the accelerated code */
+extern volatile int withAcceleration;
+
+/* wide enough for the distance of two paFloat64 samples in ulps */
+typedef long long SampleDistance;
+
+
+#define MAX_COUNT           (1021)
+#define MAX_STRIDE          (8)
+#define MAX_SAMPLE_SIZE     (8)
+#define BUFFER_BYTES        ((MAX_COUNT + 1) * MAX_STRIDE * MAX_SAMPLE_SIZE)
+#define MAX_SETS            (3)
+
+
+#define SAMPLE_FORMAT_COUNT (8)
+
+static PaSampleFormat sampleFormats_[ SAMPLE_FORMAT_COUNT ] =
+    { paFloat64, paFloat32, paInt32, paInt24, paInt24In32, paInt16, paInt8, paUInt8 };
+
+static const char* abbreviatedSampleFormatNames_[SAMPLE_FORMAT_COUNT] =
+    { "f64", "f32", "i32", "i24", "s24", "i16", "i8", "ui8" };
+
+
+#define FLAG_COMBINATION_COUNT (6)
+
+static PaStreamFlags flagCombinations_[FLAG_COMBINATION_COUNT] =
+    { paNoFlag, paClipOff, paDitherOff, paClipOff | paDitherOff, paSoftClip, paSoftClip | paDitherOff };
+
+static const char *flagCombinationNames_[FLAG_COMBINATION_COUNT] =
+    { "", " clipoff", " ditheroff", " clipoff ditheroff", " softclip", " softclip ditheroff" };
+
+
+/* the buffer processor's specializations, then strides which only the
+   generic versions handle */
+static const int strides_[][2] = {
+    { 1, 1 }, { 1, 2 }, { 2, 2 }, { 1, 4 }, { 4, 4 }, { 1, 6 }, { 6, 6 }, { 1, 8 }, { 8, 8 },
+    { 2, 1 }, { 4, 1 }, { 8, 1 }, { 3, 3 }, { 1, 3 }, { 5, 7 }
+};
+#define STRIDE_COUNT    (sizeof(strides_) / sizeof(strides_[0]))
+
+/* every count below two AVX2 vectors, then odd and even ones around the
+   block sizes of the buffer processor */
+static const unsigned int counts_[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+    31, 32, 33, 63, 64, 65, 127, 128, 129, 255, 256, 257, 1021
+};
+#define COUNT_COUNT     (sizeof(counts_) / sizeof(counts_[0]))
+
+/* points of the dither sequence the generators start at */
+static const unsigned int ditherOffsets_[] = { 0, 1, 3, 4093 };
+#define DITHER_OFFSET_COUNT     (sizeof(ditherOffsets_) / sizeof(ditherOffsets_[0]))
+
+
+/*
+    Differences accepted between an accelerated set and the scalar versions,
+    in least significant bits of the destination for integer formats and in
+    units in the last place for floating point ones. Everything else must be
+    bit exact.
+*/
+typedef struct Tolerance
+{
+    const char *set;
+    PaSampleFormat sourceFormat;        /* 0 for any */
+    PaSampleFormat destinationFormat;   /* 0 for any */
+    long maxDifference;
+    const char *reason;
+} Tolerance;
+
+static const Tolerance tolerances_[] = {
+    /* the NEON sections scale by 0x7FFFFFFF in single precision, which is
+       2^31, and truncate a product whose float ulp is 128 LSB at full scale */
+    { "NEON", paFloat32, paInt32, 256, "single precision scaling" },
+    /* the NEON sections round their vector conversions to and from float
+       differently from the scalar casts */
+    { "NEON", 0, 0, 1, "vector rounding" },
+    { 0, 0, 0, 0, 0 }
+};
+
+
+typedef struct ConverterSet
+{
+    const char *name;
+    PaUtilConverterTable table;
+    unsigned long conversions;
+    unsigned long failures;
+} ConverterSet;
+
+
+static int verbose_ = 0;
+
+
+static const Tolerance *FindTolerance( const char *set, PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat )
+{
+    const Tolerance *t;
+
+    for( t = tolerances_; t->set; ++t )
+    {
+        if( !strcmp( t->set, set )
+                && ( !t->sourceFormat || t->sourceFormat == sourceFormat )
+                && ( !t->destinationFormat || t->destinationFormat == destinationFormat ) )
+            return t;
+    }
+    return 0;
+}
+
+
+static int SampleSize( PaSampleFormat format )
+{
+    switch( format )
+    {
+    case paUInt8:
+    case paInt8:
+        return 1;
+    case paInt16:
+        return 2;
+    case paInt24:
+        return 3;
+    case paFloat64:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+
+/* xorshift, so that runs are repeatable */
+static PaUint32 random_ = 0x12345678;
+
+static PaUint32 Random( void )
+{
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+}
+
+static double RandomUnit( void )   /* [-1, 1] */
+{
+    return (double)Random() / 2147483647.5 - 1.;
+}
+
+
+/*
+    A source value for a float converter: mostly uniform, with boundaries
+    mixed in. Without clipping the values stay within full scale, with
+    dither far enough within it that the dither can't overflow, as the
+    scalar casts of overflowing values are undefined.
+*/
+static double FloatSourceValue( int clipped, int dithered, double minNormal, double epsilon )
+{
+    static const double roundingBoundaries[] = {
+        .5 / 32767., 1.5 / 32767., .5 / 127., .5 / 8388607., -.5 / 32767., 32766.5 / 32767.
+    };
+    double limit = clipped ? 1. : ( dithered ? .95 : 1. );
+    PaUint32 r = Random();
+
+    if( (r & 7) != 0 )
+        return RandomUnit() * limit;
+
+    switch( (r >> 3) % 14 )
+    {
+    case 0: return 0.;
+    case 1: return -0.;
+    case 2: return limit;
+    case 3: return -limit;
+    case 4: return limit - epsilon;
+    case 5: return -limit + epsilon;
+    case 6: return minNormal;
+    case 7: return -minNormal / 2.;                 /* denormal */
+    case 8: return minNormal * epsilon * 4.;        /* denormal near the smallest */
+    case 9: return roundingBoundaries[ (r >> 8) % 6 ] * limit;
+    case 10: return clipped ? 1. + epsilon : limit;
+    case 11: return clipped ? -1. - epsilon : -limit;
+    case 12: return clipped ? 1.5 : RandomUnit() * limit;
+    default: return clipped ? -1e10 : RandomUnit() * limit;
+    }
+}
+
+
+static void FillSource( PaSampleFormat format, unsigned char *buffer, int byteCount,
+        int clipped, int dithered )
+{
+    int i, count = byteCount / SampleSize( format );
+
+    switch( format )
+    {
+    case paFloat64:
+        for( i=0; i < count; ++i )
+            ((double*)buffer)[i] = FloatSourceValue( clipped, dithered, DBL_MIN, DBL_EPSILON );
+        break;
+    case paFloat32:
+        for( i=0; i < count; ++i )
+            ((float*)buffer)[i] = (float)FloatSourceValue( clipped, dithered, FLT_MIN, FLT_EPSILON );
+        break;
+    case paInt24In32:
+        for( i=0; i < count; ++i )
+        {
+            PaInt32 value = (PaInt32)(Random() >> 8) - 0x800000;
+            if( (Random() & 15) == 0 )
+                value = (Random() & 1) ? 0x7FFFFF : -0x800000;
+            ((PaInt32*)buffer)[i] = value;
+        }
+        break;
+    default:
+        /* any bit pattern is a valid integer sample, the extremes are
+           mixed in as for the float formats */
+        for( i=0; i < byteCount; ++i )
+            buffer[i] = (unsigned char)Random();
+        if( format == paInt32 || format == paInt16 )
+        {
+            int size = SampleSize( format );
+            for( i=0; i < count; ++i )
+            {
+                if( (Random() & 15) == 0 )
+                {
+                    /* most negative and most positive, native endian */
+                    int negative = Random() & 1;
+                    memset( buffer + i * size, negative ? 0 : 0xFF, size );
+#if defined(PA_LITTLE_ENDIAN)
+                    buffer[ i * size + size - 1 ] = negative ? 0x80 : 0x7F;
+#else
+                    buffer[ i * size ] = negative ? 0x80 : 0x7F;
+#endif
+                }
+            }
+        }
+        break;
+    }
+}
+
+
+/* The value of sample i of buffer, floating point samples as integers which
+   are one apart for adjacent values */
+static SampleDistance SampleValue( PaSampleFormat format, const unsigned char *buffer, int i )
+{
+    switch( format )
+    {
+    case paFloat64:
+        {
+            SampleDistance bits;
+            memcpy( &bits, buffer + i * 8, 8 );
+            return bits < 0 ? (SampleDistance)(-0x7FFFFFFFFFFFFFFFLL - 1) - bits : bits;
+        }
+    case paFloat32:
+        {
+            PaInt32 bits;
+            memcpy( &bits, buffer + i * 4, 4 );
+            return bits < 0 ? (SampleDistance)(-0x7FFFFFFF - 1) - bits : bits;
+        }
+    case paInt32:
+    case paInt24In32:
+        {
+            PaInt32 value;
+            memcpy( &value, buffer + i * 4, 4 );
+            return value;
+        }
+    case paInt24:
+        {
+            const unsigned char *p = buffer + i * 3;
+#if defined(PA_LITTLE_ENDIAN)
+            PaInt32 value = (PaInt32)(((PaUint32)p[2] << 24) | ((PaUint32)p[1] << 16) | ((PaUint32)p[0] << 8));
+#else
+            PaInt32 value = (PaInt32)(((PaUint32)p[0] << 24) | ((PaUint32)p[1] << 16) | ((PaUint32)p[2] << 8));
+#endif
+            return value >> 8;
+        }
+    case paInt16:
+        {
+            PaInt16 value;
+            memcpy( &value, buffer + i * 2, 2 );
+            return value;
+        }
+    case paInt8:
+        return (signed char)buffer[i];
+    default:
+        return buffer[i];
+    }
+}
+
+
+/* Start a dither generator offset values into its sequence, with or without
+   withAcceleration, which takes 16 bit dither from a table of the sequence */
+static void StartDither( PaUtilTriangularDitherGenerator *ditherGenerator, unsigned int offset )
+{
+    int acceleration = withAcceleration;
+    unsigned int i;
+
+    PaUtil_InitializeTriangularDitherState( ditherGenerator );
+    withAcceleration = 0;
+    for( i=0; i < offset; ++i )
+        PaUtil_Generate16BitTriangularDither( ditherGenerator );
+    withAcceleration = acceleration;
+    ditherGenerator->posInAccelBuff = offset;
+}
+
+
+/*
+    Compare a destination with the reference. Returns the largest difference
+    of their samples, -1 if a byte between the strided samples differs.
+*/
+static SampleDistance CompareDestinations( PaSampleFormat format, const unsigned char *destination,
+        const unsigned char *reference, unsigned int count, int stride, int *firstDifference )
+{
+    int size = SampleSize( format );
+    SampleDistance maxDifference = 0;
+    unsigned int i;
+
+    *firstDifference = -1;
+    if( !memcmp( destination, reference, BUFFER_BYTES ) )
+        return 0;
+
+    for( i=0; i < (unsigned int)BUFFER_BYTES / size; ++i )
+    {
+        SampleDistance difference;
+
+        if( !memcmp( destination + i * size, reference + i * size, size ) )
+            continue;
+        if( i % stride != 0 || i / stride >= count )
+        {
+            *firstDifference = (int)i;
+            return -1;
+        }
+
+        difference = SampleValue( format, destination, i ) - SampleValue( format, reference, i );
+        if( difference < 0 )
+            difference = -difference;
+        if( *firstDifference < 0 )
+            *firstDifference = (int)(i / stride);
+        if( difference > maxDifference )
+            maxDifference = difference;
+    }
+    return maxDifference;
+}
+
+
+/* Runs one converter of a set against the reference over all strides,
+   counts and dither offsets. Returns the largest difference, -1 if one of
+   the conversions wrote outside its samples. */
+static SampleDistance TestConverter( ConverterSet *set, PaSampleFormat sourceFormat,
+        PaSampleFormat destinationFormat, PaStreamFlags flags,
+        const PaUtilConverterTable *portable, unsigned char *source,
+        unsigned char *destination, unsigned char *reference, const char **where )
+{
+    static char whereBuffer[128];
+    PaUtilTriangularDitherGenerator ditherGenerator;
+    SampleDistance maxDifference = 0;
+    unsigned int s, c, d;
+
+    for( s=0; s < STRIDE_COUNT; ++s )
+    {
+        int sourceStride = strides_[s][0], destinationStride = strides_[s][1];
+        PaUtilConverter *scalar, *accelerated;
+
+        paConverters = *portable;
+        scalar = PaUtil_SelectConverter( sourceFormat, destinationFormat, flags );
+        paConverters = set->table;
+        accelerated = PaUtil_SelectConverterForStrides( sourceFormat, destinationFormat, flags,
+                sourceStride, destinationStride );
+        paConverters = *portable;
+
+        for( c=0; c < COUNT_COUNT; ++c )
+        {
+            for( d=0; d < DITHER_OFFSET_COUNT; ++d )
+            {
+                unsigned int count = counts_[c];
+                int firstDifference;
+                SampleDistance difference;
+
+                /* the destinations start out different, so a sample which
+                   is skipped shows as well */
+                memset( reference, 0x5A, BUFFER_BYTES );
+                memset( destination, 0x5A, BUFFER_BYTES );
+
+                withAcceleration = 0;
+                StartDither( &ditherGenerator, ditherOffsets_[d] );
+                scalar( reference, destinationStride, source, sourceStride, count, &ditherGenerator );
+
+                withAcceleration = 1;
+                StartDither( &ditherGenerator, ditherOffsets_[d] );
+                accelerated( destination, destinationStride, source, sourceStride, count, &ditherGenerator );
+
+                ++set->conversions;
+                difference = CompareDestinations( destinationFormat, destination, reference,
+                        count, destinationStride, &firstDifference );
+                if( difference == 0 )
+                    continue;
+
+                sprintf( whereBuffer, "strides %d->%d, count %u, dither offset %u, %s %d",
+                        sourceStride, destinationStride, count, ditherOffsets_[d],
+                        difference < 0 ? "wrote sample" : "first at frame", firstDifference );
+                if( difference < 0 )
+                {
+                    *where = whereBuffer;
+                    return -1;
+                }
+                if( difference > maxDifference )
+                {
+                    maxDifference = difference;
+                    *where = whereBuffer;
+                }
+            }
+        }
+    }
+    return maxDifference;
+}
+
+
+int main( int argc, char **argv )
+{
+    PaUtilCpuFeatures features = PaUtil_GetCpuFeatures();
+    PaUtilTriangularDitherGenerator ditherGenerator;
+    PaUtilConverterTable portable;
+    ConverterSet sets[MAX_SETS];
+    int setCount = 0, i, f, sourceIndex, destinationIndex;
+    unsigned char *source, *destination, *reference;
+    unsigned long conversions = 0, failures = 0, tested = 0;
+
+    if( argc > 1 && !strcmp( argv[1], "-v" ) )
+        verbose_ = 1;
+
+    /* fills the table of 16 bit dither which withAcceleration reads */
+    withAcceleration = 1;
+    PaUtil_InitializeTriangularDitherState( &ditherGenerator );
+
+    /* Pa_Initialize() isn't called, paConverters holds the C versions */
+    portable = paConverters;
+
+#ifdef __ARM_NEON__
+    sets[setCount].name = "NEON";
+#else
+    sets[setCount].name = "C";
+#endif
+    sets[setCount++].table = portable;
+
+    if( (features & paCpuSSE2) && PaUtil_InitializeX86SSE2Converters() )
+    {
+        sets[setCount].name = "SSE2";
+        sets[setCount++].table = paConverters;
+    }
+    paConverters = portable;
+    if( (features & paCpuAVX2) && PaUtil_InitializeX86AVX2Converters() )
+    {
+        sets[setCount].name = "AVX2";
+        sets[setCount++].table = paConverters;
+    }
+    paConverters = portable;
+
+    source = (unsigned char*)malloc( BUFFER_BYTES );
+    destination = (unsigned char*)malloc( BUFFER_BYTES );
+    reference = (unsigned char*)malloc( BUFFER_BYTES );
+    if( !source || !destination || !reference )
+    {
+        printf( "out of memory\n" );
+        return 1;
+    }
+
+    printf( "Checking the" );
+    for( i=0; i < setCount; ++i )
+    {
+        sets[i].conversions = 0;
+        sets[i].failures = 0;
+        printf( " %s", sets[i].name );
+    }
+    printf( " converters against the scalar versions\n" );
+
+    for( sourceIndex = 0; sourceIndex < SAMPLE_FORMAT_COUNT; ++sourceIndex )
+    {
+        for( destinationIndex = 0; destinationIndex < SAMPLE_FORMAT_COUNT; ++destinationIndex )
+        {
+            PaSampleFormat sourceFormat = sampleFormats_[sourceIndex];
+            PaSampleFormat destinationFormat = sampleFormats_[destinationIndex];
+            PaUtilConverter *seen[FLAG_COMBINATION_COUNT][MAX_SETS];
+
+            for( f=0; f < FLAG_COMBINATION_COUNT; ++f )
+            {
+                PaStreamFlags flags = flagCombinations_[f];
+                int clipped = !(flags & paClipOff), dithered = !(flags & paDitherOff);
+
+                for( i=0; i < setCount; ++i )
+                {
+                    ConverterSet *set = &sets[i];
+                    const Tolerance *tolerance;
+                    const char *where = "";
+                    SampleDistance difference;
+                    long allowed;
+                    int g, duplicate = 0;
+
+                    /* flags which select the same converters were tested */
+                    paConverters = set->table;
+                    seen[f][i] = PaUtil_SelectConverter( sourceFormat, destinationFormat, flags );
+                    paConverters = portable;
+                    if( !seen[f][i] )
+                        continue;
+                    for( g=0; g < f; ++g )
+                        duplicate |= ( seen[g][i] == seen[f][i] );
+                    if( duplicate )
+                        continue;
+
+                    FillSource( sourceFormat, source, BUFFER_BYTES, clipped, dithered );
+                    difference = TestConverter( set, sourceFormat, destinationFormat, flags,
+                            &portable, source, destination, reference, &where );
+                    ++tested;
+
+                    tolerance = FindTolerance( set->name, sourceFormat, destinationFormat );
+                    allowed = tolerance ? tolerance->maxDifference : 0;
+
+                    if( difference < 0 || difference > allowed )
+                    {
+                        ++set->failures;
+                        printf( "FAIL %s %s->%s%s: %s\n", set->name,
+                                abbreviatedSampleFormatNames_[sourceIndex],
+                                abbreviatedSampleFormatNames_[destinationIndex],
+                                flagCombinationNames_[f], where );
+                        if( difference > 0 )
+                            printf( "     differs by %ld, %ld allowed\n", (long)difference, allowed );
+                    }
+                    else if( verbose_ || difference > 0 )
+                    {
+                        printf( "ok   %s %s->%s%s", set->name,
+                                abbreviatedSampleFormatNames_[sourceIndex],
+                                abbreviatedSampleFormatNames_[destinationIndex],
+                                flagCombinationNames_[f] );
+                        if( difference > 0 )
+                            printf( ": within %ld (%s), %ld seen", allowed, tolerance->reason, (long)difference );
+                        printf( "\n" );
+                    }
+                }
+            }
+        }
+    }
+
+    for( i=0; i < setCount; ++i )
+    {
+        printf( "%s: %lu conversions, %lu converters failed\n", sets[i].name,
+                sets[i].conversions, sets[i].failures );
+        conversions += sets[i].conversions;
+        failures += sets[i].failures;
+    }
+    printf( "%lu converters, %lu conversions: %s\n", tested, conversions, failures ? "FAILED" : "PASSED" );
+
+    free( source );
+    free( destination );
+    free( reference );
+
+    return failures ? 1 : 0;
+}